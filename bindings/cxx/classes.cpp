@@ -28,6 +28,7 @@
 
 #include <sstream>
 #include <cmath>
+#include <future>
 
 namespace sigrok
 {
@@ -231,6 +232,13 @@ void Context::set_log_level(const LogLevel *level)
 	check(sr_log_loglevel_set(level->id()));
 }
 
+void Context::set_thread_scheduling(enum sr_thread_class thread_class,
+	string cpus, int priority)
+{
+	check(sr_thread_sched_set(_structure, thread_class, cpus.c_str(),
+		priority));
+}
+
 static int call_log_callback(void *cb_data, int loglevel,
 		const char *format, va_list args) noexcept
 {
@@ -287,23 +295,61 @@ shared_ptr<UserDevice> Context::create_user_device(
 		default_delete<UserDevice>{}};
 }
 
+/* Packet and payload of a packet which Context created, in one block. */
+struct Packet::Storage
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_spec spec;
+
+	explicit Storage(uint16_t type) :
+		packet(), header(), meta(), logic(), analog(),
+		meaning(), encoding(), spec()
+	{
+		packet.type = type;
+	}
+
+	~Storage()
+	{
+		for (auto l = meta.config; l; l = l->next) {
+			auto *const config = static_cast<struct sr_config *>(l->data);
+			g_variant_unref(config->data);
+			g_free(config);
+		}
+		g_slist_free(meta.config);
+		g_slist_free(meaning.channels);
+	}
+};
+
+shared_ptr<Packet> Packet::from_storage(unique_ptr<Storage> storage,
+	void *payload)
+{
+	storage->packet.payload = payload;
+	auto packet = new Packet{nullptr, &storage->packet};
+	packet->_storage = move(storage);
+	return shared_ptr<Packet>{packet, default_delete<Packet>{}};
+}
+
 shared_ptr<Packet> Context::create_header_packet(Glib::DateTime start_time)
 {
-	auto header = g_new(struct sr_datafeed_header, 1);
+	unique_ptr<Packet::Storage> storage{new Packet::Storage{SR_DF_HEADER}};
+	auto *const header = &storage->header;
 	header->feed_version = 1;
 	header->starttime.tv_sec = start_time.to_unix();
 	header->starttime.tv_usec = start_time.get_microsecond();
-	auto packet = g_new(struct sr_datafeed_packet, 1);
-	packet->type = SR_DF_HEADER;
-	packet->payload = header;
-	return shared_ptr<Packet>{new Packet{nullptr, packet},
-		default_delete<Packet>{}};
+	return Packet::from_storage(move(storage), header);
 }
 
 shared_ptr<Packet> Context::create_meta_packet(
 	map<const ConfigKey *, Glib::VariantBase> config)
 {
-	auto meta = g_new0(struct sr_datafeed_meta, 1);
+	unique_ptr<Packet::Storage> storage{new Packet::Storage{SR_DF_META}};
+	auto *const meta = &storage->meta;
 	for (const auto &input : config) {
 		const auto &key = input.first;
 		const auto &value = input.second;
@@ -312,24 +358,18 @@ shared_ptr<Packet> Context::create_meta_packet(
 		output->data = value.gobj_copy();
 		meta->config = g_slist_append(meta->config, output);
 	}
-	auto packet = g_new(struct sr_datafeed_packet, 1);
-	packet->type = SR_DF_META;
-	packet->payload = meta;
-	return shared_ptr<Packet>{new Packet{nullptr, packet},
-		default_delete<Packet>{}};
+	return Packet::from_storage(move(storage), meta);
 }
 
 shared_ptr<Packet> Context::create_logic_packet(
 	void *data_pointer, size_t data_length, unsigned int unit_size)
 {
-	auto logic = g_new(struct sr_datafeed_logic, 1);
+	unique_ptr<Packet::Storage> storage{new Packet::Storage{SR_DF_LOGIC}};
+	auto *const logic = &storage->logic;
 	logic->length = data_length;
 	logic->unitsize = unit_size;
 	logic->data = data_pointer;
-	auto packet = g_new(struct sr_datafeed_packet, 1);
-	packet->type = SR_DF_LOGIC;
-	packet->payload = logic;
-	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
+	return Packet::from_storage(move(storage), logic);
 }
 
 shared_ptr<Packet> Context::create_analog_packet(
@@ -337,10 +377,11 @@ shared_ptr<Packet> Context::create_analog_packet(
 	const float *data_pointer, unsigned int num_samples, const Quantity *mq,
 	const Unit *unit, vector<const QuantityFlag *> mqflags)
 {
-	auto analog = g_new0(struct sr_datafeed_analog, 1);
-	auto meaning = g_new0(struct sr_analog_meaning, 1);
-	auto encoding = g_new0(struct sr_analog_encoding, 1);
-	auto spec = g_new0(struct sr_analog_spec, 1);
+	unique_ptr<Packet::Storage> storage{new Packet::Storage{SR_DF_ANALOG}};
+	auto *const analog = &storage->analog;
+	auto *const meaning = &storage->meaning;
+	auto *const encoding = &storage->encoding;
+	auto *const spec = &storage->spec;
 
 	analog->meaning = meaning;
 
@@ -373,18 +414,13 @@ shared_ptr<Packet> Context::create_analog_packet(
 
 	analog->num_samples = num_samples;
 	analog->data = (float*)data_pointer;
-	auto packet = g_new(struct sr_datafeed_packet, 1);
-	packet->type = SR_DF_ANALOG;
-	packet->payload = analog;
-	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
+	return Packet::from_storage(move(storage), analog);
 }
 
 shared_ptr<Packet> Context::create_end_packet()
 {
-	auto packet = g_new(struct sr_datafeed_packet, 1);
-	packet->type = SR_DF_END;
-	return shared_ptr<Packet>{new Packet{nullptr, packet},
-		default_delete<Packet>{}};
+	unique_ptr<Packet::Storage> storage{new Packet::Storage{SR_DF_END}};
+	return Packet::from_storage(move(storage), nullptr);
 }
 
 shared_ptr<Session> Context::load_session(string filename)
@@ -898,16 +934,46 @@ float TriggerMatch::value() const
 DatafeedCallbackData::DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback) :
 	_callback(move(callback)),
-	_session(session)
+	_session(session),
+	_sdi(nullptr)
 {
 }
 
 void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
-	auto device = _session->get_device(sdi);
-	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
-	_callback(move(device), move(packet));
+	// Packets keep arriving from the same device, look it up only once.
+	if (!_device || sdi != _sdi) {
+		_device = _session->get_device(sdi);
+		_sdi = sdi;
+	}
+
+	// Re-use the previous packet object when nobody else references it.
+	if (_packet && _packet.use_count() == 1)
+		_packet->set_structure(_device, pkt);
+	else
+		_packet.reset(new Packet{_device, pkt}, default_delete<Packet>{});
+
+	_callback(_device, _packet);
+
+	// Session devices reference their session, which owns this object.
+	// Keep them only until the end of the acquisition.
+	if (pkt->type == SR_DF_END &&
+			_session->_owned_devices.find(sdi) !=
+			_session->_owned_devices.end())
+		forget_device();
+
+	// Don't keep the device alive, the session device owns the session.
+	if (_packet.use_count() == 1)
+		_packet->_device.reset();
+	else
+		_packet.reset();
+}
+
+void DatafeedCallbackData::forget_device()
+{
+	_sdi = nullptr;
+	_device.reset();
 }
 
 SessionDevice::SessionDevice(struct sr_dev_inst *structure) :
@@ -951,18 +1017,23 @@ Session::Session(shared_ptr<Context> context, string filename) :
 
 Session::~Session()
 {
+	if (_thread.joinable()) {
+		sr_session_stop(_structure);
+		_thread.join();
+	}
 	check(sr_session_destroy(_structure));
 }
 
 shared_ptr<Device> Session::get_device(const struct sr_dev_inst *sdi)
 {
-	if (_owned_devices.count(sdi))
+	const auto owned = _owned_devices.find(sdi);
+	if (owned != _owned_devices.end())
 		return static_pointer_cast<Device>(
-			_owned_devices[sdi]->share_owned_by(shared_from_this()));
-	else if (_other_devices.count(sdi))
-		return _other_devices[sdi];
-	else
-		throw Error(SR_ERR_BUG);
+			owned->second->share_owned_by(shared_from_this()));
+	const auto other = _other_devices.find(sdi);
+	if (other != _other_devices.end())
+		return other->second;
+	throw Error(SR_ERR_BUG);
 }
 
 void Session::add_device(shared_ptr<Device> device)
@@ -970,6 +1041,8 @@ void Session::add_device(shared_ptr<Device> device)
 	const auto dev_struct = device->_structure;
 	check(sr_session_dev_add(_structure, dev_struct));
 	_other_devices[dev_struct] = move(device);
+	for (auto &callback : _datafeed_callbacks)
+		callback->forget_device();
 }
 
 vector<shared_ptr<Device>> Session::devices()
@@ -987,6 +1060,8 @@ vector<shared_ptr<Device>> Session::devices()
 
 void Session::remove_devices()
 {
+	for (auto &callback : _datafeed_callbacks)
+		callback->forget_device();
 	_other_devices.clear();
 	check(sr_session_dev_remove_all(_structure));
 }
@@ -1051,6 +1126,78 @@ void Session::remove_datafeed_callbacks()
 {
 	check(sr_session_datafeed_callback_remove_all(_structure));
 	_datafeed_callbacks.clear();
+	for (auto &stream : _packet_streams)
+		stream->finish();
+	_packet_streams.clear();
+}
+
+static void packet_stream_callback(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *pkt, void *cb_data) noexcept
+{
+	auto stream = static_cast<PacketStream *>(cb_data);
+	stream->push(sdi, pkt);
+}
+
+shared_ptr<PacketStream> Session::packets(size_t depth)
+{
+	shared_ptr<PacketStream> stream{new PacketStream{this, depth},
+		default_delete<PacketStream>{}};
+	check(sr_session_datafeed_callback_add_full(_structure,
+		&packet_stream_callback, stream.get(),
+		SR_DATAFEED_CB_REFCOUNTED));
+	_packet_streams.push_back(stream);
+	return stream;
+}
+
+void Session::start_async()
+{
+	if (_thread.joinable())
+		throw Error(SR_ERR);
+
+	// Start in the new thread, the session attaches to its main context.
+	promise<void> started;
+	auto started_future = started.get_future();
+	_thread_error = nullptr;
+	_thread = thread([this, &started]() {
+		auto *const main_context = g_main_context_new();
+		g_main_context_push_thread_default(main_context);
+		try {
+			start();
+		} catch (...) {
+			started.set_exception(current_exception());
+			g_main_context_pop_thread_default(main_context);
+			g_main_context_unref(main_context);
+			return;
+		}
+		started.set_value();
+		try {
+			run();
+		} catch (...) {
+			_thread_error = current_exception();
+		}
+		for (auto &stream : _packet_streams)
+			stream->finish();
+		g_main_context_pop_thread_default(main_context);
+		g_main_context_unref(main_context);
+	});
+
+	try {
+		started_future.get();
+	} catch (...) {
+		_thread.join();
+		throw;
+	}
+}
+
+void Session::wait()
+{
+	if (_thread.joinable())
+		_thread.join();
+	if (_thread_error) {
+		auto error = _thread_error;
+		_thread_error = nullptr;
+		rethrow_exception(error);
+	}
 }
 
 shared_ptr<Trigger> Session::trigger()
@@ -1073,16 +1220,188 @@ string Session::filename() const
 	return _filename;
 }
 
+void Session::set_datafeed_stats(bool enable)
+{
+	check(sr_session_datafeed_stats_set(_structure, enable));
+}
+
+void Session::set_thread_scheduling(enum sr_thread_class thread_class,
+	string cpus, int priority)
+{
+	check(sr_session_thread_sched_set(_structure, thread_class,
+		cpus.c_str(), priority));
+}
+
+struct sr_session_datafeed_stats Session::datafeed_stats() const
+{
+	struct sr_session_datafeed_stats stats;
+	check(sr_session_datafeed_stats_get(_structure, &stats));
+	return stats;
+}
+
+struct sr_datafeed_timing Session::datafeed_callback_timing(unsigned int index) const
+{
+	struct sr_datafeed_timing timing;
+	check(sr_session_datafeed_callback_timing_get(_structure, index, &timing));
+	return timing;
+}
+
 shared_ptr<Context> Session::context()
 {
 	return _context;
 }
 
+PacketStream::PacketStream(Session *session, size_t depth) :
+	_session(session),
+	_depth(depth ? depth : 1),
+	_ended(false)
+{
+}
+
+PacketStream::~PacketStream()
+{
+	clear();
+}
+
+void PacketStream::push(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *pkt)
+{
+	auto *const ref = sr_packet_ref(pkt);
+	if (!ref)
+		return;
+
+	PacketStreamReadyCallback ready;
+	{
+		unique_lock<mutex> lock(_mutex);
+		// A new run restarts the stream.
+		if (pkt->type == SR_DF_HEADER)
+			_ended = false;
+		_cond.wait(lock, [this]() {
+			return _queue.size() < _depth || _ended; });
+		if (_ended) {
+			sr_packet_unref(ref);
+			return;
+		}
+		_queue.push_back(Entry{_session->get_device(sdi), ref});
+		if (pkt->type == SR_DF_END)
+			_ended = true;
+		ready = _ready_callback;
+	}
+	_cond.notify_all();
+	if (ready)
+		ready();
+}
+
+void PacketStream::finish()
+{
+	PacketStreamReadyCallback ready;
+	{
+		lock_guard<mutex> lock(_mutex);
+		_ended = true;
+		ready = _ready_callback;
+	}
+	_cond.notify_all();
+	if (ready)
+		ready();
+}
+
+void PacketStream::clear()
+{
+	lock_guard<mutex> lock(_mutex);
+	for (auto &entry : _queue)
+		sr_packet_unref(entry.packet);
+	_queue.clear();
+}
+
+shared_ptr<Packet> PacketStream::wrap(Entry &entry)
+{
+	// The packet object owns the reference.
+	return shared_ptr<Packet>{new Packet{entry.device, entry.packet},
+		[](Packet *packet) {
+			sr_packet_unref(const_cast<struct sr_datafeed_packet *>(
+				packet->_structure));
+			delete packet;
+		}};
+}
+
+void PacketStream::take(shared_ptr<Device> &device, shared_ptr<Packet> &packet)
+{
+	auto entry = move(_queue.front());
+	_queue.pop_front();
+	device = entry.device;
+	packet = wrap(entry);
+}
+
+bool PacketStream::next(shared_ptr<Device> &device, shared_ptr<Packet> &packet)
+{
+	{
+		unique_lock<mutex> lock(_mutex);
+		_cond.wait(lock, [this]() { return !_queue.empty() || _ended; });
+		if (_queue.empty())
+			return false;
+		take(device, packet);
+	}
+	_cond.notify_all();
+	return true;
+}
+
+bool PacketStream::try_next(shared_ptr<Device> &device, shared_ptr<Packet> &packet)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		if (_queue.empty())
+			return false;
+		take(device, packet);
+	}
+	_cond.notify_all();
+	return true;
+}
+
+bool PacketStream::finished()
+{
+	lock_guard<mutex> lock(_mutex);
+	return _ended && _queue.empty();
+}
+
+void PacketStream::set_ready_callback(PacketStreamReadyCallback callback)
+{
+	lock_guard<mutex> lock(_mutex);
+	_ready_callback = move(callback);
+}
+
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
-	_structure(structure),
-	_device(move(device))
+	_structure(nullptr)
+{
+	set_structure(move(device), structure);
+}
+
+Packet::~Packet()
+{
+}
+
+void Packet::set_structure(shared_ptr<Device> device,
+	const struct sr_datafeed_packet *structure)
 {
+	_structure = structure;
+	_device = move(device);
+
+	// Logic and analog packets are frequent, keep their payload object.
+	if (structure->type == SR_DF_LOGIC) {
+		if (auto *const logic = dynamic_cast<Logic *>(_payload.get())) {
+			logic->_structure = static_cast<
+				const struct sr_datafeed_logic *>(structure->payload);
+			return;
+		}
+	} else if (structure->type == SR_DF_ANALOG) {
+		if (auto *const analog = dynamic_cast<Analog *>(_payload.get())) {
+			analog->_structure = static_cast<
+				const struct sr_datafeed_analog *>(structure->payload);
+			return;
+		}
+	}
+
+	_payload.reset();
 	switch (structure->type)
 	{
 		case SR_DF_HEADER:
@@ -1108,8 +1427,20 @@ Packet::Packet(shared_ptr<Device> device,
 	}
 }
 
-Packet::~Packet()
+void Packet::set_logic_data(void *data_pointer, size_t data_length)
 {
+	if (!_storage || _storage->packet.type != SR_DF_LOGIC)
+		throw Error(SR_ERR_ARG);
+	_storage->logic.data = data_pointer;
+	_storage->logic.length = data_length;
+}
+
+void Packet::set_analog_data(const float *data_pointer, unsigned int num_samples)
+{
+	if (!_storage || _storage->packet.type != SR_DF_ANALOG)
+		throw Error(SR_ERR_ARG);
+	_storage->analog.data = (float *)data_pointer;
+	_storage->analog.num_samples = num_samples;
 }
 
 const PacketType *Packet::type() const
@@ -1217,6 +1548,63 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+size_t Logic::num_samples() const
+{
+	return _structure->unitsize ? _structure->length / _structure->unitsize : 0;
+}
+
+LogicChannelView Logic::channel(unsigned int bit) const
+{
+	if (bit >= _structure->unitsize * 8)
+		throw Error(SR_ERR_ARG);
+	return LogicChannelView(
+		static_cast<const uint8_t *>(_structure->data) + bit / 8,
+		_structure->unitsize, num_samples(), bit % 8);
+}
+
+AnalogFloatView::AnalogFloatView(const struct sr_datafeed_analog *structure,
+		unsigned int channel, unsigned int num_channels) :
+	_structure(structure),
+	_channel(channel),
+	_num_channels(num_channels),
+	_block_start(0),
+	_block_length(0)
+{
+}
+
+size_t AnalogFloatView::size() const
+{
+	return _structure->num_samples;
+}
+
+float AnalogFloatView::operator[](size_t idx) const
+{
+	if (idx - _block_start >= _block_length)
+		load(idx);
+	return _block[idx - _block_start];
+}
+
+void AnalogFloatView::load(size_t idx) const
+{
+	struct sr_datafeed_analog block = *_structure;
+	size_t start = idx - idx % block_size;
+	size_t stride = _structure->encoding->unitsize * _num_channels;
+	size_t remain = _structure->num_samples - start;
+
+	if (idx >= _structure->num_samples)
+		throw Error(SR_ERR_ARG);
+
+	/* Convert only the block of samples around idx. */
+	block.data = static_cast<uint8_t *>(_structure->data) + start * stride;
+	block.num_samples = remain < block_size ? remain : block_size;
+	if (_num_channels == 1)
+		check(sr_analog_to_float(&block, _block));
+	else
+		check(sr_analog_to_float_channel(&block, _channel, _block));
+	_block_start = start;
+	_block_length = block.num_samples;
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
 	_structure(structure)
@@ -1243,6 +1631,15 @@ void Analog::get_data_as_float(float *dest)
 	check(sr_analog_to_float(_structure, dest));
 }
 
+AnalogFloatView Analog::float_view(unsigned int channel) const
+{
+	unsigned int num_channels = g_slist_length(_structure->meaning->channels);
+
+	if (channel >= num_channels)
+		throw Error(SR_ERR_ARG);
+	return AnalogFloatView(_structure, channel, num_channels);
+}
+
 unsigned int Analog::num_samples() const
 {
 	return _structure->num_samples;
@@ -1682,6 +2079,32 @@ string Output::receive(shared_ptr<Packet> packet)
 	}
 }
 
+string Output::receive(shared_ptr<Packet> packet,
+	const vector<pair<const void *, size_t> > &buffers)
+{
+	const auto type = packet->_structure->type;
+	if (type != SR_DF_LOGIC && type != SR_DF_ANALOG)
+		throw Error(SR_ERR_ARG);
+
+	string result;
+	for (const auto &buffer : buffers) {
+		if (type == SR_DF_LOGIC)
+			packet->set_logic_data(const_cast<void *>(buffer.first),
+				buffer.second);
+		else
+			packet->set_analog_data(
+				static_cast<const float *>(buffer.first),
+				buffer.second);
+		GString *out;
+		check(sr_output_send(_structure, packet->_structure, &out));
+		if (out) {
+			result.append(out->str, out->len);
+			g_string_free(out, true);
+		}
+	}
+	return result;
+}
+
 #include <enums.cpp>
 
 }
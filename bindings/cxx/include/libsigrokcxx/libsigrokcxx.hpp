@@ -78,9 +78,16 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 #include <glibmm.h>
 G_GNUC_END_IGNORE_DEPRECATIONS
 
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <iterator>
 #include <stdexcept>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <map>
 #include <set>
@@ -109,6 +116,7 @@ class SR_API TriggerMatch;
 class SR_API TriggerMatchType;
 class SR_API ChannelType;
 class SR_API Packet;
+class SR_API PacketStream;
 class SR_API PacketPayload;
 class SR_API PacketType;
 class SR_API Quantity;
@@ -268,6 +276,12 @@ public:
 	/** Install a delegate for reading resource files.
 	 * @param reader The resource reader delegate, or nullptr to unset. */
 	void set_resource_reader(ResourceReader *reader);
+	/** Set where and how a kind of thread runs, for all sessions.
+	 * @param thread_class The kind of thread.
+	 * @param cpus The CPUs to run on, like "2-3,6", empty for all.
+	 * @param priority SCHED_FIFO priority 1-99, 0 for normal scheduling. */
+	void set_thread_scheduling(enum sr_thread_class thread_class,
+		std::string cpus, int priority = 0);
 	/** Create a new session. */
 	std::shared_ptr<Session> create_session();
 	/** Create a new user device. */
@@ -278,10 +292,14 @@ public:
 	/** Create a meta packet. */
 	std::shared_ptr<Packet> create_meta_packet(
 		std::map<const ConfigKey *, Glib::VariantBase> config);
-	/** Create a logic packet. */
+	/** Create a logic packet.
+	 * The packet can be pointed at further data, see
+	 * Packet::set_logic_data(). */
 	std::shared_ptr<Packet> create_logic_packet(
 		void *data_pointer, size_t data_length, unsigned int unit_size);
-	/** Create an analog packet. */
+	/** Create an analog packet.
+	 * The packet can be pointed at further samples, see
+	 * Packet::set_analog_data(). */
 	std::shared_ptr<Packet> create_analog_packet(
 		std::vector<std::shared_ptr<Channel> > channels,
 		const float *data_pointer, unsigned int num_samples, const Quantity *mq,
@@ -588,7 +606,13 @@ private:
 	DatafeedCallbackFunction _callback;
 	DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback);
+	void forget_device();
 	Session *_session;
+	/* Device of the most recent packet, kept while registered. */
+	const struct sr_dev_inst *_sdi;
+	std::shared_ptr<Device> _device;
+	/* Packet object for re-use, when the callback did not keep it. */
+	std::shared_ptr<Packet> _packet;
 	friend class Session;
 };
 
@@ -641,6 +665,32 @@ public:
 	void set_trigger(std::shared_ptr<Trigger> trigger);
 	/** Get filename this session was loaded from. */
 	std::string filename() const;
+	/** Enable or disable the collection of datafeed statistics.
+	 * @param enable Whether to collect statistics. */
+	void set_datafeed_stats(bool enable);
+	/** Set where and how a kind of thread runs, for this session.
+	 * Overrides the settings of the context.
+	 * @param thread_class The kind of thread.
+	 * @param cpus The CPUs to run on, like "2-3,6", empty for all.
+	 * @param priority SCHED_FIFO priority 1-99, 0 for normal scheduling. */
+	void set_thread_scheduling(enum sr_thread_class thread_class,
+		std::string cpus, int priority = 0);
+	/** Get the datafeed statistics of the current or last run. */
+	struct sr_session_datafeed_stats datafeed_stats() const;
+	/** Get the time spent in a datafeed callback.
+	 * @param index Position of the callback, in the order of registration. */
+	struct sr_datafeed_timing datafeed_callback_timing(unsigned int index) const;
+	/** Create a stream which receives the packets of this session.
+	 * Streams stay attached until remove_datafeed_callbacks().
+	 * @param depth Maximum number of queued packets. The session waits
+	 *              for the consumer when the stream is full. */
+	std::shared_ptr<PacketStream> packets(size_t depth = 64);
+	/** Start the session, and run its event loop on a thread which is
+	 * owned by the session. Errors from starting get thrown here. */
+	void start_async();
+	/** Wait for the session thread of start_async() to finish.
+	 * Errors from running the session get thrown here. */
+	void wait();
 private:
 	explicit Session(std::shared_ptr<Context> context);
 	Session(std::shared_ptr<Context> context, std::string filename);
@@ -654,9 +704,13 @@ private:
 	SessionStoppedCallback _stopped_callback;
 	std::string _filename;
 	std::shared_ptr<Trigger> _trigger;
+	std::vector<std::shared_ptr<PacketStream> > _packet_streams;
+	std::thread _thread;
+	std::exception_ptr _thread_error;
 
 	friend class Context;
 	friend class DatafeedCallbackData;
+	friend class PacketStream;
 	friend class SessionDevice;
 	friend struct std::default_delete<Session>;
 };
@@ -669,17 +723,37 @@ public:
 	const PacketType *type() const;
 	/** Payload of this packet. */
 	std::shared_ptr<PacketPayload> payload();
+	/** Point a packet from Context::create_logic_packet() at new data.
+	 * This re-uses the packet, instead of creating one per buffer.
+	 * @param data_pointer The data, which must stay valid while the
+	 *                     packet is in use.
+	 * @param data_length Size of the data in bytes. */
+	void set_logic_data(void *data_pointer, size_t data_length);
+	/** Point a packet from Context::create_analog_packet() at new samples.
+	 * This re-uses the packet, instead of creating one per buffer.
+	 * @param data_pointer The samples, which must stay valid while the
+	 *                     packet is in use.
+	 * @param num_samples Number of samples. */
+	void set_analog_data(const float *data_pointer, unsigned int num_samples);
 private:
 	Packet(std::shared_ptr<Device> device,
 		const struct sr_datafeed_packet *structure);
 	~Packet();
+	void set_structure(std::shared_ptr<Device> device,
+		const struct sr_datafeed_packet *structure);
 	const struct sr_datafeed_packet *_structure;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
+	/* Packet and payload of packets which Context creates. */
+	struct Storage;
+	std::unique_ptr<Storage> _storage;
+	static std::shared_ptr<Packet> from_storage(
+		std::unique_ptr<Storage> storage, void *payload);
 
 	friend class Session;
 	friend class Output;
 	friend class DatafeedCallbackData;
+	friend class PacketStream;
 	friend class Header;
 	friend class Meta;
 	friend class Logic;
@@ -688,6 +762,64 @@ private:
 	friend struct std::default_delete<Packet>;
 };
 
+/** Type of packet stream readiness callback */
+typedef std::function<void()> PacketStreamReadyCallback;
+
+/** A bounded queue of the packets on a session datafeed.
+
+	Packets are referenced, not copied, and remain valid as long as the
+	consumer holds them. The stream gets filled from the session's
+	datafeed, which runs on the session's delivery thread when a datafeed
+	ring is configured for the session. */
+class SR_API PacketStream
+{
+public:
+	/** Wait for the next packet.
+	 * @param device Where to store the packet's device.
+	 * @param packet Where to store the packet.
+	 * @return False when the session's run ended, after all packets were
+	 *         taken. */
+	bool next(std::shared_ptr<Device> &device, std::shared_ptr<Packet> &packet);
+	/** Take the next packet if one is queued, without waiting.
+	 * @param device Where to store the packet's device.
+	 * @param packet Where to store the packet.
+	 * @return False when no packet is queued. */
+	bool try_next(std::shared_ptr<Device> &device, std::shared_ptr<Packet> &packet);
+	/** Return whether the session's run ended, and all packets were taken. */
+	bool finished();
+	/** Set a callback to be invoked when a packet got queued, or the run
+	 * ended. It runs on the thread which feeds the stream, and is meant
+	 * to wake up an event loop or resume a coroutine, which then takes
+	 * the packets with try_next(). */
+	void set_ready_callback(PacketStreamReadyCallback callback);
+private:
+	struct Entry
+	{
+		std::shared_ptr<Device> device;
+		struct sr_datafeed_packet *packet;
+	};
+
+	PacketStream(Session *session, size_t depth);
+	~PacketStream();
+	void push(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *pkt);
+	void finish();
+	void clear();
+	std::shared_ptr<Packet> wrap(Entry &entry);
+	void take(std::shared_ptr<Device> &device, std::shared_ptr<Packet> &packet);
+
+	Session *_session;
+	size_t _depth;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::deque<Entry> _queue;
+	bool _ended;
+	PacketStreamReadyCallback _ready_callback;
+
+	friend class Session;
+	friend struct std::default_delete<PacketStream>;
+};
+
 /** Abstract base class for datafeed packet payloads */
 class SR_API PacketPayload
 {
@@ -741,6 +873,148 @@ private:
 	friend class Packet;
 };
 
+/**
+ * Non-owning view of a contiguous array of values.
+ *
+ * The view is only valid as long as the packet it was taken from.
+ */
+template <class T>
+class Span
+{
+public:
+	Span(T *data, size_t size) : _data(data), _size(size) {}
+	/** Pointer to the first element. */
+	T *data() const { return _data; }
+	/** Number of elements. */
+	size_t size() const { return _size; }
+	/** The view has no elements. */
+	bool empty() const { return _size == 0; }
+	T &operator[](size_t idx) const { return _data[idx]; }
+	T *begin() const { return _data; }
+	T *end() const { return _data + _size; }
+private:
+	T *_data;
+	size_t _size;
+};
+
+/**
+ * Non-owning view of the levels of one channel in a logic packet.
+ *
+ * The view is only valid as long as the packet it was taken from.
+ */
+class SR_API LogicChannelView
+{
+public:
+	/** Iterator over the levels, yields one bool per sample. */
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef bool value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const bool *pointer;
+		typedef bool reference;
+
+		bool operator*() const { return (*_ptr >> _shift) & 1; }
+		const_iterator &operator++() { _ptr += _stride; return *this; }
+		const_iterator operator++(int)
+			{ const_iterator old(*this); _ptr += _stride; return old; }
+		bool operator==(const const_iterator &other) const
+			{ return _ptr == other._ptr; }
+		bool operator!=(const const_iterator &other) const
+			{ return _ptr != other._ptr; }
+	private:
+		const_iterator(const uint8_t *ptr, size_t stride, unsigned int shift) :
+			_ptr(ptr), _stride(stride), _shift(shift) {}
+		const uint8_t *_ptr;
+		size_t _stride;
+		unsigned int _shift;
+
+		friend class LogicChannelView;
+	};
+
+	/** Number of samples. */
+	size_t size() const { return _size; }
+	/** Level of the channel in the given sample. */
+	bool operator[](size_t idx) const
+		{ return (_data[idx * _stride] >> _shift) & 1; }
+	const_iterator begin() const
+		{ return const_iterator(_data, _stride, _shift); }
+	const_iterator end() const
+		{ return const_iterator(_data + _size * _stride, _stride, _shift); }
+private:
+	LogicChannelView(const uint8_t *data, size_t stride, size_t size,
+		unsigned int shift) :
+		_data(data), _stride(stride), _size(size), _shift(shift) {}
+	const uint8_t *_data;
+	size_t _stride;
+	size_t _size;
+	unsigned int _shift;
+
+	friend class Logic;
+};
+
+/**
+ * Non-owning view of the samples of one channel in an analog packet,
+ * converted to float on access.
+ *
+ * Samples are converted in blocks as they are accessed, so no buffer for
+ * the whole packet is needed. The view is only valid as long as the packet
+ * it was taken from. Copies of the view have their own block buffer.
+ */
+class SR_API AnalogFloatView
+{
+public:
+	/** Iterator over the converted samples. */
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef float value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const float *pointer;
+		typedef float reference;
+
+		float operator*() const { return (*_view)[_idx]; }
+		const_iterator &operator++() { _idx++; return *this; }
+		const_iterator operator++(int)
+			{ const_iterator old(*this); _idx++; return old; }
+		bool operator==(const const_iterator &other) const
+			{ return _idx == other._idx; }
+		bool operator!=(const const_iterator &other) const
+			{ return _idx != other._idx; }
+	private:
+		const_iterator(const AnalogFloatView *view, size_t idx) :
+			_view(view), _idx(idx) {}
+		const AnalogFloatView *_view;
+		size_t _idx;
+
+		friend class AnalogFloatView;
+	};
+
+	/** Number of samples. */
+	size_t size() const;
+	/** Converted value of the given sample. */
+	float operator[](size_t idx) const;
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+private:
+	static const size_t block_size = 256;
+
+	AnalogFloatView(const struct sr_datafeed_analog *structure,
+		unsigned int channel, unsigned int num_channels);
+	void load(size_t idx) const;
+
+	const struct sr_datafeed_analog *_structure;
+	unsigned int _channel;
+	unsigned int _num_channels;
+	mutable size_t _block_start;
+	mutable size_t _block_length;
+	mutable float _block[block_size];
+
+	friend class Analog;
+};
+
 /** Payload of a datafeed packet with logic data */
 class SR_API Logic :
 	public ParentOwned<Logic, Packet>,
@@ -753,6 +1027,17 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** Number of samples in this packet. */
+	size_t num_samples() const;
+	/**
+	 * View of the samples as unsigned integers of the unit size, e.g.
+	 * uint16_t for a unit size of 2. Throws if the size of T differs
+	 * from the unit size. Samples are stored in little endian order,
+	 * the values match the channel bits on little endian hosts only.
+	 */
+	template <class T> Span<const T> samples() const;
+	/** View of the levels of the channel at the given bit position. */
+	LogicChannelView channel(unsigned int bit) const;
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -765,6 +1050,15 @@ private:
 	friend struct std::default_delete<Logic>;
 };
 
+template <class T>
+Span<const T> Logic::samples() const
+{
+	if (sizeof(T) != _structure->unitsize)
+		throw Error(SR_ERR_ARG);
+	return Span<const T>(static_cast<const T *>(_structure->data),
+		_structure->length / sizeof(T));
+}
+
 /** Payload of a datafeed packet with analog data */
 class SR_API Analog :
 	public ParentOwned<Analog, Packet>,
@@ -778,6 +1072,12 @@ public:
 	 * The pointer must have space for num_samples() floats.
 	 */
 	void get_data_as_float(float *dest);
+	/**
+	 * View of the samples of one channel, converted to float on access.
+	 *
+	 * @param channel Index of the channel in channels().
+	 */
+	AnalogFloatView float_view(unsigned int channel = 0) const;
 	/** Number of samples in this packet. */
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
@@ -1028,6 +1328,15 @@ public:
 	/** Update output with data from the given packet.
 	 * @param packet Packet to handle. */
 	std::string receive(std::shared_ptr<Packet> packet);
+	/** Update output with data from many buffers in one call.
+	 * The packet gets pointed at each buffer in turn, see
+	 * Packet::set_logic_data() and Packet::set_analog_data().
+	 * @param packet Logic or analog packet from Context.
+	 * @param buffers Pairs of data pointer and length, in bytes for
+	 *                logic packets, in samples for analog packets.
+	 * @return Output for all of the buffers. */
+	std::string receive(std::shared_ptr<Packet> packet,
+		const std::vector<std::pair<const void *, size_t> > &buffers);
 	/** Output format in use for this output */
 	std::shared_ptr<OutputFormat> format();
 private:
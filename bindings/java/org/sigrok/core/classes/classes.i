@@ -36,6 +36,7 @@
 
 import org.sigrok.core.interfaces.LogCallback;
 import org.sigrok.core.interfaces.DatafeedCallback;
+import org.sigrok.core.interfaces.BatchedDatafeedCallback;
 %}
 
 /* Map Glib::VariantBase to a Variant class in Java */
@@ -322,7 +323,8 @@ typedef jobject jlogcallback;
 /* Support Java datafeed callbacks. */
 
 %typemap(javaimports) sigrok::Session
-  "import org.sigrok.core.interfaces.DatafeedCallback;"
+  "import org.sigrok.core.interfaces.DatafeedCallback;
+import org.sigrok.core.interfaces.BatchedDatafeedCallback;"
 
 %inline {
 typedef jobject jdatafeedcallback;
@@ -372,6 +374,228 @@ typedef jobject jdatafeedcallback;
   }
 }
 
+/*
+ * Support Java batched datafeed callbacks. The packets are referenced,
+ * not copied, and stay valid as long as the Java Packet objects do.
+ * A batch gets delivered when it is full, and at the end of a run.
+ */
+
+%{
+namespace {
+  struct DatafeedBatch
+  {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<sigrok::Device> > devices;
+    std::vector<std::shared_ptr<sigrok::Packet> > packets;
+  };
+}
+%}
+
+%inline {
+typedef jobject jbatcheddatafeedcallback;
+}
+
+%typemap(jni) jbatcheddatafeedcallback "jbatcheddatafeedcallback"
+%typemap(jtype) jbatcheddatafeedcallback "BatchedDatafeedCallback"
+%typemap(jstype) jbatcheddatafeedcallback "BatchedDatafeedCallback"
+%typemap(javain) jbatcheddatafeedcallback "$javainput"
+
+%extend sigrok::Session
+{
+  void add_batched_datafeed_callback(JNIEnv *env,
+    jbatcheddatafeedcallback obj, unsigned int max_packets)
+  {
+    JavaVM *jvm = NULL;
+    env->GetJavaVM(&jvm);
+    jclass obj_class = env->GetObjectClass(obj);
+    jmethodID method = env->GetMethodID(obj_class, "run",
+      "([Lorg/sigrok/core/classes/Device;[Lorg/sigrok/core/classes/Packet;)V");
+    GlobalRef<jclass> Device(jvm, env->FindClass("org/sigrok/core/classes/Device"));
+    jmethodID Device_init = env->GetMethodID(Device, "<init>", "(JZ)V");
+    GlobalRef<jclass> Packet(jvm, env->FindClass("org/sigrok/core/classes/Packet"));
+    jmethodID Packet_init = env->GetMethodID(Packet, "<init>", "(JZ)V");
+    GlobalRef<jobject> obj_ref(jvm, obj);
+
+    if (!max_packets)
+      max_packets = 1;
+    auto stream = $self->packets(max_packets);
+    std::weak_ptr<sigrok::PacketStream> weak_stream = stream;
+    auto batch = std::make_shared<DatafeedBatch>();
+    batch->devices.reserve(max_packets);
+    batch->packets.reserve(max_packets);
+
+    // Runs on the thread feeding the stream, which must not throw.
+    stream->set_ready_callback([=] ()
+    {
+      auto stream = weak_stream.lock();
+      if (!stream)
+        return;
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      std::shared_ptr<sigrok::Device> device;
+      std::shared_ptr<sigrok::Packet> packet;
+      bool ended = false;
+      while (stream->try_next(device, packet)) {
+        ended = ended || packet->type() == sigrok::PacketType::END;
+        batch->devices.push_back(std::move(device));
+        batch->packets.push_back(std::move(packet));
+      }
+      if (batch->packets.empty())
+        return;
+      if (batch->packets.size() < max_packets && !ended &&
+          !stream->finished())
+        return;
+
+      ScopedEnv env(jvm);
+      if (env) {
+        jsize count = batch->packets.size();
+        jobjectArray devices = env->NewObjectArray(count, Device, NULL);
+        jobjectArray packets = env->NewObjectArray(count, Packet, NULL);
+        for (jsize i = 0; devices && packets && i < count; i++) {
+          jlong device_addr = 0;
+          jlong packet_addr = 0;
+          *(std::shared_ptr<sigrok::Device> **) &device_addr =
+            new std::shared_ptr<sigrok::Device>(batch->devices[i]);
+          *(std::shared_ptr<sigrok::Packet> **) &packet_addr =
+            new std::shared_ptr<sigrok::Packet>(batch->packets[i]);
+          jobject device_obj = env->NewObject(
+            Device, Device_init, device_addr, true);
+          jobject packet_obj = env->NewObject(
+            Packet, Packet_init, packet_addr, true);
+          env->SetObjectArrayElement(devices, i, device_obj);
+          env->SetObjectArrayElement(packets, i, packet_obj);
+          env->DeleteLocalRef(device_obj);
+          env->DeleteLocalRef(packet_obj);
+        }
+        if (devices && packets)
+          env->CallVoidMethod(obj_ref, method, devices, packets);
+        if (env->ExceptionCheck()) {
+          env->ExceptionDescribe();
+          env->ExceptionClear();
+        }
+        env->DeleteLocalRef(devices);
+        env->DeleteLocalRef(packets);
+      }
+      batch->devices.clear();
+      batch->packets.clear();
+    });
+  }
+}
+
+/*
+ * Direct buffer views of logic and analog payloads, without copies. The
+ * views point into the packet, and are only valid while the packet is:
+ * for the duration of a plain datafeed callback, or for as long as the
+ * Java Packet object of a batched datafeed callback is kept.
+ */
+
+%inline {
+typedef jobject jbytebuffer;
+typedef jobject jfloatbuffer;
+}
+
+%typemap(jni) jbytebuffer "jbytebuffer"
+%typemap(jtype) jbytebuffer "java.nio.ByteBuffer"
+%typemap(jstype) jbytebuffer "java.nio.ByteBuffer"
+%typemap(out) jbytebuffer %{ $result = $1; %}
+%typemap(javaout) jbytebuffer { return $jnicall; }
+
+%typemap(jni) jfloatbuffer "jfloatbuffer"
+%typemap(jtype) jfloatbuffer "java.nio.FloatBuffer"
+%typemap(jstype) jfloatbuffer "java.nio.FloatBuffer"
+%typemap(out) jfloatbuffer %{ $result = $1; %}
+%typemap(javaout) jfloatbuffer { return $jnicall; }
+
+%{
+namespace {
+  /* Set the byte order of a buffer, return the buffer. */
+  jobject buffer_order(JNIEnv *env, jobject buffer, bool big_endian)
+  {
+    if (!buffer)
+      return NULL;
+    jclass ByteOrder = env->FindClass("java/nio/ByteOrder");
+    jfieldID field = env->GetStaticFieldID(ByteOrder,
+      big_endian ? "BIG_ENDIAN" : "LITTLE_ENDIAN", "Ljava/nio/ByteOrder;");
+    jobject order = env->GetStaticObjectField(ByteOrder, field);
+    jmethodID method = env->GetMethodID(env->GetObjectClass(buffer),
+      "order", "(Ljava/nio/ByteOrder;)Ljava/nio/ByteBuffer;");
+    jobject result = env->CallObjectMethod(buffer, method, order);
+    env->DeleteLocalRef(order);
+    env->DeleteLocalRef(ByteOrder);
+    if (result != buffer)
+      env->DeleteLocalRef(buffer);
+    return result;
+  }
+
+  jobject as_float_buffer(JNIEnv *env, jobject buffer)
+  {
+    if (!buffer)
+      return NULL;
+    jmethodID method = env->GetMethodID(env->GetObjectClass(buffer),
+      "asFloatBuffer", "()Ljava/nio/FloatBuffer;");
+    jobject result = env->CallObjectMethod(buffer, method);
+    env->DeleteLocalRef(buffer);
+    return result;
+  }
+}
+%}
+
+%extend sigrok::Logic
+{
+  /* Samples of the packet, unit_size() bytes each. */
+  jbytebuffer data_buffer(JNIEnv *env)
+  {
+    return env->NewDirectByteBuffer($self->data_pointer(),
+      $self->data_length());
+  }
+}
+
+%extend sigrok::Analog
+{
+  /* Samples of the packet in their encoding, with its byte order. */
+  jbytebuffer data_buffer(JNIEnv *env)
+  {
+    jlong length = (jlong)$self->num_samples() *
+      $self->channels().size() * $self->unitsize();
+    return buffer_order(env, env->NewDirectByteBuffer(
+      $self->data_pointer(), length), $self->is_bigendian());
+  }
+
+  /*
+   * Samples as floats, interleaved when there are several channels.
+   * Native unscaled float samples get viewed in the packet, others get
+   * converted into a new direct buffer.
+   */
+  jfloatbuffer float_buffer(JNIEnv *env)
+  {
+    bool big_endian = G_BYTE_ORDER == G_BIG_ENDIAN;
+    jlong count = (jlong)$self->num_samples() * $self->channels().size();
+    auto scale = $self->scale();
+    auto offset = $self->offset();
+    jobject buffer;
+
+    if ($self->is_float() && $self->unitsize() == sizeof(float) &&
+        $self->is_bigendian() == big_endian &&
+        scale->numerator() == (int64_t)scale->denominator() &&
+        offset->numerator() == 0) {
+      buffer = env->NewDirectByteBuffer($self->data_pointer(),
+        count * sizeof(float));
+    } else {
+      jclass ByteBuffer = env->FindClass("java/nio/ByteBuffer");
+      jmethodID allocate = env->GetStaticMethodID(ByteBuffer,
+        "allocateDirect", "(I)Ljava/nio/ByteBuffer;");
+      buffer = env->CallStaticObjectMethod(ByteBuffer, allocate,
+        (jint)(count * sizeof(float)));
+      env->DeleteLocalRef(ByteBuffer);
+      if (!buffer)
+        return NULL;
+      $self->get_data_as_float(
+        static_cast<float *>(env->GetDirectBufferAddress(buffer)));
+    }
+
+    return as_float_buffer(env, buffer_order(env, buffer, big_endian));
+  }
+}
+
 %include "doc.i"
 
 %define %enumextras(Class)
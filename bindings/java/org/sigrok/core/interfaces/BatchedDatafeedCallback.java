@@ -0,0 +1,9 @@
+package org.sigrok.core.interfaces;
+
+import org.sigrok.core.classes.Device;
+import org.sigrok.core.classes.Packet;
+
+public interface BatchedDatafeedCallback
+{
+    public void run(Device[] devices, Packet[] packets);
+}
@@ -295,6 +295,55 @@ typedef guint pyg_flags_type;
 }
 }
 
+/*
+ * Release the GIL while the session runs. Callbacks take it back for
+ * each invocation, so other Python threads run during acquisition, and
+ * can e.g. call Session.stop().
+ */
+%exception sigrok::Session::run {
+    PyThreadState *thread_state = PyEval_SaveThread();
+    try {
+        $action
+    } catch (sigrok::Error &e) {
+        PyEval_RestoreThread(thread_state);
+        SWIG_exception(swig_exception_code(e.result),
+            const_cast<char*>(e.what()));
+    } catch (...) {
+        PyEval_RestoreThread(thread_state);
+        throw;
+    }
+    PyEval_RestoreThread(thread_state);
+}
+
+%extend sigrok::Session
+{
+%pythoncode
+{
+    def add_datafeed_queue(self, maxsize=0):
+        """Deliver the sample data of the datafeed to a thread safe queue.
+
+        Logic and analog packets are queued as (device, packet type, array)
+        tuples, where the NumPy array holds a copy of the packet's data
+        (analog data gets converted to float32). None is queued at the end
+        of the datafeed. With maxsize set, the session waits for consumers
+        to catch up when the queue is full."""
+        try:
+            import queue
+        except ImportError:
+            import Queue as queue
+        q = queue.Queue(maxsize)
+        def callback(device, packet):
+            if packet.type == PacketType.LOGIC:
+                q.put((device, packet.type, packet.payload.data.copy()))
+            elif packet.type == PacketType.ANALOG:
+                q.put((device, packet.type, packet.payload.data_as_float()))
+            elif packet.type == PacketType.END:
+                q.put(None)
+        self.add_datafeed_callback(callback)
+        return q
+}
+}
+
 %{
 
 #include "libsigrokcxx/libsigrokcxx.hpp"
@@ -543,10 +592,31 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     }
 }
 
+%{
+/*
+ * Wrap payload data in a NumPy array without copying it. The array
+ * keeps the payload object, and thereby the packet, alive.
+ */
+static PyObject *payload_array(PyObject *owner, int nd, npy_intp *dims,
+    int typenum, void *data)
+{
+    PyObject *array = PyArray_SimpleNewFromData(nd, dims, typenum, data);
+    if (!array)
+        return nullptr;
+    Py_INCREF(owner);
+    /* Steals the reference to owner, also on failure. */
+    if (PyArray_SetBaseObject((PyArrayObject *)array, owner) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+    return array;
+}
+%}
+
 /* Return NumPy array from Analog::data(). */
 %extend sigrok::Analog
 {
-    PyObject * _data()
+    PyObject * _data(PyObject *owner)
     {
         int nd = 2;
         npy_intp dims[2];
@@ -554,31 +624,91 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         dims[1] = $self->num_samples();
         int typenum = NPY_FLOAT;
         void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+        return payload_array(owner, nd, dims, typenum, data);
+    }
+
+    /*
+     * Convert the samples to float, into the given C contiguous float32
+     * array or into a new one when out is None. Samples of several
+     * channels are interleaved, as in the packet.
+     */
+    PyObject * _data_as_float(PyObject *out)
+    {
+        npy_intp num_samples = $self->num_samples();
+        npy_intp num_channels = $self->channels().size();
+        npy_intp dims[2] = { num_samples, num_channels };
+
+        if (out == Py_None) {
+            out = PyArray_SimpleNew(num_channels > 1 ? 2 : 1, dims,
+                NPY_FLOAT32);
+            if (!out)
+                return nullptr;
+        } else {
+            if (!PyArray_Check(out) ||
+                    PyArray_TYPE((PyArrayObject *)out) != NPY_FLOAT32 ||
+                    !PyArray_ISCARRAY((PyArrayObject *)out) ||
+                    PyArray_SIZE((PyArrayObject *)out) <
+                    num_samples * num_channels) {
+                PyErr_SetString(PyExc_ValueError,
+                    "Expected a writable C contiguous float32 array of sufficient size");
+                return nullptr;
+            }
+            Py_INCREF(out);
+        }
+
+        try {
+            $self->get_data_as_float(
+                (float *)PyArray_DATA((PyArrayObject *)out));
+        } catch (...) {
+            Py_DECREF(out);
+            throw;
+        }
+
+        return out;
     }
 
 %pythoncode
 {
-    data = property(_data)
+    def _data_property(self):
+        return self._data(self)
+
+    def data_as_float(self, out=None):
+        """Convert samples to float, optionally into a preallocated array."""
+        return self._data_as_float(out)
+
+    def _array_interface(self):
+        if not self.is_float() or self.unitsize() != 4 or self.is_bigendian():
+            raise TypeError("Analog data is not native float, use data_as_float()")
+        return self._data(self).__array_interface__
+
+    data = property(_data_property)
+    __array_interface__ = property(_array_interface)
 }
 }
 
 /* Return NumPy array from Logic::data(). */
 %extend sigrok::Logic
 {
-    PyObject * _data()
+    PyObject * _data(PyObject *owner)
     {
         npy_intp dims[2];
         dims[0] = $self->data_length() / $self->unit_size();
         dims[1] = $self->unit_size();
         int typenum = NPY_UINT8;
         void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        return payload_array(owner, 2, dims, typenum, data);
     }
 
 %pythoncode
 {
-    data = property(_data)
+    def _data_property(self):
+        return self._data(self)
+
+    def _array_interface(self):
+        return self._data(self).__array_interface__
+
+    data = property(_data_property)
+    __array_interface__ = property(_array_interface)
 }
 }
 
@@ -601,4 +731,84 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     Context.create_logic_packet = _Context_create_logic_packet
 }
 
+/*
+ * Re-use packets for further Python buffers, and send many buffers to
+ * an output in one call. The buffers must stay alive and unchanged while
+ * the packet uses them.
+ */
+%extend sigrok::Packet
+{
+    void _set_data_buf(PyObject *buf)
+    {
+        Py_buffer view;
+        if (PyObject_GetBuffer(buf, &view, PyBUF_SIMPLE) < 0)
+            throw sigrok::Error(SR_ERR_ARG);
+        try {
+            if ($self->type() == sigrok::PacketType::ANALOG)
+                $self->set_analog_data((const float *)view.buf,
+                    view.len / sizeof(float));
+            else
+                $self->set_logic_data(view.buf, view.len);
+        } catch (...) {
+            PyBuffer_Release(&view);
+            throw;
+        }
+        PyBuffer_Release(&view);
+    }
+}
+
+%extend sigrok::Output
+{
+    std::string _receive_bufs(std::shared_ptr<sigrok::Packet> packet,
+        PyObject *bufs)
+    {
+        PyObject *seq = PySequence_Fast(bufs, "Expected a sequence of buffers");
+        if (!seq)
+            throw sigrok::Error(SR_ERR_ARG);
+        Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+        std::vector<Py_buffer> views(count);
+        std::vector<std::pair<const void *, size_t> > buffers;
+        bool analog = packet->type() == sigrok::PacketType::ANALOG;
+        Py_ssize_t got = 0;
+        for (; got < count; got++) {
+            PyObject *item = PySequence_Fast_GET_ITEM(seq, got);
+            if (PyObject_GetBuffer(item, &views[got], PyBUF_SIMPLE) < 0)
+                break;
+            buffers.emplace_back(views[got].buf, analog ?
+                views[got].len / sizeof(float) : views[got].len);
+        }
+        std::string result;
+        try {
+            if (got == count)
+                result = $self->receive(packet, buffers);
+        } catch (...) {
+            for (Py_ssize_t i = 0; i < got; i++)
+                PyBuffer_Release(&views[i]);
+            Py_DECREF(seq);
+            throw;
+        }
+        for (Py_ssize_t i = 0; i < got; i++)
+            PyBuffer_Release(&views[i]);
+        Py_DECREF(seq);
+        if (got != count)
+            throw sigrok::Error(SR_ERR_ARG);
+        return result;
+    }
+}
+
+%pythoncode
+{
+    def _Packet_set_data(self, buf):
+        """Point a created logic or analog packet at another buffer."""
+        self._set_data_buf(buf)
+
+    Packet.set_data = _Packet_set_data
+
+    def _Output_receive_buffers(self, packet, bufs):
+        """Send a created packet once per buffer, returns all output."""
+        return self._receive_bufs(packet, bufs)
+
+    Output.receive_buffers = _Output_receive_buffers
+}
+
 %include "doc_end.i"
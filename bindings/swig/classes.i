@@ -81,6 +81,33 @@ template< class T > class enable_shared_from_this;
 
 %ignore sigrok::DatafeedCallbackData;
 
+/* The typed payload views are C++ only, languages wrap the data natively. */
+%ignore sigrok::Span;
+%ignore sigrok::LogicChannelView;
+%ignore sigrok::AnalogFloatView;
+%ignore sigrok::Logic::samples;
+%ignore sigrok::Logic::channel;
+%ignore sigrok::Analog::float_view;
+
+/*
+ * Packet streams and the session thread are C++ only. Languages have
+ * their own threading, the packets come to datafeed callbacks there.
+ */
+%ignore sigrok::PacketStream;
+%ignore sigrok::Session::packets;
+%ignore sigrok::Session::start_async;
+%ignore sigrok::Session::wait;
+
+/*
+ * Raw pointers don't map to other languages, the Python bindings pass
+ * buffer objects instead, see Packet.set_data() and
+ * Output.receive_buffers().
+ */
+%ignore sigrok::Packet::set_logic_data;
+%ignore sigrok::Packet::set_analog_data;
+%ignore sigrok::Output::receive(std::shared_ptr<sigrok::Packet>,
+	const std::vector<std::pair<const void *, size_t> > &);
+
 #ifndef SWIGJAVA
 
 #define SWIG_ATTRIBUTE_TEMPLATE
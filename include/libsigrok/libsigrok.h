@@ -130,8 +130,11 @@ enum sr_loglevel {
 #define SR_API
 #endif
 
-/* Marks private, non-public libsigrok symbols (not part of the API). */
-#ifndef _WIN32
+/*
+ * Marks private, non-public libsigrok symbols (not part of the API).
+ * Builds with loadable driver modules export them to the modules.
+ */
+#if !defined(_WIN32) && !defined(HAVE_DRIVER_MODULES)
 #define SR_PRIV __attribute__((visibility("hidden")))
 #else
 #define SR_PRIV
@@ -176,10 +179,165 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
+	/** Payload is struct sr_datafeed_logic_planar. */
+	SR_DF_LOGIC_PLANAR,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
 
+/** Flags for sr_session_datafeed_callback_add_full(). */
+enum sr_datafeed_callback_flag {
+	/**
+	 * The callback keeps packets beyond its own invocation by taking
+	 * a reference with sr_packet_ref() instead of copying them. Drivers
+	 * may then lend their acquisition buffers to the callback without
+	 * an intermediate copy.
+	 */
+	SR_DATAFEED_CB_REFCOUNTED = 0x01,
+	/**
+	 * The callback understands SR_DF_LOGIC_RLE packets. Callbacks
+	 * without this flag get them as a sequence of SR_DF_LOGIC packets.
+	 */
+	SR_DATAFEED_CB_LOGIC_RLE = 0x02,
+	/**
+	 * The callback understands SR_DF_LOGIC_PLANAR packets. Callbacks
+	 * without this flag get them as a sequence of SR_DF_LOGIC packets.
+	 */
+	SR_DATAFEED_CB_LOGIC_PLANAR = 0x04,
+};
+
+/** Statistics of the datafeed delivery ring of a session. */
+struct sr_session_ring_stats {
+	/** Number of packets which were queued for delivery. */
+	uint64_t packets_queued;
+	/** Number of data packets which were dropped because of a full ring. */
+	uint64_t packets_dropped;
+	/** Number of times the sender had to wait for space in the ring. */
+	uint64_t producer_stalls;
+	/** Highest number of packets which were queued at the same time. */
+	unsigned int high_water;
+	/** Ring capacity in packets. */
+	unsigned int depth;
+};
+
+/** Number of buckets in the histogram of struct sr_datafeed_timing. */
+#define SR_DATAFEED_TIMING_BUCKETS 16
+
+/** Time spent in a datafeed callback or transform module. */
+struct sr_datafeed_timing {
+	/** Number of invocations. */
+	uint64_t calls;
+	/** Accumulated duration of all invocations in microseconds. */
+	uint64_t total_us;
+	/** Longest invocation in microseconds. */
+	uint64_t max_us;
+	/**
+	 * Invocations by duration. Bucket 0 counts invocations which took
+	 * less than 1us, bucket n those which took less than 2^n us. The
+	 * last bucket also counts all longer invocations.
+	 */
+	uint64_t histogram[SR_DATAFEED_TIMING_BUCKETS];
+};
+
+/** Number of packet types in struct sr_session_datafeed_stats. */
+#define SR_DATAFEED_STATS_TYPES (SR_DF_LOGIC_PLANAR - SR_DF_HEADER + 1)
+
+/** Statistics of the packets which a session delivered to its consumers. */
+struct sr_session_datafeed_stats {
+	/** Number of packets by type, index is the type minus SR_DF_HEADER. */
+	uint64_t packets[SR_DATAFEED_STATS_TYPES];
+	/** Payload bytes of logic, analog, RLE and planar packets, same index. */
+	uint64_t bytes[SR_DATAFEED_STATS_TYPES];
+	/** Time spent in all datafeed callbacks. */
+	struct sr_datafeed_timing callbacks;
+};
+
+/** Metadata of a datafeed packet, see sr_packet_info_get(). */
+struct sr_datafeed_packet_info {
+	/** Index of the first sample in the device's acquisition. */
+	uint64_t first_sample;
+	/** Host monotonic time in us when the data arrived, 0 if unknown. */
+	int64_t host_time_us;
+	/** Number of samples which were lost right before the packet. */
+	uint64_t dropped_samples;
+};
+
+/** Sample clock model of a device, see sr_session_dev_clock_get(). */
+struct sr_dev_clock {
+	/** Start of the acquisition, in nanoseconds since the epoch. */
+	int64_t start_ns;
+	/** Samplerate in Hz, 0 when packets get timed on arrival. */
+	uint64_t samplerate;
+	/** Clock error set with sr_session_dev_clock_drift_set(), in ppm. */
+	double drift_ppm;
+	/** Number of samples received so far. */
+	uint64_t num_samples;
+	/**
+	 * Clock error as seen from the arrival of the samples, in ppm.
+	 * A rough estimate, that is only meaningful for streaming devices
+	 * which have run for a while, 0 when not available.
+	 */
+	double observed_drift_ppm;
+};
+
+/** Kinds of threads, see sr_thread_sched_set(). */
+enum sr_thread_class {
+	/** The USB event thread, see sr_session_usb_thread_set(). */
+	SR_THREAD_USB,
+	/** Device threads, see sr_session_device_threads_set(). */
+	SR_THREAD_DEVICE,
+	/** The datafeed delivery thread, see sr_session_datafeed_ring_set(). */
+	SR_THREAD_DATAFEED,
+	/** Transform pipeline workers, see sr_session_transform_pipeline_set(). */
+	SR_THREAD_TRANSFORM,
+	/** Workers of output modules, like srzip's compression threads. */
+	SR_THREAD_OUTPUT,
+};
+
+/** Number of kinds of threads in enum sr_thread_class. */
+#define SR_THREAD_CLASSES (SR_THREAD_OUTPUT + 1)
+
+/** Phases of finding, opening and starting devices, see sr_profile_enable(). */
+enum sr_profile_phase {
+	/** A driver's scan. */
+	SR_PROFILE_SCAN,
+	/** Opening a device, including the phases below. */
+	SR_PROFILE_OPEN,
+	/** Loading firmware or another resource, see sr_resource_set_hooks(). */
+	SR_PROFILE_RESOURCE_LOAD,
+	/** Uploading firmware to a device. */
+	SR_PROFILE_FIRMWARE_UPLOAD,
+	/** Waiting for a device to reappear after its firmware upload. */
+	SR_PROFILE_RENUMERATION,
+	/** Configuring a device's FPGA. */
+	SR_PROFILE_FPGA_CONFIG,
+	/** Reading a device's EEPROM. */
+	SR_PROFILE_EEPROM_READ,
+	/** Starting an acquisition on a device. */
+	SR_PROFILE_ACQUISITION_START,
+};
+
+/** Number of phases in enum sr_profile_phase. */
+#define SR_PROFILE_PHASES (SR_PROFILE_ACQUISITION_START + 1)
+
+/** Duration of a phase, see sr_profile_records_get(). */
+struct sr_profile_record {
+	/** The phase. */
+	enum sr_profile_phase phase;
+	/** The driver's name, NULL if unknown. */
+	char *driver;
+	/** The device's connection ID or model, NULL if unknown (scans). */
+	char *device;
+	/** Host monotonic time in us when the phase started. */
+	int64_t start_us;
+	/** Duration of the phase in us. */
+	int64_t duration_us;
+	/** The phase's result, SR_OK or an SR_ERR_* code. */
+	int result;
+};
+
 /** Measured quantity, sr_analog_meaning.mq. */
 enum sr_mq {
 	SR_MQ_VOLTAGE = 10000,
@@ -403,6 +561,8 @@ enum sr_mqflag {
 	SR_MQFLAG_UNSTABLE = 0x100000,
 	/** Measurement is four wire (e.g. Kelvin connection). */
 	SR_MQFLAG_FOUR_WIRE = 0x200000,
+	/** Values are a magnitude spectrum (frequency domain). */
+	SR_MQFLAG_SPECTRUM = 0x400000,
 
 	/*
 	 * Update mq_strings[] (analog.c) and fancyprint() (output/analog.c)
@@ -483,6 +643,22 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_sessionfile_reader
+ * Opaque structure for random access to the samples in a session file.
+ *
+ * @see sr_sessionfile_reader_open(), sr_sessionfile_reader_close().
+ */
+struct sr_sessionfile_reader;
+
+/**
+ * @struct sr_capture_file
+ * Opaque structure representing a memory mapped capture file.
+ *
+ * @see sr_capture_file_open(), sr_capture_file_close().
+ */
+struct sr_capture_file;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -514,6 +690,35 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Holds @a num_runs runs of identical samples. Run i is the sample at
+ * values + i * unitsize, repeated run_lengths[i] times. Adjacent runs
+ * may have the same value.
+ */
+struct sr_datafeed_logic_rle {
+	uint64_t num_runs;
+	uint16_t unitsize;
+	void *values;
+	uint64_t *run_lengths;
+};
+
+/**
+ * Planar (channel major) logic datafeed payload for type SR_DF_LOGIC_PLANAR.
+ *
+ * Holds @a num_samples samples as one bit plane per channel. planes[i]
+ * holds the samples of the channel at bit i of an SR_DF_LOGIC sample of
+ * @a unitsize bytes, least significant bit first: bit b of byte k is
+ * sample 8 * k + b. There are unitsize * 8 planes, NULL for channels
+ * without data, which read as low.
+ */
+struct sr_datafeed_logic_planar {
+	uint64_t num_samples;
+	uint16_t unitsize;
+	uint8_t **planes;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -618,6 +823,16 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/**
+	 * This output module handles SR_DF_LOGIC_RLE packets. Other
+	 * modules get them as a sequence of SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
+	/**
+	 * This output module handles SR_DF_LOGIC_PLANAR packets. Other
+	 * modules get them as a sequence of SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_PLANAR = 0x04,
 };
 
 struct sr_input;
@@ -1165,6 +1380,56 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * Latency target for the delivery of acquired data, in ms.
+	 * @arg type: uint64_t
+	 * @arg get: get the latency target
+	 * @arg set: change the latency target
+	 */
+	SR_CONF_LATENCY_TARGET,
+
+	/**
+	 * Number of data underruns (missing, failed or empty transfers)
+	 * during the current or most recent acquisition.
+	 * @arg type: uint64_t
+	 * @arg get: get the underrun count
+	 */
+	SR_CONF_UNDERRUN_COUNT,
+
+	/**
+	 * Produce data as fast as possible, instead of at the samplerate's
+	 * pace. Useful to load test the datafeed's consumers.
+	 * @arg type: boolean
+	 * @arg get: get whether the mode is enabled
+	 * @arg set: enable or disable the mode
+	 */
+	SR_CONF_MAX_THROUGHPUT,
+
+	/**
+	 * Replay speed of recorded data, relative to the samplerate. 1.0
+	 * replays at the original pace, 0 as fast as possible.
+	 * @arg type: double
+	 * @arg get: get the replay speed
+	 * @arg set: change the replay speed
+	 */
+	SR_CONF_REPLAY_SPEED,
+
+	/**
+	 * Start over at the beginning when the recorded data ends.
+	 * @arg type: boolean
+	 * @arg get: get whether the replay loops
+	 * @arg set: enable or disable looping
+	 */
+	SR_CONF_REPLAY_LOOP,
+
+	/**
+	 * Trigger time of the current frame, in seconds after the trigger
+	 * of the acquisition's first frame. Sent as meta data right after
+	 * SR_DF_FRAME_BEGIN by devices which record frames in a burst.
+	 * @arg type: double
+	 */
+	SR_CONF_FRAME_TIMESTAMP,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
@@ -30,6 +30,10 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
+SR_API int sr_analog_to_float_channel(const struct sr_datafeed_analog *analog,
+		unsigned int channel, float *buf);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -50,6 +54,33 @@ SR_API GSList *sr_buildinfo_libs_get(void);
 SR_API char *sr_buildinfo_host_get(void);
 SR_API char *sr_buildinfo_scpi_backends_get(void);
 
+/*--- thread_sched.c --------------------------------------------------------*/
+
+SR_API int sr_thread_sched_set(struct sr_context *ctx,
+		enum sr_thread_class cls, const char *cpus, int priority);
+SR_API int sr_session_thread_sched_set(struct sr_session *session,
+		enum sr_thread_class cls, const char *cpus, int priority);
+
+/*--- thread_pool.c ---------------------------------------------------------*/
+
+SR_API int sr_thread_pool_size_set(struct sr_context *ctx,
+		unsigned int num_threads);
+SR_API unsigned int sr_thread_pool_size_get(struct sr_context *ctx);
+
+/*--- device_cache.c --------------------------------------------------------*/
+
+SR_API int sr_dev_cache_dir_set(struct sr_context *ctx, const char *dir);
+SR_API int sr_dev_cache_clear(struct sr_context *ctx);
+
+/*--- profile.c -------------------------------------------------------------*/
+
+SR_API int sr_profile_enable(struct sr_context *ctx, gboolean enable);
+SR_API const char *sr_profile_phase_name(enum sr_profile_phase phase);
+SR_API GSList *sr_profile_records_get(struct sr_context *ctx);
+SR_API void sr_profile_records_free(GSList *records);
+SR_API int sr_profile_clear(struct sr_context *ctx);
+SR_API void sr_profile_summary_log(struct sr_context *ctx);
+
 /*--- conversion.c ----------------------------------------------------------*/
 
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
@@ -57,6 +88,12 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		const float *thresholds, uint8_t *logic, unsigned int unitsize,
+		unsigned int first_bit);
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		const float *lo_thr, const float *hi_thr, uint8_t *states,
+		uint8_t *logic, unsigned int unitsize, unsigned int first_bit);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -65,6 +102,7 @@ typedef int (*sr_log_callback)(void *cb_data, int loglevel,
 
 SR_API int sr_log_loglevel_set(int loglevel);
 SR_API int sr_log_loglevel_get(void);
+SR_API int sr_log_async_set(gboolean async);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
@@ -83,6 +121,10 @@ SR_API GArray *sr_dev_options(const struct sr_dev_driver *driver,
 SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver);
 SR_API int sr_dev_clear(const struct sr_dev_driver *driver);
 SR_API int sr_dev_open(struct sr_dev_inst *sdi);
+typedef void (*sr_dev_open_callback)(struct sr_dev_inst *sdi, int ret,
+		void *cb_data);
+SR_API int sr_dev_open_all(GSList *devices, unsigned int max_threads,
+		sr_dev_open_callback cb, void *cb_data);
 SR_API int sr_dev_close(struct sr_dev_inst *sdi);
 
 SR_API struct sr_dev_driver *sr_dev_inst_driver_get(const struct sr_dev_inst *sdi);
@@ -105,6 +147,11 @@ SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+typedef void (*sr_driver_scan_callback)(struct sr_dev_driver *driver,
+		GSList *devices, void *cb_data);
+SR_API int sr_driver_scan_all(struct sr_context *ctx, GSList *options,
+		unsigned int max_threads, sr_driver_scan_callback cb,
+		void *cb_data);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -113,6 +160,10 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant *data);
 SR_API int sr_config_commit(const struct sr_dev_inst *sdi);
+SR_API int sr_config_cache_flush(const struct sr_dev_inst *sdi);
+SR_API int sr_config_transaction_begin(const struct sr_dev_inst *sdi);
+SR_API int sr_config_transaction_commit(const struct sr_dev_inst *sdi);
+SR_API int sr_config_transaction_abort(const struct sr_dev_inst *sdi);
 SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -120,6 +171,32 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key);
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid);
 
+/*--- hotplug.c -------------------------------------------------------------*/
+
+typedef void (*sr_hotplug_callback)(struct sr_dev_inst *sdi,
+		gboolean arrived, void *cb_data);
+
+SR_API int sr_hotplug_start(struct sr_context *ctx, GMainContext *main_ctx,
+		sr_hotplug_callback cb, void *cb_data);
+SR_API int sr_hotplug_stop(struct sr_context *ctx);
+
+/*--- usb_capture.c ---------------------------------------------------------*/
+
+SR_API int sr_usb_capture_start(struct sr_context *ctx, const char *filename);
+SR_API int sr_usb_capture_stop(struct sr_context *ctx);
+
+/*--- logic_planar.c --------------------------------------------------------*/
+
+SR_API int sr_logic_planar_expand(const struct sr_datafeed_logic_planar *planar,
+		uint64_t offset, void *buf, uint64_t *count);
+
+/*--- logic_rle.c -----------------------------------------------------------*/
+
+SR_API uint64_t sr_logic_rle_sample_count(
+		const struct sr_datafeed_logic_rle *rle);
+SR_API int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint64_t offset, void *buf, uint64_t *count);
+
 /*--- session.c -------------------------------------------------------------*/
 
 typedef void (*sr_session_stopped_callback)(void *data);
@@ -131,6 +208,53 @@ SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session);
 /* Session setup */
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	struct sr_session **session);
+SR_API int sr_sessionfile_reader_open(const char *filename,
+	struct sr_sessionfile_reader **reader);
+SR_API int sr_sessionfile_reader_close(struct sr_sessionfile_reader *reader);
+SR_API int sr_sessionfile_reader_logic_info(
+	struct sr_sessionfile_reader *reader,
+	uint64_t *num_samples, unsigned int *unitsize);
+SR_API int sr_sessionfile_reader_read_logic(
+	struct sr_sessionfile_reader *reader,
+	uint64_t start, uint64_t count, void *buf, uint64_t *samples_read);
+SR_API int sr_sessionfile_reader_analog_info(
+	struct sr_sessionfile_reader *reader, int channel,
+	uint64_t *num_samples);
+SR_API int sr_sessionfile_reader_read_analog(
+	struct sr_sessionfile_reader *reader, int channel,
+	uint64_t start, uint64_t count, float *buf, uint64_t *samples_read);
+SR_API int sr_sessionfile_reader_logic_summary_info(
+	struct sr_sessionfile_reader *reader, uint64_t factor,
+	uint64_t *num_bins);
+SR_API int sr_sessionfile_reader_read_logic_summary(
+	struct sr_sessionfile_reader *reader, uint64_t factor,
+	uint64_t start, uint64_t count, void *buf, uint64_t *bins_read);
+SR_API int sr_sessionfile_reader_analog_summary_info(
+	struct sr_sessionfile_reader *reader, int channel, uint64_t factor,
+	uint64_t *num_bins);
+SR_API int sr_sessionfile_reader_read_analog_summary(
+	struct sr_sessionfile_reader *reader, int channel, uint64_t factor,
+	uint64_t start, uint64_t count, float *buf, uint64_t *bins_read);
+
+/*--- capture_file.c --------------------------------------------------------*/
+
+SR_API int sr_capture_file_open(const char *filename,
+	struct sr_capture_file **cf);
+SR_API int sr_capture_file_close(struct sr_capture_file *cf);
+SR_API int sr_capture_file_info(const struct sr_capture_file *cf,
+	uint64_t *samplerate, unsigned int *num_logic,
+	unsigned int *unitsize, unsigned int *num_analog);
+SR_API const char *sr_capture_file_channel_name(
+	const struct sr_capture_file *cf, unsigned int index);
+SR_API int sr_capture_file_logic_samples(const struct sr_capture_file *cf,
+	uint64_t *num_samples);
+SR_API int sr_capture_file_logic_map(const struct sr_capture_file *cf,
+	uint64_t start, const void **data, uint64_t *count);
+SR_API int sr_capture_file_analog_samples(const struct sr_capture_file *cf,
+	unsigned int channel, uint64_t *num_samples);
+SR_API int sr_capture_file_analog_map(const struct sr_capture_file *cf,
+	unsigned int channel, uint64_t start, const float **data,
+	uint64_t *count);
 SR_API int sr_session_new(struct sr_context *ctx, struct sr_session **session);
 SR_API int sr_session_destroy(struct sr_session *session);
 SR_API int sr_session_dev_remove_all(struct sr_session *session);
@@ -145,11 +269,85 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_callback_add_full(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags);
+SR_API int sr_session_datafeed_ring_set(struct sr_session *session,
+		unsigned int depth, gboolean drop_when_full);
+SR_API int sr_session_datafeed_ring_stats_get(struct sr_session *session,
+		struct sr_session_ring_stats *stats);
+SR_API int sr_session_transform_pipeline_set(struct sr_session *session,
+		unsigned int depth);
+SR_API int sr_session_datafeed_batch_set(struct sr_session *session,
+		size_t max_bytes, unsigned int max_latency_ms);
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_datafeed_merge_set(struct sr_session *session,
+		size_t max_bytes);
+SR_API int sr_session_dev_clock_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_dev_clock *clock);
+SR_API int sr_session_dev_clock_drift_set(struct sr_session *session,
+		const struct sr_dev_inst *sdi, double drift_ppm);
+SR_API int sr_session_epoll_set(struct sr_session *session, gboolean enable);
+SR_API int sr_session_usb_thread_set(struct sr_session *session,
+		gboolean enable, gboolean realtime);
+
+/*--- session_stats.c -------------------------------------------------------*/
+
+SR_API int sr_session_datafeed_stats_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_datafeed_stats_get(struct sr_session *session,
+		struct sr_session_datafeed_stats *stats);
+SR_API int sr_session_datafeed_callback_timing_get(struct sr_session *session,
+		unsigned int index, struct sr_datafeed_timing *timing);
+SR_API int sr_session_transform_timing_get(struct sr_session *session,
+		unsigned int index, struct sr_datafeed_timing *timing);
+
+/*--- session_retain.c ------------------------------------------------------*/
+
+typedef void (*sr_session_retention_callback)(struct sr_session *session,
+		void *cb_data);
+
+SR_API int sr_session_retention_set(struct sr_session *session,
+		size_t max_bytes, uint64_t max_ms);
+SR_API int sr_session_retention_trigger_set(struct sr_session *session,
+		struct sr_trigger *trigger, uint64_t post_ms,
+		sr_session_retention_callback cb, void *cb_data);
+SR_API int sr_session_retention_snapshot(struct sr_session *session,
+		const char *filename);
+
+/*--- session_budget.c ------------------------------------------------------*/
+
+SR_API int sr_session_memory_budget_set(struct sr_session *session,
+		uint64_t max_bytes);
+SR_API int sr_session_memory_limit_set(struct sr_session *session,
+		const char *component, uint64_t max_bytes);
+SR_API int sr_session_memory_usage_get(struct sr_session *session,
+		const char *component, uint64_t *used, uint64_t *peak);
+SR_API gboolean sr_session_memory_pressure(struct sr_session *session);
+
+/*--- session_outputs.c -----------------------------------------------------*/
+
+SR_API int sr_session_output_add(struct sr_session *session,
+		const struct sr_output *o, int fd);
+SR_API int sr_session_outputs_remove_all(struct sr_session *session);
+
+/*--- session_mailbox.c -----------------------------------------------------*/
+
+SR_API int sr_session_frame_mailbox_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_frame_take(struct sr_session *session,
+		GSList **packets, gint64 timeout_us);
+SR_API void sr_session_frame_free(GSList *packets);
+SR_API int sr_session_frame_stats_get(struct sr_session *session,
+		uint64_t *frames, uint64_t *dropped);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
+SR_API int sr_session_rearm(struct sr_session *session);
 SR_API int sr_session_run(struct sr_session *session);
 SR_API int sr_session_stop(struct sr_session *session);
+SR_API int sr_session_stop_fast(struct sr_session *session,
+		sr_session_stopped_callback cb, void *cb_data);
 SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
@@ -157,6 +355,11 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet);
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet);
+SR_API int sr_packet_info_get(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info);
 
 /*--- input/input.c ---------------------------------------------------------*/
 
@@ -176,7 +379,11 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_mapped(const struct sr_input *in,
+		void *data, size_t length, size_t *consumed);
 SR_API int sr_input_end(const struct sr_input *in);
+SR_API int sr_input_run_file(const struct sr_input *in, const char *filename,
+		struct sr_session *session, unsigned int depth);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
 
@@ -198,6 +405,10 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out);
+SR_API int sr_output_send_fd(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, int fd);
 SR_API int sr_output_free(const struct sr_output *o);
 
 /*--- transform/transform.c -------------------------------------------------*/
@@ -241,6 +452,7 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_resource_open_callback open_cb,
 		sr_resource_close_callback close_cb,
 		sr_resource_read_callback read_cb, void *cb_data);
+SR_API int sr_resource_cache_clear(struct sr_context *ctx);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
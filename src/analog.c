@@ -119,6 +119,7 @@ static struct unit_mq_string mq_strings[] = {
 	{ SR_MQFLAG_REFERENCE, " REF" },
 	{ SR_MQFLAG_UNSTABLE, " UNSTABLE" },
 	{ SR_MQFLAG_FOUR_WIRE, " 4-WIRE" },
+	{ SR_MQFLAG_SPECTRUM, " SPECTRUM" },
 	ALL_ZERO
 };
 
@@ -157,6 +158,224 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
+/*
+ * Approximate a value by a decimal fraction, with enough digits for the
+ * single precision values which consumers compute from it.
+ */
+static void rational_from_double(struct sr_rational *r, double value)
+{
+	double scaled;
+	uint64_t q;
+
+	q = 1;
+	scaled = value;
+	while (q < 1000000000000000ULL && fabs(scaled) < 1e17 &&
+			fabs(scaled - round(scaled)) > 1e-9 * fabs(scaled)) {
+		q *= 10;
+		scaled = value * q;
+	}
+	r->p = (int64_t)round(scaled);
+	r->q = q;
+}
+
+/**
+ * Set up the encoding of raw integer samples, which consumers convert
+ * to values as (raw * scale + offset).
+ *
+ * Drivers which receive integer ADC samples can pass them on as is,
+ * instead of converting every sample to float. The encoding's digits
+ * remain unchanged.
+ *
+ * @param encoding The encoding, as set up by sr_analog_init().
+ * @param unitsize The size of a raw sample in bytes (1, 2, or 4).
+ * @param is_signed Whether the raw samples are signed.
+ * @param is_bigendian Whether the raw samples are big endian.
+ * @param scale The factor to apply to raw samples.
+ * @param offset The offset to add after scaling.
+ *
+ * @private
+ */
+SR_PRIV void sr_analog_encoding_set_raw(struct sr_analog_encoding *encoding,
+		unsigned int unitsize, gboolean is_signed, gboolean is_bigendian,
+		double scale, double offset)
+{
+	encoding->unitsize = unitsize;
+	encoding->is_signed = is_signed;
+	encoding->is_float = FALSE;
+	encoding->is_bigendian = is_bigendian;
+	rational_from_double(&encoding->scale, scale);
+	rational_from_double(&encoding->offset, offset);
+}
+
+/** @cond PRIVATE */
+typedef void (*analog_conv_float_fn)(const uint8_t *in, size_t stride,
+	float *out, size_t count, double scale, double offset);
+typedef void (*analog_conv_double_fn)(const uint8_t *in, size_t stride,
+	double *out, size_t count, double scale, double offset);
+typedef void (*analog_conv_raw_fn)(const uint8_t *in, size_t stride,
+	int64_t *out, size_t count);
+
+/*
+ * Generate a pair of conversion loops (to float and to double) for one
+ * input data type. Contiguous values take the bulk converters, whose
+ * loops have a constant stride which compilers turn into vector code.
+ */
+#define ANALOG_CONVERTERS(type, reader, size) \
+static void conv_##type##_float(const uint8_t *in, size_t stride, \
+	float *out, size_t count, double scale, double offset) \
+{ \
+	if (stride == (size)) { \
+		sr_read_##type##_float(out, in, count, scale, offset); \
+		return; \
+	} \
+	while (count--) { \
+		*out++ = reader(in) * scale + offset; \
+		in += stride; \
+	} \
+} \
+static void conv_##type##_double(const uint8_t *in, size_t stride, \
+	double *out, size_t count, double scale, double offset) \
+{ \
+	while (count--) { \
+		*out++ = reader(in) * scale + offset; \
+		in += stride; \
+	} \
+}
+
+ANALOG_CONVERTERS(fltle, read_fltle, 4)
+ANALOG_CONVERTERS(fltbe, read_fltbe, 4)
+ANALOG_CONVERTERS(dblle, read_dblle, 8)
+ANALOG_CONVERTERS(dblbe, read_dblbe, 8)
+ANALOG_CONVERTERS(u8, read_u8, 1)
+ANALOG_CONVERTERS(i8, read_i8, 1)
+ANALOG_CONVERTERS(u16le, read_u16le, 2)
+ANALOG_CONVERTERS(u16be, read_u16be, 2)
+ANALOG_CONVERTERS(i16le, read_i16le, 2)
+ANALOG_CONVERTERS(i16be, read_i16be, 2)
+ANALOG_CONVERTERS(u32le, read_u32le, 4)
+ANALOG_CONVERTERS(u32be, read_u32be, 4)
+ANALOG_CONVERTERS(i32le, read_i32le, 4)
+ANALOG_CONVERTERS(i32be, read_i32be, 4)
+
+/* Read integer samples as is, without applying scale and offset. */
+#define ANALOG_RAW_READER(type, reader) \
+static void conv_##type##_raw(const uint8_t *in, size_t stride, \
+	int64_t *out, size_t count) \
+{ \
+	while (count--) { \
+		*out++ = reader(in); \
+		in += stride; \
+	} \
+}
+
+ANALOG_RAW_READER(u8, read_u8)
+ANALOG_RAW_READER(i8, read_i8)
+ANALOG_RAW_READER(u16le, read_u16le)
+ANALOG_RAW_READER(u16be, read_u16be)
+ANALOG_RAW_READER(i16le, read_i16le)
+ANALOG_RAW_READER(i16be, read_i16be)
+ANALOG_RAW_READER(u32le, read_u32le)
+ANALOG_RAW_READER(u32be, read_u32be)
+ANALOG_RAW_READER(i32le, read_i32le)
+ANALOG_RAW_READER(i32be, read_i32be)
+
+struct analog_converter {
+	gboolean is_float;
+	gboolean is_signed;
+	gboolean is_bigendian;
+	size_t unitsize;
+	analog_conv_float_fn to_float;
+	analog_conv_double_fn to_double;
+	/* NULL for floating point types. */
+	analog_conv_raw_fn to_raw;
+};
+
+#define CONV(f, s, be, size, type) \
+	{ f, s, be, size, conv_##type##_float, conv_##type##_double, NULL, }
+#define CONV_INT(s, be, size, type) \
+	{ FALSE, s, be, size, conv_##type##_float, conv_##type##_double, \
+		conv_##type##_raw, }
+
+/* Signedness is ignored for floats, endianess for single bytes. */
+static const struct analog_converter analog_converters[] = {
+	CONV(TRUE, TRUE, FALSE, sizeof(float), fltle),
+	CONV(TRUE, TRUE, TRUE, sizeof(float), fltbe),
+	CONV(TRUE, TRUE, FALSE, sizeof(double), dblle),
+	CONV(TRUE, TRUE, TRUE, sizeof(double), dblbe),
+	CONV_INT(FALSE, FALSE, sizeof(uint8_t), u8),
+	CONV_INT(TRUE, FALSE, sizeof(uint8_t), i8),
+	CONV_INT(FALSE, FALSE, sizeof(uint16_t), u16le),
+	CONV_INT(FALSE, TRUE, sizeof(uint16_t), u16be),
+	CONV_INT(TRUE, FALSE, sizeof(uint16_t), i16le),
+	CONV_INT(TRUE, TRUE, sizeof(uint16_t), i16be),
+	CONV_INT(FALSE, FALSE, sizeof(uint32_t), u32le),
+	CONV_INT(FALSE, TRUE, sizeof(uint32_t), u32be),
+	CONV_INT(TRUE, FALSE, sizeof(uint32_t), i32le),
+	CONV_INT(TRUE, TRUE, sizeof(uint32_t), i32be),
+};
+/** @endcond */
+
+/*
+ * Determine the conversion routine for an analog payload's encoding,
+ * and the common scale/offset factors which apply to all values.
+ */
+static const struct analog_converter *analog_converter_get(
+	const struct sr_analog_encoding *encoding,
+	double *scale, double *offset)
+{
+	const struct analog_converter *conv;
+	gboolean is_bigendian;
+	size_t i;
+	char type_text[10];
+
+	for (i = 0; i < ARRAY_SIZE(analog_converters); i++) {
+		conv = &analog_converters[i];
+		if (conv->is_float != encoding->is_float)
+			continue;
+		if (conv->unitsize != encoding->unitsize)
+			continue;
+		if (!conv->is_float && conv->is_signed != encoding->is_signed)
+			continue;
+		is_bigendian = encoding->unitsize > 1 && encoding->is_bigendian;
+		if (conv->is_bigendian != is_bigendian)
+			continue;
+
+		*offset = encoding->offset.p;
+		*offset /= encoding->offset.q;
+		*scale = encoding->scale.p;
+		*scale /= encoding->scale.q;
+		return conv;
+	}
+
+	/*
+	 * Error messages for unsupported input property combinations
+	 * will only be seen by developers and maintainers of input
+	 * formats or acquisition device drivers. Terse output is
+	 * acceptable there, users shall never see them.
+	 */
+	snprintf(type_text, sizeof(type_text), "%c%zu%s",
+		encoding->is_float ? 'f' : encoding->is_signed ? 'i' : 'u',
+		(size_t)encoding->unitsize * 8,
+		encoding->is_bigendian ? "be" : "le");
+	sr_err("Unsupported type for analog-to-float conversion: %s.",
+		type_text);
+
+	return NULL;
+}
+
+static gboolean analog_is_native(const struct sr_analog_encoding *encoding,
+	size_t unitsize)
+{
+#ifdef WORDS_BIGENDIAN
+	const gboolean host_bigendian = TRUE;
+#else
+	const gboolean host_bigendian = FALSE;
+#endif
+
+	return encoding->is_float && encoding->unitsize == unitsize &&
+		encoding->is_bigendian == host_bigendian;
+}
+
 /**
  * Convert an analog datafeed payload to an array of floats.
  *
@@ -177,14 +396,9 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *outbuf)
 {
+	const struct analog_converter *conv;
 	size_t count;
-	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
-	char type_text[10];
+	double scale, offset;
 
 	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
 		return SR_ERR_ARG;
@@ -193,34 +407,9 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
 
-	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
-	 * Error messages for unsupported input property combinations
-	 * will only be seen by developers and maintainers of input
-	 * formats or acquisition device drivers. Terse output is
-	 * acceptable there, users shall never see them.
-	 */
-#ifdef WORDS_BIGENDIAN
-	host_bigendian = TRUE;
-#else
-	host_bigendian = FALSE;
-#endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
-
-	/*
-	 * Prepare the iteration over the sample data: Get the common
-	 * scale/offset factors which apply to all individual values.
-	 * Position the read pointer on the first byte of input data.
-	 */
-	offset = analog->encoding->offset.p;
-	offset /= analog->encoding->offset.q;
-	scale = analog->encoding->scale.p;
-	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
+	conv = analog_converter_get(analog->encoding, &scale, &offset);
+	if (!conv)
+		return SR_ERR;
 
 	/*
 	 * Immediately handle the special case where input data needs
@@ -228,11 +417,8 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * native format. Do apply scale/offset though when applicable
 	 * on our way out.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
+	if (analog_is_native(analog->encoding, sizeof(outbuf[0]))) {
+		memcpy(outbuf, analog->data, count * sizeof(outbuf[0]));
 		if (scale != 1.0 || offset != 0.0) {
 			while (count--) {
 				*outbuf *= scale;
@@ -244,138 +430,350 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	}
 
 	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
+	 * Do the internal calculations on double precision values, only
+	 * trim the result data to single precision. Use sr_analog_to_double()
+	 * when the extra precision is needed in the result.
 	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+	conv->to_float(analog->data, analog->encoding->unitsize,
+		outbuf, count, scale, offset);
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * This is the double precision variant of sr_analog_to_float(). The
+ * caller must provide the #outbuf space for the conversion result.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	const struct analog_converter *conv;
+	size_t count;
+	double scale, offset;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+
+	conv = analog_converter_get(analog->encoding, &scale, &offset);
+	if (!conv)
+		return SR_ERR;
+
+	if (analog_is_native(analog->encoding, sizeof(outbuf[0])) &&
+			scale == 1.0 && offset == 0.0) {
+		memcpy(outbuf, analog->data, count * sizeof(outbuf[0]));
 		return SR_OK;
 	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
+	conv->to_double(analog->data, analog->encoding->unitsize,
+		outbuf, count, scale, offset);
+
+	return SR_OK;
+}
+
+/**
+ * Convert one channel of a multi-channel analog payload to floats.
+ *
+ * Payloads which cover several channels carry their values interleaved,
+ * one value per channel (in the order of analog->meaning->channels) for
+ * every sample. This routine extracts the values of a single channel in
+ * one pass, without converting the complete payload first.
+ *
+ * The caller must provide #outbuf space for analog->num_samples values.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] channel Index of the channel in analog->meaning->channels.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_float_channel(const struct sr_datafeed_analog *analog,
+		unsigned int channel, float *outbuf)
+{
+	const struct analog_converter *conv;
+	size_t num_channels, unitsize;
+	const uint8_t *data;
+	double scale, offset;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (channel >= num_channels)
+		return SR_ERR_ARG;
+
+	conv = analog_converter_get(analog->encoding, &scale, &offset);
+	if (!conv)
 		return SR_ERR;
-	}
 
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+	unitsize = analog->encoding->unitsize;
+	data = analog->data;
+	data += channel * unitsize;
+	conv->to_float(data, num_channels * unitsize,
+		outbuf, analog->num_samples, scale, offset);
+
+	return SR_OK;
+}
+
+/** @cond PRIVATE */
+#define A2L_BLOCK_SIZE 256
+/* Integer thresholds beyond any raw sample value. */
+#define A2L_RAW_LIMIT ((double)(1LL << 40))
+/** @endcond */
+
+/*
+ * Turn a threshold on the value into a threshold on the raw sample, for
+ * value = raw * scale + offset with positive scale. Values below @a thr
+ * are raw samples below the result when @a below is set. Otherwise values
+ * above @a thr are raw samples above the result.
+ */
+static int64_t a2l_raw_threshold(double thr, double scale, double offset,
+	gboolean below)
+{
+	double t;
+
+	t = (thr - offset) / scale;
+	t = below ? ceil(t) : floor(t);
+	if (isnan(t))
+		return 0;
+	if (t > A2L_RAW_LIMIT)
+		return A2L_RAW_LIMIT;
+	if (t < -A2L_RAW_LIMIT)
+		return -A2L_RAW_LIMIT;
+
+	return t;
+}
+
+/* Store levels (0 or 1) as whole bytes, or into the bits of @a mask. */
+static void a2l_store_levels(const uint8_t *levels, size_t count,
+	uint8_t *out, size_t out_stride, uint8_t mask)
+{
+	size_t i;
+
+	if (!mask) {
+		for (i = 0; i < count; i++)
+			out[i * out_stride] = levels[i];
+		return;
 	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+	for (i = 0; i < count; i++) {
+		out[i * out_stride] = (out[i * out_stride] & ~mask) |
+			(-levels[i] & mask);
 	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
+}
+
+/**
+ * Derive logic levels from the values of an analog payload.
+ *
+ * Walks @a count values which start at value index @a first, and are
+ * @a step values apart (the channel count, to process one channel of a
+ * multi-channel payload). Values are processed in blocks on the stack,
+ * there are no allocations.
+ *
+ * Integer encodings get compared in raw sample units. The thresholds
+ * are translated once using the encoding's scale and offset, so the
+ * samples need not get converted to floating point at all. The loops
+ * are simple enough for compilers to turn them into vector code.
+ *
+ * Without @a state a fixed threshold applies: values at or above
+ * @a lo_thr become 1, values below it become 0, @a hi_thr is ignored.
+ * With @a state the levels follow a Schmitt-trigger: values below
+ * @a lo_thr become 0, values above @a hi_thr become 1, values in
+ * between keep the previous level, which @a state holds across calls.
+ *
+ * @param analog The analog payload.
+ * @param first Index of the first value.
+ * @param step Distance between values to process.
+ * @param count Number of values to process.
+ * @param lo_thr The (low) threshold.
+ * @param hi_thr The high threshold.
+ * @param state Schmitt-trigger state, or NULL for a fixed threshold.
+ * @param out Where to store the levels.
+ * @param out_stride Distance between output bytes.
+ * @param mask The output bits to set or clear, or 0 to store whole
+ *             bytes which are 0 or 1.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ *
+ * @private
+ */
+SR_PRIV int sr_analog_to_levels(const struct sr_datafeed_analog *analog,
+	size_t first, size_t step, size_t count, float lo_thr, float hi_thr,
+	uint8_t *state, uint8_t *out, size_t out_stride, uint8_t mask)
+{
+	const struct analog_converter *conv;
+	const uint8_t *data;
+	double scale, offset;
+	size_t stride, len, i;
+	int64_t raw[A2L_BLOCK_SIZE], sign, raw_lo, raw_hi;
+	float values[A2L_BLOCK_SIZE];
+	uint8_t levels[A2L_BLOCK_SIZE], level;
+
+	conv = analog_converter_get(analog->encoding, &scale, &offset);
+	if (!conv)
+		return SR_ERR;
+
+	stride = step * analog->encoding->unitsize;
+	data = analog->data;
+	data += first * analog->encoding->unitsize;
+
+	/*
+	 * Negate the raw samples for a negative scale. A zero scale makes
+	 * all values the same: compare the offset once, and pick raw
+	 * thresholds which all raw samples are above or below.
+	 */
+	sign = scale < 0 ? -1 : 1;
+	raw_lo = raw_hi = 0;
+	if (conv->to_raw && scale == 0) {
+		if (!state) {
+			raw_lo = offset >= lo_thr ? -A2L_RAW_LIMIT : A2L_RAW_LIMIT;
+			raw_hi = raw_lo - 1;
+		} else {
+			raw_lo = offset < lo_thr ? A2L_RAW_LIMIT : -A2L_RAW_LIMIT;
+			raw_hi = offset > hi_thr ? -A2L_RAW_LIMIT : A2L_RAW_LIMIT;
 		}
-		return SR_OK;
+	} else if (conv->to_raw) {
+		raw_lo = a2l_raw_threshold(lo_thr, scale * sign, offset, TRUE);
+		raw_hi = state ? a2l_raw_threshold(hi_thr, scale * sign,
+			offset, FALSE) : raw_lo - 1;
 	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
+
+	while (count) {
+		len = MIN(count, A2L_BLOCK_SIZE);
+		if (conv->to_raw) {
+			conv->to_raw(data, stride, raw, len);
+			if (sign < 0) {
+				for (i = 0; i < len; i++)
+					raw[i] = -raw[i];
+			}
+		} else {
+			conv->to_float(data, stride, values, len, scale, offset);
 		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
+
+		if (!state && conv->to_raw) {
+			for (i = 0; i < len; i++)
+				levels[i] = raw[i] >= raw_lo;
+		} else if (!state) {
+			for (i = 0; i < len; i++)
+				levels[i] = values[i] >= lo_thr;
+		} else if (conv->to_raw) {
+			level = *state;
+			for (i = 0; i < len; i++) {
+				if (raw[i] < raw_lo)
+					level = 0;
+				else if (raw[i] > raw_hi)
+					level = 1;
+				levels[i] = level;
+			}
+			*state = level;
+		} else {
+			level = *state;
+			for (i = 0; i < len; i++) {
+				if (values[i] < lo_thr)
+					level = 0;
+				else if (values[i] > hi_thr)
+					level = 1;
+				levels[i] = level;
+			}
+			*state = level;
 		}
-		return SR_OK;
+		a2l_store_levels(levels, len, out, out_stride, mask);
+
+		data += len * stride;
+		out += len * out_stride;
+		count -= len;
 	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+
+	return SR_OK;
+}
+
+/**
+ * Get values of an analog payload in raw sample units.
+ *
+ * Integer encodings are kept as raw samples, only negated for a negative
+ * scale. Floating point encodings get converted to their values. Either
+ * way the output keeps the order of the values, and value =
+ * out * @a unit_scale + @a unit_offset holds with a non-negative
+ * @a unit_scale. Callers translate their thresholds once, and compare
+ * the output directly. Takes the same @a first / @a step / @a count
+ * arguments as sr_analog_to_levels().
+ *
+ * @param analog The analog payload.
+ * @param first Index of the first value.
+ * @param step Distance between values to process.
+ * @param count Number of values to process.
+ * @param out Where to store the values.
+ * @param unit_scale Receives the scale of the output.
+ * @param unit_offset Receives the offset of the output.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ *
+ * @private
+ */
+SR_PRIV int sr_analog_to_raw_units(const struct sr_datafeed_analog *analog,
+	size_t first, size_t step, size_t count, double *out,
+	double *unit_scale, double *unit_offset)
+{
+	const struct analog_converter *conv;
+	const uint8_t *data;
+	double scale, offset, sign;
+	size_t stride, len, i;
+	int64_t raw[A2L_BLOCK_SIZE];
+
+	conv = analog_converter_get(analog->encoding, &scale, &offset);
+	if (!conv)
+		return SR_ERR;
+
+	stride = step * analog->encoding->unitsize;
+	data = analog->data;
+	data += first * analog->encoding->unitsize;
+
+	/* A zero scale makes all values the same. */
+	if (!conv->to_raw || scale == 0) {
+		conv->to_double(data, stride, out, count, scale, offset);
+		*unit_scale = 1.0;
+		*unit_offset = 0.0;
 		return SR_OK;
 	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
+
+	sign = scale < 0 ? -1.0 : 1.0;
+	while (count) {
+		len = MIN(count, A2L_BLOCK_SIZE);
+		conv->to_raw(data, stride, raw, len);
+		for (i = 0; i < len; i++)
+			out[i] = sign * raw[i];
+		data += len * stride;
+		out += len;
+		count -= len;
+	}
+	*unit_scale = scale * sign;
+	*unit_offset = offset;
+
+	return SR_OK;
 }
 
 /**
@@ -183,6 +183,16 @@ SR_API GSList *sr_buildinfo_libs_get(void)
 	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBBLUEZ_VERSION));
 	l = g_slist_append(l, m);
 #endif
+#ifdef HAVE_LIBZSTD
+	m = g_slist_append(NULL, g_strdup("libzstd"));
+	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBZSTD_VERSION));
+	l = g_slist_append(l, m);
+#endif
+#ifdef HAVE_LIBHDF5
+	m = g_slist_append(NULL, g_strdup("hdf5"));
+	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBHDF5_VERSION));
+	l = g_slist_append(l, m);
+#endif
 #ifdef HAVE_LIBFTDI
 	m = g_slist_append(NULL, g_strdup("libftdi"));
 	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBFTDI_VERSION));
@@ -558,13 +568,18 @@ SR_API int sr_init(struct sr_context **ctx)
 {
 	int ret = SR_ERR;
 	struct sr_context *context;
+	int64_t start_us;
 #ifdef _WIN32
 	WSADATA wsadata;
 #endif
 
-	print_versions();
+	start_us = g_get_monotonic_time();
 
-	print_resourcepaths();
+	/* Don't collect the details when they won't get logged. */
+	if (sr_log_loglevel_get() >= SR_LOG_DBG) {
+		print_versions();
+		print_resourcepaths();
+	}
 
 	if (!ctx) {
 		sr_err("%s(): libsigrok context was NULL.", __func__);
@@ -611,12 +626,62 @@ SR_API int sr_init(struct sr_context **ctx)
 		goto done;
 	}
 
+	/* libusb and HIDAPI get set up with the first driver, see below. */
+	g_mutex_init(&context->io_mutex);
 #ifdef HAVE_LIBUSB_1_0
-	ret = libusb_init(&context->libusb_ctx);
+	g_mutex_init(&context->usb_scan_mutex);
+#endif
+	g_mutex_init(&context->resource_mutex);
+	g_mutex_init(&context->pool_mutex);
+	g_mutex_init(&context->dev_cache_mutex);
+	sr_profile_init(context);
+	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
+
+	sr_dbg("Initialized in %" PRIi64 " us.",
+		g_get_monotonic_time() - start_us);
+
+	*ctx = context;
+	context = NULL;
+	ret = SR_OK;
+
+done:
+	g_free(context);
+	return ret;
+}
+
+/**
+ * Set up the libraries which drivers use for device access.
+ *
+ * This happens on the first use of a driver rather than in sr_init(),
+ * so that applications which don't talk to devices don't pay for it.
+ * libusb_init() in particular enumerates the bus. Further calls return
+ * right away.
+ *
+ * @param ctx Pointer to a libsigrok context struct. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR A library failed to initialize.
+ *
+ * @private
+ */
+SR_PRIV int sr_init_io_backends(struct sr_context *ctx)
+{
+	int64_t start_us;
+	int ret;
+
+	g_mutex_lock(&ctx->io_mutex);
+	if (ctx->io_initialized) {
+		g_mutex_unlock(&ctx->io_mutex);
+		return SR_OK;
+	}
+	start_us = g_get_monotonic_time();
+
+#ifdef HAVE_LIBUSB_1_0
+	ret = libusb_init(&ctx->libusb_ctx);
 	if (LIBUSB_SUCCESS != ret) {
 		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
-		ret = SR_ERR;
-		goto done;
+		g_mutex_unlock(&ctx->io_mutex);
+		return SR_ERR;
 	}
 #endif
 #ifdef HAVE_LIBHIDAPI
@@ -629,19 +694,22 @@ SR_API int sr_init(struct sr_context **ctx)
 	 */
 	if (hid_init() != 0) {
 		sr_err("HIDAPI hid_init() failed.");
-		ret = SR_ERR;
-		goto done;
+#ifdef HAVE_LIBUSB_1_0
+		libusb_exit(ctx->libusb_ctx);
+		ctx->libusb_ctx = NULL;
+#endif
+		g_mutex_unlock(&ctx->io_mutex);
+		return SR_ERR;
 	}
 #endif
-	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
+	(void)ret;
 
-	*ctx = context;
-	context = NULL;
-	ret = SR_OK;
+	ctx->io_initialized = TRUE;
+	g_mutex_unlock(&ctx->io_mutex);
+	sr_dbg("Device access set up in %" PRIi64 " us.",
+		g_get_monotonic_time() - start_us);
 
-done:
-	g_free(context);
-	return ret;
+	return SR_OK;
 }
 
 /**
@@ -662,17 +730,35 @@ SR_API int sr_exit(struct sr_context *ctx)
 	}
 
 	sr_hw_cleanup_all(ctx);
+	sr_thread_pool_exit(ctx);
 
 #ifdef _WIN32
 	WSACleanup();
 #endif
 
+	if (ctx->io_initialized) {
 #ifdef HAVE_LIBHIDAPI
-	hid_exit();
+		hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
-	libusb_exit(ctx->libusb_ctx);
+		if (ctx->hotplug)
+			sr_hotplug_stop(ctx);
+		libusb_exit(ctx->libusb_ctx);
+#endif
+	}
+#ifdef HAVE_LIBUSB_1_0
+	if (ctx->usb_capture)
+		sr_usb_capture_stop(ctx);
+	g_mutex_clear(&ctx->usb_scan_mutex);
 #endif
+	g_mutex_clear(&ctx->io_mutex);
+
+	sr_resource_cache_free(ctx);
+	g_mutex_clear(&ctx->resource_mutex);
+	g_mutex_clear(&ctx->pool_mutex);
+	sr_dev_cache_free(ctx);
+	g_mutex_clear(&ctx->dev_cache_mutex);
+	sr_profile_exit(ctx);
 
 	g_free(sr_driver_list(ctx));
 	g_free(ctx);
@@ -18,48 +18,158 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
-SR_PRIV int bv_get_value(float *out, const struct binary_value_spec *spec,
-	const void *data, size_t length)
+/*
+ * Bulk variants of the read_u16le() et al helpers, for arrays of values.
+ * Conversions into host order are a copy, followed by a byte swap loop
+ * when the byte order differs, which compilers turn into vector code.
+ * So do the conversions to float, as their loops have a constant stride.
+ */
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+#define SWAP_LE TRUE
+#else
+#define SWAP_LE FALSE
+#endif
+#define SWAP_BE (!SWAP_LE)
+
+#define BULK_INT_READER(name, type, bits, swap) \
+SR_PRIV void sr_read_##name##_array(type *out, const void *in, size_t count) \
+{ \
+	size_t i; \
+\
+	memcpy(out, in, count * sizeof(type)); \
+	if (!(swap)) \
+		return; \
+	for (i = 0; i < count; i++) \
+		out[i] = GUINT##bits##_SWAP_LE_BE(out[i]); \
+}
+
+BULK_INT_READER(u16le, uint16_t, 16, SWAP_LE)
+BULK_INT_READER(u16be, uint16_t, 16, SWAP_BE)
+BULK_INT_READER(u32le, uint32_t, 32, SWAP_LE)
+BULK_INT_READER(u32be, uint32_t, 32, SWAP_BE)
+BULK_INT_READER(u64le, uint64_t, 64, SWAP_LE)
+BULK_INT_READER(u64be, uint64_t, 64, SWAP_BE)
+
+#define BULK_FLT_READER(name, swap) \
+SR_PRIV void sr_read_##name##_array(float *out, const void *in, size_t count) \
+{ \
+	const uint8_t *p; \
+	uint32_t u; \
+	size_t i; \
+\
+	if (!(swap)) { \
+		memcpy(out, in, count * sizeof(float)); \
+		return; \
+	} \
+	p = in; \
+	for (i = 0; i < count; i++) { \
+		memcpy(&u, &p[i * sizeof(u)], sizeof(u)); \
+		u = GUINT32_SWAP_LE_BE(u); \
+		memcpy(&out[i], &u, sizeof(u)); \
+	} \
+}
+
+BULK_FLT_READER(fltle, SWAP_LE)
+BULK_FLT_READER(fltbe, SWAP_BE)
+
+#define BULK_FLOAT_CONVERTER(name, reader, size) \
+SR_PRIV void sr_read_##name##_float(float *out, const void *in, \
+	size_t count, double scale, double offset) \
+{ \
+	const uint8_t *p; \
+	size_t i; \
+\
+	p = in; \
+	for (i = 0; i < count; i++) \
+		out[i] = reader(&p[i * (size)]) * scale + offset; \
+}
+
+BULK_FLOAT_CONVERTER(u8, read_u8, 1)
+BULK_FLOAT_CONVERTER(i8, read_i8, 1)
+BULK_FLOAT_CONVERTER(u16le, read_u16le, 2)
+BULK_FLOAT_CONVERTER(u16be, read_u16be, 2)
+BULK_FLOAT_CONVERTER(i16le, read_i16le, 2)
+BULK_FLOAT_CONVERTER(i16be, read_i16be, 2)
+BULK_FLOAT_CONVERTER(u32le, read_u32le, 4)
+BULK_FLOAT_CONVERTER(u32be, read_u32be, 4)
+BULK_FLOAT_CONVERTER(i32le, read_i32le, 4)
+BULK_FLOAT_CONVERTER(i32be, read_i32be, 4)
+BULK_FLOAT_CONVERTER(fltle, read_fltle, 4)
+BULK_FLOAT_CONVERTER(fltbe, read_fltbe, 4)
+BULK_FLOAT_CONVERTER(dblle, read_dblle, 8)
+BULK_FLOAT_CONVERTER(dblbe, read_dblbe, 8)
+
+SR_PRIV int bv_get_values(float *out, const struct binary_value_spec *spec,
+	const void *data, size_t stride, size_t count, size_t length)
 {
-	float value;
+	const uint8_t *p;
+	size_t i;
 
 	if (!out || !spec || !data)
 		return SR_ERR_ARG;
+	if (!count)
+		return SR_OK;
+
+	/*
+	 * Dispatch on the type once, not per value. Contiguous values
+	 * take the bulk converters.
+	 */
+#define VALUE_TYPE(T, R, L, BULK)				\
+	case T:							\
+		if (spec->offset + (count - 1) * stride + (L) > length) \
+			return SR_ERR_DATA;			\
+		if (stride == (L)) {				\
+			BULK(out, p, count, spec->scale, 0);	\
+			break;					\
+		}						\
+		for (i = 0; i < count; i++)			\
+			out[i] = R(p + i * stride) * spec->scale; \
+		break
 
-#define VALUE_TYPE(T, R, L)				\
-	case T:						\
-		if (spec->offset + (L) > length)	\
-			return SR_ERR_DATA;		\
-		value = R(data + spec->offset);		\
+#define VALUE_TYPE_SCALAR(T, R, L)				\
+	case T:							\
+		if (spec->offset + (count - 1) * stride + (L) > length) \
+			return SR_ERR_DATA;			\
+		for (i = 0; i < count; i++)			\
+			out[i] = R(p + i * stride) * spec->scale; \
 		break
 
+	p = (const uint8_t *)data + spec->offset;
 	switch (spec->type) {
-		VALUE_TYPE(BVT_UINT8, R8, sizeof(uint8_t));
+		VALUE_TYPE(BVT_UINT8, R8, sizeof(uint8_t), sr_read_u8_float);
 
-		VALUE_TYPE(BVT_BE_UINT16, RB16, sizeof(uint16_t));
-		VALUE_TYPE(BVT_BE_UINT32, RB32, sizeof(uint32_t));
-		VALUE_TYPE(BVT_BE_UINT64, RB64, sizeof(uint64_t));
-		VALUE_TYPE(BVT_BE_FLOAT, RBFL, sizeof(float));
+		VALUE_TYPE(BVT_BE_UINT16, RB16, sizeof(uint16_t), sr_read_u16be_float);
+		VALUE_TYPE(BVT_BE_UINT32, RB32, sizeof(uint32_t), sr_read_u32be_float);
+		VALUE_TYPE_SCALAR(BVT_BE_UINT64, RB64, sizeof(uint64_t));
+		VALUE_TYPE(BVT_BE_FLOAT, RBFL, sizeof(float), sr_read_fltbe_float);
 
-		VALUE_TYPE(BVT_LE_UINT16, RL16, sizeof(uint16_t));
-		VALUE_TYPE(BVT_LE_UINT32, RL32, sizeof(uint32_t));
-		VALUE_TYPE(BVT_LE_UINT64, RL64, sizeof(uint64_t));
-		VALUE_TYPE(BVT_LE_FLOAT, RLFL, sizeof(float));
+		VALUE_TYPE(BVT_LE_UINT16, RL16, sizeof(uint16_t), sr_read_u16le_float);
+		VALUE_TYPE(BVT_LE_UINT32, RL32, sizeof(uint32_t), sr_read_u32le_float);
+		VALUE_TYPE_SCALAR(BVT_LE_UINT64, RL64, sizeof(uint64_t));
+		VALUE_TYPE(BVT_LE_FLOAT, RLFL, sizeof(float), sr_read_fltle_float);
 
 	default:
 		return SR_ERR_ARG;
 	}
 
 #undef VALUE_TYPE
+#undef VALUE_TYPE_SCALAR
 
-	*out = value * spec->scale;
 	return SR_OK;
 }
 
+SR_PRIV int bv_get_value(float *out, const struct binary_value_spec *spec,
+	const void *data, size_t length)
+{
+	return bv_get_values(out, spec, data, 0, 1, length);
+}
+
 SR_PRIV int bv_send_analog_channel(const struct sr_dev_inst *sdi,
 	struct sr_channel *ch, const struct binary_analog_channel *bac,
 	const void *data, size_t length)
@@ -0,0 +1,245 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Conversion between per-channel bit planes and packed logic samples.
+ *
+ * Several logic analyzers transfer their sample data "channel major":
+ * a block holds a run of consecutive samples for the first channel,
+ * followed by the same run of samples for the next channel, and so on.
+ * The session feed wants "sample major" data instead, where each sample
+ * holds the state of all channels.
+ *
+ * Turning the former into the latter is a bit matrix transposition. The
+ * routines in here do this in 8x8 bit tiles which are kept in a 64bit
+ * word, so that eight samples of eight channels get converted with a
+ * handful of shift and mask operations instead of 64 individual bit
+ * tests.
+ *
+ * The opposite direction serves consumers which look at one channel at
+ * a time, like the text output modules: a block of samples gets sliced
+ * into one plane per channel once, and the per-channel work then runs
+ * on whole bytes of eight samples.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/*
+ * Transpose an 8x8 bit matrix. Byte r of the input is matrix row r,
+ * with bit c being column c. Returns the matrix with rows and columns
+ * swapped (Hacker's Delight, section 7-3).
+ */
+static inline uint64_t transpose_8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+/**
+ * Convert bit planes to packed logic samples.
+ *
+ * Each plane holds consecutive samples of one channel, least significant
+ * bit first: bit b of byte k is sample 8 * k + b. The output has one
+ * sample of @a unitsize bytes (little endian) for each bit of a plane.
+ *
+ * @param[out] samples Output buffer, plane_bytes * 8 * unitsize bytes.
+ * @param[in] unitsize Size of one output sample in bytes.
+ * @param[in] planes Array of unitsize * 8 plane pointers, index i is the
+ *                   plane for output bit i. NULL entries get zero bits.
+ * @param[in] plane_bytes Number of bytes in each plane.
+ *
+ * @private
+ */
+SR_PRIV void sr_bitplanes_to_samples(uint8_t *samples, size_t unitsize,
+	const uint8_t *const *planes, size_t plane_bytes)
+{
+	const uint8_t *const *group_planes;
+	size_t group, idx, bit;
+	gboolean have_planes;
+	uint64_t tile;
+	uint8_t *wp;
+
+	for (group = 0; group < unitsize; group++) {
+		group_planes = &planes[group * 8];
+		wp = &samples[group];
+
+		have_planes = FALSE;
+		for (bit = 0; bit < 8; bit++)
+			have_planes |= group_planes[bit] != NULL;
+		if (!have_planes) {
+			for (idx = 0; idx < plane_bytes * 8; idx++) {
+				*wp = 0;
+				wp += unitsize;
+			}
+			continue;
+		}
+
+		for (idx = 0; idx < plane_bytes; idx++) {
+			tile = 0;
+			for (bit = 0; bit < 8; bit++) {
+				if (!group_planes[bit])
+					continue;
+				tile |= (uint64_t)group_planes[bit][idx] << (8 * bit);
+			}
+			/* Idle lines are common, skip the shuffle for them. */
+			if (tile)
+				tile = transpose_8x8(tile);
+			for (bit = 0; bit < 8; bit++) {
+				*wp = tile & 0xff;
+				tile >>= 8;
+				wp += unitsize;
+			}
+		}
+	}
+}
+
+/**
+ * Create a bit slicer for a set of logic channels.
+ *
+ * @param[in] channel_index Logic bit index of each channel of interest.
+ * @param[in] num_channels Number of entries in @a channel_index.
+ *
+ * @return The new slicer. Release it with sr_bitslice_free().
+ *
+ * @private
+ */
+SR_PRIV struct sr_bitslice *sr_bitslice_new(const int *channel_index,
+	size_t num_channels)
+{
+	struct sr_bitslice *bs;
+
+	bs = g_malloc0(sizeof(*bs));
+	bs->num_channels = num_channels;
+	bs->channel_index = g_memdup2(channel_index,
+		num_channels * sizeof(channel_index[0]));
+	bs->data = g_malloc0(num_channels * SR_BITSLICE_PLANE_BYTES);
+
+	return bs;
+}
+
+/**
+ * Release a bit slicer.
+ *
+ * @param[in] bs The slicer, may be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_bitslice_free(struct sr_bitslice *bs)
+{
+	if (!bs)
+		return;
+
+	g_free(bs->channel_index);
+	g_free(bs->planes);
+	g_free(bs->data);
+	g_free(bs);
+}
+
+/* Map logic bits of the sample layout to the channels' planes. */
+static void bitslice_setup(struct sr_bitslice *bs, size_t unitsize)
+{
+	size_t ch, idx;
+
+	g_free(bs->planes);
+	bs->planes = g_malloc0(unitsize * 8 * sizeof(bs->planes[0]));
+	bs->unitsize = unitsize;
+	for (ch = 0; ch < bs->num_channels; ch++) {
+		idx = bs->channel_index[ch];
+		if (idx < unitsize * 8) {
+			bs->planes[idx] = sr_bitslice_plane(bs, ch);
+			continue;
+		}
+		/* Channels which are not in the samples read as low. */
+		memset(sr_bitslice_plane(bs, ch), 0, SR_BITSLICE_PLANE_BYTES);
+	}
+}
+
+/**
+ * Slice packed logic samples into one bit plane per channel.
+ *
+ * Takes up to SR_BITSLICE_SAMPLES samples. Afterwards the plane of
+ * each channel, see sr_bitslice_plane(), holds these samples least
+ * significant bit first: bit b of byte k is sample 8 * k + b. Bits
+ * past the end of the input are zero.
+ *
+ * @param[in] bs The slicer.
+ * @param[in] samples The samples, @a unitsize bytes each (little endian).
+ * @param[in] unitsize Size of one sample in bytes.
+ * @param[in] num_samples Number of samples available.
+ *
+ * @return The number of samples which were sliced.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_bitslice_load(struct sr_bitslice *bs,
+	const uint8_t *samples, size_t unitsize, size_t num_samples)
+{
+	uint8_t **group_planes;
+	const uint8_t *rp;
+	size_t group, idx, plane_bytes, bit, avail;
+	gboolean have_planes;
+	uint64_t tile;
+
+	if (unitsize != bs->unitsize)
+		bitslice_setup(bs, unitsize);
+
+	num_samples = MIN(num_samples, SR_BITSLICE_SAMPLES);
+	plane_bytes = (num_samples + 7) / 8;
+	for (group = 0; group < unitsize; group++) {
+		group_planes = &bs->planes[group * 8];
+		have_planes = FALSE;
+		for (bit = 0; bit < 8; bit++)
+			have_planes |= group_planes[bit] != NULL;
+		if (!have_planes)
+			continue;
+
+		rp = &samples[group];
+		for (idx = 0; idx < plane_bytes; idx++) {
+			avail = MIN(num_samples - idx * 8, 8);
+			tile = 0;
+			for (bit = 0; bit < avail; bit++) {
+				tile |= (uint64_t)*rp << (8 * bit);
+				rp += unitsize;
+			}
+			if (tile)
+				tile = transpose_8x8(tile);
+			for (bit = 0; bit < 8; bit++) {
+				if (group_planes[bit])
+					group_planes[bit][idx] = tile & 0xff;
+				tile >>= 8;
+			}
+		}
+	}
+
+	return num_samples;
+}
@@ -96,6 +96,21 @@
 #define CONNECT_RFCOMM_TRIES	3
 #define CONNECT_RFCOMM_RETRY_MS	100
 
+/*
+ * Link parameters for BLE connections. The default ATT MTU of 23 bytes
+ * and the central's default connection interval limit the rate at
+ * which notifications arrive. Ask for the largest MTU which fits the
+ * receive buffer, and for a short connection interval (in units of
+ * 1.25ms). Peers are free to reject either request.
+ */
+#define BLE_ATT_MTU_DEFAULT	23
+#define BLE_ATT_MTU_WANT	247
+#define BLE_CONN_INTERVAL_MIN	6	/* 7.5ms */
+#define BLE_CONN_INTERVAL_MAX	24	/* 30ms */
+#define BLE_CONN_LATENCY	0
+#define BLE_CONN_SUPERVISION	200	/* 2s, in units of 10ms */
+#define BLE_CONN_UPDATE_TO_MS	1000
+
 /* Silence warning about (currently) unused routine. */
 #define WITH_WRITE_TYPE_HANDLE	0
 
@@ -239,10 +254,14 @@ struct sr_bt_desc {
 	uint16_t write_handle;
 	uint16_t cccd_handle;
 	uint16_t cccd_value;
+	size_t batch_count;
+	gboolean batch_merge;
 	/* Internal state. */
 	int devid;
 	int fd;
 	struct hci_filter orig_filter;
+	uint16_t att_mtu;
+	GByteArray *batch_data;
 };
 
 static int sr_bt_desc_open(struct sr_bt_desc *desc, int *id_ref);
@@ -268,6 +287,7 @@ SR_PRIV struct sr_bt_desc *sr_bt_desc_new(void)
 
 	desc->devid = -1;
 	desc->fd = -1;
+	desc->att_mtu = BLE_ATT_MTU_DEFAULT;
 
 	return desc;
 }
@@ -278,6 +298,8 @@ SR_PRIV void sr_bt_desc_free(struct sr_bt_desc *desc)
 		return;
 
 	sr_bt_desc_close(desc);
+	if (desc->batch_data)
+		g_byte_array_free(desc->batch_data, TRUE);
 	g_free(desc);
 }
 
@@ -379,6 +401,29 @@ SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	return 0;
 }
 
+/*
+ * Have sr_bt_check_notify() process up to 'count' pending messages
+ * per call instead of just one. With 'merge' set, the payloads of
+ * the notifications get concatenated and passed to the data callback
+ * in a single invocation, which suits byte stream consumers. Without
+ * 'merge' the data callback runs for each notification, which keeps
+ * message boundaries. A count of 0 or 1 restores the default of one
+ * message per call.
+ */
+SR_PRIV int sr_bt_config_batch(struct sr_bt_desc *desc,
+	size_t count, gboolean merge)
+{
+	if (!desc)
+		return -1;
+
+	desc->batch_count = count;
+	desc->batch_merge = merge;
+	if (merge && count > 1 && !desc->batch_data)
+		desc->batch_data = g_byte_array_new();
+
+	return 0;
+}
+
 static int sr_bt_desc_open(struct sr_bt_desc *desc, int *id_ref)
 {
 	int id, sock;
@@ -657,6 +702,62 @@ SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration)
 /* }}} scan */
 /* {{{ connect/disconnect */
 
+/*
+ * Request a larger ATT MTU. The response is handled when messages get
+ * received, notifications are accepted in either case.
+ */
+static void sr_bt_request_mtu(struct sr_bt_desc *desc)
+{
+	ssize_t wrlen;
+
+	wrlen = sr_bt_write_type_handle_bytes(desc,
+		BLE_ATT_EXCHANGE_MTU_REQ, BLE_ATT_MTU_WANT, NULL, 0);
+	if (wrlen < 0)
+		sr_dbg("Cannot request ATT MTU %d.", BLE_ATT_MTU_WANT);
+}
+
+/*
+ * Request a short connection interval, such that notifications get
+ * delivered as often as the peer can send them. Requires an HCI socket
+ * and an appropriate permission, failure is not fatal.
+ */
+static void sr_bt_request_conn_interval(struct sr_bt_desc *desc)
+{
+	struct l2cap_conninfo info;
+	socklen_t len;
+	bdaddr_t mac;
+	int id, dd, ret;
+
+	memset(&info, 0, sizeof(info));
+	len = sizeof(info);
+	ret = getsockopt(desc->fd, SOL_L2CAP, L2CAP_CONNINFO, &info, &len);
+	if (ret < 0) {
+		sr_dbg("Cannot get BLE connection handle.");
+		return;
+	}
+
+	if (desc->local_addr[0]) {
+		id = hci_devid(desc->local_addr);
+	} else {
+		str2ba(desc->remote_addr, &mac);
+		id = hci_get_route(&mac);
+	}
+	if (id < 0)
+		return;
+	dd = hci_open_dev(id);
+	if (dd < 0)
+		return;
+	ret = hci_le_conn_update(dd, info.hci_handle,
+		BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX,
+		BLE_CONN_LATENCY, BLE_CONN_SUPERVISION, BLE_CONN_UPDATE_TO_MS);
+	if (ret < 0)
+		sr_dbg("BLE connection parameter update was not accepted.");
+	else
+		sr_dbg("BLE connection interval %d-%d (x1.25ms) requested.",
+			BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX);
+	hci_close_dev(dd);
+}
+
 SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 {
 	struct sockaddr_l2 sl2;
@@ -784,6 +885,10 @@ SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 		return ret;
 	}
 
+	desc->att_mtu = BLE_ATT_MTU_DEFAULT;
+	sr_bt_request_mtu(desc);
+	sr_bt_request_conn_interval(desc);
+
 	return 0;
 }
 
@@ -898,27 +1003,29 @@ SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
-SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+/* Pass notification payload to the application, or batch it up. */
+static int sr_bt_notify_data(struct sr_bt_desc *desc,
+	uint8_t *data, size_t dlen)
+{
+	if (!desc->data_cb)
+		return 0;
+	if (desc->batch_merge && desc->batch_data) {
+		g_byte_array_append(desc->batch_data, data, dlen);
+		return 0;
+	}
+
+	return desc->data_cb(desc->data_cb_data, data, dlen);
+}
+
+/* Process one message which was received from the Bluetooth socket. */
+static int sr_bt_handle_message(struct sr_bt_desc *desc,
+	uint8_t *buf, ssize_t rdlen)
 {
-	uint8_t buf[1024];
-	ssize_t rdlen;
 	uint8_t packet_type;
 	uint16_t packet_handle;
 	uint8_t *packet_data;
 	size_t packet_dlen;
-
-	if (!desc)
-		return -1;
-
-	if (sr_bt_check_socket_usable(desc) < 0)
-		return -2;
-
-	/* Get another message from the Bluetooth socket. */
-	rdlen = sr_bt_read(desc, buf, sizeof(buf));
-	if (rdlen < 0)
-		return -2;
-	if (!rdlen)
-		return 0;
+	uint16_t mtu;
 
 	/* Get header fields and references to the payload data. */
 	packet_type = 0x00;
@@ -943,6 +1050,14 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "write response");
 		/* EMPTY */
 		break;
+	case BLE_ATT_EXCHANGE_MTU_RESP:
+		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "MTU response");
+		/* The handle position holds the peer's receive MTU. */
+		mtu = MIN(packet_handle, BLE_ATT_MTU_WANT);
+		if (mtu >= BLE_ATT_MTU_DEFAULT)
+			desc->att_mtu = mtu;
+		sr_dbg("BLE ATT MTU %u.", desc->att_mtu);
+		break;
 	case BLE_ATT_HANDLE_INDICATION:
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "handle indication");
 		sr_bt_write_type(desc, BLE_ATT_HANDLE_CONFIRMATION);
@@ -950,18 +1065,14 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 			return -4;
 		if (!packet_data)
 			return -4;
-		if (!desc->data_cb)
-			return 0;
-		return desc->data_cb(desc->data_cb_data, packet_data, packet_dlen);
+		return sr_bt_notify_data(desc, packet_data, packet_dlen);
 	case BLE_ATT_HANDLE_NOTIFICATION:
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "handle notification");
 		if (packet_handle != desc->read_handle)
 			return -4;
 		if (!packet_data)
 			return -4;
-		if (!desc->data_cb)
-			return 0;
-		return desc->data_cb(desc->data_cb_data, packet_data, packet_dlen);
+		return sr_bt_notify_data(desc, packet_data, packet_dlen);
 	default:
 		sr_spew("unsupported type 0x%02x", packet_type);
 		return -3;
@@ -970,6 +1081,59 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
+/*
+ * Process pending messages from the Bluetooth socket. Handles one
+ * message by default, and returns the data callback's result for
+ * notifications. When batching was configured, handles as many pending
+ * messages as configured, and returns the number of messages handled.
+ * Returns negative upon errors.
+ */
+SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+{
+	uint8_t buf[1024];
+	ssize_t rdlen;
+	size_t count, max_count;
+	int ret, rc;
+
+	if (!desc)
+		return -1;
+
+	if (sr_bt_check_socket_usable(desc) < 0)
+		return -2;
+
+	max_count = MAX(desc->batch_count, 1);
+	count = 0;
+	ret = 0;
+	while (count < max_count) {
+		/* Get another message from the Bluetooth socket. */
+		rdlen = sr_bt_read(desc, buf, sizeof(buf));
+		if (rdlen < 0) {
+			ret = -2;
+			break;
+		}
+		if (!rdlen)
+			break;
+		ret = sr_bt_handle_message(desc, buf, rdlen);
+		if (ret < 0)
+			break;
+		count++;
+	}
+
+	/* Pass batched up notification payload in one call. */
+	if (desc->batch_merge && desc->batch_data && desc->batch_data->len) {
+		rc = desc->data_cb(desc->data_cb_data,
+			desc->batch_data->data, desc->batch_data->len);
+		g_byte_array_set_size(desc->batch_data, 0);
+		if (rc < 0 && ret >= 0)
+			ret = rc;
+	}
+
+	if (ret < 0 || max_count == 1)
+		return ret;
+
+	return count;
+}
+
 /* }}} indication/notification */
 /* {{{ read/write */
 
@@ -0,0 +1,701 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Uncompressed, memory mappable capture files.
+ *
+ * Unlike srzip session files, the sample data in these files is stored
+ * as is, so the file can be mapped into memory and the samples used in
+ * place. All values are little endian.
+ *
+ * The file starts with a header:
+ *
+ *   offset  size  content
+ *    0       8    SR_CAPFILE_MAGIC
+ *    8       4    format version, SR_CAPFILE_VERSION
+ *   12       4    header size, the offset of the first extent
+ *   16       8    samplerate in Hz, 0 if unknown
+ *   24       8    offset of the index, 0 if the file was not finished
+ *   32       4    number of logic channels
+ *   36       4    logic unitsize in bytes
+ *   40       4    number of analog channels
+ *   44       4    reserved, 0
+ *   48       ...  channel names, NUL terminated, logic channels first
+ *
+ * The samples follow in extents. Each extent holds consecutive samples
+ * of one channel group. Group 0 is the logic data, group N is the N-th
+ * analog channel, in single precision floating point format. An extent
+ * consists of a SR_CAPFILE_EXTENT_SIZE bytes header (magic, group, number
+ * of samples, data size in bytes), followed by the data. The header, all
+ * extents and the index start at a multiple of SR_CAPFILE_ALIGN.
+ *
+ * The index lists all extents (magic, reserved, number of entries, the
+ * entries). Each entry holds the group, a reserved word, the number of
+ * the extent's first sample within its group, the number of samples,
+ * and the offset of the extent's data. Files without an index (because
+ * the writer did not finish) can be read by walking the extents.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "capture-file"
+/** @endcond */
+
+/**
+ * @defgroup grp_capture_file Capture files
+ *
+ * Memory mapped access to uncompressed capture files.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+struct capfile_extent {
+	uint64_t first_sample;
+	uint64_t num_samples;
+	const uint8_t *data;
+};
+
+struct capfile_group {
+	size_t unitsize;
+	uint64_t num_samples;
+	GArray *extents;
+};
+
+struct sr_capture_file {
+	GMappedFile *mapping;
+	struct sr_capfile_header header;
+	/* Group 0 is logic, the analog channels follow. */
+	struct capfile_group *groups;
+	size_t num_groups;
+};
+/** @endcond */
+
+/**
+ * Get the aligned size of a capture file header.
+ *
+ * @param hdr The header, with all channel names set.
+ *
+ * @return The header's size in bytes.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_capfile_header_size(const struct sr_capfile_header *hdr)
+{
+	size_t size, i;
+
+	size = SR_CAPFILE_HEADER_FIXED;
+	for (i = 0; i < hdr->num_logic + hdr->num_analog; i++)
+		size += strlen(hdr->names[i]) + 1;
+
+	return SR_CAPFILE_ALIGN_UP(size);
+}
+
+/**
+ * Serialize a capture file header.
+ *
+ * @param buf Buffer of sr_capfile_header_size() bytes, all zero.
+ * @param hdr The header.
+ *
+ * @private
+ */
+SR_PRIV void sr_capfile_header_write(uint8_t *buf,
+	const struct sr_capfile_header *hdr)
+{
+	size_t i, len;
+	uint8_t *p;
+
+	memcpy(buf, SR_CAPFILE_MAGIC, 8);
+	WL32(&buf[8], SR_CAPFILE_VERSION);
+	WL32(&buf[12], sr_capfile_header_size(hdr));
+	WL64(&buf[16], hdr->samplerate);
+	WL64(&buf[24], hdr->index_offset);
+	WL32(&buf[32], hdr->num_logic);
+	WL32(&buf[36], hdr->unitsize);
+	WL32(&buf[40], hdr->num_analog);
+	WL32(&buf[44], 0);
+
+	p = &buf[SR_CAPFILE_HEADER_FIXED];
+	for (i = 0; i < hdr->num_logic + hdr->num_analog; i++) {
+		len = strlen(hdr->names[i]) + 1;
+		memcpy(p, hdr->names[i], len);
+		p += len;
+	}
+}
+
+/**
+ * Parse a capture file header.
+ *
+ * @param buf The start of the file.
+ * @param len The number of bytes available at @a buf.
+ * @param hdr Where to store the header. Must be released with
+ *            sr_capfile_header_clear() after success.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR This is not a capture file.
+ * @retval SR_ERR_NA More data is needed.
+ * @retval SR_ERR_DATA Malformed or unsupported header.
+ *
+ * @private
+ */
+SR_PRIV int sr_capfile_header_parse(const uint8_t *buf, size_t len,
+	struct sr_capfile_header *hdr)
+{
+	const char *p, *end;
+	size_t header_size, num_names, i;
+
+	memset(hdr, 0, sizeof(*hdr));
+	if (len < 8)
+		return SR_ERR_NA;
+	if (memcmp(buf, SR_CAPFILE_MAGIC, 8) != 0)
+		return SR_ERR;
+	if (len < SR_CAPFILE_HEADER_FIXED)
+		return SR_ERR_NA;
+	if (RL32(&buf[8]) != SR_CAPFILE_VERSION) {
+		sr_err("Unsupported capture file version %u.", RL32(&buf[8]));
+		return SR_ERR_DATA;
+	}
+	header_size = RL32(&buf[12]);
+	if (header_size < SR_CAPFILE_HEADER_FIXED ||
+			header_size % SR_CAPFILE_ALIGN) {
+		sr_err("Invalid capture file header size.");
+		return SR_ERR_DATA;
+	}
+	if (len < header_size)
+		return SR_ERR_NA;
+
+	hdr->header_size = header_size;
+	hdr->samplerate = RL64(&buf[16]);
+	hdr->index_offset = RL64(&buf[24]);
+	hdr->num_logic = RL32(&buf[32]);
+	hdr->unitsize = RL32(&buf[36]);
+	hdr->num_analog = RL32(&buf[40]);
+	if (hdr->num_logic > hdr->unitsize * 8 ||
+			(hdr->num_logic && !hdr->unitsize)) {
+		sr_err("Invalid capture file logic unitsize.");
+		return SR_ERR_DATA;
+	}
+
+	/* Each name takes at least its terminating NUL. */
+	num_names = (size_t)hdr->num_logic + hdr->num_analog;
+	if (num_names > header_size - SR_CAPFILE_HEADER_FIXED) {
+		sr_err("Invalid capture file channel count.");
+		return SR_ERR_DATA;
+	}
+	hdr->names = g_malloc0_n(num_names + 1, sizeof(hdr->names[0]));
+	p = (const char *)&buf[SR_CAPFILE_HEADER_FIXED];
+	end = (const char *)&buf[header_size];
+	for (i = 0; i < num_names; i++) {
+		if (!memchr(p, '\0', end - p)) {
+			sr_err("Invalid capture file channel names.");
+			sr_capfile_header_clear(hdr);
+			return SR_ERR_DATA;
+		}
+		hdr->names[i] = g_strdup(p);
+		p += strlen(p) + 1;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Release the resources of a parsed capture file header.
+ *
+ * @param hdr The header.
+ *
+ * @private
+ */
+SR_PRIV void sr_capfile_header_clear(struct sr_capfile_header *hdr)
+{
+	g_strfreev(hdr->names);
+	hdr->names = NULL;
+}
+
+/**
+ * Serialize an extent header.
+ *
+ * @param buf Buffer of SR_CAPFILE_EXTENT_SIZE bytes.
+ * @param group The extent's channel group.
+ * @param num_samples The number of samples in the extent.
+ * @param data_size The size of the extent's data in bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_capfile_extent_write(uint8_t *buf, uint32_t group,
+	uint64_t num_samples, uint64_t data_size)
+{
+	memset(buf, 0, SR_CAPFILE_EXTENT_SIZE);
+	WL32(&buf[0], SR_CAPFILE_EXTENT_MAGIC);
+	WL32(&buf[4], group);
+	WL64(&buf[8], num_samples);
+	WL64(&buf[16], data_size);
+}
+
+/**
+ * Parse an extent header.
+ *
+ * @param buf Buffer of SR_CAPFILE_EXTENT_SIZE bytes.
+ * @param group Where to store the extent's channel group.
+ * @param num_samples Where to store the number of samples in the extent.
+ * @param data_size Where to store the size of the extent's data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA This is not an extent header.
+ *
+ * @private
+ */
+SR_PRIV int sr_capfile_extent_parse(const uint8_t *buf, uint32_t *group,
+	uint64_t *num_samples, uint64_t *data_size)
+{
+	if (RL32(&buf[0]) != SR_CAPFILE_EXTENT_MAGIC)
+		return SR_ERR_DATA;
+
+	*group = RL32(&buf[4]);
+	*num_samples = RL64(&buf[8]);
+	*data_size = RL64(&buf[16]);
+
+	return SR_OK;
+}
+
+static int capfile_add_extent(struct sr_capture_file *cf, uint32_t group,
+	uint64_t num_samples, uint64_t offset)
+{
+	struct capfile_group *grp;
+	struct capfile_extent ext;
+	gsize file_size;
+
+	if (group >= cf->num_groups) {
+		sr_err("Invalid channel group %u in capture file.", group);
+		return SR_ERR_DATA;
+	}
+	grp = &cf->groups[group];
+
+	file_size = g_mapped_file_get_length(cf->mapping);
+	if (offset > file_size ||
+			num_samples > (file_size - offset) / grp->unitsize) {
+		sr_err("Truncated extent in capture file.");
+		return SR_ERR_DATA;
+	}
+
+	ext.first_sample = grp->num_samples;
+	ext.num_samples = num_samples;
+	ext.data = (const uint8_t *)g_mapped_file_get_contents(cf->mapping) +
+		offset;
+	g_array_append_val(grp->extents, ext);
+	grp->num_samples += num_samples;
+
+	return SR_OK;
+}
+
+/* Load the extent list from the index which the writer left. */
+static int capfile_read_index(struct sr_capture_file *cf)
+{
+	const uint8_t *base, *entry;
+	gsize file_size;
+	uint64_t offset, count, i;
+	int ret;
+
+	base = (const uint8_t *)g_mapped_file_get_contents(cf->mapping);
+	file_size = g_mapped_file_get_length(cf->mapping);
+	offset = cf->header.index_offset;
+	if (offset > file_size || file_size - offset < SR_CAPFILE_INDEX_HEADER ||
+			RL32(&base[offset]) != SR_CAPFILE_INDEX_MAGIC)
+		return SR_ERR_DATA;
+	count = RL64(&base[offset + 8]);
+	if (count > (file_size - offset - SR_CAPFILE_INDEX_HEADER) /
+			SR_CAPFILE_INDEX_ENTRY)
+		return SR_ERR_DATA;
+
+	/* Entries are in file order, thus in sample order per group. */
+	entry = &base[offset + SR_CAPFILE_INDEX_HEADER];
+	for (i = 0; i < count; i++) {
+		ret = capfile_add_extent(cf, RL32(&entry[0]),
+			RL64(&entry[16]), RL64(&entry[24]));
+		if (ret != SR_OK)
+			return ret;
+		entry += SR_CAPFILE_INDEX_ENTRY;
+	}
+
+	return SR_OK;
+}
+
+/* Find the extents of a file which has no index, by walking them. */
+static int capfile_scan_extents(struct sr_capture_file *cf)
+{
+	const uint8_t *base;
+	gsize file_size;
+	uint64_t offset, num_samples, data_size;
+	uint32_t group;
+	int ret;
+
+	base = (const uint8_t *)g_mapped_file_get_contents(cf->mapping);
+	file_size = g_mapped_file_get_length(cf->mapping);
+	offset = cf->header.header_size;
+	while (file_size - offset >= SR_CAPFILE_EXTENT_SIZE) {
+		if (sr_capfile_extent_parse(&base[offset], &group,
+				&num_samples, &data_size) != SR_OK)
+			break;
+		offset += SR_CAPFILE_EXTENT_SIZE;
+		if (data_size > file_size - offset) {
+			/* The writer got interrupted, ignore the remainder. */
+			sr_warn("Capture file ends in an incomplete extent.");
+			break;
+		}
+		ret = capfile_add_extent(cf, group, num_samples, offset);
+		if (ret != SR_OK)
+			return ret;
+		offset += SR_CAPFILE_ALIGN_UP(data_size);
+		if (offset > file_size)
+			break;
+	}
+
+	return SR_OK;
+}
+
+static void capfile_free(struct sr_capture_file *cf)
+{
+	size_t i;
+
+	for (i = 0; i < cf->num_groups; i++)
+		g_array_free(cf->groups[i].extents, TRUE);
+	g_free(cf->groups);
+	sr_capfile_header_clear(&cf->header);
+	if (cf->mapping)
+		g_mapped_file_unref(cf->mapping);
+	g_free(cf);
+}
+
+/**
+ * Open a capture file.
+ *
+ * The file gets mapped into memory. No sample data is read or copied,
+ * the operating system's page cache holds the data which is accessed.
+ *
+ * @param filename The name of the capture file.
+ * @param cf Where to store the capture file handle. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO The file cannot be mapped.
+ * @retval SR_ERR This is not a capture file.
+ * @retval SR_ERR_DATA Malformed capture file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_open(const char *filename,
+	struct sr_capture_file **cf)
+{
+	struct sr_capture_file *capf;
+	GError *error;
+	size_t i;
+	int ret;
+
+	if (!filename || !cf)
+		return SR_ERR_ARG;
+	*cf = NULL;
+
+	capf = g_malloc0(sizeof(*capf));
+	error = NULL;
+	capf->mapping = g_mapped_file_new(filename, FALSE, &error);
+	if (!capf->mapping) {
+		sr_err("Cannot map '%s': %s.", filename, error->message);
+		g_error_free(error);
+		g_free(capf);
+		return SR_ERR_IO;
+	}
+
+	ret = sr_capfile_header_parse(
+		(const uint8_t *)g_mapped_file_get_contents(capf->mapping),
+		g_mapped_file_get_length(capf->mapping), &capf->header);
+	if (ret != SR_OK) {
+		capfile_free(capf);
+		return ret == SR_ERR_NA ? SR_ERR_DATA : ret;
+	}
+
+	capf->num_groups = 1 + capf->header.num_analog;
+	capf->groups = g_malloc0_n(capf->num_groups, sizeof(capf->groups[0]));
+	for (i = 0; i < capf->num_groups; i++) {
+		capf->groups[i].unitsize = i ? sizeof(float) :
+			MAX(capf->header.unitsize, 1);
+		capf->groups[i].extents = g_array_new(FALSE, FALSE,
+			sizeof(struct capfile_extent));
+	}
+
+	ret = SR_ERR_DATA;
+	if (capf->header.index_offset)
+		ret = capfile_read_index(capf);
+	if (ret != SR_OK) {
+		if (capf->header.index_offset)
+			sr_warn("Bad index in '%s', scanning extents.", filename);
+		for (i = 0; i < capf->num_groups; i++) {
+			g_array_set_size(capf->groups[i].extents, 0);
+			capf->groups[i].num_samples = 0;
+		}
+		ret = capfile_scan_extents(capf);
+	}
+	if (ret != SR_OK) {
+		capfile_free(capf);
+		return ret;
+	}
+
+	*cf = capf;
+
+	return SR_OK;
+}
+
+/**
+ * Close a capture file, and unmap it.
+ *
+ * Pointers which sr_capture_file_logic_map() or
+ * sr_capture_file_analog_map() returned become invalid.
+ *
+ * @param cf The capture file.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_close(struct sr_capture_file *cf)
+{
+	if (!cf)
+		return SR_ERR_ARG;
+
+	capfile_free(cf);
+
+	return SR_OK;
+}
+
+/**
+ * Get the properties of a capture file.
+ *
+ * @param cf The capture file.
+ * @param samplerate Where to store the samplerate, 0 when unknown.
+ *                   May be NULL.
+ * @param num_logic Where to store the number of logic channels.
+ *                  May be NULL.
+ * @param unitsize Where to store the size of a logic sample in bytes.
+ *                 May be NULL.
+ * @param num_analog Where to store the number of analog channels.
+ *                   May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_info(const struct sr_capture_file *cf,
+	uint64_t *samplerate, unsigned int *num_logic,
+	unsigned int *unitsize, unsigned int *num_analog)
+{
+	if (!cf)
+		return SR_ERR_ARG;
+
+	if (samplerate)
+		*samplerate = cf->header.samplerate;
+	if (num_logic)
+		*num_logic = cf->header.num_logic;
+	if (unitsize)
+		*unitsize = cf->header.unitsize;
+	if (num_analog)
+		*num_analog = cf->header.num_analog;
+
+	return SR_OK;
+}
+
+/**
+ * Get the name of a channel in a capture file.
+ *
+ * @param cf The capture file.
+ * @param index The channel's index. Logic channels come first, analog
+ *              channels follow.
+ *
+ * @return The channel's name, NULL for invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_capture_file_channel_name(
+	const struct sr_capture_file *cf, unsigned int index)
+{
+	if (!cf || index >= cf->header.num_logic + cf->header.num_analog)
+		return NULL;
+
+	return cf->header.names[index];
+}
+
+static const struct capfile_group *capfile_group(
+	const struct sr_capture_file *cf, size_t group)
+{
+	if (!cf || group >= cf->num_groups)
+		return NULL;
+
+	return &cf->groups[group];
+}
+
+/* Find the extent which holds a sample, by binary search. */
+static int capfile_map(const struct capfile_group *grp, uint64_t start,
+	const void **data, uint64_t *count)
+{
+	const struct capfile_extent *ext;
+	size_t lo, hi, mid;
+
+	*count = 0;
+	*data = NULL;
+	if (start >= grp->num_samples)
+		return SR_OK;
+
+	lo = 0;
+	hi = grp->extents->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		ext = &g_array_index(grp->extents, struct capfile_extent, mid);
+		if (ext->first_sample <= start)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	/* Skip empty extents. */
+	ext = &g_array_index(grp->extents, struct capfile_extent, lo);
+	while (start >= ext->first_sample + ext->num_samples)
+		ext++;
+
+	*data = ext->data + (start - ext->first_sample) * grp->unitsize;
+	*count = ext->first_sample + ext->num_samples - start;
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of logic samples in a capture file.
+ *
+ * @param cf The capture file.
+ * @param num_samples Where to store the number of samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_logic_samples(const struct sr_capture_file *cf,
+	uint64_t *num_samples)
+{
+	const struct capfile_group *grp;
+
+	if (!(grp = capfile_group(cf, 0)) || !num_samples)
+		return SR_ERR_ARG;
+
+	*num_samples = cf->header.num_logic ? grp->num_samples : 0;
+
+	return SR_OK;
+}
+
+/**
+ * Map logic samples of a capture file.
+ *
+ * The samples are stored in extents. This returns a pointer to the
+ * sample @a start within the file's mapping, and the number of samples
+ * which follow it contiguously. Callers iterate to access longer ranges.
+ *
+ * @param cf The capture file.
+ * @param start The number of the first sample.
+ * @param data Where to store the pointer to the sample data. The data
+ *             remains valid until the file gets closed.
+ * @param count Where to store the number of contiguous samples, 0 when
+ *              @a start is beyond the end of the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_logic_map(const struct sr_capture_file *cf,
+	uint64_t start, const void **data, uint64_t *count)
+{
+	const struct capfile_group *grp;
+
+	if (!(grp = capfile_group(cf, 0)) || !data || !count)
+		return SR_ERR_ARG;
+
+	return capfile_map(grp, start, data, count);
+}
+
+/**
+ * Get the number of samples of an analog channel in a capture file.
+ *
+ * @param cf The capture file.
+ * @param channel The analog channel, counting from 0.
+ * @param num_samples Where to store the number of samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_analog_samples(const struct sr_capture_file *cf,
+	unsigned int channel, uint64_t *num_samples)
+{
+	const struct capfile_group *grp;
+
+	if (!(grp = capfile_group(cf, (size_t)channel + 1)) || !num_samples)
+		return SR_ERR_ARG;
+
+	*num_samples = grp->num_samples;
+
+	return SR_OK;
+}
+
+/**
+ * Map samples of an analog channel of a capture file.
+ *
+ * The values are IEEE 754 single precision floats in little endian
+ * format, which matches the native representation of most hosts.
+ *
+ * @param cf The capture file.
+ * @param channel The analog channel, counting from 0.
+ * @param start The number of the first sample.
+ * @param data Where to store the pointer to the sample data.
+ * @param count Where to store the number of contiguous samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @see sr_capture_file_logic_map()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_capture_file_analog_map(const struct sr_capture_file *cf,
+	unsigned int channel, uint64_t start, const float **data,
+	uint64_t *count)
+{
+	const struct capfile_group *grp;
+
+	if (!(grp = capfile_group(cf, (size_t)channel + 1)) || !data || !count)
+		return SR_ERR_ARG;
+
+	return capfile_map(grp, start, (const void **)data, count);
+}
+
+/** @} */
@@ -44,24 +44,8 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
-
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
-
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
-
-	if (!analog->encoding->is_float)
-		g_free(input);
-
-	return SR_OK;
+	return sr_analog_to_levels(analog, 0, 1, count,
+		threshold, threshold, NULL, output, 1, 0);
 }
 
 /**
@@ -82,28 +66,110 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	return sr_analog_to_levels(analog, 0, 1, count,
+		lo_thr, hi_thr, state, output, 1, 0);
+}
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+static int a2l_logic(const struct sr_datafeed_analog *analog,
+		const float *lo_thr, const float *hi_thr, uint8_t *states,
+		uint8_t *logic, unsigned int unitsize, unsigned int first_bit)
+{
+	unsigned int num_channels, ch, bit;
+	int ret;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!lo_thr || !logic || !unitsize)
+		return SR_ERR_ARG;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (first_bit + num_channels > unitsize * 8) {
+		sr_err("%u channels don't fit into unitsize %u at bit %u.",
+			num_channels, unitsize, first_bit);
+		return SR_ERR_ARG;
+	}
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	for (ch = 0; ch < num_channels; ch++) {
+		bit = first_bit + ch;
+		ret = sr_analog_to_levels(analog, ch, num_channels,
+			analog->num_samples, lo_thr[ch],
+			hi_thr ? hi_thr[ch] : lo_thr[ch],
+			states ? &states[ch] : NULL,
+			logic + bit / 8, unitsize, 1 << (bit % 8));
+		if (ret != SR_OK)
+			return ret;
+	}
 
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+	return SR_OK;
+}
 
-		output[i] = *state;
-	}
+/**
+ * Derive logic traces from all channels of an analog payload.
+ *
+ * Every analog channel gets compared against its own fixed threshold.
+ * The results get stored as bits of logic samples, so that they can
+ * get sent in SR_DF_LOGIC packets. Channel n of the payload (in the order
+ * of analog->meaning->channels) becomes the bit (first_bit + n). Other
+ * bits of the logic samples are not modified.
+ *
+ * Integer encodings are compared in raw ADC units. The thresholds get
+ * translated using the encoding's scale and offset, the samples are not
+ * converted to floating point values.
+ *
+ * @param[in] analog The analog input values. Must not be NULL.
+ * @param[in] thresholds The thresholds, one per channel. Values at or
+ *                       above the threshold yield 1. Must not be NULL.
+ * @param[in,out] logic The logic samples. Must provide space for
+ *                      analog->num_samples samples of unitsize bytes.
+ * @param[in] unitsize The size of one logic sample in bytes.
+ * @param[in] first_bit The bit which receives the first channel's level.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the channels don't fit.
+ * @retval SR_ERR Unsupported encoding.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		const float *thresholds, uint8_t *logic, unsigned int unitsize,
+		unsigned int first_bit)
+{
+	return a2l_logic(analog, thresholds, NULL, NULL,
+		logic, unitsize, first_bit);
+}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+/**
+ * Derive logic traces with hysteresis from all channels of an analog payload.
+ *
+ * This is the Schmitt-trigger variant of sr_a2l_threshold_logic(). Every
+ * channel has its own pair of thresholds, and its own state.
+ *
+ * @param[in] analog The analog input values. Must not be NULL.
+ * @param[in] lo_thr The low thresholds, one per channel. Levels become 0
+ *                   below them. Must not be NULL.
+ * @param[in] hi_thr The high thresholds, one per channel. Levels become 1
+ *                   above them. Must not be NULL.
+ * @param[in,out] states The converter states, one per channel. Must contain
+ *                       the levels of the previous samples, will contain
+ *                       the levels of the last samples upon exit.
+ * @param[in,out] logic The logic samples. Must provide space for
+ *                      analog->num_samples samples of unitsize bytes.
+ * @param[in] unitsize The size of one logic sample in bytes.
+ * @param[in] first_bit The bit which receives the first channel's level.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the channels don't fit.
+ * @retval SR_ERR Unsupported encoding.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		const float *lo_thr, const float *hi_thr, uint8_t *states,
+		uint8_t *logic, unsigned int unitsize, unsigned int first_bit)
+{
+	if (!hi_thr || !states)
+		return SR_ERR_ARG;
 
-	return SR_OK;
+	return a2l_logic(analog, lo_thr, hi_thr, states,
+		logic, unitsize, first_bit);
 }
@@ -19,25 +19,152 @@
 
 #include <config.h>
 #include <stdint.h>
+#include <glib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
+/*
+ * All CRCs here are reflected (LSB first), and get computed with the
+ * slicing-by-8 method: table[k][b] is the CRC contribution of byte b
+ * followed by k zero bytes, which lets eight input bytes get folded
+ * into the CRC by eight independent table lookups per step. Tables are
+ * built on first use.
+ */
+#define CRC_SLICES 8
+
+static void crc16_table_build(uint16_t table[CRC_SLICES][256], uint16_t poly)
+{
+	uint16_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+		table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++) {
+		for (j = 1; j < CRC_SLICES; j++) {
+			crc = table[j - 1][i];
+			table[j][i] = (crc >> 8) ^ table[0][crc & 0xff];
+		}
+	}
+}
+
+static uint16_t crc16_update(const uint16_t table[CRC_SLICES][256],
+	uint16_t crc, const uint8_t *buffer, size_t len)
+{
+	while (len >= CRC_SLICES) {
+		crc ^= buffer[0] | (buffer[1] << 8);
+		crc = table[7][crc & 0xff] ^ table[6][crc >> 8] ^
+			table[5][buffer[2]] ^ table[4][buffer[3]] ^
+			table[3][buffer[4]] ^ table[2][buffer[5]] ^
+			table[1][buffer[6]] ^ table[0][buffer[7]];
+		buffer += CRC_SLICES;
+		len -= CRC_SLICES;
+	}
+	while (len--)
+		crc = table[0][(crc ^ *buffer++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+static uint16_t crc16_modbus_table[CRC_SLICES][256];
+static uint16_t crc16_mcrf4xx_table[CRC_SLICES][256];
+
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len)
 {
-	int i;
+	static gsize initialized;
 
 	if (!buffer || len < 0)
 		return crc;
 
-	while (len--) {
-		crc ^= *buffer++;
-		for (i = 0; i < 8; i++) {
-			int carry = crc & 1;
-			crc >>= 1;
-			if (carry)
-				crc ^= 0xA001;
+	if (g_once_init_enter(&initialized)) {
+		crc16_table_build(crc16_modbus_table, 0xA001);
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return crc16_update(crc16_modbus_table, crc, buffer, len);
+}
+
+SR_PRIV uint16_t sr_crc16_mcrf4xx(uint16_t crc, const uint8_t *buffer, size_t len)
+{
+	static gsize initialized;
+
+	if (!buffer)
+		return crc;
+
+	if (g_once_init_enter(&initialized)) {
+		crc16_table_build(crc16_mcrf4xx_table, 0x8408);
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return crc16_update(crc16_mcrf4xx_table, crc, buffer, len);
+}
+
+#ifndef HAVE_ZLIB
+static uint32_t crc32_table[CRC_SLICES][256];
+
+static void crc32_table_init(void)
+{
+	static gsize initialized;
+	uint32_t crc;
+	int i, j;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+		crc32_table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++) {
+		for (j = 1; j < CRC_SLICES; j++) {
+			crc = crc32_table[j - 1][i];
+			crc32_table[j][i] = (crc >> 8) ^ crc32_table[0][crc & 0xff];
 		}
 	}
+	g_once_init_leave(&initialized, 1);
+}
+#endif
+
+SR_PRIV uint32_t sr_crc32(uint32_t crc, const uint8_t *buffer, size_t len)
+{
+#ifdef HAVE_ZLIB
+	size_t chunk;
+#endif
+
+	if (!buffer)
+		return crc;
 
+#ifdef HAVE_ZLIB
+	while (len) {
+		chunk = MIN(len, (size_t)G_MAXUINT32);
+		crc = crc32(crc, buffer, chunk);
+		buffer += chunk;
+		len -= chunk;
+	}
 	return crc;
+#else
+	crc32_table_init();
+	crc = ~crc;
+	while (len >= CRC_SLICES) {
+		crc ^= RL32(buffer);
+		crc = crc32_table[7][crc & 0xff] ^
+			crc32_table[6][(crc >> 8) & 0xff] ^
+			crc32_table[5][(crc >> 16) & 0xff] ^
+			crc32_table[4][crc >> 24] ^
+			crc32_table[3][buffer[4]] ^ crc32_table[2][buffer[5]] ^
+			crc32_table[1][buffer[6]] ^ crc32_table[0][buffer[7]];
+		buffer += CRC_SLICES;
+		len -= CRC_SLICES;
+	}
+	while (len--)
+		crc = crc32_table[0][(crc ^ *buffer++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+#endif
 }
@@ -0,0 +1,185 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bookkeeping for the download of a logging instrument's memory. The
+ * device's log holds a known number of records (samples, or bytes for
+ * streamed downloads). Drivers request blocks of at most a maximum size,
+ * keep several requests in flight where the protocol permits, and
+ * resume from the last completely received offset after a timeout.
+ *
+ * The helper does no I/O. Drivers ask for the next request to issue,
+ * report completed blocks, and send each block as one multi-sample
+ * analog packet.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "datalog"
+/** @endcond */
+
+/**
+ * Prepare the download of a device's log.
+ *
+ * @param[out] log The download state.
+ * @param[in] total The number of records in the log.
+ * @param[in] block_size The maximum number of records per request.
+ *     Zero when the device decides on the size of its responses.
+ * @param[in] depth The number of requests which may be in flight.
+ *     Protocols where devices can return short blocks for addressed
+ *     requests must use a depth of 1.
+ *
+ * @private
+ */
+SR_PRIV void sr_datalog_init(struct sr_datalog *log, uint64_t total,
+	size_t block_size, size_t depth)
+{
+	memset(log, 0, sizeof(*log));
+	log->total = total;
+	log->block_size = block_size;
+	log->depth = depth ? depth : 1;
+	log->timeout_us = SR_DATALOG_TIMEOUT_US;
+	log->max_retries = SR_DATALOG_RETRIES;
+	log->last_activity = g_get_monotonic_time();
+}
+
+/**
+ * Get the next request to issue, if any.
+ *
+ * @param[in] log The download state.
+ * @param[out] offset The first record to request.
+ * @param[out] count The number of records to request. Zero when the
+ *     device decides on the size of the response.
+ *
+ * @retval TRUE When the caller should issue the request.
+ * @retval FALSE When all records were requested or the window is full.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_datalog_next_request(struct sr_datalog *log,
+	uint64_t *offset, size_t *count)
+{
+	uint64_t remain;
+
+	if (log->in_flight >= log->depth)
+		return FALSE;
+	if (log->requested >= log->total)
+		return FALSE;
+
+	remain = log->total - log->requested;
+	*offset = log->requested;
+	if (log->block_size) {
+		*count = MIN(remain, log->block_size);
+		log->requested += *count;
+	} else {
+		*count = 0;
+		log->requested = log->total;
+	}
+	if (!log->in_flight)
+		log->last_activity = g_get_monotonic_time();
+	log->in_flight++;
+
+	return TRUE;
+}
+
+/**
+ * Account for a completely received block.
+ *
+ * Blocks are expected in the order of their requests. When no request
+ * remains in flight, the next request continues right after the
+ * received records, which copes with devices sending short blocks.
+ *
+ * @param[in] log The download state.
+ * @param[in] count The number of records in the block.
+ *
+ * @private
+ */
+SR_PRIV void sr_datalog_block_done(struct sr_datalog *log, size_t count)
+{
+	log->received += count;
+	if (log->received > log->total)
+		log->received = log->total;
+	if (log->in_flight)
+		log->in_flight--;
+	if (!log->in_flight)
+		log->requested = log->received;
+	log->retries = 0;
+	log->last_activity = g_get_monotonic_time();
+}
+
+/**
+ * Rewind to the last completely received record.
+ *
+ * Outstanding requests are considered lost. The next request resumes
+ * from the offset of the first missing record.
+ *
+ * @param[in] log The download state.
+ *
+ * @retval SR_OK The download can resume.
+ * @retval SR_ERR_TIMEOUT The number of retries was exceeded.
+ *
+ * @private
+ */
+SR_PRIV int sr_datalog_resume(struct sr_datalog *log)
+{
+	if (log->retries >= log->max_retries)
+		return SR_ERR_TIMEOUT;
+	log->retries++;
+	sr_dbg("Resuming download at record %" PRIu64 " of %" PRIu64
+		" (retry %zu).", log->received, log->total, log->retries);
+	log->requested = log->received;
+	log->in_flight = 0;
+	log->last_activity = g_get_monotonic_time();
+
+	return SR_OK;
+}
+
+/**
+ * Check whether outstanding requests timed out.
+ *
+ * @param[in] log The download state.
+ *
+ * @retval TRUE Requests are outstanding and no response was seen for
+ *     longer than the timeout. Callers should resume the download.
+ * @retval FALSE Otherwise.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_datalog_timed_out(const struct sr_datalog *log)
+{
+	if (!log->in_flight || !log->timeout_us)
+		return FALSE;
+
+	return g_get_monotonic_time() - log->last_activity > log->timeout_us;
+}
+
+/**
+ * Check whether all records of the log were received.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_datalog_done(const struct sr_datalog *log)
+{
+	return log->received >= log->total;
+}
@@ -71,6 +71,7 @@ SR_PRIV struct sr_channel *sr_channel_new(struct sr_dev_inst *sdi,
 		ch->name = g_strdup(name);
 
 	sdi->channels = g_slist_append(sdi->channels, ch);
+	sr_dev_channel_layout_invalidate(sdi);
 
 	return ch;
 }
@@ -153,6 +154,7 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
 	sdi = channel->sdi;
 	was_enabled = channel->enabled;
 	channel->enabled = state;
+	sr_dev_channel_layout_invalidate(sdi);
 	if (!state != !was_enabled && sdi->driver
 			&& sdi->driver->config_channel_set) {
 		ret = sdi->driver->config_channel_set(
@@ -165,6 +167,102 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
 	return SR_OK;
 }
 
+static void channel_layout_free(struct sr_channel_layout *layout)
+{
+	if (!layout)
+		return;
+	g_free(layout->enabled);
+	g_free(layout->logic);
+	g_free(layout->logic_index);
+	g_free(layout->logic_byte);
+	g_free(layout->logic_bit);
+	g_free(layout->analog);
+	g_free(layout);
+}
+
+/**
+ * Get the layout of a device's enabled channels.
+ *
+ * The layout gets built on first use and is kept until the channels
+ * change, so that code which handles samples needn't walk the channel
+ * list, nor compute byte offsets and bit masks from channel indices.
+ * Code which changes sr_channel::enabled directly instead of using
+ * sr_dev_channel_enable() must call sr_dev_channel_layout_invalidate().
+ * sr_session_start() refreshes the layout of all devices.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ *
+ * @return The layout, owned by the device instance. It is valid until
+ *         the channels change.
+ *
+ * @private
+ */
+SR_PRIV const struct sr_channel_layout *sr_dev_channel_layout(
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *dev;
+	struct sr_channel_layout *layout;
+	struct sr_channel *ch;
+	GSList *l;
+	size_t num_channels, byte;
+
+	/* The layout is a cache, building it doesn't change the device. */
+	dev = (struct sr_dev_inst *)sdi;
+	if (dev->channel_layout)
+		return dev->channel_layout;
+
+	num_channels = g_slist_length(dev->channels);
+	layout = g_malloc0(sizeof(*layout));
+	layout->enabled = g_malloc0_n(num_channels + 1, sizeof(ch));
+	layout->logic = g_malloc0_n(num_channels + 1, sizeof(ch));
+	layout->logic_index = g_malloc0_n(num_channels + 1, sizeof(int));
+	layout->logic_byte = g_malloc0_n(num_channels + 1, sizeof(size_t));
+	layout->logic_bit = g_malloc0_n(num_channels + 1, sizeof(uint8_t));
+	layout->analog = g_malloc0_n(num_channels + 1, sizeof(ch));
+
+	for (l = dev->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			byte = ch->index / 8 + 1;
+			layout->logic_unitsize = MAX(layout->logic_unitsize, byte);
+		}
+		if (!ch->enabled)
+			continue;
+		layout->enabled[layout->num_enabled++] = ch;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			layout->logic[layout->num_logic] = ch;
+			layout->logic_index[layout->num_logic] = ch->index;
+			layout->logic_byte[layout->num_logic] = ch->index / 8;
+			layout->logic_bit[layout->num_logic] = 1 << (ch->index % 8);
+			layout->num_logic++;
+			if (ch->index < 64)
+				layout->logic_mask |= UINT64_C(1) << ch->index;
+		} else if (ch->type == SR_CHANNEL_ANALOG) {
+			layout->analog[layout->num_analog++] = ch;
+		}
+	}
+	dev->channel_layout = layout;
+
+	return layout;
+}
+
+/**
+ * Discard the cached layout of a device's enabled channels.
+ *
+ * @param[in] sdi The device instance. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_channel_layout_invalidate(const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *dev;
+
+	dev = (struct sr_dev_inst *)sdi;
+	channel_layout_free(dev->channel_layout);
+	dev->channel_layout = NULL;
+	dev->armed = FALSE;
+}
+
 /**
  * Returns the next enabled channel, wrapping around if necessary.
  *
@@ -441,7 +539,7 @@ SR_API int sr_dev_config_capabilities_list(const struct sr_dev_inst *sdi,
 	devopts = g_variant_get_fixed_array(gvar, &num_opts, sizeof(int32_t));
 	for (i = 0; i < num_opts; i++) {
 		if ((devopts[i] & SR_CONF_MASK) == key) {
-			ret = devopts[i] & ~SR_CONF_MASK;
+			ret = devopts[i] & (SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST);
 			break;
 		}
 	}
@@ -518,6 +616,10 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	}
 	g_slist_free(sdi->channels);
 	g_slist_free_full(sdi->channel_groups, sr_channel_group_free_cb);
+	channel_layout_free(sdi->channel_layout);
+	if (sdi->config_cache)
+		g_hash_table_destroy(sdi->config_cache);
+	sr_config_transaction_clear(sdi);
 
 	if (sdi->session)
 		sr_session_dev_remove(sdi->session, sdi);
@@ -566,6 +668,7 @@ SR_PRIV struct sr_usb_dev_inst *sr_usb_dev_inst_new(uint8_t bus,
  */
 SR_PRIV void sr_usb_dev_inst_free(struct sr_usb_dev_inst *usb)
 {
+	sr_usb_transfer_pool_free(usb);
 	g_free(usb);
 }
 
@@ -725,6 +828,7 @@ SR_API int sr_dev_clear(const struct sr_dev_driver *driver)
  */
 SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 {
+	struct sr_profile_scope scope;
 	int ret;
 
 	if (!sdi || !sdi->driver || !sdi->driver->dev_open)
@@ -738,7 +842,11 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Opening device instance.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi, TRUE);
+	sdi->armed = FALSE;
+	sr_profile_begin(&scope, NULL, SR_PROFILE_OPEN, NULL, sdi);
 	ret = sdi->driver->dev_open(sdi);
+	sr_profile_end(&scope, ret);
 
 	if (ret == SR_OK)
 		sdi->status = SR_ST_ACTIVE;
@@ -746,6 +854,150 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 	return ret;
 }
 
+/** @cond PRIVATE */
+/* Default number of concurrent opens for sr_dev_open_all(). */
+#define OPEN_ALL_THREADS 8
+/** @endcond */
+
+/* Devices which get opened one after another. */
+struct open_group {
+	GSList *devices;
+	GAsyncQueue *results;
+};
+
+struct open_result {
+	struct sr_dev_inst *sdi;
+	int ret;
+};
+
+static void open_group_run(gpointer data, gpointer user_data)
+{
+	struct open_group *group;
+	struct open_result *result;
+	GSList *l;
+
+	(void)user_data;
+
+	group = data;
+	for (l = group->devices; l; l = l->next) {
+		result = g_malloc0(sizeof(*result));
+		result->sdi = l->data;
+		result->ret = sr_dev_open(result->sdi);
+		g_async_queue_push(group->results, result);
+	}
+	/* An empty result marks the end of the group. */
+	g_async_queue_push(group->results, g_malloc0(sizeof(*result)));
+}
+
+/**
+ * Open several device instances, several of them at a time.
+ *
+ * Opens run on a pool of worker threads, so the firmware uploads and
+ * the waits for USB devices to renumerate overlap. USB devices get
+ * opened concurrently. Other devices of the same driver may share a
+ * port or bus, they get opened one after another.
+ *
+ * @a cb runs in the calling thread for every device, as soon as it was
+ * opened (or failed to open), with the result of sr_dev_open(). This
+ * routine returns when all devices were handled. Devices which failed
+ * to open are left closed, the others are open.
+ *
+ * @param devices A list of 'struct sr_dev_inst *'. Can be NULL.
+ * @param max_threads Maximum number of concurrent opens, 0 for a default.
+ * @param cb Function to call with the result of each open. Can be NULL.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @retval SR_OK All devices were opened.
+ * @retval SR_ERR Cannot start the worker threads.
+ * @retval other The first error of one of the devices.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_open_all(GSList *devices, unsigned int max_threads,
+		sr_dev_open_callback cb, void *cb_data)
+{
+	GHashTable *driver_groups;
+	GSList *groups, *l;
+	GAsyncQueue *results;
+	GThreadPool *pool;
+	GError *error;
+	struct sr_dev_inst *sdi;
+	struct open_group *group;
+	struct open_result *result;
+	guint pending;
+	int ret;
+
+	if (!max_threads)
+		max_threads = OPEN_ALL_THREADS;
+
+	/* Arrange the devices in groups which must not open concurrently. */
+	results = g_async_queue_new();
+	driver_groups = g_hash_table_new(g_direct_hash, g_direct_equal);
+	groups = NULL;
+	for (l = devices; l; l = l->next) {
+		if (!(sdi = l->data))
+			continue;
+		group = NULL;
+		if (sdi->inst_type != SR_INST_USB)
+			group = g_hash_table_lookup(driver_groups, sdi->driver);
+		if (!group) {
+			group = g_malloc0(sizeof(*group));
+			group->results = results;
+			groups = g_slist_append(groups, group);
+			if (sdi->inst_type != SR_INST_USB)
+				g_hash_table_insert(driver_groups,
+					sdi->driver, group);
+		}
+		group->devices = g_slist_append(group->devices, sdi);
+	}
+	g_hash_table_destroy(driver_groups);
+
+	error = NULL;
+	pool = g_thread_pool_new(open_group_run, NULL, max_threads, FALSE,
+		&error);
+	if (!pool) {
+		sr_err("Cannot create open threads: %s.", error->message);
+		g_error_free(error);
+		for (l = groups; l; l = l->next) {
+			group = l->data;
+			g_slist_free(group->devices);
+		}
+		g_slist_free_full(groups, g_free);
+		g_async_queue_unref(results);
+		return SR_ERR;
+	}
+	pending = 0;
+	for (l = groups; l; l = l->next) {
+		g_thread_pool_push(pool, l->data, NULL);
+		pending++;
+	}
+
+	/* Report the results as they come in. */
+	ret = SR_OK;
+	while (pending) {
+		result = g_async_queue_pop(results);
+		if (!result->sdi) {
+			pending--;
+		} else {
+			if (ret == SR_OK)
+				ret = result->ret;
+			if (cb)
+				cb(result->sdi, result->ret, cb_data);
+		}
+		g_free(result);
+	}
+
+	g_thread_pool_free(pool, FALSE, TRUE);
+	for (l = groups; l; l = l->next) {
+		group = l->data;
+		g_slist_free(group->devices);
+	}
+	g_slist_free_full(groups, g_free);
+	g_async_queue_unref(results);
+
+	return ret;
+}
+
 /**
  * Close the specified device instance.
  *
@@ -780,6 +1032,10 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi, TRUE);
+	sr_config_transaction_clear(sdi);
+	sdi->armed = FALSE;
+
 	return sdi->driver->dev_close(sdi);
 }
 
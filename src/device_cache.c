@@ -0,0 +1,332 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Identity and calibration data which drivers read from devices.
+ *
+ * Drivers read EEPROM content, register layouts or calibration tables
+ * every time a device gets opened, often with many slow control
+ * transfers. They keep what they read in the context's device cache
+ * instead, and take it from there when the device gets opened again.
+ * Entries belong to a device (its serial number, else its connection
+ * ID) and carry the version of the firmware which they were read with.
+ * Entries of another firmware version don't get used, and get replaced.
+ * The cache is kept in memory, and optionally in a file, see
+ * sr_dev_cache_dir_set().
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "device-cache"
+/** @endcond */
+
+#define CACHE_FILE_NAME "device-cache.ini"
+#define VERSION_SUFFIX ".version"
+
+/* The group of a device's entries, NULL if the device lacks an identity. */
+static char *cache_group(const struct sr_dev_inst *sdi)
+{
+	const char *id;
+
+	id = sdi->serial_num && *sdi->serial_num ?
+		sdi->serial_num : sdi->connection_id;
+	if (!sdi->driver || !id || !*id)
+		return NULL;
+
+	return g_strdup_printf("%s/%s", sdi->driver->name, id);
+}
+
+static struct sr_context *cache_ctx(const struct sr_dev_inst *sdi)
+{
+	struct drv_context *drvc;
+
+	if (!sdi->driver || !sdi->driver->context)
+		return NULL;
+	drvc = sdi->driver->context;
+
+	return drvc->sr_ctx;
+}
+
+/* Write the cache to its file. Call with the cache mutex held. */
+static void cache_save(struct sr_context *ctx)
+{
+	GError *error;
+	char *data;
+	gsize len;
+
+	if (!ctx->dev_cache_file)
+		return;
+
+	data = g_key_file_to_data(ctx->dev_cache, &len, NULL);
+	error = NULL;
+	if (!g_file_set_contents(ctx->dev_cache_file, data, len, &error)) {
+		sr_warn("Cannot write '%s': %s.", ctx->dev_cache_file,
+			error->message);
+		g_error_free(error);
+	}
+	g_free(data);
+}
+
+/**
+ * Keep the device cache in a file.
+ *
+ * The cache file in @a dir gets loaded, and stays up to date with the
+ * entries which drivers add. Entries of devices in the file are used
+ * the first time these devices get opened already.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param dir The directory of the cache file, or NULL to keep the cache
+ *            in memory only.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid context passed.
+ * @retval SR_ERR_IO The directory cannot be created.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_cache_dir_set(struct sr_context *ctx, const char *dir)
+{
+	GKeyFile *loaded;
+	GError *error;
+	char *file, **groups, **keys, *value;
+	size_t i, j;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	if (dir && g_mkdir_with_parents(dir, 0755) != 0) {
+		sr_err("Cannot create cache directory '%s'.", dir);
+		return SR_ERR_IO;
+	}
+	file = dir ? g_build_filename(dir, CACHE_FILE_NAME, NULL) : NULL;
+
+	g_mutex_lock(&ctx->dev_cache_mutex);
+	g_free(ctx->dev_cache_file);
+	ctx->dev_cache_file = file;
+	if (!ctx->dev_cache)
+		ctx->dev_cache = g_key_file_new();
+	loaded = g_key_file_new();
+	error = NULL;
+	if (file && g_key_file_load_from_file(loaded, file,
+			G_KEY_FILE_NONE, &error)) {
+		/* Entries in memory are newer than those in the file. */
+		groups = g_key_file_get_groups(loaded, NULL);
+		for (i = 0; groups[i]; i++) {
+			keys = g_key_file_get_keys(loaded, groups[i], NULL, NULL);
+			for (j = 0; keys && keys[j]; j++) {
+				if (g_key_file_has_key(ctx->dev_cache,
+						groups[i], keys[j], NULL))
+					continue;
+				value = g_key_file_get_value(loaded, groups[i],
+					keys[j], NULL);
+				g_key_file_set_value(ctx->dev_cache, groups[i],
+					keys[j], value);
+				g_free(value);
+			}
+			g_strfreev(keys);
+		}
+		g_strfreev(groups);
+		sr_dbg("Loaded device cache '%s'.", file);
+	} else if (error) {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			sr_warn("Cannot load '%s': %s.", file, error->message);
+		g_error_free(error);
+	}
+	g_key_file_free(loaded);
+	cache_save(ctx);
+	g_mutex_unlock(&ctx->dev_cache_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Drop all entries of the device cache, including those in its file.
+ *
+ * Frontends do this when devices got reprogrammed or recalibrated in
+ * ways which drivers cannot tell.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid context passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->dev_cache_mutex);
+	if (ctx->dev_cache) {
+		g_key_file_free(ctx->dev_cache);
+		ctx->dev_cache = g_key_file_new();
+		cache_save(ctx);
+	}
+	g_mutex_unlock(&ctx->dev_cache_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Look up data of a device in the device cache.
+ *
+ * @param sdi The device instance.
+ * @param item The name of the data, e.g. "eeprom".
+ * @param version The version of the firmware or the bitstream which the
+ *                data depends on, or NULL.
+ * @param data Where to put the data.
+ * @param len The length of the data in bytes.
+ *
+ * @retval SR_OK The data was found, with the given length and version.
+ * @retval SR_ERR_NA The cache lacks the data.
+ *
+ * @private
+ */
+SR_PRIV int sr_dev_cache_get(const struct sr_dev_inst *sdi,
+		const char *item, const char *version, void *data, size_t len)
+{
+	struct sr_context *ctx;
+	char *group, *vkey, *cached_version, *value;
+	guchar *raw;
+	gsize raw_len;
+	int ret;
+
+	if (!(ctx = cache_ctx(sdi)) || !(group = cache_group(sdi)))
+		return SR_ERR_NA;
+
+	ret = SR_ERR_NA;
+	vkey = g_strconcat(item, VERSION_SUFFIX, NULL);
+	g_mutex_lock(&ctx->dev_cache_mutex);
+	value = NULL;
+	cached_version = NULL;
+	if (ctx->dev_cache) {
+		value = g_key_file_get_string(ctx->dev_cache, group, item, NULL);
+		cached_version = g_key_file_get_string(ctx->dev_cache,
+			group, vkey, NULL);
+	}
+	g_mutex_unlock(&ctx->dev_cache_mutex);
+
+	if (value && g_strcmp0(cached_version, version ? version : "") == 0) {
+		raw = g_base64_decode(value, &raw_len);
+		if (raw_len == len) {
+			memcpy(data, raw, len);
+			sr_dbg("Using cached %s of %s.", item, group);
+			ret = SR_OK;
+		}
+		g_free(raw);
+	} else if (value) {
+		sr_dbg("Cached %s of %s is for firmware '%s'.", item, group,
+			cached_version ? cached_version : "");
+	}
+	g_free(value);
+	g_free(cached_version);
+	g_free(vkey);
+	g_free(group);
+
+	return ret;
+}
+
+/**
+ * Put data of a device into the device cache.
+ *
+ * Replaces what the cache has of this data, also of other versions.
+ *
+ * @param sdi The device instance.
+ * @param item The name of the data, e.g. "eeprom".
+ * @param version The version of the firmware or the bitstream which the
+ *                data depends on, or NULL.
+ * @param data The data.
+ * @param len The length of the data in bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_cache_put(const struct sr_dev_inst *sdi,
+		const char *item, const char *version,
+		const void *data, size_t len)
+{
+	struct sr_context *ctx;
+	char *group, *vkey, *value;
+
+	if (!(ctx = cache_ctx(sdi)) || !(group = cache_group(sdi)))
+		return;
+
+	vkey = g_strconcat(item, VERSION_SUFFIX, NULL);
+	value = g_base64_encode(data, len);
+	g_mutex_lock(&ctx->dev_cache_mutex);
+	if (!ctx->dev_cache)
+		ctx->dev_cache = g_key_file_new();
+	g_key_file_set_string(ctx->dev_cache, group, item, value);
+	g_key_file_set_string(ctx->dev_cache, group, vkey,
+		version ? version : "");
+	cache_save(ctx);
+	g_mutex_unlock(&ctx->dev_cache_mutex);
+	g_free(value);
+	g_free(vkey);
+	g_free(group);
+}
+
+/**
+ * Drop the entries of a device from the device cache.
+ *
+ * Drivers do this when the device does not match the data which they
+ * took from the cache.
+ *
+ * @param sdi The device instance.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_cache_invalidate(const struct sr_dev_inst *sdi)
+{
+	struct sr_context *ctx;
+	char *group;
+
+	if (!(ctx = cache_ctx(sdi)) || !(group = cache_group(sdi)))
+		return;
+
+	g_mutex_lock(&ctx->dev_cache_mutex);
+	if (ctx->dev_cache &&
+			g_key_file_remove_group(ctx->dev_cache, group, NULL))
+		cache_save(ctx);
+	g_mutex_unlock(&ctx->dev_cache_mutex);
+	g_free(group);
+}
+
+/**
+ * Release the device cache of a context.
+ *
+ * @param ctx The context to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_cache_free(struct sr_context *ctx)
+{
+	if (ctx->dev_cache)
+		g_key_file_free(ctx->dev_cache);
+	ctx->dev_cache = NULL;
+	g_free(ctx->dev_cache_file);
+	ctx->dev_cache_file = NULL;
+}
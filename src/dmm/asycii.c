@@ -469,6 +469,13 @@ SR_PRIV int sr_asycii_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+static const uint8_t sync_trailer[] = "\r";
+
+SR_PRIV const struct sr_packet_sync asycii_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 /**
  * Check whether a received frame is valid.
  *
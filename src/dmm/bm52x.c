@@ -168,6 +168,9 @@ SR_PRIV int sr_brymen_bm82x_packet_request(struct sr_serial_dev_inst *serial)
  * and is handled in other code paths.
  */
 
+/* No fixed bytes to synchronize to, packets get checked at every offset. */
+SR_PRIV const struct sr_packet_sync brymen_bm52x_sync = { 0 };
+
 SR_PRIV gboolean sr_brymen_bm52x_packet_valid(const uint8_t *buf)
 {
 	if (buf[16] != 0x52)
@@ -161,6 +161,15 @@ SR_PRIV int brymen_bm85x_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+static const uint8_t sync_header[] = {
+	DLE, STX,
+};
+
+SR_PRIV const struct sr_packet_sync brymen_bm85x_sync = {
+	.header = sync_header,
+	.header_len = ARRAY_SIZE(sync_header),
+};
+
 /**
  * Check Brymen BM85x DMM packet for validity.
  *
@@ -47,6 +47,9 @@ SR_PRIV int sr_brymen_bm86x_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+/* No fixed bytes to synchronize to, packets get checked at every offset. */
+SR_PRIV const struct sr_packet_sync brymen_bm86x_sync = { 0 };
+
 SR_PRIV gboolean sr_brymen_bm86x_packet_valid(const uint8_t *buf)
 {
 	/*
@@ -633,6 +633,15 @@ static const struct mode_range_item *mode_range_get_scale(
 	return NULL;
 }
 
+static const uint8_t sync_header[] = {
+	VAL_START_CMD,
+};
+
+SR_PRIV const struct sr_packet_sync eev121gw_sync = {
+	.header = sync_header,
+	.header_len = ARRAY_SIZE(sync_header),
+};
+
 SR_PRIV gboolean sr_eev121gw_packet_valid(const uint8_t *buf)
 {
 	uint8_t csum;
@@ -622,6 +622,13 @@ static int sr_es519xx_parse(const uint8_t *buf, float *floatval,
 	return SR_OK;
 }
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync es519xx_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 /*
  * Functions for 2400 baud / 11 bytes protocols.
  * This includes ES51962, ES51971, ES51972, ES51978 and ES51989.
@@ -323,6 +323,22 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		sr_spew("User-defined LCD symbol 3 is active.");
 }
 
+static const uint8_t sync_header[] = {
+	0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80,
+	0x90, 0xa0, 0xb0, 0xc0, 0xd0, 0xe0,
+};
+
+static const uint8_t sync_header_mask[] = {
+	0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+	0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+};
+
+SR_PRIV const struct sr_packet_sync fs9721_sync = {
+	.header = sync_header,
+	.header_mask = sync_header_mask,
+	.header_len = ARRAY_SIZE(sync_header),
+};
+
 SR_PRIV gboolean sr_fs9721_packet_valid(const uint8_t *buf)
 {
 	struct fs9721_info info;
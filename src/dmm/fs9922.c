@@ -320,6 +320,13 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 
 }
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync fs9922_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_fs9922_packet_valid(const uint8_t *buf)
 {
 	struct fs9922_info info;
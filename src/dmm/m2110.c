@@ -34,6 +34,13 @@
 
 #define LOG_PREFIX "m2110"
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync m2110_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_m2110_packet_valid(const uint8_t *buf)
 {
 	float val;
@@ -347,6 +347,13 @@ SR_PRIV int sr_metex14_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+static const uint8_t sync_trailer[] = "\r";
+
+SR_PRIV const struct sr_packet_sync metex14_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_metex14_packet_valid(const uint8_t *buf)
 {
 	struct metex14_info info;
@@ -313,6 +313,13 @@ static int meterman_38xr_decode(const uint8_t *buf, struct meterman_info *mi)
 	return SR_OK;
 }
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync meterman_38xr_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean meterman_38xr_packet_valid(const uint8_t *buf)
 {
 	size_t i;
@@ -147,6 +147,15 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		analog->meaning->mqflags |= SR_MQFLAG_DIODE | SR_MQFLAG_DC;
 }
 
+static const uint8_t sync_header[] = {
+	0x55,
+};
+
+SR_PRIV const struct sr_packet_sync ms2115b_sync = {
+	.header = sync_header,
+	.header_len = ARRAY_SIZE(sync_header),
+};
+
 SR_PRIV gboolean sr_ms2115b_packet_valid(const uint8_t *buf)
 {
 	sr_dbg("DMM packet: %02x %02x %02x %02x %02x %02x %02x %02x %02x",
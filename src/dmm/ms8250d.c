@@ -259,6 +259,13 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		sr_spew("Beep is active");
 }
 
+static const uint8_t sync_trailer[] = "\0";
+
+SR_PRIV const struct sr_packet_sync ms8250d_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_ms8250d_packet_valid(const uint8_t *buf)
 {
 	struct ms8250d_info info;
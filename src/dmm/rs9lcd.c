@@ -191,6 +191,9 @@ static gboolean selection_good(const struct rs9lcd_packet *rs_packet)
 	return TRUE;
 }
 
+/* No fixed bytes to synchronize to, packets get checked at every offset. */
+SR_PRIV const struct sr_packet_sync rs9lcd_sync = { 0 };
+
 /*
  * Since the 22-812 does not identify itself in any way, shape, or form,
  * we really don't know for sure who is sending the data. We must use every
@@ -316,6 +316,13 @@ static gboolean flags_valid(const struct ut71x_info *info)
 	return TRUE;
 }
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync ut71x_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_ut71x_packet_valid(const uint8_t *buf)
 {
 	struct ut71x_info info;
@@ -229,6 +229,13 @@ static gboolean flags_valid(const struct vc96_info *info)
 	return TRUE;
 }
 
+static const uint8_t sync_trailer[] = "\r\n";
+
+SR_PRIV const struct sr_packet_sync vc96_sync = {
+	.trailer = sync_trailer,
+	.trailer_len = sizeof(sync_trailer) - 1,
+};
+
 SR_PRIV gboolean sr_vc96_packet_valid(const uint8_t *buf)
 {
 	struct vc96_info info;
@@ -27,7 +27,7 @@
  * after any actual drivers.
  */
 
-SR_PRIV const struct sr_dev_driver *sr_driver_list__stop[]
+SR_DRIVER_LIST_HIDDEN const struct sr_dev_driver *sr_driver_list__stop[]
 	SR_DRIVER_LIST_NOREORDER
 	__attribute__((section (SR_DRIVER_LIST_SECTION),
 		       used, aligned(sizeof(struct sr_dev_driver *))))
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/*
+ * This gets linked into every driver module, between the start and the
+ * end of the module's own driver list (see driver_list_start.c). The
+ * library looks the routine up after loading the module, see
+ * driver_modules.c.
+ */
+
+SR_DRIVER_LIST_HIDDEN extern const struct sr_dev_driver *sr_driver_list__start[];
+SR_DRIVER_LIST_HIDDEN extern const struct sr_dev_driver *sr_driver_list__stop[];
+
+SR_API const struct sr_dev_driver **sr_driver_module_list(size_t *count)
+{
+	*count = sr_driver_list__stop - (sr_driver_list__start + 1);
+
+	return sr_driver_list__start + 1;
+}
@@ -0,0 +1,416 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Hardware drivers which get loaded when they are used.
+ *
+ * Builds with --enable-driver-modules put every driver into a module of
+ * its own. The driver list holds a stand-in for each of the drivers in
+ * the modules, which know the driver's names only. The module gets
+ * loaded when one of its drivers gets initialized, and the stand-in
+ * passes all calls on to the actual driver then. Device instances refer
+ * to the actual driver (see sr_dev_inst_driver_get()), which has the
+ * same names as its stand-in.
+ *
+ * The module directory is DRIVER_MODULE_DIR, or the one which the
+ * SIGROK_DRIVER_DIR environment variable names. Finding out which
+ * drivers a module has takes loading it. The names get kept in an index
+ * in the user's cache directory, later processes load just the modules
+ * which they use. Loaded modules stay loaded.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "driver-modules"
+/** @endcond */
+
+/* The routine which lists a module's drivers, see driver_module_list.c. */
+#define MODULE_LIST_SYMBOL "sr_driver_module_list"
+#define INDEX_FILE_NAME "driver-modules.ini"
+
+typedef const struct sr_dev_driver **(*module_list_func)(size_t *count);
+
+struct driver_proxy {
+	/* Must be first, the driver list points to it. */
+	struct sr_dev_driver driver;
+	const char *module_path;
+	const struct sr_dev_driver *real;
+};
+
+static GMutex proxies_mutex;
+static GPtrArray *proxies;
+
+static struct driver_proxy *proxy_of(const struct sr_dev_driver *driver)
+{
+	return (struct driver_proxy *)driver;
+}
+
+/* Load a module, and get its drivers. */
+static const struct sr_dev_driver **module_open(const char *path,
+		size_t *count)
+{
+	GModule *module;
+	module_list_func list;
+
+	module = g_module_open(path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+	if (!module) {
+		sr_err("Cannot load driver module: %s.", g_module_error());
+		return NULL;
+	}
+	if (!g_module_symbol(module, MODULE_LIST_SYMBOL, (gpointer *)&list)) {
+		sr_err("'%s' is no driver module.", path);
+		g_module_close(module);
+		return NULL;
+	}
+	/* Drivers may have threads or callbacks which outlive their use. */
+	g_module_make_resident(module);
+	sr_dbg("Loaded driver module '%s'.", path);
+
+	return list(count);
+}
+
+/* Let a stand-in pass calls on to the actual driver. */
+static void proxy_bind(struct driver_proxy *proxy,
+		const struct sr_dev_driver *real)
+{
+	struct sr_dev_driver *driver;
+
+	driver = &proxy->driver;
+	driver->api_version = real->api_version;
+	driver->config_get = real->config_get;
+	driver->config_set = real->config_set;
+	driver->config_channel_set = real->config_channel_set;
+	driver->config_commit = real->config_commit;
+	driver->config_list = real->config_list;
+	driver->dev_open = real->dev_open;
+	driver->dev_close = real->dev_close;
+	driver->dev_acquisition_start = real->dev_acquisition_start;
+	driver->dev_acquisition_stop = real->dev_acquisition_stop;
+	proxy->real = real;
+}
+
+/* Bind the stand-ins of a module's drivers. Call with the mutex held. */
+static void module_bind(const char *path,
+		const struct sr_dev_driver **drivers, size_t count)
+{
+	struct driver_proxy *proxy;
+	size_t i, j;
+
+	for (i = 0; proxies && i < proxies->len; i++) {
+		proxy = g_ptr_array_index(proxies, i);
+		if (proxy->real || strcmp(proxy->module_path, path) != 0)
+			continue;
+		for (j = 0; j < count; j++) {
+			if (strcmp(drivers[j]->name, proxy->driver.name) == 0)
+				proxy_bind(proxy, drivers[j]);
+		}
+	}
+}
+
+static int proxy_load(struct driver_proxy *proxy)
+{
+	const struct sr_dev_driver **drivers;
+	size_t count;
+
+	g_mutex_lock(&proxies_mutex);
+	if (!proxy->real) {
+		drivers = module_open(proxy->module_path, &count);
+		if (drivers)
+			module_bind(proxy->module_path, drivers, count);
+	}
+	g_mutex_unlock(&proxies_mutex);
+
+	if (!proxy->real) {
+		sr_err("Driver '%s' is missing in module '%s'.",
+			proxy->driver.name, proxy->module_path);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int proxy_init(struct sr_dev_driver *driver, struct sr_context *sr_ctx)
+{
+	struct driver_proxy *proxy;
+	int ret;
+
+	proxy = proxy_of(driver);
+	if ((ret = proxy_load(proxy)) != SR_OK)
+		return ret;
+
+	ret = proxy->real->init((struct sr_dev_driver *)proxy->real, sr_ctx);
+	driver->context = proxy->real->context;
+
+	return ret;
+}
+
+static int proxy_cleanup(const struct sr_dev_driver *driver)
+{
+	struct driver_proxy *proxy;
+	int ret;
+
+	proxy = proxy_of(driver);
+	if (!proxy->real)
+		return SR_OK;
+
+	ret = proxy->real->cleanup(proxy->real);
+	proxy->driver.context = proxy->real->context;
+
+	return ret;
+}
+
+static GSList *proxy_scan(struct sr_dev_driver *driver, GSList *options)
+{
+	struct driver_proxy *proxy;
+
+	proxy = proxy_of(driver);
+	if (!proxy->real)
+		return NULL;
+
+	return proxy->real->scan((struct sr_dev_driver *)proxy->real, options);
+}
+
+static GSList *proxy_dev_list(const struct sr_dev_driver *driver)
+{
+	struct driver_proxy *proxy;
+
+	proxy = proxy_of(driver);
+	if (!proxy->real)
+		return NULL;
+
+	return proxy->real->dev_list(proxy->real);
+}
+
+static int proxy_dev_clear(const struct sr_dev_driver *driver)
+{
+	struct driver_proxy *proxy;
+
+	proxy = proxy_of(driver);
+	if (!proxy->real)
+		return SR_OK;
+
+	return proxy->real->dev_clear(proxy->real);
+}
+
+/*
+ * Stand-ins until the module got loaded. Devices and driver options
+ * take an initialized driver, see sr_driver_init().
+ */
+
+static int unloaded_config_set(uint32_t key, GVariant *data,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	(void)key;
+	(void)data;
+	(void)sdi;
+	(void)cg;
+
+	return SR_ERR_NA;
+}
+
+static int unloaded_config_list(uint32_t key, GVariant **data,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	(void)key;
+	(void)data;
+	(void)sdi;
+	(void)cg;
+
+	return SR_ERR_NA;
+}
+
+static int unloaded_dev_open(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_ERR_NA;
+}
+
+static int unloaded_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_ERR_NA;
+}
+
+static struct driver_proxy *proxy_new(const char *path, const char *name,
+		const char *longname)
+{
+	struct driver_proxy *proxy;
+	struct sr_dev_driver *driver;
+
+	proxy = g_malloc0(sizeof(*proxy));
+	proxy->module_path = path;
+	driver = &proxy->driver;
+	driver->name = g_strdup(name);
+	driver->longname = g_strdup(longname);
+	driver->api_version = 1;
+	driver->init = proxy_init;
+	driver->cleanup = proxy_cleanup;
+	driver->scan = proxy_scan;
+	driver->dev_list = proxy_dev_list;
+	driver->dev_clear = proxy_dev_clear;
+	driver->config_set = unloaded_config_set;
+	driver->config_list = unloaded_config_list;
+	driver->dev_open = unloaded_dev_open;
+	driver->dev_close = unloaded_dev_open;
+	driver->dev_acquisition_start = unloaded_acquisition_start;
+	driver->dev_acquisition_stop = unloaded_dev_open;
+	g_ptr_array_add(proxies, proxy);
+
+	return proxy;
+}
+
+/* Create the stand-ins of a module, from the index where it is current. */
+static gboolean module_add(GKeyFile *index, const char *path)
+{
+	const struct sr_dev_driver **drivers;
+	const char *group;
+	GStatBuf st;
+	char **names, **longnames;
+	gsize num_names, num_longnames, count, i;
+	gboolean current;
+
+	if (g_stat(path, &st) != 0)
+		return FALSE;
+	group = strrchr(path, G_DIR_SEPARATOR);
+	group = group ? group + 1 : path;
+
+	current = g_key_file_get_int64(index, group, "mtime", NULL) ==
+			(gint64)st.st_mtime &&
+		g_key_file_get_int64(index, group, "size", NULL) ==
+			(gint64)st.st_size;
+	names = g_key_file_get_string_list(index, group, "names",
+		&num_names, NULL);
+	longnames = g_key_file_get_string_list(index, group, "longnames",
+		&num_longnames, NULL);
+	if (current && names && longnames && num_names == num_longnames) {
+		for (i = 0; i < num_names; i++)
+			proxy_new(path, names[i], longnames[i]);
+		g_strfreev(names);
+		g_strfreev(longnames);
+		return FALSE;
+	}
+	g_strfreev(names);
+	g_strfreev(longnames);
+
+	/* Load modules which are new or changed, and update the index. */
+	if (!(drivers = module_open(path, &count)))
+		return FALSE;
+	names = g_malloc0_n(count + 1, sizeof(names[0]));
+	longnames = g_malloc0_n(count + 1, sizeof(longnames[0]));
+	for (i = 0; i < count; i++) {
+		names[i] = (char *)drivers[i]->name;
+		longnames[i] = (char *)drivers[i]->longname;
+		proxy_new(path, names[i], longnames[i]);
+	}
+	module_bind(path, drivers, count);
+	g_key_file_remove_group(index, group, NULL);
+	g_key_file_set_int64(index, group, "mtime", st.st_mtime);
+	g_key_file_set_int64(index, group, "size", st.st_size);
+	g_key_file_set_string_list(index, group, "names",
+		(const char * const *)names, count);
+	g_key_file_set_string_list(index, group, "longnames",
+		(const char * const *)longnames, count);
+	g_free(names);
+	g_free(longnames);
+
+	return TRUE;
+}
+
+static void modules_discover(void)
+{
+	GKeyFile *index;
+	GDir *dir;
+	const char *dir_name, *entry;
+	char *index_dir, *index_file, *path, *data;
+	gsize len;
+	gboolean changed;
+
+	proxies = g_ptr_array_new();
+	if (!g_module_supported())
+		return;
+	dir_name = g_getenv("SIGROK_DRIVER_DIR");
+	if (!dir_name)
+		dir_name = DRIVER_MODULE_DIR;
+	if (!(dir = g_dir_open(dir_name, 0, NULL))) {
+		sr_warn("Cannot open driver module directory '%s'.", dir_name);
+		return;
+	}
+
+	index_dir = g_build_filename(g_get_user_cache_dir(), "libsigrok", NULL);
+	index_file = g_build_filename(index_dir, INDEX_FILE_NAME, NULL);
+	index = g_key_file_new();
+	g_key_file_load_from_file(index, index_file, G_KEY_FILE_NONE, NULL);
+
+	changed = FALSE;
+	while ((entry = g_dir_read_name(dir))) {
+		if (!g_str_has_suffix(entry, "." G_MODULE_SUFFIX))
+			continue;
+		/* Stand-ins refer to the path for all of the process' life. */
+		path = g_build_filename(dir_name, entry, NULL);
+		if (module_add(index, path))
+			changed = TRUE;
+	}
+	g_dir_close(dir);
+	sr_dbg("Found %u driver(s) in '%s'.", proxies->len, dir_name);
+
+	if (changed && g_mkdir_with_parents(index_dir, 0755) == 0) {
+		data = g_key_file_to_data(index, &len, NULL);
+		if (!g_file_set_contents(index_file, data, len, NULL))
+			sr_dbg("Cannot write '%s'.", index_file);
+		g_free(data);
+	}
+	g_key_file_free(index);
+	g_free(index_file);
+	g_free(index_dir);
+}
+
+/**
+ * Add the drivers of the driver modules to a driver list.
+ *
+ * The modules get looked for once per process.
+ *
+ * @param array The driver list, a GArray of 'struct sr_dev_driver *'.
+ *
+ * @private
+ */
+SR_PRIV void sr_driver_modules_append(GArray *array)
+{
+	struct sr_dev_driver *driver;
+	unsigned int i;
+
+	g_mutex_lock(&proxies_mutex);
+	if (!proxies)
+		modules_discover();
+	for (i = 0; i < proxies->len; i++) {
+		driver = g_ptr_array_index(proxies, i);
+		g_array_append_val(array, driver);
+	}
+	g_mutex_unlock(&proxies_mutex);
+}
@@ -32,8 +32,8 @@
  * section. They are used to iterate over the list of all drivers which were
  * included in the library.
  */
-SR_PRIV extern const struct sr_dev_driver *sr_driver_list__start[];
-SR_PRIV extern const struct sr_dev_driver *sr_driver_list__stop[];
+SR_DRIVER_LIST_HIDDEN extern const struct sr_dev_driver *sr_driver_list__start[];
+SR_DRIVER_LIST_HIDDEN extern const struct sr_dev_driver *sr_driver_list__stop[];
 
 /**
  * Initialize the driver list in a fresh libsigrok context.
@@ -51,6 +51,9 @@ SR_API void sr_drivers_init(struct sr_context *ctx)
 	for (const struct sr_dev_driver **drivers = sr_driver_list__start + 1;
 	     drivers < sr_driver_list__stop; drivers++)
 		g_array_append_val(array, *drivers);
+#endif
+#ifdef HAVE_DRIVER_MODULES
+	sr_driver_modules_append(array);
 #endif
 	ctx->driver_list = (struct sr_dev_driver **)array->data;
 	g_array_free(array, FALSE);
@@ -95,8 +95,8 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 	return result;
 }
 
-SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
-				  int configuration, const char *name)
+static int upload_firmware(struct sr_context *ctx, libusb_device *dev,
+		int configuration, const char *name)
 {
 	struct libusb_device_handle *hdl;
 	int ret;
@@ -142,3 +142,16 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 
 	return SR_OK;
 }
+
+SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
+				  int configuration, const char *name)
+{
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, ctx, SR_PROFILE_FIRMWARE_UPLOAD, NULL, NULL);
+	ret = upload_firmware(ctx, dev, configuration, name);
+	sr_profile_end(&scope, ret);
+
+	return ret;
+}
@@ -0,0 +1,287 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming reception from FTDI chips, with several bulk IN transfers
+ * in flight. The libftdi ftdi_read_data_submit() routine cannot be used
+ * for this, all its requests share the context's single read buffer.
+ * So transfers are submitted on the FTDI context's libusb handle, and
+ * the modem status bytes which start every USB packet get stripped
+ * here, like ftdi_read_data() does.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "ftdi-stream"
+
+#ifdef HAVE_LIBFTDI
+
+/* Length of the modem status at the start of every USB packet. */
+#define FTDI_STATUS_LEN 2
+
+/** @cond PRIVATE */
+struct sr_ftdi_stream {
+	struct ftdi_context *ftdic;
+	sr_ftdi_stream_callback cb;
+	void *cb_data;
+	size_t transfer_size;
+	size_t num_transfers;
+	struct libusb_transfer **transfers;
+	size_t in_flight;
+	gboolean stopping;
+	int result;
+};
+/** @endcond */
+
+static void LIBUSB_CALL stream_transfer_done(struct libusb_transfer *transfer)
+{
+	struct sr_ftdi_stream *stream;
+	unsigned char *data;
+	size_t left, packet_size, chunk;
+	int ret;
+
+	stream = transfer->user_data;
+
+	if (!stream->stopping && transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+	    transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		sr_err("FTDI bulk read failed: %s.",
+			libusb_error_name(transfer->status));
+		stream->result = SR_ERR_IO;
+		stream->stopping = TRUE;
+	}
+
+	/* Strip the status bytes, pass the payload of each USB packet. */
+	data = transfer->buffer;
+	left = transfer->actual_length;
+	packet_size = stream->ftdic->max_packet_size;
+	while (!stream->stopping && left > FTDI_STATUS_LEN) {
+		chunk = MIN(left, packet_size);
+		ret = stream->cb(stream->cb_data, data + FTDI_STATUS_LEN,
+			chunk - FTDI_STATUS_LEN);
+		if (ret != SR_OK) {
+			if (ret != SR_ERR_NA)
+				stream->result = ret;
+			stream->stopping = TRUE;
+		}
+		data += chunk;
+		left -= chunk;
+	}
+
+	if (!stream->stopping) {
+		ret = libusb_submit_transfer(transfer);
+		if (ret == 0)
+			return;
+		sr_err("Failed to resubmit FTDI bulk read: %s.",
+			libusb_error_name(ret));
+		stream->result = SR_ERR_IO;
+		stream->stopping = TRUE;
+	}
+
+	stream->in_flight--;
+}
+
+/**
+ * Create a stream reader for an open FTDI device.
+ *
+ * @param ftdic The libftdi context of the device, must be open.
+ * @param num_transfers The number of bulk transfers kept in flight.
+ * @param transfer_size The size of each transfer in bytes, gets rounded
+ *                      up to a multiple of the USB packet size.
+ * @param cb The routine which receives the payload of each USB packet.
+ *           Returning SR_ERR_NA ends the stream regularly, other values
+ *           except SR_OK end it with an error.
+ * @param cb_data Caller data for the callback.
+ *
+ * @return The stream reader, or NULL upon invalid arguments.
+ *
+ * @private
+ */
+SR_PRIV struct sr_ftdi_stream *sr_ftdi_stream_new(struct ftdi_context *ftdic,
+		size_t num_transfers, size_t transfer_size,
+		sr_ftdi_stream_callback cb, void *cb_data)
+{
+	struct sr_ftdi_stream *stream;
+	size_t packet_size;
+
+	if (!ftdic || !ftdic->usb_dev || !num_transfers || !transfer_size || !cb)
+		return NULL;
+
+	packet_size = ftdic->max_packet_size;
+	if (packet_size <= FTDI_STATUS_LEN)
+		return NULL;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->ftdic = ftdic;
+	stream->cb = cb;
+	stream->cb_data = cb_data;
+	stream->num_transfers = num_transfers;
+	stream->transfer_size = ((transfer_size + packet_size - 1) /
+		packet_size) * packet_size;
+	stream->transfers = g_malloc0(num_transfers * sizeof(stream->transfers[0]));
+
+	return stream;
+}
+
+/**
+ * Submit the stream's transfers.
+ *
+ * Data which libftdi has buffered already is not seen by the stream,
+ * callers are expected to purge the receive buffers before.
+ *
+ * @retval SR_OK Success, transfers are in flight.
+ * @retval SR_ERR_ARG Invalid argument, or the stream is running.
+ * @retval SR_ERR_IO Cannot submit transfers.
+ *
+ * @private
+ */
+SR_PRIV int sr_ftdi_stream_start(struct sr_ftdi_stream *stream)
+{
+	struct ftdi_context *ftdic;
+	struct libusb_transfer *transfer;
+	size_t i;
+	int ret;
+
+	if (!stream || stream->in_flight)
+		return SR_ERR_ARG;
+
+	ftdic = stream->ftdic;
+	stream->stopping = FALSE;
+	stream->result = SR_OK;
+
+	for (i = 0; i < stream->num_transfers; i++) {
+		transfer = stream->transfers[i];
+		if (!transfer) {
+			transfer = libusb_alloc_transfer(0);
+			if (!transfer)
+				break;
+			libusb_fill_bulk_transfer(transfer, ftdic->usb_dev,
+				ftdic->out_ep, g_malloc(stream->transfer_size),
+				stream->transfer_size, stream_transfer_done,
+				stream, ftdic->usb_read_timeout);
+			stream->transfers[i] = transfer;
+		}
+		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+			sr_err("Failed to submit FTDI bulk read: %s.",
+				libusb_error_name(ret));
+			break;
+		}
+		stream->in_flight++;
+	}
+
+	if (!stream->in_flight)
+		return SR_ERR_IO;
+
+	return SR_OK;
+}
+
+/**
+ * Handle completed transfers, call this from the session's main loop.
+ *
+ * @param stream The stream reader.
+ * @param timeout_ms The time to wait for transfers to complete.
+ *
+ * @retval SR_OK The stream is still running.
+ * @retval SR_ERR_NA The stream has ended, all transfers are back.
+ * @retval other The stream has ended upon an error.
+ *
+ * @private
+ */
+SR_PRIV int sr_ftdi_stream_poll(struct sr_ftdi_stream *stream, int timeout_ms)
+{
+	struct timeval tv;
+	size_t i;
+
+	if (!stream)
+		return SR_ERR_ARG;
+
+	if (stream->in_flight) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		libusb_handle_events_timeout_completed(stream->ftdic->usb_ctx,
+			&tv, NULL);
+	}
+
+	if (stream->stopping) {
+		for (i = 0; i < stream->num_transfers; i++) {
+			if (stream->transfers[i])
+				libusb_cancel_transfer(stream->transfers[i]);
+		}
+	}
+
+	if (stream->in_flight)
+		return SR_OK;
+
+	return (stream->result != SR_OK) ? stream->result : SR_ERR_NA;
+}
+
+/**
+ * Stop the stream, and wait for all transfers to come back.
+ *
+ * @private
+ */
+SR_PRIV void sr_ftdi_stream_stop(struct sr_ftdi_stream *stream)
+{
+	gint64 deadline;
+
+	if (!stream)
+		return;
+
+	stream->stopping = TRUE;
+	deadline = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
+	while (sr_ftdi_stream_poll(stream, 10) == SR_OK) {
+		if (g_get_monotonic_time() > deadline) {
+			sr_err("Timeout waiting for FTDI transfers to cancel.");
+			break;
+		}
+	}
+}
+
+/**
+ * Release a stream reader, stops it when it is still running.
+ *
+ * @private
+ */
+SR_PRIV void sr_ftdi_stream_free(struct sr_ftdi_stream *stream)
+{
+	size_t i;
+
+	if (!stream)
+		return;
+
+	sr_ftdi_stream_stop(stream);
+	if (stream->in_flight) {
+		/* Completions still reference the stream, leak it. */
+		sr_err("Leaking FTDI stream with transfers in flight.");
+		return;
+	}
+	for (i = 0; i < stream->num_transfers; i++) {
+		if (!stream->transfers[i])
+			continue;
+		g_free(stream->transfers[i]->buffer);
+		libusb_free_transfer(stream->transfers[i]);
+	}
+	g_free(stream->transfers);
+	g_free(stream);
+}
+
+#endif
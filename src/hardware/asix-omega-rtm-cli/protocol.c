@@ -19,6 +19,7 @@
 
 #include <config.h>
 
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -59,6 +60,9 @@ SR_PRIV int omega_rtm_cli_open(const struct sr_dev_inst *sdi)
 	memset(&devc->samples, 0, sizeof(devc->samples));
 	devc->samples.queue = feed_queue_logic_alloc(sdi,
 		FEED_QUEUE_DEPTH, sizeof(devc->samples.last_sample));
+	/* Real time monitoring: don't hold back data of idle signals. */
+	(void)feed_queue_logic_set_latency(devc->samples.queue,
+		FEED_QUEUE_LATENCY_MS);
 
 	/*
 	 * Start the background process. May take considerable time
@@ -116,6 +120,20 @@ SR_PRIV int omega_rtm_cli_open(const struct sr_dev_inst *sdi)
 	sr_dbg("stamp %u, samples %x %x", stamp, sample1, sample2);
 	write_u16le(devc->samples.last_sample, sample2);
 
+	/*
+	 * Have the pipe buffer hold more of the child's output, and
+	 * drain it in larger reads from now on. The child keeps running
+	 * while the session's main loop is busy elsewhere.
+	 */
+#if defined F_SETPIPE_SZ
+	if (fcntl(fd_out, F_SETPIPE_SZ, RTMCLI_PIPE_SIZE) < 0)
+		sr_dbg("Cannot resize the vendor application's stdout pipe.");
+#endif
+#if defined F_SETFL && defined O_NONBLOCK
+	if (fcntl(fd_out, F_SETFL, fcntl(fd_out, F_GETFL) | O_NONBLOCK) == 0)
+		devc->child.nonblocking = TRUE;
+#endif
+
 	return SR_OK;
 }
 
@@ -164,11 +182,66 @@ SR_PRIV int omega_rtm_cli_close(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Submit the collected runs of sample values to the session feed. */
+static int omega_rtm_cli_flush_runs(struct dev_context *devc)
+{
+	int ret;
+
+	if (!devc->samples.num_runs)
+		return SR_OK;
+
+	ret = feed_queue_logic_submit_many(devc->samples.queue,
+		devc->samples.values, devc->samples.counts,
+		devc->samples.num_runs);
+	devc->samples.num_runs = 0;
+
+	return ret;
+}
+
+/*
+ * Add a run of a sample value to the batch. Merges with the previous
+ * run when the value did not change. Returns the number of samples
+ * which were taken, which is less than requested when the user
+ * specified sample count limit was reached.
+ */
+static size_t omega_rtm_cli_add_run(struct dev_context *devc,
+	uint16_t sample, size_t count, int *ret)
+{
+	size_t idx;
+	uint8_t *value;
+
+	if (devc->samples.check_count) {
+		if (count > devc->samples.remain_count)
+			count = devc->samples.remain_count;
+		devc->samples.remain_count -= count;
+	}
+	if (!count)
+		return 0;
+
+	idx = devc->samples.num_runs;
+	if (idx && read_u16le(&devc->samples.values[(idx - 1) *
+			sizeof(uint16_t)]) == sample) {
+		devc->samples.counts[idx - 1] += count;
+		return count;
+	}
+	if (idx == RTMCLI_BATCH_RUNS) {
+		*ret = omega_rtm_cli_flush_runs(devc);
+		idx = 0;
+	}
+	value = &devc->samples.values[idx * sizeof(uint16_t)];
+	write_u16le(value, sample);
+	devc->samples.counts[idx] = count;
+	devc->samples.num_runs = idx + 1;
+
+	return count;
+}
+
 /*
  * Process received sample data, which comes in 6-byte chunks.
- * Uncompress the RLE stream. Strictly enforce user specified sample
- * count limits in the process, cap the submission when an uncompressed
- * chunk would exceed the limit.
+ * Uncompress the RLE stream, in batches of runs which get submitted
+ * to the session feed in one call. Strictly enforce user specified
+ * sample count limits in the process, cap the submission when an
+ * uncompressed chunk would exceed the limit.
  */
 static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 {
@@ -176,14 +249,16 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 
 	struct dev_context *devc;
 	const uint8_t *rdptr;
-	size_t avail, taken, count;
-	uint16_t stamp, sample1, sample2;
+	size_t avail, taken;
+	uint64_t samples_read;
+	uint16_t stamp, sample1, sample2, last;
 	int ret;
 
 	devc = sdi->priv;
 	rdptr = &devc->rawdata.buff[0];
 	avail = devc->rawdata.fill;
 	taken = 0;
+	samples_read = 0;
 	ret = SR_OK;
 
 	/* Cope with previous errors, silently discard RX data. */
@@ -191,6 +266,7 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 		ret = SR_ERR_DATA;
 
 	/* Process those chunks whose reception has completed. */
+	last = read_u16le(devc->samples.last_sample);
 	while (ret == SR_OK && avail >= chunk_size) {
 		stamp = read_u16le_inc(&rdptr);
 		sample1 = read_u16le_inc(&rdptr);
@@ -208,19 +284,8 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 		 */
 		if (stamp)
 			stamp--;
-		count = stamp * 2;
-		if (devc->samples.check_count) {
-			if (count > devc->samples.remain_count)
-				count = devc->samples.remain_count;
-			devc->samples.remain_count -= count;
-		}
-		if (count) {
-			ret = feed_queue_logic_submit(devc->samples.queue,
-				devc->samples.last_sample, count);
-			if (ret != SR_OK)
-				break;
-			sr_sw_limits_update_samples_read(&devc->limits, count);
-		}
+		samples_read += omega_rtm_cli_add_run(devc, last,
+			stamp * 2, &ret);
 		if (devc->samples.check_count && !devc->samples.remain_count)
 			break;
 
@@ -228,28 +293,17 @@ static int omega_rtm_cli_process_rawdata(const struct sr_dev_inst *sdi)
 		 * Also send the current samples. Keep the last value at
 		 * hand because future chunks might repeat it.
 		 */
-		write_u16le(devc->samples.last_sample, sample1);
-		ret = feed_queue_logic_submit(devc->samples.queue,
-			devc->samples.last_sample, 1);
-		if (ret != SR_OK)
-			break;
-
-		write_u16le(devc->samples.last_sample, sample2);
-		ret = feed_queue_logic_submit(devc->samples.queue,
-			devc->samples.last_sample, 1);
-		if (ret != SR_OK)
+		samples_read += omega_rtm_cli_add_run(devc, sample1, 1, &ret);
+		samples_read += omega_rtm_cli_add_run(devc, sample2, 1, &ret);
+		last = sample2;
+		if (devc->samples.check_count && !devc->samples.remain_count)
 			break;
-
-		count = 2;
-		sr_sw_limits_update_samples_read(&devc->limits, count);
-		if (devc->samples.check_count) {
-			if (count > devc->samples.remain_count)
-				count = devc->samples.remain_count;
-			devc->samples.remain_count -= count;
-			if (!devc->samples.remain_count)
-				break;
-		}
 	}
+	write_u16le(devc->samples.last_sample, last);
+	if (ret == SR_OK)
+		ret = omega_rtm_cli_flush_runs(devc);
+	devc->samples.num_runs = 0;
+	sr_sw_limits_update_samples_read(&devc->limits, samples_read);
 
 	/*
 	 * Silently consume all chunks which were successfully received.
@@ -284,7 +338,7 @@ SR_PRIV int omega_rtm_cli_receive_data(int fd, int revents, void *cb_data)
 	const struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	uint8_t *buff;
-	size_t space;
+	size_t space, reads;
 	ssize_t rcvd;
 	int ret;
 
@@ -295,7 +349,12 @@ SR_PRIV int omega_rtm_cli_receive_data(int fd, int revents, void *cb_data)
 	if (!devc)
 		return TRUE;
 
-	/* Process receive data when available. */
+	/*
+	 * Process receive data when available. Keep draining the pipe
+	 * for a few reads when it is non-blocking and reads fill the
+	 * buffer, the child has more data pending then.
+	 */
+	reads = 0;
 	if (revents & G_IO_IN) do {
 		buff = &devc->rawdata.buff[devc->rawdata.fill];
 		space = sizeof(devc->rawdata.buff) - devc->rawdata.fill;
@@ -307,8 +366,12 @@ SR_PRIV int omega_rtm_cli_receive_data(int fd, int revents, void *cb_data)
 		ret = omega_rtm_cli_process_rawdata(sdi);
 		if (ret != SR_OK) {
 			sr_err("Could not process sample data.");
+			break;
 		}
-	} while (0);
+		if (sr_sw_limits_check(&devc->limits))
+			break;
+	} while (devc->child.nonblocking && (size_t)rcvd == space &&
+		++reads < RTMCLI_READS_PER_CALL);
 
 	/* Handle receive errors. */
 	if (revents & G_IO_ERR) {
@@ -28,8 +28,12 @@
 
 #define LOG_PREFIX "asix-omega-rtm-cli"
 
-#define RTMCLI_STDOUT_CHUNKSIZE (1024 * 1024)
+#define RTMCLI_STDOUT_CHUNKSIZE (4 * 1024 * 1024)
+#define RTMCLI_PIPE_SIZE (1024 * 1024)
+#define RTMCLI_READS_PER_CALL 8
+#define RTMCLI_BATCH_RUNS 4096
 #define FEED_QUEUE_DEPTH (256 * 1024)
+#define FEED_QUEUE_LATENCY_MS 100
 
 struct dev_context {
 	char **channel_names;
@@ -41,6 +45,7 @@ struct dev_context {
 		GPid pid;
 		gint fd_stdin_write;
 		gint fd_stdout_read;
+		gboolean nonblocking;
 	} child;
 	struct {
 		uint8_t buff[RTMCLI_STDOUT_CHUNKSIZE];
@@ -51,6 +56,10 @@ struct dev_context {
 		uint8_t last_sample[sizeof(uint16_t)];
 		uint64_t remain_count;
 		gboolean check_count;
+		/* Runs of the RLE expansion, submitted in batches. */
+		uint8_t values[RTMCLI_BATCH_RUNS * sizeof(uint16_t)];
+		size_t counts[RTMCLI_BATCH_RUNS];
+		size_t num_runs;
 	} samples;
 };
 
@@ -149,7 +149,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 	conn_devices = NULL;
 	if (conn)
-		conn_devices = sr_usb_find(usbctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	if (conn && !conn_devices)
 		return NULL;
 
@@ -643,6 +643,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	if (devc->state == SIGMA_CAPTURE) {
 		devc->state = SIGMA_STOPPING;
 	} else {
+		if (devc->state == SIGMA_DOWNLOAD)
+			sigma_abort_download(devc);
 		devc->state = SIGMA_IDLE;
 		(void)sr_session_source_remove(sdi->session, -1);
 	}
@@ -1145,6 +1145,8 @@ SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi)
  */
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+/* How long interpretation waits for the download thread per attempt. */
+#define FETCH_WAIT_US	(10 * 1000)
 
 struct submit_buffer {
 	size_t unit_size;
@@ -1260,34 +1262,98 @@ static int flush_submit_buffer(struct dev_context *devc)
 	return SR_OK;
 }
 
+/*
+ * Determine how many of the samples which are about to get queued
+ * can be accepted, such that enforcement of user specified limits is
+ * exact. The limit does not apply when triggers are involved.
+ */
+static size_t submit_limit_count(struct dev_context *devc, size_t count)
+{
+	uint64_t remain;
+	gboolean exceeded;
+
+	if (devc->use_triggers)
+		return count;
+	if (sr_sw_limits_get_remain(&devc->limit.submit, &remain,
+			NULL, NULL, &exceeded) != SR_OK)
+		return count;
+	if (exceeded)
+		return 0;
+	if (remain && remain < count)
+		return remain;
+
+	return count;
+}
+
+/* Account for queued samples, submit when local storage is full. */
+static int commit_submit_buffer(struct dev_context *devc, size_t count)
+{
+	struct submit_buffer *buffer;
+
+	buffer = devc->buffer;
+	buffer->curr_samples += count;
+	sr_sw_limits_update_samples_read(&devc->limit.submit, count);
+	if (buffer->curr_samples == buffer->max_samples)
+		return flush_submit_buffer(devc);
+
+	return SR_OK;
+}
+
 static int addto_submit_buffer(struct dev_context *devc,
 	uint16_t sample, size_t count)
 {
 	struct submit_buffer *buffer;
-	struct sr_sw_limits *limits;
+	size_t chunk, filled, copy;
+	uint8_t *wp;
 	int ret;
 
 	buffer = devc->buffer;
-	limits = &devc->limit.submit;
-	if (!devc->use_triggers && sr_sw_limits_check(limits))
-		count = 0;
+	count = submit_limit_count(devc, count);
 
 	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
+	 * Fill repeated samples (RLE gaps) in blocks, by doubling the
+	 * already written part of the block. Don't exceed the local
+	 * storage between flushes.
 	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
-		if (buffer->curr_samples == buffer->max_samples) {
-			ret = flush_submit_buffer(devc);
-			if (ret != SR_OK)
-				return ret;
+	while (count) {
+		chunk = MIN(count, buffer->max_samples - buffer->curr_samples);
+		wp = buffer->write_pointer;
+		write_u16le(wp, sample);
+		for (filled = 1; filled < chunk; filled += copy) {
+			copy = MIN(filled, chunk - filled);
+			memcpy(wp + filled * sizeof(uint16_t), wp,
+				copy * sizeof(uint16_t));
 		}
-		sr_sw_limits_update_samples_read(limits, 1);
-		if (!devc->use_triggers && sr_sw_limits_check(limits))
-			break;
+		buffer->write_pointer += chunk * sizeof(uint16_t);
+		count -= chunk;
+		ret = commit_submit_buffer(devc, chunk);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/* Queue a series of individual samples. */
+static int addto_submit_buffer_array(struct dev_context *devc,
+	const uint16_t *samples, size_t count)
+{
+	struct submit_buffer *buffer;
+	size_t chunk, idx;
+	int ret;
+
+	buffer = devc->buffer;
+	count = submit_limit_count(devc, count);
+
+	while (count) {
+		chunk = MIN(count, buffer->max_samples - buffer->curr_samples);
+		for (idx = 0; idx < chunk; idx++)
+			write_u16le_inc(&buffer->write_pointer, samples[idx]);
+		samples += chunk;
+		count -= chunk;
+		ret = commit_submit_buffer(devc, chunk);
+		if (ret != SR_OK)
+			return ret;
 	}
 
 	return SR_OK;
@@ -1390,12 +1456,60 @@ static void rewind_trig_arm_pos(struct dev_context *devc, size_t count)
 	}
 }
 
+/*
+ * Don't fetch DRAM lines which are far before the trigger. The memory
+ * can hold much more pre-trigger data than the user asked for, when
+ * the trigger condition matched late or the write pointer wrapped.
+ * Lines hold clusters of RLE compressed data, so they span at least
+ * EVENTS_PER_ROW samples. Keep enough lines to cover the requested
+ * amount of pre-trigger samples, plus one for the partial first line,
+ * and move the start position to the window's first line.
+ */
+static void skip_pretrigger_lines(struct dev_context *devc, size_t trig_pos)
+{
+	struct sigma_sample_interp *interp;
+	struct std_download_window window;
+	GVariant *data;
+	uint64_t limit, pre_lines;
+	size_t lines, trig_line;
+
+	interp = &devc->interp;
+
+	if (!devc->use_triggers || trig_pos == (size_t)~0)
+		return;
+	if (sr_sw_limits_config_get(&devc->limit.config,
+			SR_CONF_LIMIT_SAMPLES, &data) != SR_OK)
+		return;
+	limit = g_variant_get_uint64(data);
+	g_variant_unref(data);
+	if (!limit)
+		return;
+
+	lines = interp->stop.line + 1 + ROW_COUNT - interp->start.line;
+	lines %= ROW_COUNT;
+	trig_line = interp->trig.line + ROW_COUNT - interp->start.line;
+	trig_line %= ROW_COUNT;
+	pre_lines = limit * devc->capture_ratio / 100;
+	pre_lines = (pre_lines + EVENTS_PER_ROW - 1) / EVENTS_PER_ROW + 1;
+
+	std_download_window(&window, lines, trig_line, pre_lines, lines);
+	if (!window.first)
+		return;
+
+	sr_dbg("Skipping %" PRIu64 " DRAM lines before the trigger.",
+		window.first);
+	interp->start.raw = (interp->start.line + window.first) % ROW_COUNT;
+	interp->start.raw *= ROW_LENGTH_U16;
+	sigma_location_break_down(&interp->start);
+}
+
 static int alloc_sample_buffer(struct dev_context *devc,
 	size_t stop_pos, size_t trig_pos, uint8_t mode)
 {
 	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
 	gboolean wrapped;
-	size_t alloc_size;
+	size_t alloc_size, idx;
 
 	interp = &devc->interp;
 
@@ -1428,6 +1542,7 @@ static int alloc_sample_buffer(struct dev_context *devc,
 	sigma_location_break_down(&interp->stop);
 	sigma_location_break_down(&interp->trig);
 	sigma_location_break_down(&interp->iter);
+	skip_pretrigger_lines(devc, trig_pos);
 
 	/*
 	 * The hardware provided trigger location "is late" because of
@@ -1449,23 +1564,115 @@ static int alloc_sample_buffer(struct dev_context *devc,
 
 	/* Arrange for chunked download, N lines per USB request. */
 	interp->fetch.lines_per_read = 32;
-	alloc_size = sizeof(devc->interp.fetch.rcvd_lines[0]);
-	alloc_size *= devc->interp.fetch.lines_per_read;
-	devc->interp.fetch.rcvd_lines = g_try_malloc0(alloc_size);
-	if (!devc->interp.fetch.rcvd_lines)
-		return SR_ERR_MALLOC;
+	alloc_size = sizeof(chunk->lines[0]);
+	alloc_size *= interp->fetch.lines_per_read;
+	interp->fetch.free_chunks = g_async_queue_new();
+	interp->fetch.full_chunks = g_async_queue_new();
+	for (idx = 0; idx < FETCH_CHUNKS; idx++) {
+		chunk = g_malloc0(sizeof(*chunk));
+		chunk->lines = g_try_malloc0(alloc_size);
+		g_async_queue_push(interp->fetch.free_chunks, chunk);
+		if (!chunk->lines)
+			return SR_ERR_MALLOC;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Download DRAM lines in a separate thread, such that the USB transfer
+ * and the interpretation of previously received data run concurrently.
+ * The number of chunks limits how far the download gets ahead. Only
+ * this thread communicates with the device during download.
+ */
+static gpointer fetch_thread(gpointer data)
+{
+	struct dev_context *devc;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
+	size_t line, count;
+
+	devc = data;
+	interp = &devc->interp;
+
+	while (interp->fetch.lines_read < interp->fetch.lines_total) {
+		chunk = g_async_queue_pop(interp->fetch.free_chunks);
+		if (g_atomic_int_get(&interp->fetch.abort)) {
+			g_async_queue_push(interp->fetch.free_chunks, chunk);
+			break;
+		}
+		count = interp->fetch.lines_total - interp->fetch.lines_read;
+		if (count > interp->fetch.lines_per_read)
+			count = interp->fetch.lines_per_read;
+		line = interp->start.line + interp->fetch.lines_read;
+		line %= ROW_COUNT;
+		chunk->status = sigma_read_dram(devc, line, count,
+			(uint8_t *)chunk->lines);
+		chunk->count = count;
+		interp->fetch.lines_read += count;
+		g_async_queue_push(interp->fetch.full_chunks, chunk);
+		if (chunk->status != SR_OK)
+			break;
+	}
+
+	return NULL;
+}
+
+static int start_fetch_thread(struct dev_context *devc)
+{
+	struct sigma_sample_interp *interp;
+	GError *error;
+
+	interp = &devc->interp;
+	interp->fetch.lines_read = 0;
+	interp->fetch.abort = 0;
+
+	error = NULL;
+	interp->fetch.reader = g_thread_try_new("sigma-download",
+		fetch_thread, devc, &error);
+	if (!interp->fetch.reader) {
+		sr_err("Cannot create download thread: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
 
 	return SR_OK;
 }
 
+/* Have the download thread terminate, and wait for it. */
+static void stop_fetch_thread(struct dev_context *devc)
+{
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
+
+	interp = &devc->interp;
+	if (!interp->fetch.reader)
+		return;
+
+	/* Hand all chunks to the thread, it then finds the abort flag. */
+	g_atomic_int_set(&interp->fetch.abort, 1);
+	if (interp->fetch.chunk) {
+		g_async_queue_push(interp->fetch.free_chunks, interp->fetch.chunk);
+		interp->fetch.chunk = NULL;
+	}
+	while ((chunk = g_async_queue_try_pop(interp->fetch.full_chunks)))
+		g_async_queue_push(interp->fetch.free_chunks, chunk);
+	g_thread_join(interp->fetch.reader);
+	interp->fetch.reader = NULL;
+}
+
 static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx);
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx);
 
+/*
+ * Get the next set of DRAM lines from the download thread, and return
+ * the previous set to it. Returns SR_ERR_NA when the download has not
+ * caught up yet.
+ */
 static int fetch_sample_buffer(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
-	size_t count;
-	int ret;
+	struct sigma_fetch_chunk *chunk;
 	const uint8_t *rdptr;
 	uint16_t ts, data;
 
@@ -1476,16 +1683,19 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		interp->iter = interp->start;
 	}
 
-	/* Get another set of DRAM lines in one read call. */
-	count = interp->fetch.lines_total - interp->fetch.lines_done;
-	if (count > interp->fetch.lines_per_read)
-		count = interp->fetch.lines_per_read;
-	ret = sigma_read_dram(devc, interp->iter.line, count,
-		(uint8_t *)interp->fetch.rcvd_lines);
-	if (ret != SR_OK)
-		return ret;
-	interp->fetch.lines_rcvd = count;
-	interp->fetch.curr_line = &interp->fetch.rcvd_lines[0];
+	if (interp->fetch.chunk) {
+		g_async_queue_push(interp->fetch.free_chunks, interp->fetch.chunk);
+		interp->fetch.chunk = NULL;
+	}
+	chunk = g_async_queue_timeout_pop(interp->fetch.full_chunks,
+		FETCH_WAIT_US);
+	if (!chunk)
+		return SR_ERR_NA;
+	interp->fetch.chunk = chunk;
+	if (chunk->status != SR_OK)
+		return chunk->status;
+	interp->fetch.lines_rcvd = chunk->count;
+	interp->fetch.curr_line = &chunk->lines[0];
 
 	/* First invocation? Get initial timestamp and sample data. */
 	if (!interp->fetch.lines_done) {
@@ -1506,9 +1716,33 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 static void free_sample_buffer(struct dev_context *devc)
 {
-	g_free(devc->interp.fetch.rcvd_lines);
-	devc->interp.fetch.rcvd_lines = NULL;
-	devc->interp.fetch.lines_per_read = 0;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
+
+	interp = &devc->interp;
+	stop_fetch_thread(devc);
+	if (interp->fetch.chunk) {
+		g_async_queue_push(interp->fetch.free_chunks, interp->fetch.chunk);
+		interp->fetch.chunk = NULL;
+	}
+	if (interp->fetch.free_chunks) {
+		while ((chunk = g_async_queue_try_pop(interp->fetch.free_chunks))) {
+			g_free(chunk->lines);
+			g_free(chunk);
+		}
+		g_async_queue_unref(interp->fetch.free_chunks);
+		interp->fetch.free_chunks = NULL;
+	}
+	if (interp->fetch.full_chunks) {
+		while ((chunk = g_async_queue_try_pop(interp->fetch.full_chunks))) {
+			g_free(chunk->lines);
+			g_free(chunk);
+		}
+		g_async_queue_unref(interp->fetch.full_chunks);
+		interp->fetch.full_chunks = NULL;
+	}
+	interp->fetch.curr_line = NULL;
+	interp->fetch.lines_per_read = 0;
 }
 
 /*
@@ -1848,6 +2082,114 @@ static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
 	return outdata;
 }
 
+/*
+ * Lookup tables for the deinterlacing of whole DRAM clusters. The bit
+ * of a sample at a given position is in the low or the high byte of
+ * the 16bit item. The tables map each byte to the bits of the sample
+ * at the table's index, the high byte's bits get shifted into place.
+ */
+static struct {
+	uint8_t lut_2x8[2][256];
+	uint8_t lut_4x4[4][256];
+} deinterlace;
+
+static void sigma_deinterlace_init(void)
+{
+	static gsize done;
+	size_t idx, bit, b;
+	uint8_t out;
+
+	if (!g_once_init_enter(&done))
+		return;
+
+	for (b = 0; b < 256; b++) {
+		for (idx = 0; idx < 2; idx++) {
+			out = 0;
+			for (bit = 0; bit < 4; bit++)
+				out |= ((b >> (bit * 2 + idx)) & 1) << bit;
+			deinterlace.lut_2x8[idx][b] = out;
+		}
+		for (idx = 0; idx < 4; idx++) {
+			out = 0;
+			for (bit = 0; bit < 2; bit++)
+				out |= ((b >> (bit * 4 + idx)) & 1) << bit;
+			deinterlace.lut_4x4[idx][b] = out;
+		}
+	}
+
+	g_once_init_leave(&done, 1);
+}
+
+/*
+ * Check whether software trigger supervision is active, or becomes
+ * active, during the next events. Only a short period of events around
+ * the hardware provided trigger location needs per sample checks.
+ */
+static gboolean sigma_location_needs_check(struct dev_context *devc,
+	size_t events)
+{
+	struct sigma_sample_interp *interp;
+	struct sigma_location loc;
+
+	if (!devc->use_triggers)
+		return FALSE;
+	interp = &devc->interp;
+	if (interp->trig_chk.armed)
+		return TRUE;
+	if (interp->trig_chk.matched)
+		return FALSE;
+
+	/* Supervision gets armed after the location was advanced. */
+	loc = interp->iter;
+	while (events--) {
+		sigma_location_increment(&loc);
+		if (sigma_location_is_eq(&loc, &interp->trig_arm, TRUE))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Deinterlace all events of a cluster in one go, and queue the samples
+ * without trigger checks. This is the path for everything outside the
+ * period of trigger supervision.
+ */
+static void sigma_decode_cluster_bulk(struct dev_context *devc,
+	struct sigma_dram_cluster *dram_cluster, size_t events_in_cluster)
+{
+	uint16_t samples[EVENTS_PER_CLUSTER * 4];
+	uint16_t item16;
+	uint8_t lo, hi;
+	size_t evt, idx, num;
+
+	num = 0;
+	for (evt = 0; evt < events_in_cluster; evt++) {
+		item16 = sigma_dram_cluster_data(dram_cluster, evt);
+		lo = item16 & 0xff;
+		hi = item16 >> 8;
+		if (devc->interp.samples_per_event == 4) {
+			for (idx = 0; idx < 4; idx++) {
+				samples[num++] = deinterlace.lut_4x4[idx][lo] |
+					deinterlace.lut_4x4[idx][hi] << 2;
+			}
+		} else if (devc->interp.samples_per_event == 2) {
+			for (idx = 0; idx < 2; idx++) {
+				samples[num++] = deinterlace.lut_2x8[idx][lo] |
+					deinterlace.lut_2x8[idx][hi] << 4;
+			}
+		} else {
+			samples[num++] = item16;
+		}
+		sigma_location_increment(&devc->interp.iter);
+	}
+	if (!num)
+		return;
+
+	devc->interp.last.sample = samples[num - 1];
+	(void)addto_submit_buffer_array(devc, samples, num);
+}
+
 static void sigma_decode_dram_cluster(struct dev_context *devc,
 	struct sigma_dram_cluster *dram_cluster,
 	size_t events_in_cluster)
@@ -1882,6 +2224,10 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	 * before submission is transparent to this code path, specific
 	 * buffer depth is neither assumed nor required here.
 	 */
+	if (!sigma_location_needs_check(devc, events_in_cluster)) {
+		sigma_decode_cluster_bulk(devc, dram_cluster, events_in_cluster);
+		return;
+	}
 	sample = 0;
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
@@ -1979,10 +2325,13 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * clusters to DRAM regardless of whether pin state changes) and
 	 * raise the POSTTRIGGERED flag.
 	 */
-	ret = sigma_get_register(devc, READ_MODE, &modestatus);
-	if (ret != SR_OK) {
-		sr_err("Could not determine current device state.");
-		return FALSE;
+	modestatus = RMR_POSTTRIGGERED;
+	if (!interp->fetch.lines_per_read) {
+		ret = sigma_get_register(devc, READ_MODE, &modestatus);
+		if (ret != SR_OK) {
+			sr_err("Could not determine current device state.");
+			return FALSE;
+		}
 	}
 	if (!(modestatus & RMR_POSTTRIGGERED)) {
 		sr_info("Downloading sample data.");
@@ -2011,7 +2360,9 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * trigger match location). With disabled triggers, use a value
 	 * for the location that will never match during interpretation.
 	 * Determine which area of the sample memory to retrieve,
-	 * allocate a receive buffer, and setup counters/pointers.
+	 * allocate a receive buffer, and setup counters/pointers. Then
+	 * have the download thread start reading sample memory. The
+	 * device is not accessed from here while it runs.
 	 */
 	if (!interp->fetch.lines_per_read) {
 		ret = sigma_set_register(devc, WRITE_MODE, WMR_SDRAMREADEN);
@@ -2029,8 +2380,10 @@ static int download_capture(struct sr_dev_inst *sdi)
 			triggerpos = ~0;
 
 		ret = alloc_sample_buffer(devc, stoppos, triggerpos, modestatus);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			free_sample_buffer(devc);
 			return FALSE;
+		}
 
 		ret = alloc_submit_buffer(sdi);
 		if (ret != SR_OK)
@@ -2038,6 +2391,10 @@ static int download_capture(struct sr_dev_inst *sdi)
 		ret = setup_submit_limit(devc);
 		if (ret != SR_OK)
 			return FALSE;
+		sigma_deinterlace_init();
+		ret = start_fetch_thread(devc);
+		if (ret != SR_OK)
+			return FALSE;
 	}
 
 	/*
@@ -2053,8 +2410,10 @@ static int download_capture(struct sr_dev_inst *sdi)
 	while (interp->fetch.lines_done < interp->fetch.lines_total) {
 		size_t dl_events_in_line;
 
-		/* Read another chunk of sample memory (several lines). */
+		/* Get another chunk of sample memory (several lines). */
 		ret = fetch_sample_buffer(devc);
+		if (ret == SR_ERR_NA)
+			break;
 		if (ret != SR_OK)
 			return FALSE;
 
@@ -2102,6 +2461,16 @@ static int download_capture(struct sr_dev_inst *sdi)
 	return TRUE;
 }
 
+/*
+ * Release the resources of a download which did not complete, e.g.
+ * when the application stops the acquisition during download.
+ */
+SR_PRIV void sigma_abort_download(struct dev_context *devc)
+{
+	free_sample_buffer(devc);
+	free_submit_buffer(devc);
+}
+
 /*
  * Periodically check the Sigma status when in CAPTURE mode. This routine
  * checks whether the configured sample count or sample time have passed,
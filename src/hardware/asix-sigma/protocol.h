@@ -251,6 +251,18 @@ struct sigma_dram_line {
 	} cluster[CLUSTERS_PER_ROW];
 };
 
+/*
+ * A set of DRAM lines, as read in one USB request. Two of them circulate
+ * between the download thread and the sample data interpretation.
+ */
+#define FETCH_CHUNKS		2
+
+struct sigma_fetch_chunk {
+	struct sigma_dram_line *lines;
+	size_t count;
+	int status;
+};
+
 /* The effect of all these are still a bit unclear. */
 struct triggerinout {
 	gboolean trgout_resistor_enable, trgout_resistor_pullup;
@@ -367,8 +379,13 @@ struct dev_context {
 			size_t lines_total, lines_done;
 			size_t lines_per_read; /* USB transfer limit */
 			size_t lines_rcvd;
-			struct sigma_dram_line *rcvd_lines;
 			struct sigma_dram_line *curr_line;
+			/* Download thread, and chunks in flight. */
+			GThread *reader;
+			GAsyncQueue *free_chunks, *full_chunks;
+			struct sigma_fetch_chunk *chunk;
+			size_t lines_read;
+			gint abort;
 		} fetch;
 		struct {
 			gboolean armed;
@@ -422,5 +439,6 @@ SR_PRIV int sigma_build_basic_trigger(struct dev_context *devc,
 
 /* Callback to periodically drive acuisition progress. */
 SR_PRIV int sigma_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV void sigma_abort_download(struct dev_context *devc);
 
 #endif
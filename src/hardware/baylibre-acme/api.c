@@ -48,14 +48,18 @@ static const uint32_t devopts[] = {
 #define HAS_PROBE_FACTOR	(SR_CONF_PROBE_FACTOR | SR_CONF_GET | SR_CONF_SET)
 #define HAS_POWER_OFF		(SR_CONF_POWER_OFF | SR_CONF_GET | SR_CONF_SET)
 
-#define MAX_SAMPLE_RATE 500 /* In Hz */
-
 static const uint64_t samplerates[] = {
 	SR_HZ(1),
 	SR_HZ(MAX_SAMPLE_RATE),
 	SR_HZ(1),
 };
 
+static const uint64_t samplerates_iio[] = {
+	SR_HZ(1),
+	SR_HZ(MAX_IIO_SAMPLE_RATE),
+	SR_HZ(1),
+};
+
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
 	struct dev_context *devc;
@@ -122,6 +126,10 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	if (!sdi->channel_groups)
 		goto err_out;
 
+	devc->use_iio = bl_acme_iio_available(sdi);
+	if (devc->use_iio)
+		sr_info("Using IIO buffered capture.");
+
 	return std_scan_complete(di, g_slist_append(NULL, sdi));
 
 err_out:
@@ -175,7 +183,7 @@ static int config_set(uint32_t key, GVariant *data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
 	struct dev_context *devc;
-	uint64_t samplerate;
+	uint64_t samplerate, max_rate;
 
 	devc = sdi->priv;
 
@@ -185,8 +193,9 @@ static int config_set(uint32_t key, GVariant *data,
 		return sr_sw_limits_config_set(&devc->limits, key, data);
 	case SR_CONF_SAMPLERATE:
 		samplerate = g_variant_get_uint64(data);
-		if (samplerate > MAX_SAMPLE_RATE) {
-			sr_err("Maximum sample rate is %d", MAX_SAMPLE_RATE);
+		max_rate = devc->use_iio ? MAX_IIO_SAMPLE_RATE : MAX_SAMPLE_RATE;
+		if (samplerate > max_rate) {
+			sr_err("Maximum sample rate is %" PRIu64, max_rate);
 			return SR_ERR_SAMPLERATE;
 		}
 		devc->samplerate = samplerate;
@@ -210,15 +219,21 @@ static int config_set(uint32_t key, GVariant *data,
 static int config_list(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
+	struct dev_context *devc;
 	uint32_t devopts_cg[MAX_DEVOPTS_CG];
 	int num_devopts_cg = 0;
 
+	devc = sdi ? sdi->priv : NULL;
+
 	if (!cg) {
 		switch (key) {
 		case SR_CONF_DEVICE_OPTIONS:
 			return STD_CONFIG_LIST(key, data, sdi, cg, NO_OPTS, drvopts, devopts);
 		case SR_CONF_SAMPLERATE:
-			*data = std_gvar_samplerates_steps(ARRAY_AND_SIZE(samplerates));
+			if (devc && devc->use_iio)
+				*data = std_gvar_samplerates_steps(ARRAY_AND_SIZE(samplerates_iio));
+			else
+				*data = std_gvar_samplerates_steps(ARRAY_AND_SIZE(samplerates));
 			break;
 		default:
 			return SR_ERR_NA;
@@ -277,10 +292,18 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		.it_value = { 0, 0 }
 	};
 
+	devc = sdi->priv;
+	if (devc->use_iio) {
+		if (bl_acme_iio_start(sdi) != SR_OK)
+			return SR_ERR;
+		std_session_send_df_header(sdi);
+		sr_sw_limits_acquisition_start(&devc->limits);
+		return SR_OK;
+	}
+
 	if (dev_acquisition_open(sdi))
 		return SR_ERR;
 
-	devc = sdi->priv;
 	devc->samples_missed = 0;
 	devc->timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
 	if (devc->timer_fd < 0) {
@@ -318,6 +341,12 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	if (devc->use_iio) {
+		bl_acme_iio_stop(sdi);
+		std_session_send_df_end(sdi);
+		return SR_OK;
+	}
+
 	dev_acquisition_close(sdi);
 	sr_session_source_remove_channel(sdi->session, devc->channel);
 	g_io_channel_shutdown(devc->channel, FALSE, NULL);
@@ -42,10 +42,28 @@ enum channel_type {
 struct channel_group_priv {
 	uint8_t rev;
 	int hwmon_num;
+	int iio_num;
 	int probe_type;
 	int index;
 	int has_pws;
 	uint32_t pws_gpio;
+	/* IIO buffered capture: device node, and the partial scan read. */
+	int iio_fd;
+	size_t iio_scan_size;
+	uint8_t *iio_buf;
+	size_t iio_buf_used;
+};
+
+/* Layout and scale of an IIO scan element in the buffer's scans. */
+struct iio_scan_element {
+	int index;
+	size_t offset;
+	size_t bytes;
+	unsigned int bits;
+	unsigned int shift;
+	gboolean is_signed;
+	gboolean is_bigendian;
+	double scale;
 };
 
 struct channel_priv {
@@ -54,6 +72,8 @@ struct channel_priv {
 	int digits;
 	float val;
 	struct channel_group_priv *probe;
+	struct iio_scan_element iio;
+	float *iio_values;
 };
 
 #define EEPROM_SERIAL_SIZE		16
@@ -104,6 +124,11 @@ static const uint32_t revB_pws_gpios[] = {
 #define MOHM_TO_UOHM(x) ((x) * 1000)
 #define UOHM_TO_MOHM(x) ((x) / 1000)
 
+#define IIO_SYSFS_PATH		"/sys/bus/iio/devices/iio:device%d"
+#define IIO_DEV_PATH		"/dev/iio:device%d"
+/* Number of scans to read from the IIO buffer at once. */
+#define IIO_READ_SCANS		1024
+
 SR_PRIV uint8_t bl_acme_get_enrg_addr(int index)
 {
 	return enrg_i2c_addrs[index];
@@ -147,6 +172,12 @@ static void probe_hwmon_path(unsigned int addr, GString *path)
 			"/sys/class/i2c-adapter/i2c-1/1-00%02x/hwmon", addr);
 }
 
+static void probe_dev_path(unsigned int addr, GString *path)
+{
+	g_string_printf(path,
+			"/sys/class/i2c-adapter/i2c-1/1-00%02x", addr);
+}
+
 static void probe_eeprom_path(unsigned int addr, GString *path)
 {
 	g_string_printf(path,
@@ -154,6 +185,35 @@ static void probe_eeprom_path(unsigned int addr, GString *path)
 			addr + 0x10);
 }
 
+/*
+ * Get the index of the probe's IIO device, when the ina2xx IIO driver
+ * (instead of the hwmon driver) handles it. Returns -1 if there is none.
+ */
+static int get_iio_index(unsigned int addr)
+{
+	GString *path;
+	GDir *dir;
+	const char *name;
+	int iio;
+
+	path = g_string_sized_new(64);
+	probe_dev_path(addr, path);
+	dir = g_dir_open(path->str, 0, NULL);
+	g_string_free(path, TRUE);
+	if (!dir)
+		return -1;
+
+	iio = -1;
+	while ((name = g_dir_read_name(dir))) {
+		if (sscanf(name, "iio:device%d", &iio) == 1)
+			break;
+		iio = -1;
+	}
+	g_dir_close(dir);
+
+	return iio;
+}
+
 SR_PRIV gboolean bl_acme_detect_probe(unsigned int addr,
 				      int prb_num, const char *prb_name)
 {
@@ -182,7 +242,7 @@ SR_PRIV gboolean bl_acme_detect_probe(unsigned int addr,
 		 */
 		probe_hwmon_path(addr, path);
 		status = g_file_test(path->str, G_FILE_TEST_IS_DIR);
-		if (status) {
+		if (status || get_iio_index(addr) >= 0) {
 			/* We have found an ACME probe. */
 			ret = TRUE;
 		}
@@ -324,15 +384,25 @@ SR_PRIV gboolean bl_acme_register_probe(struct sr_dev_inst *sdi, int type,
 	struct sr_channel_group *cg;
 	struct channel_group_priv *cgp;
 	struct probe_eeprom eeprom;
-	int hwmon, status;
+	GString *path;
+	int hwmon, iio, status;
 	uint32_t gpio;
 
-	/* Obtain the hwmon index. */
-	hwmon = get_hwmon_index(addr);
-	if (hwmon < 0)
+	/*
+	 * Obtain the hwmon index, or the IIO device index of energy
+	 * probes which the ina2xx IIO driver handles.
+	 */
+	path = g_string_sized_new(64);
+	probe_hwmon_path(addr, path);
+	status = g_file_test(path->str, G_FILE_TEST_IS_DIR);
+	g_string_free(path, TRUE);
+	hwmon = status ? get_hwmon_index(addr) : -1;
+	iio = type == PROBE_ENRG ? get_iio_index(addr) : -1;
+	if (hwmon < 0 && iio < 0)
 		return FALSE;
 
 	cgp = g_malloc0(sizeof(struct channel_group_priv));
+	cgp->iio_fd = -1;
 	cg = sr_channel_group_new(sdi, NULL, cgp);
 
 	/*
@@ -346,6 +416,7 @@ SR_PRIV gboolean bl_acme_register_probe(struct sr_dev_inst *sdi, int type,
 	prb_num = cgp->rev == ACME_REV_A ? prb_num : revB_addr_to_num(addr);
 
 	cgp->hwmon_num = hwmon;
+	cgp->iio_num = iio;
 	cgp->probe_type = type;
 	cgp->index = prb_num - 1;
 	cg->name = g_strdup_printf("Probe_%d", prb_num);
@@ -413,9 +484,14 @@ static int get_shunt_path(const struct sr_channel_group *cg, GString *path)
 		return SR_ERR_ARG;
 	}
 
-	g_string_append_printf(path,
-			       "/sys/class/hwmon/hwmon%d/shunt_resistor",
-			       cgp->hwmon_num);
+	if (cgp->hwmon_num < 0) {
+		g_string_append_printf(path, IIO_SYSFS_PATH "/in_shunt_resistor",
+				       cgp->iio_num);
+	} else {
+		g_string_append_printf(path,
+				       "/sys/class/hwmon/hwmon%d/shunt_resistor",
+				       cgp->hwmon_num);
+	}
 
 	/*
 	 * The shunt_resistor sysfs attribute is available
@@ -448,6 +524,8 @@ SR_PRIV void bl_acme_maybe_set_update_interval(const struct sr_dev_inst *sdi,
 	for (l = sdi->channel_groups; l != NULL; l = l->next) {
 		cg = l->data;
 		cgp = cg->priv;
+		if (cgp->hwmon_num < 0)
+			continue;
 
 		hwmon = g_string_sized_new(64);
 		g_string_append_printf(hwmon,
@@ -796,3 +874,409 @@ SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data)
 
 	return TRUE;
 }
+
+/*
+ * IIO buffered capture. The ina2xx IIO driver samples the probes in
+ * the kernel, and provides scans of binary values in a buffer which
+ * gets read from the /dev/iio:deviceN node. Blocks of samples get
+ * sent per channel, instead of reading one value per channel and
+ * timer expiration from hwmon sysfs files.
+ */
+
+SR_PRIV gboolean bl_acme_iio_available(const struct sr_dev_inst *sdi)
+{
+	struct channel_group_priv *cgp;
+	GSList *l;
+
+	if (!sdi->channel_groups)
+		return FALSE;
+	for (l = sdi->channel_groups; l; l = l->next) {
+		cgp = ((struct sr_channel_group *)l->data)->priv;
+		if (cgp->iio_num < 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static const char *iio_scan_element_name(int type)
+{
+	switch (type) {
+	case ENRG_PWR:
+		return "in_power2";
+	case ENRG_CURR:
+		return "in_current3";
+	case ENRG_VOL:
+		return "in_voltage1";
+	default:
+		return NULL;
+	}
+}
+
+static char *iio_attr_read(int iio_num, const char *attr)
+{
+	char *path, *contents;
+
+	path = g_strdup_printf(IIO_SYSFS_PATH "/%s", iio_num, attr);
+	if (!g_file_get_contents(path, &contents, NULL, NULL))
+		contents = NULL;
+	g_free(path);
+
+	return contents ? g_strstrip(contents) : NULL;
+}
+
+static int iio_attr_write(int iio_num, const char *attr, const char *value)
+{
+	char *path;
+	FILE *fd;
+	int ret;
+
+	/* See bl_acme_set_shunt() for why g_file_set_contents() won't do. */
+	path = g_strdup_printf(IIO_SYSFS_PATH "/%s", iio_num, attr);
+	fd = g_fopen(path, "w");
+	if (!fd) {
+		sr_dbg("Cannot open %s: %s", path, g_strerror(errno));
+		g_free(path);
+		return SR_ERR_IO;
+	}
+	ret = SR_OK;
+	if (g_fprintf(fd, "%s\n", value) < 0)
+		ret = SR_ERR_IO;
+	/* Sysfs stores the value (and reports errors) upon the flush. */
+	if (fclose(fd) != 0)
+		ret = SR_ERR_IO;
+	if (ret != SR_OK)
+		sr_dbg("Cannot write %s: %s", path, g_strerror(errno));
+	g_free(path);
+
+	return ret;
+}
+
+/* Get an enabled scan element's index, data type and scale. */
+static int iio_scan_element_get(int iio_num, const char *name,
+				struct iio_scan_element *elem)
+{
+	char *attr, *value, endian[3], sign;
+	unsigned int storage;
+	int ret;
+
+	ret = SR_ERR_DATA;
+	attr = g_strdup_printf("scan_elements/%s_index", name);
+	value = iio_attr_read(iio_num, attr);
+	g_free(attr);
+	if (!value || sr_atoi(value, &elem->index) != SR_OK)
+		goto out;
+	g_free(value);
+
+	/* The type looks like "le:s16/16>>0". */
+	attr = g_strdup_printf("scan_elements/%s_type", name);
+	value = iio_attr_read(iio_num, attr);
+	g_free(attr);
+	if (!value || sscanf(value, "%2[bel]:%c%u/%u>>%u", endian, &sign,
+			&elem->bits, &storage, &elem->shift) != 5)
+		goto out;
+	if (storage != 8 && storage != 16 && storage != 32 && storage != 64)
+		goto out;
+	if (!elem->bits || elem->bits + elem->shift > storage)
+		goto out;
+	elem->bytes = storage / 8;
+	elem->is_signed = sign == 's';
+	elem->is_bigendian = strcmp(endian, "be") == 0;
+	g_free(value);
+
+	/* Scales are for milli units, callers want base units. */
+	attr = g_strdup_printf("%s_scale", name);
+	value = iio_attr_read(iio_num, attr);
+	g_free(attr);
+	elem->scale = value ? g_ascii_strtod(value, NULL) : 1.0;
+	elem->scale /= 1000.0;
+	ret = SR_OK;
+
+out:
+	if (ret != SR_OK)
+		sr_err("Unsupported IIO scan element %s.", name);
+	g_free(value);
+
+	return ret;
+}
+
+static float iio_scan_element_value(const struct iio_scan_element *elem,
+				    const uint8_t *scan)
+{
+	const uint8_t *p;
+	uint64_t raw;
+	int64_t value;
+	size_t i;
+
+	p = scan + elem->offset;
+	raw = 0;
+	for (i = 0; i < elem->bytes; i++) {
+		if (elem->is_bigendian)
+			raw = (raw << 8) | p[i];
+		else
+			raw |= (uint64_t)p[i] << (8 * i);
+	}
+	raw >>= elem->shift;
+	if (elem->bits < 64)
+		raw &= (UINT64_C(1) << elem->bits) - 1;
+	value = raw;
+	if (elem->is_signed && elem->bits < 64 &&
+			(raw & (UINT64_C(1) << (elem->bits - 1))))
+		value -= (int64_t)(UINT64_C(1) << elem->bits);
+
+	return value * elem->scale;
+}
+
+static void iio_close_probe(struct channel_group_priv *cgp,
+			    struct sr_channel_group *cg)
+{
+	struct channel_priv *chp;
+	GSList *l;
+
+	if (cgp->iio_fd >= 0) {
+		close(cgp->iio_fd);
+		cgp->iio_fd = -1;
+	}
+	iio_attr_write(cgp->iio_num, "buffer/enable", "0");
+	g_free(cgp->iio_buf);
+	cgp->iio_buf = NULL;
+	cgp->iio_buf_used = 0;
+	for (l = cg->channels; l; l = l->next) {
+		chp = ((struct sr_channel *)l->data)->priv;
+		g_free(chp->iio_values);
+		chp->iio_values = NULL;
+	}
+}
+
+/*
+ * Enable the scan elements of the probe's enabled channels, determine
+ * the layout of the scans, then enable the buffer and open the device.
+ */
+static int iio_open_probe(const struct sr_dev_inst *sdi,
+			  struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+	struct channel_group_priv *cgp;
+	struct channel_priv *chp, *elems[3];
+	struct sr_channel *ch;
+	const char *name;
+	char *attr, value[32];
+	size_t num_elems, i, j, offset, align;
+	GSList *l;
+	int ret;
+
+	devc = sdi->priv;
+	cgp = cg->priv;
+
+	/* The buffer must be disabled while it gets configured. */
+	iio_attr_write(cgp->iio_num, "buffer/enable", "0");
+	iio_attr_write(cgp->iio_num, "scan_elements/in_voltage0_en", "0");
+	iio_attr_write(cgp->iio_num, "scan_elements/in_timestamp_en", "0");
+
+	num_elems = 0;
+	for (l = cg->channels; l; l = l->next) {
+		ch = l->data;
+		chp = ch->priv;
+		name = iio_scan_element_name(chp->ch_type);
+		if (!name)
+			return SR_ERR_BUG;
+		attr = g_strdup_printf("scan_elements/%s_en", name);
+		ret = iio_attr_write(cgp->iio_num, attr, ch->enabled ? "1" : "0");
+		g_free(attr);
+		if (ret != SR_OK) {
+			sr_err("Cannot configure IIO scan element %s.", name);
+			return ret;
+		}
+		if (!ch->enabled)
+			continue;
+		ret = iio_scan_element_get(cgp->iio_num, name, &chp->iio);
+		if (ret != SR_OK)
+			return ret;
+		chp->digits = type_digits(chp->ch_type);
+		/* Keep the elements in the order of their scan index. */
+		for (i = num_elems++; i && elems[i - 1]->iio.index > chp->iio.index; i--)
+			elems[i] = elems[i - 1];
+		elems[i] = chp;
+	}
+	if (!num_elems)
+		return SR_OK;
+
+	/* Elements are naturally aligned, so are the scans. */
+	offset = align = 0;
+	for (j = 0; j < num_elems; j++) {
+		offset = (offset + elems[j]->iio.bytes - 1) /
+			elems[j]->iio.bytes * elems[j]->iio.bytes;
+		elems[j]->iio.offset = offset;
+		offset += elems[j]->iio.bytes;
+		align = MAX(align, elems[j]->iio.bytes);
+	}
+	cgp->iio_scan_size = (offset + align - 1) / align * align;
+
+	snprintf(value, sizeof(value), "%" PRIu64, devc->samplerate);
+	if (iio_attr_write(cgp->iio_num, "sampling_frequency", value) != SR_OK)
+		sr_dbg("Probe %d keeps its sampling frequency.", cgp->index + 1);
+	snprintf(value, sizeof(value), "%d", 4 * IIO_READ_SCANS);
+	iio_attr_write(cgp->iio_num, "buffer/length", value);
+	ret = iio_attr_write(cgp->iio_num, "buffer/enable", "1");
+	if (ret != SR_OK) {
+		sr_err("Cannot enable the IIO buffer of probe %d.", cgp->index + 1);
+		return ret;
+	}
+
+	snprintf(value, sizeof(value), IIO_DEV_PATH, cgp->iio_num);
+	cgp->iio_fd = g_open(value, O_RDONLY | O_NONBLOCK, 0);
+	if (cgp->iio_fd < 0) {
+		sr_err("Error opening %s: %s", value, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	cgp->iio_buf = g_malloc(IIO_READ_SCANS * cgp->iio_scan_size);
+	cgp->iio_buf_used = 0;
+	for (j = 0; j < num_elems; j++)
+		elems[j]->iio_values = g_malloc(IIO_READ_SCANS * sizeof(float));
+
+	return SR_OK;
+}
+
+SR_PRIV int bl_acme_iio_start(const struct sr_dev_inst *sdi)
+{
+	struct sr_channel_group *cg;
+	struct channel_group_priv *cgp;
+	GSList *l;
+	int ret;
+
+	for (l = sdi->channel_groups; l; l = l->next) {
+		cg = l->data;
+		ret = iio_open_probe(sdi, cg);
+		if (ret == SR_OK)
+			continue;
+		for (l = sdi->channel_groups; l; l = l->next) {
+			cg = l->data;
+			iio_close_probe(cg->priv, cg);
+		}
+		return ret;
+	}
+
+	for (l = sdi->channel_groups; l; l = l->next) {
+		cgp = ((struct sr_channel_group *)l->data)->priv;
+		if (cgp->iio_fd < 0)
+			continue;
+		sr_session_source_add(sdi->session, cgp->iio_fd, G_IO_IN,
+			100, bl_acme_iio_receive_data, (void *)sdi);
+	}
+
+	return SR_OK;
+}
+
+SR_PRIV void bl_acme_iio_stop(const struct sr_dev_inst *sdi)
+{
+	struct sr_channel_group *cg;
+	struct channel_group_priv *cgp;
+	GSList *l;
+
+	for (l = sdi->channel_groups; l; l = l->next) {
+		cg = l->data;
+		cgp = cg->priv;
+		if (cgp->iio_fd >= 0)
+			sr_session_source_remove(sdi->session, cgp->iio_fd);
+		iio_close_probe(cgp, cg);
+	}
+}
+
+/* Send the complete scans read from a probe, one packet per channel. */
+static void iio_send_scans(const struct sr_dev_inst *sdi,
+			   struct sr_channel_group *cg, size_t num_scans)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct channel_group_priv *cgp;
+	struct channel_priv *chp;
+	struct sr_channel *ch;
+	GSList *l, chonly;
+	const uint8_t *scan;
+	size_t i;
+
+	cgp = cg->priv;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+
+	for (l = cg->channels; l; l = l->next) {
+		ch = l->data;
+		chp = ch->priv;
+		if (!ch->enabled || !chp->iio_values)
+			continue;
+		scan = cgp->iio_buf;
+		for (i = 0; i < num_scans; i++) {
+			chp->iio_values[i] = iio_scan_element_value(&chp->iio, scan);
+			scan += cgp->iio_scan_size;
+		}
+		/* Different units per channel, hence one packet each. */
+		chonly.next = NULL;
+		chonly.data = ch;
+		analog.num_samples = num_scans;
+		analog.meaning->channels = &chonly;
+		analog.meaning->mq = channel_to_mq(ch);
+		analog.meaning->unit = channel_to_unit(ch);
+		analog.encoding->digits = chp->digits;
+		analog.spec->spec_digits = chp->digits;
+		analog.data = chp->iio_values;
+		sr_session_send(sdi, &packet);
+	}
+}
+
+SR_PRIV int bl_acme_iio_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_channel_group *cg;
+	struct channel_group_priv *cgp;
+	size_t size, num_scans;
+	ssize_t len;
+	GSList *l;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	if (!sdi || !(devc = sdi->priv))
+		return TRUE;
+
+	/* Drain all probes' buffers, sources share this routine. */
+	for (l = sdi->channel_groups; l; l = l->next) {
+		cg = l->data;
+		cgp = cg->priv;
+		if (cgp->iio_fd < 0)
+			continue;
+		size = IIO_READ_SCANS * cgp->iio_scan_size;
+		len = read(cgp->iio_fd, cgp->iio_buf + cgp->iio_buf_used,
+			size - cgp->iio_buf_used);
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			sr_err("Error reading IIO buffer of probe %d: %s",
+				cgp->index + 1, g_strerror(errno));
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		cgp->iio_buf_used += len;
+		num_scans = cgp->iio_buf_used / cgp->iio_scan_size;
+		if (!num_scans)
+			continue;
+		iio_send_scans(sdi, cg, num_scans);
+		cgp->iio_buf_used -= num_scans * cgp->iio_scan_size;
+		memmove(cgp->iio_buf, cgp->iio_buf + num_scans * cgp->iio_scan_size,
+			cgp->iio_buf_used);
+
+		/* The probes sample at the same rate, count the first. */
+		if (l == sdi->channel_groups)
+			sr_sw_limits_update_samples_read(&devc->limits, num_scans);
+	}
+
+	if (sr_sw_limits_check(&devc->limits))
+		sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
@@ -49,9 +49,15 @@ enum probe_type {
 	PROBE_TEMP,
 };
 
+/* With the ina2xx IIO driver the kernel paces the samples. */
+#define MAX_SAMPLE_RATE		500 /* In Hz */
+#define MAX_IIO_SAMPLE_RATE	3500 /* In Hz */
+
 struct dev_context {
 	uint64_t samplerate;
 	struct sr_sw_limits limits;
+	/* All probes are IIO devices, use buffered capture. */
+	gboolean use_iio;
 
 	uint32_t num_channels;
 	uint64_t samples_missed;
@@ -89,4 +95,9 @@ SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data);
 SR_PRIV int bl_acme_open_channel(struct sr_channel *ch);
 
 SR_PRIV void bl_acme_close_channel(struct sr_channel *ch);
+
+SR_PRIV gboolean bl_acme_iio_available(const struct sr_dev_inst *sdi);
+SR_PRIV int bl_acme_iio_start(const struct sr_dev_inst *sdi);
+SR_PRIV void bl_acme_iio_stop(const struct sr_dev_inst *sdi);
+SR_PRIV int bl_acme_iio_receive_data(int fd, int revents, void *cb_data);
 #endif
@@ -37,6 +37,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_NUM_LOGIC_CHANNELS | SR_CONF_GET,
+	SR_CONF_UNDERRUN_COUNT | SR_CONF_GET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -198,8 +199,10 @@ static int dev_close(struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 
 	/* Close the memory mapping and the file */
-	if (devc->beaglelogic == &beaglelogic_native_ops)
+	if (devc->beaglelogic == &beaglelogic_native_ops) {
+		beaglelogic_native_units_free(devc);
 		devc->beaglelogic->munmap(devc);
+	}
 	devc->beaglelogic->close(devc);
 
 	return SR_OK;
@@ -237,6 +240,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_NUM_LOGIC_CHANNELS:
 		*data = g_variant_new_uint32(g_slist_length(sdi->channels));
 		break;
+	case SR_CONF_UNDERRUN_COUNT:
+		*data = g_variant_new_uint64(devc->overruns);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -332,6 +338,13 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (devc->triggerflags == BL_TRIGGERFLAGS_CONTINUOUS)
 		devc->limit_samples = UINT64_MAX;
 
+	/* Track the kernel buffer units which get lent to the session */
+	if (devc->beaglelogic == &beaglelogic_native_ops) {
+		beaglelogic_native_units_free(devc);
+		if (beaglelogic_native_units_new(devc) != SR_OK)
+			return SR_ERR;
+	}
+
 	/* Configure triggers & send header packet */
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
@@ -375,6 +388,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	/* Remove session source and send EOT packet */
 	sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
 	std_session_send_df_end(sdi);
+	if (devc->beaglelogic == &beaglelogic_native_ops)
+		beaglelogic_native_units_free(devc);
 
 	return SR_OK;
 }
@@ -32,9 +32,95 @@
 #include "protocol.h"
 #include "beaglelogic.h"
 
-/* Define data packet size independent of packet (bufunitsize bytes) size
- * from the BeagleLogic kernel module */
-#define PACKET_SIZE	(512 * 1024)
+/*
+ * Packets point straight into the mmap'ed kernel buffer, one packet per
+ * kernel buffer unit. Consumers which keep packets hold a reference on
+ * their unit. The PRU does not wait for them: in continuous mode a unit
+ * which still is referenced when its turn comes again has already been
+ * overwritten, and counts as an overrun. The reference counts outlive
+ * the acquisition when consumers hold on to packets.
+ */
+struct beaglelogic_units {
+	gint refcount;
+	guint num_units;
+	gint busy[];
+};
+
+struct beaglelogic_lent_unit {
+	struct beaglelogic_units *units;
+	guint index;
+};
+
+static void units_unref(struct beaglelogic_units *units)
+{
+	if (g_atomic_int_dec_and_test(&units->refcount))
+		g_free(units);
+}
+
+static void lent_unit_release(void *data)
+{
+	struct beaglelogic_lent_unit *lent;
+
+	lent = data;
+	g_atomic_int_add(&lent->units->busy[lent->index], -1);
+	units_unref(lent->units);
+	g_free(lent);
+}
+
+SR_PRIV int beaglelogic_native_units_new(struct dev_context *devc)
+{
+	struct beaglelogic_units *units;
+	guint num_units;
+
+	if (!devc->bufunitsize || devc->buffersize < devc->bufunitsize) {
+		sr_err("Invalid kernel buffer layout.");
+		return SR_ERR;
+	}
+	num_units = (devc->buffersize + devc->bufunitsize - 1) /
+		devc->bufunitsize;
+
+	units = g_malloc0(sizeof(*units) + num_units * sizeof(units->busy[0]));
+	units->refcount = 1;
+	units->num_units = num_units;
+	devc->units = units;
+	devc->overruns = 0;
+
+	return SR_OK;
+}
+
+SR_PRIV void beaglelogic_native_units_free(struct dev_context *devc)
+{
+	if (!devc->units)
+		return;
+
+	units_unref(devc->units);
+	devc->units = NULL;
+}
+
+/* Lend the data of the current buffer unit to the session. */
+static void send_unit_data(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct dev_context *devc;
+	struct beaglelogic_lent_unit *lent;
+	guint index;
+
+	devc = sdi->priv;
+	index = devc->offset / devc->bufunitsize;
+
+	if (g_atomic_int_get(&devc->units->busy[index])) {
+		devc->overruns++;
+		sr_dbg("Buffer unit %u still in use, overrun %" PRIu64 ".",
+			index, devc->overruns);
+	}
+
+	lent = g_malloc(sizeof(*lent));
+	lent->units = devc->units;
+	lent->index = index;
+	g_atomic_int_inc(&devc->units->busy[index]);
+	g_atomic_int_inc(&devc->units->refcount);
+	sr_session_send_lent(sdi, packet, lent_unit_release, lent);
+}
 
 /* This implementation is zero copy from the libsigrok side.
  * It does not copy any data, just passes a pointer from the mmap'ed
@@ -56,10 +142,18 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 	if (!(sdi = cb_data) || !(devc = sdi->priv))
 		return TRUE;
 
-	packetsize = PACKET_SIZE;
+	/* Keep in step with the kernel's buffer units. */
+	packetsize = devc->bufunitsize;
 	logic.unitsize = SAMPLEUNIT_TO_BYTES(devc->sampleunit);
 
-	if (revents == G_IO_IN) {
+	if (revents & G_IO_ERR) {
+		/* The kernel stops capturing when its buffer overran. */
+		devc->beaglelogic->get_lasterror(devc);
+		devc->overruns++;
+		sr_err("Capture buffer overrun (last error %d).",
+			devc->last_error);
+		packetsize = 0;
+	} else if (revents == G_IO_IN) {
 		sr_info("In callback G_IO_IN, offset=%d", devc->offset);
 
 		bytes_remaining = (devc->limit_samples * logic.unitsize) -
@@ -73,7 +167,7 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 
 		if (devc->trigger_fired) {
 			/* Send the incoming transfer to the session bus. */
-			sr_session_send(sdi, &packet);
+			send_unit_data(sdi, &packet);
 		} else {
 			/* Check for trigger */
 			trigger_offset = soft_trigger_logic_check(devc->stl,
@@ -85,7 +179,7 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 						bytes_remaining);
 				logic.data += trigger_offset;
 
-				sr_session_send(sdi, &packet);
+				send_unit_data(sdi, &packet);
 
 				devc->trigger_fired = TRUE;
 			}
@@ -109,9 +203,12 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 	/* EOF Received or we have reached the limit */
 	if (devc->bytes_read >= devc->limit_samples * logic.unitsize ||
 			packetsize == 0) {
+		if (devc->overruns)
+			sr_warn("%" PRIu64 " buffer overruns.", devc->overruns);
 		/* Send EOA Packet, stop polling */
 		std_session_send_df_end(sdi);
 		sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
+		beaglelogic_native_units_free(devc);
 	}
 
 	return TRUE;
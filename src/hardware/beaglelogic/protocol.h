@@ -34,6 +34,8 @@
 
 #define TCP_BUFFER_SIZE         (128 * 1024)
 
+struct beaglelogic_units;
+
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	int max_channels;
@@ -68,12 +70,17 @@ struct dev_context {
 	uint64_t sent_samples;
 	uint32_t offset;
 	uint8_t *sample_buf;	/* mmap'd kernel buffer here */
+	/* Buffer units which the session still holds, see protocol.c */
+	struct beaglelogic_units *units;
+	uint64_t overruns;
 
 	/* Trigger logic */
 	struct soft_trigger_logic *stl;
 	gboolean trigger_fired;
 };
 
+SR_PRIV int beaglelogic_native_units_new(struct dev_context *devc);
+SR_PRIV void beaglelogic_native_units_free(struct dev_context *devc);
 SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data);
 SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data);
 
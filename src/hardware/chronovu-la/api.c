@@ -146,7 +146,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
@@ -392,19 +392,18 @@ static int receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 	}
 
-	/* Get one block of data. */
-	if ((ret = cv_read_block(devc)) < 0) {
+	if (!devc->stream)
+		return TRUE;
+
+	/* Handle received data, until NUM_BLOCKS blocks (i.e. 8MB) are in. */
+	if ((ret = cv_stream_poll(devc)) == SR_OK)
+		return TRUE;
+	if (ret != SR_ERR_NA) {
 		sr_err("Failed to read data block: %d.", ret);
 		sr_dev_acquisition_stop(sdi);
 		return FALSE;
 	}
 
-	/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
-	if (devc->block_counter != (NUM_BLOCKS - 1)) {
-		devc->block_counter++;
-		return TRUE;
-	}
-
 	sr_dbg("Sampling finished, sending data to session bus now.");
 
 	/*
@@ -479,9 +478,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	/* Time when we should be done (for detecting trigger timeouts). */
 	devc->done = (devc->divcount + 1) * devc->prof->trigger_constant +
 			g_get_monotonic_time() + (10 * G_TIME_SPAN_SECOND);
-	devc->block_counter = 0;
 	devc->trigger_found = 0;
 
+	if (cv_stream_start(devc) != SR_OK) {
+		sr_err("Failed to start reading data.");
+		std_session_send_df_end(sdi);
+		return SR_ERR;
+	}
+
 	/* Hook up a dummy handler to receive data from the device. */
 	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
 
@@ -490,6 +494,11 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	cv_stream_stop(devc);
 	sr_session_source_remove(sdi->session, -1);
 	std_session_send_df_end(sdi);
 
@@ -348,42 +348,14 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
 }
 
 /**
- * Get a block of data from the device.
+ * De-mangle the block in devc->mangled_buf into the final buffer.
  *
- * @param devc The struct containing private per-device-instance data. Must not
- *             be NULL. devc->ftdic must not be NULL either.
- *
- * @return SR_OK upon success, or SR_ERR upon errors.
+ * @param devc The struct containing private per-device-instance data.
  */
-SR_PRIV int cv_read_block(struct dev_context *devc)
+static void demangle_block(struct dev_context *devc)
 {
-	int i, byte_offset, m, mi, p, q, index, bytes_read;
-	gint64 now;
-
-	/* Note: Caller checked that devc and devc->ftdic != NULL. */
-
-	sr_spew("Reading block %d.", devc->block_counter);
+	int i, byte_offset, m, mi, p, q, index;
 
-	bytes_read = cv_read(devc, devc->mangled_buf, BS);
-
-	/* If first block read got 0 bytes, retry until success or timeout. */
-	if ((bytes_read == 0) && (devc->block_counter == 0)) {
-		do {
-			sr_spew("Reading block 0 (again).");
-			/* Note: If bytes_read < 0 cv_read() will log errors. */
-			bytes_read = cv_read(devc, devc->mangled_buf, BS);
-			now = g_get_monotonic_time();
-		} while ((devc->done > now) && (bytes_read == 0));
-	}
-
-	/* Check if block read was successful or a timeout occurred. */
-	if (bytes_read != BS) {
-		sr_err("Trigger timed out. Bytes read: %d.", bytes_read);
-		(void) reset_device(devc); /* Ignore errors. */
-		return SR_ERR;
-	}
-
-	/* De-mangle the data. */
 	sr_spew("Demangling block %d.", devc->block_counter);
 	byte_offset = devc->block_counter * BS;
 	m = byte_offset / (1024 * 1024);
@@ -401,10 +373,110 @@ SR_PRIV int cv_read_block(struct dev_context *devc)
 		}
 		devc->final_buf[index] = devc->mangled_buf[i];
 	}
+}
+
+/* Collect received data into blocks, de-mangle every complete block. */
+static int receive_block_data(void *cb_data, const uint8_t *data, size_t len)
+{
+	struct dev_context *devc;
+	size_t n;
+
+	devc = cb_data;
+
+	while (len) {
+		n = MIN(len, (size_t)(BS - devc->block_fill));
+		memcpy(devc->mangled_buf + devc->block_fill, data, n);
+		devc->block_fill += n;
+		data += n;
+		len -= n;
+		if (devc->block_fill < BS)
+			break;
+
+		demangle_block(devc);
+		devc->block_fill = 0;
+
+		/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
+		if (++devc->block_counter == NUM_BLOCKS)
+			return SR_ERR_NA;
+	}
 
 	return SR_OK;
 }
 
+/**
+ * Start receiving the sample memory, with several transfers in flight.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL. devc->ftdic must not be NULL either.
+ *
+ * @return SR_OK upon success, or SR_ERR upon errors.
+ */
+SR_PRIV int cv_stream_start(struct dev_context *devc)
+{
+	devc->block_counter = 0;
+	devc->block_fill = 0;
+
+	devc->stream = sr_ftdi_stream_new(devc->ftdic, NUM_TRANSFERS,
+		TRANSFER_SIZE, receive_block_data, devc);
+	if (!devc->stream)
+		return SR_ERR;
+
+	if (sr_ftdi_stream_start(devc->stream) != SR_OK) {
+		sr_ftdi_stream_free(devc->stream);
+		devc->stream = NULL;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Stop receiving, and release the transfers.
+ *
+ * @param devc The struct containing private per-device-instance data.
+ */
+SR_PRIV void cv_stream_stop(struct dev_context *devc)
+{
+	sr_ftdi_stream_free(devc->stream);
+	devc->stream = NULL;
+}
+
+/**
+ * Handle received data.
+ *
+ * The device only starts to send after the trigger matched, a timeout
+ * is detected while the first block is outstanding.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL. devc->stream must not be NULL either.
+ *
+ * @retval SR_OK Still receiving.
+ * @retval SR_ERR_NA All NUM_BLOCKS blocks were received and de-mangled.
+ * @retval SR_ERR Errors, or the trigger timed out.
+ */
+SR_PRIV int cv_stream_poll(struct dev_context *devc)
+{
+	int ret;
+
+	ret = sr_ftdi_stream_poll(devc->stream, 10);
+	if (ret == SR_OK) {
+		if (devc->block_counter || devc->block_fill ||
+		    g_get_monotonic_time() < devc->done)
+			return SR_OK;
+		sr_err("Trigger timed out.");
+		ret = SR_ERR;
+	}
+
+	cv_stream_stop(devc);
+	if (ret == SR_ERR_NA)
+		return ret;
+
+	sr_err("Failed to read data block %d.", devc->block_counter);
+	(void) reset_device(devc); /* Ignore errors. */
+
+	return SR_ERR;
+}
+
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block)
 {
 	int i, idx;
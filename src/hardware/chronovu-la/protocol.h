@@ -36,6 +36,10 @@
 #define BS				4096 /* Block size */
 #define NUM_BLOCKS			2048 /* Number of blocks */
 
+/* Bulk IN transfers kept in flight while reading the SDRAM. */
+#define NUM_TRANSFERS			8
+#define TRANSFER_SIZE			(16 * 1024)
+
 enum {
 	CHRONOVU_LA8,
 	CHRONOVU_LA16,
@@ -103,6 +107,12 @@ struct dev_context {
 	/** Counter/index for the data block to be read. */
 	int block_counter;
 
+	/** Number of bytes received for the current block. */
+	int block_fill;
+
+	/** Receives the SDRAM contents while an acquisition is running. */
+	struct sr_ftdi_stream *stream;
+
 	/** The divcount value (determines the sample period). */
 	uint8_t divcount;
 
@@ -122,7 +132,9 @@ SR_PRIV uint8_t cv_samplerate_to_divcount(const struct sr_dev_inst *sdi,
 SR_PRIV int cv_write(struct dev_context *devc, uint8_t *buf, int size);
 SR_PRIV int cv_convert_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate);
-SR_PRIV int cv_read_block(struct dev_context *devc);
+SR_PRIV int cv_stream_start(struct dev_context *devc);
+SR_PRIV void cv_stream_stop(struct dev_context *devc);
+SR_PRIV int cv_stream_poll(struct dev_context *devc);
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block);
 
 #endif
@@ -69,6 +69,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_MAX_THROUGHPUT | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -147,6 +149,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devc->num_analog_channels = num_analog_channels;
 	devc->limit_frames = limit_frames;
 	devc->capture_ratio = 20;
+	devc->tile_size = DEFAULT_TILE_SIZE;
 	devc->stl = NULL;
 
 	if (num_logic_channels > 0) {
@@ -220,6 +223,7 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	demo_free_tile(devc);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -315,6 +319,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_MAX_THROUGHPUT:
+		*data = g_variant_new_boolean(devc->max_throughput);
+		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->tile_size);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -428,6 +438,14 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_MAX_THROUGHPUT:
+		devc->max_throughput = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_BUFFERSIZE:
+		if (!g_variant_get_uint64(data))
+			return SR_ERR_ARG;
+		devc->tile_size = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -502,8 +520,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->sent_samples = 0;
 	devc->sent_frame_samples = 0;
 
+	trigger = sr_session_trigger_get(sdi->session);
+	if (devc->max_throughput) {
+		if (trigger)
+			sr_warn("Triggers are ignored at maximum throughput.");
+		trigger = NULL;
+	}
+
 	/* Setup triggers */
-	if ((trigger = sr_session_trigger_get(sdi->session))) {
+	if (trigger) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
@@ -561,8 +586,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
-			demo_prepare_data, (struct sr_dev_inst *)sdi);
+	if (devc->max_throughput && devc->enabled_logic_channels) {
+		/*
+		 * Only logic data gets sent, from a pattern generated in
+		 * advance. Keep the event loop spinning, the callback
+		 * itself limits the time it runs.
+		 */
+		if (demo_prepare_tile(sdi) != SR_OK)
+			return SR_ERR_MALLOC;
+		sr_session_source_add(sdi->session, -1, 0, 0,
+				demo_send_tiles, (struct sr_dev_inst *)sdi);
+	} else {
+		sr_session_source_add(sdi->session, -1, 0, 100,
+				demo_prepare_data, (struct sr_dev_inst *)sdi);
+	}
 
 	std_session_send_df_header(sdi);
 
@@ -593,6 +630,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
+	demo_free_tile(devc);
 
 	return SR_OK;
 }
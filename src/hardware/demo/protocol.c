@@ -399,6 +399,57 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+/*
+ * Generate the logic data for max throughput mode, as one tile of the
+ * configured packet size. The pattern continues across the generator's
+ * chunks, but restarts when the tile repeats.
+ */
+SR_PRIV int demo_prepare_tile(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_logic logic;
+	size_t length, chunk, done;
+
+	devc = sdi->priv;
+	demo_free_tile(devc);
+
+	length = devc->tile_size - devc->tile_size % devc->logic_unitsize;
+	if (!length)
+		length = devc->logic_unitsize;
+	devc->tile = g_try_malloc(length);
+	if (!devc->tile) {
+		sr_err("Cannot allocate %zu bytes of pattern data.", length);
+		return SR_ERR_MALLOC;
+	}
+
+	devc->step = 0;
+	if (devc->logic_pattern == PATTERN_ALL_LOW)
+		memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
+	else if (devc->logic_pattern == PATTERN_ALL_HIGH)
+		memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
+	chunk = LOGIC_BUFSIZE - LOGIC_BUFSIZE % devc->logic_unitsize;
+	for (done = 0; done < length; done += chunk) {
+		chunk = MIN(chunk, length - done);
+		logic_generator((struct sr_dev_inst *)sdi, chunk);
+		memcpy(devc->tile + done, devc->logic_data, chunk);
+	}
+
+	logic.length = length;
+	logic.unitsize = devc->logic_unitsize;
+	logic.data = devc->tile;
+	logic_fixup_feed(devc, &logic);
+	devc->tile_length = length;
+
+	return SR_OK;
+}
+
+SR_PRIV void demo_free_tile(struct dev_context *devc)
+{
+	g_free(devc->tile);
+	devc->tile = NULL;
+	devc->tile_length = 0;
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -572,6 +623,61 @@ do_send:
 	}
 }
 
+/*
+ * Callback handling data in max throughput mode. Sends the pre-generated
+ * tile as often as fits in a time slice, then returns to the event loop
+ * so that the acquisition can get stopped.
+ */
+SR_PRIV int demo_send_tiles(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t samples, tile_samples;
+	int64_t now, slice_end;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = devc->logic_unitsize;
+	logic.data = devc->tile;
+	tile_samples = devc->tile_length / devc->logic_unitsize;
+
+	now = g_get_monotonic_time();
+	slice_end = now + TILE_SLICE_US;
+	do {
+		if (devc->limit_msec &&
+				now - devc->start_us >= (int64_t)devc->limit_msec * 1000)
+			break;
+		samples = tile_samples;
+		if (devc->limit_samples) {
+			if (devc->sent_samples >= devc->limit_samples)
+				break;
+			samples = MIN(samples,
+				devc->limit_samples - devc->sent_samples);
+		}
+		logic.length = samples * devc->logic_unitsize;
+		sr_session_send(sdi, &packet);
+		devc->sent_samples += samples;
+		now = g_get_monotonic_time();
+	} while (now < slice_end);
+
+	if ((devc->limit_samples && devc->sent_samples >= devc->limit_samples) ||
+			(devc->limit_msec &&
+			now - devc->start_us >= (int64_t)devc->limit_msec * 1000)) {
+		sr_dbg("Requested number of samples reached.");
+		sr_dev_acquisition_stop(sdi);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
 /* Callback handling data */
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 {
@@ -37,6 +37,9 @@
 /* This is a development feature: it starts a new frame every n samples. */
 #define SAMPLES_PER_FRAME		1000UL
 #define DEFAULT_LIMIT_FRAMES		0
+/* Packet size, and time slice per event loop iteration at max throughput. */
+#define DEFAULT_TILE_SIZE		(1024 * 1024)
+#define TILE_SLICE_US			(10 * 1000)
 
 #define DEFAULT_ANALOG_ENCODING_DIGITS	4
 #define DEFAULT_ANALOG_SPEC_DIGITS		4
@@ -138,6 +141,14 @@ struct dev_context {
 	size_t enabled_analog_channels;
 	size_t first_partial_logic_index;
 	uint8_t first_partial_logic_mask;
+	/*
+	 * Max throughput mode: a tile of logic data gets generated once,
+	 * and is sent over and over without pacing.
+	 */
+	gboolean max_throughput;
+	uint64_t tile_size;
+	uint8_t *tile;
+	size_t tile_length;
 	/* Triggers */
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
@@ -162,6 +173,9 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV int demo_prepare_tile(const struct sr_dev_inst *sdi);
+SR_PRIV void demo_free_tile(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
+SR_PRIV int demo_send_tiles(int fd, int revents, void *cb_data);
 
 #endif
@@ -21,6 +21,7 @@
 #include <config.h>
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "protocol.h"
@@ -137,6 +138,7 @@ struct fpga_config {
  * it in chunks.
  */
 #define FW_BUFSIZE (1024 * 1024)
+#define FW_SIZE_LIMIT (8 * 1024 * 1024)
 
 #define FPGA_UPLOAD_DELAY (10 * 1000)
 
@@ -220,17 +222,14 @@ static int command_stop_acquisition(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
+static int fpga_firmware_upload(const struct sr_dev_inst *sdi)
 {
 	const char *name = NULL;
-	uint64_t sum;
-	struct sr_resource bitstream;
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	unsigned char *buf;
-	ssize_t chunksize;
-	int transferred;
+	uint8_t *bitstream;
+	size_t bitstream_size;
 	int result, ret;
 	const uint8_t cmd[3] = {0, 0, 0};
 
@@ -258,53 +257,28 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Uploading FPGA firmware '%s'.", name);
 
-	result = sr_resource_open(drvc->sr_ctx, &bitstream,
-			SR_RESOURCE_FIRMWARE, name);
-	if (result != SR_OK)
-		return result;
+	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			name, &bitstream_size, FW_SIZE_LIMIT);
+	if (!bitstream)
+		return SR_ERR;
 
 	/* Tell the device firmware is coming. */
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
 			LIBUSB_ENDPOINT_OUT, DS_CMD_CONFIG, 0x0000, 0x0000,
 			(unsigned char *)&cmd, sizeof(cmd), USB_TIMEOUT)) < 0) {
 		sr_err("Failed to upload FPGA firmware: %s.", libusb_error_name(ret));
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_free(bitstream);
 		return SR_ERR;
 	}
 
 	/* Give the FX2 time to get ready for FPGA firmware upload. */
 	g_usleep(FPGA_UPLOAD_DELAY);
 
-	buf = g_malloc(FW_BUFSIZE);
-	sum = 0;
-	result = SR_OK;
-	while (1) {
-		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-				buf, FW_BUFSIZE);
-		if (chunksize < 0)
-			result = SR_ERR;
-		if (chunksize <= 0)
-			break;
-
-		if ((ret = libusb_bulk_transfer(usb->devhdl, 2 | LIBUSB_ENDPOINT_OUT,
-				buf, chunksize, &transferred, USB_TIMEOUT)) < 0) {
-			sr_err("Unable to configure FPGA firmware: %s.",
-					libusb_error_name(ret));
-			result = SR_ERR;
-			break;
-		}
-		sum += transferred;
-		sr_spew("Uploaded %" PRIu64 "/%" PRIu64 " bytes.",
-			sum, bitstream.size);
-
-		if (transferred != chunksize) {
-			sr_err("Short transfer while uploading FPGA firmware.");
-			result = SR_ERR;
-			break;
-		}
-	}
-	g_free(buf);
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	result = sr_usb_bulk_write(drvc->sr_ctx, usb, 2 | LIBUSB_ENDPOINT_OUT,
+			bitstream, bitstream_size, FW_BUFSIZE, USB_TIMEOUT);
+	if (result != SR_OK)
+		sr_err("Unable to configure FPGA firmware.");
+	g_free(bitstream);
 
 	if (result == SR_OK)
 		sr_dbg("FPGA firmware upload done.");
@@ -312,6 +286,18 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 	return result;
 }
 
+SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
+{
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_FPGA_CONFIG, NULL, sdi);
+	ret = fpga_firmware_upload(sdi);
+	sr_profile_end(&scope, ret);
+
+	return ret;
+}
+
 static unsigned int enabled_channel_count(const struct sr_dev_inst *sdi)
 {
 	unsigned int count = 0;
@@ -325,13 +311,7 @@ static unsigned int enabled_channel_count(const struct sr_dev_inst *sdi)
 
 static uint16_t enabled_channel_mask(const struct sr_dev_inst *sdi)
 {
-	unsigned int mask = 0;
-	for (const GSList *l = sdi->channels; l; l = l->next) {
-		const struct sr_channel *const probe = (struct sr_channel *)l->data;
-		if (probe->enabled)
-			mask |= 1 << probe->index;
-	}
-	return mask;
+	return sr_dev_channel_layout(sdi)->logic_mask & 0xffff;
 }
 
 /*
@@ -696,9 +676,7 @@ static void free_transfer(struct libusb_transfer *transfer)
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
+	sr_usb_transfer_put(sdi->conn, transfer);
 
 	for (i = 0; i < devc->num_transfers; i++) {
 		if (devc->transfers[i] == transfer) {
@@ -716,7 +694,7 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	if ((ret = sr_usb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
@@ -724,30 +702,85 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
+/*
+ * The device sends blocks of one 64bit word per enabled channel, each
+ * word holds 64 consecutive samples of that channel. Map the words to
+ * the bit positions of their channels and have them transposed.
+ */
 static void deinterleave_buffer(const uint8_t *src, size_t length,
 	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
+	const size_t block_size = channel_count * sizeof(uint64_t);
+	const uint8_t *planes[16];
+	size_t channel, plane;
+
+	plane = 0;
+	for (channel = 0; channel < ARRAY_SIZE(planes); channel++) {
+		if (channel_mask & (1 << channel))
+			planes[channel] = src + plane++ * sizeof(uint64_t);
+		else
+			planes[channel] = NULL;
+	}
+
+	while (length >= block_size) {
+		sr_bitplanes_to_samples((uint8_t *)dst_ptr, sizeof(*dst_ptr),
+			planes, sizeof(uint64_t));
+		dst_ptr += 64;
+		length -= block_size;
+		for (channel = 0; channel < ARRAY_SIZE(planes); channel++) {
+			if (planes[channel])
+				planes[channel] += block_size;
+		}
+	}
+}
+
+/*
+ * Consumers which take planar logic data get the words of each channel
+ * gathered into one contiguous plane, which needs no transpose at all.
+ */
+static void gather_planes(const uint8_t *src, size_t length,
+	uint8_t *dst, uint8_t **planes, size_t channel_count,
+	uint16_t channel_mask)
+{
+	const size_t block_size = channel_count * sizeof(uint64_t);
+	const size_t num_blocks = length / block_size;
+	size_t channel, plane, block;
+	uint8_t *wrptr;
+
+	plane = 0;
+	for (channel = 0; channel < 16; channel++) {
+		if (!(channel_mask & (1 << channel))) {
+			planes[channel] = NULL;
+			continue;
 		}
+		planes[channel] = wrptr = dst;
+		for (block = 0; block < num_blocks; block++) {
+			memcpy(wrptr, src + block * block_size +
+				plane * sizeof(uint64_t), sizeof(uint64_t));
+			wrptr += sizeof(uint64_t);
+		}
+		dst = wrptr;
+		plane++;
 	}
 }
 
+static void send_planar_data(struct sr_dev_inst *sdi,
+	uint8_t **planes, size_t sample_count)
+{
+	const struct sr_datafeed_logic_planar planar = {
+		.num_samples = sample_count,
+		.unitsize = sizeof(uint16_t),
+		.planes = planes
+	};
+
+	const struct sr_datafeed_packet packet = {
+		.type = SR_DF_LOGIC_PLANAR,
+		.payload = &planar
+	};
+
+	sr_session_send(sdi, &packet);
+}
+
 static void send_data(struct sr_dev_inst *sdi,
 	uint16_t *data, size_t sample_count)
 {
@@ -790,6 +823,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
+	sr_usb_capture_transfer(sdi, transfer);
 
 	/* Save incoming transfer before reusing the transfer struct. */
 
@@ -842,12 +877,15 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
 
 		/* Send the incoming transfer to the session bus. */
 		if (devc->trigger_pos > devc->sent_samples
 			&& devc->trigger_pos <= devc->sent_samples + num_samples) {
+			/* Planes can't get split at arbitrary samples. */
+			deinterleave_buffer(transfer->buffer,
+				transfer->actual_length,
+				devc->deinterleave_buffer,
+				channel_count, channel_mask);
 			/* DSLogic trigger in this block. Send trigger position. */
 			trigger_offset = devc->trigger_pos - devc->sent_samples;
 			/* Pre-trigger samples. */
@@ -861,7 +899,17 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 			send_data(sdi, devc->deinterleave_buffer
 				+ trigger_offset, num_samples);
 			devc->sent_samples += num_samples;
+		} else if (devc->send_planar) {
+			gather_planes(transfer->buffer, transfer->actual_length,
+				(uint8_t *)devc->deinterleave_buffer,
+				devc->planes, channel_count, channel_mask);
+			send_planar_data(sdi, devc->planes, num_samples);
+			devc->sent_samples += num_samples;
 		} else {
+			deinterleave_buffer(transfer->buffer,
+				transfer->actual_length,
+				devc->deinterleave_buffer,
+				channel_count, channel_mask);
 			send_data(sdi, devc->deinterleave_buffer, num_samples);
 			devc->sent_samples += num_samples;
 		}
@@ -946,7 +994,6 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	struct libusb_transfer *transfer;
 	unsigned int i;
 	int ret;
-	unsigned char *buf;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -955,6 +1002,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
 	devc->submitted_transfers = 0;
+	devc->send_planar = sr_session_logic_planar_wanted(sdi->session);
 
 	g_free(devc->transfers);
 	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
@@ -973,20 +1021,16 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 
 	devc->num_transfers = num_transfers;
 	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
+		if (!(transfer = sr_usb_transfer_get(usb, size)))
 			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
 		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				6 | LIBUSB_ENDPOINT_IN, buf, size,
+				6 | LIBUSB_ENDPOINT_IN, transfer->buffer, size,
 				receive_transfer, (void *)sdi, timeout);
 		sr_info("submitting transfer: %d", i);
 		if ((ret = libusb_submit_transfer(transfer)) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+			sr_usb_transfer_put(usb, transfer);
 			abort_acquisition(devc);
 			return SR_ERR;
 		}
@@ -1053,7 +1097,9 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
 
-	if ((ret = fpga_configure(sdi)) != SR_OK)
+	/* The FPGA keeps its setup when the session gets rearmed. */
+	if (!sr_dev_acquisition_rearmed(sdi) &&
+			(ret = fpga_configure(sdi)) != SR_OK)
 		return ret;
 
 	if ((ret = command_start_acquisition(sdi)) != SR_OK)
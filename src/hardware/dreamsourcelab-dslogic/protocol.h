@@ -133,6 +133,9 @@ struct dev_context {
 	struct sr_context *ctx;
 
 	uint16_t *deinterleave_buffer;
+	/* Send SR_DF_LOGIC_PLANAR, from planes in deinterleave_buffer. */
+	gboolean send_planar;
+	uint8_t *planes[16];
 
 	uint16_t mode;
 	uint32_t trigger_pos;
@@ -140,9 +140,6 @@ static void scan_device(struct ftdi_context *ftdic,
 
 	devc = g_malloc0(sizeof(struct dev_context));
 
-	/* Allocate memory for the incoming data. */
-	devc->data_buf = g_malloc0(DATA_BUF_SIZE);
-
 	devc->desc = desc;
 
 	vendor = g_malloc(usb_str_maxlen);
@@ -212,7 +209,6 @@ err_free_strings:
 	g_free(vendor);
 	g_free(model);
 	g_free(serial_num);
-	g_free(devc->data_buf);
 	g_free(devc);
 }
 
@@ -277,7 +273,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		devices = NULL;
 		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 		for (i = 0; devlist[i]; i++) {
-			conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+			conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 			for (l = conn_devices; l; l = l->next) {
 				usb = l->data;
 				if (usb->bus == libusb_get_bus_number(devlist[i])
@@ -295,14 +291,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	return std_scan_complete(di, devices);
 }
 
-static void clear_helper(struct dev_context *devc)
-{
-	g_free(devc->data_buf);
-}
-
 static int dev_clear(const struct sr_dev_driver *di)
 {
-	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+	return std_dev_clear(di);
 }
 
 static int dev_open(struct sr_dev_inst *sdi)
@@ -462,11 +453,18 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Properly reset internal variables before every new acquisition. */
 	devc->samples_sent = 0;
-	devc->bytes_received = 0;
+
+	/* Drop stale data, the stream bypasses libftdi's read buffer. */
+	PURGE_FTDI_BOTH(devc->ftdic);
+
+	if (ftdi_la_start_stream((struct sr_dev_inst *)sdi) != SR_OK) {
+		sr_err("Failed to start the FTDI data stream.");
+		return SR_ERR;
+	}
 
 	std_session_send_df_header(sdi);
 
-	/* Hook up a dummy handler to receive data from the device. */
+	/* Hook up a dummy handler which completes the stream's transfers. */
 	sr_session_source_add(sdi->session, -1, G_IO_IN, 0,
 			      ftdi_la_receive_data, (void *)sdi);
 
@@ -475,8 +473,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
 	sr_session_source_remove(sdi->session, -1);
 
+	sr_ftdi_stream_free(devc->stream);
+	devc->stream = NULL;
+
 	std_session_send_df_end(sdi);
 
 	return SR_OK;
@@ -21,7 +21,8 @@
 #include <ftdi.h>
 #include "protocol.h"
 
-static void send_samples(struct sr_dev_inst *sdi, uint64_t samples_to_send)
+static void send_samples(struct sr_dev_inst *sdi,
+	const uint8_t *data, uint64_t samples_to_send)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -35,11 +36,53 @@ static void send_samples(struct sr_dev_inst *sdi, uint64_t samples_to_send)
 	packet.payload = &logic;
 	logic.length = samples_to_send;
 	logic.unitsize = 1;
-	logic.data = devc->data_buf;
+	logic.data = (void *)data;
 	sr_session_send(sdi, &packet);
 
 	devc->samples_sent += samples_to_send;
-	devc->bytes_received -= samples_to_send;
+}
+
+/* Takes the payload of each received USB packet, one byte per sample. */
+static int receive_samples(void *cb_data, const uint8_t *data, size_t len)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	if (devc->limit_samples &&
+	    devc->samples_sent + len >= devc->limit_samples) {
+		send_samples(sdi, data, devc->limit_samples - devc->samples_sent);
+		sr_info("Requested number of samples reached.");
+		return SR_ERR_NA;
+	}
+
+	send_samples(sdi, data, len);
+
+	return SR_OK;
+}
+
+SR_PRIV int ftdi_la_start_stream(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int ret;
+
+	devc = sdi->priv;
+
+	devc->stream = sr_ftdi_stream_new(devc->ftdic, NUM_TRANSFERS,
+		TRANSFER_SIZE, receive_samples, sdi);
+	if (!devc->stream)
+		return SR_ERR;
+
+	ret = sr_ftdi_stream_start(devc->stream);
+	if (ret != SR_OK) {
+		sr_ftdi_stream_free(devc->stream);
+		devc->stream = NULL;
+		return ret;
+	}
+
+	return SR_OK;
 }
 
 SR_PRIV int ftdi_la_set_samplerate(struct dev_context *devc)
@@ -60,8 +103,7 @@ SR_PRIV int ftdi_la_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	int bytes_read;
-	uint64_t n;
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -72,34 +114,19 @@ SR_PRIV int ftdi_la_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
-	if (!devc->ftdic)
+	if (!devc->stream)
 		return TRUE;
 
-	/* Get a block of data. */
-	bytes_read = ftdi_read_data(devc->ftdic, devc->data_buf, DATA_BUF_SIZE);
-	if (bytes_read < 0) {
-		sr_err("Failed to read FTDI data (%d): %s.",
-		       bytes_read, ftdi_get_error_string(devc->ftdic));
-		sr_dev_acquisition_stop(sdi);
-		return FALSE;
-	}
-	if (bytes_read == 0) {
-		sr_spew("Received 0 bytes, nothing to do.");
+	/* Handle completed transfers, the stream ends at the sample limit. */
+	ret = sr_ftdi_stream_poll(devc->stream, 10);
+	if (ret == SR_OK)
 		return TRUE;
-	}
-	sr_spew("Got some data.");
-	devc->bytes_received += bytes_read;
-
-	n = devc->samples_sent + devc->bytes_received;
-
-	if (devc->limit_samples && (n >= devc->limit_samples)) {
-		send_samples(sdi, devc->limit_samples - devc->samples_sent);
-		sr_info("Requested number of samples reached.");
+	if (ret != SR_ERR_NA) {
+		sr_err("Failed to read FTDI data (%d).", ret);
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else {
-		send_samples(sdi, devc->bytes_received);
+		return FALSE;
 	}
+	sr_dev_acquisition_stop(sdi);
 
 	return TRUE;
 }
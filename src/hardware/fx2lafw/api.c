@@ -132,6 +132,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LATENCY_TARGET | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_UNDERRUN_COUNT | SR_CONF_GET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -199,8 +201,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	gboolean has_firmware;
 	struct libusb_device_descriptor des;
 	libusb_device **devlist;
-	struct libusb_device_handle *hdl;
-	int ret, i;
+	int i;
 	size_t j, num_logic_channels, num_analog_channels;
 	const char *conn;
 	const char *probe_names;
@@ -224,13 +225,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -251,44 +252,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (!is_plausible(&des))
 			continue;
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0) {
-			sr_warn("Failed to open potential device with "
-				"VID:PID %04x:%04x: %s.", des.idVendor,
-				des.idProduct, libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iManufacturer == 0) {
-			manufacturer[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iManufacturer, (unsigned char *) manufacturer,
-				sizeof(manufacturer))) < 0) {
-			sr_warn("Failed to get manufacturer string descriptor: %s.",
-				libusb_error_name(ret));
+		if (sr_usb_get_strings(drvc->sr_ctx, devlist[i], manufacturer,
+				product, serial_num, sizeof(manufacturer)) != SR_OK)
 			continue;
-		}
-
-		if (des.iProduct == 0) {
-			product[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, (unsigned char *) product,
-				sizeof(product))) < 0) {
-			sr_warn("Failed to get product string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iSerialNumber == 0) {
-			serial_num[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iSerialNumber, (unsigned char *) serial_num,
-				sizeof(serial_num))) < 0) {
-			sr_warn("Failed to get serial number string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		libusb_close(hdl);
 
 		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
@@ -369,7 +335,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		devc->samplerates = samplerates;
 		devc->num_samplerates = ARRAY_SIZE(samplerates);
-		has_firmware = usb_match_manuf_prod(devlist[i],
+		has_firmware = usb_match_manuf_prod(drvc->sr_ctx, devlist[i],
 				"sigrok", "fx2lafw");
 
 		if (has_firmware) {
@@ -396,7 +362,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 					0xff, NULL);
 		}
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
 	return std_scan_complete(di, devices);
@@ -412,13 +378,18 @@ static int dev_clear(const struct sr_dev_driver *di)
 	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
 }
 
+/* Opens the device once it came back after the firmware upload. */
+static int renum_probe(struct sr_dev_inst *sdi)
+{
+	return fx2lafw_dev_open(sdi, sdi->driver);
+}
+
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct sr_dev_driver *di = sdi->driver;
 	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
 	int ret;
-	int64_t timediff_us, timediff_ms;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -430,23 +401,12 @@ static int dev_open(struct sr_dev_inst *sdi)
 	ret = SR_ERR;
 	if (devc->fw_updated > 0) {
 		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((ret = fx2lafw_dev_open(sdi, di)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
+		ret = usb_wait_renumeration(sdi, devc->fw_updated,
+			MAX_RENUM_DELAY_MS, renum_probe);
 		if (ret != SR_OK) {
 			sr_err("Device failed to renumerate.");
 			return SR_ERR;
 		}
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
 	} else {
 		sr_info("Firmware upload was not needed.");
 		ret = fx2lafw_dev_open(sdi, di);
@@ -496,6 +456,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
+	sr_usb_transfer_pool_free(usb);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
 
@@ -538,6 +499,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_LATENCY_TARGET:
+		*data = g_variant_new_uint64(devc->latency_target);
+		break;
+	case SR_CONF_UNDERRUN_COUNT:
+		*data = g_variant_new_uint64(devc->num_underruns);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +540,11 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_LATENCY_TARGET:
+		if (g_variant_get_uint64(data) == 0)
+			return SR_ERR_ARG;
+		devc->latency_target = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -264,6 +264,7 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 	devc->sample_wide = FALSE;
 	devc->num_frames = 0;
 	devc->stl = NULL;
+	devc->latency_target = DEFAULT_LATENCY_MS;
 
 	return devc;
 }
@@ -314,9 +315,7 @@ static void free_transfer(struct libusb_transfer *transfer)
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
+	sr_usb_transfer_put(sdi->conn, transfer);
 
 	for (i = 0; i < devc->num_transfers; i++) {
 		if (devc->transfers[i] == transfer) {
@@ -334,7 +333,7 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	if ((ret = sr_usb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
@@ -342,10 +341,114 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
+static unsigned int to_bytes_per_ms(unsigned int samplerate)
+{
+	return samplerate / 1000;
+}
+
+static int submit_new_transfer(const struct sr_dev_inst *sdi);
+
+/*
+ * Adapt the number of USB transfers in flight to what the host needs.
+ * The queued transfers must cover the longest delay between two transfer
+ * completions, else the FX2's FIFO overflows and data gets lost. Grow
+ * the queue right away when completions got delayed or data got lost,
+ * and shrink it slowly again when the delays went away, to keep the
+ * memory footprint and the latency low.
+ */
+static void adapt_transfers(const struct sr_dev_inst *sdi, gboolean underrun)
+{
+	struct dev_context *devc;
+	int64_t now, transfer_us;
+	unsigned int wanted, bytes_per_ms;
+
+	devc = sdi->priv;
+
+	now = g_get_monotonic_time();
+	if (devc->last_completion && now - devc->last_completion > devc->max_gap)
+		devc->max_gap = now - devc->last_completion;
+	devc->last_completion = now;
+
+	bytes_per_ms = MAX(to_bytes_per_ms(devc->cur_samplerate), 1);
+	transfer_us = MAX(1000 * devc->transfer_size / bytes_per_ms, 1);
+	wanted = 2 * devc->max_gap / transfer_us + 1;
+	if (underrun) {
+		devc->num_underruns++;
+		wanted = MAX(wanted, (unsigned int)devc->submitted_transfers + 2);
+	}
+	wanted = CLAMP(wanted, MIN_SIMUL_TRANSFERS, NUM_SIMUL_TRANSFERS);
+
+	if (wanted > (unsigned int)devc->submitted_transfers) {
+		sr_dbg("Growing to %u transfers (longest gap %" PRId64 "us).",
+			wanted, devc->max_gap);
+		while ((unsigned int)devc->submitted_transfers < wanted) {
+			if (submit_new_transfer(sdi) != SR_OK)
+				break;
+		}
+		devc->completions = 0;
+		return;
+	}
+
+	if (++devc->completions < SHRINK_INTERVAL)
+		return;
+	devc->completions = 0;
+	/* Let old delays fade out, to eventually release transfers again. */
+	devc->max_gap /= 2;
+	if (wanted < (unsigned int)devc->submitted_transfers)
+		devc->shrink_pending = TRUE;
+}
+
+/* Resubmit a transfer, unless the queue of transfers is to be shrunk. */
+static void requeue_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	if (devc->shrink_pending &&
+			devc->submitted_transfers > MIN_SIMUL_TRANSFERS) {
+		devc->shrink_pending = FALSE;
+		sr_dbg("Shrinking to %d transfers.",
+			devc->submitted_transfers - 1);
+		free_transfer(transfer);
+		return;
+	}
+	resubmit_transfer(transfer);
+}
+
+/*
+ * Split the interleaved (logic, analog) byte pairs. Four pairs get
+ * separated in a 64bit word at a time, by folding the even and the odd
+ * bytes together, which compilers keep in registers on every target.
+ */
+static void mso_split(uint8_t *logic, uint8_t *analog,
+	const uint8_t *data, size_t count)
+{
+	const uint64_t mask8 = 0x00ff00ff00ff00ffULL;
+	const uint64_t mask16 = 0x0000ffff0000ffffULL;
+	uint64_t word, even, odd;
+	size_t i;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		word = read_u64le(&data[i * 2]);
+		even = word & mask8;
+		odd = (word >> 8) & mask8;
+		even = (even | (even >> 8)) & mask16;
+		odd = (odd | (odd >> 8)) & mask16;
+		write_u32le(&logic[i], (uint32_t)(even | (even >> 16)));
+		write_u32le(&analog[i], (uint32_t)(odd | (odd >> 16)));
+	}
+	for (; i < count; i++) {
+		logic[i] = data[i * 2];
+		analog[i] = data[i * 2 + 1];
+	}
+}
+
 static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
-	size_t i;
 	struct dev_context *devc;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -359,11 +462,7 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	length /= 2;
 
 	/* Send the logic */
-	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
-		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
-	};
+	mso_split(devc->logic_buffer, devc->analog_buffer, data, length);
 
 	const struct sr_datafeed_logic logic = {
 		.length = length,
@@ -376,9 +475,16 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 		.payload = &logic
 	};
 
-	sr_session_send(sdi, &logic_packet);
+	const struct sr_datafeed_packet_info info = {
+		.host_time_us = devc->last_completion
+	};
+
+	sr_session_send_info(sdi, &logic_packet, &info);
 
+	/* The raw samples span -10V - +10V with 0-255. */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	sr_analog_encoding_set_raw(&encoding, 1, FALSE, FALSE,
+		1 / 12.8, -10.0);
 	analog.meaning->channels = devc->enabled_analog_channels;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
@@ -391,12 +497,14 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 		.payload = &analog
 	};
 
-	sr_session_send(sdi, &analog_packet);
+	sr_session_send_info(sdi, &analog_packet, &info);
 }
 
 static void la_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
+	struct dev_context *devc = sdi->priv;
+
 	const struct sr_datafeed_logic logic = {
 		.length = length,
 		.unitsize = sample_width,
@@ -408,7 +516,12 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 		.payload = &logic
 	};
 
-	sr_session_send(sdi, &packet);
+	/* The completion time of the transfer which brought the data. */
+	const struct sr_datafeed_packet_info info = {
+		.host_time_us = devc->last_completion
+	};
+
+	sr_session_send_info(sdi, &packet, &info);
 }
 
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
@@ -434,6 +547,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
+	sr_usb_capture_transfer(sdi, transfer);
 
 	/* Save incoming transfer before reusing the transfer struct. */
 	unitsize = devc->sample_wide ? 2 : 1;
@@ -453,6 +568,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		break;
 	}
 
+	adapt_transfers(sdi, transfer->actual_length == 0 || packet_has_error);
+
 	if (transfer->actual_length == 0 || packet_has_error) {
 		devc->empty_transfer_count++;
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
@@ -463,7 +580,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 			fx2lafw_abort_acquisition(devc);
 			free_transfer(transfer);
 		} else {
-			resubmit_transfer(transfer);
+			requeue_transfer(transfer);
 		}
 		return;
 	} else {
@@ -533,7 +650,7 @@ check_trigger:
 		fx2lafw_abort_acquisition(devc);
 		free_transfer(transfer);
 	} else
-		resubmit_transfer(transfer);
+		requeue_transfer(transfer);
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -570,21 +687,18 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
-{
-	return samplerate / 1000;
-}
-
 static size_t get_buffer_size(struct dev_context *devc)
 {
 	size_t s;
 
 	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
+	 * The buffer should be large enough to hold the latency target's
+	 * amount of data (10ms by default) and a multiple of 512.
 	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
+	s = devc->latency_target * to_bytes_per_ms(devc->cur_samplerate);
+	s = (s + 511) & ~511;
+
+	return MAX(s, 512);
 }
 
 static unsigned int get_number_of_transfers(struct dev_context *devc)
@@ -595,10 +709,8 @@ static unsigned int get_number_of_transfers(struct dev_context *devc)
 	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
 		get_buffer_size(devc));
 
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
+	/* This is a start value only, adapt_transfers() adjusts it. */
+	return CLAMP(n, MIN_SIMUL_TRANSFERS, NUM_SIMUL_TRANSFERS);
 }
 
 static unsigned int get_timeout(struct dev_context *devc)
@@ -606,9 +718,9 @@ static unsigned int get_timeout(struct dev_context *devc)
 	size_t total_size;
 	unsigned int timeout;
 
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
+	/* Consider the maximum number of transfers adapt_transfers() may use. */
+	total_size = get_buffer_size(devc) * NUM_SIMUL_TRANSFERS;
+	timeout = total_size / MAX(to_bytes_per_ms(devc->cur_samplerate), 1);
 	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
 }
 
@@ -628,23 +740,59 @@ static int receive_data(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
-static int start_transfers(const struct sr_dev_inst *sdi)
+static int submit_new_transfer(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_trigger *trigger;
 	struct libusb_transfer *transfer;
-	unsigned int i, num_transfers;
-	int timeout, ret;
-	unsigned char *buf;
-	size_t size;
+	unsigned int i;
+	int ret;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
 
+	for (i = 0; i < devc->num_transfers; i++) {
+		if (!devc->transfers[i])
+			break;
+	}
+	if (i == devc->num_transfers)
+		return SR_ERR;
+
+	if (!(transfer = sr_usb_transfer_get(usb, devc->transfer_size)))
+		return SR_ERR_MALLOC;
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			2 | LIBUSB_ENDPOINT_IN, transfer->buffer, devc->transfer_size,
+			receive_transfer, (void *)sdi, get_timeout(devc));
+	sr_spew("Submitting transfer %d.", i);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+		       libusb_error_name(ret));
+		sr_usb_transfer_put(usb, transfer);
+		return SR_ERR;
+	}
+	devc->transfers[i] = transfer;
+	devc->submitted_transfers++;
+
+	return SR_OK;
+}
+
+static int start_transfers(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_trigger *trigger;
+	unsigned int i, num_transfers;
+	int ret;
+
+	devc = sdi->priv;
+
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
+	devc->num_underruns = 0;
+	devc->last_completion = 0;
+	devc->max_gap = 0;
+	devc->completions = 0;
+	devc->shrink_pending = FALSE;
 
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
@@ -661,37 +809,23 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 
 	num_transfers = get_number_of_transfers(devc);
 
-	size = get_buffer_size(devc);
+	devc->transfer_size = get_buffer_size(devc);
 	devc->submitted_transfers = 0;
 
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	/* Leave room for the transfers which adapt_transfers() may add. */
+	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) *
+		NUM_SIMUL_TRANSFERS);
 	if (!devc->transfers) {
 		sr_err("USB transfers malloc failed.");
 		return SR_ERR_MALLOC;
 	}
 
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
+	devc->num_transfers = NUM_SIMUL_TRANSFERS;
 	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+		if ((ret = submit_new_transfer(sdi)) != SR_OK) {
 			fx2lafw_abort_acquisition(devc);
-			return SR_ERR;
+			return ret;
 		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
 	}
 
 	/*
@@ -740,8 +874,7 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		/* We need a buffer half the size of a transfer. */
 		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
+		devc->analog_buffer = g_try_malloc(size / 2);
 	}
 	start_transfers(sdi);
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
@@ -37,8 +37,14 @@
 
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
+#define MIN_SIMUL_TRANSFERS	4
 #define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
+/* Default amount of data per USB transfer, in ms. */
+#define DEFAULT_LATENCY_MS	10
+/* Completions between attempts to reduce the number of transfers. */
+#define SHRINK_INTERVAL		64
+
 #define NUM_CHANNELS		16
 
 #define FX2LAFW_REQUIRED_VERSION_MAJOR	1
@@ -119,11 +125,21 @@ struct dev_context {
 
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+
+	/* Adaptive transfer scheduling. */
+	uint64_t latency_target;
+	uint64_t num_underruns;
+	size_t transfer_size;
+	int64_t last_completion;
+	int64_t max_gap;
+	unsigned int completions;
+	gboolean shrink_pending;
+
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
-	float *analog_buffer;
+	uint8_t *analog_buffer;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
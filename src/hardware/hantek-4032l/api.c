@@ -196,7 +196,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
@@ -39,8 +39,11 @@ struct h4032l_status_packet {
 	uint32_t fpga_version;
 };
 
+static void free_transfer(struct libusb_transfer *transfer);
+
 static void abort_acquisition(struct dev_context *devc)
 {
+	GSList *parked, *l;
 	int i;
 
 	devc->acq_aborted = TRUE;
@@ -50,6 +53,13 @@ static void abort_acquisition(struct dev_context *devc)
 			libusb_cancel_transfer(devc->transfers[i]);
 	}
 
+	/* Parked transfers aren't submitted, nothing else frees them. */
+	parked = devc->parked_transfers;
+	devc->parked_transfers = NULL;
+	for (l = parked; l; l = l->next)
+		free_transfer(l->data);
+	g_slist_free(parked);
+
 	devc->status = H4032L_STATUS_IDLE;
 }
 
@@ -58,6 +68,11 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 	struct drv_context *drvc = sdi->driver->context;
 
+	if (devc->feed_queue) {
+		feed_queue_logic_flush(devc->feed_queue);
+		feed_queue_logic_free(devc->feed_queue);
+		devc->feed_queue = NULL;
+	}
 	std_session_send_df_end(sdi);
 	usb_source_remove(sdi->session, drvc->sr_ctx);
 
@@ -101,44 +116,79 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	free_transfer(transfer);
 }
 
+/* Copy samples of a transfer to the feed queue, in pieces that fit it. */
+static void queue_data(struct dev_context *devc,
+	const uint32_t *data, size_t sample_count)
+{
+	uint8_t *wrptr;
+	size_t count;
+
+	while (sample_count) {
+		count = MIN(sample_count, H4032L_FEED_QUEUE_DEPTH);
+		wrptr = feed_queue_logic_reserve(devc->feed_queue, count);
+		if (!wrptr)
+			return;
+		memcpy(wrptr, data, count * sizeof(uint32_t));
+		feed_queue_logic_commit(devc->feed_queue, count);
+		data += count;
+		sample_count -= count;
+	}
+}
+
+/*
+ * Several transfers get coalesced into larger packets by the feed
+ * queue. Only the trigger position splits a transfer's data.
+ */
 static void send_data(struct sr_dev_inst *sdi,
 	uint32_t *data, size_t sample_count)
 {
 	struct dev_context *devc = sdi->priv;
-	struct sr_datafeed_logic logic = {
-		.length = sample_count * sizeof(uint32_t),
-		.unitsize = sizeof(uint32_t),
-		.data = data
-	};
-	const struct sr_datafeed_packet packet = {
-		.type = SR_DF_LOGIC,
-		.payload = &logic
-	};
 	size_t trigger_offset;
 
 	if (devc->trigger_pos >= devc->sent_samples &&
 		devc->trigger_pos < (devc->sent_samples + sample_count)) {
 		/* Get trigger position. */
 		trigger_offset = devc->trigger_pos - devc->sent_samples;
-		logic.length = trigger_offset * sizeof(uint32_t);
-		if (logic.length)
-			sr_session_send(sdi, &packet);
+		queue_data(devc, data, trigger_offset);
 
 		/* Send trigger position. */
-		std_session_send_df_trigger(sdi);
+		feed_queue_logic_send_trigger(devc->feed_queue);
 
 		/* Send rest of data. */
-		logic.length = (sample_count - trigger_offset) * sizeof(uint32_t);
-		logic.data = data + trigger_offset;
-		if (logic.length)
-			sr_session_send(sdi, &packet);
+		queue_data(devc, data + trigger_offset,
+			sample_count - trigger_offset);
 	} else {
-		sr_session_send(sdi, &packet);
+		queue_data(devc, data, sample_count);
 	}
 
 	devc->sent_samples += sample_count;
 }
 
+/*
+ * Resubmit the transfers which were parked while the session was under
+ * memory pressure. The samples wait in the device's memory meanwhile.
+ */
+static void resume_parked_transfers(struct drv_context *drvc)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	GSList *l, *parked, *t;
+
+	for (l = drvc->instances; l; l = l->next) {
+		sdi = l->data;
+		devc = sdi->priv;
+		if (!devc || !devc->parked_transfers || devc->acq_aborted)
+			continue;
+		if (sr_session_memory_pressure(sdi->session))
+			continue;
+		parked = devc->parked_transfers;
+		devc->parked_transfers = NULL;
+		for (t = parked; t; t = t->next)
+			resubmit_transfer(t->data);
+		g_slist_free(parked);
+	}
+}
+
 SR_PRIV int h4032l_receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
@@ -151,6 +201,7 @@ SR_PRIV int h4032l_receive_data(int fd, int revents, void *cb_data)
 
 	tv.tv_sec = tv.tv_usec = 0;
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+	resume_parked_transfers(drvc);
 
 	return TRUE;
 }
@@ -174,6 +225,7 @@ void LIBUSB_CALL h4032l_data_transfer_callback(struct libusb_transfer *transfer)
 
 	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
 		sr_dbg("%s error: %d.", __func__, transfer->status);
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
 
 	/* Cancel pending transfers. */
 	if (transfer->actual_length == 0) {
@@ -191,17 +243,21 @@ void LIBUSB_CALL h4032l_data_transfer_callback(struct libusb_transfer *transfer)
 
 	/* Close data receiving. */
 	if (devc->remaining_samples == 0) {
-		if (buf[num_samples] != H4032L_END_PACKET_MAGIC)
+		if (num_samples >= max_samples ||
+		    buf[num_samples] != H4032L_END_PACKET_MAGIC)
 			sr_err("Mismatch magic number of end poll.");
 
 		abort_acquisition(devc);
 		free_transfer(transfer);
 	} else {
-		if (((devc->submitted_transfers - 1) * H4032L_DATA_BUFFER_SIZE) <
-		    (int32_t)(devc->remaining_samples * sizeof(uint32_t)))
-			resubmit_transfer(transfer);
-		else
+		if (((devc->submitted_transfers - 1) * devc->transfer_size) >=
+		    (devc->remaining_samples * sizeof(uint32_t)))
 			free_transfer(transfer);
+		else if (sr_session_memory_pressure(sdi->session))
+			devc->parked_transfers = g_slist_append(
+				devc->parked_transfers, transfer);
+		else
+			resubmit_transfer(transfer);
 	}
 }
 
@@ -272,6 +328,12 @@ void LIBUSB_CALL h4032l_usb_callback(struct libusb_transfer *transfer)
 		devc->status = H4032L_STATUS_FIRST_TRANSFER;
 		/* Trigger has been captured. */
 		std_session_send_df_header(sdi);
+		devc->feed_queue = feed_queue_logic_alloc(sdi,
+			H4032L_FEED_QUEUE_DEPTH, sizeof(uint32_t));
+		if (!devc->feed_queue) {
+			sr_err("Cannot allocate the session feed queue.");
+			devc->status = H4032L_STATUS_IDLE;
+		}
 		break;
 	case H4032L_STATUS_FIRST_TRANSFER:
 		/* Drop packets until H4032L_START_PACKET_MAGIC. */
@@ -360,6 +422,7 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 	struct sr_usb_dev_inst *usb = sdi->conn;
 	struct libusb_transfer *transfer;
 	uint8_t *buf;
+	size_t remaining, size;
 	unsigned int num_transfers;
 	unsigned int i;
 	int ret;
@@ -367,11 +430,23 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 	devc->submitted_transfers = 0;
 
 	/*
-	 * Set number of data transfers regarding to size of buffer.
-	 * FPGA version 0 can't transfer multiple transfers at once.
+	 * Adapt the size of the transfers to the amount of data, so that
+	 * the ring of transfers covers a good part of deep captures. Use
+	 * small transfers for short captures, and for FPGA version 0,
+	 * which can't transfer multiple transfers at once.
 	 */
-	if ((num_transfers = MIN(devc->remaining_samples * sizeof(uint32_t) /
-	    H4032L_DATA_BUFFER_SIZE, devc->fpga_version ?
+	remaining = devc->remaining_samples * sizeof(uint32_t);
+	size = H4032L_DATA_BUFFER_SIZE;
+	if (devc->fpga_version) {
+		size = remaining / H4032L_DATA_TRANSFER_MAX_NUM;
+		size -= size % H4032L_DATA_BUFFER_SIZE;
+		size = MAX(size, H4032L_DATA_BUFFER_SIZE);
+		size = MIN(size, H4032L_DATA_BUFFER_SIZE_MAX);
+	}
+	devc->transfer_size = size;
+
+	/* Set number of data transfers regarding to size of buffer. */
+	if ((num_transfers = MIN(remaining / size, devc->fpga_version ?
 	    H4032L_DATA_TRANSFER_MAX_NUM : 1)) == 0)
 		num_transfers = 1;
 
@@ -380,12 +455,12 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 	devc->num_transfers = num_transfers;
 
 	for (i = 0; i < num_transfers; i++) {
-		buf = g_malloc(H4032L_DATA_BUFFER_SIZE);
+		buf = g_malloc(size);
 		transfer = libusb_alloc_transfer(0);
 
 		libusb_fill_bulk_transfer(transfer, usb->devhdl,
 			6 | LIBUSB_ENDPOINT_IN,
-			buf, H4032L_DATA_BUFFER_SIZE,
+			buf, size,
 			h4032l_data_transfer_callback,
 			(void *)sdi, H4032L_USB_TIMEOUT);
 
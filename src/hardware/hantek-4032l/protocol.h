@@ -34,7 +34,9 @@
 #define H4032L_USB_PRODUCT 0x4032
 
 #define H4032L_DATA_BUFFER_SIZE (2 * 1024)
-#define H4032L_DATA_TRANSFER_MAX_NUM 32
+#define H4032L_DATA_BUFFER_SIZE_MAX (256 * 1024)
+#define H4032L_DATA_TRANSFER_MAX_NUM 64
+#define H4032L_FEED_QUEUE_DEPTH (1024 * 1024)
 
 #define H4043L_NUM_SAMPLES_MIN (2 * 1024)
 #define H4032L_NUM_SAMPLES_MAX (64 * 1024 * 1024)
@@ -163,6 +165,10 @@ struct dev_context {
 	struct h4032l_cmd_pkt cmd_pkt;
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	size_t transfer_size;
+	/* Transfers held back while the session is under memory pressure. */
+	GSList *parked_transfers;
+	struct feed_queue_logic *feed_queue;
 	uint8_t buf[512];
 	uint64_t capture_ratio;
 	uint32_t trigger_pos;
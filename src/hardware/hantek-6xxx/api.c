@@ -40,6 +40,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_VDIV | SR_CONF_GET,
+	SR_CONF_CONTINUOUS | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg[] = {
@@ -227,12 +228,12 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -296,7 +297,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			/* Not a supported VID/PID. */
 			continue;
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	return std_scan_complete(di, devices);
 }
@@ -387,6 +388,9 @@ static int config_get(uint32_t key, GVariant **data,
 		case SR_CONF_LIMIT_SAMPLES:
 			*data = g_variant_new_uint64(devc->limit_samples);
 			break;
+		case SR_CONF_CONTINUOUS:
+			*data = g_variant_new_boolean(devc->continuous);
+			break;
 		case SR_CONF_CONN:
 			if (!sdi->conn)
 				return SR_ERR_ARG;
@@ -441,6 +445,9 @@ static int config_set(uint32_t key, GVariant *data,
 		case SR_CONF_LIMIT_SAMPLES:
 			devc->limit_samples = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_CONTINUOUS:
+			devc->continuous = g_variant_get_boolean(data);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -604,6 +611,85 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	g_free(analog.data);
 }
 
+static gboolean limits_reached(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	if (devc->limit_samples && devc->samp_received >= devc->limit_samples) {
+		sr_info("Requested number of samples reached, stopping. %"
+			PRIu64 " <= %" PRIu64, devc->limit_samples,
+			devc->samp_received);
+		return TRUE;
+	}
+	if (devc->limit_msec && (g_get_monotonic_time() -
+			devc->aq_started) / 1000 >= devc->limit_msec) {
+		sr_info("Requested time limit reached, stopping. %d <= %d",
+			(uint32_t)devc->limit_msec,
+			(uint32_t)(g_get_monotonic_time() - devc->aq_started) / 1000);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Called by libusb for the transfers of the streaming ring. The data
+ * goes onto the session bus, and the transfer gets resubmitted right
+ * away, until the acquisition stops.
+ */
+static void LIBUSB_CALL receive_stream_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint64_t samples_received;
+	int ret;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	if (devc->dev_state != CAPTURE) {
+		hantek_6xxx_free_stream_transfer(transfer);
+		return;
+	}
+
+	sr_spew("receive_stream_transfer(): status %s received %d bytes.",
+		libusb_error_name(transfer->status), transfer->actual_length);
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		sr_err("Streaming transfer failed: %s.",
+			libusb_error_name(transfer->status));
+		hantek_6xxx_free_stream_transfer(transfer);
+		devc->dev_state = STOPPING;
+		return;
+	}
+
+	samples_received = transfer->actual_length / NUM_CHANNELS;
+	/* The ring runs ahead of the sample limit, drop the excess. */
+	if (devc->limit_samples)
+		samples_received = MIN(samples_received,
+			devc->limit_samples - devc->samp_received);
+	if (samples_received) {
+		send_chunk(sdi, transfer->buffer, samples_received);
+		devc->samp_received += samples_received;
+	}
+
+	if (limits_reached(sdi)) {
+		hantek_6xxx_free_stream_transfer(transfer);
+		sr_dev_acquisition_stop(sdi);
+		return;
+	}
+
+	if ((ret = libusb_submit_transfer(transfer)) < 0) {
+		sr_err("Failed to resubmit transfer: %s.",
+			libusb_error_name(ret));
+		hantek_6xxx_free_stream_transfer(transfer);
+		devc->dev_state = STOPPING;
+	}
+}
+
 /*
  * Called by libusb (as triggered by handle_event()) when a transfer comes in.
  * Only channel data comes in asynchronously, and all transfers for this are
@@ -623,7 +709,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		libusb_free_transfer(transfer);
 		devc->dev_state = CAPTURE;
 		devc->aq_started = g_get_monotonic_time();
-		read_channel(sdi, data_amount(sdi));
+		if (!devc->continuous)
+			read_channel(sdi, data_amount(sdi));
+		else if (hantek_6xxx_start_streaming(sdi, receive_stream_transfer) != SR_OK)
+			devc->dev_state = STOPPING;
 		return;
 	}
 
@@ -649,20 +738,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	g_free(transfer->buffer);
 	libusb_free_transfer(transfer);
 
-	if (devc->limit_samples && devc->samp_received >= devc->limit_samples) {
-		sr_info("Requested number of samples reached, stopping. %"
-			PRIu64 " <= %" PRIu64, devc->limit_samples,
-			devc->samp_received);
-		sr_dev_acquisition_stop(sdi);
-	} else if (devc->limit_msec && (g_get_monotonic_time() -
-			devc->aq_started) / 1000 >= devc->limit_msec) {
-		sr_info("Requested time limit reached, stopping. %d <= %d",
-			(uint32_t)devc->limit_msec,
-			(uint32_t)(g_get_monotonic_time() - devc->aq_started) / 1000);
+	if (limits_reached(sdi))
 		sr_dev_acquisition_stop(sdi);
-	} else {
+	else
 		read_channel(sdi, data_amount(sdi));
-	}
 }
 
 static int read_channel(const struct sr_dev_inst *sdi, uint32_t amount)
@@ -700,6 +779,12 @@ static int handle_event(int fd, int revents, void *cb_data)
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
 	if (devc->dev_state == STOPPING) {
+		/* Wait for the streaming ring to drain. */
+		if (devc->submitted_transfers) {
+			hantek_6xxx_cancel_streaming(sdi);
+			return TRUE;
+		}
+
 		/* We've been told to wind up the acquisition. */
 		sr_dbg("Stopping acquisition.");
 
@@ -739,6 +824,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	std_session_send_df_header(sdi);
 
 	devc->samp_received = 0;
+	devc->submitted_transfers = 0;
 	devc->dev_state = FLUSH;
 
 	usb_source_add(sdi->session, drvc->sr_ctx, TICK,
@@ -96,6 +96,7 @@ SR_PRIV void hantek_6xxx_close(struct sr_dev_inst *sdi)
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
+	sr_usb_transfer_pool_free(usb);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
 	sdi->status = SR_ST_INACTIVE;
@@ -132,6 +133,96 @@ SR_PRIV int hantek_6xxx_get_channeldata(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+/* Size of a streaming transfer, a multiple of the packet size. */
+static uint32_t stream_transfer_size(const struct dev_context *devc)
+{
+	uint64_t size;
+
+	size = devc->samplerate * NUM_CHANNELS * STREAM_TRANSFER_MS / 1000;
+	size = (size + MIN_PACKET_SIZE - 1) / MIN_PACKET_SIZE * MIN_PACKET_SIZE;
+
+	return CLAMP(size, MIN_PACKET_SIZE, MAX_PACKET_SIZE);
+}
+
+/*
+ * Submit the ring of streaming transfers. The callback resubmits each
+ * transfer as soon as it has handled its data, so the device always
+ * finds a buffer to fill and no samples get lost between blocks.
+ */
+SR_PRIV int hantek_6xxx_start_streaming(const struct sr_dev_inst *sdi,
+		libusb_transfer_cb_fn cb)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	uint32_t size;
+	int i, ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	size = stream_transfer_size(devc);
+	sr_dbg("Streaming with %d transfers of %" PRIu32 " bytes.",
+		NUM_STREAM_TRANSFERS, size);
+
+	for (i = 0; i < NUM_STREAM_TRANSFERS; i++) {
+		if (!(transfer = sr_usb_transfer_get(usb, size))) {
+			hantek_6xxx_cancel_streaming(sdi);
+			return SR_ERR_MALLOC;
+		}
+		libusb_fill_bulk_transfer(transfer, usb->devhdl, HANTEK_EP_IN,
+				transfer->buffer, size, cb, (void *)sdi, 4000);
+		if ((ret = libusb_submit_transfer(transfer)) < 0) {
+			sr_err("Failed to submit transfer: %s.",
+				libusb_error_name(ret));
+			sr_usb_transfer_put(usb, transfer);
+			hantek_6xxx_cancel_streaming(sdi);
+			return SR_ERR;
+		}
+		devc->transfers[i] = transfer;
+		devc->submitted_transfers++;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Cancel the streaming transfers which still are in flight. They come
+ * back through the callback, which releases them.
+ */
+SR_PRIV void hantek_6xxx_cancel_streaming(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int i;
+
+	devc = sdi->priv;
+
+	for (i = 0; i < NUM_STREAM_TRANSFERS; i++) {
+		if (devc->transfers[i])
+			libusb_cancel_transfer(devc->transfers[i]);
+	}
+}
+
+/* Return a streaming transfer to the pool, and drop it from the ring. */
+SR_PRIV void hantek_6xxx_free_stream_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	int i;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	for (i = 0; i < NUM_STREAM_TRANSFERS; i++) {
+		if (devc->transfers[i] == transfer) {
+			devc->transfers[i] = NULL;
+			break;
+		}
+	}
+	sr_usb_transfer_put(sdi->conn, transfer);
+	devc->submitted_transfers--;
+}
+
 static uint8_t samplerate_to_reg(uint64_t samplerate)
 {
 	const uint64_t samplerate_values[] = {SAMPLERATE_VALUES};
@@ -74,6 +74,13 @@
 #define MAX_PACKET_SIZE		(12 * 1024 * 1024)
 #endif
 
+/*
+ * Continuous streaming keeps a ring of transfers in flight, each of
+ * which holds STREAM_TRANSFER_MS worth of samples.
+ */
+#define NUM_STREAM_TRANSFERS	16
+#define STREAM_TRANSFER_MS	10
+
 #define HANTEK_EP_IN		0x86
 #define USB_INTERFACE		0
 #define USB_CONFIGURATION	1
@@ -145,12 +152,21 @@ struct dev_context {
 
 	uint64_t limit_msec;
 	uint64_t limit_samples;
+
+	/* Streaming mode, with a ring of continuously resubmitted transfers. */
+	gboolean continuous;
+	struct libusb_transfer *transfers[NUM_STREAM_TRANSFERS];
+	int submitted_transfers;
 };
 
 SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi);
 SR_PRIV void hantek_6xxx_close(struct sr_dev_inst *sdi);
 SR_PRIV int hantek_6xxx_get_channeldata(const struct sr_dev_inst *sdi,
 		libusb_transfer_cb_fn cb, uint32_t data_amount);
+SR_PRIV int hantek_6xxx_start_streaming(const struct sr_dev_inst *sdi,
+		libusb_transfer_cb_fn cb);
+SR_PRIV void hantek_6xxx_cancel_streaming(const struct sr_dev_inst *sdi);
+SR_PRIV void hantek_6xxx_free_stream_transfer(struct libusb_transfer *transfer);
 
 SR_PRIV int hantek_6xxx_start_data_collecting(const struct sr_dev_inst *sdi);
 SR_PRIV int hantek_6xxx_stop_data_collecting(const struct sr_dev_inst *sdi);
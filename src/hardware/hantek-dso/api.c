@@ -237,6 +237,8 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 	g_slist_free(devc->enabled_channels);
 	devc->enabled_channels = NULL;
+	g_slist_free(devc->interleaved_channels);
+	devc->interleaved_channels = NULL;
 	devc->ch_enabled[0] = devc->ch_enabled[1] = FALSE;
 	for (l = sdi->channels, p = 0; l; l = l->next, p++) {
 		ch = l->data;
@@ -248,6 +250,12 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			devc->enabled_channels = g_slist_append(devc->enabled_channels, ch);
 	}
 
+	/* Both channels in the order of the device's interleaved data. */
+	if (devc->ch_enabled[0] && devc->ch_enabled[1]) {
+		devc->interleaved_channels = g_slist_reverse(
+			g_slist_copy(devc->enabled_channels));
+	}
+
 	return SR_OK;
 }
 
@@ -255,6 +263,8 @@ static void clear_helper(struct dev_context *devc)
 {
 	g_free(devc->triggersource);
 	g_slist_free(devc->enabled_channels);
+	g_slist_free(devc->interleaved_channels);
+	g_free(devc->chunkbuf);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -290,7 +300,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
@@ -640,6 +650,20 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
+/* Consumers scale the raw bytes when they need values. */
+static void set_chunk_encoding(const struct dev_context *devc, int ch,
+		struct sr_datafeed_analog *analog)
+{
+	float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
+	float vdivlog = log10f(range / 255);
+	int digits = -(int)vdivlog + (vdivlog < 0.0);
+
+	analog->encoding->digits = digits;
+	analog->spec->spec_digits = digits;
+	sr_analog_encoding_set_raw(analog->encoding, 1, FALSE, FALSE,
+		range / 255, -range / 2);
+}
+
 static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 		int num_samples)
 {
@@ -651,6 +675,18 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
 
+	/*
+	 * The device always sends data for both channels, interleaved,
+	 * with CH2 first. If a channel is disabled, it contains a copy of
+	 * the enabled channel's data. However, we only send the requested
+	 * channels to the bus.
+	 *
+	 * Voltage values are encoded as a value 0-255 (0-512 on the
+	 * DSO-5200*), where the value is a point in the range
+	 * represented by the vdiv setting. There are 8 vertical divs,
+	 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
+	 * and 255 = +2V.
+	 */
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	/* TODO: support for 5xxx series 9-bit samples */
@@ -659,42 +695,35 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(num_samples * sizeof(float));
 
+	/*
+	 * Both channels share an encoding when their vdiv is the same,
+	 * the USB buffer then goes out as is, in one packet.
+	 */
+	if (devc->interleaved_channels &&
+			devc->voltage[0] == devc->voltage[1]) {
+		set_chunk_encoding(devc, 0, &analog);
+		analog.meaning->channels = devc->interleaved_channels;
+		analog.data = buf;
+		sr_session_send(sdi, &packet);
+		return;
+	}
+
+	analog.data = devc->chunkbuf;
 	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
-		float vdivlog = log10f(range / 255);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
+		set_chunk_encoding(devc, ch, &analog);
 		analog.meaning->channels = g_slist_append(NULL, channels->data);
-
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255 (0-512 on the
-			 * DSO-5200*), where the value is a point in the range
-			 * represented by the vdiv setting. There are 8 vertical divs,
-			 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
-			 * and 255 = +2V.
-			 */
-			/* TODO: Support for DSO-5xxx series 9-bit samples. */
-			((float *)analog.data)[i] = range / 255 * *(buf + i * 2 + 1 - ch) - range / 2;
-		}
+		/* TODO: Support for DSO-5xxx series 9-bit samples. */
+		for (int i = 0; i < num_samples; i++)
+			devc->chunkbuf[i] = buf[i * 2 + 1 - ch];
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
 
 		channels = channels->next;
 	}
-	g_free(analog.data);
 }
 
 /*
@@ -874,6 +903,8 @@ static int handle_event(int fd, int revents, void *cb_data)
 
 		num_channels = (devc->ch_enabled[0] && devc->ch_enabled[1]) ? 2 : 1;
 		devc->framebuf = g_malloc(devc->framesize * num_channels * 2);
+		/* One channel's samples of a chunk, no chunk exceeds a frame. */
+		devc->chunkbuf = g_realloc(devc->chunkbuf, devc->framesize);
 		devc->samp_buffered = devc->samp_received = 0;
 
 		/* Tell the scope to send us the first frame. */
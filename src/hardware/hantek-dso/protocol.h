@@ -212,6 +212,10 @@ struct dev_context {
 	unsigned int samp_buffered;
 	unsigned int trigger_offset;
 	unsigned char *framebuf;
+	/* Samples of one channel, as sent to the session bus. */
+	uint8_t *chunkbuf;
+	/* CH2 and CH1 when both are enabled, else NULL. */
+	GSList *interleaved_channels;
 };
 
 SR_PRIV int dso_open(struct sr_dev_inst *sdi);
@@ -71,7 +71,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	drvc = di->context;
 
-	usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, USB_VID_PID);
+	usb_devices = sr_usb_find(drvc->sr_ctx, USB_VID_PID);
 
 	if (!usb_devices)
 		return NULL;
@@ -24,7 +24,6 @@
 #define USB_DEVICE_ID			0x6014
 #define USB_IPRODUCT			"SCANAPLUS"
 
-#define SAMPLE_BUF_SIZE			(8 * 1024 * 1024)
 
 static const uint32_t drvopts[] = {
 	SR_CONF_LOGIC_ANALYZER,
@@ -47,7 +46,6 @@ static void clear_helper(struct dev_context *devc)
 {
 	ftdi_free(devc->ftdic);
 	g_free(devc->compressed_buf);
-	g_free(devc->sample_buf);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -72,15 +70,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		goto err_free_devc;
 	}
 
-	/* Allocate memory for the uncompressed samples. */
-	if (!(devc->sample_buf = g_try_malloc0(SAMPLE_BUF_SIZE))) {
-		sr_err("sample_buf malloc failed.");
-		goto err_free_compressed_buf;
-	}
-
 	if (!(devc->ftdic = ftdi_new())) {
 		sr_err("Failed to initialize libftdi.");
-		goto err_free_sample_buf;
+		goto err_free_compressed_buf;
 	}
 
 	ret = ftdi_usb_open_desc(devc->ftdic, USB_VENDOR_ID, USB_DEVICE_ID,
@@ -109,8 +101,6 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	scanaplus_close(devc);
 err_free_ftdic:
 	ftdi_free(devc->ftdic);
-err_free_sample_buf:
-	g_free(devc->sample_buf);
 err_free_compressed_buf:
 	g_free(devc->compressed_buf);
 err_free_devc:
@@ -279,7 +269,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	/* Properly reset internal variables before every new acquisition. */
 	devc->compressed_bytes_ignored = 0;
 	devc->samples_sent = 0;
-	devc->bytes_received = 0;
 
 	if ((ret = scanaplus_init(devc)) < 0)
 		return ret;
@@ -287,6 +276,12 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if ((ret = scanaplus_start_acquisition(devc)) < 0)
 		return ret;
 
+	/* Uncompressed samples go straight to the queue's buffer. */
+	devc->ops = sr_logic_ops_get(2);
+	devc->feed_queue = feed_queue_logic_alloc(sdi, FEED_QUEUE_DEPTH, 2);
+	if (!devc->feed_queue)
+		return SR_ERR_MALLOC;
+
 	std_session_send_df_header(sdi);
 
 	/* Hook up a dummy handler to receive data from the device. */
@@ -298,6 +293,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	sr_session_source_remove(sdi->session, -1);
+	scanaplus_stop_acquisition(sdi->priv);
 	std_session_send_df_end(sdi);
 
 	return SR_OK;
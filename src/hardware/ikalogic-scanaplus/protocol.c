@@ -87,44 +87,52 @@ SR_PRIV int scanaplus_close(struct dev_context *devc)
 	return SR_OK;
 }
 
-static void scanaplus_uncompress_block(struct dev_context *devc,
-				       uint64_t num_bytes)
+/*
+ * Uncompress a block straight into the feed queue's buffer. Each pair
+ * of bytes holds a run length (bits 7-1 of the first byte) and the
+ * 9 channels' values. Runs get filled with 16-bit stores, the queue
+ * sends full buffers while the block is still being processed. At most
+ * @a max_samples samples get queued, the number of them is returned.
+ */
+static uint64_t scanaplus_uncompress_block(struct dev_context *devc,
+				       uint64_t num_bytes, uint64_t max_samples)
 {
-	uint64_t i, j;
-	uint8_t num_samples, low, high;
-
-	for (i = 0; i < num_bytes; i += 2) {
+	uint64_t i, queued;
+	size_t room, filled, num_samples;
+	uint8_t sample[2], *wrptr;
+
+	queued = 0;
+	room = filled = 0;
+	wrptr = NULL;
+	for (i = 0; i + 1 < num_bytes && queued < max_samples; i += 2) {
 		num_samples = devc->compressed_buf[i + 0] >> 1;
-
-		low = devc->compressed_buf[i + 0] & (1 << 0);
-		high = devc->compressed_buf[i + 1];
-
-		for (j = 0; j < num_samples; j++) {
-			devc->sample_buf[devc->bytes_received++] = high;
-			devc->sample_buf[devc->bytes_received++] = low;
+		num_samples = MIN(num_samples, max_samples - queued);
+		if (!num_samples)
+			continue;
+
+		/* We need 2 bytes for 9 channels. */
+		sample[0] = devc->compressed_buf[i + 1];
+		sample[1] = devc->compressed_buf[i + 0] & (1 << 0);
+
+		if (room - filled < MAX_RUN_SAMPLES) {
+			if (filled && feed_queue_logic_commit(devc->feed_queue,
+					filled) != SR_OK)
+				return queued;
+			room = RESERVE_SAMPLES;
+			filled = 0;
+			wrptr = feed_queue_logic_reserve(devc->feed_queue, room);
+			if (!wrptr)
+				return queued;
 		}
+		devc->ops->fill(wrptr, sample, sizeof(sample), num_samples);
+		wrptr += num_samples * sizeof(sample);
+		filled += num_samples;
+		queued += num_samples;
 	}
-}
-
-static void send_samples(const struct sr_dev_inst *sdi, uint64_t samples_to_send)
-{
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	struct dev_context *devc;
-
-	devc = sdi->priv;
-
-	sr_spew("Sending %" PRIu64 " samples.", samples_to_send);
+	if (filled)
+		feed_queue_logic_commit(devc->feed_queue, filled);
 
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.length = samples_to_send * 2;
-	logic.unitsize = 2; /* We need 2 bytes for 9 channels. */
-	logic.data = devc->sample_buf;
-	sr_session_send(sdi, &packet);
-
-	devc->samples_sent += samples_to_send;
-	devc->bytes_received -= samples_to_send * 2;
+	return queued;
 }
 
 SR_PRIV int scanaplus_get_device_id(struct dev_context *devc)
@@ -294,6 +302,16 @@ SR_PRIV int scanaplus_start_acquisition(struct dev_context *devc)
 	return SR_OK;
 }
 
+SR_PRIV void scanaplus_stop_acquisition(struct dev_context *devc)
+{
+	if (!devc->feed_queue)
+		return;
+
+	feed_queue_logic_flush(devc->feed_queue);
+	feed_queue_logic_free(devc->feed_queue);
+	devc->feed_queue = NULL;
+}
+
 SR_PRIV int scanaplus_receive_data(int fd, int revents, void *cb_data)
 {
 	int bytes_read;
@@ -349,24 +367,26 @@ SR_PRIV int scanaplus_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	/* TODO: Handle bytes_read which is not a multiple of 2? */
-	scanaplus_uncompress_block(devc, bytes_read);
-
-	n = devc->samples_sent + (devc->bytes_received / 2);
+	/* Cap the uncompressed samples at the acquisition limits. */
+	n = UINT64_MAX;
+	if (devc->limit_samples)
+		n = MIN(n, devc->limit_samples);
 	max = (SR_MHZ(100) / 1000) * devc->limit_msec;
+	if (devc->limit_msec)
+		n = MIN(n, max);
+	n = (n > devc->samples_sent) ? n - devc->samples_sent : 0;
+
+	/* TODO: Handle bytes_read which is not a multiple of 2? */
+	devc->samples_sent += scanaplus_uncompress_block(devc, bytes_read, n);
+	feed_queue_logic_flush(devc->feed_queue);
+	sr_spew("Sent %" PRIu64 " samples.", devc->samples_sent);
 
-	if (devc->limit_samples && (n >= devc->limit_samples)) {
-		send_samples(sdi, devc->limit_samples - devc->samples_sent);
+	if (devc->limit_samples && devc->samples_sent >= devc->limit_samples) {
 		sr_info("Requested number of samples reached.");
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else if (devc->limit_msec && (n >= max)) {
-		send_samples(sdi, max - devc->samples_sent);
+	} else if (devc->limit_msec && devc->samples_sent >= max) {
 		sr_info("Requested time limit reached.");
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else {
-		send_samples(sdi, devc->bytes_received / 2);
 	}
 
 	return TRUE;
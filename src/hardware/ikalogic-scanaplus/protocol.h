@@ -30,6 +30,11 @@
 #define LOG_PREFIX "ikalogic-scanaplus"
 
 #define COMPRESSED_BUF_SIZE (64 * 1024)
+#define FEED_QUEUE_DEPTH (1024 * 1024)
+/* Samples which get reserved in the feed queue at a time. */
+#define RESERVE_SAMPLES (64 * 1024)
+/* Maximum number of samples in one run of the compressed data. */
+#define MAX_RUN_SAMPLES 127
 
 struct dev_context {
 	struct ftdi_context *ftdic;
@@ -38,8 +43,8 @@ struct dev_context {
 
 	uint8_t *compressed_buf;
 	uint64_t compressed_bytes_ignored;
-	uint8_t *sample_buf;
-	uint64_t bytes_received;
+	struct feed_queue_logic *feed_queue;
+	const struct sr_logic_ops *ops;
 	uint64_t samples_sent;
 
 	/** ScanaPLUS unique device ID (3 bytes). */
@@ -50,6 +55,7 @@ SR_PRIV int scanaplus_close(struct dev_context *devc);
 SR_PRIV int scanaplus_get_device_id(struct dev_context *devc);
 SR_PRIV int scanaplus_init(struct dev_context *devc);
 SR_PRIV int scanaplus_start_acquisition(struct dev_context *devc);
+SR_PRIV void scanaplus_stop_acquisition(struct dev_context *devc);
 SR_PRIV int scanaplus_receive_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -174,16 +174,20 @@ SR_PRIV int ipdbg_la_tcp_close(struct ipdbg_la_tcp *tcp)
 static int tcp_send(struct ipdbg_la_tcp *tcp, const uint8_t *buf, size_t len)
 {
 	int out;
-	out = send(tcp->socket, (const char *)buf, len, 0);
 
-	if (out < 0) {
-		sr_err("Send error: %s", g_strerror(errno));
-		return SR_ERR;
+	/* Commands get sent as one buffer, complete short writes. */
+	while (len) {
+		out = send(tcp->socket, (const char *)buf, len, 0);
+		if (out < 0) {
+			sr_err("Send error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (out < (int)len)
+			sr_dbg("Only sent %d/%d bytes of data.", out, (int)len);
+		buf += out;
+		len -= out;
 	}
 
-	if (out < (int)len)
-		sr_dbg("Only sent %d/%d bytes of data.", out, (int)len);
-
 	return SR_OK;
 }
 
@@ -233,7 +237,6 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 
 	devc->num_stages = 0;
 	devc->num_transfers = 0;
-	devc->raw_sample_buf = NULL;
 
 	for (uint64_t i = 0; i < devc->data_width_bytes; i++) {
 		devc->trigger_mask[i] = 0;
@@ -291,84 +294,97 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static int ipdbg_la_runlength_decode(struct dev_context *devc,
-	uint64_t *delay_value, uint64_t *total_samples)
+/*
+ * Split one raw sample as the device sends it into its data value and
+ * the number of sample periods it lasts. The run length counter occupies
+ * the low bits, the data bits follow without padding. Devices without
+ * the run length coder have a zero width counter which always yields a
+ * repeat count of one.
+ */
+static uint32_t decode_raw_sample(const struct dev_context *devc,
+	const uint8_t *raw, uint8_t *value)
 {
-	if (devc->runlength_code_width == 0) {
-		*delay_value = devc->delay_value;
-		*total_samples = devc->limit_samples;
-		return TRUE;
+	const uint32_t raw_data_width_bytes =
+		(devc->data_width + devc->runlength_code_width + host_word_size - 1) /
+		host_word_size;
+	const uint32_t runlength_count_mask =
+		(uint32_t)((1ull << devc->runlength_code_width) - 1);
+	const uint32_t runlength_code_width_bytes =
+		(devc->runlength_code_width + host_word_size - 1) / host_word_size;
+	const uint8_t shift = devc->runlength_code_width % host_word_size;
+	uint32_t repeats;
+	size_t byte, idx;
+	uint16_t buffer;
+
+	repeats = 0;
+	for (byte = 0; byte < runlength_code_width_bytes; byte++)
+		repeats |= (uint32_t)raw[byte] << (byte * host_word_size);
+	repeats &= runlength_count_mask;
+	repeats += 1;
+
+	for (byte = 0; byte < devc->data_width_bytes; byte++) {
+		idx = runlength_code_width_bytes + byte;
+		if (shift) {
+			buffer = raw[idx - 1];
+			if (idx < raw_data_width_bytes)
+				buffer |= raw[idx] << 8;
+			buffer >>= shift;
+		} else {
+			buffer = raw[idx];
+		}
+		value[byte] = buffer & 0x00ff;
 	}
 
-	uint8_t *raw_sample_buffer = devc->raw_sample_buf;
-	const uint64_t total_raw_samples = devc->limit_samples;
-	const uint64_t raw_delay_value = devc->delay_value;
-
-	*delay_value = 0;
-	*total_samples = 0;
+	return repeats;
+}
 
-	uint32_t raw_data_width_bytes =
+/*
+ * Decode the complete raw samples in the receive buffer and queue them
+ * for the session, a partial sample at the end is kept for the next
+ * call. The trigger marker goes out right before the raw sample at the
+ * configured delay, this matches the device's pre-trigger buffer.
+ */
+static int process_raw_samples(struct dev_context *devc, size_t length)
+{
+	const uint32_t raw_data_width_bytes =
 		(devc->data_width + devc->runlength_code_width + host_word_size - 1) /
 		host_word_size;
-	uint32_t data_width_bytes = (devc->data_width + host_word_size - 1) / host_word_size;
-	const uint32_t runlength_count_mask = (uint32_t)((1ull << devc->runlength_code_width) - 1);
-	const uint32_t runlength_code_width_bytes = (devc->runlength_code_width + host_word_size - 1) /
-		host_word_size;
-
-	uint32_t *repeats = g_malloc(total_raw_samples * sizeof(uint32_t));
-	if (!repeats) {
-		sr_err("repeat counters malloc failed");
-		return FALSE;
-	}
-	for (uint64_t i = 0; i < total_raw_samples; ++i) {
-		repeats[i] = 0;
-		for (size_t byte = 0; byte < runlength_code_width_bytes; ++byte)
-			repeats[i] |= (uint32_t)(*(raw_sample_buffer + i * raw_data_width_bytes + byte)) <<
-				(byte * host_word_size);
-		repeats[i] &= runlength_count_mask;
-		repeats[i] += 1;
-		*total_samples += repeats[i];
-		if (i < raw_delay_value)
-			*delay_value += repeats[i];
-	}
-
-	uint8_t *run_buffer = g_try_malloc(*total_samples * data_width_bytes);
-	if (!run_buffer) {
-		g_free(repeats);
-		sr_err("decoded sample buffer malloc failed.");
-		return FALSE;
-	}
-	devc->raw_sample_buf = run_buffer;
-
-	for (size_t i = 0; i < total_raw_samples; ++i) {
-		for (size_t byte = 0; byte < data_width_bytes; ++byte) {
-			uint16_t buffer = 0;
-			if (devc->runlength_code_width % host_word_size)
-			{
-				buffer = *(raw_sample_buffer + i * raw_data_width_bytes + runlength_code_width_bytes - 1 + byte);
-				if (byte < (raw_data_width_bytes - 1))
-					buffer |= *(raw_sample_buffer + i * raw_data_width_bytes + runlength_code_width_bytes + byte) << 8;
-
-				buffer = buffer >> (devc->runlength_code_width % host_word_size);
-			} else {
-				buffer = *(raw_sample_buffer + i * raw_data_width_bytes + runlength_code_width_bytes + byte);
-			}
-			*run_buffer++ = buffer & 0x00ff;
-		}
-		for (uint32_t rep = 1; rep < repeats[i]; ++rep) {
-			memcpy(run_buffer, run_buffer - data_width_bytes, data_width_bytes);
-			run_buffer += data_width_bytes;
+	const uint8_t *raw;
+	uint32_t repeats;
+	int ret;
+
+	raw = devc->raw_sample_buf;
+	while (length >= raw_data_width_bytes) {
+		if (devc->num_raw_samples == devc->delay_value) {
+			ret = feed_queue_logic_send_trigger(devc->feed_queue);
+			if (ret != SR_OK)
+				return ret;
 		}
+		repeats = decode_raw_sample(devc, raw, devc->sample_value);
+		ret = feed_queue_logic_submit(devc->feed_queue,
+			devc->sample_value, repeats);
+		if (ret != SR_OK)
+			return ret;
+		devc->num_raw_samples++;
+		raw += raw_data_width_bytes;
+		length -= raw_data_width_bytes;
 	}
-	g_free(repeats);
-	g_free(raw_sample_buffer);
-	return TRUE;
+
+	if (length)
+		memmove(devc->raw_sample_buf, raw, length);
+	devc->raw_fill = length;
+
+	return SR_OK;
 }
 
 SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	struct ipdbg_la_tcp *tcp;
+	uint64_t wanted, total;
+	size_t take;
+	int recd;
 
 	(void)fd;
 	(void)revents;
@@ -380,112 +396,114 @@ SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 	if (!(devc = sdi->priv))
 		return FALSE;
 
-	struct ipdbg_la_tcp *tcp = sdi->conn;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
+	tcp = sdi->conn;
 
 	uint32_t raw_data_width_bytes =
 		(devc->data_width + devc->runlength_code_width + host_word_size - 1) /
 		host_word_size;
-	if (!devc->raw_sample_buf) {
-		devc->raw_sample_buf =
-			g_try_malloc(devc->limit_samples * raw_data_width_bytes);
+	wanted = devc->limit_samples * raw_data_width_bytes;
+	total = devc->limit_samples_max * raw_data_width_bytes;
+
+	if (!devc->feed_queue) {
+		devc->feed_queue = feed_queue_logic_alloc(sdi,
+			LOGIC_QUEUE_SAMPLES, devc->data_width_bytes);
+		devc->raw_sample_buf = sr_large_buffer_alloc(RAW_BUFFER_SIZE,
+			sr_dev_numa_node(sdi));
 		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
+			ipdbg_la_abort_acquisition(sdi);
 			return FALSE;
 		}
+		devc->sample_value = g_malloc0(devc->data_width_bytes);
+		devc->raw_fill = 0;
+		devc->num_raw_samples = 0;
 	}
-	if (devc->num_transfers <
-		(devc->limit_samples_max * raw_data_width_bytes)) {
-		const size_t bufsize = 1024*16;
-		uint8_t buffer[bufsize];
-		const int recd = ipdbg_la_tcp_receive(tcp, buffer, bufsize);
-		if (recd > 0) {
-			int num_move = (((devc->num_transfers + recd) <=
-							 (devc->limit_samples * raw_data_width_bytes))
-			?
-				recd
-			:
-				(int)((devc->limit_samples * raw_data_width_bytes) -
-						devc->num_transfers));
-			if (num_move > 0)
-				memcpy(&(devc->raw_sample_buf[devc->num_transfers]),
-						buffer, num_move);
-			devc->num_transfers += recd;
 
-		}
-	} else {
-		uint64_t delay_value;
-		uint64_t total_samples;
-		if (!ipdbg_la_runlength_decode(devc, &delay_value, &total_samples)) {
-			g_free(devc->raw_sample_buf);
-			devc->raw_sample_buf = NULL;
+	/*
+	 * Receive straight into the tail of the raw buffer, behind a
+	 * partial sample left over from the previous call. Only the first
+	 * limit_samples raw samples are of interest, the device sends its
+	 * whole memory and the remainder gets consumed and dropped.
+	 */
+	if (devc->num_transfers < total) {
+		recd = ipdbg_la_tcp_receive(tcp,
+			devc->raw_sample_buf + devc->raw_fill,
+			RAW_BUFFER_SIZE - devc->raw_fill);
+		if (recd < 0) {
+			ipdbg_la_abort_acquisition(sdi);
 			return FALSE;
 		}
-
-		if (delay_value > 0) {
-			/* There are pre-trigger samples, send these first. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = delay_value * devc->data_width_bytes;
-			logic.unitsize = devc->data_width_bytes;
-			logic.data = devc->raw_sample_buf;
-			sr_session_send(cb_data, &packet);
+		if (recd > 0 && devc->num_transfers < wanted) {
+			take = MIN((uint64_t)recd, wanted - devc->num_transfers);
+			if (process_raw_samples(devc, devc->raw_fill + take) != SR_OK) {
+				sr_err("Cannot send sample data.");
+				ipdbg_la_abort_acquisition(sdi);
+				return FALSE;
+			}
 		}
+		if (recd > 0)
+			devc->num_transfers += recd;
+	}
 
-		/* Send the trigger. */
-		std_session_send_df_trigger(cb_data);
-
-		/* Send post-trigger samples. */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = (total_samples - delay_value) *
-			devc->data_width_bytes;
-		logic.unitsize = devc->data_width_bytes;
-		logic.data = devc->raw_sample_buf +
-			(delay_value * devc->data_width_bytes);
-		sr_session_send(cb_data, &packet);
-
-		g_free(devc->raw_sample_buf);
-		devc->raw_sample_buf = NULL;
+	if (devc->num_transfers >= total)
 		ipdbg_la_abort_acquisition(sdi);
-	}
+
 	return TRUE;
 }
 
-static int send_escaping(struct ipdbg_la_tcp *tcp, uint8_t *data_to_send,
-	uint32_t length)
+/*
+ * Append data to a command buffer and escape bytes which the device
+ * would otherwise take for a reset or an escape command.
+ */
+static void append_escaping(GByteArray *cmd, const uint8_t *data,
+	size_t length)
 {
-	uint8_t escape = CMD_ESCAPE;
+	const uint8_t escape = CMD_ESCAPE;
 
 	while (length--) {
-		uint8_t payload = *data_to_send++;
+		uint8_t payload = *data++;
 
-		if (payload == CMD_RESET)
-			if (tcp_send(tcp, &escape, 1) != SR_OK)
-				sr_warn("Couldn't send escape");
+		if (payload == CMD_RESET || payload == CMD_ESCAPE)
+			g_byte_array_append(cmd, &escape, 1);
+		g_byte_array_append(cmd, &payload, 1);
+	}
+}
 
-		if (payload == CMD_ESCAPE)
-			if (tcp_send(tcp, &escape, 1) != SR_OK)
-				sr_warn("Couldn't send escape");
+/* Append a multi byte value to a command buffer, MSB first. */
+static void append_escaping_msb(GByteArray *cmd, const uint8_t *data,
+	size_t length)
+{
+	while (length--)
+		append_escaping(cmd, &data[length], 1);
+}
 
-		if (tcp_send(tcp, &payload, 1) != SR_OK)
-			sr_warn("Couldn't send data");
-	}
+static void append_trigger_reg(GByteArray *cmd, uint8_t select,
+	uint8_t reg, const uint8_t *data, size_t length)
+{
+	const uint8_t buf[] = { CMD_CFG_TRIGGER, select, reg, };
 
-	return SR_OK;
+	g_byte_array_append(cmd, buf, sizeof(buf));
+	append_escaping_msb(cmd, data, length);
+}
+
+static int send_cmd(struct ipdbg_la_tcp *tcp, GByteArray *cmd)
+{
+	int ret;
+
+	ret = tcp_send(tcp, cmd->data, cmd->len);
+	g_byte_array_free(cmd, TRUE);
+	if (ret != SR_OK)
+		sr_warn("Couldn't send command");
+
+	return ret;
 }
 
 SR_PRIV int ipdbg_la_send_delay(struct dev_context *devc,
 	struct ipdbg_la_tcp *tcp)
 {
-	devc->delay_value = ((devc->limit_samples - 1) / 100.0) * devc->capture_ratio;
+	const uint8_t delay_cmd[] = { CMD_CFG_LA, CMD_LA_DELAY, };
+	GByteArray *cmd;
 
-	uint8_t buf;
-	buf = CMD_CFG_LA;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_LA_DELAY;
-	tcp_send(tcp, &buf, 1);
+	devc->delay_value = ((devc->limit_samples - 1) / 100.0) * devc->capture_ratio;
 
 	uint8_t delay_buf[4] = { devc->delay_value & 0x000000ff,
 		(devc->delay_value >> 8) & 0x000000ff,
@@ -493,78 +511,35 @@ SR_PRIV int ipdbg_la_send_delay(struct dev_context *devc,
 		(devc->delay_value >> 24) & 0x000000ff
 	};
 
-	for (uint64_t i = 0; i < devc->addr_width_bytes; i++)
-		send_escaping(tcp, &(delay_buf[devc->addr_width_bytes - 1 - i]), 1);
+	cmd = g_byte_array_new();
+	g_byte_array_append(cmd, delay_cmd, sizeof(delay_cmd));
+	append_escaping_msb(cmd, delay_buf, devc->addr_width_bytes);
 
-	return SR_OK;
+	return send_cmd(tcp, cmd);
 }
 
 SR_PRIV int ipdbg_la_send_trigger(struct dev_context *devc,
 	struct ipdbg_la_tcp *tcp)
 {
-	uint8_t buf;
-
-	/* Mask */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASK;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_mask + devc->data_width_bytes - 1 - i, 1);
-
-	/* Value */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_VALUE;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_value + devc->data_width_bytes - 1 - i, 1);
-
-	/* Mask_last */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS_LAST;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASK_LAST;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_mask_last + devc->data_width_bytes - 1 - i, 1);
-
-	/* Value_last */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_MASKS_LAST;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_VALUE_LAST;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_value_last + devc->data_width_bytes - 1 - i, 1);
-
-	/* Edge_mask */
-	buf = CMD_CFG_TRIGGER;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_SELECT_EDGE_MASK;
-	tcp_send(tcp, &buf, 1);
-	buf = CMD_TRIG_SET_EDGE_MASK;
-	tcp_send(tcp, &buf, 1);
-
-	for (size_t i = 0; i < devc->data_width_bytes; i++)
-		send_escaping(tcp,
-			devc->trigger_edge_mask + devc->data_width_bytes - 1 - i, 1);
-
-	return SR_OK;
+	GByteArray *cmd;
+	size_t width;
+
+	/* Collect all trigger registers, and send them in one go. */
+	cmd = g_byte_array_new();
+	width = devc->data_width_bytes;
+
+	append_trigger_reg(cmd, CMD_TRIG_MASKS, CMD_TRIG_MASK,
+		devc->trigger_mask, width);
+	append_trigger_reg(cmd, CMD_TRIG_MASKS, CMD_TRIG_VALUE,
+		devc->trigger_value, width);
+	append_trigger_reg(cmd, CMD_TRIG_MASKS_LAST, CMD_TRIG_MASK_LAST,
+		devc->trigger_mask_last, width);
+	append_trigger_reg(cmd, CMD_TRIG_MASKS_LAST, CMD_TRIG_VALUE_LAST,
+		devc->trigger_value_last, width);
+	append_trigger_reg(cmd, CMD_TRIG_SELECT_EDGE_MASK, CMD_TRIG_SET_EDGE_MASK,
+		devc->trigger_edge_mask, width);
+
+	return send_cmd(tcp, cmd);
 }
 
 SR_PRIV void ipdbg_la_get_addrwidth_and_datawidth(
@@ -820,9 +795,20 @@ SR_PRIV int ipdbg_la_request_id(struct ipdbg_la_tcp *tcp, uint8_t *version)
 SR_PRIV void ipdbg_la_abort_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct ipdbg_la_tcp *tcp = sdi->conn;
+	struct dev_context *devc = sdi->priv;
 
 	sr_session_source_remove(sdi->session, tcp->socket);
 
+	if (devc->feed_queue) {
+		feed_queue_logic_flush(devc->feed_queue);
+		feed_queue_logic_free(devc->feed_queue);
+		devc->feed_queue = NULL;
+	}
+	sr_large_buffer_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = NULL;
+	g_free(devc->sample_value);
+	devc->sample_value = NULL;
+
 	std_session_send_df_end(sdi);
 }
 
@@ -27,6 +27,11 @@
 
 #define LOG_PREFIX "ipdbg-la"
 
+/* Receive buffer size for raw (run length coded) samples. */
+#define RAW_BUFFER_SIZE (16 * 1024)
+/* Number of decoded samples per session feed packet. */
+#define LOGIC_QUEUE_SAMPLES (64 * 1024)
+
 struct ipdbg_la_tcp {
 	char *address;
 	char *port;
@@ -55,6 +60,10 @@ struct dev_context {
 	uint64_t num_transfers;
 	uint8_t version;
 	uint8_t *raw_sample_buf;
+	size_t raw_fill;
+	uint64_t num_raw_samples;
+	uint8_t *sample_value;
+	struct feed_queue_logic *feed_queue;
 	uint8_t runlength_code_width;
 };
 
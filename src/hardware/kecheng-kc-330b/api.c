@@ -113,7 +113,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	drvc = di->context;
 
 	devices = NULL;
-	if ((usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, USB_CONN))) {
+	if ((usb_devices = sr_usb_find(drvc->sr_ctx, USB_CONN))) {
 		/* We have a list of sr_usb_dev_inst matching the connection
 		 * string. Wrap them in sr_dev_inst and we're done. */
 		for (l = usb_devices; l; l = l->next) {
@@ -378,28 +378,32 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (!(devc->xfer = libusb_alloc_transfer(0)))
 		return SR_ERR;
 
+	if (devc->data_source == DATA_SOURCE_MEMORY) {
+		if (!(devc->xfer_out = libusb_alloc_transfer(0))) {
+			libusb_free_transfer(devc->xfer);
+			return SR_ERR;
+		}
+		sr_datalog_init(&devc->log, devc->stored_samples,
+			LOG_CHUNK_SAMPLES, 1);
+		if (kecheng_kc_330b_log_request(sdi) != SR_OK) {
+			libusb_free_transfer(devc->xfer);
+			libusb_free_transfer(devc->xfer_out);
+			devc->xfer_out = NULL;
+			return SR_ERR;
+		}
+		usb_source_add(sdi->session, drvc->sr_ctx, 10,
+			kecheng_kc_330b_handle_events, (void *)sdi);
+		return SR_OK;
+	}
+
 	usb_source_add(sdi->session, drvc->sr_ctx, 10,
 		kecheng_kc_330b_handle_events, (void *)sdi);
 
-	if (devc->data_source == DATA_SOURCE_LIVE) {
-		buf[0] = CMD_GET_LIVE_SPL;
-		buf_len = 1;
-		devc->state = LIVE_SPL_WAIT;
-		devc->last_live_request = g_get_monotonic_time() / 1000;
-		req_len = 3;
-	} else {
-		buf[0] = CMD_GET_LOG_DATA;
-		buf[1] = 0;
-		buf[2] = 0;
-		buf_len = 4;
-		devc->state = LOG_DATA_WAIT;
-		if (devc->stored_samples < 63)
-			buf[3] = devc->stored_samples;
-		else
-			buf[3] = 63;
-		/* Command ack byte + 2 bytes per sample. */
-		req_len = 1 + buf[3] * 2;
-	}
+	buf[0] = CMD_GET_LIVE_SPL;
+	buf_len = 1;
+	devc->state = LIVE_SPL_WAIT;
+	devc->last_live_request = g_get_monotonic_time() / 1000;
+	req_len = 3;
 
 	ret = libusb_bulk_transfer(usb->devhdl, EP_OUT, buf, buf_len, &len, 5);
 	if (ret != 0 || len != 1) {
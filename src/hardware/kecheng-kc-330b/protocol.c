@@ -33,8 +33,8 @@ SR_PRIV int kecheng_kc_330b_handle_events(int fd, int revents, void *cb_data)
 	struct timeval tv;
 	const uint64_t *intv_entry;
 	gint64 now, interval;
-	int offset, len, ret;
-	unsigned char buf[4];
+	int len, ret;
+	unsigned char buf[1];
 
 	(void)fd;
 	(void)revents;
@@ -51,6 +51,8 @@ SR_PRIV int kecheng_kc_330b_handle_events(int fd, int revents, void *cb_data)
 
 	if (sdi->status == SR_ST_STOPPING) {
 		libusb_free_transfer(devc->xfer);
+		libusb_free_transfer(devc->xfer_out);
+		devc->xfer_out = NULL;
 		usb_source_remove(sdi->session, drvc->sr_ctx);
 		std_session_send_df_end(sdi);
 		sdi->status = SR_ST_ACTIVE;
@@ -75,30 +77,73 @@ SR_PRIV int kecheng_kc_330b_handle_events(int fd, int revents, void *cb_data)
 			devc->last_live_request = now;
 			devc->state = LIVE_SPL_WAIT;
 		}
-	} else if (devc->state == LIVE_SPL_IDLE) {
-		buf[0] = CMD_GET_LOG_DATA;
-		offset = devc->num_samples / 63;
-		buf[1] = (offset >> 8) & 0xff;
-		buf[2] = offset & 0xff;
-		if (devc->stored_samples - devc->num_samples > 63)
-			buf[3] = 63;
-		else
-			/* Last chunk. */
-			buf[3] = devc->stored_samples - devc->num_samples;
-		ret = libusb_bulk_transfer(usb->devhdl, EP_OUT, buf, 4, &len, 5);
-		if (ret != 0 || len != 4) {
-			sr_dbg("Failed to request next chunk: %s",
-					libusb_error_name(ret));
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
+	} else if (devc->state == LOG_DATA_WAIT) {
+		/* Re-request lost chunks, carry on where reception stopped. */
+		if (sr_datalog_timed_out(&devc->log)) {
+			if (sr_datalog_resume(&devc->log) != SR_OK) {
+				sr_err("Log download timed out.");
+				sr_dev_acquisition_stop(sdi);
+				return TRUE;
+			}
+			if (kecheng_kc_330b_log_request(sdi) != SR_OK)
+				sr_dev_acquisition_stop(sdi);
 		}
-		libusb_submit_transfer(devc->xfer);
-		devc->state = LIVE_SPL_WAIT;
 	}
 
 	return TRUE;
 }
 
+static void LIBUSB_CALL log_request_sent(struct libusb_transfer *transfer)
+{
+	/* Errors show as missing responses, which get re-requested. */
+	(void)transfer;
+}
+
+/*
+ * Request the next chunk of stored samples. The request is sent
+ * asynchronously, so that the next chunk gets requested right from
+ * the completion of the previous one, not upon the next poll.
+ */
+SR_PRIV int kecheng_kc_330b_log_request(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	uint64_t offset;
+	size_t count, chunk;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	if (!sr_datalog_next_request(&devc->log, &offset, &count))
+		return SR_OK;
+
+	chunk = offset / LOG_CHUNK_SAMPLES;
+	devc->cmd[0] = CMD_GET_LOG_DATA;
+	devc->cmd[1] = (chunk >> 8) & 0xff;
+	devc->cmd[2] = chunk & 0xff;
+	devc->cmd[3] = count;
+	libusb_fill_bulk_transfer(devc->xfer_out, usb->devhdl, EP_OUT,
+		devc->cmd, sizeof(devc->cmd), log_request_sent, NULL, 100);
+	if ((ret = libusb_submit_transfer(devc->xfer_out)) != 0) {
+		sr_dbg("Failed to request next chunk: %s",
+			libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	/* Command ack byte + 2 bytes per sample. */
+	libusb_fill_bulk_transfer(devc->xfer, usb->devhdl, EP_IN, devc->buf,
+		1 + count * 2, kecheng_kc_330b_receive_transfer, (void *)sdi, 100);
+	if ((ret = libusb_submit_transfer(devc->xfer)) != 0) {
+		sr_dbg("Failed to receive next chunk: %s",
+			libusb_error_name(ret));
+		return SR_ERR;
+	}
+	devc->state = LOG_DATA_WAIT;
+
+	return SR_OK;
+}
+
 static void send_data(const struct sr_dev_inst *sdi, void *buf, unsigned int buf_len)
 {
 	struct dev_context *devc;
@@ -166,24 +211,25 @@ SR_PRIV void LIBUSB_CALL kecheng_kc_330b_receive_transfer(struct libusb_transfer
 		}
 	} else if (devc->state == LOG_DATA_WAIT) {
 		if (transfer->actual_length < 1 || !(transfer->actual_length & 0x01)) {
+			/* Request the chunk again, or give up. */
 			sr_dbg("Received invalid stored SPL packet.");
-		} else {
-			num_samples = (transfer->actual_length - 1) / 2;
-			for (i = 0; i < num_samples; i++) {
-				fvalue[i] = transfer->buffer[1 + i * 2] << 8;
-				fvalue[i] += transfer->buffer[1 + i * 2 + 1];
-				fvalue[i] /= 10.0;
-			}
-			send_data(sdi, fvalue, 1);
-			devc->num_samples += num_samples;
-			if (devc->num_samples >= devc->stored_samples) {
+			if (sr_datalog_resume(&devc->log) != SR_OK ||
+					kecheng_kc_330b_log_request(sdi) != SR_OK)
 				sr_dev_acquisition_stop(sdi);
-			} else {
-				/* let USB event handler fire off another
-				 * request when the time is right. */
-				devc->state = LOG_DATA_IDLE;
-			}
+			return;
 		}
+		num_samples = (transfer->actual_length - 1) / 2;
+		for (i = 0; i < num_samples; i++) {
+			fvalue[i] = transfer->buffer[1 + i * 2] << 8;
+			fvalue[i] += transfer->buffer[1 + i * 2 + 1];
+			fvalue[i] /= 10.0;
+		}
+		send_data(sdi, fvalue, num_samples);
+		devc->num_samples += num_samples;
+		sr_datalog_block_done(&devc->log, num_samples);
+		if (sr_datalog_done(&devc->log) ||
+				kecheng_kc_330b_log_request(sdi) != SR_OK)
+			sr_dev_acquisition_stop(sdi);
 	}
 
 }
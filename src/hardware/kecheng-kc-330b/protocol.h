@@ -30,6 +30,9 @@
 #define EP_IN (0x80 | 1)
 #define EP_OUT 2
 
+/* Samples per log data request, the offset is in units of these. */
+#define LOG_CHUNK_SAMPLES 63
+
 /* 500ms */
 #define DEFAULT_SAMPLE_INTERVAL 0
 #define DEFAULT_ALARM_LOW 40
@@ -80,12 +83,16 @@ struct dev_context {
 	uint64_t stored_samples;
 	struct libusb_transfer *xfer;
 	unsigned char buf[128];
+	struct libusb_transfer *xfer_out;
+	unsigned char cmd[4];
+	struct sr_datalog log;
 
 	gint64 last_live_request;
 };
 
 SR_PRIV int kecheng_kc_330b_handle_events(int fd, int revents, void *cb_data);
 SR_PRIV void LIBUSB_CALL kecheng_kc_330b_receive_transfer(struct libusb_transfer *transfer);
+SR_PRIV int kecheng_kc_330b_log_request(const struct sr_dev_inst *sdi);
 SR_PRIV int kecheng_kc_330b_configure(const struct sr_dev_inst *sdi);
 SR_PRIV int kecheng_kc_330b_set_date_time(struct sr_dev_inst *sdi);
 SR_PRIV int kecheng_kc_330b_recording_get(const struct sr_dev_inst *sdi,
@@ -257,6 +257,7 @@ static void la2016_close_usb(struct sr_usb_dev_inst *usb)
 
 	if (usb->devhdl) {
 		libusb_release_interface(usb->devhdl, USB_INTERFACE);
+		sr_usb_transfer_pool_free(usb);
 		libusb_close(usb->devhdl);
 		usb->devhdl = NULL;
 	}
@@ -456,7 +457,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(ctx, conn);
 	if (conn && !conn_devices) {
 		sr_err("Cannot find the specified connection '%s'.", conn);
 		return NULL;
@@ -535,6 +536,8 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 				continue;
 			}
 			devc->fw_uploaded = g_get_monotonic_time();
+			/* Another device may have been plugged in, meanwhile. */
+			sr_dev_cache_invalidate(sdi);
 			usb->address = 0xff;
 			renum_devices = g_slist_append(renum_devices, sdi);
 			continue;
@@ -1076,6 +1079,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->packets_per_chunk /= unitsize + repsize;
 	}
 
+	/*
+	 * Capture memory content is run length encoded, have it sent to
+	 * the session in that form. Streaming mode data is not.
+	 */
+	ret = feed_queue_logic_set_rle(devc->feed_queue, !devc->continuous);
+	if (ret != SR_OK)
+		return ret;
+
 	sr_sw_limits_acquisition_start(&devc->sw_limits);
 
 	voltage = threshold_voltage(sdi, NULL);
@@ -1095,7 +1106,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	}
 
 	devc->completion_seen = FALSE;
-	usb_source_add(sdi->session, ctx, 50,
+	usb_source_add(sdi->session, ctx, la2016_receive_timeout(sdi),
 		la2016_receive_data, (void *)sdi);
 
 	std_session_send_df_header(sdi);
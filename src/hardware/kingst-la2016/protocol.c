@@ -32,6 +32,9 @@
 /* USB PID dependent MCU firmware. Model dependent FPGA bitstream. */
 #define MCU_FWFILE_FMT	"kingst-la-%04x.fw"
 #define FPGA_FWFILE_FMT	"kingst-%s-fpga.bitstream"
+#define FPGA_BITSTREAM_SIZE_LIMIT	(2 * 1024 * 1024)
+/* Multiple of LA2016_EP2_PADDING. */
+#define FPGA_UPLOAD_CHUNK_SIZE	(64 * 1024)
 
 /*
  * List of known devices and their features. See @ref kingst_model
@@ -137,6 +140,19 @@ static int ctrl_in(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+static int read_eeprom(const struct sr_dev_inst *sdi,
+	uint16_t offset, void *data, uint16_t len)
+{
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_EEPROM_READ, NULL, sdi);
+	ret = ctrl_in(sdi, CMD_EEPROM, offset, 0, data, len);
+	sr_profile_end(&scope, ret);
+
+	return ret;
+}
+
 static int ctrl_out(const struct sr_dev_inst *sdi,
 	uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
 	void *data, uint16_t wLength)
@@ -289,83 +305,55 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 {
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource bitstream;
-	uint32_t bitstream_size;
+	uint8_t *bitstream, *padding;
+	size_t bitstream_size, pad_size;
 	uint8_t buffer[sizeof(uint32_t)];
 	uint8_t *wrptr;
-	uint8_t block[4096];
-	int len, act_len;
-	unsigned int pos;
 	int ret;
-	unsigned int zero_pad_to;
 
 	drvc = sdi->driver->context;
 	usb = sdi->conn;
 
 	sr_info("Uploading FPGA bitstream '%s'.", bitstream_fname);
 
-	ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-		SR_RESOURCE_FIRMWARE, bitstream_fname);
-	if (ret != SR_OK) {
+	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		bitstream_fname, &bitstream_size, FPGA_BITSTREAM_SIZE_LIMIT);
+	if (!bitstream) {
 		sr_err("Cannot find FPGA bitstream %s.", bitstream_fname);
-		return ret;
+		return SR_ERR_IO;
 	}
 
-	bitstream_size = (uint32_t)bitstream.size;
 	wrptr = buffer;
-	write_u32le_inc(&wrptr, bitstream_size);
+	write_u32le_inc(&wrptr, (uint32_t)bitstream_size);
 	ret = ctrl_out(sdi, CMD_FPGA_INIT, 0x00, 0, buffer, wrptr - buffer);
 	if (ret != SR_OK) {
 		sr_err("Cannot initiate FPGA bitstream upload.");
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_free(bitstream);
 		return ret;
 	}
-	zero_pad_to = bitstream_size;
-	zero_pad_to += LA2016_EP2_PADDING - 1;
-	zero_pad_to /= LA2016_EP2_PADDING;
-	zero_pad_to *= LA2016_EP2_PADDING;
-
-	pos = 0;
-	while (1) {
-		if (pos < bitstream.size) {
-			len = (int)sr_resource_read(drvc->sr_ctx, &bitstream,
-				block, sizeof(block));
-			if (len < 0) {
-				sr_err("Cannot read FPGA bitstream.");
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR_IO;
-			}
-		} else {
-			/*  Zero-pad until 'zero_pad_to'. */
-			len = zero_pad_to - pos;
-			if ((unsigned)len > sizeof(block))
-				len = sizeof(block);
-			memset(&block, 0, len);
-		}
-		if (len == 0)
-			break;
-
-		ret = libusb_bulk_transfer(usb->devhdl, USB_EP_FPGA_BITSTREAM,
-			&block[0], len, &act_len, DEFAULT_TIMEOUT_MS);
-		if (ret != 0) {
-			sr_dbg("Cannot write FPGA bitstream, block %#x len %d: %s.",
-				pos, (int)len, libusb_error_name(ret));
-			ret = SR_ERR_IO;
-			break;
-		}
-		if (act_len != len) {
-			sr_dbg("Short write for FPGA bitstream, block %#x len %d: got %d.",
-				pos, (int)len, act_len);
-			ret = SR_ERR_IO;
-			break;
-		}
-		pos += len;
+
+	/*
+	 * Send the bitstream, then zero-pad to a multiple of the EP2
+	 * FIFO size. Both in as large transfers as the endpoint takes.
+	 */
+	ret = sr_usb_bulk_write(drvc->sr_ctx, usb, USB_EP_FPGA_BITSTREAM,
+		bitstream, bitstream_size, FPGA_UPLOAD_CHUNK_SIZE,
+		DEFAULT_TIMEOUT_MS);
+	g_free(bitstream);
+	pad_size = (LA2016_EP2_PADDING - bitstream_size % LA2016_EP2_PADDING)
+		% LA2016_EP2_PADDING;
+	if (ret == SR_OK && pad_size) {
+		padding = g_malloc0(pad_size);
+		ret = sr_usb_bulk_write(drvc->sr_ctx, usb,
+			USB_EP_FPGA_BITSTREAM, padding, pad_size,
+			LA2016_EP2_PADDING, DEFAULT_TIMEOUT_MS);
+		g_free(padding);
 	}
-	sr_resource_close(drvc->sr_ctx, &bitstream);
-	if (ret != SR_OK)
+	if (ret != SR_OK) {
+		sr_dbg("Cannot write FPGA bitstream.");
 		return ret;
-	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.",
-		bitstream.size);
+	}
+	sr_info("FPGA bitstream upload (%zu bytes) done.", bitstream_size);
 
 	return SR_OK;
 }
@@ -581,6 +569,8 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
+		stream->planes[ch->index] =
+			stream->plane_data[stream->enabled_count];
 		stream->channel_masks[stream->enabled_count++] = channel_mask;
 	}
 	stream->channel_index = 0;
@@ -813,6 +803,11 @@ static int set_sample_config(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Set sample config: %" PRIu64 "kHz (div %" PRIu16 "), %" PRIu64 " samples.",
 		eff_samplerate / SR_KHZ(1), divider_u16, limit_samples);
+
+	/* How long the capture is expected to take, see state_poll_ms(). */
+	devc->capture_us = limit_samples * 1000 * 1000 / eff_samplerate;
+	devc->post_trigger_us = (limit_samples - pre_trigger_samples) *
+		1000 * 1000 / eff_samplerate;
 	sr_dbg("Capture ratio %" PRIu64 "%%, count %" PRIu64 ", mem %" PRIu64 ".",
 		devc->capture_ratio, pre_trigger_samples, pre_trigger_memory);
 
@@ -916,7 +911,7 @@ static uint16_t run_state(const struct sr_dev_inst *sdi)
 
 	/*
 	 * Avoid flooding the log, only dump values as they change.
-	 * The routine is called about every 50ms.
+	 * The routine gets called repeatedly while capturing.
 	 */
 	if (state == previous_state)
 		return state;
@@ -939,15 +934,46 @@ static uint16_t run_state(const struct sr_dev_inst *sdi)
 	return state;
 }
 
-static gboolean la2016_is_idle(const struct sr_dev_inst *sdi)
+/*
+ * Determine when to poll the capture state next. Captures take about
+ * as long as the sample depth and rate suggest, from the start or from
+ * the trigger. Until then, half of the remaining time gets waited at a
+ * time, which ends up polling quickly near the expected end. Captures
+ * which take longer (waiting for the trigger, or the end is overdue)
+ * get polled with an exponential backoff.
+ */
+static int state_poll_ms(struct dev_context *devc, uint16_t state)
 {
-	uint16_t state;
+	int64_t now, expected_end, remain_ms;
 
-	state = run_state(sdi);
-	if ((state & runstate_mask_idle) == runstate_patt_idle)
-		return TRUE;
+	now = g_get_monotonic_time();
+	if ((state & runstate_mask_step) == runstate_patt_post_trig &&
+			!devc->trigger_seen_us) {
+		devc->trigger_seen_us = now;
+		devc->poll_backoff_ms = 0;
+	}
+
+	if (devc->trigger_seen_us)
+		expected_end = devc->trigger_seen_us + devc->post_trigger_us;
+	else if (devc->trigger_involved)
+		expected_end = devc->capture_start_us +
+			devc->capture_us - devc->post_trigger_us;
+	else
+		expected_end = devc->capture_start_us + devc->capture_us;
+
+	if ((state & runstate_mask_step) != runstate_patt_wait_trig &&
+			expected_end > now) {
+		remain_ms = (expected_end - now) / 1000 / 2;
+		return CLAMP(remain_ms, STATE_POLL_MIN_MS, STATE_POLL_MAX_MS);
+	}
+
+	if (!devc->poll_backoff_ms)
+		devc->poll_backoff_ms = STATE_POLL_MIN_MS;
+	else
+		devc->poll_backoff_ms = MIN(2 * devc->poll_backoff_ms,
+			STATE_POLL_MAX_MS);
 
-	return FALSE;
+	return devc->poll_backoff_ms;
 }
 
 static int set_run_mode(const struct sr_dev_inst *sdi, uint8_t mode)
@@ -1028,25 +1054,19 @@ SR_PRIV int la2016_upload_firmware(const struct sr_dev_inst *sdi,
 
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *xfer);
 
-static void la2016_usbxfer_release_cb(gpointer p)
-{
-	struct libusb_transfer *xfer;
-
-	xfer = p;
-	g_free(xfer->buffer);
-	libusb_free_transfer(xfer);
-}
-
 static int la2016_usbxfer_release(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	GSList *l;
 
 	devc = sdi ? sdi->priv : NULL;
 	if (!devc)
 		return SR_ERR_ARG;
 
-	/* Release all USB transfers. */
-	g_slist_free_full(devc->transfers, la2016_usbxfer_release_cb);
+	/* Return all USB transfers to the device's pool. */
+	for (l = devc->transfers; l; l = l->next)
+		sr_usb_transfer_put(sdi->conn, l->data);
+	g_slist_free(devc->transfers);
 	devc->transfers = NULL;
 
 	return SR_OK;
@@ -1056,7 +1076,6 @@ static int la2016_usbxfer_allocate(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	size_t bufsize, xfercount;
-	uint8_t *buffer;
 	struct libusb_transfer *xfer;
 
 	devc = sdi ? sdi->priv : NULL;
@@ -1080,18 +1099,9 @@ static int la2016_usbxfer_allocate(const struct sr_dev_inst *sdi)
 	bufsize = LA2016_USB_BUFSZ;
 	xfercount = LA2016_USB_XFER_COUNT;
 	while (xfercount--) {
-		buffer = g_try_malloc(bufsize);
-		if (!buffer) {
-			sr_err("Cannot allocate USB transfer buffer.");
-			return SR_ERR_MALLOC;
-		}
-		xfer = libusb_alloc_transfer(0);
-		if (!xfer) {
-			sr_err("Cannot allocate USB transfer.");
-			g_free(buffer);
+		xfer = sr_usb_transfer_get(sdi->conn, bufsize);
+		if (!xfer)
 			return SR_ERR_MALLOC;
-		}
-		xfer->buffer = buffer;
 		devc->transfers = g_slist_append(devc->transfers, xfer);
 	}
 	devc->transfer_bufsize = bufsize;
@@ -1141,7 +1151,7 @@ static int la2016_usbxfer_resubmit(const struct sr_dev_inst *sdi,
 		USB_EP_CAPTURE_DATA | LIBUSB_ENDPOINT_IN,
 		xfer->buffer, devc->transfer_bufsize,
 		cb, (void *)sdi, CAPTURE_TIMEOUT_MS);
-	ret = libusb_submit_transfer(xfer);
+	ret = sr_usb_submit_transfer(xfer);
 	if (ret != 0) {
 		sr_err("Cannot submit USB transfer: %s.",
 			libusb_error_name(ret));
@@ -1183,9 +1193,12 @@ SR_PRIV int la2016_setup_acquisition(const struct sr_dev_inst *sdi,
 
 	devc = sdi->priv;
 
-	ret = set_threshold_voltage(sdi, voltage);
-	if (ret != SR_OK)
-		return ret;
+	/* Keep the previous setup when the session gets rearmed. */
+	if (!sr_dev_acquisition_rearmed(sdi)) {
+		ret = set_threshold_voltage(sdi, voltage);
+		if (ret != SR_OK)
+			return ret;
+	}
 
 	cmd = devc->continuous ? CAPTMODE_STREAM : CAPTMODE_TO_RAM;
 	ret = ctrl_out(sdi, CMD_FPGA_SPI, REG_CAPT_MODE, 0, &cmd, sizeof(cmd));
@@ -1194,6 +1207,11 @@ SR_PRIV int la2016_setup_acquisition(const struct sr_dev_inst *sdi,
 		return ret;
 	}
 
+	if (sr_dev_acquisition_rearmed(sdi)) {
+		sr_dbg("Rearmed, keeping sample and trigger config.");
+		return SR_OK;
+	}
+
 	ret = set_trigger_config(sdi);
 	if (ret != SR_OK)
 		return ret;
@@ -1234,11 +1252,26 @@ SR_PRIV int la2016_start_acquisition(const struct sr_dev_inst *sdi)
 		ret = set_run_mode(sdi, RUNMODE_RUN);
 		if (ret != SR_OK)
 			return ret;
+		devc->capture_start_us = g_get_monotonic_time();
+		devc->trigger_seen_us = 0;
+		devc->poll_backoff_ms = 0;
 	}
 
 	return SR_OK;
 }
 
+/* The receive callback's first invocation, polls the capture state. */
+SR_PRIV int la2016_receive_timeout(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->continuous)
+		return RECEIVE_TIMEOUT_MS;
+
+	return state_poll_ms(devc, runstate_patt_pre_trig);
+}
+
 static int la2016_stop_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -1343,17 +1376,22 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
  *
  * This implementation silently ignores the (weak) sequence number.
  */
+/* Number of (value, repetitions) tuples which get queued in one go. */
+#define SEND_CHUNK_RUNS 256
+
 static void send_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
-	size_t num_xfers, num_pkts, num_seqs;
+	size_t num_xfers, num_pkts;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
+	size_t unitsize, num_runs;
+	uint64_t chunk_samples;
+	uint8_t values[SEND_CHUNK_RUNS * sizeof(uint32_t)];
+	size_t counts[SEND_CHUNK_RUNS];
 
 	devc = sdi->priv;
+	unitsize = devc->model->channel_count / 8;
 
 	/* Ignore incoming USB data after complete sample data download. */
 	if (devc->download_finished)
@@ -1374,43 +1412,53 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	else
 		devc->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
-	sample_value = 0;
+	/*
+	 * Process the received chunk of capture data. Collect the
+	 * packets' (value, repetitions) tuples, values are little endian
+	 * in the device's memory as well as in the feed queue. Have a
+	 * batch of them queued when the buffer is full, and before the
+	 * trigger marker. Account for the chunk's samples once.
+	 */
 	rp = data_buffer;
+	num_runs = 0;
+	chunk_samples = 0;
 	num_xfers = data_length / devc->transfer_size;
 	while (num_xfers--) {
 		num_pkts = devc->packets_per_chunk;
 		while (num_pkts--) {
-
-			if (devc->model->channel_count == 32)
-				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
-				sample_value = read_u16le_inc(&rp);
-			repetitions = read_u8_inc(&rp);
-
-			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit(devc->feed_queue,
-				sample_buff, repetitions);
-			sr_sw_limits_update_samples_read(&devc->sw_limits,
-				repetitions);
+			memcpy(&values[num_runs * unitsize], rp, unitsize);
+			rp += unitsize;
+			counts[num_runs] = read_u8_inc(&rp);
+			chunk_samples += counts[num_runs];
+			num_runs++;
 
 			if (devc->trigger_involved && !devc->trigger_marked) {
 				if (!--devc->n_reps_until_trigger) {
+					feed_queue_logic_submit_many(devc->feed_queue,
+						values, counts, num_runs);
+					num_runs = 0;
 					feed_queue_logic_send_trigger(devc->feed_queue);
 					devc->trigger_marked = TRUE;
 					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
-						devc->total_samples,
-						(double)devc->total_samples / devc->samplerate * 1e3);
+						devc->total_samples + chunk_samples,
+						(double)(devc->total_samples + chunk_samples) /
+						devc->samplerate * 1e3);
 				}
 			}
+			if (num_runs == SEND_CHUNK_RUNS) {
+				feed_queue_logic_submit_many(devc->feed_queue,
+					values, counts, num_runs);
+				num_runs = 0;
+			}
 		}
 		/* Skip the sequence number bytes. */
-		num_seqs = devc->sequence_size;
-		while (num_seqs--)
-			(void)read_u8_inc(&rp);
+		rp += devc->sequence_size;
 	}
+	if (num_runs)
+		feed_queue_logic_submit_many(devc->feed_queue,
+			values, counts, num_runs);
+	devc->total_samples += chunk_samples;
+	sr_sw_limits_update_samples_read(&devc->sw_limits, chunk_samples);
 
 	/*
 	 * Check for several conditions which shall terminate the
@@ -1452,10 +1500,11 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * Implementor's note: This routine is inspired by convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
+ * The transpose is done by the common bit plane helper, 8x8 tiles at a
+ * time. Feed queue space for all the chunk's complete rounds over the
+ * enabled channels is reserved once, samples get written there
+ * directly. Operation was verified with an LA2016 device. The LA5032
+ * reportedly shares the 16 samples per channel layout, just round-robins through a potentially larger set of enabled
  * channels before returning to the first of the channels.
  */
 static void stream_data(struct sr_dev_inst *sdi,
@@ -1465,10 +1514,8 @@ static void stream_data(struct sr_dev_inst *sdi,
 	struct stream_state_t *stream;
 	size_t bit_count;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
-	size_t bit_idx;
-	uint32_t ch_mask;
+	uint8_t *plane, *wrptr;
+	size_t unitsize, rounds, done;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1483,38 +1530,55 @@ static void stream_data(struct sr_dev_inst *sdi,
 
 	/* All channels' chunks carry 16 samples for one channel. */
 	bit_count = 16;
+	unitsize = devc->model->channel_count / 8;
 	data_length /= sizeof(uint16_t);
 
+	/* Get space for all rounds which this chunk completes. */
+	if (!stream->enabled_count)
+		return;
+	rounds = (stream->channel_index + data_length) / stream->enabled_count;
+	wrptr = NULL;
+	if (rounds) {
+		wrptr = feed_queue_logic_reserve(devc->feed_queue,
+			rounds * bit_count);
+		if (!wrptr) {
+			sr_err("Cannot queue stream samples.");
+			devc->download_finished = TRUE;
+			return;
+		}
+	}
+
+	done = 0;
 	rp = data_buffer;
-	sample_value = 0;
 	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
+		/*
+		 * Keep another entity in the channel's bit plane. These
+		 * are little endian with the first sample in bit 0, which
+		 * is what the transpose wants, so they need no decoding.
+		 */
+		plane = stream->plane_data[stream->channel_index];
+		memcpy(plane, rp, sizeof(uint16_t));
+		rp += sizeof(uint16_t);
 
 		/*
-		 * Advance to the next channel. Submit a block of
+		 * Advance to the next channel. Convert a block of
 		 * samples when all channels' data was seen.
 		 */
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit(devc->feed_queue, sample_buff, 1);
-		}
-		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
-		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
+		sr_bitplanes_to_samples(wrptr, unitsize, stream->planes,
+			sizeof(uint16_t));
+		wrptr += bit_count * unitsize;
+		done++;
 		stream->channel_index = 0;
 	}
+	if (done) {
+		feed_queue_logic_commit(devc->feed_queue, done * bit_count);
+		sr_sw_limits_update_samples_read(&devc->sw_limits,
+			done * bit_count);
+		devc->total_samples += done * bit_count;
+	}
 
 	/*
 	 * Need we count empty or failed USB transfers? This version
@@ -1553,6 +1617,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	device_gone = transfer->status == LIBUSB_TRANSFER_NO_DEVICE;
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
+	sr_usb_capture_transfer(sdi, transfer);
 	if (device_gone) {
 		sr_warn("Lost communication to USB device.");
 		devc->download_finished = TRUE;
@@ -1566,6 +1632,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	 * or exhausting the device's captured data will complete the
 	 * sample data download.
 	 */
+	feed_queue_logic_set_time(devc->feed_queue, g_get_monotonic_time());
 	if (devc->continuous)
 		stream_data(sdi, transfer->buffer, transfer->actual_length);
 	else
@@ -1590,6 +1657,7 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	struct timeval tv;
+	uint16_t state;
 	int ret;
 
 	(void)fd;
@@ -1624,17 +1692,21 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	/*
-	 * Wait for the acquisition to complete in hardware.
-	 * Periodically check a potentially configured msecs timeout.
+	 * Wait for the acquisition to complete in hardware, polling
+	 * at the times which state_poll_ms() suggests. Periodically
+	 * check a potentially configured msecs timeout.
 	 */
 	if (!devc->continuous && !devc->completion_seen) {
-		if (!la2016_is_idle(sdi)) {
+		state = run_state(sdi);
+		if ((state & runstate_mask_idle) != runstate_patt_idle) {
 			if (sr_sw_limits_check(&devc->sw_limits)) {
 				devc->sw_limits.limit_msec = 0;
 				sr_dbg("Limit reached. Stopping acquisition.");
 				la2016_stop_acquisition(sdi);
 			}
 			/* Not yet ready for sample data download. */
+			usb_source_timeout_set(sdi->session, drvc->sr_ctx,
+				state_poll_ms(devc, state));
 			return TRUE;
 		}
 		sr_dbg("Acquisition completion seen (hardware).");
@@ -1655,8 +1727,10 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 			return FALSE;
 		}
 		sr_dbg("Acquisition data download started.");
+		usb_source_timeout_set(sdi->session, drvc->sr_ctx,
+			RECEIVE_TIMEOUT_MS);
 
-		return TRUE;
+		/* Don't wait for the next invocation to see data. */
 	}
 
 	/* Handle USB reception. Drives sample data download. */
@@ -1713,6 +1787,8 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 {
 	struct dev_context *devc;
 	uint8_t buf[8]; /* Larger size of manuf date and device type magic. */
+	uint8_t eeprom[4 + 8]; /* Both of them, for the device cache. */
+	gboolean cached, date_ok;
 	size_t rdoff, rdlen;
 	const uint8_t *rdptr;
 	uint8_t date_yy, date_mm;
@@ -1724,6 +1800,14 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 
 	devc = sdi->priv;
 
+	/*
+	 * The EEPROM content of devices which were seen before (with the
+	 * same MCU firmware, which gets uploaded after power up) comes
+	 * from the device cache.
+	 */
+	cached = sr_dev_cache_get(sdi, "eeprom", devc->mcu_firmware,
+		eeprom, sizeof(eeprom)) == SR_OK;
+
 	/*
 	 * Four EEPROM bytes at offset 0x20 are the manufacturing date,
 	 * year and month in BCD format, followed by inverted values for
@@ -1733,7 +1817,15 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 	 */
 	rdoff = 0x20;
 	rdlen = 4 * sizeof(uint8_t);
-	ret = ctrl_in(sdi, CMD_EEPROM, rdoff, 0, buf, rdlen);
+	if (cached) {
+		memcpy(buf, &eeprom[0], rdlen);
+		ret = SR_OK;
+	} else {
+		ret = read_eeprom(sdi, rdoff, buf, rdlen);
+	}
+	date_ok = ret == SR_OK;
+	if (date_ok)
+		memcpy(&eeprom[0], buf, rdlen);
 	if (ret != SR_OK && !show_message) {
 		/* Non-fatal weak attempt during probe. Not worth logging. */
 		sr_dbg("Cannot access EEPROM.");
@@ -1799,11 +1891,21 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 	devc->identify_magic = 0;
 	rdoff = 0x08;
 	rdlen = 8 * sizeof(uint8_t);
-	ret = ctrl_in(sdi, CMD_EEPROM, rdoff, 0, &buf, rdlen);
+	if (cached) {
+		memcpy(buf, &eeprom[4], rdlen);
+		ret = SR_OK;
+	} else {
+		ret = read_eeprom(sdi, rdoff, &buf, rdlen);
+	}
 	if (ret != SR_OK) {
 		sr_err("Cannot read EEPROM device identifier bytes.");
 		return ret;
 	}
+	if (!cached && date_ok) {
+		memcpy(&eeprom[4], buf, rdlen);
+		sr_dev_cache_put(sdi, "eeprom", devc->mcu_firmware,
+			eeprom, sizeof(eeprom));
+	}
 	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
 		GString *txt;
 		txt = sr_hexdump_new(buf, rdlen);
@@ -1858,6 +1960,8 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 	}
 	if (!devc->model) {
 		sr_err("Cannot identify as one of the supported models.");
+		if (cached)
+			sr_dev_cache_invalidate(sdi);
 		return SR_ERR_DATA;
 	}
 
@@ -1866,22 +1970,45 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 
 SR_PRIV int la2016_init_hardware(const struct sr_dev_inst *sdi)
 {
+	struct drv_context *drvc;
 	struct dev_context *devc;
 	const char *bitstream_fn;
+	char *target;
+	struct sr_profile_scope scope;
 	int ret;
 	uint16_t state;
 
 	devc = sdi->priv;
 	bitstream_fn = devc ? devc->fpga_bitstream : "";
 
+	/*
+	 * A running bitstream only gets re-used when it is not known to
+	 * differ from the current file content.
+	 */
+	drvc = sdi->driver->context;
+	target = g_strdup_printf("%s/%s/fpga", sdi->driver->name,
+		sdi->connection_id);
 	ret = check_fpga_bitstream(sdi);
+	if (ret == SR_OK && sr_resource_check_loaded(drvc->sr_ctx, target,
+			SR_RESOURCE_FIRMWARE, bitstream_fn) == SR_ERR_DATA) {
+		sr_info("FPGA bitstream file changed since its upload.");
+		ret = SR_ERR_DATA;
+	}
 	if (ret != SR_OK) {
+		sr_profile_begin(&scope, NULL, SR_PROFILE_FPGA_CONFIG, NULL, sdi);
 		ret = upload_fpga_bitstream(sdi, bitstream_fn);
+		sr_profile_end(&scope, ret);
 		if (ret != SR_OK) {
 			sr_err("Cannot upload FPGA bitstream.");
+			sr_resource_set_loaded(drvc->sr_ctx, target,
+				SR_RESOURCE_FIRMWARE, NULL);
+			g_free(target);
 			return ret;
 		}
+		sr_resource_set_loaded(drvc->sr_ctx, target,
+			SR_RESOURCE_FIRMWARE, bitstream_fn);
 	}
+	g_free(target);
 	ret = enable_fpga_bitstream(sdi);
 	if (ret != SR_OK) {
 		sr_err("Cannot enable FPGA bitstream after upload.");
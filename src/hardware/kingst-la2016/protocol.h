@@ -52,6 +52,15 @@
 #define DEFAULT_TIMEOUT_MS	200
 #define CAPTURE_TIMEOUT_MS	500
 
+/*
+ * Invocation period of the receive callback, and bounds of the capture
+ * state polls. Polls get more frequent as the expected end of a capture
+ * comes near, and back off when a capture takes longer than expected.
+ */
+#define RECEIVE_TIMEOUT_MS	50
+#define STATE_POLL_MIN_MS	2
+#define STATE_POLL_MAX_MS	200
+
 /*
  * Check for MCU firmware to take effect after upload. Check the device
  * presence for a maximum period of time, delay between checks in that
@@ -155,6 +164,12 @@ struct dev_context {
 	gboolean trigger_marked;
 	uint64_t total_samples;
 	uint32_t read_pos;
+	/* Expected capture timing, see la2016_receive_data(). */
+	uint64_t capture_us;
+	uint64_t post_trigger_us;
+	int64_t capture_start_us;
+	int64_t trigger_seen_us;
+	int poll_backoff_ms;
 
 	struct feed_queue_logic *feed_queue;
 	GSList *transfers;
@@ -164,7 +179,8 @@ struct dev_context {
 		uint32_t enabled_mask;
 		uint32_t channel_masks[32];
 		size_t channel_index;
-		uint32_t sample_data[32];
+		uint8_t plane_data[32][sizeof(uint16_t)];
+		const uint8_t *planes[32];
 		uint64_t flush_period_ms;
 		uint64_t last_flushed;
 	} stream;
@@ -181,6 +197,7 @@ SR_PRIV int la2016_setup_acquisition(const struct sr_dev_inst *sdi,
 	double voltage);
 SR_PRIV int la2016_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV int la2016_receive_timeout(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data);
 SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi);
 
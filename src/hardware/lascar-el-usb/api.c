@@ -63,7 +63,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		return NULL;
 
 	devices = NULL;
-	if ((usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn))) {
+	if ((usb_devices = sr_usb_find(drvc->sr_ctx, conn))) {
 		/* We have a list of sr_usb_dev_inst matching the connection
 		 * string. Wrap them in sr_dev_inst and we're done. */
 		for (l = usb_devices; l; l = l->next) {
@@ -267,7 +267,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct sr_usb_dev_inst *usb;
 	struct libusb_transfer *xfer_in, *xfer_out;
 	struct timeval tv;
-	uint64_t interval;
+	uint64_t interval, offset;
+	size_t count, i;
 	int ret;
 	unsigned char cmd[3], resp[4], *buf;
 
@@ -357,14 +358,30 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	usb_source_add(sdi->session, drvc->sr_ctx, 100,
 			lascar_el_usb_handle_events, (void *)sdi);
 
-	buf = g_malloc(4096);
-	libusb_fill_bulk_transfer(xfer_in, usb->devhdl, LASCAR_EP_IN,
-			buf, 4096, lascar_el_usb_receive_transfer,
-			(struct sr_dev_inst *)sdi, 100);
-	if ((ret = libusb_submit_transfer(xfer_in) != 0)) {
-		sr_err("Unable to submit transfer: %s.", libusb_error_name(ret));
-		libusb_free_transfer(xfer_in);
-		g_free(buf);
+	/*
+	 * The device streams its log after the request. Keep several
+	 * transfers queued so that the host does not idle between the
+	 * completion of one transfer and the submission of the next.
+	 */
+	sr_datalog_init(&devc->log, devc->log_size, LOG_XFER_SIZE,
+		LOG_XFER_DEPTH);
+	for (i = 0; sr_datalog_next_request(&devc->log, &offset, &count); i++) {
+		if (i && !(xfer_in = libusb_alloc_transfer(0)))
+			break;
+		buf = g_malloc(LOG_XFER_SIZE);
+		libusb_fill_bulk_transfer(xfer_in, usb->devhdl, LASCAR_EP_IN,
+				buf, LOG_XFER_SIZE, lascar_el_usb_receive_transfer,
+				(struct sr_dev_inst *)sdi, 100);
+		if ((ret = libusb_submit_transfer(xfer_in)) != 0) {
+			sr_err("Unable to submit transfer: %s.",
+				libusb_error_name(ret));
+			libusb_free_transfer(xfer_in);
+			g_free(buf);
+			break;
+		}
+	}
+	if (!i) {
+		usb_source_remove(sdi->session, drvc->sr_ctx);
 		return SR_ERR;
 	}
 
@@ -525,6 +525,8 @@ SR_PRIV void LIBUSB_CALL lascar_el_usb_receive_transfer(struct libusb_transfer *
 	struct sr_dev_inst *sdi;
 	int ret;
 	gboolean packet_has_error;
+	uint64_t offset;
+	size_t count;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
@@ -548,6 +550,7 @@ SR_PRIV void LIBUSB_CALL lascar_el_usb_receive_transfer(struct libusb_transfer *
 			lascar_el_usb_dispatch(sdi, transfer->buffer,
 					transfer->actual_length);
 		devc->rcvd_bytes += transfer->actual_length;
+		sr_datalog_block_done(&devc->log, transfer->actual_length);
 		sr_spew("received %d/%d bytes (%d/%d samples)",
 				devc->rcvd_bytes, devc->log_size,
 				devc->rcvd_samples, devc->logged_samples);
@@ -555,8 +558,9 @@ SR_PRIV void LIBUSB_CALL lascar_el_usb_receive_transfer(struct libusb_transfer *
 			sr_dev_acquisition_stop(sdi);
 	}
 
-	if (sdi->status == SR_ST_ACTIVE) {
-		/* Send the same request again. */
+	if (sdi->status == SR_ST_ACTIVE && (packet_has_error ||
+			sr_datalog_next_request(&devc->log, &offset, &count))) {
+		/* Keep the pipe busy while the log is not complete. */
 		if ((ret = libusb_submit_transfer(transfer) != 0)) {
 			sr_err("Unable to resubmit transfer: %s.",
 			       libusb_error_name(ret));
@@ -34,6 +34,9 @@
 /* Max 100ms for a device to positively identify. */
 #define SCAN_TIMEOUT (100 * 1000)
 #define BULK_XFER_TIMEOUT (10 * 1000)
+/* Log download: bytes per bulk transfer, and transfers kept in flight. */
+#define LOG_XFER_SIZE 4096
+#define LOG_XFER_DEPTH 4
 #define EVENTS_TIMEOUT (10 * 1000)
 #define SLEEP_US_LONG (5 * 1000)
 #define SLEEP_US_SHORT (1 * 1000)
@@ -45,6 +48,7 @@ struct dev_context {
 	unsigned char config[MAX_CONFIGBLOCK_SIZE];
 	unsigned int log_size;
 	unsigned int rcvd_bytes;
+	struct sr_datalog log;
 	unsigned int sample_size;
 	unsigned int logged_samples;
 	unsigned int rcvd_samples;
@@ -545,33 +545,20 @@ static int lecroy_waveform_2_x_to_analog(GByteArray *data,
 	struct sr_analog_encoding *encoding = analog->encoding;
 	struct sr_analog_meaning *meaning = analog->meaning;
 	struct sr_analog_spec *spec = analog->spec;
-	float *data_float;
-	int16_t *waveform_data;
-	unsigned int i, num_samples;
 
-	data_float = g_malloc(desc->version_2_x.wave_array_count * sizeof(float));
-	num_samples = desc->version_2_x.wave_array_count;
-
-	waveform_data = (int16_t*)(data->data +
+	/*
+	 * Pass the waveform's 16 bit words on, they stay in the received
+	 * block. Consumers apply the vertical gain and offset.
+	 */
+	analog->data = data->data
 		+ desc->version_2_x.wave_descriptor_length
-		+ desc->version_2_x.user_text_len);
-
-	for (i = 0; i < num_samples; i++)
-		data_float[i] = (float)waveform_data[i]
-			* desc->version_2_x.vertical_gain
-			+ desc->version_2_x.vertical_offset;
-
-	analog->data = data_float;
-	analog->num_samples = num_samples;
+		+ desc->version_2_x.user_text_len;
+	analog->num_samples = desc->version_2_x.wave_array_count;
 
-	encoding->unitsize = sizeof(float);
-	encoding->is_signed = TRUE;
-	encoding->is_float = TRUE;
-	encoding->is_bigendian = FALSE;
-	encoding->scale.p = 1;
-	encoding->scale.q = 1;
-	encoding->offset.p = 0;
-	encoding->offset.q = 1;
+	sr_analog_encoding_set_raw(encoding, sizeof(int16_t), TRUE,
+		desc->version_2_x.comm_order != 1,
+		desc->version_2_x.vertical_gain,
+		desc->version_2_x.vertical_offset);
 
 	encoding->digits = 6;
 	encoding->is_digits_decimal = FALSE;
@@ -654,7 +641,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		return SR_ERR;
 
 	if (analog.num_samples == 0) {
-		g_free(analog.data);
 		g_byte_array_free(data, TRUE);
 
 		/* No data available, we have to acquire data first. */
@@ -667,7 +653,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		/* Update sample rate if needed. */
 		if (state->sample_rate == 0)
 			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK) {
-				g_free(analog.data);
 				g_byte_array_free(data, TRUE);
 				return SR_ERR;
 			}
@@ -689,7 +674,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	data = NULL;
 
 	g_slist_free(meaning.channels);
-	g_free(analog.data);
 
 	/*
 	 * Advance to the next enabled channel. When data for all enabled
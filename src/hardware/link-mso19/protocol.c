@@ -345,26 +345,70 @@ SR_PRIV int mso_check_trigger(struct sr_serial_dev_inst *serial, uint8_t *info)
 	return ret;
 }
 
-SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+/*
+ * Send a frame's logic and analog samples back to back. The analog
+ * samples go out as the raw 10-bit ADC values, the receivers convert
+ * them when they need to.
+ */
+static void send_frame(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc = sdi->priv;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel *ch;
+	GSList channels;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = FRAME_SAMPLES;
+	logic.unitsize = 1;
+	logic.data = devc->logic_out;
+	sr_session_send(sdi, &packet);
+
+	/* The DSO is the first channel. */
+	ch = sdi->channels->data;
+	if (!ch->enabled)
+		return;
+
+	/* FIXME: Need to do conversion to mV */
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	encoding.unitsize = sizeof(devc->analog_out[0]);
+	encoding.is_signed = FALSE;
+	encoding.is_float = FALSE;
+	channels.data = ch;
+	channels.next = NULL;
+	analog.meaning->channels = &channels;
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_UNITLESS;
+	analog.num_samples = FRAME_SAMPLES;
+	analog.data = devc->analog_out;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+}
+
+SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+{
 	struct sr_dev_inst *sdi = cb_data;
 	struct dev_context *devc = sdi->priv;
-	int i;
+	const uint8_t *p;
+	gboolean last;
+	uint8_t state;
+	int i, s;
 
+	(void)fd;
 	(void)revents;
 
-	uint8_t in[1024];
-	size_t s = serial_read(devc->serial, in, sizeof(in));
-
-	if (s <= 0)
-		return FALSE;
-
 	/* Check if we triggered, then send a command that we are ready
 	 * to read the data */
 	if (devc->trigger_state != MSO_TRIGGER_DATAREADY) {
-		devc->trigger_state = in[0];
+		if (serial_read(devc->serial, &state, 1) != 1)
+			return FALSE;
+		devc->trigger_state = state;
 		if (devc->trigger_state == MSO_TRIGGER_DATAREADY) {
 			mso_read_buffer(sdi);
 			devc->buffer_n = 0;
@@ -374,36 +418,41 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	/* the hardware always dumps 1024 samples, 24bits each */
-	if (devc->buffer_n < 3072) {
-		memcpy(devc->buffer + devc->buffer_n, in, s);
-		devc->buffer_n += s;
-	}
-	if (devc->buffer_n < 3072)
+	/*
+	 * Read the dump straight into the frame buffer. Don't read past
+	 * the frame, the next trigger state already follows it.
+	 */
+	s = serial_read(devc->serial, devc->buffer + devc->buffer_n,
+		FRAME_BYTES - devc->buffer_n);
+	if (s <= 0)
+		return FALSE;
+	devc->buffer_n += s;
+	if (devc->buffer_n < FRAME_BYTES)
 		return TRUE;
 
-	/* do the conversion */
-	uint8_t logic_out[1024];
-	double analog_out[1024];
-	for (i = 0; i < 1024; i++) {
-		/* FIXME: Need to do conversion to mV */
-		analog_out[i] = (devc->buffer[i * 3] & 0x3f) |
-		    ((devc->buffer[i * 3 + 1] & 0xf) << 6);
-		(void)analog_out;
-		logic_out[i] = ((devc->buffer[i * 3 + 1] & 0x30) >> 4) |
-		    ((devc->buffer[i * 3 + 2] & 0x3f) << 2);
+	/*
+	 * Re-arm before the conversion, so that the next capture runs
+	 * while this frame gets converted and sent.
+	 */
+	devc->num_samples += FRAME_SAMPLES;
+	last = devc->limit_samples && devc->num_samples >= devc->limit_samples;
+	devc->trigger_state = 0x00;
+	if (!last && (mso_arm(sdi) != SR_OK ||
+	    mso_check_trigger(devc->serial, NULL) != SR_OK)) {
+		sr_err("Failed to re-arm the trigger.");
+		last = TRUE;
 	}
 
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.length = 1024;
-	logic.unitsize = 1;
-	logic.data = logic_out;
-	sr_session_send(sdi, &packet);
-
-	devc->num_samples += 1024;
+	/* do the conversion */
+	p = devc->buffer;
+	for (i = 0; i < FRAME_SAMPLES; i++, p += 3) {
+		devc->analog_out[i] = (p[0] & 0x3f) | ((p[1] & 0xf) << 6);
+		devc->logic_out[i] = ((p[1] & 0x30) >> 4) |
+		    ((p[2] & 0x3f) << 2);
+	}
+	send_frame(sdi);
 
-	if (devc->limit_samples && devc->num_samples >= devc->limit_samples) {
+	if (last) {
 		sr_info("Requested number of samples reached.");
 		sr_dev_acquisition_stop(sdi);
 	}
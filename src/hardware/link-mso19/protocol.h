@@ -40,6 +40,9 @@
 #define SERIALCONN		"/dev/ttyUSB0"
 #define CLOCK_RATE		SR_MHZ(100)
 #define MIN_NUM_SAMPLES		4
+/* The hardware always dumps 1024 samples, 24bits each. */
+#define FRAME_SAMPLES		1024
+#define FRAME_BYTES		(FRAME_SAMPLES * 3)
 
 #define MSO_TRIGGER_UNKNOWN	'!'
 #define MSO_TRIGGER_UNKNOWN1	'1'
@@ -116,7 +119,9 @@ struct dev_context {
 	uint16_t dso_trigger_width;
 	struct mso_prototrig protocol_trigger;
 	uint16_t buffer_n;
-	char buffer[4096];
+	uint8_t buffer[FRAME_BYTES];
+	uint8_t logic_out[FRAME_SAMPLES];
+	uint16_t analog_out[FRAME_SAMPLES];
 };
 
 SR_PRIV int mso_parse_serial(const char *iSerial, const char *iProduct,
@@ -141,7 +141,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	devices = NULL;
-	usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+	usb_devices = sr_usb_find(drvc->sr_ctx, conn);
 	if (!usb_devices)
 		return NULL;
 
@@ -1135,23 +1135,6 @@ static void startup_send_tree_crc(struct startup_context *ctx)
 	set_tree_integer(ctx->sdi, target, ctx->crc);
 }
 
-static uint32_t crc32(const uint8_t *ptr, size_t size)
-{
-	uint32_t result = 0xFFFFFFFF;
-	uint32_t t;
-	for (; size; size--, ptr++) {
-		result ^= *ptr;
-		for (int i = 0; i < 8; i++) {
-			t = result & 1;
-			result >>= 1;
-			if (t)
-				result ^= 0xEDB88320;
-		}
-	}
-
-	return ~result;
-}
-
 static void startup_tree_updated(struct config_tree_node *node, void *param)
 {
 	struct startup_context *ctx = param;
@@ -1169,7 +1152,7 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 	size_t size;
 	struct config_tree_node *target;
 
-	ctx->crc = crc32(node->value.b->data, node->value.b->len);
+	ctx->crc = sr_crc32(0, node->value.b->data, node->value.b->len);
 
 	tree_data = g_byte_array_new();
 	g_byte_array_set_size(tree_data, 4096);
@@ -1265,6 +1248,14 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 	if (ret < 0)
 		return SR_ERR;
 
+	/*
+	 * Handle all pending notifications per poll, not just one. Each
+	 * notification carries a frame of its own, keep them separate.
+	 */
+	ret = sr_bt_config_batch(desc, 16, FALSE);
+	if (ret < 0)
+		return SR_ERR;
+
 	ret = sr_bt_connect_ble(desc);
 	if (ret < 0)
 		return SR_ERR;
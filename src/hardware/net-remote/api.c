@@ -0,0 +1,269 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replay the datafeed which another sigrok instance streams with the
+ * "net" output module, conn=tcp-raw/<host>/<port>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "protocol.h"
+
+static const uint32_t scanopts[] = {
+	SR_CONF_CONN,
+};
+
+static const uint32_t drvopts[] = {
+	SR_CONF_LOGIC_ANALYZER,
+	SR_CONF_OSCILLOSCOPE,
+};
+
+static const uint32_t devopts[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET,
+	SR_CONF_CONN | SR_CONF_GET,
+};
+
+static void clear_helper(struct dev_context *devc)
+{
+	g_free(devc->address);
+	g_free(devc->port);
+	g_free(devc->analog_channels);
+	g_free(devc->buf);
+	if (devc->batch)
+		g_byte_array_unref(devc->batch);
+	g_free(devc->values);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
+static GSList *scan(struct sr_dev_driver *di, GSList *options)
+{
+	struct dev_context *devc;
+	struct sr_dev_inst *sdi;
+	struct sr_config *src;
+	struct sr_channel *ch;
+	struct net_remote_hello hello;
+	GSList *l;
+	const char *conn;
+	gchar **params;
+	uint32_t i;
+
+	conn = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conn = g_variant_get_string(src->data, NULL);
+	}
+	if (!conn)
+		return NULL;
+
+	params = g_strsplit(conn, "/", 0);
+	if (!params || !params[0] || !params[1] || !params[2] ||
+			g_ascii_strncasecmp(params[0], "tcp", 3)) {
+		sr_err("Invalid connection '%s', use tcp-raw/<host>/<port>.", conn);
+		g_strfreev(params);
+		return NULL;
+	}
+
+	devc = g_malloc0(sizeof(*devc));
+	devc->address = g_strdup(params[1]);
+	devc->port = g_strdup(params[2]);
+	devc->socket = -1;
+	g_strfreev(params);
+
+	/* Only the channel layout is needed here. */
+	if (net_remote_open(devc) != SR_OK) {
+		clear_helper(devc);
+		g_free(devc);
+		return NULL;
+	}
+	if (net_remote_read_hello(devc, &hello) != SR_OK) {
+		net_remote_close(devc);
+		clear_helper(devc);
+		g_free(devc);
+		return NULL;
+	}
+	net_remote_close(devc);
+
+	devc->samplerate = hello.samplerate;
+	devc->num_logic = hello.num_logic;
+	devc->num_analog = hello.num_analog;
+	devc->analog_channels = g_malloc0_n(devc->num_analog + 1,
+		sizeof(devc->analog_channels[0]));
+	devc->batch = g_byte_array_new();
+	sr_sw_limits_init(&devc->limits);
+
+	sdi = g_malloc0(sizeof(*sdi));
+	sdi->status = SR_ST_INACTIVE;
+	sdi->vendor = g_strdup("sigrok");
+	sdi->model = g_strdup("Network datafeed");
+	sdi->connection_id = g_strdup(conn);
+	sdi->priv = devc;
+	for (i = 0; i < hello.num_logic + hello.num_analog; i++) {
+		if (i < hello.num_logic) {
+			sr_channel_new(sdi, i, SR_CHANNEL_LOGIC, TRUE,
+				hello.names[i]);
+		} else {
+			ch = sr_channel_new(sdi, i, SR_CHANNEL_ANALOG, TRUE,
+				hello.names[i]);
+			devc->analog_channels[i - hello.num_logic] = ch;
+		}
+	}
+	g_strfreev(hello.names);
+
+	return std_scan_complete(di, g_slist_append(NULL, sdi));
+}
+
+static int dev_open(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct net_remote_hello hello;
+	int ret;
+
+	devc = sdi->priv;
+	if ((ret = net_remote_open(devc)) != SR_OK)
+		return ret;
+	if ((ret = net_remote_read_hello(devc, &hello)) != SR_OK) {
+		net_remote_close(devc);
+		return ret;
+	}
+	g_strfreev(hello.names);
+
+	/* The sender may have been restarted with other channels. */
+	if (hello.num_logic != devc->num_logic ||
+			hello.num_analog != devc->num_analog) {
+		sr_err("The channels of %s:%s have changed, rescan.",
+			devc->address, devc->port);
+		net_remote_close(devc);
+		return SR_ERR;
+	}
+	devc->samplerate = hello.samplerate;
+
+	return SR_OK;
+}
+
+static int dev_close(struct sr_dev_inst *sdi)
+{
+	net_remote_close(sdi->priv);
+
+	return SR_OK;
+}
+
+static int config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+	devc = sdi->priv;
+
+	switch (key) {
+	case SR_CONF_CONN:
+		*data = g_variant_new_string(sdi->connection_id);
+		break;
+	case SR_CONF_SAMPLERATE:
+		if (!devc->samplerate)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+	case SR_CONF_LIMIT_MSEC:
+		return sr_sw_limits_config_get(&devc->limits, key, data);
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_set(uint32_t key, GVariant *data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	devc = sdi->priv;
+
+	return sr_sw_limits_config_set(&devc->limits, key, data);
+}
+
+static int config_list(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	return STD_CONFIG_LIST(key, data, sdi, cg, scanopts, drvopts, devopts);
+}
+
+static int dev_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_sw_limits_acquisition_start(&devc->limits);
+	std_session_send_df_header(sdi);
+
+	sr_session_source_add(sdi->session, devc->socket, G_IO_IN, 100,
+		net_remote_receive_data, (void *)sdi);
+
+	return SR_OK;
+}
+
+static int dev_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_session_source_remove(sdi->session, devc->socket);
+	std_session_send_df_end(sdi);
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver net_remote_driver_info = {
+	.name = "net-remote",
+	.longname = "Remote sigrok datafeed",
+	.api_version = 1,
+	.init = std_init,
+	.cleanup = std_cleanup,
+	.scan = scan,
+	.dev_list = std_dev_list,
+	.dev_clear = dev_clear,
+	.config_get = config_get,
+	.config_set = config_set,
+	.config_list = config_list,
+	.dev_open = dev_open,
+	.dev_close = dev_close,
+	.dev_acquisition_start = dev_acquisition_start,
+	.dev_acquisition_stop = dev_acquisition_stop,
+	.context = NULL,
+};
+SR_REGISTER_DEV_DRIVER(net_remote_driver_info);
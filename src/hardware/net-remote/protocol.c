@@ -0,0 +1,425 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#include <errno.h>
+#include "protocol.h"
+
+SR_PRIV int net_remote_open(struct dev_context *devc)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *res;
+	int err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	err = getaddrinfo(devc->address, devc->port, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", devc->address,
+			devc->port, gai_strerror(err));
+		return SR_ERR;
+	}
+
+	devc->socket = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((devc->socket = socket(res->ai_family, res->ai_socktype,
+						res->ai_protocol)) < 0)
+			continue;
+		if (connect(devc->socket, res->ai_addr, res->ai_addrlen) != 0) {
+			close(devc->socket);
+			devc->socket = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+
+	if (devc->socket < 0) {
+		sr_err("Failed to connect to %s:%s: %s", devc->address,
+			devc->port, g_strerror(errno));
+		return SR_ERR;
+	}
+	devc->buf_start = 0;
+	devc->buf_len = 0;
+
+	return SR_OK;
+}
+
+SR_PRIV void net_remote_close(struct dev_context *devc)
+{
+	if (devc->socket < 0)
+		return;
+
+	close(devc->socket);
+	devc->socket = -1;
+	devc->buf_start = 0;
+	devc->buf_len = 0;
+}
+
+/* Move the unhandled data to the start of the buffer. */
+static void compact(struct dev_context *devc)
+{
+	if (!devc->buf_start)
+		return;
+
+	devc->buf_len -= devc->buf_start;
+	memmove(devc->buf, devc->buf + devc->buf_start, devc->buf_len);
+	devc->buf_start = 0;
+}
+
+/* Make room for a frame of the given total size at the read offset. */
+static void reserve(struct dev_context *devc, size_t size)
+{
+	if (devc->buf_size - devc->buf_start >= size)
+		return;
+
+	compact(devc);
+	if (devc->buf_size >= size)
+		return;
+	devc->buf_size = MAX(size, RECV_BUFFER_SIZE);
+	devc->buf = g_realloc(devc->buf, devc->buf_size);
+}
+
+static int recv_some(struct dev_context *devc, int timeout_ms)
+{
+	struct timeval tv;
+	fd_set fds;
+	ssize_t len;
+
+	if (timeout_ms >= 0) {
+		FD_ZERO(&fds);
+		FD_SET(devc->socket, &fds);
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		if (select(devc->socket + 1, &fds, NULL, NULL, &tv) <= 0)
+			return SR_ERR_TIMEOUT;
+	}
+
+	/* Only compact when there is no room left behind the data. */
+	if (!devc->buf)
+		reserve(devc, RECV_BUFFER_SIZE);
+	else if (devc->buf_len == devc->buf_size)
+		compact(devc);
+	if (devc->buf_len == devc->buf_size)
+		reserve(devc, devc->buf_size + RECV_BUFFER_SIZE);
+	len = recv(devc->socket, (char *)devc->buf + devc->buf_len,
+		devc->buf_size - devc->buf_len, 0);
+	if (len < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return SR_OK;
+		sr_err("Receive error: %s", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	if (len == 0) {
+		sr_info("The sender closed the connection.");
+		return SR_ERR_IO;
+	}
+	devc->buf_len += len;
+
+	return SR_OK;
+}
+
+/* Update the buffer size when a frame's header says it needs more room. */
+static int next_frame(struct dev_context *devc, uint32_t *type, uint32_t *length)
+{
+	int ret;
+
+	ret = sr_net_frame_parse(devc->buf + devc->buf_start,
+		devc->buf_len - devc->buf_start, type, length);
+	if (ret == SR_ERR_NA &&
+			devc->buf_len - devc->buf_start >= SR_NET_FRAME_HEADER)
+		reserve(devc, SR_NET_FRAME_HEADER + *length);
+	if (ret == SR_ERR_DATA)
+		sr_err("Invalid frame of %" PRIu32 " bytes.", *length);
+
+	return ret;
+}
+
+static void consume(struct dev_context *devc, size_t len)
+{
+	devc->buf_start += len;
+	if (devc->buf_start == devc->buf_len)
+		devc->buf_start = devc->buf_len = 0;
+}
+
+SR_PRIV int net_remote_read_hello(struct dev_context *devc,
+		struct net_remote_hello *hello)
+{
+	const uint8_t *p, *end;
+	uint32_t type, length, num_names, name_len, i;
+	gint64 deadline;
+	int ret;
+
+	deadline = g_get_monotonic_time() + HELLO_TIMEOUT_MS * 1000;
+	while ((ret = next_frame(devc, &type, &length)) == SR_ERR_NA) {
+		if (g_get_monotonic_time() > deadline)
+			ret = SR_ERR_TIMEOUT;
+		else
+			ret = recv_some(devc, HELLO_TIMEOUT_MS);
+		if (ret != SR_OK) {
+			sr_err("No channel description from %s:%s.",
+				devc->address, devc->port);
+			return ret;
+		}
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	p = devc->buf + devc->buf_start + SR_NET_FRAME_HEADER;
+	if (type != SR_NET_HELLO || length < SR_NET_HELLO_FIXED ||
+			memcmp(p, SR_NET_MAGIC, 8)) {
+		sr_err("%s:%s does not send a sigrok datafeed.",
+			devc->address, devc->port);
+		return SR_ERR_DATA;
+	}
+	if (RL32(&p[8]) != SR_NET_VERSION) {
+		sr_err("Unsupported datafeed version %" PRIu32 ".", RL32(&p[8]));
+		return SR_ERR_DATA;
+	}
+	hello->num_logic = RL32(&p[12]);
+	hello->num_analog = RL32(&p[16]);
+	hello->samplerate = RL64(&p[24]);
+	num_names = hello->num_logic + hello->num_analog;
+	if (num_names < hello->num_logic || num_names > 4096)
+		return SR_ERR_DATA;
+
+	hello->names = g_malloc0_n(num_names + 1, sizeof(char *));
+	end = p + length;
+	p += SR_NET_HELLO_FIXED;
+	for (i = 0; i < num_names; i++) {
+		name_len = strnlen((const char *)p, end - p);
+		if (p + name_len == end) {
+			g_strfreev(hello->names);
+			hello->names = NULL;
+			return SR_ERR_DATA;
+		}
+		hello->names[i] = g_strndup((const char *)p, name_len);
+		p += name_len + 1;
+	}
+	/* Later versions may append to the hello frame. */
+	consume(devc, SR_NET_FRAME_HEADER + length);
+
+	return SR_OK;
+}
+
+/*
+ * Logic packets point into the receive buffer, datafeed callbacks which
+ * keep packets get a copy from sr_packet_ref().
+ */
+static int send_logic(const struct sr_dev_inst *sdi,
+		const uint8_t *payload, uint32_t length)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	devc = sdi->priv;
+	if (length < SR_NET_LOGIC_HEADER || !RL32(payload))
+		return SR_ERR_DATA;
+
+	logic.unitsize = RL32(payload);
+	logic.length = length - SR_NET_LOGIC_HEADER;
+	logic.length -= logic.length % logic.unitsize;
+	logic.data = (void *)(payload + SR_NET_LOGIC_HEADER);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	sr_session_send(sdi, &packet);
+	sr_sw_limits_update_samples_read(&devc->limits,
+		logic.length / logic.unitsize);
+
+	return SR_OK;
+}
+
+static int send_analog(const struct sr_dev_inst *sdi,
+		const uint8_t *payload, uint32_t length)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel *ch;
+	uint32_t channel, num_samples, i;
+	const uint8_t *data;
+
+	devc = sdi->priv;
+	if (length < SR_NET_ANALOG_HEADER)
+		return SR_ERR_DATA;
+	channel = RL32(&payload[0]);
+	num_samples = RL32(&payload[4]);
+	if (channel >= devc->num_analog || num_samples >
+			(length - SR_NET_ANALOG_HEADER) / sizeof(float))
+		return SR_ERR_DATA;
+	ch = devc->analog_channels[channel];
+	if (!ch->enabled || !num_samples)
+		return SR_OK;
+
+	if (devc->values_size < num_samples) {
+		g_free(devc->values);
+		devc->values = g_malloc(num_samples * sizeof(float));
+		devc->values_size = num_samples;
+	}
+	data = payload + SR_NET_ANALOG_HEADER;
+	for (i = 0; i < num_samples; i++)
+		devc->values[i] = RLFL(&data[i * sizeof(float)]);
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec,
+		(int32_t)RL32(&payload[24]));
+	analog.meaning->channels = g_slist_append(NULL, ch);
+	analog.meaning->mq = (int32_t)RL32(&payload[8]);
+	analog.meaning->unit = (int32_t)RL32(&payload[12]);
+	analog.meaning->mqflags = RL64(&payload[16]);
+	analog.num_samples = num_samples;
+	analog.data = devc->values;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+	sr_sw_limits_update_samples_read(&devc->limits, num_samples);
+
+	return SR_OK;
+}
+
+static int handle_frames(const struct sr_dev_inst *sdi,
+		const uint8_t *buf, size_t len, gboolean in_batch);
+
+static int handle_frame(const struct sr_dev_inst *sdi, uint32_t type,
+		const uint8_t *payload, uint32_t length, gboolean in_batch)
+{
+	struct dev_context *devc;
+	uint64_t samplerate;
+	int ret;
+
+	devc = sdi->priv;
+
+	switch (type) {
+	case SR_NET_SAMPLERATE:
+		if (length < sizeof(uint64_t))
+			return SR_ERR_DATA;
+		samplerate = RL64(payload);
+		if (samplerate == devc->samplerate)
+			break;
+		devc->samplerate = samplerate;
+		return sr_session_send_meta(sdi, SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(samplerate));
+	case SR_NET_LOGIC:
+		return send_logic(sdi, payload, length);
+	case SR_NET_ANALOG:
+		return send_analog(sdi, payload, length);
+	case SR_NET_TRIGGER:
+		return std_session_send_df_trigger(sdi);
+	case SR_NET_FRAME_BEGIN:
+		return std_session_send_df_frame_begin(sdi);
+	case SR_NET_FRAME_END:
+		return std_session_send_df_frame_end(sdi);
+	case SR_NET_END:
+		/* The sender's acquisition ended, so does ours. */
+		return SR_ERR_NA;
+	case SR_NET_BATCH:
+		if (in_batch)
+			return SR_ERR_DATA;
+		if ((ret = sr_net_batch_unpack(payload, length, devc->batch)) != SR_OK)
+			return ret;
+		return handle_frames(sdi, devc->batch->data, devc->batch->len, TRUE);
+	default:
+		/* HEADER, and frame types of later versions. */
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int handle_frames(const struct sr_dev_inst *sdi,
+		const uint8_t *buf, size_t len, gboolean in_batch)
+{
+	struct dev_context *devc;
+	uint32_t type, length;
+	int ret;
+
+	devc = sdi->priv;
+	while (len) {
+		if (sr_net_frame_parse(buf, len, &type, &length) != SR_OK)
+			return SR_ERR_DATA;
+		ret = handle_frame(sdi, type, buf + SR_NET_FRAME_HEADER,
+			length, in_batch);
+		if (ret != SR_OK)
+			return ret;
+		if (sr_sw_limits_check(&devc->limits))
+			return SR_ERR_NA;
+		buf += SR_NET_FRAME_HEADER + length;
+		len -= SR_NET_FRAME_HEADER + length;
+	}
+
+	return SR_OK;
+}
+
+SR_PRIV int net_remote_receive_data(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint32_t type, length;
+	int ret;
+
+	(void)fd;
+
+	if (!(sdi = cb_data) || !(devc = sdi->priv))
+		return TRUE;
+	if (!(revents & G_IO_IN))
+		return TRUE;
+
+	ret = recv_some(devc, -1);
+	while (ret == SR_OK) {
+		ret = next_frame(devc, &type, &length);
+		if (ret == SR_ERR_NA)
+			return TRUE;
+		if (ret != SR_OK)
+			break;
+		ret = handle_frame(sdi, type,
+			devc->buf + devc->buf_start + SR_NET_FRAME_HEADER,
+			length, FALSE);
+		consume(devc, SR_NET_FRAME_HEADER + length);
+		if (ret == SR_OK && sr_sw_limits_check(&devc->limits))
+			ret = SR_ERR_NA;
+	}
+	if (ret == SR_ERR_DATA)
+		sr_err("Invalid data from %s:%s.", devc->address, devc->port);
+
+	sr_dev_acquisition_stop((struct sr_dev_inst *)sdi);
+
+	return TRUE;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_HARDWARE_NET_REMOTE_PROTOCOL_H
+#define LIBSIGROK_HARDWARE_NET_REMOTE_PROTOCOL_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "net-remote"
+
+/* How long to wait for the sender's channel description. */
+#define HELLO_TIMEOUT_MS 3000
+#define RECV_BUFFER_SIZE (256 * 1024)
+
+/** What the sender describes in its hello frame. */
+struct net_remote_hello {
+	uint64_t samplerate;
+	uint32_t num_logic;
+	uint32_t num_analog;
+	/* Logic channel names first, then analog ones. */
+	char **names;
+};
+
+struct dev_context {
+	char *address;
+	char *port;
+	int socket;
+	struct sr_sw_limits limits;
+	uint64_t samplerate;
+	uint32_t num_logic;
+	/* The analog channels, in the sender's order. */
+	struct sr_channel **analog_channels;
+	uint32_t num_analog;
+
+	/* Received data, the unhandled part starts at buf_start. */
+	uint8_t *buf;
+	size_t buf_size;
+	size_t buf_start;
+	size_t buf_len;
+	GByteArray *batch;
+	float *values;
+	size_t values_size;
+};
+
+SR_PRIV int net_remote_open(struct dev_context *devc);
+SR_PRIV void net_remote_close(struct dev_context *devc);
+SR_PRIV int net_remote_read_hello(struct dev_context *devc,
+	struct net_remote_hello *hello);
+SR_PRIV int net_remote_receive_data(int fd, int revents, void *cb_data);
+
+#endif
@@ -339,18 +339,126 @@ SR_PRIV int ols_set_samplerate(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+static void free_sample_buffers(struct dev_context *devc)
+{
+	g_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = NULL;
+	if (devc->rle_values)
+		g_array_free(devc->rle_values, TRUE);
+	devc->rle_values = NULL;
+	if (devc->rle_lengths)
+		g_array_free(devc->rle_lengths, TRUE);
+	devc->rle_lengths = NULL;
+}
+
 SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct sr_serial_dev_inst *serial;
 
 	serial = sdi->conn;
 	ols_send_reset(serial);
+	free_sample_buffers(sdi->priv);
 
 	serial_source_remove(sdi->session, serial);
 
 	std_session_send_df_end(sdi);
 }
 
+/* Keep a run of the current sample, merging it with an identical one. */
+static void add_rle_run(struct dev_context *devc, uint64_t length)
+{
+	uint64_t *last;
+	guint num_runs;
+
+	num_runs = devc->rle_values->len;
+	if (num_runs && memcmp(&g_array_index(devc->rle_values, uint32_t,
+			num_runs - 1), devc->sample, 4) == 0) {
+		last = &g_array_index(devc->rle_lengths, uint64_t, num_runs - 1);
+		*last += length;
+		return;
+	}
+
+	g_array_append_vals(devc->rle_values, devc->sample, 1);
+	g_array_append_val(devc->rle_lengths, length);
+}
+
+static void send_rle_runs(const struct sr_dev_inst *sdi, guint first,
+		guint count)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+
+	devc = sdi->priv;
+	if (!count)
+		return;
+
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	rle.num_runs = count;
+	rle.unitsize = 4;
+	rle.values = &g_array_index(devc->rle_values, uint32_t, first);
+	rle.run_lengths = &g_array_index(devc->rle_lengths, uint64_t, first);
+	sr_session_send(sdi, &packet);
+}
+
+/*
+ * Send an RLE capture as is. Consumers which can't handle run length
+ * encoded data get it expanded by the session, a piece at a time.
+ */
+static void send_rle_capture(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	uint32_t *values, value;
+	uint64_t *lengths, length, pos, trigger;
+	guint num_runs, idx, first;
+
+	devc = sdi->priv;
+	values = (uint32_t *)devc->rle_values->data;
+	lengths = (uint64_t *)devc->rle_lengths->data;
+	num_runs = devc->rle_values->len;
+
+	/* The OLS sends its sample buffer backwards, reverse it in place. */
+	for (idx = 0; idx < num_runs / 2; idx++) {
+		value = values[idx];
+		values[idx] = values[num_runs - 1 - idx];
+		values[num_runs - 1 - idx] = value;
+		length = lengths[idx];
+		lengths[idx] = lengths[num_runs - 1 - idx];
+		lengths[num_runs - 1 - idx] = length;
+	}
+
+	first = 0;
+	if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
+		if (devc->trigger_at_smpl > 0) {
+			/* Split the run which holds the trigger position. */
+			trigger = devc->trigger_at_smpl;
+			pos = 0;
+			for (idx = 0; idx < num_runs; idx++) {
+				if (pos + lengths[idx] >= trigger)
+					break;
+				pos += lengths[idx];
+			}
+			if (idx == num_runs) {
+				first = num_runs;
+				send_rle_runs(sdi, 0, num_runs);
+			} else {
+				length = lengths[idx];
+				lengths[idx] = trigger - pos;
+				send_rle_runs(sdi, 0, idx + 1);
+				first = idx + 1;
+				if (pos + length > trigger) {
+					lengths[idx] = pos + length - trigger;
+					first = idx;
+				}
+			}
+		}
+		std_session_send_df_trigger(sdi);
+	}
+
+	send_rle_runs(sdi, first, num_runs - first);
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -375,13 +483,21 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (devc->num_transfers++ == 0) {
-		devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
-		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
-			return FALSE;
+		if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+			/* Collect the runs as they are, without expanding them. */
+			devc->rle_values = g_array_new(FALSE, FALSE,
+				sizeof(uint32_t));
+			devc->rle_lengths = g_array_new(FALSE, FALSE,
+				sizeof(uint64_t));
+		} else {
+			devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
+			if (!devc->raw_sample_buf) {
+				sr_err("Sample buffer malloc failed.");
+				return FALSE;
+			}
+			/* fill with 1010... for debugging */
+			memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
 		}
-		/* fill with 1010... for debugging */
-		memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
 	}
 
 	num_changroups = 0;
@@ -471,15 +587,19 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 					devc->sample[1], devc->sample[0]);
 			}
 
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * 4;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * 4),
-				       devc->sample, 4);
+			if (devc->rle_values) {
+				add_rle_run(devc, devc->rle_count + 1);
+			} else {
+				/*
+				 * the OLS sends its sample buffer backwards.
+				 * store it in reverse order here, so we can dump
+				 * this on the session bus later.
+				 */
+				offset = (devc->limit_samples - devc->num_samples) * 4;
+				for (i = 0; i <= devc->rle_count; i++) {
+					memcpy(devc->raw_sample_buf + offset + (i * 4),
+					       devc->sample, 4);
+				}
 			}
 			memset(devc->sample, 0, 4);
 			devc->num_bytes = 0;
@@ -494,6 +614,12 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 		sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
 		       devc->cnt_bytes, devc->cnt_samples,
 		       devc->cnt_samples_rle);
+		if (devc->rle_values) {
+			send_rle_capture(sdi);
+			serial_flush(serial);
+			abort_acquisition(sdi);
+			return TRUE;
+		}
 		if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
 			/*
 			 * A trigger was set up, so we need to tell the frontend
@@ -532,8 +658,6 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 				     4;
 		sr_session_send(sdi, &packet);
 
-		g_free(devc->raw_sample_buf);
-
 		serial_flush(serial);
 		abort_acquisition(sdi);
 	}
@@ -126,6 +126,9 @@ struct dev_context {
 	unsigned int rle_count;
 	unsigned char sample[4];
 	unsigned char *raw_sample_buf;
+	/* RLE captures: runs of 32-bit samples, in the order of arrival. */
+	GArray *rle_values;
+	GArray *rle_lengths;
 };
 
 SR_PRIV extern const char *ols_channel_names[];
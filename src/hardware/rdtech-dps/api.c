@@ -223,6 +223,16 @@ static GSList *scan_rd(struct sr_dev_driver *di, GSList *options)
 	return scan(di, options, MODEL_RD);
 }
 
+static void clear_helper(struct dev_context *devc)
+{
+	sr_modbus_regmap_free(devc->regmap);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct sr_modbus_dev_inst *modbus;
@@ -496,7 +506,7 @@ static struct sr_dev_driver rdtech_dps_driver_info = {
 	.cleanup = std_cleanup,
 	.scan = scan_dps,
 	.dev_list = std_dev_list,
-	.dev_clear = std_dev_clear,
+	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
@@ -516,7 +526,7 @@ static struct sr_dev_driver rdtech_rd_driver_info = {
 	.cleanup = std_cleanup,
 	.scan = scan_rd,
 	.dev_list = std_dev_list,
-	.dev_clear = std_dev_clear,
+	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
@@ -100,6 +100,40 @@ enum rdtech_rd_register {
 	REG_RD_START_MEM = 84, /* 0x54 */
 };
 
+/*
+ * Register ranges which get read when the device's state is polled.
+ * Measurements and states get read in every poll. Setpoints and
+ * protection thresholds rarely change while a device gets polled,
+ * and get written by this driver. Keep those values for a while.
+ */
+struct rdtech_dps_poll_regs {
+	int meas_address, meas_count;
+	int cfg_address, cfg_count;
+};
+
+static const struct rdtech_dps_poll_regs poll_regs_dps = {
+	REG_DPS_USET, 10, PRE_DPS_OVPSET, 2,
+};
+
+static const struct rdtech_dps_poll_regs poll_regs_rd = {
+	REG_RD_VOLT_TGT, 11, REG_RD_OVP_THR, 2,
+};
+
+#define CONFIG_REGS_MAX_AGE_US	(1000 * 1000)
+
+static const struct rdtech_dps_poll_regs *rdtech_dps_poll_regs(
+	const struct dev_context *devc)
+{
+	switch (devc->model->model_type) {
+	case MODEL_DPS:
+		return &poll_regs_dps;
+	case MODEL_RD:
+		return &poll_regs_rd;
+	default:
+		return NULL;
+	}
+}
+
 /* Retries failed modbus read attempts for improved reliability. */
 static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	int address, int nb_registers, uint16_t *registers)
@@ -118,6 +152,71 @@ static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return ret;
 }
 
+/*
+ * Read the poll's registers, in as few requests as possible, and copy
+ * their values to the caller's buffers. Recently read configuration
+ * values get used unless the caller wants the current configuration.
+ * Failed attempts are retried, chunks which were read are kept.
+ */
+static int rdtech_dps_read_poll_regs(const struct sr_dev_inst *sdi,
+	gboolean refresh_config, uint16_t *meas_regs, uint16_t *cfg_regs)
+{
+	struct dev_context *devc;
+	struct sr_modbus_dev_inst *modbus;
+	const struct rdtech_dps_poll_regs *poll;
+	const uint16_t *values;
+	size_t retries;
+	int ret;
+
+	devc = sdi->priv;
+	modbus = sdi->conn;
+	poll = rdtech_dps_poll_regs(devc);
+	if (!poll)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&devc->rw_mutex);
+	if (!devc->regmap) {
+		devc->regmap = sr_modbus_regmap_new(0,
+			poll->cfg_address + poll->cfg_count, 0);
+		sr_modbus_regmap_add(devc->regmap,
+			poll->meas_address, poll->meas_count, 0);
+		sr_modbus_regmap_add(devc->regmap,
+			poll->cfg_address, poll->cfg_count,
+			CONFIG_REGS_MAX_AGE_US);
+	}
+	if (refresh_config) {
+		sr_modbus_regmap_invalidate(devc->regmap,
+			poll->cfg_address, poll->cfg_count);
+	}
+	retries = 3;
+	while (retries--) {
+		ret = sr_modbus_regmap_read(modbus, devc->regmap);
+		if (ret == SR_OK)
+			break;
+	}
+	if (ret == SR_OK) {
+		values = sr_modbus_regmap_get(devc->regmap,
+			poll->meas_address, poll->meas_count);
+		if (values)
+			memcpy(meas_regs, values,
+				poll->meas_count * sizeof(values[0]));
+		else
+			ret = SR_ERR_DATA;
+	}
+	if (ret == SR_OK) {
+		values = sr_modbus_regmap_get(devc->regmap,
+			poll->cfg_address, poll->cfg_count);
+		if (values)
+			memcpy(cfg_regs, values,
+				poll->cfg_count * sizeof(values[0]));
+		else
+			ret = SR_ERR_DATA;
+	}
+	g_mutex_unlock(&devc->rw_mutex);
+
+	return ret;
+}
+
 /* Set one 16bit register. LE format for DPS devices. */
 static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	uint16_t address, uint16_t value)
@@ -137,6 +236,8 @@ static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	g_mutex_lock(&devc->rw_mutex);
 	ret = sr_modbus_write_multiple_registers(modbus, address,
 		ARRAY_SIZE(registers), registers);
+	if (devc->regmap)
+		sr_modbus_regmap_invalidate(devc->regmap, address, 1);
 	g_mutex_unlock(&devc->rw_mutex);
 
 	return ret;
@@ -161,6 +262,8 @@ static int rdtech_rd_set_reg(const struct sr_dev_inst *sdi,
 	g_mutex_lock(&devc->rw_mutex);
 	ret = sr_modbus_write_multiple_registers(modbus, address,
 		ARRAY_SIZE(registers), registers);
+	if (devc->regmap)
+		sr_modbus_regmap_invalidate(devc->regmap, address, 1);
 	g_mutex_unlock(&devc->rw_mutex);
 
 	return ret;
@@ -257,9 +360,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct rdtech_dps_state *state, enum rdtech_dps_state_context reason)
 {
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
 	gboolean get_config, get_init_state, get_curr_meas;
-	uint16_t registers[12];
+	uint16_t registers[12], cfg_registers[2];
 	int ret;
 	const uint8_t *rdptr;
 	uint16_t uset_raw, iset_raw, uout_raw, iout_raw, power_raw;
@@ -273,7 +375,6 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	if (!sdi || !sdi->priv || !sdi->conn)
 		return SR_ERR_ARG;
 	devc = sdi->priv;
-	modbus = sdi->conn;
 	if (!state)
 		return SR_ERR_ARG;
 
@@ -299,33 +400,32 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 	}
 	/*
-	 * TODO Make use of this information to reduce the transfer
+	 * TODO Make more use of this information to reduce the transfer
 	 * volume, especially on low bitrate serial connections. Though
 	 * the device firmware's samplerate is probably more limiting
 	 * than communication bandwidth is.
 	 */
-	(void)get_config;
-	(void)get_init_state;
 	(void)get_curr_meas;
 
+	/*
+	 * Polls during acquisition can use recently read configuration
+	 * values. Other callers get the current configuration.
+	 */
+	ret = rdtech_dps_read_poll_regs(sdi, get_config || get_init_state,
+		registers, cfg_registers);
+	if (ret != SR_OK)
+		return ret;
+
 	switch (devc->model->model_type) {
 	case MODEL_DPS:
 		/*
-		 * Transfer a chunk of registers in a single call. It's
-		 * unfortunate that the model dependency and the sparse
-		 * register map force us to open code addresses, sizes,
-		 * and the sequence of the registers and how to interpret
-		 * their bit fields. But then this is not too unusual for
-		 * a hardware specific device driver ...
+		 * Interpret a chunk of registers. It's unfortunate that
+		 * the model dependency and the sparse register map force
+		 * us to open code addresses, sizes, and the sequence of
+		 * the registers and how to interpret their bit fields.
+		 * But then this is not too unusual for a hardware specific
+		 * device driver ...
 		 */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_DPS_USET, 10, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' values. */
 		rdptr = (const void *)registers;
 		uset_raw = read_u16be_inc(&rdptr);
 		volt_target = uset_raw / devc->voltage_multiplier;
@@ -348,16 +448,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Transfer another chunk of registers in a single call. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			PRE_DPS_OVPSET, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
 		/* Interpret the second registers chunk's values. */
-		rdptr = (const void *)registers;
+		rdptr = (const void *)cfg_registers;
 		ovpset_raw = read_u16be_inc(&rdptr); /* PRE OVPSET */
 		ovp_threshold = ovpset_raw * devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* PRE OCPSET */
@@ -366,15 +458,7 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 
 	case MODEL_RD:
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_VOLT_TGT, 11, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
+		/* Interpret a set of adjacent registers' raw content. */
 		rdptr = (const void *)registers;
 		uset_raw = read_u16be_inc(&rdptr); /* USET */
 		volt_target = uset_raw / devc->voltage_multiplier;
@@ -397,16 +481,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_OVP_THR, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
+		/* Interpret the thresholds' raw content. */
+		rdptr = (const void *)cfg_registers;
 		ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
 		ovp_threshold = ovpset_raw / devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
@@ -55,6 +55,7 @@ struct dev_context {
 	double voltage_multiplier;
 	struct sr_sw_limits limits;
 	GMutex rw_mutex;
+	struct sr_modbus_regmap *regmap;
 	gboolean curr_ovp_state;
 	gboolean curr_ocp_state;
 	gboolean curr_cc_state;
@@ -26,7 +26,6 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
-#include <ctype.h>
 #include <time.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
@@ -446,6 +445,15 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 					devc->model->series->protocol <= PROTOCOL_V4)
 				if (rigol_ds_config_set(sdi, "FUNC:WREP:FCUR %d", devc->num_frames + 1) != SR_OK)
 					return SR_ERR;
+			/*
+			 * Recorded frames already are in sample memory, and
+			 * the scope stays stopped while they get replayed.
+			 * Only the first frame needs to wait for the stop,
+			 * later frames get downloaded back to back without
+			 * polling the trigger status in between.
+			 */
+			if (devc->data_source == DATA_SOURCE_SEGMENTED && !first_frame)
+				return rigol_ds_channel_start(sdi);
 		}
 		break;
 	}
@@ -453,7 +461,45 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-/* Start reading data from the current channel */
+/* Ask for the current channel's next block of samples. */
+static int rigol_ds_request_block(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	gboolean first_frame;
+
+	devc = sdi->priv;
+	first_frame = (devc->num_frames == 0);
+
+	if (devc->model->series->protocol >= PROTOCOL_V4) {
+		if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
+				devc->num_channel_bytes + 1) != SR_OK)
+			return SR_ERR;
+		if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
+				MIN(devc->num_channel_bytes + ACQ_BLOCK_SIZE,
+					devc->analog_frame_size)) != SR_OK)
+			return SR_ERR;
+	}
+
+	if (devc->model->series->protocol >= PROTOCOL_V3) {
+		if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
+			return SR_ERR;
+		if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
+			return SR_ERR;
+	}
+	devc->block_requested = TRUE;
+
+	return SR_OK;
+}
+
+/* Make room for a block of data, plus its terminating linefeed. */
+static void rigol_ds_buffer_reserve(struct dev_context *devc, size_t size)
+{
+	if (size + 1 <= devc->buffer_size)
+		return;
+	devc->buffer_size = size + 1;
+	devc->buffer = g_realloc(devc->buffer, devc->buffer_size);
+}
+
 SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -542,67 +588,17 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 	rigol_ds_set_wait_event(devc, WAIT_BLOCK);
 
 	devc->num_channel_bytes = 0;
-	devc->num_header_bytes = 0;
 	devc->num_block_bytes = 0;
+	devc->block_requested = FALSE;
 
-	return SR_OK;
-}
-
-/* Read the header of a data block */
-static int rigol_ds_read_header(struct sr_dev_inst *sdi)
-{
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
-	struct dev_context *devc = sdi->priv;
-	char *buf = (char *) devc->buffer;
-	size_t header_length;
-	int ret;
-
-	/* Try to read the hashsign and length digit. */
-	if (devc->num_header_bytes < 2) {
-		ret = sr_scpi_read_data(scpi, buf + devc->num_header_bytes,
-				2 - devc->num_header_bytes);
-		if (ret < 0) {
-			sr_err("Read error while reading data header.");
-			return SR_ERR;
-		}
-		devc->num_header_bytes += ret;
-	}
-
-	if (devc->num_header_bytes < 2)
-		return 0;
-
-	if (buf[0] != '#' || !isdigit(buf[1]) || buf[1] == '0') {
-		sr_err("Received invalid data block header '%c%c'.", buf[0], buf[1]);
-		return SR_ERR;
-	}
-
-	header_length = 2 + buf[1] - '0';
-
-	/* Try to read the length. */
-	if (devc->num_header_bytes < header_length) {
-		ret = sr_scpi_read_data(scpi, buf + devc->num_header_bytes,
-				header_length - devc->num_header_bytes);
-		if (ret < 0) {
-			sr_err("Read error while reading data header.");
-			return SR_ERR;
-		}
-		devc->num_header_bytes += ret;
-	}
-
-	if (devc->num_header_bytes < header_length)
-		return 0;
-
-	/* Read the data length. */
-	buf[header_length] = '\0';
-
-	if (parse_int(buf + 2, &ret) != SR_OK) {
-		sr_err("Received invalid data block length '%s'.", buf + 2);
-		return -1;
-	}
-
-	sr_dbg("Received data block header: '%s' -> block length %d", buf, ret);
+	/*
+	 * There is nothing to wait for on newer models, ask for the data
+	 * right away. The receive callback then runs when it arrives.
+	 */
+	if (devc->model->series->protocol >= PROTOCOL_V4)
+		return rigol_ds_request_block(sdi);
 
-	return ret;
+	return SR_OK;
 }
 
 SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
@@ -617,9 +613,11 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	int len, vref;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
+	size_t block_len;
+	char lf;
 
 	(void)fd;
 
@@ -634,8 +632,6 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
-	const gboolean first_frame = (devc->num_frames == 0);
-
 	switch (devc->wait_event) {
 	case WAIT_NONE:
 		break;
@@ -667,94 +663,101 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	expected_data_bytes = ch->type == SR_CHANNEL_ANALOG ?
 			devc->analog_frame_size : devc->digital_frame_size;
 
-	if (devc->num_block_bytes == 0) {
-		if (devc->model->series->protocol >= PROTOCOL_V4) {
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
-					devc->num_channel_bytes + 1) != SR_OK)
-				return TRUE;
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
-					MIN(devc->num_channel_bytes + ACQ_BLOCK_SIZE,
-						devc->analog_frame_size)) != SR_OK)
-				return TRUE;
+	if (devc->format == FORMAT_IEEE488_2) {
+		if (!devc->block_requested && rigol_ds_request_block(sdi) != SR_OK)
+			return TRUE;
+		devc->block_requested = FALSE;
+
+		/* Have the block go to the sample buffer straight away. */
+		rigol_ds_buffer_reserve(devc, expected_data_bytes);
+		if (sr_scpi_get_block_into(scpi, NULL, devc->buffer,
+				devc->buffer_size, &block_len) != SR_OK) {
+			sr_err("Error while reading data block, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
 		}
-
+		sr_dbg("Received data block of %zu bytes.", block_len);
 		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
-				return TRUE;
-			if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
-				return TRUE;
+			/* Discard the terminating linefeed */
+			sr_scpi_read_data(scpi, &lf, 1);
 		}
 
-		if (sr_scpi_read_begin(scpi) != SR_OK)
+		/* At slow timebases in live capture the DS2072 and
+		 * DS1054Z sometimes return "short" data blocks, with
+		 * apparently no way to get the rest of the data.
+		 * Discard these, the complete data block will appear
+		 * eventually.
+		 */
+		if (devc->data_source == DATA_SOURCE_LIVE &&
+				block_len < expected_data_bytes) {
+			sr_dbg("Discarding short data block: got %zu/%zu bytes.",
+				block_len, (size_t)expected_data_bytes);
 			return TRUE;
-
-		if (devc->format == FORMAT_IEEE488_2) {
-			sr_dbg("New block header expected");
-			len = rigol_ds_read_header(sdi);
-			if (len == 0)
-				/* Still reading the header. */
-				return TRUE;
-			if (len == -1) {
-				sr_err("Error while reading block header, aborting capture.");
-				std_session_send_df_frame_end(sdi);
-				sr_dev_acquisition_stop(sdi);
+		}
+		len = block_len;
+		/* Prepare for possible next block */
+		if (devc->data_source != DATA_SOURCE_LIVE)
+			rigol_ds_set_wait_event(devc, WAIT_BLOCK);
+	} else {
+		if (devc->num_block_bytes == 0) {
+			if (!devc->block_requested &&
+					rigol_ds_request_block(sdi) != SR_OK)
 				return TRUE;
-			}
-			/* At slow timebases in live capture the DS2072 and
-			 * DS1054Z sometimes return "short" data blocks, with
-			 * apparently no way to get the rest of the data.
-			 * Discard these, the complete data block will appear
-			 * eventually.
-			 */
-			if (devc->data_source == DATA_SOURCE_LIVE
-					&& (unsigned)len < expected_data_bytes) {
-				sr_dbg("Discarding short data block: got %d/%d bytes\n", len, (int)expected_data_bytes);
-				sr_scpi_read_data(scpi, (char *)devc->buffer, len + 1);
-				devc->num_header_bytes = 0;
+			if (sr_scpi_read_begin(scpi) != SR_OK)
 				return TRUE;
-			}
-			devc->num_block_bytes = len;
-		} else {
 			devc->num_block_bytes = expected_data_bytes;
+			devc->block_requested = FALSE;
+			devc->num_block_read = 0;
+			/* Read the whole block at once. */
+			rigol_ds_buffer_reserve(devc, devc->num_block_bytes);
 		}
-		devc->num_block_read = 0;
-	}
 
-	len = devc->num_block_bytes - devc->num_block_read;
-	if (len > ACQ_BUFFER_SIZE)
-		len = ACQ_BUFFER_SIZE;
-	sr_dbg("Requesting read of %d bytes", len);
+		len = devc->num_block_bytes - devc->num_block_read;
+		sr_dbg("Requesting read of %d bytes", len);
 
-	len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
+		len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
 
-	if (len == -1) {
-		sr_err("Error while reading block data, aborting capture.");
-		std_session_send_df_frame_end(sdi);
-		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	}
+		if (len == -1) {
+			sr_err("Error while reading block data, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
 
-	sr_dbg("Received %d bytes.", len);
+		sr_dbg("Received %d bytes.", len);
 
-	devc->num_block_read += len;
+		devc->num_block_read += len;
+		if (devc->num_block_read == devc->num_block_bytes) {
+			sr_dbg("Block has been completed");
+			if (!sr_scpi_read_complete(scpi) && !devc->channel_entry->next) {
+				sr_err("Read should have been completed");
+			}
+			devc->num_block_read = 0;
+		} else {
+			sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read",
+				devc->num_block_read, devc->num_block_bytes);
+		}
+	}
 
 	if (ch->type == SR_CHANNEL_ANALOG) {
 		vref = devc->vert_reference[ch->index];
 		vdiv = devc->vert_inc[ch->index];
 		origin = devc->vert_origin[ch->index];
 		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
 		float vdivlog = log10f(vdiv);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+		/* Pass the ADC bytes on, consumers scale them when needed. */
+		if (devc->model->series->protocol >= PROTOCOL_V3)
+			sr_analog_encoding_set_raw(&encoding, 1, FALSE, FALSE,
+				vdiv, -(vref + origin) * vdiv);
+		else
+			sr_analog_encoding_set_raw(&encoding, 1, FALSE, FALSE,
+				-vdiv, 128 * vdiv - offset);
 		analog.meaning->channels = g_slist_append(NULL, ch);
 		analog.num_samples = len;
-		analog.data = devc->data;
+		analog.data = devc->buffer;
 		analog.meaning->mq = SR_MQ_VOLTAGE;
 		analog.meaning->unit = SR_UNIT_VOLT;
 		analog.meaning->mqflags = 0;
@@ -774,33 +777,17 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		sr_session_send(sdi, &packet);
 	}
 
-	if (devc->num_block_read == devc->num_block_bytes) {
-		sr_dbg("Block has been completed");
-		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			/* Discard the terminating linefeed */
-			sr_scpi_read_data(scpi, (char *)devc->buffer, 1);
-		}
-		if (devc->format == FORMAT_IEEE488_2) {
-			/* Prepare for possible next block */
-			devc->num_header_bytes = 0;
-			devc->num_block_bytes = 0;
-			if (devc->data_source != DATA_SOURCE_LIVE)
-				rigol_ds_set_wait_event(devc, WAIT_BLOCK);
-		}
-		if (!sr_scpi_read_complete(scpi) && !devc->channel_entry->next) {
-			sr_err("Read should have been completed");
-		}
-		devc->num_block_read = 0;
-	} else {
-		sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read",
-			devc->num_block_read, devc->num_block_bytes);
-	}
-
 	devc->num_channel_bytes += len;
 
-	if (devc->num_channel_bytes < expected_data_bytes)
-		/* Don't have the full data for this channel yet, re-run. */
+	if (devc->num_channel_bytes < expected_data_bytes) {
+		/*
+		 * Don't have the full data for this channel yet, re-run.
+		 * Newer models get asked for the next block right away.
+		 */
+		if (devc->model->series->protocol >= PROTOCOL_V4)
+			rigol_ds_request_block(sdi);
 		return TRUE;
+	}
 
 	/* End of data for this channel. */
 	if (devc->model->series->protocol == PROTOCOL_V3) {
@@ -28,11 +28,14 @@
 
 #define LOG_PREFIX "rigol-ds"
 
-/* Size of acquisition buffers */
+/* Initial size of acquisition buffers, they grow to the block size. */
 #define ACQ_BUFFER_SIZE (32 * 1024)
 
-/* Maximum number of samples to retrieve at once. */
-#define ACQ_BLOCK_SIZE (30 * 1000)
+/*
+ * Maximum number of samples to retrieve at once. This is the most the
+ * scopes return per :WAV:DATA? request for byte sized samples.
+ */
+#define ACQ_BLOCK_SIZE (250 * 1000)
 
 #define MAX_ANALOG_CHANNELS 4
 #define MAX_DIGITAL_CHANNELS 16
@@ -150,11 +153,9 @@ struct dev_context {
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
 	uint64_t num_channel_bytes;
-	/* Number of bytes of block header read */
-	uint64_t num_header_bytes;
-	/* Number of bytes in current data block, if 0 block header expected */
+	/* Number of bytes in current raw data block, 0 when none is pending */
 	uint64_t num_block_bytes;
-	/* Number of data block bytes already read */
+	/* Number of raw data block bytes already read */
 	uint64_t num_block_read;
 	/* What to wait for in *_receive */
 	enum wait_events wait_event;
@@ -162,7 +163,9 @@ struct dev_context {
 	int wait_status;
 	/* Acq buffers used for reading from the scope and sending data to app */
 	unsigned char *buffer;
-	float *data;
+	size_t buffer_size;
+	/* Whether the current block's :WAV:DATA? request went out. */
+	gboolean block_requested;
 };
 
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
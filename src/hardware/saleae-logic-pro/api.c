@@ -217,7 +217,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		if (conn_devices) {
 			struct sr_usb_dev_inst *usb = NULL;
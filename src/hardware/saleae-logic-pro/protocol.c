@@ -226,8 +226,14 @@ static int read_eeprom(const struct sr_dev_inst *sdi,
 		address, address >> 8,
 		len, len >> 8
 	};
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_EEPROM_READ, NULL, sdi);
+	ret = transact(sdi, req, sizeof(req), data, len);
+	sr_profile_end(&scope, ret);
 
-	return transact(sdi, req, sizeof(req), data, len);
+	return ret;
 }
 
 static int read_eeprom_serial(const struct sr_dev_inst *sdi,
@@ -572,12 +578,15 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 	devc->dig_channel_cnt = 0;
 	devc->dig_channel_mask = 0;
+	memset(devc->batch_planes, 0, sizeof(devc->batch_planes));
 	for (l = sdi->channels; l; l = l->next) {
 		c = l->data;
 		if (!c->enabled)
 			continue;
 
 		mask = 1 << c->index;
+		devc->batch_planes[c->index] =
+			devc->batch_data[devc->dig_channel_cnt];
 		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
 		devc->dig_channel_mask |= mask;
 
@@ -845,38 +854,43 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
  * One batch from the device consists of 32 samples per active digital channel.
  * This stream of batches is packed into USB packets with 16384 bytes each.
  */
+/* Reverse the bit order of a 32bit word. */
+static inline uint32_t reverse_bits32(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+	x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+	x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+	x = ((x >> 8) & 0x00ff00ff) | ((x & 0x00ff00ff) << 8);
+
+	return (x >> 16) | (x << 16);
+}
+
+/*
+ * Each word carries 32 samples of one channel, with the first sample in
+ * the most significant bit. Words for all enabled channels form a batch.
+ * Keep a batch's words as bit planes (first sample in the least
+ * significant bit), and have them transposed when the batch is complete.
+ * Batches can span USB transfers.
+ */
 static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
 					 const uint32_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
 	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
+	unsigned int batch_index;
 
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
 	/* Reset converted size. */
 	devc->conv_size = 0;
 
 	batch_index = devc->batch_index;
 	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
+		write_u32le(devc->batch_data[batch_index],
+			reverse_bits32(*src++));
 
 		/* Last index of the batch. */
 		if (++batch_index == devc->dig_channel_cnt) {
+			sr_bitplanes_to_samples(dst, sizeof(uint16_t),
+				devc->batch_planes, sizeof(uint32_t));
 			devc->conv_size += CONV_BATCH_SIZE;
 			batch_index = 0;
 			dst += CONV_BATCH_SIZE;
@@ -891,6 +905,8 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 	struct dev_context *devc = sdi->priv;
 	int ret;
 
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
+	sr_usb_capture_transfer(sdi, transfer);
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
 		sr_dbg("FIXME no device");
@@ -906,6 +922,6 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 	saleae_logic_pro_convert_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
 	saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
 
-	if ((ret = libusb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
+	if ((ret = sr_usb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
 		sr_dbg("FIXME resubmit failed");
 }
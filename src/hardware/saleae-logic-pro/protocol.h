@@ -31,10 +31,10 @@
 #define CONV_BATCH_SIZE (2 * 32)
 
 /*
- * One packet + one partial conversion: Worst case is only one active
- * channel converted to 2 bytes per sample, with 8 * 16384 samples per packet.
+ * One packet: Worst case is only one active channel converted to
+ * 2 bytes per sample, with 8 * 16384 samples per packet.
  */
-#define CONV_BUFFER_SIZE (2 * 8 * 16384 + CONV_BATCH_SIZE)
+#define CONV_BUFFER_SIZE (2 * 8 * 16384)
 
 struct dev_context {
 	unsigned int dig_channel_cnt;
@@ -51,6 +51,8 @@ struct dev_context {
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
 	unsigned int batch_index;
+	uint8_t batch_data[16][sizeof(uint32_t)];
+	const uint8_t *batch_planes[16];
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
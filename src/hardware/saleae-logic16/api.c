@@ -164,7 +164,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
@@ -338,7 +338,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	int ret;
-	int64_t timediff_us, timediff_ms;
 
 	devc = sdi->priv;
 
@@ -349,23 +348,12 @@ static int dev_open(struct sr_dev_inst *sdi)
 	ret = SR_ERR;
 	if (devc->fw_updated > 0) {
 		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((ret = logic16_dev_open(sdi)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
+		ret = usb_wait_renumeration(sdi, devc->fw_updated,
+			MAX_RENUM_DELAY_MS, logic16_dev_open);
 		if (ret != SR_OK) {
 			sr_err("Device failed to renumerate.");
 			return SR_ERR;
 		}
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
 	} else {
 		sr_info("Firmware upload was not needed.");
 		ret = logic16_dev_open(sdi);
@@ -570,6 +558,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 	devc->cur_channels = 0;
 	devc->num_channels = 0;
+	memset(devc->batch_planes, 0, sizeof(devc->batch_planes));
 	for (l = sdi->channels; l; l = l->next) {
 		ch = (struct sr_channel *)l->data;
 		if (ch->enabled == FALSE)
@@ -579,16 +568,9 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 		devc->cur_channels |= channel_bit;
 
-#ifdef WORDS_BIGENDIAN
-		/*
-		 * Output logic data should be stored in little endian format.
-		 * To speed things up during conversion, do the switcharoo
-		 * here instead.
-		 */
-		channel_bit = 1 << (ch->index ^ 8);
-#endif
-
-		devc->channel_masks[devc->num_channels++] = channel_bit;
+		/* The n-th word of a batch is the plane for this channel. */
+		devc->batch_planes[ch->index] =
+			devc->batch_data[devc->num_channels++];
 	}
 
 	return SR_OK;
@@ -647,7 +629,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->sent_samples = 0;
 	devc->empty_transfer_count = 0;
 	devc->cur_channel = 0;
-	memset(devc->channel_data, 0, sizeof(devc->channel_data));
 
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
@@ -246,8 +246,14 @@ static int read_eeprom(const struct sr_dev_inst *sdi,
 		address,
 		length,
 	};
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_EEPROM_READ, NULL, sdi);
+	ret = do_ep1_command(sdi, command, 5, buf, length);
+	sr_profile_end(&scope, ret);
 
-	return do_ep1_command(sdi, command, 5, buf, length);
+	return ret;
 }
 
 static int upload_led_table(const struct sr_dev_inst *sdi,
@@ -339,34 +345,77 @@ static uint8_t map_eeprom_data(uint8_t v)
 	return (((v ^ 0x80) + 0x44) ^ 0xd5) + 0x69;
 }
 
-static int setup_register_mapping(const struct sr_dev_inst *sdi)
+/*
+ * Cached device data applies to the same device (the EEPROM identity)
+ * running the same bitstream, see sr_dev_cache_get().
+ */
+static char *cache_version(const struct dev_context *devc, const char *name)
+{
+	GString *version;
+	size_t i;
+
+	version = g_string_new(name ? name : "");
+	g_string_append_c(version, '/');
+	for (i = 0; i < sizeof(devc->eeprom_data); i++)
+		g_string_append_printf(version, "%02x", devc->eeprom_data[i]);
+
+	return g_string_free(version, FALSE);
+}
+
+static int detect_fpga_variant(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	uint8_t reg0, reg7;
 	int ret;
 
 	devc = sdi->priv;
 
-	if (devc->fpga_variant != FPGA_VARIANT_MCUPRO) {
-		uint8_t reg0, reg7;
+	/*
+	 * Check for newer bitstream version by polling the
+	 * version register at the old and new location.
+	 */
 
-		/*
-		 * Check for newer bitstream version by polling the
-		 * version register at the old and new location.
-		 */
+	if ((ret = read_fpga_register(sdi, 0 /* No mapping */, &reg0)) != SR_OK)
+		return ret;
 
-		if ((ret = read_fpga_register(sdi, 0 /* No mapping */, &reg0)) != SR_OK)
-			return ret;
+	if ((ret = read_fpga_register(sdi, 7 /* No mapping */, &reg7)) != SR_OK)
+		return ret;
 
-		if ((ret = read_fpga_register(sdi, 7 /* No mapping */, &reg7)) != SR_OK)
-			return ret;
+	if (reg0 == 0 && reg7 > 0x10) {
+		sr_info("Original Saleae Logic16 using new bitstream.");
+		devc->fpga_variant = FPGA_VARIANT_ORIGINAL_NEW_BITSTREAM;
+	} else {
+		sr_info("Original Saleae Logic16 using old bitstream.");
+		devc->fpga_variant = FPGA_VARIANT_ORIGINAL;
+	}
 
-		if (reg0 == 0 && reg7 > 0x10) {
-			sr_info("Original Saleae Logic16 using new bitstream.");
-			devc->fpga_variant = FPGA_VARIANT_ORIGINAL_NEW_BITSTREAM;
-		} else {
-			sr_info("Original Saleae Logic16 using old bitstream.");
-			devc->fpga_variant = FPGA_VARIANT_ORIGINAL;
+	return SR_OK;
+}
+
+static int setup_register_mapping(const struct sr_dev_inst *sdi,
+				  const char *bitstream)
+{
+	struct dev_context *devc;
+	char *version;
+	uint8_t variant;
+	int ret;
+
+	devc = sdi->priv;
+
+	if (devc->fpga_variant != FPGA_VARIANT_MCUPRO) {
+		version = cache_version(devc, bitstream);
+		ret = sr_dev_cache_get(sdi, "fpga-variant", version,
+				&variant, sizeof(variant));
+		if (ret == SR_OK) {
+			devc->fpga_variant = variant;
+		} else if ((ret = detect_fpga_variant(sdi)) == SR_OK) {
+			variant = devc->fpga_variant;
+			sr_dev_cache_put(sdi, "fpga-variant", version,
+					&variant, sizeof(variant));
 		}
+		g_free(version);
+		if (ret != SR_OK)
+			return ret;
 	}
 
 	if (devc->fpga_variant == FPGA_VARIANT_ORIGINAL_NEW_BITSTREAM) {
@@ -397,9 +446,21 @@ static int prime_fpga(const struct sr_dev_inst *sdi)
 		{FPGA_REG(PRIMER_CONTROL), 1},
 		{FPGA_REG(PRIMER_CONTROL), 0}
 	};
+	char *cache_id;
 	int i, ret;
 
-	if ((ret = read_eeprom(sdi, 16, 16, eeprom_data)) != SR_OK)
+	/* The primer data only depends on the device. */
+	cache_id = cache_version(devc, NULL);
+	ret = sr_dev_cache_get(sdi, "primer", cache_id,
+			eeprom_data, sizeof(eeprom_data));
+	if (ret != SR_OK) {
+		ret = read_eeprom(sdi, 16, 16, eeprom_data);
+		if (ret == SR_OK)
+			sr_dev_cache_put(sdi, "primer", cache_id,
+					eeprom_data, sizeof(eeprom_data));
+	}
+	g_free(cache_id);
+	if (ret != SR_OK)
 		return ret;
 
 	if ((ret = read_fpga_register(sdi, FPGA_REG(MODE), &old_mode_reg)) != SR_OK)
@@ -457,7 +518,7 @@ static int configure_led(const struct sr_dev_inst *sdi)
 	return set_led_mode(sdi, 1, 6250, 0, 1);
 }
 
-static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
+static int fpga_bitstream_upload(const struct sr_dev_inst *sdi,
 				 enum voltage_range vrange)
 {
 	uint64_t sum;
@@ -471,6 +532,7 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	devc = sdi->priv;
 	drvc = sdi->driver->context;
+	name = NULL;
 
 	if (devc->cur_voltage_range == vrange)
 		return SR_OK;
@@ -526,7 +588,7 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 	}
 
 	/* This needs to be called before accessing any FPGA registers. */
-	if ((ret = setup_register_mapping(sdi)) != SR_OK)
+	if ((ret = setup_register_mapping(sdi, name)) != SR_OK)
 		return ret;
 
 	if ((ret = prime_fpga(sdi)) != SR_OK)
@@ -539,6 +601,19 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
+				 enum voltage_range vrange)
+{
+	struct sr_profile_scope scope;
+	int ret;
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_FPGA_CONFIG, NULL, sdi);
+	ret = fpga_bitstream_upload(sdi, vrange);
+	sr_profile_end(&scope, ret);
+
+	return ret;
+}
+
 static int abort_acquisition_sync(const struct sr_dev_inst *sdi)
 {
 	static const uint8_t command[2] = {
@@ -794,7 +869,7 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	if ((ret = sr_usb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	free_transfer(transfer);
@@ -803,37 +878,46 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
+/* Reverse the bit order of a 16bit word. */
+static inline uint16_t reverse_bits16(uint16_t x)
+{
+	x = ((x >> 1) & 0x5555) | ((x & 0x5555) << 1);
+	x = ((x >> 2) & 0x3333) | ((x & 0x3333) << 2);
+	x = ((x >> 4) & 0x0f0f) | ((x & 0x0f0f) << 4);
+
+	return (x >> 8) | (x << 8);
+}
+
+/*
+ * Each little endian word carries 16 samples of one channel, with the
+ * first sample in the most significant bit. Words for all enabled
+ * channels form a batch. Keep a batch's words as bit planes (first
+ * sample in the least significant bit), and have them transposed when
+ * the batch is complete. Batches can span USB transfers.
+ */
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
-	uint16_t *channel_data;
-	int i, cur_channel;
+	int cur_channel;
 	size_t ret = 0;
-	uint16_t sample, channel_mask;
 
 	srccnt /= 2;
 
-	channel_data = devc->channel_data;
 	cur_channel = devc->cur_channel;
 
 	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
+		write_u16le(devc->batch_data[cur_channel],
+			reverse_bits16(read_u16le(src)));
 		src += 2;
 
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
-
 		if (++cur_channel == devc->num_channels) {
 			cur_channel = 0;
 			if (destcnt < 16 * 2) {
 				sr_err("Conversion buffer too small!");
 				break;
 			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
+			sr_bitplanes_to_samples(dest, sizeof(uint16_t),
+				devc->batch_planes, sizeof(uint16_t));
 			dest += 16 * 2;
 			ret += 16;
 			destcnt -= 16 * 2;
@@ -870,6 +954,8 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 
 	sr_info("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
+	SR_PROBE3(usb__transfer, sdi, transfer->status, transfer->actual_length);
+	sr_usb_capture_transfer(sdi, transfer);
 
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
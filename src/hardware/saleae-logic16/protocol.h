@@ -79,8 +79,9 @@ struct dev_context {
 	int empty_transfer_count;
 	int num_channels;
 	int cur_channel;
-	uint16_t channel_masks[16];
-	uint16_t channel_data[16];
+	/* Words of the current batch, as bit planes for each channel. */
+	uint8_t batch_data[16][sizeof(uint16_t)];
+	const uint8_t *batch_planes[16];
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
 	struct soft_trigger_logic *stl;
@@ -48,6 +48,27 @@ static const uint32_t devopts_generic_range[] = {
 	SR_CONF_RANGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
+static const uint32_t devopts_generic_buffered[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_CONN | SR_CONF_GET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_MEASURED_QUANTITY | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
+};
+
+static const uint32_t devopts_generic_range_buffered[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_CONN | SR_CONF_GET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_MEASURED_QUANTITY | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_RANGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
+};
+
 static const struct scpi_command cmdset_agilent[] = {
 	{ DMM_CMD_SETUP_REMOTE, "\n", },
 	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
@@ -94,6 +115,48 @@ static const struct scpi_command cmdset_hp[] = {
 	ALL_ZERO,
 };
 
+/*
+ * The 34410A and 3446xA have a reading memory. With a non-zero buffer
+ * size the meter measures on its own, either back-to-back or timed,
+ * and the driver removes the readings in bulk. DATA:REM? is used in
+ * favour of FETCH?, since the latter waits for the complete trigger
+ * count and does not consume the memory.
+ */
+#define CMDS_BUFFERED \
+	{ DMM_CMD_SETUP_BUFFERED, "TRIG:SOUR IMM;:TRIG:COUN INF;:SAMP:SOUR IMM;:SAMP:COUN 1", }, \
+	{ DMM_CMD_SETUP_INTERVAL, "TRIG:SOUR IMM;:TRIG:COUN 1;:SAMP:SOUR TIM;:SAMP:TIM %s;:SAMP:COUN %s", }, \
+	{ DMM_CMD_SETUP_UNBUFFERED, "TRIG:COUN 1;:SAMP:SOUR IMM;:SAMP:COUN 1", }, \
+	{ DMM_CMD_QUERY_POINTS, "DATA:POIN?", }, \
+	{ DMM_CMD_QUERY_BUFFERED, "DATA:REM? %zu", }
+
+static const struct scpi_command cmdset_agilent_buffered[] = {
+	{ DMM_CMD_SETUP_REMOTE, "\n", },
+	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
+	{ DMM_CMD_SETUP_FUNC, "CONF:%s", },
+	{ DMM_CMD_QUERY_FUNC, "CONF?", },
+	{ DMM_CMD_START_ACQ, "INIT", },
+	{ DMM_CMD_STOP_ACQ, "ABORT", },
+	{ DMM_CMD_QUERY_VALUE, "FETCH?", },
+	{ DMM_CMD_QUERY_PREC, "CONF?", },
+	{ DMM_CMD_QUERY_RANGE_AUTO, "%s:RANGE:AUTO?", },
+	{ DMM_CMD_QUERY_RANGE, "%s:RANGE?", },
+	{ DMM_CMD_SETUP_RANGE, "CONF:%s %s", },
+	CMDS_BUFFERED,
+	ALL_ZERO,
+};
+
+static const struct scpi_command cmdset_hp_buffered[] = {
+	{ DMM_CMD_SETUP_REMOTE, "\n", },
+	{ DMM_CMD_SETUP_FUNC, "CONF:%s", },
+	{ DMM_CMD_QUERY_FUNC, "CONF?", },
+	{ DMM_CMD_START_ACQ, "INIT", },
+	{ DMM_CMD_STOP_ACQ, "ABORT", },
+	{ DMM_CMD_QUERY_VALUE, "READ?", },
+	{ DMM_CMD_QUERY_PREC, "CONF?", },
+	CMDS_BUFFERED,
+	ALL_ZERO,
+};
+
 static const struct scpi_command cmdset_gwinstek[] = {
 	{ DMM_CMD_SETUP_REMOTE, "SYST:REM", },
 	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
@@ -224,17 +287,17 @@ SR_PRIV const struct scpi_dmm_model models[] = {
 	},
 	{
 		"Agilent", "34410A",
-		1, 6, cmdset_hp, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_hp_buffered, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
-		ARRAY_AND_SIZE(devopts_generic),
+		ARRAY_AND_SIZE(devopts_generic_buffered),
 		0, 0, 0, 0, FALSE,
 		NULL, NULL, NULL,
 	},
 	{
 		"Agilent", "34460A",
-		1, 6, cmdset_agilent, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_agilent_buffered, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
-		ARRAY_AND_SIZE(devopts_generic_range),
+		ARRAY_AND_SIZE(devopts_generic_range_buffered),
 		0, 0, 10 * 1000, 0, FALSE,
 		scpi_dmm_get_range_text, scpi_dmm_set_range_from_text, NULL,
 	},
@@ -281,9 +344,9 @@ SR_PRIV const struct scpi_dmm_model models[] = {
 	},
 	{
 		"Keysight", "34465A",
-		1, 6, cmdset_agilent, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_agilent_buffered, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
-		ARRAY_AND_SIZE(devopts_generic_range),
+		ARRAY_AND_SIZE(devopts_generic_range_buffered),
 		0, 0, 10 * 1000, 0, FALSE,
 		scpi_dmm_get_range_text, scpi_dmm_set_range_from_text, NULL,
 	},
@@ -497,6 +560,16 @@ static int config_get(uint32_t key, GVariant **data,
 			return SR_ERR_NA;
 		*data = g_variant_new_string(range);
 		return SR_OK;
+	case SR_CONF_BUFFERSIZE:
+		if (!devc || !scpi_dmm_can_buffer(sdi))
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->buffer_size);
+		return SR_OK;
+	case SR_CONF_SAMPLE_INTERVAL:
+		if (!devc || !scpi_dmm_can_buffer(sdi))
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->sample_interval);
+		return SR_OK;
 	default:
 		return SR_ERR_NA;
 	}
@@ -510,6 +583,7 @@ static int config_set(uint32_t key, GVariant *data,
 	enum sr_mqflag mqflag;
 	GVariant *tuple_child;
 	const char *range;
+	uint64_t value;
 
 	(void)cg;
 
@@ -532,6 +606,19 @@ static int config_set(uint32_t key, GVariant *data,
 			return SR_ERR_NA;
 		range = g_variant_get_string(data, NULL);
 		return devc->model->set_range_from_text(sdi, range);
+	case SR_CONF_BUFFERSIZE:
+		if (!devc || !scpi_dmm_can_buffer(sdi))
+			return SR_ERR_NA;
+		value = g_variant_get_uint64(data);
+		if (value > SCPI_DMM_MAX_BUFFERED)
+			return SR_ERR_ARG;
+		devc->buffer_size = value;
+		return SR_OK;
+	case SR_CONF_SAMPLE_INTERVAL:
+		if (!devc || !scpi_dmm_can_buffer(sdi))
+			return SR_ERR_NA;
+		devc->sample_interval = g_variant_get_uint64(data);
+		return SR_OK;
 	default:
 		return SR_ERR_NA;
 	}
@@ -619,12 +706,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		}
 	}
 
+	if (devc->buffer_size && scpi_dmm_can_buffer(sdi)) {
+		ret = scpi_dmm_buffered_start(sdi);
+		if (ret != SR_OK)
+			return ret;
+	}
+
 	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_START_ACQ);
 	if (command && *command) {
 		scpi_dmm_cmd_delay(scpi);
 		ret = sr_scpi_send(scpi, command);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			scpi_dmm_buffered_stop(sdi);
 			return ret;
+		}
 	}
 
 	do_mq_meas_delay = item->drv_flags & FLAG_MEAS_DELAY;
@@ -635,6 +730,12 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	ret = std_session_send_df_header(sdi);
 	if (ret != SR_OK)
 		return ret;
+	if (devc->buffered && devc->sample_interval) {
+		ret = sr_session_send_meta(sdi, SR_CONF_SAMPLE_INTERVAL,
+			g_variant_new_uint64(devc->sample_interval));
+		if (ret != SR_OK)
+			return ret;
+	}
 
 	ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
 		scpi_dmm_receive_data, (void *)sdi);
@@ -658,6 +759,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		scpi_dmm_cmd_delay(scpi);
 		(void)sr_scpi_send(scpi, command);
 	}
+	scpi_dmm_buffered_stop(sdi);
 	sr_scpi_source_remove(sdi->session, scpi);
 
 	std_session_send_df_end(sdi);
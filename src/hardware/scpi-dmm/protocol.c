@@ -269,9 +269,13 @@ SR_PRIV GVariant *scpi_dmm_get_range_text_list(const struct sr_dev_inst *sdi)
 	return list;
 }
 
-SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
+/*
+ * Get the meter's current mode and resolution, and fill in the 'analog'
+ * description of a channel's values: encoding, meaning, spec. Callers
+ * fill in the data, sample count, and channel name.
+ */
+static int agilent_describe(const struct sr_dev_inst *sdi, size_t ch)
 {
-	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct scpi_dmm_acq_info *info;
 	struct sr_datafeed_analog *analog;
@@ -285,15 +289,9 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	char prec_text[20];
 	const struct mqopt_item *item;
 	int prec_exp;
-	const char *command;
-	char *response;
-	gboolean use_double;
-	int sig_digits, val_exp;
 	int digits;
 	enum sr_unit unit;
-	double limit;
 
-	scpi = sdi->conn;
 	devc = sdi->priv;
 	info = &devc->run_acq_info;
 	analog = &info->analog[ch];
@@ -367,6 +365,98 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	if (ret != SR_OK)
 		return ret;
 
+	/*
+	 * TODO Come up with the most appropriate 'digits' calculation.
+	 * This implementation assumes that either the device provides
+	 * the resolution with the query for the meter's function, or
+	 * the driver uses a fallback text pretending the device had
+	 * provided it. This works with supported Agilent devices.
+	 *
+	 * An alternative may be to assume a given digits count which
+	 * depends on the device, and adjust that count based on the
+	 * value's significant digits and exponent. But this approach
+	 * fails if devices change their digits count depending on
+	 * modes or user requests, and also fails when e.g. devices
+	 * with "100000 counts" can provide values between 100000 and
+	 * 120000 in either 4 or 5 digits modes, depending on the most
+	 * recent trend of the values. This less robust approach should
+	 * only be taken if the mode inquiry won't yield the resolution
+	 * (as e.g. DIOD does on 34405A, though we happen to know the
+	 * fixed resolution for this very mode on this very model).
+	 *
+	 * For now, let's keep the prepared code path for the second
+	 * approach in place (see scpi_dmm_get_meas_agilent()), should
+	 * some Agilent devices need it yet benefit from re-using most
+	 * of the remaining acquisition routine.
+	 */
+	digits = -prec_exp;
+
+	/*
+	 * Use double precision FP for meters with many digits. Others
+	 * get downgraded to single precision to reduce the amount of
+	 * logged information.
+	 */
+	if (devc->model->digits >= 6)
+		analog->encoding->unitsize = sizeof(info->d_value);
+	else
+		analog->encoding->unitsize = sizeof(info->f_value);
+	analog->encoding->digits = digits;
+	analog->meaning->mq = mq;
+	analog->meaning->mqflags = mqflag;
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		unit = SR_UNIT_VOLT;
+		break;
+	case SR_MQ_CURRENT:
+		unit = SR_UNIT_AMPERE;
+		break;
+	case SR_MQ_RESISTANCE:
+	case SR_MQ_CONTINUITY:
+		unit = SR_UNIT_OHM;
+		break;
+	case SR_MQ_CAPACITANCE:
+		unit = SR_UNIT_FARAD;
+		break;
+	case SR_MQ_TEMPERATURE:
+		unit = SR_UNIT_CELSIUS;
+		break;
+	case SR_MQ_FREQUENCY:
+		unit = SR_UNIT_HERTZ;
+		break;
+	case SR_MQ_TIME:
+		unit = SR_UNIT_SECOND;
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+	analog->meaning->unit = unit;
+	analog->spec->spec_digits = digits;
+
+	return SR_OK;
+}
+
+SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	struct sr_datafeed_analog *analog;
+	int ret;
+	const char *p;
+	const char *command;
+	char *response;
+	int sig_digits, val_exp;
+	double limit;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	info = &devc->run_acq_info;
+	analog = &info->analog[ch];
+
+	ret = agilent_describe(sdi, ch);
+	if (ret != SR_OK)
+		return ret;
+
 	/*
 	 * Get the measurement value. Make sure to strip trailing space
 	 * or else number conversion may fail in fatal ways. Detect OL
@@ -383,10 +473,6 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	 * addition to providing a precise rational value instead of a
 	 * float that's an approximation of the received value? Can the
 	 * 'analog' struct that we fill in carry rationals?
-	 *
-	 * Use double precision FP here during conversion. Optionally
-	 * downgrade to single precision later to reduce the amount of
-	 * logged information.
 	 */
 	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_VALUE);
 	if (!command || !*command)
@@ -396,7 +482,6 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	if (ret != SR_OK)
 		return ret;
 	g_strstrip(response);
-	use_double = devc->model->digits >= 6;
 	ret = sr_atod_ascii(response, &info->d_value);
 	if (ret != SR_OK) {
 		g_free(response);
@@ -405,6 +490,7 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	if (!response)
 		return SR_ERR;
 	limit = 9e37;
+	sig_digits = val_exp = 0;
 	if (info->d_value > +limit) {
 		info->d_value = +INFINITY;
 	} else if (info->d_value < -limit) {
@@ -435,82 +521,21 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	g_free(response);
 	if (ret != SR_OK)
 		return ret;
-	/*
-	 * TODO Come up with the most appropriate 'digits' calculation.
-	 * This implementation assumes that either the device provides
-	 * the resolution with the query for the meter's function, or
-	 * the driver uses a fallback text pretending the device had
-	 * provided it. This works with supported Agilent devices.
-	 *
-	 * An alternative may be to assume a given digits count which
-	 * depends on the device, and adjust that count based on the
-	 * value's significant digits and exponent. But this approach
-	 * fails if devices change their digits count depending on
-	 * modes or user requests, and also fails when e.g. devices
-	 * with "100000 counts" can provide values between 100000 and
-	 * 120000 in either 4 or 5 digits modes, depending on the most
-	 * recent trend of the values. This less robust approach should
-	 * only be taken if the mode inquiry won't yield the resolution
-	 * (as e.g. DIOD does on 34405A, though we happen to know the
-	 * fixed resolution for this very mode on this very model).
-	 *
-	 * For now, let's keep the prepared code path for the second
-	 * approach in place, should some Agilent devices need it yet
-	 * benefit from re-using most of the remaining acquisition
-	 * routine.
-	 */
-#if 1
-	digits = -prec_exp;
+#if 0
+	/* The alternative 'digits' calculation, see agilent_describe(). */
+	analog->encoding->digits = devc->model->digits - sig_digits - val_exp;
+	analog->spec->spec_digits = analog->encoding->digits;
 #else
-	digits = devc->model->digits;
-	digits -= sig_digits;
-	digits -= val_exp;
+	(void)sig_digits;
+	(void)val_exp;
 #endif
 
-	/*
-	 * Fill in the 'analog' description: value, encoding, meaning.
-	 * Callers will fill in the sample count, and channel name,
-	 * and will send out the packet.
-	 */
-	if (use_double) {
+	if (analog->encoding->unitsize == sizeof(info->d_value)) {
 		analog->data = &info->d_value;
-		analog->encoding->unitsize = sizeof(info->d_value);
 	} else {
 		info->f_value = info->d_value;
 		analog->data = &info->f_value;
-		analog->encoding->unitsize = sizeof(info->f_value);
-	}
-	analog->encoding->digits = digits;
-	analog->meaning->mq = mq;
-	analog->meaning->mqflags = mqflag;
-	switch (mq) {
-	case SR_MQ_VOLTAGE:
-		unit = SR_UNIT_VOLT;
-		break;
-	case SR_MQ_CURRENT:
-		unit = SR_UNIT_AMPERE;
-		break;
-	case SR_MQ_RESISTANCE:
-	case SR_MQ_CONTINUITY:
-		unit = SR_UNIT_OHM;
-		break;
-	case SR_MQ_CAPACITANCE:
-		unit = SR_UNIT_FARAD;
-		break;
-	case SR_MQ_TEMPERATURE:
-		unit = SR_UNIT_CELSIUS;
-		break;
-	case SR_MQ_FREQUENCY:
-		unit = SR_UNIT_HERTZ;
-		break;
-	case SR_MQ_TIME:
-		unit = SR_UNIT_SECOND;
-		break;
-	default:
-		return SR_ERR_NA;
 	}
-	analog->meaning->unit = unit;
-	analog->spec->spec_digits = digits;
 
 	return SR_OK;
 }
@@ -718,6 +743,205 @@ SR_PRIV int scpi_dmm_get_meas_gwinstek(const struct sr_dev_inst *sdi, size_t ch)
 }
 
 /* Strictly speaking this is a timer controlled poll routine. */
+/*
+ * Models which keep readings in memory can take them at their own pace,
+ * while the driver pulls them in bulk (DATA:POIN?, DATA:REM?). This
+ * decouples the sample rate from the round trip time of queries.
+ */
+SR_PRIV gboolean scpi_dmm_can_buffer(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const char *command;
+
+	devc = sdi->priv;
+	if (devc->model->get_measurement != scpi_dmm_get_meas_agilent)
+		return FALSE;
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_BUFFERED);
+
+	return command && *command;
+}
+
+SR_PRIV int scpi_dmm_buffered_start(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	const char *command;
+	char interval_text[32], count_text[32];
+	int ret;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	info = &devc->run_acq_info;
+
+	/*
+	 * The meter's function won't change while it fills its reading
+	 * memory. Describe the values once, all chunks share it.
+	 */
+	sr_analog_init(&info->analog[0], &info->encoding[0],
+		&info->meaning[0], &info->spec[0], 0);
+	ret = agilent_describe(sdi, 0);
+	if (ret > 0) {
+		sr_err("Cannot buffer readings of an unknown function.");
+		return SR_ERR_NA;
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	/*
+	 * Free running measurements get triggered immediately and
+	 * endlessly. Paced measurements take timed samples from one
+	 * trigger, which is how these meters keep a precise interval.
+	 * The sample count then is the limit, or the memory's capacity.
+	 */
+	if (devc->sample_interval) {
+		command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_SETUP_INTERVAL);
+		if (!command || !*command)
+			return SR_ERR_NA;
+		g_ascii_formatd(interval_text, sizeof(interval_text), "%.3f",
+			devc->sample_interval / 1000.0);
+		if (devc->limits.limit_samples)
+			snprintf(count_text, sizeof(count_text), "%" PRIu64,
+				devc->limits.limit_samples);
+		else
+			snprintf(count_text, sizeof(count_text), "MAX");
+		scpi_dmm_cmd_delay(scpi);
+		ret = sr_scpi_send(scpi, command, interval_text, count_text);
+	} else {
+		command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_SETUP_BUFFERED);
+		if (!command || !*command)
+			return SR_ERR_NA;
+		scpi_dmm_cmd_delay(scpi);
+		ret = sr_scpi_send(scpi, command);
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	g_free(devc->f_values);
+	g_free(devc->d_values);
+	devc->f_values = NULL;
+	devc->d_values = NULL;
+	if (info->encoding[0].unitsize == sizeof(double))
+		devc->d_values = g_malloc(devc->buffer_size * sizeof(double));
+	else
+		devc->f_values = g_malloc(devc->buffer_size * sizeof(float));
+	devc->buffered = TRUE;
+
+	return SR_OK;
+}
+
+SR_PRIV void scpi_dmm_buffered_stop(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	const char *command;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	if (!devc->buffered)
+		return;
+
+	/* Single readings (READ?, FETCH?) won't work with endless triggers. */
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_SETUP_UNBUFFERED);
+	if (command && *command) {
+		scpi_dmm_cmd_delay(scpi);
+		(void)sr_scpi_send(scpi, command);
+	}
+	devc->buffered = FALSE;
+	g_free(devc->f_values);
+	g_free(devc->d_values);
+	devc->f_values = NULL;
+	devc->d_values = NULL;
+}
+
+/*
+ * Fetch the readings which the meter has taken so far, in one query.
+ * Returns the number of readings that were sent, or SR_ERR_* upon
+ * communication or conversion errors.
+ */
+static int receive_buffered(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	struct sr_channel *channel;
+	const char *command;
+	char *query, *response, *p, *end;
+	int points, ret;
+	size_t count, i;
+	uint64_t remain;
+	double value, limit;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	info = &devc->run_acq_info;
+
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_POINTS);
+	if (!command || !*command)
+		return SR_ERR_NA;
+	ret = sr_scpi_get_int(scpi, command, &points);
+	if (ret != SR_OK)
+		return ret;
+	if (points <= 0)
+		return 0;
+	count = MIN((uint64_t)points, devc->buffer_size);
+	if (devc->limits.limit_samples) {
+		remain = devc->limits.limit_samples - devc->limits.samples_read;
+		count = MIN(count, remain);
+	}
+	if (!count)
+		return 0;
+
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_BUFFERED);
+	query = g_strdup_printf(command, count);
+	ret = sr_scpi_get_string(scpi, query, &response);
+	g_free(query);
+	if (ret != SR_OK)
+		return ret;
+
+	/* The response is like "+1.09450000E-01,+1.09460000E-01,...". */
+	limit = 9e37;
+	p = response;
+	for (i = 0; i < count; i++) {
+		while (*p == ',' || g_ascii_isspace(*p))
+			p++;
+		value = g_ascii_strtod(p, &end);
+		if (end == p)
+			break;
+		p = end;
+		if (value > +limit)
+			value = +INFINITY;
+		else if (value < -limit)
+			value = -INFINITY;
+		if (devc->d_values)
+			devc->d_values[i] = value;
+		else
+			devc->f_values[i] = value;
+	}
+	g_free(response);
+	if (i != count) {
+		sr_err("Short read of buffered values, %zu of %zu.", i, count);
+		return SR_ERR_DATA;
+	}
+
+	channel = g_slist_nth_data(sdi->channels, 0);
+	info->packet.type = SR_DF_ANALOG;
+	info->packet.payload = &info->analog[0];
+	if (devc->d_values)
+		info->analog[0].data = devc->d_values;
+	else
+		info->analog[0].data = devc->f_values;
+	info->analog[0].num_samples = count;
+	info->analog[0].meaning->channels = g_slist_append(NULL, channel);
+	ret = sr_session_send(sdi, &info->packet);
+	g_slist_free(info->analog[0].meaning->channels);
+	info->analog[0].meaning->channels = NULL;
+	if (ret != SR_OK)
+		return ret;
+
+	return count;
+}
+
 SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
@@ -741,6 +965,18 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	info = &devc->run_acq_info;
 
+	if (devc->buffered) {
+		ret = receive_buffered(sdi);
+		if (ret < 0) {
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		sr_sw_limits_update_samples_read(&devc->limits, ret);
+		if (sr_sw_limits_check(&devc->limits))
+			sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+
 	sent_sample = FALSE;
 	ret = SR_OK;
 	for (ch = 0; ch < devc->num_channels; ch++) {
@@ -31,6 +31,7 @@
 #define LOG_PREFIX "scpi-dmm"
 
 #define SCPI_DMM_MAX_CHANNELS	1
+#define SCPI_DMM_MAX_BUFFERED	50000
 
 enum scpi_dmm_cmdcode {
 	DMM_CMD_SETUP_REMOTE,
@@ -45,6 +46,11 @@ enum scpi_dmm_cmdcode {
 	DMM_CMD_QUERY_RANGE,
 	DMM_CMD_SETUP_RANGE_AUTO,
 	DMM_CMD_SETUP_RANGE,
+	DMM_CMD_SETUP_BUFFERED,
+	DMM_CMD_SETUP_INTERVAL,
+	DMM_CMD_SETUP_UNBUFFERED,
+	DMM_CMD_QUERY_POINTS,
+	DMM_CMD_QUERY_BUFFERED,
 };
 
 struct mqopt_item {
@@ -103,6 +109,12 @@ struct dev_context {
 	} run_acq_info;
 	gchar *precision;
 	char range_text[32];
+	/* Readings per bulk query from reading memory, 0 when unused. */
+	uint64_t buffer_size;
+	uint64_t sample_interval; /* ms, 0 for back-to-back readings */
+	gboolean buffered;
+	float *f_values;
+	double *d_values;
 };
 
 SR_PRIV void scpi_dmm_cmd_delay(struct sr_scpi_dev_inst *scpi);
@@ -121,6 +133,9 @@ SR_PRIV int scpi_dmm_set_range_from_text(const struct sr_dev_inst *sdi,
 SR_PRIV GVariant *scpi_dmm_get_range_text_list(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch);
 SR_PRIV int scpi_dmm_get_meas_gwinstek(const struct sr_dev_inst *sdi, size_t ch);
+SR_PRIV gboolean scpi_dmm_can_buffer(const struct sr_dev_inst *sdi);
+SR_PRIV int scpi_dmm_buffered_start(const struct sr_dev_inst *sdi);
+SR_PRIV void scpi_dmm_buffered_stop(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data);
 
 #endif
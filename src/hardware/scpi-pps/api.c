@@ -813,6 +813,11 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Prime the pipe with the first channel. */
 	devc->cur_acquisition_channel = sr_next_enabled_channel(sdi, NULL);
+	devc->bulk_measure = scpi_pps_bulk_supported(sdi);
+	if (devc->bulk_measure) {
+		sr_dbg("Measuring all channels of an output at once.");
+		devc->queue = sr_scpi_queue_new(scpi, BULK_MAX_JOIN);
+	}
 
 	/* Device specific initialization before acquisition starts. */
 	if (devc->device->init_acquisition)
@@ -829,11 +834,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_scpi_dev_inst *scpi;
 
+	devc = sdi->priv;
 	scpi = sdi->conn;
 
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_queue_free(devc->queue);
+	devc->queue = NULL;
 
 	std_session_send_df_end(sdi);
 
@@ -25,6 +25,203 @@
 #include "scpi.h"
 #include "protocol.h"
 
+static const struct channel_spec *channel_spec_get(
+		const struct dev_context *devc, const struct pps_channel *pch)
+{
+	if (devc->channels) {
+		/* Dynamically-probed devices. */
+		return &devc->channels[pch->hw_output_idx];
+	}
+
+	/* Statically-configured devices. */
+	return &devc->device->channels[pch->hw_output_idx];
+}
+
+/* Note: digits/spec_digits will be overridden later. */
+static void analog_meta_set(struct sr_datafeed_analog *analog,
+		const struct pps_channel *pch, const struct channel_spec *ch_spec)
+{
+	analog->meaning->mq = pch->mq;
+	analog->meaning->mqflags = pch->mqflags;
+	if (pch->mq == SR_MQ_VOLTAGE) {
+		analog->meaning->unit = SR_UNIT_VOLT;
+		analog->encoding->digits = ch_spec->voltage[4];
+		analog->spec->spec_digits = ch_spec->voltage[3];
+	} else if (pch->mq == SR_MQ_CURRENT) {
+		analog->meaning->unit = SR_UNIT_AMPERE;
+		analog->encoding->digits = ch_spec->current[4];
+		analog->spec->spec_digits = ch_spec->current[3];
+	} else if (pch->mq == SR_MQ_POWER) {
+		analog->meaning->unit = SR_UNIT_WATT;
+		analog->encoding->digits = ch_spec->power[4];
+		analog->spec->spec_digits = ch_spec->power[3];
+	} else if (pch->mq == SR_MQ_FREQUENCY) {
+		analog->meaning->unit = SR_UNIT_HERTZ;
+		analog->encoding->digits = ch_spec->frequency[4];
+		analog->spec->spec_digits = ch_spec->frequency[3];
+	}
+}
+
+/* Quantities in the order of the SCPI_CMD_GET_MEAS_ALL response. */
+static const enum sr_mq bulk_mqs[] = {
+	SR_MQ_VOLTAGE, SR_MQ_CURRENT, SR_MQ_POWER,
+};
+
+/*
+ * Whether the device can measure all channels of an output in one query,
+ * and all enabled channels are of the quantities which that returns.
+ */
+SR_PRIV gboolean scpi_pps_bulk_supported(const struct sr_dev_inst *sdi)
+{
+	const struct dev_context *devc;
+	const struct sr_channel_layout *layout;
+	const struct pps_channel *pch;
+	size_t i;
+
+	devc = sdi->priv;
+	if (!sr_scpi_cmd_get(devc->device->commands, SCPI_CMD_GET_MEAS_ALL))
+		return FALSE;
+
+	layout = sr_dev_channel_layout(sdi);
+	for (i = 0; i < layout->num_enabled; i++) {
+		pch = layout->enabled[i]->priv;
+		if (pch->mq == SR_MQ_FREQUENCY)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* The measurement of one output, see bulk_query_done(). */
+struct bulk_query {
+	const char *hwname;
+	float values[ARRAY_SIZE(bulk_mqs)];
+	int status;
+};
+
+static void bulk_query_done(void *cb_data, int status, const char *response)
+{
+	struct bulk_query *query;
+	char **fields;
+	double d;
+	size_t i;
+
+	query = cb_data;
+	query->status = status;
+	if (status != SR_OK)
+		return;
+
+	fields = g_strsplit(response, ",", 0);
+	for (i = 0; i < ARRAY_SIZE(bulk_mqs); i++) {
+		if (!fields[i] || sr_atod_ascii(g_strstrip(fields[i]), &d) != SR_OK) {
+			sr_err("Unexpected response to measurement of output %s.",
+				query->hwname);
+			query->status = SR_ERR_DATA;
+			break;
+		}
+		query->values[i] = (float)d;
+	}
+	g_strfreev(fields);
+}
+
+/*
+ * Measure all enabled channels with one query per output, and send one
+ * multi-channel packet per quantity. The queries of all outputs go out
+ * in one program message, so a poll costs a single round trip.
+ */
+static int receive_bulk(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const struct sr_channel_layout *layout;
+	const struct pps_channel *pch, *first;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct bulk_query *queries, *query;
+	float *values, *data;
+	unsigned int cur_output;
+	size_t *query_idx;
+	size_t i, m, num, num_queries;
+	char *cmd;
+	int ret;
+
+	devc = sdi->priv;
+	layout = sr_dev_channel_layout(sdi);
+	if (!layout->num_enabled)
+		return SR_OK;
+
+	if (devc->device->update_status)
+		devc->device->update_status(sdi);
+
+	/* Consecutive channels of the same output share one query. */
+	queries = g_new0(struct bulk_query, layout->num_enabled);
+	query_idx = g_new(size_t, layout->num_enabled);
+	cur_output = G_MAXUINT;
+	num_queries = 0;
+	for (i = 0; i < layout->num_enabled; i++) {
+		pch = layout->enabled[i]->priv;
+		if (pch->hw_output_idx != cur_output) {
+			query = &queries[num_queries++];
+			query->hwname = pch->hwname;
+			cmd = g_strdup_printf(sr_scpi_cmd_get(devc->device->commands,
+				SCPI_CMD_GET_MEAS_ALL), pch->hwname);
+			sr_scpi_queue_add(devc->queue, SR_SCPI_QUEUE_QUERY,
+				bulk_query_done, query, cmd);
+			g_free(cmd);
+			cur_output = pch->hw_output_idx;
+		}
+		query_idx[i] = num_queries - 1;
+	}
+	sr_scpi_queue_run(devc->queue);
+
+	values = g_malloc_n(layout->num_enabled, sizeof(*values));
+	data = g_malloc_n(layout->num_enabled, sizeof(*data));
+	ret = SR_OK;
+	for (i = 0; i < layout->num_enabled; i++) {
+		pch = layout->enabled[i]->priv;
+		query = &queries[query_idx[i]];
+		if ((ret = query->status) != SR_OK)
+			break;
+		for (m = 0; m < ARRAY_SIZE(bulk_mqs); m++) {
+			if (bulk_mqs[m] == pch->mq)
+				values[i] = query->values[m];
+		}
+	}
+	g_free(queries);
+	g_free(query_idx);
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	for (m = 0; m < ARRAY_SIZE(bulk_mqs) && ret == SR_OK; m++) {
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+		first = NULL;
+		num = 0;
+		for (i = 0; i < layout->num_enabled; i++) {
+			pch = layout->enabled[i]->priv;
+			if (pch->mq != bulk_mqs[m])
+				continue;
+			if (!first)
+				first = pch;
+			meaning.channels = g_slist_append(meaning.channels,
+				layout->enabled[i]);
+			data[num++] = values[i];
+		}
+		if (!num)
+			continue;
+		analog_meta_set(&analog, first, channel_spec_get(devc, first));
+		analog.num_samples = 1;
+		analog.data = data;
+		sr_session_send(sdi, &packet);
+		g_slist_free(meaning.channels);
+	}
+	g_free(values);
+	g_free(data);
+
+	return ret;
+}
+
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -57,6 +254,16 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	if (!(device = devc->device))
 		return TRUE;
 
+	if (devc->bulk_measure) {
+		ret = receive_bulk(sdi);
+		if (ret != SR_OK)
+			return ret;
+		sr_sw_limits_update_samples_read(&devc->limits, 1);
+		if (sr_sw_limits_check(&devc->limits))
+			sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+
 	pch = devc->cur_acquisition_channel->priv;
 
 	channel_group_cmd = 0;
@@ -97,38 +304,13 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	if (ret != SR_OK)
 		return ret;
 
-	if (devc->channels) {
-		/* Dynamically-probed devices. */
-		ch_spec = &devc->channels[pch->hw_output_idx];
-	} else {
-		/* Statically-configured devices. */
-		ch_spec = &devc->device->channels[pch->hw_output_idx];
-	}
+	ch_spec = channel_spec_get(devc, pch);
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
-	/* Note: digits/spec_digits will be overridden later. */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
 	analog.meaning->channels = g_slist_append(NULL, devc->cur_acquisition_channel);
 	analog.num_samples = 1;
-	analog.meaning->mq = pch->mq;
-	analog.meaning->mqflags = pch->mqflags;
-	if (pch->mq == SR_MQ_VOLTAGE) {
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.encoding->digits = ch_spec->voltage[4];
-		analog.spec->spec_digits = ch_spec->voltage[3];
-	} else if (pch->mq == SR_MQ_CURRENT) {
-		analog.meaning->unit = SR_UNIT_AMPERE;
-		analog.encoding->digits = ch_spec->current[4];
-		analog.spec->spec_digits = ch_spec->current[3];
-	} else if (pch->mq == SR_MQ_POWER) {
-		analog.meaning->unit = SR_UNIT_WATT;
-		analog.encoding->digits = ch_spec->power[4];
-		analog.spec->spec_digits = ch_spec->power[3];
-	} else if (pch->mq == SR_MQ_FREQUENCY) {
-		analog.meaning->unit = SR_UNIT_HERTZ;
-		analog.encoding->digits = ch_spec->frequency[4];
-		analog.spec->spec_digits = ch_spec->frequency[3];
-	}
+	analog_meta_set(&analog, pch, ch_spec);
 	f = (float)g_variant_get_double(gvdata);
 	g_variant_unref(gvdata);
 	analog.data = &f;
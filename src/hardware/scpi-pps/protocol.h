@@ -29,6 +29,9 @@
 
 #define LOG_PREFIX "scpi-pps"
 
+/* Maximum number of bulk measurement queries per program message. */
+#define BULK_MAX_JOIN 8
+
 enum pps_scpi_cmds {
 	SCPI_CMD_REMOTE = 1,
 	SCPI_CMD_LOCAL,
@@ -40,6 +43,12 @@ enum pps_scpi_cmds {
 	SCPI_CMD_GET_MEAS_CURRENT,
 	SCPI_CMD_GET_MEAS_POWER,
 	SCPI_CMD_GET_MEAS_FREQUENCY,
+	/*
+	 * Voltage, current and power of one output in one query, the
+	 * output's name is the parameter. The response lists the values
+	 * separated by commas, in this order.
+	 */
+	SCPI_CMD_GET_MEAS_ALL,
 	SCPI_CMD_GET_VOLTAGE_TARGET,
 	SCPI_CMD_SET_VOLTAGE_TARGET,
 	SCPI_CMD_GET_FREQUENCY_TARGET,
@@ -163,6 +172,10 @@ struct dev_context {
 	struct channel_group_spec *channel_groups;
 
 	struct sr_channel *cur_acquisition_channel;
+	/* Measure all channels of an output with SCPI_CMD_GET_MEAS_ALL. */
+	gboolean bulk_measure;
+	/* Pipelines the bulk measurements of all outputs. */
+	struct sr_scpi_queue *queue;
 	struct sr_sw_limits limits;
 };
 
@@ -170,6 +183,7 @@ SR_PRIV extern unsigned int num_pps_profiles;
 SR_PRIV extern const struct scpi_pps pps_profiles[];
 
 SR_PRIV int select_channel(const struct sr_dev_inst *sdi, struct sr_channel *ch);
+SR_PRIV gboolean scpi_pps_bulk_supported(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -113,8 +113,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	 * and the serial port or USB to serial adapter.
 	 */
 	len = sizeof(buf);
-	ret = serial_stream_detect(serial, buf, &len, dmm->packet_size,
-		dmm->packet_valid, dmm->packet_valid_len, &packet_len, 3000);
+	ret = serial_stream_detect_sync(serial, buf, &len, dmm->packet_size,
+		dmm->packet_valid, dmm->packet_valid_len, dmm->sync,
+		&packet_len, 3000);
 	if (ret != SR_OK)
 		goto scan_cleanup;
 	dropped = len - dmm->packet_size;
@@ -319,6 +320,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		NULL, INIT_STATE, FREE_STATE, \
 		OPEN, VALID_LEN, PARSE_LEN, \
 		CFG_GET, CFG_SET, CFG_LIST, ACQ_START, \
+		&CHIPSET##_sync, \
 	}).di
 
 #define DMM_CONN(ID, CHIPSET, VENDOR, MODEL, \
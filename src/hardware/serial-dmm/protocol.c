@@ -144,7 +144,7 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
 	int ret;
-	size_t read_len, check_pos, check_len, pkt_size, copy_len;
+	size_t read_len, check_pos, check_len, pkt_size, copy_len, sync_size;
 	uint8_t *check_ptr;
 	uint64_t deadline;
 
@@ -168,6 +168,7 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	 * Process packets when their reception has completed, or keep
 	 * trying to synchronize to the stream of input data.
 	 */
+	sync_size = dmm->packet_valid_len ? 0 : dmm->packet_size;
 	check_pos = 0;
 	while (check_pos < devc->buflen) {
 		/* Got the (minimum) amount of receive data for a packet? */
@@ -187,13 +188,17 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 			}
 			if (ret == SR_PACKET_INVALID) {
 				sr_dbg("Not a valid packet, searching.");
-				check_pos++;
+				check_pos = serial_packet_sync_next(dmm->sync,
+					devc->buf, check_pos + 1,
+					devc->buflen, sync_size);
 				continue;
 			}
 		} else if (dmm->packet_valid) {
 			if (!dmm->packet_valid(check_ptr)) {
 				sr_dbg("Not a valid packet, searching.");
-				check_pos++;
+				check_pos = serial_packet_sync_next(dmm->sync,
+					devc->buf, check_pos + 1,
+					devc->buflen, sync_size);
 				continue;
 			}
 			pkt_size = dmm->packet_size;
@@ -78,6 +78,8 @@ struct dmm_info {
 	/** Hook at acquisition start. Can re-route the receive routine. */
 	int (*acquire_start)(void *state, const struct sr_dev_inst *sdi,
 		sr_receive_data_callback *cb, void **cb_data);
+	/** Fixed bytes of the packet format, to skip invalid data quickly. */
+	const struct sr_packet_sync *sync;
 };
 
 #define DMM_BUFSIZE 256
@@ -0,0 +1,254 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Pick up the datafeed which another process publishes with the "shm"
+ * output module. The conn= option names the ring.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "protocol.h"
+
+static const uint32_t scanopts[] = {
+	SR_CONF_CONN,
+};
+
+static const uint32_t drvopts[] = {
+	SR_CONF_LOGIC_ANALYZER,
+	SR_CONF_OSCILLOSCOPE,
+};
+
+static const uint32_t devopts[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET,
+	SR_CONF_CONN | SR_CONF_GET,
+};
+
+static GSList *scan(struct sr_dev_driver *di, GSList *options)
+{
+	struct dev_context *devc;
+	struct sr_dev_inst *sdi;
+	struct sr_config *src;
+	struct sr_shm_ring *ring;
+	struct sr_shm_ring_info *info;
+	struct sr_channel *ch;
+	GSList *l;
+	const char *conn;
+	char name[SR_SHM_RING_NAME_LEN + 1];
+	uint32_t i;
+
+	conn = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conn = g_variant_get_string(src->data, NULL);
+	}
+	if (!conn)
+		return NULL;
+
+	/* Only the channel layout is needed here, the ring gets closed. */
+	if (!(ring = sr_shm_ring_open(conn)))
+		return NULL;
+	info = ring->info;
+	if (info->num_logic + info->num_analog > SR_SHM_RING_CHANNELS) {
+		sr_err("Invalid channel count in %s.", ring->name);
+		sr_shm_ring_close(ring);
+		return NULL;
+	}
+
+	sdi = g_malloc0(sizeof(*sdi));
+	sdi->status = SR_ST_INACTIVE;
+	sdi->vendor = g_strdup("sigrok");
+	sdi->model = g_strdup("Shared memory datafeed");
+	sdi->connection_id = g_strdup(conn);
+	devc = g_malloc0(sizeof(*devc));
+	devc->name = g_strdup(conn);
+	devc->samplerate = info->samplerate;
+	devc->num_logic = info->num_logic;
+	devc->num_analog = info->num_analog;
+	devc->analog_channels = g_malloc0_n(devc->num_analog + 1,
+		sizeof(devc->analog_channels[0]));
+	sr_sw_limits_init(&devc->limits);
+	sdi->priv = devc;
+
+	name[SR_SHM_RING_NAME_LEN] = '\0';
+	for (i = 0; i < info->num_logic + info->num_analog; i++) {
+		memcpy(name, info->names[i], SR_SHM_RING_NAME_LEN);
+		if (i < info->num_logic) {
+			sr_channel_new(sdi, i, SR_CHANNEL_LOGIC, TRUE, name);
+		} else {
+			ch = sr_channel_new(sdi, i, SR_CHANNEL_ANALOG, TRUE, name);
+			devc->analog_channels[i - info->num_logic] = ch;
+		}
+	}
+	sr_shm_ring_close(ring);
+
+	return std_scan_complete(di, g_slist_append(NULL, sdi));
+}
+
+static void clear_helper(struct dev_context *devc)
+{
+	g_free(devc->analog_channels);
+	g_free(devc->name);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
+static int dev_open(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_shm_ring_info *info;
+
+	devc = sdi->priv;
+	if (!(devc->ring = sr_shm_ring_open(devc->name)))
+		return SR_ERR_IO;
+
+	/* The writer may have been restarted with other channels. */
+	info = devc->ring->info;
+	if (info->num_logic != devc->num_logic ||
+			info->num_analog != devc->num_analog) {
+		sr_err("The channels of %s have changed, rescan.", devc->name);
+		sr_shm_ring_close(devc->ring);
+		devc->ring = NULL;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int dev_close(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_shm_ring_close(devc->ring);
+	devc->ring = NULL;
+
+	return SR_OK;
+}
+
+static int config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+	devc = sdi->priv;
+
+	switch (key) {
+	case SR_CONF_CONN:
+		*data = g_variant_new_string(devc->name);
+		break;
+	case SR_CONF_SAMPLERATE:
+		if (devc->ring)
+			devc->samplerate = devc->ring->info->samplerate;
+		if (!devc->samplerate)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+	case SR_CONF_LIMIT_MSEC:
+		return sr_sw_limits_config_get(&devc->limits, key, data);
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_set(uint32_t key, GVariant *data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	devc = sdi->priv;
+
+	return sr_sw_limits_config_set(&devc->limits, key, data);
+}
+
+static int config_list(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	return STD_CONFIG_LIST(key, data, sdi, cg, scanopts, drvopts, devopts);
+}
+
+static int dev_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int ret;
+
+	devc = sdi->priv;
+	if ((ret = sr_shm_ring_attach(devc->ring)) != SR_OK)
+		return ret;
+
+	sr_sw_limits_acquisition_start(&devc->limits);
+	std_session_send_df_header(sdi);
+
+	/* The writer cannot wake us up, poll the ring. */
+	sr_session_source_add(sdi->session, -1, 0, 10,
+		shm_reader_receive_data, (void *)sdi);
+
+	return SR_OK;
+}
+
+static int dev_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_session_source_remove(sdi->session, -1);
+	sr_shm_ring_detach(devc->ring);
+	std_session_send_df_end(sdi);
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver shm_reader_driver_info = {
+	.name = "shm-reader",
+	.longname = "Shared memory datafeed reader",
+	.api_version = 1,
+	.init = std_init,
+	.cleanup = std_cleanup,
+	.scan = scan,
+	.dev_list = std_dev_list,
+	.dev_clear = dev_clear,
+	.config_get = config_get,
+	.config_set = config_set,
+	.config_list = config_list,
+	.dev_open = dev_open,
+	.dev_close = dev_close,
+	.dev_acquisition_start = dev_acquisition_start,
+	.dev_acquisition_stop = dev_acquisition_stop,
+	.context = NULL,
+};
+SR_REGISTER_DEV_DRIVER(shm_reader_driver_info);
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "protocol.h"
+
+/*
+ * The packets point into the shared memory, their payload is not copied.
+ * Datafeed callbacks which keep packets get a copy from sr_packet_ref(),
+ * so the record can be released as soon as sr_session_send() returns.
+ */
+
+static int send_logic(const struct sr_dev_inst *sdi,
+		const struct sr_shm_ring_record *rec)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	const struct sr_shm_rec_logic *hdr;
+
+	devc = sdi->priv;
+	if (rec->size < sizeof(*hdr))
+		return SR_ERR_DATA;
+	hdr = (const struct sr_shm_rec_logic *)(rec + 1);
+	if (!hdr->unitsize)
+		return SR_ERR_DATA;
+
+	logic.unitsize = hdr->unitsize;
+	logic.length = rec->size - sizeof(*hdr);
+	logic.length -= logic.length % logic.unitsize;
+	logic.data = (void *)(hdr + 1);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	sr_session_send(sdi, &packet);
+	sr_sw_limits_update_samples_read(&devc->limits,
+		logic.length / logic.unitsize);
+
+	return SR_OK;
+}
+
+static int send_analog(const struct sr_dev_inst *sdi,
+		const struct sr_shm_ring_record *rec)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const struct sr_shm_rec_analog *hdr;
+
+	devc = sdi->priv;
+	if (rec->size < sizeof(*hdr))
+		return SR_ERR_DATA;
+	hdr = (const struct sr_shm_rec_analog *)(rec + 1);
+	if (hdr->channel >= devc->num_analog ||
+			hdr->num_samples > (rec->size - sizeof(*hdr)) / sizeof(float))
+		return SR_ERR_DATA;
+	if (!devc->analog_channels[hdr->channel]->enabled)
+		return SR_OK;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, hdr->digits);
+	analog.meaning->channels = g_slist_append(NULL,
+		devc->analog_channels[hdr->channel]);
+	analog.meaning->mq = hdr->mq;
+	analog.meaning->unit = hdr->unit;
+	analog.meaning->mqflags = hdr->mqflags;
+	analog.num_samples = hdr->num_samples;
+	analog.data = (void *)(hdr + 1);
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+	sr_sw_limits_update_samples_read(&devc->limits, hdr->num_samples);
+
+	return SR_OK;
+}
+
+static int handle_record(const struct sr_dev_inst *sdi,
+		const struct sr_shm_ring_record *rec)
+{
+	struct dev_context *devc;
+	uint64_t samplerate;
+
+	devc = sdi->priv;
+
+	switch (rec->type) {
+	case SR_SHM_REC_SAMPLERATE:
+		if (rec->size < sizeof(samplerate))
+			return SR_ERR_DATA;
+		memcpy(&samplerate, rec + 1, sizeof(samplerate));
+		if (samplerate == devc->samplerate)
+			break;
+		devc->samplerate = samplerate;
+		return sr_session_send_meta(sdi, SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(samplerate));
+	case SR_SHM_REC_LOGIC:
+		return send_logic(sdi, rec);
+	case SR_SHM_REC_ANALOG:
+		return send_analog(sdi, rec);
+	case SR_SHM_REC_TRIGGER:
+		return std_session_send_df_trigger(sdi);
+	case SR_SHM_REC_FRAME_BEGIN:
+		return std_session_send_df_frame_begin(sdi);
+	case SR_SHM_REC_FRAME_END:
+		return std_session_send_df_frame_end(sdi);
+	case SR_SHM_REC_END:
+		/* The writer's acquisition ended, so does ours. */
+		return SR_ERR_NA;
+	default:
+		/* HEADER, and record types of later versions. */
+		break;
+	}
+
+	return SR_OK;
+}
+
+SR_PRIV int shm_reader_receive_data(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	const struct sr_shm_ring_record *rec;
+	int i, ret;
+
+	(void)fd;
+	(void)revents;
+
+	if (!(sdi = cb_data) || !(devc = sdi->priv))
+		return TRUE;
+
+	for (i = 0; i < RECORDS_PER_CALL; i++) {
+		ret = sr_shm_ring_peek(devc->ring, &rec);
+		if (ret == SR_ERR_NA) {
+			if (sr_shm_ring_writer_closed(devc->ring)) {
+				sr_info("The writer closed %s.", devc->name);
+				break;
+			}
+			return TRUE;
+		}
+		if (ret != SR_OK) {
+			sr_err("Lost the connection to %s.", devc->name);
+			break;
+		}
+		ret = handle_record(sdi, rec);
+		sr_shm_ring_release(devc->ring);
+		if (ret == SR_ERR_DATA) {
+			sr_err("Invalid record in %s.", devc->name);
+			break;
+		}
+		if (ret == SR_ERR_NA || sr_sw_limits_check(&devc->limits))
+			break;
+	}
+	if (i == RECORDS_PER_CALL)
+		return TRUE;
+
+	sr_dev_acquisition_stop((struct sr_dev_inst *)sdi);
+
+	return TRUE;
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_HARDWARE_SHM_READER_PROTOCOL_H
+#define LIBSIGROK_HARDWARE_SHM_READER_PROTOCOL_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "shm-reader"
+
+/* Upper bound of records which get forwarded per main loop iteration. */
+#define RECORDS_PER_CALL 256
+
+struct dev_context {
+	char *name;
+	struct sr_shm_ring *ring;
+	struct sr_sw_limits limits;
+	uint64_t samplerate;
+	uint32_t num_logic;
+	/* The analog channels, in the ring's order. */
+	struct sr_channel **analog_channels;
+	uint32_t num_analog;
+};
+
+SR_PRIV int shm_reader_receive_data(int fd, int revents, void *cb_data);
+
+#endif
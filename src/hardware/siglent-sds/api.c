@@ -157,6 +157,7 @@ static const uint64_t averages[] = {
 static const char *data_sources[] = {
 	"Display",
 	"History",
+	"Sequence",
 };
 
 enum vendor {
@@ -240,6 +241,8 @@ static void clear_helper(void *priv)
 		return;
 	g_free(devc->analog_groups);
 	g_free(devc->enabled_channels);
+	if (devc->dig_buffer)
+		g_array_free(devc->dig_buffer, TRUE);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -427,6 +430,8 @@ static int config_get(uint32_t key, GVariant **data,
 			*data = g_variant_new_string("Screen");
 		else if (devc->data_source == DATA_SOURCE_HISTORY)
 			*data = g_variant_new_string("History");
+		else if (devc->data_source == DATA_SOURCE_SEQUENCE)
+			*data = g_variant_new_string("Sequence");
 		break;
 	case SR_CONF_SAMPLERATE:
 		siglent_sds_get_dev_cfg_horizontal(sdi);
@@ -675,6 +680,9 @@ static int config_set(uint32_t key, GVariant *data,
 		else if (devc->model->series->protocol >= SPO_MODEL
 			&& !strcmp(tmp_str, "History"))
 			devc->data_source = DATA_SOURCE_HISTORY;
+		else if (devc->model->series->protocol != NON_SPO_MODEL
+			&& !strcmp(tmp_str, "Sequence"))
+			devc->data_source = DATA_SOURCE_SEQUENCE;
 		else {
 			sr_err("Unknown data source: '%s'.", tmp_str);
 			return SR_ERR;
@@ -766,7 +774,7 @@ static int config_list(uint32_t key, GVariant **data,
 		switch (devc->model->series->protocol) {
 		/* TODO: Check what must be done here for the data source buffer sizes. */
 		case NON_SPO_MODEL:
-			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 1);
+			*data = g_variant_new_strv(data_sources, 1);
 			break;
 		case SPO_MODEL:
 		case ESERIES:
@@ -800,6 +808,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	devc->num_frames = 0;
 	some_digital = FALSE;
+	siglent_sds_sequence_free(devc);
 
 	/*
 	 * Check if there are any logic channels enabled, if so then enable
@@ -812,6 +821,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		if (ch->type == SR_CHANNEL_LOGIC && ch->enabled)
 			some_digital = TRUE;
 	}
+	if (some_digital && devc->data_source == DATA_SOURCE_SEQUENCE) {
+		sr_err("Sequence mode only supports analog channels.");
+		return SR_ERR_NA;
+	}
 
 	for (l = sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -911,6 +924,11 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
 
+	if (devc->data_source == DATA_SOURCE_SEQUENCE) {
+		siglent_sds_sequence_free(devc);
+		siglent_sds_config_set(sdi, "SEQ OFF");
+	}
+
 	return SR_OK;
 }
 
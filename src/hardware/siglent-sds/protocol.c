@@ -149,6 +149,24 @@ SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi, const char *fo
 	return ret;
 }
 
+/*
+ * In sequence mode have the scope record limit_frames segments (or as
+ * many as configured on the scope) at its own trigger rate, to download
+ * them all at once afterwards.
+ */
+static int siglent_sds_sequence_arm(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->data_source != DATA_SOURCE_SEQUENCE)
+		return SR_OK;
+	if (!devc->limit_frames)
+		return siglent_sds_config_set(sdi, "SEQ ON");
+
+	return siglent_sds_config_set(sdi, "SEQ ON,%" PRIu64, devc->limit_frames);
+}
+
 /* Start capturing a new frameset. */
 SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 {
@@ -159,10 +177,12 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 
 	switch (devc->model->series->protocol) {
 	case SPO_MODEL:
-		if (devc->data_source == DATA_SOURCE_SCREEN) {
+		if (devc->data_source != DATA_SOURCE_HISTORY) {
 			char *buf;
 			int out;
 
+			if (siglent_sds_sequence_arm(sdi) != SR_OK)
+				return SR_ERR;
 			sr_dbg("Starting data capture for active frameset %" PRIu64 " of %" PRIu64,
 				devc->num_frames + 1, devc->limit_frames);
 			if (siglent_sds_config_set(sdi, "ARM") != SR_OK)
@@ -209,10 +229,12 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 		}
 		break;
 	case ESERIES:
-		if (devc->data_source == DATA_SOURCE_SCREEN) {
+		if (devc->data_source != DATA_SOURCE_HISTORY) {
 			char *buf;
 			int out;
 
+			if (siglent_sds_sequence_arm(sdi) != SR_OK)
+				return SR_ERR;
 			sr_dbg("Starting data capture for active frameset %" PRIu64 " of %" PRIu64,
 				devc->num_frames + 1, devc->limit_frames);
 			if (siglent_sds_config_set(sdi, "ARM") != SR_OK)
@@ -302,159 +324,293 @@ SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 	}
 
 	devc->num_channel_bytes = 0;
-	devc->num_header_bytes = 0;
-	devc->num_block_bytes = 0;
 
 	return SR_OK;
 }
 
-/* Read the header of a data block. */
-static int siglent_sds_read_header(struct sr_dev_inst *sdi)
+/*
+ * Offsets in the WaveDescriptor. The block starts with the descriptor,
+ * followed by the user text, the trigger times of sequence segments,
+ * and other arrays, all of the lengths which are given here. The sample
+ * data comes last.
+ */
+#define WAVEDESC_DESC_LENGTH 36
+#define WAVEDESC_TEXT_LENGTH 40
+#define WAVEDESC_RES_DESC1_LENGTH 44
+#define WAVEDESC_TRIGTIME_LENGTH 48
+#define WAVEDESC_RIS_TIME_LENGTH 52
+#define WAVEDESC_RES_ARRAY1_LENGTH 56
+#define WAVEDESC_ARRAY_LENGTH 60
+#define WAVEDESC_SUBARRAY_COUNT 144
+#define WAVEDESC_MIN_SIZE 148
+/* A trigger time entry holds the trigger time and offset as doubles. */
+#define TRIGTIME_ENTRY_SIZE 16
+
+/* Reception state of a "C<n>:WF? ALL" block, see siglent_sds_block_cb(). */
+struct siglent_block {
+	const struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	/* Number of bytes in front of the samples, 0 until it is known. */
+	size_t prefix_length;
+	/* Offset of the trigger times, and their number. */
+	size_t trigtime_offset;
+	size_t num_trigtimes;
+	/* Number of segments, 1 unless in sequence mode. */
+	size_t num_segments;
+	/* Number of sample bytes, and how many of them were taken. */
+	size_t data_length;
+	size_t num_sent;
+	/* Collects the samples instead of sending them, when not NULL. */
+	GByteArray *samples;
+};
+
+static void siglent_sds_send_analog(const struct sr_dev_inst *sdi,
+		struct sr_channel *ch, const uint8_t *data, size_t len)
 {
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
-	struct dev_context *devc = sdi->priv;
-	char *buf = (char *)devc->buffer;
-	int ret, desc_length;
-	int block_offset = 15; /* Offset for descriptor block. */
-	long data_length = 0;
-
-	/* Read header from device. */
-	ret = sr_scpi_read_data(scpi, buf, SIGLENT_HEADER_SIZE);
-	if (ret < SIGLENT_HEADER_SIZE) {
-		sr_err("Read error while reading data header.");
-		return SR_ERR;
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float vdiv, offset, vdivlog;
+	int digits;
+
+	devc = sdi->priv;
+	vdiv = devc->vdiv[ch->index];
+	offset = devc->vert_offset[ch->index];
+	vdivlog = log10f(vdiv);
+	digits = -(int) vdivlog + (vdivlog < 0.0);
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	/* Signed ADC bytes, 25 steps per division. */
+	sr_analog_encoding_set_raw(&encoding, 1, TRUE, FALSE,
+		vdiv / 25.0, -offset);
+	analog.meaning->channels = g_slist_append(NULL, ch);
+	analog.num_samples = len;
+	analog.data = (void *)data;
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+}
+
+/* Get the layout of the block from its WaveDescriptor. */
+static int siglent_sds_parse_wavedesc(struct siglent_block *blk,
+		const uint8_t *desc, size_t buffer_size)
+{
+	uint64_t desc_length, text_length, trigtime_length, prefix_length;
+	uint32_t segments;
+
+	desc_length = RL32(&desc[WAVEDESC_DESC_LENGTH]);
+	text_length = RL32(&desc[WAVEDESC_TEXT_LENGTH]) +
+		RL32(&desc[WAVEDESC_RES_DESC1_LENGTH]);
+	trigtime_length = RL32(&desc[WAVEDESC_TRIGTIME_LENGTH]);
+	prefix_length = desc_length + text_length + trigtime_length +
+		RL32(&desc[WAVEDESC_RIS_TIME_LENGTH]) +
+		RL32(&desc[WAVEDESC_RES_ARRAY1_LENGTH]);
+	if (desc_length < WAVEDESC_MIN_SIZE || prefix_length > buffer_size) {
+		sr_err("Invalid wave descriptor length %" PRIu64 ".",
+			desc_length);
+		return SR_ERR_DATA;
 	}
-	sr_dbg("Device returned %i bytes.", ret);
-	devc->num_header_bytes += ret;
-	buf += block_offset; /* Skip to start descriptor block. */
 
-	/* Parse WaveDescriptor header. */
-	memcpy(&desc_length, buf + 36, 4); /* Descriptor block length */
-	memcpy(&data_length, buf + 60, 4); /* Data block length */
+	blk->prefix_length = prefix_length;
+	blk->trigtime_offset = desc_length + text_length;
+	blk->num_trigtimes = trigtime_length / TRIGTIME_ENTRY_SIZE;
+	blk->data_length = RL32(&desc[WAVEDESC_ARRAY_LENGTH]);
+	segments = RL32(&desc[WAVEDESC_SUBARRAY_COUNT]);
+	blk->num_segments = segments ? segments : 1;
+	sr_dbg("Wave descriptor of %" PRIu64 " bytes, %zu sample bytes "
+		"in %zu segments.", desc_length, blk->data_length,
+		blk->num_segments);
 
-	devc->block_header_size = desc_length + 15;
-	devc->num_samples = data_length;
+	return SR_OK;
+}
 
-	sr_dbg("Received data block header: '%s' -> block length %d.", buf, ret);
+/*
+ * Collect the WaveDescriptor and the arrays after it at the start of
+ * the block, then take the sample bytes as they arrive. They get sent
+ * right away, or kept when a sequence of segments needs splitting.
+ */
+static int siglent_sds_block_cb(void *cb_data, const uint8_t *data,
+		size_t len, size_t offset, size_t total)
+{
+	struct siglent_block *blk;
+	struct dev_context *devc;
+	size_t count;
+	int ret;
 
-	return ret;
+	(void)total;
+
+	blk = cb_data;
+	devc = blk->sdi->priv;
+	while (len) {
+		if (!blk->prefix_length || offset < blk->prefix_length) {
+			count = (blk->prefix_length ? blk->prefix_length :
+				WAVEDESC_MIN_SIZE) - offset;
+			count = MIN(count, len);
+			memcpy(&devc->buffer[offset], data, count);
+			offset += count;
+			data += count;
+			len -= count;
+			if (blk->prefix_length || offset < WAVEDESC_MIN_SIZE)
+				continue;
+			ret = siglent_sds_parse_wavedesc(blk, devc->buffer,
+				devc->model->series->buffer_samples);
+			if (ret != SR_OK)
+				return ret;
+			devc->num_samples = blk->data_length;
+			continue;
+		}
+		/* Bytes past the sample data don't belong to the waveform. */
+		count = MIN(len, blk->data_length - blk->num_sent);
+		if (!count)
+			break;
+		if (blk->samples)
+			g_byte_array_append(blk->samples, data, count);
+		else
+			siglent_sds_send_analog(blk->sdi, blk->ch, data, count);
+		blk->num_sent += count;
+		offset += count;
+		data += count;
+		len -= count;
+	}
+
+	return SR_OK;
+}
+
+static void sequence_data_free(gpointer data)
+{
+	g_byte_array_free(data, TRUE);
+}
+
+SR_PRIV void siglent_sds_sequence_free(struct dev_context *devc)
+{
+	if (devc->seq_data)
+		g_ptr_array_free(devc->seq_data, TRUE);
+	devc->seq_data = NULL;
+	if (devc->seq_times)
+		g_array_free(devc->seq_times, TRUE);
+	devc->seq_times = NULL;
+}
+
+/* Keep the segments of a channel, and the trigger times of the first. */
+static void siglent_sds_sequence_keep(struct dev_context *devc,
+		struct siglent_block *blk)
+{
+	double t;
+	size_t i;
+
+	if (!devc->seq_data)
+		devc->seq_data = g_ptr_array_new_with_free_func(
+			sequence_data_free);
+	g_ptr_array_add(devc->seq_data, blk->samples);
+	blk->samples = NULL;
+
+	if (devc->seq_times)
+		return;
+	devc->seq_times = g_array_sized_new(FALSE, TRUE, sizeof(double),
+		blk->num_segments);
+	for (i = 0; i < blk->num_segments; i++) {
+		t = 0;
+		if (i < blk->num_trigtimes)
+			t = RLDB(&devc->buffer[blk->trigtime_offset +
+				i * TRIGTIME_ENTRY_SIZE]);
+		g_array_append_val(devc->seq_times, t);
+	}
 }
 
+/*
+ * Send the recorded segments, one frame each with its trigger time.
+ * The first frame was begun when the acquisition started.
+ */
+static void siglent_sds_sequence_send(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	GByteArray *samples;
+	GSList *l;
+	size_t seg, idx, seg_len;
+
+	devc = sdi->priv;
+	if (!devc->seq_data || !devc->seq_times)
+		return;
+
+	for (seg = 0; seg < devc->seq_times->len; seg++) {
+		if (seg)
+			std_session_send_df_frame_begin(sdi);
+		sr_session_send_meta(sdi, SR_CONF_FRAME_TIMESTAMP,
+			g_variant_new_double(g_array_index(devc->seq_times,
+				double, seg)));
+		idx = 0;
+		for (l = devc->enabled_channels; l; l = l->next) {
+			if (((struct sr_channel *)l->data)->type != SR_CHANNEL_ANALOG)
+				continue;
+			if (idx >= devc->seq_data->len)
+				break;
+			samples = g_ptr_array_index(devc->seq_data, idx++);
+			seg_len = samples->len / devc->seq_times->len;
+			if (seg_len)
+				siglent_sds_send_analog(sdi, l->data,
+					&samples->data[seg * seg_len], seg_len);
+		}
+		std_session_send_df_frame_end(sdi);
+	}
+	siglent_sds_sequence_free(devc);
+}
+
+/*
+ * Each digital channel comes as a bit plane of its own, least significant
+ * bit first. Keep the planes, and have them transposed to 16bit samples
+ * in 8x8 bit tiles when all channels are in.
+ */
 static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_channel *ch)
 {
 	struct sr_scpi_dev_inst *scpi = sdi->conn;
 	struct dev_context *devc = sdi->priv;
-	GArray *tmp_samplebuf; /* Temp buffer while iterating over the scope samples */
-	char *buf = (char *)devc->buffer; /* Buffer from scope */
-	uint8_t tmp_value; /* Holding temp value from data */
-	GArray *data_low_channels, *data_high_channels, *buffdata;
+	const uint8_t *planes[16];
+	uint8_t *plane_data;
+	size_t plane_bytes, num_samples, len;
+	char cmd[32];
 	GSList *l;
-	gboolean low_channels; /* Lower channels enabled */
-	gboolean high_channels; /* Higher channels enabled */
-	int len, channel_index;
-	uint64_t samples_index;
-
-	len = 0;
-	channel_index = 0;
-	low_channels = FALSE;
-	high_channels = FALSE;
-	data_low_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
-	data_high_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
+
+	memset(planes, 0, sizeof(planes));
+	num_samples = devc->memory_depth_digital;
+	plane_bytes = (num_samples + 7) / 8;
+	plane_data = g_malloc0(ARRAY_SIZE(planes) * plane_bytes);
 
 	for (l = sdi->channels; l; l = l->next) {
 		ch = l->data;
-		samples_index = 0;
-		if (ch->type == SR_CHANNEL_LOGIC) {
-			if (ch->enabled) {
-				if (sr_scpi_send(sdi->conn, "D%d:WF? DAT2", ch->index) != SR_OK)
-					return SR_ERR;
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				len = sr_scpi_read_data(scpi, buf, -1);
-				if (len < 0)
-					return TRUE;
-				len -= 15;
-				buffdata = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-				buf += 15; /* Skipping the data header. */
-				g_array_append_vals(buffdata, buf, len);
-				tmp_samplebuf = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len); /* New temp buffer. */
-				for (uint64_t cur_sample_index = 0; cur_sample_index < devc->memory_depth_digital; cur_sample_index++) {
-					char sample = (char)g_array_index(buffdata, uint8_t, cur_sample_index);
-					for (int ii = 0; ii < 8; ii++, sample >>= 1) {
-						if (ch->index < 8) {
-							channel_index = ch->index;
-							if (data_low_channels->len <= samples_index) {
-								tmp_value = 0; /* New sample. */
-								low_channels = TRUE; /* We have at least one enabled low channel. */
-							} else {
-								/* Get previous stored sample from low channel buffer. */
-								tmp_value = g_array_index(data_low_channels, uint8_t, samples_index);
-							}
-						} else {
-							channel_index = ch->index - 8;
-							if (data_high_channels->len <= samples_index) {
-								tmp_value = 0; /* New sample. */
-								high_channels = TRUE; /* We have at least one enabled high channel. */
-							} else {
-								/* Get previous stored sample from high channel buffer. */
-								tmp_value = g_array_index(data_high_channels, uint8_t, samples_index);
-							}
-						}
-						/* Check if the current scope sample bit is set. */
-						if (sample & 0x1)
-							tmp_value |= 1UL << channel_index; /* Set current scope sample bit based on channel index. */
-						g_array_append_val(tmp_samplebuf, tmp_value);
-						samples_index++;
-					}
-				}
-
-				/* Clear the buffers to prepare for the new samples */
-				if (ch->index < 8) {
-					g_array_free(data_low_channels, FALSE);
-					data_low_channels = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-				} else {
-					g_array_free(data_high_channels, FALSE);
-					data_high_channels = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-				}
-
-				/* Storing the converted temp values from the the scope into the buffers. */
-				for (uint64_t index = 0; index < tmp_samplebuf->len; index++) {
-					uint8_t value = g_array_index(tmp_samplebuf, uint8_t, index);
-					if (ch->index < 8)
-						g_array_append_val(data_low_channels, value);
-					else
-						g_array_append_val(data_high_channels, value);
-				}
-				g_array_free(tmp_samplebuf, TRUE);
-				g_array_free(buffdata, TRUE);
-			}
-		}
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		if (ch->index >= (int)ARRAY_SIZE(planes))
+			continue;
+		g_snprintf(cmd, sizeof(cmd), "D%d:WF? DAT2", ch->index);
+		if (sr_scpi_get_block_into(scpi, cmd,
+				&plane_data[ch->index * plane_bytes],
+				plane_bytes, &len) != SR_OK)
+			goto err;
+		if (!len)
+			continue;
+		planes[ch->index] = &plane_data[ch->index * plane_bytes];
+		num_samples = MIN(num_samples, len * 8);
 	}
 
-	/* Combining the lower and higher channel buffers into one buffer for sigrok. */
-	devc->dig_buffer = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-	for (uint64_t index = 0; index < devc->memory_depth_digital; index++) {
-		uint8_t value;
-		if (low_channels) {
-			value = g_array_index(data_low_channels, uint8_t, index);
-			g_array_append_val(devc->dig_buffer, value);
-		} else {
-			value = 0;
-			g_array_append_val(devc->dig_buffer, value);
-		}
-		if (high_channels) {
-			value = g_array_index(data_high_channels, uint8_t, index);
-			g_array_append_val(devc->dig_buffer, value);
-		} else {
-			value = 0;
-			g_array_append_val(devc->dig_buffer, value);
-		}
-	}
+	if (!devc->dig_buffer)
+		devc->dig_buffer = g_array_new(FALSE, FALSE, sizeof(uint8_t));
+	g_array_set_size(devc->dig_buffer, plane_bytes * 8 * sizeof(uint16_t));
+	sr_bitplanes_to_samples((uint8_t *)devc->dig_buffer->data, sizeof(uint16_t),
+		planes, plane_bytes);
+	g_array_set_size(devc->dig_buffer, num_samples * sizeof(uint16_t));
+	g_free(plane_data);
 
-	g_array_free(data_low_channels, TRUE);
-	g_array_free(data_high_channels, TRUE);
+	return SR_OK;
 
-	return len;
+err:
+	g_free(plane_data);
+	return SR_ERR;
 }
 
 SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
@@ -463,15 +619,11 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	struct sr_channel *ch;
-	int len, i;
+	struct siglent_block blk;
 	float wait;
-	gboolean read_complete = FALSE;
+	int ret;
 
 	(void)fd;
 
@@ -511,144 +663,77 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	}
 
 	ch = devc->channel_entry->data;
-	len = 0;
 
 	if (ch->type == SR_CHANNEL_ANALOG) {
-		if (devc->num_block_bytes == 0) {
-			/* Wait for the device to fill its output buffers. */
-			switch (devc->model->series->protocol) {
-			case NON_SPO_MODEL:
-			case SPO_MODEL:
-				/* The older models need more time to prepare the the output buffers due to CPU speed. */
-				wait = (devc->memory_depth_analog * 2.5);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				break;
-			case ESERIES:
-				/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				break;
-			}
+		/* Wait for the device to fill its output buffers. */
+		switch (devc->model->series->protocol) {
+		case NON_SPO_MODEL:
+		case SPO_MODEL:
+			/* The older models need more time to prepare the the output buffers due to CPU speed. */
+			wait = (devc->memory_depth_analog * 2.5);
+			sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
+			g_usleep(wait);
+			break;
+		case ESERIES:
+			/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
+			wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
+			sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
+			g_usleep(wait);
+			break;
+		}
 
-			sr_dbg("New block with header expected.");
-			len = siglent_sds_read_header(sdi);
-			if (len == 0)
-				/* Still reading the header. */
-				return TRUE;
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
-				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-			devc->num_block_bytes = len;
-			devc->num_block_read = 0;
+		/* The samples get sent while the block still comes in. */
+		memset(&blk, 0, sizeof(blk));
+		blk.sdi = sdi;
+		blk.ch = ch;
+		if (devc->data_source == DATA_SOURCE_SEQUENCE)
+			blk.samples = g_byte_array_new();
+		ret = sr_scpi_get_block_stream(scpi, NULL, siglent_sds_block_cb, &blk);
+		if (ret != SR_OK || !blk.prefix_length ||
+				blk.num_sent < blk.data_length) {
+			sr_err("Read error, aborting capture.");
+			if (blk.samples)
+				g_byte_array_free(blk.samples, TRUE);
+			std_session_send_df_frame_end(sdi);
+			sdi->driver->dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		if (blk.samples)
+			siglent_sds_sequence_keep(devc, &blk);
+		sr_dbg("Transfer has been completed.");
+		devc->num_channel_bytes = blk.num_sent;
+		if (!sr_scpi_read_complete(scpi)) {
+			sr_err("Read should have been completed.");
+			std_session_send_df_frame_end(sdi);
+			sdi->driver->dev_acquisition_stop(sdi);
+			return TRUE;
+		}
 
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+		if (devc->channel_entry->next) {
+			/* We got the frame for this channel, now get the next channel. */
+			devc->channel_entry = devc->channel_entry->next;
+			siglent_sds_channel_start(sdi);
+		} else if (devc->data_source == DATA_SOURCE_SEQUENCE) {
+			/* All channels' segments are in, send them as frames. */
+			siglent_sds_sequence_send(sdi);
+			sdi->driver->dev_acquisition_stop(sdi);
+		} else {
+			/* Done with this frame. */
+			std_session_send_df_frame_end(sdi);
+			if (++devc->num_frames == devc->limit_frames) {
+				/* Last frame, stop capture. */
 				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-
-			do {
-				read_complete = FALSE;
-				if (devc->num_block_bytes > devc->num_samples) {
-					/* We received all data as one block. */
-					/* Offset the data block buffer past the IEEE header and description header. */
-					devc->buffer += devc->block_header_size;
-					len = devc->num_samples;
-				} else {
-					sr_dbg("Requesting: %" PRIu64 " bytes.", devc->num_samples - devc->num_block_bytes);
-					len = sr_scpi_read_data(scpi, (char *)devc->buffer, devc->num_samples-devc->num_block_bytes);
-					if (len == -1) {
-						sr_err("Read error, aborting capture.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read++;
-					devc->num_block_bytes += len;
-				}
-				sr_dbg("Received block: %i, %d bytes.", devc->num_block_read, len);
-				if (ch->type == SR_CHANNEL_ANALOG) {
-					float vdiv = devc->vdiv[ch->index];
-					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
-					int digits;
-
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
-					vdivlog = log10f(vdiv);
-					digits = -(int) vdivlog + (vdivlog < 0.0);
-					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
-					analog.meaning->mq = SR_MQ_VOLTAGE;
-					analog.meaning->unit = SR_UNIT_VOLT;
-					analog.meaning->mqflags = 0;
-					packet.type = SR_DF_ANALOG;
-					packet.payload = &analog;
-					sr_session_send(sdi, &packet);
-					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
-				}
-				len = 0;
-				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
-					sr_dbg("Transfer has been completed.");
-					devc->num_header_bytes = 0;
-					devc->num_block_bytes = 0;
-					read_complete = TRUE;
-					if (!sr_scpi_read_complete(scpi)) {
-						sr_err("Read should have been completed.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read = 0;
-				} else {
-					sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read.",
-						devc->num_block_bytes, devc->num_samples);
-				}
-			} while (!read_complete);
-
-			if (devc->channel_entry->next) {
-				/* We got the frame for this channel, now get the next channel. */
-				devc->channel_entry = devc->channel_entry->next;
-				siglent_sds_channel_start(sdi);
 			} else {
-				/* Done with this frame. */
-				std_session_send_df_frame_end(sdi);
-				if (++devc->num_frames == devc->limit_frames) {
-					/* Last frame, stop capture. */
-					sdi->driver->dev_acquisition_stop(sdi);
-				} else {
-					/* Get the next frame, starting with the first channel. */
-					devc->channel_entry = devc->enabled_channels;
-					siglent_sds_capture_start(sdi);
-
-					/* Start of next frame. */
-					std_session_send_df_frame_begin(sdi);
-				}
+				/* Get the next frame, starting with the first channel. */
+				devc->channel_entry = devc->enabled_channels;
+				siglent_sds_capture_start(sdi);
+
+				/* Start of next frame. */
+				std_session_send_df_frame_begin(sdi);
 			}
 		}
 	} else {
-		if (!siglent_sds_get_digital(sdi, ch))
+		if (siglent_sds_get_digital(sdi, ch) != SR_OK)
 			return TRUE;
 		logic.length = devc->dig_buffer->len;
 		logic.unitsize = 2;
@@ -31,9 +31,6 @@
 //#define ACQ_BUFFER_SIZE (6000000)
 #define ACQ_BUFFER_SIZE (18000000)
 
-#define SIGLENT_HEADER_SIZE 363
-#define SIGLENT_DIG_HEADER_SIZE 346
-
 /* Maximum number of samples to retrieve at once. */
 #define ACQ_BLOCK_SIZE (30 * 1000)
 
@@ -54,6 +51,7 @@ enum protocol_version {
 enum data_source {
 	DATA_SOURCE_SCREEN,
 	DATA_SOURCE_HISTORY,
+	DATA_SOURCE_SEQUENCE,
 };
 
 struct siglent_sds_vendor {
@@ -113,7 +111,6 @@ struct dev_context {
 	uint64_t num_samples;
 	uint64_t memory_depth_analog;
 	uint64_t memory_depth_digital;
-	long block_header_size;
 	float samplerate;
 
 	/* Device settings */
@@ -139,12 +136,6 @@ struct dev_context {
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
 	uint64_t num_channel_bytes;
-	/* Number of bytes of block header read. */
-	uint64_t num_header_bytes;
-	/* Number of data blocks bytes already read. */
-	uint64_t num_block_bytes;
-	/* Number of data blocks read. */
-	int num_block_read;
 	/* What to wait for in *_receive. */
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status. */
@@ -153,6 +144,10 @@ struct dev_context {
 	unsigned char *buffer;
 	float *data;
 	GArray *dig_buffer;
+	/* Sequence mode: all segments per enabled analog channel. */
+	GPtrArray *seq_data;
+	/* Sequence mode: trigger times of the segments, in seconds. */
+	GArray *seq_times;
 };
 
 SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
@@ -160,6 +155,7 @@ SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
 SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data);
+SR_PRIV void siglent_sds_sequence_free(struct dev_context *devc);
 SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_get_dev_cfg_vertical(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_get_dev_cfg_horizontal(const struct sr_dev_inst *sdi);
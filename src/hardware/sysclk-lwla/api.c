@@ -156,7 +156,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 	if (conn) {
 		/* Find devices matching the connection specification. */
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	}
 
 	/* List all libusb devices. */
@@ -112,6 +112,9 @@ struct acquisition_state {
 
 	struct libusb_transfer *xfer_in;	/* USB in transfer record */
 	struct libusb_transfer *xfer_out;	/* USB out transfer record */
+	/* Register writes which get queued ahead of xfer_out. */
+	struct libusb_transfer *xfer_regs[MAX_REG_SEQ_LEN - 1];
+	unsigned int reg_xfers_pending;	/* number of those in flight */
 
 	unsigned int mem_addr_fill;	/* capture memory fill level */
 	unsigned int mem_addr_done;	/* next address to be processed */
@@ -131,6 +134,7 @@ struct acquisition_state {
 	struct regval reg_sequence[MAX_REG_SEQ_LEN];	/* register buffer */
 	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN32];	/* USB in buffer */
 	uint16_t xfer_buf_out[MAX_ACQ_SEND_LEN16];	/* USB out buffer */
+	uint16_t reg_buf_out[MAX_REG_SEQ_LEN - 1][4];	/* register writes */
 	uint8_t out_packet[PACKET_SIZE];		/* logic payload */
 };
 
@@ -39,19 +39,69 @@ static int submit_transfer(struct dev_context *devc,
 	return SR_OK;
 }
 
+/* Fill in the command words of a register write. */
+static void fill_reg_write(uint16_t *command, const struct regval *regval)
+{
+	command[0] = LWLA_WORD(CMD_WRITE_REG);
+	command[1] = LWLA_WORD(regval->reg);
+	command[2] = LWLA_WORD_0(regval->val);
+	command[3] = LWLA_WORD_1(regval->val);
+}
+
 /* Set up transfer for the next register in a write sequence. */
 static void next_reg_write(struct acquisition_state *acq)
 {
-	struct regval *regval;
+	fill_reg_write(acq->xfer_buf_out,
+		       &acq->reg_sequence[acq->reg_seq_pos]);
+
+	acq->xfer_out->length = 4 * sizeof(acq->xfer_buf_out[0]);
+}
+
+/*
+ * Submit all but the last register write of a sequence at once. Each
+ * write still is a USB transfer of its own, as the firmware expects
+ * one command per transfer. But they get queued back to back without
+ * waiting for the preceding completion. The last write goes through
+ * the regular output transfer, whose completion advances the state.
+ */
+static int submit_reg_writes(struct dev_context *devc)
+{
+	struct acquisition_state *acq;
+	unsigned int i;
+	int ret;
 
-	regval = &acq->reg_sequence[acq->reg_seq_pos];
+	acq = devc->acquisition;
 
-	acq->xfer_buf_out[0] = LWLA_WORD(CMD_WRITE_REG);
-	acq->xfer_buf_out[1] = LWLA_WORD(regval->reg);
-	acq->xfer_buf_out[2] = LWLA_WORD_0(regval->val);
-	acq->xfer_buf_out[3] = LWLA_WORD_1(regval->val);
+	for (i = 0; i + 1 < acq->reg_seq_len; i++) {
+		fill_reg_write(acq->reg_buf_out[i], &acq->reg_sequence[i]);
+		ret = submit_transfer(devc, acq->xfer_regs[i]);
+		if (ret != SR_OK)
+			return ret;
+		acq->reg_xfers_pending++;
+	}
+	acq->reg_seq_pos = acq->reg_seq_len - 1;
+	next_reg_write(acq);
 
-	acq->xfer_out->length = 4 * sizeof(acq->xfer_buf_out[0]);
+	return SR_OK;
+}
+
+/* Completion callback of the register writes queued ahead. */
+static void LIBUSB_CALL reg_write_completed(struct libusb_transfer *transfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	devc->acquisition->reg_xfers_pending--;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+	    transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+		sr_err("Register write failed (state %d): %s.",
+		       devc->state, libusb_error_name(transfer->status));
+		devc->transfer_error = TRUE;
+	}
 }
 
 /* Set up transfer for the next register in a read sequence. */
@@ -109,10 +159,13 @@ static int submit_request(const struct sr_dev_inst *sdi,
 	}
 
 	if (acq->reg_seq_pos < acq->reg_seq_len) {
-		if ((state & STATE_EXPECT_RESPONSE) != 0)
+		if ((state & STATE_EXPECT_RESPONSE) != 0) {
 			next_reg_read(acq);
-		else
-			next_reg_write(acq);
+		} else {
+			ret = submit_reg_writes(devc);
+			if (ret != SR_OK)
+				return ret;
+		}
 	}
 
 	return submit_transfer(devc, acq->xfer_out);
@@ -247,6 +300,7 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	devc = sdi->priv;
 	acq = devc->acquisition;
@@ -254,6 +308,8 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 	devc->acquisition = NULL;
 
 	if (acq) {
+		for (i = 0; i < ARRAY_SIZE(acq->xfer_regs); i++)
+			libusb_free_transfer(acq->xfer_regs[i]);
 		libusb_free_transfer(acq->xfer_out);
 		libusb_free_transfer(acq->xfer_in);
 		g_free(acq);
@@ -267,6 +323,7 @@ static int transfer_event(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	struct timeval tv;
+	unsigned int i;
 	int ret;
 
 	(void)fd;
@@ -302,6 +359,13 @@ static int transfer_event(int fd, int revents, void *cb_data)
 	if (devc->state != STATE_IDLE)
 		return G_SOURCE_CONTINUE;
 
+	/* Wait for queued register writes before releasing them. */
+	if (devc->acquisition->reg_xfers_pending > 0) {
+		for (i = 0; i < ARRAY_SIZE(devc->acquisition->xfer_regs); i++)
+			libusb_cancel_transfer(devc->acquisition->xfer_regs[i]);
+		return G_SOURCE_CONTINUE;
+	}
+
 	sr_info("Acquisition stopped.");
 
 	/* We are done, clean up and send end packet to session bus. */
@@ -442,6 +506,7 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -470,6 +535,24 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 		g_free(acq);
 		return SR_ERR_MALLOC;
 	}
+	for (i = 0; i < ARRAY_SIZE(acq->xfer_regs); i++) {
+		acq->xfer_regs[i] = libusb_alloc_transfer(0);
+		if (!acq->xfer_regs[i]) {
+			while (i-- > 0)
+				libusb_free_transfer(acq->xfer_regs[i]);
+			libusb_free_transfer(acq->xfer_out);
+			libusb_free_transfer(acq->xfer_in);
+			g_free(acq);
+			return SR_ERR_MALLOC;
+		}
+		libusb_fill_bulk_transfer(acq->xfer_regs[i], usb->devhdl,
+					  EP_COMMAND,
+					  (unsigned char *)acq->reg_buf_out[i],
+					  sizeof(acq->reg_buf_out[i]),
+					  &reg_write_completed,
+					  (struct sr_dev_inst *)sdi,
+					  USB_TIMEOUT_MS);
+	}
 
 	libusb_fill_bulk_transfer(acq->xfer_out, usb->devhdl, EP_COMMAND,
 				  (unsigned char *)acq->xfer_buf_out, 0,
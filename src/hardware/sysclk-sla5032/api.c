@@ -165,7 +165,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 	if (conn) {
 		/* Find devices matching the connection specification. */
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	}
 
 	/* List all libusb devices. */
@@ -233,6 +233,16 @@ static int dev_open(struct sr_dev_inst *sdi)
 	return sla5032_apply_fpga_config(sdi);
 }
 
+static void clear_helper(struct dev_context *devc)
+{
+	sr_trigger_free(devc->soft_trigger);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
 static int dev_close(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
@@ -368,17 +378,28 @@ static int config_channel_set(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
-/* Derive trigger masks from the session's trigger configuration. */
+/* The hardware matches one stage of levels and edges except "any edge". */
+static const struct sr_trigger_hw_caps hw_trigger_caps = {
+	.num_stages = 1,
+	.matches = (1UL << SR_TRIGGER_ZERO) | (1UL << SR_TRIGGER_ONE) |
+		(1UL << SR_TRIGGER_RISING) | (1UL << SR_TRIGGER_FALLING),
+	.num_channels = NUM_CHANNELS,
+};
+
+/*
+ * Derive trigger masks from the session's trigger configuration. Stages
+ * which the hardware can't match are left to the soft trigger.
+ */
 static int prepare_trigger_masks(const struct sr_dev_inst *sdi)
 {
 	uint32_t trigger_mask, trigger_values, trigger_edge_mask;
 	uint32_t level_bit, type_bit;
 	struct dev_context *devc;
-	struct sr_trigger *trigger;
+	struct sr_trigger *trigger, *hw_trigger;
 	struct sr_trigger_stage *stage;
 	struct sr_trigger_match *match;
 	const GSList *node;
-	int idx;
+	int idx, ret;
 	enum sr_trigger_matches trg;
 
 	devc = sdi->priv;
@@ -387,16 +408,17 @@ static int prepare_trigger_masks(const struct sr_dev_inst *sdi)
 	trigger_values = 0;
 	trigger_edge_mask = 0;
 
+	sr_trigger_free(devc->soft_trigger);
+	devc->soft_trigger = NULL;
+
 	trigger = sr_session_trigger_get(sdi->session);
-	if (!trigger || !trigger->stages) {
+	ret = sr_trigger_split(trigger, &hw_trigger_caps,
+		&hw_trigger, &devc->soft_trigger);
+	if (ret != SR_OK)
+		return ret;
+	if (!hw_trigger)
 		goto no_triggers;
-	}
-
-	if (trigger->stages->next) {
-		sr_err("This device only supports 1 trigger stage.");
-		return SR_ERR_ARG;
-	}
-	stage = trigger->stages->data;
+	stage = hw_trigger->stages->data;
 
 	for (node = stage->matches; node; node = node->next) {
 		match = node->data;
@@ -407,17 +429,6 @@ static int prepare_trigger_masks(const struct sr_dev_inst *sdi)
 		idx = match->channel->index;
 		trg = match->match;
 
-		if (idx < 0 || idx >= NUM_CHANNELS) {
-			sr_err("Channel index %d out of range.", idx);
-			return SR_ERR_BUG; /* Should not happen. */
-		}
-		if (trg != SR_TRIGGER_ZERO
-			&& trg != SR_TRIGGER_ONE
-			&& trg != SR_TRIGGER_RISING
-			&& trg != SR_TRIGGER_FALLING) {
-			sr_err("Unsupported trigger match for CH%d.", idx);
-			return SR_ERR_ARG;
-		}
 		level_bit = (trg == SR_TRIGGER_ONE
 			|| trg == SR_TRIGGER_RISING) ? 1 : 0;
 		type_bit = (trg == SR_TRIGGER_RISING
@@ -427,6 +438,7 @@ static int prepare_trigger_masks(const struct sr_dev_inst *sdi)
 		trigger_values |= level_bit << idx;
 		trigger_edge_mask |= type_bit << idx;
 	}
+	sr_trigger_free(hw_trigger);
 
 no_triggers:
 	devc->trigger_mask = trigger_mask;
@@ -510,6 +522,12 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	/* The download's event source sends the end of the feed. */
+	if (devc->downloading) {
+		devc->download_done = TRUE;
+		return SR_OK;
+	}
+
 	sr_session_source_remove(sdi->session, -1);
 
 	std_session_send_df_end(sdi);
@@ -527,7 +545,7 @@ static struct sr_dev_driver sysclk_sla5032_driver_info = {
 	.cleanup = std_cleanup,
 	.scan = scan,
 	.dev_list = std_dev_list,
-	.dev_clear = std_dev_clear,
+	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_channel_set = config_channel_set,
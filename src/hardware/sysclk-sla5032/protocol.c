@@ -120,6 +120,23 @@
 #define FW_CHUNK_SIZE 250
 #define XILINX_SYNC_WORD 0xAA995566
 
+/*
+ * The sample memory gets downloaded in chunks of RLE samples. Each chunk
+ * gets requested by a command sequence, and arrives on EP_DATA, through
+ * a ring of transfers which stay submitted. So the device never waits
+ * for the host, and transfers get decoded while the next ones are on
+ * the way. Chunks end with a short transfer, or when they are full. A
+ * full chunk means there is more.
+ */
+enum {
+	RLE_SAMPLE_SIZE = sizeof(uint32_t) + sizeof(uint16_t),
+	RLE_SAMPLES_COUNT = 0x100000,
+	RLE_BUF_SIZE = RLE_SAMPLES_COUNT * RLE_SAMPLE_SIZE,
+	RLE_END_MARKER = 0xFFFF,
+	/* Whole RLE samples and USB packets, chunks are 32 transfers. */
+	DATA_XFER_SIZE = RLE_SAMPLE_SIZE * 512 * 64,
+};
+
 static int la_write_cmd_buf(const struct sr_usb_dev_inst *usb, uint8_t cmd,
 		unsigned int addr, unsigned int len, const void *data)
 {
@@ -412,15 +429,8 @@ static int sla5032_get_status(const struct sr_usb_dev_inst *usb, uint32_t status
 	return ret;
 }
 
-static int la_read_samples_data(const struct sr_usb_dev_inst *usb, void *buf,
-		unsigned int len, int *xfer_len)
-{
-	return libusb_bulk_transfer(usb->devhdl, EP_DATA, (uint8_t *)buf, len,
-			xfer_len, USB_DATA_TIMEOUT_MS);
-}
-
-static int sla5032_read_data_chunk(const struct sr_usb_dev_inst *usb,
-		void *buf, unsigned int len, int *xfer_len)
+/* Have the device send the next chunk of sample memory on EP_DATA. */
+static int sla5032_request_data_chunk(const struct sr_usb_dev_inst *usb)
 {
 	int ret;
 
@@ -436,11 +446,7 @@ static int sla5032_read_data_chunk(const struct sr_usb_dev_inst *usb,
 	if (ret != SR_OK)
 		return ret;
 
-	ret = la_set_res_reg_bit(usb, 5, 4, 1);
-	if (ret != SR_OK)
-		return ret;
-
-	return la_read_samples_data(usb, buf, len, xfer_len);
+	return la_set_res_reg_bit(usb, 5, 4, 1);
 }
 
 static int sla5032_set_read_back(const struct sr_usb_dev_inst *usb)
@@ -683,186 +689,330 @@ SR_PRIV int sla5032_apply_fpga_config(const struct sr_dev_inst *sdi)
 	return ret;
 }
 
-/* Callback handling data */
-static int la_prepare_data(int fd, int revents, void *cb_data)
+/* Decode a block of RLE samples, and send them to the session bus. */
+static int decode_samples(const struct sr_dev_inst *sdi, const uint8_t *buf,
+		size_t len, gboolean *end)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
-	int i, j, ret, xfer_len;
-	uint8_t *rle_buf, *samples;
-	const uint8_t *p, *q;
-	uint16_t rle_count;
-	int samples_count, rle_samples_count;
-	uint32_t status[3];
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	const uint8_t *p;
+	uint8_t *samples, *q;
+	uint16_t rle_count;
 	uint32_t value;
-	int trigger_offset;
+	size_t i, rle_samples_count, samples_count;
+	int trigger_offset, j;
+	uint64_t skip;
 
-	enum {
-		RLE_SAMPLE_SIZE = sizeof(uint32_t) + sizeof(uint16_t),
-		RLE_SAMPLES_COUNT = 0x100000,
-		RLE_BUF_SIZE = RLE_SAMPLES_COUNT * RLE_SAMPLE_SIZE,
-		RLE_END_MARKER = 0xFFFF,
-	};
+	devc = sdi->priv;
+
+	p = buf;
+	samples_count = 0;
+	rle_samples_count = len / RLE_SAMPLE_SIZE;
+	for (i = 0; i < rle_samples_count; i++) {
+		p += sizeof(uint32_t); /* skip sample value */
+
+		rle_count = RL16(p); /* read RLE counter */
+		p += sizeof(uint16_t);
+		if (rle_count == RLE_END_MARKER) {
+			sr_dbg("RLE end marker found.");
+			rle_samples_count = i;
+			*end = TRUE;
+			break;
+		}
+		samples_count += rle_count + 1;
+	}
+	if (samples_count == 0)
+		return SR_OK;
+
+	/* Decode RLE */
+	samples = g_try_malloc(samples_count * sizeof(uint32_t));
+	if (!samples) {
+		sr_err("Sample buffer allocation failed.");
+		return SR_ERR_MALLOC;
+	}
+
+	p = buf;
+	q = samples;
+	for (i = 0; i < rle_samples_count; i++) {
+		value = RL32(p);
+		p += sizeof(uint32_t); /* read sample value */
+
+		rle_count = RL16(p); /* read RLE counter */
+		p += sizeof(uint16_t);
+
+		for (j = 0; j <= rle_count; j++) {
+			WL32(q, value);
+			q += sizeof(uint32_t);
+		}
+	}
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = sizeof(uint32_t);
+	if (devc->trigger_fired) {
+		/* Send the incoming transfer to the session bus. */
+		logic.length = samples_count * sizeof(uint32_t);
+		logic.data = samples;
+		sr_session_send(sdi, &packet);
+	} else {
+		skip = MIN(devc->soft_trigger_skip, (uint64_t)samples_count);
+		soft_trigger_logic_skip(devc->stl, samples,
+			skip * sizeof(uint32_t));
+		devc->soft_trigger_skip -= skip;
+		trigger_offset = soft_trigger_logic_check(devc->stl,
+			samples + skip * sizeof(uint32_t),
+			(samples_count - skip) * sizeof(uint32_t), NULL);
+		if (trigger_offset > -1) {
+			trigger_offset += skip;
+			logic.length = (samples_count - trigger_offset) *
+				sizeof(uint32_t);
+			logic.data = samples + trigger_offset * sizeof(uint32_t);
+			sr_session_send(sdi, &packet);
+
+			devc->trigger_fired = TRUE;
+		}
+	}
+
+	g_free(samples);
+
+	return SR_OK;
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *xfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	gboolean end, short_xfer;
+	int ret;
+
+	sdi = xfer->user_data;
+	devc = sdi->priv;
+	devc->xfers_active--;
+
+	if (devc->download_done)
+		return;
+
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			xfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		sr_err("Sample download failed: %s.",
+			libusb_error_name(xfer->status));
+		devc->download_done = TRUE;
+		return;
+	}
+
+	end = FALSE;
+	if (decode_samples(sdi, xfer->buffer, xfer->actual_length, &end) != SR_OK)
+		end = TRUE;
+	devc->chunk_bytes += xfer->actual_length;
+	short_xfer = xfer->actual_length < xfer->length;
+	if (short_xfer || devc->chunk_bytes >= RLE_BUF_SIZE) {
+		sr_dbg("Chunk of %" PRIu64 " bytes done.", devc->chunk_bytes);
+		/* Only full chunks get followed by more. */
+		if (devc->chunk_bytes < RLE_BUF_SIZE)
+			end = TRUE;
+		devc->request_chunk = !end;
+		devc->chunk_bytes = 0;
+	}
+	if (end) {
+		devc->download_done = TRUE;
+		return;
+	}
+
+	ret = libusb_submit_transfer(xfer);
+	if (ret != 0) {
+		sr_err("Cannot resubmit transfer: %s.", libusb_error_name(ret));
+		devc->download_done = TRUE;
+		return;
+	}
+	devc->xfers_active++;
+}
+
+static void download_free(struct dev_context *devc)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(devc->xfers); i++) {
+		if (!devc->xfers[i])
+			continue;
+		g_free(devc->xfers[i]->buffer);
+		libusb_free_transfer(devc->xfers[i]);
+		devc->xfers[i] = NULL;
+	}
+}
+
+/* Callback handling the sample download */
+static int la_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	struct timeval tv;
+	size_t i;
+	int ret;
 
 	(void)fd;
 	(void)revents;
 
 	sdi = cb_data;
 	devc = sdi->priv;
+	drvc = sdi->driver->context;
 	usb = sdi->conn;
 
-	memset(status, 0, sizeof(status));
-	ret = sla5032_get_status(usb, status);
-	if (ret != SR_OK) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
-		return G_SOURCE_CONTINUE;
+	/* Handle pending USB events without blocking. */
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	ret = libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
+		&tv, NULL);
+	if (ret != 0) {
+		sr_err("Event handling failed: %s.", libusb_error_name(ret));
+		devc->download_done = TRUE;
 	}
 
-	/* data not ready (acquision in progress) */
-	if (status[1] != 3)
-		return G_SOURCE_CONTINUE;
-
-	sr_dbg("acquision done, status: %u.", (unsigned int)status[2]);
-
-	/* data ready (download, decode and send to sigrok) */
-	ret = sla5032_set_read_back(usb);
-	if (ret != SR_OK) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
-		return G_SOURCE_CONTINUE;
+	/* The data keeps arriving in the transfers which are submitted. */
+	if (devc->request_chunk && !devc->download_done) {
+		devc->request_chunk = FALSE;
+		if (sla5032_request_data_chunk(usb) != SR_OK)
+			devc->download_done = TRUE;
 	}
 
-	rle_buf = g_try_malloc(RLE_BUF_SIZE);
-	if (rle_buf == NULL) {
-		sla5032_write_reg14_zero(usb);
-		sr_dev_acquisition_stop(sdi);
+	if (!devc->download_done)
 		return G_SOURCE_CONTINUE;
-	}
 
-	do {
-		xfer_len = 0;
-		ret = sla5032_read_data_chunk(usb, rle_buf, RLE_BUF_SIZE, &xfer_len);
-		if (ret != SR_OK) {
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-
-			sr_dbg("acquision done, ret: %d.", ret);
-			return G_SOURCE_CONTINUE;
+	/* Wait for the transfers which did not complete. */
+	if (devc->xfers_active) {
+		if (!devc->xfers_cancelled) {
+			for (i = 0; i < ARRAY_SIZE(devc->xfers); i++)
+				libusb_cancel_transfer(devc->xfers[i]);
+			devc->xfers_cancelled = TRUE;
 		}
+		return G_SOURCE_CONTINUE;
+	}
 
-		sr_dbg("acquision done, xfer_len: %d.", xfer_len);
-
-		if (xfer_len == 0) {
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
-		}
+	sr_dbg("Sample download done.");
+	download_free(devc);
+	devc->downloading = FALSE;
+	sla5032_write_reg14_zero(usb);
+	if (devc->stl) {
+		soft_trigger_logic_free(devc->stl);
+		devc->stl = NULL;
+	}
+	std_session_send_df_end(sdi);
+	devc->state = STATE_IDLE;
 
-		p = rle_buf;
-		samples_count = 0;
-		rle_samples_count = xfer_len / RLE_SAMPLE_SIZE;
+	return G_SOURCE_REMOVE;
+}
 
-		sr_dbg("acquision done, rle_samples_count: %d.", rle_samples_count);
+/* Submit the transfer ring, and request the first chunk of samples. */
+static int start_download(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *xfer;
+	uint8_t *buf;
+	size_t i;
+	int ret;
 
-		for (i = 0; i < rle_samples_count; i++) {
-			p += sizeof(uint32_t); /* skip sample value */
+	devc = sdi->priv;
+	drvc = sdi->driver->context;
+	usb = sdi->conn;
 
-			rle_count = RL16(p); /* read RLE counter */
-			p += sizeof(uint16_t);
-			if (rle_count == RLE_END_MARKER) {
-				rle_samples_count = i;
-				break;
-			}
-			samples_count += rle_count + 1;
-		}
-		sr_dbg("acquision done, samples_count: %d.", samples_count);
-
-		if (samples_count == 0) {
-			sr_dbg("acquision done, no samples.");
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
+	devc->xfers_active = 0;
+	devc->xfers_cancelled = FALSE;
+	devc->chunk_bytes = 0;
+	devc->request_chunk = FALSE;
+	devc->download_done = FALSE;
+	for (i = 0; i < ARRAY_SIZE(devc->xfers); i++) {
+		buf = g_try_malloc(DATA_XFER_SIZE);
+		xfer = buf ? libusb_alloc_transfer(0) : NULL;
+		if (!xfer) {
+			sr_err("Transfer allocation failed.");
+			g_free(buf);
+			ret = SR_ERR_MALLOC;
+			goto err;
 		}
-
-		/* Decode RLE */
-		samples = g_try_malloc(samples_count * sizeof(uint32_t));
-		if (!samples) {
-			sr_dbg("memory allocation error.");
-			sla5032_write_reg14_zero(usb);
-			g_free(rle_buf);
-			sr_dev_acquisition_stop(sdi);
-			return G_SOURCE_CONTINUE;
+		libusb_fill_bulk_transfer(xfer, usb->devhdl, EP_DATA, buf,
+			DATA_XFER_SIZE, receive_transfer, sdi,
+			USB_DATA_TIMEOUT_MS);
+		devc->xfers[i] = xfer;
+	}
+	for (i = 0; i < ARRAY_SIZE(devc->xfers); i++) {
+		ret = libusb_submit_transfer(devc->xfers[i]);
+		if (ret != 0) {
+			sr_err("Cannot submit transfer: %s.",
+				libusb_error_name(ret));
+			ret = SR_ERR_IO;
+			goto err;
 		}
+		devc->xfers_active++;
+	}
 
-		p = rle_buf;
-		q = samples;
-		for (i = 0; i < rle_samples_count; i++) {
-			value = RL32(p);
-			p += sizeof(uint32_t); /* read sample value */
+	ret = sla5032_request_data_chunk(usb);
+	if (ret != SR_OK)
+		goto err;
 
-			rle_count = RL16(p); /* read RLE counter */
-			p += sizeof(uint16_t);
+	devc->downloading = TRUE;
 
-			if (rle_count == RLE_END_MARKER) {
-				sr_dbg("RLE end marker found.");
-				break;
-			}
+	return usb_source_add(sdi->session, drvc->sr_ctx, 100,
+		la_receive_data, sdi);
 
-			for (j = 0; j <= rle_count; j++) {
-				WL32(q, value);
-				q += sizeof(uint32_t);
-			}
-		}
+err:
+	/* Transfers which got submitted get cancelled and completed. */
+	devc->download_done = TRUE;
+	for (i = 0; i < ARRAY_SIZE(devc->xfers); i++) {
+		if (devc->xfers[i])
+			libusb_cancel_transfer(devc->xfers[i]);
+	}
+	while (devc->xfers_active)
+		libusb_handle_events_completed(drvc->sr_ctx->libusb_ctx, NULL);
+	download_free(devc);
 
-		if (devc->trigger_fired) {
-			/* Send the incoming transfer to the session bus. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
+	return ret;
+}
 
-			logic.length = samples_count * sizeof(uint32_t);
-			logic.unitsize = sizeof(uint32_t);
-			logic.data = samples;
-			sr_session_send(sdi, &packet);
-		} else {
-			trigger_offset = soft_trigger_logic_check(devc->stl,
-				samples, samples_count * sizeof(uint32_t), NULL);
-			if (trigger_offset > -1) {
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				int num_samples = samples_count - trigger_offset;
-
-				logic.length = num_samples * sizeof(uint32_t);
-				logic.unitsize = sizeof(uint32_t);
-				logic.data = samples + trigger_offset * sizeof(uint32_t);
-				sr_session_send(sdi, &packet);
-
-				devc->trigger_fired = TRUE;
-			}
-		}
+/* Callback polling the capture status */
+static int la_prepare_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_usb_dev_inst *usb;
+	int ret;
+	uint32_t status[3];
 
-		g_free(samples);
-	} while (rle_samples_count == RLE_SAMPLES_COUNT);
+	(void)fd;
+	(void)revents;
 
-	sr_dbg("acquision stop, rle_samples_count < RLE_SAMPLES_COUNT.");
+	sdi = cb_data;
+	usb = sdi->conn;
 
-	sla5032_write_reg14_zero(usb);
+	memset(status, 0, sizeof(status));
+	ret = sla5032_get_status(usb, status);
+	if (ret != SR_OK) {
+		sla5032_write_reg14_zero(usb);
+		sr_dev_acquisition_stop(sdi);
+		return G_SOURCE_CONTINUE;
+	}
 
-	sr_dev_acquisition_stop(sdi); /* if all data transfered */
+	/* data not ready (acquision in progress) */
+	if (status[1] != 3)
+		return G_SOURCE_CONTINUE;
 
-	g_free(rle_buf);
+	sr_dbg("acquision done, status: %u.", (unsigned int)status[2]);
 
-	if (devc->stl) {
-		soft_trigger_logic_free(devc->stl);
-		devc->stl = NULL;
+	/* data ready (download, decode and send to sigrok) */
+	ret = sla5032_set_read_back(usb);
+	if (ret == SR_OK)
+		ret = start_download(sdi);
+	if (ret != SR_OK) {
+		sla5032_write_reg14_zero(usb);
+		sr_dev_acquisition_stop(sdi);
+		return G_SOURCE_CONTINUE;
 	}
 
+	/* The download continues from the USB event source. */
+	sr_session_source_remove(sdi->session, -1);
+
 	return G_SOURCE_CONTINUE;
 }
 
@@ -886,7 +1036,8 @@ SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 	pre = (devc->limit_samples * devc->capture_ratio) / 100;
 	post = devc->limit_samples - pre;
 
-	if ((trigger = sr_session_trigger_get(sdi->session))) {
+	/* The hardware takes the leading stages, see prepare_trigger_masks(). */
+	if ((trigger = devc->soft_trigger)) {
 		devc->stl = soft_trigger_logic_new(sdi, trigger, pre);
 		if (!devc->stl) {
 			sr_err("stl alloc error.");
@@ -905,6 +1056,9 @@ SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi)
 	pre = MAX(pre, 2);
 	pre--;
 
+	/* Only the samples after the hardware trigger can match the rest. */
+	devc->soft_trigger_skip = devc->trigger_mask ? (pre + 1) * 256 : 0;
+
 	post /= 256;
 	post = MAX(post, 2);
 	post--;
@@ -45,6 +45,8 @@ enum {
 	USB_CMD_TIMEOUT_MS	= 5000,
 	USB_REPLY_TIMEOUT_MS	= 500000,
 	USB_DATA_TIMEOUT_MS	= 2000,
+	/* Sample download transfers which are submitted at a time. */
+	NUM_DATA_XFERS		= 4,
 };
 
 /* USB device end points. */
@@ -98,12 +100,25 @@ struct dev_context {
 	uint64_t trigger_edge_mask;	/* trigger type mask */
 	uint64_t trigger_values;	/* trigger level/slope bits */
 
+	/* Trigger stages which the hardware can't match, or NULL. */
+	struct sr_trigger *soft_trigger;
+	/* Samples before the hardware trigger position, not yet checked. */
+	uint64_t soft_trigger_skip;
 	struct soft_trigger_logic *stl;
 	gboolean trigger_fired;
 
 	int active_fpga_config;		/* FPGA configuration index */
 
 	enum protocol_state state;	/* async protocol state */
+
+	/* Sample download, see start_download(). */
+	gboolean downloading;
+	struct libusb_transfer *xfers[NUM_DATA_XFERS];
+	unsigned int xfers_active;
+	gboolean xfers_cancelled;
+	uint64_t chunk_bytes;		/* bytes of the current chunk */
+	gboolean request_chunk;		/* the next chunk is due */
+	gboolean download_done;		/* complete, failed or cancelled */
 };
 
 SR_PRIV int sla5032_start_acquisition(const struct sr_dev_inst *sdi);
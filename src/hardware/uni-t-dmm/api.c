@@ -73,7 +73,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		return NULL;
 
 	devices = NULL;
-	if (!(usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn))) {
+	if (!(usb_devices = sr_usb_find(drvc->sr_ctx, conn))) {
 		g_slist_free_full(usb_devices, g_free);
 		return NULL;
 	}
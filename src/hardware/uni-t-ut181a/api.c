@@ -528,9 +528,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		ret = ut181a_waitfor_response(sdi, 200);
 		if (ret < 0)
 			return ret;
-		devc->info.rec_data.samples_total = devc->wait_state.data_value;
-		devc->info.rec_data.samples_curr = 0;
-		ret = ut181a_send_cmd_get_rec_samples(serial, rec_idx, 0);
+		devc->info.rec_data.rec_idx = rec_idx;
+		sr_datalog_init(&devc->info.rec_data.log,
+			devc->wait_state.data_value, 0, 1);
+		ret = ut181a_request_rec_samples(sdi);
 	} else {
 		sr_err("Unhandled data source %d, programming error?",
 			(int)devc->data_source);
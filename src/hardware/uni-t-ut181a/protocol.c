@@ -1232,6 +1232,26 @@ SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, s
 	return ut181a_send_frame(serial, cmd, sizeof(cmd));
 }
 
+/*
+ * Request the next chunk of a recording's samples. The meter decides
+ * on the chunk size, the offset is the number of received samples.
+ */
+SR_PRIV int ut181a_request_rec_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct ut181a_info *info;
+	uint64_t offset;
+	size_t count;
+
+	devc = sdi->priv;
+	info = &devc->info;
+	if (!sr_datalog_next_request(&info->rec_data.log, &offset, &count))
+		return SR_OK;
+
+	return ut181a_send_cmd_get_rec_samples(sdi->conn,
+		info->rec_data.rec_idx, offset);
+}
+
 /* TODO
  * Construct and transmit "record on/off" command. Requires a caption,
  * an interval, and a duration to start a recording. Recordings can get
@@ -2564,7 +2584,8 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		ret = consume_u8(&info->rec_data.samples_chunk, &payload, &pl_dlen);
 		if (ret != SR_OK)
 			return SR_ERR_DATA;
-		info->rec_data.samples_curr += info->rec_data.samples_chunk;
+		sr_datalog_block_done(&info->rec_data.log,
+			info->rec_data.samples_chunk);
 		while (info->rec_data.samples_chunk--) {
 			/*
 			 * Implementation detail: Consume all received
@@ -2674,12 +2695,11 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			 * reception, because of variable length chunks
 			 * of sample data.
 			 */
-			if (info->rec_data.samples_curr >= info->rec_data.samples_total) {
+			if (sr_datalog_done(&info->rec_data.log)) {
 				ut181a_cond_stop_acquisition(sdi);
 				break;
 			}
-			ret = ut181a_send_cmd_get_rec_samples(serial,
-				info->rec_data.rec_idx, info->rec_data.samples_curr);
+			ret = ut181a_request_rec_samples(sdi);
 			if (ret < 0)
 				ut181a_cond_stop_acquisition(sdi);
 			break;
@@ -2895,6 +2915,17 @@ SR_PRIV int ut181a_handle_events(int fd, int revents, void *cb_data)
 	if (revents & G_IO_IN)
 		(void)ut181a_receive_data(sdi);
 
+	/* Re-request lost chunks of recordings, starting at the gap. */
+	if (sdi->status == SR_ST_ACTIVE &&
+			devc->data_source >= DATA_SOURCE_REC_FIRST &&
+			sr_datalog_timed_out(&devc->info.rec_data.log)) {
+		if (sr_datalog_resume(&devc->info.rec_data.log) != SR_OK ||
+				ut181a_request_rec_samples(sdi) < 0) {
+			sr_err("Download of the recording timed out.");
+			ut181a_cond_stop_acquisition(sdi);
+		}
+	}
+
 	if (sdi->status == SR_ST_STOPPING) {
 		if (devc->data_source == DATA_SOURCE_LIVE) {
 			sdi->status = SR_ST_INACTIVE;
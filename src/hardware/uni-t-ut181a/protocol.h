@@ -353,8 +353,7 @@ struct ut181a_info {
 	} rec_info;
 	struct {
 		size_t rec_idx;
-		size_t samples_total;
-		size_t samples_curr;
+		struct sr_datalog log;
 		uint8_t samples_chunk;
 	} rec_data;
 	struct {
@@ -421,6 +420,7 @@ SR_PRIV int ut181a_send_cmd_get_saved_value(struct sr_serial_dev_inst *serial, s
 SR_PRIV int ut181a_send_cmd_get_recs_count(struct sr_serial_dev_inst *serial);
 SR_PRIV int ut181a_send_cmd_get_rec_info(struct sr_serial_dev_inst *serial, size_t idx);
 SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, size_t idx, size_t off);
+SR_PRIV int ut181a_request_rec_samples(const struct sr_dev_inst *sdi);
 
 SR_PRIV int ut181a_configure_waitfor(struct dev_context *devc,
 	gboolean want_code, enum ut181_cmd_code want_data,
@@ -426,6 +426,12 @@ SR_PRIV int analyzer_read_data(libusb_device_handle *devh, void *buffer,
 	return gl_read_bulk(devh, buffer, size);
 }
 
+SR_PRIV int analyzer_read_request(libusb_device_handle *devh,
+		unsigned int size)
+{
+	return gl_read_bulk_request(devh, size);
+}
+
 SR_PRIV void analyzer_read_stop(libusb_device_handle *devh)
 {
 	analyzer_write_status(devh, 3, STATUS_FLAG_20);
@@ -23,7 +23,6 @@
 #define USB_INTERFACE			0
 #define USB_CONFIGURATION		1
 #define NUM_TRIGGER_STAGES		4
-#define PACKET_SIZE			2048	/* ?? */
 
 //#define ZP_EXPERIMENTAL
 
@@ -434,12 +433,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	unsigned int samples_read;
-	int res;
-	unsigned int packet_num, n;
-	unsigned char *buf;
+	unsigned int n;
 	unsigned int status;
 	unsigned int stop_address;
 	unsigned int now_address;
@@ -451,6 +445,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	unsigned int valid_samples;
 	unsigned int discard;
 	int trigger_now;
+	struct std_download_window window;
 
 	devc = sdi->priv;
 
@@ -497,8 +492,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_OK;
 	}
 
-	buf = g_malloc(PACKET_SIZE);
-
 	/* Check if the trigger is in the samples we are throwing away */
 	trigger_now = now_address == trigger_address ||
 		((now_address + 1) % memory_size) == trigger_address;
@@ -525,93 +518,57 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		now_address = 2;
 	}
 
-	/* If we have more samples than we need, discard them */
-	valid_samples = (stop_address - now_address) % memory_size;
-	if (valid_samples > ramsize_trigger + triggerbar) {
-		discard += valid_samples - (ramsize_trigger + triggerbar);
-		now_address += valid_samples - (ramsize_trigger + triggerbar);
-	}
-
-	sr_info("Need to discard %d samples.", discard);
-
 	/* Calculate how far in the trigger is */
+	valid_samples = (stop_address - now_address) % memory_size;
 	if (trigger_now)
 		trigger_offset = 0;
 	else
 		trigger_offset = (trigger_address - now_address) % memory_size;
 
-	/* Recalculate the number of samples available */
-	valid_samples = (stop_address - now_address) % memory_size;
-
-	/* Send the incoming transfer to the session bus. */
-	samples_read = 0;
-	for (packet_num = 0; packet_num < n / PACKET_SIZE; packet_num++) {
-		unsigned int len;
-		unsigned int buf_offset;
-
-		res = analyzer_read_data(usb->devhdl, buf, PACKET_SIZE);
-		if (res != PACKET_SIZE)
-			sr_warn("Tried to read %d bytes, actually read %d.",
-				PACKET_SIZE, res);
-
-		if (discard >= PACKET_SIZE / 4) {
-			discard -= PACKET_SIZE / 4;
-			continue;
-		}
-
-		len = PACKET_SIZE - discard * 4;
-		buf_offset = discard * 4;
-		discard = 0;
+	/*
+	 * If we have more samples than we need, only keep the range
+	 * around the trigger. The device reads memory sequentially,
+	 * samples before the window get discarded, the readout stops
+	 * at the end of the window.
+	 */
+	std_download_window(&window, valid_samples, trigger_offset,
+		triggerbar, ramsize_trigger);
+	discard += window.first;
 
-		/* Check if we've read all the samples */
-		if (samples_read + len / 4 >= valid_samples)
-			len = (valid_samples - samples_read) * 4;
-		if (!len)
-			break;
+	sr_info("Need to discard %d samples.", discard);
 
-		if (samples_read < trigger_offset &&
-		    samples_read + len / 4 > trigger_offset) {
-			/* Send out samples remaining before trigger */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = (trigger_offset - samples_read) * 4;
-			logic.unitsize = 4;
-			logic.data = buf + buf_offset;
-			sr_session_send(sdi, &packet);
-			len -= logic.length;
-			samples_read += logic.length / 4;
-			buf_offset += logic.length;
-		}
+	devc->discard = discard;
+	devc->valid_samples = window.count;
+	devc->trigger_offset = window.trigger;
 
-		if (samples_read == trigger_offset)
-			std_session_send_df_trigger(sdi);
-
-		/* Send out data (or data after trigger) */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = len;
-		logic.unitsize = 4;
-		logic.data = buf + buf_offset;
-		sr_session_send(sdi, &packet);
-		samples_read += len / 4;
+	/* The transfers' completion sends the end of the capture. */
+	if (zp_readout_start(sdi) != SR_OK) {
+		sr_err("Failed to start the sample memory readout.");
+		analyzer_read_stop(usb->devhdl);
+		std_session_send_df_end(sdi);
+		return SR_ERR;
 	}
-	analyzer_read_stop(usb->devhdl);
-	g_free(buf);
-
-	std_session_send_df_end(sdi);
 
 	return SR_OK;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 
+	devc = sdi->priv;
+
+	/* Resetting the device is deferred until all transfers are gone. */
+	if (devc->num_transfers) {
+		zp_readout_abort(sdi);
+		return SR_OK;
+	}
+
 	std_session_send_df_end(sdi);
 
 	usb = sdi->conn;
 	analyzer_reset(usb->devhdl);
-	/* TODO: Need to cancel and free any queued up transfers. */
 
 	return SR_OK;
 }
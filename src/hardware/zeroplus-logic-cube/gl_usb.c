@@ -41,8 +41,6 @@
 			 LIBUSB_RECIPIENT_INTERFACE)
 #define CTRL_OUT	(LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_ENDPOINT_OUT | \
 			 LIBUSB_RECIPIENT_INTERFACE)
-#define EP1_BULK_IN	(LIBUSB_ENDPOINT_IN | 1)
-
 #define TIMEOUT_MS	(5 * 1000)
 
 enum {
@@ -89,20 +87,33 @@ static int gl_read_data(libusb_device_handle *devh)
 	return (ret == 1) ? packet[0] : ret;
 }
 
-SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
+/*
+ * Announce how many bytes the following bulk IN reads of EP1 will
+ * fetch. They can be spread across several bulk transfers.
+ */
+SR_PRIV int gl_read_bulk_request(libusb_device_handle *devh,
 			 unsigned int size)
 {
 	unsigned char packet[8] = {
 		0, 0, 0, 0, size & 0xff, (size & 0xff00) >> 8,
 		(size & 0xff0000) >> 16, (size & 0xff000000) >> 24
 	};
-	int ret, transferred = 0;
+	int ret;
 
 	ret = libusb_control_transfer(devh, CTRL_OUT, 0x4, REQ_READBULK,
 				      0, packet, 8, TIMEOUT_MS);
 	if (ret != 8)
 		sr_err("%s: libusb_control_transfer: %s.", __func__,
 		       libusb_error_name(ret));
+	return ret;
+}
+
+SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
+			 unsigned int size)
+{
+	int ret, transferred = 0;
+
+	gl_read_bulk_request(devh, size);
 
 	ret = libusb_bulk_transfer(devh, EP1_BULK_IN, buffer, size,
 				   &transferred, TIMEOUT_MS);
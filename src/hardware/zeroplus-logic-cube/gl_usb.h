@@ -35,6 +35,10 @@
 #include <libusb.h>
 #include <libsigrok/libsigrok.h>
 
+#define EP1_BULK_IN	(LIBUSB_ENDPOINT_IN | 1)
+
+SR_PRIV int gl_read_bulk_request(libusb_device_handle *devh,
+			 unsigned int size);
 SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
 			 unsigned int size);
 SR_PRIV int gl_reg_write(libusb_device_handle *devh, unsigned int reg,
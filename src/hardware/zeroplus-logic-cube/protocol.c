@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <math.h>
+#include "gl_usb.h"
 #include "protocol.h"
 
 SR_PRIV unsigned int get_memory_size(int type)
@@ -124,3 +125,237 @@ SR_PRIV void set_triggerbar(struct dev_context *devc)
 	sr_dbg("ramsize_triggerbar_address = %d(0x%x)",
 	       ramsize_trigger, ramsize_trigger);
 }
+
+static void send_samples(const struct sr_dev_inst *sdi,
+	uint8_t *buf, unsigned int len)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	devc = sdi->priv;
+
+	/* Skip bogus and surplus samples at the start of the memory. */
+	if (devc->discard) {
+		unsigned int skip = MIN(devc->discard, len / 4);
+		devc->discard -= skip;
+		buf += skip * 4;
+		len -= skip * 4;
+	}
+
+	/* Check if we've read all the samples */
+	if (devc->samples_read + len / 4 >= devc->valid_samples)
+		len = (devc->valid_samples - devc->samples_read) * 4;
+	if (!len)
+		return;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 4;
+
+	if (devc->samples_read < devc->trigger_offset &&
+	    devc->samples_read + len / 4 > devc->trigger_offset) {
+		/* Send out samples remaining before trigger */
+		logic.length = (devc->trigger_offset - devc->samples_read) * 4;
+		logic.data = buf;
+		sr_session_send(sdi, &packet);
+		len -= logic.length;
+		devc->samples_read += logic.length / 4;
+		buf += logic.length;
+	}
+
+	if (devc->samples_read == devc->trigger_offset)
+		std_session_send_df_trigger(sdi);
+
+	/* Send out data (or data after trigger) */
+	logic.length = len;
+	logic.data = buf;
+	sr_session_send(sdi, &packet);
+	devc->samples_read += len / 4;
+}
+
+static int submit_transfer(struct dev_context *devc,
+	struct libusb_transfer *transfer)
+{
+	int ret;
+
+	transfer->length = MIN(TRANSFER_SIZE,
+		devc->bytes_total - devc->bytes_submitted);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+			libusb_error_name(ret));
+		return SR_ERR;
+	}
+	devc->bytes_submitted += transfer->length;
+
+	return SR_OK;
+}
+
+static void cancel_transfers(struct dev_context *devc)
+{
+	unsigned int i;
+
+	for (i = 0; i < NUM_TRANSFERS; i++) {
+		if (devc->transfers[i])
+			libusb_cancel_transfer(devc->transfers[i]);
+	}
+}
+
+static void free_transfer(struct dev_context *devc,
+	struct libusb_transfer *transfer)
+{
+	unsigned int i;
+
+	for (i = 0; i < NUM_TRANSFERS; i++) {
+		if (devc->transfers[i] == transfer) {
+			devc->transfers[i] = NULL;
+			break;
+		}
+	}
+	g_free(transfer->buffer);
+	libusb_free_transfer(transfer);
+	devc->num_transfers--;
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	if (!devc->readout_done) {
+		if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+			if (transfer->actual_length != transfer->length)
+				sr_warn("Tried to read %d bytes, actually read %d.",
+					transfer->length, transfer->actual_length);
+			send_samples(sdi, transfer->buffer,
+				transfer->actual_length);
+		} else {
+			sr_err("Bulk transfer failed: %s.",
+				libusb_error_name(transfer->status));
+			devc->readout_done = TRUE;
+		}
+		if (devc->samples_read >= devc->valid_samples)
+			devc->readout_done = TRUE;
+	}
+
+	/* Keep the transfer in flight while there is memory left to read. */
+	if (!devc->readout_done &&
+	    devc->bytes_submitted < devc->bytes_total &&
+	    submit_transfer(devc, transfer) == SR_OK)
+		return;
+
+	free_transfer(devc, transfer);
+	if (devc->readout_done)
+		cancel_transfers(devc);
+}
+
+static int receive_data(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct sr_dev_driver *di;
+	struct drv_context *drvc;
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct timeval tv;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	di = sdi->driver;
+	drvc = di->context;
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
+		&tv, NULL);
+
+	if (devc->num_transfers)
+		return TRUE;
+
+	/*
+	 * All transfers have completed or got cancelled. The device
+	 * register accesses are synchronous, they must not run from
+	 * within the transfer callbacks.
+	 */
+	usb_source_remove(sdi->session, drvc->sr_ctx);
+	analyzer_read_stop(usb->devhdl);
+	if (devc->readout_aborted)
+		analyzer_reset(usb->devhdl);
+	std_session_send_df_end(sdi);
+
+	return TRUE;
+}
+
+/*
+ * Read the sample memory with several bulk transfers in flight. The
+ * caller has set up the discard count, the number of valid samples and
+ * the trigger position. A single read request covers all the memory
+ * which is needed, the transfers' data gets processed in the order of
+ * their submission from the session's main loop.
+ */
+SR_PRIV int zp_readout_start(const struct sr_dev_inst *sdi)
+{
+	struct drv_context *drvc;
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned int i, memory_bytes, needed;
+
+	drvc = sdi->driver->context;
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	memory_bytes = get_memory_size(devc->memory_size);
+	memory_bytes -= memory_bytes % PACKET_SIZE;
+	needed = (devc->discard + devc->valid_samples) * 4;
+	needed = ((needed + PACKET_SIZE - 1) / PACKET_SIZE) * PACKET_SIZE;
+	devc->bytes_total = MIN(needed, memory_bytes);
+	devc->bytes_submitted = 0;
+	devc->samples_read = 0;
+	devc->num_transfers = 0;
+	devc->readout_done = FALSE;
+	devc->readout_aborted = FALSE;
+
+	if (analyzer_read_request(usb->devhdl, devc->bytes_total) < 0)
+		return SR_ERR_IO;
+
+	for (i = 0; i < NUM_TRANSFERS; i++) {
+		if (devc->bytes_submitted >= devc->bytes_total)
+			break;
+		transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(transfer, usb->devhdl, EP1_BULK_IN,
+			g_malloc(TRANSFER_SIZE), TRANSFER_SIZE,
+			receive_transfer, (void *)sdi, TRANSFER_TIMEOUT_MS);
+		if (submit_transfer(devc, transfer) != SR_OK) {
+			g_free(transfer->buffer);
+			libusb_free_transfer(transfer);
+			break;
+		}
+		devc->transfers[i] = transfer;
+		devc->num_transfers++;
+	}
+
+	if (!devc->num_transfers)
+		return SR_ERR_IO;
+
+	usb_source_add(sdi->session, drvc->sr_ctx, 100,
+		receive_data, (void *)sdi);
+
+	return SR_OK;
+}
+
+SR_PRIV void zp_readout_abort(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	devc->readout_done = TRUE;
+	devc->readout_aborted = TRUE;
+	cancel_transfers(devc);
+}
@@ -30,6 +30,13 @@
 
 #define LOG_PREFIX "zeroplus-logic-cube"
 
+#define PACKET_SIZE		2048	/* ?? */
+
+/* Bulk IN transfers kept in flight during the sample memory readout. */
+#define NUM_TRANSFERS		4
+#define TRANSFER_SIZE		(16 * PACKET_SIZE)
+#define TRANSFER_TIMEOUT_MS	(5 * 1000)
+
 struct dev_context {
 	uint64_t cur_samplerate;
 	uint64_t max_samplerate;
@@ -45,6 +52,18 @@ struct dev_context {
 	uint64_t capture_ratio;
 	double cur_threshold;
 	const struct zp_model *prof;
+
+	/* Sample memory readout (async bulk transfers). */
+	struct libusb_transfer *transfers[NUM_TRANSFERS];
+	unsigned int num_transfers;
+	unsigned int bytes_submitted;
+	unsigned int bytes_total;
+	unsigned int discard;
+	unsigned int valid_samples;
+	unsigned int samples_read;
+	uint64_t trigger_offset;
+	gboolean readout_done;
+	gboolean readout_aborted;
 };
 
 SR_PRIV unsigned int get_memory_size(int type);
@@ -52,5 +71,7 @@ SR_PRIV int zp_set_samplerate(struct dev_context *devc, uint64_t samplerate);
 SR_PRIV int set_limit_samples(struct dev_context *devc, uint64_t samples);
 SR_PRIV int set_voltage_threshold(struct dev_context *devc, double thresh);
 SR_PRIV void set_triggerbar(struct dev_context *devc);
+SR_PRIV int zp_readout_start(const struct sr_dev_inst *sdi);
+SR_PRIV void zp_readout_abort(const struct sr_dev_inst *sdi);
 
 #endif
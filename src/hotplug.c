@@ -0,0 +1,392 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Discovery of devices as they get plugged in and out.
+ *
+ * libusb reports arriving and leaving USB devices. Each arrival gets
+ * scanned for by the USB drivers, with the SR_CONF_CONN option pointing
+ * them at just that device. Drivers which talk to serial ports (they take
+ * the SR_CONF_SERIALCOMM option) don't take part, as a USB device tells
+ * nothing about which of them would find something behind it.
+ *
+ * libusb calls back from within its event handling, where drivers must
+ * not open devices. Events get queued, and get handled in the main
+ * context after a short delay, which gives the operating system time to
+ * set up the device node.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "hotplug"
+/** @endcond */
+
+/**
+ * @defgroup grp_hotplug Hotplug
+ *
+ * Discovery of devices as they get plugged in and out.
+ *
+ * @{
+ */
+
+#ifdef HAVE_LIBUSB_1_0
+
+/* Time which arriving devices get to settle before scanning them. */
+#define HOTPLUG_SETTLE_MS 250
+
+struct hotplug_event {
+	libusb_device *dev;
+	gboolean arrived;
+};
+
+struct sr_hotplug {
+	struct sr_context *ctx;
+	sr_hotplug_callback cb;
+	void *cb_data;
+	GMainContext *main_ctx;
+	GSource *usb_source;
+	libusb_hotplug_callback_handle handle;
+	/* Queued by libusb's callback, protected by the mutex. */
+	GMutex mutex;
+	GSList *events;
+	GSource *timer;
+	/* The devices which were reported as arrived. */
+	GSList *devices;
+};
+
+static gboolean usb_events(int fd, int revents, void *cb_data)
+{
+	struct sr_hotplug *hotplug;
+	struct timeval tv;
+
+	(void)fd;
+	(void)revents;
+
+	hotplug = cb_data;
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(hotplug->ctx->libusb_ctx,
+		&tv, NULL);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Whether a driver finds USB devices, and can be pointed at one. */
+static gboolean is_usb_driver(struct sr_dev_driver *driver)
+{
+	GArray *opts;
+	gboolean has_conn, has_serialcomm;
+	uint32_t key;
+	guint i;
+
+	if (!(opts = sr_driver_scan_options_list(driver)))
+		return FALSE;
+	has_conn = has_serialcomm = FALSE;
+	for (i = 0; i < opts->len; i++) {
+		key = g_array_index(opts, uint32_t, i);
+		if (key == SR_CONF_CONN)
+			has_conn = TRUE;
+		else if (key == SR_CONF_SERIALCOMM)
+			has_serialcomm = TRUE;
+	}
+	g_array_free(opts, TRUE);
+
+	return has_conn && !has_serialcomm;
+}
+
+static gboolean is_usb_dev(struct sr_dev_inst *sdi, uint8_t bus,
+		uint8_t address)
+{
+	struct sr_usb_dev_inst *usb;
+
+	if (sdi->inst_type != SR_INST_USB || !(usb = sdi->conn))
+		return FALSE;
+
+	return usb->bus == bus && usb->address == address;
+}
+
+static void device_arrived(struct sr_hotplug *hotplug, libusb_device *dev)
+{
+	struct sr_dev_driver **drivers;
+	struct sr_dev_inst *sdi;
+	struct sr_usb_dev_inst *usb;
+	struct sr_config *src;
+	GSList *options, *devices, *l;
+	char *conn;
+	int i;
+
+	conn = g_strdup_printf("%d.%d", libusb_get_bus_number(dev),
+		libusb_get_device_address(dev));
+	sr_dbg("USB device %s arrived.", conn);
+	src = sr_config_new(SR_CONF_CONN, g_variant_new_string(conn));
+	options = g_slist_append(NULL, src);
+
+	sr_usb_scan_begin(hotplug->ctx);
+	drivers = sr_driver_list(hotplug->ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!drivers[i]->context || !is_usb_driver(drivers[i]))
+			continue;
+		devices = sr_driver_scan(drivers[i], options);
+		for (l = devices; l; l = l->next) {
+			sdi = l->data;
+			/*
+			 * A device which just got its firmware will show
+			 * up again under a new address, and gets reported
+			 * then.
+			 */
+			usb = sdi->conn;
+			if (sdi->inst_type == SR_INST_USB && usb
+					&& usb->address == 0xff)
+				continue;
+			hotplug->devices = g_slist_append(hotplug->devices, sdi);
+			hotplug->cb(sdi, TRUE, hotplug->cb_data);
+		}
+		g_slist_free(devices);
+	}
+	sr_usb_scan_end(hotplug->ctx);
+
+	g_slist_free_full(options, (GDestroyNotify)sr_config_free);
+	g_free(conn);
+}
+
+static void device_left(struct sr_hotplug *hotplug, libusb_device *dev)
+{
+	struct sr_dev_inst *sdi;
+	GSList *l, *next;
+	uint8_t bus, address;
+
+	bus = libusb_get_bus_number(dev);
+	address = libusb_get_device_address(dev);
+	sr_dbg("USB device %d.%d left.", bus, address);
+
+	for (l = hotplug->devices; l; l = next) {
+		next = l->next;
+		sdi = l->data;
+		if (!is_usb_dev(sdi, bus, address))
+			continue;
+		hotplug->devices = g_slist_delete_link(hotplug->devices, l);
+		hotplug->cb(sdi, FALSE, hotplug->cb_data);
+	}
+}
+
+static gboolean handle_events(void *cb_data)
+{
+	struct sr_hotplug *hotplug;
+	struct hotplug_event *event;
+	GSList *events, *l;
+
+	hotplug = cb_data;
+
+	g_mutex_lock(&hotplug->mutex);
+	events = hotplug->events;
+	hotplug->events = NULL;
+	g_source_unref(hotplug->timer);
+	hotplug->timer = NULL;
+	g_mutex_unlock(&hotplug->mutex);
+
+	for (l = events; l; l = l->next) {
+		event = l->data;
+		if (event->arrived)
+			device_arrived(hotplug, event->dev);
+		else
+			device_left(hotplug, event->dev);
+		libusb_unref_device(event->dev);
+		g_free(event);
+	}
+	g_slist_free(events);
+
+	return G_SOURCE_REMOVE;
+}
+
+static int LIBUSB_CALL hotplug_event(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event type, void *user_data)
+{
+	struct sr_hotplug *hotplug;
+	struct hotplug_event *event;
+
+	(void)usb_ctx;
+
+	hotplug = user_data;
+	event = g_malloc0(sizeof(*event));
+	event->dev = libusb_ref_device(dev);
+	event->arrived = type == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED;
+
+	g_mutex_lock(&hotplug->mutex);
+	hotplug->events = g_slist_append(hotplug->events, event);
+	if (!hotplug->timer) {
+		hotplug->timer = g_timeout_source_new(HOTPLUG_SETTLE_MS);
+		g_source_set_callback(hotplug->timer, handle_events,
+			hotplug, NULL);
+		g_source_attach(hotplug->timer, hotplug->main_ctx);
+	}
+	g_mutex_unlock(&hotplug->mutex);
+
+	return 0;
+}
+
+static void free_event(void *data)
+{
+	struct hotplug_event *event;
+
+	event = data;
+	libusb_unref_device(event->dev);
+	g_free(event);
+}
+
+#endif
+
+/**
+ * Start reporting devices as they get plugged in and out.
+ *
+ * The drivers which are initialized at this time scan for devices which
+ * arrive later. @a cb runs in @a main_ctx for each device which one of
+ * the drivers found, and once more when the device leaves. Like the
+ * results of sr_driver_scan(), the devices belong to their drivers.
+ * After a device left, it remains valid until its driver gets cleared.
+ *
+ * Devices which are connected already don't get reported, use
+ * sr_driver_scan_all() for those.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param main_ctx The GLib main context to handle events in, NULL for
+ *                 the default.
+ * @param cb Function to call for arriving and leaving devices. Must not
+ *           be NULL.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or reporting was started already.
+ * @retval SR_ERR_NA The platform doesn't report USB devices coming and
+ *                   going.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_start(struct sr_context *ctx, GMainContext *main_ctx,
+		sr_hotplug_callback cb, void *cb_data)
+{
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_hotplug *hotplug;
+	int ret;
+
+	if (!ctx || !cb || ctx->hotplug)
+		return SR_ERR_ARG;
+
+	if ((ret = sr_init_io_backends(ctx)) != SR_OK)
+		return ret;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		sr_err("libusb doesn't support hotplug on this platform.");
+		return SR_ERR_NA;
+	}
+
+	hotplug = g_malloc0(sizeof(*hotplug));
+	hotplug->ctx = ctx;
+	hotplug->cb = cb;
+	hotplug->cb_data = cb_data;
+	hotplug->main_ctx = main_ctx;
+	g_mutex_init(&hotplug->mutex);
+
+	ret = libusb_hotplug_register_callback(ctx->libusb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+		LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, hotplug_event, hotplug,
+		&hotplug->handle);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Cannot register hotplug callback: %s.",
+			libusb_error_name(ret));
+		g_mutex_clear(&hotplug->mutex);
+		g_free(hotplug);
+		return SR_ERR;
+	}
+
+	hotplug->usb_source = usb_source_attach(ctx, main_ctx, usb_events,
+		hotplug);
+	if (!hotplug->usb_source) {
+		libusb_hotplug_deregister_callback(ctx->libusb_ctx,
+			hotplug->handle);
+		g_mutex_clear(&hotplug->mutex);
+		g_free(hotplug);
+		return SR_ERR;
+	}
+	ctx->hotplug = hotplug;
+
+	return SR_OK;
+#else
+	(void)main_ctx;
+	(void)cb;
+	(void)cb_data;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Stop reporting devices as they get plugged in and out.
+ *
+ * Must be called from the thread which runs the main context which was
+ * passed to sr_hotplug_start(), or while that main context doesn't run.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or reporting was not started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_stop(struct sr_context *ctx)
+{
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_hotplug *hotplug;
+
+	if (!ctx || !(hotplug = ctx->hotplug))
+		return SR_ERR_ARG;
+
+	libusb_hotplug_deregister_callback(ctx->libusb_ctx, hotplug->handle);
+	g_source_destroy(hotplug->usb_source);
+	g_source_unref(hotplug->usb_source);
+	if (hotplug->timer) {
+		g_source_destroy(hotplug->timer);
+		g_source_unref(hotplug->timer);
+	}
+	g_slist_free_full(hotplug->events, free_event);
+	g_slist_free(hotplug->devices);
+	g_mutex_clear(&hotplug->mutex);
+	g_free(hotplug);
+	ctx->hotplug = NULL;
+
+	return SR_OK;
+#else
+	(void)ctx;
+
+	return SR_ERR_ARG;
+#endif
+}
+
+/** @} */
@@ -26,6 +26,7 @@
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "scpi.h"
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "hwdriver"
@@ -230,6 +231,18 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_LATENCY_TARGET, SR_T_UINT64, "latency_target",
+		"Latency target", NULL},
+	{SR_CONF_UNDERRUN_COUNT, SR_T_UINT64, "underrun_count",
+		"Underrun count", NULL},
+	{SR_CONF_MAX_THROUGHPUT, SR_T_BOOL, "max_throughput",
+		"Maximum throughput", NULL},
+	{SR_CONF_REPLAY_SPEED, SR_T_FLOAT, "replay_speed",
+		"Replay speed", NULL},
+	{SR_CONF_REPLAY_LOOP, SR_T_BOOL, "replay_loop",
+		"Replay loop", NULL},
+	{SR_CONF_FRAME_TIMESTAMP, SR_T_FLOAT, "frame_timestamp",
+		"Frame timestamp", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -321,6 +334,7 @@ static struct sr_key_info sr_key_info_mqflag[] = {
 	{SR_MQFLAG_REFERENCE, 0, "reference", "Reference", NULL},
 	{SR_MQFLAG_UNSTABLE, 0, "unstable", "Unstable", NULL},
 	{SR_MQFLAG_FOUR_WIRE, 0, "four_wire", "4-Wire", NULL},
+	{SR_MQFLAG_SPECTRUM, 0, "spectrum", "Spectrum", NULL},
 	ALL_ZERO
 };
 
@@ -436,6 +450,9 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 
 	/* No log message here, too verbose and not very useful. */
 
+	if ((ret = sr_init_io_backends(ctx)) != SR_OK)
+		return ret;
+
 	if ((ret = driver->init(driver, ctx)) < 0)
 		sr_err("Failed to initialize the driver: %d.", ret);
 
@@ -550,6 +567,8 @@ static int check_options(struct sr_dev_driver *driver, GSList *options,
  */
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 {
+	struct drv_context *drvc;
+	struct sr_profile_scope scope;
 	GSList *l;
 
 	if (!driver) {
@@ -567,13 +586,239 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 			return NULL;
 	}
 
+	drvc = driver->context;
+	sr_profile_begin(&scope, drvc->sr_ctx, SR_PROFILE_SCAN, driver, NULL);
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_begin(drvc->sr_ctx);
+#endif
 	l = driver->scan(driver, options);
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_end(drvc->sr_ctx);
+#endif
+	sr_profile_end(&scope, SR_OK);
 
 	sr_spew("Scan found %d devices (%s).", g_slist_length(l), driver->name);
 
 	return l;
 }
 
+/** @cond PRIVATE */
+/* Default number of concurrent scans for sr_driver_scan_all(). */
+#define SCAN_ALL_THREADS 8
+/** @endcond */
+
+/* Drivers which probe the same bus, and get scanned one after another. */
+struct scan_group {
+	GSList *drivers;
+	GSList *options;
+	GAsyncQueue *results;
+};
+
+struct scan_result {
+	struct sr_dev_driver *driver;
+	GSList *devices;
+};
+
+/* The subset of the options which the driver accepts for scanning. */
+static GSList *scan_options_for(struct sr_dev_driver *driver, GSList *options)
+{
+	GArray *opts;
+	GSList *l, *result;
+	struct sr_config *src;
+	guint i;
+
+	if (!options || !(opts = sr_driver_scan_options_list(driver)))
+		return NULL;
+
+	result = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		for (i = 0; i < opts->len; i++) {
+			if (g_array_index(opts, uint32_t, i) == src->key) {
+				result = g_slist_append(result, src);
+				break;
+			}
+		}
+	}
+	g_array_free(opts, TRUE);
+
+	return result;
+}
+
+/*
+ * Get the name of the bus which a driver's scan probes, NULL when the
+ * scan can run alongside any other. Drivers which get pointed at the
+ * same connection share it, as do serial drivers which look for ports
+ * on their own.
+ */
+static const char *scan_bus_key(struct sr_dev_driver *driver,
+		GSList *driver_options)
+{
+	GArray *opts;
+	GSList *l;
+	struct sr_config *src;
+	const char *key;
+	guint i;
+
+	for (l = driver_options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			return g_variant_get_string(src->data, NULL);
+	}
+
+	if (!(opts = sr_driver_scan_options_list(driver)))
+		return NULL;
+	key = NULL;
+	for (i = 0; i < opts->len; i++) {
+		if (g_array_index(opts, uint32_t, i) == SR_CONF_SERIALCOMM)
+			key = "serial";
+	}
+	g_array_free(opts, TRUE);
+
+	return key;
+}
+
+static void scan_group_run(gpointer data, gpointer user_data)
+{
+	struct scan_group *group;
+	struct scan_result *result;
+	struct sr_dev_driver *driver;
+	GSList *l, *driver_options;
+
+	(void)user_data;
+
+	group = data;
+	for (l = group->drivers; l; l = l->next) {
+		driver = l->data;
+		driver_options = scan_options_for(driver, group->options);
+		result = g_malloc0(sizeof(*result));
+		result->driver = driver;
+		result->devices = sr_driver_scan(driver, driver_options);
+		g_slist_free(driver_options);
+		g_async_queue_push(group->results, result);
+	}
+	/* An empty result marks the end of the group. */
+	g_async_queue_push(group->results, g_malloc0(sizeof(*result)));
+}
+
+/**
+ * Scan for devices with all drivers, several of them at a time.
+ *
+ * Drivers which are not initialized yet get initialized first. Each
+ * driver gets those of @a options which it supports as scan options.
+ * Scans run on a pool of worker threads, so drivers which wait for
+ * timeouts don't hold up the others. Drivers which probe the same
+ * connection (the SR_CONF_CONN option), and serial drivers which look
+ * for ports on their own, get scanned one after another.
+ *
+ * @a cb runs in the calling thread for every driver which found devices,
+ * as soon as the driver's scan completed. It takes over the list of
+ * devices, which must be freed with g_slist_free() like the result of
+ * sr_driver_scan(). This routine returns when all scans completed.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param options A list of 'struct sr_config' scan options. Can be NULL.
+ * @param max_threads Maximum number of concurrent scans, 0 for a default.
+ * @param cb Function to call with the devices that were found.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Cannot start the worker threads.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_driver_scan_all(struct sr_context *ctx, GSList *options,
+		unsigned int max_threads, sr_driver_scan_callback cb,
+		void *cb_data)
+{
+	struct sr_dev_driver **drivers, *driver;
+	GHashTable *bus_groups;
+	GSList *groups, *driver_options, *l;
+	GAsyncQueue *results;
+	GThreadPool *pool;
+	GError *error;
+	struct scan_group *group;
+	struct scan_result *result;
+	const char *key;
+	guint pending;
+	int i;
+
+	if (!ctx || !cb)
+		return SR_ERR_ARG;
+	if (!max_threads)
+		max_threads = SCAN_ALL_THREADS;
+
+	/* Arrange the drivers in groups which must not run concurrently. */
+	results = g_async_queue_new();
+	bus_groups = g_hash_table_new(g_str_hash, g_str_equal);
+	groups = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		driver = drivers[i];
+		if (!driver->context && sr_driver_init(ctx, driver) != SR_OK)
+			continue;
+		driver_options = scan_options_for(driver, options);
+		key = scan_bus_key(driver, driver_options);
+		g_slist_free(driver_options);
+		group = key ? g_hash_table_lookup(bus_groups, key) : NULL;
+		if (!group) {
+			group = g_malloc0(sizeof(*group));
+			group->options = options;
+			group->results = results;
+			groups = g_slist_append(groups, group);
+			if (key)
+				g_hash_table_insert(bus_groups, (gpointer)key, group);
+		}
+		group->drivers = g_slist_append(group->drivers, driver);
+	}
+	g_hash_table_destroy(bus_groups);
+
+	error = NULL;
+	pool = g_thread_pool_new(scan_group_run, NULL, max_threads, FALSE,
+		&error);
+	if (!pool) {
+		sr_err("Cannot create scan threads: %s.", error->message);
+		g_error_free(error);
+		g_slist_free_full(groups, g_free);
+		g_async_queue_unref(results);
+		return SR_ERR;
+	}
+	/* Let the drivers share what they find on the USB. */
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_begin(ctx);
+#endif
+	pending = 0;
+	for (l = groups; l; l = l->next) {
+		g_thread_pool_push(pool, l->data, NULL);
+		pending++;
+	}
+
+	/* Report the results as they come in. */
+	while (pending) {
+		result = g_async_queue_pop(results);
+		if (!result->driver)
+			pending--;
+		else if (result->devices)
+			cb(result->driver, result->devices, cb_data);
+		g_free(result);
+	}
+
+	g_thread_pool_free(pool, FALSE, TRUE);
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_end(ctx);
+#endif
+	for (l = groups; l; l = l->next) {
+		group = l->data;
+		g_slist_free(group->drivers);
+	}
+	g_slist_free_full(groups, g_free);
+	g_async_queue_unref(results);
+
+	return SR_OK;
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
@@ -642,6 +887,9 @@ SR_PRIV void sr_config_free(struct sr_config *src)
 /** @private */
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 {
+	struct sr_profile_scope scope;
+	int ret;
+
 	if (!sdi || !sdi->driver) {
 		sr_err("%s: Invalid arguments.", __func__);
 		return SR_ERR_ARG;
@@ -655,7 +903,38 @@ SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Starting acquisition.", sdi->driver->name);
 
-	return sdi->driver->dev_acquisition_start(sdi);
+	/* Drivers re-read their settings from the device here. */
+	sr_config_cache_invalidate(sdi, FALSE);
+
+	sr_profile_begin(&scope, NULL, SR_PROFILE_ACQUISITION_START, NULL, sdi);
+	ret = sdi->driver->dev_acquisition_start(sdi);
+	sr_profile_end(&scope, ret);
+	sdi->armed = ret == SR_OK;
+
+	return ret;
+}
+
+/**
+ * Check whether an acquisition start may skip programming the device.
+ *
+ * This is the case when the session gets started by sr_session_rearm(),
+ * and neither the device's config, its channels nor the session's
+ * trigger changed since the device last started acquisition. Drivers
+ * can then keep the device's sampling and trigger setup as it is.
+ *
+ * @param sdi The device instance.
+ *
+ * @retval TRUE The device is still set up for the last acquisition.
+ * @retval FALSE The device needs to get programmed.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_dev_acquisition_rearmed(const struct sr_dev_inst *sdi)
+{
+	if (!sdi || !sdi->session)
+		return FALSE;
+
+	return sdi->session->rearming && sdi->armed;
 }
 
 /** @private */
@@ -701,7 +980,7 @@ static void log_key(const struct sr_dev_inst *sdi,
 
 static int check_key(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
-		uint32_t key, unsigned int op, GVariant *data)
+		uint32_t key, unsigned int op, GVariant *data, uint32_t *caps)
 {
 	const struct sr_key_info *srci;
 	gsize num_opts, i;
@@ -771,6 +1050,140 @@ static int check_key(const struct sr_dev_driver *driver,
 		return SR_ERR_ARG;
 	}
 
+	if (caps)
+		*caps = pub_opt & ~SR_CONF_MASK;
+
+	return SR_OK;
+}
+
+struct config_cache_entry {
+	const struct sr_channel_group *cg;
+	uint32_t key;
+	uint32_t caps;
+	GVariant *data;
+};
+
+static guint config_cache_hash(gconstpointer p)
+{
+	const struct config_cache_entry *entry;
+
+	entry = p;
+
+	return g_direct_hash(entry->cg) ^ entry->key;
+}
+
+static gboolean config_cache_equal(gconstpointer a, gconstpointer b)
+{
+	const struct config_cache_entry *ea, *eb;
+
+	ea = a;
+	eb = b;
+
+	return ea->cg == eb->cg && ea->key == eb->key;
+}
+
+static void config_cache_free(gpointer p)
+{
+	struct config_cache_entry *entry;
+
+	entry = p;
+	g_variant_unref(entry->data);
+	g_free(entry);
+}
+
+static GVariant *config_cache_lookup(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key)
+{
+	struct config_cache_entry needle, *entry;
+
+	if (!sdi->config_cache)
+		return NULL;
+
+	needle.cg = cg;
+	needle.key = key;
+	entry = g_hash_table_lookup(sdi->config_cache, &needle);
+
+	return entry ? entry->data : NULL;
+}
+
+static void config_cache_store(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, uint32_t caps,
+		GVariant *data)
+{
+	struct sr_dev_inst *dev;
+	struct config_cache_entry *entry;
+
+	dev = (struct sr_dev_inst *)sdi;
+	if (!dev->config_cache)
+		dev->config_cache = g_hash_table_new_full(config_cache_hash,
+			config_cache_equal, NULL, config_cache_free);
+
+	entry = g_malloc(sizeof(*entry));
+	entry->cg = cg;
+	entry->key = key;
+	entry->caps = caps;
+	entry->data = g_variant_ref(data);
+	g_hash_table_add(dev->config_cache, entry);
+}
+
+static gboolean config_cache_is_on_set(gpointer key, gpointer value,
+		gpointer user_data)
+{
+	const struct config_cache_entry *entry;
+
+	(void)value;
+	(void)user_data;
+
+	entry = key;
+
+	return !!(entry->caps & SR_CONF_CACHE_ON_SET);
+}
+
+/**
+ * Drop cached config values of a device instance.
+ *
+ * @param sdi The device instance.
+ * @param all TRUE to drop all values, FALSE to only drop values which
+ *            change when config keys get set (SR_CONF_CACHE_ON_SET).
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi,
+		gboolean all)
+{
+	if (!sdi || !sdi->config_cache)
+		return;
+
+	if (all)
+		g_hash_table_remove_all(sdi->config_cache);
+	else
+		g_hash_table_foreach_remove(sdi->config_cache,
+			config_cache_is_on_set, NULL);
+}
+
+/**
+ * Drop all cached config values of a device instance.
+ *
+ * Drivers can declare config keys whose values only change when the
+ * device gets opened, or when settings get changed through libsigrok.
+ * sr_config_get() keeps such values instead of asking the driver again.
+ * Applications can call this function when they know that the device's
+ * settings were changed by other means, e.g. at its front panel.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_cache_flush(const struct sr_dev_inst *sdi)
+{
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	sr_config_cache_invalidate(sdi, TRUE);
+
 	return SR_OK;
 }
 
@@ -804,6 +1217,8 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant **data)
 {
+	GVariant *cached;
+	uint32_t caps;
 	int ret;
 
 	if (!driver || !data)
@@ -812,7 +1227,8 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 	if (!driver->config_get)
 		return SR_ERR_ARG;
 
-	if (check_key(driver, sdi, cg, key, SR_CONF_GET, NULL) != SR_OK)
+	caps = 0;
+	if (check_key(driver, sdi, cg, key, SR_CONF_GET, NULL, &caps) != SR_OK)
 		return SR_ERR_ARG;
 
 	if (sdi && !sdi->priv) {
@@ -820,11 +1236,25 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		return SR_ERR;
 	}
 
+	/* Only device instances keep a cache, driver options are static. */
+	if (!sdi)
+		caps &= ~(SR_CONF_CACHE_STATIC | SR_CONF_CACHE_ON_SET);
+	if (caps & (SR_CONF_CACHE_STATIC | SR_CONF_CACHE_ON_SET)) {
+		cached = config_cache_lookup(sdi, cg, key);
+		if (cached) {
+			*data = g_variant_ref(cached);
+			log_key(sdi, cg, key, SR_CONF_GET, *data);
+			return SR_OK;
+		}
+	}
+
 	if ((ret = driver->config_get(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_GET, *data);
 		/* Got a floating reference from the driver. Sink it here,
 		 * caller will need to unref when done with it. */
 		g_variant_ref_sink(*data);
+		if (caps & (SR_CONF_CACHE_STATIC | SR_CONF_CACHE_ON_SET))
+			config_cache_store(sdi, cg, key, caps, *data);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -834,6 +1264,64 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 	return ret;
 }
 
+struct config_staged_entry {
+	const struct sr_channel_group *cg;
+	uint32_t key;
+	GVariant *data;
+};
+
+static void config_staged_free(gpointer p)
+{
+	struct config_staged_entry *entry;
+
+	entry = p;
+	g_variant_unref(entry->data);
+	g_free(entry);
+}
+
+/* Stage a value, a later value for the same key replaces the earlier. */
+static void config_stage(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data)
+{
+	struct sr_dev_inst *dev;
+	struct config_staged_entry *entry;
+	GSList *l;
+
+	dev = (struct sr_dev_inst *)sdi;
+	for (l = dev->config_staged; l; l = l->next) {
+		entry = l->data;
+		if (entry->cg != cg || entry->key != key)
+			continue;
+		dev->config_staged = g_slist_delete_link(dev->config_staged, l);
+		config_staged_free(entry);
+		break;
+	}
+
+	entry = g_malloc(sizeof(*entry));
+	entry->cg = cg;
+	entry->key = key;
+	entry->data = g_variant_ref(data);
+	dev->config_staged = g_slist_append(dev->config_staged, entry);
+}
+
+/**
+ * Close a device instance's config transaction, and drop staged values.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_transaction_clear(const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *dev;
+
+	if (!sdi)
+		return;
+
+	dev = (struct sr_dev_inst *)sdi;
+	g_slist_free_full(dev->config_staged, config_staged_free);
+	dev->config_staged = NULL;
+	dev->config_staging = FALSE;
+}
+
 /**
  * Set value of a configuration key in a device instance.
  *
@@ -852,6 +1340,10 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
  *         interpreted as an error by the caller; merely as an indication
  *         that it's not applicable.
  *
+ * While a transaction is open (see sr_config_transaction_begin()), the
+ * key and value only get checked and staged, and are applied when the
+ * transaction gets committed.
+ *
  * @since 0.3.0
  */
 SR_API int sr_config_set(const struct sr_dev_inst *sdi,
@@ -870,11 +1362,18 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		sr_err("%s: Device instance not active, can't set config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else if (check_key(sdi->driver, sdi, cg, key, SR_CONF_SET, data) != SR_OK)
+	} else if (check_key(sdi->driver, sdi, cg, key, SR_CONF_SET, data, NULL) != SR_OK)
 		return SR_ERR_ARG;
 	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
-		log_key(sdi, cg, key, SR_CONF_SET, data);
-		ret = sdi->driver->config_set(key, data, sdi, cg);
+		if (sdi->config_staging) {
+			config_stage(sdi, cg, key, data);
+		} else {
+			log_key(sdi, cg, key, SR_CONF_SET, data);
+			ret = sdi->driver->config_set(key, data, sdi, cg);
+			/* Other keys' values may have changed along with this one. */
+			sr_config_cache_invalidate(sdi, FALSE);
+			((struct sr_dev_inst *)sdi)->armed = FALSE;
+		}
 	}
 
 	g_variant_unref(data);
@@ -907,12 +1406,136 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
 		sr_err("%s: Device instance not active, can't commit config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else
+	} else {
 		ret = sdi->driver->config_commit(sdi);
+		sr_config_cache_invalidate(sdi, FALSE);
+		((struct sr_dev_inst *)sdi)->armed = FALSE;
+	}
 
 	return ret;
 }
 
+/**
+ * Start a config transaction on a device instance.
+ *
+ * Until the transaction gets committed, sr_config_set() checks keys and
+ * values and stages them instead of applying them one by one. Getting
+ * values still returns the device's current settings.
+ *
+ * @param sdi The device instance.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DEV_CLOSED The device instance is not active.
+ * @retval SR_ERR A transaction is open already.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_transaction_begin(const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_inst *dev;
+
+	if (!sdi || !sdi->driver)
+		return SR_ERR_ARG;
+
+	if (sdi->status != SR_ST_ACTIVE) {
+		sr_err("%s: Device instance not active, can't start transaction.",
+			sdi->driver->name);
+		return SR_ERR_DEV_CLOSED;
+	}
+
+	if (sdi->config_staging) {
+		sr_err("%s: Config transaction already open.", sdi->driver->name);
+		return SR_ERR;
+	}
+
+	dev = (struct sr_dev_inst *)sdi;
+	dev->config_staging = TRUE;
+
+	return SR_OK;
+}
+
+/**
+ * Apply the values staged since sr_config_transaction_begin(), and
+ * commit them to the device hardware.
+ *
+ * Values get applied in the order in which they were set. For SCPI
+ * devices the resulting commands are sent as one program message,
+ * waiting for their completion only once.
+ *
+ * The transaction is closed afterwards, also in case of errors.
+ * Application stops at the first value which the driver rejects.
+ *
+ * @param sdi The device instance.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no transaction is open.
+ * @retval other Error code of the first failed driver call.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_transaction_commit(const struct sr_dev_inst *sdi)
+{
+	struct config_staged_entry *entry;
+	GSList *l;
+	int ret, batch_ret;
+
+	if (!sdi || !sdi->driver || !sdi->config_staging)
+		return SR_ERR_ARG;
+
+	((struct sr_dev_inst *)sdi)->config_staging = FALSE;
+	((struct sr_dev_inst *)sdi)->armed = FALSE;
+
+	if (sdi->inst_type == SR_INST_SCPI && sdi->conn)
+		sr_scpi_batch_begin(sdi->conn);
+
+	ret = SR_OK;
+	for (l = sdi->config_staged; l && ret == SR_OK; l = l->next) {
+		entry = l->data;
+		log_key(sdi, entry->cg, entry->key, SR_CONF_SET, entry->data);
+		ret = sdi->driver->config_set(entry->key, entry->data,
+			sdi, entry->cg);
+		if (ret == SR_ERR_CHANNEL_GROUP)
+			sr_err("%s: No channel group specified.",
+				sdi->driver->name);
+	}
+
+	if (sdi->inst_type == SR_INST_SCPI && sdi->conn) {
+		batch_ret = sr_scpi_batch_end(sdi->conn);
+		if (ret == SR_OK)
+			ret = batch_ret;
+	}
+
+	sr_config_cache_invalidate(sdi, FALSE);
+	sr_config_transaction_clear(sdi);
+
+	if (ret != SR_OK)
+		return ret;
+
+	return sr_config_commit(sdi);
+}
+
+/**
+ * Drop the values staged since sr_config_transaction_begin(), and
+ * close the transaction.
+ *
+ * @param sdi The device instance.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no transaction is open.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_transaction_abort(const struct sr_dev_inst *sdi)
+{
+	if (!sdi || !sdi->config_staging)
+		return SR_ERR_ARG;
+
+	sr_config_transaction_clear(sdi);
+
+	return SR_OK;
+}
+
 /**
  * List all possible values for a configuration key.
  *
@@ -956,7 +1579,7 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		return SR_ERR_ARG;
 
 	if (key != SR_CONF_SCAN_OPTIONS && key != SR_CONF_DEVICE_OPTIONS) {
-		if (check_key(driver, sdi, cg, key, SR_CONF_LIST, NULL) != SR_OK)
+		if (check_key(driver, sdi, cg, key, SR_CONF_LIST, NULL, NULL) != SR_OK)
 			return SR_ERR_ARG;
 	}
 
@@ -66,7 +66,8 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send the complete samples of the data, return their size in bytes. */
+static size_t send_samples(struct sr_input *in, uint8_t *data, size_t length)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -91,17 +92,27 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = length / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = data + i;
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+
+	return chunk_size;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	size_t length;
+
+	length = send_samples(in, (uint8_t *)sr_input_buf_ptr(in),
+		sr_input_buf_len(in));
+	sr_input_buf_consume(in, length);
 
 	return SR_OK;
 }
@@ -110,7 +121,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -123,6 +134,33 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+		size_t length, size_t *consumed)
+{
+	struct context *inc;
+	size_t fill;
+
+	if (!in->sdi_ready) {
+		/* sdi is ready, notify frontend. No data is needed for that. */
+		in->sdi_ready = TRUE;
+		return SR_OK;
+	}
+
+	inc = in->priv;
+	if (sr_input_buf_len(in)) {
+		/* Flush data of earlier sr_input_send() calls first. */
+		process_buffer(in);
+		fill = MIN(length, inc->unitsize - sr_input_buf_len(in));
+		sr_input_buf_append(in, (const char *)data, fill);
+		*consumed = fill;
+		return process_buffer(in);
+	}
+
+	*consumed = send_samples(in, data, length);
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -174,6 +212,7 @@ SR_PRIV struct sr_input_module input_binary = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.reset = reset,
 };
@@ -33,6 +33,8 @@
 #define LOG_PREFIX "input/csv"
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+/* Minimum amount of text per parser thread. */
+#define THREAD_MIN_SIZE	(64 * 1024)
 
 /*
  * The CSV input module has the following options:
@@ -91,6 +93,14 @@
  *     up to the end of the current text line. Can be empty to disable
  *     comment support. Defaults to semicolon.
  *
+ * threads: Specifies the number of threads which parse text lines.
+ *     Larger blocks of input text get split into line aligned chunks
+ *     which are parsed concurrently, their samples are sent in input
+ *     order. Zero uses one thread per CPU. Defaults to 1 (no threads).
+ *     Lines before the start line, the header line and the lines which
+ *     determine the samplerate from timestamps are always parsed in
+ *     sequence.
+ *
  * Typical examples of using these options:
  * - ... -I csv:column_formats=*l ...
  *   All columns are single-bit logic data. Identical to the previous
@@ -225,6 +235,8 @@ struct context {
 	const char *column_formats;
 	size_t column_want_count;
 	struct column_details *column_details;
+	/* Columns' text of the current line, points into the input buffer. */
+	char **column_texts;
 
 	/* Line number to start processing. */
 	size_t start_line;
@@ -256,6 +268,20 @@ struct context {
 	/* List of previously created sigrok channels. */
 	GSList *prev_sr_channels;
 	GSList **prev_df_channels;
+
+	/* Concurrent parsing of text chunks. */
+	unsigned int num_threads;
+	GThreadPool *pool;
+	GMutex jobs_mutex;
+	GCond jobs_cond;
+	size_t jobs_pending;
+};
+
+/* A chunk of text lines which gets parsed by a worker thread. */
+struct parse_job {
+	struct context ctx;
+	char *text, *text_end;
+	int ret;
 };
 
 /*
@@ -311,7 +337,36 @@ static void set_logic_level(struct context *inc, size_t ch_idx, int on)
 	inc->sample_buffer[byte_idx] |= bit_mask;
 }
 
-static int flush_logic_samples(const struct sr_input *in)
+/*
+ * Set the levels of several adjacent logic channels at once. Bit 0 of
+ * @a bits is the level of channel @a ch_idx. Takes at most 32 channels.
+ */
+static void set_logic_levels(struct context *inc, size_t ch_idx,
+	uint32_t bits, size_t count)
+{
+	size_t byte_idx, end_idx;
+	uint64_t word;
+
+	if (ch_idx >= inc->logic_channels)
+		return;
+	if (count > inc->logic_channels - ch_idx)
+		count = inc->logic_channels - ch_idx;
+	if (count < 32)
+		bits &= (1UL << count) - 1;
+	if (!bits)
+		return;
+
+	byte_idx = ch_idx / 8;
+	word = (uint64_t)bits << (ch_idx % 8);
+	end_idx = MIN(byte_idx + 5, inc->sample_unit_size);
+	while (word && byte_idx < end_idx) {
+		inc->sample_buffer[byte_idx++] |= word & 0xff;
+		word >>= 8;
+	}
+}
+
+static int send_logic_samples(const struct sr_input *in,
+	uint8_t *data, size_t length)
 {
 	struct context *inc;
 	struct sr_datafeed_packet packet;
@@ -319,7 +374,7 @@ static int flush_logic_samples(const struct sr_input *in)
 	int rc;
 
 	inc = in->priv;
-	if (!inc->datafeed_buf_fill)
+	if (!length)
 		return SR_OK;
 
 	rc = flush_samplerate(in);
@@ -331,10 +386,20 @@ static int flush_logic_samples(const struct sr_input *in)
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = inc->sample_unit_size;
-	logic.length = inc->datafeed_buf_fill;
-	logic.data = inc->datafeed_buffer;
+	logic.length = length;
+	logic.data = data;
 
-	rc = sr_session_send(in->sdi, &packet);
+	return sr_session_send(in->sdi, &packet);
+}
+
+static int flush_logic_samples(const struct sr_input *in)
+{
+	struct context *inc;
+	int rc;
+
+	inc = in->priv;
+	rc = send_logic_samples(in, inc->datafeed_buffer,
+		inc->datafeed_buf_fill);
 	if (rc != SR_OK)
 		return rc;
 
@@ -382,7 +447,12 @@ static void set_analog_value(struct context *inc, size_t ch_idx, csv_analog_t va
 	inc->analog_sample_buffer[ch_idx * inc->analog_datafeed_buf_size] = value;
 }
 
-static int flush_analog_samples(const struct sr_input *in)
+/*
+ * Send analog samples in the "striped" layout. The @a count values of
+ * each channel follow the previous channel's values at @a stride.
+ */
+static int send_analog_samples(const struct sr_input *in,
+	csv_analog_t *samples, size_t count, size_t stride)
 {
 	struct context *inc;
 	struct sr_datafeed_packet packet;
@@ -390,27 +460,25 @@ static int flush_analog_samples(const struct sr_input *in)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	csv_analog_t *samples;
 	size_t ch_idx;
 	int digits;
 	int rc;
 
 	inc = in->priv;
-	if (!inc->analog_datafeed_buf_fill)
+	if (!count)
 		return SR_OK;
 
 	rc = flush_samplerate(in);
 	if (rc != SR_OK)
 		return rc;
 
-	samples = inc->analog_datafeed_buffer;
 	for (ch_idx = 0; ch_idx < inc->analog_channels; ch_idx++) {
 		digits = inc->analog_datafeed_digits[ch_idx];
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
 		memset(&packet, 0, sizeof(packet));
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
-		analog.num_samples = inc->analog_datafeed_buf_fill;
+		analog.num_samples = count;
 		analog.data = samples;
 		analog.meaning->channels = inc->analog_datafeed_channels[ch_idx];
 		analog.meaning->mq = 0;
@@ -428,9 +496,23 @@ static int flush_analog_samples(const struct sr_input *in)
 		rc = sr_session_send(in->sdi, &packet);
 		if (rc != SR_OK)
 			return rc;
-		samples += inc->analog_datafeed_buf_size;
+		samples += stride;
 	}
 
+	return SR_OK;
+}
+
+static int flush_analog_samples(const struct sr_input *in)
+{
+	struct context *inc;
+	int rc;
+
+	inc = in->priv;
+	rc = send_analog_samples(in, inc->analog_datafeed_buffer,
+		inc->analog_datafeed_buf_fill, inc->analog_datafeed_buf_size);
+	if (rc != SR_OK)
+		return rc;
+
 	inc->analog_datafeed_buf_fill = 0;
 
 	return SR_OK;
@@ -772,6 +854,57 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/**
+ * Splits a text line into columns in place.
+ *
+ * @param[in] buf	The input text line to split, gets modified.
+ * @param[in] inc	The input module's context.
+ *
+ * @returns The number of columns found, up to the wanted column count.
+ *
+ * This is the fast path for single character separators. It does not
+ * allocate memory. Only the columns which get processed are isolated,
+ * the remainder of the line is not inspected.
+ */
+static size_t split_line_inplace(char *buf, struct context *inc)
+{
+	char delim, *next;
+	size_t count;
+
+	delim = inc->delimiter->str[0];
+	count = 0;
+	while (count < inc->column_want_count) {
+		inc->column_texts[count++] = buf;
+		next = strchr(buf, delim);
+		if (next)
+			*next = '\0';
+		g_strchomp(buf);
+		if (!next)
+			break;
+		buf = next + 1;
+	}
+
+	return count;
+}
+
+/* Find the next line termination in a buffer, NULL if there is none. */
+static char *find_termination(char *buf, const char *end, const char *term)
+{
+	char *p;
+	size_t term_len;
+
+	term_len = strlen(term);
+	while (buf < end && (p = memchr(buf, term[0], end - buf))) {
+		if (term_len == 1)
+			return p;
+		if ((size_t)(end - p) >= term_len && !memcmp(p, term, term_len))
+			return p;
+		buf = p + 1;
+	}
+
+	return NULL;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
@@ -788,12 +921,13 @@ static char **split_line(char *buf, struct context *inc)
 static int parse_logic(const char *column, struct context *inc,
 	const struct column_details *details)
 {
-	size_t length, ch_rem, ch_idx, ch_inc;
+	size_t length, ch_rem, ch_idx, ch_inc, digit_count, acc_count;
 	const char *rdptr;
 	char c;
 	gboolean valid;
 	const char *type_text;
 	uint8_t bits;
+	uint32_t acc;
 
 	/*
 	 * Prepare to read the digits from the text end towards the start.
@@ -814,27 +948,29 @@ static int parse_logic(const char *column, struct context *inc,
 	/*
 	 * Get another digit and derive up to four logic channels' state from
 	 * it. Make sure to not process more bits than the column has channels
-	 * associated with it.
+	 * associated with it. Collect the bits of several digits, and have
+	 * them stored at once.
 	 */
+	ch_inc = details->text_format == FORMAT_HEX ? 4 :
+		details->text_format == FORMAT_OCT ? 3 : 1;
+	acc = 0;
+	acc_count = 0;
 	while (rdptr > column && ch_rem) {
 		/* Check for valid digits according to the input radix. */
 		c = *(--rdptr);
 		switch (details->text_format) {
 		case FORMAT_BIN:
-			valid = g_ascii_isxdigit(c) && c < '2';
-			ch_inc = 1;
+			valid = c == '0' || c == '1';
 			break;
 		case FORMAT_OCT:
-			valid = g_ascii_isxdigit(c) && c < '8';
-			ch_inc = 3;
+			valid = c >= '0' && c <= '7';
 			break;
 		case FORMAT_HEX:
 			valid = g_ascii_isxdigit(c);
-			ch_inc = 4;
 			break;
 		default:
-			valid = FALSE;
-			break;
+			/* ShouldNotHappen(TM), but silences compiler warning. */
+			return SR_ERR;
 		}
 		if (!valid) {
 			type_text = col_format_text[details->text_format];
@@ -844,33 +980,19 @@ static int parse_logic(const char *column, struct context *inc,
 		}
 		/* Use the digit's bits for logic channels' data. */
 		bits = g_ascii_xdigit_value(c);
-		switch (details->text_format) {
-		case FORMAT_HEX:
-			if (ch_rem >= 4) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 3, bits & (1 << 3));
-			}
-			/* FALLTHROUGH */
-		case FORMAT_OCT:
-			if (ch_rem >= 3) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 2, bits & (1 << 2));
-			}
-			if (ch_rem >= 2) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 1, bits & (1 << 1));
-			}
-			/* FALLTHROUGH */
-		case FORMAT_BIN:
-			ch_rem--;
-			set_logic_level(inc, ch_idx + 0, bits & (1 << 0));
-			break;
-		default:
-			/* ShouldNotHappen(TM), but silences compiler warning. */
-			return SR_ERR;
+		digit_count = MIN(ch_inc, ch_rem);
+		acc |= (uint32_t)(bits & ((1 << digit_count) - 1)) << acc_count;
+		acc_count += digit_count;
+		ch_rem -= digit_count;
+		if (acc_count > 32 - 4) {
+			set_logic_levels(inc, ch_idx, acc, acc_count);
+			ch_idx += acc_count;
+			acc = 0;
+			acc_count = 0;
 		}
-		ch_idx += ch_inc;
 	}
+	if (acc_count)
+		set_logic_levels(inc, ch_idx, acc, acc_count);
 	/*
 	 * TODO Determine whether the availability of extra input data
 	 * for unhandled logic channels is worth warning here. In this
@@ -882,6 +1004,58 @@ static int parse_logic(const char *column, struct context *inc,
 	return SR_OK;
 }
 
+/*
+ * Convert simple decimal text ("-12", "3.25") without the generic
+ * floating point parser. Values with up to 15 digits are exact in a
+ * double, scaling them by an exact power of ten is correctly rounded,
+ * which yields the same result as strtod(). Other text is rejected,
+ * and left to the generic parser.
+ */
+static gboolean parse_simple_decimal(const char *text, double *value)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+		1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	};
+	const char *p;
+	gboolean neg, have_digits;
+	uint64_t mantissa;
+	size_t digits, decimals;
+
+	p = text;
+	neg = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+	mantissa = 0;
+	digits = 0;
+	decimals = 0;
+	have_digits = FALSE;
+	while (*p >= '0' && *p <= '9') {
+		mantissa = mantissa * 10 + (*p++ - '0');
+		have_digits = TRUE;
+		if (mantissa)
+			digits++;
+	}
+	if (*p == '.') {
+		p++;
+		while (*p >= '0' && *p <= '9') {
+			mantissa = mantissa * 10 + (*p++ - '0');
+			have_digits = TRUE;
+			if (mantissa)
+				digits++;
+			decimals++;
+		}
+	}
+	if (*p || !have_digits || digits > 15 || decimals >= ARRAY_SIZE(pow10))
+		return FALSE;
+
+	*value = decimals ? mantissa / pow10[decimals] : mantissa;
+	if (neg)
+		*value = -*value;
+
+	return TRUE;
+}
+
 /**
  * Parse a floating point text into an analog value.
  *
@@ -912,7 +1086,10 @@ static int parse_analog(const char *column, struct context *inc,
 			inc->line_number);
 		return SR_ERR;
 	}
-	if (sizeof(value) == sizeof(double)) {
+	if (parse_simple_decimal(column, &dvalue)) {
+		ret = SR_OK;
+		value = dvalue;
+	} else if (sizeof(value) == sizeof(double)) {
 		ret = sr_atod_ascii(column, &dvalue);
 		value = dvalue;
 	} else if (sizeof(value) == sizeof(float)) {
@@ -1218,6 +1395,14 @@ static int init(struct sr_input *in, GHashTable *options)
 		sr_err("Invalid start line %zu.", inc->start_line);
 		return SR_ERR_ARG;
 	}
+	inc->num_threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!inc->num_threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		inc->num_threads = g_get_num_processors();
+#else
+		inc->num_threads = 2;
+#endif
+	}
 
 	/*
 	 * Scan flexible, to get prefered format specs which describe
@@ -1527,16 +1712,354 @@ static int initial_receive(const struct sr_input *in)
 	return ret;
 }
 
-static int process_buffer(struct sr_input *in, gboolean is_eof)
+/*
+ * Parse a single text line, which gets modified in the process. Sets
+ * @a have_sample when the line's data was stored in the current sample
+ * set. Does not access the input or the session, so that worker threads
+ * can run this on their private copy of the context.
+ */
+static int parse_line(struct context *inc, char *line, gboolean *have_sample)
 {
-	struct context *inc;
-	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	size_t num_columns, col_idx, col_nr;
 	const struct column_details *details;
 	col_parse_cb parse_func;
+	char **columns;
+	int ret;
+
+	*have_sample = FALSE;
+	inc->line_number++;
+	if (inc->line_number < inc->start_line) {
+		sr_spew("Line %zu skipped (before start).", inc->line_number);
+		return SR_OK;
+	}
+	if (line[0] == '\0') {
+		sr_spew("Blank line %zu skipped.", inc->line_number);
+		return SR_OK;
+	}
+
+	/* Remove trailing comment. */
+	strip_comment(line, inc->comment);
+	if (line[0] == '\0') {
+		sr_spew("Comment-only line %zu skipped.", inc->line_number);
+		return SR_OK;
+	}
+
+	/* Skip the header line, its content was used as the channel names. */
+	if (inc->use_header && !inc->header_seen) {
+		sr_spew("Header line %zu skipped.", inc->line_number);
+		inc->header_seen = TRUE;
+		return SR_OK;
+	}
+
+	/* Split the line into columns, check for minimum length. */
+	columns = NULL;
+	if (inc->delimiter->len == 1) {
+		num_columns = split_line_inplace(line, inc);
+	} else {
+		columns = split_line(line, inc);
+		if (!columns) {
+			sr_err("Error while parsing line %zu.", inc->line_number);
+			return SR_ERR;
+		}
+		num_columns = g_strv_length(columns);
+		for (col_idx = 0; col_idx < inc->column_want_count &&
+				col_idx < num_columns; col_idx++)
+			inc->column_texts[col_idx] = columns[col_idx];
+	}
+	if (num_columns < inc->column_want_count) {
+		sr_err("Insufficient column count %zu in line %zu.",
+			num_columns, inc->line_number);
+		g_strfreev(columns);
+		return SR_ERR;
+	}
+
+	/* Have the columns of the current text line processed. */
+	clear_logic_samples(inc);
+	clear_analog_samples(inc);
+	for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+		col_nr = col_idx + 1;
+		details = lookup_column_details(inc, col_nr);
+		if (!details || !details->text_format)
+			continue;
+		parse_func = col_parse_funcs[details->text_format];
+		if (!parse_func)
+			continue;
+		ret = parse_func(inc->column_texts[col_idx], inc, details);
+		if (ret != SR_OK) {
+			g_strfreev(columns);
+			return SR_ERR;
+		}
+	}
+	g_strfreev(columns);
+	*have_sample = TRUE;
+
+	return SR_OK;
+}
+
+/* Process a single text line, and queue its sample data. */
+static int process_line(struct sr_input *in, char *line)
+{
+	gboolean have_sample;
+	int ret;
+
+	ret = parse_line(in->priv, line, &have_sample);
+	if (ret != SR_OK || !have_sample)
+		return ret;
+
+	/* Send sample data to the session bus (buffered). */
+	ret = queue_logic_samples(in);
+	ret += queue_analog_samples(in);
+	if (ret != SR_OK) {
+		sr_err("Sending samples failed.");
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Count the text lines in a buffer, like g_strsplit() would split them. */
+static size_t count_lines(char *buf, const char *end, const char *term)
+{
+	size_t count, term_len;
+
+	term_len = strlen(term);
+	count = 1;
+	while ((buf = find_termination(buf, end, term))) {
+		count++;
+		buf += term_len;
+	}
+
+	return count;
+}
+
+/*
+ * Parse a chunk of text lines in a worker thread. The private copy of
+ * the context has buffers which take the samples of all of the chunk's
+ * lines, so there is nothing to flush.
+ */
+static void parse_job_run(gpointer data, gpointer user_data)
+{
+	struct parse_job *job;
+	struct context *inc, *parent;
+	char *line, *next;
+	size_t term_len;
+	gboolean have_sample;
+
+	job = data;
+	parent = user_data;
+	inc = &job->ctx;
+
+	term_len = strlen(inc->termination);
+	line = job->text;
+	while (TRUE) {
+		next = find_termination(line, job->text_end, inc->termination);
+		if (next)
+			*next = '\0';
+		job->ret = parse_line(inc, line, &have_sample);
+		if (job->ret != SR_OK)
+			break;
+		if (have_sample) {
+			if (inc->logic_channels)
+				inc->datafeed_buf_fill += inc->sample_unit_size;
+			if (inc->analog_channels)
+				inc->analog_datafeed_buf_fill++;
+		}
+		if (!next)
+			break;
+		line = next + term_len;
+	}
+
+	g_mutex_lock(&parent->jobs_mutex);
+	parent->jobs_pending--;
+	g_cond_signal(&parent->jobs_cond);
+	g_mutex_unlock(&parent->jobs_mutex);
+}
+
+/*
+ * Check whether the remaining lines can get parsed in any order. Which
+ * is not the case while lines get skipped, while the header is pending,
+ * or while timestamps determine the samplerate.
+ */
+static gboolean can_parse_concurrently(struct context *inc)
+{
+	const struct column_details *details;
+	size_t col_nr;
+
+	if (!inc->pool)
+		return FALSE;
+	if (inc->line_number + 1 < inc->start_line)
+		return FALSE;
+	if (inc->use_header && !inc->header_seen)
+		return FALSE;
+	if (!inc->calc_samplerate) {
+		for (col_nr = 1; col_nr <= inc->column_want_count; col_nr++) {
+			details = lookup_column_details(inc, col_nr);
+			if (details && format_is_timestamp(details->text_format))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * Split text into line aligned chunks, have them parsed by the worker
+ * pool, and send their samples in input order.
+ */
+static int process_lines_concurrently(struct sr_input *in,
+	char *text, char *text_end, size_t job_count)
+{
+	struct context *inc;
+	struct parse_job *jobs, *job;
+	size_t term_len, job_size, idx, num_lines;
+	char *stop;
 	int ret;
-	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+
+	inc = in->priv;
+	term_len = strlen(inc->termination);
+	job_size = (text_end - text) / job_count;
+	jobs = g_malloc0_n(job_count, sizeof(jobs[0]));
+
+	/* Samples which were queued before must be sent first. */
+	ret = flush_logic_samples(in);
+	ret += flush_analog_samples(in);
+	if (ret != SR_OK) {
+		g_free(jobs);
+		return SR_ERR;
+	}
+
+	/*
+	 * Cut the text at line terminations near the chunk size. Count
+	 * the lines of each chunk, to size the jobs' sample buffers, and
+	 * to have the jobs' line numbers match the input text.
+	 */
+	for (idx = 0; idx < job_count; idx++) {
+		job = &jobs[idx];
+		job->text = text;
+		job->text_end = text_end;
+		stop = NULL;
+		if (idx + 1 < job_count) {
+			stop = find_termination(MIN(text + job_size, text_end),
+				text_end, inc->termination);
+		}
+		if (stop) {
+			*stop = '\0';
+			job->text_end = stop;
+			text = stop + term_len;
+		}
+		num_lines = count_lines(job->text, job->text_end,
+			inc->termination);
+
+		job->ctx = *inc;
+		job->ctx.pool = NULL;
+		job->ctx.column_texts = g_malloc0_n(inc->column_want_count + 1,
+			sizeof(job->ctx.column_texts[0]));
+		if (inc->logic_channels) {
+			job->ctx.datafeed_buf_size = num_lines * inc->sample_unit_size;
+			job->ctx.datafeed_buffer = g_malloc(job->ctx.datafeed_buf_size);
+			job->ctx.datafeed_buf_fill = 0;
+		}
+		if (inc->analog_channels) {
+			job->ctx.analog_datafeed_buf_size = num_lines;
+			job->ctx.analog_datafeed_buffer = g_malloc_n(
+				num_lines * inc->analog_channels,
+				sizeof(job->ctx.analog_datafeed_buffer[0]));
+			job->ctx.analog_datafeed_buf_fill = 0;
+		}
+		inc->line_number += num_lines;
+
+		if (!stop) {
+			job_count = idx + 1;
+			break;
+		}
+	}
+
+	g_mutex_lock(&inc->jobs_mutex);
+	inc->jobs_pending = job_count;
+	g_mutex_unlock(&inc->jobs_mutex);
+	for (idx = 0; idx < job_count; idx++)
+		g_thread_pool_push(inc->pool, &jobs[idx], NULL);
+	g_mutex_lock(&inc->jobs_mutex);
+	while (inc->jobs_pending)
+		g_cond_wait(&inc->jobs_cond, &inc->jobs_mutex);
+	g_mutex_unlock(&inc->jobs_mutex);
+
+	/* Send the chunks' samples in order, up to the first error. */
+	ret = SR_OK;
+	for (idx = 0; idx < job_count; idx++) {
+		job = &jobs[idx];
+		if (ret == SR_OK)
+			ret = job->ret;
+		if (ret == SR_OK) {
+			ret = send_logic_samples(in, job->ctx.datafeed_buffer,
+				job->ctx.datafeed_buf_fill);
+			ret += send_analog_samples(in,
+				job->ctx.analog_datafeed_buffer,
+				job->ctx.analog_datafeed_buf_fill,
+				job->ctx.analog_datafeed_buf_size);
+			if (ret != SR_OK)
+				sr_err("Sending samples failed.");
+		}
+		g_free(job->ctx.column_texts);
+		g_free(job->ctx.datafeed_buffer);
+		g_free(job->ctx.analog_datafeed_buffer);
+	}
+	g_free(jobs);
+
+	return ret == SR_OK ? SR_OK : SR_ERR;
+}
+
+/*
+ * Process the text lines in a buffer, which get modified in the
+ * process. Hands larger amounts of text to the worker pool as soon as
+ * the lines can get parsed in any order.
+ */
+static int process_lines(struct sr_input *in, char *text, char *text_end)
+{
+	struct context *inc;
+	size_t term_len, job_count;
+	char *line, *next;
+	int ret;
+
+	inc = in->priv;
+	term_len = strlen(inc->termination);
+	line = text;
+	while (line < text_end) {
+		if (can_parse_concurrently(inc)) {
+			job_count = (text_end - line) / THREAD_MIN_SIZE;
+			job_count = MIN(job_count, inc->num_threads);
+			if (job_count > 1) {
+				return process_lines_concurrently(in,
+					line, text_end, job_count);
+			}
+		}
+		next = find_termination(line, text_end, inc->termination);
+		if (next)
+			*next = '\0';
+		ret = process_line(in, line);
+		if (ret != SR_OK)
+			return ret;
+		if (!next)
+			break;
+		line = next + term_len;
+		/* Text which ends in a termination has an empty last line. */
+		if (line == text_end) {
+			ret = process_line(in, line);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int process_buffer(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	GError *error;
+	int ret;
+	char *text, *processed_up_to, *text_end;
+	size_t text_len;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1557,99 +2080,52 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 * on Windows). A present termination sequence will just result
 	 * in the "execution of an empty line", and does not harm.
 	 */
-	if (!in->buf->len)
+	text = sr_input_buf_ptr(in);
+	text_len = sr_input_buf_len(in);
+	if (!text_len)
 		return SR_OK;
 	if (is_eof) {
-		processed_up_to = in->buf->str + in->buf->len;
+		text_end = text + text_len;
+		processed_up_to = text_end;
 	} else {
-		processed_up_to = g_strrstr_len(in->buf->str, in->buf->len,
-			inc->termination);
-		if (!processed_up_to)
+		text_end = g_strrstr_len(text, text_len, inc->termination);
+		if (!text_end)
 			return SR_OK;
-		*processed_up_to = '\0';
-		processed_up_to += strlen(inc->termination);
+		*text_end = '\0';
+		processed_up_to = text_end + strlen(inc->termination);
 	}
 
-	/* Split input text lines and process their columns. */
-	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
-		inc->line_number++;
-		if (inc->line_number < inc->start_line) {
-			sr_spew("Line %zu skipped (before start).", inc->line_number);
-			continue;
-		}
-		if (line[0] == '\0') {
-			sr_spew("Blank line %zu skipped.", inc->line_number);
-			continue;
-		}
-
-		/* Remove trailing comment. */
-		strip_comment(line, inc->comment);
-		if (line[0] == '\0') {
-			sr_spew("Comment-only line %zu skipped.", inc->line_number);
-			continue;
-		}
-
-		/* Skip the header line, its content was used as the channel names. */
-		if (inc->use_header && !inc->header_seen) {
-			sr_spew("Header line %zu skipped.", inc->line_number);
-			inc->header_seen = TRUE;
-			continue;
-		}
-
-		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
-		if (num_columns < inc->column_want_count) {
-			sr_err("Insufficient column count %zu in line %zu.",
-				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-
-		/* Have the columns of the current text line processed. */
-		clear_logic_samples(inc);
-		clear_analog_samples(inc);
-		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
-			col_nr = col_idx + 1;
-			details = lookup_column_details(inc, col_nr);
-			if (!details || !details->text_format)
-				continue;
-			parse_func = col_parse_funcs[details->text_format];
-			if (!parse_func)
-				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
-				return SR_ERR;
-			}
-		}
-
-		/* Send sample data to the session bus (buffered). */
-		ret = queue_logic_samples(in);
-		ret += queue_analog_samples(in);
-		if (ret != SR_OK) {
-			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
-			return SR_ERR;
+	/*
+	 * Walk the text lines in place, and process their columns. Lines
+	 * get terminated within the input buffer, and so do the columns
+	 * unless the column separator has several characters. There are
+	 * no allocations per line in the common case.
+	 */
+	if (!inc->column_texts) {
+		inc->column_texts = g_malloc0_n(inc->column_want_count + 1,
+			sizeof(inc->column_texts[0]));
+	}
+	if (inc->num_threads > 1 && !inc->pool) {
+		g_mutex_init(&inc->jobs_mutex);
+		g_cond_init(&inc->jobs_cond);
+		error = NULL;
+		inc->pool = g_thread_pool_new(parse_job_run, inc,
+			inc->num_threads, FALSE, &error);
+		if (!inc->pool) {
+			sr_warn("Cannot create parser threads: %s.",
+				error->message);
+			g_error_free(error);
+			g_mutex_clear(&inc->jobs_mutex);
+			g_cond_clear(&inc->jobs_cond);
+			inc->num_threads = 1;
 		}
-
-		g_strfreev(columns);
 	}
-	g_strfreev(lines);
-	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
+	ret = process_lines(in, text, text_end);
+	if (ret != SR_OK)
+		return ret;
+	sr_input_buf_consume(in, processed_up_to - text);
 
-	return ret;
+	return SR_OK;
 }
 
 static int receive(struct sr_input *in, GString *buf)
@@ -1657,7 +2133,7 @@ static int receive(struct sr_input *in, GString *buf)
 	struct context *inc;
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	inc = in->priv;
 	if (!inc->column_seen_count) {
@@ -1724,6 +2200,14 @@ static void cleanup(struct sr_input *in)
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
 	inc->column_details = NULL;
+	g_free(inc->column_texts);
+	inc->column_texts = NULL;
+	if (inc->pool) {
+		g_thread_pool_free(inc->pool, FALSE, TRUE);
+		inc->pool = NULL;
+		g_mutex_clear(&inc->jobs_mutex);
+		g_cond_clear(&inc->jobs_cond);
+	}
 
 	/* Clear internal state, but keep what .init() has provided. */
 	save_ctx = *inc;
@@ -1736,6 +2220,7 @@ static void cleanup(struct sr_input *in)
 	inc->use_header = save_ctx.use_header;
 	inc->prev_sr_channels = save_ctx.prev_sr_channels;
 	inc->prev_df_channels = save_ctx.prev_df_channels;
+	inc->num_threads = save_ctx.num_threads;
 }
 
 static int reset(struct sr_input *in)
@@ -1761,6 +2246,7 @@ enum option_index {
 	OPT_SAMPLERATE,
 	OPT_COL_SEP,
 	OPT_COMMENT,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1815,6 +2301,11 @@ static struct sr_option options[] = {
 		"The text which starts comments at the end of text lines, semicolon by default.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"The number of threads which parse text lines, 0 for one per CPU (default: 1).",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -1838,6 +2329,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(g_variant_new_uint64(0));
 		options[OPT_COL_SEP].def = g_variant_ref_sink(g_variant_new_string(","));
 		options[OPT_COMMENT].def = g_variant_ref_sink(g_variant_new_string(";"));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(1));
 	}
 
 	return options;
@@ -21,14 +21,213 @@
 #include "libsigrok-internal.h"
 #include <string.h>
 
+/*
+ * Optional pool of sample buffers for a queue. Flushing lends the
+ * current buffer to the session, and continues with another one from
+ * the pool. Consumers which keep packets return the buffers later, and
+ * possibly from another thread. The pool lives on until the queue was
+ * freed and the last buffer came back. Buffers get charged to the
+ * session's memory budget, beyond the first one the pool only grows
+ * while they fit.
+ */
+struct feed_queue_pool {
+	gint refcount;
+	size_t buffer_size;
+	guint max_buffers;
+	guint num_buffers;
+	GAsyncQueue *idle;
+	struct sr_mem_account *account;
+	int numa_node;
+};
+
+struct feed_queue_buffer {
+	struct feed_queue_pool *pool;
+	void *data;
+};
+
+static void feed_queue_pool_unref(struct feed_queue_pool *pool)
+{
+	struct feed_queue_buffer *buf;
+
+	if (!g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	while ((buf = g_async_queue_try_pop(pool->idle))) {
+		sr_large_buffer_free(buf->data);
+		g_free(buf);
+	}
+	g_async_queue_unref(pool->idle);
+	sr_mem_account_free(pool->account);
+	g_free(pool);
+}
+
+static struct feed_queue_pool *feed_queue_pool_new(
+	const struct sr_dev_inst *sdi, size_t buffer_size, guint max_buffers)
+{
+	struct feed_queue_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	pool->refcount = 1;
+	pool->buffer_size = buffer_size;
+	pool->max_buffers = max_buffers;
+	pool->idle = g_async_queue_new();
+	pool->account = sr_mem_account_new(sdi ? sdi->session : NULL,
+		"feed-queue");
+	pool->numa_node = sr_dev_numa_node(sdi);
+
+	return pool;
+}
+
+static struct feed_queue_buffer *feed_queue_pool_alloc(
+	struct feed_queue_pool *pool)
+{
+	struct feed_queue_buffer *buf;
+	void *data;
+
+	if (!pool->num_buffers)
+		sr_mem_account_charge(pool->account, pool->buffer_size);
+	else if (!sr_mem_account_try_charge(pool->account, pool->buffer_size))
+		return NULL;
+	data = sr_large_buffer_alloc(pool->buffer_size, pool->numa_node);
+	if (!data) {
+		sr_mem_account_release(pool->account, pool->buffer_size);
+		return NULL;
+	}
+	sr_large_buffer_prefault(data);
+	buf = g_malloc0(sizeof(*buf));
+	buf->pool = pool;
+	buf->data = data;
+	pool->num_buffers++;
+
+	return buf;
+}
+
+/*
+ * Get a buffer from the pool. When all of them are in use, or another
+ * one does not fit the memory budget, wait for the consumer to return
+ * one, which throttles the producer.
+ */
+static struct feed_queue_buffer *feed_queue_pool_get(
+	struct feed_queue_pool *pool)
+{
+	struct feed_queue_buffer *buf;
+
+	buf = g_async_queue_try_pop(pool->idle);
+	if (!buf && pool->num_buffers < pool->max_buffers) {
+		buf = feed_queue_pool_alloc(pool);
+		if (!buf && !pool->num_buffers)
+			return NULL;
+	}
+	if (!buf)
+		buf = g_async_queue_pop(pool->idle);
+	g_atomic_int_inc(&pool->refcount);
+
+	return buf;
+}
+
+/* Release callback of lent packets, also used for the current buffer. */
+static void feed_queue_pool_put(void *data)
+{
+	struct feed_queue_buffer *buf;
+	struct feed_queue_pool *pool;
+
+	buf = data;
+	pool = buf->pool;
+	g_async_queue_push(pool->idle, buf);
+	feed_queue_pool_unref(pool);
+}
+
+/* Limits of feed_queue_auto_count(). */
+#define AUTO_COUNT_MIN		256
+#define AUTO_COUNT_MAX_BYTES	(4 * 1024 * 1024)
+
+/*
+ * Optional latency bound. Queues note when the oldest of their pending
+ * samples was submitted, and get flushed when that is longer ago than
+ * the bound. Submission checks it, and a session timer does for queues
+ * which receive no more data.
+ */
+struct feed_queue_latency {
+	int64_t bound_us;
+	int64_t oldest_us;
+	GSource *timer;
+};
+
+/* Returns TRUE when pending samples exceed the latency bound. */
+static gboolean feed_queue_latency_due(struct feed_queue_latency *lat,
+	size_t fill_count)
+{
+	int64_t now;
+
+	if (!lat->bound_us || !fill_count)
+		return FALSE;
+
+	now = g_get_monotonic_time();
+	if (!lat->oldest_us) {
+		lat->oldest_us = now;
+		return FALSE;
+	}
+
+	return now - lat->oldest_us >= lat->bound_us;
+}
+
+static int feed_queue_latency_set(struct feed_queue_latency *lat,
+	const struct sr_dev_inst *sdi, unsigned int latency_ms,
+	GSourceFunc cb, void *cb_data)
+{
+	sr_session_timer_remove(lat->timer);
+	lat->timer = NULL;
+	lat->bound_us = 1000 * (int64_t)latency_ms;
+	lat->oldest_us = 0;
+	if (!latency_ms || !sdi || !sdi->session)
+		return SR_OK;
+
+	/* Check twice per period, pending data waits 1.5 bounds at most. */
+	lat->timer = sr_session_timer_add(sdi->session,
+		MAX(latency_ms / 2, 1), cb, cb_data);
+	if (!lat->timer)
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/*
+ * Get a queue size for the given samplerate, which makes packets span
+ * about the latency bound. The size is limited to reasonably sized
+ * packets at high rates, and yields useful packets at low rates.
+ */
+SR_API size_t feed_queue_auto_count(uint64_t samplerate,
+	unsigned int latency_ms, size_t unit_size)
+{
+	uint64_t count, max_count;
+
+	if (!unit_size)
+		unit_size = 1;
+	max_count = MAX(AUTO_COUNT_MAX_BYTES / unit_size, AUTO_COUNT_MIN);
+	count = samplerate / 1000 * latency_ms;
+	count += samplerate % 1000 * latency_ms / 1000;
+	count = MAX(count, AUTO_COUNT_MIN);
+	count = MIN(count, max_count);
+
+	return count;
+}
+
 struct feed_queue_logic {
 	const struct sr_dev_inst *sdi;
 	size_t unit_size;
+	const struct sr_logic_ops *ops;
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	uint64_t *run_lengths;
+	struct feed_queue_pool *pool;
+	struct feed_queue_buffer *buffer;
+	struct sr_mem_account *account;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
+	struct sr_datafeed_packet_info info;
+	struct feed_queue_latency latency;
 };
 
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
@@ -40,12 +239,19 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->unit_size = unit_size;
+	q->ops = sr_logic_ops_get(unit_size);
 	q->alloc_count = sample_count;
-	q->data_bytes = g_try_malloc(q->alloc_count * q->unit_size);
+	q->data_bytes = sr_large_buffer_alloc(q->alloc_count * q->unit_size,
+		sr_dev_numa_node(sdi));
 	if (!q->data_bytes) {
 		g_free(q);
 		return NULL;
 	}
+	/* Queues get allocated when the acquisition starts. */
+	sr_large_buffer_prefault(q->data_bytes);
+	q->account = sr_mem_account_new(sdi ? sdi->session : NULL,
+		"feed-queue");
+	sr_mem_account_charge(q->account, q->alloc_count * q->unit_size);
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	memset(&q->logic, 0, sizeof(q->logic));
@@ -53,28 +259,172 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	q->packet.payload = &q->logic;
 	q->logic.unitsize = q->unit_size;
 	q->logic.data = q->data_bytes;
+	q->logic_rle.unitsize = q->unit_size;
+	q->logic_rle.values = q->data_bytes;
 
 	return q;
 }
 
+/*
+ * Queue a run of samples in RLE mode. Repetitions of the most recent
+ * sample value extend the current run.
+ */
+static int feed_queue_logic_submit_rle(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count)
+{
+	uint8_t *wrptr;
+
+	if (!count)
+		return SR_OK;
+
+	if (q->fill_count) {
+		wrptr = &q->data_bytes[(q->fill_count - 1) * q->unit_size];
+		if (q->ops->equal(wrptr, data, q->unit_size)) {
+			q->run_lengths[q->fill_count - 1] += count;
+			return SR_OK;
+		}
+	}
+
+	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+	q->ops->copy(wrptr, data, q->unit_size);
+	q->run_lengths[q->fill_count] = count;
+	q->fill_count++;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_logic_flush(q);
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		return feed_queue_logic_flush(q);
+
+	return SR_OK;
+}
+
+/*
+ * Have the queue send SR_DF_LOGIC_RLE packets instead of SR_DF_LOGIC.
+ * The queue's sample_count then is the number of runs it holds, and
+ * submitting repetitions of a sample does not expand them. Consumers
+ * which don't understand run length encoded data still get expanded
+ * SR_DF_LOGIC packets.
+ */
+SR_API int feed_queue_logic_set_rle(struct feed_queue_logic *q,
+	gboolean enable)
+{
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+	if (enable == (q->run_lengths != NULL))
+		return SR_OK;
+
+	ret = feed_queue_logic_flush(q);
+	if (ret != SR_OK)
+		return ret;
+
+	if (enable) {
+		q->run_lengths = g_try_malloc(q->alloc_count *
+			sizeof(q->run_lengths[0]));
+		if (!q->run_lengths)
+			return SR_ERR_MALLOC;
+		sr_mem_account_charge(q->account, q->alloc_count *
+			sizeof(q->run_lengths[0]));
+		q->packet.type = SR_DF_LOGIC_RLE;
+		q->packet.payload = &q->logic_rle;
+		q->logic_rle.run_lengths = q->run_lengths;
+	} else {
+		g_free(q->run_lengths);
+		q->run_lengths = NULL;
+		sr_mem_account_release(q->account, q->alloc_count *
+			sizeof(q->run_lengths[0]));
+		q->packet.type = SR_DF_LOGIC;
+		q->packet.payload = &q->logic;
+	}
+
+	return SR_OK;
+}
+
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count)
 {
 	uint8_t *wrptr;
+	size_t fill;
 	int ret;
 
-	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	if (q->run_lengths)
+		return feed_queue_logic_submit_rle(q, data, count);
+
+	while (count) {
+		fill = MIN(count, q->alloc_count - q->fill_count);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		q->ops->fill(wrptr, data, q->unit_size, fill);
+		q->fill_count += fill;
+		count -= fill;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		return feed_queue_logic_flush(q);
+
+	return SR_OK;
+}
+
+/*
+ * Queue a sequence of (value, count) pairs, as RLE decoding drivers
+ * and input modules get them. The values are packed at the queue's
+ * unit size, each of them is repeated as often as its count says.
+ */
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *values, const size_t *counts, size_t num_runs)
+{
+	size_t idx;
+	int ret;
+
+	if (!q || (num_runs && (!values || !counts)))
+		return SR_ERR_ARG;
+
+	for (idx = 0; idx < num_runs; idx++) {
+		ret = feed_queue_logic_submit(q, values, counts[idx]);
+		if (ret != SR_OK)
+			return ret;
+		values += q->unit_size;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Get space for @a count samples in the queue's buffer. The caller
+ * writes the sample data there directly, and then commits the number
+ * of samples it wrote. Pending samples get sent first when the free
+ * space is too small. Not available in RLE mode.
+ */
+SR_API uint8_t *feed_queue_logic_reserve(struct feed_queue_logic *q,
+	size_t count)
+{
+
+	if (!q || q->run_lengths || count > q->alloc_count)
+		return NULL;
+
+	if (q->fill_count + count > q->alloc_count) {
+		if (feed_queue_logic_flush(q) != SR_OK)
+			return NULL;
+	}
+
+	return &q->data_bytes[q->fill_count * q->unit_size];
+}
+
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q,
+	size_t count)
+{
+
+	if (!q || q->run_lengths || q->fill_count + count > q->alloc_count)
+		return SR_ERR_ARG;
+
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_logic_flush(q);
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		return feed_queue_logic_flush(q);
 
 	return SR_OK;
 }
@@ -86,11 +436,127 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 	if (!q->fill_count)
 		return SR_OK;
 
+	SR_PROBE3(feed_queue__flush, q->sdi, q->fill_count, q->unit_size);
+	q->latency.oldest_us = 0;
 	q->logic.length = q->fill_count * q->unit_size;
-	ret = sr_session_send(q->sdi, &q->packet);
+	q->logic_rle.num_runs = q->fill_count;
+	if (!q->pool || q->packet.type != SR_DF_LOGIC) {
+		ret = sr_session_send_info(q->sdi, &q->packet, &q->info);
+		q->info.dropped_samples = 0;
+		if (ret != SR_OK)
+			return ret;
+		q->fill_count = 0;
+		return SR_OK;
+	}
+
+	/* Lend the buffer, and continue with another one. */
+	ret = sr_session_send_lent_info(q->sdi, &q->packet, &q->info,
+		feed_queue_pool_put, q->buffer);
+	q->info.dropped_samples = 0;
+	q->fill_count = 0;
+	q->buffer = feed_queue_pool_get(q->pool);
+	if (!q->buffer) {
+		q->data_bytes = NULL;
+		return SR_ERR_MALLOC;
+	}
+	q->data_bytes = q->buffer->data;
+	q->logic.data = q->data_bytes;
+	q->logic_rle.values = q->data_bytes;
+
+	return ret;
+}
+
+/*
+ * Have the queue rotate through up to @a num_buffers buffers. Flushing
+ * then does not wait for the session's consumers to be done with the
+ * sample data, which lets producer and consumer overlap when packets
+ * get delivered asynchronously. With all buffers in flight, flushing
+ * waits for one to come back. Values below 2 return to a single buffer
+ * which gets reused right after sending. RLE packets always get sent
+ * from a single buffer.
+ */
+SR_API int feed_queue_logic_set_buffers(struct feed_queue_logic *q,
+	size_t num_buffers)
+{
+	uint8_t *data;
+	size_t size;
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+	if (num_buffers > 1 && q->pool) {
+		q->pool->max_buffers = num_buffers;
+		return SR_OK;
+	}
+	if (num_buffers <= 1 && !q->pool)
+		return SR_OK;
+
+	ret = feed_queue_logic_flush(q);
 	if (ret != SR_OK)
 		return ret;
-	q->fill_count = 0;
+
+	size = q->alloc_count * q->unit_size;
+	if (num_buffers > 1) {
+		q->pool = feed_queue_pool_new(q->sdi, size, num_buffers);
+		q->buffer = feed_queue_pool_get(q->pool);
+		if (!q->buffer) {
+			feed_queue_pool_unref(q->pool);
+			q->pool = NULL;
+			return SR_ERR_MALLOC;
+		}
+		sr_large_buffer_free(q->data_bytes);
+		sr_mem_account_release(q->account, size);
+		data = q->buffer->data;
+	} else {
+		data = sr_large_buffer_alloc(size, sr_dev_numa_node(q->sdi));
+		if (!data)
+			return SR_ERR_MALLOC;
+		sr_mem_account_charge(q->account, size);
+		feed_queue_pool_put(q->buffer);
+		feed_queue_pool_unref(q->pool);
+		q->buffer = NULL;
+		q->pool = NULL;
+	}
+	q->data_bytes = data;
+	q->logic.data = q->data_bytes;
+	q->logic_rle.values = q->data_bytes;
+
+	return SR_OK;
+}
+
+/*
+ * Note the host monotonic time at which the data which gets submitted
+ * next arrived, e.g. the USB transfer's completion. Packets carry the
+ * most recent time of their data, see sr_packet_info_get().
+ */
+SR_API int feed_queue_logic_set_time(struct feed_queue_logic *q,
+	int64_t host_time_us)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	q->info.host_time_us = host_time_us;
+
+	return SR_OK;
+}
+
+/*
+ * Note that samples were lost before the data which gets submitted next.
+ * Queued data gets sent first, so the gap is at a packet boundary.
+ */
+SR_API int feed_queue_logic_drop(struct feed_queue_logic *q,
+	uint64_t count)
+{
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	ret = feed_queue_logic_flush(q);
+	if (ret != SR_OK)
+		return ret;
+	q->info.dropped_samples += count;
 
 	return SR_OK;
 }
@@ -110,13 +576,52 @@ SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q)
 	return SR_OK;
 }
 
+static gboolean feed_queue_logic_latency_cb(void *cb_data)
+{
+	struct feed_queue_logic *q;
+
+	q = cb_data;
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		(void)feed_queue_logic_flush(q);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Bound the time which submitted samples may spend in the queue, in
+ * addition to flushing when the queue is full. A session timer flushes
+ * queues which don't receive more data. Callers submit from the event
+ * loop which the queue was configured from (the timer runs there). A
+ * latency of 0 removes the bound.
+ */
+SR_API int feed_queue_logic_set_latency(struct feed_queue_logic *q,
+	unsigned int latency_ms)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	return feed_queue_latency_set(&q->latency, q->sdi, latency_ms,
+		feed_queue_logic_latency_cb, q);
+}
+
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 {
 
 	if (!q)
 		return;
 
-	g_free(q->data_bytes);
+	sr_session_timer_remove(q->latency.timer);
+
+	if (q->pool) {
+		if (q->buffer)
+			feed_queue_pool_put(q->buffer);
+		feed_queue_pool_unref(q->pool);
+	} else {
+		sr_large_buffer_free(q->data_bytes);
+	}
+	g_free(q->run_lengths);
+	sr_mem_account_free(q->account);
 	g_free(q);
 }
 
@@ -125,6 +630,9 @@ struct feed_queue_analog {
 	size_t alloc_count;
 	size_t fill_count;
 	float *data_values;
+	struct feed_queue_pool *pool;
+	struct feed_queue_buffer *buffer;
+	struct sr_mem_account *account;
 	int digits;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -133,6 +641,8 @@ struct feed_queue_analog {
 	struct sr_analog_spec spec;
 	GSList *channels;
 	float scale_factor;
+	struct sr_datafeed_packet_info info;
+	struct feed_queue_latency latency;
 };
 
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
@@ -144,11 +654,16 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
+	q->data_values = sr_large_buffer_alloc(q->alloc_count * sizeof(float),
+		sr_dev_numa_node(sdi));
 	if (!q->data_values) {
 		g_free(q);
 		return NULL;
 	}
+	sr_large_buffer_prefault(q->data_values);
+	q->account = sr_mem_account_new(sdi ? sdi->session : NULL,
+		"feed-queue");
+	sr_mem_account_charge(q->account, q->alloc_count * sizeof(float));
 	q->digits = digits;
 	q->channels = g_slist_append(NULL, ch);
 
@@ -202,6 +717,51 @@ SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 				return ret;
 		}
 	}
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		return feed_queue_analog_flush(q);
+
+	return SR_OK;
+}
+
+/*
+ * Get space for @a count values in the queue's buffer, like
+ * feed_queue_logic_reserve() does. The scale factor gets applied to
+ * the values upon commit.
+ */
+SR_API float *feed_queue_analog_reserve(struct feed_queue_analog *q,
+	size_t count)
+{
+
+	if (!q || count > q->alloc_count)
+		return NULL;
+
+	if (q->fill_count + count > q->alloc_count) {
+		if (feed_queue_analog_flush(q) != SR_OK)
+			return NULL;
+	}
+
+	return &q->data_values[q->fill_count];
+}
+
+SR_API int feed_queue_analog_commit(struct feed_queue_analog *q,
+	size_t count)
+{
+	float *values;
+	size_t idx;
+
+	if (!q || q->fill_count + count > q->alloc_count)
+		return SR_ERR_ARG;
+
+	if (q->scale_factor) {
+		values = &q->data_values[q->fill_count];
+		for (idx = 0; idx < count; idx++)
+			values[idx] *= q->scale_factor;
+	}
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_analog_flush(q);
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		return feed_queue_analog_flush(q);
 
 	return SR_OK;
 }
@@ -213,22 +773,151 @@ SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 	if (!q->fill_count)
 		return SR_OK;
 
+	q->latency.oldest_us = 0;
 	q->analog.num_samples = q->fill_count;
-	ret = sr_session_send(q->sdi, &q->packet);
+	if (!q->pool) {
+		ret = sr_session_send_info(q->sdi, &q->packet, &q->info);
+		q->info.dropped_samples = 0;
+		if (ret != SR_OK)
+			return ret;
+		q->fill_count = 0;
+		return SR_OK;
+	}
+
+	/* Lend the buffer, and continue with another one. */
+	ret = sr_session_send_lent_info(q->sdi, &q->packet, &q->info,
+		feed_queue_pool_put, q->buffer);
+	q->info.dropped_samples = 0;
+	q->fill_count = 0;
+	q->buffer = feed_queue_pool_get(q->pool);
+	if (!q->buffer) {
+		q->data_values = NULL;
+		return SR_ERR_MALLOC;
+	}
+	q->data_values = q->buffer->data;
+	q->analog.data = q->data_values;
+
+	return ret;
+}
+
+/* Rotate through several buffers, see feed_queue_logic_set_buffers(). */
+SR_API int feed_queue_analog_set_buffers(struct feed_queue_analog *q,
+	size_t num_buffers)
+{
+	float *data;
+	size_t size;
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+	if (num_buffers > 1 && q->pool) {
+		q->pool->max_buffers = num_buffers;
+		return SR_OK;
+	}
+	if (num_buffers <= 1 && !q->pool)
+		return SR_OK;
+
+	ret = feed_queue_analog_flush(q);
 	if (ret != SR_OK)
 		return ret;
-	q->fill_count = 0;
+
+	size = q->alloc_count * sizeof(float);
+	if (num_buffers > 1) {
+		q->pool = feed_queue_pool_new(q->sdi, size, num_buffers);
+		q->buffer = feed_queue_pool_get(q->pool);
+		if (!q->buffer) {
+			feed_queue_pool_unref(q->pool);
+			q->pool = NULL;
+			return SR_ERR_MALLOC;
+		}
+		sr_large_buffer_free(q->data_values);
+		sr_mem_account_release(q->account, size);
+		data = q->buffer->data;
+	} else {
+		data = sr_large_buffer_alloc(size, sr_dev_numa_node(q->sdi));
+		if (!data)
+			return SR_ERR_MALLOC;
+		sr_mem_account_charge(q->account, size);
+		feed_queue_pool_put(q->buffer);
+		feed_queue_pool_unref(q->pool);
+		q->buffer = NULL;
+		q->pool = NULL;
+	}
+	q->data_values = data;
+	q->analog.data = q->data_values;
 
 	return SR_OK;
 }
 
+/* See feed_queue_logic_set_time(). */
+SR_API int feed_queue_analog_set_time(struct feed_queue_analog *q,
+	int64_t host_time_us)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	q->info.host_time_us = host_time_us;
+
+	return SR_OK;
+}
+
+/* See feed_queue_logic_drop(). */
+SR_API int feed_queue_analog_drop(struct feed_queue_analog *q,
+	uint64_t count)
+{
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	ret = feed_queue_analog_flush(q);
+	if (ret != SR_OK)
+		return ret;
+	q->info.dropped_samples += count;
+
+	return SR_OK;
+}
+
+static gboolean feed_queue_analog_latency_cb(void *cb_data)
+{
+	struct feed_queue_analog *q;
+
+	q = cb_data;
+	if (feed_queue_latency_due(&q->latency, q->fill_count))
+		(void)feed_queue_analog_flush(q);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* See feed_queue_logic_set_latency(). */
+SR_API int feed_queue_analog_set_latency(struct feed_queue_analog *q,
+	unsigned int latency_ms)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	return feed_queue_latency_set(&q->latency, q->sdi, latency_ms,
+		feed_queue_analog_latency_cb, q);
+}
+
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 {
 
 	if (!q)
 		return;
 
-	g_free(q->data_values);
+	sr_session_timer_remove(q->latency.timer);
+
+	if (q->pool) {
+		if (q->buffer)
+			feed_queue_pool_put(q->buffer);
+		feed_queue_pool_unref(q->pool);
+	} else {
+		sr_large_buffer_free(q->data_values);
+	}
 	g_slist_free(q->channels);
+	sr_mem_account_free(q->account);
 	g_free(q);
 }
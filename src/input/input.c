@@ -31,6 +31,10 @@
 
 /** @cond PRIVATE */
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+/* Default number of chunks which sr_input_run_file() reads ahead. */
+#define READ_AHEAD	4
+/* Datafeed ring depth of sr_input_run_file(), for sessions without one. */
+#define RUN_RING_DEPTH	64
 /** @endcond */
 
 /**
@@ -73,6 +77,7 @@ extern SR_PRIV struct sr_input_module input_wav;
 extern SR_PRIV struct sr_input_module input_raw_analog;
 extern SR_PRIV struct sr_input_module input_logicport;
 extern SR_PRIV struct sr_input_module input_saleae;
+extern SR_PRIV struct sr_input_module input_srcap;
 extern SR_PRIV struct sr_input_module input_null;
 /** @endcond */
 
@@ -89,6 +94,7 @@ static const struct sr_input_module *input_module_list[] = {
 	&input_raw_analog,
 	&input_logicport,
 	&input_saleae,
+	&input_srcap,
 	&input_null,
 	NULL,
 };
@@ -344,6 +350,70 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
 	return TRUE;
 }
 
+/* Returns TRUE if one of the module's byte signatures is in the header. */
+static gboolean magic_found(const struct sr_input_module *imod,
+		const GString *header)
+{
+	const struct sr_input_magic *magic;
+
+	if (!imod->magic || !header)
+		return FALSE;
+	for (magic = imod->magic; magic->len; magic++) {
+		if (header->len < magic->offset + magic->len)
+			continue;
+		if (memcmp(&header->str[magic->offset], magic->bytes, magic->len) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Returns TRUE if the filename has one of the module's extensions. */
+static gboolean extension_found(const struct sr_input_module *imod,
+		const char *filename)
+{
+	const char *const *ext;
+	size_t fn_len, ext_len;
+
+	if (!imod->exts || !filename)
+		return FALSE;
+	fn_len = strlen(filename);
+	for (ext = imod->exts; *ext; ext++) {
+		ext_len = strlen(*ext);
+		if (fn_len < 1 + ext_len)
+			continue;
+		if (filename[fn_len - ext_len - 1] != '.')
+			continue;
+		if (g_ascii_strcasecmp(&filename[fn_len - ext_len], *ext) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Pre-filter input modules by their byte signatures, before running
+ * their potentially expensive format_match() routines. The first pass
+ * only considers the modules whose signatures are found. The second
+ * pass considers all other modules, except those which have signatures
+ * that are not found, and don't have the filename's extension either.
+ */
+static gboolean is_candidate(const struct sr_input_module *imod,
+		const GString *header, const char *filename, int pass)
+{
+	gboolean found;
+
+	found = magic_found(imod, header);
+	if (pass == 0)
+		return found;
+	if (found)
+		return FALSE;
+	if (!imod->magic)
+		return TRUE;
+
+	return extension_found(imod, filename);
+}
+
 /**
  * Try to find an input module that can parse the given buffer.
  *
@@ -371,7 +441,7 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 	GHashTable *meta;
 	unsigned int m, i;
 	unsigned int conf, best_conf;
-	int ret;
+	int ret, pass;
 	uint8_t mitem, avail_metadata[8];
 
 	/* No more metadata to be had from a buffer. */
@@ -381,48 +451,53 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 	*in = NULL;
 	best_imod = NULL;
 	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		meta = g_hash_table_new(NULL, NULL);
-		for (m = 0; m < sizeof(imod->metadata); m++) {
-			mitem = imod->metadata[m] & ~SR_INPUT_META_REQUIRED;
-			if (mitem == SR_INPUT_META_HEADER)
-				g_hash_table_insert(meta, GINT_TO_POINTER(mitem), buf);
-		}
-		if (g_hash_table_size(meta) == 0) {
-			/* No metadata for this module, so nothing to match. */
+	/* Modules with found signatures first, then all others. */
+	for (pass = 0; pass < 2 && !best_imod; pass++) {
+		for (i = 0; input_module_list[i]; i++) {
+			imod = input_module_list[i];
+			if (!is_candidate(imod, buf, NULL, pass))
+				continue;
+			if (!imod->metadata[0]) {
+				/* Module has no metadata for matching so will take
+				 * any input. No point in letting it try to match. */
+				continue;
+			}
+			if (!check_required_metadata(imod->metadata, avail_metadata))
+				/* Cannot satisfy this module's requirements. */
+				continue;
+
+			meta = g_hash_table_new(NULL, NULL);
+			for (m = 0; m < sizeof(imod->metadata); m++) {
+				mitem = imod->metadata[m] & ~SR_INPUT_META_REQUIRED;
+				if (mitem == SR_INPUT_META_HEADER)
+					g_hash_table_insert(meta, GINT_TO_POINTER(mitem), buf);
+			}
+			if (g_hash_table_size(meta) == 0) {
+				/* No metadata for this module, so nothing to match. */
+				g_hash_table_destroy(meta);
+				continue;
+			}
+			sr_spew("Trying module %s.", imod->id);
+			ret = imod->format_match(meta, &conf);
 			g_hash_table_destroy(meta);
-			continue;
-		}
-		sr_spew("Trying module %s.", imod->id);
-		ret = imod->format_match(meta, &conf);
-		g_hash_table_destroy(meta);
-		if (ret == SR_ERR_DATA) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
-		} else if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Can be SR_ERR_NA. */
-			continue;
-		}
+			if (ret == SR_ERR_DATA) {
+				/* Module recognized this buffer, but cannot handle it. */
+				continue;
+			} else if (ret == SR_ERR) {
+				/* Module didn't recognize this buffer. */
+				continue;
+			} else if (ret != SR_OK) {
+				/* Can be SR_ERR_NA. */
+				continue;
+			}
 
-		/* Found a matching module. */
-		sr_spew("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
+			/* Found a matching module. */
+			sr_spew("Module %s matched, confidence %u.", imod->id, conf);
+			if (conf >= best_conf)
+				continue;
+			best_imod = imod;
+			best_conf = conf;
+		}
 	}
 
 	if (best_imod) {
@@ -453,7 +528,7 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 	size_t count;
 	unsigned int midx, i;
 	unsigned int conf, best_conf;
-	int ret;
+	int ret, pass;
 	uint8_t avail_metadata[8];
 
 	*in = NULL;
@@ -501,33 +576,38 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 
 	best_imod = NULL;
 	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		sr_dbg("Trying module %s.", imod->id);
-
-		ret = imod->format_match(meta, &conf);
-		if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
+	/* Modules with found signatures first, then all others. */
+	for (pass = 0; pass < 2 && !best_imod; pass++) {
+		for (i = 0; input_module_list[i]; i++) {
+			imod = input_module_list[i];
+			if (!is_candidate(imod, header, filename, pass))
+				continue;
+			if (!imod->metadata[0]) {
+				/* Module has no metadata for matching so will take
+				 * any input. No point in letting it try to match. */
+				continue;
+			}
+			if (!check_required_metadata(imod->metadata, avail_metadata))
+				/* Cannot satisfy this module's requirements. */
+				continue;
+
+			sr_dbg("Trying module %s.", imod->id);
+
+			ret = imod->format_match(meta, &conf);
+			if (ret == SR_ERR) {
+				/* Module didn't recognize this buffer. */
+				continue;
+			} else if (ret != SR_OK) {
+				/* Module recognized this buffer, but cannot handle it. */
+				continue;
+			}
+			/* Found a matching module. */
+			sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
+			if (conf >= best_conf)
+				continue;
+			best_imod = imod;
+			best_conf = conf;
 		}
-		/* Found a matching module. */
-		sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
 	}
 	g_hash_table_destroy(meta);
 	g_string_free(header, TRUE);
@@ -597,6 +677,130 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+/**
+ * Send a window of a memory mapped file to the specified input instance.
+ *
+ * This is an alternative to sr_input_send() for frontends which map the
+ * input file into memory. Input modules which support it slice the
+ * window directly into datafeed packets, so the sample data is neither
+ * copied into a heap buffer, nor moved around there. Other modules get
+ * a copy of the window passed to their regular receive routine.
+ *
+ * The module may not process the whole window, e.g. when it ends in
+ * a partial sample, or when the device instance just became ready (see
+ * sr_input_send()). The number of processed bytes is returned in
+ * @a consumed, and the caller passes the remaining data again at the
+ * start of the next window. The data is not used after the call
+ * returned.
+ *
+ * Transforms may modify sample data in place. Read-only file data hence
+ * needs to get mapped privately and writable (copy-on-write), as e.g.
+ * g_mapped_file_new() with @a writable set does.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param data The start of the window.
+ * @param length The size of the window in bytes.
+ * @param consumed Receives the number of processed bytes. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Negative error code returned by the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_mapped(const struct sr_input *in,
+		void *data, size_t length, size_t *consumed)
+{
+	GString *buf;
+	int ret;
+
+	if (!in || !consumed || (!data && length))
+		return SR_ERR_ARG;
+
+	*consumed = 0;
+	sr_spew("Sending %zu mapped bytes to %s module.", length, in->module->id);
+	if (in->module->receive_mapped) {
+		return in->module->receive_mapped((struct sr_input *)in,
+			data, length, consumed);
+	}
+
+	buf = g_string_new_len(data, length);
+	ret = in->module->receive((struct sr_input *)in, buf);
+	g_string_free(buf, TRUE);
+	if (ret == SR_OK)
+		*consumed = length;
+
+	return ret;
+}
+
+/**
+ * Append received data to the input instance's buffer.
+ *
+ * The buffer is a gap buffer. Data which modules processed is not
+ * removed right away by sr_input_buf_consume(), but when the next data
+ * gets appended, and only when the processed part is at least as large
+ * as the unprocessed remainder. Moving data hence costs amortized
+ * constant time per byte, regardless of how small the pieces are which
+ * a frontend feeds in.
+ *
+ * @param in The input instance.
+ * @param data The data to append.
+ * @param length The number of bytes to append.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_append(struct sr_input *in,
+		const char *data, size_t length)
+{
+	if (in->buf_consumed &&
+			in->buf_consumed >= in->buf->len - in->buf_consumed) {
+		g_string_erase(in->buf, 0, in->buf_consumed);
+		in->buf_consumed = 0;
+	}
+	g_string_append_len(in->buf, data, length);
+}
+
+/**
+ * Get the start of the unprocessed data in the input instance's buffer.
+ *
+ * The pointer is valid until the next sr_input_buf_append() call. The
+ * unprocessed data is always followed by a NUL character.
+ *
+ * @private
+ */
+SR_PRIV char *sr_input_buf_ptr(const struct sr_input *in)
+{
+	return in->buf->str + in->buf_consumed;
+}
+
+/**
+ * Get the number of unprocessed bytes in the input instance's buffer.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_input_buf_len(const struct sr_input *in)
+{
+	return in->buf->len - in->buf_consumed;
+}
+
+/**
+ * Mark data at the start of the input instance's buffer as processed.
+ *
+ * @param in The input instance.
+ * @param length The number of processed bytes, at most the number of
+ *               unprocessed bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t length)
+{
+	in->buf_consumed += MIN(length, sr_input_buf_len(in));
+	if (in->buf_consumed == in->buf->len) {
+		g_string_truncate(in->buf, 0);
+		in->buf_consumed = 0;
+	}
+}
+
 /**
  * Signal the input module no more data will come.
  *
@@ -611,6 +815,177 @@ SR_API int sr_input_end(const struct sr_input *in)
 	return in->module->end((struct sr_input *)in);
 }
 
+/* A chunk of the file which the reader thread passes to the parser. */
+struct run_chunk {
+	GString *buf;
+	/* The end of the file, or a read error. */
+	gboolean last;
+	int ret;
+};
+
+struct run_reader {
+	FILE *stream;
+	const char *filename;
+	/* Empty chunks, and chunks which were read. */
+	GAsyncQueue *free_chunks;
+	GAsyncQueue *full_chunks;
+	gint abort;
+};
+
+static gpointer run_reader_thread(gpointer data)
+{
+	struct run_reader *reader;
+	struct run_chunk *chunk;
+	size_t count;
+
+	reader = data;
+	for (;;) {
+		chunk = g_async_queue_pop(reader->free_chunks);
+		if (g_atomic_int_get(&reader->abort)) {
+			g_async_queue_push(reader->free_chunks, chunk);
+			break;
+		}
+		count = fread(chunk->buf->str, 1, CHUNK_SIZE, reader->stream);
+		g_string_set_size(chunk->buf, count);
+		if (ferror(reader->stream)) {
+			sr_err("Failed to read %s: %s", reader->filename,
+				g_strerror(errno));
+			chunk->ret = SR_ERR_IO;
+			chunk->last = TRUE;
+		} else if (feof(reader->stream)) {
+			chunk->last = TRUE;
+		}
+		g_async_queue_push(reader->full_chunks, chunk);
+		if (chunk->last)
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * Feed a file to an input instance, with reading, parsing and delivery
+ * overlapping each other.
+ *
+ * This is an alternative to feeding the file with sr_input_send() and
+ * sr_input_end(), for file-to-file conversions which use several cores.
+ * A reader thread reads up to @a depth chunks of the file ahead. The
+ * calling thread runs the input module on them. The datafeed callbacks
+ * of @a session run on the session's delivery thread, the datafeed ring
+ * (see sr_session_datafeed_ring_set()) gets set up for this run when the
+ * session is not running. The queues between the stages are bounded,
+ * the stages wait when the next one falls behind.
+ *
+ * The input instance's device instance gets added to @a session as soon
+ * as it is ready, unless it is in the session already. The run ends with
+ * sr_input_end(), and returns after all packets got delivered.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param filename The file to read. Must not be NULL.
+ * @param session The session to deliver the packets to. Must not be NULL.
+ * @param depth The number of chunks to read ahead, 0 for a default.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO The file cannot be read.
+ * @retval other Error code returned by the input module, or by
+ *               sr_session_dev_add().
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_run_file(const struct sr_input *in, const char *filename,
+		struct sr_session *session, unsigned int depth)
+{
+	struct run_reader reader;
+	struct run_chunk *chunks, *chunk;
+	struct sr_dev_inst *sdi;
+	GThread *thread;
+	GError *error;
+	gboolean own_ring, last;
+	unsigned int i;
+	int ret;
+
+	if (!in || !filename || !session)
+		return SR_ERR_ARG;
+	if (!depth)
+		depth = READ_AHEAD;
+
+	reader.filename = filename;
+	reader.stream = g_fopen(filename, "rb");
+	if (!reader.stream) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	reader.free_chunks = g_async_queue_new();
+	reader.full_chunks = g_async_queue_new();
+	reader.abort = 0;
+	chunks = g_malloc0_n(depth, sizeof(chunks[0]));
+	for (i = 0; i < depth; i++) {
+		chunks[i].buf = g_string_sized_new(CHUNK_SIZE + 1);
+		g_async_queue_push(reader.free_chunks, &chunks[i]);
+	}
+
+	own_ring = !session->ring && !session->running;
+	ret = SR_OK;
+	if (own_ring) {
+		ret = sr_session_ring_start(session, session->ring_depth ?
+			session->ring_depth : RUN_RING_DEPTH, FALSE);
+	}
+
+	thread = NULL;
+	if (ret == SR_OK) {
+		error = NULL;
+		thread = g_thread_try_new("sr-input", run_reader_thread,
+			&reader, &error);
+		if (!thread) {
+			sr_err("Cannot create input thread: %s.", error->message);
+			g_error_free(error);
+			ret = SR_ERR;
+		}
+	}
+
+	last = !thread;
+	while (!last) {
+		chunk = g_async_queue_pop(reader.full_chunks);
+		last = chunk->last;
+		ret = chunk->ret;
+		if (ret == SR_OK && chunk->buf->len)
+			ret = sr_input_send(in, chunk->buf);
+		chunk->last = FALSE;
+		chunk->ret = SR_OK;
+		g_async_queue_push(reader.free_chunks, chunk);
+		if (ret != SR_OK)
+			break;
+
+		sdi = sr_input_dev_inst_get(in);
+		if (sdi && !sdi->session) {
+			ret = sr_session_dev_add(session, sdi);
+			if (ret != SR_OK)
+				break;
+		}
+	}
+	if (ret == SR_OK && thread)
+		ret = sr_input_end(in);
+
+	if (thread) {
+		/* Wake up the reader, and let it know to stop. */
+		g_atomic_int_set(&reader.abort, 1);
+		g_async_queue_push(reader.free_chunks, &chunks[0]);
+		g_thread_join(thread);
+	}
+	if (own_ring)
+		sr_session_ring_stop(session);
+
+	fclose(reader.stream);
+	for (i = 0; i < depth; i++)
+		g_string_free(chunks[i].buf, TRUE);
+	g_free(chunks);
+	g_async_queue_unref(reader.free_chunks);
+	g_async_queue_unref(reader.full_chunks);
+
+	return ret;
+}
+
 /**
  * Reset the input module's input handling structures.
  *
@@ -660,6 +1035,7 @@ SR_API int sr_input_reset(const struct sr_input *in_ro)
 	 */
 	if (in->buf)
 		g_string_truncate(in->buf, 0);
+	in->buf_consumed = 0;
 	in->sdi_ready = FALSE;
 
 	return rc;
@@ -689,10 +1065,10 @@ SR_API void sr_input_free(const struct sr_input *in)
 	 * .cleanup() released potentially nested resources under 'inc').
 	 */
 	sr_dev_inst_free(in->sdi);
-	if (in->buf->len > 64) {
+	if (sr_input_buf_len(in) > 64) {
 		/* That seems more than just some sub-unitsize leftover... */
 		sr_warn("Found %" G_GSIZE_FORMAT
-			" unprocessed bytes at free time.", in->buf->len);
+			" unprocessed bytes at free time.", sr_input_buf_len(in));
 	}
 	g_string_free(in->buf, TRUE);
 	g_free(in->priv);
@@ -415,32 +415,38 @@ static int process_inverted_channels(struct context *inc, char **flags)
 	return SR_OK;
 }
 
-static int process_sample_line(struct context *inc, char **values)
+static int process_sample_line(struct context *inc, const char *line)
 {
-	size_t count, idx;
+	size_t idx;
 	struct sample_data_entry *entry;
+	const char *sep;
 	uint64_t mask;
 	long conv_ret;
 	int rc;
 
 	/*
-	 * The 'values' array contains '0'/'1' text representation of
-	 * wire's values, as well as a (a textual representation of a)
-	 * repeat counter for that set of samples.
+	 * The comma separated line contains '0'/'1' text representation
+	 * of wire's values, as well as a (a textual representation of a)
+	 * repeat counter for that set of samples. Sample data is the
+	 * bulk of the file. Inspect the words in place, don't split the
+	 * text into allocated copies.
 	 */
-	count = g_strv_length(values);
-	if (count != inc->channel_count + 1)
-		return SR_ERR_DATA;
 	entry = &inc->sample_data_queue[inc->sample_lines_read];
 	entry->bits = 0;
 	mask = UINT64_C(1);
 	for (idx = 0; idx < inc->channel_count; idx++, mask <<= 1) {
-		if (strcmp(values[idx], "1") == 0)
+		sep = strchr(line, ',');
+		if (!sep)
+			return SR_ERR_DATA;
+		if (sep - line == 1 && line[0] == '1')
 			entry->bits |= mask;
-		if (strcmp(values[idx], "U") == 0)
+		if (sep - line == 1 && line[0] == 'U')
 			inc->wires_undefined |= mask;
+		line = sep + 1;
 	}
-	rc = sr_atol(values[inc->channel_count], &conv_ret);
+	if (strchr(line, ','))
+		return SR_ERR_DATA;
+	rc = sr_atol(line, &conv_ret);
 	if (rc != SR_OK)
 		return rc;
 	entry->repeat = conv_ret;
@@ -489,9 +495,7 @@ static int process_keyvalue_line(struct context *inc, char *line)
 	case SAMPLEDATA_DATA_LINES:
 		while (isspace(*line))
 			line++;
-		args = g_strsplit(line, ",", 0);
-		rc = process_sample_line(inc, args);
-		g_strfreev(args);
+		rc = process_sample_line(inc, line);
 		if (rc)
 			return rc;
 		inc->sample_lines_read++;
@@ -641,7 +645,7 @@ static int have_text_line(struct sr_input *in, char **line, char **next)
 
 	if (!in || !in->buf || !in->buf->str)
 		return 0;
-	sol_ptr = in->buf->str;
+	sol_ptr = sr_input_buf_ptr(in);
 	eol_ptr = strstr(sol_ptr, CRLF);
 	if (!eol_ptr)
 		return 0;
@@ -735,7 +739,7 @@ static int parse_header(struct sr_input *in)
 	inc = in->priv;
 	while (have_text_line(in, &line, &next)) {
 		rc = process_text_line(inc, line);
-		g_string_erase(in->buf, 0, next - line);
+		sr_input_buf_consume(in, next - line);
 		if (rc)
 			return rc;
 	}
@@ -863,7 +867,7 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 	struct context *inc;
 	uint8_t sample_buffer[sizeof(uint64_t)];
 	size_t idx;
-	size_t copy_count;
+	size_t copy_count, filled, length;
 	uint8_t *p;
 	int rc;
 
@@ -878,12 +882,20 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 			copy_count = count;
 		count -= copy_count;
 
+		/*
+		 * Repeat counts can be large. Fill in the first copy,
+		 * then duplicate what was written so far.
+		 */
 		p = inc->feed_buffer + inc->samples_in_buffer * inc->unitsize;
-		while (copy_count-- > 0) {
-			memcpy(p, sample_buffer, inc->unitsize);
-			p += inc->unitsize;
-			inc->samples_in_buffer++;
+		memcpy(p, sample_buffer, inc->unitsize);
+		filled = 1;
+		while (filled < copy_count) {
+			length = MIN(filled, copy_count - filled);
+			memcpy(p + filled * inc->unitsize, p,
+				length * inc->unitsize);
+			filled += length;
 		}
+		inc->samples_in_buffer += copy_count;
 
 		if (inc->samples_in_buffer == inc->samples_per_chunk) {
 			rc = send_buffer(in);
@@ -1041,7 +1053,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int rc;
 
 	/* Accumulate another chunk of input data. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	/*
 	 * Wait for the full header's availability, then process it in a
@@ -152,10 +152,11 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send the complete samples of the data, return their size in bytes. */
+static size_t send_samples(struct sr_input *in, uint8_t *data, size_t length)
 {
 	struct context *inc;
-	unsigned int offset, chunk_size;
+	size_t offset, chunk_size;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -174,29 +175,31 @@ static int process_buffer(struct sr_input *in)
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	offset = 0;
 
-	while ((offset + chunk_size) < in->buf->len) {
-		inc->analog.data = in->buf->str + offset;
+	while ((offset + chunk_size) < length) {
+		inc->analog.data = data + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	inc->analog.num_samples = (in->buf->len - offset) / inc->samplesize;
+	inc->analog.num_samples = (length - offset) / inc->samplesize;
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	if (chunk_size > 0) {
-		inc->analog.data = in->buf->str + offset;
+		inc->analog.data = data + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	if ((unsigned int)offset < in->buf->len) {
-		/*
-		 * The incoming buffer wasn't processed completely. Stash
-		 * the leftover data for next time.
-		 */
-		g_string_erase(in->buf, 0, offset);
-	} else {
-		g_string_truncate(in->buf, 0);
-	}
+	return offset;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	size_t offset;
+
+	/* Leftover data of partial samples is kept for next time. */
+	offset = send_samples(in, (uint8_t *)sr_input_buf_ptr(in),
+		sr_input_buf_len(in));
+	sr_input_buf_consume(in, offset);
 
 	return SR_OK;
 }
@@ -205,7 +208,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -218,6 +221,33 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+		size_t length, size_t *consumed)
+{
+	struct context *inc;
+	size_t fill;
+
+	if (!in->sdi_ready) {
+		/* sdi is ready, notify frontend. No data is needed for that. */
+		in->sdi_ready = TRUE;
+		return SR_OK;
+	}
+
+	inc = in->priv;
+	if (sr_input_buf_len(in)) {
+		/* Flush data of earlier sr_input_send() calls first. */
+		process_buffer(in);
+		fill = MIN(length, inc->samplesize - sr_input_buf_len(in));
+		sr_input_buf_append(in, (const char *)data, fill);
+		*consumed = fill;
+		return process_buffer(in);
+	}
+
+	*consumed = send_samples(in, data, length);
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -287,6 +317,7 @@ SR_PRIV struct sr_input_module input_raw_analog = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
@@ -374,30 +374,72 @@ static int flush_feed_buffer(struct sr_input *in)
 	return sr_session_send(in->sdi, &packet);
 }
 
+/* Account for samples which were written, flush a full buffer. */
+static int commit_feed_buffer(struct sr_input *in, size_t count)
+{
+	struct context *inc;
+
+	inc = in->priv;
+
+	inc->feed.samples_in_buffer += count;
+	if (inc->feed.samples_in_buffer < inc->feed.samples_per_chunk)
+		return SR_OK;
+
+	return flush_feed_buffer(in);
+}
+
+/* Get the number of samples which still fit into the feed buffer. */
+static size_t space_in_feed_buffer(struct context *inc)
+{
+	return inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+}
+
+/*
+ * Add a run of samples of the same value. Fills the feed buffer in
+ * blocks, with a loop per unit size, instead of checking the unit
+ * size and the buffer's fill level for every individual sample.
+ */
 static int addto_feed_buffer_logic(struct sr_input *in,
 	uint64_t data, size_t count)
 {
 	struct context *inc;
+	size_t chunk, idx;
+	uint8_t *pos;
+	int rc;
 
 	inc = in->priv;
 
 	if (inc->feed.is_analog)
 		return SR_ERR_ARG;
 
-	while (count--) {
-		if (inc->feed.unit_size == sizeof(uint64_t))
-			write_u64le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint32_t))
-			write_u32le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint16_t))
-			write_u16le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint8_t))
-			write_u8_inc(&inc->feed.write_pos, data);
-		else
+	while (count) {
+		chunk = MIN(count, space_in_feed_buffer(inc));
+		pos = inc->feed.write_pos;
+		switch (inc->feed.unit_size) {
+		case sizeof(uint64_t):
+			for (idx = 0; idx < chunk; idx++)
+				write_u64le_inc(&pos, data);
+			break;
+		case sizeof(uint32_t):
+			for (idx = 0; idx < chunk; idx++)
+				write_u32le_inc(&pos, data);
+			break;
+		case sizeof(uint16_t):
+			for (idx = 0; idx < chunk; idx++)
+				write_u16le_inc(&pos, data);
+			break;
+		case sizeof(uint8_t):
+			memset(pos, data & 0xff, chunk);
+			pos += chunk;
+			break;
+		default:
 			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
-		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
-			flush_feed_buffer(in);
+		}
+		inc->feed.write_pos = pos;
+		count -= chunk;
+		rc = commit_feed_buffer(in, chunk);
+		if (rc)
+			return rc;
 	}
 
 	return SR_OK;
@@ -407,22 +449,30 @@ static int addto_feed_buffer_analog(struct sr_input *in,
 	float data, size_t count)
 {
 	struct context *inc;
+	size_t chunk, idx;
+	uint8_t *pos;
+	int rc;
 
 	inc = in->priv;
 
 	if (!inc->feed.is_analog)
 		return SR_ERR_ARG;
-
-	while (count--) {
-		if (sizeof(inc->feed.buffer_analog[0]) == sizeof(float))
-			write_fltle_inc(&inc->feed.write_pos, data);
-		else if (sizeof(inc->feed.buffer_analog[0]) == sizeof(double))
-			write_dblle_inc(&inc->feed.write_pos, data);
-		else
-			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
-		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
-			flush_feed_buffer(in);
+	if (sizeof(inc->feed.buffer_analog[0]) != sizeof(float))
+		return SR_ERR_BUG;
+
+	while (count) {
+		chunk = MIN(count, space_in_feed_buffer(inc));
+		pos = inc->feed.write_pos;
+		/* The feed buffer holds host order floats. */
+		for (idx = 0; idx < chunk; idx++) {
+			memcpy(pos, &data, sizeof(data));
+			pos += sizeof(data);
+		}
+		inc->feed.write_pos = pos;
+		count -= chunk;
+		rc = commit_feed_buffer(in, chunk);
+		if (rc)
+			return rc;
 	}
 
 	return SR_OK;
@@ -845,6 +895,173 @@ static int parse_next_item(struct sr_input *in,
 	/* UNREACH */
 }
 
+/*
+ * Convert a block of every-value digital words to feed buffer units.
+ * Specialized per input word size, the compiler can unroll each loop.
+ * Returns the last word's value (unchanged when the block is empty).
+ */
+static uint64_t convert_logic_words(struct context *inc,
+	const uint8_t *curr, size_t count, uint64_t last)
+{
+	uint8_t *pos;
+	size_t idx;
+
+	pos = inc->feed.write_pos;
+#define CONVERT_LOGIC_WORDS(read_word, word_size) \
+	for (idx = 0; idx < count; idx++, curr += (word_size)) { \
+		last = read_word(curr); \
+		write_u32le_inc(&pos, last); \
+	}
+	switch (inc->logic_state.word_size) {
+	case sizeof(uint8_t):
+		CONVERT_LOGIC_WORDS(R8, sizeof(uint8_t));
+		break;
+	case sizeof(uint16_t):
+		CONVERT_LOGIC_WORDS(RL16, sizeof(uint16_t));
+		break;
+	case sizeof(uint32_t):
+		CONVERT_LOGIC_WORDS(RL32, sizeof(uint32_t));
+		break;
+	case sizeof(uint64_t):
+		CONVERT_LOGIC_WORDS(RL64, sizeof(uint64_t));
+		break;
+	}
+#undef CONVERT_LOGIC_WORDS
+	inc->feed.write_pos = pos;
+
+	return last;
+}
+
+/*
+ * Process all complete items in the buffer in one go, for those stages
+ * which make up the bulk of the sample data and which don't change
+ * within the data stream. Saves the per item dispatch, the per sample
+ * word size check, and the per sample buffer fill level check. Leaves
+ * all other stages (and unsupported word sizes) to the item by item
+ * code path. Updates the caller's buffer position.
+ */
+static int parse_items_bulk(struct sr_input *in,
+	const uint8_t **buff, size_t *blen)
+{
+	struct context *inc;
+	const uint8_t *curr;
+	size_t want_len, count, chunk;
+	uint64_t next_stamp, digital;
+	double next_time, diff_time;
+	uint8_t *pos;
+	int rc;
+
+	inc = in->priv;
+	curr = *buff;
+
+	/* Unsupported word sizes get reported by the item by item path. */
+	switch (inc->logic_state.word_size) {
+	case sizeof(uint8_t):
+	case sizeof(uint16_t):
+	case sizeof(uint32_t):
+	case sizeof(uint64_t):
+		break;
+	default:
+		return SR_OK;
+	}
+
+	switch (inc->logic_state.stage) {
+	case STAGE_L1D_EVERY_VALUE:
+		if (inc->feed.unit_size != sizeof(uint32_t))
+			return SR_OK;
+		want_len = inc->logic_state.word_size;
+		count = *blen / want_len;
+		digital = inc->feed.last.digital;
+		while (count) {
+			chunk = MIN(count, space_in_feed_buffer(inc));
+			digital = convert_logic_words(inc, curr, chunk, digital);
+			curr += chunk * want_len;
+			count -= chunk;
+			inc->feed.last.digital = digital;
+			inc->feed.last.stamp += chunk;
+			rc = commit_feed_buffer(in, chunk);
+			if (rc)
+				return rc;
+		}
+		break;
+	case STAGE_L1D_CHANGE_VALUE:
+		want_len = sizeof(uint64_t) + inc->logic_state.word_size;
+		count = *blen / want_len;
+		while (count--) {
+			next_stamp = read_u64le_inc(&curr);
+			switch (inc->logic_state.word_size) {
+			case sizeof(uint8_t):
+				digital = R8(curr);
+				break;
+			case sizeof(uint16_t):
+				digital = RL16(curr);
+				break;
+			case sizeof(uint32_t):
+				digital = RL32(curr);
+				break;
+			default:
+				digital = RL64(curr);
+				break;
+			}
+			curr += inc->logic_state.word_size;
+			/* Run of the previous value, then the new value. */
+			rc = addto_feed_buffer_logic(in, inc->feed.last.digital,
+				next_stamp - inc->feed.last.stamp);
+			if (rc)
+				return rc;
+			rc = addto_feed_buffer_logic(in, digital, 1);
+			if (rc)
+				return rc;
+			inc->feed.last.digital = digital;
+			inc->feed.last.stamp = next_stamp;
+		}
+		break;
+	case STAGE_L2D_CHANGE_VALUE:
+		count = *blen / sizeof(double);
+		while (count--) {
+			next_time = read_dblle_inc(&curr);
+			diff_time = next_time - inc->feed.last.time;
+			if (inc->logic_state.l2d.min_time_step > diff_time)
+				inc->logic_state.l2d.min_time_step = diff_time;
+			diff_time /= inc->logic_state.l2d.sample_period;
+			diff_time += 0.5;
+			next_stamp = (uint64_t)diff_time;
+			if (next_stamp) {
+				rc = addto_feed_buffer_logic(in,
+					inc->feed.last.digital, next_stamp);
+				if (rc)
+					return rc;
+				inc->feed.last.time = next_time;
+			}
+			inc->feed.last.digital = 1 - inc->feed.last.digital;
+		}
+		break;
+	case STAGE_L2A_EVERY_VALUE:
+		if (!inc->feed.is_analog)
+			return SR_OK;
+		count = *blen / sizeof(float);
+		while (count) {
+			chunk = MIN(count, space_in_feed_buffer(inc));
+			pos = inc->feed.write_pos;
+			sr_read_fltle_array((float *)(void *)pos, curr, chunk);
+			curr += chunk * sizeof(float);
+			inc->feed.write_pos = pos + chunk * sizeof(float);
+			count -= chunk;
+			rc = commit_feed_buffer(in, chunk);
+			if (rc)
+				return rc;
+		}
+		break;
+	default:
+		return SR_OK;
+	}
+
+	*blen -= curr - *buff;
+	*buff = curr;
+
+	return SR_OK;
+}
+
 static int parse_samples(struct sr_input *in)
 {
 	const uint8_t *buff, *start;
@@ -858,6 +1075,17 @@ static int parse_samples(struct sr_input *in)
 	buff = start;
 	blen = in->buf->len;
 	while (have_next_item(in, buff, blen, &curr, &next)) {
+		/*
+		 * Have the bulk of the sample data processed by tight
+		 * loops. Initial items and stage changes, as well as the
+		 * incomplete item at the end of the buffer, take the item
+		 * by item path.
+		 */
+		rc = parse_items_bulk(in, &buff, &blen);
+		if (rc)
+			return rc;
+		if (!have_next_item(in, buff, blen, &curr, &next))
+			break;
 		len = next - curr;
 		rc = parse_next_item(in, curr, len);
 		if (rc)
@@ -1201,6 +1429,10 @@ SR_PRIV struct sr_input_module input_saleae = {
 	.desc = "Saleae Logic software export files",
 	.exts = (const char *[]){"bin", NULL},
 #endif
+	.magic = (const struct sr_input_magic[]){
+		{ 0, LOGIC2_MAGIC, sizeof(LOGIC2_MAGIC) - 1 },
+		ALL_ZERO,
+	},
 	.metadata = {
 		SR_INPUT_META_FILENAME,
 		SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED
@@ -0,0 +1,323 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Read uncompressed capture files, as written by the srcap output
+ * module. See capture_file.c for the file layout.
+ *
+ * The extents are walked in file order, so the index at the end of the
+ * file is not needed here. Sample data is sent as is, there is nothing
+ * to decode. Applications which can map the file should rather use the
+ * sr_capture_file_*() API, which avoids copying the data altogether.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "input/srcap"
+
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+struct context {
+	gboolean got_header;
+	gboolean channels_created;
+	gboolean started;
+	gboolean done;
+	struct sr_capfile_header header;
+	struct sr_channel **analog_channels;
+	/* The extent which currently is being read. */
+	uint32_t group;
+	uint64_t remain;
+	uint64_t skip;
+};
+
+static int format_match(GHashTable *metadata, unsigned int *confidence)
+{
+	GString *buf;
+
+	buf = g_hash_table_lookup(metadata, GINT_TO_POINTER(SR_INPUT_META_HEADER));
+	if (!buf || buf->len < strlen(SR_CAPFILE_MAGIC))
+		return SR_ERR;
+	if (memcmp(buf->str, SR_CAPFILE_MAGIC, strlen(SR_CAPFILE_MAGIC)) != 0)
+		return SR_ERR;
+
+	*confidence = 1;
+
+	return SR_OK;
+}
+
+static int init(struct sr_input *in, GHashTable *options)
+{
+	(void)options;
+
+	in->sdi = g_malloc0(sizeof(struct sr_dev_inst));
+	in->priv = g_malloc0(sizeof(struct context));
+
+	return SR_OK;
+}
+
+static int parse_header(struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_capfile_header *hdr;
+	unsigned int idx;
+	int ret;
+
+	inc = in->priv;
+	hdr = &inc->header;
+	ret = sr_capfile_header_parse((const uint8_t *)in->buf->str,
+		in->buf->len, hdr);
+	if (ret == SR_ERR_NA)
+		return SR_OK;
+	if (ret != SR_OK)
+		return SR_ERR_DATA;
+
+	if (!inc->channels_created) {
+		for (idx = 0; idx < hdr->num_logic; idx++) {
+			sr_channel_new(in->sdi, idx, SR_CHANNEL_LOGIC, TRUE,
+				hdr->names[idx]);
+		}
+		inc->analog_channels = g_malloc0_n(hdr->num_analog + 1,
+			sizeof(inc->analog_channels[0]));
+		for (idx = 0; idx < hdr->num_analog; idx++) {
+			inc->analog_channels[idx] = sr_channel_new(in->sdi,
+				hdr->num_logic + idx, SR_CHANNEL_ANALOG, TRUE,
+				hdr->names[hdr->num_logic + idx]);
+		}
+		inc->channels_created = TRUE;
+	}
+
+	g_string_erase(in->buf, 0, hdr->header_size);
+	inc->got_header = TRUE;
+
+	return SR_OK;
+}
+
+static void send_data(struct sr_input *in, const uint8_t *data, size_t length)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	void *copy;
+
+	inc = in->priv;
+	if (inc->group == 0) {
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = length;
+		logic.unitsize = inc->header.unitsize;
+		logic.data = (void *)data;
+		sr_session_send(in->sdi, &packet);
+		return;
+	}
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 6);
+	/* The file holds little endian floats on all hosts. */
+	encoding.is_bigendian = FALSE;
+	meaning.channels = g_slist_prepend(NULL,
+		inc->analog_channels[inc->group - 1]);
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	analog.num_samples = length / sizeof(float);
+	analog.data = (void *)data;
+	/* The input buffer need not start at an extent boundary. */
+	copy = NULL;
+	if ((uintptr_t)data % sizeof(float)) {
+		copy = g_malloc(length);
+		memcpy(copy, data, length);
+		analog.data = copy;
+	}
+	sr_session_send(in->sdi, &packet);
+	g_free(copy);
+	g_slist_free(meaning.channels);
+}
+
+/* Walk the extents in the buffer, and send their data. */
+static int process_buffer(struct sr_input *in)
+{
+	struct context *inc;
+	size_t offset, length, unitsize;
+	uint64_t num_samples, data_size;
+	uint32_t group;
+
+	inc = in->priv;
+	if (!inc->started) {
+		std_session_send_df_header(in->sdi);
+		if (inc->header.samplerate) {
+			(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
+				g_variant_new_uint64(inc->header.samplerate));
+		}
+		inc->started = TRUE;
+	}
+
+	offset = 0;
+	while (!inc->done && offset < in->buf->len) {
+		length = in->buf->len - offset;
+		if (inc->skip) {
+			length = MIN(length, inc->skip);
+			inc->skip -= length;
+			offset += length;
+			continue;
+		}
+
+		if (inc->remain) {
+			unitsize = inc->group ? sizeof(float) : inc->header.unitsize;
+			length = MIN(length, inc->remain);
+			length = MIN(length, CHUNK_SIZE);
+			length -= length % unitsize;
+			if (!length)
+				break;
+			send_data(in, (const uint8_t *)in->buf->str + offset,
+				length);
+			inc->remain -= length;
+			offset += length;
+			if (inc->remain < unitsize) {
+				/* Drop trailing bytes of a partial sample. */
+				inc->skip += inc->remain;
+				inc->remain = 0;
+			}
+			continue;
+		}
+
+		/* Expect the next extent, or the index. */
+		if (length < 4)
+			break;
+		if (RL32(&in->buf->str[offset]) == SR_CAPFILE_INDEX_MAGIC) {
+			inc->done = TRUE;
+			break;
+		}
+		if (length < SR_CAPFILE_EXTENT_SIZE)
+			break;
+		if (sr_capfile_extent_parse((const uint8_t *)in->buf->str +
+				offset, &group, &num_samples, &data_size) != SR_OK ||
+				group > inc->header.num_analog ||
+				(group == 0 && !inc->header.num_logic)) {
+			sr_err("Invalid extent in capture file.");
+			return SR_ERR_DATA;
+		}
+		offset += SR_CAPFILE_EXTENT_SIZE;
+		inc->group = group;
+		inc->remain = data_size;
+		inc->skip = SR_CAPFILE_ALIGN_UP(data_size) - data_size;
+	}
+
+	/* Keep the unprocessed data for the next call. */
+	if (inc->done)
+		g_string_truncate(in->buf, 0);
+	else
+		g_string_erase(in->buf, 0, offset);
+
+	return SR_OK;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	struct context *inc;
+	int ret;
+
+	inc = in->priv;
+	g_string_append_len(in->buf, buf->str, buf->len);
+
+	if (!inc->got_header) {
+		if ((ret = parse_header(in)) != SR_OK)
+			return ret;
+		if (!inc->got_header)
+			return SR_OK;
+	}
+
+	if (!in->sdi_ready) {
+		/* sdi is ready, notify frontend. */
+		in->sdi_ready = TRUE;
+		return SR_OK;
+	}
+
+	return process_buffer(in);
+}
+
+static int end(struct sr_input *in)
+{
+	struct context *inc;
+	int ret;
+
+	inc = in->priv;
+	if (in->sdi_ready)
+		ret = process_buffer(in);
+	else
+		ret = SR_OK;
+	if (inc->remain)
+		sr_warn("Capture file ends in an incomplete extent.");
+
+	if (inc->started)
+		std_session_send_df_end(in->sdi);
+
+	return ret;
+}
+
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	sr_capfile_header_clear(&inc->header);
+	g_free(inc->analog_channels);
+}
+
+static int reset(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	sr_capfile_header_clear(&inc->header);
+	inc->got_header = FALSE;
+	inc->started = FALSE;
+	inc->done = FALSE;
+	inc->remain = 0;
+	inc->skip = 0;
+	g_string_truncate(in->buf, 0);
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_input_module input_srcap = {
+	.id = "srcap",
+	.name = "srcap",
+	.desc = "Uncompressed memory mappable capture file",
+	.exts = (const char*[]){"srcap", NULL},
+	.magic = (const struct sr_input_magic[]){
+		{ 0, SR_CAPFILE_MAGIC, sizeof(SR_CAPFILE_MAGIC) - 1 },
+		ALL_ZERO,
+	},
+	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.format_match = format_match,
+	.init = init,
+	.receive = receive,
+	.end = end,
+	.cleanup = cleanup,
+	.reset = reset,
+};
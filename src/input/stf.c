@@ -190,8 +190,17 @@ struct context {
 	} record_data;
 	struct keep_specs {
 		uint64_t sample_rate;
+		unsigned int num_threads;
 		GSList *prev_sr_channels;
 	} keep;
+	struct {
+		GThreadPool *pool;	/* Workers for record decompression. */
+		GMutex mutex;
+		GCond cond;
+		size_t pending;		/* Jobs not yet finished. */
+		struct stf_job *jobs;	/* One record per job, in file order. */
+		size_t job_count;
+	} decomp;
 	struct {
 		uint64_t sample_rate;	/* User specified or from header. */
 		uint64_t sample_count;	/* Samples count as per header. */
@@ -205,6 +214,15 @@ struct context {
 	} submit;
 };
 
+/* A data record which gets checked and uncompressed by a worker thread. */
+struct stf_job {
+	const uint8_t *compressed;
+	size_t comp_len;
+	uint32_t crc;
+	struct stf_record *rec;
+	int ret;
+};
+
 static void keep_header_for_reread(const struct sr_input *in)
 {
 	struct context *inc;
@@ -527,6 +545,65 @@ static int eval_header(const struct sr_input *in)
 	return SR_OK;
 }
 
+/*
+ * Records are independent of each other, uncompress several of them
+ * concurrently. A failure to create the pool is non-fatal, records
+ * get uncompressed one at a time then.
+ */
+static void decomp_job_run(gpointer data, gpointer user_data);
+
+static int decomp_enter(const struct sr_input *in)
+{
+	struct context *inc;
+	GError *error;
+	size_t idx;
+
+	inc = in->priv;
+	if (inc->decomp.jobs)
+		return SR_OK;
+
+	inc->decomp.job_count = 1;
+	if (inc->keep.num_threads > 1) {
+		error = NULL;
+		inc->decomp.pool = g_thread_pool_new(decomp_job_run, inc,
+			inc->keep.num_threads, FALSE, &error);
+		if (inc->decomp.pool) {
+			inc->decomp.job_count = inc->keep.num_threads;
+		} else {
+			sr_warn("Cannot create decompression threads: %s.",
+				error ? error->message : "unknown error");
+			g_clear_error(&error);
+		}
+	}
+	sr_dbg("Data: %zu record(s) get uncompressed at a time.",
+		inc->decomp.job_count);
+
+	inc->decomp.jobs = g_malloc0_n(inc->decomp.job_count,
+		sizeof(inc->decomp.jobs[0]));
+	inc->decomp.jobs[0].rec = &inc->record_data;
+	for (idx = 1; idx < inc->decomp.job_count; idx++)
+		inc->decomp.jobs[idx].rec = g_malloc(sizeof(struct stf_record));
+
+	return SR_OK;
+}
+
+static void decomp_leave(struct context *inc)
+{
+	size_t idx;
+
+	if (inc->decomp.pool) {
+		g_thread_pool_free(inc->decomp.pool, FALSE, TRUE);
+		inc->decomp.pool = NULL;
+	}
+	if (inc->decomp.jobs) {
+		for (idx = 1; idx < inc->decomp.job_count; idx++)
+			g_free(inc->decomp.jobs[idx].rec);
+		g_free(inc->decomp.jobs);
+		inc->decomp.jobs = NULL;
+	}
+	inc->decomp.job_count = 0;
+}
+
 /* Preare datafeed submission in the DATA phase. */
 static int data_enter(const struct sr_input *in)
 {
@@ -563,7 +640,7 @@ static int data_enter(const struct sr_input *in)
 	if (!inc->submit.feed)
 		return SR_ERR_MALLOC;
 
-	return SR_OK;
+	return decomp_enter(in);
 }
 
 /* Terminate datafeed submission of the DATA phase. */
@@ -1024,16 +1101,86 @@ static int stf_parse_data_record(struct sr_input *in, struct stf_record *rec)
 	return SR_OK;
 }
 
+/* Check and uncompress a record's payload data. Runs in worker threads. */
+static int decomp_record(struct stf_job *job)
+{
+	uint32_t crc_calc;
+	lzo_uint raw_len;
+	int rc;
+
+	crc_calc = crc32(0, job->compressed, job->comp_len);
+	sr_spew("DBG: CRC32 calc comp 0x%08lx.", (unsigned long)crc_calc);
+	if (crc_calc != job->crc) {
+		sr_err("Data: Record payload CRC mismatch.");
+		return SR_ERR_DATA;
+	}
+
+	raw_len = sizeof(job->rec->raw);
+	rc = lzo1x_decompress_safe(job->compressed, job->comp_len,
+		job->rec->raw, &raw_len, NULL);
+	if (rc) {
+		sr_err("Data: Decompression error %d.", rc);
+		return SR_ERR_DATA;
+	}
+	if (raw_len > sizeof(job->rec->raw)) {
+		sr_err("Data: Excessive decompressed size %zu.",
+			(size_t)raw_len);
+		return SR_ERR_DATA;
+	}
+	job->rec->len = raw_len;
+	job->rec->crc = job->crc;
+
+	return SR_OK;
+}
+
+static void decomp_job_run(gpointer data, gpointer user_data)
+{
+	struct stf_job *job;
+	struct context *inc;
+
+	job = data;
+	inc = user_data;
+
+	job->ret = decomp_record(job);
+
+	g_mutex_lock(&inc->decomp.mutex);
+	inc->decomp.pending--;
+	g_cond_signal(&inc->decomp.cond);
+	g_mutex_unlock(&inc->decomp.mutex);
+}
+
+/* Uncompress a batch of records, concurrently when there are several. */
+static void decomp_records(struct context *inc, size_t job_count)
+{
+	size_t idx;
+
+	if (job_count == 1 || !inc->decomp.pool) {
+		for (idx = 0; idx < job_count; idx++)
+			inc->decomp.jobs[idx].ret = decomp_record(&inc->decomp.jobs[idx]);
+		return;
+	}
+
+	g_mutex_lock(&inc->decomp.mutex);
+	inc->decomp.pending = job_count;
+	g_mutex_unlock(&inc->decomp.mutex);
+	for (idx = 0; idx < job_count; idx++)
+		g_thread_pool_push(inc->decomp.pool, &inc->decomp.jobs[idx], NULL);
+	g_mutex_lock(&inc->decomp.mutex);
+	while (inc->decomp.pending)
+		g_cond_wait(&inc->decomp.cond, &inc->decomp.mutex);
+	g_mutex_unlock(&inc->decomp.mutex);
+}
+
 /* Parse the "data" section of the file (sample data). */
 static int parse_file_data(struct sr_input *in)
 {
 	struct context *inc;
 	size_t len, final_len;
-	uint32_t crc, crc_calc;
-	size_t have_len, want_len;
+	uint32_t crc;
+	size_t have_len, want_len, job_count, idx;
 	const uint8_t *read_ptr;
-	void *compressed;
-	lzo_uint raw_len;
+	struct stf_job *job;
+	gboolean last_seen;
 	int rc;
 
 	inc = in->priv;
@@ -1049,6 +1196,11 @@ static int parse_file_data(struct sr_input *in)
 	 * the record processed, and remove its content from the
 	 * receive buffer.
 	 *
+	 * Records don't depend on each other. Collect as many complete
+	 * records as there are decompression jobs, have them checked
+	 * and uncompressed concurrently, then process their sample
+	 * data in file order.
+	 *
 	 * Implementator's note: Cope with the fact that receive data
 	 * is gathered in arbitrary pieces across arbitrary numbers of
 	 * routine calls. Insufficient amounts of receive data in one
@@ -1062,68 +1214,64 @@ static int parse_file_data(struct sr_input *in)
 		 * Wait for record data to become available. Check for
 		 * the availability of a header, get the payload size
 		 * from the header, check for the data's availability.
-		 * Check the CRC of the (compressed) payload data.
 		 */
-		have_len = in->buf->len;
-		if (have_len < STF_DATA_REC_HDRLEN) {
-			sr_dbg("Data: Need more receive data (header).");
-			return SR_OK;
-		}
 		read_ptr = (const uint8_t *)in->buf->str;
-		len = read_u32le_inc(&read_ptr);
-		crc = read_u32le_inc(&read_ptr);
-		if (len == final_len && !crc) {
-			sr_dbg("Data: Last record seen.");
-			g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN);
-			inc->file_stage = STF_STAGE_DONE;
-			return SR_OK;
-		}
-		sr_dbg("Data: Record header, len %zu, crc 0x%08lx.",
-			len, (unsigned long)crc);
-		if (len > STF_DATA_REC_PLMAX) {
-			sr_err("Data: Illegal record length %zu.", len);
-			return SR_ERR_DATA;
+		have_len = in->buf->len;
+		job_count = 0;
+		last_seen = FALSE;
+		while (job_count < inc->decomp.job_count) {
+			if (have_len < STF_DATA_REC_HDRLEN)
+				break;
+			len = read_u32le(&read_ptr[0]);
+			crc = read_u32le(&read_ptr[sizeof(uint32_t)]);
+			if (len == final_len && !crc) {
+				sr_dbg("Data: Last record seen.");
+				read_ptr += STF_DATA_REC_HDRLEN;
+				last_seen = TRUE;
+				break;
+			}
+			sr_dbg("Data: Record header, len %zu, crc 0x%08lx.",
+				len, (unsigned long)crc);
+			if (len > STF_DATA_REC_PLMAX) {
+				sr_err("Data: Illegal record length %zu.", len);
+				return SR_ERR_DATA;
+			}
+			want_len = STF_DATA_REC_HDRLEN + len;
+			if (have_len < want_len)
+				break;
+			job = &inc->decomp.jobs[job_count++];
+			job->compressed = &read_ptr[STF_DATA_REC_HDRLEN];
+			job->comp_len = len;
+			job->crc = crc;
+			read_ptr += want_len;
+			have_len -= want_len;
 		}
-		inc->record_data.len = len;
-		inc->record_data.crc = crc;
-		want_len = inc->record_data.len;
-		if (have_len < STF_DATA_REC_HDRLEN + want_len) {
-			sr_dbg("Data: Need more receive data (payload).");
+		if (!job_count && !last_seen) {
+			sr_dbg("Data: Need more receive data.");
 			return SR_OK;
 		}
-		crc_calc = crc32(0, read_ptr, want_len);
-		sr_spew("DBG: CRC32 calc comp 0x%08lx.",
-			(unsigned long)crc_calc);
-		if (crc_calc != inc->record_data.crc) {
-			sr_err("Data: Record payload CRC mismatch.");
-			return SR_ERR_DATA;
-		}
 
 		/*
-		 * Uncompress the payload data, have the record processed.
-		 * Drop the compressed receive data from the input buffer.
+		 * Uncompress the payload data, drop the compressed
+		 * receive data from the input buffer. Have the records
+		 * processed in order, up to the first error.
 		 */
-		compressed = (void *)read_ptr;
-		raw_len = sizeof(inc->record_data.raw);
-		memset(&inc->record_data.raw, 0, sizeof(inc->record_data.raw));
-		rc = lzo1x_decompress_safe(compressed, want_len,
-			inc->record_data.raw, &raw_len, NULL);
-		g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
-		if (rc) {
-			sr_err("Data: Decompression error %d.", rc);
-			return SR_ERR_DATA;
+		decomp_records(inc, job_count);
+		g_string_erase(in->buf, 0, read_ptr - (const uint8_t *)in->buf->str);
+		for (idx = 0; idx < job_count; idx++) {
+			job = &inc->decomp.jobs[idx];
+			if (job->ret != SR_OK)
+				return job->ret;
+			sr_spew("Data: Uncompressed record, len %zu.",
+				job->rec->len);
+			rc = stf_parse_data_record(in, job->rec);
+			if (rc != SR_OK)
+				return rc;
 		}
-		if (raw_len > sizeof(inc->record_data.raw)) {
-			sr_err("Data: Excessive decompressed size %zu.",
-				(size_t)raw_len);
-			return SR_ERR_DATA;
+		if (last_seen) {
+			inc->file_stage = STF_STAGE_DONE;
+			return SR_OK;
 		}
-		inc->record_data.len = raw_len;
-		sr_spew("Data: Uncompressed record, len %zu.",
-			inc->record_data.len);
-		rc = stf_parse_data_record(in, &inc->record_data);
-		if (rc != SR_OK)
-			return rc;
 	}
 	return SR_OK;
 }
@@ -1260,6 +1408,15 @@ static int init(struct sr_input *in, GHashTable *options)
 	var = g_hash_table_lookup(options, "samplerate");
 	sample_rate = g_variant_get_uint64(var);
 	inc->keep.sample_rate = sample_rate;
+	var = g_hash_table_lookup(options, "threads");
+	inc->keep.num_threads = g_variant_get_uint32(var);
+	if (!inc->keep.num_threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		inc->keep.num_threads = g_get_num_processors();
+#else
+		inc->keep.num_threads = 2;
+#endif
+	}
 
 	return SR_OK;
 }
@@ -1311,6 +1468,7 @@ static void cleanup(struct sr_input *in)
 	g_slist_free_full(inc->channels, free_channel);
 	feed_queue_logic_free(inc->submit.feed);
 	inc->submit.feed = NULL;
+	decomp_leave(inc);
 	g_strfreev(inc->header.sigma_clksrc);
 	inc->header.sigma_clksrc = NULL;
 	g_strfreev(inc->header.sigma_inputs);
@@ -1337,6 +1495,7 @@ static int reset(struct sr_input *in)
 
 enum option_index {
 	OPT_SAMPLERATE,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1346,6 +1505,11 @@ static struct sr_option options[] = {
 		"The input data's sample rate in Hz. No default value.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Decompression threads",
+		"The number of threads which uncompress data records, 0 for one per CPU (default).",
+		NULL, NULL,
+	},
 	ALL_ZERO,
 };
 
@@ -1356,6 +1520,8 @@ static const struct sr_option *get_options(void)
 	if (!options[0].def) {
 		var = g_variant_new_uint64(0);
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(var);
+		var = g_variant_new_uint32(0);
+		options[OPT_THREADS].def = g_variant_ref_sink(var);
 	}
 
 	return options;
@@ -1366,6 +1532,11 @@ SR_PRIV struct sr_input_module input_stf = {
 	.name = "STF",
 	.desc = "Sigma Test File (Asix Sigma/Omega)",
 	.exts = stf_extensions,
+	.magic = (const struct sr_input_magic[]){
+		{ 0, STF_MAGIC_SIGMA, STF_MAGIC_LENGTH },
+		{ 0, STF_MAGIC_OMEGA, STF_MAGIC_LENGTH },
+		ALL_ZERO,
+	},
 	.metadata = {
 		SR_INPUT_META_FILENAME | SR_INPUT_META_REQUIRED,
 		SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED,
@@ -100,7 +100,15 @@ struct context {
 	int32_t last_record;
 	uint64_t samplerate;
 	double timestamp_scale;
-	GString *out_buf;
+	/* Where the enabled pods' data is in PowerIntegrator records. */
+	struct pod_source {
+		uint16_t data_offset;
+		uint16_t clk_offset;
+		uint8_t clk_shift;
+	} pods[MAX_POD_COUNT];
+	size_t num_pods;
+	size_t unitsize;
+	struct feed_queue_logic *feed_queue;
 };
 
 static int process_header(GString *buf, struct context *inc);
@@ -182,8 +190,6 @@ static int init(struct sr_input *in, GHashTable *options)
 		return SR_ERR;
 	}
 
-	inc->out_buf = g_string_sized_new(CHUNK_SIZE);
-
 	return SR_OK;
 }
 
@@ -418,229 +424,174 @@ static void send_metadata(struct sr_input *in)
 static void flush_output_buffer(struct sr_input *in)
 {
 	struct context *inc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 
 	inc = in->priv;
 
-	if (inc->out_buf->len) {
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
-		logic.data = inc->out_buf->str;
-		logic.length = inc->out_buf->len;
-		sr_session_send(in->sdi, &packet);
-
-		g_string_truncate(inc->out_buf, 0);
-	}
+	if (inc->feed_queue)
+		feed_queue_logic_flush(inc->feed_queue);
 }
 
-static void process_record_pi(struct sr_input *in, gsize start)
+/*
+ * Determine where the data of the enabled pods is in PowerIntegrator
+ * records, see process_record_pi().
+ */
+static int pod_layout(struct sr_input *in)
 {
 	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	uint32_t pod_data;
-	char single_payload[12 * 3];
-	GString *buf;
-	int i, pod_count, clk_offset, packet_count, pod;
-	int payload_bit, payload_len, value;
+	struct pod_source *src;
+	size_t bits;
+	int pod, clk_offset;
 
 	inc = in->priv;
-	buf = in->buf;
-
-	/*
-	 * 0x00 u8  timestamp
-	 * 0x08 u16 A15..0
-	 * 0x0A u16 B15..0
-	 * 0x0C u16 C15..0
-	 * 0x0E u16 D15..0
-	 * 0x10 u16 E15..0
-	 * 0x12 u16 F15..0
-	 * 0x14 u32 ??
-	 * 0x18 u16 J15..0                          Not present in 500MHz mode
-	 * 0x1A u16 K15..0                          Not present in 500MHz mode
-	 * 0x1C u16 L15..0                          Not present in 500MHz mode
-	 * 0x1E u16 M15..0                          Not present in 500MHz mode
-	 * 0x20 u16 N15..0                          Not present in 500MHz mode
-	 * 0x22 u16 O15..0                          Not present in 500MHz mode
-	 * 0x24 u32 ??                              Not present in 500MHz mode
-	 * 0x28/18 u8 CLKF..A (32=CLKF, .., 1=CLKA)
-	 * 0x29/1A u8 CLKO..J (32=CLKO, .., 1=CLKJ) Not present in 500MHz mode
-	 * 0x2A/19 u8 ??
-	 * 0x2B/1A u8 ??
-	 * 0x2C/1B u8 ??
-	 */
 
-	timestamp = RL64(buf->str + start);
-
-	if (inc->record_mode == AD_MODE_500MHZ) {
-		pod_count = 6;
+	if (inc->record_mode == AD_MODE_500MHZ)
 		clk_offset = 0x18;
-	} else {
-		pod_count = 12;
+	else
 		clk_offset = 0x28;
-	}
 
-	payload_bit = 0;
-	payload_len = 0;
-	single_payload[0] = 0;
-
-	for (pod = 0; pod < pod_count; pod++) {
+	inc->num_pods = 0;
+	for (pod = 0; pod < MAX_POD_COUNT; pod++) {
 		if (!inc->pod_status[pod])
 			continue;
-
-		switch (pod) {
-		case 0: /* A */
-			pod_data = RL16(buf->str + start + 0x08);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 1) << 16;
-			break;
-		case 1: /* B */
-			pod_data = RL16(buf->str + start + 0x0A);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 2) << 15;
-			break;
-		case 2: /* C */
-			pod_data = RL16(buf->str + start + 0x0C);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 4) << 14;
-			break;
-		case 3: /* D */
-			pod_data = RL16(buf->str + start + 0x0E);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 8) << 13;
-			break;
-		case 4: /* E */
-			pod_data = RL16(buf->str + start + 0x10);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 16) << 12;
-			break;
-		case 5: /* F */
-			pod_data = RL16(buf->str + start + 0x12);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 32) << 11;
-			break;
-		case 6: /* J */
-			pod_data = RL16(buf->str + start + 0x18);
-			pod_data |= (RL16(buf->str + start + 0x29) & 1) << 16;
-			break;
-		case 7: /* K */
-			pod_data = RL16(buf->str + start + 0x1A);
-			pod_data |= (RL16(buf->str + start + 0x29) & 2) << 15;
-			break;
-		case 8: /* L */
-			pod_data = RL16(buf->str + start + 0x1C);
-			pod_data |= (RL16(buf->str + start + 0x29) & 4) << 14;
-			break;
-		case 9: /* M */
-			pod_data = RL16(buf->str + start + 0x1E);
-			pod_data |= (RL16(buf->str + start + 0x29) & 8) << 13;
-			break;
-		case 10: /* N */
-			pod_data = RL16(buf->str + start + 0x20);
-			pod_data |= (RL16(buf->str + start + 0x29) & 16) << 12;
-			break;
-		case 11: /* O */
-			pod_data = RL16(buf->str + start + 0x22);
-			pod_data |= (RL16(buf->str + start + 0x29) & 32) << 11;
-			break;
-		default:
-			pod_data = 0;
+		if (inc->record_mode == AD_MODE_500MHZ && pod >= 6) {
 			sr_err("Don't know how to obtain data for pod %d.", pod);
+			return SR_ERR_DATA;
 		}
+		src = &inc->pods[inc->num_pods++];
+		/* A..F are at 0x08, J..O follow the u32 at 0x14. */
+		src->data_offset = (pod < 6) ? 0x08 + 2 * pod : 0x18 + 2 * (pod - 6);
+		src->clk_offset = (pod < 6) ? clk_offset : 0x29;
+		src->clk_shift = pod % 6;
+	}
 
-		for (i = 0; i < 17; i++) {
-			value = (pod_data >> i) & 1;
-			single_payload[payload_len] |= value << payload_bit;
-
-			payload_bit++;
-			if (payload_bit > 7) {
-				payload_bit = 0;
-				payload_len++;
-				single_payload[payload_len] = 0;
-			}
-		}
+	bits = inc->num_pods * 17;
+	inc->unitsize = (bits + 7) / 8;
+	if (inc->unitsize != (g_slist_length(in->sdi->channels) + 7) / 8) {
+		sr_err("Payload unit size is %zu but should be %u!",
+			inc->unitsize, (g_slist_length(in->sdi->channels) + 7) / 8);
+		return SR_ERR_DATA;
 	}
 
-	/* Make sure that payload_len accounts for any incomplete bytes used. */
-	if (payload_bit)
-		payload_len++;
+	return SR_OK;
+}
 
-	i = (g_slist_length(in->sdi->channels) + 7) / 8;
-	if (payload_len != i) {
-		sr_err("Payload unit size is %d but should be %d!", payload_len, i);
-		return;
-	}
+/*
+ * Send a record's sample, repeated until the next record's timestamp.
+ * The feed queue keeps the repetitions in its buffer, the trigger gets
+ * sent when the samples before it were.
+ */
+static void record_submit(struct sr_input *in, gsize start,
+		const uint8_t *sample, size_t unitsize)
+{
+	struct context *inc;
+	uint64_t timestamp, next_timestamp;
+	int packet_count;
+
+	inc = in->priv;
+
+	if (!inc->feed_queue)
+		inc->feed_queue = feed_queue_logic_alloc(in->sdi,
+			CHUNK_SIZE / unitsize, unitsize);
 
+	timestamp = RL64(in->buf->str + start);
 	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
 		sr_dbg("Trigger @%lf s, record #%d.",
 			timestamp * TIMESTAMP_RESOLUTION, inc->cur_record);
-		std_session_send_df_trigger(in->sdi);
+		feed_queue_logic_send_trigger(inc->feed_queue);
 		inc->trigger_sent = TRUE;
 	}
 
 	/* Is this the last record in the file? */
 	if (inc->cur_record == inc->record_count - 1) {
 		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
+		packet_count = 1;
 	} else {
 		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(buf->str + start + inc->record_size);
+		next_timestamp = RL64(in->buf->str + start + inc->record_size);
 		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
 
 		/* Make sure we send at least one data set. */
 		if (packet_count == 0)
 			packet_count = 1;
-
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
 	}
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	if (packet_count > 0)
+		feed_queue_logic_submit(inc->feed_queue, sample, packet_count);
 }
 
-static void process_record_iprobe(struct sr_input *in, gsize start)
+static void process_record_pi(struct sr_input *in, gsize start)
 {
 	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	char single_payload[3];
-	int i, payload_len, packet_count;
+	const struct pod_source *src;
+	const uint8_t *rec;
+	uint8_t sample[(MAX_POD_COUNT * 17 + 7) / 8], *wr;
+	uint64_t acc;
+	unsigned int bits;
+	size_t i;
 
 	inc = in->priv;
+	rec = (const uint8_t *)in->buf->str + start;
 
 	/*
-	 * 0x00 u64 timestamp
-	 * 0x08 u16 IP15..0
-	 * 0x0A u8  CLK
+	 * 0x00 u8  timestamp
+	 * 0x08 u16 A15..0
+	 * 0x0A u16 B15..0
+	 * 0x0C u16 C15..0
+	 * 0x0E u16 D15..0
+	 * 0x10 u16 E15..0
+	 * 0x12 u16 F15..0
+	 * 0x14 u32 ??
+	 * 0x18 u16 J15..0                          Not present in 500MHz mode
+	 * 0x1A u16 K15..0                          Not present in 500MHz mode
+	 * 0x1C u16 L15..0                          Not present in 500MHz mode
+	 * 0x1E u16 M15..0                          Not present in 500MHz mode
+	 * 0x20 u16 N15..0                          Not present in 500MHz mode
+	 * 0x22 u16 O15..0                          Not present in 500MHz mode
+	 * 0x24 u32 ??                              Not present in 500MHz mode
+	 * 0x28/18 u8 CLKF..A (32=CLKF, .., 1=CLKA)
+	 * 0x29/1A u8 CLKO..J (32=CLKO, .., 1=CLKJ) Not present in 500MHz mode
+	 * 0x2A/19 u8 ??
+	 * 0x2B/1A u8 ??
+	 * 0x2C/1B u8 ??
+	 *
+	 * Each enabled pod contributes 17 bits to the sample (16 data
+	 * bits and the clock), which get packed back to back.
 	 */
-
-	timestamp = RL64(in->buf->str + start);
-	single_payload[0] = R8(in->buf->str + start + 0x08);
-	single_payload[1] = R8(in->buf->str + start + 0x09);
-	single_payload[2] = R8(in->buf->str + start + 0x0A) & 1;
-	payload_len = 3;
-
-	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
-		sr_dbg("Trigger @%lf s, record #%d.",
-			timestamp * TIMESTAMP_RESOLUTION, inc->cur_record);
-		std_session_send_df_trigger(in->sdi);
-		inc->trigger_sent = TRUE;
+	acc = 0;
+	bits = 0;
+	wr = sample;
+	for (i = 0; i < inc->num_pods; i++) {
+		src = &inc->pods[i];
+		acc |= (uint64_t)(RL16(rec + src->data_offset) |
+			(((R8(rec + src->clk_offset) >> src->clk_shift) & 1) << 16)) << bits;
+		bits += 17;
+		while (bits >= 8) {
+			*wr++ = acc & 0xff;
+			acc >>= 8;
+			bits -= 8;
+		}
 	}
+	if (bits)
+		*wr++ = acc & 0xff;
 
-	/* Is this the last record in the file? */
-	if (inc->cur_record == inc->record_count - 1) {
-		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
-	} else {
-		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(in->buf->str + start + inc->record_size);
-		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
+	record_submit(in, start, sample, wr - sample);
+}
 
-		/* Make sure we send at least one data set. */
-		if (packet_count == 0)
-			packet_count = 1;
+static void process_record_iprobe(struct sr_input *in, gsize start)
+{
+	uint8_t sample[3];
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
-	}
+	/*
+	 * 0x00 u64 timestamp
+	 * 0x08 u16 IP15..0
+	 * 0x0A u8  CLK
+	 */
+
+	sample[0] = R8(in->buf->str + start + 0x08);
+	sample[1] = R8(in->buf->str + start + 0x09);
+	sample[2] = R8(in->buf->str + start + 0x0A) & 1;
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	record_submit(in, start, sample, sizeof(sample));
 }
 
 static void process_practice_token(struct sr_input *in, char *cmd_token)
@@ -764,6 +715,11 @@ static int process_buffer(struct sr_input *in)
 		g_string_erase(in->buf, 0, inc->header_size);
 		if (res != SR_OK)
 			return res;
+		if (inc->device == AD_DEVICE_PI) {
+			res = pod_layout(in);
+			if (res != SR_OK)
+				return res;
+		}
 	}
 
 	if (!inc->meta_sent) {
@@ -850,11 +806,24 @@ static int reset(struct sr_input *in)
 	inc->trigger_sent = FALSE;
 	inc->cur_record = 0;
 
+	feed_queue_logic_free(inc->feed_queue);
+	inc->feed_queue = NULL;
+
 	g_string_truncate(in->buf, 0);
 
 	return SR_OK;
 }
 
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+
+	feed_queue_logic_free(inc->feed_queue);
+	inc->feed_queue = NULL;
+}
+
 static struct sr_option options[] = {
 	{ "podA", "Import pod A / iprobe",
 		"Create channels and data for pod A / iprobe", NULL, NULL },
@@ -908,5 +877,6 @@ SR_PRIV struct sr_input_module input_trace32_ad = {
 	.init = init,
 	.receive = receive,
 	.end = end,
+	.cleanup = cleanup,
 	.reset = reset,
 };
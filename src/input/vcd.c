@@ -42,6 +42,14 @@
  *   only this many timescale ticks. This can speed up operation on long
  *   captures (default 0, don't compress).
  *
+ * index: The name of a sidecar index file (default empty, no index).
+ *   A full parse writes checkpoints to the index: file offsets of
+ *   timestamps in the data section, and the signals' values there.
+ *   Later imports of the same file with skip > 0 then pass over the
+ *   text up to the last checkpoint before the skip timestamp without
+ *   parsing it, and resume from the checkpoint's values. The index
+ *   gets rebuilt when the file's header does not match it.
+ *
  * Based on Verilog standard IEEE Std 1364-2001 Version C
  *
  * Supported features:
@@ -120,6 +128,11 @@
 #define CHUNK_SIZE (4 * 1024 * 1024)
 #define SCOPE_SEP '.'
 
+/* Distance of the index checkpoints in the input data, in bytes. */
+#define INDEX_INTERVAL (16 * 1024 * 1024)
+#define INDEX_VERSION 1
+#define INDEX_GROUP "vcd index"
+
 struct context {
 	struct vcd_user_opt {
 		size_t maxchannels; /* sigrok channels (output) */
@@ -127,6 +140,7 @@ struct context {
 		uint64_t compress;
 		uint64_t skip_starttime;
 		gboolean skip_specified;
+		char *index_file;
 	} options;
 	gboolean use_skip;
 	gboolean started;
@@ -134,7 +148,8 @@ struct context {
 	uint64_t prev_timestamp;
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
-	GSList *ignored_signals;
+	GHashTable *signals; /* VCD identifier -> list of vcd_channel */
+	GHashTable *ignored_signals; /* set of VCD identifiers */
 	gboolean data_after_timestamp;
 	gboolean ignore_end_keyword;
 	gboolean skip_until_end;
@@ -152,11 +167,6 @@ struct context {
 	} conv_bits;
 	GString *scope_prefix;
 	struct feed_queue_logic *feed_logic;
-	struct split_state {
-		size_t alloced;
-		char **words;
-		gboolean in_use;
-	} split;
 	struct ts_stats {
 		size_t total_ts_seen;
 		uint64_t last_ts_value;
@@ -173,6 +183,17 @@ struct context {
 		GSList *sr_channels;
 		GSList *sr_groups;
 	} prev;
+	/* Absolute input position of the end of the receive buffer. */
+	uint64_t bytes_in;
+	struct vcd_index {
+		char *header_sum;
+		GKeyFile *kf;
+		size_t count;
+		uint64_t next_offset;
+		uint64_t resume_offset;
+		uint64_t resume_timestamp;
+		gboolean resume_check;
+	} index;
 };
 
 struct vcd_channel {
@@ -529,10 +550,9 @@ static gboolean parse_section(GString *buf, char **name, char **contents)
  * The repeated memory allocation is acceptable for small workloads like
  * parsing the header sections. But the heavy lifting for sample data is
  * done by DIY code to speedup execution. The use of glib routines would
- * severely hurt throughput. Allocated memory gets re-used while a strict
- * ping-pong pattern is assumed (each text line of input data enters and
- * leaves in a strict symmetrical manner, due to the organization of the
- * receive() routine and parse calls).
+ * severely hurt throughput. Words of sample data text lines are taken
+ * one after another, and get terminated in place. There is no memory
+ * allocation at all, not even for a list of words.
  */
 
 /* Remove empty parts from an array returned by g_strsplit(). */
@@ -554,110 +574,40 @@ static void remove_empty_parts(gchar **parts)
 	*dest = NULL;
 }
 
-static char **split_text_line(struct context *inc, char *text, size_t *count)
+/*
+ * Get the next space separated word from a text line, and advance the
+ * read position. The word gets terminated in place. Returns #NULL when
+ * the text line's end was reached.
+ */
+static char *next_text_word(char **text)
 {
-	struct split_state *state;
-	size_t counted, alloced, wanted;
-	char **words, *p, **new_words;
+	char *p, *word;
 
-	state = &inc->split;
-
-	if (count)
-		*count = 0;
-
-	if (state->in_use) {
-		sr_dbg("coding error, split() called while \"in use\".");
+	/* Skip leading spaces. */
+	p = *text;
+	while (g_ascii_isspace(*p))
+		p++;
+	if (!*p) {
+		*text = p;
 		return NULL;
 	}
 
-	/*
-	 * Seed allocation when invoked for the first time. Assume
-	 * simple logic data, start with a few words per line. Will
-	 * automatically adjust with subsequent use.
-	 */
-	if (!state->alloced) {
-		alloced = 20;
-		words = g_malloc(sizeof(words[0]) * alloced);
-		if (!words)
-			return NULL;
-		state->alloced = alloced;
-		state->words = words;
-	}
-
-	/* Start with most recently allocated word list space. */
-	alloced = state->alloced;
-	words = state->words;
-	counted = 0;
-
-	/* As long as more input text remains ... */
-	p = text;
-	while (*p) {
-		/* Resize word list if needed. Just double the size. */
-		if (counted + 1 >= alloced) {
-			wanted = 2 * alloced;
-			new_words = g_realloc(words, sizeof(words[0]) * wanted);
-			if (!new_words) {
-				return NULL;
-			}
-			words = new_words;
-			alloced = wanted;
-			state->words = words;
-			state->alloced = alloced;
-		}
-
-		/* Skip leading spaces. */
-		while (g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* Add found word to word list. */
-		words[counted++] = p;
-
-		/* Find end of the word. Terminate loop upon EOS. */
-		while (*p && !g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* More text follows. Terminate the word. */
+	/* Find end of the word. Terminate the word if more text follows. */
+	word = p;
+	while (*p && !g_ascii_isspace(*p))
+		p++;
+	if (*p)
 		*p++ = '\0';
-	}
-
-	/*
-	 * NULL terminate the word list. Provide its length so that
-	 * calling code need not re-iterate the list to get the count.
-	 */
-	words[counted] = NULL;
-	if (count)
-		*count = counted;
-	state->in_use = TRUE;
-
-	return words;
-}
-
-static void free_text_split(struct context *inc, char **words)
-{
-	struct split_state *state;
-
-	state = &inc->split;
-
-	if (words && words != state->words) {
-		sr_dbg("coding error, free() arg differs from split() result.");
-	}
-
-	/* "Double free" finally releases the memory. */
-	if (!state->in_use) {
-		g_free(state->words);
-		state->words = NULL;
-		state->alloced = 0;
-	}
+	*text = p;
 
-	/* Mark as no longer in use. */
-	state->in_use = FALSE;
+	return word;
 }
 
-static gboolean have_header(GString *buf)
+/*
+ * Check whether the buffer holds the complete file header. Optionally
+ * get the header's length up to its last "$end" keyword.
+ */
+static gboolean have_header(GString *buf, size_t *length)
 {
 	static const char *enddef_txt = "$enddefinitions";
 	static const char *end_txt = "$end";
@@ -678,6 +628,8 @@ static gboolean have_header(GString *buf)
 	if (strncmp(p, end_txt, strlen(end_txt)) != 0)
 		return FALSE;
 	p += strlen(end_txt);
+	if (length)
+		*length = p - buf->str;
 
 	return TRUE;
 }
@@ -800,6 +752,39 @@ static int parse_scope(struct context *inc, char *contents, gboolean is_up)
 	return SR_OK;
 }
 
+/*
+ * Register a VCD channel for fast lookup by its identifier. Several VCD
+ * channels (from different scopes) may share an identifier. The table
+ * references the first channel's identifier text, the channels must be
+ * released after the table.
+ */
+static void add_signal(struct context *inc, struct vcd_channel *vcd_ch)
+{
+	GSList *list;
+
+	if (!inc->signals) {
+		inc->signals = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, (GDestroyNotify)g_slist_free);
+	}
+	list = g_hash_table_lookup(inc->signals, vcd_ch->identifier);
+	if (list) {
+		/* Appending to a non-empty list keeps its head. */
+		(void)g_slist_append(list, vcd_ch);
+		return;
+	}
+	list = g_slist_append(NULL, vcd_ch);
+	g_hash_table_insert(inc->signals, vcd_ch->identifier, list);
+}
+
+static void add_ignored_signal(struct context *inc, const char *id)
+{
+	if (!inc->ignored_signals) {
+		inc->ignored_signals = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, NULL);
+	}
+	g_hash_table_add(inc->ignored_signals, g_strdup(id));
+}
+
 /**
  * Parse a $var section which describes a VCD signal ("variable").
  *
@@ -850,8 +835,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	} else if (is_str) {
 		sr_warn("Skipping id %s, name '%s%s', unsupported type '%s'.",
 			id, ref, idx ? idx : "", type);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		add_ignored_signal(inc, id);
 		g_strfreev(parts);
 		return SR_OK;
 	} else {
@@ -891,8 +875,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	if (inc->options.maxchannels && next_size > inc->options.maxchannels) {
 		sr_warn("Skipping '%s%s', exceeds requested channel count %zu.",
 			ref, idx ? idx : "", inc->options.maxchannels);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		add_ignored_signal(inc, id);
 		g_strfreev(parts);
 		return SR_OK;
 	}
@@ -922,6 +905,7 @@ static int parse_header_var(struct context *inc, char *contents)
 		vcd_ch->type == SR_CHANNEL_ANALOG ? "A" : "L",
 		vcd_ch->array_index);
 	inc->channels = g_slist_append(inc->channels, vcd_ch);
+	add_signal(inc, vcd_ch);
 	g_strfreev(parts);
 
 	return SR_OK;
@@ -1311,17 +1295,19 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
+/* Get the list of VCD channels for an identifier, #NULL if unknown. */
+static GSList *lookup_signal(struct context *inc, const char *id)
 {
-	return strcmp((const char *)a, (const char *)b);
+	if (!inc->signals)
+		return NULL;
+	return g_hash_table_lookup(inc->signals, id);
 }
 
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
-
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	if (!inc->ignored_signals)
+		return FALSE;
+	return g_hash_table_contains(inc->ignored_signals, id);
 }
 
 /*
@@ -1371,10 +1357,8 @@ static void process_bits(struct context *inc, char *identifier,
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
+	for (l = lookup_signal(inc, identifier); l; l = l->next) {
 		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1445,12 +1429,10 @@ static void process_real(struct context *inc, char *identifier, float real_val)
 	struct vcd_channel *vcd_ch;
 
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
+	for (l = lookup_signal(inc, identifier); l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
@@ -1601,8 +1583,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 {
 	struct context *inc;
 	int ret;
-	char **words;
-	size_t word_count, word_idx;
+	char *rdptr;
 	char *curr_word, *next_word, curr_first;
 	gboolean is_timestamp, is_section;
 	gboolean is_real, is_multibit, is_singlebit, is_string;
@@ -1621,22 +1602,19 @@ static int parse_textline(const struct sr_input *in, char *lines)
 	 * as well as single-bit data with whitespace before its
 	 * identifier (if that's valid in VCD, we'd accept it here).
 	 * The fact that callers always pass complete text lines should
-	 * make this assumption acceptable.
+	 * make this assumption acceptable. Branches which consume the
+	 * next word fetch another word to take its place.
 	 */
 	ret = SR_OK;
-	words = split_text_line(inc, lines, &word_count);
-	for (word_idx = 0; word_idx < word_count; word_idx++) {
+	rdptr = lines;
+	next_word = next_text_word(&rdptr);
+	while ((curr_word = next_word)) {
 		/*
 		 * Make the next two words available, to simpilify code
 		 * paths below. The second word is optional here.
 		 */
-		curr_word = words[word_idx];
-		if (!curr_word && !curr_word[0])
-			continue;
 		curr_first = g_ascii_tolower(curr_word[0]);
-		next_word = words[word_idx + 1];
-		if (next_word && !next_word[0])
-			next_word = NULL;
+		next_word = next_text_word(&rdptr);
 
 		/*
 		 * Optionally skip some sections that can be interleaved
@@ -1820,7 +1798,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 
 			real_text = &curr_word[1];
 			identifier = next_word;
-			word_idx++;
+			next_word = next_text_word(&rdptr);
 			if (!*real_text || !identifier || !*identifier) {
 				sr_err("Unexpected real format.");
 				ret = SR_ERR_DATA;
@@ -1855,7 +1833,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 			 */
 			bits_text = &curr_word[1];
 			identifier = next_word;
-			word_idx++;
+			next_word = next_text_word(&rdptr);
 
 			if (!*bits_text || !identifier || !*identifier) {
 				sr_err("Unexpected integer/vector format.");
@@ -1942,7 +1920,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 			identifier = ++bits_text;
 			if (!*identifier) {
 				identifier = next_word;
-				word_idx++;
+				next_word = next_text_word(&rdptr);
 			}
 			if (!identifier || !*identifier) {
 				sr_err("Identifier missing.");
@@ -1966,7 +1944,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 
 			str_value = &curr_word[1];
 			identifier = next_word;
-			word_idx++;
+			next_word = next_text_word(&rdptr);
 			if (!vcd_string_valid(str_value)) {
 				sr_err("Invalid string data: %s", str_value);
 				ret = SR_ERR_DATA;
@@ -1993,11 +1971,216 @@ static int parse_textline(const struct sr_input *in, char *lines)
 		ret = SR_ERR_DATA;
 		break;
 	}
-	free_text_split(inc, words);
 
 	return ret;
 }
 
+/* Get the (raw) timestamp of a text line starting with one, or FALSE. */
+static gboolean line_timestamp(const char *line, uint64_t *timestamp)
+{
+	char *endptr;
+
+	if (line[0] != '#' || !g_ascii_isdigit(line[1]))
+		return FALSE;
+	endptr = NULL;
+	*timestamp = strtoull(&line[1], &endptr, 10);
+	if (!endptr || (*endptr && !g_ascii_isspace(*endptr)))
+		return FALSE;
+
+	return TRUE;
+}
+
+/*
+ * Load the index file of the input, or prepare to build one. Picks the
+ * last checkpoint before the skip timestamp to resume from, and restores
+ * the signals' values there.
+ */
+static int index_load(const struct sr_input *in)
+{
+	struct context *inc;
+	GKeyFile *kf;
+	char *sum, *group, *logic;
+	gdouble *analog;
+	gsize count, idx, bit;
+	uint64_t timestamp, offset, best_offset, best_timestamp;
+	GError *error;
+	int a, b;
+
+	inc = in->priv;
+	if (!inc->options.index_file)
+		return SR_OK;
+
+	/* Check whether the index is for this file (its header). */
+	kf = g_key_file_new();
+	error = NULL;
+	sum = NULL;
+	count = 0;
+	if (g_key_file_load_from_file(kf, inc->options.index_file,
+			G_KEY_FILE_NONE, &error)) {
+		sum = g_key_file_get_string(kf, INDEX_GROUP, "header", NULL);
+		count = g_key_file_get_uint64(kf, INDEX_GROUP, "checkpoints", NULL);
+		if (g_key_file_get_integer(kf, INDEX_GROUP, "version", NULL) != INDEX_VERSION)
+			count = 0;
+	} else {
+		sr_dbg("Cannot load VCD index: %s.", error->message);
+		g_error_free(error);
+	}
+	if (!count || g_strcmp0(sum, inc->index.header_sum) != 0) {
+		g_free(sum);
+		g_key_file_free(kf);
+		sr_info("Building VCD index '%s'.", inc->options.index_file);
+		inc->index.kf = g_key_file_new();
+		inc->index.next_offset = 0;
+		return SR_OK;
+	}
+	g_free(sum);
+
+	/* Pick the checkpoint, when a specific start time was requested. */
+	best_offset = best_timestamp = 0;
+	group = NULL;
+	for (idx = 0; inc->options.skip_starttime && idx < count; idx++) {
+		g_free(group);
+		group = g_strdup_printf("checkpoint %zu", idx);
+		timestamp = g_key_file_get_uint64(kf, group, "timestamp", NULL);
+		offset = g_key_file_get_uint64(kf, group, "offset", NULL);
+		if (timestamp / inc->options.downsample > inc->options.skip_starttime)
+			break;
+		best_offset = offset;
+		best_timestamp = timestamp;
+	}
+	g_free(group);
+	if (!best_offset) {
+		g_key_file_free(kf);
+		return SR_OK;
+	}
+
+	/* Restore the signals' values at the checkpoint. */
+	group = g_strdup_printf("checkpoint %zu", idx - 1);
+	logic = g_key_file_get_string(kf, group, "logic", NULL);
+	analog = g_key_file_get_double_list(kf, group, "analog", &count, NULL);
+	g_free(group);
+	g_key_file_free(kf);
+	if (!logic || strlen(logic) != 2 * inc->unit_size ||
+			(inc->analog_count && count != inc->analog_count)) {
+		sr_err("Invalid checkpoint in VCD index.");
+		g_free(logic);
+		g_free(analog);
+		return SR_ERR_DATA;
+	}
+	for (bit = 0; bit < inc->unit_size; bit++) {
+		a = g_ascii_xdigit_value(logic[2 * bit]);
+		b = g_ascii_xdigit_value(logic[2 * bit + 1]);
+		if (a < 0 || b < 0) {
+			sr_err("Invalid checkpoint in VCD index.");
+			g_free(logic);
+			g_free(analog);
+			return SR_ERR_DATA;
+		}
+		inc->current_logic[bit] = (a << 4) | b;
+	}
+	for (idx = 0; idx < inc->analog_count; idx++)
+		inc->current_floats[idx] = analog[idx];
+	g_free(logic);
+	g_free(analog);
+
+	/* The text before the checkpoint had timestamps to skip only. */
+	sr_dbg("Resuming at timestamp %" PRIu64 ", offset %" PRIu64 ".",
+		best_timestamp, best_offset);
+	inc->index.resume_offset = best_offset;
+	inc->index.resume_timestamp = best_timestamp;
+	inc->index.resume_check = TRUE;
+	inc->prev_timestamp = inc->options.skip_starttime;
+	inc->use_skip = TRUE;
+
+	return SR_OK;
+}
+
+/*
+ * Inspect a text line before it gets parsed. Verifies that the line at
+ * a resume position is the expected timestamp, and adds a checkpoint
+ * to an index under construction when the line starts with a timestamp.
+ */
+static int index_check_line(const struct sr_input *in, const char *line,
+	uint64_t position)
+{
+	struct context *inc;
+	struct vcd_index *index;
+	uint64_t timestamp;
+	GString *logic;
+	gdouble *analog;
+	char *group;
+	size_t idx;
+
+	inc = in->priv;
+	index = &inc->index;
+
+	if (index->resume_check) {
+		index->resume_check = FALSE;
+		if (!line_timestamp(line, &timestamp) ||
+				timestamp != index->resume_timestamp) {
+			sr_err("VCD index does not match the input file.");
+			return SR_ERR_DATA;
+		}
+		return SR_OK;
+	}
+
+	if (!index->kf || position < index->next_offset)
+		return SR_OK;
+	if (inc->skip_until_end || inc->ignore_end_keyword)
+		return SR_OK;
+	if (!line_timestamp(line, &timestamp))
+		return SR_OK;
+
+	logic = g_string_sized_new(2 * inc->unit_size + 1);
+	for (idx = 0; idx < inc->unit_size; idx++)
+		g_string_append_printf(logic, "%02x", inc->current_logic[idx]);
+	analog = g_malloc0((inc->analog_count + 1) * sizeof(analog[0]));
+	for (idx = 0; idx < inc->analog_count; idx++)
+		analog[idx] = inc->current_floats[idx];
+
+	group = g_strdup_printf("checkpoint %zu", index->count++);
+	g_key_file_set_uint64(index->kf, group, "timestamp", timestamp);
+	g_key_file_set_uint64(index->kf, group, "offset", position);
+	g_key_file_set_string(index->kf, group, "logic", logic->str);
+	if (inc->analog_count) {
+		g_key_file_set_double_list(index->kf, group, "analog",
+			analog, inc->analog_count);
+	}
+	g_free(group);
+	g_string_free(logic, TRUE);
+	g_free(analog);
+
+	index->next_offset = position + INDEX_INTERVAL;
+
+	return SR_OK;
+}
+
+/* Write an index which was built during a complete parse of the input. */
+static void index_save(const struct sr_input *in)
+{
+	struct context *inc;
+	struct vcd_index *index;
+	char *data;
+	gsize length;
+	GError *error;
+
+	inc = in->priv;
+	index = &inc->index;
+	if (!index->kf || !index->count)
+		return;
+
+	g_key_file_set_integer(index->kf, INDEX_GROUP, "version", INDEX_VERSION);
+	g_key_file_set_string(index->kf, INDEX_GROUP, "header", index->header_sum);
+	g_key_file_set_uint64(index->kf, INDEX_GROUP, "checkpoints", index->count);
+	data = g_key_file_to_data(index->kf, &length, NULL);
+	error = NULL;
+	if (!g_file_set_contents(inc->options.index_file, data, length, &error)) {
+		sr_warn("Cannot write VCD index: %s.", error->message);
+		g_error_free(error);
+	}
+	g_free(data);
+}
+
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
@@ -2006,6 +2189,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	int ret;
 	char *rdptr, *endptr, *trimptr;
 	size_t rdlen;
+	uint64_t position;
 
 	inc = in->priv;
 
@@ -2030,17 +2214,28 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 * lines. Enforce the trailing line feed. Proper input is not
 	 * harmed by another empty line of input data.
 	 */
-	if (is_eof)
-		g_string_append_c(in->buf, '\n');
+	if (is_eof) {
+		sr_input_buf_append(in, "\n", 1);
+		inc->bytes_in++;
+	}
+
+	/* Pass over the text before the index checkpoint to resume from. */
+	position = inc->bytes_in - sr_input_buf_len(in);
+	if (position < inc->index.resume_offset) {
+		sr_input_buf_consume(in, inc->index.resume_offset - position);
+		if (inc->bytes_in - sr_input_buf_len(in) < inc->index.resume_offset)
+			return SR_OK;
+	}
 
 	/* Find and process complete text lines in the input data. */
 	ret = SR_OK;
-	rdptr = in->buf->str;
+	rdptr = sr_input_buf_ptr(in);
 	while (TRUE) {
 		rdlen = &in->buf->str[in->buf->len] - rdptr;
-		endptr = g_strstr_len(rdptr, rdlen, "\n");
+		endptr = memchr(rdptr, '\n', rdlen);
 		if (!endptr)
 			break;
+		position = inc->bytes_in - rdlen;
 		trimptr = endptr;
 		*endptr++ = '\0';
 		while (g_ascii_isspace(*rdptr))
@@ -2051,13 +2246,16 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 			rdptr = endptr;
 			continue;
 		}
+		ret = index_check_line(in, rdptr, position);
+		if (ret != SR_OK)
+			break;
 		ret = parse_textline(in, rdptr);
 		rdptr = endptr;
 		if (ret != SR_OK)
 			break;
 	}
-	rdlen = rdptr - in->buf->str;
-	g_string_erase(in->buf, 0, rdlen);
+	rdlen = rdptr - sr_input_buf_ptr(in);
+	sr_input_buf_consume(in, rdlen);
 
 	return ret;
 }
@@ -2119,6 +2317,10 @@ static int init(struct sr_input *in, GHashTable *options)
 		inc->options.skip_starttime /= inc->options.downsample;
 	}
 
+	data = g_hash_table_lookup(options, "index");
+	if (data && *g_variant_get_string(data, NULL))
+		inc->options.index_file = g_variant_dup_string(data, NULL);
+
 	in->sdi = g_malloc0(sizeof(*in->sdi));
 	in->priv = inc;
 
@@ -2130,20 +2332,30 @@ static int init(struct sr_input *in, GHashTable *options)
 static int receive(struct sr_input *in, GString *buf)
 {
 	struct context *inc;
+	size_t header_len;
 	int ret;
 
 	inc = in->priv;
 
 	/* Collect all input chunks, potential deferred processing. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf->str, buf->len);
+	inc->bytes_in += buf->len;
 	if (!inc->got_header && in->buf->len == buf->len)
 		check_remove_bom(in->buf);
 
 	/* Must complete reception of the VCD header first. */
 	if (!inc->got_header) {
-		if (!have_header(in->buf))
+		if (!have_header(in->buf, &header_len))
 			return SR_OK;
+		if (inc->options.index_file) {
+			inc->index.header_sum = g_compute_checksum_for_data(
+				G_CHECKSUM_SHA256, (const guchar *)in->buf->str,
+				header_len);
+		}
 		ret = parse_header(in, in->buf);
+		if (ret != SR_OK)
+			return ret;
+		ret = index_load(in);
 		if (ret != SR_OK)
 			return ret;
 		/* sdi is ready, notify frontend. */
@@ -2181,6 +2393,10 @@ static int end(struct sr_input *in)
 	if (inc->got_header)
 		(void)ts_stats_post(inc, !inc->data_after_timestamp);
 
+	/* Keep the index for later imports after a complete parse. */
+	if (inc->got_header && ret == SR_OK)
+		index_save(in);
+
 	/* Must send DF_END when DF_HEADER was sent before. */
 	if (inc->started)
 		std_session_send_df_end(in->sdi);
@@ -2196,6 +2412,9 @@ static void cleanup(struct sr_input *in)
 
 	keep_header_for_reread(in);
 
+	if (inc->signals)
+		g_hash_table_destroy(inc->signals);
+	inc->signals = NULL;
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 	feed_queue_logic_free(inc->feed_logic);
@@ -2208,9 +2427,15 @@ static void cleanup(struct sr_input *in)
 	inc->current_floats = NULL;
 	g_string_free(inc->scope_prefix, TRUE);
 	inc->scope_prefix = NULL;
-	g_slist_free_full(inc->ignored_signals, g_free);
+	if (inc->ignored_signals)
+		g_hash_table_destroy(inc->ignored_signals);
 	inc->ignored_signals = NULL;
-	free_text_split(inc, NULL);
+	g_free(inc->index.header_sum);
+	if (inc->index.kf)
+		g_key_file_free(inc->index.kf);
+	memset(&inc->index, 0, sizeof(inc->index));
+	g_free(inc->options.index_file);
+	inc->options.index_file = NULL;
 }
 
 static int reset(struct sr_input *in)
@@ -2222,11 +2447,12 @@ static int reset(struct sr_input *in)
 	inc = in->priv;
 
 	/* Relase previously allocated resources. */
+	save = inc->options;
+	save.index_file = g_strdup(save.index_file);
 	cleanup(in);
 	g_string_truncate(in->buf, 0);
 
 	/* Restore part of the context, init() won't run again. */
-	save = inc->options;
 	prev = inc->prev;
 	memset(inc, 0, sizeof(*inc));
 	inc->options = save;
@@ -2241,6 +2467,7 @@ enum vcd_option_t {
 	OPT_DOWN_SAMPLE,
 	OPT_SKIP_COUNT,
 	OPT_COMPRESS,
+	OPT_INDEX,
 	OPT_MAX,
 };
 
@@ -2268,6 +2495,13 @@ static struct sr_option options[] = {
 		"Compress idle periods which are longer than the specified number of timescale ticks.",
 		NULL, NULL,
 	},
+	[OPT_INDEX] = {
+		"index", "Index file",
+		"Sidecar index file which lets imports with a skip timestamp "
+		"resume from a checkpoint instead of parsing the whole file. "
+		"Gets built upon the first complete import.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -2278,6 +2512,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_DOWN_SAMPLE].def = g_variant_ref_sink(g_variant_new_uint64(1));
 		options[OPT_SKIP_COUNT].def = g_variant_ref_sink(g_variant_new_uint64(~UINT64_C(0)));
 		options[OPT_COMPRESS].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[OPT_INDEX].def = g_variant_ref_sink(g_variant_new_string(""));
 	}
 
 	return options;
@@ -184,7 +184,13 @@ static int find_data_chunk(GString *buf, int initial_offset)
 	return offset;
 }
 
-static void send_chunk(const struct sr_input *in, int offset, int num_samples)
+/*
+ * Send the file's sample data as is, all channels' samples interleaved
+ * in one packet. The encoding describes the PCM integer or the IEEE
+ * float format (always little endian in WAV files), receivers convert
+ * when they need to. PCM samples get normalized by their full scale.
+ */
+static void send_chunk(const struct sr_input *in, const char *s, int num_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -192,57 +198,44 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct context *inc;
-	float *fdata;
-	int total_samples, samplenum;
-	char *s, *d;
 
 	inc = in->priv;
 
-	total_samples = num_samples * inc->num_channels;
-	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
-	d = (char *)fdata;
-
-	for (samplenum = 0; samplenum < total_samples; samplenum++) {
-		if (inc->fmt_code == WAVE_FORMAT_PCM_) {
-			switch (inc->unitsize) {
-			case 1:
-				/* 8-bit PCM samples are unsigned. */
-				fdata[samplenum] = *(uint8_t*)(s) / (float)255;
-				break;
-			case 2:
-				fdata[samplenum] = RL16S(s) / (float)INT16_MAX;
-				break;
-			case 4:
-				fdata[samplenum] = RL32S(s) / (float)INT32_MAX;
-				break;
-			}
-		} else {
-			/* BINARY32 float */
-#ifdef WORDS_BIGENDIAN
-			int i;
-			for (i = 0; i < inc->unitsize; i++)
-				d[i] = s[inc->unitsize - 1 - i];
-#else
-			memcpy(d, s, inc->unitsize);
-#endif
-		}
-		s += inc->unitsize;
-		d += inc->unitsize;
-	}
-
 	/* TODO: Use proper 'digits' value for this device (and its modes). */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	encoding.unitsize = inc->unitsize;
+	encoding.is_bigendian = FALSE;
+	if (inc->fmt_code == WAVE_FORMAT_PCM_) {
+		encoding.is_float = FALSE;
+		switch (inc->unitsize) {
+		case 1:
+			/* 8-bit PCM samples are unsigned. */
+			encoding.is_signed = FALSE;
+			encoding.scale.q = UINT8_MAX;
+			break;
+		case 2:
+			encoding.is_signed = TRUE;
+			encoding.scale.q = UINT64_C(1) << 15;
+			break;
+		case 4:
+			encoding.is_signed = TRUE;
+			encoding.scale.q = UINT64_C(1) << 31;
+			break;
+		}
+	} else {
+		/* BINARY32 float */
+		encoding.is_signed = TRUE;
+		encoding.is_float = TRUE;
+	}
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	analog.num_samples = num_samples;
-	analog.data = fdata;
+	analog.data = (void *)s;
 	analog.meaning->channels = in->sdi->channels;
 	analog.meaning->mq = 0;
 	analog.meaning->mqflags = 0;
 	analog.meaning->unit = 0;
 	sr_session_send(in->sdi, &packet);
-	g_free(fdata);
 }
 
 static int process_buffer(struct sr_input *in)
@@ -283,7 +276,7 @@ static int process_buffer(struct sr_input *in)
 			num_samples = max_chunk_samples;
 		else
 			num_samples = chunk_samples;
-		send_chunk(in, offset, num_samples);
+		send_chunk(in, in->buf->str + offset, num_samples);
 		offset += num_samples * inc->samplesize;
 		chunk_samples -= num_samples;
 		processed += num_samples;
@@ -380,6 +373,47 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+		size_t length, size_t *consumed)
+{
+	struct context *inc;
+	GString *buf;
+	size_t chunk_samples, num_samples, max_chunk_samples, fill;
+	int ret;
+
+	inc = in->priv;
+	if (!in->sdi_ready || !inc->found_data) {
+		/* The header is small, copy it in bounded pieces. */
+		fill = MIN(length, MAX_DATA_CHUNK_OFFSET);
+		buf = g_string_new_len((const char *)data, fill);
+		ret = receive(in, buf);
+		g_string_free(buf, TRUE);
+		*consumed = fill;
+		return ret;
+	}
+
+	if (in->buf->len) {
+		/* Flush data of earlier calls first. */
+		if ((ret = process_buffer(in)) != SR_OK)
+			return ret;
+		fill = MIN(length, (size_t)inc->samplesize - in->buf->len);
+		g_string_append_len(in->buf, (const char *)data, fill);
+		*consumed = fill;
+		return process_buffer(in);
+	}
+
+	chunk_samples = length / inc->samplesize;
+	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
+	while (chunk_samples) {
+		num_samples = MIN(chunk_samples, max_chunk_samples);
+		send_chunk(in, (const char *)data + *consumed, num_samples);
+		*consumed += num_samples * inc->samplesize;
+		chunk_samples -= num_samples;
+	}
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -422,10 +456,15 @@ SR_PRIV struct sr_input_module input_wav = {
 	.name = "WAV",
 	.desc = "Microsoft WAV file format data",
 	.exts = (const char*[]){"wav", NULL},
+	.magic = (const struct sr_input_magic[]){
+		{ 0, "RIFF", 4 },
+		ALL_ZERO,
+	},
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.reset = reset,
 };
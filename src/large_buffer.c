@@ -0,0 +1,278 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Allocation of large sample buffers.
+ *
+ * Buffers from a few hundred KiB on get mapped from the kernel directly,
+ * rather than taken from the heap. They are backed by huge pages where
+ * the system provides them, explicitly reserved ones first, transparent
+ * huge pages otherwise, which saves TLB misses when the buffers get
+ * streamed through. The memory can be bound to the NUMA node of the USB
+ * host controller the device is attached to, and be pre-faulted, such
+ * that the page faults happen at the start of an acquisition rather than
+ * while the samples come in.
+ *
+ * Smaller buffers, and systems without mmap(), use the heap.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(HAVE_SYS_MMAN_H)
+#include <sys/syscall.h>
+#endif
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "large-buffer"
+/** @endcond */
+
+/* Buffers of at least this size get mapped rather than heap allocated. */
+#define MAP_MIN_SIZE (256 * 1024)
+/* Size of the huge pages which get asked for explicitly. */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+/* Preferred NUMA node policy of mbind(). */
+#define MPOL_PREFERRED_MODE 1
+
+enum large_buffer_kind {
+	BUFFER_HEAP,
+	BUFFER_MAPPED,
+};
+
+/*
+ * Precedes the caller's memory. Padded to a cache line, so that the
+ * caller's memory starts cache line aligned in mappings.
+ */
+union large_buffer_header {
+	struct {
+		enum large_buffer_kind kind;
+		size_t size;
+		size_t map_size;
+	} info;
+	uint8_t pad[64];
+};
+
+#ifdef HAVE_SYS_MMAN_H
+static void bind_node(void *map, size_t map_size, int numa_node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	unsigned long mask[4];
+
+	if (numa_node < 0 || (size_t)numa_node >= sizeof(mask) * 8)
+		return;
+
+	memset(mask, 0, sizeof(mask));
+	mask[numa_node / (sizeof(mask[0]) * 8)] =
+		1UL << (numa_node % (sizeof(mask[0]) * 8));
+	if (syscall(SYS_mbind, map, map_size, MPOL_PREFERRED_MODE,
+			mask, sizeof(mask) * 8, 0) != 0)
+		sr_dbg("Cannot bind buffer to NUMA node %d.", numa_node);
+#else
+	(void)map;
+	(void)map_size;
+	(void)numa_node;
+#endif
+}
+
+static void *map_buffer(size_t size, size_t *map_size, int numa_node)
+{
+	void *map;
+	size_t page_size;
+
+	map = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	/* Explicit huge pages are only there when the admin reserved them. */
+	if (size >= HUGE_PAGE_SIZE) {
+		*map_size = (size + HUGE_PAGE_SIZE - 1) &
+			~(size_t)(HUGE_PAGE_SIZE - 1);
+		map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (map == MAP_FAILED) {
+		page_size = sysconf(_SC_PAGESIZE);
+		*map_size = (size + page_size - 1) & ~(page_size - 1);
+		map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map == MAP_FAILED)
+			return NULL;
+#ifdef MADV_HUGEPAGE
+		madvise(map, *map_size, MADV_HUGEPAGE);
+#endif
+	}
+	bind_node(map, *map_size, numa_node);
+
+	return map;
+}
+#endif
+
+/**
+ * Allocate a large sample buffer.
+ *
+ * @param size The size of the buffer in bytes.
+ * @param numa_node The NUMA node to place the buffer on, or -1.
+ *                  See sr_dev_numa_node().
+ *
+ * @return The buffer, or NULL when it cannot be allocated. Free it with
+ *         sr_large_buffer_free(). The memory is not initialized.
+ *
+ * @private
+ */
+SR_PRIV void *sr_large_buffer_alloc(size_t size, int numa_node)
+{
+	union large_buffer_header *hdr;
+	size_t alloc_size;
+#ifdef HAVE_SYS_MMAN_H
+	size_t map_size;
+#endif
+
+	alloc_size = sizeof(*hdr) + size;
+	hdr = NULL;
+#ifdef HAVE_SYS_MMAN_H
+	if (size >= MAP_MIN_SIZE) {
+		hdr = map_buffer(alloc_size, &map_size, numa_node);
+		if (hdr) {
+			hdr->info.kind = BUFFER_MAPPED;
+			hdr->info.map_size = map_size;
+		}
+	}
+#else
+	(void)numa_node;
+#endif
+	if (!hdr) {
+		hdr = g_try_malloc(alloc_size);
+		if (!hdr)
+			return NULL;
+		hdr->info.kind = BUFFER_HEAP;
+		hdr->info.map_size = 0;
+	}
+	hdr->info.size = size;
+
+	return hdr + 1;
+}
+
+/**
+ * Free a buffer which was allocated with sr_large_buffer_alloc().
+ *
+ * @param buf The buffer, may be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_large_buffer_free(void *buf)
+{
+	union large_buffer_header *hdr;
+
+	if (!buf)
+		return;
+
+	hdr = (union large_buffer_header *)buf - 1;
+#ifdef HAVE_SYS_MMAN_H
+	if (hdr->info.kind == BUFFER_MAPPED) {
+		munmap(hdr, hdr->info.map_size);
+		return;
+	}
+#endif
+	g_free(hdr);
+}
+
+/**
+ * Have all pages of a large buffer populated.
+ *
+ * Call this before the acquisition starts, which moves the page faults
+ * of the first pass through the buffer out of the sample path.
+ *
+ * @param buf The buffer, may be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_large_buffer_prefault(void *buf)
+{
+#ifdef HAVE_SYS_MMAN_H
+	union large_buffer_header *hdr;
+	volatile uint8_t *p;
+	size_t page_size, offset;
+
+	if (!buf)
+		return;
+
+	hdr = (union large_buffer_header *)buf - 1;
+	if (hdr->info.kind != BUFFER_MAPPED)
+		return;
+#ifdef MADV_POPULATE_WRITE
+	if (madvise(hdr, hdr->info.map_size, MADV_POPULATE_WRITE) == 0)
+		return;
+#endif
+	/* Write one byte of each page, the contents are undefined anyway. */
+	page_size = sysconf(_SC_PAGESIZE);
+	p = buf;
+	for (offset = 0; offset < hdr->info.size; offset += page_size)
+		p[offset] = 0;
+#else
+	(void)buf;
+#endif
+}
+
+/**
+ * Get the NUMA node which a device's data arrives on.
+ *
+ * For USB devices, that's the node of the host controller which the
+ * device is attached to.
+ *
+ * @param sdi The device instance, may be NULL.
+ *
+ * @return The node, or -1 when unknown.
+ *
+ * @private
+ */
+SR_PRIV int sr_dev_numa_node(const struct sr_dev_inst *sdi)
+{
+#if defined(__linux__) && defined(HAVE_LIBUSB_1_0)
+	const struct sr_usb_dev_inst *usb;
+	char path[64];
+	FILE *f;
+	int node;
+
+	if (!sdi || sdi->inst_type != SR_INST_USB || !(usb = sdi->conn))
+		return -1;
+
+	/* The root hub's parent is the host controller's PCI device. */
+	snprintf(path, sizeof(path), "/sys/bus/usb/devices/usb%d/../numa_node",
+		usb->bus);
+	if (!(f = fopen(path, "r")))
+		return -1;
+	if (fscanf(f, "%d", &node) != 1)
+		node = -1;
+	fclose(f);
+
+	return node;
+#else
+	(void)sdi;
+
+	return -1;
+#endif
+}
@@ -66,6 +66,23 @@ struct zip_stat;
 #define SR_RECEIVE_DATA_CALLBACK(f) \
 	((sr_receive_data_callback) (void (*)(void)) (f))
 
+/*
+ * Static tracepoints (USDT) of the "libsigrok" provider, for perf and
+ * bpftrace. Each one is a single nop instruction until a tracer attaches.
+ * Without <sys/sdt.h> they compile to nothing, and the arguments don't
+ * get evaluated. Double underscores in names show as dashes in tools.
+ */
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define SR_PROBE1(name, a) DTRACE_PROBE1(libsigrok, name, a)
+#define SR_PROBE2(name, a, b) DTRACE_PROBE2(libsigrok, name, a, b)
+#define SR_PROBE3(name, a, b, c) DTRACE_PROBE3(libsigrok, name, a, b, c)
+#else
+#define SR_PROBE1(name, a) do { } while (0)
+#define SR_PROBE2(name, a, b) do { } while (0)
+#define SR_PROBE3(name, a, b, c) do { } while (0)
+#endif
+
 /**
  * Read a 8 bits unsigned integer out of memory.
  * @param x a pointer to the input memory
@@ -1077,6 +1094,17 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 #define SR_DRIVER_LIST_NOREORDER /* EMPTY */
 #endif
 
+/*
+ * The library and every driver module have a driver list of their own.
+ * Its bounds stay hidden also where SR_PRIV symbols get exported (see
+ * HAVE_DRIVER_MODULES), so that modules don't bind to another list.
+ */
+#ifndef _WIN32
+#define SR_DRIVER_LIST_HIDDEN __attribute__((visibility("hidden")))
+#else
+#define SR_DRIVER_LIST_HIDDEN
+#endif
+
 /**
  * Register a list of hardware drivers.
  *
@@ -1139,15 +1167,62 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 
 SR_API void sr_drivers_init(struct sr_context *context);
 
+#ifdef HAVE_DRIVER_MODULES
+SR_PRIV void sr_driver_modules_append(GArray *array);
+SR_API const struct sr_dev_driver **sr_driver_module_list(size_t *count);
+#endif
+
+/* Number of 64 bit words of CPU masks, for up to 1024 CPUs. */
+#define SR_THREAD_CPU_WORDS 16
+
+/* CPU affinity and scheduling of a kind of thread, see thread_sched.c. */
+struct sr_thread_sched {
+	/* Whether this was set, otherwise the defaults apply. */
+	gboolean configured;
+	/* The CPUs to run on, none for all. */
+	uint64_t cpus[SR_THREAD_CPU_WORDS];
+	/* SCHED_FIFO priority, 0 for normal scheduling. */
+	int priority;
+};
+
 struct sr_context {
 	struct sr_dev_driver **driver_list;
+	/* Whether sr_init_io_backends() ran. */
+	GMutex io_mutex;
+	gboolean io_initialized;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
+	/* Devices and strings seen during a scan, see sr_usb_scan_begin(). */
+	GMutex usb_scan_mutex;
+	struct sr_usb_scan_cache *usb_scan_cache;
+	/* Set while sr_hotplug_start() is in effect. */
+	struct sr_hotplug *hotplug;
+	/* Set while sr_usb_capture_start() is in effect. */
+	struct sr_usb_capture *usb_capture;
 #endif
 	sr_resource_open_callback resource_open_cb;
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	/* Cached resource content, see resource.c. */
+	GMutex resource_mutex;
+	GHashTable *resource_cache;
+	GHashTable *resource_loaded;
+	/* Thread settings of all sessions, see sr_thread_sched_set(). */
+	struct sr_thread_sched thread_sched[SR_THREAD_CLASSES];
+	/* Shared worker threads, see sr_task_run(). */
+	GMutex pool_mutex;
+	struct sr_thread_pool *pool;
+	unsigned int pool_threads;
+	gboolean pool_failed;
+	/* Identity and calibration data of devices, see device_cache.c. */
+	GMutex dev_cache_mutex;
+	GKeyFile *dev_cache;
+	char *dev_cache_file;
+	/* Durations of scans, opens and starts, see profile.c. */
+	gint profile_enabled;
+	GMutex profile_mutex;
+	GQueue profile_records;
 };
 
 /** Input module metadata keys. */
@@ -1170,12 +1245,27 @@ struct sr_input {
 	 */
 	const struct sr_input_module *module;
 	GString *buf;
+	/**
+	 * Number of bytes at the start of 'buf' which were processed
+	 * already, see sr_input_buf_consume().
+	 */
+	size_t buf_consumed;
 	struct sr_dev_inst *sdi;
 	gboolean sdi_ready;
 	void *priv;
 };
 
 /** Input (file) module driver. */
+/** A byte signature which identifies an input module's file format. */
+struct sr_input_magic {
+	/** Position of the signature in the input stream. */
+	size_t offset;
+	/** The signature's bytes. */
+	const char *bytes;
+	/** The signature's length in bytes, zero terminates a list. */
+	size_t len;
+};
+
 struct sr_input_module {
 	/**
 	 * A unique ID for this input module, suitable for use in command-line
@@ -1204,6 +1294,19 @@ struct sr_input_module {
 	 */
 	const char *const *exts;
 
+	/**
+	 * A list of byte signatures terminated by an all-zero entry, or
+	 * NULL if the file format has no signature.
+	 *
+	 * When given, the module's format_match() cannot succeed unless
+	 * one of the signatures is found in the stream's header, or the
+	 * filename has one of the module's extensions. Format detection
+	 * skips the module otherwise. A found signature is decisive, the
+	 * modules which don't declare signatures only get a chance when
+	 * none of the modules with found signatures claims the stream.
+	 */
+	const struct sr_input_magic *magic;
+
 	/**
 	 * Zero-terminated list of metadata items the module needs to be able
 	 * to identify an input stream. Can be all-zero, if the module cannot
@@ -1274,6 +1377,21 @@ struct sr_input_module {
 	 */
 	int (*receive) (struct sr_input *in, GString *buf);
 
+	/**
+	 * Send a window of a memory mapped file to the input instance.
+	 *
+	 * This function is optional. Modules which implement it may send
+	 * slices of @a data as datafeed packets without copying them. The
+	 * data only is valid during the call. The number of processed
+	 * bytes is returned in @a consumed, the caller passes the rest
+	 * again with the next window.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_mapped) (struct sr_input *in, uint8_t *data,
+		size_t length, size_t *consumed);
+
 	/**
 	 * Signal the input module no more data will come.
 	 *
@@ -1331,6 +1449,12 @@ struct sr_output {
 	 * there, and only flush it when it reaches a certain size.
 	 */
 	void *priv;
+
+	/**
+	 * Text buffer which sr_output_send_fd() reuses across packets,
+	 * allocated on first use.
+	 */
+	GString *sink_buf;
 };
 
 /** Output module driver. */
@@ -1413,6 +1537,45 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Append the output representation of a packet to a text buffer
+	 * which is owned by the caller.
+	 *
+	 * This function is optional, modules which implement it may leave
+	 * receive() unset. Callers can reuse the same buffer for all
+	 * packets, which avoids an allocation per packet.
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param out The text buffer to append output to.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_append) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet, GString *out);
+
+	/**
+	 * Return the output representation of a packet as a pointer into
+	 * the packet's own payload, for modules which emit payloads as
+	 * they are.
+	 *
+	 * This function is optional. It allows sr_output_send_fd() to
+	 * write the data without copying it. Modules which implement it
+	 * also need to provide receive_append().
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param data Receives the start of the output, or NULL if none.
+	 * @param length Receives the output's length in bytes.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_direct) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet,
+			const uint8_t **data, size_t *length);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1440,6 +1603,9 @@ struct sr_transform {
 	 * state between calls into its callback functions.
 	 */
 	void *priv;
+
+	/** Time spent in receive(), when session statistics are enabled. */
+	struct sr_datafeed_timing timing;
 };
 
 struct sr_transform_module {
@@ -1520,6 +1686,8 @@ struct sr_usb_dev_inst {
 	uint8_t address;
 	/** libusb device handle */
 	struct libusb_device_handle *devhdl;
+	/** Idle transfers for reuse, see sr_usb_transfer_get(). */
+	struct sr_usb_transfer_pool *transfer_pool;
 };
 #endif
 
@@ -1548,6 +1716,14 @@ struct sr_serial_dev_inst {
 #ifdef HAVE_LIBSERIALPORT
 	/** libserialport port handle */
 	struct sp_port *sp_data;
+	/* Background reception for ports without a pollable handle. */
+	GThread *sp_rx_thread;
+	gint sp_rx_running;
+	GMutex sp_rx_mutex;
+	GCond sp_rx_cond;
+	GString *sp_rx_pending;
+	int sp_rx_error;
+	GSource *sp_rx_source;
 #endif
 #ifdef HAVE_LIBHIDAPI
 	enum ser_hid_chip_t {
@@ -1564,6 +1740,14 @@ struct sr_serial_dev_inst {
 	const char *hid_path;
 	hid_device *hid_dev;
 	GSList *hid_source_args;
+	/* Background reception of HID reports. */
+	GThread *hid_rx_thread;
+	gint hid_rx_running;
+	GMutex hid_rx_mutex;
+	GCond hid_rx_cond;
+	GString *hid_rx_pending;
+	GString *hid_rx_taken;
+	int hid_rx_error;
 #endif
 #ifdef HAVE_BLUETOOTH
 	enum ser_bt_conn_t {
@@ -1599,6 +1783,10 @@ struct drv_context {
 	GSList *instances;
 };
 
+/*--- backend.c -------------------------------------------------------------*/
+
+SR_PRIV int sr_init_io_backends(struct sr_context *ctx);
+
 /*--- log.c -----------------------------------------------------------------*/
 
 #if defined(_WIN32) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 4))
@@ -1612,12 +1800,31 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
 #endif
 
-/* Message logging helpers with subsystem-specific prefix string. */
-#define sr_spew(...)	sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_dbg(...)	sr_log(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
-#define sr_info(...)	sr_log(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_err(...)	sr_log(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
+extern SR_PRIV int sr_cur_loglevel;
+
+/*
+ * Most verbose loglevel which gets compiled in, e.g. SR_LOG_INFO drops
+ * all debug messages from the build.
+ */
+#ifndef SR_LOG_MAX_LEVEL
+#define SR_LOG_MAX_LEVEL SR_LOG_SPEW
+#endif
+
+/* Whether messages of a loglevel get logged. */
+#define sr_log_enabled(l) \
+	((l) <= SR_LOG_MAX_LEVEL && (l) <= sr_cur_loglevel)
+
+/*
+ * Message logging helpers with subsystem-specific prefix string. The
+ * arguments only get evaluated when the message gets logged.
+ */
+#define sr_log_if(l, ...) \
+	(sr_log_enabled(l) ? sr_log(l, __VA_ARGS__) : SR_OK)
+#define sr_spew(...)	sr_log_if(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_dbg(...)	sr_log_if(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
+#define sr_info(...)	sr_log_if(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_warn(...)	sr_log_if(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_err(...)	sr_log_if(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -1628,7 +1835,19 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
 #define SR_CONF_DEVICE_OPTIONS 0x7FFF0001
 
 /** Mask for separating config keys from capabilities. */
-#define SR_CONF_MASK 0x1fffffff
+#define SR_CONF_MASK 0x07ffffff
+
+/*
+ * Volatility of a config key, drivers may add one of these to their
+ * device options. sr_config_get() caches values of such keys, other
+ * keys' values are considered live and always come from the driver.
+ */
+
+/** Value only changes when the device gets opened. */
+#define SR_CONF_CACHE_STATIC (1UL << 28)
+
+/** Value only changes when config keys are set, or acquisition starts. */
+#define SR_CONF_CACHE_ON_SET (1UL << 27)
 
 /** Values for the changes argument of sr_dev_driver.config_channel_set. */
 enum {
@@ -1672,6 +1891,16 @@ struct sr_dev_inst {
 	GSList *channels;
 	/** List of sr_channel_group structs */
 	GSList *channel_groups;
+	/** Cached layout of the enabled channels, see sr_dev_channel_layout(). */
+	struct sr_channel_layout *channel_layout;
+	/** Cached config values, see SR_CONF_CACHE_STATIC. */
+	GHashTable *config_cache;
+	/** Whether a config transaction is open, see sr_config_transaction_begin(). */
+	gboolean config_staging;
+	/** Config values set during the open transaction, in order. */
+	GSList *config_staged;
+	/** Whether the device is still programmed for the last acquisition. */
+	gboolean armed;
 	/** Device instance connection data (used?) */
 	void *conn;
 	/** Device instance private data (used?) */
@@ -1680,6 +1909,35 @@ struct sr_dev_inst {
 	struct sr_session *session;
 };
 
+/*
+ * Layout of a device's enabled channels, for code which handles samples.
+ * The arrays list channels in the order of sdi->channels.
+ */
+struct sr_channel_layout {
+	/** All enabled channels. */
+	struct sr_channel **enabled;
+	size_t num_enabled;
+	/** Enabled logic channels, their indices, and where to find them. */
+	struct sr_channel **logic;
+	int *logic_index;
+	/** Byte offset of each enabled logic channel within a sample. */
+	size_t *logic_byte;
+	/** Bit mask of each enabled logic channel within its byte. */
+	uint8_t *logic_bit;
+	size_t num_logic;
+	/** Enabled logic channels by index, for indices below 64. */
+	uint64_t logic_mask;
+	/** Size of a logic sample which holds all logic channels. */
+	size_t logic_unitsize;
+	/** Enabled analog channels. */
+	struct sr_channel **analog;
+	size_t num_analog;
+};
+
+SR_PRIV const struct sr_channel_layout *sr_dev_channel_layout(
+		const struct sr_dev_inst *sdi);
+SR_PRIV void sr_dev_channel_layout_invalidate(const struct sr_dev_inst *sdi);
+
 /* Generic device instances */
 SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi);
 
@@ -1733,7 +1991,11 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *data);
 SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx);
 SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi,
+		gboolean all);
+SR_PRIV void sr_config_transaction_clear(const struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
+SR_PRIV gboolean sr_dev_acquisition_rearmed(const struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
 /*--- session.c -------------------------------------------------------------*/
@@ -1754,6 +2016,11 @@ struct sr_session {
 	sr_session_stopped_callback stopped_callback;
 	/** User data to be passed to the session stop callback. */
 	void *stopped_cb_data;
+	/** One-shot callback of sr_session_stop_fast(), and its data. */
+	sr_session_stopped_callback fast_stop_callback;
+	void *fast_stop_cb_data;
+	/** Set by sr_session_stop_fast(), payload packets get dropped. */
+	gint discarding;
 
 	/** Mutex protecting the main context pointer. */
 	GMutex main_mutex;
@@ -1768,6 +2035,77 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Whether the session gets started by sr_session_rearm(). */
+	gboolean rearming;
+
+	/** Datafeed delivery thread and ring, NULL when not in use. */
+	struct sr_session_ring *ring;
+	/** Configured ring depth, 0 to run callbacks synchronously. */
+	unsigned int ring_depth;
+	/** Whether to drop data packets when the ring is full. */
+	gboolean ring_drop;
+	/** Ring statistics of the most recent session run. */
+	struct sr_session_ring_stats ring_stats;
+
+	/** Transform pipeline worker threads, NULL when not in use. */
+	struct sr_session_pipeline *pipeline;
+	/** Configured pipeline depth, 0 to run transforms synchronously. */
+	unsigned int pipeline_depth;
+	/** Outputs which run on worker threads, see session_outputs.c. */
+	GSList *outputs;
+	/** Latest complete frame, NULL when not in use. */
+	struct sr_frame_mailbox *frame_mailbox;
+
+	/** Pending coalesced data packet, NULL when not in use. */
+	struct sr_session_batch *batch;
+	/** Byte budget of coalesced packets, 0 to disable batching. */
+	size_t batch_bytes;
+	/** Latency budget of coalesced packets in microseconds, or 0. */
+	gint64 batch_latency;
+
+	/** Device clocks and held back packets, NULL when not in use. */
+	struct sr_session_merge *merge;
+	/** Byte budget of held back packets, 0 to disable merging. */
+	size_t merge_bytes;
+	/** Guards the device clocks. */
+	GMutex merge_mutex;
+
+	/** Device event processing threads, NULL when not in use. */
+	struct sr_session_threads *threads;
+	/** Whether to run each device in a thread of its own. */
+	gboolean device_threads;
+	/** Whether to handle USB events in a thread of their own. */
+	gboolean usb_thread;
+	/** Whether the USB thread uses real-time scheduling. */
+	gboolean usb_thread_realtime;
+
+	/** Whether to multiplex fd sources through epoll. */
+	gboolean use_epoll;
+	/** Epoll multiplexer of the current run, NULL when not in use. */
+	GSource *epoll_source;
+
+	/** Whether to collect datafeed statistics. */
+	gboolean stats_enabled;
+	/** Datafeed statistics of the current or most recent run. */
+	struct sr_session_datafeed_stats stats;
+
+	/** Rolling retention buffer of the datafeed, NULL when not in use. */
+	struct sr_session_retention *retention;
+
+	/** Memory budget of the session's components, NULL when not in use. */
+	struct sr_session_budget *budget;
+
+	/** Thread settings which override those of the context. */
+	struct sr_thread_sched thread_sched[SR_THREAD_CLASSES];
+};
+
+/** A datafeed callback which was registered with a session. */
+struct datafeed_callback {
+	sr_datafeed_callback cb;
+	void *cb_data;
+	uint32_t flags;
+	/** Time spent in the callback, when statistics are enabled. */
+	struct sr_datafeed_timing timing;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1789,6 +2127,9 @@ SR_PRIV int sr_session_source_add_channel(struct sr_session *session,
 		GIOChannel *channel, int events, int timeout,
 		sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int sr_session_source_remove(struct sr_session *session, int fd);
+SR_PRIV GSource *sr_session_timer_add(struct sr_session *session,
+		unsigned int interval_ms, GSourceFunc cb, void *cb_data);
+SR_PRIV void sr_session_timer_remove(GSource *source);
 SR_PRIV int sr_session_source_remove_pollfd(struct sr_session *session,
 		GPollFD *pollfd);
 SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
@@ -1796,12 +2137,216 @@ SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 
 SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
+SR_PRIV gboolean sr_session_discards(const struct sr_session *session,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV gboolean sr_session_logic_planar_wanted(const struct sr_session *session);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_lent(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		GDestroyNotify release, void *release_data);
+/** Metadata of an unreferenced packet, see sr_packet_info_scope_begin(). */
+struct sr_packet_info_scope {
+	const struct sr_datafeed_packet *packet;
+	struct sr_datafeed_packet_info info;
+	struct sr_packet_info_scope *prev;
+};
+
+SR_PRIV void sr_packet_info_scope_begin(struct sr_packet_info_scope *scope,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info);
+SR_PRIV void sr_packet_info_scope_end(struct sr_packet_info_scope *scope);
+SR_PRIV int sr_session_send_info(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info);
+SR_PRIV int sr_session_send_lent_info(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info,
+		GDestroyNotify release, void *release_data);
+SR_PRIV int sr_session_deliver(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_deliver_merged(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_deliver_unbatched(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_dispatch(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
 SR_PRIV int sr_sessionfile_check(const char *filename);
+
+/*--- session_ring.c --------------------------------------------------------*/
+
+struct sr_session_ring;
+
+SR_PRIV int sr_session_ring_start(struct sr_session *session,
+		unsigned int depth, gboolean drop_when_full);
+SR_PRIV void sr_session_ring_stop(struct sr_session *session);
+SR_PRIV int sr_session_ring_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+
+/*--- session_batch.c -------------------------------------------------------*/
+
+struct sr_session_batch;
+
+SR_PRIV int sr_session_batch_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_batch_stop(struct sr_session *session);
+
+/*--- session_merge.c -------------------------------------------------------*/
+
+struct sr_session_merge;
+
+SR_PRIV int64_t sr_session_clock_packet(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info);
+SR_PRIV void sr_session_clock_reset(struct sr_session *session);
+SR_PRIV int sr_session_merge_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int64_t time_ns);
+SR_PRIV void sr_session_merge_stop(struct sr_session *session);
+SR_PRIV void sr_session_merge_free(struct sr_session *session);
+
+/*--- session_stats.c -------------------------------------------------------*/
+
+SR_PRIV void sr_session_stats_reset(struct sr_session *session);
+SR_PRIV uint64_t sr_packet_payload_bytes(
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_stats_packet(struct sr_session *session,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_datafeed_timing_add(struct sr_datafeed_timing *timing,
+		gint64 usecs);
+
+/*--- session_retain.c ------------------------------------------------------*/
+
+struct sr_session_retention;
+
+SR_PRIV void sr_session_retention_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_retention_reset(struct sr_session *session);
+SR_PRIV void sr_session_retention_free(struct sr_session *session);
+
+/*--- session_budget.c ------------------------------------------------------*/
+
+struct sr_session_budget;
+struct sr_mem_account;
+
+SR_PRIV struct sr_mem_account *sr_mem_account_new(struct sr_session *session,
+		const char *name);
+SR_PRIV void sr_mem_account_free(struct sr_mem_account *acct);
+SR_PRIV void sr_mem_account_charge(struct sr_mem_account *acct, size_t bytes);
+SR_PRIV gboolean sr_mem_account_try_charge(struct sr_mem_account *acct,
+		size_t bytes);
+SR_PRIV void sr_mem_account_release(struct sr_mem_account *acct, size_t bytes);
+SR_PRIV gboolean sr_mem_account_pressure(const struct sr_mem_account *acct);
+SR_PRIV void sr_session_budget_free(struct sr_session *session);
+
+/*--- session_pipeline.c ----------------------------------------------------*/
+
+struct sr_session_pipeline;
+
+SR_PRIV int sr_session_pipeline_start(struct sr_session *session,
+		unsigned int depth);
+SR_PRIV void sr_session_pipeline_stop(struct sr_session *session);
+SR_PRIV int sr_session_pipeline_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+
+/*--- session_outputs.c -----------------------------------------------------*/
+
+SR_PRIV void sr_session_outputs_push(struct sr_session *session,
+		const struct sr_datafeed_packet *packet);
+
+/*--- session_mailbox.c -----------------------------------------------------*/
+
+struct sr_frame_mailbox;
+
+SR_PRIV void sr_session_frame_mailbox_push(struct sr_session *session,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_frame_mailbox_free(struct sr_session *session);
+
+/*--- session_threads.c -----------------------------------------------------*/
+
+struct sr_session_threads;
+
+SR_PRIV int sr_session_threads_start(struct sr_session *session);
+SR_PRIV void sr_session_threads_stop(struct sr_session *session);
+SR_PRIV int sr_session_threads_dev_call(struct sr_session *session,
+		struct sr_dev_inst *sdi, int (*func)(struct sr_dev_inst *sdi),
+		gboolean wait);
+SR_PRIV GMainContext *sr_session_threads_context(struct sr_session *session);
+SR_PRIV gboolean sr_session_threads_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- thread_sched.c --------------------------------------------------------*/
+
+SR_PRIV void sr_thread_sched_apply(const struct sr_session *session,
+		enum sr_thread_class cls, int default_priority);
+SR_PRIV void sr_thread_sched_enter(const struct sr_session *session,
+		enum sr_thread_class cls);
+
+/*--- thread_pool.c ---------------------------------------------------------*/
+
+struct sr_thread_pool;
+
+/** A routine which runs on the shared worker pool, see sr_task_run(). */
+typedef void (*sr_task_func)(void *data);
+
+/** A set of tasks to wait for, see sr_task_group_wait(). */
+struct sr_task_group {
+	GMutex mutex;
+	GCond cond;
+	unsigned int pending;
+};
+
+SR_PRIV void sr_thread_pool_exit(struct sr_context *ctx);
+SR_PRIV void sr_task_group_init(struct sr_task_group *group);
+SR_PRIV void sr_task_group_clear(struct sr_task_group *group);
+SR_PRIV void sr_task_run(struct sr_context *ctx, struct sr_task_group *group,
+		sr_task_func func, void *data);
+SR_PRIV void sr_task_group_wait(struct sr_context *ctx,
+		struct sr_task_group *group);
+
+/*--- device_cache.c --------------------------------------------------------*/
+
+SR_PRIV int sr_dev_cache_get(const struct sr_dev_inst *sdi,
+		const char *item, const char *version, void *data, size_t len);
+SR_PRIV void sr_dev_cache_put(const struct sr_dev_inst *sdi,
+		const char *item, const char *version,
+		const void *data, size_t len);
+SR_PRIV void sr_dev_cache_invalidate(const struct sr_dev_inst *sdi);
+SR_PRIV void sr_dev_cache_free(struct sr_context *ctx);
+
+/*--- profile.c -------------------------------------------------------------*/
+
+/** A phase being timed, see sr_profile_begin(). */
+struct sr_profile_scope {
+	struct sr_context *ctx;
+	enum sr_profile_phase phase;
+	const struct sr_dev_driver *driver;
+	const struct sr_dev_inst *sdi;
+	gboolean enabled;
+	int64_t start_us;
+	struct sr_profile_scope *outer;
+};
+
+SR_PRIV void sr_profile_begin(struct sr_profile_scope *scope,
+		struct sr_context *ctx, enum sr_profile_phase phase,
+		const struct sr_dev_driver *driver, const struct sr_dev_inst *sdi);
+SR_PRIV void sr_profile_end(struct sr_profile_scope *scope, int result);
+SR_PRIV void sr_profile_init(struct sr_context *ctx);
+SR_PRIV void sr_profile_exit(struct sr_context *ctx);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -1810,16 +2355,45 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 SR_PRIV void sr_zip_discard(struct zip *archive);
 #endif
 
+/*
+ * Logic members of session files version 3 can hold runs of identical
+ * samples ("capture encoding" is "runs"). Each run is a 32bit little
+ * endian sample count, followed by the sample value.
+ */
+#define SR_SESSIONFILE_RUN_COUNT_SIZE sizeof(uint32_t)
+
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
+SR_PRIV int sr_sessionfile_analog_encoding_set(GKeyFile *kf, size_t ch_nr,
+		const struct sr_analog_encoding *encoding);
+SR_PRIV int sr_sessionfile_analog_encoding_get(GKeyFile *kf, size_t ch_nr,
+		struct sr_analog_encoding *encoding);
+
+/*--- input/input.c ---------------------------------------------------------*/
+
+SR_PRIV void sr_input_buf_append(struct sr_input *in,
+		const char *data, size_t length);
+SR_PRIV char *sr_input_buf_ptr(const struct sr_input *in);
+SR_PRIV size_t sr_input_buf_len(const struct sr_input *in);
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t length);
 
 /*--- analog.c --------------------------------------------------------------*/
 
+SR_PRIV int sr_analog_to_levels(const struct sr_datafeed_analog *analog,
+	size_t first, size_t step, size_t count, float lo_thr, float hi_thr,
+	uint8_t *state, uint8_t *out, size_t out_stride, uint8_t mask);
+SR_PRIV int sr_analog_to_raw_units(const struct sr_datafeed_analog *analog,
+	size_t first, size_t step, size_t count, double *out,
+	double *unit_scale, double *unit_offset);
+
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_encoding *encoding,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV void sr_analog_encoding_set_raw(struct sr_analog_encoding *encoding,
+	unsigned int unitsize, gboolean is_signed, gboolean is_bigendian,
+	double scale, double offset);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -1896,6 +2470,22 @@ SR_PRIV int std_dummy_set_params(struct sr_serial_dev_inst *serial,
 SR_PRIV int std_dummy_set_handshake(struct sr_serial_dev_inst *serial,
 	int rts, int dtr);
 
+/** Part of a device's sample memory which needs to get downloaded. */
+struct std_download_window {
+	/** First unit to download, relative to the oldest valid unit. */
+	uint64_t first;
+	/** Number of units to download. */
+	uint64_t count;
+	/** Trigger position within the window, or STD_DOWNLOAD_NO_TRIGGER. */
+	uint64_t trigger;
+};
+#define STD_DOWNLOAD_NO_TRIGGER UINT64_MAX
+
+SR_PRIV void std_download_window(struct std_download_window *win,
+	uint64_t captured, uint64_t trigger, uint64_t pre, uint64_t post);
+SR_PRIV void std_download_window_limits(struct std_download_window *win,
+	uint64_t captured, uint64_t trigger, uint64_t limit, uint64_t ratio);
+
 /*--- resource.c ------------------------------------------------------------*/
 
 SR_PRIV int64_t sr_file_get_size(FILE *file);
@@ -1911,6 +2501,13 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx);
+SR_PRIV char *sr_resource_checksum(struct sr_context *ctx,
+		int type, const char *name);
+SR_PRIV void sr_resource_set_loaded(struct sr_context *ctx,
+		const char *target, int type, const char *name);
+SR_PRIV int sr_resource_check_loaded(struct sr_context *ctx,
+		const char *target, int type, const char *name);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -1927,19 +2524,124 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret);
 SR_PRIV GString *sr_hexdump_new(const uint8_t *data, const size_t len);
 SR_PRIV void sr_hexdump_free(GString *s);
 
+/*--- trigger.c -------------------------------------------------------------*/
+
+/** What a device's hardware trigger can match, see sr_trigger_split(). */
+struct sr_trigger_hw_caps {
+	/** Number of stages the hardware matches in sequence. */
+	int num_stages;
+	/** Supported matches, bits of (1 << enum sr_trigger_matches). */
+	uint32_t matches;
+	/** Hardware matches logic channels with indices below this. */
+	int num_channels;
+};
+
+SR_PRIV int sr_trigger_split(const struct sr_trigger *trigger,
+		const struct sr_trigger_hw_caps *caps,
+		struct sr_trigger **hw_trigger, struct sr_trigger **sw_trigger);
+
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+/*
+ * Circular buffer of the most recent samples before a trigger, of both
+ * the logic and the analog trigger. Sizes are in bytes.
+ */
+struct soft_trigger_history {
+	uint8_t *buffer;
+	uint8_t *head;
+	int size;
+	int fill;
+	struct sr_mem_account *account;
+};
+
+/*
+ * Trigger stage, compiled to bit masks in sample memory layout. A sample
+ * matches when all level bits have their expected value, and all bits
+ * in the edge masks changed in the respective direction.
+ */
+struct soft_trigger_logic_stage {
+	/* Masks of unitsize bytes each, for wide samples. */
+	uint8_t *level_mask;
+	uint8_t *level_value;
+	uint8_t *rise_mask;
+	uint8_t *fall_mask;
+	uint8_t *edge_mask;
+	/* Same masks as words, for samples of up to 8 bytes. */
+	uint64_t w_level_mask;
+	uint64_t w_level_value;
+	uint64_t w_rise_mask;
+	uint64_t w_fall_mask;
+	uint64_t w_edge_mask;
+	gboolean has_edges;
+};
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
 	int count;
 	int unitsize;
+	const struct sr_logic_ops *ops;
 	int cur_stage;
+	int num_stages;
+	struct soft_trigger_logic_stage *stages;
 	uint8_t *prev_sample;
-	uint8_t *pre_trigger_buffer;
-	uint8_t *pre_trigger_head;
-	int pre_trigger_size;
-	int pre_trigger_fill;
+	struct soft_trigger_history pre_trigger;
+	/* Segmented capture, see soft_trigger_logic_set_segmented(). */
+	gboolean segmented;
+	int post_trigger_samples;
+	int holdoff_samples;
+	struct sr_sw_limits *limits;
+	gboolean in_segment;
+	int seg_remain;
+	int holdoff_remain;
+};
+
+/* Condition of an analog trigger stage, on one channel. */
+struct soft_trigger_analog_cond {
+	struct sr_channel *channel;
+	int type;
+	/* Crossing level or lower limit, and upper limit, in values. */
+	float level;
+	float level2;
+	/* Position of the channel in the current payload, -1 if absent. */
+	int pos;
+	/* Thresholds in the current payload's raw sample units. */
+	double raw_level;
+	double raw_level2;
+	double raw_hysteresis;
+	double raw_slope;
+	/* A crossing needs the value on the other side of the hysteresis. */
+	gboolean armed;
+	gboolean have_prev;
+	/* The previous value in raw units, and as a value across payloads. */
+	double prev;
+	double prev_value;
+	/* A block of the channel's values, and the next one to check. */
+	double *values;
+	size_t next;
+};
+
+struct soft_trigger_analog_stage {
+	struct soft_trigger_analog_cond *conds;
+	int num_conds;
+};
+
+struct soft_trigger_analog {
+	const struct sr_dev_inst *sdi;
+	const struct sr_trigger *trigger;
+	int cur_stage;
+	int num_stages;
+	struct soft_trigger_analog_stage *stages;
+	float hysteresis;
+	float slope;
+	int pre_trigger_samples;
+	struct soft_trigger_history pre_trigger;
+	/* Layout of the samples which the pre-trigger buffer holds. */
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GSList *channels;
+	int frame_size;
 };
 
 SR_PRIV int logic_channel_unitsize(GSList *channels);
@@ -1949,9 +2651,41 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV void soft_trigger_logic_skip(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len);
+SR_PRIV void soft_trigger_logic_set_segmented(struct soft_trigger_logic *stl,
+		int post_trigger_samples, int holdoff_samples,
+		struct sr_sw_limits *limits);
+SR_PRIV gboolean soft_trigger_logic_segment(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len);
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples);
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta);
+SR_PRIV void soft_trigger_analog_set_hysteresis(struct soft_trigger_analog *sta,
+		float hysteresis);
+SR_PRIV void soft_trigger_analog_set_slope(struct soft_trigger_analog *sta,
+		float slope);
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int *pre_trigger_samples);
 
 /*--- serial.c --------------------------------------------------------------*/
 
+/**
+ * Fixed bytes of a packet format, used to skip over receive data which
+ * cannot start a packet while synchronizing to a stream. The header
+ * is found at the start of a packet, optionally matched through a mask.
+ * The trailer is found at the end of fixed size packets. Either part
+ * can be empty.
+ */
+struct sr_packet_sync {
+	const uint8_t *header;
+	const uint8_t *header_mask;
+	size_t header_len;
+	const uint8_t *trailer;
+	size_t trailer_len;
+};
+
 #ifdef HAVE_SERIAL_COMM
 enum {
 	SERIAL_RDWR = 1,
@@ -1994,6 +2728,14 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 		size_t packet_size, packet_valid_callback is_valid,
 		packet_valid_len_callback is_valid_len, size_t *return_size,
 		uint64_t timeout_ms);
+SR_PRIV int serial_stream_detect_sync(struct sr_serial_dev_inst *serial,
+		uint8_t *buf, size_t *buflen,
+		size_t packet_size, packet_valid_callback is_valid,
+		packet_valid_len_callback is_valid_len,
+		const struct sr_packet_sync *sync, size_t *return_size,
+		uint64_t timeout_ms);
+SR_PRIV size_t serial_packet_sync_next(const struct sr_packet_sync *sync,
+		const uint8_t *buf, size_t pos, size_t len, size_t packet_size);
 SR_PRIV int serial_source_add(struct sr_session *session,
 		struct sr_serial_dev_inst *serial, int events, int timeout,
 		sr_receive_data_callback cb, void *cb_data);
@@ -2097,6 +2839,8 @@ SR_PRIV int sr_bt_config_rfcomm(struct sr_bt_desc *desc, size_t channel);
 SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	uint16_t read_handle, uint16_t write_handle,
 	uint16_t cccd_handle, uint16_t cccd_value);
+SR_PRIV int sr_bt_config_batch(struct sr_bt_desc *desc,
+	size_t count, gboolean merge);
 
 SR_PRIV int sr_bt_scan_le(struct sr_bt_desc *desc, int duration);
 SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration);
@@ -2129,15 +2873,75 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 SR_PRIV int sr_usb_split_conn(const char *conn,
 	uint16_t *vid, uint16_t *pid, uint8_t *bus, uint8_t *addr);
 #ifdef HAVE_LIBUSB_1_0
-SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
+SR_PRIV void sr_usb_scan_begin(struct sr_context *ctx);
+SR_PRIV void sr_usb_scan_end(struct sr_context *ctx);
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list);
+SR_PRIV void sr_usb_free_device_list(libusb_device **list);
+SR_PRIV int sr_usb_get_strings(struct sr_context *ctx, libusb_device *dev,
+		char *manufacturer, char *product, char *serial_num, size_t len);
+SR_PRIV GSList *sr_usb_find(struct sr_context *ctx, const char *conn);
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
+SR_PRIV struct libusb_transfer *sr_usb_transfer_get(struct sr_usb_dev_inst *usb,
+		size_t size);
+SR_PRIV void sr_usb_transfer_put(struct sr_usb_dev_inst *usb,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_transfer_pool_free(struct sr_usb_dev_inst *usb);
+SR_PRIV int sr_usb_bulk_write(struct sr_context *ctx,
+		struct sr_usb_dev_inst *usb, unsigned char endpoint,
+		const uint8_t *data, size_t len, size_t chunk_size,
+		unsigned int timeout_ms);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+SR_PRIV int usb_source_timeout_set(struct sr_session *session,
+		struct sr_context *ctx, int timeout);
+SR_PRIV GSource *usb_source_attach(struct sr_context *ctx,
+		GMainContext *main_ctx, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product);
+SR_PRIV int usb_wait_renumeration(struct sr_dev_inst *sdi,
+		int64_t fw_updated, int timeout_ms,
+		int (*probe)(struct sr_dev_inst *sdi));
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product);
+#endif
+
+/*--- usb_capture.c ---------------------------------------------------------*/
+
+#ifdef HAVE_LIBUSB_1_0
+struct sr_usb_replay;
+
+SR_PRIV void sr_usb_capture_transfer(const struct sr_dev_inst *sdi,
+		const struct libusb_transfer *transfer);
+SR_PRIV int sr_usb_submit_transfer(struct libusb_transfer *transfer);
+SR_PRIV struct sr_usb_replay *sr_usb_replay_new(const char *driver);
+SR_PRIV void sr_usb_replay_add(struct sr_usb_replay *replay, uint8_t endpoint,
+		int status, const uint8_t *data, size_t length);
+SR_PRIV struct sr_usb_replay *sr_usb_replay_load(const char *filename);
+SR_PRIV const char *sr_usb_replay_driver(const struct sr_usb_replay *replay);
+SR_PRIV size_t sr_usb_replay_run(struct sr_usb_replay *replay,
+		struct sr_dev_inst *sdi, libusb_transfer_cb_fn callback,
+		size_t buffer_size, uint64_t *bytes);
+SR_PRIV void sr_usb_replay_free(struct sr_usb_replay *replay);
+#endif
+
+/*--- ftdi_stream.c ---------------------------------------------------------*/
+
+#ifdef HAVE_LIBFTDI
+struct sr_ftdi_stream;
+
+/* Receives the payload of one USB packet, status bytes are stripped. */
+typedef int (*sr_ftdi_stream_callback)(void *cb_data,
+		const uint8_t *data, size_t len);
+
+SR_PRIV struct sr_ftdi_stream *sr_ftdi_stream_new(struct ftdi_context *ftdic,
+		size_t num_transfers, size_t transfer_size,
+		sr_ftdi_stream_callback cb, void *cb_data);
+SR_PRIV int sr_ftdi_stream_start(struct sr_ftdi_stream *stream);
+SR_PRIV int sr_ftdi_stream_poll(struct sr_ftdi_stream *stream, int timeout_ms);
+SR_PRIV void sr_ftdi_stream_stop(struct sr_ftdi_stream *stream);
+SR_PRIV void sr_ftdi_stream_free(struct sr_ftdi_stream *stream);
 #endif
 
 /*--- binary_helpers.c ------------------------------------------------------*/
@@ -2190,6 +2994,21 @@ struct binary_analog_channel {
 SR_PRIV int bv_get_value(float *out, const struct binary_value_spec *spec,
 	const void *data, size_t length);
 
+/**
+ * Extract a value from each of several records in a binary blob.
+ *
+ * @param[out] out Output buffer, @a count values
+ * @param[in] spec Binary value specification, within the first record
+ * @param[in] data Pointer to binary input data
+ * @param[in] stride Distance between records in bytes
+ * @param[in] count Number of records
+ * @param[in] length Size of binary input data
+ *
+ * @return SR_OK on success, SR_ERR_* error code on failure.
+ */
+SR_PRIV int bv_get_values(float *out, const struct binary_value_spec *spec,
+	const void *data, size_t stride, size_t count, size_t length);
+
 /**
  * Send an analog channel packet based on a binary analog channel
  * specification.
@@ -2206,6 +3025,352 @@ SR_PRIV int bv_send_analog_channel(const struct sr_dev_inst *sdi,
 	struct sr_channel *ch, const struct binary_analog_channel *spec,
 	const void *data, size_t length);
 
+/*
+ * Bulk variants of read_u16le() et al: convert @a count values at @a in
+ * into host order, or into floats as (value * scale + offset).
+ */
+SR_PRIV void sr_read_u16le_array(uint16_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_u16be_array(uint16_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_u32le_array(uint32_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_u32be_array(uint32_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_u64le_array(uint64_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_u64be_array(uint64_t *out, const void *in, size_t count);
+SR_PRIV void sr_read_fltle_array(float *out, const void *in, size_t count);
+SR_PRIV void sr_read_fltbe_array(float *out, const void *in, size_t count);
+SR_PRIV void sr_read_u8_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_i8_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_u16le_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_u16be_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_i16le_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_i16be_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_u32le_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_u32be_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_i32le_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_i32be_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_fltle_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_fltbe_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_dblle_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+SR_PRIV void sr_read_dblbe_float(float *out, const void *in, size_t count,
+	double scale, double offset);
+
+/*--- logic_rle.c -----------------------------------------------------------*/
+
+/* Receives the SR_DF_LOGIC packets of expanded RLE or planar packets. */
+typedef int (*sr_logic_rle_chunk_cb)(const struct sr_datafeed_packet *packet,
+		void *cb_data);
+
+/*
+ * Helpers for logic samples, specialized for the common unit sizes.
+ * Code which handles a stream picks them once, see sr_logic_ops_get().
+ * SR_LOGIC_UNITSIZES() expands X(n) for each specialized unit size.
+ */
+#define SR_LOGIC_UNITSIZES(X) X(1) X(2) X(4) X(8)
+
+struct sr_logic_ops {
+	/** The unit size, 0 for the generic implementation. */
+	size_t unitsize;
+	/** Fill @a count samples with @a value, see sr_logic_fill_samples(). */
+	void (*fill)(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count);
+	/** Compare two samples. */
+	gboolean (*equal)(const uint8_t *a, const uint8_t *b, size_t unitsize);
+	/** Copy one sample. */
+	void (*copy)(uint8_t *dst, const uint8_t *src, size_t unitsize);
+	/** Index of the first of @a count samples which differs from @a value. */
+	uint64_t (*find_change)(const uint8_t *data, const uint8_t *value,
+		size_t unitsize, uint64_t count);
+};
+
+SR_PRIV const struct sr_logic_ops *sr_logic_ops_get(size_t unitsize);
+SR_PRIV void sr_logic_fill_samples(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count);
+SR_PRIV int sr_logic_rle_foreach_chunk(const struct sr_datafeed_packet *packet,
+		sr_logic_rle_chunk_cb cb, void *cb_data);
+
+/*--- logic_planar.c --------------------------------------------------------*/
+
+SR_PRIV int sr_logic_planar_foreach_chunk(const struct sr_datafeed_packet *packet,
+		sr_logic_rle_chunk_cb cb, void *cb_data);
+
+/*--- large_buffer.c --------------------------------------------------------*/
+
+SR_PRIV void *sr_large_buffer_alloc(size_t size, int numa_node);
+SR_PRIV void sr_large_buffer_free(void *buf);
+SR_PRIV void sr_large_buffer_prefault(void *buf);
+SR_PRIV int sr_dev_numa_node(const struct sr_dev_inst *sdi);
+
+/*--- zip_writer.c ----------------------------------------------------------*/
+
+struct sr_zip_writer;
+
+/* Compression methods of ZIP archive members, as in the ZIP headers. */
+#define SR_ZIP_METHOD_STORE		0
+#define SR_ZIP_METHOD_DEFLATE		8
+#define SR_ZIP_METHOD_ZSTD		93
+
+/** A ZIP archive member which is ready to be written. */
+struct sr_zip_member {
+	uint16_t method;
+	uint32_t crc;
+	size_t usize;
+	size_t csize;
+	const void *data;
+	uint8_t *cbuf;
+};
+
+SR_PRIV struct sr_zip_writer *sr_zip_writer_open(const char *filename);
+SR_PRIV gboolean sr_zip_method_supported(uint16_t method);
+SR_PRIV void sr_zip_member_prepare(struct sr_zip_member *member,
+	const void *data, size_t length, uint16_t method, int level);
+SR_PRIV void sr_zip_member_clear(struct sr_zip_member *member);
+SR_PRIV int sr_zip_writer_add_member(struct sr_zip_writer *zw,
+	const char *name, const struct sr_zip_member *member);
+SR_PRIV int sr_zip_writer_add(struct sr_zip_writer *zw, const char *name,
+	const void *data, size_t length, int level);
+SR_PRIV int sr_zip_writer_finish(struct sr_zip_writer *zw);
+
+/*--- capture_file.c --------------------------------------------------------*/
+
+#define SR_CAPFILE_MAGIC		"sigrokCF"
+#define SR_CAPFILE_VERSION		1
+#define SR_CAPFILE_ALIGN		64
+#define SR_CAPFILE_ALIGN_UP(x) \
+	(((x) + SR_CAPFILE_ALIGN - 1) / SR_CAPFILE_ALIGN * SR_CAPFILE_ALIGN)
+#define SR_CAPFILE_HEADER_FIXED		48
+#define SR_CAPFILE_EXTENT_MAGIC		0x45435253 /* "SRCE" */
+#define SR_CAPFILE_EXTENT_SIZE		SR_CAPFILE_ALIGN
+#define SR_CAPFILE_INDEX_MAGIC		0x49435253 /* "SRCI" */
+#define SR_CAPFILE_INDEX_HEADER		16
+#define SR_CAPFILE_INDEX_ENTRY		32
+
+/** The header of an uncompressed capture file. */
+struct sr_capfile_header {
+	uint32_t header_size;
+	uint64_t samplerate;
+	uint64_t index_offset;
+	uint32_t num_logic;
+	uint32_t unitsize;
+	uint32_t num_analog;
+	/* Logic channel names first, then analog ones. */
+	char **names;
+};
+
+SR_PRIV size_t sr_capfile_header_size(const struct sr_capfile_header *hdr);
+SR_PRIV void sr_capfile_header_write(uint8_t *buf,
+	const struct sr_capfile_header *hdr);
+SR_PRIV int sr_capfile_header_parse(const uint8_t *buf, size_t len,
+	struct sr_capfile_header *hdr);
+SR_PRIV void sr_capfile_header_clear(struct sr_capfile_header *hdr);
+SR_PRIV void sr_capfile_extent_write(uint8_t *buf, uint32_t group,
+	uint64_t num_samples, uint64_t data_size);
+SR_PRIV int sr_capfile_extent_parse(const uint8_t *buf, uint32_t *group,
+	uint64_t *num_samples, uint64_t *data_size);
+
+/*--- net_stream.c ----------------------------------------------------------*/
+
+#define SR_NET_MAGIC			"sigrokNS"
+#define SR_NET_VERSION			1
+#define SR_NET_FRAME_HEADER		8
+#define SR_NET_MAX_FRAME		(64 * 1024 * 1024)
+/* Magic, version, logic and analog channel counts, reserved, samplerate. */
+#define SR_NET_HELLO_FIXED		32
+/* Unit size. */
+#define SR_NET_LOGIC_HEADER		4
+/* Channel, samples, mq, unit, mqflags (64 bit), digits, reserved. */
+#define SR_NET_ANALOG_HEADER		32
+
+/** Types of the frames in a network datafeed stream. */
+enum sr_net_frame_type {
+	/** The stream's channel layout, followed by their names. */
+	SR_NET_HELLO = 1,
+	SR_NET_HEADER,
+	SR_NET_END,
+	/** Payload is the samplerate, 64 bits. */
+	SR_NET_SAMPLERATE,
+	SR_NET_LOGIC,
+	/** Values are little endian floats. */
+	SR_NET_ANALOG,
+	SR_NET_TRIGGER,
+	SR_NET_FRAME_BEGIN,
+	SR_NET_FRAME_END,
+	SR_NET_BATCH,
+};
+
+SR_PRIV void sr_net_frame_header(GString *buf, uint32_t type, uint32_t length);
+SR_PRIV int sr_net_frame_parse(const uint8_t *buf, size_t len,
+	uint32_t *type, uint32_t *length);
+SR_PRIV gboolean sr_net_batch_compression(void);
+SR_PRIV int sr_net_batch_pack(GString *out, const uint8_t *frames,
+	size_t len, int level);
+SR_PRIV int sr_net_batch_unpack(const uint8_t *payload, size_t len,
+	GByteArray *out);
+
+/*--- shm_ring.c ------------------------------------------------------------*/
+
+#define SR_SHM_RING_MAGIC		"sigrokSR"
+#define SR_SHM_RING_VERSION		1
+#define SR_SHM_RING_READERS		16
+#define SR_SHM_RING_CHANNELS		256
+#define SR_SHM_RING_NAME_LEN		32
+#define SR_SHM_RING_MAX_SIZE		(1U << 30)
+
+/** Types of the records in a shared memory datafeed ring. */
+enum sr_shm_record_type {
+	/** Fills the end of the ring, skipped by readers. */
+	SR_SHM_REC_PAD,
+	SR_SHM_REC_HEADER,
+	SR_SHM_REC_END,
+	/** Payload is the samplerate as uint64_t. */
+	SR_SHM_REC_SAMPLERATE,
+	/** Payload is struct sr_shm_rec_logic, followed by the samples. */
+	SR_SHM_REC_LOGIC,
+	/** Payload is struct sr_shm_rec_analog, followed by float samples. */
+	SR_SHM_REC_ANALOG,
+	SR_SHM_REC_TRIGGER,
+	SR_SHM_REC_FRAME_BEGIN,
+	SR_SHM_REC_FRAME_END,
+};
+
+struct sr_shm_ring_record {
+	uint32_t type;
+	uint32_t size;
+};
+
+struct sr_shm_rec_logic {
+	uint32_t unitsize;
+	uint32_t reserved;
+};
+
+/** One channel's samples, the channel is an index into the analog names. */
+struct sr_shm_rec_analog {
+	uint32_t channel;
+	uint32_t num_samples;
+	int32_t mq;
+	int32_t unit;
+	uint64_t mqflags;
+	int32_t digits;
+	uint32_t reserved;
+};
+
+struct sr_shm_ring_reader {
+	volatile gint state;
+	volatile gint generation;
+	volatile gint pos;
+	gint pid;
+};
+
+/** Header at the start of the shared memory, the ring's data follows. */
+struct sr_shm_ring_info {
+	char magic[8];
+	uint32_t version;
+	uint32_t data_size;
+	volatile gint write_pos;
+	volatile gint writer_closed;
+	uint64_t samplerate;
+	uint32_t num_logic;
+	uint32_t num_analog;
+	struct sr_shm_ring_reader readers[SR_SHM_RING_READERS];
+	/* Logic channel names first, then analog ones. */
+	char names[SR_SHM_RING_CHANNELS][SR_SHM_RING_NAME_LEN];
+};
+
+/** A process' mapping of a shared memory datafeed ring. */
+struct sr_shm_ring {
+	int fd;
+	char *name;
+	size_t map_size;
+	struct sr_shm_ring_info *info;
+	uint8_t *data;
+	gboolean writer;
+	/* Writer side. */
+	guint pending_pos;
+	/* Reader side. */
+	int reader;
+	gint reader_generation;
+	guint read_pos;
+};
+
+SR_PRIV struct sr_shm_ring *sr_shm_ring_create(const char *name, size_t size);
+SR_PRIV void sr_shm_ring_publish(struct sr_shm_ring *ring);
+SR_PRIV struct sr_shm_ring *sr_shm_ring_open(const char *name);
+SR_PRIV void sr_shm_ring_close(struct sr_shm_ring *ring);
+SR_PRIV void *sr_shm_ring_reserve(struct sr_shm_ring *ring, uint32_t type,
+	size_t size, int timeout_ms);
+SR_PRIV void sr_shm_ring_commit(struct sr_shm_ring *ring);
+SR_PRIV size_t sr_shm_ring_max_payload(const struct sr_shm_ring *ring);
+SR_PRIV int sr_shm_ring_attach(struct sr_shm_ring *ring);
+SR_PRIV void sr_shm_ring_detach(struct sr_shm_ring *ring);
+SR_PRIV int sr_shm_ring_peek(struct sr_shm_ring *ring,
+	const struct sr_shm_ring_record **record);
+SR_PRIV void sr_shm_ring_release(struct sr_shm_ring *ring);
+SR_PRIV gboolean sr_shm_ring_writer_closed(const struct sr_shm_ring *ring);
+
+/*--- bitplanes.c ----------------------------------------------------------*/
+
+SR_PRIV void sr_bitplanes_to_samples(uint8_t *samples, size_t unitsize,
+	const uint8_t *const *planes, size_t plane_bytes);
+
+/* Number of samples which one sr_bitslice_load() call slices. */
+#define SR_BITSLICE_SAMPLES 4096
+#define SR_BITSLICE_PLANE_BYTES (SR_BITSLICE_SAMPLES / 8)
+
+/** Per-channel bit planes of a block of logic samples. */
+struct sr_bitslice {
+	size_t num_channels;
+	int *channel_index;
+	/* Sample layout the plane mapping was set up for. */
+	size_t unitsize;
+	/* Plane for each logic bit of a sample, NULL for unused bits. */
+	uint8_t **planes;
+	/* SR_BITSLICE_PLANE_BYTES for each channel. */
+	uint8_t *data;
+};
+
+/** Bit plane of the channel with index @a ch in the slicer's channel list. */
+#define sr_bitslice_plane(bs, ch) \
+	(&(bs)->data[(ch) * SR_BITSLICE_PLANE_BYTES])
+
+SR_PRIV struct sr_bitslice *sr_bitslice_new(const int *channel_index,
+	size_t num_channels);
+SR_PRIV void sr_bitslice_free(struct sr_bitslice *bs);
+SR_PRIV size_t sr_bitslice_load(struct sr_bitslice *bs,
+	const uint8_t *samples, size_t unitsize, size_t num_samples);
+
+/** Get the bit of sample @a pos from a bit plane. */
+static inline uint8_t sr_bitplane_bit(const uint8_t *plane, size_t pos)
+{
+	return (plane[pos / 8] >> (pos % 8)) & 1;
+}
+
+/**
+ * Get eight consecutive samples from a bit plane, starting at sample
+ * @a pos which need not be byte aligned. All eight must be in the plane.
+ */
+static inline uint8_t sr_bitplane_get8(const uint8_t *plane, size_t pos)
+{
+	size_t shift;
+
+	shift = pos % 8;
+	plane += pos / 8;
+	if (!shift)
+		return plane[0];
+
+	return (plane[0] >> shift) | (plane[1] << (8 - shift));
+}
+
 /*--- crc.c -----------------------------------------------------------------*/
 
 #define SR_CRC16_DEFAULT_INIT 0xffffU
@@ -2222,6 +3387,29 @@ SR_PRIV int bv_send_analog_channel(const struct sr_dev_inst *sdi,
  */
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len);
 
+/**
+ * Calculate a CRC16 checksum using the reflected 0x1021 polynomial.
+ *
+ * This CRC16 flavor is also known as CRC16-MCRF4XX (CRC16-CCITT, LSB
+ * first, no final XOR).
+ *
+ * @param crc Initial value (typically 0xffff)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint16_t sr_crc16_mcrf4xx(uint16_t crc, const uint8_t *buffer, size_t len);
+
+/**
+ * Calculate a CRC32 checksum (IEEE 802.3, as used by ZIP and zlib).
+ *
+ * @param crc Initial value (0 for a new checksum, or a previous result)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint32_t sr_crc32(uint32_t crc, const uint8_t *buffer, size_t len);
+
 /*--- modbus/modbus.c -------------------------------------------------------*/
 
 struct sr_modbus_dev_inst {
@@ -2275,6 +3463,20 @@ SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
 SR_PRIV int sr_modbus_close(struct sr_modbus_dev_inst *modbus);
 SR_PRIV void sr_modbus_free(struct sr_modbus_dev_inst *modbus);
 
+struct sr_modbus_regmap;
+
+SR_PRIV struct sr_modbus_regmap *sr_modbus_regmap_new(int address,
+		int nb_registers, int max_gap);
+SR_PRIV void sr_modbus_regmap_free(struct sr_modbus_regmap *map);
+SR_PRIV int sr_modbus_regmap_add(struct sr_modbus_regmap *map,
+		int address, int nb_registers, uint64_t max_age_us);
+SR_PRIV void sr_modbus_regmap_invalidate(struct sr_modbus_regmap *map,
+		int address, int nb_registers);
+SR_PRIV int sr_modbus_regmap_read(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_regmap *map);
+SR_PRIV const uint16_t *sr_modbus_regmap_get(const struct sr_modbus_regmap *map,
+		int address, int nb_registers);
+
 /*--- dmm/es519xx.c ---------------------------------------------------------*/
 
 /**
@@ -2299,6 +3501,7 @@ struct es519xx_info {
 	int digits;
 };
 
+extern SR_PRIV const struct sr_packet_sync es519xx_sync;
 SR_PRIV gboolean sr_es519xx_2400_11b_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_es519xx_2400_11b_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2334,6 +3537,7 @@ struct fs9922_info {
 	int bargraph_sign, bargraph_value;
 };
 
+extern SR_PRIV const struct sr_packet_sync fs9922_sync;
 SR_PRIV gboolean sr_fs9922_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_fs9922_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -2350,6 +3554,7 @@ struct fs9721_info {
 	gboolean is_c2c1_11, is_c2c1_10, is_c2c1_01, is_c2c1_00, is_sign;
 };
 
+extern SR_PRIV const struct sr_packet_sync fs9721_sync;
 SR_PRIV gboolean sr_fs9721_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_fs9721_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -2365,6 +3570,7 @@ SR_PRIV void sr_fs9721_max_c_min(struct sr_datafeed_analog *analog, void *info);
 
 struct meterman_38xr_info { int dummy; };
 
+extern SR_PRIV const struct sr_packet_sync meterman_38xr_sync;
 SR_PRIV gboolean meterman_38xr_packet_valid(const uint8_t *buf);
 SR_PRIV int meterman_38xr_parse(const uint8_t *buf, float *floatval,
 	struct sr_datafeed_analog *analog, void *info);
@@ -2389,6 +3595,7 @@ struct ms2115b_info {
 };
 
 extern SR_PRIV const char *ms2115b_channel_formats[];
+extern SR_PRIV const struct sr_packet_sync ms2115b_sync;
 SR_PRIV gboolean sr_ms2115b_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_ms2115b_parse(const uint8_t *buf, float *floatval,
 	struct sr_datafeed_analog *analog, void *info);
@@ -2404,6 +3611,7 @@ struct ms8250d_info {
 	gboolean is_ncv, is_min, is_max, is_sign, is_autotimer;
 };
 
+extern SR_PRIV const struct sr_packet_sync ms8250d_sync;
 SR_PRIV gboolean sr_ms8250d_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_ms8250d_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -2420,6 +3628,7 @@ struct dtm0660_info {
 	gboolean is_minmax, is_max, is_sign;
 };
 
+extern SR_PRIV const struct sr_packet_sync dtm0660_sync;
 SR_PRIV gboolean sr_dtm0660_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_dtm0660_parse(const uint8_t *buf, float *floatval,
 			struct sr_datafeed_analog *analog, void *info);
@@ -2431,6 +3640,7 @@ SR_PRIV int sr_dtm0660_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct m2110_info { int dummy; };
 
+extern SR_PRIV const struct sr_packet_sync m2110_sync;
 SR_PRIV gboolean sr_m2110_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_m2110_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -2452,6 +3662,7 @@ struct metex14_info {
 #ifdef HAVE_SERIAL_COMM
 SR_PRIV int sr_metex14_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+extern SR_PRIV const struct sr_packet_sync metex14_sync;
 SR_PRIV gboolean sr_metex14_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_metex14_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -2466,6 +3677,7 @@ SR_PRIV int sr_metex14_4packets_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct rs9lcd_info { int dummy; };
 
+extern SR_PRIV const struct sr_packet_sync rs9lcd_sync;
 SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_rs9lcd_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -2477,6 +3689,7 @@ SR_PRIV int sr_rs9lcd_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct bm25x_info { int dummy; };
 
+extern SR_PRIV const struct sr_packet_sync bm25x_sync;
 SR_PRIV gboolean sr_brymen_bm25x_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_brymen_bm25x_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -2492,6 +3705,7 @@ struct brymen_bm52x_info { size_t ch_idx; };
 SR_PRIV int sr_brymen_bm52x_packet_request(struct sr_serial_dev_inst *serial);
 SR_PRIV int sr_brymen_bm82x_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+extern SR_PRIV const struct sr_packet_sync brymen_bm52x_sync;
 SR_PRIV gboolean sr_brymen_bm52x_packet_valid(const uint8_t *buf);
 SR_PRIV gboolean sr_brymen_bm82x_packet_valid(const uint8_t *buf);
 /* BM520s and BM820s protocols are similar, the parse routine is shared. */
@@ -2522,6 +3736,7 @@ struct brymen_bm85x_info { int dummy; };
 SR_PRIV int brymen_bm85x_after_open(struct sr_serial_dev_inst *serial);
 SR_PRIV int brymen_bm85x_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+extern SR_PRIV const struct sr_packet_sync brymen_bm85x_sync;
 SR_PRIV gboolean brymen_bm85x_packet_valid(void *state,
 	const uint8_t *buf, size_t len, size_t *pkt_len);
 SR_PRIV int brymen_bm85x_parse(void *state, const uint8_t *buf, size_t len,
@@ -2537,6 +3752,7 @@ struct brymen_bm86x_info { size_t ch_idx; };
 #ifdef HAVE_SERIAL_COMM
 SR_PRIV int sr_brymen_bm86x_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+extern SR_PRIV const struct sr_packet_sync brymen_bm86x_sync;
 SR_PRIV gboolean sr_brymen_bm86x_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_brymen_bm86x_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2552,6 +3768,7 @@ struct ut71x_info {
 	gboolean is_auto, is_manual, is_sign, is_power, is_loop_current;
 };
 
+extern SR_PRIV const struct sr_packet_sync ut71x_sync;
 SR_PRIV gboolean sr_ut71x_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_ut71x_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2573,6 +3790,7 @@ struct vc870_info {
 	gboolean is_frequency, is_dual_display, is_auto;
 };
 
+extern SR_PRIV const struct sr_packet_sync vc870_sync;
 SR_PRIV gboolean sr_vc870_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_vc870_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2588,6 +3806,7 @@ struct vc96_info {
 	gboolean is_unitless;
 };
 
+extern SR_PRIV const struct sr_packet_sync vc96_sync;
 SR_PRIV gboolean sr_vc96_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_vc96_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2675,6 +3894,7 @@ struct asycii_info {
 #ifdef HAVE_SERIAL_COMM
 SR_PRIV int sr_asycii_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+extern SR_PRIV const struct sr_packet_sync asycii_sync;
 SR_PRIV gboolean sr_asycii_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_asycii_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -2716,6 +3936,7 @@ struct eev121gw_info {
 };
 
 extern SR_PRIV const char *eev121gw_channel_formats[];
+extern SR_PRIV const struct sr_packet_sync eev121gw_sync;
 SR_PRIV gboolean sr_eev121gw_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_eev121gw_3displays_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -2759,18 +3980,70 @@ SR_PRIV void sr_sw_limits_update_frames_read(struct sr_sw_limits *limits,
 	uint64_t frames_read);
 SR_PRIV void sr_sw_limits_init(struct sr_sw_limits *limits);
 
+/*--- datalog.c -------------------------------------------------------------*/
+
+#define SR_DATALOG_TIMEOUT_US	(500 * 1000)
+#define SR_DATALOG_RETRIES	3
+
+/** Download state of a logging instrument's memory. */
+struct sr_datalog {
+	/** Records in the device's log. */
+	uint64_t total;
+	/** Records which were received, where downloads resume. */
+	uint64_t received;
+	/** Records which were requested so far. */
+	uint64_t requested;
+	/** Maximum records per request, 0 when the device decides. */
+	size_t block_size;
+	/** Maximum number of requests in flight. */
+	size_t depth;
+	size_t in_flight;
+	/** Time without responses after which requests are lost. */
+	int64_t timeout_us;
+	int64_t last_activity;
+	size_t retries;
+	size_t max_retries;
+};
+
+SR_PRIV void sr_datalog_init(struct sr_datalog *log, uint64_t total,
+	size_t block_size, size_t depth);
+SR_PRIV gboolean sr_datalog_next_request(struct sr_datalog *log,
+	uint64_t *offset, size_t *count);
+SR_PRIV void sr_datalog_block_done(struct sr_datalog *log, size_t count);
+SR_PRIV int sr_datalog_resume(struct sr_datalog *log);
+SR_PRIV gboolean sr_datalog_timed_out(const struct sr_datalog *log);
+SR_PRIV gboolean sr_datalog_done(const struct sr_datalog *log);
+
 /*--- feed_queue.h ----------------------------------------------------------*/
 
 struct feed_queue_logic;
 struct feed_queue_analog;
 
+SR_API size_t feed_queue_auto_count(uint64_t samplerate,
+	unsigned int latency_ms, size_t unit_size);
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size);
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count);
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *values, const size_t *counts, size_t num_runs);
+SR_API int feed_queue_logic_set_rle(struct feed_queue_logic *q,
+	gboolean enable);
+SR_API int feed_queue_logic_set_buffers(struct feed_queue_logic *q,
+	size_t num_buffers);
+SR_API uint8_t *feed_queue_logic_reserve(struct feed_queue_logic *q,
+	size_t count);
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q,
+	size_t count);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
+SR_API int feed_queue_logic_set_time(struct feed_queue_logic *q,
+	int64_t host_time_us);
+SR_API int feed_queue_logic_drop(struct feed_queue_logic *q,
+	uint64_t count);
 SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q);
+SR_API int feed_queue_logic_set_latency(struct feed_queue_logic *q,
+	unsigned int latency_ms);
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
 
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
@@ -2781,7 +4054,19 @@ SR_API int feed_queue_analog_params(struct feed_queue_analog *q,
 	enum sr_mq mq, enum sr_mqflag mq_flag, enum sr_unit unit);
 SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 	float data, size_t count);
+SR_API int feed_queue_analog_set_buffers(struct feed_queue_analog *q,
+	size_t num_buffers);
+SR_API float *feed_queue_analog_reserve(struct feed_queue_analog *q,
+	size_t count);
+SR_API int feed_queue_analog_commit(struct feed_queue_analog *q,
+	size_t count);
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q);
+SR_API int feed_queue_analog_set_time(struct feed_queue_analog *q,
+	int64_t host_time_us);
+SR_API int feed_queue_analog_drop(struct feed_queue_analog *q,
+	uint64_t count);
+SR_API int feed_queue_analog_set_latency(struct feed_queue_analog *q,
+	unsigned int latency_ms);
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q);
 
 #endif
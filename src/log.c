@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -42,8 +43,11 @@
  * @{
  */
 
-/* Currently selected libsigrok loglevel. Default: SR_LOG_WARN. */
-static int cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
+/*
+ * Currently selected libsigrok loglevel. Default: SR_LOG_WARN.
+ * The sr_err() etc. macros check it before evaluating their arguments.
+ */
+SR_PRIV int sr_cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
 
 /* Function prototype. */
 static int sr_logv(void *cb_data, int loglevel, const char *format,
@@ -63,6 +67,35 @@ static void *sr_log_cb_data = NULL;
 /** @endcond */
 static int64_t sr_log_start_time = 0;
 
+/** @cond PRIVATE */
+/* Number of messages which the asynchronous log ring holds. */
+#define LOG_RING_SLOTS 512
+/* Longer messages get truncated in the ring. */
+#define LOG_RING_TEXT_SIZE 248
+/** @endcond */
+
+/*
+ * A bounded MPSC queue after Dmitry Vyukov. A slot is free for the writer
+ * at position n when its sequence is n, and ready for the reader when it
+ * is n + 1. The reader hands it back for position n + LOG_RING_SLOTS.
+ */
+struct log_slot {
+	guint seq;
+	int loglevel;
+	char text[LOG_RING_TEXT_SIZE];
+};
+
+static struct log_slot log_ring[LOG_RING_SLOTS];
+static guint log_ring_head;
+static guint log_ring_tail;
+static guint log_ring_dropped;
+static gint log_ring_active;
+static gint log_ring_stop;
+static gint log_ring_waiting;
+static GThread *log_ring_thread;
+static GMutex log_ring_mutex;
+static GCond log_ring_cond;
+
 /**
  * Set the libsigrok loglevel.
  *
@@ -90,7 +123,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
 	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
 		sr_log_start_time = g_get_monotonic_time();
 
-	cur_loglevel = loglevel;
+	sr_cur_loglevel = loglevel;
 
 	sr_dbg("libsigrok loglevel set to %d.", loglevel);
 
@@ -106,7 +139,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
  */
 SR_API int sr_log_loglevel_get(void)
 {
-	return cur_loglevel;
+	return sr_cur_loglevel;
 }
 
 /**
@@ -186,15 +219,16 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 {
 	uint64_t elapsed_us, minutes;
 	unsigned int rest_us, seconds, microseconds;
-	char *raw_output, *output;
-	int raw_len, raw_idx, idx, ret;
+	char prefix[32], buf[256], *output, *p, *q;
+	va_list args_copy;
+	int len, ret;
 
 	/* This specific log callback doesn't need the void pointer data. */
 	(void)cb_data;
 
 	(void)loglevel;
 
-	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
+	if (sr_cur_loglevel >= LOGLEVEL_TIMESTAMP) {
 		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
@@ -202,31 +236,192 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 		seconds = rest_us / G_TIME_SPAN_SECOND;
 		microseconds = rest_us % G_TIME_SPAN_SECOND;
 
-		ret = g_fprintf(stderr, "sr: [%.2" PRIu64 ":%.2u.%.6u] ",
+		g_snprintf(prefix, sizeof(prefix), "sr: [%.2" PRIu64 ":%.2u.%.6u] ",
 				minutes, seconds, microseconds);
 	} else {
-		ret = fputs("sr: ", stderr);
+		g_strlcpy(prefix, "sr: ", sizeof(prefix));
 	}
 
-	if (ret < 0 || (raw_len = g_vasprintf(&raw_output, format, args)) < 0)
+	/* Most messages fit the stack buffer. */
+	va_copy(args_copy, args);
+	len = g_vsnprintf(buf, sizeof(buf), format, args_copy);
+	va_end(args_copy);
+	if (len < 0)
 		return SR_ERR;
+	output = buf;
+	if ((size_t)len >= sizeof(buf) &&
+			g_vasprintf(&output, format, args) < 0)
+		return SR_ERR;
+
+	/* Drop any unwanted newlines. */
+	for (p = q = output; *p; p++) {
+		if (*p != '\n')
+			*q++ = *p;
+	}
+	*q = '\0';
+
+	ret = g_fprintf(stderr, "%s%s\n", prefix, output);
+	fflush(stderr);
+	if (output != buf)
+		g_free(output);
+
+	return ret < 0 ? SR_ERR : SR_OK;
+}
+
+static int log_emit(int loglevel, const char *format, ...)
+{
+	int ret;
+	va_list args;
+
+	va_start(args, format);
+	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	va_end(args);
 
-	output = g_malloc0(raw_len + 1);
+	return ret;
+}
 
-	/* Copy the string without any unwanted newlines. */
-	raw_idx = idx = 0;
-	while (raw_idx < raw_len) {
-		if (raw_output[raw_idx] != '\n') {
-			output[idx] = raw_output[raw_idx];
-			idx++;
+static int log_ring_put(int loglevel, const char *format, va_list args)
+{
+	struct log_slot *slot;
+	guint pos, seq;
+	gint diff;
+
+	pos = (guint)g_atomic_int_get(&log_ring_head);
+	while (1) {
+		slot = &log_ring[pos % LOG_RING_SLOTS];
+		seq = (guint)g_atomic_int_get(&slot->seq);
+		diff = (gint)(seq - pos);
+		if (diff == 0) {
+			if (g_atomic_int_compare_and_exchange(
+					(gint *)&log_ring_head, pos, pos + 1))
+				break;
+			pos = (guint)g_atomic_int_get(&log_ring_head);
+		} else if (diff < 0) {
+			/* The ring is full, don't block the caller. */
+			g_atomic_int_inc(&log_ring_dropped);
+			return SR_OK;
+		} else {
+			pos = (guint)g_atomic_int_get(&log_ring_head);
 		}
-		raw_idx++;
 	}
 
-	g_fprintf(stderr, "%s\n", output);
-	fflush(stderr);
-	g_free(raw_output);
-	g_free(output);
+	slot->loglevel = loglevel;
+	g_vsnprintf(slot->text, sizeof(slot->text), format, args);
+	g_atomic_int_set(&slot->seq, pos + 1);
+
+	if (g_atomic_int_get(&log_ring_waiting)) {
+		g_mutex_lock(&log_ring_mutex);
+		g_cond_signal(&log_ring_cond);
+		g_mutex_unlock(&log_ring_mutex);
+	}
+
+	return SR_OK;
+}
+
+/* Hand all ready messages to the log callback, in order. */
+static gboolean log_ring_drain(void)
+{
+	struct log_slot *slot;
+	guint dropped;
+	gboolean drained;
+
+	drained = FALSE;
+	while (1) {
+		slot = &log_ring[log_ring_tail % LOG_RING_SLOTS];
+		if ((guint)g_atomic_int_get(&slot->seq) != log_ring_tail + 1)
+			break;
+		log_emit(slot->loglevel, "%s", slot->text);
+		g_atomic_int_set(&slot->seq, log_ring_tail + LOG_RING_SLOTS);
+		log_ring_tail++;
+		drained = TRUE;
+	}
+
+	dropped = (guint)g_atomic_int_and(&log_ring_dropped, 0);
+	if (dropped)
+		log_emit(SR_LOG_WARN, "log: %u messages dropped, log ring was full.",
+			dropped);
+
+	return drained;
+}
+
+static gpointer log_ring_run(gpointer data)
+{
+	gint64 end_time;
+
+	(void)data;
+
+	while (!g_atomic_int_get(&log_ring_stop)) {
+		if (log_ring_drain())
+			continue;
+		/* Re-check after announcing the wait, then sleep. */
+		g_mutex_lock(&log_ring_mutex);
+		g_atomic_int_set(&log_ring_waiting, 1);
+		end_time = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+		if (!g_atomic_int_get(&log_ring_stop))
+			g_cond_wait_until(&log_ring_cond, &log_ring_mutex, end_time);
+		g_atomic_int_set(&log_ring_waiting, 0);
+		g_mutex_unlock(&log_ring_mutex);
+	}
+	log_ring_drain();
+
+	return NULL;
+}
+
+/**
+ * Have messages logged asynchronously.
+ *
+ * When enabled, messages get formatted by the thread which logs them,
+ * and get queued in a fixed size ring without taking locks. A background
+ * thread passes them on to the log callback (see sr_log_callback_set()).
+ * Logging then costs no I/O in time critical code, like the acquisition
+ * of high rate data with SR_LOG_DBG enabled.
+ *
+ * Messages get truncated to 247 characters. When the ring is full, new
+ * messages get dropped, and the number of dropped messages gets logged.
+ * Time stamps of the default log callback are from the time of output.
+ *
+ * Disabling waits for the queued messages to be passed on.
+ *
+ * @param async TRUE to log asynchronously, FALSE to log synchronously.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Cannot start the background thread.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_async_set(gboolean async)
+{
+	GError *error;
+	guint i;
+
+	if (!!async == !!g_atomic_int_get(&log_ring_active))
+		return SR_OK;
+
+	if (!async) {
+		g_atomic_int_set(&log_ring_active, 0);
+		g_mutex_lock(&log_ring_mutex);
+		g_atomic_int_set(&log_ring_stop, 1);
+		g_cond_signal(&log_ring_cond);
+		g_mutex_unlock(&log_ring_mutex);
+		g_thread_join(log_ring_thread);
+		log_ring_thread = NULL;
+		return SR_OK;
+	}
+
+	/* The ring is empty whenever the background thread isn't running. */
+	for (i = 0; i < LOG_RING_SLOTS; i++)
+		log_ring[i].seq = log_ring_tail + i;
+	g_atomic_int_set(&log_ring_head, log_ring_tail);
+	g_atomic_int_set(&log_ring_stop, 0);
+
+	error = NULL;
+	log_ring_thread = g_thread_try_new("sr-log", log_ring_run, NULL, &error);
+	if (!log_ring_thread) {
+		sr_err("Cannot start log thread: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+	g_atomic_int_set(&log_ring_active, 1);
 
 	return SR_OK;
 }
@@ -238,11 +433,14 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 	va_list args;
 
 	/* Only output messages of at least the selected loglevel(s). */
-	if (loglevel > cur_loglevel)
+	if (loglevel > sr_cur_loglevel)
 		return SR_OK;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	if (g_atomic_int_get(&log_ring_active))
+		ret = log_ring_put(loglevel, format, args);
+	else
+		ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
 	va_end(args);
 
 	return ret;
@@ -0,0 +1,211 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-planar"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Handling of planar (channel major) logic data.
+ */
+
+/**
+ * @defgroup grp_logic_planar Planar logic data
+ *
+ * Handling of planar (channel major) logic data.
+ *
+ * Devices which transfer their samples one channel at a time can forward
+ * them as SR_DF_LOGIC_PLANAR packets, with one bit plane per channel.
+ * Consumers which look at one channel at a time then need not transpose
+ * the samples back. Consumers which don't understand these packets get
+ * a sequence of SR_DF_LOGIC packets of bounded size instead.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Maximum size of the sample data of an expanded SR_DF_LOGIC packet. */
+#define EXPAND_CHUNK_SIZE (4 * 1024 * 1024)
+/** @endcond */
+
+/* Assemble samples one bit at a time, for unaligned positions. */
+static void expand_bits(const struct sr_datafeed_logic_planar *planar,
+		uint64_t offset, uint8_t *buf, uint64_t count)
+{
+	size_t bit, num_bits;
+	uint64_t idx;
+
+	num_bits = planar->unitsize * 8;
+	memset(buf, 0, count * planar->unitsize);
+	for (bit = 0; bit < num_bits; bit++) {
+		if (!planar->planes[bit])
+			continue;
+		for (idx = 0; idx < count; idx++) {
+			if (sr_bitplane_bit(planar->planes[bit], offset + idx))
+				buf[idx * planar->unitsize + bit / 8] |=
+					1 << (bit % 8);
+		}
+	}
+}
+
+/*
+ * Byte aligned runs of eight samples get transposed in 8x8 bit tiles,
+ * see sr_bitplanes_to_samples(). The caller provides space for the
+ * unitsize * 8 plane pointers.
+ */
+static void expand_samples(const struct sr_datafeed_logic_planar *planar,
+		uint64_t offset, uint8_t *buf, uint64_t count,
+		const uint8_t **planes)
+{
+	size_t bit, num_bits;
+	uint64_t aligned;
+
+	aligned = 0;
+	if (offset % 8 == 0 && count >= 8) {
+		num_bits = planar->unitsize * 8;
+		for (bit = 0; bit < num_bits; bit++) {
+			planes[bit] = planar->planes[bit] ?
+				planar->planes[bit] + offset / 8 : NULL;
+		}
+		aligned = count - count % 8;
+		sr_bitplanes_to_samples(buf, planar->unitsize, planes,
+			aligned / 8);
+	}
+	if (aligned < count)
+		expand_bits(planar, offset + aligned,
+			buf + aligned * planar->unitsize, count - aligned);
+}
+
+/**
+ * Convert a range of samples of a planar logic payload to packed samples.
+ *
+ * The caller can convert the payload piece by piece, in a buffer which
+ * is much smaller than the complete sample data. Offsets which are a
+ * multiple of 8 take the fast path.
+ *
+ * @param planar The payload. Must not be NULL.
+ * @param offset Number of the first sample to convert.
+ * @param buf The buffer to convert to, with space for @a count samples
+ *            of the payload's unitsize.
+ * @param count On entry the maximum number of samples to convert, the
+ *              number of samples that were converted on return. That is
+ *              less than on entry when the payload ends early.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_planar_expand(const struct sr_datafeed_logic_planar *planar,
+		uint64_t offset, void *buf, uint64_t *count)
+{
+	const uint8_t **planes;
+
+	if (!planar || !buf || !count)
+		return SR_ERR_ARG;
+	if (!planar->unitsize || !planar->planes)
+		return SR_ERR_ARG;
+
+	if (offset >= planar->num_samples) {
+		*count = 0;
+		return SR_OK;
+	}
+	*count = MIN(*count, planar->num_samples - offset);
+
+	planes = g_malloc(planar->unitsize * 8 * sizeof(planes[0]));
+	expand_samples(planar, offset, buf, *count, planes);
+	g_free(planes);
+
+	return SR_OK;
+}
+
+/**
+ * Pass the content of an SR_DF_LOGIC_PLANAR packet on as SR_DF_LOGIC
+ * packets.
+ *
+ * The packets' sample data is of bounded size, independently of how many
+ * samples the planes hold.
+ *
+ * @param packet The SR_DF_LOGIC_PLANAR packet to convert.
+ * @param cb The function to call for each SR_DF_LOGIC packet.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Out of memory.
+ * @retval other The first error which @a cb returned.
+ *
+ * @private
+ */
+SR_PRIV int sr_logic_planar_foreach_chunk(const struct sr_datafeed_packet *packet,
+		sr_logic_rle_chunk_cb cb, void *cb_data)
+{
+	const struct sr_datafeed_logic_planar *planar;
+	struct sr_datafeed_packet chunk_packet;
+	struct sr_datafeed_logic logic;
+	const uint8_t **planes;
+	uint8_t *buf;
+	uint64_t offset, alloc, count;
+	int ret;
+
+	if (!packet || packet->type != SR_DF_LOGIC_PLANAR || !cb)
+		return SR_ERR_ARG;
+	planar = packet->payload;
+	if (!planar->unitsize || !planar->planes)
+		return SR_ERR_ARG;
+
+	/* Whole bytes of the planes per chunk, keeps the fast path. */
+	alloc = MIN(EXPAND_CHUNK_SIZE / planar->unitsize, planar->num_samples);
+	if (alloc < planar->num_samples)
+		alloc -= alloc % 8;
+	if (!alloc)
+		return SR_OK;
+	buf = g_try_malloc(alloc * planar->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+	planes = g_malloc(planar->unitsize * 8 * sizeof(planes[0]));
+
+	logic.unitsize = planar->unitsize;
+	logic.data = buf;
+	chunk_packet.type = SR_DF_LOGIC;
+	chunk_packet.payload = &logic;
+
+	ret = SR_OK;
+	for (offset = 0; offset < planar->num_samples; offset += count) {
+		count = MIN(alloc, planar->num_samples - offset);
+		expand_samples(planar, offset, buf, count, planes);
+		logic.length = count * planar->unitsize;
+		if ((ret = cb(&chunk_packet, cb_data)) != SR_OK)
+			break;
+	}
+	g_free(planes);
+	g_free(buf);
+
+	return ret;
+}
+
+/** @} */
@@ -0,0 +1,369 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-rle"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Handling of run length encoded logic data.
+ */
+
+/**
+ * @defgroup grp_logic_rle Run length encoded logic data
+ *
+ * Handling of run length encoded logic data.
+ *
+ * Devices which compress their sample data by themselves can forward
+ * it as SR_DF_LOGIC_RLE packets. Long runs of identical samples then
+ * need not get expanded in memory. Consumers which don't understand
+ * these packets get a sequence of SR_DF_LOGIC packets of bounded size
+ * instead.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Maximum size of the sample data of an expanded SR_DF_LOGIC packet. */
+#define EXPAND_CHUNK_SIZE (4 * 1024 * 1024)
+/** @endcond */
+
+/*
+ * For other unit sizes, the filled region keeps doubling in size, so
+ * long runs take a few large memcpy() calls instead of one per sample.
+ */
+static void fill_generic(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count)
+{
+	size_t done, size, copy;
+
+	if (!count)
+		return;
+
+	/* Keep doubling the already filled region. */
+	size = count * unitsize;
+	memcpy(dst, value, unitsize);
+	done = unitsize;
+	while (done < size) {
+		copy = MIN(done, size - done);
+		memcpy(dst + done, dst, copy);
+		done += copy;
+	}
+}
+
+static gboolean equal_generic(const uint8_t *a, const uint8_t *b,
+		size_t unitsize)
+{
+	return memcmp(a, b, unitsize) == 0;
+}
+
+static void copy_generic(uint8_t *dst, const uint8_t *src, size_t unitsize)
+{
+	memcpy(dst, src, unitsize);
+}
+
+static uint64_t find_change_generic(const uint8_t *data, const uint8_t *value,
+		size_t unitsize, uint64_t count)
+{
+	uint64_t i;
+
+	for (i = 0; i < count; i++, data += unitsize) {
+		if (memcmp(data, value, unitsize) != 0)
+			break;
+	}
+
+	return i;
+}
+
+/* Samples per block which find_change() tests at once. */
+#define FIND_CHANGE_BLOCK 16
+
+/* Integer types which hold a sample of the specialized unit sizes. */
+#define LOGIC_WORD_1 uint8_t
+#define LOGIC_WORD_2 uint16_t
+#define LOGIC_WORD_4 uint32_t
+#define LOGIC_WORD_8 uint64_t
+
+/*
+ * The fixed size memcpy() and memcmp() calls compile to plain loads
+ * and stores, and the fill loops get vectorized. The search for changes
+ * ORs the XOR differences of a whole block, and only looks at the
+ * individual samples of the block which contains a change.
+ */
+#define LOGIC_OPS_FUNCS(n) \
+static void fill_##n(uint8_t *dst, const uint8_t *value, \
+		size_t unitsize, uint64_t count) \
+{ \
+	uint8_t v[n]; \
+	(void)unitsize; \
+	memcpy(v, value, n); \
+	while (count--) { \
+		memcpy(dst, v, n); \
+		dst += n; \
+	} \
+} \
+static gboolean equal_##n(const uint8_t *a, const uint8_t *b, \
+		size_t unitsize) \
+{ \
+	(void)unitsize; \
+	return memcmp(a, b, n) == 0; \
+} \
+static void copy_##n(uint8_t *dst, const uint8_t *src, size_t unitsize) \
+{ \
+	(void)unitsize; \
+	memcpy(dst, src, n); \
+} \
+static uint64_t find_change_##n(const uint8_t *data, const uint8_t *value, \
+		size_t unitsize, uint64_t count) \
+{ \
+	LOGIC_WORD_##n ref, diff, v[FIND_CHANGE_BLOCK]; \
+	uint64_t i; \
+	size_t k; \
+	(void)unitsize; \
+	memcpy(&ref, value, n); \
+	for (i = 0; i + FIND_CHANGE_BLOCK <= count; i += FIND_CHANGE_BLOCK) { \
+		memcpy(v, &data[i * n], sizeof(v)); \
+		diff = 0; \
+		for (k = 0; k < FIND_CHANGE_BLOCK; k++) \
+			diff |= v[k] ^ ref; \
+		if (diff) \
+			break; \
+	} \
+	for (; i < count; i++) { \
+		memcpy(&v[0], &data[i * n], n); \
+		if (v[0] != ref) \
+			break; \
+	} \
+	return i; \
+}
+SR_LOGIC_UNITSIZES(LOGIC_OPS_FUNCS)
+
+#define LOGIC_OPS_ENTRY(n) { n, fill_##n, equal_##n, copy_##n, find_change_##n },
+static const struct sr_logic_ops logic_ops[] = {
+	SR_LOGIC_UNITSIZES(LOGIC_OPS_ENTRY)
+};
+
+static const struct sr_logic_ops logic_ops_generic = {
+	0, fill_generic, equal_generic, copy_generic, find_change_generic,
+};
+
+/**
+ * Get the helpers for logic samples of a unit size.
+ *
+ * @param unitsize The size of a sample in bytes.
+ *
+ * @return The helpers, specialized ones for common unit sizes.
+ *
+ * @private
+ */
+SR_PRIV const struct sr_logic_ops *sr_logic_ops_get(size_t unitsize)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(logic_ops); i++) {
+		if (logic_ops[i].unitsize == unitsize)
+			return &logic_ops[i];
+	}
+
+	return &logic_ops_generic;
+}
+
+/**
+ * Fill a buffer with repetitions of one sample.
+ *
+ * Code which fills many runs should get the helper for its unit size
+ * once with sr_logic_ops_get() instead.
+ *
+ * @param dst The buffer, with space for @a count samples.
+ * @param value The sample value, must not be within @a dst.
+ * @param unitsize The size of a sample in bytes.
+ * @param count The number of samples to fill in.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_fill_samples(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count)
+{
+	sr_logic_ops_get(unitsize)->fill(dst, value, unitsize, count);
+}
+
+/**
+ * Get the number of samples in a run length encoded logic payload.
+ *
+ * @param rle The payload. Must not be NULL.
+ *
+ * @return The sum of all the payload's run lengths.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_sample_count(
+		const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t idx, count;
+
+	if (!rle)
+		return 0;
+
+	count = 0;
+	for (idx = 0; idx < rle->num_runs; idx++)
+		count += rle->run_lengths[idx];
+
+	return count;
+}
+
+/**
+ * Expand a range of samples of a run length encoded logic payload.
+ *
+ * The caller can expand the payload piece by piece, in a buffer which
+ * is much smaller than the complete sample data.
+ *
+ * @param rle The payload. Must not be NULL.
+ * @param offset Number of the first sample to expand.
+ * @param buf The buffer to expand to, with space for @a count samples
+ *            of the payload's unitsize.
+ * @param count On entry the maximum number of samples to expand, the
+ *              number of samples that were expanded on return. That is
+ *              less than on entry when the payload ends early.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint64_t offset, void *buf, uint64_t *count)
+{
+	const struct sr_logic_ops *ops;
+	const uint8_t *value;
+	uint8_t *wrptr;
+	uint64_t idx, run, remain;
+
+	if (!rle || !buf || !count)
+		return SR_ERR_ARG;
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+
+	ops = sr_logic_ops_get(rle->unitsize);
+	wrptr = buf;
+	remain = *count;
+	for (idx = 0; idx < rle->num_runs && remain; idx++) {
+		run = rle->run_lengths[idx];
+		if (offset >= run) {
+			offset -= run;
+			continue;
+		}
+		run = MIN(run - offset, remain);
+		offset = 0;
+		value = (const uint8_t *)rle->values + idx * rle->unitsize;
+		ops->fill(wrptr, value, rle->unitsize, run);
+		wrptr += run * rle->unitsize;
+		remain -= run;
+	}
+	*count -= remain;
+
+	return SR_OK;
+}
+
+/**
+ * Pass the content of an SR_DF_LOGIC_RLE packet on as SR_DF_LOGIC packets.
+ *
+ * The packets' sample data is of bounded size, independently of how many
+ * samples the runs amount to.
+ *
+ * @param packet The SR_DF_LOGIC_RLE packet to expand.
+ * @param cb The function to call for each SR_DF_LOGIC packet.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Out of memory.
+ * @retval other The first error which @a cb returned.
+ *
+ * @private
+ */
+SR_PRIV int sr_logic_rle_foreach_chunk(const struct sr_datafeed_packet *packet,
+		sr_logic_rle_chunk_cb cb, void *cb_data)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_logic_ops *ops;
+	struct sr_datafeed_packet chunk_packet;
+	struct sr_datafeed_logic logic;
+	const uint8_t *value;
+	uint8_t *buf;
+	uint64_t idx, run, copy, alloc, fill;
+	int ret;
+
+	if (!packet || packet->type != SR_DF_LOGIC_RLE || !cb)
+		return SR_ERR_ARG;
+	rle = packet->payload;
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+	ops = sr_logic_ops_get(rle->unitsize);
+
+	alloc = MIN(EXPAND_CHUNK_SIZE / rle->unitsize,
+		sr_logic_rle_sample_count(rle));
+	if (!alloc)
+		return SR_OK;
+	buf = g_try_malloc(alloc * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+	chunk_packet.type = SR_DF_LOGIC;
+	chunk_packet.payload = &logic;
+
+	ret = SR_OK;
+	fill = 0;
+	for (idx = 0; idx < rle->num_runs && ret == SR_OK; idx++) {
+		value = (const uint8_t *)rle->values + idx * rle->unitsize;
+		run = rle->run_lengths[idx];
+		while (run) {
+			copy = MIN(run, alloc - fill);
+			ops->fill(&buf[fill * rle->unitsize], value,
+				rle->unitsize, copy);
+			fill += copy;
+			run -= copy;
+			if (fill < alloc)
+				continue;
+			logic.length = fill * rle->unitsize;
+			ret = cb(&chunk_packet, cb_data);
+			fill = 0;
+			if (ret != SR_OK)
+				break;
+		}
+	}
+	if (ret == SR_OK && fill) {
+		logic.length = fill * rle->unitsize;
+		ret = cb(&chunk_packet, cb_data);
+	}
+	g_free(buf);
+
+	return ret;
+}
+
+/** @} */
@@ -552,6 +552,246 @@ SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
 	return SR_OK;
 }
 
+/** A register's planning details within a register map. */
+struct modbus_regmap_reg {
+	gboolean used;
+	uint64_t max_age_us;
+	int64_t read_at;
+};
+
+/**
+ * Register map of a device, used to plan read requests. Tracks which
+ * registers a caller is interested in, how long their values remain
+ * valid, and keeps a copy of their most recently read content.
+ */
+struct sr_modbus_regmap {
+	int address;
+	int nb_registers;
+	int max_gap;
+	uint16_t *values;
+	struct modbus_regmap_reg *regs;
+};
+
+/** Maximum number of registers in a read holding registers command. */
+#define MODBUS_READ_REGS_MAX 125
+
+/**
+ * Create a register map to plan read holding registers requests.
+ *
+ * @param address The Modbus address of the map's first register.
+ * @param nb_registers The number of registers which the map covers.
+ * @param max_gap The number of consecutive registers which need not be
+ *                read, but may get included to merge requests. Zero
+ *                merges adjacent ranges only. Larger values are only
+ *                acceptable when gap registers can be read.
+ *
+ * @return The new register map, or NULL upon invalid arguments.
+ */
+SR_PRIV struct sr_modbus_regmap *sr_modbus_regmap_new(int address,
+		int nb_registers, int max_gap)
+{
+	struct sr_modbus_regmap *map;
+
+	if (address < 0 || nb_registers < 1 || address + nb_registers > 0x10000)
+		return NULL;
+	if (max_gap < 0)
+		return NULL;
+
+	map = g_malloc0(sizeof(*map));
+	map->address = address;
+	map->nb_registers = nb_registers;
+	map->max_gap = max_gap;
+	map->values = g_malloc0_n(nb_registers, sizeof(map->values[0]));
+	map->regs = g_malloc0_n(nb_registers, sizeof(map->regs[0]));
+
+	return map;
+}
+
+/**
+ * Free a register map.
+ *
+ * @param map The register map, or NULL.
+ */
+SR_PRIV void sr_modbus_regmap_free(struct sr_modbus_regmap *map)
+{
+	if (!map)
+		return;
+
+	g_free(map->values);
+	g_free(map->regs);
+	g_free(map);
+}
+
+static gboolean modbus_regmap_range_ok(const struct sr_modbus_regmap *map,
+		int address, int nb_registers)
+{
+	if (!map || nb_registers < 1)
+		return FALSE;
+	if (address < map->address)
+		return FALSE;
+	if (address + nb_registers > map->address + map->nb_registers)
+		return FALSE;
+
+	return TRUE;
+}
+
+/**
+ * Register a range of registers which subsequent reads should get.
+ *
+ * @param map The register map.
+ * @param address The Modbus address of the range's first register.
+ * @param nb_registers The number of registers in the range.
+ * @param max_age_us The period in microseconds during which a previously
+ *                   read value is considered valid. Zero reads the
+ *                   registers in every call to sr_modbus_regmap_read().
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments.
+ */
+SR_PRIV int sr_modbus_regmap_add(struct sr_modbus_regmap *map,
+		int address, int nb_registers, uint64_t max_age_us)
+{
+	struct modbus_regmap_reg *reg;
+	int idx;
+
+	if (!modbus_regmap_range_ok(map, address, nb_registers))
+		return SR_ERR_ARG;
+
+	reg = &map->regs[address - map->address];
+	for (idx = 0; idx < nb_registers; idx++, reg++) {
+		reg->used = TRUE;
+		reg->max_age_us = max_age_us;
+		reg->read_at = 0;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Discard cached values of a range of registers, for example after
+ * the registers were written to. The next read gets them again.
+ *
+ * @param map The register map.
+ * @param address The Modbus address of the range's first register.
+ * @param nb_registers The number of registers in the range.
+ */
+SR_PRIV void sr_modbus_regmap_invalidate(struct sr_modbus_regmap *map,
+		int address, int nb_registers)
+{
+	int idx;
+
+	if (!modbus_regmap_range_ok(map, address, nb_registers))
+		return;
+
+	address -= map->address;
+	for (idx = 0; idx < nb_registers; idx++)
+		map->regs[address + idx].read_at = 0;
+}
+
+static gboolean modbus_regmap_need_read(const struct modbus_regmap_reg *reg,
+		int64_t now)
+{
+	if (!reg->used)
+		return FALSE;
+	if (!reg->read_at)
+		return TRUE;
+
+	return (uint64_t)(now - reg->read_at) >= reg->max_age_us;
+}
+
+/**
+ * Read those registers of a map whose values are missing or outdated.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param map The register map.
+ *
+ * Registers which need to be read get coalesced into as few read
+ * holding registers commands as possible. Registers whose cached value
+ * is still valid are not read unless they are in the middle of a
+ * request anyway. When a request fails, the requests which succeeded
+ * before remain valid, and calling this routine again only reads the
+ * remaining registers.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_regmap_read(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_regmap *map)
+{
+	struct modbus_regmap_reg *regs;
+	int64_t now;
+	int first, last, idx, count;
+	int ret;
+
+	if (!modbus || !map)
+		return SR_ERR_ARG;
+
+	regs = map->regs;
+	now = g_get_monotonic_time();
+	first = 0;
+	while (first < map->nb_registers) {
+		if (!modbus_regmap_need_read(&regs[first], now)) {
+			first++;
+			continue;
+		}
+
+		/* Extend the request for as long as merging pays off. */
+		last = first;
+		for (idx = first + 1; idx < map->nb_registers; idx++) {
+			if (idx - first >= MODBUS_READ_REGS_MAX)
+				break;
+			if (idx - last - 1 >= map->max_gap &&
+			    !modbus_regmap_need_read(&regs[idx], now))
+				break;
+			if (modbus_regmap_need_read(&regs[idx], now))
+				last = idx;
+		}
+		count = last - first + 1;
+
+		sr_spew("Reading %d registers at address %d.",
+			count, map->address + first);
+		ret = sr_modbus_read_holding_registers(modbus,
+			map->address + first, count, &map->values[first]);
+		if (ret != SR_OK)
+			return ret;
+		for (idx = first; idx <= last; idx++) {
+			if (regs[idx].used)
+				regs[idx].read_at = now;
+		}
+
+		first = last + 1;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the most recently read content of a range of registers.
+ *
+ * @param map The register map.
+ * @param address The Modbus address of the range's first register.
+ * @param nb_registers The number of registers in the range.
+ *
+ * @return The registers' values in the device's wire format, or NULL
+ *         when the range is not part of the map or was never read.
+ */
+SR_PRIV const uint16_t *sr_modbus_regmap_get(const struct sr_modbus_regmap *map,
+		int address, int nb_registers)
+{
+	const struct modbus_regmap_reg *reg;
+	int idx;
+
+	if (!modbus_regmap_range_ok(map, address, nb_registers))
+		return NULL;
+
+	reg = &map->regs[address - map->address];
+	for (idx = 0; idx < nb_registers; idx++, reg++) {
+		if (!reg->used || !reg->read_at)
+			return NULL;
+	}
+
+	return &map->values[address - map->address];
+}
+
 /**
  * Close Modbus device.
  *
@@ -0,0 +1,193 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Framing of the datafeed for network streams, shared by the "net"
+ * output module and the net-remote driver.
+ *
+ * A stream is a sequence of frames. Each frame starts with its type and
+ * payload length, both as little endian 32 bit numbers. The first frame
+ * is SR_NET_HELLO. Consecutive frames may be packed into an optionally
+ * compressed SR_NET_BATCH frame, which holds the uncompressed length of
+ * its content followed by the content.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "net-stream"
+
+/**
+ * Append a frame header to a buffer.
+ *
+ * The caller appends @a length bytes of payload next.
+ *
+ * @private
+ */
+SR_PRIV void sr_net_frame_header(GString *buf, uint32_t type, uint32_t length)
+{
+	uint8_t hdr[SR_NET_FRAME_HEADER];
+
+	WL32(&hdr[0], type);
+	WL32(&hdr[4], length);
+	g_string_append_len(buf, (const gchar *)hdr, sizeof(hdr));
+}
+
+/**
+ * Check for a complete frame at the start of a buffer.
+ *
+ * @param buf The received data.
+ * @param len The length of the received data.
+ * @param type Where to store the frame type.
+ * @param length Where to store the payload length.
+ *
+ * @retval SR_OK A frame of SR_NET_FRAME_HEADER + @a length bytes is complete.
+ * @retval SR_ERR_NA More data is needed.
+ * @retval SR_ERR_DATA The frame exceeds SR_NET_MAX_FRAME.
+ *
+ * @private
+ */
+SR_PRIV int sr_net_frame_parse(const uint8_t *buf, size_t len,
+		uint32_t *type, uint32_t *length)
+{
+	if (len < SR_NET_FRAME_HEADER)
+		return SR_ERR_NA;
+
+	*type = RL32(&buf[0]);
+	*length = RL32(&buf[4]);
+	if (*length > SR_NET_MAX_FRAME)
+		return SR_ERR_DATA;
+	if (len - SR_NET_FRAME_HEADER < *length)
+		return SR_ERR_NA;
+
+	return SR_OK;
+}
+
+/**
+ * Check whether batches can get compressed.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_net_batch_compression(void)
+{
+#ifdef HAVE_ZLIB
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Append a batch frame which holds the given frames.
+ *
+ * @param out The buffer to append the batch frame to.
+ * @param frames The frames to put into the batch.
+ * @param len The length of @a frames.
+ * @param level The compression level, 0 stores the frames as they are.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA Compression would not save space, or is not
+ *         available. Nothing was appended.
+ *
+ * @private
+ */
+SR_PRIV int sr_net_batch_pack(GString *out, const uint8_t *frames,
+		size_t len, int level)
+{
+#ifdef HAVE_ZLIB
+	uLongf csize;
+	size_t pos;
+	uint8_t *hdr;
+
+	if (!level || len > SR_NET_MAX_FRAME - 4)
+		return SR_ERR_NA;
+
+	/* Compress right into the output, then fill in the header. */
+	pos = out->len;
+	csize = compressBound(len);
+	g_string_set_size(out, pos + SR_NET_FRAME_HEADER + 4 + csize);
+	if (compress2((Bytef *)&out->str[pos + SR_NET_FRAME_HEADER + 4],
+			&csize, frames, len, level) != Z_OK || csize >= len) {
+		g_string_truncate(out, pos);
+		return SR_ERR_NA;
+	}
+	g_string_set_size(out, pos + SR_NET_FRAME_HEADER + 4 + csize);
+	hdr = (uint8_t *)&out->str[pos];
+	WL32(&hdr[0], SR_NET_BATCH);
+	WL32(&hdr[4], 4 + csize);
+	WL32(&hdr[SR_NET_FRAME_HEADER], len);
+
+	return SR_OK;
+#else
+	(void)out;
+	(void)frames;
+	(void)len;
+	(void)level;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Unpack the content of a batch frame.
+ *
+ * @param payload The batch frame's payload.
+ * @param len The length of the payload.
+ * @param out Receives the frames of the batch, replacing its content.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA Invalid batch.
+ * @retval SR_ERR_NA Compression is not supported in this build.
+ *
+ * @private
+ */
+SR_PRIV int sr_net_batch_unpack(const uint8_t *payload, size_t len,
+		GByteArray *out)
+{
+#ifdef HAVE_ZLIB
+	uLongf usize;
+
+	if (len < 4 || RL32(payload) > SR_NET_MAX_FRAME)
+		return SR_ERR_DATA;
+
+	usize = RL32(payload);
+	g_byte_array_set_size(out, usize);
+	if (uncompress(out->data, &usize, payload + 4, len - 4) != Z_OK ||
+			usize != out->len) {
+		g_byte_array_set_size(out, 0);
+		return SR_ERR_DATA;
+	}
+
+	return SR_OK;
+#else
+	(void)payload;
+	(void)len;
+	(void)out;
+
+	sr_err("Compressed network streams need zlib support.");
+
+	return SR_ERR_NA;
+#endif
+}
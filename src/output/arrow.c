@@ -0,0 +1,753 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Write the datafeed as an Apache Arrow IPC stream, which pyarrow,
+ * pandas, polars and duckdb load without parsing text.
+ *
+ * The schema has an int64 column of sample numbers, a boolean column
+ * (bit-packed) per logic channel, and a float32 column per analog
+ * channel. Its metadata has the samplerate and the start time of the
+ * acquisition. Record batches hold a fixed number of rows, the last
+ * batch marks values as null which some channels didn't provide.
+ *
+ * The Arrow metadata is encoded as flatbuffers, which a minimal builder
+ * below takes care of, so no Arrow library is needed.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/arrow"
+
+#define DEFAULT_BATCH_ROWS (64 * 1024)
+
+/* Arrow format constants, see Schema.fbs and Message.fbs. */
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_BOOL 6
+#define ARROW_PRECISION_SINGLE 1
+#define ARROW_CONTINUATION 0xffffffff
+
+#define FBB_MAX_FIELDS 8
+
+/*
+ * Flatbuffers get built back to front, objects are prepended to the
+ * buffer. Objects are referred to by their distance from the buffer's
+ * end, which doesn't change while more gets prepended.
+ */
+struct fbb {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	/* Positions of the fields of the table under construction. */
+	size_t fields[FBB_MAX_FIELDS];
+	size_t table_start;
+};
+
+struct column {
+	/* NULL for the sample numbers. */
+	const struct sr_channel *ch;
+	/* Pending values, bit-packed for logic channels. */
+	uint8_t *data;
+	size_t size;
+	uint64_t count;
+};
+
+struct out_context {
+	gboolean header_done;
+	uint64_t samplerate;
+	gint64 start_time;
+	uint64_t batch_rows;
+	uint64_t rows_written;
+	size_t num_columns;
+	struct column *columns;
+	float *fdata;
+	size_t fdata_size;
+	struct fbb fbb;
+	struct sr_mem_account *account;
+};
+
+static uint8_t *fbb_prepend(struct fbb *b, size_t length)
+{
+	size_t size;
+
+	if (b->len + length > b->size) {
+		size = MAX(2 * b->size, b->len + length + 256);
+		b->buf = g_realloc(b->buf, size);
+		/* Keep the content at the end. */
+		memmove(b->buf + size - b->len, b->buf + b->size - b->len,
+			b->len);
+		b->size = size;
+	}
+	b->len += length;
+
+	return b->buf + b->size - b->len;
+}
+
+/* Pad, so that an object of the given size ends up aligned. */
+static void fbb_align(struct fbb *b, size_t length, size_t align)
+{
+	size_t pad;
+
+	pad = (align - (b->len + length) % align) % align;
+	if (pad)
+		memset(fbb_prepend(b, pad), 0, pad);
+}
+
+static size_t fbb_u8(struct fbb *b, uint8_t value)
+{
+	*fbb_prepend(b, 1) = value;
+
+	return b->len;
+}
+
+static size_t fbb_u16(struct fbb *b, uint16_t value)
+{
+	fbb_align(b, 2, 2);
+	WL16(fbb_prepend(b, 2), value);
+
+	return b->len;
+}
+
+static size_t fbb_u32(struct fbb *b, uint32_t value)
+{
+	fbb_align(b, 4, 4);
+	WL32(fbb_prepend(b, 4), value);
+
+	return b->len;
+}
+
+static size_t fbb_u64(struct fbb *b, uint64_t value)
+{
+	fbb_align(b, 8, 8);
+	WL64(fbb_prepend(b, 8), value);
+
+	return b->len;
+}
+
+/* Reference an object which was prepended before. */
+static size_t fbb_offset(struct fbb *b, size_t target)
+{
+	fbb_align(b, 4, 4);
+
+	return fbb_u32(b, b->len + 4 - target);
+}
+
+static size_t fbb_string(struct fbb *b, const char *str)
+{
+	size_t length;
+
+	length = strlen(str);
+	fbb_align(b, length + 1 + 4, 4);
+	memcpy(fbb_prepend(b, length + 1), str, length + 1);
+
+	return fbb_u32(b, length);
+}
+
+static size_t fbb_offset_vector(struct fbb *b, const size_t *items,
+	size_t count)
+{
+	size_t i;
+
+	fbb_align(b, 4 * count + 4, 4);
+	for (i = count; i--; )
+		fbb_offset(b, items[i]);
+
+	return fbb_u32(b, count);
+}
+
+/* A vector of structs of two int64 values, FieldNode and Buffer. */
+static size_t fbb_pair_vector(struct fbb *b, const uint64_t *pairs,
+	size_t count)
+{
+	size_t i;
+
+	fbb_align(b, 16 * count, 8);
+	for (i = 2 * count; i--; )
+		fbb_u64(b, pairs[i]);
+
+	return fbb_u32(b, count);
+}
+
+static void fbb_table_start(struct fbb *b)
+{
+	memset(b->fields, 0, sizeof(b->fields));
+	b->table_start = b->len;
+}
+
+static size_t fbb_table_end(struct fbb *b)
+{
+	size_t table, field, num_fields;
+	uint8_t *p;
+
+	/* The table starts with the offset to its vtable. */
+	table = fbb_u32(b, 0);
+	num_fields = 0;
+	for (field = 0; field < FBB_MAX_FIELDS; field++) {
+		if (b->fields[field])
+			num_fields = field + 1;
+	}
+	for (field = num_fields; field--; )
+		fbb_u16(b, b->fields[field] ? table - b->fields[field] : 0);
+	fbb_u16(b, table - b->table_start);
+	fbb_u16(b, 4 + 2 * num_fields);
+
+	/* The vtable precedes the table. */
+	p = b->buf + b->size - table;
+	WL32(p, b->len - table);
+
+	return table;
+}
+
+static void fbb_reset(struct fbb *b)
+{
+	b->len = 0;
+}
+
+/* Complete the buffer, which then is a multiple of 8 bytes. */
+static void fbb_finish(struct fbb *b, size_t root)
+{
+	fbb_align(b, 4, 8);
+	fbb_offset(b, root);
+}
+
+static size_t fbb_key_value(struct fbb *b, const char *key, const char *value)
+{
+	size_t key_pos, value_pos;
+
+	key_pos = fbb_string(b, key);
+	value_pos = fbb_string(b, value);
+	fbb_table_start(b);
+	b->fields[0] = fbb_offset(b, key_pos);
+	b->fields[1] = fbb_offset(b, value_pos);
+
+	return fbb_table_end(b);
+}
+
+/* Encapsulate a Message header, with a body of the given length. */
+static size_t fbb_message(struct fbb *b, uint8_t header_type, size_t header,
+	uint64_t body_length)
+{
+	fbb_table_start(b);
+	b->fields[3] = fbb_u64(b, body_length);
+	b->fields[2] = fbb_offset(b, header);
+	b->fields[0] = fbb_u16(b, ARROW_METADATA_V5);
+	b->fields[1] = fbb_u8(b, header_type);
+
+	return fbb_table_end(b);
+}
+
+/* Append an encapsulated message's prefix and metadata to the output. */
+static void append_message(struct fbb *b, GString *out)
+{
+	uint8_t prefix[8];
+
+	WL32(&prefix[0], ARROW_CONTINUATION);
+	WL32(&prefix[4], b->len);
+	g_string_append_len(out, (const char *)prefix, sizeof(prefix));
+	g_string_append_len(out, (const char *)b->buf + b->size - b->len,
+		b->len);
+}
+
+static size_t field_type(struct fbb *b, const struct column *col,
+	uint8_t *type_type)
+{
+	size_t pos;
+
+	fbb_table_start(b);
+	if (!col->ch) {
+		*type_type = ARROW_TYPE_INT;
+		b->fields[0] = fbb_u32(b, 64);
+		b->fields[1] = fbb_u8(b, 1);
+	} else if (col->ch->type == SR_CHANNEL_LOGIC) {
+		*type_type = ARROW_TYPE_BOOL;
+	} else {
+		*type_type = ARROW_TYPE_FLOATING_POINT;
+		b->fields[0] = fbb_u16(b, ARROW_PRECISION_SINGLE);
+	}
+	pos = fbb_table_end(b);
+
+	return pos;
+}
+
+static void gen_schema(struct out_context *outc, GString *out)
+{
+	struct fbb *b;
+	struct column *col;
+	size_t *fields, meta[2], name, type, children, fields_vec, meta_vec;
+	size_t schema, i;
+	uint8_t type_type;
+	char *value;
+
+	b = &outc->fbb;
+	fbb_reset(b);
+	fields = g_malloc_n(outc->num_columns, sizeof(fields[0]));
+	for (i = 0; i < outc->num_columns; i++) {
+		col = &outc->columns[i];
+		name = fbb_string(b, col->ch ? col->ch->name : "sample");
+		type = field_type(b, col, &type_type);
+		children = fbb_offset_vector(b, NULL, 0);
+		fbb_table_start(b);
+		b->fields[0] = fbb_offset(b, name);
+		b->fields[3] = fbb_offset(b, type);
+		b->fields[5] = fbb_offset(b, children);
+		b->fields[1] = fbb_u8(b, col->ch != NULL);
+		b->fields[2] = fbb_u8(b, type_type);
+		fields[i] = fbb_table_end(b);
+	}
+	fields_vec = fbb_offset_vector(b, fields, outc->num_columns);
+	g_free(fields);
+
+	value = g_strdup_printf("%" PRIu64, outc->samplerate);
+	meta[0] = fbb_key_value(b, "samplerate", value);
+	g_free(value);
+	value = g_strdup_printf("%" G_GINT64_FORMAT, outc->start_time);
+	meta[1] = fbb_key_value(b, "start_time_us", value);
+	g_free(value);
+	meta_vec = fbb_offset_vector(b, meta, ARRAY_SIZE(meta));
+
+	fbb_table_start(b);
+	b->fields[1] = fbb_offset(b, fields_vec);
+	b->fields[2] = fbb_offset(b, meta_vec);
+	b->fields[0] = fbb_u16(b, 0);
+	schema = fbb_table_end(b);
+
+	fbb_finish(b, fbb_message(b, ARROW_HEADER_SCHEMA, schema, 0));
+	append_message(b, out);
+}
+
+static size_t pad8(size_t length)
+{
+	return (length + 7) & ~(size_t)7;
+}
+
+/* Size of a column's values in a batch of the given number of rows. */
+static size_t column_data_size(const struct column *col, uint64_t rows)
+{
+	if (!col->ch)
+		return rows * sizeof(int64_t);
+	if (col->ch->type == SR_CHANNEL_LOGIC)
+		return (rows + 7) / 8;
+
+	return rows * sizeof(float);
+}
+
+static size_t column_pending_size(const struct column *col, uint64_t rows)
+{
+	return column_data_size(col, MIN(col->count, rows));
+}
+
+static void append_zeros(GString *out, size_t length)
+{
+	size_t pos;
+
+	pos = out->len;
+	g_string_set_size(out, pos + length);
+	memset(out->str + pos, 0, length);
+}
+
+/*
+ * Write a record batch of the columns' first rows. Columns which lack
+ * some of the rows get their missing values marked as null.
+ */
+static void write_batch(struct out_context *outc, GString *out, uint64_t rows)
+{
+	struct fbb *b;
+	struct column *col;
+	uint64_t *nodes, *buffers, offset, nulls, i;
+	size_t c, length, valid, pos, nodes_vec, buffers_vec, batch;
+	uint8_t *p;
+
+	nodes = g_malloc_n(2 * outc->num_columns, sizeof(nodes[0]));
+	buffers = g_malloc_n(4 * outc->num_columns, sizeof(buffers[0]));
+	offset = 0;
+	for (c = 0; c < outc->num_columns; c++) {
+		col = &outc->columns[c];
+		nulls = col->ch && col->count < rows ? rows - col->count : 0;
+		nodes[2 * c] = rows;
+		nodes[2 * c + 1] = nulls;
+		valid = nulls ? (rows + 7) / 8 : 0;
+		buffers[4 * c] = offset;
+		buffers[4 * c + 1] = valid;
+		offset += pad8(valid);
+		length = column_data_size(col, rows);
+		buffers[4 * c + 2] = offset;
+		buffers[4 * c + 3] = length;
+		offset += pad8(length);
+	}
+
+	b = &outc->fbb;
+	fbb_reset(b);
+	buffers_vec = fbb_pair_vector(b, buffers, 2 * outc->num_columns);
+	nodes_vec = fbb_pair_vector(b, nodes, outc->num_columns);
+	fbb_table_start(b);
+	b->fields[0] = fbb_u64(b, rows);
+	b->fields[1] = fbb_offset(b, nodes_vec);
+	b->fields[2] = fbb_offset(b, buffers_vec);
+	batch = fbb_table_end(b);
+	fbb_finish(b, fbb_message(b, ARROW_HEADER_RECORD_BATCH, batch, offset));
+	append_message(b, out);
+
+	for (c = 0; c < outc->num_columns; c++) {
+		col = &outc->columns[c];
+		if (nodes[2 * c + 1]) {
+			/* The validity bitmap has the provided rows set. */
+			pos = out->len;
+			append_zeros(out, pad8(buffers[4 * c + 1]));
+			p = (uint8_t *)out->str + pos;
+			memset(p, 0xff, col->count / 8);
+			for (i = col->count & ~UINT64_C(7); i < col->count; i++)
+				p[i / 8] |= 1 << (i % 8);
+		}
+		pos = out->len;
+		length = buffers[4 * c + 3];
+		append_zeros(out, pad8(length));
+		p = (uint8_t *)out->str + pos;
+		if (!col->ch) {
+			for (i = 0; i < rows; i++)
+				WL64(&p[i * sizeof(int64_t)], outc->rows_written + i);
+		} else {
+			memcpy(p, col->data, column_pending_size(col, rows));
+		}
+	}
+	g_free(nodes);
+	g_free(buffers);
+
+	/* Batches other than the last have a multiple of 8 rows. */
+	for (c = 0; c < outc->num_columns; c++) {
+		col = &outc->columns[c];
+		if (!col->ch)
+			continue;
+		if (col->count <= rows) {
+			col->count = 0;
+			continue;
+		}
+		length = column_data_size(col, rows);
+		memmove(col->data, col->data + length,
+			column_data_size(col, col->count) - length);
+		col->count -= rows;
+	}
+	outc->rows_written += rows;
+}
+
+/* Write the batches which all channels have provided the values for. */
+static void write_batches(struct out_context *outc, GString *out)
+{
+	uint64_t rows;
+	size_t c;
+
+	rows = UINT64_MAX;
+	for (c = 0; c < outc->num_columns; c++) {
+		if (outc->columns[c].ch)
+			rows = MIN(rows, outc->columns[c].count);
+	}
+	while (rows >= outc->batch_rows) {
+		write_batch(outc, out, outc->batch_rows);
+		rows -= outc->batch_rows;
+	}
+}
+
+static int column_reserve(struct out_context *outc, struct column *col,
+	uint64_t count)
+{
+	size_t size;
+	uint8_t *data;
+
+	size = column_data_size(col, col->count + count);
+	if (size <= col->size)
+		return SR_OK;
+
+	size = MAX(size, 2 * col->size);
+	if (!(data = g_try_realloc(col->data, size)))
+		return SR_ERR_MALLOC;
+	sr_mem_account_charge(outc->account, size - col->size);
+	col->data = data;
+	col->size = size;
+
+	return SR_OK;
+}
+
+static int receive_logic(struct out_context *outc,
+	const struct sr_datafeed_logic *logic)
+{
+	struct column *col;
+	const uint8_t *src;
+	uint64_t count, row, i;
+	size_t c, byte;
+	uint8_t mask, *dst;
+	int ret;
+
+	if (!logic->unitsize)
+		return SR_ERR_ARG;
+	count = logic->length / logic->unitsize;
+	for (c = 0; c < outc->num_columns; c++) {
+		col = &outc->columns[c];
+		if (!col->ch || col->ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if ((ret = column_reserve(outc, col, count)) != SR_OK)
+			return ret;
+		byte = col->ch->index / 8;
+		mask = 1 << (col->ch->index % 8);
+		src = logic->data;
+		dst = col->data;
+		row = col->count;
+		if (byte >= logic->unitsize) {
+			for (i = 0; i < count; i++, row++)
+				dst[row / 8] &= ~(1 << (row % 8));
+		} else {
+			for (i = 0; i < count; i++, row++) {
+				if (src[i * logic->unitsize + byte] & mask)
+					dst[row / 8] |= 1 << (row % 8);
+				else
+					dst[row / 8] &= ~(1 << (row % 8));
+			}
+		}
+		col->count = row;
+	}
+
+	return SR_OK;
+}
+
+static int receive_analog(struct out_context *outc,
+	const struct sr_datafeed_analog *analog)
+{
+	struct column *col;
+	const GSList *l;
+	float *values, *dst;
+	size_t num_channels, count, c, i, j;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	count = analog->num_samples;
+	if (!num_channels || !count)
+		return SR_OK;
+
+	if (outc->fdata_size < count * num_channels) {
+		values = g_try_realloc(outc->fdata,
+			count * num_channels * sizeof(float));
+		if (!values)
+			return SR_ERR_MALLOC;
+		outc->fdata = values;
+		outc->fdata_size = count * num_channels;
+	}
+	if ((ret = sr_analog_to_float(analog, outc->fdata)) != SR_OK)
+		return ret;
+
+	for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+		for (c = 0; c < outc->num_columns; c++) {
+			if (outc->columns[c].ch == l->data)
+				break;
+		}
+		if (c == outc->num_columns)
+			continue;
+		col = &outc->columns[c];
+		if ((ret = column_reserve(outc, col, count)) != SR_OK)
+			return ret;
+		dst = (float *)col->data + col->count;
+		for (i = 0; i < count; i++)
+			write_fltle((uint8_t *)&dst[i],
+				outc->fdata[i * num_channels + j]);
+		col->count += count;
+	}
+
+	return SR_OK;
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	struct sr_channel *ch;
+	GSList *l;
+	uint64_t batch_rows;
+	size_t num_columns;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	batch_rows = g_variant_get_uint64(g_hash_table_lookup(options, "batch"));
+	if (!batch_rows) {
+		sr_err("The batch size must not be zero.");
+		return SR_ERR_ARG;
+	}
+
+	num_columns = 1;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->enabled && (ch->type == SR_CHANNEL_LOGIC ||
+				ch->type == SR_CHANNEL_ANALOG))
+			num_columns++;
+	}
+	if (num_columns == 1) {
+		sr_err("No channels enabled.");
+		return SR_ERR_ARG;
+	}
+
+	outc = g_malloc0(sizeof(*outc));
+	/* Bit-packed columns get cut at byte boundaries. */
+	outc->batch_rows = (batch_rows + 7) & ~UINT64_C(7);
+	outc->columns = g_malloc0_n(num_columns, sizeof(outc->columns[0]));
+	outc->num_columns = 1;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->enabled && (ch->type == SR_CHANNEL_LOGIC ||
+				ch->type == SR_CHANNEL_ANALOG))
+			outc->columns[outc->num_columns++].ch = ch;
+	}
+	outc->account = sr_mem_account_new(o->sdi->session, "output");
+	o->priv = outc;
+
+	return SR_OK;
+}
+
+static void chk_header(const struct sr_output *o, GString **out)
+{
+	struct out_context *outc;
+	GVariant *gvar;
+
+	outc = o->priv;
+	if (outc->header_done)
+		return;
+	outc->header_done = TRUE;
+
+	if (!outc->samplerate && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		outc->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	if (!*out)
+		*out = g_string_sized_new(1024);
+	gen_schema(outc, *out);
+}
+
+static int receive(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	const struct sr_datafeed_logic *logic;
+	uint64_t rows;
+	uint8_t eos[8];
+	GSList *l;
+	size_t c;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		outc->start_time = (gint64)header->starttime.tv_sec *
+			G_USEC_PER_SEC + header->starttime.tv_usec;
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			outc->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		chk_header(o, out);
+		logic = packet->payload;
+		if ((ret = receive_logic(outc, logic)) != SR_OK)
+			return ret;
+		write_batches(outc, *out);
+		break;
+	case SR_DF_ANALOG:
+		chk_header(o, out);
+		if ((ret = receive_analog(outc, packet->payload)) != SR_OK)
+			return ret;
+		write_batches(outc, *out);
+		break;
+	case SR_DF_END:
+		chk_header(o, out);
+		/* The last batch has all pending values. */
+		rows = 0;
+		for (c = 0; c < outc->num_columns; c++)
+			rows = MAX(rows, outc->columns[c].count);
+		if (rows)
+			write_batch(outc, *out, rows);
+		WL32(&eos[0], ARROW_CONTINUATION);
+		WL32(&eos[4], 0);
+		g_string_append_len(*out, (const char *)eos, sizeof(eos));
+		break;
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "batch", "Batch size", "Number of samples per record batch", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(
+			g_variant_new_uint64(DEFAULT_BATCH_ROWS));
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+	size_t c;
+
+	outc = o->priv;
+	if (!outc)
+		return SR_OK;
+
+	for (c = 0; c < outc->num_columns; c++)
+		g_free(outc->columns[c].data);
+	g_free(outc->columns);
+	g_free(outc->fdata);
+	g_free(outc->fbb.buf);
+	sr_mem_account_free(outc->account);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_arrow = {
+	.id = "arrow",
+	.name = "Arrow",
+	.desc = "Apache Arrow IPC stream, one column per channel",
+	.exts = (const char *[]){"arrows", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
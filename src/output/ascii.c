@@ -51,14 +51,17 @@ struct context {
 	GString **lines;
 	const char *charset;
 	gboolean edges;
+	struct sr_bitslice *slice;
+	/* Text for eight samples without edges, indexed by their plane byte. */
+	char level_text[256][8];
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
+	const struct sr_channel_layout *layout;
 	struct sr_channel *ch;
-	GSList *l;
-	size_t j, max_namelen, alloc_line_len;
+	size_t i, j, k, max_namelen, alloc_line_len;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -75,14 +78,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	}
 	ctx->edges = (strlen(ctx->charset) >= 4) ? TRUE : FALSE;
 
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
-	}
+	layout = sr_dev_channel_layout(o->sdi);
+	ctx->num_enabled_channels = layout->num_logic;
 	ctx->channel_index = g_malloc0(sizeof(ctx->channel_index[0]) * ctx->num_enabled_channels);
 	ctx->aligned_names = g_malloc0(sizeof(ctx->aligned_names[0]) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc0(sizeof(ctx->lines[0]) * ctx->num_enabled_channels);
@@ -90,32 +87,25 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	/* Get the maximum length across all active logic channels. */
 	max_namelen = 0;
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		max_namelen = MAX(max_namelen, strlen(ch->name));
-	}
+	for (j = 0; j < layout->num_logic; j++)
+		max_namelen = MAX(max_namelen, strlen(layout->logic[j]->name));
 	ctx->max_namelen = max_namelen;
 
 	alloc_line_len = ctx->max_namelen + 8 + ctx->spl;
-	j = 0;
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-
+	for (j = 0; j < layout->num_logic; j++) {
+		ch = layout->logic[j];
 		ctx->channel_index[j] = ch->index;
 		ctx->aligned_names[j] = g_strdup_printf("%*s", (int)max_namelen, ch->name);
 
 		ctx->lines[j] = g_string_sized_new(alloc_line_len);
 		g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+	}
+	ctx->slice = sr_bitslice_new(ctx->channel_index,
+		ctx->num_enabled_channels);
 
-		j++;
+	for (i = 0; i < 256; i++) {
+		for (k = 0; k < 8; k++)
+			ctx->level_text[i][k] = ctx->charset[(i >> k) & 1];
 	}
 
 	return SR_OK;
@@ -172,6 +162,53 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
+/* Append a channel's text for the samples following the line position. */
+static void append_levels(const struct context *ctx, size_t ch,
+		const uint8_t *plane, size_t count)
+{
+	GString *line;
+	size_t idx, k, pos, bit;
+	uint8_t value, edges, curbit, prevbit;
+
+	line = ctx->lines[ch];
+	idx = ctx->channel_index[ch];
+	prevbit = (ctx->prev_sample[idx / 8] >> (idx % 8)) & 1;
+	pos = ctx->spl_cnt;
+	k = 0;
+	while (k < count) {
+		if (pos && count - k >= 8) {
+			/*
+			 * Eight samples past the line's start. Without
+			 * edges (in the data, or in the charset) the
+			 * text is a table lookup.
+			 */
+			value = sr_bitplane_get8(plane, k);
+			edges = value ^ (uint8_t)((value << 1) | prevbit);
+			if (!ctx->edges || !edges) {
+				g_string_append_len(line, ctx->level_text[value], 8);
+			} else {
+				for (bit = 0; bit < 8; bit++) {
+					g_string_append_c(line, ctx->charset[
+						((value >> bit) & 1) |
+						(((edges >> bit) & 1) << 1)]);
+				}
+			}
+			prevbit = value >> 7;
+			k += 8;
+			pos += 8;
+			continue;
+		}
+		curbit = sr_bitplane_bit(plane, k);
+		if (ctx->edges && pos && curbit != prevbit)
+			g_string_append_c(line, ctx->charset[curbit + 2]);
+		else
+			g_string_append_c(line, ctx->charset[curbit]);
+		prevbit = curbit;
+		k++;
+		pos++;
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -180,13 +217,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	size_t idx, i, j;
-	size_t num_samples;
+	size_t i, j;
+	size_t num_samples, count;
 	const uint8_t *curr_sample;
-	size_t bytepos;
-	uint8_t bitmask, curbit, prevbit;
-	char c;
-	size_t charidx;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -216,39 +249,42 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		}
 
 		logic = packet->payload;
+		if (!logic->unitsize)
+			break;
+		/*
+		 * Slice blocks of samples into per-channel bit planes, which
+		 * end at line boundaries. The text then gets generated for
+		 * eight samples at a time where no edges need drawing.
+		 */
 		num_samples = logic->length / logic->unitsize;
 		curr_sample = logic->data;
-		while (num_samples--) {
-			ctx->spl_cnt++;
+		while (num_samples) {
+			count = num_samples;
+			if (ctx->spl)
+				count = MIN(count, ctx->spl - ctx->spl_cnt);
+			count = sr_bitslice_load(ctx->slice, curr_sample,
+				logic->unitsize, count);
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				bytepos = idx / 8;
-				bitmask = 1U << (idx % 8);
-				curbit = curr_sample[bytepos] & bitmask;
-				prevbit = ctx->prev_sample[bytepos] & bitmask;
-
-				charidx = curbit ? 1 : 0;
-				if (ctx->edges && ctx->spl_cnt > 1) {
-					if (curbit != prevbit)
-						charidx += 2;
-				}
-				c = ctx->charset[charidx];
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
+				append_levels(ctx, j,
+					sr_bitslice_plane(ctx->slice, j), count);
+			}
+			ctx->spl_cnt += count;
+			curr_sample += count * logic->unitsize;
+			num_samples -= count;
+			memcpy(ctx->prev_sample, curr_sample - logic->unitsize,
+				logic->unitsize);
+
+			if (ctx->spl_cnt == ctx->spl) {
+				/* Flush line buffers. */
+				for (j = 0; j < ctx->num_enabled_channels; j++) {
 					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
 					g_string_append_c(*out, '\n');
 					if (j + 1 == ctx->num_enabled_channels)
 						maybe_add_trigger(ctx, *out);
 					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
 				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
 				ctx->spl_cnt = 0;
-			memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
-			curr_sample += logic->unitsize;
+			}
 		}
 		break;
 	case SR_DF_END:
@@ -287,6 +323,7 @@ static int cleanup(struct sr_output *o)
 	g_free(ctx->aligned_names);
 	g_free(ctx->lines);
 	g_free((gpointer)ctx->charset);
+	sr_bitslice_free(ctx->slice);
 	g_free(ctx);
 	o->priv = NULL;
 
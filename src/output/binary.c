@@ -26,18 +26,34 @@
 
 #define LOG_PREFIX "output/binary"
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+static int receive_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
 {
 	const struct sr_datafeed_logic *logic;
 
 	(void)o;
 
-	*out = NULL;
 	if (packet->type != SR_DF_LOGIC)
 		return SR_OK;
 	logic = packet->payload;
-	*out = g_string_new_len(logic->data, logic->length);
+	g_string_append_len(out, logic->data, logic->length);
+
+	return SR_OK;
+}
+
+static int receive_direct(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		const uint8_t **data, size_t *length)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)o;
+
+	if (packet->type != SR_DF_LOGIC)
+		return SR_OK;
+	logic = packet->payload;
+	*data = logic->data;
+	*length = logic->length;
 
 	return SR_OK;
 }
@@ -49,5 +65,6 @@ SR_PRIV struct sr_output_module output_binary = {
 	.exts = NULL,
 	.flags = 0,
 	.options = NULL,
-	.receive = receive,
+	.receive_append = receive_append,
+	.receive_direct = receive_direct,
 };
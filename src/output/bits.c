@@ -38,14 +38,18 @@ struct context {
 	char **channel_names;
 	gboolean header_done;
 	GString **lines;
+	struct sr_bitslice *slice;
+	/* Text for eight samples, indexed by their plane byte. */
+	char bits_text[256][8];
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
+	const struct sr_channel_layout *layout;
 	struct sr_channel *ch;
-	GSList *l;
-	unsigned int i, j;
+	unsigned int i, j, k;
+	size_t line_len;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -55,30 +59,30 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->trigger = -1;
 	ctx->spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
 
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
-	}
+	layout = sr_dev_channel_layout(o->sdi);
+	ctx->num_enabled_channels = layout->num_logic;
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
 
-	j = 0;
-	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
+	/* One character per bit, plus one separator per byte. */
+	line_len = 80;
+	if (ctx->spl > 0)
+		line_len = ctx->spl + ctx->spl / 8 + 1;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		ch = layout->logic[j];
 		ctx->channel_index[j] = ch->index;
 		ctx->channel_names[j] = ch->name;
-		ctx->lines[j] = g_string_sized_new(80);
+		ctx->lines[j] = g_string_sized_new(strlen(ch->name) + line_len);
 		g_string_printf(ctx->lines[j], "%s:", ch->name);
-		j++;
+	}
+	ctx->slice = sr_bitslice_new(ctx->channel_index,
+		ctx->num_enabled_channels);
+
+	for (i = 0; i < 256; i++) {
+		for (k = 0; k < 8; k++)
+			ctx->bits_text[i][k] = (i & (1 << k)) ? '1' : '0';
 	}
 
 	return SR_OK;
@@ -116,6 +120,56 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	int offset;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+	}
+	if (ctx->num_enabled_channels && ctx->trigger > -1) {
+		/*
+		 * Sample data lines have one character per bit,
+		 * plus one separator per byte. Align trigger marker
+		 * to this layout.
+		 */
+		offset = ctx->trigger + ctx->trigger / 8;
+		g_string_append_printf(out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+		ctx->trigger = -1;
+	}
+}
+
+/* Append a channel's text for the samples following the line position. */
+static void append_bits(const struct context *ctx, GString *line,
+		const uint8_t *plane, size_t count)
+{
+	size_t k;
+	int pos;
+
+	pos = ctx->spl_cnt;
+	k = 0;
+	while (k < count) {
+		if ((pos & 7) == 0 && count - k >= 8 && pos + 8 != ctx->spl) {
+			/* A whole byte which does not end the line. */
+			g_string_append_len(line,
+				ctx->bits_text[sr_bitplane_get8(plane, k)], 8);
+			g_string_append_c(line, ' ');
+			k += 8;
+			pos += 8;
+			continue;
+		}
+		g_string_append_c(line, sr_bitplane_bit(plane, k) ? '1' : '0');
+		k++;
+		pos++;
+		/* Add a space every 8th bit, except at the line's end. */
+		if (pos != ctx->spl && (pos & 7) == 0)
+			g_string_append_c(line, ' ');
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -124,9 +178,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	struct context *ctx;
 	GSList *l;
-	int idx, offset;
-	uint64_t i, j;
-	gchar *p, c;
+	const uint8_t *data;
+	size_t num_samples, count;
+	uint64_t i;
+	unsigned int j;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -155,37 +210,32 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
+		if (!logic->unitsize)
+			break;
+		/*
+		 * Slice blocks of samples into per-channel bit planes, which
+		 * end at line boundaries. The text then gets generated from
+		 * whole plane bytes where the line layout permits.
+		 */
+		data = logic->data;
+		num_samples = logic->length / logic->unitsize;
+		while (num_samples) {
+			count = num_samples;
+			if (ctx->spl > 0)
+				count = MIN(count, (size_t)(ctx->spl - ctx->spl_cnt));
+			count = sr_bitslice_load(ctx->slice, data,
+				logic->unitsize, count);
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = (*p & (1 << (idx % 8))) ? '1' : '0';
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per bit,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				} else if ((ctx->spl_cnt & 7) == 0) {
-					/* Add a space every 8th bit. */
-					g_string_append_c(ctx->lines[j], ' ');
-				}
+				append_bits(ctx, ctx->lines[j],
+					sr_bitslice_plane(ctx->slice, j), count);
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+			ctx->spl_cnt += count;
+			if (ctx->spl_cnt == ctx->spl) {
+				flush_lines(ctx, *out);
 				ctx->spl_cnt = 0;
+			}
+			data += count * logic->unitsize;
+			num_samples -= count;
 		}
 		break;
 	case SR_DF_END:
@@ -219,6 +269,7 @@ static int cleanup(struct sr_output *o)
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
+	sr_bitslice_free(ctx->slice);
 	g_free(ctx);
 	o->priv = NULL;
 
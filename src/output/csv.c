@@ -51,10 +51,15 @@
  *
  * dedup:   Don't output duplicate rows. Defaults to FALSE. If time is off, then
  *          this is forced to be off.
+ *
+ * threads: Number of tasks which format the rows of large frames, on the
+ *          context's worker pool (see sr_thread_pool_size_set()). 0 for one
+ *          per CPU. Defaults to 1, formatting on the session thread.
  */
 
 #include <config.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <glib.h>
@@ -63,6 +68,9 @@
 
 #define LOG_PREFIX "output/csv"
 
+/* Minimum number of rows per formatting thread. */
+#define THREAD_MIN_ROWS	(16 * 1024)
+
 struct ctx_channel {
 	struct sr_channel *ch;
 	char *label;
@@ -96,7 +104,6 @@ struct context {
 	uint64_t sample_rate;
 	uint64_t sample_scale;
 	uint64_t out_sample_count;
-	uint8_t *previous_sample;
 	float *analog_samples;
 	uint8_t *logic_samples;
 	const char *xlabel;	/* Don't free: will point to a static string. */
@@ -106,6 +113,21 @@ struct context {
 	gboolean have_checked;
 	gboolean have_frames;
 	uint64_t pkt_snums;
+
+	/* Formatting tasks, which run on the context's shared pool. */
+	unsigned int num_threads;
+	struct sr_context *sr_ctx;
+	/* Workers apply the thread settings of this session. */
+	const struct sr_session *session;
+};
+
+/** A block of saved rows, which gets formatted by a worker thread. */
+struct format_job {
+	struct context *ctx;
+	size_t first;
+	size_t count;
+	float *min, *max;
+	GString *text;
 };
 
 /*
@@ -121,12 +143,15 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct sr_channel *ch;
 	const char *label_string;
 	GSList *l;
+	unsigned int threads;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
+	ctx->session = o->sdi->session;
+	ctx->sr_ctx = ctx->session ? ctx->session->ctx : NULL;
 
 	/* Options */
 	ctx->gnuplot = g_strdup(g_variant_get_string(
@@ -147,6 +172,14 @@ static int init(struct sr_output *o, GHashTable *options)
 		g_hash_table_lookup(options, "label"), NULL);
 	ctx->dedup = g_variant_get_boolean(g_hash_table_lookup(options, "dedup"));
 	ctx->dedup &= ctx->time;
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		threads = g_get_num_processors();
+#else
+		threads = 2;
+#endif
+	}
 
 	if (*ctx->gnuplot && g_strcmp0(ctx->record, "\n"))
 		sr_warn("gnuplot record separator must be newline.");
@@ -207,6 +240,8 @@ static int init(struct sr_output *o, GHashTable *options)
 		}
 	}
 
+	ctx->num_threads = threads;
+
 	return SR_OK;
 }
 
@@ -215,19 +250,17 @@ static const char *xlabels[] = {
 	"femtoseconds", "attoseconds",
 };
 
-static GString *gen_header(const struct sr_output *o,
-			   const struct sr_datafeed_header *hdr)
+static void gen_header(const struct sr_output *o,
+		const struct sr_datafeed_header *hdr, GString *header)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
 	GSList *channels, *l;
 	unsigned int num_channels, i;
 	char *samplerate_s;
 
 	ctx = o->priv;
-	header = g_string_sized_new(512);
 
 	if (ctx->sample_rate == 0) {
 		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
@@ -286,8 +319,6 @@ static GString *gen_header(const struct sr_output *o,
 	/* Time column requested but samplerate unknown. Emit a warning. */
 	if (ctx->time && !ctx->sample_rate)
 		sr_warn("Samplerate unknown, cannot provide timestamps.");
-
-	return header;
 }
 
 /*
@@ -405,13 +436,186 @@ static void process_logic(struct context *ctx,
 	}
 }
 
-static void dump_saved_values(struct context *ctx, GString **out)
+static void append_u64(GString *s, uint64_t value)
 {
-	unsigned int i, j, analog_size, num_channels;
+	char buf[24], *p;
+
+	p = &buf[sizeof(buf)];
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+/*
+ * Format a range of the saved rows. Rows only depend on their own
+ * values and their predecessor (for dedup), so ranges can be formatted
+ * independently. The channels' value ranges get collected in the
+ * caller's min/max arrays.
+ */
+static void format_rows(const struct context *ctx, GString *out,
+	size_t first, size_t count, float *min, float *max)
+{
+	size_t i, j, analog_size, num_channels;
 	double sample_time_dbl;
 	uint64_t sample_time_u64;
 	float *analog_sample, value;
 	uint8_t *logic_sample;
+	char buf[32];
+	int len;
+
+	num_channels = ctx->num_logic_channels + ctx->num_analog_channels;
+	analog_size = ctx->num_analog_channels * sizeof(float);
+	for (i = first; i < first + count; i++) {
+		analog_sample =
+		    &ctx->analog_samples[i * ctx->num_analog_channels];
+		logic_sample =
+		    &ctx->logic_samples[i * ctx->num_logic_channels];
+
+		if (ctx->dedup) {
+			/*
+			 * Skipped rows equal the last row which was output,
+			 * so comparing against the predecessor will do.
+			 */
+			if (i > 0 && i < ctx->num_samples - 1 &&
+			    !memcmp(logic_sample,
+				    logic_sample - ctx->num_logic_channels,
+				    ctx->num_logic_channels) &&
+			    !memcmp(analog_sample,
+				    analog_sample - ctx->num_analog_channels,
+				    analog_size))
+				continue;
+		}
+
+		if (ctx->time && !ctx->sample_rate) {
+			g_string_append_c(out, '0');
+			g_string_append(out, ctx->value);
+		} else if (ctx->time) {
+			sample_time_dbl = ctx->out_sample_count + i;
+			sample_time_dbl /= ctx->sample_rate;
+			sample_time_dbl *= ctx->sample_scale;
+			sample_time_u64 = sample_time_dbl;
+			append_u64(out, sample_time_u64);
+			g_string_append(out, ctx->value);
+		}
+
+		for (j = 0; j < num_channels; j++) {
+			if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
+				value = ctx->analog_samples[i * ctx->num_analog_channels + j];
+				max[j] = fmax(value, max[j]);
+				min[j] = fmin(value, min[j]);
+				len = snprintf(buf, sizeof(buf), "%g", value);
+				g_string_append_len(out, buf, len);
+			} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
+				g_string_append_c(out,
+					ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0');
+			} else {
+				sr_warn("Unexpected channel type: %d",
+					ctx->channels[j].ch->type);
+				continue;
+			}
+			g_string_append(out, ctx->value);
+		}
+
+		if (ctx->do_trigger) {
+			/* The trigger gets marked in the first row. */
+			g_string_append_c(out, (ctx->trigger && !i) ? '1' : '0');
+			g_string_append(out, ctx->value);
+		}
+		g_string_truncate(out, out->len - 1);
+		g_string_append(out, ctx->record);
+	}
+}
+
+static void format_job_run(void *data)
+{
+	struct format_job *job;
+	struct context *ctx;
+
+	job = data;
+	ctx = job->ctx;
+	sr_thread_sched_enter(ctx->session, SR_THREAD_OUTPUT);
+	format_rows(ctx, job->text, job->first, job->count,
+		job->min, job->max);
+}
+
+/*
+ * Format all saved rows. Large frames get cut into blocks for the
+ * worker pool, the blocks' text gets appended in the order of their
+ * rows.
+ */
+static void dump_rows(struct context *ctx, GString *out)
+{
+	struct format_job *jobs, *job;
+	struct sr_task_group group;
+	size_t job_count, job_size, idx, j, num_channels;
+
+	num_channels = ctx->num_logic_channels + ctx->num_analog_channels;
+	job_count = 0;
+	if (ctx->sr_ctx && ctx->num_threads > 1)
+		job_count = MIN(ctx->num_threads, ctx->num_samples / THREAD_MIN_ROWS);
+	if (job_count < 1)
+		job_count = 1;
+
+	jobs = g_malloc0_n(job_count, sizeof(jobs[0]));
+	job_size = ctx->num_samples / job_count;
+	for (idx = 0; idx < job_count; idx++) {
+		job = &jobs[idx];
+		job->ctx = ctx;
+		job->first = idx * job_size;
+		job->count = job_size;
+		if (idx + 1 == job_count)
+			job->count = ctx->num_samples - job->first;
+		job->min = g_malloc_n(num_channels, sizeof(job->min[0]));
+		job->max = g_malloc_n(num_channels, sizeof(job->max[0]));
+		for (j = 0; j < num_channels; j++) {
+			job->min[j] = ctx->channels[j].min;
+			job->max[j] = ctx->channels[j].max;
+		}
+	}
+
+	if (job_count > 1) {
+		for (idx = 0; idx < job_count; idx++) {
+			job = &jobs[idx];
+			job->text = g_string_sized_new(job->count *
+				(num_channels + 1) * 4);
+		}
+		sr_task_group_init(&group);
+		for (idx = 0; idx < job_count; idx++)
+			sr_task_run(ctx->sr_ctx, &group, format_job_run,
+				&jobs[idx]);
+		sr_task_group_wait(ctx->sr_ctx, &group);
+		sr_task_group_clear(&group);
+		for (idx = 0; idx < job_count; idx++) {
+			job = &jobs[idx];
+			g_string_append_len(out, job->text->str, job->text->len);
+			g_string_free(job->text, TRUE);
+		}
+	} else {
+		format_rows(ctx, out, 0, ctx->num_samples,
+			jobs[0].min, jobs[0].max);
+	}
+
+	for (idx = 0; idx < job_count; idx++) {
+		job = &jobs[idx];
+		for (j = 0; j < num_channels; j++) {
+			ctx->channels[j].min = fmin(job->min[j], ctx->channels[j].min);
+			ctx->channels[j].max = fmax(job->max[j], ctx->channels[j].max);
+		}
+		g_free(job->min);
+		g_free(job->max);
+	}
+	g_free(jobs);
+
+	if (ctx->num_samples)
+		ctx->trigger = FALSE;
+	ctx->out_sample_count += ctx->num_samples;
+}
+
+static void dump_saved_values(struct context *ctx, GString *out)
+{
+	unsigned int i, num_channels;
 
 	/* If we haven't seen samples we're expecting, skip them. */
 	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
@@ -420,105 +624,39 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
 
-		if (!*out)
-			*out = g_string_sized_new(512);
 		num_channels =
 		    ctx->num_logic_channels + ctx->num_analog_channels;
 
 		if (ctx->label_do) {
 			if (ctx->time)
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->label_names ? "Time" : ctx->xlabel,
 					ctx->value);
 			for (i = 0; i < num_channels; i++) {
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->channels[i].label, ctx->value);
 				if (ctx->channels[i].ch->type == SR_CHANNEL_ANALOG
 						&& ctx->label_names)
 					g_free(ctx->channels[i].label);
 			}
 			if (ctx->do_trigger)
-				g_string_append_printf(*out, "Trigger%s",
+				g_string_append_printf(out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 
 			ctx->label_do = FALSE;
 		}
 
-		analog_size = ctx->num_analog_channels * sizeof(float);
-		if (ctx->dedup && !ctx->previous_sample)
-			ctx->previous_sample = g_malloc0(analog_size + ctx->num_logic_channels);
-
-		for (i = 0; i < ctx->num_samples; i++) {
-			analog_sample =
-			    &ctx->analog_samples[i * ctx->num_analog_channels];
-			logic_sample =
-			    &ctx->logic_samples[i * ctx->num_logic_channels];
-
-			if (ctx->dedup) {
-				if (i > 0 && i < ctx->num_samples - 1 &&
-				    !memcmp(logic_sample, ctx->previous_sample,
-					    ctx->num_logic_channels) &&
-				    !memcmp(analog_sample,
-					    ctx->previous_sample +
-					    ctx->num_logic_channels,
-					    analog_size))
-					continue;
-				memcpy(ctx->previous_sample, logic_sample,
-				       ctx->num_logic_channels);
-				memcpy(ctx->previous_sample
-				       + ctx->num_logic_channels,
-				       analog_sample, analog_size);
-			}
-
-			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
-			} else if (ctx->time) {
-				sample_time_dbl = ctx->out_sample_count++;
-				sample_time_dbl /= ctx->sample_rate;
-				sample_time_dbl *= ctx->sample_scale;
-				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
-			}
-
-			for (j = 0; j < num_channels; j++) {
-				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
-					ctx->channels[j].max =
-					    fmax(value, ctx->channels[j].max);
-					ctx->channels[j].min =
-					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
-				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
-				} else {
-					sr_warn("Unexpected channel type: %d",
-						ctx->channels[i].ch->type);
-				}
-			}
-
-			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
-				ctx->trigger = FALSE;
-			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
-		}
+		dump_rows(ctx, out);
 	}
 
 	/* Discard all of the working space. */
-	g_free(ctx->previous_sample);
 	g_free(ctx->analog_samples);
 	g_free(ctx->logic_samples);
 	ctx->channels_seen = 0;
 	ctx->num_samples = 0;
-	ctx->previous_sample = NULL;
 	ctx->analog_samples = NULL;
 	ctx->logic_samples = NULL;
 }
@@ -654,14 +792,13 @@ static void check_input_constraints(struct context *ctx)
 	sr_warn("Resulting CSV output data may be incomplete or incorrect.");
 }
 
-static int receive(const struct sr_output *o,
-		   const struct sr_datafeed_packet *packet, GString **out)
+static int receive_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -673,13 +810,12 @@ static int receive(const struct sr_output *o,
 		ctx->have_checked = FALSE;
 		ctx->have_frames = FALSE;
 		ctx->pkt_snums = FALSE;
-		*out = gen_header(o, packet->payload);
+		gen_header(o, packet->payload, out);
 		break;
 	case SR_DF_TRIGGER:
 		ctx->trigger = TRUE;
 		break;
 	case SR_DF_LOGIC:
-		*out = g_string_sized_new(512);
 		logic = packet->payload;
 		ctx->pkt_snums = logic->length;
 		ctx->pkt_snums /= logic->length;
@@ -687,7 +823,6 @@ static int receive(const struct sr_output *o,
 		process_logic(ctx, logic);
 		break;
 	case SR_DF_ANALOG:
-		*out = g_string_sized_new(512);
 		analog = packet->payload;
 		ctx->pkt_snums = analog->num_samples;
 		ctx->pkt_snums /= g_slist_length(analog->meaning->channels);
@@ -696,7 +831,7 @@ static int receive(const struct sr_output *o,
 		break;
 	case SR_DF_FRAME_BEGIN:
 		ctx->have_frames = TRUE;
-		*out = g_string_new(ctx->frame);
+		g_string_append(out, ctx->frame);
 		/* Fallthrough */
 	case SR_DF_END:
 		/* Got to end of frame/session with part of the data. */
@@ -728,7 +863,6 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->comment);
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
-		g_free(ctx->previous_sample);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -749,6 +883,7 @@ static struct sr_option options[] = {
 	{"time", "Time column", "Output sample time as column 1", NULL, NULL},
 	{"trigger", "Trigger column", "Output trigger indicator as last column ", NULL, NULL},
 	{"dedup", "Dedup rows", "Set to false to output duplicate rows", NULL, NULL},
+	{"threads", "Formatting threads", "Number of threads formatting the rows of large frames, 0 for one per CPU", NULL, NULL},
 	ALL_ZERO
 };
 
@@ -772,6 +907,7 @@ static const struct sr_option *get_options(void)
 		options[8].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[9].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[10].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[11].def = g_variant_ref_sink(g_variant_new_uint32(1));
 	}
 
 	return options;
@@ -785,6 +921,6 @@ SR_PRIV struct sr_output_module output_csv = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive_append,
 	.cleanup = cleanup,
 };
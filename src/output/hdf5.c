@@ -0,0 +1,508 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Write the datafeed to an HDF5 file. Each analog channel gets a one
+ * dimensional dataset "/analog/<channel>", which keeps the samples in
+ * the encoding the device delivered them in. The dataset's attributes
+ * tell how to turn them into values: scale and offset, the number of
+ * significant digits, and the unit. Logic data goes to "/logic", one
+ * element per sample.
+ *
+ * Datasets are chunked and extendible, samples get appended as they
+ * arrive without rewriting earlier data. Readers get quick access to
+ * arbitrary windows of long recordings, chunks are compressed
+ * individually.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <hdf5.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/hdf5"
+
+#define DEFAULT_CHUNK_SAMPLES (64 * 1024)
+#define DEFAULT_LEVEL 4
+
+struct dataset {
+	hid_t id;
+	/* The file's (and the memory's) datatype of the samples. */
+	hid_t type;
+	hsize_t size;
+	struct sr_analog_encoding encoding;
+};
+
+struct out_context {
+	hid_t file;
+	hid_t analog_group;
+	hsize_t chunk_samples;
+	gboolean compress;
+	gboolean shuffle;
+	unsigned int level;
+	uint64_t samplerate;
+	gint64 start_time;
+	/* Datasets of analog channels, by their struct sr_channel. */
+	GHashTable *analog;
+	struct dataset logic;
+};
+
+static void close_dataset(gpointer data)
+{
+	struct dataset *ds;
+
+	ds = data;
+	H5Dclose(ds->id);
+	g_free(ds);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	const char *compression;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("HDF5 output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+
+	outc = g_malloc0(sizeof(*outc));
+	outc->chunk_samples = g_variant_get_uint64(
+		g_hash_table_lookup(options, "chunk"));
+	compression = g_variant_get_string(
+		g_hash_table_lookup(options, "compression"), NULL);
+	outc->shuffle = g_variant_get_boolean(
+		g_hash_table_lookup(options, "shuffle"));
+	outc->level = g_variant_get_uint32(
+		g_hash_table_lookup(options, "level"));
+	if (!outc->chunk_samples) {
+		sr_err("The chunk size must not be zero.");
+		g_free(outc);
+		return SR_ERR_ARG;
+	}
+	if (!g_ascii_strcasecmp(compression, "deflate")) {
+		outc->compress = TRUE;
+	} else if (g_ascii_strcasecmp(compression, "none")) {
+		sr_err("Unsupported compression '%s'.", compression);
+		g_free(outc);
+		return SR_ERR_ARG;
+	}
+	if (outc->compress && H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+		sr_err("The HDF5 library lacks deflate compression.");
+		g_free(outc);
+		return SR_ERR_NA;
+	}
+	if (outc->level > 9) {
+		sr_err("Invalid compression level %u.", outc->level);
+		g_free(outc);
+		return SR_ERR_ARG;
+	}
+
+	outc->file = H5Fcreate(o->filename, H5F_ACC_TRUNC, H5P_DEFAULT,
+		H5P_DEFAULT);
+	if (outc->file < 0) {
+		sr_err("Cannot create %s.", o->filename);
+		g_free(outc);
+		return SR_ERR_IO;
+	}
+	outc->analog_group = -1;
+	outc->logic.id = -1;
+	outc->analog = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, close_dataset);
+	o->priv = outc;
+
+	return SR_OK;
+}
+
+static void set_attr(hid_t obj, const char *name, hid_t type,
+	const void *value)
+{
+	hid_t space, attr;
+
+	if (H5Aexists(obj, name) > 0)
+		H5Adelete(obj, name);
+	space = H5Screate(H5S_SCALAR);
+	attr = H5Acreate2(obj, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+	if (attr >= 0) {
+		H5Awrite(attr, type, value);
+		H5Aclose(attr);
+	}
+	H5Sclose(space);
+}
+
+static void set_attr_string(hid_t obj, const char *name, const char *value)
+{
+	hid_t type;
+
+	type = H5Tcopy(H5T_C_S1);
+	H5Tset_size(type, strlen(value) + 1);
+	set_attr(obj, name, type, value);
+	H5Tclose(type);
+}
+
+static void set_attr_rational(hid_t obj, const char *name,
+	const struct sr_rational *r)
+{
+	double value;
+
+	value = r->q ? (double)r->p / r->q : 0.0;
+	set_attr(obj, name, H5T_NATIVE_DOUBLE, &value);
+}
+
+/* The HDF5 datatype of samples in the given encoding. */
+static hid_t encoding_type(const struct sr_analog_encoding *enc)
+{
+	gboolean be;
+
+	be = enc->is_bigendian;
+	if (enc->is_float) {
+		if (enc->unitsize == sizeof(float))
+			return be ? H5T_IEEE_F32BE : H5T_IEEE_F32LE;
+		if (enc->unitsize == sizeof(double))
+			return be ? H5T_IEEE_F64BE : H5T_IEEE_F64LE;
+		return -1;
+	}
+
+	switch (enc->unitsize) {
+	case 1:
+		return enc->is_signed ? H5T_STD_I8LE : H5T_STD_U8LE;
+	case 2:
+		if (enc->is_signed)
+			return be ? H5T_STD_I16BE : H5T_STD_I16LE;
+		return be ? H5T_STD_U16BE : H5T_STD_U16LE;
+	case 4:
+		if (enc->is_signed)
+			return be ? H5T_STD_I32BE : H5T_STD_I32LE;
+		return be ? H5T_STD_U32BE : H5T_STD_U32LE;
+	case 8:
+		if (enc->is_signed)
+			return be ? H5T_STD_I64BE : H5T_STD_I64LE;
+		return be ? H5T_STD_U64BE : H5T_STD_U64LE;
+	}
+
+	return -1;
+}
+
+/* Create an empty dataset, which grows in chunks. */
+static hid_t create_dataset(struct out_context *outc, hid_t loc,
+	const char *name, hid_t type)
+{
+	hsize_t dims, max_dims, chunk;
+	hid_t space, props, ds;
+
+	dims = 0;
+	max_dims = H5S_UNLIMITED;
+	chunk = outc->chunk_samples;
+	space = H5Screate_simple(1, &dims, &max_dims);
+	props = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(props, 1, &chunk);
+	if (outc->compress) {
+		if (outc->shuffle && H5Tget_size(type) > 1)
+			H5Pset_shuffle(props);
+		H5Pset_deflate(props, outc->level);
+	}
+	ds = H5Dcreate2(loc, name, type, space, H5P_DEFAULT, props,
+		H5P_DEFAULT);
+	H5Pclose(props);
+	H5Sclose(space);
+	if (ds < 0)
+		sr_err("Cannot create the dataset %s.", name);
+
+	return ds;
+}
+
+/*
+ * Append samples to a dataset. The samples are every stride-th element
+ * of the memory buffer, which the memory dataspace selects, so that
+ * interleaved channels need no copying.
+ */
+static int append_samples(struct dataset *ds, const void *data,
+	hsize_t count, hsize_t stride, hsize_t first)
+{
+	hsize_t size, start, mem_size;
+	hid_t file_space, mem_space;
+	herr_t ret;
+
+	if (!count)
+		return SR_OK;
+
+	size = ds->size + count;
+	if (H5Dset_extent(ds->id, &size) < 0)
+		return SR_ERR_IO;
+	file_space = H5Dget_space(ds->id);
+	start = ds->size;
+	H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, NULL,
+		&count, NULL);
+	mem_size = count * stride;
+	mem_space = H5Screate_simple(1, &mem_size, NULL);
+	H5Sselect_hyperslab(mem_space, H5S_SELECT_SET, &first, &stride,
+		&count, NULL);
+	ret = H5Dwrite(ds->id, ds->type, mem_space, file_space, H5P_DEFAULT,
+		data);
+	H5Sclose(mem_space);
+	H5Sclose(file_space);
+	if (ret < 0)
+		return SR_ERR_IO;
+	ds->size = size;
+
+	return SR_OK;
+}
+
+static struct dataset *analog_dataset(struct out_context *outc,
+	const struct sr_channel *ch, const struct sr_datafeed_analog *analog)
+{
+	struct dataset *ds;
+	hid_t type;
+	char *name, *unit;
+	int digits;
+
+	ds = g_hash_table_lookup(outc->analog, ch);
+	if (ds) {
+		if (ds->encoding.unitsize != analog->encoding->unitsize ||
+				ds->encoding.is_float != analog->encoding->is_float ||
+				ds->encoding.is_signed != analog->encoding->is_signed ||
+				ds->encoding.is_bigendian != analog->encoding->is_bigendian) {
+			sr_err("The encoding of channel %s changed.", ch->name);
+			return NULL;
+		}
+		return ds;
+	}
+
+	type = encoding_type(analog->encoding);
+	if (type < 0) {
+		sr_err("Unsupported encoding of channel %s.", ch->name);
+		return NULL;
+	}
+	if (outc->analog_group < 0) {
+		outc->analog_group = H5Gcreate2(outc->file, "analog",
+			H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		if (outc->analog_group < 0)
+			return NULL;
+	}
+
+	/* Slashes would make for nested groups. */
+	name = g_strdup(ch->name);
+	g_strdelimit(name, "/", '_');
+	ds = g_malloc0(sizeof(*ds));
+	ds->id = create_dataset(outc, outc->analog_group, name, type);
+	g_free(name);
+	if (ds->id < 0) {
+		g_free(ds);
+		return NULL;
+	}
+	ds->type = type;
+	ds->encoding = *analog->encoding;
+	g_hash_table_insert(outc->analog, (gpointer)ch, ds);
+
+	set_attr_rational(ds->id, "scale", &analog->encoding->scale);
+	set_attr_rational(ds->id, "offset", &analog->encoding->offset);
+	digits = analog->encoding->digits;
+	set_attr(ds->id, "digits", H5T_NATIVE_INT, &digits);
+	if (sr_analog_unit_to_string(analog, &unit) == SR_OK) {
+		set_attr_string(ds->id, "unit", unit);
+		g_free(unit);
+	}
+
+	return ds;
+}
+
+static int receive_analog(struct out_context *outc,
+	const struct sr_datafeed_analog *analog)
+{
+	struct dataset *ds;
+	const GSList *l;
+	hsize_t num_channels, first;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	for (l = analog->meaning->channels, first = 0; l; l = l->next, first++) {
+		if (!(ds = analog_dataset(outc, l->data, analog)))
+			return SR_ERR_DATA;
+		ret = append_samples(ds, analog->data, analog->num_samples,
+			num_channels, first);
+		if (ret != SR_OK) {
+			sr_err("Cannot append to the dataset of channel %s.",
+				((const struct sr_channel *)l->data)->name);
+			return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int receive_logic(struct out_context *outc,
+	const struct sr_datafeed_logic *logic)
+{
+	hid_t type;
+
+	switch (logic->unitsize) {
+	case 1:
+		type = H5T_STD_U8LE;
+		break;
+	case 2:
+		type = H5T_STD_U16LE;
+		break;
+	case 4:
+		type = H5T_STD_U32LE;
+		break;
+	case 8:
+		type = H5T_STD_U64LE;
+		break;
+	default:
+		sr_err("Unsupported logic unit size %u.", logic->unitsize);
+		return SR_ERR_DATA;
+	}
+
+	if (outc->logic.id < 0) {
+		outc->logic.id = create_dataset(outc, outc->file, "logic", type);
+		if (outc->logic.id < 0)
+			return SR_ERR_IO;
+		outc->logic.type = type;
+	} else if (H5Tget_size(outc->logic.type) != logic->unitsize) {
+		sr_err("The logic unit size changed.");
+		return SR_ERR_DATA;
+	}
+
+	return append_samples(&outc->logic, logic->data,
+		logic->length / logic->unitsize, 1, 0);
+}
+
+/* Keep the acquisition's parameters with the file's root group. */
+static void write_file_attrs(struct out_context *outc)
+{
+	set_attr(outc->file, "samplerate", H5T_NATIVE_UINT64,
+		&outc->samplerate);
+	set_attr(outc->file, "start_time_us", H5T_NATIVE_INT64,
+		&outc->start_time);
+}
+
+static int receive(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GVariant *gvar;
+	GSList *l;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		outc->start_time = (gint64)header->starttime.tv_sec *
+			G_USEC_PER_SEC + header->starttime.tv_usec;
+		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			outc->samplerate = g_variant_get_uint64(gvar);
+			g_variant_unref(gvar);
+		}
+		write_file_attrs(outc);
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			outc->samplerate = g_variant_get_uint64(src->data);
+			write_file_attrs(outc);
+		}
+		break;
+	case SR_DF_LOGIC:
+		return receive_logic(outc, packet->payload);
+	case SR_DF_ANALOG:
+		return receive_analog(outc, packet->payload);
+	case SR_DF_END:
+		if (H5Fflush(outc->file, H5F_SCOPE_GLOBAL) < 0)
+			return SR_ERR_IO;
+		break;
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "chunk", "Chunk size", "Number of samples per dataset chunk", NULL, NULL },
+	{ "compression", "Compression", "Compression of chunks (deflate, none)", NULL, NULL },
+	{ "level", "Compression level", "Deflate compression level (0-9)", NULL, NULL },
+	{ "shuffle", "Shuffle", "Group the bytes of samples before compression, for better ratios", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(
+			g_variant_new_uint64(DEFAULT_CHUNK_SAMPLES));
+		options[1].def = g_variant_ref_sink(
+			g_variant_new_string("deflate"));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("deflate")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("none")));
+		options[2].def = g_variant_ref_sink(
+			g_variant_new_uint32(DEFAULT_LEVEL));
+		options[3].def = g_variant_ref_sink(
+			g_variant_new_boolean(TRUE));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+	int ret;
+
+	outc = o->priv;
+	if (!outc)
+		return SR_OK;
+
+	g_hash_table_destroy(outc->analog);
+	if (outc->logic.id >= 0)
+		H5Dclose(outc->logic.id);
+	if (outc->analog_group >= 0)
+		H5Gclose(outc->analog_group);
+	ret = H5Fclose(outc->file) < 0 ? SR_ERR_IO : SR_OK;
+	g_free(outc);
+	o->priv = NULL;
+
+	return ret;
+}
+
+SR_PRIV struct sr_output_module output_hdf5 = {
+	.id = "hdf5",
+	.name = "HDF5",
+	.desc = "HDF5 file with a chunked dataset per channel",
+	.exts = (const char *[]){"h5", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -41,14 +41,21 @@ struct context {
 	uint8_t *sample_buf;
 	gboolean header_done;
 	GString **lines;
+	struct sr_bitslice *slice;
+	/* Text for eight samples, indexed by their plane byte. */
+	char hex_text[256][3];
 };
 
+static const char hex_digits[] = "0123456789abcdef";
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
+	const struct sr_channel_layout *layout;
 	struct sr_channel *ch;
-	GSList *l;
-	unsigned int i, j;
+	unsigned int i, j, k;
+	size_t line_len;
+	uint8_t value;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -58,42 +65,48 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->trigger = -1;
 	ctx->spl = g_variant_get_uint32(g_hash_table_lookup(options, "width"));
 
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
-	}
+	layout = sr_dev_channel_layout(o->sdi);
+	ctx->num_enabled_channels = layout->num_logic;
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
 	ctx->sample_buf = g_malloc(ctx->num_enabled_channels);
 
-	j = 0;
-	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
+	/* Two digits and a separator per byte. */
+	line_len = 80;
+	if (ctx->spl > 0)
+		line_len = (ctx->spl + 7) / 8 * 3 + 1;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		ch = layout->logic[j];
 		ctx->channel_index[j] = ch->index;
 		ctx->channel_names[j] = ch->name;
-		ctx->lines[j] = g_string_sized_new(80);
+		ctx->lines[j] = g_string_sized_new(strlen(ch->name) + line_len);
 		ctx->sample_buf[j] = 0;
 		g_string_printf(ctx->lines[j], "%s:", ch->name);
-		j++;
+	}
+	ctx->slice = sr_bitslice_new(ctx->channel_index,
+		ctx->num_enabled_channels);
+
+	/* Planes are LSB first, the text shows the first sample as MSB. */
+	for (i = 0; i < 256; i++) {
+		value = 0;
+		for (k = 0; k < 8; k++) {
+			if (i & (1 << k))
+				value |= 0x80 >> k;
+		}
+		ctx->hex_text[i][0] = hex_digits[value >> 4];
+		ctx->hex_text[i][1] = hex_digits[value & 0x0f];
+		ctx->hex_text[i][2] = ' ';
 	}
 
 	return SR_OK;
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct context *ctx;
 	GVariant *gvar;
-	GString *header;
 	int num_channels;
 	char *samplerate_s;
 
@@ -106,8 +119,7 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
+	g_string_append_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
 	num_channels = g_slist_length(o->sdi->channels);
 	g_string_append_printf(header, "Acquisition with %d/%d channels",
 			ctx->num_enabled_channels, num_channels);
@@ -117,23 +129,80 @@ static GString *gen_header(const struct sr_output *o)
 		g_free(samplerate_s);
 	}
 	g_string_append_printf(header, "\n");
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	int offset;
 
-	return header;
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+	}
+	if (ctx->num_enabled_channels && ctx->trigger > -1) {
+		/*
+		 * Sample data lines have one character per nibble,
+		 * plus one separator per byte. Align trigger marker
+		 * to this layout.
+		 */
+		offset = ctx->trigger / 4 + ctx->trigger / 8;
+		g_string_append_printf(out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+		ctx->trigger = -1;
+	}
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+/* Append a channel's text for the samples following the line position. */
+static void append_hex(struct context *ctx, unsigned int ch,
+		const uint8_t *plane, size_t count)
+{
+	GString *line;
+	size_t k;
+	int pos;
+	uint8_t buf;
+
+	line = ctx->lines[ch];
+	buf = ctx->sample_buf[ch];
+	pos = ctx->spl_cnt;
+	k = 0;
+	while (k < count) {
+		if ((pos & 7) == 0 && count - k >= 8) {
+			/* A whole byte, which shifts out any buffered bits. */
+			g_string_append_len(line,
+				ctx->hex_text[sr_bitplane_get8(plane, k)], 3);
+			buf = 0;
+			k += 8;
+			pos += 8;
+			continue;
+		}
+		buf = (buf << 1) | sr_bitplane_bit(plane, k);
+		k++;
+		pos++;
+		if ((pos & 7) == 0) {
+			/* Buffered a byte's worth, output hex. */
+			g_string_append_c(line, hex_digits[buf >> 4]);
+			g_string_append_c(line, hex_digits[buf & 0x0f]);
+			g_string_append_c(line, ' ');
+			buf = 0;
+		}
+	}
+	ctx->sample_buf[ch] = buf;
+}
+
+static int receive_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, pos, offset;
-	uint64_t i, j;
-	gchar *p;
+	const uint8_t *data;
+	size_t num_samples, count;
+	uint64_t i;
+	unsigned int j;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -154,60 +223,46 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			ctx->header_done = TRUE;
-		} else
-			*out = g_string_sized_new(512);
+		}
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			pos = ctx->spl_cnt & 7;
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				ctx->sample_buf[j] <<= 1;
-				if (*p & (1 << (idx % 8)))
-					ctx->sample_buf[j] |= 1;
-				if (ctx->spl_cnt && pos == 0) {
-					/* Buffered a byte's worth, output hex. */
-					g_string_append_printf(ctx->lines[j], "%.2x ",
-							ctx->sample_buf[j]);
-					ctx->sample_buf[j] = 0;
-				}
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per nibble,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger / 4 + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+		if (!logic->unitsize)
+			break;
+		/*
+		 * Slice blocks of samples into per-channel bit planes, which
+		 * end at line boundaries. Aligned bytes of eight samples then
+		 * get their text by table lookup.
+		 */
+		data = logic->data;
+		num_samples = logic->length / logic->unitsize;
+		while (num_samples) {
+			count = num_samples;
+			if (ctx->spl > 0)
+				count = MIN(count, (size_t)(ctx->spl - ctx->spl_cnt));
+			count = sr_bitslice_load(ctx->slice, data,
+				logic->unitsize, count);
+			for (j = 0; j < ctx->num_enabled_channels; j++)
+				append_hex(ctx, j, sr_bitslice_plane(ctx->slice, j), count);
+			ctx->spl_cnt += count;
+			if (ctx->spl_cnt == ctx->spl) {
+				flush_lines(ctx, out);
 				ctx->spl_cnt = 0;
+			}
+			data += count * logic->unitsize;
+			num_samples -= count;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
 				if (ctx->spl_cnt & 7)
 					g_string_append_printf(ctx->lines[i], "%.2x ",
 							ctx->sample_buf[i] << (8 - (ctx->spl_cnt & 7)));
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
 		}
 		break;
@@ -233,6 +288,7 @@ static int cleanup(struct sr_output *o)
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
+	sr_bitslice_free(ctx->slice);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -262,6 +318,6 @@ SR_PRIV struct sr_output_module output_hex = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive_append,
 	.cleanup = cleanup,
 };
@@ -0,0 +1,617 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stream the datafeed over TCP, to the net-remote driver of another
+ * sigrok instance. The module listens for connections, every client
+ * receives a description of the channels, then all frames from the time
+ * it connected. Frames are batched, and optionally compressed, see
+ * net_stream.c for the format. Clients get picked up when packets flow.
+ * Client sockets don't block the session. What a client does not take
+ * right away gets queued for it, and a client which falls too far behind
+ * gets disconnected.
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#include <errno.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/net"
+
+#define DEFAULT_PORT 33400
+#define DEFAULT_BATCH_KIB 64
+
+/* Most data which gets queued for a client before it is disconnected. */
+#define CLIENT_BACKLOG_MAX (16 * 1024 * 1024)
+/* How long clients get to take the rest of the stream at the end. */
+#define DRAIN_TIMEOUT_MS 1000
+
+/* Don't get killed by SIGPIPE when a client has disconnected. */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#ifdef SO_NOSIGPIPE
+#define USE_SO_NOSIGPIPE
+#endif
+#endif
+
+struct net_client {
+	int fd;
+	/* Data which the socket did not take yet, starts at offset. */
+	GString *pending;
+	size_t offset;
+};
+
+struct out_context {
+	int listen_fd;
+	/* The connected clients. */
+	GSList *clients;
+	uint32_t num_logic;
+	uint32_t num_analog;
+	uint64_t samplerate;
+	/* The NUL terminated channel names, for the hello frame. */
+	GString *names;
+	/* Channel indices of the streamed analog channels. */
+	gint *analog_index_map;
+	GString *frames;
+	GString *batch;
+	size_t batch_size;
+	int level;
+	float *values;
+	size_t values_size;
+};
+
+static int listen_on(const char *address, uint32_t port)
+{
+	struct addrinfo hints, *results, *res;
+	char service[16];
+	int fd, on, err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+	snprintf(service, sizeof(service), "%" PRIu32, port);
+
+	err = getaddrinfo(*address ? address : NULL, service, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", address, service,
+			gai_strerror(err));
+		return -1;
+	}
+
+	fd = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((fd = socket(res->ai_family, res->ai_socktype,
+				res->ai_protocol)) < 0)
+			continue;
+		on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+			(const char *)&on, sizeof(on));
+		if (bind(fd, res->ai_addr, res->ai_addrlen) == 0 &&
+				listen(fd, 4) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(results);
+
+	if (fd < 0)
+		sr_err("Cannot listen on port %s: %s", service, g_strerror(errno));
+
+	return fd;
+}
+
+static void socket_prepare(int fd)
+{
+#ifdef _WIN32
+	u_long mode;
+
+	mode = 1;
+	ioctlsocket(fd, FIONBIO, &mode);
+#else
+	int flags;
+
+	flags = fcntl(fd, F_GETFL, 0);
+	if (flags >= 0)
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#ifdef USE_SO_NOSIGPIPE
+	flags = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &flags, sizeof(flags));
+#endif
+#endif
+}
+
+static void client_free(struct net_client *client)
+{
+	close(client->fd);
+	g_string_free(client->pending, TRUE);
+	g_free(client);
+}
+
+/*
+ * Send what the socket takes without blocking. Returns the number of
+ * bytes sent, or -1 when the client is gone.
+ */
+static ssize_t send_some(int fd, const char *data, size_t len)
+{
+	ssize_t sent;
+	size_t done;
+
+	done = 0;
+	while (done < len) {
+		sent = send(fd, data + done, len - done, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (sent <= 0)
+			return -1;
+		done += sent;
+	}
+
+	return done;
+}
+
+/* Send queued data first, then queue what the socket did not take. */
+static int client_send(struct net_client *client, const char *data, size_t len)
+{
+	ssize_t sent;
+
+	if (client->pending->len > client->offset) {
+		sent = send_some(client->fd, client->pending->str + client->offset,
+			client->pending->len - client->offset);
+		if (sent < 0)
+			return SR_ERR_IO;
+		client->offset += sent;
+	}
+	if (client->offset == client->pending->len) {
+		g_string_truncate(client->pending, 0);
+		client->offset = 0;
+		sent = len ? send_some(client->fd, data, len) : 0;
+		if (sent < 0)
+			return SR_ERR_IO;
+		data += sent;
+		len -= sent;
+	}
+	if (!len)
+		return SR_OK;
+
+	if (client->pending->len - client->offset + len > CLIENT_BACKLOG_MAX) {
+		sr_warn("Client falls behind, disconnecting.");
+		return SR_ERR_IO;
+	}
+	if (client->offset > client->pending->len / 2) {
+		g_string_erase(client->pending, 0, client->offset);
+		client->offset = 0;
+	}
+	g_string_append_len(client->pending, data, len);
+
+	return SR_OK;
+}
+
+static void send_clients(struct out_context *outc, const GString *buf)
+{
+	GSList *l, *next;
+	struct net_client *client;
+
+	for (l = outc->clients; l; l = next) {
+		next = l->next;
+		client = l->data;
+		if (client_send(client, buf->str, buf->len) == SR_OK)
+			continue;
+		sr_info("Client disconnected.");
+		client_free(client);
+		outc->clients = g_slist_delete_link(outc->clients, l);
+	}
+}
+
+/* Give a client a moment to take the data which is still queued. */
+static void drain_client(struct net_client *client)
+{
+	struct timeval tv;
+	fd_set fds;
+	gint64 deadline, remaining;
+
+	deadline = g_get_monotonic_time() + DRAIN_TIMEOUT_MS * 1000;
+	while (client->pending->len > client->offset) {
+		remaining = deadline - g_get_monotonic_time();
+		if (remaining <= 0)
+			break;
+		FD_ZERO(&fds);
+		FD_SET(client->fd, &fds);
+		tv.tv_sec = remaining / G_USEC_PER_SEC;
+		tv.tv_usec = remaining % G_USEC_PER_SEC;
+		if (select(client->fd + 1, NULL, &fds, NULL, &tv) <= 0)
+			break;
+		if (client_send(client, NULL, 0) != SR_OK)
+			break;
+	}
+}
+
+static void send_hello(struct out_context *outc, int fd)
+{
+	struct net_client *client;
+	GString *hello;
+	uint8_t fixed[SR_NET_HELLO_FIXED];
+
+	memset(fixed, 0, sizeof(fixed));
+	memcpy(&fixed[0], SR_NET_MAGIC, 8);
+	WL32(&fixed[8], SR_NET_VERSION);
+	WL32(&fixed[12], outc->num_logic);
+	WL32(&fixed[16], outc->num_analog);
+	WL64(&fixed[24], outc->samplerate);
+
+	hello = g_string_sized_new(SR_NET_FRAME_HEADER + sizeof(fixed) +
+		outc->names->len);
+	sr_net_frame_header(hello, SR_NET_HELLO, sizeof(fixed) + outc->names->len);
+	g_string_append_len(hello, (const gchar *)fixed, sizeof(fixed));
+	g_string_append_len(hello, outc->names->str, outc->names->len);
+	client = g_malloc0(sizeof(*client));
+	client->fd = fd;
+	client->pending = g_string_new(NULL);
+	if (client_send(client, hello->str, hello->len) == SR_OK) {
+		outc->clients = g_slist_append(outc->clients, client);
+		sr_info("Client connected.");
+	} else {
+		client_free(client);
+	}
+	g_string_free(hello, TRUE);
+}
+
+static void accept_clients(struct out_context *outc)
+{
+	struct timeval tv;
+	fd_set fds;
+	int fd;
+
+	while (TRUE) {
+		FD_ZERO(&fds);
+		FD_SET(outc->listen_fd, &fds);
+		tv.tv_sec = tv.tv_usec = 0;
+		if (select(outc->listen_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+			break;
+		if ((fd = accept(outc->listen_fd, NULL, NULL)) < 0)
+			break;
+		socket_prepare(fd);
+		send_hello(outc, fd);
+	}
+}
+
+static void flush(struct out_context *outc)
+{
+	if (!outc->frames->len)
+		return;
+
+	accept_clients(outc);
+	if (outc->clients) {
+		g_string_truncate(outc->batch, 0);
+		if (sr_net_batch_pack(outc->batch, (const uint8_t *)outc->frames->str,
+				outc->frames->len, outc->level) == SR_OK)
+			send_clients(outc, outc->batch);
+		else
+			send_clients(outc, outc->frames);
+	}
+	g_string_truncate(outc->frames, 0);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	struct sr_channel *ch;
+	const char *address;
+	GVariant *gvar;
+	GSList *l;
+	uint32_t port, batch, level;
+	int fd;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	address = g_variant_get_string(g_hash_table_lookup(options, "address"), NULL);
+	port = g_variant_get_uint32(g_hash_table_lookup(options, "port"));
+	batch = g_variant_get_uint32(g_hash_table_lookup(options, "batch"));
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "compression"));
+	if (!port || port > 65535 || !batch || batch > 16 * 1024 || level > 9) {
+		sr_err("Invalid port, batch size or compression level.");
+		return SR_ERR_ARG;
+	}
+	if (level && !sr_net_batch_compression()) {
+		sr_err("Compression needs zlib support.");
+		return SR_ERR_NA;
+	}
+
+	if ((fd = listen_on(address, port)) < 0)
+		return SR_ERR_IO;
+
+	outc = g_malloc0(sizeof(*outc));
+	outc->listen_fd = fd;
+	outc->batch_size = batch * 1024;
+	outc->level = level;
+	outc->frames = g_string_sized_new(outc->batch_size + 64 * 1024);
+	outc->batch = g_string_new(NULL);
+	o->priv = outc;
+
+	/* Logic channels keep their bit positions, analog ones are sent when enabled. */
+	outc->names = g_string_new(NULL);
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		g_string_append_len(outc->names, ch->name, strlen(ch->name) + 1);
+		outc->num_logic++;
+	}
+	outc->analog_index_map = g_malloc0_n(
+		g_slist_length(o->sdi->channels) + 1, sizeof(gint));
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG || !ch->enabled)
+			continue;
+		g_string_append_len(outc->names, ch->name, strlen(ch->name) + 1);
+		outc->analog_index_map[outc->num_analog++] = ch->index;
+	}
+	if (sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		outc->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	sr_info("Streaming the datafeed on port %" PRIu32 ".", port);
+
+	return SR_OK;
+}
+
+static void put_empty(struct out_context *outc, uint32_t type)
+{
+	sr_net_frame_header(outc->frames, type, 0);
+}
+
+static void put_samplerate(struct out_context *outc, uint64_t samplerate)
+{
+	uint8_t buf[sizeof(uint64_t)];
+
+	outc->samplerate = samplerate;
+	WL64(buf, samplerate);
+	sr_net_frame_header(outc->frames, SR_NET_SAMPLERATE, sizeof(buf));
+	g_string_append_len(outc->frames, (const gchar *)buf, sizeof(buf));
+}
+
+static int put_logic(struct out_context *outc,
+		const struct sr_datafeed_logic *logic)
+{
+	uint8_t hdr[SR_NET_LOGIC_HEADER];
+	const gchar *data;
+	uint64_t length;
+	size_t max_chunk, chunk;
+
+	if (!logic->unitsize)
+		return SR_ERR_ARG;
+
+	/* Frames hold whole samples, and stay below the batch size. */
+	max_chunk = MAX(outc->batch_size, logic->unitsize);
+	max_chunk -= max_chunk % logic->unitsize;
+	WL32(hdr, logic->unitsize);
+	data = logic->data;
+	length = logic->length;
+	while (length) {
+		chunk = MIN(length, max_chunk);
+		sr_net_frame_header(outc->frames, SR_NET_LOGIC, sizeof(hdr) + chunk);
+		g_string_append_len(outc->frames, (const gchar *)hdr, sizeof(hdr));
+		g_string_append_len(outc->frames, data, chunk);
+		data += chunk;
+		length -= chunk;
+		if (outc->frames->len >= outc->batch_size)
+			flush(outc);
+	}
+
+	return SR_OK;
+}
+
+static int put_analog(struct out_context *outc,
+		const struct sr_datafeed_analog *analog)
+{
+	uint8_t hdr[SR_NET_ANALOG_HEADER], *dest;
+	const struct sr_channel *ch;
+	size_t num_channels, max_samples, count, offset, pos, i, j;
+	uint32_t channel;
+	GSList *l;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	count = analog->num_samples * num_channels;
+	if (outc->values_size < count) {
+		g_free(outc->values);
+		outc->values = g_try_malloc(count * sizeof(float));
+		outc->values_size = outc->values ? count : 0;
+		if (!outc->values)
+			return SR_ERR_MALLOC;
+	}
+	if ((ret = sr_analog_to_float(analog, outc->values)) != SR_OK)
+		return ret;
+
+	max_samples = MAX(outc->batch_size / sizeof(float), 1);
+	for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+		ch = l->data;
+		for (channel = 0; channel < outc->num_analog; channel++) {
+			if (outc->analog_index_map[channel] == ch->index)
+				break;
+		}
+		if (channel == outc->num_analog)
+			continue;
+
+		for (offset = 0; offset < analog->num_samples; offset += count) {
+			count = MIN(analog->num_samples - offset, max_samples);
+			memset(hdr, 0, sizeof(hdr));
+			WL32(&hdr[0], channel);
+			WL32(&hdr[4], count);
+			WL32(&hdr[8], analog->meaning->mq);
+			WL32(&hdr[12], analog->meaning->unit);
+			WL64(&hdr[16], analog->meaning->mqflags);
+			WL32(&hdr[24], analog->encoding->digits);
+			sr_net_frame_header(outc->frames, SR_NET_ANALOG,
+				sizeof(hdr) + count * sizeof(float));
+			g_string_append_len(outc->frames, (const gchar *)hdr,
+				sizeof(hdr));
+			pos = outc->frames->len;
+			g_string_set_size(outc->frames, pos + count * sizeof(float));
+			dest = (uint8_t *)&outc->frames->str[pos];
+			for (i = 0; i < count; i++) {
+				write_fltle(dest + i * sizeof(float),
+					outc->values[(offset + i) * num_channels + j]);
+			}
+			if (outc->frames->len >= outc->batch_size)
+				flush(outc);
+		}
+	}
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GVariant *gvar;
+	GSList *l;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	/* Data gets batched, everything else is sent right away. */
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		put_empty(outc, SR_NET_HEADER);
+		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			put_samplerate(outc, g_variant_get_uint64(gvar));
+			g_variant_unref(gvar);
+		}
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				put_samplerate(outc, g_variant_get_uint64(src->data));
+		}
+		break;
+	case SR_DF_LOGIC:
+		return put_logic(outc, packet->payload);
+	case SR_DF_ANALOG:
+		return put_analog(outc, packet->payload);
+	case SR_DF_TRIGGER:
+		put_empty(outc, SR_NET_TRIGGER);
+		break;
+	case SR_DF_FRAME_BEGIN:
+		put_empty(outc, SR_NET_FRAME_BEGIN);
+		break;
+	case SR_DF_FRAME_END:
+		put_empty(outc, SR_NET_FRAME_END);
+		break;
+	case SR_DF_END:
+		put_empty(outc, SR_NET_END);
+		break;
+	default:
+		return SR_OK;
+	}
+	flush(outc);
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "address", "Address", "Local address to listen on, empty for all", NULL, NULL },
+	{ "port", "Port", "TCP port to listen on", NULL, NULL },
+	{ "batch", "Batch size", "Size of the batches sent to clients, in KiB", NULL, NULL },
+	{ "compression", "Compression", "Compression level of the batches, 0 to 9", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_PORT));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_BATCH_KIB));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+	GSList *l;
+
+	outc = o->priv;
+	if (!outc)
+		return SR_OK;
+
+	flush(outc);
+	for (l = outc->clients; l; l = l->next) {
+		drain_client(l->data);
+		client_free(l->data);
+	}
+	g_slist_free(outc->clients);
+	close(outc->listen_fd);
+	g_string_free(outc->names, TRUE);
+	g_string_free(outc->frames, TRUE);
+	g_string_free(outc->batch, TRUE);
+	g_free(outc->analog_index_map);
+	g_free(outc->values);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_net = {
+	.id = "net",
+	.name = "Network stream",
+	.desc = "Datafeed for the net-remote driver, over TCP",
+	.exts = NULL,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
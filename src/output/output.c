@@ -18,7 +18,9 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -62,10 +64,19 @@ extern SR_PRIV struct sr_output_module output_ols;
 extern SR_PRIV struct sr_output_module output_chronovu_la8;
 extern SR_PRIV struct sr_output_module output_csv;
 extern SR_PRIV struct sr_output_module output_analog;
+extern SR_PRIV struct sr_output_module output_arrow;
 extern SR_PRIV struct sr_output_module output_srzip;
+extern SR_PRIV struct sr_output_module output_srcap;
 extern SR_PRIV struct sr_output_module output_wav;
 extern SR_PRIV struct sr_output_module output_wavedrom;
+extern SR_PRIV struct sr_output_module output_net;
 extern SR_PRIV struct sr_output_module output_null;
+#if defined HAVE_SHM_RING && HAVE_SHM_RING
+extern SR_PRIV struct sr_output_module output_shm;
+#endif
+#ifdef HAVE_LIBHDF5
+extern SR_PRIV struct sr_output_module output_hdf5;
+#endif
 /** @endcond */
 
 static const struct sr_output_module *output_module_list[] = {
@@ -78,10 +89,19 @@ static const struct sr_output_module *output_module_list[] = {
 	&output_vcd,
 	&output_chronovu_la8,
 	&output_analog,
+	&output_arrow,
 	&output_srzip,
+	&output_srcap,
 	&output_wav,
 	&output_wavedrom,
+	&output_net,
 	&output_null,
+#if defined HAVE_SHM_RING && HAVE_SHM_RING
+	&output_shm,
+#endif
+#ifdef HAVE_LIBHDF5
+	&output_hdf5,
+#endif
 	NULL,
 };
 
@@ -325,18 +345,211 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/* Have the module append a packet's output, whichever callback it has. */
+static int receive_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	GString *chunk_out;
+	int ret;
+
+	SR_PROBE3(output__entry, o->module->id, packet->type,
+		sr_packet_payload_bytes(packet));
+	if (o->module->receive_append) {
+		ret = o->module->receive_append(o, packet, out);
+		SR_PROBE2(output__return, o->module->id, ret);
+		return ret;
+	}
+
+	chunk_out = NULL;
+	ret = o->module->receive(o, packet, &chunk_out);
+	SR_PROBE2(output__return, o->module->id, ret);
+	if (chunk_out) {
+		g_string_append_len(out, chunk_out->str, chunk_out->len);
+		g_string_free(chunk_out, TRUE);
+	}
+
+	return ret;
+}
+
+struct expanded_output {
+	const struct sr_output *o;
+	GString *out;
+};
+
+static int send_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	struct expanded_output *exp;
+
+	exp = cb_data;
+
+	return receive_append(exp->o, packet, exp->out);
+}
+
+/* Whether a module takes a packet as it is, rather than expanded. */
+static gboolean takes_packet(const struct sr_output_module *omod,
+		const struct sr_datafeed_packet *packet)
+{
+	if (packet->type == SR_DF_LOGIC_RLE)
+		return sr_output_test_flag(omod, SR_OUTPUT_LOGIC_RLE);
+	if (packet->type == SR_DF_LOGIC_PLANAR)
+		return sr_output_test_flag(omod, SR_OUTPUT_LOGIC_PLANAR);
+
+	return TRUE;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE and SR_DF_LOGIC_PLANAR packets get expanded for output
+ * modules which do not have the SR_OUTPUT_LOGIC_RLE or
+ * SR_OUTPUT_LOGIC_PLANAR flag respectively.
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	int ret;
+
+	if (o->module->receive && takes_packet(o->module, packet)) {
+		SR_PROBE3(output__entry, o->module->id, packet->type,
+			sr_packet_payload_bytes(packet));
+		ret = o->module->receive(o, packet, out);
+		SR_PROBE2(output__return, o->module->id, ret);
+		return ret;
+	}
+
+	*out = g_string_sized_new(512);
+	ret = sr_output_send_append(o, packet, *out);
+	if (!(*out)->len) {
+		g_string_free(*out, TRUE);
+		*out = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Send a packet to the specified output instance, appending the output
+ * to a caller provided text buffer.
+ *
+ * Unlike sr_output_send() this does not allocate a new GString per
+ * packet. Callers can reuse the same buffer, truncating it after they
+ * have consumed its content.
+ *
+ * SR_DF_LOGIC_RLE and SR_DF_LOGIC_PLANAR packets get expanded for output
+ * modules which do not have the SR_OUTPUT_LOGIC_RLE or
+ * SR_OUTPUT_LOGIC_PLANAR flag respectively.
+ *
+ * @param o The output instance.
+ * @param packet The packet to send.
+ * @param out The text buffer to append the output to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Negative error code from the output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	struct expanded_output exp;
+
+	if (!o || !packet || !out)
+		return SR_ERR_ARG;
+
+	if (!takes_packet(o->module, packet)) {
+		exp.o = o;
+		exp.out = out;
+		if (packet->type == SR_DF_LOGIC_RLE)
+			return sr_logic_rle_foreach_chunk(packet,
+				send_expanded, &exp);
+		return sr_logic_planar_foreach_chunk(packet,
+			send_expanded, &exp);
+	}
+
+	return receive_append(o, packet, out);
+}
+
+static int write_all(int fd, const uint8_t *data, size_t left)
+{
+	ssize_t written;
+
+	while (left) {
+		written = write(fd, data, left);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written < 0) {
+			sr_err("Cannot write output: %s.", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		data += written;
+		left -= written;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send a packet to the specified output instance, and write the output
+ * to a file descriptor.
+ *
+ * The output gets assembled in a text buffer which the instance keeps
+ * across calls, so there is no allocation per packet. Modules which
+ * pass payloads through unmodified get them written straight from the
+ * packet, without any copy.
+ *
+ * @param o The output instance.
+ * @param packet The packet to send.
+ * @param fd The file descriptor to write the output to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Writing to the file descriptor failed.
+ * @retval other Negative error code from the output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_fd(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, int fd)
+{
+	struct sr_output *op;
+	const uint8_t *data;
+	size_t length;
+	int ret;
+
+	if (!o || !packet || fd < 0)
+		return SR_ERR_ARG;
+
+	if (o->module->receive_direct && packet->type != SR_DF_LOGIC_RLE &&
+			packet->type != SR_DF_LOGIC_PLANAR) {
+		data = NULL;
+		length = 0;
+		SR_PROBE3(output__entry, o->module->id, packet->type,
+			sr_packet_payload_bytes(packet));
+		ret = o->module->receive_direct(o, packet, &data, &length);
+		SR_PROBE2(output__return, o->module->id, ret);
+		if (ret != SR_OK || !data)
+			return ret;
+		return write_all(fd, data, length);
+	}
+
+	op = (struct sr_output *)o;
+	if (!op->sink_buf)
+		op->sink_buf = g_string_sized_new(4096);
+	g_string_truncate(op->sink_buf, 0);
+
+	ret = sr_output_send_append(o, packet, op->sink_buf);
+	if (op->sink_buf->len && write_all(fd, (const uint8_t *)op->sink_buf->str,
+			op->sink_buf->len) != SR_OK)
+		return SR_ERR_IO;
+
+	return ret;
 }
 
 /**
@@ -354,6 +567,8 @@ SR_API int sr_output_free(const struct sr_output *o)
 	ret = SR_OK;
 	if (o->module->cleanup)
 		ret = o->module->cleanup((struct sr_output *)o);
+	if (o->sink_buf)
+		g_string_free(o->sink_buf, TRUE);
 	g_free((char *)o->filename);
 	g_free((gpointer)o);
 
@@ -0,0 +1,342 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Publish the datafeed into a shared memory ring (see shm_ring.c), where
+ * other processes pick it up with the shm-reader driver. Nothing gets
+ * written to the output file.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/shm"
+
+#define DEFAULT_NAME "sigrok"
+#define DEFAULT_SIZE_MIB 64
+#define DEFAULT_TIMEOUT_MS 1000
+
+struct out_context {
+	struct sr_shm_ring *ring;
+	int timeout_ms;
+	/* Channel indices of the published analog channels. */
+	gint *analog_index_map;
+	uint32_t num_analog;
+	float *values;
+	size_t values_size;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	struct sr_shm_ring_info *info;
+	struct sr_channel *ch;
+	const char *name;
+	uint64_t size;
+	GVariant *gvar;
+	GSList *l;
+	uint32_t num_logic, num_analog;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	name = g_variant_get_string(g_hash_table_lookup(options, "name"), NULL);
+	size = g_variant_get_uint64(g_hash_table_lookup(options, "size"));
+	if (!size || size > SR_SHM_RING_MAX_SIZE / (1024 * 1024)) {
+		sr_err("Invalid ring size %" PRIu64 " MiB.", size);
+		return SR_ERR_ARG;
+	}
+
+	num_logic = num_analog = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			num_logic++;
+		else if (ch->type == SR_CHANNEL_ANALOG && ch->enabled)
+			num_analog++;
+	}
+	if (num_logic + num_analog > SR_SHM_RING_CHANNELS) {
+		sr_err("Cannot publish more than %d channels.",
+			SR_SHM_RING_CHANNELS);
+		return SR_ERR_ARG;
+	}
+
+	outc = g_malloc0(sizeof(*outc));
+	outc->timeout_ms = g_variant_get_uint32(
+		g_hash_table_lookup(options, "timeout"));
+	outc->ring = sr_shm_ring_create(name, size * 1024 * 1024);
+	if (!outc->ring) {
+		g_free(outc);
+		return SR_ERR_IO;
+	}
+	o->priv = outc;
+
+	/*
+	 * All logic channels are kept, so that their bit positions match
+	 * their channel indices. Analog channels get published when enabled.
+	 */
+	info = outc->ring->info;
+	info->num_logic = num_logic;
+	info->num_analog = num_analog;
+	outc->num_analog = num_analog;
+	outc->analog_index_map = g_malloc0_n(num_analog + 1, sizeof(gint));
+	num_logic = num_analog = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			g_strlcpy(info->names[num_logic++], ch->name,
+				SR_SHM_RING_NAME_LEN);
+		} else if (ch->type == SR_CHANNEL_ANALOG && ch->enabled) {
+			g_strlcpy(info->names[info->num_logic + num_analog],
+				ch->name, SR_SHM_RING_NAME_LEN);
+			outc->analog_index_map[num_analog++] = ch->index;
+		}
+	}
+	if (sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		info->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	sr_shm_ring_publish(outc->ring);
+	sr_info("Publishing the datafeed in shared memory %s.",
+		outc->ring->name);
+
+	return SR_OK;
+}
+
+static int put_record(struct out_context *outc, uint32_t type,
+		const void *data, size_t size)
+{
+	void *payload;
+
+	payload = sr_shm_ring_reserve(outc->ring, type, size, outc->timeout_ms);
+	if (!payload)
+		return SR_ERR_ARG;
+	if (size)
+		memcpy(payload, data, size);
+	sr_shm_ring_commit(outc->ring);
+
+	return SR_OK;
+}
+
+static int put_samplerate(struct out_context *outc, uint64_t samplerate)
+{
+	outc->ring->info->samplerate = samplerate;
+
+	return put_record(outc, SR_SHM_REC_SAMPLERATE,
+		&samplerate, sizeof(samplerate));
+}
+
+static int put_logic(struct out_context *outc,
+		const struct sr_datafeed_logic *logic)
+{
+	struct sr_shm_rec_logic *rec;
+	size_t max_chunk, chunk;
+	const uint8_t *data;
+	uint64_t length;
+
+	if (!logic->unitsize)
+		return SR_ERR_ARG;
+
+	/* Large packets get split, into whole samples. */
+	max_chunk = sr_shm_ring_max_payload(outc->ring) - sizeof(*rec);
+	max_chunk -= max_chunk % logic->unitsize;
+	data = logic->data;
+	length = logic->length;
+	while (length) {
+		chunk = MIN(length, max_chunk);
+		rec = sr_shm_ring_reserve(outc->ring, SR_SHM_REC_LOGIC,
+			sizeof(*rec) + chunk, outc->timeout_ms);
+		if (!rec)
+			return SR_ERR_ARG;
+		rec->unitsize = logic->unitsize;
+		rec->reserved = 0;
+		memcpy(rec + 1, data, chunk);
+		sr_shm_ring_commit(outc->ring);
+		data += chunk;
+		length -= chunk;
+	}
+
+	return SR_OK;
+}
+
+static int put_analog(struct out_context *outc,
+		const struct sr_datafeed_analog *analog)
+{
+	struct sr_shm_rec_analog *rec;
+	const struct sr_channel *ch;
+	size_t num_channels, max_samples, count, offset, i, j;
+	float *dest;
+	uint32_t channel;
+	GSList *l;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	/* Convert once, the values of several channels are interleaved. */
+	count = analog->num_samples * num_channels;
+	if (outc->values_size < count) {
+		g_free(outc->values);
+		outc->values = g_try_malloc(count * sizeof(float));
+		outc->values_size = outc->values ? count : 0;
+		if (!outc->values)
+			return SR_ERR_MALLOC;
+	}
+	if ((ret = sr_analog_to_float(analog, outc->values)) != SR_OK)
+		return ret;
+
+	max_samples = (sr_shm_ring_max_payload(outc->ring) - sizeof(*rec)) /
+		sizeof(float);
+	for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+		ch = l->data;
+		for (channel = 0; channel < outc->num_analog; channel++) {
+			if (outc->analog_index_map[channel] == ch->index)
+				break;
+		}
+		if (channel == outc->num_analog)
+			continue;
+
+		for (offset = 0; offset < analog->num_samples; offset += count) {
+			count = MIN(analog->num_samples - offset, max_samples);
+			rec = sr_shm_ring_reserve(outc->ring, SR_SHM_REC_ANALOG,
+				sizeof(*rec) + count * sizeof(float),
+				outc->timeout_ms);
+			if (!rec)
+				return SR_ERR_ARG;
+			rec->channel = channel;
+			rec->num_samples = count;
+			rec->mq = analog->meaning->mq;
+			rec->unit = analog->meaning->unit;
+			rec->mqflags = analog->meaning->mqflags;
+			rec->digits = analog->encoding->digits;
+			rec->reserved = 0;
+			dest = (float *)(rec + 1);
+			for (i = 0; i < count; i++)
+				dest[i] = outc->values[(offset + i) *
+					num_channels + j];
+			sr_shm_ring_commit(outc->ring);
+		}
+	}
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GVariant *gvar;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		if ((ret = put_record(outc, SR_SHM_REC_HEADER, NULL, 0)) != SR_OK)
+			return ret;
+		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			ret = put_samplerate(outc, g_variant_get_uint64(gvar));
+			g_variant_unref(gvar);
+		}
+		return ret;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			ret = put_samplerate(outc, g_variant_get_uint64(src->data));
+			if (ret != SR_OK)
+				return ret;
+		}
+		break;
+	case SR_DF_LOGIC:
+		return put_logic(outc, packet->payload);
+	case SR_DF_ANALOG:
+		return put_analog(outc, packet->payload);
+	case SR_DF_TRIGGER:
+		return put_record(outc, SR_SHM_REC_TRIGGER, NULL, 0);
+	case SR_DF_FRAME_BEGIN:
+		return put_record(outc, SR_SHM_REC_FRAME_BEGIN, NULL, 0);
+	case SR_DF_FRAME_END:
+		return put_record(outc, SR_SHM_REC_FRAME_END, NULL, 0);
+	case SR_DF_END:
+		return put_record(outc, SR_SHM_REC_END, NULL, 0);
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "name", "Name", "Name of the shared memory ring", NULL, NULL },
+	{ "size", "Size", "Size of the ring in MiB", NULL, NULL },
+	{ "timeout", "Timeout", "Milliseconds to wait for slow readers before detaching them", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(DEFAULT_NAME));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_SIZE_MIB));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_TIMEOUT_MS));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+
+	outc = o->priv;
+	if (!outc)
+		return SR_OK;
+
+	sr_shm_ring_close(outc->ring);
+	g_free(outc->analog_index_map);
+	g_free(outc->values);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_shm = {
+	.id = "shm",
+	.name = "Shared memory",
+	.desc = "Datafeed for other processes, in a shared memory ring",
+	.exts = NULL,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
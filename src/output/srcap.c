@@ -0,0 +1,467 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Write uncompressed, memory mappable capture files. See capture_file.c
+ * for the file layout. Samples of each channel group are collected into
+ * extents of up to CHUNK_SIZE bytes. The index and the final header are
+ * written when the acquisition ends.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/srcap"
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+struct index_entry {
+	uint32_t group;
+	uint64_t first_sample;
+	uint64_t num_samples;
+	uint64_t offset;
+};
+
+/* Group 0 holds the logic data, the analog channels follow. */
+struct group_buff {
+	size_t unit_size;
+	size_t alloc_size;
+	uint8_t *samples;
+	size_t fill_size;
+	uint64_t written;
+};
+
+struct out_context {
+	char *filename;
+	FILE *file;
+	gboolean file_created;
+	uint64_t offset;
+	uint64_t samplerate;
+	struct sr_capfile_header header;
+	GArray *index;
+	size_t num_groups;
+	struct group_buff *groups;
+	/* Channel indices of the analog groups. */
+	gint *analog_index_map;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+
+	(void)options;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("srcap output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+
+	outc = g_malloc0(sizeof(*outc));
+	outc->filename = g_strdup(o->filename);
+	outc->index = g_array_new(FALSE, FALSE, sizeof(struct index_entry));
+	o->priv = outc;
+
+	return SR_OK;
+}
+
+static int file_write(struct out_context *outc, const void *data, size_t len)
+{
+	if (len && fwrite(data, len, 1, outc->file) != 1) {
+		sr_err("Cannot write '%s': %s.", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->offset += len;
+
+	return SR_OK;
+}
+
+/* (Re)write the header. The index offset is only known at the end. */
+static int header_write(struct out_context *outc)
+{
+	uint8_t *buf;
+	size_t size;
+	int ret;
+
+	outc->header.samplerate = outc->samplerate;
+	size = sr_capfile_header_size(&outc->header);
+	buf = g_malloc0(size);
+	sr_capfile_header_write(buf, &outc->header);
+	ret = file_write(outc, buf, size);
+	g_free(buf);
+
+	return ret;
+}
+
+static int file_create(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct sr_channel *ch;
+	GSList *l;
+	GVariant *gvar;
+	GPtrArray *logic_names, *analog_names;
+	size_t idx;
+
+	outc = o->priv;
+
+	if (outc->samplerate == 0 && sr_config_get(o->sdi->driver, o->sdi, NULL,
+					SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		outc->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	/*
+	 * All logic channels are kept, so that their bit positions match
+	 * their channel indices. Analog channels get stored when enabled.
+	 */
+	logic_names = g_ptr_array_new();
+	analog_names = g_ptr_array_new();
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			g_ptr_array_add(logic_names, ch->name);
+		else if (ch->type == SR_CHANNEL_ANALOG && ch->enabled)
+			g_ptr_array_add(analog_names, ch->name);
+	}
+	outc->header.num_logic = logic_names->len;
+	outc->header.unitsize = (logic_names->len + 7) / 8;
+	outc->header.num_analog = analog_names->len;
+	outc->header.names = g_malloc0_n(logic_names->len +
+		analog_names->len + 1, sizeof(char *));
+	for (idx = 0; idx < logic_names->len; idx++)
+		outc->header.names[idx] = g_strdup(logic_names->pdata[idx]);
+	for (idx = 0; idx < analog_names->len; idx++)
+		outc->header.names[logic_names->len + idx] =
+			g_strdup(analog_names->pdata[idx]);
+	g_ptr_array_free(logic_names, TRUE);
+	g_ptr_array_free(analog_names, TRUE);
+
+	outc->num_groups = 1 + outc->header.num_analog;
+	outc->groups = g_malloc0_n(outc->num_groups, sizeof(outc->groups[0]));
+	outc->analog_index_map = g_malloc0_n(outc->header.num_analog + 1,
+		sizeof(gint));
+	idx = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_ANALOG && ch->enabled)
+			outc->analog_index_map[idx++] = ch->index;
+	}
+	for (idx = 0; idx < outc->num_groups; idx++) {
+		outc->groups[idx].unit_size = idx ? sizeof(float) :
+			MAX(outc->header.unitsize, 1);
+		outc->groups[idx].samples = g_try_malloc(CHUNK_SIZE);
+		if (!outc->groups[idx].samples)
+			return SR_ERR_MALLOC;
+		outc->groups[idx].alloc_size = CHUNK_SIZE /
+			outc->groups[idx].unit_size;
+	}
+
+	outc->file = g_fopen(outc->filename, "wb");
+	if (!outc->file) {
+		sr_err("Cannot create '%s': %s.", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->offset = 0;
+
+	return header_write(outc);
+}
+
+/* Write the buffered samples of a group as an extent. */
+static int group_flush(struct out_context *outc, size_t group)
+{
+	static const uint8_t padding[SR_CAPFILE_ALIGN];
+	struct group_buff *buff;
+	struct index_entry entry;
+	uint8_t header[SR_CAPFILE_EXTENT_SIZE];
+	size_t length;
+	int ret;
+
+	buff = &outc->groups[group];
+	if (!buff->fill_size)
+		return SR_OK;
+
+	length = buff->fill_size * buff->unit_size;
+	sr_capfile_extent_write(header, group, buff->fill_size, length);
+	if ((ret = file_write(outc, header, sizeof(header))) != SR_OK)
+		return ret;
+
+	entry.group = group;
+	entry.first_sample = buff->written;
+	entry.num_samples = buff->fill_size;
+	entry.offset = outc->offset;
+	g_array_append_val(outc->index, entry);
+
+	if ((ret = file_write(outc, buff->samples, length)) != SR_OK)
+		return ret;
+	ret = file_write(outc, padding, SR_CAPFILE_ALIGN_UP(length) - length);
+	if (ret != SR_OK)
+		return ret;
+
+	buff->written += buff->fill_size;
+	buff->fill_size = 0;
+
+	return SR_OK;
+}
+
+static int group_append(struct out_context *outc, size_t group,
+	const uint8_t *data, size_t count)
+{
+	struct group_buff *buff;
+	size_t copy_size;
+	int ret;
+
+	buff = &outc->groups[group];
+	while (count) {
+		copy_size = MIN(count, buff->alloc_size - buff->fill_size);
+		memcpy(&buff->samples[buff->fill_size * buff->unit_size],
+			data, copy_size * buff->unit_size);
+		buff->fill_size += copy_size;
+		data += copy_size * buff->unit_size;
+		count -= copy_size;
+		if (buff->fill_size == buff->alloc_size) {
+			if ((ret = group_flush(outc, group)) != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Drivers may send wider samples than the device's logic channels need,
+ * or narrower ones when upper channels are disabled. Bit positions are
+ * channel indices either way, so samples get truncated or zero extended
+ * to the file's unit size.
+ */
+static int group_append_repack(struct out_context *outc,
+	const uint8_t *data, size_t unitsize, size_t count)
+{
+	struct group_buff *buff;
+	size_t copy_size, width, idx;
+	uint8_t *wrptr;
+	int ret;
+
+	buff = &outc->groups[0];
+	width = MIN(unitsize, buff->unit_size);
+	while (count) {
+		copy_size = MIN(count, buff->alloc_size - buff->fill_size);
+		wrptr = &buff->samples[buff->fill_size * buff->unit_size];
+		memset(wrptr, 0, copy_size * buff->unit_size);
+		for (idx = 0; idx < copy_size; idx++) {
+			memcpy(wrptr, data, width);
+			wrptr += buff->unit_size;
+			data += unitsize;
+		}
+		buff->fill_size += copy_size;
+		count -= copy_size;
+		if (buff->fill_size == buff->alloc_size) {
+			if ((ret = group_flush(outc, 0)) != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int append_logic(struct out_context *outc,
+	const struct sr_datafeed_logic *logic)
+{
+	if (!outc->header.num_logic || !logic->unitsize)
+		return SR_OK;
+	if (logic->unitsize != outc->header.unitsize)
+		return group_append_repack(outc, logic->data, logic->unitsize,
+			logic->length / logic->unitsize);
+
+	return group_append(outc, 0, logic->data,
+		logic->length / logic->unitsize);
+}
+
+static int append_analog(struct out_context *outc,
+	const struct sr_datafeed_analog *analog)
+{
+	const struct sr_channel *ch;
+	float *values;
+	size_t idx;
+	int ret;
+
+	if (g_slist_length(analog->meaning->channels) != 1) {
+		sr_err("Analog packets covering multiple channels not supported yet");
+		return SR_ERR;
+	}
+	ch = g_slist_nth_data(analog->meaning->channels, 0);
+	for (idx = 0; idx < outc->header.num_analog; idx++) {
+		if (outc->analog_index_map[idx] == ch->index)
+			break;
+	}
+	if (idx == outc->header.num_analog)
+		return SR_ERR_ARG;
+
+	values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
+	if (!values)
+		return SR_ERR_MALLOC;
+	ret = sr_analog_to_float(analog, values);
+	if (ret == SR_OK) {
+#ifdef WORDS_BIGENDIAN
+		size_t i;
+
+		for (i = 0; i < analog->num_samples; i++)
+			write_fltle((uint8_t *)&values[i], values[i]);
+#endif
+		ret = group_append(outc, idx + 1, (const uint8_t *)values,
+			analog->num_samples);
+	}
+	g_free(values);
+
+	return ret;
+}
+
+/* Flush all groups, and write the index and the final header. */
+static int file_finish(struct out_context *outc)
+{
+	const struct index_entry *entry;
+	uint8_t buf[SR_CAPFILE_INDEX_ENTRY];
+	uint64_t index_offset;
+	size_t idx;
+	int ret;
+
+	if (!outc->file)
+		return SR_OK;
+
+	ret = SR_OK;
+	for (idx = 0; idx < outc->num_groups && ret == SR_OK; idx++)
+		ret = group_flush(outc, idx);
+
+	index_offset = outc->offset;
+	if (ret == SR_OK) {
+		memset(buf, 0, sizeof(buf));
+		WL32(&buf[0], SR_CAPFILE_INDEX_MAGIC);
+		WL64(&buf[8], outc->index->len);
+		ret = file_write(outc, buf, SR_CAPFILE_INDEX_HEADER);
+	}
+	for (idx = 0; idx < outc->index->len && ret == SR_OK; idx++) {
+		entry = &g_array_index(outc->index, struct index_entry, idx);
+		memset(buf, 0, sizeof(buf));
+		WL32(&buf[0], entry->group);
+		WL64(&buf[8], entry->first_sample);
+		WL64(&buf[16], entry->num_samples);
+		WL64(&buf[24], entry->offset);
+		ret = file_write(outc, buf, SR_CAPFILE_INDEX_ENTRY);
+	}
+
+	/* Readers walk the extents of files without an index. */
+	if (ret == SR_OK) {
+		outc->header.index_offset = index_offset;
+		if (fseek(outc->file, 0, SEEK_SET) != 0)
+			ret = SR_ERR_IO;
+		else
+			ret = header_write(outc);
+	}
+
+	if (fclose(outc->file) != 0 && ret == SR_OK) {
+		sr_err("Cannot write '%s': %s.", outc->filename,
+			g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	outc->file = NULL;
+
+	return ret;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			outc->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+	case SR_DF_ANALOG:
+		if (!outc->file_created) {
+			outc->file_created = TRUE;
+			if ((ret = file_create(o)) != SR_OK)
+				return ret;
+		}
+		if (!outc->file)
+			return SR_ERR;
+		if (packet->type == SR_DF_LOGIC)
+			return append_logic(outc, packet->payload);
+		return append_analog(outc, packet->payload);
+	case SR_DF_END:
+		return file_finish(outc);
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+	size_t idx;
+
+	outc = o->priv;
+
+	/* Keep the file usable when the acquisition did not end properly. */
+	file_finish(outc);
+
+	for (idx = 0; idx < outc->num_groups; idx++)
+		g_free(outc->groups[idx].samples);
+	g_free(outc->groups);
+	g_free(outc->analog_index_map);
+	sr_capfile_header_clear(&outc->header);
+	g_array_free(outc->index, TRUE);
+	g_free(outc->filename);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_srcap = {
+	.id = "srcap",
+	.name = "srcap",
+	.desc = "Uncompressed memory mappable capture file",
+	.exts = (const char*[]){"srcap", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -22,16 +22,68 @@
 #include <string.h>
 #include <errno.h>
 #include <glib.h>
-#include <glib/gstdio.h>
-#include <zip.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
+/* Compressed chunks that may be pending per compression thread. */
+#define JOBS_PER_THREAD 2
+/* Summary levels cover 64, 4096, and 262144 samples per bin. */
+#define SUMMARY_LEVELS 3
+#define SUMMARY_RATIO 64
+
+/* A chunk which gets compressed by the worker pool. */
+struct compress_job {
+	char *name;
+	uint8_t *data;
+	size_t length;
+	uint16_t method;
+	int level;
+	struct sr_zip_member member;
+	gboolean done;
+};
+
+/*
+ * One level of a summary. Bins of the first level summarize samples,
+ * bins of further levels summarize SUMMARY_RATIO bins of the level
+ * below. A logic bin holds the AND and the OR of its samples (a channel
+ * toggled within the bin when these differ), an analog bin holds the
+ * minimum and the maximum value.
+ */
+struct summary_level {
+	uint64_t factor;
+	uint64_t fill;
+	uint8_t *bin;
+	GByteArray *bins;
+	unsigned int chunks;
+};
+
+struct summary {
+	gboolean analog;
+	size_t unit_size;
+	char *name;
+	struct summary_level levels[SUMMARY_LEVELS];
+};
 
 struct out_context {
 	gboolean zip_created;
+	struct sr_zip_writer *zip;
+	GKeyFile *meta;
+	unsigned int logic_chunks;
+	uint16_t method;
+	int level;
+	unsigned int num_threads;
+	gboolean with_summary;
+	gboolean native_analog;
+	gboolean logic_runs;
+	GThreadPool *pool;
+	/* Workers apply the thread settings of this session. */
+	const struct sr_session *session;
+	GQueue jobs;
+	GMutex jobs_mutex;
+	GCond jobs_cond;
+	struct sr_mem_account *account;
 	uint64_t samplerate;
 	char *filename;
 	size_t first_analog_index;
@@ -42,46 +94,415 @@ struct out_context {
 		size_t alloc_size;
 		uint8_t *samples;
 		size_t fill_size;
+		struct summary *summary;
+		/* The run which continues until the value changes. */
+		uint8_t *run_value;
+		uint64_t run_length;
 	} logic_buff;
 	struct analog_buff {
 		size_t alloc_size;
-		float *samples;
+		uint8_t *samples;
 		size_t fill_size;
+		unsigned int chunks;
+		struct summary *summary;
+		/* Integer samples with scale and offset, or float. */
+		gboolean has_encoding;
+		struct sr_analog_encoding encoding;
 	} *analog_buff;
 };
 
-static int init(struct sr_output *o, GHashTable *options)
+static void compress_job_run(gpointer data, gpointer user_data)
 {
 	struct out_context *outc;
+	struct compress_job *job;
+
+	job = data;
+	outc = user_data;
 
-	(void)options;
+	sr_thread_sched_enter(outc->session, SR_THREAD_OUTPUT);
+	sr_zip_member_prepare(&job->member, job->data, job->length,
+		job->method, job->level);
+
+	g_mutex_lock(&outc->jobs_mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&outc->jobs_cond);
+	g_mutex_unlock(&outc->jobs_mutex);
+}
+
+static void compress_job_free(struct compress_job *job)
+{
+	sr_zip_member_clear(&job->member);
+	g_free(job->data);
+	g_free(job->name);
+	g_free(job);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	GError *error;
+	const char *compression;
+	uint16_t method;
+	int level, max_level;
+	unsigned int threads;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	compression = g_variant_get_string(
+		g_hash_table_lookup(options, "compression"), NULL);
+	if (!g_ascii_strcasecmp(compression, "deflate")) {
+		method = SR_ZIP_METHOD_DEFLATE;
+		max_level = 9;
+	} else if (!g_ascii_strcasecmp(compression, "zstd")) {
+		method = SR_ZIP_METHOD_ZSTD;
+		max_level = 19;
+	} else {
+		sr_err("Unknown compression '%s'.", compression);
+		return SR_ERR_ARG;
+	}
+	if (!sr_zip_method_supported(method)) {
+		sr_err("%s compression is not supported by this build.",
+			compression);
+		return SR_ERR_NA;
+	}
+
+	level = g_variant_get_int32(g_hash_table_lookup(options, "level"));
+	if (level < 0 || level > max_level) {
+		sr_err("Compression level must be in the range 0 to %d.",
+			max_level);
+		return SR_ERR_ARG;
+	}
+	if (g_variant_get_boolean(g_hash_table_lookup(options, "store")))
+		level = 0;
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		threads = g_get_num_processors();
+#else
+		threads = 2;
+#endif
+	}
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->method = method;
+	outc->level = level;
+	outc->num_threads = threads;
+	outc->with_summary = g_variant_get_boolean(
+		g_hash_table_lookup(options, "summary"));
+	outc->native_analog = g_variant_get_boolean(
+		g_hash_table_lookup(options, "native"));
+	outc->logic_runs = g_variant_get_boolean(
+		g_hash_table_lookup(options, "runs"));
+	g_queue_init(&outc->jobs);
+	g_mutex_init(&outc->jobs_mutex);
+	g_cond_init(&outc->jobs_cond);
+	outc->account = sr_mem_account_new(o->sdi ? o->sdi->session : NULL,
+		"output");
+	outc->session = o->sdi ? o->sdi->session : NULL;
 	o->priv = outc;
 
+	/*
+	 * Chunks are independent members of the archive. Have them
+	 * compressed concurrently, unless there is nothing to gain.
+	 */
+	if (level != 0 && threads > 1) {
+		error = NULL;
+		outc->pool = g_thread_pool_new(compress_job_run, outc,
+			threads, FALSE, &error);
+		if (!outc->pool) {
+			sr_warn("Cannot create compression threads: %s.",
+				error->message);
+			g_error_free(error);
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Write compressed chunks to the archive, in the order they were queued.
+ * Waits for pending chunks when there are too many of them, or while the
+ * session is under memory pressure, or for all chunks with @a drain set.
+ */
+static int write_completed_jobs(struct out_context *outc, gboolean drain)
+{
+	struct compress_job *job;
+	int ret, err;
+
+	ret = SR_OK;
+	while (TRUE) {
+		g_mutex_lock(&outc->jobs_mutex);
+		job = g_queue_peek_head(&outc->jobs);
+		while (job && !job->done && (drain || g_queue_get_length(
+				&outc->jobs) > outc->num_threads * JOBS_PER_THREAD ||
+				sr_mem_account_pressure(outc->account)))
+			g_cond_wait(&outc->jobs_cond, &outc->jobs_mutex);
+		if (job && job->done)
+			g_queue_pop_head(&outc->jobs);
+		else
+			job = NULL;
+		g_mutex_unlock(&outc->jobs_mutex);
+		if (!job)
+			break;
+
+		err = sr_zip_writer_add_member(outc->zip, job->name,
+			&job->member);
+		if (err != SR_OK) {
+			sr_err("Failed to add chunk '%s'.", job->name);
+			if (ret == SR_OK)
+				ret = err;
+		}
+		sr_mem_account_release(outc->account, job->length);
+		compress_job_free(job);
+	}
+
+	return ret;
+}
+
+/*
+ * Add a chunk to the archive. Takes ownership of @a name. The data is
+ * compressed by the worker pool if there is one, the caller's buffer
+ * must not be referenced afterwards, so it gets copied in that case.
+ */
+static int zip_add_chunk(struct out_context *outc, char *name,
+	const void *data, size_t length)
+{
+	struct compress_job *job;
+	struct sr_zip_member member;
+	int ret;
+
+	if (!outc->pool) {
+		sr_zip_member_prepare(&member, data, length,
+			outc->method, outc->level);
+		ret = sr_zip_writer_add_member(outc->zip, name, &member);
+		sr_zip_member_clear(&member);
+		if (ret != SR_OK)
+			sr_err("Failed to add chunk '%s'.", name);
+		g_free(name);
+		return ret;
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->name = name;
+	job->data = g_try_malloc(length);
+	if (!job->data) {
+		g_free(job->name);
+		g_free(job);
+		return SR_ERR_MALLOC;
+	}
+	memcpy(job->data, data, length);
+	job->length = length;
+	sr_mem_account_charge(outc->account, length);
+	job->method = outc->method;
+	job->level = outc->level;
+
+	g_mutex_lock(&outc->jobs_mutex);
+	g_queue_push_tail(&outc->jobs, job);
+	g_mutex_unlock(&outc->jobs_mutex);
+	g_thread_pool_push(outc->pool, job, NULL);
+
+	return write_completed_jobs(outc, FALSE);
+}
+
+static int summary_complete(struct out_context *outc,
+	struct summary *summary, size_t idx);
+
+static struct summary *summary_new(const char *name,
+	gboolean analog, size_t unit_size)
+{
+	struct summary *summary;
+	struct summary_level *level;
+	size_t idx;
+	uint64_t factor;
+
+	summary = g_malloc0(sizeof(*summary));
+	summary->analog = analog;
+	summary->unit_size = unit_size;
+	summary->name = g_strdup(name);
+	factor = 1;
+	for (idx = 0; idx < SUMMARY_LEVELS; idx++) {
+		level = &summary->levels[idx];
+		factor *= SUMMARY_RATIO;
+		level->factor = factor;
+		level->bin = g_malloc0(2 * unit_size);
+		level->bins = g_byte_array_sized_new(CHUNK_SIZE);
+	}
+
+	return summary;
+}
+
+static void summary_free(struct summary *summary)
+{
+	size_t idx;
+
+	if (!summary)
+		return;
+	for (idx = 0; idx < SUMMARY_LEVELS; idx++) {
+		g_free(summary->levels[idx].bin);
+		g_byte_array_free(summary->levels[idx].bins, TRUE);
+	}
+	g_free(summary->name);
+	g_free(summary);
+}
+
+/* Write the completed bins of a summary level as another chunk. */
+static int summary_write(struct out_context *outc,
+	struct summary *summary, struct summary_level *level)
+{
+	int ret;
+
+	if (!level->bins->len)
+		return SR_OK;
+	ret = zip_add_chunk(outc, g_strdup_printf("%s-%" PRIu64 "-%u",
+		summary->name, level->factor, ++level->chunks),
+		level->bins->data, level->bins->len);
+	g_byte_array_set_size(level->bins, 0);
+
+	return ret;
+}
+
+/* Merge a range (a sample, or a bin of the level below) into a level. */
+static int summary_push(struct out_context *outc, struct summary *summary,
+	size_t idx, const uint8_t *min, const uint8_t *max)
+{
+	struct summary_level *level;
+	uint8_t *bin_min, *bin_max;
+	float fmin, fmax, bmin, bmax;
+	size_t i;
+
+	level = &summary->levels[idx];
+	bin_min = level->bin;
+	bin_max = level->bin + summary->unit_size;
+	if (!level->fill) {
+		memcpy(bin_min, min, summary->unit_size);
+		memcpy(bin_max, max, summary->unit_size);
+	} else if (summary->analog) {
+		memcpy(&fmin, min, sizeof(fmin));
+		memcpy(&fmax, max, sizeof(fmax));
+		memcpy(&bmin, bin_min, sizeof(bmin));
+		memcpy(&bmax, bin_max, sizeof(bmax));
+		if (fmin < bmin)
+			memcpy(bin_min, &fmin, sizeof(fmin));
+		if (fmax > bmax)
+			memcpy(bin_max, &fmax, sizeof(fmax));
+	} else {
+		for (i = 0; i < summary->unit_size; i++) {
+			bin_min[i] &= min[i];
+			bin_max[i] |= max[i];
+		}
+	}
+	if (++level->fill < SUMMARY_RATIO)
+		return SR_OK;
+
+	return summary_complete(outc, summary, idx);
+}
+
+/* Emit the current bin of a level, even when it is only partially filled. */
+static int summary_complete(struct out_context *outc,
+	struct summary *summary, size_t idx)
+{
+	struct summary_level *level;
+	int ret;
+
+	level = &summary->levels[idx];
+	if (!level->fill)
+		return SR_OK;
+	level->fill = 0;
+	g_byte_array_append(level->bins, level->bin, 2 * summary->unit_size);
+	if (level->bins->len >= CHUNK_SIZE) {
+		ret = summary_write(outc, summary, level);
+		if (ret != SR_OK)
+			return ret;
+	}
+	if (idx + 1 == SUMMARY_LEVELS)
+		return SR_OK;
+
+	return summary_push(outc, summary, idx + 1,
+		level->bin, level->bin + summary->unit_size);
+}
+
+/* Add a block of samples to a summary. */
+static int summary_add(struct out_context *outc, struct summary *summary,
+	const uint8_t *samples, size_t count)
+{
+	int ret;
+
+	while (count--) {
+		ret = summary_push(outc, summary, 0, samples, samples);
+		if (ret != SR_OK)
+			return ret;
+		samples += summary->unit_size;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Add a run of identical samples to a summary. Whole first level bins
+ * of the run get merged at once, instead of sample by sample.
+ */
+static int summary_add_run(struct out_context *outc, struct summary *summary,
+	const uint8_t *value, uint64_t count)
+{
+	struct summary_level *level;
+	int ret;
+
+	level = &summary->levels[0];
+	while (count) {
+		if (level->fill || count < SUMMARY_RATIO) {
+			ret = summary_push(outc, summary, 0, value, value);
+			if (ret != SR_OK)
+				return ret;
+			count--;
+			continue;
+		}
+		memcpy(level->bin, value, summary->unit_size);
+		memcpy(level->bin + summary->unit_size, value, summary->unit_size);
+		level->fill = SUMMARY_RATIO - 1;
+		ret = summary_push(outc, summary, 0, value, value);
+		if (ret != SR_OK)
+			return ret;
+		count -= SUMMARY_RATIO;
+	}
+
+	return SR_OK;
+}
+
+/* Emit the partial bins at the end of the data, and pending chunks. */
+static int summary_flush(struct out_context *outc, struct summary *summary)
+{
+	size_t idx;
+	int ret;
+
+	if (!summary)
+		return SR_OK;
+	for (idx = 0; idx < SUMMARY_LEVELS; idx++) {
+		ret = summary_complete(outc, summary, idx);
+		if (ret != SR_OK)
+			return ret;
+		ret = summary_write(outc, summary, &summary->levels[idx]);
+		if (ret != SR_OK)
+			return ret;
+	}
+
 	return SR_OK;
 }
 
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
-	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
 	GVariant *gvar;
 	GKeyFile *meta;
 	GSList *l;
-	const char *devgroup;
-	char *s, *metabuf;
-	gsize metalen;
+	const char *devgroup, *version;
+	char *s;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
@@ -94,24 +515,32 @@ static int zip_create(const struct sr_output *o)
 		g_variant_unref(gvar);
 	}
 
-	/* Quietly delete it first, libzip wants replace ops otherwise. */
-	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
+	/*
+	 * The archive stays open for the whole acquisition. Chunks get
+	 * appended as they are complete, the metadata is written last.
+	 */
+	outc->zip = sr_zip_writer_open(outc->filename);
+	if (!outc->zip)
 		return SR_ERR;
 
-	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_add(zipfile, "version", versrc) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
+	/*
+	 * "version", runs of logic samples need version 3 readers,
+	 * zstd compressed chunks need version 4 readers.
+	 */
+	if (outc->method == SR_ZIP_METHOD_ZSTD && outc->level)
+		version = "4";
+	else if (outc->logic_runs)
+		version = "3";
+	else
+		version = "2";
+	if (sr_zip_writer_add(outc->zip, "version", version, 1, -1) != SR_OK) {
+		sr_err("Error saving version into zipfile.");
 		return SR_ERR;
 	}
 
 	/* init "metadata" */
 	meta = g_key_file_new();
+	outc->meta = meta;
 
 	g_key_file_set_string(meta, "global", "sigrok version",
 			sr_package_version_string_get());
@@ -149,6 +578,10 @@ static int zip_create(const struct sr_output *o)
 	if (enabled_logic_channels > 0) {
 		g_key_file_set_string(meta, devgroup, "capturefile", "logic-1");
 		g_key_file_set_integer(meta, devgroup, "total probes", logic_channels);
+		if (outc->logic_runs) {
+			g_key_file_set_string(meta, devgroup,
+				"capture encoding", "runs");
+		}
 	}
 
 	s = sr_samplerate_string(outc->samplerate);
@@ -210,10 +643,16 @@ static int zip_create(const struct sr_output *o)
 	outc->logic_buff.samples = g_try_malloc0(alloc_size);
 	if (!outc->logic_buff.samples)
 		return SR_ERR_MALLOC;
+	sr_mem_account_charge(outc->account, alloc_size);
 	if (outc->logic_buff.unit_size)
 		alloc_size /= outc->logic_buff.unit_size;
 	outc->logic_buff.alloc_size = alloc_size;
+	outc->logic_buff.run_value = g_malloc0(outc->logic_buff.unit_size + 1);
 	outc->logic_buff.fill_size = 0;
+	if (outc->with_summary && outc->logic_buff.unit_size) {
+		outc->logic_buff.summary = summary_new("summary-logic-1",
+			FALSE, outc->logic_buff.unit_size);
+	}
 
 	alloc_size = sizeof(outc->analog_buff[0]) * outc->analog_ch_count + 1;
 	outc->analog_buff = g_malloc0(alloc_size);
@@ -222,33 +661,72 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].samples = g_try_malloc0(alloc_size);
 		if (!outc->analog_buff[index].samples)
 			return SR_ERR_MALLOC;
-		alloc_size /= sizeof(outc->analog_buff[0].samples[0]);
-		outc->analog_buff[index].alloc_size = alloc_size;
+		sr_mem_account_charge(outc->account, alloc_size);
+		/* Sample counts depend on the encoding of the first packet. */
+		outc->analog_buff[index].alloc_size = 0;
 		outc->analog_buff[index].fill_size = 0;
+		if (outc->with_summary) {
+			s = g_strdup_printf("summary-analog-1-%zu",
+				outc->first_analog_index + index);
+			outc->analog_buff[index].summary = summary_new(s,
+				TRUE, sizeof(float));
+			g_free(s);
+		}
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
-	g_key_file_free(meta);
-
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
-		sr_err("Error saving metadata into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(metasrc);
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	if (outc->with_summary) {
+		g_key_file_set_integer(meta, devgroup, "summary ratio",
+			SUMMARY_RATIO);
+		g_key_file_set_integer(meta, devgroup, "summary levels",
+			SUMMARY_LEVELS);
 	}
 
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	return SR_OK;
+}
+
+/**
+ * Write the metadata and the archive's central directory.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	char *metabuf;
+	gsize metalen;
+	size_t idx;
+	int ret, err;
+
+	outc = o->priv;
+	if (!outc->zip)
+		return SR_OK;
+
+	/* The summaries' last bins are only known at the end of the data. */
+	ret = summary_flush(outc, outc->logic_buff.summary);
+	for (idx = 0; idx < outc->analog_ch_count && ret == SR_OK; idx++)
+		ret = summary_flush(outc, outc->analog_buff[idx].summary);
+
+	err = write_completed_jobs(outc, TRUE);
+	if (ret == SR_OK)
+		ret = err;
+
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	if (sr_zip_writer_add(outc->zip, "metadata", metabuf, metalen,
+			outc->level) != SR_OK) {
+		sr_err("Error saving metadata into zipfile.");
+		ret = SR_ERR;
 	}
 	g_free(metabuf);
 
-	return SR_OK;
+	if (sr_zip_writer_finish(outc->zip) != SR_OK && ret == SR_OK) {
+		sr_err("Error saving session file.");
+		ret = SR_ERR;
+	}
+	outc->zip = NULL;
+
+	return ret;
 }
 
 /**
@@ -265,125 +743,161 @@ static int zip_append(const struct sr_output *o,
 	uint8_t *buf, size_t unitsize, size_t length)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
-	char *chunkname;
-	unsigned int next_chunk_num;
+	int ret;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
+	if (!outc->zip)
 		return SR_ERR;
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
+	/* The unitsize is only known when the first logic data is seen. */
+	if (!outc->logic_chunks)
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize", unitsize);
+
+	if (length % unitsize != 0) {
+		sr_warn("Chunk size %zu not a multiple of the"
+			" unit size %zu.", length, unitsize);
 	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
+
+	if (outc->logic_buff.summary) {
+		ret = summary_add(outc, outc->logic_buff.summary,
+			buf, length / unitsize);
+		if (ret != SR_OK)
+			return ret;
 	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
+
+	return zip_add_chunk(outc,
+		g_strdup_printf("logic-1-%u", ++outc->logic_chunks),
+		buf, length);
+}
+
+/* Write the queued runs of logic samples as another chunk. */
+static int zip_append_runs_chunk(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	size_t length;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+	if (!buff->fill_size)
+		return SR_OK;
+	if (!outc->zip)
+		return SR_ERR;
+
+	if (!outc->logic_chunks) {
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize",
+			buff->unit_size);
 	}
-	g_key_file_free(kf);
+	length = buff->fill_size;
+	buff->fill_size = 0;
 
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
+	return zip_add_chunk(outc,
+		g_strdup_printf("logic-1-%u", ++outc->logic_chunks),
+		buff->samples, length);
+}
+
+/*
+ * Queue the pending run for archive writes. The local buffer holds
+ * complete runs only, its fill size counts bytes in this mode. Runs
+ * beyond the 32bit count get split.
+ */
+static int zip_append_runs_pending(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	size_t record_size;
+	uint32_t count;
+	uint8_t *wrptr;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+	record_size = SR_SESSIONFILE_RUN_COUNT_SIZE + buff->unit_size;
+	while (buff->run_length) {
+		if (CHUNK_SIZE - buff->fill_size < record_size) {
+			ret = zip_append_runs_chunk(o);
+			if (ret != SR_OK)
+				return ret;
 			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
 		}
+		count = MIN(buff->run_length, UINT32_MAX);
+		wrptr = &buff->samples[buff->fill_size];
+		write_u32le_inc(&wrptr, count);
+		memcpy(wrptr, buff->run_value, buff->unit_size);
+		buff->fill_size += record_size;
+		buff->run_length -= count;
 	}
 
-	if (length % unitsize != 0) {
-		sr_warn("Chunk size %zu not a multiple of the"
-			" unit size %zu.", length, unitsize);
-	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
-	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+	return SR_OK;
+}
+
+/* Extend the pending run, or start another one when the value differs. */
+static int zip_append_run(const struct sr_output *o,
+	const uint8_t *value, uint64_t count)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+	if (!count)
+		return SR_OK;
+
+	if (buff->summary) {
+		ret = summary_add_run(outc, buff->summary, value, count);
+		if (ret != SR_OK)
+			return ret;
 	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+
+	if (buff->run_length && !memcmp(buff->run_value, value, buff->unit_size)) {
+		buff->run_length += count;
+		return SR_OK;
 	}
-	g_free(metabuf);
+	ret = zip_append_runs_pending(o);
+	if (ret != SR_OK)
+		return ret;
+	memcpy(buff->run_value, value, buff->unit_size);
+	buff->run_length = count;
 
 	return SR_OK;
 }
 
+/* Queue logic samples as runs, see zip_append_queue(). */
+static int zip_append_queue_runs(const struct sr_output *o,
+	const uint8_t *buf, size_t length, gboolean flush)
+{
+	struct out_context *outc;
+	size_t unit_size, count, idx, start;
+	int ret;
+
+	outc = o->priv;
+	unit_size = outc->logic_buff.unit_size;
+	count = unit_size ? length / unit_size : 0;
+
+	start = 0;
+	for (idx = 1; idx <= count; idx++) {
+		if (idx < count && !memcmp(&buf[idx * unit_size],
+				&buf[start * unit_size], unit_size))
+			continue;
+		ret = zip_append_run(o, &buf[start * unit_size], idx - start);
+		if (ret != SR_OK)
+			return ret;
+		start = idx;
+	}
+
+	if (!flush)
+		return SR_OK;
+	ret = zip_append_runs_pending(o);
+	if (ret != SR_OK)
+		return ret;
+
+	return zip_append_runs_chunk(o);
+}
+
 /**
  * Queue a block of logic data for srzip archive writes.
  *
@@ -410,6 +924,8 @@ static int zip_append_queue(const struct sr_output *o,
 		sr_warn("Unexpected unit size, discarding logic data.");
 		return SR_ERR_ARG;
 	}
+	if (outc->logic_runs)
+		return zip_append_queue_runs(o, buf, length, flush);
 
 	/*
 	 * Queue most recently received samples to the local buffer.
@@ -451,84 +967,271 @@ static int zip_append_queue(const struct sr_output *o,
 }
 
 /**
- * Append analog data of a channel to an srzip archive.
+ * Queue run length encoded logic data for a later archive update.
+ *
+ * Runs get expanded straight into the local buffer, which is flushed to
+ * the ZIP archive whenever it is full. No matter how long the runs are,
+ * the data never takes more memory than the buffer's size.
  *
  * @param[in] o Output module instance.
- * @param[in] values Sample data as array of floating point values.
- * @param[in] count Number of samples (float items, not bytes).
- * @param[in] ch_nr 1-based channel number.
+ * @param[in] rle Run length encoded logic data.
  *
  * @returns SR_OK et al error codes.
  */
-static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+static int zip_append_queue_rle(const struct sr_output *o,
+	const struct sr_datafeed_logic_rle *rle)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
-	char *chunkname;
-	unsigned int next_chunk_num;
+	struct logic_buff *buff;
+	const uint8_t *value;
+	uint8_t *wrptr;
+	uint64_t idx, run;
+	size_t remain, copy_size;
+	int ret;
 
 	outc = o->priv;
+	buff = &outc->logic_buff;
+	if (rle->num_runs && rle->unitsize != buff->unit_size) {
+		sr_warn("Unexpected unit size, discarding logic data.");
+		return SR_ERR_ARG;
+	}
 
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
+	value = rle->values;
+	if (outc->logic_runs) {
+		for (idx = 0; idx < rle->num_runs; idx++) {
+			ret = zip_append_run(o, value, rle->run_lengths[idx]);
+			if (ret != SR_OK)
+				return ret;
+			value += rle->unitsize;
+		}
+		return SR_OK;
+	}
+	for (idx = 0; idx < rle->num_runs; idx++) {
+		run = rle->run_lengths[idx];
+		while (run) {
+			remain = buff->alloc_size - buff->fill_size;
+			if (!remain) {
+				ret = zip_append(o, buff->samples,
+					buff->unit_size,
+					buff->fill_size * buff->unit_size);
+				if (ret != SR_OK)
+					return ret;
+				buff->fill_size = 0;
+				continue;
+			}
+			copy_size = MIN(run, remain);
+			wrptr = &buff->samples[buff->fill_size * buff->unit_size];
+			run -= copy_size;
+			buff->fill_size += copy_size;
+			while (copy_size--) {
+				memcpy(wrptr, value, buff->unit_size);
+				wrptr += buff->unit_size;
+			}
+		}
+		value += rle->unitsize;
+	}
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
+	return SR_OK;
+}
+
+/**
+ * Append analog data of a channel to an srzip archive.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] idx The channel's index in the analog buffers.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_analog(const struct sr_output *o, size_t idx)
+{
+	struct out_context *outc;
+	struct analog_buff *buff;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	GSList channels;
+	float *values;
+	size_t count, ch_nr;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->zip)
 		return SR_ERR;
-	}
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+	buff = &outc->analog_buff[idx];
+	count = buff->fill_size;
+	if (!count)
+		return SR_OK;
+	ch_nr = outc->first_analog_index + idx;
+
+	if (buff->summary && buff->encoding.is_float) {
+		ret = summary_add(outc, buff->summary, buff->samples, count);
+		if (ret != SR_OK)
+			return ret;
+	} else if (buff->summary) {
+		/* Summaries hold float values, convert integer samples. */
+		values = g_try_malloc(count * sizeof(values[0]));
+		if (!values)
+			return SR_ERR_MALLOC;
+		memset(&analog, 0, sizeof(analog));
+		memset(&meaning, 0, sizeof(meaning));
+		channels.data = NULL;
+		channels.next = NULL;
+		meaning.channels = &channels;
+		analog.data = buff->samples;
+		analog.num_samples = count;
+		analog.encoding = &buff->encoding;
+		analog.meaning = &meaning;
+		ret = sr_analog_to_float(&analog, values);
+		if (ret == SR_OK) {
+			ret = summary_add(outc, buff->summary,
+				(const uint8_t *)values, count);
 		}
+		g_free(values);
+		if (ret != SR_OK)
+			return ret;
 	}
+	buff->fill_size = 0;
 
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
+	return zip_add_chunk(outc,
+		g_strdup_printf("analog-1-%zu-%u", ch_nr, ++buff->chunks),
+		buff->samples, count * buff->encoding.unitsize);
+}
+
+/* Check whether integer samples can be stored as they are. */
+static gboolean analog_is_storable(const struct sr_analog_encoding *encoding)
+{
+	if (encoding->is_float)
+		return FALSE;
+	switch (encoding->unitsize) {
+	case sizeof(uint8_t):
+	case sizeof(uint16_t):
+	case sizeof(uint32_t):
+		break;
+	default:
+		return FALSE;
 	}
-	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
+	if (!encoding->scale.q || !encoding->offset.q)
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean rational_equal(const struct sr_rational *a,
+	const struct sr_rational *b)
+{
+	return a->p == b->p && a->q == b->q;
+}
+
+/*
+ * Determine a channel's encoding in the archive from its first packet.
+ * Integer samples are kept as they are when the user asked for that,
+ * the encoding then must not change during the acquisition.
+ */
+static int analog_buff_encoding(struct out_context *outc, size_t idx,
+	const struct sr_analog_encoding *encoding, gboolean *native)
+{
+	struct analog_buff *buff;
+	struct sr_analog_encoding *want;
+	int ret;
+
+	buff = &outc->analog_buff[idx];
+	want = &buff->encoding;
+
+	if (!buff->has_encoding) {
+		memset(want, 0, sizeof(*want));
+		want->unitsize = sizeof(float);
+		want->is_signed = TRUE;
+		want->is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+		want->is_bigendian = TRUE;
+#endif
+		want->scale.p = 1;
+		want->scale.q = 1;
+		want->offset.q = 1;
+		if (outc->native_analog && analog_is_storable(encoding)) {
+			want->unitsize = encoding->unitsize;
+			want->is_signed = encoding->is_signed;
+			want->is_float = FALSE;
+			want->is_bigendian = FALSE;
+			want->scale = encoding->scale;
+			want->offset = encoding->offset;
+			ret = sr_sessionfile_analog_encoding_set(outc->meta,
+				outc->first_analog_index + idx, want);
+			if (ret != SR_OK)
+				return ret;
+		}
+		buff->alloc_size = CHUNK_SIZE / want->unitsize;
+		buff->has_encoding = TRUE;
 	}
 
-	g_free(basename);
+	*native = !want->is_float;
+	if (!*native)
+		return SR_OK;
+	if (encoding->is_float || encoding->unitsize != want->unitsize ||
+			encoding->is_signed != want->is_signed ||
+			!rational_equal(&encoding->scale, &want->scale) ||
+			!rational_equal(&encoding->offset, &want->offset)) {
+		sr_err("Analog sample encoding changed, cannot store it.");
+		return SR_ERR_DATA;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Queue a channel's samples for srzip archive writes. Takes every
+ * stride'th item, swaps the bytes of big endian integer samples.
+ */
+static int analog_buff_append(const struct sr_output *o, size_t idx,
+	const uint8_t *data, size_t stride, size_t count, gboolean swap)
+{
+	struct out_context *outc;
+	struct analog_buff *buff;
+	size_t unitsize, remain, copy_size, i, b;
+	uint8_t *wrptr;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->analog_buff[idx];
+	unitsize = buff->encoding.unitsize;
+
+	/*
+	 * Queue most recently received samples to the local buffer.
+	 * Flush to the ZIP archive when the buffer space is exhausted.
+	 */
+	while (count) {
+		remain = buff->alloc_size - buff->fill_size;
+		if (!remain) {
+			ret = zip_append_analog(o, idx);
+			if (ret != SR_OK)
+				return ret;
+			continue;
+		}
+		copy_size = MIN(count, remain);
+		wrptr = &buff->samples[buff->fill_size * unitsize];
+		if (stride == unitsize && !swap) {
+			memcpy(wrptr, data, copy_size * unitsize);
+			data += copy_size * unitsize;
+		} else {
+			for (i = 0; i < copy_size; i++) {
+				for (b = 0; b < unitsize; b++)
+					wrptr[b] = data[swap ? unitsize - 1 - b : b];
+				wrptr += unitsize;
+				data += stride;
+			}
+		}
+		buff->fill_size += copy_size;
+		count -= copy_size;
+	}
 
 	return SR_OK;
 }
 
 /**
- * Queue analog data of a channel for srzip archive writes.
+ * Queue analog data for srzip archive writes.
+ *
+ * Packets may cover several channels, with their samples interleaved.
+ * Each channel's samples go to the channel's own archive members.
  *
  * @param[in] o Output module instance.
  * @param[in] analog Sample data (session feed packet format).
@@ -541,10 +1244,12 @@ static int zip_append_analog_queue(const struct sr_output *o,
 {
 	struct out_context *outc;
 	const struct sr_channel *ch;
-	size_t idx, nr;
-	struct analog_buff *buff;
-	float *values, *wrptr, *rdptr;
-	size_t send_size, remain, copy_size;
+	size_t idx, num_channels, ch_pos;
+	const struct sr_analog_encoding *encoding;
+	float *values;
+	const uint8_t *data;
+	gboolean native, swap;
+	GSList *l;
 	int ret;
 
 	outc = o->priv;
@@ -552,81 +1257,68 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	/* Is this the DF_END flush call without samples submission? */
 	if (!analog && flush) {
 		for (idx = 0; idx < outc->analog_ch_count; idx++) {
-			nr = outc->first_analog_index + idx;
-			buff = &outc->analog_buff[idx];
-			if (!buff->fill_size)
-				continue;
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+			ret = zip_append_analog(o, idx);
 			if (ret != SR_OK)
 				return ret;
-			buff->fill_size = 0;
 		}
 		return SR_OK;
 	}
 
-	/* Lookup index and number of the analog channel. */
-	/* TODO: support packets covering multiple channels */
-	if (g_slist_length(analog->meaning->channels) != 1) {
-		sr_err("Analog packets covering multiple channels not supported yet");
-		return SR_ERR;
-	}
-	ch = g_slist_nth_data(analog->meaning->channels, 0);
-	for (idx = 0; idx < outc->analog_ch_count; idx++) {
-		if (outc->analog_index_map[idx] == ch->index)
+	encoding = analog->encoding;
+	num_channels = g_slist_length(analog->meaning->channels);
+	values = NULL;
+	ret = SR_OK;
+	for (l = analog->meaning->channels, ch_pos = 0; l && ret == SR_OK;
+			l = l->next, ch_pos++) {
+		/* Lookup index and number of the analog channel. */
+		ch = l->data;
+		for (idx = 0; idx < outc->analog_ch_count; idx++) {
+			if (outc->analog_index_map[idx] == ch->index)
+				break;
+		}
+		if (idx == outc->analog_ch_count) {
+			ret = SR_ERR_ARG;
+			break;
+		}
+		ret = analog_buff_encoding(outc, idx, encoding, &native);
+		if (ret != SR_OK)
 			break;
-	}
-	if (idx == outc->analog_ch_count)
-		return SR_ERR_ARG;
-	nr = outc->first_analog_index + idx;
-	buff = &outc->analog_buff[idx];
-
-	/* Convert the analog data to an array of float values. */
-	values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
-	if (!values)
-		return SR_ERR_MALLOC;
-	ret = sr_analog_to_float(analog, values);
-	if (ret != SR_OK) {
-		g_free(values);
-		return ret;
-	}
 
-	/*
-	 * Queue most recently received samples to the local buffer.
-	 * Flush to the ZIP archive when the buffer space is exhausted.
-	 */
-	rdptr = values;
-	send_size = analog->num_samples;
-	while (send_size) {
-		remain = buff->alloc_size - buff->fill_size;
-		if (remain) {
-			wrptr = &buff->samples[buff->fill_size];
-			copy_size = MIN(send_size, remain);
-			send_size -= copy_size;
-			buff->fill_size += copy_size;
-			memcpy(wrptr, rdptr, copy_size * sizeof(values[0]));
-			rdptr += copy_size;
-			remain -= copy_size;
+		if (native) {
+			data = analog->data;
+			data += ch_pos * encoding->unitsize;
+			swap = encoding->is_bigendian && encoding->unitsize > 1;
+			ret = analog_buff_append(o, idx, data,
+				num_channels * encoding->unitsize,
+				analog->num_samples, swap);
+			continue;
 		}
-		if (send_size && !remain) {
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
-			if (ret != SR_OK) {
-				g_free(values);
-				return ret;
+
+		/* Convert the channel's data to an array of float values. */
+		if (!values) {
+			values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
+			if (!values) {
+				ret = SR_ERR_MALLOC;
+				break;
 			}
-			buff->fill_size = 0;
-			remain = buff->alloc_size - buff->fill_size;
 		}
+		ret = sr_analog_to_float_channel(analog, ch_pos, values);
+		if (ret != SR_OK)
+			break;
+		ret = analog_buff_append(o, idx, (const uint8_t *)values,
+			sizeof(values[0]), analog->num_samples, FALSE);
 	}
 	g_free(values);
+	if (ret != SR_OK)
+		return ret;
 
 	/* Flush to the ZIP archive if the caller wants us to. */
-	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
-		if (ret != SR_OK)
-			return ret;
-		buff->fill_size = 0;
+	if (flush) {
+		for (idx = 0; idx < outc->analog_ch_count; idx++) {
+			ret = zip_append_analog(o, idx);
+			if (ret != SR_OK)
+				return ret;
+		}
 	}
 
 	return SR_OK;
@@ -638,6 +1330,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	struct out_context *outc;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
@@ -669,6 +1362,17 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_LOGIC_RLE:
+		if (!outc->zip_created) {
+			if ((ret = zip_create(o)) != SR_OK)
+				return ret;
+			outc->zip_created = TRUE;
+		}
+		rle = packet->payload;
+		ret = zip_append_queue_rle(o, rle);
+		if (ret != SR_OK)
+			return ret;
+		break;
 	case SR_DF_ANALOG:
 		if (!outc->zip_created) {
 			if ((ret = zip_create(o)) != SR_OK)
@@ -688,6 +1392,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			ret = zip_finish(o);
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -696,11 +1403,28 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"compression", "Compression", "Compression of chunks, deflate or zstd (faster to save and load, needs session file version 4 readers)", NULL, NULL},
+	{"level", "Compression level", "Level from 1 (fastest) to 9 (best) for deflate, or 19 for zstd, 0 stores chunks without compression", NULL, NULL},
+	{"store", "Store only", "Store chunks without compression", NULL, NULL},
+	{"threads", "Compression threads", "Number of threads compressing chunks, 0 for one per CPU", NULL, NULL},
+	{"summary", "Summary levels", "Store min/max summaries at 1:64, 1:4096 and 1:262144 for overview rendering", NULL, NULL},
+	{"native", "Native analog", "Store integer analog samples as they are, with their scale and offset, instead of float", NULL, NULL},
+	{"runs", "Logic runs", "Store logic data as runs of identical samples, needs session file version 3 readers", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		options[1].def = g_variant_ref_sink(g_variant_new_int32(6));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[4].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[5].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[6].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
 	return options;
 }
 
@@ -711,12 +1435,27 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* Keep the file usable when the acquisition did not end properly. */
+	if (outc->zip)
+		zip_finish(o);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	if (outc->pool)
+		g_thread_pool_free(outc->pool, FALSE, TRUE);
+	g_mutex_clear(&outc->jobs_mutex);
+	g_cond_clear(&outc->jobs_cond);
+
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
-	for (idx = 0; idx < outc->analog_ch_count; idx++)
+	g_free(outc->logic_buff.run_value);
+	summary_free(outc->logic_buff.summary);
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
 		g_free(outc->analog_buff[idx].samples);
+		summary_free(outc->analog_buff[idx].summary);
+	}
 	g_free(outc->analog_buff);
+	sr_mem_account_free(outc->account);
 
 	g_free(outc);
 	o->priv = NULL;
@@ -729,7 +1468,7 @@ SR_PRIV struct sr_output_module output_srzip = {
 	.name = "srzip",
 	.desc = "srzip session file format data",
 	.exts = (const char*[]){"sr", NULL},
-	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_RLE,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
@@ -40,7 +40,9 @@
 #define LOG_PREFIX "output/vcd"
 
 static const int with_queue_stats = 0;
-static const int with_pool_stats = 0;
+
+/* Minimum number of logic samples per formatting thread. */
+#define THREAD_MIN_SAMPLES	(64 * 1024)
 
 struct vcd_channel_desc {
 	size_t index;
@@ -51,14 +53,20 @@ struct vcd_channel_desc {
 		double real;
 	} last;
 	uint64_t last_rcvd_snum;
+	/* Queued value changes, in the order of their sample numbers. */
+	struct vcd_change *queue;
+	size_t queue_head, queue_tail, queue_size;
 };
 
-/** Queued values for a given sample number. */
-struct vcd_queue_item {
+/** A queued value change of one channel. */
+struct vcd_change {
 	uint64_t samplenum;	/**!< sample number, _not_ timestamp */
-	GString *values;	/**!< text of value changes */
+	double value;		/**!< new value, 0 or 1 for logic channels */
 };
 
+/* Initial number of queued changes per channel, in mixed signal setups. */
+#define QUEUE_PREALLOC 1024
+
 struct context {
 	size_t enabled_count;
 	size_t logic_count;
@@ -67,12 +75,33 @@ struct context {
 	uint64_t period;
 	struct vcd_channel_desc *channels;
 	uint64_t samplerate;
-	GSList *free_list, *used_list;
-	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	/* Channels with changes to write, see write_completed_changes(). */
+	struct vcd_channel_desc **merge_heap;
 	gboolean immediate_write;
 	uint8_t *last_logic;
+	/* Logic data bit positions of VCD signals, for the fast path. */
+	size_t logic_size;
+	uint8_t *logic_mask;
+	struct vcd_channel_desc **bit_desc;
+	/* Concurrent formatting of logic data blocks. */
+	unsigned int num_threads;
+	GThreadPool *pool;
+	/* Workers apply the thread settings of this session. */
+	const struct sr_session *session;
+	GMutex jobs_mutex;
+	GCond jobs_cond;
+	size_t jobs_pending;
+	struct sr_mem_account *account;
+};
+
+/** A block of logic samples, which gets formatted by a worker thread. */
+struct format_job {
+	struct context *ctx;
+	const uint8_t *prev;	/**!< the sample before the block */
+	const uint8_t *samples;
+	size_t count;
+	uint64_t snum;
+	GString *text;
 };
 
 /*
@@ -202,6 +231,8 @@ static void format_vcd_value_real(GString *s, double real_value, GString *id)
 	g_string_append(s, id->str);
 }
 
+static void format_job_run(gpointer data, gpointer user_data);
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
@@ -210,8 +241,17 @@ static int init(struct sr_output *o, GHashTable *options)
 	GSList *l;
 	size_t num_enabled, num_logic, num_analog, desc_idx;
 	struct vcd_channel_desc *desc;
-
-	(void)options;
+	unsigned int threads;
+	GError *error;
+
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		threads = g_get_num_processors();
+#else
+		threads = 2;
+#endif
+	}
 
 	/* Determine the number of involved channels. */
 	num_enabled = 0;
@@ -238,6 +278,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	/* Allocate space for channel descriptions. */
 	ctx = g_malloc0(sizeof(*ctx));
 	o->priv = ctx;
+	ctx->account = sr_mem_account_new(o->sdi->session, "output");
+	ctx->session = o->sdi->session;
 	ctx->enabled_count = num_enabled;
 	ctx->logic_count = num_logic;
 	ctx->analog_count = num_analog;
@@ -287,6 +329,20 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (ctx->logic_count == 0 && ctx->analog_count == 1)
 		ctx->immediate_write = TRUE;
 
+	/* Otherwise channels queue their changes, until all got data. */
+	if (!ctx->immediate_write) {
+		ctx->merge_heap = g_malloc0_n(ctx->enabled_count,
+			sizeof(ctx->merge_heap[0]));
+		for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+			desc = &ctx->channels[desc_idx];
+			desc->queue = g_malloc_n(QUEUE_PREALLOC,
+				sizeof(desc->queue[0]));
+			desc->queue_size = QUEUE_PREALLOC;
+		}
+		sr_mem_account_charge(ctx->account, ctx->enabled_count *
+			QUEUE_PREALLOC * sizeof(desc->queue[0]));
+	}
+
 	/*
 	 * Keep a copy of the last logic data bitmap around. To avoid
 	 * iterating over individual bits when nothing in the set has
@@ -298,6 +354,43 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (ctx->logic_count && !ctx->last_logic)
 		return SR_ERR_MALLOC;
 
+	/*
+	 * Logic only setups use a faster code path. Which compares
+	 * whole words of sample data, and maps the bits which have
+	 * changed to their VCD signals. Large packets get cut into
+	 * blocks which are formatted concurrently.
+	 */
+	if (ctx->logic_count && !ctx->analog_count) {
+		ctx->logic_size = alloc_size;
+		ctx->logic_mask = g_malloc0(alloc_size);
+		ctx->bit_desc = g_malloc0_n(alloc_size * 8,
+			sizeof(ctx->bit_desc[0]));
+		for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+			desc = &ctx->channels[desc_idx];
+			if (desc->type != SR_CHANNEL_LOGIC)
+				continue;
+			if (desc->index >= alloc_size * 8)
+				continue;
+			ctx->logic_mask[desc->index / 8] |= 1 << (desc->index % 8);
+			ctx->bit_desc[desc->index] = desc;
+		}
+		ctx->num_threads = threads;
+		if (threads > 1) {
+			g_mutex_init(&ctx->jobs_mutex);
+			g_cond_init(&ctx->jobs_cond);
+			error = NULL;
+			ctx->pool = g_thread_pool_new(format_job_run, ctx,
+				threads, FALSE, &error);
+			if (!ctx->pool) {
+				sr_warn("Cannot create formatting threads: %s.",
+					error->message);
+				g_error_free(error);
+				g_mutex_clear(&ctx->jobs_mutex);
+				g_cond_clear(&ctx->jobs_cond);
+			}
+		}
+	}
+
 	return SR_OK;
 }
 
@@ -334,12 +427,11 @@ static uint64_t get_timescale_freq(uint64_t samplerate)
 }
 
 /* Emit a VCD file header. */
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
 	GSList *l;
 	time_t t;
 	size_t num_channels, i;
@@ -370,8 +462,7 @@ static GString *gen_header(const struct sr_output *o)
 	frequency_s = sr_period_string(1, ctx->period);
 
 	/* Construct the VCD output file header. */
-	header = g_string_sized_new(512);
-	g_string_printf(header, "$date %s $end\n", timestamp);
+	g_string_append_printf(header, "$date %s $end\n", timestamp);
 	g_string_append_printf(header, "$version %s %s $end\n",
 		PACKAGE_NAME, sr_package_version_string_get());
 	g_string_append_printf(header, "$comment\n");
@@ -410,31 +501,24 @@ static GString *gen_header(const struct sr_output *o)
 	g_free(timestamp);
 	g_free(samplerate_s);
 	g_free(frequency_s);
-
-	return header;
 }
 
 /*
- * Gets called when a session feed packet was received. Either creates
- * a VCD file header (once in the output module's lifetime), or an empty
- * GString. Callers will append the text representation of sample data
- * to that string as needed.
+ * Gets called when a session feed packet was received. Appends the VCD
+ * file header (once in the output module's lifetime) to the caller's
+ * text buffer. Callers will append the text representation of sample
+ * data to that string as needed.
  */
-static GString *chk_header(const struct sr_output *o)
+static void chk_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
-	GString *s;
 
 	ctx = o->priv;
 
 	if (!ctx->header_done) {
 		ctx->header_done = TRUE;
-		s = gen_header(o);
-	} else {
-		s = g_string_sized_new(512);
+		gen_header(o, out);
 	}
-
-	return s;
 }
 
 /*
@@ -443,345 +527,79 @@ static GString *chk_header(const struct sr_output *o)
  * have seen samples from all involved channels for a given samplenumber.
  * Data for a given sample number can only get emitted when we are sure
  * no other channel's data can arrive any more.
+ *
+ * Each channel receives its samples in order, and appends its value
+ * changes to its own array. Which keeps the queueing cheap regardless
+ * of how the channels' packets interleave. Writing the changes merges
+ * the channels' arrays, see write_completed_changes().
  */
 
-static struct vcd_queue_item *queue_alloc_item(struct context *ctx, uint64_t snum)
-{
-	GSList *node;
-	struct vcd_queue_item *item;
-
-	/* Get an item from the free list if available. */
-	node = ctx->free_list;
-	if (node) {
-		ctx->reused++;
-
-		/* Unlink GSList node from the free list. */
-		ctx->free_list = node->next;
-		node->next = NULL;
-		item = node->data;
-		node->data = NULL;
-
-		/* Setup content of the item. */
-		item->samplenum = snum;
-		if (!item->values)
-			item->values = g_string_sized_new(32);
-		else
-			g_string_truncate(item->values, 0);
-
-		/* Keep GSList node in the used list (avoid free/alloc). */
-		node->next = ctx->used_list;
-		ctx->used_list = node;
-
-		return item;
-	}
-
-	/* Dynamic allocation of an item. */
-	ctx->alloced++;
-	item = g_malloc0(sizeof(*item));
-	if (!item)
-		return NULL;
-	item->samplenum = snum;
-	item->values = g_string_sized_new(32);
-
-	/* Create a used list item, to later move to the free list. */
-	ctx->used_list = g_slist_prepend(ctx->used_list, item);
-
-	return item;
-}
-
-static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
+static int queue_change(struct context *ctx, struct vcd_channel_desc *desc,
+	uint64_t snum, double value)
 {
-	GSList *node;
-
-	/*
-	 * Put item back into the free list. We can assume to find a
-	 * used list node, it got allocated when the item was acquired.
-	 */
-	node = ctx->used_list;
-	if (node) {
-		ctx->pooled++;
-
-		ctx->used_list = node->next;
-		node->next = NULL;
-		node->data = item;
-
-		item->samplenum = 0;
-		g_string_truncate(item->values, 0);
-
-		node->next = ctx->free_list;
-		ctx->free_list = node;
-
-		return;
+	struct vcd_change *queue, *change;
+	size_t size;
+
+	if (desc->queue_tail == desc->queue_size) {
+		if (desc->queue_head >= desc->queue_size / 2) {
+			/* Reclaim the space of already written changes. */
+			memmove(desc->queue, &desc->queue[desc->queue_head],
+				(desc->queue_tail - desc->queue_head) *
+				sizeof(desc->queue[0]));
+			desc->queue_tail -= desc->queue_head;
+			desc->queue_head = 0;
+		} else {
+			size = 2 * desc->queue_size;
+			queue = g_try_realloc(desc->queue,
+				size * sizeof(desc->queue[0]));
+			if (!queue)
+				return SR_ERR_MALLOC;
+			sr_mem_account_charge(ctx->account,
+				(size - desc->queue_size) * sizeof(queue[0]));
+			if (with_queue_stats)
+				sr_dbg("%s(), queue size %zu", __func__, size);
+			desc->queue = queue;
+			desc->queue_size = size;
+		}
 	}
 
-	/*
-	 * Release dynamically allocated resources. Could also be used
-	 * to release free list items when the use list is empty.
-	 */
-	ctx->freed++;
-	if (item->values)
-		g_string_free(item->values, TRUE);
-	g_free(item);
-}
-
-static void queue_drain_pool_cb(gpointer data, gpointer cb_data)
-{
-	struct context *ctx;
-	struct vcd_queue_item *item;
+	change = &desc->queue[desc->queue_tail++];
+	change->samplenum = snum;
+	change->value = value;
 
-	item = data;
-	ctx = cb_data;
-	queue_free_item(ctx, item);
+	return SR_OK;
 }
 
-static void queue_drain_pool(struct context *ctx)
+/* Order channels by their first queued change, then by position. */
+static gboolean queue_before(const struct vcd_channel_desc *a,
+	const struct vcd_channel_desc *b)
 {
-	GSList *list;
+	uint64_t snum_a, snum_b;
 
-	/*
-	 * Grab the list and "empty" the context member. Then
-	 * iterate over the items, have dymamic memory released.
-	 * Then free the GSList nodes (but not their data parts).
-	 * Do this for the used and the free lists.
-	 */
-	list = ctx->used_list;
-	ctx->used_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-
-	list = ctx->free_list;
-	ctx->free_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-}
-
-static int cmp_snum(gconstpointer l, gconstpointer d)
-{
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
-}
+	snum_a = a->queue[a->queue_head].samplenum;
+	snum_b = b->queue[b->queue_head].samplenum;
+	if (snum_a != snum_b)
+		return snum_a < snum_b;
 
-static int cmp_items(gconstpointer a, gconstpointer b)
-{
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	return a < b;
 }
 
-/*
- * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
- *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
- * cases (logic only, one analog channel only) this queue is bypassed.
- */
-static int queue_samplenum(struct context *ctx, uint64_t snum)
+static void heap_sift_down(struct vcd_channel_desc **heap, size_t count,
+	size_t pos)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
-
-	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (item && item->samplenum == snum)
-		return SR_OK;
-
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
-	}
+	struct vcd_channel_desc *desc;
+	size_t child;
 
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
+	desc = heap[pos];
+	while ((child = 2 * pos + 1) < count) {
+		if (child + 1 < count && queue_before(heap[child + 1], heap[child]))
+			child++;
+		if (!queue_before(heap[child], desc))
 			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
-	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
-		return SR_OK;
+		heap[pos] = heap[child];
+		pos = child;
 	}
-
-	/*
-	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
-	 */
-	if (with_queue_stats)
-		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
-		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
-	return SR_OK;
-}
-
-/*
- * Prepare to append another text fragment for a value change to the
- * queue item which corresponds to the current sample number. Return
- * the GString which the caller then will append to.
- */
-static GString *queue_value_text_prep(struct context *ctx)
-{
-	struct vcd_queue_item *item;
-	GString *buff;
-
-	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (!item)
-		return NULL;
-
-	/* Create a GString if not done already. */
-	buff = item->values;
-	if (!buff) {
-		buff = g_string_sized_new(20);
-		item->values = buff;
-	}
-
-	/* Separate items with spaces (if previous content is present). */
-	if (buff->len)
-		g_string_append_c(buff, ' ');
-
-	return buff;
+	heap[pos] = desc;
 }
 
 static double snum_to_ts(struct context *ctx, uint64_t snum)
@@ -795,33 +613,6 @@ static double snum_to_ts(struct context *ctx, uint64_t snum)
 	return ts;
 }
 
-/*
- * Unqueue one item of the VCD values queue which corresponds to one
- * sample number. Append all of the text to the passed in GString.
- */
-static int unqueue_item(struct context *ctx,
-	struct vcd_queue_item *item, GString *s)
-{
-	double ts;
-	GString *buff;
-	gboolean is_empty;
-
-	/*
-	 * Start the sample number's string with the timestamp. Append
-	 * all value changes. Terminate lines for items which have a
-	 * timestamp but no value changes, assuming this is the last
-	 * entry which corresponds to SR_DF_END.
-	 */
-	ts = snum_to_ts(ctx, item->samplenum);
-	buff = item->values;
-	is_empty = !buff || !buff->len || !buff->str || !*buff->str;
-	append_vcd_timestamp(s, ts, is_empty);
-	if (!is_empty)
-		g_string_append(s, buff->str);
-
-	return SR_OK;
-}
-
 /*
  * Get the last sample number which logic data was received for. This
  * implementation assumes that all logic channels get received within
@@ -929,79 +720,321 @@ static uint64_t get_max_snum_flush(struct context *ctx)
 
 /*
  * Pass all queued value changes when we are certain we have received
- * data from all channels.
+ * data from all channels. Take the changes with the lowest sample
+ * number from the channels' queues, the heap has the channels which
+ * have changes to write.
  */
 static int write_completed_changes(struct context *ctx, GString *out)
 {
-	uint64_t upto_snum;
-	GList **listref, *node;
-	struct vcd_queue_item *item;
-	int rc;
-	size_t dumped;
+	uint64_t upto_snum, snum;
+	struct vcd_channel_desc **heap, *desc;
+	const struct vcd_change *change;
+	size_t count, idx, dumped;
 
 	/* Determine the number which all data was received for so far. */
 	upto_snum = get_max_snum_export(ctx);
 	if (with_queue_stats)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
+	heap = ctx->merge_heap;
+	count = 0;
+	for (idx = 0; idx < ctx->enabled_count; idx++) {
+		desc = &ctx->channels[idx];
+		if (desc->queue_head == desc->queue_tail)
+			continue;
+		if (desc->queue[desc->queue_head].samplenum >= upto_snum)
+			continue;
+		heap[count++] = desc;
+	}
+	for (idx = count / 2; idx--; )
+		heap_sift_down(heap, count, idx);
+
 	/*
-	 * Forward and consume those items from the head of the list
-	 * which we completely have accumulated and are certain about.
+	 * Start each sample number's text with the timestamp, and
+	 * separate the value changes with spaces.
 	 */
 	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
-		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
-		if (item->samplenum >= upto_snum)
-			break;
+	snum = 0;
+	while (count) {
+		desc = heap[0];
+		change = &desc->queue[desc->queue_head++];
+		if (!dumped || change->samplenum != snum) {
+			snum = change->samplenum;
+			append_vcd_timestamp(out, snum_to_ts(ctx, snum), FALSE);
+		} else {
+			g_string_append_c(out, ' ');
+		}
+		dumped++;
+		if (desc->type == SR_CHANNEL_LOGIC)
+			format_vcd_value_bit(out, change->value != 0.0,
+				desc->name);
+		else
+			format_vcd_value_real(out, change->value, desc->name);
+
+		/* Keep the channel in the heap while it has more to write. */
+		if (desc->queue_head == desc->queue_tail) {
+			desc->queue_head = desc->queue_tail = 0;
+			heap[0] = heap[--count];
+		} else if (desc->queue[desc->queue_head].samplenum >= upto_snum) {
+			heap[0] = heap[--count];
+		}
+		if (count)
+			heap_sift_down(heap, count, 0);
+	}
+	if (with_queue_stats && dumped)
+		sr_dbg("%s(), dumped %zu changes", __func__, dumped);
+
+	return SR_OK;
+}
+
+/*
+ * Check a logic sample for changes against the previous one, and queue
+ * or emit the text for the changed channels' values.
+ */
+static void receive_logic_sample(struct context *ctx, GString *out,
+	const uint8_t *sample, size_t unit_size, uint64_t snum_curr)
+{
+	struct vcd_channel_desc *desc;
+	size_t index, p;
+	gboolean changed;
+	uint8_t *last_logic, prevbit, curbit;
+	double ts;
+
+	/* Check whether any logic value has changed. */
+	last_logic = ctx->last_logic;
+	changed = memcmp(last_logic, sample, unit_size) != 0;
+	changed |= snum_curr == 0;
+	if (!changed)
+		return;
+	memcpy(last_logic, sample, unit_size);
 
+	/* Avoid the queue for logic-only setups. */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(out, ts, FALSE);
+	}
+
+	/* Iterate over individual logic channels. */
+	for (p = 0; p < ctx->enabled_count; p++) {
 		/*
-		 * Unlink the item from the list. Void cached positions.
-		 * Append its timestamp and values to the caller's text.
+		 * TODO Check whether the mapping from
+		 * data image positions to channel numbers
+		 * is required. Experiments suggest that
+		 * the data image "is dense", and packs
+		 * bits of enabled channels, and leaves no
+		 * room for positions of disabled channels.
 		 */
-		dumped++;
-		if (with_queue_stats)
-			sr_dbg("%s(), dump nr %" PRIu64,
-				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
-		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
-		if (rc != SR_OK)
-			return rc;
+		desc = &ctx->channels[p];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		index = desc->index;
+		prevbit = desc->last.logic;
+
+		/* Skip over unchanged values. */
+		curbit = sample[index / 8];
+		curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
+		if (snum_curr != 0 && prevbit == curbit)
+			continue;
+		desc->last.logic = curbit;
+
+		/*
+		 * Queue, or immediately emit the text for
+		 * the observed value change.
+		 */
+		if (ctx->immediate_write) {
+			g_string_append_c(out, ' ');
+			format_vcd_value_bit(out, curbit, desc->name);
+		} else if (queue_change(ctx, desc, snum_curr, curbit) != SR_OK) {
+			break;
+		}
 	}
+}
 
-	return SR_OK;
+/* Get up to 64 bits of logic data, in little endian bit order. */
+static uint64_t load_logic_word(const uint8_t *p, size_t len)
+{
+	uint64_t word;
+
+	if (len >= sizeof(word))
+		return RL64(p);
+	word = 0;
+	while (len--)
+		word |= (uint64_t)p[len] << (len * 8);
+
+	return word;
+}
+
+static unsigned int lowest_bit_pos(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	unsigned int pos;
+
+	pos = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		pos++;
+	}
+	return pos;
+#endif
+}
+
+/*
+ * Format the value changes of a block of logic samples. The XOR of a
+ * sample and its predecessor, taken 64 bits at a time, has the bits
+ * of the changed channels set. Unchanged samples cost a few compares,
+ * changed samples only visit the channels which did change.
+ */
+static void format_logic_block(struct context *ctx, GString *out,
+	const uint8_t *prev, const uint8_t *sample, size_t count,
+	uint64_t snum)
+{
+	size_t unit_size, offset, len;
+	uint64_t curr, diff;
+	unsigned int bit;
+	gboolean changed;
+	struct vcd_channel_desc *desc;
+
+	unit_size = ctx->logic_size;
+	while (count--) {
+		changed = FALSE;
+		for (offset = 0; offset < unit_size; offset += sizeof(diff)) {
+			len = MIN(unit_size - offset, sizeof(diff));
+			curr = load_logic_word(&sample[offset], len);
+			diff = curr ^ load_logic_word(&prev[offset], len);
+			/* The first sample has all values dumped. */
+			if (snum == 0)
+				diff = ~UINT64_C(0);
+			diff &= load_logic_word(&ctx->logic_mask[offset], len);
+			while (diff) {
+				bit = lowest_bit_pos(diff);
+				diff &= diff - 1;
+				if (!changed) {
+					append_vcd_timestamp(out,
+						snum_to_ts(ctx, snum), FALSE);
+					changed = TRUE;
+				}
+				desc = ctx->bit_desc[offset * 8 + bit];
+				g_string_append_c(out, ' ');
+				format_vcd_value_bit(out, (curr >> bit) & 1,
+					desc->name);
+			}
+		}
+		prev = sample;
+		sample += unit_size;
+		snum++;
+	}
+}
+
+static void format_job_run(gpointer data, gpointer user_data)
+{
+	struct format_job *job;
+	struct context *ctx;
+
+	job = data;
+	ctx = user_data;
+	sr_thread_sched_enter(ctx->session, SR_THREAD_OUTPUT);
+	format_logic_block(ctx, job->text, job->prev, job->samples,
+		job->count, job->snum);
+
+	g_mutex_lock(&ctx->jobs_mutex);
+	ctx->jobs_pending--;
+	g_cond_signal(&ctx->jobs_cond);
+	g_mutex_unlock(&ctx->jobs_mutex);
+}
+
+/*
+ * Format the value changes of a logic packet in the logic only setup.
+ * Large packets get cut into blocks for the worker pool. Each block's
+ * text is independent, the predecessor of a block's first sample is
+ * the previous block's last sample. Blocks' text gets appended in the
+ * order of their sample numbers.
+ */
+static void receive_logic_blocks(struct context *ctx, GString *out,
+	const uint8_t *samples, size_t count, uint64_t snum)
+{
+	struct format_job *jobs, *job;
+	size_t unit_size, job_count, job_size, idx, ch_idx;
+	struct vcd_channel_desc *desc;
+
+	if (!count)
+		return;
+	unit_size = ctx->logic_size;
+
+	job_count = 0;
+	if (ctx->pool)
+		job_count = MIN(ctx->num_threads, count / THREAD_MIN_SAMPLES);
+	if (job_count > 1) {
+		jobs = g_malloc0_n(job_count, sizeof(jobs[0]));
+		job_size = count / job_count;
+		for (idx = 0; idx < job_count; idx++) {
+			job = &jobs[idx];
+			job->ctx = ctx;
+			job->samples = &samples[idx * job_size * unit_size];
+			job->prev = idx ? job->samples - unit_size : ctx->last_logic;
+			job->count = job_size;
+			if (idx + 1 == job_count)
+				job->count = count - idx * job_size;
+			job->snum = snum + idx * job_size;
+			job->text = g_string_sized_new(job->count * 4);
+		}
+		g_mutex_lock(&ctx->jobs_mutex);
+		ctx->jobs_pending = job_count;
+		g_mutex_unlock(&ctx->jobs_mutex);
+		for (idx = 0; idx < job_count; idx++)
+			g_thread_pool_push(ctx->pool, &jobs[idx], NULL);
+		g_mutex_lock(&ctx->jobs_mutex);
+		while (ctx->jobs_pending)
+			g_cond_wait(&ctx->jobs_cond, &ctx->jobs_mutex);
+		g_mutex_unlock(&ctx->jobs_mutex);
+		for (idx = 0; idx < job_count; idx++) {
+			job = &jobs[idx];
+			g_string_append_len(out, job->text->str, job->text->len);
+			g_string_free(job->text, TRUE);
+		}
+		g_free(jobs);
+	} else {
+		format_logic_block(ctx, out, ctx->last_logic, samples,
+			count, snum);
+	}
+
+	/* Keep the most recent values for the next packet. */
+	samples += (count - 1) * unit_size;
+	memcpy(ctx->last_logic, samples, unit_size);
+	for (ch_idx = 0; ch_idx < ctx->enabled_count; ch_idx++) {
+		desc = &ctx->channels[ch_idx];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (desc->index >= unit_size * 8)
+			continue;
+		desc->last.logic = (samples[desc->index / 8] >>
+			(desc->index % 8)) & 1;
+	}
 }
 
 /* Get packets from the session feed, generate output text. */
-static int receive(const struct sr_output *o,
-	const struct sr_datafeed_packet *packet, GString **out)
+static int receive_append(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size;
 	gboolean changed;
-	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	uint8_t *sample;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
 	double ts;
 
-	*out = NULL;
 	if (!o || !o->priv)
 		return SR_ERR_BUG;
 	ctx = o->priv;
@@ -1017,7 +1050,7 @@ static int receive(const struct sr_output *o,
 		}
 		break;
 	case SR_DF_LOGIC:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		logic = packet->payload;
 		sample = logic->data;
@@ -1026,73 +1059,45 @@ static int receive(const struct sr_output *o,
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
 
-		last_logic = ctx->last_logic;
+		if (ctx->logic_size && unit_size == ctx->logic_size) {
+			receive_logic_blocks(ctx, out, sample, count,
+				snum_curr);
+			break;
+		}
 		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
-			}
-
+			receive_logic_sample(ctx, out, sample, unit_size,
+				snum_curr);
 			/* Advance to next set of logic samples. */
 			snum_curr++;
 			sample += unit_size;
 		}
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
+		break;
+	case SR_DF_LOGIC_RLE:
+		chk_header(o, out);
+
+		/*
+		 * Only the first sample of a run can differ from its
+		 * predecessor. The run's other samples just advance
+		 * the sample number.
+		 */
+		rle = packet->payload;
+		sample = rle->values;
+		unit_size = rle->unitsize;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, sr_logic_rle_sample_count(rle));
+
+		for (run = 0; run < rle->num_runs; run++) {
+			if (rle->run_lengths[run])
+				receive_logic_sample(ctx, out, sample,
+					unit_size, snum_curr);
+			snum_curr += rle->run_lengths[run];
+			sample += unit_size;
+		}
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_ANALOG:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		/*
 		 * This implementation expects one analog packet per
@@ -1150,25 +1155,25 @@ static int receive(const struct sr_output *o,
 			/* Queue, or emit the timestamp and the new value. */
 			if (ctx->immediate_write) {
 				ts = snum_to_ts(ctx, snum_curr + index);
-				append_vcd_timestamp(*out, ts, FALSE);
-				s_val = *out;
-			} else {
-				queue_samplenum(ctx, snum_curr + index);
-				s_val = queue_value_text_prep(ctx);
+				append_vcd_timestamp(out, ts, FALSE);
+				format_vcd_value_real(out, value, desc->name);
+			} else if (queue_change(ctx, desc, snum_curr + index,
+					value) != SR_OK) {
+				g_free(floats);
+				return SR_ERR_MALLOC;
 			}
-			format_vcd_value_real(s_val, value, desc->name);
 		}
 
 		g_free(floats);
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_END:
-		*out = chk_header(o);
-		/* Push the final timestamp as length indicator. */
+		chk_header(o, out);
 		snum_curr = get_max_snum_flush(ctx);
-		queue_samplenum(ctx, snum_curr);
 		/* Flush previously queued value changes. */
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
+		/* Push the final timestamp as length indicator. */
+		append_vcd_timestamp(out, snum_to_ts(ctx, snum_curr), TRUE);
 		break;
 	}
 
@@ -1185,32 +1190,48 @@ static int cleanup(struct sr_output *o)
 
 	ctx = o->priv;
 
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
-	queue_drain_pool(ctx);
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
-
+	if (ctx->pool) {
+		g_thread_pool_free(ctx->pool, FALSE, TRUE);
+		g_mutex_clear(&ctx->jobs_mutex);
+		g_cond_clear(&ctx->jobs_cond);
+	}
 	while (ctx->enabled_count--) {
 		desc = &ctx->channels[ctx->enabled_count];
 		g_string_free(desc->name, TRUE);
+		g_free(desc->queue);
 	}
 	g_free(ctx->channels);
+	g_free(ctx->merge_heap);
+	g_free(ctx->last_logic);
+	g_free(ctx->logic_mask);
+	g_free(ctx->bit_desc);
+	sr_mem_account_free(ctx->account);
 	g_free(ctx);
 
 	return SR_OK;
 }
 
+static struct sr_option options[] = {
+	{"threads", "Formatting threads", "Number of threads formatting logic data of large packets, 0 for one per CPU", NULL, NULL},
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(1));
+
+	return options;
+}
+
 struct sr_output_module output_vcd = {
 	.id = "vcd",
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
-	.options = NULL,
+	.flags = SR_OUTPUT_LOGIC_RLE,
+	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive_append,
 	.cleanup = cleanup,
 };
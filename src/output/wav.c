@@ -18,85 +18,78 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/wav"
 
-/* Minimum/maximum number of samples per channel to put in a data chunk */
-#define MIN_DATA_CHUNK_SAMPLES 10
+enum sample_format {
+	FORMAT_FLOAT,
+	FORMAT_INT16,
+	FORMAT_INT24,
+};
+
+static const struct {
+	const char *name;
+	uint16_t format_code;
+	size_t size;
+} sample_formats[] = {
+	/* Format codes: 3 = IEEE float, 1 = PCM (integer). */
+	[FORMAT_FLOAT] = { "float", 0x0003, 4, },
+	[FORMAT_INT16] = { "int16", 0x0001, 2, },
+	[FORMAT_INT24] = { "int24", 0x0001, 3, },
+};
 
 struct out_context {
 	double scale;
+	enum sample_format format;
+	size_t sample_size;
 	gboolean header_done;
 	uint64_t samplerate;
 	int num_channels;
 	GSList *channels;
-	int chanbuf_size;
-	int *chanbuf_used;
-	uint8_t **chanbuf;
+	int *chan_idx;
+	/*
+	 * Interleaved frames which not all channels have provided data
+	 * for yet. Channels' values get written to their final position
+	 * in the frame as they arrive.
+	 */
+	uint8_t *frames;
+	size_t frames_size;
+	size_t *frames_used;
 	float *fdata;
+	size_t fdata_size;
 };
 
-static int realloc_chanbufs(const struct sr_output *o, int size)
-{
-	struct out_context *outc;
-	int i;
-
-	outc = o->priv;
-	for (i = 0; i < outc->num_channels; i++) {
-		if (!(outc->chanbuf[i] = g_try_realloc(outc->chanbuf[i], sizeof(float) * size))) {
-			sr_err("Unable to allocate enough output buffer memory.");
-			return SR_ERR;
-		}
-		outc->chanbuf_used[i] = 0;
-	}
-	outc->chanbuf_size = size;
-
-	return SR_OK;
-}
-
-static int flush_chanbufs(const struct sr_output *o, GString *out)
-{
-	struct out_context *outc;
-	int num_samples, i, j;
-	char *buf, *bufp;
-
-	outc = o->priv;
-
-	/* Any one of them will do. */
-	num_samples = outc->chanbuf_used[0];
-	if (!(buf = g_try_malloc(4 * num_samples * outc->num_channels))) {
-		sr_err("Unable to allocate enough interleaved output buffer memory.");
-		return SR_ERR;
-	}
-
-	bufp = buf;
-	for (i = 0; i < num_samples; i++) {
-		for (j = 0; j < outc->num_channels; j++) {
-			memcpy(bufp, outc->chanbuf[j] + i * 4, 4);
-			bufp += 4;
-		}
-	}
-	g_string_append_len(out, buf, 4 * num_samples * outc->num_channels);
-	g_free(buf);
-
-	for (i = 0; i < outc->num_channels; i++)
-		outc->chanbuf_used[i] = 0;
-
-	return SR_OK;
-}
-
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
 	struct sr_channel *ch;
 	GSList *l;
+	const char *format;
+	size_t i;
 
 	outc = g_malloc0(sizeof(struct out_context));
 	o->priv = outc;
 	outc->scale = g_variant_get_double(g_hash_table_lookup(options, "scale"));
+	if (outc->scale == 0.0)
+		outc->scale = 1.0;
+
+	format = g_variant_get_string(g_hash_table_lookup(options, "format"), NULL);
+	for (i = 0; i < ARRAY_SIZE(sample_formats); i++) {
+		if (g_ascii_strcasecmp(format, sample_formats[i].name) == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(sample_formats)) {
+		sr_err("Unsupported sample format '%s'.", format);
+		g_free(outc);
+		o->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	outc->format = i;
+	outc->sample_size = sample_formats[i].size;
 
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -108,11 +101,8 @@ static int init(struct sr_output *o, GHashTable *options)
 		outc->num_channels++;
 	}
 
-	outc->chanbuf = g_malloc0(sizeof(float *) * outc->num_channels);
-	outc->chanbuf_used = g_malloc0(sizeof(int) * outc->num_channels);
-
-	/* Start off the interleaved buffer with 100 samples/channel. */
-	realloc_chanbufs(o, 100);
+	outc->chan_idx = g_malloc0(sizeof(int) * (outc->num_channels + 1));
+	outc->frames_used = g_malloc0(sizeof(size_t) * (outc->num_channels + 1));
 
 	return SR_OK;
 }
@@ -121,14 +111,15 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 {
 	struct out_context *outc;
 	char tmp[4];
+	size_t frame_size;
 
 	outc = o->priv;
+	frame_size = outc->num_channels * outc->sample_size;
 	g_string_append(gs, "fmt ");
 	/* Remaining chunk size */
 	WL32(tmp, 0x12);
 	g_string_append_len(gs, tmp, 4);
-	/* Format code 3 = IEEE float */
-	WL16(tmp, 0x0003);
+	WL16(tmp, sample_formats[outc->format].format_code);
 	g_string_append_len(gs, tmp, 2);
 	/* Number of channels */
 	WL16(tmp, outc->num_channels);
@@ -136,14 +127,14 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Samplerate */
 	WL32(tmp, outc->samplerate);
 	g_string_append_len(gs, tmp, 4);
-	/* Byterate, using 32-bit floats. */
-	WL32(tmp, outc->samplerate * outc->num_channels * 4);
+	/* Byterate */
+	WL32(tmp, outc->samplerate * frame_size);
 	g_string_append_len(gs, tmp, 4);
 	/* Blockalign */
-	WL16(tmp, outc->num_channels * 4);
+	WL16(tmp, frame_size);
 	g_string_append_len(gs, tmp, 2);
 	/* Bits per sample */
-	WL16(tmp, 32);
+	WL16(tmp, 8 * outc->sample_size);
 	g_string_append_len(gs, tmp, 2);
 	WL16(tmp, 0);
 	g_string_append_len(gs, tmp, 2);
@@ -181,56 +172,75 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
-/*
- * Stores the float in little-endian BINARY32 IEEE-754 2008 format.
- */
-static void float_to_le(uint8_t *buf, float value)
+/* Convert a value to a full scale integer, with clipping. */
+static inline int32_t float_to_int(float value, float full_scale)
 {
-	uint8_t *old;
-
-	old = (uint8_t *)&value;
-#ifdef WORDS_BIGENDIAN
-	buf[0] = old[3];
-	buf[1] = old[2];
-	buf[2] = old[1];
-	buf[3] = old[0];
-#else
-	buf[0] = old[0];
-	buf[1] = old[1];
-	buf[2] = old[2];
-	buf[3] = old[3];
-#endif
+	value *= full_scale;
+	if (value >= full_scale - 1)
+		return full_scale - 1;
+	if (value <= -full_scale)
+		return -full_scale;
+
+	return lrintf(value);
 }
 
 /*
- * Returns the number of samples used in the current channel buffers,
- * or -1 if they're not all the same.
+ * Write a channel's values to their positions in interleaved frames.
+ * The loops are kept simple, so that compilers can vectorize them.
  */
-static int check_chanbuf_size(const struct sr_output *o)
+static void write_samples(const struct out_context *outc, uint8_t *dest,
+	size_t dest_stride, const float *src, size_t src_stride, size_t count)
 {
-	struct out_context *outc;
-	int size, i;
-
-	outc = o->priv;
-	size = 0;
-	for (i = 0; i < outc->num_channels; i++) {
-		if (size == 0) {
-			if (outc->chanbuf_used[i] == 0) {
-				/* Nothing in all the buffers yet. */
-				size = -1;
-				break;
-			} else {
-				/* New high water mark. */
-				size = outc->chanbuf_used[i];
-			}
-		} else if (outc->chanbuf_used[i] != size) {
-			/* All channel buffers are not equally full yet. */
-			size = -1;
-			break;
+	float scale, value;
+	size_t i;
+
+	scale = 1.0 / outc->scale;
+	switch (outc->format) {
+	case FORMAT_FLOAT:
+		for (i = 0; i < count; i++) {
+			value = src[i * src_stride] * scale;
+			write_fltle(dest, value);
+			dest += dest_stride;
 		}
+		break;
+	case FORMAT_INT16:
+		for (i = 0; i < count; i++) {
+			value = src[i * src_stride] * scale;
+			write_u16le(dest, float_to_int(value, 32768.0));
+			dest += dest_stride;
+		}
+		break;
+	case FORMAT_INT24:
+		for (i = 0; i < count; i++) {
+			value = src[i * src_stride] * scale;
+			write_u24le(dest, float_to_int(value, 8388608.0));
+			dest += dest_stride;
+		}
+		break;
 	}
+}
 
-	return size;
+/* Move the frames which all channels have data for to the output. */
+static void flush_frames(struct out_context *outc, GString *out)
+{
+	size_t frame_size, count, max_used;
+	int i;
+
+	count = max_used = outc->frames_used[0];
+	for (i = 1; i < outc->num_channels; i++) {
+		count = MIN(count, outc->frames_used[i]);
+		max_used = MAX(max_used, outc->frames_used[i]);
+	}
+	if (!count)
+		return;
+
+	frame_size = outc->num_channels * outc->sample_size;
+	g_string_append_len(out, (const char *)outc->frames,
+		count * frame_size);
+	memmove(outc->frames, outc->frames + count * frame_size,
+		(max_used - count) * frame_size);
+	for (i = 0; i < outc->num_channels; i++)
+		outc->frames_used[i] -= count;
 }
 
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
@@ -240,13 +250,13 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
-	struct sr_channel *ch;
 	GSList *l;
 	const GSList *channels;
-	float f;
-	int num_channels, num_samples, size, *chan_idx, idx, i, j, ret;
-	float *data;
+	size_t num_samples, frame_size, size, used, length;
+	int num_channels, idx, i, ret;
+	gboolean direct;
 	uint8_t *buf;
+	float *data;
 
 	*out = NULL;
 	if (!o || !o->sdi || !(outc = o->priv))
@@ -266,66 +276,83 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (!outc->header_done) {
 			*out = gen_header(o);
 			outc->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		analog = packet->payload;
 		num_samples = analog->num_samples;
 		channels = analog->meaning->channels;
 		num_channels = g_slist_length(analog->meaning->channels);
-		if (!(data = g_try_realloc(outc->fdata, sizeof(float) * num_samples * num_channels)))
-			return SR_ERR_MALLOC;
-		outc->fdata = data;
-		ret = sr_analog_to_float(analog, data);
-		if (ret != SR_OK)
-			return ret;
-
-		if (num_samples == 0)
+		if (!num_samples || !num_channels)
 			return SR_OK;
-
 		if (num_channels > outc->num_channels) {
 			sr_err("Packet has %d channels, but only %d were enabled.",
 					num_channels, outc->num_channels);
 			return SR_ERR;
 		}
 
-		if (num_samples > outc->chanbuf_size) {
-			if (realloc_chanbufs(o, analog->num_samples) != SR_OK)
+		size = num_samples * num_channels;
+		if (size > outc->fdata_size) {
+			if (!(data = g_try_realloc(outc->fdata, sizeof(float) * size)))
 				return SR_ERR_MALLOC;
+			outc->fdata = data;
+			outc->fdata_size = size;
 		}
+		data = outc->fdata;
+		ret = sr_analog_to_float(analog, data);
+		if (ret != SR_OK)
+			return ret;
 
-		/* Index the channels in this packet, so we can interleave quicker. */
-		chan_idx = g_malloc(sizeof(int) * outc->num_channels);
-		for (i = 0; i < num_channels; i++) {
-			ch = g_slist_nth_data((GSList *) channels, i);
-			chan_idx[i] = g_slist_index(outc->channels, ch);
+		/*
+		 * Index the packet's channels. Packets which cover all
+		 * channels get interleaved straight into the output when
+		 * no partial frames are pending.
+		 */
+		direct = num_channels == outc->num_channels;
+		for (i = 0, l = (GSList *)channels; l; i++, l = l->next) {
+			idx = g_slist_index(outc->channels, l->data);
+			outc->chan_idx[i] = idx;
+			if (idx < 0 || outc->frames_used[idx])
+				direct = FALSE;
 		}
 
-		for (i = 0; i < num_samples; i++) {
-			for (j = 0; j < num_channels; j++) {
-				idx = chan_idx[j];
-				buf = outc->chanbuf[idx] + outc->chanbuf_used[idx]++ * 4;
-				f = data[i * num_channels + j];
-				if (outc->scale != 1.0)
-					f /= outc->scale;
-				float_to_le(buf, f);
+		frame_size = outc->num_channels * outc->sample_size;
+		if (!*out)
+			*out = g_string_sized_new(num_samples * frame_size);
+		if (direct) {
+			length = (*out)->len;
+			g_string_set_size(*out, length + num_samples * frame_size);
+			buf = (uint8_t *)(*out)->str + length;
+			for (i = 0; i < num_channels; i++) {
+				write_samples(outc,
+					buf + outc->chan_idx[i] * outc->sample_size,
+					frame_size, data + i, num_channels,
+					num_samples);
 			}
+			break;
 		}
-		g_free(chan_idx);
 
-		size = check_chanbuf_size(o);
-		if (size > MIN_DATA_CHUNK_SAMPLES)
-			if (flush_chanbufs(o, *out) != SR_OK)
-				return SR_ERR;
-		break;
-	case SR_DF_END:
-		size = check_chanbuf_size(o);
-		if (size > 0) {
-			*out = g_string_sized_new(4 * size * outc->num_channels);
-			if (flush_chanbufs(o, *out) != SR_OK)
-				return SR_ERR;
+		/* Keep values of the channels which are ahead of others. */
+		for (i = 0; i < num_channels; i++) {
+			idx = outc->chan_idx[i];
+			if (idx < 0)
+				continue;
+			used = outc->frames_used[idx];
+			if (used + num_samples > outc->frames_size) {
+				size = MAX(used + num_samples, 2 * outc->frames_size);
+				buf = g_try_realloc(outc->frames, size * frame_size);
+				if (!buf) {
+					sr_err("Unable to allocate enough output buffer memory.");
+					return SR_ERR_MALLOC;
+				}
+				outc->frames = buf;
+				outc->frames_size = size;
+			}
+			buf = outc->frames + used * frame_size;
+			write_samples(outc, buf + idx * outc->sample_size,
+				frame_size, data + i, num_channels, num_samples);
+			outc->frames_used[idx] += num_samples;
 		}
+		flush_frames(outc, *out);
 		break;
 	}
 
@@ -334,13 +361,24 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 static struct sr_option options[] = {
 	{ "scale", "Scale", "Scale values by factor", NULL, NULL },
+	{ "format", "Sample format", "Sample format (float, int16, int24)", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
-	if (!options[0].def)
+	size_t i;
+
+	if (!options[0].def) {
 		options[0].def = g_variant_ref_sink(g_variant_new_double(1.0));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(
+			sample_formats[FORMAT_FLOAT].name));
+		for (i = 0; i < ARRAY_SIZE(sample_formats); i++) {
+			options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string(
+					sample_formats[i].name)));
+		}
+	}
 
 	return options;
 }
@@ -348,15 +386,14 @@ static const struct sr_option *get_options(void)
 static int cleanup(struct sr_output *o)
 {
 	struct out_context *outc;
-	int i;
 
 	outc = o->priv;
+	if (!outc)
+		return SR_OK;
 	g_slist_free(outc->channels);
-	g_variant_unref(options[0].def);
-	for (i = 0; i < outc->num_channels; i++)
-		g_free(outc->chanbuf[i]);
-	g_free(outc->chanbuf_used);
-	g_free(outc->chanbuf);
+	g_free(outc->chan_idx);
+	g_free(outc->frames);
+	g_free(outc->frames_used);
 	g_free(outc->fdata);
 	g_free(outc);
 	o->priv = NULL;
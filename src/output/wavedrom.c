@@ -24,100 +24,188 @@
 
 #define LOG_PREFIX "output/wavedrom"
 
+/*
+ * The channels' waves are kept run length encoded while the data comes
+ * in. Levels alternate between runs, so the first level and the length
+ * of each run are all that's needed. This matches the WaveDrom syntax
+ * for repeated levels, where a run becomes its level's letter followed
+ * by one '.' per further sample, and keeps the memory consumption in
+ * proportion to the number of edges instead of the number of samples.
+ *
+ * The JSON document lists the channels one after another, so the text
+ * still can only be generated when all data was received.
+ */
+struct wave_channel {
+	struct sr_channel *channel;
+	GArray *runs; /* uint64_t lengths of completed runs */
+	uint64_t run; /* length of the current run, 0 if none yet */
+	uint8_t first_level;
+	uint8_t level;
+};
+
 struct context {
-	uint32_t channel_count;
-	struct sr_channel **channels;
-	GString **channel_outputs; /* output strings */
+	size_t channel_count;
+	struct wave_channel *channels;
+	struct sr_bitslice *slice;
+	/* Keep one out of this many samples. */
+	uint64_t decimate;
+	uint64_t sample_pos;
+	uint64_t num_points;
+	/* The runs are charged to the session's memory budget. */
+	struct sr_mem_account *account;
+	size_t charged;
 };
 
+static void add_level(struct wave_channel *wc, uint8_t level)
+{
+	if (!wc->run) {
+		wc->first_level = wc->level = level;
+		wc->run = 1;
+		return;
+	}
+	if (level == wc->level) {
+		wc->run++;
+		return;
+	}
+	g_array_append_val(wc->runs, wc->run);
+	wc->level = level;
+	wc->run = 1;
+}
+
+/* Extend the runs by the samples in a channel's bit plane. */
+static void add_plane(struct wave_channel *wc, const uint8_t *plane,
+	size_t count)
+{
+	size_t k;
+
+	k = 0;
+	while (k < count) {
+		/* Whole bytes which continue the current run. */
+		if (wc->run && !(k % 8) && count - k >= 8 &&
+				plane[k / 8] == (wc->level ? 0xff : 0x00)) {
+			wc->run += 8;
+			k += 8;
+			continue;
+		}
+		add_level(wc, sr_bitplane_bit(plane, k));
+		k++;
+	}
+}
+
+static void append_wave(GString *output, const struct wave_channel *wc)
+{
+	static const char dots[] = "................................";
+	uint64_t len, n;
+	size_t i;
+	char level;
+
+	if (!wc->run)
+		return;
+
+	level = wc->first_level ? '1' : '0';
+	for (i = 0; i <= wc->runs->len; i++) {
+		if (i < wc->runs->len)
+			len = g_array_index(wc->runs, uint64_t, i);
+		else
+			len = wc->run;
+		/* Data point, and its continuation. */
+		g_string_append_c(output, level);
+		for (len--; len; len -= n) {
+			n = MIN(len, sizeof(dots) - 1);
+			g_string_append_len(output, dots, n);
+		}
+		level = (level == '1') ? '0' : '1';
+	}
+}
+
 /* Converts accumulated output data to a JSON string. */
 static GString *wavedrom_render(const struct context *ctx)
 {
 	GString *output;
-	size_t ch, i;
-	char last_char, curr_char;
+	size_t ch;
 
-	output = g_string_new("{ \"signal\": [");
+	output = g_string_sized_new(64 + ctx->channel_count *
+		(ctx->num_points + 32));
+	g_string_append(output, "{ \"signal\": [");
 	for (ch = 0; ch < ctx->channel_count; ch++) {
-		if (!ctx->channel_outputs[ch])
-			continue;
-
 		/* Channel strip. */
+		if (ch)
+			g_string_append(output, ",");
 		g_string_append_printf(output,
-			"{ \"name\": \"%s\", \"wave\": \"", ctx->channels[ch]->name);
-
-		last_char = 0;
-		for (i = 0; i < ctx->channel_outputs[ch]->len; i++) {
-			curr_char = ctx->channel_outputs[ch]->str[i];
-			/* Data point. */
-			if (curr_char == last_char) {
-				g_string_append_c(output, '.');
-			} else {
-				g_string_append_c(output, curr_char);
-				last_char = curr_char;
-			}
-		}
-		if (ch < ctx->channel_count - 1) {
-			g_string_append(output, "\" },");
-		} else {
-			/* Last channel, no comma. */
-			g_string_append(output, "\" }");
-		}
+			"{ \"name\": \"%s\", \"wave\": \"",
+			ctx->channels[ch].channel->name);
+		append_wave(output, &ctx->channels[ch]);
+		g_string_append(output, "\" }");
 	}
 	g_string_append(output, "], \"config\": { \"skin\": \"narrow\" }}");
 
 	return output;
 }
 
-static void process_logic(const struct context *ctx,
+static void process_logic(struct context *ctx,
 	const struct sr_datafeed_logic *logic)
 {
-	size_t sample_count, ch, i;
-	uint8_t *sample, bit;
-	GString *accu;
+	struct wave_channel *wc;
+	const uint8_t *sample;
+	size_t sample_count, count, ch, i;
+	int idx;
 
-	if (!ctx->channel_count)
+	if (!ctx->channel_count || !logic->unitsize)
 		return;
 
 	/*
-	 * Extract the logic bits for each channel and store them
-	 * as wavedrom letters (1/0) in each channel's text string.
-	 * This transforms the input which consists of sample sets
-	 * that span multiple channels into output stripes per logic
-	 * channel which consist of bits for that individual channel.
-	 *
-	 * TODO Reduce memory consumption during accumulation of
-	 * output data.
-	 *
-	 * Ideally we'd accumulate binary chunks, and defer conversion
-	 * to the text format. Analog data already won't get here, only
-	 * logic data does. When the per-channel transformation also
-	 * gets deferred until later, then the only overhead would be
-	 * for disabled logic channels. Which may be acceptable or even
-	 * negligable.
-	 *
-	 * An optional addition to the above mentioned accumulation of
-	 * binary data is RLE compression. Mark both the position in the
-	 * accumulated data as well as a repetition counter, instead of
-	 * repeatedly storing the same sample set. The efficiency of
-	 * this approach of course depends on the change rate of input
-	 * data. But the approach perfectly matches the WaveDrom syntax
-	 * for repeated bit patterns, and thus is easily handled in the
-	 * text rendering stage of the output module.
+	 * Extract the logic bits for each channel and extend that
+	 * channel's runs. Without decimation, blocks of samples get
+	 * sliced into per-channel bit planes, and bytes of eight
+	 * samples which continue a run get taken in one go.
 	 */
 	sample_count = logic->length / logic->unitsize;
-	for (i = 0; i < sample_count; i++) {
-		sample = logic->data + i * logic->unitsize;
+	sample = logic->data;
+	if (ctx->decimate == 1) {
+		ctx->num_points += sample_count;
+		while (sample_count) {
+			count = sr_bitslice_load(ctx->slice, sample,
+				logic->unitsize, sample_count);
+			for (ch = 0; ch < ctx->channel_count; ch++) {
+				add_plane(&ctx->channels[ch],
+					sr_bitslice_plane(ctx->slice, ch), count);
+			}
+			sample += count * logic->unitsize;
+			sample_count -= count;
+		}
+		return;
+	}
+
+	for (i = 0; i < sample_count; i++, sample += logic->unitsize) {
+		if (ctx->sample_pos++ % ctx->decimate)
+			continue;
+		ctx->num_points++;
 		for (ch = 0; ch < ctx->channel_count; ch++) {
-			accu = ctx->channel_outputs[ch];
-			if (!accu)
+			wc = &ctx->channels[ch];
+			idx = wc->channel->index;
+			if ((size_t)idx >= logic->unitsize * 8) {
+				add_level(wc, 0);
 				continue;
-			bit = sample[ch / 8] & (1 << (ch % 8));
-			g_string_append_c(accu, bit ? '1' : '0');
+			}
+			add_level(wc, (sample[idx / 8] >> (idx % 8)) & 1);
 		}
 	}
 }
 
+/* Charge the growth of the recorded runs. */
+static void charge_runs(struct context *ctx)
+{
+	size_t size, ch;
+
+	size = 0;
+	for (ch = 0; ch < ctx->channel_count; ch++)
+		size += ctx->channels[ch].runs->len * sizeof(uint64_t);
+	if (size <= ctx->charged)
+		return;
+	sr_mem_account_charge(ctx->account, size - ctx->charged);
+	ctx->charged = size;
+}
+
 static int receive(const struct sr_output *o,
 	const struct sr_datafeed_packet *packet, GString **out)
 {
@@ -133,6 +221,7 @@ static int receive(const struct sr_output *o,
 	switch (packet->type) {
 	case SR_DF_LOGIC:
 		process_logic(ctx, packet->payload);
+		charge_runs(ctx);
 		break;
 	case SR_DF_END:
 		*out = wavedrom_render(ctx);
@@ -147,28 +236,36 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct context *ctx;
 	struct sr_channel *channel;
 	GSList *l;
+	int *channel_index;
 	size_t i;
 
-	(void)options;
-
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
 	o->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->account = sr_mem_account_new(o->sdi->session, "output");
 
-	ctx->channel_count = g_slist_length(o->sdi->channels);
-	ctx->channels = g_malloc0(
-		sizeof(ctx->channels[0]) * ctx->channel_count);
-	ctx->channel_outputs = g_malloc0(
-		sizeof(ctx->channel_outputs[0]) * ctx->channel_count);
+	ctx->decimate = g_variant_get_uint32(g_hash_table_lookup(options,
+		"decimate"));
+	if (!ctx->decimate)
+		ctx->decimate = 1;
 
-	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
+	ctx->channels = g_malloc0(sizeof(ctx->channels[0]) *
+		g_slist_length(o->sdi->channels));
+	channel_index = g_malloc0(sizeof(channel_index[0]) *
+		g_slist_length(o->sdi->channels));
+	for (l = o->sdi->channels; l; l = l->next) {
 		channel = l->data;
-		if (channel->enabled && channel->type == SR_CHANNEL_LOGIC) {
-			ctx->channels[i] = channel;
-			ctx->channel_outputs[i] = g_string_new(NULL);
-		}
+		if (!channel->enabled || channel->type != SR_CHANNEL_LOGIC)
+			continue;
+		i = ctx->channel_count++;
+		ctx->channels[i].channel = channel;
+		ctx->channels[i].runs = g_array_new(FALSE, FALSE,
+			sizeof(uint64_t));
+		channel_index[i] = channel->index;
 	}
+	ctx->slice = sr_bitslice_new(channel_index, ctx->channel_count);
+	g_free(channel_index);
 
 	return SR_OK;
 }
@@ -176,7 +273,7 @@ static int init(struct sr_output *o, GHashTable *options)
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	GString *s;
+	size_t ch;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -185,26 +282,39 @@ static int cleanup(struct sr_output *o)
 	o->priv = NULL;
 
 	if (ctx) {
-		while (--ctx->channel_count) {
-			s = ctx->channel_outputs[ctx->channel_count];
-			if (s)
-				g_string_free(s, TRUE);
-		}
-		g_free(ctx->channel_outputs);
+		for (ch = 0; ch < ctx->channel_count; ch++)
+			g_array_free(ctx->channels[ch].runs, TRUE);
 		g_free(ctx->channels);
+		sr_bitslice_free(ctx->slice);
+		sr_mem_account_free(ctx->account);
 		g_free(ctx);
 	}
 
 	return SR_OK;
 }
 
+static struct sr_option options[] = {
+	{ "decimate", "Decimation", "Keep one out of this many samples", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_new_uint32(1);
+		g_variant_ref_sink(options[0].def);
+	}
+
+	return options;
+}
+
 SR_PRIV struct sr_output_module output_wavedrom = {
 	.id = "wavedrom",
 	.name = "WaveDrom",
 	.desc = "WaveDrom.com file format",
 	.exts = (const char *[]){"wavedrom", "json", NULL},
 	.flags = 0,
-	.options = NULL,
+	.options = get_options,
 	.init = init,
 	.receive = receive,
 	.cleanup = cleanup,
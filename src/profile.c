@@ -0,0 +1,398 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Time spent finding, opening and starting devices.
+ *
+ * While profiling is enabled, the durations of driver scans, of device
+ * opens and of their phases (loading and uploading firmware, waiting
+ * for renumeration, configuring FPGAs, reading EEPROMs) and of
+ * acquisition starts get recorded, see sr_profile_records_get() and
+ * sr_profile_summary_log(). Phases are attributed to the driver and the
+ * device whose scan, open or start they happen in on the same thread.
+ * Setting the SIGROK_PROFILE environment variable enables profiling
+ * from the start, and logs the summary when the context gets released.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "profile"
+/** @endcond */
+
+/* Upper bound of kept records, older ones get dropped. */
+#define PROFILE_RECORDS_MAX 4096
+
+/* The innermost scope on the current thread. */
+static GPrivate current_scope;
+
+static const char *phase_names[] = {
+	[SR_PROFILE_SCAN] = "scan",
+	[SR_PROFILE_OPEN] = "open",
+	[SR_PROFILE_RESOURCE_LOAD] = "resource load",
+	[SR_PROFILE_FIRMWARE_UPLOAD] = "firmware upload",
+	[SR_PROFILE_RENUMERATION] = "renumeration",
+	[SR_PROFILE_FPGA_CONFIG] = "FPGA configuration",
+	[SR_PROFILE_EEPROM_READ] = "EEPROM read",
+	[SR_PROFILE_ACQUISITION_START] = "acquisition start",
+};
+
+static void record_free(void *data)
+{
+	struct sr_profile_record *rec;
+
+	rec = data;
+	g_free(rec->driver);
+	g_free(rec->device);
+	g_free(rec);
+}
+
+static struct sr_profile_record *record_copy(const struct sr_profile_record *rec)
+{
+	struct sr_profile_record *copy;
+
+	copy = g_memdup2(rec, sizeof(*rec));
+	copy->driver = g_strdup(rec->driver);
+	copy->device = g_strdup(rec->device);
+
+	return copy;
+}
+
+/**
+ * Enable or disable profiling of device scans, opens and starts.
+ *
+ * Records of earlier profiling are kept, see sr_profile_clear().
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param enable TRUE to record durations, FALSE to stop doing so.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid context passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_profile_enable(struct sr_context *ctx, gboolean enable)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&ctx->profile_enabled, enable ? 1 : 0);
+
+	return SR_OK;
+}
+
+/**
+ * Get the name of a profiling phase.
+ *
+ * @param phase The phase.
+ *
+ * @return The name, e.g. "firmware upload", or NULL for unknown phases.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_profile_phase_name(enum sr_profile_phase phase)
+{
+	if ((unsigned int)phase >= G_N_ELEMENTS(phase_names))
+		return NULL;
+
+	return phase_names[phase];
+}
+
+/**
+ * Get the profiling records of a context.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ *
+ * @return A list of struct sr_profile_record copies, in the order in
+ *         which the phases completed, or NULL if there are none. Must be
+ *         freed by the caller using sr_profile_records_free().
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_profile_records_get(struct sr_context *ctx)
+{
+	GSList *records;
+	GList *l;
+
+	if (!ctx)
+		return NULL;
+
+	records = NULL;
+	g_mutex_lock(&ctx->profile_mutex);
+	for (l = ctx->profile_records.tail; l; l = l->prev)
+		records = g_slist_prepend(records, record_copy(l->data));
+	g_mutex_unlock(&ctx->profile_mutex);
+
+	return records;
+}
+
+/**
+ * Release a list of profiling records.
+ *
+ * @param records The list, see sr_profile_records_get(). May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_profile_records_free(GSList *records)
+{
+	g_slist_free_full(records, record_free);
+}
+
+/**
+ * Drop the profiling records of a context.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid context passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_profile_clear(struct sr_context *ctx)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->profile_mutex);
+	while (!g_queue_is_empty(&ctx->profile_records))
+		record_free(g_queue_pop_head(&ctx->profile_records));
+	g_mutex_unlock(&ctx->profile_mutex);
+
+	return SR_OK;
+}
+
+/* Durations of a driver's scans, or of a device's phases. */
+struct summary_entry {
+	const char *driver;
+	const char *device;
+	int64_t total_us[SR_PROFILE_PHASES];
+	unsigned int count[SR_PROFILE_PHASES];
+};
+
+/**
+ * Log a summary of the profiling records of a context.
+ *
+ * One line per driver (scans) and per device (its phases) gets logged,
+ * with the total duration and the number of each phase. Phases which
+ * happen within others, like firmware loads within uploads, count in
+ * both.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_profile_summary_log(struct sr_context *ctx)
+{
+	GSList *records, *l;
+	GArray *entries;
+	struct sr_profile_record *rec;
+	struct summary_entry *e, entry;
+	GString *line;
+	size_t i;
+	int phase;
+
+	if (!ctx)
+		return;
+
+	records = sr_profile_records_get(ctx);
+	if (!records) {
+		sr_info("No profiling records.");
+		return;
+	}
+
+	entries = g_array_new(FALSE, TRUE, sizeof(struct summary_entry));
+	for (l = records; l; l = l->next) {
+		rec = l->data;
+		e = NULL;
+		for (i = 0; i < entries->len; i++) {
+			e = &g_array_index(entries, struct summary_entry, i);
+			if (!g_strcmp0(e->driver, rec->driver) &&
+					!g_strcmp0(e->device, rec->device))
+				break;
+			e = NULL;
+		}
+		if (!e) {
+			memset(&entry, 0, sizeof(entry));
+			entry.driver = rec->driver;
+			entry.device = rec->device;
+			g_array_append_val(entries, entry);
+			e = &g_array_index(entries, struct summary_entry,
+				entries->len - 1);
+		}
+		e->total_us[rec->phase] += rec->duration_us;
+		e->count[rec->phase]++;
+	}
+
+	line = g_string_sized_new(256);
+	for (i = 0; i < entries->len; i++) {
+		e = &g_array_index(entries, struct summary_entry, i);
+		g_string_printf(line, "%s%s%s:", e->driver ? e->driver : "-",
+			e->device ? " " : "", e->device ? e->device : "");
+		for (phase = 0; phase < SR_PROFILE_PHASES; phase++) {
+			if (!e->count[phase])
+				continue;
+			g_string_append_printf(line, " %s %.1f ms",
+				phase_names[phase], e->total_us[phase] / 1000.0);
+			if (e->count[phase] > 1)
+				g_string_append_printf(line, " (%u times)",
+					e->count[phase]);
+			g_string_append_c(line, ',');
+		}
+		g_string_truncate(line, line->len - 1);
+		sr_info("%s.", line->str);
+	}
+	g_string_free(line, TRUE);
+	g_array_free(entries, TRUE);
+	sr_profile_records_free(records);
+}
+
+static struct sr_context *sdi_ctx(const struct sr_dev_inst *sdi)
+{
+	struct drv_context *drvc;
+
+	if (!sdi || !sdi->driver || !sdi->driver->context)
+		return NULL;
+	drvc = sdi->driver->context;
+
+	return drvc->sr_ctx;
+}
+
+/**
+ * Start timing a phase.
+ *
+ * The context, driver and device which are not passed get taken from
+ * the enclosing scope on the same thread, if any. Each call must be
+ * paired with sr_profile_end() on the same thread, scopes nest.
+ *
+ * @param scope The scope of the phase, typically on the stack.
+ * @param ctx The context, or NULL.
+ * @param phase The phase.
+ * @param driver The driver, or NULL.
+ * @param sdi The device instance, or NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_profile_begin(struct sr_profile_scope *scope,
+		struct sr_context *ctx, enum sr_profile_phase phase,
+		const struct sr_dev_driver *driver, const struct sr_dev_inst *sdi)
+{
+	struct sr_profile_scope *outer;
+
+	outer = g_private_get(&current_scope);
+	if (!ctx)
+		ctx = sdi_ctx(sdi);
+	if (!driver && sdi)
+		driver = sdi->driver;
+	if (outer) {
+		ctx = ctx ? ctx : outer->ctx;
+		driver = driver ? driver : outer->driver;
+		sdi = sdi ? sdi : outer->sdi;
+	}
+
+	scope->ctx = ctx;
+	scope->phase = phase;
+	scope->driver = driver;
+	scope->sdi = sdi;
+	scope->enabled = ctx && g_atomic_int_get(&ctx->profile_enabled);
+	scope->start_us = scope->enabled ? g_get_monotonic_time() : 0;
+	scope->outer = outer;
+	g_private_set(&current_scope, scope);
+}
+
+/**
+ * Stop timing a phase, and record its duration.
+ *
+ * @param scope The scope of the phase, see sr_profile_begin().
+ * @param result The phase's result, an SR_OK or SR_ERR_* code.
+ *
+ * @private
+ */
+SR_PRIV void sr_profile_end(struct sr_profile_scope *scope, int result)
+{
+	struct sr_profile_record *rec;
+	struct sr_context *ctx;
+	const struct sr_dev_inst *sdi;
+
+	g_private_set(&current_scope, scope->outer);
+	if (!scope->enabled)
+		return;
+
+	ctx = scope->ctx;
+	sdi = scope->sdi;
+	rec = g_malloc0(sizeof(*rec));
+	rec->phase = scope->phase;
+	rec->driver = scope->driver ? g_strdup(scope->driver->name) : NULL;
+	if (sdi && sdi->connection_id)
+		rec->device = g_strdup(sdi->connection_id);
+	else if (sdi && sdi->model)
+		rec->device = g_strdup(sdi->model);
+	rec->start_us = scope->start_us;
+	rec->duration_us = g_get_monotonic_time() - scope->start_us;
+	rec->result = result;
+
+	sr_dbg("%s%s%s: %s took %" PRIi64 " us.",
+		rec->driver ? rec->driver : "-", rec->device ? " " : "",
+		rec->device ? rec->device : "", phase_names[rec->phase],
+		rec->duration_us);
+
+	g_mutex_lock(&ctx->profile_mutex);
+	g_queue_push_tail(&ctx->profile_records, rec);
+	if (g_queue_get_length(&ctx->profile_records) > PROFILE_RECORDS_MAX)
+		record_free(g_queue_pop_head(&ctx->profile_records));
+	g_mutex_unlock(&ctx->profile_mutex);
+}
+
+/**
+ * Set up profiling of a new context.
+ *
+ * @param ctx The context to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_profile_init(struct sr_context *ctx)
+{
+	g_mutex_init(&ctx->profile_mutex);
+	g_queue_init(&ctx->profile_records);
+	if (g_getenv("SIGROK_PROFILE"))
+		ctx->profile_enabled = 1;
+}
+
+/**
+ * Release the profiling records of a context.
+ *
+ * The summary gets logged when profiling was enabled by the
+ * SIGROK_PROFILE environment variable.
+ *
+ * @param ctx The context to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_profile_exit(struct sr_context *ctx)
+{
+	if (g_getenv("SIGROK_PROFILE"))
+		sr_profile_summary_log(ctx);
+	sr_profile_clear(ctx);
+	g_mutex_clear(&ctx->profile_mutex);
+}
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -27,14 +28,36 @@
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "resource"
+/* Larger resources get read through the hooks instead of being cached. */
+#define RESOURCE_CACHE_SIZE_LIMIT (64 * 1024 * 1024)
 /** @endcond */
 
 /**
  * @file
  *
  * Access to resource files.
+ *
+ * The content of each resource gets read just once, and gets kept in the
+ * context's cache, along with its checksum. Identical content is shared
+ * between names. Drivers can record which content they have loaded into
+ * a device, to tell whether a device which still runs a bitstream needs
+ * another upload.
  */
 
+/* A cached resource. */
+struct resource_entry {
+	GBytes *data;
+	char *checksum;
+};
+
+/* The handle of an open resource. */
+struct resource_reader {
+	/* The cached content, NULL when reading through the hooks. */
+	GBytes *data;
+	size_t pos;
+	struct sr_resource hook_res;
+};
+
 /**
  * Get a list of paths where we look for resource (e.g. firmware) files.
  *
@@ -269,6 +292,8 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_err("%s: ctx was NULL.", __func__);
 		return SR_ERR_ARG;
 	}
+	/* Content from the previous hooks doesn't apply anymore. */
+	sr_resource_cache_clear(ctx);
 	if (open_cb && close_cb && read_cb) {
 		ctx->resource_open_cb = open_cb;
 		ctx->resource_close_cb = close_cb;
@@ -286,6 +311,152 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 	return SR_OK;
 }
 
+/**
+ * Drop the cached content of all resources.
+ *
+ * Resources get read again when they are opened next time. Useful when
+ * resource files were changed on disk.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_resource_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	if (ctx->resource_cache)
+		g_hash_table_remove_all(ctx->resource_cache);
+	g_mutex_unlock(&ctx->resource_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Release the resource cache of a context.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx)
+{
+	if (ctx->resource_cache)
+		g_hash_table_destroy(ctx->resource_cache);
+	ctx->resource_cache = NULL;
+	if (ctx->resource_loaded)
+		g_hash_table_destroy(ctx->resource_loaded);
+	ctx->resource_loaded = NULL;
+}
+
+static void resource_entry_free(void *data)
+{
+	struct resource_entry *entry;
+
+	entry = data;
+	g_bytes_unref(entry->data);
+	g_free(entry->checksum);
+	g_free(entry);
+}
+
+static char *cache_key(int type, const char *name)
+{
+	return g_strdup_printf("%d/%s", type, name);
+}
+
+/* Called with the resource mutex held. */
+static struct resource_entry *cache_lookup(struct sr_context *ctx,
+		int type, const char *name)
+{
+	struct resource_entry *entry;
+	char *key;
+
+	if (!ctx->resource_cache)
+		return NULL;
+	key = cache_key(type, name);
+	entry = g_hash_table_lookup(ctx->resource_cache, key);
+	g_free(key);
+
+	return entry;
+}
+
+/* Called with the resource mutex held. */
+static void cache_insert(struct sr_context *ctx, int type, const char *name,
+		GBytes *data, char *checksum)
+{
+	struct resource_entry *entry, *other;
+	GHashTableIter iter;
+
+	if (!ctx->resource_cache)
+		ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, resource_entry_free);
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->checksum = checksum;
+	g_hash_table_iter_init(&iter, ctx->resource_cache);
+	while (g_hash_table_iter_next(&iter, NULL, (void **)&other)) {
+		if (!strcmp(other->checksum, checksum)) {
+			entry->data = g_bytes_ref(other->data);
+			break;
+		}
+	}
+	if (!entry->data)
+		entry->data = g_bytes_ref(data);
+	g_hash_table_replace(ctx->resource_cache, cache_key(type, name), entry);
+}
+
+/* Read all of the content through the hooks, and cache it. */
+static int cache_fill(struct sr_context *ctx, struct resource_reader *reader,
+		const char *name)
+{
+	struct resource_entry *entry;
+	uint8_t *buf;
+	size_t size, pos;
+	gssize n_read;
+	GBytes *data;
+	char *checksum;
+
+	size = reader->hook_res.size;
+	buf = g_try_malloc(size ? size : 1);
+	if (!buf) {
+		sr_err("Failed to allocate buffer for '%s'.", name);
+		return SR_ERR_MALLOC;
+	}
+	for (pos = 0; pos < size; pos += n_read) {
+		n_read = (*ctx->resource_read_cb)(&reader->hook_res,
+			buf + pos, size - pos, ctx->resource_cb_data);
+		if (n_read <= 0) {
+			if (n_read == 0)
+				sr_err("Failed to read '%s': premature end of file.",
+					name);
+			else
+				sr_err("Failed to read resource.");
+			g_free(buf);
+			return SR_ERR;
+		}
+	}
+	data = g_bytes_new_take(buf, size);
+	checksum = g_compute_checksum_for_bytes(G_CHECKSUM_SHA256, data);
+
+	g_mutex_lock(&ctx->resource_mutex);
+	entry = cache_lookup(ctx, reader->hook_res.type, name);
+	if (entry)
+		g_free(checksum);
+	else
+		cache_insert(ctx, reader->hook_res.type, name, data, checksum);
+	entry = cache_lookup(ctx, reader->hook_res.type, name);
+	reader->data = g_bytes_ref(entry->data);
+	g_mutex_unlock(&ctx->resource_mutex);
+	g_bytes_unref(data);
+
+	return SR_OK;
+}
+
 /**
  * Open resource.
  *
@@ -303,19 +474,48 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 SR_PRIV int sr_resource_open(struct sr_context *ctx,
 		struct sr_resource *res, int type, const char *name)
 {
+	struct resource_entry *entry;
+	struct resource_reader *reader;
 	int ret;
 
 	res->size = 0;
 	res->handle = NULL;
 	res->type = type;
 
-	ret = (*ctx->resource_open_cb)(res, name, ctx->resource_cb_data);
+	reader = g_malloc0(sizeof(*reader));
+	g_mutex_lock(&ctx->resource_mutex);
+	if ((entry = cache_lookup(ctx, type, name)))
+		reader->data = g_bytes_ref(entry->data);
+	g_mutex_unlock(&ctx->resource_mutex);
 
-	if (ret != SR_OK)
-		sr_err("Failed to open resource '%s' (use loglevel 5/spew for"
-		       " details).", name);
+	if (!reader->data) {
+		reader->hook_res.type = type;
+		ret = (*ctx->resource_open_cb)(&reader->hook_res, name,
+			ctx->resource_cb_data);
+		if (ret != SR_OK) {
+			sr_err("Failed to open resource '%s' (use loglevel 5/spew for"
+			       " details).", name);
+			g_free(reader);
+			return ret;
+		}
+		if (reader->hook_res.size <= RESOURCE_CACHE_SIZE_LIMIT) {
+			ret = cache_fill(ctx, reader, name);
+			(*ctx->resource_close_cb)(&reader->hook_res,
+				ctx->resource_cb_data);
+			if (ret != SR_OK) {
+				g_free(reader);
+				return ret;
+			}
+		}
+	}
 
-	return ret;
+	if (reader->data)
+		res->size = g_bytes_get_size(reader->data);
+	else
+		res->size = reader->hook_res.size;
+	res->handle = reader;
+
+	return SR_OK;
 }
 
 /**
@@ -332,9 +532,20 @@ SR_PRIV int sr_resource_open(struct sr_context *ctx,
  */
 SR_PRIV int sr_resource_close(struct sr_context *ctx, struct sr_resource *res)
 {
+	struct resource_reader *reader;
 	int ret;
 
-	ret = (*ctx->resource_close_cb)(res, ctx->resource_cb_data);
+	if (!(reader = res->handle))
+		return SR_ERR_ARG;
+
+	ret = SR_OK;
+	if (reader->data)
+		g_bytes_unref(reader->data);
+	else
+		ret = (*ctx->resource_close_cb)(&reader->hook_res,
+			ctx->resource_cb_data);
+	g_free(reader);
+	res->handle = NULL;
 
 	if (ret != SR_OK)
 		sr_err("Failed to close resource.");
@@ -359,9 +570,25 @@ SR_PRIV int sr_resource_close(struct sr_context *ctx, struct sr_resource *res)
 SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 		const struct sr_resource *res, void *buf, size_t count)
 {
+	struct resource_reader *reader;
+	const uint8_t *data;
+	size_t size;
 	gssize n_read;
 
-	n_read = (*ctx->resource_read_cb)(res, buf, count,
+	if (!(reader = res->handle))
+		return SR_ERR_ARG;
+
+	if (reader->data) {
+		data = g_bytes_get_data(reader->data, &size);
+		count = MIN(count, size - reader->pos);
+		if (count > G_MAXSSIZE)
+			return SR_ERR_ARG;
+		memcpy(buf, data + reader->pos, count);
+		reader->pos += count;
+		return count;
+	}
+
+	n_read = (*ctx->resource_read_cb)(&reader->hook_res, buf, count,
 			ctx->resource_cb_data);
 	if (n_read < 0)
 		sr_err("Failed to read resource.");
@@ -369,21 +596,7 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 	return n_read;
 }
 
-/**
- * Load a resource into memory.
- *
- * @param ctx libsigrok context. Must not be NULL.
- * @param type Resource type ID.
- * @param name Name of the resource. Must not be NULL.
- * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
- * @param max_size Size limit. Error out if the resource is larger than this.
- *
- * @return A buffer containing the resource data, or NULL on failure. Must
- *         be freed by the caller using g_free().
- *
- * @private
- */
-SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+static void *resource_load(struct sr_context *ctx,
 		int type, const char *name, size_t *size, size_t max_size)
 {
 	struct sr_resource res;
@@ -423,3 +636,136 @@ SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 	*size = res_size;
 	return buf;
 }
+
+/**
+ * Load a resource into memory.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return A buffer containing the resource data, or NULL on failure. Must
+ *         be freed by the caller using g_free().
+ *
+ * @private
+ */
+SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+		int type, const char *name, size_t *size, size_t max_size)
+{
+	struct sr_profile_scope scope;
+	void *buf;
+
+	sr_profile_begin(&scope, ctx, SR_PROFILE_RESOURCE_LOAD, NULL, NULL);
+	buf = resource_load(ctx, type, name, size, max_size);
+	sr_profile_end(&scope, buf ? SR_OK : SR_ERR);
+
+	return buf;
+}
+
+/**
+ * Get the checksum of a resource's content.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @return The SHA-256 checksum in hex, or NULL when the resource cannot
+ *         be read, or is too large to be cached. Must be freed by the
+ *         caller using g_free().
+ *
+ * @private
+ */
+SR_PRIV char *sr_resource_checksum(struct sr_context *ctx,
+		int type, const char *name)
+{
+	struct resource_entry *entry;
+	struct sr_resource res;
+	char *checksum;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	entry = cache_lookup(ctx, type, name);
+	g_mutex_unlock(&ctx->resource_mutex);
+	if (!entry) {
+		/* Opening it gets the content into the cache. */
+		if (sr_resource_open(ctx, &res, type, name) != SR_OK)
+			return NULL;
+		sr_resource_close(ctx, &res);
+	}
+
+	g_mutex_lock(&ctx->resource_mutex);
+	entry = cache_lookup(ctx, type, name);
+	checksum = entry ? g_strdup(entry->checksum) : NULL;
+	g_mutex_unlock(&ctx->resource_mutex);
+
+	return checksum;
+}
+
+/**
+ * Record which resource was loaded into a device.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param target Name of the device, and the part of it the resource was
+ *               loaded into. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource, NULL to forget about the target.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_set_loaded(struct sr_context *ctx,
+		const char *target, int type, const char *name)
+{
+	char *checksum;
+
+	checksum = name ? sr_resource_checksum(ctx, type, name) : NULL;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	if (!ctx->resource_loaded)
+		ctx->resource_loaded = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, g_free);
+	if (checksum)
+		g_hash_table_replace(ctx->resource_loaded,
+			g_strdup(target), checksum);
+	else
+		g_hash_table_remove(ctx->resource_loaded, target);
+	g_mutex_unlock(&ctx->resource_mutex);
+}
+
+/**
+ * Check whether a device got loaded with the current content of a resource.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param target Name of the device as passed to sr_resource_set_loaded().
+ *               Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @retval SR_OK The device was loaded with the resource's content.
+ * @retval SR_ERR_DATA The device was loaded with different content.
+ * @retval SR_ERR_NA Nothing was recorded for the device.
+ *
+ * @private
+ */
+SR_PRIV int sr_resource_check_loaded(struct sr_context *ctx,
+		const char *target, int type, const char *name)
+{
+	char *loaded, *checksum;
+	int ret;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	loaded = NULL;
+	if (ctx->resource_loaded)
+		loaded = g_strdup(g_hash_table_lookup(ctx->resource_loaded,
+			target));
+	g_mutex_unlock(&ctx->resource_mutex);
+	if (!loaded)
+		return SR_ERR_NA;
+
+	checksum = sr_resource_checksum(ctx, type, name);
+	ret = (checksum && !strcmp(checksum, loaded)) ? SR_OK : SR_ERR_DATA;
+	g_free(checksum);
+	g_free(loaded);
+
+	return ret;
+}
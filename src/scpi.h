@@ -73,6 +73,7 @@ enum scpi_transport_layer {
 	SCPI_TRANSPORT_USBTMC,
 	SCPI_TRANSPORT_VISA,
 	SCPI_TRANSPORT_VXI,
+	SCPI_TRANSPORT_HISLIP,
 };
 
 struct scpi_command {
@@ -87,6 +88,33 @@ struct sr_scpi_hw_info {
 	char *firmware_version;
 };
 
+/**
+ * Receives a chunk of a SCPI block response.
+ *
+ * @param cb_data The callback's argument.
+ * @param data The chunk's data.
+ * @param len The chunk's length in bytes.
+ * @param offset Position of the chunk in the block.
+ * @param total The block's length as announced in its header.
+ *
+ * @return SR_OK to continue, SR_ERR* to skip the remaining data.
+ */
+typedef int (*sr_scpi_block_callback)(void *cb_data, const uint8_t *data,
+		size_t len, size_t offset, size_t total);
+
+/**
+ * Receives values of a SCPI comma separated float list response.
+ *
+ * @param cb_data The callback's argument.
+ * @param values The values.
+ * @param count The number of values.
+ * @param offset Position of the first value in the list.
+ *
+ * @return SR_OK to continue, SR_ERR* to skip the remaining data.
+ */
+typedef int (*sr_scpi_floatv_callback)(void *cb_data, const float *values,
+		size_t count, size_t offset);
+
 struct sr_scpi_dev_inst {
 	const char *name;
 	const char *prefix;
@@ -105,15 +133,21 @@ struct sr_scpi_dev_inst {
 	int (*read_data)(void *priv, char *buf, int maxlen);
 	int (*write_data)(void *priv, char *buf, int len);
 	int (*read_complete)(void *priv);
+	int (*device_clear)(void *priv);
 	int (*close)(struct sr_scpi_dev_inst *scpi);
 	void (*free)(void *priv);
 	unsigned int read_timeout_us;
+	/* Limit of network connection attempts, 0 for the system's default. */
+	unsigned int connect_timeout_ms;
 	void *priv;
 	/* Only used for quirk workarounds, notably the Rigol DS1000 series. */
 	uint64_t firmware_version;
 	GMutex scpi_mutex;
 	char *actual_channel_name;
 	gboolean no_opc_command;
+	/* Commands held back by sr_scpi_batch_begin(), and deferred *OPC?. */
+	GString *batch;
+	gboolean batch_opc;
 };
 
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
@@ -136,9 +170,13 @@ SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen);
 SR_PRIV int sr_scpi_write_data(struct sr_scpi_dev_inst *scpi, char *buf, int len);
 SR_PRIV int sr_scpi_read_complete(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_device_clear(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi);
 SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi);
 
+SR_PRIV void sr_scpi_batch_begin(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_batch_end(struct sr_scpi_dev_inst *scpi);
+
 SR_PRIV int sr_scpi_read_response(struct sr_scpi_dev_inst *scpi,
 			GString *response, gint64 abs_timeout_us);
 SR_PRIV int sr_scpi_get_string(struct sr_scpi_dev_inst *scpi,
@@ -156,10 +194,19 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
+SR_PRIV int sr_scpi_get_floatv_stream(struct sr_scpi_dev_inst *scpi,
+			const char *command, sr_scpi_floatv_callback cb,
+			void *cb_data);
 SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+			const char *command, uint8_t *buf, size_t size,
+			size_t *length);
+SR_PRIV int sr_scpi_get_block_stream(struct sr_scpi_dev_inst *scpi,
+			const char *command, sr_scpi_block_callback cb,
+			void *cb_data);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
@@ -178,6 +225,28 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		int channel_command, const char *channel_name,
 		GVariant **gvar, const GVariantType *gvtype, int command, ...);
 
+/*--- Queued transactions, see scpi_queue.c ---------------------------------*/
+
+/** The command expects a response. */
+#define SR_SCPI_QUEUE_QUERY	(1 << 0)
+/** The command must not be joined with other commands. */
+#define SR_SCPI_QUEUE_ALONE	(1 << 1)
+
+struct sr_scpi_queue;
+
+typedef void (*sr_scpi_queue_callback)(void *cb_data, int status,
+		const char *response);
+
+SR_PRIV struct sr_scpi_queue *sr_scpi_queue_new(struct sr_scpi_dev_inst *scpi,
+		unsigned int max_join);
+SR_PRIV void sr_scpi_queue_free(struct sr_scpi_queue *queue);
+SR_PRIV int sr_scpi_queue_add(struct sr_scpi_queue *queue, int flags,
+		sr_scpi_queue_callback cb, void *cb_data, const char *command);
+SR_PRIV int sr_scpi_queue_run(struct sr_scpi_queue *queue);
+SR_PRIV int sr_scpi_queue_attach(struct sr_scpi_queue *queue,
+		struct sr_session *session);
+SR_PRIV int sr_scpi_queue_detach(struct sr_scpi_queue *queue);
+
 /*--- GPIB only functions ---------------------------------------------------*/
 
 #ifdef HAVE_LIBGPIB
@@ -19,6 +19,7 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <glib.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
@@ -28,7 +29,18 @@
 #define LOG_PREFIX "scpi"
 
 #define SCPI_READ_RETRIES 100
+#define SCPI_BLOCK_CHUNK_SIZE (64 * 1024)
+/* Maximum length of a response header in front of a block. */
+#define SCPI_BLOCK_PREFIX_MAX 64
+/* Number of values which get passed to float list callbacks at once. */
+#define SCPI_FLOATV_CHUNK_SIZE 4096
 #define SCPI_READ_RETRY_TIMEOUT_US (10 * 1000)
+/* Instruments' input buffers are small, don't let batches grow beyond. */
+#define SCPI_BATCH_MAX_LEN 512
+/* Scans give up on unresponsive network resources quickly. */
+#define SCPI_SCAN_CONNECT_TIMEOUT_MS 1500
+/* Number of resources which sr_scpi_scan() probes concurrently. */
+#define SCPI_SCAN_THREADS 16
 
 static const char *scpi_vendors[][2] = {
 	{ "Agilent Technologies", "Agilent" },
@@ -81,6 +93,7 @@ static int parse_strict_bool(const char *str, gboolean *ret)
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_serial_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_raw_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_rigol_dev;
+SR_PRIV extern const struct sr_scpi_dev_inst scpi_hislip_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_usbtmc_libusb_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_vxi_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_visa_dev;
@@ -89,6 +102,7 @@ SR_PRIV extern const struct sr_scpi_dev_inst scpi_libgpib_dev;
 static const struct sr_scpi_dev_inst *scpi_devs[] = {
 	&scpi_tcp_raw_dev,
 	&scpi_tcp_rigol_dev,
+	&scpi_hislip_dev,
 #ifdef HAVE_LIBUSB_1_0
 	&scpi_usbtmc_libusb_dev,
 #endif
@@ -116,6 +130,7 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
 	if (!(scpi = scpi_dev_inst_new(drvc, resource, serialcomm)))
 		return NULL;
 
+	scpi->connect_timeout_ms = SCPI_SCAN_CONNECT_TIMEOUT_MS;
 	if (sr_scpi_open(scpi) != SR_OK) {
 		sr_info("Couldn't open SCPI device.");
 		sr_scpi_free(scpi);
@@ -125,6 +140,7 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
 	sdi = probe_device(scpi);
 
 	sr_scpi_close(scpi);
+	scpi->connect_timeout_ms = 0;
 
 	if (sdi)
 		sdi->status = SR_ST_INACTIVE;
@@ -143,6 +159,57 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
  *
  * @return SR_OK on success, SR_ERR on failure.
  */
+/* Append a command to a program message, see IEEE 488.2. */
+static void scpi_batch_append(GString *msg, const char *command, size_t len)
+{
+	if (msg->len) {
+		g_string_append_c(msg, ';');
+		/* Use absolute headers, follow ups are relative. */
+		if (command[0] != ':' && command[0] != '*')
+			g_string_append_c(msg, ':');
+	}
+	g_string_append_len(msg, command, len);
+}
+
+/* Send batched commands, without mutex. */
+static int scpi_batch_flush(struct sr_scpi_dev_inst *scpi)
+{
+	int ret;
+
+	if (!scpi->batch->len)
+		return SR_OK;
+
+	sr_spew("Sending batched commands: '%s'.", scpi->batch->str);
+	g_string_append_c(scpi->batch, '\n');
+	ret = scpi->send(scpi->priv, scpi->batch->str);
+	g_string_truncate(scpi->batch, 0);
+
+	return ret;
+}
+
+/*
+ * Hold back a command while a batch is open. Commands without a query
+ * get appended to the batch. A query gets sent right away, prefixed by
+ * the batch, so that its response reflects all previous commands.
+ */
+static int scpi_batch_send(struct sr_scpi_dev_inst *scpi, char *buf, int len)
+{
+	int ret;
+
+	if (buf[len - 1] == '\n')
+		buf[--len] = '\0';
+
+	if (scpi->batch->len + len + 2 > SCPI_BATCH_MAX_LEN) {
+		if ((ret = scpi_batch_flush(scpi)) != SR_OK)
+			return ret;
+	}
+	scpi_batch_append(scpi->batch, buf, len);
+	if (strchr(buf, '?'))
+		return scpi_batch_flush(scpi);
+
+	return SR_OK;
+}
+
 static int scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 			 const char *format, va_list args)
 {
@@ -161,8 +228,11 @@ static int scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 	if (buf[len - 1] != '\n')
 		buf[len] = '\n';
 
-	/* Send command. */
-	ret = scpi->send(scpi->priv, buf);
+	/* Send command, or hold it back while a batch is open. */
+	if (scpi->batch)
+		ret = scpi_batch_send(scpi, buf, len + 1);
+	else
+		ret = scpi->send(scpi->priv, buf);
 
 	/* Free command buffer. */
 	g_free(buf);
@@ -311,44 +381,115 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	return SR_OK;
 }
 
+/* A resource which a backend's scan found, see sr_scpi_scan(). */
+struct scan_probe {
+	struct drv_context *drvc;
+	char *resource;
+	const char *serialcomm;
+	struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi);
+	struct sr_dev_inst *sdi;
+};
+
+static void scan_probe_run(gpointer data, gpointer user_data)
+{
+	struct scan_probe *probe;
+	gchar **res;
+
+	(void)user_data;
+
+	probe = data;
+	res = g_strsplit(probe->resource, ":", 2);
+	if (res[0])
+		probe->sdi = sr_scpi_scan_resource(probe->drvc, res[0],
+			probe->serialcomm ? : res[1], probe->probe_device);
+	g_strfreev(res);
+}
+
+/*
+ * Probe the resources which the backends' scans found. Most of the
+ * time goes into waiting for instruments (or their absence), so the
+ * resources get probed concurrently. The devices keep the order of
+ * the resources.
+ */
+static GSList *scan_probe_all(GPtrArray *probes)
+{
+	struct scan_probe *probe;
+	GThreadPool *pool;
+	GError *error;
+	GSList *devices;
+	guint i;
+
+	pool = NULL;
+	if (probes->len > 1) {
+		error = NULL;
+		pool = g_thread_pool_new(scan_probe_run, NULL,
+			MIN(probes->len, SCPI_SCAN_THREADS), FALSE, &error);
+		if (!pool) {
+			sr_warn("Cannot create probe threads: %s.",
+				error->message);
+			g_error_free(error);
+		}
+	}
+	for (i = 0; i < probes->len; i++) {
+		if (pool)
+			g_thread_pool_push(pool, probes->pdata[i], NULL);
+		else
+			scan_probe_run(probes->pdata[i], NULL);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	devices = NULL;
+	for (i = 0; i < probes->len; i++) {
+		probe = probes->pdata[i];
+		if (probe->sdi) {
+			probe->sdi->connection_id = g_strdup(probe->resource);
+			devices = g_slist_append(devices, probe->sdi);
+		}
+		g_free(probe->resource);
+		g_free(probe);
+	}
+
+	return devices;
+}
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi))
 {
 	GSList *resources, *l, *devices;
+	GPtrArray *probes;
+	struct scan_probe *probe;
 	struct sr_dev_inst *sdi;
-	const char *resource, *conn;
-	const char *serialcomm, *comm;
-	gchar **res;
+	const char *resource;
+	const char *serialcomm;
 	unsigned i;
 
 	resource = NULL;
 	serialcomm = NULL;
 	(void)sr_serial_extract_options(options, &resource, &serialcomm);
 
-	devices = NULL;
+	probes = g_ptr_array_new();
 	for (i = 0; i < ARRAY_SIZE(scpi_devs); i++) {
 		if (resource && strcmp(resource, scpi_devs[i]->prefix) != 0)
 			continue;
 		if (!scpi_devs[i]->scan)
 			continue;
+		/* Network discovery takes a while, only run it on request. */
+		if (!resource && scpi_devs[i]->transport == SCPI_TRANSPORT_RAW_TCP)
+			continue;
 		resources = scpi_devs[i]->scan(drvc);
 		for (l = resources; l; l = l->next) {
-			res = g_strsplit(l->data, ":", 2);
-			if (!res[0]) {
-				g_strfreev(res);
-				continue;
-			}
-			conn = res[0];
-			comm = serialcomm ? : res[1];
-			sdi = sr_scpi_scan_resource(drvc, conn, comm, probe_device);
-			if (sdi) {
-				devices = g_slist_append(devices, sdi);
-				sdi->connection_id = g_strdup(l->data);
-			}
-			g_strfreev(res);
+			probe = g_malloc0(sizeof(*probe));
+			probe->drvc = drvc;
+			probe->resource = l->data;
+			probe->serialcomm = serialcomm;
+			probe->probe_device = probe_device;
+			g_ptr_array_add(probes, probe);
 		}
-		g_slist_free_full(resources, g_free);
+		g_slist_free(resources);
 	}
+	devices = scan_probe_all(probes);
+	g_ptr_array_free(probes, TRUE);
 
 	if (!devices && resource) {
 		sdi = sr_scpi_scan_resource(drvc, resource, serialcomm, probe_device);
@@ -504,6 +645,58 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/**
+ * Start holding back SCPI commands, to send them as one program message.
+ *
+ * Subsequent commands without queries get joined and are sent when
+ * a query is sent, or when sr_scpi_batch_end() gets called. *OPC?
+ * queries via sr_scpi_get_opc() are deferred to the end of the batch,
+ * so that a sequence of settings costs a single round trip.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ */
+SR_PRIV void sr_scpi_batch_begin(struct sr_scpi_dev_inst *scpi)
+{
+	g_mutex_lock(&scpi->scpi_mutex);
+	if (!scpi->batch) {
+		scpi->batch = g_string_sized_new(SCPI_BATCH_MAX_LEN);
+		scpi->batch_opc = FALSE;
+	}
+	g_mutex_unlock(&scpi->scpi_mutex);
+}
+
+/**
+ * Send commands held back since sr_scpi_batch_begin(), and resume
+ * sending commands immediately.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_batch_end(struct sr_scpi_dev_inst *scpi)
+{
+	gboolean opc;
+	int ret;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	if (!scpi->batch) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return SR_OK;
+	}
+	ret = scpi_batch_flush(scpi);
+	opc = scpi->batch_opc;
+	g_string_free(scpi->batch, TRUE);
+	scpi->batch = NULL;
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	if (ret != SR_OK)
+		return SR_ERR;
+	if (opc)
+		return sr_scpi_get_opc(scpi);
+
+	return SR_OK;
+}
+
 /**
  * Begin receiving an SCPI reply.
  *
@@ -573,6 +766,29 @@ SR_PRIV int sr_scpi_read_complete(struct sr_scpi_dev_inst *scpi)
 	return scpi->read_complete(scpi->priv);
 }
 
+/**
+ * Clear the device's input and output buffers, and abort the operation
+ * in progress, without closing the connection.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return SR_OK on success, SR_ERR_NA when the transport does not
+ *         support device clear, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_device_clear(struct sr_scpi_dev_inst *scpi)
+{
+	int ret;
+
+	if (!scpi->device_clear)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi->device_clear(scpi->priv);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
 /**
  * Close SCPI device.
  *
@@ -605,6 +821,8 @@ SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 
 	scpi->free(scpi->priv);
 	g_free(scpi->priv);
+	if (scpi->batch)
+		g_string_free(scpi->batch, TRUE);
 	g_free(scpi->actual_channel_name);
 	g_free(scpi);
 }
@@ -831,6 +1049,12 @@ SR_PRIV int sr_scpi_get_opc(struct sr_scpi_dev_inst *scpi)
 	unsigned int i;
 	gboolean opc;
 
+	/* Batches wait for completion once, at their end. */
+	if (scpi->batch) {
+		scpi->batch_opc = TRUE;
+		return SR_OK;
+	}
+
 	for (i = 0; i < SCPI_READ_RETRIES; i++) {
 		opc = FALSE;
 		sr_scpi_get_bool(scpi, SCPI_CMD_OPC, &opc);
@@ -842,6 +1066,146 @@ SR_PRIV int sr_scpi_get_opc(struct sr_scpi_dev_inst *scpi)
 	return SR_ERR;
 }
 
+/* Powers of ten which are exact in double precision. */
+static const double scpi_exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/*
+ * Parse a number at the start of a list item, leave the text pointer at
+ * the comma or at the end of the text which must follow it.
+ *
+ * Plain decimal text with at most 15 significant digits and a small
+ * exponent gets converted exactly with one multiplication or division
+ * (both operands are exact doubles, so the result is correctly rounded).
+ * Everything else (long mantissas, large exponents, INF/NAN, hex) is
+ * up to g_ascii_strtod().
+ */
+static int scpi_parse_double(const char **str, double *value)
+{
+	const char *p, *digits;
+	uint64_t mantissa;
+	int exponent, exp_value, num_digits;
+	gboolean negative, exp_negative;
+	char *endptr;
+	double v;
+
+	p = *str;
+	while (g_ascii_isspace(*p))
+		p++;
+	negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+
+	mantissa = 0;
+	exponent = 0;
+	num_digits = 0;
+	digits = p;
+	while (g_ascii_isdigit(*p)) {
+		if (mantissa || *p != '0')
+			num_digits++;
+		mantissa = mantissa * 10 + (*p++ - '0');
+		if (num_digits > 15)
+			goto slow;
+	}
+	if (*p == '.') {
+		p++;
+		while (g_ascii_isdigit(*p)) {
+			if (mantissa || *p != '0')
+				num_digits++;
+			mantissa = mantissa * 10 + (*p++ - '0');
+			exponent--;
+			if (num_digits > 15)
+				goto slow;
+		}
+	}
+	if (p == digits || (p == digits + 1 && *digits == '.'))
+		goto slow;
+	if (*p == 'e' || *p == 'E') {
+		p++;
+		exp_negative = *p == '-';
+		if (*p == '-' || *p == '+')
+			p++;
+		if (!g_ascii_isdigit(*p))
+			goto slow;
+		exp_value = 0;
+		while (g_ascii_isdigit(*p)) {
+			exp_value = exp_value * 10 + (*p++ - '0');
+			if (exp_value > 1000)
+				goto slow;
+		}
+		exponent += exp_negative ? -exp_value : exp_value;
+	}
+	if ((*p && *p != ',') || exponent < -22 || exponent > 22)
+		goto slow;
+
+	v = mantissa;
+	if (exponent < 0)
+		v /= scpi_exact_pow10[-exponent];
+	else
+		v *= scpi_exact_pow10[exponent];
+	*value = negative ? -v : v;
+	*str = p;
+
+	return SR_OK;
+
+slow:
+	errno = 0;
+	v = g_ascii_strtod(*str, &endptr);
+	if (endptr == *str || errno || (*endptr && *endptr != ','))
+		return SR_ERR_DATA;
+	*value = v;
+	*str = endptr;
+
+	return SR_OK;
+}
+
+/*
+ * Parse a decimal integer at the start of a list item, leave the text
+ * pointer at the comma or at the end of the text which must follow it.
+ */
+static int scpi_parse_int(const char **str, int *value)
+{
+	const char *p, *digits;
+	gboolean negative;
+	int64_t v;
+
+	p = *str;
+	while (g_ascii_isspace(*p))
+		p++;
+	negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+
+	v = 0;
+	digits = p;
+	while (g_ascii_isdigit(*p)) {
+		v = v * 10 + (*p++ - '0');
+		if (v > G_MAXINT)
+			return SR_ERR_DATA;
+	}
+	if (p == digits || (*p && *p != ','))
+		return SR_ERR_DATA;
+
+	*value = negative ? -v : v;
+	*str = p;
+
+	return SR_OK;
+}
+
+/* Number of items in a comma separated list. */
+static size_t scpi_list_length(const char *str)
+{
+	size_t count;
+
+	count = 1;
+	while ((str = strchr(str, ',')))
+		count++, str++;
+
+	return count;
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as comma separated list of
  * floats and store the as an result in scpi_response.
@@ -860,10 +1224,11 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
 	int ret;
-	float tmp;
+	double tmp;
 	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	const char *p;
+	float *values;
+	size_t count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -873,23 +1238,24 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
+	/* Size the array once, parse right into it. */
+	count = scpi_list_length(response);
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(float), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atof_ascii(*ptr, &tmp);
-		if (ret != SR_OK) {
-			ret = SR_ERR_DATA;
+		sizeof(float), count + 1);
+	g_array_set_size(response_array, count);
+	values = (float *)response_array->data;
+
+	count = 0;
+	p = response;
+	while (1) {
+		ret = scpi_parse_double(&p, &tmp);
+		if (ret != SR_OK)
+			break;
+		values[count++] = tmp;
+		if (!*p++)
 			break;
-		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
 	}
-	g_strfreev(tokens);
+	g_array_set_size(response_array, count);
 	g_free(response);
 
 	if (ret != SR_OK && response_array->len == 0) {
@@ -921,8 +1287,9 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 {
 	int tmp, ret;
 	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	const char *p;
+	uint8_t *values;
+	size_t count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -932,23 +1299,23 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
+	count = scpi_list_length(response);
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(uint8_t), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atoi(*ptr, &tmp);
-		if (ret != SR_OK) {
-			ret = SR_ERR_DATA;
+		sizeof(uint8_t), count + 1);
+	g_array_set_size(response_array, count);
+	values = (uint8_t *)response_array->data;
+
+	count = 0;
+	p = response;
+	while (1) {
+		ret = scpi_parse_int(&p, &tmp);
+		if (ret != SR_OK)
+			break;
+		values[count++] = tmp;
+		if (!*p++)
 			break;
-		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
 	}
-	g_strfreev(tokens);
+	g_array_set_size(response_array, count);
 	g_free(response);
 
 	if (response_array->len == 0) {
@@ -961,63 +1328,225 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/* Where the values of a streamed float list go. */
+struct floatv_sink {
+	sr_scpi_floatv_callback cb;
+	void *cb_data;
+	float values[SCPI_FLOATV_CHUNK_SIZE];
+	size_t count;
+	size_t offset;
+	int ret;
+};
+
+static void floatv_sink_flush(struct floatv_sink *sink)
+{
+	if (sink->count && sink->cb) {
+		if (sink->cb(sink->cb_data, sink->values, sink->count,
+				sink->offset) != SR_OK) {
+			/* Keep reading, the data must be consumed. */
+			sink->cb = NULL;
+		}
+	}
+	sink->offset += sink->count;
+	sink->count = 0;
+}
+
+/*
+ * Parse list items up to the given end of the text, which is either
+ * right behind a comma, or the end of the response. Returns the number
+ * of consumed characters.
+ */
+static size_t floatv_sink_parse(struct floatv_sink *sink,
+		const char *str, const char *end)
+{
+	const char *p;
+	double tmp;
+
+	p = str;
+	while (sink->ret == SR_OK && p < end) {
+		sink->ret = scpi_parse_double(&p, &tmp);
+		if (sink->ret != SR_OK)
+			break;
+		sink->values[sink->count++] = tmp;
+		if (sink->count == G_N_ELEMENTS(sink->values))
+			floatv_sink_flush(sink);
+		if (*p)
+			p++;
+	}
+
+	return end - str;
+}
+
+/*
+ * Send a command and parse its comma separated list of floats while
+ * the response is read, without mutex.
+ */
+static int scpi_get_floatv_stream(struct sr_scpi_dev_inst *scpi,
+		const char *command, struct floatv_sink *sink)
+{
+	GString *response;
+	const char *comma;
+	size_t len;
+	gint64 timeout;
+	int ret;
+
+	if (command && scpi_send(scpi, command) != SR_OK)
+		return SR_ERR;
+	if (sr_scpi_read_begin(scpi) != SR_OK)
+		return SR_ERR;
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	response = g_string_sized_new(SCPI_BLOCK_CHUNK_SIZE);
+	ret = SR_OK;
+	while (!sr_scpi_read_complete(scpi)) {
+		if (response->allocated_len - response->len < 128) {
+			len = response->len;
+			g_string_set_size(response, len + SCPI_BLOCK_CHUNK_SIZE);
+			g_string_set_size(response, len);
+		}
+		ret = scpi_read_response(scpi, response, timeout);
+		if (ret < 0)
+			break;
+		if (ret == 0)
+			continue;
+		timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+		/* Parse the complete items, keep the trailing partial one. */
+		comma = NULL;
+		for (len = response->len; len; len--) {
+			if (response->str[len - 1] == ',') {
+				comma = &response->str[len];
+				break;
+			}
+		}
+		if (comma) {
+			len = floatv_sink_parse(sink, response->str, comma);
+			g_string_erase(response, 0, len);
+		}
+		ret = SR_OK;
+	}
+
+	if (ret == SR_OK) {
+		len = response->len;
+		while (len && (response->str[len - 1] == '\n' ||
+				response->str[len - 1] == '\r'))
+			len--;
+		g_string_truncate(response, len);
+		/* An empty last item is an error, like an empty response. */
+		floatv_sink_parse(sink, response->str,
+			response->str + MAX(len, 1));
+		floatv_sink_flush(sink);
+		ret = sink->ret;
+	}
+	g_string_free(response, TRUE);
+
+	return ret;
+}
+
 /**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
+ * Send a SCPI command, and pass its comma separated list of floats to a
+ * callback while the response still is being read.
  *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
+ * This avoids holding the complete text of long ASCII format waveforms
+ * in memory. When the callback returns an error, it does not get invoked
+ * again, and the remaining response gets read and discarded.
  *
  * @param[in] scpi Previously initialised SCPI device structure.
  * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
+ * @param[in] cb Callback which receives the values.
+ * @param[in] cb_data Argument to pass to the callback.
  *
  * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+ *         error or upon no response. Values before a parsing error were
+ *         passed to the callback.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+SR_PRIV int sr_scpi_get_floatv_stream(struct sr_scpi_dev_inst *scpi,
+		const char *command, sr_scpi_floatv_callback cb, void *cb_data)
 {
+	struct floatv_sink *sink;
 	int ret;
-	GString* response;
-	gsize oldlen;
-	char buf[10];
-	long llen;
-	long datalen;
-	gint64 timeout;
 
-	*scpi_response = NULL;
+	if (!cb)
+		return SR_ERR_ARG;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->cb = cb;
+	sink->cb_data = cb_data;
 
 	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_floatv_stream(scpi, command, sink);
+	g_mutex_unlock(&scpi->scpi_mutex);
 
-	if (command)
-		if (scpi_send(scpi, command) != SR_OK) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			return SR_ERR;
-		}
+	g_free(sink);
 
-	if (sr_scpi_read_begin(scpi) != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		return SR_ERR;
-	}
+	return ret;
+}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
+/* Where the data of a definite length block goes. */
+struct block_sink {
+	/* Allocate the block in this array. */
+	GByteArray *array;
+	/* Or read into a caller provided buffer. */
+	uint8_t *buf;
+	size_t size;
+	/* Or pass the data to a callback, chunk by chunk. */
+	sr_scpi_block_callback cb;
+	void *cb_data;
+	/* Number of data bytes which were received. */
+	size_t length;
+};
 
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+/*
+ * Read exactly the given number of bytes, without mutex. Used for block
+ * headers, so that no data bytes get read along with them.
+ */
+static int scpi_read_exact(struct sr_scpi_dev_inst *scpi,
+		char *buf, int len, gint64 *abs_timeout_us)
+{
+	int ret, pos;
 
-	/* Get (the first chunk of) the response. */
-	do {
-		ret = scpi_read_response(scpi, response, timeout);
+	pos = 0;
+	while (pos < len) {
+		ret = scpi_read_data(scpi, &buf[pos], len - pos);
 		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
+			sr_err("Incompletely read SCPI response.");
+			return SR_ERR;
+		}
+		if (ret > 0) {
+			pos += ret;
+			*abs_timeout_us = g_get_monotonic_time() +
+				scpi->read_timeout_us;
+			continue;
+		}
+		if (g_get_monotonic_time() > *abs_timeout_us) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
 		}
-	} while (response->len < 2);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Send a command and receive its definite length block response, without
+ * mutex. The header gets parsed before any data is read, so the data can
+ * go to its final destination right away.
+ */
+static int scpi_get_block(struct sr_scpi_dev_inst *scpi,
+		const char *command, struct block_sink *sink)
+{
+	char buf[10];
+	long llen, datalen;
+	uint8_t *dest, *chunk;
+	size_t remain, count;
+	gint64 timeout;
+	int ret, skipped;
+
+	if (command && scpi_send(scpi, command) != SR_OK)
+		return SR_ERR;
+	if (sr_scpi_read_begin(scpi) != SR_OK)
+		return SR_ERR;
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
 
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
@@ -1027,17 +1556,22 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * length. Raw data bytes follow (thus one must no longer assume
 	 * that the received input stream would be an ASCIIZ string).
 	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
+	 * Instruments with response headers enabled put text in front
+	 * of the block (e.g. "C1:WF ALL,#9..."), skip over it.
 	 */
-	if (response->str[0] != '#') {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	skipped = 0;
+	do {
+		ret = scpi_read_exact(scpi, buf, 1, &timeout);
+		if (ret != SR_OK)
+			return ret;
+	} while (buf[0] != '#' && ++skipped < SCPI_BLOCK_PREFIX_MAX);
+	if (buf[0] != '#')
 		return SR_ERR_DATA;
-	}
-	buf[0] = response->str[1];
-	buf[1] = '\0';
-	ret = sr_atol(buf, &llen);
+	ret = scpi_read_exact(scpi, &buf[1], 1, &timeout);
+	if (ret != SR_OK)
+		return ret;
+	buf[2] = '\0';
+	ret = sr_atol(&buf[1], &llen);
 	/*
 	 * The form "#0..." is legal, and does not mean "empty response",
 	 * but means that the number of data bytes is not known (or was
@@ -1060,70 +1594,190 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
 		ret = SR_ERR_NA;
 	}
-	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	if (ret != SR_OK)
 		return ret;
-	}
-
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
-	}
 
-	memcpy(buf, &response->str[2], llen);
+	ret = scpi_read_exact(scpi, buf, llen, &timeout);
+	if (ret != SR_OK)
+		return ret;
 	buf[llen] = '\0';
 	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	if (ret != SR_OK || datalen <= 0)
 		return ret;
-	}
-	g_string_erase(response, 0, 2 + llen);
-
-	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
-	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
 
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
+	/* Allocate once, for the now known length. */
+	dest = NULL;
+	chunk = NULL;
+	if (sink->array) {
+		g_byte_array_set_size(sink->array, datalen);
+		dest = sink->array->data;
+	} else if (sink->buf && (size_t)datalen <= sink->size) {
+		dest = sink->buf;
+	} else {
+		if (sink->buf)
+			sr_err("SCPI block of %ld bytes exceeds buffer.", datalen);
+		chunk = g_malloc(MIN((size_t)datalen, SCPI_BLOCK_CHUNK_SIZE));
+	}
 
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
+	sink->length = 0;
+	while (sink->length < (size_t)datalen) {
+		remain = datalen - sink->length;
+		if (dest) {
+			count = MIN(remain, G_MAXINT);
+			ret = scpi_read_data(scpi,
+				(char *)&dest[sink->length], count);
+		} else {
+			count = MIN(remain, SCPI_BLOCK_CHUNK_SIZE);
+			ret = scpi_read_data(scpi, (char *)chunk, count);
+		}
+		if (ret < 0) {
+			sr_err("Incompletely read SCPI response.");
+			break;
+		}
+		if (ret == 0) {
+			/*
+			 * On timeout truncate the block and pass on the
+			 * partial response instead of getting stuck.
 			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
+			if (g_get_monotonic_time() > timeout) {
+				sr_err("Timed out waiting for SCPI response.");
+				ret = SR_OK;
 				break;
 			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
+			continue;
+		}
+		timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		if (sink->cb) {
+			if (sink->cb(sink->cb_data, chunk, ret, sink->length,
+					datalen) != SR_OK) {
+				/* Keep reading, the data must be consumed. */
+				sink->cb = NULL;
 			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
+		}
+		sink->length += ret;
+		ret = SR_OK;
 	}
+	g_free(chunk);
 
+	if (sink->array)
+		g_byte_array_set_size(sink->array, sink->length);
+	if (ret == SR_OK && sink->buf && !dest)
+		ret = SR_ERR_DATA;
+
+	return ret;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	struct block_sink sink;
+	int ret;
+
+	*scpi_response = NULL;
+
+	memset(&sink, 0, sizeof(sink));
+	sink.array = g_byte_array_new();
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, &sink);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	if (ret != SR_OK || !sink.length) {
+		g_byte_array_free(sink.array, TRUE);
+		return ret;
+	}
+	*scpi_response = sink.array;
 
 	return SR_OK;
 }
 
+/**
+ * Send a SCPI command, and read its "definite length block" response
+ * into a caller provided buffer.
+ *
+ * Blocks which exceed the buffer are read and discarded.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] buf Buffer where to store the block data.
+ * @param[in] size Size of the buffer in bytes.
+ * @param[out] length Number of received data bytes.
+ *
+ * @return SR_OK upon success, SR_ERR_DATA when the block did not fit,
+ *         other SR_ERR* upon a parsing error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t *buf, size_t size, size_t *length)
+{
+	struct block_sink sink;
+	int ret;
+
+	if (!buf || !length)
+		return SR_ERR_ARG;
+
+	memset(&sink, 0, sizeof(sink));
+	sink.buf = buf;
+	sink.size = size;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, &sink);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	*length = ret == SR_OK ? sink.length : 0;
+
+	return ret;
+}
+
+/**
+ * Send a SCPI command, and pass its "definite length block" response to
+ * a callback as the data comes in.
+ *
+ * This lets drivers convert sample data while the transfer still is in
+ * flight. When the callback returns an error, it does not get invoked
+ * again, and the remaining data gets read and discarded.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in] cb Callback which receives the data chunks.
+ * @param[in] cb_data Argument to pass to the callback.
+ *
+ * @return SR_OK upon success, SR_ERR* upon a parsing error or upon no
+ *         response.
+ */
+SR_PRIV int sr_scpi_get_block_stream(struct sr_scpi_dev_inst *scpi,
+		const char *command, sr_scpi_block_callback cb, void *cb_data)
+{
+	struct block_sink sink;
+	int ret;
+
+	if (!cb)
+		return SR_ERR_ARG;
+
+	memset(&sink, 0, sizeof(sink));
+	sink.cb = cb;
+	sink.cb_data = cb_data;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, &sink);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
 /**
  * Send the *IDN? SCPI command, receive the reply, parse it and store the
  * reply as a sr_scpi_hw_info structure in the supplied scpi_response pointer.
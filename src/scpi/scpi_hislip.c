@@ -0,0 +1,578 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * HiSLIP (High Speed LAN Instrument Protocol, IVI-6.1) transport.
+ *
+ * HiSLIP uses two TCP connections to the same port: the synchronous
+ * channel carries commands and responses, the asynchronous channel
+ * carries out of band requests like device clear. Messages have a 16
+ * byte header, the payload of data messages is passed through without
+ * further framing, so large blocks transfer at line rate.
+ *
+ * Resource syntax: hislip/<address>[/<port>[/<sub address>]]
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#include <errno.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+#define LOG_PREFIX "scpi_hislip"
+
+#define HISLIP_DEFAULT_PORT "4880"
+#define HISLIP_DEFAULT_SUBADDRESS "hislip0"
+#define HISLIP_HEADER_SIZE 16
+#define HISLIP_PROTOCOL_VERSION 0x0100
+/* Arbitrary. */
+#define HISLIP_VENDOR_ID (('s' << 8) | 'r')
+#define HISLIP_FIRST_MESSAGE_ID 0xffffff00
+/* The largest message the server may send to us. */
+#define HISLIP_MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+
+enum hislip_message_type {
+	HISLIP_INITIALIZE = 0,
+	HISLIP_INITIALIZE_RESPONSE = 1,
+	HISLIP_FATAL_ERROR = 2,
+	HISLIP_ERROR = 3,
+	HISLIP_DATA = 6,
+	HISLIP_DATA_END = 7,
+	HISLIP_DEVICE_CLEAR_COMPLETE = 8,
+	HISLIP_DEVICE_CLEAR_ACKNOWLEDGE = 9,
+	HISLIP_INTERRUPTED = 13,
+	HISLIP_ASYNC_INTERRUPTED = 14,
+	HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE = 15,
+	HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE = 16,
+	HISLIP_ASYNC_INITIALIZE = 17,
+	HISLIP_ASYNC_INITIALIZE_RESPONSE = 18,
+	HISLIP_ASYNC_DEVICE_CLEAR = 19,
+	HISLIP_ASYNC_DEVICE_CLEAR_ACKNOWLEDGE = 23,
+};
+
+struct hislip_header {
+	uint8_t type;
+	uint8_t control;
+	uint32_t param;
+	uint64_t length;
+};
+
+struct scpi_hislip {
+	char *address;
+	char *port;
+	char *subaddress;
+	int sync_socket;
+	int async_socket;
+	gboolean overlapped;
+	uint32_t message_id;
+	/* Response message terminator was delivered for the last query. */
+	gboolean rmt_delivered;
+	/* The largest message the server accepts. */
+	uint64_t server_max_size;
+	/* Data of the current message which still is to be read. */
+	uint64_t payload_remain;
+	gboolean in_data_end;
+	gboolean read_done;
+};
+
+static int hislip_dev_inst_new(void *priv, struct drv_context *drvc,
+		const char *resource, char **params, const char *serialcomm)
+{
+	struct scpi_hislip *hislip = priv;
+
+	(void)drvc;
+	(void)resource;
+	(void)serialcomm;
+
+	if (!params || !params[1] || !*params[1]) {
+		sr_err("Invalid parameters.");
+		return SR_ERR;
+	}
+
+	hislip->address = g_strdup(params[1]);
+	hislip->port = g_strdup(params[2] && *params[2] ?
+		params[2] : HISLIP_DEFAULT_PORT);
+	hislip->subaddress = g_strdup(params[2] && params[3] && *params[3] ?
+		params[3] : HISLIP_DEFAULT_SUBADDRESS);
+	hislip->sync_socket = -1;
+	hislip->async_socket = -1;
+
+	return SR_OK;
+}
+
+static int hislip_connect(struct scpi_hislip *hislip)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *res;
+	int err, sock, on;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	err = getaddrinfo(hislip->address, hislip->port, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", hislip->address,
+			hislip->port, gai_strerror(err));
+		return -1;
+	}
+
+	sock = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((sock = socket(res->ai_family, res->ai_socktype,
+				res->ai_protocol)) < 0)
+			continue;
+		if (connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+			close(sock);
+			sock = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+
+	if (sock < 0) {
+		sr_err("Failed to connect to %s:%s: %s", hislip->address,
+			hislip->port, g_strerror(errno));
+		return -1;
+	}
+
+	/* Commands are small, don't have them wait for more data. */
+	on = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const void *)&on, sizeof(on));
+
+	return sock;
+}
+
+static int hislip_send_all(int sock, const uint8_t *buf, size_t len)
+{
+	int out;
+
+	while (len) {
+		out = send(sock, (const char *)buf, len, 0);
+		if (out < 0) {
+			sr_err("Send error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		buf += out;
+		len -= out;
+	}
+
+	return SR_OK;
+}
+
+static int hislip_recv_all(int sock, uint8_t *buf, size_t len)
+{
+	int got;
+
+	while (len) {
+		got = recv(sock, (char *)buf, len, 0);
+		if (got < 0) {
+			sr_err("Receive error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (got == 0) {
+			sr_err("Connection closed by the instrument.");
+			return SR_ERR;
+		}
+		buf += got;
+		len -= got;
+	}
+
+	return SR_OK;
+}
+
+static int hislip_send_message(int sock, uint8_t type, uint8_t control,
+		uint32_t param, const void *payload, uint64_t length)
+{
+	uint8_t header[HISLIP_HEADER_SIZE];
+
+	header[0] = 'H';
+	header[1] = 'S';
+	header[2] = type;
+	header[3] = control;
+	WB32(&header[4], param);
+	WB32(&header[8], length >> 32);
+	WB32(&header[12], length & 0xffffffff);
+
+	if (hislip_send_all(sock, header, sizeof(header)) != SR_OK)
+		return SR_ERR;
+	if (length && hislip_send_all(sock, payload, length) != SR_OK)
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+static int hislip_recv_header(int sock, struct hislip_header *hdr)
+{
+	uint8_t header[HISLIP_HEADER_SIZE];
+
+	if (hislip_recv_all(sock, header, sizeof(header)) != SR_OK)
+		return SR_ERR;
+	if (header[0] != 'H' || header[1] != 'S') {
+		sr_err("Invalid HiSLIP message header.");
+		return SR_ERR_DATA;
+	}
+	hdr->type = header[2];
+	hdr->control = header[3];
+	hdr->param = RB32(&header[4]);
+	hdr->length = ((uint64_t)RB32(&header[8]) << 32) | RB32(&header[12]);
+
+	return SR_OK;
+}
+
+/* Skip or log the payload of a message which is not handled otherwise. */
+static int hislip_skip_payload(int sock, const struct hislip_header *hdr)
+{
+	uint8_t buf[256];
+	uint64_t remain;
+	size_t len;
+	gboolean is_error;
+
+	is_error = hdr->type == HISLIP_ERROR || hdr->type == HISLIP_FATAL_ERROR;
+	remain = hdr->length;
+	while (remain) {
+		len = MIN(remain, sizeof(buf) - 1);
+		if (hislip_recv_all(sock, buf, len) != SR_OK)
+			return SR_ERR;
+		if (is_error) {
+			buf[len] = '\0';
+			sr_err("Instrument reports error %u: %s",
+				hdr->control, (const char *)buf);
+			is_error = FALSE;
+		}
+		remain -= len;
+	}
+
+	return SR_OK;
+}
+
+/* Receive a message of the given type, skipping others. */
+static int hislip_expect(int sock, uint8_t type, struct hislip_header *hdr)
+{
+	while (TRUE) {
+		if (hislip_recv_header(sock, hdr) != SR_OK)
+			return SR_ERR;
+		if (hdr->type == type)
+			return SR_OK;
+		if (hislip_skip_payload(sock, hdr) != SR_OK)
+			return SR_ERR;
+		if (hdr->type == HISLIP_FATAL_ERROR)
+			return SR_ERR;
+	}
+}
+
+static int hislip_open(struct sr_scpi_dev_inst *scpi)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+	struct hislip_header hdr;
+	uint8_t size[8];
+	uint32_t session_id;
+
+	hislip->sync_socket = hislip_connect(hislip);
+	if (hislip->sync_socket < 0)
+		return SR_ERR;
+	if (hislip_send_message(hislip->sync_socket, HISLIP_INITIALIZE, 0,
+			(HISLIP_PROTOCOL_VERSION << 16) | HISLIP_VENDOR_ID,
+			hislip->subaddress, strlen(hislip->subaddress)) != SR_OK)
+		goto fail;
+	if (hislip_expect(hislip->sync_socket,
+			HISLIP_INITIALIZE_RESPONSE, &hdr) != SR_OK)
+		goto fail;
+	if (hislip_skip_payload(hislip->sync_socket, &hdr) != SR_OK)
+		goto fail;
+	hislip->overlapped = hdr.control & 1;
+	session_id = hdr.param & 0xffff;
+
+	hislip->async_socket = hislip_connect(hislip);
+	if (hislip->async_socket < 0)
+		goto fail;
+	if (hislip_send_message(hislip->async_socket,
+			HISLIP_ASYNC_INITIALIZE, 0, session_id, NULL, 0) != SR_OK)
+		goto fail;
+	if (hislip_expect(hislip->async_socket,
+			HISLIP_ASYNC_INITIALIZE_RESPONSE, &hdr) != SR_OK)
+		goto fail;
+	if (hislip_skip_payload(hislip->async_socket, &hdr) != SR_OK)
+		goto fail;
+
+	/* Exchange the maximum message sizes. */
+	WB32(&size[0], 0);
+	WB32(&size[4], HISLIP_MAX_MESSAGE_SIZE);
+	if (hislip_send_message(hislip->async_socket,
+			HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE, 0, 0,
+			size, sizeof(size)) != SR_OK)
+		goto fail;
+	if (hislip_expect(hislip->async_socket,
+			HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE, &hdr) != SR_OK)
+		goto fail;
+	if (hdr.length != sizeof(size)) {
+		sr_err("Unexpected maximum message size response.");
+		goto fail;
+	}
+	if (hislip_recv_all(hislip->async_socket, size, sizeof(size)) != SR_OK)
+		goto fail;
+	hislip->server_max_size = ((uint64_t)RB32(&size[0]) << 32) |
+		RB32(&size[4]);
+	if (!hislip->server_max_size)
+		hislip->server_max_size = G_MAXUINT64;
+
+	hislip->message_id = HISLIP_FIRST_MESSAGE_ID;
+	hislip->rmt_delivered = FALSE;
+	sr_dbg("HiSLIP session %u, %s mode.", session_id,
+		hislip->overlapped ? "overlapped" : "synchronized");
+
+	return SR_OK;
+
+fail:
+	if (hislip->async_socket >= 0)
+		close(hislip->async_socket);
+	close(hislip->sync_socket);
+	hislip->async_socket = -1;
+	hislip->sync_socket = -1;
+
+	return SR_ERR;
+}
+
+static int hislip_connection_id(struct sr_scpi_dev_inst *scpi,
+		char **connection_id)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+
+	*connection_id = g_strdup_printf("%s/%s:%s",
+		scpi->prefix, hislip->address, hislip->port);
+
+	return SR_OK;
+}
+
+static int hislip_source_add(struct sr_session *session, void *priv,
+		int events, int timeout, sr_receive_data_callback cb, void *cb_data)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return sr_session_source_add(session, hislip->sync_socket, events,
+		timeout, cb, cb_data);
+}
+
+static int hislip_source_remove(struct sr_session *session, void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return sr_session_source_remove(session, hislip->sync_socket);
+}
+
+static int hislip_send(void *priv, const char *command)
+{
+	struct scpi_hislip *hislip = priv;
+	size_t len, chunk;
+	uint8_t type, control;
+
+	/* The END indicator of DataEnd replaces the line termination. */
+	len = strlen(command);
+	if (len && command[len - 1] == '\n')
+		len--;
+
+	do {
+		chunk = MIN(len, hislip->server_max_size);
+		type = chunk == len ? HISLIP_DATA_END : HISLIP_DATA;
+		control = hislip->rmt_delivered ? 1 : 0;
+		if (hislip_send_message(hislip->sync_socket, type, control,
+				hislip->message_id, command, chunk) != SR_OK)
+			return SR_ERR;
+		hislip->rmt_delivered = FALSE;
+		hislip->message_id += 2;
+		command += chunk;
+		len -= chunk;
+	} while (len);
+
+	sr_spew("Successfully sent SCPI command.");
+
+	return SR_OK;
+}
+
+static int hislip_read_begin(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	hislip->payload_remain = 0;
+	hislip->in_data_end = FALSE;
+	hislip->read_done = FALSE;
+
+	return SR_OK;
+}
+
+static int hislip_read_data(void *priv, char *buf, int maxlen)
+{
+	struct scpi_hislip *hislip = priv;
+	struct hislip_header hdr;
+	int len;
+
+	while (!hislip->payload_remain) {
+		if (hislip->read_done)
+			return 0;
+		if (hislip_recv_header(hislip->sync_socket, &hdr) != SR_OK)
+			return SR_ERR;
+		switch (hdr.type) {
+		case HISLIP_DATA:
+		case HISLIP_DATA_END:
+			hislip->in_data_end = hdr.type == HISLIP_DATA_END;
+			hislip->payload_remain = hdr.length;
+			if (hislip->in_data_end && !hdr.length) {
+				hislip->read_done = TRUE;
+				hislip->rmt_delivered = TRUE;
+			}
+			break;
+		case HISLIP_FATAL_ERROR:
+		case HISLIP_ERROR:
+			hislip_skip_payload(hislip->sync_socket, &hdr);
+			return SR_ERR;
+		default:
+			/* E.g. Interrupted, in overlapped mode. */
+			if (hislip_skip_payload(hislip->sync_socket, &hdr) != SR_OK)
+				return SR_ERR;
+			break;
+		}
+	}
+
+	len = recv(hislip->sync_socket, buf,
+		MIN((uint64_t)maxlen, hislip->payload_remain), 0);
+	if (len < 0) {
+		sr_err("Receive error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+	if (len == 0) {
+		sr_err("Connection closed by the instrument.");
+		return SR_ERR;
+	}
+
+	hislip->payload_remain -= len;
+	if (!hislip->payload_remain && hislip->in_data_end) {
+		hislip->read_done = TRUE;
+		hislip->rmt_delivered = TRUE;
+	}
+
+	return len;
+}
+
+static int hislip_read_complete(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return hislip->read_done;
+}
+
+/*
+ * Abort the current operation, and discard pending responses, without
+ * tearing down the connection.
+ */
+static int hislip_device_clear(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+	struct hislip_header hdr;
+	uint8_t control;
+
+	if (hislip_send_message(hislip->async_socket,
+			HISLIP_ASYNC_DEVICE_CLEAR, 0, 0, NULL, 0) != SR_OK)
+		return SR_ERR;
+	if (hislip_expect(hislip->async_socket,
+			HISLIP_ASYNC_DEVICE_CLEAR_ACKNOWLEDGE, &hdr) != SR_OK)
+		return SR_ERR;
+	if (hislip_skip_payload(hislip->async_socket, &hdr) != SR_OK)
+		return SR_ERR;
+
+	/* Accept the server's preferred mode. */
+	control = hdr.control & 1;
+	if (hislip_send_message(hislip->sync_socket,
+			HISLIP_DEVICE_CLEAR_COMPLETE, control, 0, NULL, 0) != SR_OK)
+		return SR_ERR;
+
+	/* Whatever was still underway on the sync channel gets dropped. */
+	if (hislip_expect(hislip->sync_socket,
+			HISLIP_DEVICE_CLEAR_ACKNOWLEDGE, &hdr) != SR_OK)
+		return SR_ERR;
+	if (hislip_skip_payload(hislip->sync_socket, &hdr) != SR_OK)
+		return SR_ERR;
+
+	hislip->overlapped = hdr.control & 1;
+	hislip->message_id = HISLIP_FIRST_MESSAGE_ID;
+	hislip->rmt_delivered = FALSE;
+	hislip_read_begin(hislip);
+
+	return SR_OK;
+}
+
+static int hislip_close(struct sr_scpi_dev_inst *scpi)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+	int ret;
+
+	ret = SR_OK;
+	if (hislip->async_socket >= 0 && close(hislip->async_socket) < 0)
+		ret = SR_ERR;
+	if (close(hislip->sync_socket) < 0)
+		ret = SR_ERR;
+	hislip->async_socket = -1;
+	hislip->sync_socket = -1;
+
+	return ret;
+}
+
+static void hislip_free(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	g_free(hislip->address);
+	g_free(hislip->port);
+	g_free(hislip->subaddress);
+}
+
+SR_PRIV const struct sr_scpi_dev_inst scpi_hislip_dev = {
+	.name          = "HiSLIP",
+	.prefix        = "hislip",
+	.transport     = SCPI_TRANSPORT_HISLIP,
+	.priv_size     = sizeof(struct scpi_hislip),
+	.dev_inst_new  = hislip_dev_inst_new,
+	.open          = hislip_open,
+	.connection_id = hislip_connection_id,
+	.source_add    = hislip_source_add,
+	.source_remove = hislip_source_remove,
+	.send          = hislip_send,
+	.read_begin    = hislip_read_begin,
+	.read_data     = hislip_read_data,
+	.read_complete = hislip_read_complete,
+	.device_clear  = hislip_device_clear,
+	.close         = hislip_close,
+	.free          = hislip_free,
+};
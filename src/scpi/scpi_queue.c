@@ -0,0 +1,440 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Queued SCPI transactions.
+ *
+ * Drivers which poll many values would otherwise pay one round trip per
+ * query. The queue joins consecutive commands into one program message
+ * ("A?;:B?;:C 1", see IEEE 488.2), sends it at once, and splits the
+ * single response line into the individual query results. Completion
+ * callbacks run in submission order.
+ *
+ * When the queue is attached to a session, transactions make progress
+ * from the session's event loop: messages get sent when the connection
+ * is idle, and responses get read with a single transport read per
+ * dispatch, once the connection's descriptor is readable. Transports
+ * without a pollable descriptor (USBTMC, GPIB) are read on every poll
+ * interval instead, and may still wait inside their read callback.
+ *
+ * While transactions are in flight the connection must not be used
+ * other than through the queue, or responses would get mixed up.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+#define LOG_PREFIX "scpi"
+
+/* Poll interval of the session source, in milliseconds. */
+#define QUEUE_POLL_MS 10
+
+struct queue_item {
+	char *command;
+	int flags;
+	sr_scpi_queue_callback cb;
+	void *cb_data;
+};
+
+struct sr_scpi_queue {
+	struct sr_scpi_dev_inst *scpi;
+	unsigned int max_join;
+	/* Items which were not sent yet. */
+	GQueue pending;
+	/* Items of the program message which currently is in flight. */
+	GQueue inflight;
+	unsigned int inflight_queries;
+	gboolean reading;
+	/* Whether the last read returned any data. */
+	gboolean got_data;
+	GString *response;
+	gint64 deadline;
+	/* Guards against recursion from completion callbacks. */
+	gboolean stepping;
+	struct sr_session *session;
+};
+
+static void item_complete(struct queue_item *item, int status,
+		const char *response)
+{
+	if (item->cb)
+		item->cb(item->cb_data, status, response);
+	g_free(item->command);
+	g_free(item);
+}
+
+/* Complete the in flight items with an error. */
+static void inflight_fail(struct sr_scpi_queue *queue, int status)
+{
+	struct queue_item *item;
+
+	while ((item = g_queue_pop_head(&queue->inflight)))
+		item_complete(item, status, NULL);
+	queue->inflight_queries = 0;
+	queue->reading = FALSE;
+}
+
+/*
+ * Split a response line at the unit separators, and pass the fields to
+ * the in flight items. Separators in quoted strings don't count.
+ */
+static void inflight_dispatch(struct sr_scpi_queue *queue)
+{
+	struct queue_item *item;
+	char *field, *p, quote;
+	GPtrArray *fields;
+	guint idx;
+
+	g_strchomp(queue->response->str);
+	fields = g_ptr_array_new();
+	field = queue->response->str;
+	quote = 0;
+	for (p = field; *p; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = 0;
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		} else if (*p == ';') {
+			*p = '\0';
+			g_ptr_array_add(fields, field);
+			field = p + 1;
+		}
+	}
+	g_ptr_array_add(fields, field);
+
+	if (fields->len != queue->inflight_queries) {
+		sr_err("Expected %u responses, got %u.",
+			queue->inflight_queries, fields->len);
+		g_ptr_array_free(fields, TRUE);
+		inflight_fail(queue, SR_ERR_DATA);
+		return;
+	}
+
+	idx = 0;
+	while ((item = g_queue_pop_head(&queue->inflight))) {
+		if (item->flags & SR_SCPI_QUEUE_QUERY)
+			item_complete(item, SR_OK, g_strstrip(fields->pdata[idx++]));
+		else
+			item_complete(item, SR_OK, NULL);
+	}
+	g_ptr_array_free(fields, TRUE);
+	queue->inflight_queries = 0;
+	queue->reading = FALSE;
+}
+
+/* Join pending items into one program message, and send it. */
+static int queue_send(struct sr_scpi_queue *queue)
+{
+	struct queue_item *item;
+	GString *msg;
+	unsigned int count;
+	int ret;
+
+	msg = g_string_sized_new(256);
+	count = 0;
+	while ((item = g_queue_peek_head(&queue->pending))) {
+		if (count && (count == queue->max_join ||
+				(item->flags & SR_SCPI_QUEUE_ALONE)))
+			break;
+		if (count) {
+			g_string_append_c(msg, ';');
+			/* Use absolute headers, follow ups are relative. */
+			if (item->command[0] != ':' && item->command[0] != '*')
+				g_string_append_c(msg, ':');
+		}
+		g_string_append(msg, item->command);
+		g_queue_push_tail(&queue->inflight, g_queue_pop_head(&queue->pending));
+		if (item->flags & SR_SCPI_QUEUE_QUERY)
+			queue->inflight_queries++;
+		count++;
+		if (item->flags & SR_SCPI_QUEUE_ALONE)
+			break;
+	}
+
+	sr_spew("Sending %u queued commands: '%s'.", count, msg->str);
+	ret = sr_scpi_send(queue->scpi, "%s", msg->str);
+	g_string_free(msg, TRUE);
+	if (ret != SR_OK) {
+		inflight_fail(queue, SR_ERR_IO);
+		return SR_ERR_IO;
+	}
+
+	/* Commands without queries have no response to wait for. */
+	if (!queue->inflight_queries) {
+		while ((item = g_queue_pop_head(&queue->inflight)))
+			item_complete(item, SR_OK, NULL);
+		return SR_OK;
+	}
+
+	if (sr_scpi_read_begin(queue->scpi) != SR_OK) {
+		inflight_fail(queue, SR_ERR_IO);
+		return SR_ERR_IO;
+	}
+	g_string_truncate(queue->response, 0);
+	queue->deadline = g_get_monotonic_time() + queue->scpi->read_timeout_us;
+	queue->reading = TRUE;
+
+	return SR_OK;
+}
+
+/* Read once from the connection, and dispatch the completed response. */
+static void queue_receive(struct sr_scpi_queue *queue)
+{
+	GString *response;
+	gsize oldlen;
+	int ret;
+
+	response = queue->response;
+	if (response->allocated_len - response->len < 128) {
+		oldlen = response->len;
+		g_string_set_size(response, oldlen + 1024);
+		g_string_set_size(response, oldlen);
+	}
+	ret = sr_scpi_read_response(queue->scpi, response, queue->deadline);
+	queue->got_data = ret > 0;
+	if (ret < 0) {
+		inflight_fail(queue, ret);
+		return;
+	}
+	if (ret > 0)
+		queue->deadline = g_get_monotonic_time() +
+			queue->scpi->read_timeout_us;
+
+	if (sr_scpi_read_complete(queue->scpi))
+		inflight_dispatch(queue);
+}
+
+/*
+ * Send pending messages while no response is outstanding, and read at
+ * most once from the connection when may_read is set. Returns TRUE when
+ * a response is outstanding, FALSE when the queue ran empty.
+ */
+static gboolean queue_step(struct sr_scpi_queue *queue, gboolean may_read)
+{
+	if (queue->stepping)
+		return TRUE;
+
+	queue->stepping = TRUE;
+	queue->got_data = FALSE;
+	while (TRUE) {
+		if (queue->reading) {
+			if (may_read) {
+				may_read = FALSE;
+				queue_receive(queue);
+				continue;
+			}
+			if (g_get_monotonic_time() > queue->deadline) {
+				sr_err("Timed out waiting for queued responses.");
+				inflight_fail(queue, SR_ERR_TIMEOUT);
+				continue;
+			}
+			break;
+		}
+		if (g_queue_is_empty(&queue->pending))
+			break;
+		queue_send(queue);
+	}
+	queue->stepping = FALSE;
+
+	return queue->reading;
+}
+
+static int queue_source_cb(int fd, int revents, void *cb_data)
+{
+	/* Only read when that won't wait, if the transport can tell. */
+	queue_step(cb_data, fd < 0 || (revents & G_IO_IN));
+
+	return TRUE;
+}
+
+/**
+ * Create a transaction queue for a SCPI connection.
+ *
+ * @param scpi Previously opened SCPI device structure.
+ * @param max_join Maximum number of commands to join into one program
+ *                 message, 1 to send them individually.
+ *
+ * @return The new queue, or NULL on invalid arguments.
+ */
+SR_PRIV struct sr_scpi_queue *sr_scpi_queue_new(struct sr_scpi_dev_inst *scpi,
+		unsigned int max_join)
+{
+	struct sr_scpi_queue *queue;
+
+	if (!scpi || !max_join)
+		return NULL;
+
+	queue = g_malloc0(sizeof(*queue));
+	queue->scpi = scpi;
+	queue->max_join = max_join;
+	g_queue_init(&queue->pending);
+	g_queue_init(&queue->inflight);
+	queue->response = g_string_sized_new(1024);
+
+	return queue;
+}
+
+/**
+ * Release a transaction queue.
+ *
+ * The queue gets detached from its session. Outstanding transactions
+ * complete with SR_ERR_NA, without waiting for their responses.
+ *
+ * @param queue The queue to release, may be NULL.
+ */
+SR_PRIV void sr_scpi_queue_free(struct sr_scpi_queue *queue)
+{
+	struct queue_item *item;
+
+	if (!queue)
+		return;
+
+	sr_scpi_queue_detach(queue);
+	inflight_fail(queue, SR_ERR_NA);
+	while ((item = g_queue_pop_head(&queue->pending)))
+		item_complete(item, SR_ERR_NA, NULL);
+	g_string_free(queue->response, TRUE);
+	g_free(queue);
+}
+
+/**
+ * Queue a SCPI command or query.
+ *
+ * The callback runs when the transaction completed, with SR_OK and the
+ * response text for queries, NULL for plain commands. The response text
+ * is only valid during the callback. On failure the callback receives an
+ * SR_ERR_* code. When the queue is attached to a session and idle, the
+ * command gets sent right away.
+ *
+ * @param queue The queue to use.
+ * @param flags SR_SCPI_QUEUE_QUERY when a response is expected, and/or
+ *              SR_SCPI_QUEUE_ALONE when the command must not get joined
+ *              with others (e.g. block data responses, or instruments
+ *              which don't support compound messages for it).
+ * @param cb Completion callback, may be NULL.
+ * @param cb_data Argument to pass to the callback.
+ * @param command The command text, without the trailing newline.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_scpi_queue_add(struct sr_scpi_queue *queue, int flags,
+		sr_scpi_queue_callback cb, void *cb_data, const char *command)
+{
+	struct queue_item *item;
+
+	if (!queue || !command || !*command)
+		return SR_ERR_ARG;
+
+	item = g_malloc0(sizeof(*item));
+	item->command = g_strdup(command);
+	item->flags = flags;
+	item->cb = cb;
+	item->cb_data = cb_data;
+	g_queue_push_tail(&queue->pending, item);
+
+	if (queue->session && !queue->reading)
+		queue_step(queue, FALSE);
+
+	return SR_OK;
+}
+
+/**
+ * Complete all queued transactions, blocking until they are done.
+ *
+ * @param queue The queue to use.
+ *
+ * @retval SR_OK Success. Failures of individual transactions are
+ *               reported to their callbacks.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_scpi_queue_run(struct sr_scpi_queue *queue)
+{
+	if (!queue)
+		return SR_ERR_ARG;
+
+	while (queue_step(queue, TRUE)) {
+		if (!queue->got_data)
+			g_usleep(1000);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Have the transactions of a queue progress from a session's event loop.
+ *
+ * This installs the connection's event source, so the connection must not
+ * have another one meanwhile.
+ *
+ * @param queue The queue to use.
+ * @param session The session to attach to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The event source could not be added.
+ */
+SR_PRIV int sr_scpi_queue_attach(struct sr_scpi_queue *queue,
+		struct sr_session *session)
+{
+	int ret;
+
+	if (!queue || !session || queue->session)
+		return SR_ERR_ARG;
+
+	ret = sr_scpi_source_add(session, queue->scpi, G_IO_IN,
+		QUEUE_POLL_MS, queue_source_cb, queue);
+	if (ret != SR_OK)
+		return ret;
+	queue->session = session;
+	queue_step(queue, FALSE);
+
+	return SR_OK;
+}
+
+/**
+ * Stop the transactions of a queue from progressing on the session loop.
+ *
+ * Transactions remain queued, and are resumed by sr_scpi_queue_run() or
+ * another sr_scpi_queue_attach().
+ *
+ * @param queue The queue to use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_scpi_queue_detach(struct sr_scpi_queue *queue)
+{
+	int ret;
+
+	if (!queue)
+		return SR_ERR_ARG;
+	if (!queue->session)
+		return SR_OK;
+
+	ret = sr_scpi_source_remove(queue->session, queue->scpi);
+	queue->session = NULL;
+
+	return ret;
+}
@@ -27,6 +27,8 @@
 #include <string.h>
 #include <unistd.h>
 #ifndef _WIN32
+#include <fcntl.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -41,6 +43,22 @@
 
 #define LENGTH_BYTES 4
 
+/* Instruments announce themselves as either of these (DNS-SD). */
+#define MDNS_SERVICE_SCPI_RAW	"_scpi-raw._tcp.local"
+#define MDNS_SERVICE_LXI	"_lxi._tcp.local"
+#define MDNS_ADDRESS		"224.0.0.251"
+#define MDNS_PORT		5353
+/* How long responses to the discovery queries get collected. */
+#define MDNS_TIMEOUT_MS		1200
+/* The query gets repeated once, in case it got lost. */
+#define MDNS_REPEAT_MS		300
+/* The SCPI socket of LXI instruments which don't announce a port. */
+#define LXI_SCPI_RAW_PORT	5025
+
+#define DNS_TYPE_PTR	12
+#define DNS_TYPE_SRV	33
+#define DNS_CLASS_IN	1
+
 struct scpi_tcp {
 	char *address;
 	char *port;
@@ -72,6 +90,70 @@ static int scpi_tcp_dev_inst_new(void *priv, struct drv_context *drvc,
 	return SR_OK;
 }
 
+static void socket_set_nonblocking(int sock, gboolean enable)
+{
+#ifdef _WIN32
+	u_long mode;
+
+	mode = enable ? 1 : 0;
+	ioctlsocket(sock, FIONBIO, &mode);
+#else
+	int flags;
+
+	flags = fcntl(sock, F_GETFL, 0);
+	if (flags < 0)
+		return;
+	flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+	fcntl(sock, F_SETFL, flags);
+#endif
+}
+
+/* Connect, giving up after @a timeout_ms milliseconds (unless 0). */
+static int socket_connect(int sock, const struct sockaddr *addr,
+		socklen_t addrlen, unsigned int timeout_ms)
+{
+	struct timeval tv;
+	fd_set wfds;
+	int err;
+	socklen_t errlen;
+
+	if (!timeout_ms)
+		return connect(sock, addr, addrlen);
+
+	socket_set_nonblocking(sock, TRUE);
+	if (connect(sock, addr, addrlen) == 0) {
+		socket_set_nonblocking(sock, FALSE);
+		return 0;
+	}
+#ifdef _WIN32
+	if (WSAGetLastError() != WSAEWOULDBLOCK)
+		return -1;
+#else
+	if (errno != EINPROGRESS)
+		return -1;
+#endif
+
+	FD_ZERO(&wfds);
+	FD_SET(sock, &wfds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	if (select(sock + 1, NULL, &wfds, NULL, &tv) <= 0) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+	err = 0;
+	errlen = sizeof(err);
+	if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (void *)&err, &errlen) < 0)
+		return -1;
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	socket_set_nonblocking(sock, FALSE);
+
+	return 0;
+}
+
 static int scpi_tcp_open(struct sr_scpi_dev_inst *scpi)
 {
 	struct scpi_tcp *tcp = scpi->priv;
@@ -96,7 +178,8 @@ static int scpi_tcp_open(struct sr_scpi_dev_inst *scpi)
 		if ((tcp->socket = socket(res->ai_family, res->ai_socktype,
 						res->ai_protocol)) < 0)
 			continue;
-		if (connect(tcp->socket, res->ai_addr, res->ai_addrlen) != 0) {
+		if (socket_connect(tcp->socket, res->ai_addr, res->ai_addrlen,
+				scpi->connect_timeout_ms) != 0) {
 			close(tcp->socket);
 			tcp->socket = -1;
 			continue;
@@ -115,6 +198,213 @@ static int scpi_tcp_open(struct sr_scpi_dev_inst *scpi)
 	return SR_OK;
 }
 
+/* Append a question for the PTR records of a service. */
+static void mdns_question(GByteArray *msg, const char *service)
+{
+	gchar **labels;
+	uint8_t len, tail[4];
+	size_t i;
+
+	labels = g_strsplit(service, ".", 0);
+	for (i = 0; labels[i]; i++) {
+		len = strlen(labels[i]);
+		g_byte_array_append(msg, &len, 1);
+		g_byte_array_append(msg, (const guint8 *)labels[i], len);
+	}
+	g_strfreev(labels);
+	len = 0;
+	g_byte_array_append(msg, &len, 1);
+	WB16(&tail[0], DNS_TYPE_PTR);
+	WB16(&tail[2], DNS_CLASS_IN);
+	g_byte_array_append(msg, tail, sizeof(tail));
+}
+
+/*
+ * Read a (possibly compressed) name at @a pos into @a name, and advance
+ * @a pos past it. Returns FALSE for malformed names.
+ */
+static gboolean mdns_read_name(const uint8_t *msg, size_t len, size_t *pos,
+		GString *name)
+{
+	size_t p, next;
+	unsigned int jumps;
+	uint8_t l;
+
+	g_string_truncate(name, 0);
+	p = *pos;
+	next = 0;
+	jumps = 0;
+	for (;;) {
+		if (p >= len)
+			return FALSE;
+		l = msg[p];
+		if ((l & 0xc0) == 0xc0) {
+			if (p + 1 >= len || ++jumps > 16)
+				return FALSE;
+			if (!next)
+				next = p + 2;
+			p = ((l & 0x3f) << 8) | msg[p + 1];
+			continue;
+		}
+		if (!l)
+			break;
+		if (p + 1 + l > len)
+			return FALSE;
+		if (name->len)
+			g_string_append_c(name, '.');
+		g_string_append_len(name, (const char *)&msg[p + 1], l);
+		p += 1 + l;
+	}
+	*pos = next ? next : p + 1;
+
+	return TRUE;
+}
+
+static gboolean mdns_name_is(const GString *name, const char *service)
+{
+	size_t slen;
+
+	slen = strlen(service);
+	if (name->len < slen)
+		return FALSE;
+
+	return !g_ascii_strcasecmp(name->str + name->len - slen, service);
+}
+
+/*
+ * Find the SCPI port which a response announces: the port of a raw
+ * SCPI service, else the standard port for LXI instruments. Returns 0
+ * when the response is about neither.
+ */
+static unsigned int mdns_response_port(const uint8_t *msg, size_t len)
+{
+	GString *name;
+	size_t pos, rdpos;
+	unsigned int count, i, type, rdlen, port;
+	gboolean lxi;
+
+	if (len < 12 || !(msg[2] & 0x80))
+		return 0;
+	/* Answers, authority and additional records. */
+	count = RB16(&msg[6]) + RB16(&msg[8]) + RB16(&msg[10]);
+
+	name = g_string_sized_new(64);
+	pos = 12;
+	for (i = RB16(&msg[4]); i; i--) {
+		if (!mdns_read_name(msg, len, &pos, name) || pos + 4 > len)
+			goto out;
+		pos += 4;
+	}
+	port = 0;
+	lxi = FALSE;
+	for (i = 0; i < count && !port; i++) {
+		if (!mdns_read_name(msg, len, &pos, name) || pos + 10 > len)
+			break;
+		type = RB16(&msg[pos]);
+		rdlen = RB16(&msg[pos + 8]);
+		rdpos = pos + 10;
+		if (rdpos + rdlen > len)
+			break;
+		if (type == DNS_TYPE_SRV && rdlen >= 6 &&
+				mdns_name_is(name, MDNS_SERVICE_SCPI_RAW))
+			port = RB16(&msg[rdpos + 4]);
+		if (mdns_name_is(name, MDNS_SERVICE_LXI))
+			lxi = TRUE;
+		pos = rdpos + rdlen;
+	}
+	if (!port && lxi)
+		port = LXI_SCPI_RAW_PORT;
+out:
+	g_string_free(name, TRUE);
+
+	return port;
+}
+
+/*
+ * Discover networked instruments by their DNS-SD announcements. The
+ * queries are sent from an ephemeral port, which makes responders send
+ * their answers to this port directly (RFC 6762, section 6.7). The
+ * instruments get reported by their response's source address.
+ */
+static GSList *scpi_tcp_raw_scan(struct drv_context *drvc)
+{
+	struct sockaddr_in dest, src;
+	socklen_t srclen;
+	struct timeval tv;
+	fd_set rfds;
+	GByteArray *query;
+	GSList *resources;
+	char *resource, addr[INET_ADDRSTRLEN];
+	uint8_t buf[1500];
+	gint64 now, end_time, send_time;
+	unsigned int port, sends;
+	int sock, len;
+
+	(void)drvc;
+
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
+		sr_err("Cannot create discovery socket: %s", g_strerror(errno));
+		return NULL;
+	}
+
+	query = g_byte_array_new();
+	memset(buf, 0, 12);
+	WB16(&buf[4], 2);
+	g_byte_array_append(query, buf, 12);
+	mdns_question(query, MDNS_SERVICE_SCPI_RAW);
+	mdns_question(query, MDNS_SERVICE_LXI);
+
+	memset(&dest, 0, sizeof(dest));
+	dest.sin_family = AF_INET;
+	dest.sin_port = htons(MDNS_PORT);
+	dest.sin_addr.s_addr = inet_addr(MDNS_ADDRESS);
+
+	resources = NULL;
+	now = g_get_monotonic_time();
+	end_time = now + MDNS_TIMEOUT_MS * 1000;
+	send_time = now;
+	sends = 0;
+	while ((now = g_get_monotonic_time()) < end_time) {
+		if (sends < 2 && now >= send_time) {
+			if (sendto(sock, (const void *)query->data, query->len, 0,
+					(struct sockaddr *)&dest, sizeof(dest)) < 0)
+				sr_warn("Cannot send discovery query: %s",
+					g_strerror(errno));
+			send_time = now + MDNS_REPEAT_MS * 1000;
+			sends++;
+		}
+		FD_ZERO(&rfds);
+		FD_SET(sock, &rfds);
+		tv.tv_sec = 0;
+		tv.tv_usec = MIN(end_time - now, MDNS_REPEAT_MS * 1000);
+		if (select(sock + 1, &rfds, NULL, NULL, &tv) <= 0)
+			continue;
+		srclen = sizeof(src);
+		len = recvfrom(sock, (void *)buf, sizeof(buf), 0,
+			(struct sockaddr *)&src, &srclen);
+		if (len <= 0 || src.sin_family != AF_INET)
+			continue;
+		if (!(port = mdns_response_port(buf, len)))
+			continue;
+		if (!inet_ntop(AF_INET, &src.sin_addr, addr, sizeof(addr)))
+			continue;
+		resource = g_strdup_printf("tcp-raw/%s/%u", addr, port);
+		if (g_slist_find_custom(resources, resource,
+				(GCompareFunc)g_strcmp0)) {
+			g_free(resource);
+			continue;
+		}
+		sr_dbg("Discovered %s.", resource);
+		resources = g_slist_append(resources, resource);
+	}
+
+	g_byte_array_free(query, TRUE);
+	close(sock);
+
+	return resources;
+}
+
 static int scpi_tcp_connection_id(struct sr_scpi_dev_inst *scpi,
 		char **connection_id)
 {
@@ -276,6 +566,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_raw_dev = {
 	.prefix        = "tcp-raw",
 	.transport     = SCPI_TRANSPORT_RAW_TCP,
 	.priv_size     = sizeof(struct scpi_tcp),
+	.scan          = scpi_tcp_raw_scan,
 	.dev_inst_new  = scpi_tcp_dev_inst_new,
 	.open          = scpi_tcp_open,
 	.connection_id = scpi_tcp_connection_id,
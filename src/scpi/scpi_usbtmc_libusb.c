@@ -29,6 +29,14 @@
 #define MAX_TRANSFER_LENGTH 2048
 #define TRANSFER_TIMEOUT 1000
 
+/*
+ * Long responses get read with several large bulk IN transfers queued
+ * at the same time, so the instrument need not wait for the host while
+ * the data of a completed transfer is handed out.
+ */
+#define BULKIN_TRANSFERS 4
+#define BULKIN_TRANSFER_SIZE (256 * 1024)
+
 struct scpi_usbtmc_libusb {
 	struct sr_context *ctx;
 	struct sr_usb_dev_inst *usb;
@@ -40,12 +48,21 @@ struct scpi_usbtmc_libusb {
 	uint8_t usbtmc_int_cap;
 	uint8_t usbtmc_dev_cap;
 	uint8_t usb488_dev_cap;
+	uint16_t bulk_in_max_packet;
 	uint8_t bTag;
 	uint8_t bulkin_attributes;
 	uint8_t buffer[MAX_TRANSFER_LENGTH];
+	const uint8_t *response_data;
 	int response_length;
 	int response_bytes_read;
 	int remaining_length;
+	/* Queue of bulk IN transfers, for the remainder of long responses. */
+	struct libusb_transfer *transfers[BULKIN_TRANSFERS];
+	int transfer_done[BULKIN_TRANSFERS];
+	unsigned int transfers_head;
+	unsigned int transfers_queued;
+	gboolean head_in_use;
+	int unqueued_length;
 };
 
 /* Some USBTMC-specific enums, as defined in the USBTMC standard. */
@@ -186,7 +203,7 @@ static int scpi_usbtmc_libusb_dev_inst_new(void *priv, struct drv_context *drvc,
 	}
 
 	uscpi->ctx = drvc->sr_ctx;
-	devices = sr_usb_find(uscpi->ctx->libusb_ctx, params[1]);
+	devices = sr_usb_find(uscpi->ctx, params[1]);
 	if (g_slist_length(devices) != 1) {
 		sr_err("Failed to find USB device '%s'.", params[1]);
 		g_slist_free_full(devices, (GDestroyNotify)sr_usb_dev_inst_free);
@@ -338,6 +355,7 @@ static int scpi_usbtmc_libusb_open(struct sr_scpi_dev_inst *scpi)
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_BULK &&
 				    ep->bEndpointAddress & (LIBUSB_ENDPOINT_DIR_MASK)) {
 					uscpi->bulk_in_ep = ep->bEndpointAddress;
+					uscpi->bulk_in_max_packet = ep->wMaxPacketSize;
 					sr_dbg("Bulk IN EP %d", uscpi->bulk_in_ep & 0x7f);
 				}
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_INTERRUPT &&
@@ -563,27 +581,148 @@ static int scpi_usbtmc_bulkin_start(struct scpi_usbtmc_libusb *uscpi,
 	}
 
 	message_size += USBTMC_BULK_HEADER_SIZE;
+	uscpi->response_data = data;
 	uscpi->response_length = MIN(transferred, message_size);
 	uscpi->response_bytes_read = USBTMC_BULK_HEADER_SIZE;
 	uscpi->remaining_length = message_size - uscpi->response_length;
+	uscpi->unqueued_length = uscpi->remaining_length;
 
 	return transferred - USBTMC_BULK_HEADER_SIZE;
 }
 
-static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi,
-                                       void *data, int size)
+static void LIBUSB_CALL bulkin_transfer_done(struct libusb_transfer *transfer)
 {
-	struct sr_usb_dev_inst *usb = uscpi->usb;
+	int *done = transfer->user_data;
+
+	*done = 1;
+}
+
+/* Cancel the queued bulk IN transfers, and wait for them to come back. */
+static void scpi_usbtmc_bulkin_cancel(struct scpi_usbtmc_libusb *uscpi)
+{
+	unsigned int i, idx;
+
+	for (i = 0; i < uscpi->transfers_queued; i++) {
+		idx = (uscpi->transfers_head + i) % BULKIN_TRANSFERS;
+		if (!uscpi->transfer_done[idx])
+			libusb_cancel_transfer(uscpi->transfers[idx]);
+	}
+	for (i = 0; i < uscpi->transfers_queued; i++) {
+		idx = (uscpi->transfers_head + i) % BULKIN_TRANSFERS;
+		while (!uscpi->transfer_done[idx]) {
+			if (libusb_handle_events_completed(uscpi->ctx->libusb_ctx,
+					&uscpi->transfer_done[idx]) < 0)
+				break;
+		}
+	}
+
+	uscpi->transfers_head = 0;
+	uscpi->transfers_queued = 0;
+	uscpi->head_in_use = FALSE;
+	uscpi->unqueued_length = 0;
+}
+
+static void scpi_usbtmc_bulkin_free(struct scpi_usbtmc_libusb *uscpi)
+{
+	unsigned int i;
+
+	scpi_usbtmc_bulkin_cancel(uscpi);
+	for (i = 0; i < BULKIN_TRANSFERS; i++) {
+		if (!uscpi->transfers[i])
+			continue;
+		g_free(uscpi->transfers[i]->buffer);
+		libusb_free_transfer(uscpi->transfers[i]);
+		uscpi->transfers[i] = NULL;
+	}
+}
+
+/* Queue transfers for the part of the response which was not requested yet. */
+static int scpi_usbtmc_bulkin_submit(struct scpi_usbtmc_libusb *uscpi)
+{
+	struct libusb_transfer *transfer;
+	unsigned int idx;
+	int length, packet, ret;
+
+	packet = uscpi->bulk_in_max_packet ? uscpi->bulk_in_max_packet : 64;
+	while (uscpi->transfers_queued < BULKIN_TRANSFERS &&
+			uscpi->unqueued_length > 0) {
+		idx = (uscpi->transfers_head + uscpi->transfers_queued) %
+			BULKIN_TRANSFERS;
+		transfer = uscpi->transfers[idx];
+		if (!transfer) {
+			transfer = libusb_alloc_transfer(0);
+			if (!transfer)
+				return SR_ERR_MALLOC;
+			transfer->buffer = g_malloc(BULKIN_TRANSFER_SIZE);
+			uscpi->transfers[idx] = transfer;
+		}
+
+		/*
+		 * All but the last transfer are a multiple of the packet
+		 * size. The last one has room for the alignment padding.
+		 */
+		length = MIN(uscpi->unqueued_length, BULKIN_TRANSFER_SIZE);
+		length = (length + packet - 1) / packet * packet;
+		libusb_fill_bulk_transfer(transfer, uscpi->usb->devhdl,
+			uscpi->bulk_in_ep, transfer->buffer, length,
+			bulkin_transfer_done, &uscpi->transfer_done[idx],
+			TRANSFER_TIMEOUT * BULKIN_TRANSFERS);
+		uscpi->transfer_done[idx] = 0;
+		if ((ret = libusb_submit_transfer(transfer)) < 0) {
+			sr_err("USBTMC bulk in transfer error: %s.",
+			       libusb_error_name(ret));
+			return SR_ERR;
+		}
+		uscpi->transfers_queued++;
+		uscpi->unqueued_length -= MIN(uscpi->unqueued_length, length);
+	}
+
+	return SR_OK;
+}
+
+static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi)
+{
+	struct libusb_transfer *transfer;
 	int ret, transferred;
 
-	ret = libusb_bulk_transfer(usb->devhdl, uscpi->bulk_in_ep, data, size,
-	                           &transferred, TRANSFER_TIMEOUT);
-	if (ret < 0) {
+	/* The previous transfer's data was handed out, its slot is free. */
+	if (uscpi->head_in_use) {
+		uscpi->transfers_head = (uscpi->transfers_head + 1) %
+			BULKIN_TRANSFERS;
+		uscpi->transfers_queued--;
+		uscpi->head_in_use = FALSE;
+	}
+
+	if (scpi_usbtmc_bulkin_submit(uscpi) != SR_OK || !uscpi->transfers_queued) {
+		scpi_usbtmc_bulkin_cancel(uscpi);
+		return SR_ERR;
+	}
+
+	transfer = uscpi->transfers[uscpi->transfers_head];
+	while (!uscpi->transfer_done[uscpi->transfers_head]) {
+		ret = libusb_handle_events_completed(uscpi->ctx->libusb_ctx,
+			&uscpi->transfer_done[uscpi->transfers_head]);
+		if (ret < 0) {
+			sr_err("USBTMC bulk in transfer error: %s.",
+			       libusb_error_name(ret));
+			scpi_usbtmc_bulkin_cancel(uscpi);
+			return SR_ERR;
+		}
+	}
+	uscpi->head_in_use = TRUE;
+
+	transferred = transfer->actual_length;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+	    (transferred < uscpi->remaining_length &&
+	     transferred < transfer->length)) {
 		sr_err("USBTMC bulk in transfer error: %s.",
-		       libusb_error_name(ret));
+		       transfer->status == LIBUSB_TRANSFER_COMPLETED ?
+		       "short transfer" : libusb_error_name(transfer->status));
+		scpi_usbtmc_bulkin_cancel(uscpi);
 		return SR_ERR;
 	}
 
+	uscpi->response_data = transfer->buffer;
 	uscpi->response_length = MIN(transferred, uscpi->remaining_length);
 	uscpi->response_bytes_read = 0;
 	uscpi->remaining_length -= uscpi->response_length;
@@ -609,6 +748,8 @@ static int scpi_usbtmc_libusb_read_begin(void *priv)
 	struct scpi_usbtmc_libusb *uscpi = priv;
 
 	uscpi->remaining_length = 0;
+	/* Drop what is left of an incompletely read response. */
+	scpi_usbtmc_bulkin_cancel(uscpi);
 
 	if (scpi_usbtmc_bulkout(uscpi, REQUEST_DEV_DEP_MSG_IN,
 	    NULL, INT32_MAX, 0) < 0)
@@ -628,8 +769,7 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 
 	if (uscpi->response_bytes_read >= uscpi->response_length) {
 		if (uscpi->remaining_length > 0) {
-			if (scpi_usbtmc_bulkin_continue(uscpi, uscpi->buffer,
-			                                sizeof(uscpi->buffer)) <= 0)
+			if (scpi_usbtmc_bulkin_continue(uscpi) <= 0)
 				return SR_ERR;
 		} else {
 			if (uscpi->bulkin_attributes & EOM)
@@ -641,7 +781,7 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 
 	read_length = MIN(uscpi->response_length - uscpi->response_bytes_read, maxlen);
 
-	memcpy(buf, uscpi->buffer + uscpi->response_bytes_read, read_length);
+	memcpy(buf, uscpi->response_data + uscpi->response_bytes_read, read_length);
 
 	uscpi->response_bytes_read += read_length;
 
@@ -665,6 +805,7 @@ static int scpi_usbtmc_libusb_close(struct sr_scpi_dev_inst *scpi)
 	if (!usb->devhdl)
 		return SR_ERR;
 
+	scpi_usbtmc_bulkin_free(uscpi);
 	scpi_usbtmc_local(uscpi);
 
 	if ((ret = libusb_release_interface(usb->devhdl, uscpi->interface)) < 0)
@@ -362,6 +362,26 @@ SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
 	return len;
 }
 
+/**
+ * Return RX data to the front of the queue. Lets buffered readers take
+ * more data from the port than they consume, the subsequent read calls
+ * see the excess data first.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[in] data Pointer to data bytes to return.
+ * @param[in] len Number of data bytes to return.
+ */
+static void ser_unread_rx_data(struct sr_serial_dev_inst *serial,
+	const uint8_t *data, size_t len)
+{
+	if (!serial || !data || !len)
+		return;
+
+	if (!serial->rcv_buffer)
+		serial->rcv_buffer = g_string_sized_new(len);
+	g_string_prepend_len(serial->rcv_buffer, (const gchar *)data, len);
+}
+
 /**
  * Check for available receive data.
  *
@@ -454,6 +474,7 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
 {
 	ssize_t ret;
+	size_t queued;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -462,10 +483,22 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 
 	if (!serial->lib_funcs || !serial->lib_funcs->read)
 		return SR_ERR_NA;
+
+	/* Data which buffered readers returned comes first. */
+	queued = sr_ser_unqueue_rx_data(serial, buf, count);
+	if (queued == count)
+		return queued;
+	buf = (uint8_t *)buf + queued;
+	count -= queued;
+
 	ret = serial->lib_funcs->read(serial, buf, count,
 		nonblocking, timeout_ms);
 	if (ret > 0)
 		sr_spew("Read %zd/%zu bytes.", ret, count);
+	if (ret < 0 && queued)
+		ret = 0;
+	if (ret >= 0)
+		ret += queued;
 
 	return ret;
 }
@@ -738,7 +771,8 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 	char **buf, int *buflen, gint64 timeout_ms)
 {
 	gint64 start, remaining;
-	int maxlen, len;
+	int maxlen, len, idx;
+	char *line;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -753,22 +787,38 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 	start = g_get_monotonic_time();
 	remaining = timeout_ms;
 
+	line = *buf;
 	maxlen = *buflen;
 	*buflen = len = 0;
 	while (1) {
 		len = maxlen - *buflen - 1;
 		if (len < 1)
 			break;
-		len = serial_read_blocking(serial, *buf + *buflen, 1, remaining);
+		/*
+		 * Take whatever is available in one go, and only block
+		 * for a single byte when nothing is. Data after the line
+		 * terminator gets queued for the next read.
+		 */
+		len = serial_read_nonblocking(serial, line + *buflen, len);
+		if (len < 1)
+			len = serial_read_blocking(serial, line + *buflen,
+				1, remaining);
 		if (len > 0) {
-			*buflen += len;
-			*(*buf + *buflen) = '\0';
-			if (*buflen > 0 && (*(*buf + *buflen - 1) == '\r'
-					|| *(*buf + *buflen - 1) == '\n')) {
+			for (idx = *buflen; idx < *buflen + len; idx++) {
+				if (line[idx] == '\r' || line[idx] == '\n')
+					break;
+			}
+			if (idx < *buflen + len) {
 				/* Strip CR/LF and terminate. */
-				*(*buf + --*buflen) = '\0';
+				ser_unread_rx_data(serial,
+					(const uint8_t *)&line[idx + 1],
+					*buflen + len - idx - 1);
+				*buflen = idx;
+				line[*buflen] = '\0';
 				break;
 			}
+			*buflen += len;
+			line[*buflen] = '\0';
 		}
 		/* Reduce timeout by time elapsed. */
 		remaining = timeout_ms - ((g_get_monotonic_time() - start) / 1000);
@@ -793,6 +843,7 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
  * @param[in] packet_size Size, in bytes, of a valid packet.
  * @param[in] is_valid Callback that assesses whether the packet is valid or not.
  * @param[in] is_valid_len Callback which checks a variable length packet.
+ * @param[in] sync Optional sync pattern of the packet format, can be NULL.
  * @param[out] return_size Detected packet size in case of successful match.
  * @param[in] timeout_ms The timeout after which, if no packet is detected, to
  *                       abort scanning.
@@ -803,21 +854,24 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
  * provided validity check routine, assuming either fixed size packets
  * (#is_valid parameter, exact match to the #packet_size length) or
  * packets of variable length (#is_valid_len parameter, minimum length
- * #packet_size required for first invocation).
+ * #packet_size required for first invocation). When a #sync pattern
+ * is given, receive data which cannot start a packet gets skipped
+ * without running the validity check on it.
  *
  * @retval SR_OK Valid packet was found within the given timeout.
  * @retval SR_ERR Failure.
  *
  * @private
  */
-SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
+SR_PRIV int serial_stream_detect_sync(struct sr_serial_dev_inst *serial,
 	uint8_t *buf, size_t *buflen,
 	size_t packet_size, packet_valid_callback is_valid,
-	packet_valid_len_callback is_valid_len, size_t *return_size,
+	packet_valid_len_callback is_valid_len,
+	const struct sr_packet_sync *sync, size_t *return_size,
 	uint64_t timeout_ms)
 {
 	uint64_t start_us, elapsed_ms, byte_delay_us;
-	size_t fill_idx, check_idx, max_fill_idx;
+	size_t fill_idx, check_idx, recv_idx, max_fill_idx;
 	ssize_t recv_len;
 	const uint8_t *check_ptr;
 	size_t check_len, pkt_len;
@@ -841,17 +895,25 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 	byte_delay_us = serial_timeout(serial, 1) * 1000;
 	start_us = g_get_monotonic_time();
 
-	check_idx = fill_idx = 0;
+	check_idx = fill_idx = recv_idx = 0;
 	while (fill_idx < max_fill_idx) {
 		/*
-		 * Read bytes individually. Lets callers continue to
-		 * successfully process next RX data after first match.
+		 * Read all available bytes at once, but check them as if
+		 * they had arrived individually. Data after a match gets
+		 * queued for the next read, which lets callers continue
+		 * to successfully process next RX data after first match.
 		 * Run full loop bodies for empty or failed reception
 		 * in an iteration, to have timeouts checked.
 		 */
-		recv_len = serial_read_nonblocking(serial, &buf[fill_idx], 1);
-		if (recv_len > 0)
-			fill_idx += recv_len;
+		recv_len = 0;
+		if (recv_idx == fill_idx) {
+			recv_len = serial_read_nonblocking(serial,
+				&buf[recv_idx], max_fill_idx - recv_idx);
+			if (recv_len > 0)
+				recv_idx += recv_len;
+		}
+		if (fill_idx < recv_idx)
+			fill_idx++;
 
 		/* Dump receive data when (a minimum) size is reached. */
 		check_ptr = &buf[check_idx];
@@ -879,6 +941,8 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 					elapsed_ms);
 				sr_spew("RX count %zu, packet len %zu.",
 					fill_idx, pkt_len);
+				ser_unread_rx_data(serial, &buf[fill_idx],
+					recv_idx - fill_idx);
 				*buflen = fill_idx;
 				if (return_size)
 					*return_size = pkt_len;
@@ -890,7 +954,8 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 			} else {
 				/* Not a valid packet. Continue searching. */
 				sr_spew("Invalid packet, advancing read pos.");
-				check_idx++;
+				check_idx = serial_packet_sync_next(sync, buf,
+					check_idx + 1, fill_idx, 0);
 			}
 		}
 		if (is_valid && check_len >= packet_size) {
@@ -900,6 +965,8 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 					elapsed_ms);
 				sr_spew("RX count %zu, packet len %zu.",
 					fill_idx, packet_size);
+				ser_unread_rx_data(serial, &buf[fill_idx],
+					recv_idx - fill_idx);
 				*buflen = fill_idx;
 				if (return_size)
 					*return_size = packet_size;
@@ -907,7 +974,8 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 			}
 			/* Not a valid packet. Continue searching. */
 			sr_spew("Invalid packet, advancing read pointer.");
-			check_idx++;
+			check_idx = serial_packet_sync_next(sync, buf,
+				check_idx + 1, fill_idx, packet_size);
 		}
 
 		/* Check for packet search timeout. */
@@ -916,15 +984,114 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 				elapsed_ms);
 			break;
 		}
-		if (recv_len < 1)
+		if (recv_len < 1 && recv_idx == fill_idx)
 			g_usleep(byte_delay_us);
 	}
+	ser_unread_rx_data(serial, &buf[fill_idx], recv_idx - fill_idx);
 	sr_info("Didn't find a valid packet (read %zu bytes).", fill_idx);
 	*buflen = fill_idx;
 
 	return SR_ERR;
 }
 
+/**
+ * Try to find a valid packet in a serial data stream.
+ *
+ * Identical to serial_stream_detect_sync() without a sync pattern.
+ *
+ * @private
+ */
+SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
+	uint8_t *buf, size_t *buflen,
+	size_t packet_size, packet_valid_callback is_valid,
+	packet_valid_len_callback is_valid_len, size_t *return_size,
+	uint64_t timeout_ms)
+{
+	return serial_stream_detect_sync(serial, buf, buflen, packet_size,
+		is_valid, is_valid_len, NULL, return_size, timeout_ms);
+}
+
+static gboolean sync_header_matches(const struct sr_packet_sync *sync,
+	const uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	if (!sync->header_mask)
+		return memcmp(buf, sync->header, len) == 0;
+	for (i = 0; i < len; i++) {
+		if ((buf[i] & sync->header_mask[i]) != sync->header[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Find the next position in receive data where a packet can start.
+ *
+ * @param[in] sync Sync pattern of the packet format, can be NULL.
+ * @param[in] buf Receive data.
+ * @param[in] pos Position to start the search at.
+ * @param[in] len Number of bytes in the receive data.
+ * @param[in] packet_size Size of fixed size packets, zero when packets
+ *                        are of variable length.
+ *
+ * Positions where the header or the trailer bytes don't match get
+ * skipped, searching for the bytes with memchr(). Positions where these
+ * bytes were not received yet are considered candidates. Without a
+ * usable pattern the search position is returned unmodified, and
+ * callers check every offset like before.
+ *
+ * @returns The position of the next candidate, or @a len when none of
+ *          the remaining data can start a packet.
+ *
+ * @private
+ */
+SR_PRIV size_t serial_packet_sync_next(const struct sr_packet_sync *sync,
+	const uint8_t *buf, size_t pos, size_t len, size_t packet_size)
+{
+	const uint8_t *p;
+	size_t offs, cmp_len;
+	gboolean scan;
+
+	if (!sync || pos >= len)
+		return pos;
+
+	if (sync->header_len) {
+		scan = !sync->header_mask || sync->header_mask[0] == 0xff;
+		while (pos < len) {
+			if (scan) {
+				p = memchr(&buf[pos], sync->header[0], len - pos);
+				if (!p)
+					return len;
+				pos = p - buf;
+			}
+			cmp_len = MIN(len - pos, sync->header_len);
+			if (sync_header_matches(sync, &buf[pos], cmp_len))
+				return pos;
+			pos++;
+		}
+		return len;
+	}
+
+	if (sync->trailer_len && packet_size >= sync->trailer_len) {
+		offs = packet_size - sync->trailer_len;
+		while (pos + offs < len) {
+			p = memchr(&buf[pos + offs], sync->trailer[0],
+				len - pos - offs);
+			if (!p)
+				return len - offs;
+			pos = p - buf - offs;
+			cmp_len = MIN(len - pos - offs, sync->trailer_len);
+			if (memcmp(p, sync->trailer, cmp_len) == 0)
+				return pos;
+			pos++;
+		}
+	}
+
+	return pos;
+}
+
 #endif
 
 /**
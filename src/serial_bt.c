@@ -31,6 +31,7 @@
 
 #define SER_BT_CONN_PREFIX	"bt"
 #define SER_BT_CHUNK_SIZE	1200
+#define SER_BT_NOTIFY_BATCH	16
 
 #define SER_BT_PARAM_PREFIX_CHANNEL	"channel="
 #define SER_BT_PARAM_PREFIX_HDL_RX	"handle_rx="
@@ -438,6 +439,10 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 		serial->bt_notify_handle_write = write_hdl;
 		serial->bt_notify_handle_cccd = cccd_hdl;
 		serial->bt_notify_value_cccd = cccd_val;
+		/* Queue all pending notifications' data in one go. */
+		rc = sr_bt_config_batch(desc, SER_BT_NOTIFY_BATCH, TRUE);
+		if (rc < 0)
+			return SR_ERR;
 		break;
 	default:
 		/* Unsupported type, or incomplete implementation. */
@@ -69,6 +69,154 @@ static void ser_hid_mask_databits(struct sr_serial_dev_inst *serial,
 		data[idx] &= mask;
 }
 
+/* }}} */
+/* {{{ background reception of HID reports */
+
+/*
+ * A thread keeps reading HID reports while the port is open, such
+ * that the device's pipe is drained and short lived reports of fast
+ * updating meters don't get lost, and RX data is available without
+ * waiting for a report round trip when the application asks for it.
+ *
+ * The thread only appends to a pending buffer. Data gets moved to the
+ * serial port's RX queue by the application's thread, which keeps the
+ * RX chunk callbacks and the queue's accessors single threaded.
+ */
+#define SER_HID_RX_POLL_MS	50
+
+static gpointer ser_hid_rx_thread(gpointer data)
+{
+	struct sr_serial_dev_inst *serial;
+	uint8_t rx_buf[SER_HID_CHUNK_SIZE];
+	int rc;
+
+	serial = data;
+	while (g_atomic_int_get(&serial->hid_rx_running)) {
+		rc = serial->hid_chip_funcs->read_bytes(serial,
+			rx_buf, sizeof(rx_buf), SER_HID_RX_POLL_MS);
+		if (rc < 0) {
+			sr_dbg("Background HID read error %d.", rc);
+			g_mutex_lock(&serial->hid_rx_mutex);
+			serial->hid_rx_error = rc;
+			g_cond_broadcast(&serial->hid_rx_cond);
+			g_mutex_unlock(&serial->hid_rx_mutex);
+			break;
+		}
+		if (!rc)
+			continue;
+		ser_hid_mask_databits(serial, rx_buf, rc);
+		g_mutex_lock(&serial->hid_rx_mutex);
+		g_string_append_len(serial->hid_rx_pending,
+			(const gchar *)rx_buf, rc);
+		g_cond_broadcast(&serial->hid_rx_cond);
+		g_mutex_unlock(&serial->hid_rx_mutex);
+	}
+
+	return NULL;
+}
+
+static int ser_hid_rx_start(struct sr_serial_dev_inst *serial)
+{
+	GError *error;
+
+	if (serial->hid_rx_thread)
+		return SR_OK;
+	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->read_bytes)
+		return SR_ERR_NA;
+
+	g_mutex_init(&serial->hid_rx_mutex);
+	g_cond_init(&serial->hid_rx_cond);
+	serial->hid_rx_pending = g_string_sized_new(SER_HID_CHUNK_SIZE);
+	serial->hid_rx_taken = g_string_sized_new(SER_HID_CHUNK_SIZE);
+	serial->hid_rx_error = 0;
+	g_atomic_int_set(&serial->hid_rx_running, 1);
+
+	error = NULL;
+	serial->hid_rx_thread = g_thread_try_new("hid-rx",
+		ser_hid_rx_thread, serial, &error);
+	if (!serial->hid_rx_thread) {
+		sr_warn("Cannot start HID RX thread, polling in foreground: %s.",
+			error->message);
+		g_error_free(error);
+		g_atomic_int_set(&serial->hid_rx_running, 0);
+		g_string_free(serial->hid_rx_pending, TRUE);
+		serial->hid_rx_pending = NULL;
+		g_string_free(serial->hid_rx_taken, TRUE);
+		serial->hid_rx_taken = NULL;
+		g_cond_clear(&serial->hid_rx_cond);
+		g_mutex_clear(&serial->hid_rx_mutex);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static void ser_hid_rx_stop(struct sr_serial_dev_inst *serial)
+{
+	if (!serial->hid_rx_thread)
+		return;
+
+	g_atomic_int_set(&serial->hid_rx_running, 0);
+	g_thread_join(serial->hid_rx_thread);
+	serial->hid_rx_thread = NULL;
+
+	g_string_free(serial->hid_rx_pending, TRUE);
+	serial->hid_rx_pending = NULL;
+	g_string_free(serial->hid_rx_taken, TRUE);
+	serial->hid_rx_taken = NULL;
+	g_cond_clear(&serial->hid_rx_cond);
+	g_mutex_clear(&serial->hid_rx_mutex);
+}
+
+/* Discard data which the thread has received but was not taken yet. */
+static void ser_hid_rx_discard(struct sr_serial_dev_inst *serial)
+{
+	if (!serial->hid_rx_thread)
+		return;
+
+	g_mutex_lock(&serial->hid_rx_mutex);
+	g_string_truncate(serial->hid_rx_pending, 0);
+	g_mutex_unlock(&serial->hid_rx_mutex);
+}
+
+/*
+ * Move data which the thread has received to the RX queue. Optionally
+ * wait for the arrival of data. Returns the number of bytes which were
+ * queued, or a negative error code when reception has failed.
+ */
+static int ser_hid_rx_take(struct sr_serial_dev_inst *serial,
+	unsigned int timeout_ms)
+{
+	GString *taken;
+	gint64 deadline;
+	int rc;
+
+	g_mutex_lock(&serial->hid_rx_mutex);
+	if (timeout_ms) {
+		deadline = g_get_monotonic_time();
+		deadline += (gint64)timeout_ms * G_TIME_SPAN_MILLISECOND;
+		while (!serial->hid_rx_pending->len && !serial->hid_rx_error) {
+			if (!g_cond_wait_until(&serial->hid_rx_cond,
+					&serial->hid_rx_mutex, deadline))
+				break;
+		}
+	}
+	taken = serial->hid_rx_pending;
+	serial->hid_rx_pending = serial->hid_rx_taken;
+	serial->hid_rx_taken = taken;
+	rc = serial->hid_rx_error;
+	g_mutex_unlock(&serial->hid_rx_mutex);
+
+	if (taken->len) {
+		sr_ser_queue_rx_data(serial, (const uint8_t *)taken->str,
+			taken->len);
+		rc = taken->len;
+		g_string_truncate(taken, 0);
+	}
+
+	return rc;
+}
+
 /* }}} */
 /* {{{ open/close/list/find HIDAPI connection, exchange HID requests and data */
 
@@ -446,9 +594,12 @@ static int hidapi_source_cb(int fd, int revents, void *cb_data)
 	 * Drain receive data which the chip might have pending. This is
 	 * "a copy" of the "background part" of ser_hid_read(), without
 	 * the timeout support code, and not knowing how much data the
-	 * application is expecting.
+	 * application is expecting. Just take what the background
+	 * reception has gathered when it runs.
 	 */
-	do {
+	if (args->serial->hid_rx_thread) {
+		(void)ser_hid_rx_take(args->serial, 0);
+	} else do {
 		rc = args->serial->hid_chip_funcs->read_bytes(args->serial,
 				rx_buf, sizeof(rx_buf), 0);
 		if (rc > 0) {
@@ -1135,11 +1286,14 @@ static int ser_hid_open(struct sr_serial_dev_inst *serial, int flags)
 	if (!serial->rcv_buffer)
 		serial->rcv_buffer = g_string_sized_new(SER_HID_CHUNK_SIZE);
 
+	(void)ser_hid_rx_start(serial);
+
 	return SR_OK;
 }
 
 static int ser_hid_close(struct sr_serial_dev_inst *serial)
 {
+	ser_hid_rx_stop(serial);
 	ser_hid_hidapi_close_dev(serial);
 
 	return SR_OK;
@@ -1186,6 +1340,8 @@ static GSList *ser_hid_find_usb(GSList *list, sr_ser_find_append_t append,
 
 static int ser_hid_flush(struct sr_serial_dev_inst *serial)
 {
+	ser_hid_rx_discard(serial);
+
 	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->flush)
 		return SR_ERR_NA;
 
@@ -1306,15 +1462,19 @@ static int ser_hid_read(struct sr_serial_dev_inst *serial,
 
 		/*
 		 * Check the HID transport for the availability of more
-		 * receive data.
+		 * receive data. Take what background reception has
+		 * gathered when it runs, else read from the device.
 		 */
-		rc = serial->hid_chip_funcs->read_bytes(serial,
+		if (serial->hid_rx_thread)
+			rc = ser_hid_rx_take(serial, timeout_ms);
+		else
+			rc = serial->hid_chip_funcs->read_bytes(serial,
 				buffer, sizeof(buffer), timeout_ms);
 		if (rc < 0) {
 			sr_dbg("DBG: %s() read error %d.", __func__, rc);
 			return SR_ERR;
 		}
-		if (rc) {
+		if (rc && !serial->hid_rx_thread) {
 			ser_hid_mask_databits(serial, buffer, rc);
 			sr_ser_queue_rx_data(serial, buffer, rc);
 		}
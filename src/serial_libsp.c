@@ -21,6 +21,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -33,6 +34,11 @@
 
 #define LOG_PREFIX "serial-libsp"
 
+/* Reader thread: chunk size, wait per read, cap on unconsumed data. */
+#define SP_RX_CHUNK_SIZE	256
+#define SP_RX_WAIT_MS		100
+#define SP_RX_MAX_PENDING	(1024 * 1024)
+
 /**
  * @file
  *
@@ -87,6 +93,130 @@ static int sr_ser_libsp_open(struct sr_serial_dev_inst *serial, int flags)
 	return SR_OK;
 }
 
+/*
+ * Ports without a pollable event handle get a reader thread. The thread
+ * waits for data in libserialport, keeps received bytes for subsequent
+ * reads, and wakes up the session's event source. So arriving data gets
+ * processed immediately, and idle ports don't need periodic polls.
+ */
+static gpointer sp_rx_thread(gpointer data)
+{
+	struct sr_serial_dev_inst *serial;
+	uint8_t buf[SP_RX_CHUNK_SIZE];
+	int rc;
+
+	serial = data;
+	while (g_atomic_int_get(&serial->sp_rx_running)) {
+		rc = sp_blocking_read_next(serial->sp_data, buf, sizeof(buf),
+			SP_RX_WAIT_MS);
+		if (rc == 0)
+			continue;
+		g_mutex_lock(&serial->sp_rx_mutex);
+		if (rc < 0) {
+			serial->sp_rx_error = rc;
+		} else if (serial->sp_rx_pending->len + rc > SP_RX_MAX_PENDING) {
+			sr_warn("Discarding unconsumed receive data.");
+			g_string_truncate(serial->sp_rx_pending, 0);
+		} else {
+			g_string_append_len(serial->sp_rx_pending,
+				(const gchar *)buf, rc);
+		}
+		g_cond_broadcast(&serial->sp_rx_cond);
+		if (serial->sp_rx_source)
+			g_source_set_ready_time(serial->sp_rx_source, 0);
+		g_mutex_unlock(&serial->sp_rx_mutex);
+		if (rc < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static int sp_rx_start(struct sr_serial_dev_inst *serial)
+{
+	GError *error;
+
+	if (serial->sp_rx_thread)
+		return SR_OK;
+
+	g_mutex_init(&serial->sp_rx_mutex);
+	g_cond_init(&serial->sp_rx_cond);
+	serial->sp_rx_pending = g_string_sized_new(SP_RX_CHUNK_SIZE);
+	serial->sp_rx_error = 0;
+	g_atomic_int_set(&serial->sp_rx_running, 1);
+
+	error = NULL;
+	serial->sp_rx_thread = g_thread_try_new("serial-rx",
+		sp_rx_thread, serial, &error);
+	if (!serial->sp_rx_thread) {
+		sr_err("Cannot start serial reception thread: %s.",
+			error->message);
+		g_error_free(error);
+		g_atomic_int_set(&serial->sp_rx_running, 0);
+		g_string_free(serial->sp_rx_pending, TRUE);
+		serial->sp_rx_pending = NULL;
+		g_cond_clear(&serial->sp_rx_cond);
+		g_mutex_clear(&serial->sp_rx_mutex);
+		return SR_ERR;
+	}
+	sr_dbg("Receiving from %s in a background thread.", serial->port);
+
+	return SR_OK;
+}
+
+static void sp_rx_stop(struct sr_serial_dev_inst *serial)
+{
+	if (!serial->sp_rx_thread)
+		return;
+
+	g_atomic_int_set(&serial->sp_rx_running, 0);
+	g_thread_join(serial->sp_rx_thread);
+	serial->sp_rx_thread = NULL;
+
+	g_string_free(serial->sp_rx_pending, TRUE);
+	serial->sp_rx_pending = NULL;
+	g_cond_clear(&serial->sp_rx_cond);
+	g_mutex_clear(&serial->sp_rx_mutex);
+}
+
+/*
+ * Take received data from the reader thread. Blocking reads wait for
+ * the requested amount or the timeout (zero waits indefinitely), like
+ * sp_blocking_read() does.
+ */
+static int sp_rx_take(struct sr_serial_dev_inst *serial,
+	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
+{
+	gint64 deadline;
+	size_t len;
+	int rc;
+
+	g_mutex_lock(&serial->sp_rx_mutex);
+	if (!nonblocking) {
+		deadline = g_get_monotonic_time() + timeout_ms * 1000;
+		while (serial->sp_rx_pending->len < count && !serial->sp_rx_error) {
+			if (!timeout_ms) {
+				g_cond_wait(&serial->sp_rx_cond,
+					&serial->sp_rx_mutex);
+			} else if (!g_cond_wait_until(&serial->sp_rx_cond,
+					&serial->sp_rx_mutex, deadline)) {
+				break;
+			}
+		}
+	}
+	len = MIN(count, serial->sp_rx_pending->len);
+	if (len) {
+		memcpy(buf, serial->sp_rx_pending->str, len);
+		g_string_erase(serial->sp_rx_pending, 0, len);
+	}
+	rc = len;
+	if (!len && serial->sp_rx_error)
+		rc = serial->sp_rx_error;
+	g_mutex_unlock(&serial->sp_rx_mutex);
+
+	return rc;
+}
+
 static int sr_ser_libsp_close(struct sr_serial_dev_inst *serial)
 {
 	int ret;
@@ -97,6 +227,8 @@ static int sr_ser_libsp_close(struct sr_serial_dev_inst *serial)
 		return SR_ERR;
 	}
 
+	sp_rx_stop(serial);
+
 	ret = sp_close(serial->sp_data);
 
 	switch (ret) {
@@ -128,6 +260,11 @@ static int sr_ser_libsp_flush(struct sr_serial_dev_inst *serial)
 	}
 
 	ret = sp_flush(serial->sp_data, SP_BUF_BOTH);
+	if (serial->sp_rx_thread) {
+		g_mutex_lock(&serial->sp_rx_mutex);
+		g_string_truncate(serial->sp_rx_pending, 0);
+		g_mutex_unlock(&serial->sp_rx_mutex);
+	}
 
 	switch (ret) {
 	case SP_ERR_ARG:
@@ -210,7 +347,9 @@ static int sr_ser_libsp_read(struct sr_serial_dev_inst *serial,
 		return SR_ERR;
 	}
 
-	if (nonblocking)
+	if (serial->sp_rx_thread)
+		ret = sp_rx_take(serial, buf, count, nonblocking, timeout_ms);
+	else if (nonblocking)
 		ret = sp_nonblocking_read(serial->sp_data, buf, count);
 	else
 		ret = sp_blocking_read(serial->sp_data, buf, count, timeout_ms);
@@ -383,6 +522,133 @@ static int sr_ser_libsp_source_add_int(struct sr_serial_dev_inst *serial,
 	return SR_OK;
 }
 
+/* Event source which gets woken up by the reader thread. */
+struct sp_rx_source {
+	GSource base;
+	struct sr_session *session;
+	struct sr_serial_dev_inst *serial;
+	int64_t timeout_us;
+	int64_t due_us;
+};
+
+static gboolean sp_rx_source_pending(struct sp_rx_source *rsource)
+{
+	struct sr_serial_dev_inst *serial;
+	gboolean pending;
+
+	serial = rsource->serial;
+	g_mutex_lock(&serial->sp_rx_mutex);
+	pending = serial->sp_rx_pending->len || serial->sp_rx_error;
+	g_mutex_unlock(&serial->sp_rx_mutex);
+
+	return pending;
+}
+
+static gboolean sp_rx_source_prepare(GSource *source, int *timeout)
+{
+	struct sp_rx_source *rsource;
+	int64_t now_us;
+
+	rsource = (struct sp_rx_source *)source;
+	*timeout = -1;
+	if (sp_rx_source_pending(rsource))
+		return TRUE;
+	if (rsource->timeout_us < 0)
+		return FALSE;
+
+	now_us = g_source_get_time(source);
+	if (!rsource->due_us)
+		rsource->due_us = now_us + rsource->timeout_us;
+	*timeout = (MAX(0, rsource->due_us - now_us) + 999) / 1000;
+
+	return *timeout == 0;
+}
+
+static gboolean sp_rx_source_check(GSource *source)
+{
+	struct sp_rx_source *rsource;
+
+	rsource = (struct sp_rx_source *)source;
+	if (sp_rx_source_pending(rsource))
+		return TRUE;
+
+	return rsource->timeout_us >= 0 &&
+		rsource->due_us <= g_source_get_time(source);
+}
+
+static gboolean sp_rx_source_dispatch(GSource *source,
+	GSourceFunc callback, void *user_data)
+{
+	struct sp_rx_source *rsource;
+	unsigned int revents;
+	gboolean keep;
+
+	rsource = (struct sp_rx_source *)source;
+	g_source_set_ready_time(source, -1);
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+
+	revents = sp_rx_source_pending(rsource) ? G_IO_IN : 0;
+	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
+	if (rsource->timeout_us >= 0 && keep && !g_source_is_destroyed(source))
+		rsource->due_us = g_source_get_time(source) + rsource->timeout_us;
+
+	return keep;
+}
+
+static void sp_rx_source_finalize(GSource *source)
+{
+	struct sp_rx_source *rsource;
+	struct sr_serial_dev_inst *serial;
+
+	rsource = (struct sp_rx_source *)source;
+	serial = rsource->serial;
+	g_mutex_lock(&serial->sp_rx_mutex);
+	if (serial->sp_rx_source == source)
+		serial->sp_rx_source = NULL;
+	g_mutex_unlock(&serial->sp_rx_mutex);
+	sr_session_source_destroyed(rsource->session, serial->sp_data, source);
+}
+
+static int sp_rx_source_add(struct sr_session *session,
+	struct sr_serial_dev_inst *serial, int timeout,
+	sr_receive_data_callback cb, void *cb_data)
+{
+	static GSourceFuncs sp_rx_source_funcs = {
+		.prepare  = &sp_rx_source_prepare,
+		.check    = &sp_rx_source_check,
+		.dispatch = &sp_rx_source_dispatch,
+		.finalize = &sp_rx_source_finalize,
+	};
+	GSource *source;
+	struct sp_rx_source *rsource;
+	int ret;
+
+	ret = sp_rx_start(serial);
+	if (ret != SR_OK)
+		return ret;
+
+	source = g_source_new(&sp_rx_source_funcs, sizeof(*rsource));
+	g_source_set_name(source, "serial-rx");
+	rsource = (struct sp_rx_source *)source;
+	rsource->session = session;
+	rsource->serial = serial;
+	rsource->timeout_us = (timeout >= 0) ? 1000 * (int64_t)timeout : -1;
+	rsource->due_us = 0;
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+
+	g_mutex_lock(&serial->sp_rx_mutex);
+	serial->sp_rx_source = source;
+	g_mutex_unlock(&serial->sp_rx_mutex);
+
+	ret = sr_session_source_add_internal(session, serial->sp_data, source);
+	g_source_unref(source);
+
+	return ret;
+}
+
 static int sr_ser_libsp_source_add(struct sr_session *session,
 	struct sr_serial_dev_inst *serial, int events, int timeout,
 	sr_receive_data_callback cb, void *cb_data)
@@ -392,8 +658,21 @@ static int sr_ser_libsp_source_add(struct sr_session *session,
 	gintptr poll_fd;
 	unsigned int poll_events;
 
+	/*
+	 * Prefer the port's event handle, which the session polls along
+	 * with other sources. Fall back to the reader thread for input
+	 * when the port cannot provide one.
+	 */
+	if (serial->sp_rx_thread && (events & G_IO_IN))
+		return sp_rx_source_add(session, serial, timeout, cb, cb_data);
 	ret = sr_ser_libsp_source_add_int(serial, events,
 		&key, &poll_fd, &poll_events);
+	if (ret != SR_OK && serial->sp_data && (events & G_IO_IN) &&
+			!(events & G_IO_OUT)) {
+		sr_dbg("No event handle for %s, using a reader thread.",
+			serial->port);
+		return sp_rx_source_add(session, serial, timeout, cb, cb_data);
+	}
 	if (ret != SR_OK)
 		return ret;
 
@@ -510,6 +789,13 @@ static size_t sr_ser_libsp_get_rx_avail(struct sr_serial_dev_inst *serial)
 	if (!serial)
 		return 0;
 
+	if (serial->sp_rx_thread) {
+		g_mutex_lock(&serial->sp_rx_mutex);
+		rc = serial->sp_rx_pending->len;
+		g_mutex_unlock(&serial->sp_rx_mutex);
+		return rc;
+	}
+
 	rc = sp_input_waiting(serial->sp_data);
 	if (rc < 0)
 		return 0;
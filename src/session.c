@@ -25,6 +25,12 @@
 #include <unistd.h>
 #include <string.h>
 #include <glib.h>
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+#define HAVE_EPOLL_SOURCES 1
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -46,10 +52,61 @@
  * @{
  */
 
-struct datafeed_callback {
-	sr_datafeed_callback cb;
-	void *cb_data;
+/**
+ * Reference counted datafeed packet.
+ *
+ * Lent packets carry a shallow copy of the driver's payload descriptors,
+ * the sample data itself stays in the driver's buffer until the last
+ * reference is dropped and the release callback runs. Packets which were
+ * referenced outside of sr_session_send_lent() own a deep copy instead.
+ */
+struct packet_ref {
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/** Deep copy of the packet, or NULL for lent packets. */
+	struct sr_datafeed_packet *copy;
+	int refcount;
+	GDestroyNotify release;
+	void *release_data;
+	/** Metadata of the packet, see sr_packet_info_get(). */
+	struct sr_datafeed_packet_info info;
+	gboolean has_info;
+};
+
+/* Maps struct sr_datafeed_packet pointers to struct packet_ref. */
+static GHashTable *packet_refs;
+G_LOCK_DEFINE_STATIC(packet_refs);
+
+/* Innermost metadata scope of unreferenced packets, per thread. */
+static GPrivate packet_info_scopes;
+
+#ifdef HAVE_EPOLL_SOURCES
+/* Maximum number of epoll events handled per main loop iteration. */
+#define EPOLL_MAX_EVENTS 64
+
+struct fd_source;
+
+/** Identifies an epoll registration of an fd source. */
+struct epoll_tag {
+	struct fd_source *fsource;
+	gboolean is_timer;
+};
+
+/** Event source which multiplexes fd sources through an epoll set.
+ *
+ * The main loop polls just the epoll descriptor, so its poll set does
+ * not grow with the number of fd sources. Timeouts are kept in timerfd
+ * instances, which have microsecond resolution unlike poll().
+ */
+struct epoll_source {
+	GSource base;
+	GPollFD pollfd;
 };
+#endif
 
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
@@ -65,8 +122,225 @@ struct fd_source {
 	void *key;
 
 	GPollFD pollfd;
+
+#ifdef HAVE_EPOLL_SOURCES
+	/* Multiplexer which the source is registered with, or NULL. */
+	struct epoll_source *epoll;
+	struct epoll_tag fd_tag;
+	struct epoll_tag timer_tag;
+	int timer_fd;
+	gboolean fd_registered;
+#endif
 };
 
+#ifdef HAVE_EPOLL_SOURCES
+static unsigned int gio_to_epoll(unsigned int events)
+{
+	unsigned int ev;
+
+	ev = 0;
+	if (events & G_IO_IN)
+		ev |= EPOLLIN;
+	if (events & G_IO_OUT)
+		ev |= EPOLLOUT;
+	if (events & G_IO_PRI)
+		ev |= EPOLLPRI;
+
+	return ev;
+}
+
+static unsigned int epoll_to_gio(unsigned int ev)
+{
+	unsigned int events;
+
+	events = 0;
+	if (ev & EPOLLIN)
+		events |= G_IO_IN;
+	if (ev & EPOLLOUT)
+		events |= G_IO_OUT;
+	if (ev & EPOLLPRI)
+		events |= G_IO_PRI;
+	if (ev & EPOLLERR)
+		events |= G_IO_ERR;
+	if (ev & EPOLLHUP)
+		events |= G_IO_HUP;
+
+	return events;
+}
+
+static gboolean epoll_source_check(GSource *source)
+{
+	return ((struct epoll_source *)source)->pollfd.revents != 0;
+}
+
+/** Epoll event source dispatch() method.
+ * Marks the fd sources with pending events ready, they get dispatched
+ * by the main loop like any other source.
+ */
+static gboolean epoll_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct epoll_source *esource;
+	struct epoll_event events[EPOLL_MAX_EVENTS];
+	struct epoll_tag *tag;
+	struct fd_source *fsource;
+	uint64_t expirations;
+	int i, num;
+
+	(void)callback;
+	(void)user_data;
+
+	esource = (struct epoll_source *)source;
+	num = epoll_wait(esource->pollfd.fd, events, G_N_ELEMENTS(events), 0);
+	for (i = 0; i < num; i++) {
+		tag = events[i].data.ptr;
+		fsource = tag->fsource;
+		if (g_source_is_destroyed(&fsource->base))
+			continue;
+		if (tag->is_timer) {
+			if (read(fsource->timer_fd, &expirations,
+					sizeof(expirations)) < 0)
+				continue;
+		} else {
+			fsource->pollfd.revents |= epoll_to_gio(events[i].events)
+				& (fsource->pollfd.events | G_IO_ERR | G_IO_HUP);
+		}
+		g_source_set_ready_time(&fsource->base, 0);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void epoll_source_finalize(GSource *source)
+{
+	close(((struct epoll_source *)source)->pollfd.fd);
+}
+
+/** Create the epoll multiplexer of a session run.
+ *
+ * @return A new event source object, or NULL when epoll is unavailable.
+ */
+static GSource *epoll_source_new(void)
+{
+	static GSourceFuncs epoll_source_funcs = {
+		.check    = &epoll_source_check,
+		.dispatch = &epoll_source_dispatch,
+		.finalize = &epoll_source_finalize
+	};
+	GSource *source;
+	struct epoll_source *esource;
+	int epfd;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		sr_warn("Cannot create epoll set: %s.", g_strerror(errno));
+		return NULL;
+	}
+
+	source = g_source_new(&epoll_source_funcs, sizeof(struct epoll_source));
+	esource = (struct epoll_source *)source;
+	g_source_set_name(source, "epoll");
+
+	esource->pollfd.fd = epfd;
+	esource->pollfd.events = G_IO_IN;
+	g_source_add_poll(source, &esource->pollfd);
+
+	return source;
+}
+
+/* Restart the timeout of an epoll registered fd source from now. */
+static void fd_source_arm_timer(struct fd_source *fsource)
+{
+	struct itimerspec spec;
+
+	if (fsource->timer_fd < 0)
+		return;
+
+	memset(&spec, 0, sizeof(spec));
+	spec.it_value.tv_sec = fsource->timeout_us / G_USEC_PER_SEC;
+	spec.it_value.tv_nsec = (fsource->timeout_us % G_USEC_PER_SEC) * 1000;
+	/* An all zero value would disarm the timer. */
+	if (!fsource->timeout_us)
+		spec.it_value.tv_nsec = 1;
+	timerfd_settime(fsource->timer_fd, 0, &spec, NULL);
+}
+
+/** Register an fd source's descriptor and timeout with the multiplexer.
+ *
+ * @return TRUE when registered, FALSE to have the main loop poll the
+ *         descriptor instead, e.g. for files which epoll rejects.
+ */
+static gboolean fd_source_epoll_attach(struct fd_source *fsource,
+		struct epoll_source *esource)
+{
+	struct epoll_event ev;
+	int epfd;
+
+	epfd = esource->pollfd.fd;
+	fsource->fd_tag.fsource = fsource;
+	fsource->fd_tag.is_timer = FALSE;
+	fsource->timer_tag.fsource = fsource;
+	fsource->timer_tag.is_timer = TRUE;
+	fsource->timer_fd = -1;
+
+	if (fsource->timeout_us >= 0) {
+		fsource->timer_fd = timerfd_create(CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+		if (fsource->timer_fd < 0)
+			return FALSE;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = &fsource->timer_tag;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fsource->timer_fd, &ev) < 0) {
+			close(fsource->timer_fd);
+			fsource->timer_fd = -1;
+			return FALSE;
+		}
+	}
+
+	if (fsource->pollfd.fd >= 0) {
+		memset(&ev, 0, sizeof(ev));
+		ev.events = gio_to_epoll(fsource->pollfd.events);
+		ev.data.ptr = &fsource->fd_tag;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fsource->pollfd.fd, &ev) < 0) {
+			sr_dbg("Polling fd %d without epoll: %s.",
+				(int)fsource->pollfd.fd, g_strerror(errno));
+			if (fsource->timer_fd >= 0) {
+				epoll_ctl(epfd, EPOLL_CTL_DEL, fsource->timer_fd, NULL);
+				close(fsource->timer_fd);
+				fsource->timer_fd = -1;
+			}
+			return FALSE;
+		}
+		fsource->fd_registered = TRUE;
+	}
+
+	g_source_ref(&esource->base);
+	fsource->epoll = esource;
+	fd_source_arm_timer(fsource);
+
+	return TRUE;
+}
+
+static void fd_source_epoll_detach(struct fd_source *fsource)
+{
+	int epfd;
+
+	if (!fsource->epoll)
+		return;
+
+	epfd = fsource->epoll->pollfd.fd;
+	if (fsource->fd_registered)
+		epoll_ctl(epfd, EPOLL_CTL_DEL, fsource->pollfd.fd, NULL);
+	if (fsource->timer_fd >= 0) {
+		epoll_ctl(epfd, EPOLL_CTL_DEL, fsource->timer_fd, NULL);
+		close(fsource->timer_fd);
+	}
+	g_source_unref(&fsource->epoll->base);
+	fsource->epoll = NULL;
+}
+#endif
+
 /** FD event source prepare() method.
  * This is called immediately before poll().
  */
@@ -78,6 +352,14 @@ static gboolean fd_source_prepare(GSource *source, int *timeout)
 
 	fsource = (struct fd_source *)source;
 
+#ifdef HAVE_EPOLL_SOURCES
+	/* The multiplexer sets the ready time upon events. */
+	if (fsource->epoll) {
+		*timeout = -1;
+		return FALSE;
+	}
+#endif
+
 	if (fsource->timeout_us >= 0) {
 		now_us = g_source_get_time(source);
 
@@ -105,6 +387,11 @@ static gboolean fd_source_check(GSource *source)
 	fsource = (struct fd_source *)source;
 	revents = fsource->pollfd.revents;
 
+#ifdef HAVE_EPOLL_SOURCES
+	if (fsource->epoll)
+		return FALSE;
+#endif
+
 	return (revents != 0 || (fsource->timeout_us >= 0
 			&& fsource->due_us <= g_source_get_time(source)));
 }
@@ -122,6 +409,13 @@ static gboolean fd_source_dispatch(GSource *source,
 	fsource = (struct fd_source *)source;
 	revents = fsource->pollfd.revents;
 
+#ifdef HAVE_EPOLL_SOURCES
+	if (fsource->epoll) {
+		g_source_set_ready_time(source, -1);
+		fsource->pollfd.revents = 0;
+	}
+#endif
+
 	if (!callback) {
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
@@ -130,9 +424,13 @@ static gboolean fd_source_dispatch(GSource *source,
 			(fsource->pollfd.fd, revents, user_data);
 
 	if (fsource->timeout_us >= 0 && G_LIKELY(keep)
-			&& G_LIKELY(!g_source_is_destroyed(source)))
+			&& G_LIKELY(!g_source_is_destroyed(source))) {
+#ifdef HAVE_EPOLL_SOURCES
+		fd_source_arm_timer(fsource);
+#endif
 		fsource->due_us = g_source_get_time(source)
 				+ fsource->timeout_us;
+	}
 	return keep;
 }
 
@@ -146,6 +444,9 @@ static void fd_source_finalize(GSource *source)
 
 	sr_dbg("%s: key %p", __func__, fsource->key);
 
+#ifdef HAVE_EPOLL_SOURCES
+	fd_source_epoll_detach(fsource);
+#endif
 	sr_session_source_destroyed(fsource->session, fsource->key, source);
 }
 
@@ -173,6 +474,10 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	};
 	GSource *source;
 	struct fd_source *fsource;
+#ifdef HAVE_EPOLL_SOURCES
+	GSource *esource;
+	gboolean registered;
+#endif
 
 	source = g_source_new(&fd_source_funcs, sizeof(struct fd_source));
 	fsource = (struct fd_source *)source;
@@ -193,6 +498,18 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	fsource->pollfd.events = events;
 	fsource->pollfd.revents = 0;
 
+#ifdef HAVE_EPOLL_SOURCES
+	g_mutex_lock(&session->main_mutex);
+	/* Sources of device threads attach to the thread's context. */
+	esource = sr_session_threads_context(session) ?
+		NULL : session->epoll_source;
+	registered = esource && fd_source_epoll_attach(fsource,
+		(struct epoll_source *)esource);
+	g_mutex_unlock(&session->main_mutex);
+	if (registered)
+		return source;
+#endif
+
 	if (fd >= 0)
 		g_source_add_poll(source, &fsource->pollfd);
 
@@ -225,6 +542,7 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	session->ctx = ctx;
 
 	g_mutex_init(&session->main_mutex);
+	g_mutex_init(&session->merge_mutex);
 
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
@@ -254,14 +572,25 @@ SR_API int sr_session_destroy(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
+	/* Pending snapshots still use the devices. */
+	sr_session_retention_free(session);
 	sr_session_dev_remove_all(session);
 	g_slist_free_full(session->owned_devs, (GDestroyNotify)sr_dev_inst_free);
 
+	sr_session_pipeline_stop(session);
+	sr_session_merge_stop(session);
+	sr_session_batch_stop(session);
+	sr_session_ring_stop(session);
+	sr_session_outputs_remove_all(session);
+	sr_session_frame_mailbox_free(session);
 	sr_session_datafeed_callback_remove_all(session);
+	sr_session_merge_free(session);
+	sr_session_budget_free(session);
 
 	g_hash_table_unref(session->event_sources);
 
 	g_mutex_clear(&session->main_mutex);
+	g_mutex_clear(&session->merge_mutex);
 
 	g_free(session);
 
@@ -482,6 +811,33 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
  */
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data)
+{
+	return sr_session_datafeed_callback_add_full(session, cb, cb_data, 0);
+}
+
+/**
+ * Add a datafeed callback with additional flags to a session.
+ *
+ * Callbacks which are registered with SR_DATAFEED_CB_REFCOUNTED may keep
+ * a packet beyond their invocation by calling sr_packet_ref(), and must
+ * eventually drop that reference with sr_packet_unref(). Drivers which
+ * lend their acquisition buffers to the session then avoid the copy that
+ * sr_packet_copy() would otherwise involve.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param flags Bitwise OR of enum sr_datafeed_callback_flag values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_add_full(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags)
 {
 	struct datafeed_callback *cb_struct;
 
@@ -498,6 +854,7 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
 	cb_struct->cb = cb;
 	cb_struct->cb_data = cb_data;
+	cb_struct->flags = flags;
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
@@ -536,11 +893,62 @@ SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session)
  */
 SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig)
 {
+	struct sr_dev_inst *sdi;
+	GSList *l;
+
 	if (!session)
 		return SR_ERR_ARG;
 
 	session->trigger = trig;
 
+	/* Devices need to get their trigger setup programmed again. */
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		sdi->armed = FALSE;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Multiplex the session's event sources through epoll.
+ *
+ * With this enabled, the main loop polls a single epoll descriptor
+ * instead of one descriptor per fd source, and source timeouts are
+ * kept with microsecond instead of millisecond resolution. The event
+ * source API and the callbacks' semantics don't change. Descriptors
+ * which epoll does not support, USB sources, and sessions which use
+ * device threads keep getting polled by the main loop.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to use epoll.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR_NA Epoll is not available on this platform.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_epoll_set(struct sr_session *session, gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the event backend of a running session.");
+		return SR_ERR;
+	}
+#ifndef HAVE_EPOLL_SOURCES
+	if (enable)
+		return SR_ERR_NA;
+#endif
+
+	session->use_epoll = enable;
+
 	return SR_OK;
 }
 
@@ -620,6 +1028,15 @@ static int set_main_context(struct sr_session *session)
 	}
 	session->main_context = main_context;
 
+#ifdef HAVE_EPOLL_SOURCES
+	/* Device threads have sources attach to their own contexts. */
+	if (session->use_epoll && !session->device_threads) {
+		session->epoll_source = epoll_source_new();
+		if (session->epoll_source)
+			g_source_attach(session->epoll_source, main_context);
+	}
+#endif
+
 	g_mutex_unlock(&session->main_mutex);
 
 	return SR_OK;
@@ -640,6 +1057,11 @@ static int unset_main_context(struct sr_session *session)
 	g_mutex_lock(&session->main_mutex);
 
 	if (session->main_context) {
+		if (session->epoll_source) {
+			g_source_destroy(session->epoll_source);
+			g_source_unref(session->epoll_source);
+			session->epoll_source = NULL;
+		}
 		g_main_context_unref(session->main_context);
 		session->main_context = NULL;
 		ret = SR_OK;
@@ -657,11 +1079,17 @@ static int unset_main_context(struct sr_session *session)
 static unsigned int session_source_attach(struct sr_session *session,
 		GSource *source)
 {
+	GMainContext *context;
 	unsigned int id = 0;
 
+	/* Sources which a device thread adds belong to that thread. */
+	context = sr_session_threads_context(session);
+
 	g_mutex_lock(&session->main_mutex);
 
-	if (session->main_context)
+	if (context)
+		id = g_source_attach(source, context);
+	else if (session->main_context)
 		id = g_source_attach(source, session->main_context);
 	else
 		sr_err("Cannot add event source without main context.");
@@ -671,33 +1099,65 @@ static unsigned int session_source_attach(struct sr_session *session,
 	return id;
 }
 
+/* Device threads may install and remove event sources concurrently. */
+static unsigned int session_source_count(struct sr_session *session)
+{
+	unsigned int count;
+
+	g_mutex_lock(&session->main_mutex);
+	count = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+
+	return count;
+}
+
 /* Idle handler; invoked when the number of registered event sources
  * for a running session drops to zero.
  */
 static gboolean delayed_stop_check(void *data)
 {
 	struct sr_session *session;
+	sr_session_stopped_callback fast_cb;
+	void *fast_cb_data;
 
 	session = data;
+	g_mutex_lock(&session->main_mutex);
 	session->stop_check_id = 0;
+	g_mutex_unlock(&session->main_mutex);
 
 	/* Session already ended? */
 	if (!session->running)
 		return G_SOURCE_REMOVE;
 
 	/* New event sources may have been installed in the meantime. */
-	if (g_hash_table_size(session->event_sources) != 0)
+	if (session_source_count(session) != 0)
 		return G_SOURCE_REMOVE;
 
+	/* Pass on what the devices sent until they stopped. */
+	sr_session_threads_stop(session);
+
 	session->running = FALSE;
 	unset_main_context(session);
 
+	/* Have the worker threads catch up before reporting the stop. */
+	sr_session_pipeline_stop(session);
+	sr_session_merge_stop(session);
+	sr_session_batch_stop(session);
+	sr_session_ring_stop(session);
+
 	sr_info("Stopped.");
 
+	g_mutex_lock(&session->main_mutex);
+	fast_cb = session->fast_stop_callback;
+	fast_cb_data = session->fast_stop_cb_data;
+	session->fast_stop_callback = NULL;
+	session->fast_stop_cb_data = NULL;
+	g_mutex_unlock(&session->main_mutex);
+
 	/* This indicates a bug in user code, since it is not valid to
 	 * restart or destroy a session while it may still be running.
 	 */
-	if (!session->main_loop && !session->stopped_callback) {
+	if (!session->main_loop && !session->stopped_callback && !fast_cb) {
 		sr_err("BUG: Session stop left unhandled.");
 		return G_SOURCE_REMOVE;
 	}
@@ -706,6 +1166,8 @@ static gboolean delayed_stop_check(void *data)
 
 	if (session->stopped_callback)
 		(*session->stopped_callback)(session->stopped_cb_data);
+	if (fast_cb)
+		fast_cb(fast_cb_data);
 
 	return G_SOURCE_REMOVE;
 }
@@ -715,15 +1177,26 @@ static int stop_check_later(struct sr_session *session)
 	GSource *source;
 	unsigned int source_id;
 
-	if (session->stop_check_id != 0)
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->stop_check_id != 0) {
+		g_mutex_unlock(&session->main_mutex);
 		return SR_OK; /* idle handler already installed */
+	}
 
 	source = g_idle_source_new();
 	g_source_set_callback(source, &delayed_stop_check, session, NULL);
 
-	source_id = session_source_attach(session, source);
+	/* Always in the session thread, even when called by a device thread. */
+	source_id = 0;
+	if (session->main_context)
+		source_id = g_source_attach(source, session->main_context);
+	else
+		sr_err("Cannot add event source without main context.");
 	session->stop_check_id = source_id;
 
+	g_mutex_unlock(&session->main_mutex);
+
 	g_source_unref(source);
 
 	return (source_id != 0) ? SR_OK : SR_ERR;
@@ -753,8 +1226,7 @@ static int stop_check_later(struct sr_session *session)
 SR_API int sr_session_start(struct sr_session *session)
 {
 	struct sr_dev_inst *sdi;
-	struct sr_channel *ch;
-	GSList *l, *c, *lend;
+	GSList *l, *lend;
 	int ret;
 
 	if (!session) {
@@ -779,15 +1251,15 @@ SR_API int sr_session_start(struct sr_session *session)
 			return ret;
 	}
 
-	/* Check enabled channels and commit settings of all devices. */
+	/*
+	 * Check enabled channels and commit settings of all devices.
+	 * Drivers may have changed channels behind our back, so refresh
+	 * the channel layouts.
+	 */
 	for (l = session->devs; l; l = l->next) {
 		sdi = l->data;
-		for (c = sdi->channels; c; c = c->next) {
-			ch = c->data;
-			if (ch->enabled)
-				break;
-		}
-		if (!c) {
+		sr_dev_channel_layout_invalidate(sdi);
+		if (!sr_dev_channel_layout(sdi)->num_enabled) {
 			sr_err("%s device %s has no enabled channels.",
 				sdi->driver->name, sdi->connection_id);
 			return SR_ERR;
@@ -806,8 +1278,40 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
+	if (session->stats_enabled)
+		sr_session_stats_reset(session);
+	sr_session_retention_reset(session);
+	sr_session_clock_reset(session);
+
+	if (session->ring_depth > 0) {
+		ret = sr_session_ring_start(session, session->ring_depth,
+				session->ring_drop);
+		if (ret != SR_OK) {
+			unset_main_context(session);
+			return ret;
+		}
+	}
+	if (session->pipeline_depth > 0) {
+		ret = sr_session_pipeline_start(session,
+				session->pipeline_depth);
+		if (ret != SR_OK) {
+			sr_session_ring_stop(session);
+			unset_main_context(session);
+			return ret;
+		}
+	}
+
+	ret = sr_session_threads_start(session);
+	if (ret != SR_OK) {
+		sr_session_pipeline_stop(session);
+		sr_session_ring_stop(session);
+		unset_main_context(session);
+		return ret;
+	}
+
 	sr_info("Starting.");
 
+	g_atomic_int_set(&session->discarding, FALSE);
 	session->running = TRUE;
 
 	/* Have all devices start acquisition. */
@@ -817,7 +1321,8 @@ SR_API int sr_session_start(struct sr_session *session)
 			ret = SR_ERR;
 			break;
 		}
-		ret = sr_dev_acquisition_start(sdi);
+		ret = sr_session_threads_dev_call(session, sdi,
+			sr_dev_acquisition_start, TRUE);
 		if (ret != SR_OK) {
 			sr_err("Could not start %s device %s acquisition.",
 				sdi->driver->name, sdi->connection_id);
@@ -831,22 +1336,67 @@ SR_API int sr_session_start(struct sr_session *session)
 		lend = l->next;
 		for (l = session->devs; l != lend; l = l->next) {
 			sdi = l->data;
-			sr_dev_acquisition_stop(sdi);
+			sr_session_threads_dev_call(session, sdi,
+				sr_dev_acquisition_stop, FALSE);
 		}
 		/* TODO: Handle delayed stops. Need to iterate the event
 		 * sources... */
+		sr_session_threads_stop(session);
 		session->running = FALSE;
 
 		unset_main_context(session);
+		sr_session_pipeline_stop(session);
+		sr_session_merge_stop(session);
+		sr_session_batch_stop(session);
+		sr_session_ring_stop(session);
 		return ret;
 	}
 
-	if (g_hash_table_size(session->event_sources) == 0)
+	if (session_source_count(session) == 0)
 		stop_check_later(session);
 
 	return SR_OK;
 }
 
+/**
+ * Start a session again, with the setup of its previous run.
+ *
+ * This works like sr_session_start(), but lets drivers skip programming
+ * devices whose config, channels and trigger did not change since their
+ * last acquisition start. Applications which do many short captures in a
+ * row can use this to cut the time spent per capture. The session's
+ * trigger must not have been modified in place since, replace it with
+ * sr_session_trigger_set() instead.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running, or another error occurred.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_rearm(struct sr_session *session)
+{
+	int ret;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot rearm a running session.");
+		return SR_ERR;
+	}
+
+	session->rearming = TRUE;
+	ret = sr_session_start(session);
+	session->rearming = FALSE;
+
+	return ret;
+}
+
 /**
  * Block until the running session stops.
  *
@@ -914,7 +1464,8 @@ static gboolean session_stop_sync(void *user_data)
 
 	for (node = session->devs; node; node = node->next) {
 		sdi = node->data;
-		sr_dev_acquisition_stop(sdi);
+		sr_session_threads_dev_call(session, sdi,
+			sr_dev_acquisition_stop, FALSE);
 	}
 
 	return G_SOURCE_REMOVE;
@@ -972,62 +1523,165 @@ SR_API int sr_session_stop(struct sr_session *session)
 }
 
 /**
- * Return whether the session is currently running.
- *
- * Note that this function should be called from the same thread
- * the session was started in.
+ * Stop a session quickly, dropping the data which is still on its way.
  *
- * @param session The session to use. Must not be NULL.
- *
- * @retval TRUE Session is running.
- * @retval FALSE Session is not running.
- * @retval SR_ERR_ARG Invalid session passed.
- *
- * @since 0.4.0
- */
-SR_API int sr_session_is_running(struct sr_session *session)
-{
-	if (!session) {
-		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_ARG;
-	}
-	return session->running;
-}
-
-/**
- * Set the callback to be invoked after a session stopped running.
+ * Like sr_session_stop(), this requests all devices to abort
+ * acquisition. In addition, logic and analog data which devices still
+ * send, and data which is queued in the session's worker threads, get
+ * discarded instead of running through transforms and datafeed
+ * callbacks. Other packets like SR_DF_END still get delivered. This
+ * is meant for applications which start and stop acquisition in rapid
+ * succession, and don't need the tail of the data.
  *
- * Install a callback to receive notification when a session run stopped.
- * This can be used to integrate session execution with an existing main
- * loop, without having to block in sr_session_run().
+ * @a cb gets invoked once when the session has stopped, after the
+ * callback set by sr_session_stopped_callback_set(). It runs in the
+ * context of the thread that called sr_session_start().
  *
- * Note that the callback will be invoked in the context of the thread
- * that calls sr_session_start().
+ * This function is reentrant in the same way as sr_session_stop().
  *
  * @param session The session to use. Must not be NULL.
- * @param cb The callback to invoke on session stop. May be NULL to unset.
+ * @param cb The callback to invoke when the session has stopped. May be
+ *           NULL.
  * @param cb_data User data pointer to be passed to the callback.
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_ARG Invalid session passed.
  *
- * @since 0.4.0
+ * @since 0.6.0
  */
-SR_API int sr_session_stopped_callback_set(struct sr_session *session,
+SR_API int sr_session_stop_fast(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data)
 {
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
 		return SR_ERR_ARG;
 	}
-	session->stopped_callback = cb;
-	session->stopped_cb_data = cb_data;
-
-	return SR_OK;
-}
+
+	g_mutex_lock(&session->main_mutex);
+	if (!session->main_context) {
+		g_mutex_unlock(&session->main_mutex);
+		sr_dbg("No main context set; already stopped?");
+		return SR_OK;
+	}
+	session->fast_stop_callback = cb;
+	session->fast_stop_cb_data = cb_data;
+	g_atomic_int_set(&session->discarding, TRUE);
+	g_mutex_unlock(&session->main_mutex);
+
+	return sr_session_stop(session);
+}
+
+/**
+ * Return whether a packet may get discarded by sr_session_stop_fast().
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_discards(const struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	if (!g_atomic_int_get(&session->discarding))
+		return FALSE;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+	case SR_DF_LOGIC_PLANAR:
+	case SR_DF_ANALOG:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * Return whether all consumers of a session take planar logic data.
+ *
+ * Drivers which get their samples channel major can then send them as
+ * SR_DF_LOGIC_PLANAR packets, rather than transposing them. Otherwise
+ * the conversion in the session would cost the same as their own.
+ *
+ * @param session The session to use.
+ *
+ * @return TRUE if the session has datafeed callbacks, all of which
+ *         registered for planar packets, and no transform modules.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_logic_planar_wanted(const struct sr_session *session)
+{
+	const struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	if (!session || !session->datafeed_callbacks || session->transforms)
+		return FALSE;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (!(cb_struct->flags & SR_DATAFEED_CB_LOGIC_PLANAR))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Return whether the session is currently running.
+ *
+ * Note that this function should be called from the same thread
+ * the session was started in.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval TRUE Session is running.
+ * @retval FALSE Session is not running.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_is_running(struct sr_session *session)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	return session->running;
+}
 
 /**
- * Debug helper.
+ * Set the callback to be invoked after a session stopped running.
+ *
+ * Install a callback to receive notification when a session run stopped.
+ * This can be used to integrate session execution with an existing main
+ * loop, without having to block in sr_session_run().
+ *
+ * Note that the callback will be invoked in the context of the thread
+ * that calls sr_session_start().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb The callback to invoke on session stop. May be NULL to unset.
+ * @param cb_data User data pointer to be passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_stopped_callback_set(struct sr_session *session,
+		sr_session_stopped_callback cb, void *cb_data)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	session->stopped_callback = cb;
+	session->stopped_cb_data = cb_data;
+
+	return SR_OK;
+}
+
+/**
+ * Debug helper. Payload packets only get shown at SR_LOG_SPEW, so that
+ * SR_LOG_DBG stays usable while data flows.
  *
  * @param packet The packet to show debugging information for.
  */
@@ -1035,6 +1689,8 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1052,7 +1708,7 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
-		sr_dbg("bus: Received SR_DF_LOGIC packet (%" PRIu64 " bytes, "
+		sr_spew("bus: Received SR_DF_LOGIC packet (%" PRIu64 " bytes, "
 		       "unitsize = %d).", logic->length, logic->unitsize);
 		break;
 	case SR_DF_FRAME_BEGIN:
@@ -1063,9 +1719,20 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
-		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
+		sr_spew("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_spew("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", rle->num_runs, rle->unitsize);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		sr_spew("bus: Received SR_DF_LOGIC_PLANAR packet (%" PRIu64
+		       " samples, unitsize = %d).", planar->num_samples,
+		       planar->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
@@ -1108,6 +1775,162 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+/* Look up the metadata of a referenced, or a scoped packet. */
+static gboolean packet_info_find(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info)
+{
+	struct packet_ref *ref;
+	struct sr_packet_info_scope *scope;
+	gboolean found;
+
+	found = FALSE;
+	G_LOCK(packet_refs);
+	ref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (ref && ref->has_info) {
+		*info = ref->info;
+		found = TRUE;
+	}
+	G_UNLOCK(packet_refs);
+	if (ref)
+		return found;
+
+	for (scope = g_private_get(&packet_info_scopes); scope;
+			scope = scope->prev) {
+		if (scope->packet == packet) {
+			*info = scope->info;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Attach metadata to a packet while it gets passed on.
+ *
+ * Referenced packets keep the metadata for their lifetime. Others have it
+ * until the matching sr_packet_info_scope_end() call, in the calling
+ * thread, and in the references which get taken of them meanwhile.
+ *
+ * @param scope Caller provided storage, typically on the stack.
+ * @param packet The packet.
+ * @param info The packet's metadata.
+ *
+ * @private
+ */
+SR_PRIV void sr_packet_info_scope_begin(struct sr_packet_info_scope *scope,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info)
+{
+	struct packet_ref *ref;
+
+	G_LOCK(packet_refs);
+	ref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (ref) {
+		ref->info = *info;
+		ref->has_info = TRUE;
+	}
+	G_UNLOCK(packet_refs);
+
+	scope->packet = ref ? NULL : packet;
+	scope->info = *info;
+	scope->prev = g_private_get(&packet_info_scopes);
+	g_private_set(&packet_info_scopes, scope);
+}
+
+/** @private */
+SR_PRIV void sr_packet_info_scope_end(struct sr_packet_info_scope *scope)
+{
+	g_private_set(&packet_info_scopes, scope->prev);
+}
+
+/**
+ * Send a packet to the session, along with its metadata.
+ *
+ * Drivers use this to pass the host time of the transfer which brought
+ * the data, or the number of samples which got lost before it. The
+ * index of the first sample gets filled in by the session.
+ *
+ * @param sdi The device instance that is sending the packet.
+ * @param packet The datafeed packet to send to the session bus.
+ * @param info The packet's metadata.
+ *
+ * @return See sr_session_send().
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_info(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info)
+{
+	struct sr_packet_info_scope scope;
+	int ret;
+
+	sr_packet_info_scope_begin(&scope, packet, info);
+	ret = sr_session_send(sdi, packet);
+	sr_packet_info_scope_end(&scope);
+
+	return ret;
+}
+
+/**
+ * Lend a packet to the session, along with its metadata.
+ *
+ * @see sr_session_send_lent(), sr_session_send_info()
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_lent_info(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_packet_info *info,
+		GDestroyNotify release, void *release_data)
+{
+	struct sr_packet_info_scope scope;
+	int ret;
+
+	sr_packet_info_scope_begin(&scope, packet, info);
+	ret = sr_session_send_lent(sdi, packet, release, release_data);
+	sr_packet_info_scope_end(&scope);
+
+	return ret;
+}
+
+/**
+ * Get the metadata of a datafeed packet.
+ *
+ * This works for the packets which datafeed callbacks get passed, and
+ * their references. Packets get a sample index, which counts the samples
+ * of the device's current acquisition including lost ones. So consumers
+ * can detect gaps without counting samples themselves. Where drivers
+ * provide them, packets also carry the host monotonic time (see
+ * g_get_monotonic_time()) at which their data arrived, and the number of
+ * samples which got lost right before the packet. Packets which
+ * transform modules create carry the metadata of their input.
+ *
+ * @param packet The packet. Must not be NULL.
+ * @param info The metadata gets stored here. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The packet has no metadata.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_packet_info_get(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info)
+{
+	if (!packet || !info)
+		return SR_ERR_ARG;
+
+	return packet_info_find(packet, info) ? SR_OK : SR_ERR_NA;
+}
+
+static int send_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	return sr_session_send(cb_data, packet);
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -1125,9 +1948,11 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
 	GSList *l;
-	struct datafeed_callback *cb_struct;
 	struct sr_datafeed_packet *packet_in, *packet_out;
 	struct sr_transform *t;
+	struct sr_datafeed_packet_info info;
+	struct sr_packet_info_scope scope;
+	gint64 start;
 	int ret;
 
 	if (!sdi) {
@@ -1145,16 +1970,49 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	SR_PROBE3(datafeed__send, sdi, packet->type,
+		sr_packet_payload_bytes(packet));
+
+	if (sr_session_discards(sdi->session, packet))
+		return SR_OK;
+
+	/* Packets from device threads get passed on by the session thread. */
+	if (sdi->session->threads &&
+			sr_session_threads_push(sdi->session, sdi, packet))
+		return SR_OK;
+
+	/* Transform modules only know about uncompressed logic data. */
+	if (packet->type == SR_DF_LOGIC_RLE && sdi->session->transforms)
+		return sr_logic_rle_foreach_chunk(packet, send_expanded,
+			(void *)sdi);
+	if (packet->type == SR_DF_LOGIC_PLANAR && sdi->session->transforms)
+		return sr_logic_planar_foreach_chunk(packet, send_expanded,
+			(void *)sdi);
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
 	 * transform module in the list, and so on.
 	 */
+	/* Transforms run on worker threads in pipelined mode. */
+	if (sdi->session->pipeline)
+		return sr_session_pipeline_push(sdi->session, sdi, packet);
+
 	packet_in = (struct sr_datafeed_packet *)packet;
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
 		sr_spew("Running transform module '%s'.", t->module->id);
-		ret = t->module->receive(t, packet_in, &packet_out);
+		SR_PROBE3(transform__entry, t->module->id, packet_in->type,
+			sr_packet_payload_bytes(packet_in));
+		if (sdi->session->stats_enabled) {
+			start = g_get_monotonic_time();
+			ret = t->module->receive(t, packet_in, &packet_out);
+			sr_datafeed_timing_add(&t->timing,
+				g_get_monotonic_time() - start);
+		} else {
+			ret = t->module->receive(t, packet_in, &packet_out);
+		}
+		SR_PROBE2(transform__return, t->module->id, ret);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
 			return SR_ERR;
@@ -1174,22 +2032,331 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			packet_in = packet_out;
 		}
 	}
+	/* Transform output carries the metadata of its input. */
+	if (packet_in != packet && packet_info_find(packet, &info)) {
+		sr_packet_info_scope_begin(&scope, packet_in, &info);
+		ret = sr_session_deliver(sdi->session, sdi, packet_in);
+		sr_packet_info_scope_end(&scope);
+		return ret;
+	}
 	packet = packet_in;
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
 	 * callbacks.
 	 */
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
-		cb_struct = l->data;
+	return sr_session_deliver(sdi->session, sdi, packet);
+}
+
+/**
+ * Pass a packet which went through all transforms to the consumers.
+ *
+ * The datafeed callbacks run right here, or by means of the delivery
+ * thread if the session has one. With merging enabled, the packet may
+ * be held back until the other devices caught up.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The packet could not be queued.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_deliver(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet_info info;
+	struct sr_packet_info_scope scope;
+	int64_t time_ns;
+	int ret;
+
+	if (!packet_info_find(packet, &info))
+		memset(&info, 0, sizeof(info));
+	time_ns = sr_session_clock_packet(session, sdi, packet, &info);
+
+	sr_packet_info_scope_begin(&scope, packet, &info);
+	if (session->merge_bytes)
+		ret = sr_session_merge_push(session, sdi, packet, time_ns);
+	else
+		ret = sr_session_deliver_merged(session, sdi, packet);
+	sr_packet_info_scope_end(&scope);
+
+	return ret;
+}
+
+/**
+ * Pass a packet to the consumers, bypassing time ordered delivery.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The packet could not be queued.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_deliver_merged(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	if (session->batch_bytes)
+		return sr_session_batch_push(session, sdi, packet);
+
+	return sr_session_deliver_unbatched(session, sdi, packet);
+}
+
+/**
+ * Pass a packet to the consumers, bypassing packet coalescing.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The packet could not be queued.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_deliver_unbatched(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	if (session->ring)
+		return sr_session_ring_push(session, sdi, packet);
+	sr_session_dispatch(session, sdi, packet);
+
+	return SR_OK;
+}
+
+struct dispatch_expanded {
+	struct sr_session *session;
+	const struct sr_dev_inst *sdi;
+	/* Callbacks with this flag got the packet as it was. */
+	uint32_t flag;
+};
+
+static void run_callback(struct sr_session *session,
+		struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	gint64 start, usecs;
+
+	if (sr_log_loglevel_get() >= SR_LOG_DBG)
+		datafeed_dump(packet);
+	if (!session->stats_enabled) {
 		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		return;
+	}
+
+	start = g_get_monotonic_time();
+	cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	usecs = g_get_monotonic_time() - start;
+	sr_datafeed_timing_add(&cb_struct->timing, usecs);
+	sr_datafeed_timing_add(&session->stats.callbacks, usecs);
+}
+
+/* Pass expanded logic data to the callbacks which can't take RLE or planes. */
+static int dispatch_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	struct dispatch_expanded *ctx;
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+
+	ctx = cb_data;
+	for (l = ctx->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->flags & ctx->flag)
+			continue;
+		run_callback(ctx->session, cb_struct, ctx->sdi, packet);
 	}
 
 	return SR_OK;
 }
 
+/**
+ * Pass a packet to all datafeed callbacks of a session.
+ *
+ * SR_DF_LOGIC_RLE and SR_DF_LOGIC_PLANAR packets get expanded for the
+ * callbacks which did not register for them.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_dispatch(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	struct dispatch_expanded expanded;
+	gboolean need_expand;
+
+	/* Data which was queued before a fast stop. */
+	if (sr_session_discards(session, packet))
+		return;
+
+	if (session->stats_enabled)
+		sr_session_stats_packet(session, packet);
+	if (session->retention)
+		sr_session_retention_push(session, sdi, packet);
+
+	if (packet->type == SR_DF_LOGIC_RLE)
+		expanded.flag = SR_DATAFEED_CB_LOGIC_RLE;
+	else if (packet->type == SR_DF_LOGIC_PLANAR)
+		expanded.flag = SR_DATAFEED_CB_LOGIC_PLANAR;
+	else
+		expanded.flag = 0;
+
+	need_expand = FALSE;
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (expanded.flag && !(cb_struct->flags & expanded.flag)) {
+			need_expand = TRUE;
+			continue;
+		}
+		run_callback(session, cb_struct, sdi, packet);
+	}
+	if (session->outputs)
+		sr_session_outputs_push(session, packet);
+	if (session->frame_mailbox)
+		sr_session_frame_mailbox_push(session, packet);
+
+	if (need_expand) {
+		expanded.session = session;
+		expanded.sdi = sdi;
+		if (packet->type == SR_DF_LOGIC_RLE) {
+			if (sr_logic_rle_foreach_chunk(packet,
+					dispatch_expanded, &expanded) != SR_OK)
+				sr_err("Cannot expand run length encoded logic data.");
+		} else if (sr_logic_planar_foreach_chunk(packet,
+				dispatch_expanded, &expanded) != SR_OK) {
+			sr_err("Cannot expand planar logic data.");
+		}
+	}
+}
+
+static void packet_ref_free(struct packet_ref *ref)
+{
+	if (ref->copy)
+		sr_packet_free(ref->copy);
+	else
+		g_slist_free(ref->meaning.channels);
+	if (ref->release)
+		ref->release(ref->release_data);
+	g_free(ref);
+}
+
+static void packet_ref_register(struct sr_datafeed_packet *packet,
+		struct packet_ref *ref)
+{
+	G_LOCK(packet_refs);
+	if (!packet_refs)
+		packet_refs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_insert(packet_refs, packet, ref);
+	G_UNLOCK(packet_refs);
+}
+
+static gboolean session_has_refcounted_cb(const struct sr_session *session)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->flags & SR_DATAFEED_CB_REFCOUNTED)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Send a packet with a payload buffer that is lent to the session.
+ *
+ * The sample data of @a packet is not copied. Datafeed callbacks which
+ * were registered with SR_DATAFEED_CB_REFCOUNTED can keep it alive by
+ * means of sr_packet_ref(). The @a release callback runs as soon as the
+ * last reference was dropped, which may be before this routine returns,
+ * or later and from a different thread. The caller must not modify or
+ * free the buffer before then. The packet and payload structs themselves
+ * are not retained and may live on the caller's stack.
+ *
+ * @param sdi The device instance that is sending the packet.
+ * @param packet The datafeed packet to send to the session bus.
+ * @param release Function which returns the buffer to the driver.
+ * @param release_data Argument to pass to @a release.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_lent(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		GDestroyNotify release, void *release_data)
+{
+	struct packet_ref *ref;
+	const struct sr_datafeed_analog *analog;
+	int ret;
+
+	if (!sdi || !packet || !sdi->session) {
+		ret = sr_session_send(sdi, packet);
+		if (release)
+			release(release_data);
+		return ret;
+	}
+
+	/* Nobody can take a reference, skip the bookkeeping. */
+	if ((!sdi->session->ring &&
+			!session_has_refcounted_cb(sdi->session)) ||
+			(packet->type != SR_DF_LOGIC &&
+			packet->type != SR_DF_ANALOG)) {
+		ret = sr_session_send(sdi, packet);
+		if (release)
+			release(release_data);
+		return ret;
+	}
+
+	ref = g_malloc0(sizeof(*ref));
+	ref->packet.type = packet->type;
+	if (packet->type == SR_DF_LOGIC) {
+		ref->logic = *(const struct sr_datafeed_logic *)packet->payload;
+		ref->packet.payload = &ref->logic;
+	} else {
+		analog = packet->payload;
+		ref->analog = *analog;
+		ref->encoding = *analog->encoding;
+		ref->meaning = *analog->meaning;
+		ref->meaning.channels = g_slist_copy(analog->meaning->channels);
+		ref->spec = *analog->spec;
+		ref->analog.encoding = &ref->encoding;
+		ref->analog.meaning = &ref->meaning;
+		ref->analog.spec = &ref->spec;
+		ref->packet.payload = &ref->analog;
+	}
+	ref->refcount = 1;
+	ref->release = release;
+	ref->release_data = release_data;
+	ref->has_info = packet_info_find(packet, &ref->info);
+	packet_ref_register(&ref->packet, ref);
+
+	ret = sr_session_send(sdi, &ref->packet);
+
+	/* Drop the session's own reference. */
+	sr_packet_unref(&ref->packet);
+
+	return ret;
+}
+
 /**
  * Add an event source for a file descriptor.
  *
@@ -1213,11 +2380,14 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 	 * already installed source. (Well it would, if we did not have
 	 * another sanity check there.)
 	 */
+	g_mutex_lock(&session->main_mutex);
 	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source with key %p already exists.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->main_mutex);
 
 	if (session_source_attach(session, source) == 0)
 		return SR_ERR;
@@ -1245,6 +2415,58 @@ SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 	return ret;
 }
 
+/**
+ * Attach a periodic timer to the session's event loop.
+ *
+ * Other than the event sources of drivers, the timer does not keep the
+ * acquisition running. Sources which get added from a device thread
+ * run in that thread, like the thread's other event sources.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param interval_ms The timer's period.
+ * @param cb Callback function. Must not be NULL.
+ * @param cb_data Data for the callback function. Can be NULL.
+ *
+ * @return The timer, to release with sr_session_timer_remove(), or NULL
+ *         upon failure.
+ *
+ * @private
+ */
+SR_PRIV GSource *sr_session_timer_add(struct sr_session *session,
+		unsigned int interval_ms, GSourceFunc cb, void *cb_data)
+{
+	GSource *source;
+
+	if (!session || !cb)
+		return NULL;
+
+	source = g_timeout_source_new(interval_ms);
+	g_source_set_name(source, "session-timer");
+	g_source_set_callback(source, cb, cb_data, NULL);
+	if (session_source_attach(session, source) == 0) {
+		g_source_unref(source);
+		return NULL;
+	}
+
+	return source;
+}
+
+/**
+ * Detach and release a timer of sr_session_timer_add().
+ *
+ * @param source The timer. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_timer_remove(GSource *source)
+{
+	if (!source)
+		return;
+
+	g_source_destroy(source);
+	g_source_unref(source);
+}
+
 /**
  * Add an event source for a file descriptor.
  *
@@ -1357,7 +2579,11 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 {
 	GSource *source;
 
+	g_mutex_lock(&session->main_mutex);
 	source = g_hash_table_lookup(session->event_sources, key);
+	if (source)
+		g_source_ref(source);
+	g_mutex_unlock(&session->main_mutex);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
@@ -1366,7 +2592,9 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 		sr_warn("Cannot remove non-existing event source %p.", key);
 		return SR_ERR_BUG;
 	}
+	/* Finalizing the source unregisters it, don't hold the lock. */
 	g_source_destroy(source);
+	g_source_unref(source);
 
 	return SR_OK;
 }
@@ -1453,24 +2681,30 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		void *key, GSource *source)
 {
 	GSource *registered_source;
+	unsigned int count;
 
+	g_mutex_lock(&session->main_mutex);
 	registered_source = g_hash_table_lookup(session->event_sources, key);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
 	 */
 	if (!registered_source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("No event source for key %p found.", key);
 		return SR_ERR_BUG;
 	}
 	if (registered_source != source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source for key %p does not match"
 			" destroyed source.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_remove(session->event_sources, key);
+	count = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (g_hash_table_size(session->event_sources) > 0)
+	if (count > 0)
 		return SR_OK;
 
 	/* If no event sources are left, consider the acquisition finished.
@@ -1501,12 +2735,17 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_meta *meta_copy;
 	const struct sr_datafeed_logic *logic;
 	struct sr_datafeed_logic *logic_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
+	const struct sr_datafeed_logic_planar *planar;
+	struct sr_datafeed_logic_planar *planar_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
 	uint8_t *payload;
+	size_t num_planes, plane_bytes, size, i;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
 	(*copy)->type = packet->type;
@@ -1514,6 +2753,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +2765,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1566,6 +2807,50 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		rle_copy->num_runs = rle->num_runs;
+		rle_copy->unitsize = rle->unitsize;
+#if GLIB_CHECK_VERSION(2, 67, 3)
+		rle_copy->values = g_memdup2(rle->values,
+			rle->num_runs * rle->unitsize);
+		rle_copy->run_lengths = g_memdup2(rle->run_lengths,
+			rle->num_runs * sizeof(rle->run_lengths[0]));
+#else
+		rle_copy->values = g_memdup(rle->values,
+			rle->num_runs * rle->unitsize);
+		rle_copy->run_lengths = g_memdup(rle->run_lengths,
+			rle->num_runs * sizeof(rle->run_lengths[0]));
+#endif
+		(*copy)->payload = rle_copy;
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		planar_copy = g_malloc(sizeof(*planar_copy));
+		planar_copy->num_samples = planar->num_samples;
+		planar_copy->unitsize = planar->unitsize;
+		/* The planes follow their pointers, in one allocation. */
+		num_planes = planar->unitsize * 8;
+		plane_bytes = (planar->num_samples + 7) / 8;
+		size = num_planes * sizeof(planar->planes[0]);
+		for (i = 0; i < num_planes; i++) {
+			if (planar->planes[i])
+				size += plane_bytes;
+		}
+		planar_copy->planes = g_malloc(size);
+		payload = (uint8_t *)&planar_copy->planes[num_planes];
+		for (i = 0; i < num_planes; i++) {
+			if (!planar->planes[i]) {
+				planar_copy->planes[i] = NULL;
+				continue;
+			}
+			memcpy(payload, planar->planes[i], plane_bytes);
+			planar_copy->planes[i] = payload;
+			payload += plane_bytes;
+		}
+		(*copy)->payload = planar_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1578,6 +2863,8 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
 	const struct sr_datafeed_analog *analog;
 	struct sr_config *src;
 	GSList *l;
@@ -1585,6 +2872,8 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1615,10 +2904,100 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		g_free(rle->values);
+		g_free(rle->run_lengths);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		g_free(planar->planes);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
 	g_free(packet);
 }
 
+/**
+ * Take a reference on a datafeed packet.
+ *
+ * Packets which were lent to the session by a driver are not copied,
+ * their reference count gets incremented instead. Other packets (and
+ * packets that were modified by transform modules) are deep-copied with
+ * sr_packet_copy(), the copy starts out with one reference.
+ *
+ * @param packet The packet to reference. Must not be NULL.
+ *
+ * @return The referenced packet, to be released with sr_packet_unref().
+ *         This may or may not be the same pointer as @a packet. NULL
+ *         upon errors.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet)
+{
+	struct packet_ref *ref;
+	struct sr_datafeed_packet *copy;
+
+	if (!packet)
+		return NULL;
+
+	G_LOCK(packet_refs);
+	ref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (ref)
+		ref->refcount++;
+	G_UNLOCK(packet_refs);
+	if (ref)
+		return (struct sr_datafeed_packet *)packet;
+
+	if (sr_packet_copy(packet, &copy) != SR_OK)
+		return NULL;
+	ref = g_malloc0(sizeof(*ref));
+	ref->copy = copy;
+	ref->refcount = 1;
+	ref->has_info = packet_info_find(packet, &ref->info);
+	packet_ref_register(copy, ref);
+
+	return copy;
+}
+
+/**
+ * Drop a reference that was taken with sr_packet_ref().
+ *
+ * When the last reference is gone, the packet is freed, and lent buffers
+ * are returned to the driver which sent them.
+ *
+ * @param packet The packet to release.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet)
+{
+	struct packet_ref *ref;
+	gboolean last;
+
+	if (!packet)
+		return;
+
+	last = FALSE;
+	G_LOCK(packet_refs);
+	ref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (ref && --ref->refcount == 0) {
+		g_hash_table_remove(packet_refs, packet);
+		last = TRUE;
+	}
+	G_UNLOCK(packet_refs);
+
+	if (!ref) {
+		sr_err("%s: packet %p is not referenced", __func__, packet);
+		return;
+	}
+	if (last)
+		packet_ref_free(ref);
+}
+
 /** @} */
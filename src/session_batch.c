@@ -0,0 +1,356 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Coalescing of consecutive data packets before delivery.
+ *
+ * Drivers typically send one packet per USB transfer, or even smaller
+ * chunks. Consumers which do bookkeeping per datafeed callback benefit
+ * from fewer, larger packets. When batching is enabled, consecutive logic
+ * or analog packets of the same device and format get collected in a
+ * buffer, and are delivered as one packet when the byte budget is used
+ * up, when the latency budget is exceeded, or when any other packet
+ * (trigger, frame markers, end of stream, ...) comes along.
+ *
+ * Batching happens after the transforms ran, and before the packets get
+ * handed to the datafeed callbacks or the delivery ring. Packets arrive
+ * here from a single thread only (the session's event processing, or
+ * the last transform pipeline stage), so no locking is needed.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-batch"
+/** @endcond */
+
+struct sr_session_batch {
+	/* Type of the pending packet, 0 when the buffer is empty. */
+	int type;
+	const struct sr_dev_inst *sdi;
+	uint8_t *data;
+	size_t length;
+	size_t size;
+	/* Monotonic time when the first pending packet arrived. */
+	gint64 first_time;
+	/* Metadata of the first pending packet. */
+	struct sr_datafeed_packet_info info;
+	gboolean has_info;
+
+	/* Format of the pending data. */
+	unsigned int unitsize;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+};
+
+static gboolean same_channels(GSList *a, GSList *b)
+{
+	while (a && b) {
+		if (a->data != b->data)
+			return FALSE;
+		a = a->next;
+		b = b->next;
+	}
+
+	return !a && !b;
+}
+
+static gboolean same_encoding(const struct sr_analog_encoding *a,
+		const struct sr_analog_encoding *b)
+{
+	return a->unitsize == b->unitsize &&
+		a->is_signed == b->is_signed &&
+		a->is_float == b->is_float &&
+		a->is_bigendian == b->is_bigendian &&
+		a->digits == b->digits &&
+		a->is_digits_decimal == b->is_digits_decimal &&
+		a->scale.p == b->scale.p && a->scale.q == b->scale.q &&
+		a->offset.p == b->offset.p && a->offset.q == b->offset.q;
+}
+
+/* Whether the packet's data can get appended to the pending data. */
+static gboolean batch_can_append(const struct sr_session_batch *batch,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, size_t length)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct sr_datafeed_packet_info info;
+
+	if (batch->type != packet->type || batch->sdi != sdi)
+		return FALSE;
+	if (batch->length + length > batch->size)
+		return FALSE;
+	/* Lost samples must stay visible at a packet boundary. */
+	if (sr_packet_info_get(packet, &info) == SR_OK && info.dropped_samples)
+		return FALSE;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		return logic->unitsize == batch->unitsize;
+	}
+
+	analog = packet->payload;
+	return same_encoding(analog->encoding, &batch->encoding) &&
+		analog->meaning->mq == batch->meaning.mq &&
+		analog->meaning->unit == batch->meaning.unit &&
+		analog->meaning->mqflags == batch->meaning.mqflags &&
+		same_channels(analog->meaning->channels,
+			batch->meaning.channels) &&
+		analog->spec->spec_digits == batch->spec.spec_digits;
+}
+
+/* Size of a data packet's payload in bytes, 0 for other packets. */
+static size_t packet_data_length(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		return logic->unitsize ? logic->length : 0;
+	}
+	if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		return (size_t)analog->num_samples * analog->encoding->unitsize *
+			g_slist_length(analog->meaning->channels);
+	}
+
+	return 0;
+}
+
+/* Take over the format of the first packet of a new batch. */
+static void batch_begin(struct sr_session_batch *batch,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	batch->type = packet->type;
+	batch->sdi = sdi;
+	batch->length = 0;
+	batch->first_time = g_get_monotonic_time();
+	batch->has_info = sr_packet_info_get(packet, &batch->info) == SR_OK;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		batch->unitsize = logic->unitsize;
+		return;
+	}
+
+	analog = packet->payload;
+	batch->encoding = *analog->encoding;
+	batch->meaning = *analog->meaning;
+	batch->meaning.channels = g_slist_copy(analog->meaning->channels);
+	batch->spec = *analog->spec;
+	batch->analog.encoding = &batch->encoding;
+	batch->analog.meaning = &batch->meaning;
+	batch->analog.spec = &batch->spec;
+	batch->analog.num_samples = 0;
+}
+
+static void batch_append(struct sr_session_batch *batch,
+		const struct sr_datafeed_packet *packet, size_t length)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		memcpy(batch->data + batch->length, logic->data, length);
+	} else {
+		analog = packet->payload;
+		memcpy(batch->data + batch->length, analog->data, length);
+		batch->analog.num_samples += analog->num_samples;
+	}
+	batch->length += length;
+}
+
+/* Deliver the pending data, if any, as one packet. */
+static int batch_flush(struct sr_session *session)
+{
+	struct sr_session_batch *batch;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_packet_info_scope scope;
+	int ret;
+
+	batch = session->batch;
+	if (!batch->type)
+		return SR_OK;
+
+	packet.type = batch->type;
+	if (batch->type == SR_DF_LOGIC) {
+		logic.length = batch->length;
+		logic.unitsize = batch->unitsize;
+		logic.data = batch->data;
+		packet.payload = &logic;
+	} else {
+		batch->analog.data = batch->data;
+		packet.payload = &batch->analog;
+	}
+	if (batch->has_info) {
+		sr_packet_info_scope_begin(&scope, &packet, &batch->info);
+		ret = sr_session_deliver_unbatched(session, batch->sdi, &packet);
+		sr_packet_info_scope_end(&scope);
+	} else {
+		ret = sr_session_deliver_unbatched(session, batch->sdi, &packet);
+	}
+
+	if (batch->type == SR_DF_ANALOG) {
+		g_slist_free(batch->meaning.channels);
+		batch->meaning.channels = NULL;
+	}
+	batch->type = 0;
+	batch->sdi = NULL;
+	batch->length = 0;
+
+	return ret;
+}
+
+/**
+ * Collect a packet for coalesced delivery.
+ *
+ * Logic and analog packets which fit the pending data get appended to
+ * it. Everything else first flushes the pending data, and then gets
+ * delivered as is. Data packets which exceed the byte budget on their
+ * own are passed on without copying them.
+ *
+ * @param session The session to use. Batching must be enabled.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR A packet could not be delivered.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_batch_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_batch *batch;
+	size_t length;
+	int ret;
+
+	batch = session->batch;
+	if (!batch) {
+		batch = g_malloc0(sizeof(*batch));
+		batch->size = session->batch_bytes;
+		batch->data = g_malloc(batch->size);
+		session->batch = batch;
+	}
+
+	length = packet_data_length(packet);
+	if (!length || length > batch->size) {
+		ret = batch_flush(session);
+		if (sr_session_deliver_unbatched(session, sdi, packet) != SR_OK)
+			ret = SR_ERR;
+		return ret;
+	}
+
+	ret = SR_OK;
+	if (batch->type && !batch_can_append(batch, sdi, packet, length))
+		ret = batch_flush(session);
+	if (!batch->type)
+		batch_begin(batch, sdi, packet);
+	batch_append(batch, packet, length);
+
+	if (batch->length == batch->size || (session->batch_latency &&
+			g_get_monotonic_time() - batch->first_time >=
+			session->batch_latency)) {
+		if (batch_flush(session) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	return ret;
+}
+
+/**
+ * Deliver pending data, and release the batching state of a session.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_batch_stop(struct sr_session *session)
+{
+	struct sr_session_batch *batch;
+
+	batch = session->batch;
+	if (!batch)
+		return;
+
+	batch_flush(session);
+	g_free(batch->data);
+	g_free(batch);
+	session->batch = NULL;
+}
+
+/**
+ * Configure coalescing of data packets for a session.
+ *
+ * With a non-zero @a max_bytes, consecutive logic or analog packets of
+ * the same device and format get combined before the datafeed callbacks
+ * see them. The combined packet is delivered when it holds @a max_bytes
+ * of sample data, when its first part arrived more than @a max_latency_ms
+ * ago, or when a packet of another kind (e.g. a trigger, or the end of
+ * the stream) comes along. The latency gets checked when packets arrive,
+ * so the data of a device which stops sending is held back until the
+ * next packet.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes Byte budget of a combined packet. 0 disables batching.
+ * @param max_latency_ms Latency budget in milliseconds, 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_batch_set(struct sr_session *session,
+		size_t max_bytes, unsigned int max_latency_ms)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change datafeed batching of a running session.");
+		return SR_ERR;
+	}
+
+	sr_session_batch_stop(session);
+	session->batch_bytes = max_bytes;
+	session->batch_latency = (gint64)max_latency_ms * 1000;
+
+	return SR_OK;
+}
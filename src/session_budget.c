@@ -0,0 +1,461 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Memory budget of a session.
+ *
+ * Components which hold sample data for longer, like feed queues and
+ * their buffer pools, pre-trigger buffers, output modules and the
+ * retention buffer, charge their allocations to an account of the
+ * session they work for. Accounts of the same component, e.g. all feed
+ * queues, share the component's usage, which can be limited on its own.
+ * The session's limit covers all of them.
+ *
+ * When the usage reaches 90% of the session's limit, the session is
+ * under memory pressure until the usage went below 75% of it again.
+ * Components then don't grow their buffers, feed queue pools wait for
+ * the consumers to return buffers instead of allocating more, and
+ * drivers which can hold back the data, e.g. because it sits in device
+ * memory, pause their transfers. See sr_session_memory_pressure().
+ *
+ * The budget is reference counted, accounts may outlive the session,
+ * e.g. buffers of a pool which consumers still hold.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-budget"
+/** @endcond */
+
+/* Pressure hysteresis, in percent of the session's limit. */
+#define PRESSURE_ON_PERCENT 90
+#define PRESSURE_OFF_PERCENT 75
+
+/** @cond PRIVATE */
+struct mem_component {
+	uint64_t max_bytes;
+	uint64_t used;
+	uint64_t peak;
+};
+
+struct sr_session_budget {
+	gint refcount;
+	GMutex mutex;
+	uint64_t max_bytes;
+	uint64_t used;
+	uint64_t peak;
+	gboolean pressure;
+	/* struct mem_component of each component, by name. */
+	GHashTable *components;
+};
+
+struct sr_mem_account {
+	struct sr_session_budget *budget;
+	struct mem_component *comp;
+	char *name;
+	uint64_t used;
+};
+/** @endcond */
+
+static struct sr_session_budget *budget_get(struct sr_session *session)
+{
+	struct sr_session_budget *budget;
+
+	if ((budget = session->budget))
+		return budget;
+
+	budget = g_malloc0(sizeof(*budget));
+	budget->refcount = 1;
+	g_mutex_init(&budget->mutex);
+	budget->components = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+	session->budget = budget;
+
+	return budget;
+}
+
+static void budget_unref(struct sr_session_budget *budget)
+{
+	if (!g_atomic_int_dec_and_test(&budget->refcount))
+		return;
+
+	g_hash_table_unref(budget->components);
+	g_mutex_clear(&budget->mutex);
+	g_free(budget);
+}
+
+static struct mem_component *component_get(struct sr_session_budget *budget,
+		const char *name)
+{
+	struct mem_component *comp;
+
+	comp = g_hash_table_lookup(budget->components, name);
+	if (!comp) {
+		comp = g_malloc0(sizeof(*comp));
+		g_hash_table_insert(budget->components, g_strdup(name), comp);
+	}
+
+	return comp;
+}
+
+/* Update the pressure state after the usage changed. Must hold the lock. */
+static void update_pressure(struct sr_session_budget *budget)
+{
+	uint64_t limit;
+
+	if (!budget->max_bytes) {
+		budget->pressure = FALSE;
+		return;
+	}
+
+	if (!budget->pressure) {
+		limit = budget->max_bytes / 100 * PRESSURE_ON_PERCENT;
+		if (budget->used < limit)
+			return;
+		budget->pressure = TRUE;
+		sr_warn("Memory pressure, %" PRIu64 " of %" PRIu64
+			" bytes in use.", budget->used, budget->max_bytes);
+	} else {
+		limit = budget->max_bytes / 100 * PRESSURE_OFF_PERCENT;
+		if (budget->used >= limit)
+			return;
+		budget->pressure = FALSE;
+		sr_dbg("Memory pressure relieved, %" PRIu64 " bytes in use.",
+			budget->used);
+	}
+}
+
+static void charge(struct sr_mem_account *acct, uint64_t bytes)
+{
+	struct sr_session_budget *budget;
+
+	budget = acct->budget;
+	acct->used += bytes;
+	acct->comp->used += bytes;
+	acct->comp->peak = MAX(acct->comp->peak, acct->comp->used);
+	budget->used += bytes;
+	budget->peak = MAX(budget->peak, budget->used);
+	update_pressure(budget);
+}
+
+/**
+ * Open an account for the allocations of a component.
+ *
+ * @param session The session the component works for. May be NULL, the
+ *                allocations then are not accounted for.
+ * @param name The name of the component, e.g. "feed-queue".
+ *
+ * @return The new account, or NULL without a session.
+ *
+ * @private
+ */
+SR_PRIV struct sr_mem_account *sr_mem_account_new(struct sr_session *session,
+		const char *name)
+{
+	struct sr_session_budget *budget;
+	struct sr_mem_account *acct;
+
+	if (!session || !name)
+		return NULL;
+
+	budget = budget_get(session);
+	g_atomic_int_inc(&budget->refcount);
+
+	acct = g_malloc0(sizeof(*acct));
+	acct->budget = budget;
+	acct->name = g_strdup(name);
+	g_mutex_lock(&budget->mutex);
+	acct->comp = component_get(budget, name);
+	g_mutex_unlock(&budget->mutex);
+
+	return acct;
+}
+
+/**
+ * Close an account, what is still charged to it gets released.
+ *
+ * @param acct The account, may be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_mem_account_free(struct sr_mem_account *acct)
+{
+	if (!acct)
+		return;
+
+	sr_mem_account_release(acct, acct->used);
+	budget_unref(acct->budget);
+	g_free(acct->name);
+	g_free(acct);
+}
+
+/**
+ * Charge an allocation to an account, even when that exceeds the budget.
+ *
+ * For allocations which the component cannot do without.
+ *
+ * @param acct The account, may be NULL.
+ * @param bytes The size of the allocation.
+ *
+ * @private
+ */
+SR_PRIV void sr_mem_account_charge(struct sr_mem_account *acct, size_t bytes)
+{
+	if (!acct)
+		return;
+
+	g_mutex_lock(&acct->budget->mutex);
+	charge(acct, bytes);
+	g_mutex_unlock(&acct->budget->mutex);
+}
+
+/**
+ * Charge an allocation to an account when it fits the budget.
+ *
+ * The allocation neither may exceed the limit of the session, nor the
+ * limit of the account's component.
+ *
+ * @param acct The account, may be NULL.
+ * @param bytes The size of the allocation.
+ *
+ * @return TRUE when the allocation was charged, FALSE when the caller
+ *         should do without it.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_mem_account_try_charge(struct sr_mem_account *acct,
+		size_t bytes)
+{
+	struct sr_session_budget *budget;
+	gboolean fits;
+
+	if (!acct)
+		return TRUE;
+
+	budget = acct->budget;
+	g_mutex_lock(&budget->mutex);
+	fits = (!budget->max_bytes ||
+		budget->used + bytes <= budget->max_bytes) &&
+		(!acct->comp->max_bytes ||
+		acct->comp->used + bytes <= acct->comp->max_bytes);
+	if (fits)
+		charge(acct, bytes);
+	g_mutex_unlock(&budget->mutex);
+
+	return fits;
+}
+
+/**
+ * Release an allocation which was charged to an account.
+ *
+ * @param acct The account, may be NULL.
+ * @param bytes The size of the allocation.
+ *
+ * @private
+ */
+SR_PRIV void sr_mem_account_release(struct sr_mem_account *acct, size_t bytes)
+{
+	struct sr_session_budget *budget;
+
+	if (!acct || !bytes)
+		return;
+
+	budget = acct->budget;
+	g_mutex_lock(&budget->mutex);
+	bytes = MIN(bytes, acct->used);
+	acct->used -= bytes;
+	acct->comp->used -= bytes;
+	budget->used -= bytes;
+	update_pressure(budget);
+	g_mutex_unlock(&budget->mutex);
+}
+
+/**
+ * Whether the session of an account is under memory pressure.
+ *
+ * @param acct The account, may be NULL.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_mem_account_pressure(const struct sr_mem_account *acct)
+{
+	if (!acct)
+		return FALSE;
+
+	return g_atomic_int_get(&acct->budget->pressure);
+}
+
+/**
+ * Drop the session's reference to its budget.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_budget_free(struct sr_session *session)
+{
+	if (!session->budget)
+		return;
+
+	budget_unref(session->budget);
+	session->budget = NULL;
+}
+
+/**
+ * Limit the memory which a session's components hold.
+ *
+ * Feed queues, pre-trigger buffers, output modules and the retention
+ * buffer charge their sample data allocations to the session. From 90%
+ * of the limit on, the session is under memory pressure and components
+ * hold back, so that consumers which fall behind slow down the
+ * acquisition rather than have the memory use grow without bounds.
+ * Allocations which components cannot do without may exceed the limit.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes The limit in bytes, 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_memory_budget_set(struct sr_session *session,
+		uint64_t max_bytes)
+{
+	struct sr_session_budget *budget;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	budget = budget_get(session);
+	g_mutex_lock(&budget->mutex);
+	budget->max_bytes = max_bytes;
+	update_pressure(budget);
+	g_mutex_unlock(&budget->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Limit the memory which one kind of component of a session holds.
+ *
+ * The component's limit applies within the one of the session. Known
+ * components are "feed-queue", "pre-trigger", "output" and "retention".
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param component The name of the component. Must not be NULL.
+ * @param max_bytes The limit in bytes, 0 for no limit of its own.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_memory_limit_set(struct sr_session *session,
+		const char *component, uint64_t max_bytes)
+{
+	struct sr_session_budget *budget;
+
+	if (!session || !component) {
+		sr_err("%s: invalid arguments", __func__);
+		return SR_ERR_ARG;
+	}
+
+	budget = budget_get(session);
+	g_mutex_lock(&budget->mutex);
+	component_get(budget, component)->max_bytes = max_bytes;
+	g_mutex_unlock(&budget->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the memory use of a session, or of one of its components.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param component The name of the component, NULL for the session.
+ * @param used Where to store the bytes in use, may be NULL.
+ * @param peak Where to store the most bytes that were in use, may be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_memory_usage_get(struct sr_session *session,
+		const char *component, uint64_t *used, uint64_t *peak)
+{
+	struct sr_session_budget *budget;
+	struct mem_component *comp;
+	uint64_t u, p;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	u = p = 0;
+	if ((budget = session->budget)) {
+		g_mutex_lock(&budget->mutex);
+		if (!component) {
+			u = budget->used;
+			p = budget->peak;
+		} else if ((comp = g_hash_table_lookup(budget->components,
+				component))) {
+			u = comp->used;
+			p = comp->peak;
+		}
+		g_mutex_unlock(&budget->mutex);
+	}
+	if (used)
+		*used = u;
+	if (peak)
+		*peak = p;
+
+	return SR_OK;
+}
+
+/**
+ * Whether a session is under memory pressure.
+ *
+ * Drivers which can hold back data use this to pause their transfers,
+ * frontends may use it to tell users that the consumers fall behind.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @return TRUE while the memory use is close to the session's limit.
+ *
+ * @since 0.6.0
+ */
+SR_API gboolean sr_session_memory_pressure(struct sr_session *session)
+{
+	if (!session || !session->budget)
+		return FALSE;
+
+	return g_atomic_int_get(&session->budget->pressure);
+}
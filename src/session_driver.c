@@ -24,6 +24,9 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <zip.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -32,24 +35,72 @@
 /* size of payloads sent across the session bus */
 /** @cond PRIVATE */
 #define CHUNKSIZE (4 * 1024 * 1024)
+/* Number of payload buffers which circulate between reader and session. */
+#define READAHEAD_BLOCKS 4
+/* How long the main loop waits for the reader before doing other work. */
+#define READAHEAD_WAIT_US (10 * 1000)
+/* Default bound on the time span of a paced packet, in ms. */
+#define PACING_JITTER_MS 10
 /** @endcond */
 
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+struct readahead_pool;
+
+/* A payload buffer. An empty block marks the end of the capture data. */
+struct readahead_block {
+	struct readahead_pool *pool;
+	uint8_t *data;
+	size_t length;
+	/* 0 for logic data, else the 1-based analog channel. */
+	int analog_channel;
+	/* Outstanding slices of a paced block, plus the driver's own. */
+	gint slices;
+};
+
+/*
+ * Recycles payload buffers. Blocks can get returned by datafeed
+ * callbacks which hold a reference after the acquisition has finished,
+ * so the pool only gets freed when the last block has come back.
+ */
+struct readahead_pool {
+	GMutex mutex;
+	GCond cond;
+	GSList *free_blocks;
+	unsigned int num_blocks;
+	gboolean stopping;
+	gboolean closed;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
 	struct zip *archive;
-	struct zip_file *capfile;
 	int bytes_read;
 	uint64_t samplerate;
 	int unitsize;
 	int num_logic_channels;
 	int num_analog_channels;
-	int cur_analog_channel;
 	GArray *analog_channels;
-	int cur_chunk;
+	/* Sample encodings of the analog channels, float unless noted. */
+	struct sr_analog_encoding *analog_encodings;
+	/* Logic data is stored as runs of identical samples. */
+	gboolean logic_runs;
 	gboolean finished;
+	struct readahead_pool *pool;
+	GAsyncQueue *full_blocks;
+	GThread *reader;
+	/* Bytes the reader queued in the current pass over the file. */
+	uint64_t pass_bytes;
+	/* Pacing, a speed of 0 sends data as fast as possible. */
+	double speed;
+	gboolean loop;
+	uint64_t jitter_ms;
+	struct readahead_block *block;
+	size_t block_offset;
+	int pace_channel;
+	int64_t pace_start_us;
+	uint64_t pace_samples;
 };
 
 static const uint32_t devopts[] = {
@@ -59,9 +110,453 @@ static const uint32_t devopts[] = {
 	SR_CONF_NUM_ANALOG_CHANNELS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
+	SR_CONF_REPLAY_SPEED | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REPLAY_LOOP | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LATENCY_TARGET | SR_CONF_GET | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+static struct readahead_pool *pool_new(void)
+{
+	struct readahead_pool *pool;
+	struct readahead_block *block;
+	unsigned int i;
+
+	pool = g_malloc0(sizeof(*pool));
+	g_mutex_init(&pool->mutex);
+	g_cond_init(&pool->cond);
+	for (i = 0; i < READAHEAD_BLOCKS; i++) {
+		block = g_malloc0(sizeof(*block));
+		block->pool = pool;
+		block->data = g_malloc(CHUNKSIZE);
+		pool->free_blocks = g_slist_prepend(pool->free_blocks, block);
+		pool->num_blocks++;
+	}
+
+	return pool;
+}
+
+static void pool_free(struct readahead_pool *pool)
+{
+	g_mutex_clear(&pool->mutex);
+	g_cond_clear(&pool->cond);
+	g_free(pool);
+}
+
+static void block_free(struct readahead_block *block)
+{
+	g_free(block->data);
+	g_free(block);
+}
+
+/* Take a free block, waiting for one. Returns NULL when stopping. */
+static struct readahead_block *pool_get(struct readahead_pool *pool)
+{
+	struct readahead_block *block;
+
+	block = NULL;
+	g_mutex_lock(&pool->mutex);
+	while (!pool->free_blocks && !pool->stopping)
+		g_cond_wait(&pool->cond, &pool->mutex);
+	if (!pool->stopping) {
+		block = pool->free_blocks->data;
+		pool->free_blocks = g_slist_delete_link(pool->free_blocks,
+			pool->free_blocks);
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	return block;
+}
+
+/* Return a block to its pool. Suitable as a packet release callback. */
+static void pool_put(void *data)
+{
+	struct readahead_block *block;
+	struct readahead_pool *pool;
+	gboolean last;
+
+	block = data;
+	pool = block->pool;
+	last = FALSE;
+	g_mutex_lock(&pool->mutex);
+	if (pool->closed) {
+		block_free(block);
+		last = --pool->num_blocks == 0;
+	} else {
+		pool->free_blocks = g_slist_prepend(pool->free_blocks, block);
+		g_cond_signal(&pool->cond);
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (last)
+		pool_free(pool);
+}
+
+/* Drop a reference to a block which was sent in slices. */
+static void block_slice_put(void *data)
+{
+	struct readahead_block *block;
+
+	block = data;
+	if (g_atomic_int_dec_and_test(&block->slices))
+		pool_put(block);
+}
+
+/* Wake up and turn away the reader, which may wait for a free block. */
+static void pool_stop(struct readahead_pool *pool)
+{
+	g_mutex_lock(&pool->mutex);
+	pool->stopping = TRUE;
+	g_cond_broadcast(&pool->cond);
+	g_mutex_unlock(&pool->mutex);
+}
+
+/* Free the pool, or have the last block which comes back do that. */
+static void pool_close(struct readahead_pool *pool)
+{
+	GSList *l;
+	gboolean last;
+
+	g_mutex_lock(&pool->mutex);
+	pool->closed = TRUE;
+	for (l = pool->free_blocks; l; l = l->next) {
+		block_free(l->data);
+		pool->num_blocks--;
+	}
+	g_slist_free(pool->free_blocks);
+	pool->free_blocks = NULL;
+	last = pool->num_blocks == 0;
+	g_mutex_unlock(&pool->mutex);
+
+	if (last)
+		pool_free(pool);
+}
+
+/*
+ * The size of the stored items of a stream: an analog sample, a logic
+ * sample, or a run of logic samples (the count, then the value).
+ */
+static size_t item_size(const struct session_vdev *vdev, int analog_channel)
+{
+	if (analog_channel)
+		return vdev->analog_encodings[analog_channel - 1].unitsize;
+	if (vdev->unitsize && vdev->logic_runs)
+		return SR_SESSIONFILE_RUN_COUNT_SIZE + vdev->unitsize;
+
+	return vdev->unitsize;
+}
+
+/* Get the number of samples in a range of a block. */
+static uint64_t block_samples(const struct session_vdev *vdev,
+	const struct readahead_block *block, size_t offset, size_t length)
+{
+	size_t unitsize;
+	const uint8_t *rdptr, *end;
+	uint64_t count;
+
+	unitsize = item_size(vdev, block->analog_channel);
+	if (!unitsize)
+		return 0;
+	if (block->analog_channel || !vdev->logic_runs)
+		return length / unitsize;
+
+	count = 0;
+	rdptr = block->data + offset;
+	end = rdptr + length;
+	while (rdptr + unitsize <= end) {
+		count += read_u32le(rdptr);
+		rdptr += unitsize;
+	}
+
+	return count;
+}
+
+/* Send runs of logic samples as a run length encoded packet. */
+static void send_runs(struct sr_dev_inst *sdi, const uint8_t *data,
+	size_t length)
+{
+	struct session_vdev *vdev;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+	size_t record_size, idx;
+	uint8_t *values;
+
+	vdev = sdi->priv;
+	record_size = SR_SESSIONFILE_RUN_COUNT_SIZE + vdev->unitsize;
+	rle.unitsize = vdev->unitsize;
+	rle.num_runs = length / record_size;
+	if (!rle.num_runs)
+		return;
+	rle.values = values = g_malloc(rle.num_runs * vdev->unitsize);
+	rle.run_lengths = g_malloc(rle.num_runs * sizeof(rle.run_lengths[0]));
+	for (idx = 0; idx < rle.num_runs; idx++) {
+		rle.run_lengths[idx] = read_u32le(data);
+		memcpy(values, data + SR_SESSIONFILE_RUN_COUNT_SIZE,
+			vdev->unitsize);
+		values += vdev->unitsize;
+		data += record_size;
+	}
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	sr_session_send(sdi, &packet);
+	g_free(rle.values);
+	g_free(rle.run_lengths);
+}
+
+static void queue_block(struct session_vdev *vdev,
+	struct readahead_block *block, size_t length, int analog_channel)
+{
+	block->length = length;
+	block->analog_channel = analog_channel;
+	vdev->pass_bytes += length;
+	g_async_queue_push(vdev->full_blocks, block);
+}
+
+#ifdef HAVE_LIBZSTD
+/*
+ * Decompress a zstd member. libzip only handles them when it was built
+ * with zstd support, so the compressed data gets read and decompressed
+ * here.
+ */
+static gboolean read_member_zstd(struct session_vdev *vdev, const char *name,
+	int analog_channel, size_t size)
+{
+	struct readahead_block *block;
+	struct zip_file *capfile;
+	ZSTD_DStream *dstream;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	uint8_t *cbuf;
+	size_t cbuf_size, ret;
+	zip_int64_t len;
+	gboolean eof, ok;
+
+	if (!(capfile = zip_fopen(vdev->archive, name, ZIP_FL_COMPRESSED)))
+		return FALSE;
+	if (!(dstream = ZSTD_createDStream())) {
+		zip_fclose(capfile);
+		return FALSE;
+	}
+	ZSTD_initDStream(dstream);
+	sr_dbg("Opened %s (zstd).", name);
+
+	cbuf_size = ZSTD_DStreamInSize();
+	cbuf = g_malloc(cbuf_size);
+	in.src = cbuf;
+	in.size = in.pos = 0;
+	out.size = out.pos = 0;
+	block = NULL;
+	eof = FALSE;
+	ok = TRUE;
+	while (TRUE) {
+		if (in.pos == in.size && !eof) {
+			len = zip_fread(capfile, cbuf, cbuf_size);
+			eof = len <= 0;
+			in.size = eof ? 0 : len;
+			in.pos = 0;
+		}
+		if (!block) {
+			if (!(block = pool_get(vdev->pool))) {
+				ok = FALSE;
+				break;
+			}
+			out.dst = block->data;
+			out.size = size;
+			out.pos = 0;
+		}
+		ret = ZSTD_decompressStream(dstream, &out, &in);
+		if (ZSTD_isError(ret)) {
+			sr_err("Cannot decompress %s: %s.", name,
+				ZSTD_getErrorName(ret));
+			ok = FALSE;
+			break;
+		}
+		if (out.pos == out.size) {
+			queue_block(vdev, block, out.pos, analog_channel);
+			block = NULL;
+		} else if (eof && in.pos == in.size) {
+			/* Everything was flushed, the output has room left. */
+			break;
+		}
+	}
+	if (block && ok && out.pos)
+		queue_block(vdev, block, out.pos, analog_channel);
+	else if (block)
+		pool_put(block);
+	g_free(cbuf);
+	ZSTD_freeDStream(dstream);
+	zip_fclose(capfile);
+
+	return ok;
+}
+#endif
+
+/* Decompress an archive member into blocks, and queue them. */
+static gboolean read_member(struct session_vdev *vdev, const char *name,
+	int analog_channel)
+{
+	struct readahead_block *block;
+	struct zip_file *capfile;
+	struct zip_stat zs;
+	size_t size, unitsize;
+	zip_int64_t ret;
+
+	/*
+	 * unitsize is not defined for purely analog session files.
+	 * Blocks hold complete samples, or complete runs.
+	 */
+	size = CHUNKSIZE;
+	unitsize = item_size(vdev, analog_channel);
+	if (unitsize)
+		size = CHUNKSIZE / unitsize * unitsize;
+
+	if (zip_stat(vdev->archive, name, 0, &zs) != -1 &&
+			(zs.valid & ZIP_STAT_COMP_METHOD) &&
+			zs.comp_method == SR_ZIP_METHOD_ZSTD) {
+#ifdef HAVE_LIBZSTD
+		return read_member_zstd(vdev, name, analog_channel, size);
+#else
+		sr_err("Cannot read %s, zstd is not supported by this build.",
+			name);
+		return FALSE;
+#endif
+	}
+
+	if (!(capfile = zip_fopen(vdev->archive, name, 0)))
+		return FALSE;
+	sr_dbg("Opened %s.", name);
+
+	while (TRUE) {
+		if (!(block = pool_get(vdev->pool))) {
+			zip_fclose(capfile);
+			return FALSE;
+		}
+		ret = zip_fread(capfile, block->data, size);
+		if (ret <= 0) {
+			pool_put(block);
+			break;
+		}
+		queue_block(vdev, block, ret, analog_channel);
+	}
+	zip_fclose(capfile);
+
+	return TRUE;
+}
+
+/* Read a capture stream, which is either a single member or chunked. */
+static gboolean read_stream(struct session_vdev *vdev, const char *base,
+	int analog_channel)
+{
+	struct zip_stat zs;
+	char capturefile[128];
+	int chunk;
+
+	/* No chunks, just a single capture file. */
+	if (zip_stat(vdev->archive, base, 0, &zs) != -1)
+		return read_member(vdev, base, analog_channel);
+
+	for (chunk = 1; ; chunk++) {
+		snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d",
+			base, chunk);
+		if (zip_stat(vdev->archive, capturefile, 0, &zs) == -1)
+			break;
+		if (!read_member(vdev, capturefile, analog_channel))
+			return FALSE;
+	}
+	if (chunk == 1) {
+		sr_err("No capture file '%s' in " "session file '%s'.",
+				base, vdev->sessionfile);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Decompress the capture data ahead of the session, so that zlib
+ * runs concurrently with the datafeed callbacks. The number of
+ * blocks in the pool limits how far the reader gets ahead. In loop
+ * mode, the reader starts over until the acquisition gets stopped.
+ */
+static gpointer reader_thread(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct readahead_block *block;
+	gboolean ok;
+	char *name;
+	int i;
+
+	vdev = data;
+
+	do {
+		vdev->pass_bytes = 0;
+		ok = TRUE;
+		if (vdev->capturefile)
+			ok = read_stream(vdev, vdev->capturefile, 0);
+		for (i = 0; ok && i < vdev->num_analog_channels; i++) {
+			name = g_strdup_printf("analog-1-%d",
+					vdev->num_logic_channels + i + 1);
+			ok = read_stream(vdev, name, i + 1);
+			g_free(name);
+		}
+		/* Don't spin on a file without sample data. */
+	} while (ok && vdev->loop && vdev->pass_bytes);
+
+	if ((block = pool_get(vdev->pool))) {
+		block->length = 0;
+		g_async_queue_push(vdev->full_blocks, block);
+	}
+
+	return NULL;
+}
+
+static int readahead_start(struct session_vdev *vdev)
+{
+	GError *error;
+
+	vdev->pool = pool_new();
+	vdev->full_blocks = g_async_queue_new();
+
+	error = NULL;
+	vdev->reader = g_thread_try_new("sr-session-read", reader_thread,
+		vdev, &error);
+	if (!vdev->reader) {
+		sr_err("Cannot create reader thread: %s.", error->message);
+		g_error_free(error);
+		g_async_queue_unref(vdev->full_blocks);
+		vdev->full_blocks = NULL;
+		pool_close(vdev->pool);
+		vdev->pool = NULL;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static void readahead_stop(struct session_vdev *vdev)
+{
+	struct readahead_block *block;
+
+	if (!vdev->reader)
+		return;
+
+	pool_stop(vdev->pool);
+	g_thread_join(vdev->reader);
+	vdev->reader = NULL;
+
+	while ((block = g_async_queue_try_pop(vdev->full_blocks)))
+		pool_put(block);
+	g_async_queue_unref(vdev->full_blocks);
+	vdev->full_blocks = NULL;
+	pool_close(vdev->pool);
+	vdev->pool = NULL;
+}
+
+/*
+ * Send (part of) a block to the session. The release routine runs when
+ * the session is done with the data.
+ */
+static void send_slice(struct sr_dev_inst *sdi, struct readahead_block *block,
+	size_t offset, size_t length, GDestroyNotify release)
 {
 	struct session_vdev *vdev;
 	struct sr_datafeed_packet packet;
@@ -70,140 +565,123 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[128];
-	void *buf;
 
-	got_data = FALSE;
 	vdev = sdi->priv;
 
-	if (!vdev->capfile) {
-		/* No capture file opened yet, or finished with the last
-		 * chunked one. */
-		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
-			/* capturefile is always the unchunked base name. */
-			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-				/* No chunks, just a single capture file. */
-				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
-			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					sr_err("No capture file '%s' in " "session file '%s'.",
-							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
-				}
-			}
-		} else {
-			/* Capture data is chunked, advance to the next chunk. */
-			vdev->cur_chunk++;
-			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
-					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
-			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
-				vdev->capturefile = g_strdup_printf("analog-1-%d",
-						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
-				vdev->cur_analog_channel++;
-				vdev->cur_chunk = 0;
+	if (block->analog_channel != 0) {
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		encoding = vdev->analog_encodings[block->analog_channel - 1];
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, block->analog_channel - 1));
+		analog.num_samples = length / encoding.unitsize;
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = block->data + offset;
+	} else if (vdev->unitsize && vdev->logic_runs) {
+		/* The runs get copied, the block can be returned. */
+		vdev->bytes_read += length;
+		send_runs(sdi, block->data + offset, length);
+		release(block);
+		return;
+	} else if (vdev->unitsize) {
+		if (length % vdev->unitsize != 0)
+			sr_warn("Read size %zu not a multiple of the"
+				" unit size %d.", length, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = length;
+		logic.unitsize = vdev->unitsize;
+		logic.data = block->data + offset;
+	} else {
+		/*
+		 * Neither analog data, nor logic which has
+		 * unitsize, must be an unexpected API use.
+		 */
+		sr_warn("Neither analog nor logic data. Ignoring.");
+		release(block);
+		return;
+	}
+
+	vdev->bytes_read += length;
+	sr_session_send_lent(sdi, &packet, release, block);
+	if (packet.type == SR_DF_ANALOG)
+		g_slist_free(analog.meaning->channels);
+}
+
+/*
+ * Send the data which is due at the configured speed. Blocks get cut
+ * into slices which cover at most the jitter bound each, and a slice is
+ * sent when the wall clock has reached its first sample. The pace starts
+ * over with every stream of the file, since the streams are read one
+ * after another. Returns FALSE when the end of the data was reached.
+ */
+static gboolean send_paced(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct readahead_block *block;
+	size_t unitsize, length;
+	uint64_t slice_samples;
+	int64_t now, due;
+	double rate;
+
+	vdev = sdi->priv;
+	rate = vdev->samplerate * vdev->speed;
+	slice_samples = MAX(1, rate * vdev->jitter_ms / 1000);
+	now = g_get_monotonic_time();
+
+	while (TRUE) {
+		if (!vdev->block) {
+			if (!(block = g_async_queue_try_pop(vdev->full_blocks)))
 				return TRUE;
-			} else {
-				/* We got all the chunks, finish up. */
-				g_free(vdev->capturefile);
-
-				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
-				 * once. In order to not mess this mechanism up, we simulate
-				 * this here if needed. For purely analog files, capturefile
-				 * is not set.
-				 */
-				if (vdev->num_logic_channels)
-					vdev->capturefile = g_strdup("logic-1");
-				else
-					vdev->capturefile = NULL;
+			if (!block->length) {
+				pool_put(block);
 				return FALSE;
 			}
+			if (!vdev->pace_start_us ||
+					block->analog_channel != vdev->pace_channel) {
+				vdev->pace_channel = block->analog_channel;
+				vdev->pace_start_us = now;
+				vdev->pace_samples = 0;
+			}
+			block->slices = 1;
+			vdev->block = block;
+			vdev->block_offset = 0;
 		}
-	}
-
-	buf = g_malloc(CHUNKSIZE);
-
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
-
-	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
-		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
-	} else {
-		/* done with this capture file */
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
+		block = vdev->block;
+
+		due = vdev->pace_start_us +
+			(int64_t)(vdev->pace_samples * G_USEC_PER_SEC / rate);
+		if (due > now)
+			return TRUE;
+
+		/* Slices of runs cover at least as many samples as items. */
+		unitsize = item_size(vdev, block->analog_channel);
+		length = block->length - vdev->block_offset;
+		if (unitsize)
+			length = MIN(length, slice_samples * unitsize);
+		vdev->pace_samples += block_samples(vdev, block,
+			vdev->block_offset, length);
+		g_atomic_int_inc(&block->slices);
+		send_slice(sdi, block, vdev->block_offset, length,
+			block_slice_put);
+		vdev->block_offset += length;
+		if (vdev->block_offset >= block->length) {
+			vdev->block = NULL;
+			block_slice_put(block);
 		}
 	}
-	g_free(buf);
-
-	return got_data;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct session_vdev *vdev;
+	struct readahead_block *block;
 
 	(void)fd;
 	(void)revents;
@@ -211,15 +689,28 @@ static int receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	vdev = sdi->priv;
 
-	if (!vdev->finished && !stream_session_data(sdi))
+	if (!vdev->finished && vdev->speed > 0) {
+		if (send_paced(sdi))
+			return G_SOURCE_CONTINUE;
 		vdev->finished = TRUE;
-	if (!vdev->finished)
-		return G_SOURCE_CONTINUE;
+	} else if (!vdev->finished) {
+		block = g_async_queue_timeout_pop(vdev->full_blocks,
+			READAHEAD_WAIT_US);
+		if (!block)
+			return G_SOURCE_CONTINUE;
+		if (block->length) {
+			send_slice(sdi, block, 0, block->length, pool_put);
+			return G_SOURCE_CONTINUE;
+		}
+		pool_put(block);
+		vdev->finished = TRUE;
+	}
 
-	if (vdev->capfile) {
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
+	if (vdev->block) {
+		block_slice_put(vdev->block);
+		vdev->block = NULL;
 	}
+	readahead_stop(vdev);
 	if (vdev->archive) {
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
@@ -241,6 +732,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	di = sdi->driver;
 	drvc = di->context;
 	vdev = g_malloc0(sizeof(struct session_vdev));
+	vdev->jitter_ms = PACING_JITTER_MS;
 	sdi->priv = vdev;
 	drvc->instances = g_slist_append(drvc->instances, sdi);
 
@@ -252,6 +744,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 	const struct session_vdev *const vdev = sdi->priv;
 	g_free(vdev->sessionfile);
 	g_free(vdev->capturefile);
+	g_free(vdev->analog_encodings);
 
 	g_free(sdi->priv);
 	sdi->priv = NULL;
@@ -278,6 +771,15 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_REPLAY_SPEED:
+		*data = g_variant_new_double(vdev->speed);
+		break;
+	case SR_CONF_REPLAY_LOOP:
+		*data = g_variant_new_boolean(vdev->loop);
+		break;
+	case SR_CONF_LATENCY_TARGET:
+		*data = g_variant_new_uint64(vdev->jitter_ms);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -318,6 +820,19 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_NUM_ANALOG_CHANNELS:
 		vdev->num_analog_channels = g_variant_get_int32(data);
 		break;
+	case SR_CONF_REPLAY_SPEED:
+		if (g_variant_get_double(data) < 0)
+			return SR_ERR_ARG;
+		vdev->speed = g_variant_get_double(data);
+		break;
+	case SR_CONF_REPLAY_LOOP:
+		vdev->loop = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_LATENCY_TARGET:
+		if (!g_variant_get_uint64(data))
+			return SR_ERR_ARG;
+		vdev->jitter_ms = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -331,6 +846,50 @@ static int config_list(uint32_t key, GVariant **data,
 	return STD_CONFIG_LIST(key, data, sdi, cg, NO_OPTS, NO_OPTS, devopts);
 }
 
+/* Get the logic and analog sample encodings from the session file. */
+static int get_encodings(struct session_vdev *vdev)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	char *capture_encoding;
+	int i, ret;
+
+	g_free(vdev->analog_encodings);
+	vdev->analog_encodings = g_malloc0_n(vdev->num_analog_channels + 1,
+		sizeof(vdev->analog_encodings[0]));
+	for (i = 0; i < vdev->num_analog_channels; i++) {
+		sr_analog_init(&analog, &vdev->analog_encodings[i],
+			&meaning, &spec, 2);
+	}
+
+	if (zip_stat(vdev->archive, "metadata", 0, &zs) < 0)
+		return SR_ERR_DATA;
+	if (!(kf = sr_sessionfile_read_metadata(vdev->archive, &zs)))
+		return SR_ERR_DATA;
+	ret = SR_OK;
+	capture_encoding = g_key_file_get_string(kf, "device 1",
+		"capture encoding", NULL);
+	vdev->logic_runs = g_strcmp0(capture_encoding, "runs") == 0;
+	if (capture_encoding && !vdev->logic_runs) {
+		sr_err("Unknown capture encoding '%s'.", capture_encoding);
+		ret = SR_ERR_DATA;
+	}
+	g_free(capture_encoding);
+	for (i = 0; ret == SR_OK && i < vdev->num_analog_channels; i++) {
+		ret = sr_sessionfile_analog_encoding_get(kf,
+			vdev->num_logic_channels + i + 1,
+			&vdev->analog_encodings[i]);
+	}
+	g_key_file_free(kf);
+	if (ret != SR_OK)
+		sr_err("Invalid sample encoding in session file.");
+
+	return ret;
+}
+
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
@@ -340,7 +899,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_analog_channel = 0;
 	vdev->analog_channels = g_array_sized_new(FALSE, FALSE,
 			sizeof(struct sr_channel *), vdev->num_analog_channels);
 	for (l = sdi->channels; l; l = l->next) {
@@ -348,8 +906,13 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		if (ch->type == SR_CHANNEL_ANALOG)
 			g_array_append_val(vdev->analog_channels, ch);
 	}
-	vdev->cur_chunk = 0;
 	vdev->finished = FALSE;
+	vdev->block = NULL;
+	vdev->pace_start_us = 0;
+	if (vdev->speed > 0 && !vdev->samplerate) {
+		sr_warn("No samplerate, cannot pace the replay.");
+		vdev->speed = 0;
+	}
 
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
 		vdev->capturefile);
@@ -360,10 +923,21 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	if (get_encodings(vdev) != SR_OK ||
+			readahead_start(vdev) != SR_OK) {
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return SR_ERR;
+	}
+
 	std_session_send_df_header(sdi);
 
-	/* freewheeling source */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	/*
+	 * Freewheeling source, or a short timeout which checks for due
+	 * data when the replay is paced.
+	 */
+	sr_session_source_add(sdi->session, -1, 0, vdev->speed > 0 ? 1 : 0,
+		receive_data, (void *)sdi);
 
 	return SR_OK;
 }
@@ -45,6 +45,25 @@
 
 /** @cond PRIVATE */
 extern SR_PRIV struct sr_dev_driver session_driver;
+
+/*
+ * Integer encodings of analog samples, in the metadata's group which
+ * older readers don't inspect. Channels without an entry hold floats.
+ */
+#define ANALOG_ENCODING_GROUP "analog encoding"
+
+static const struct {
+	const char *name;
+	uint8_t unitsize;
+	gboolean is_signed;
+} analog_int_encodings[] = {
+	{ "int8", sizeof(int8_t), TRUE, },
+	{ "uint8", sizeof(uint8_t), FALSE, },
+	{ "int16", sizeof(int16_t), TRUE, },
+	{ "uint16", sizeof(uint16_t), FALSE, },
+	{ "int32", sizeof(int32_t), TRUE, },
+	{ "uint32", sizeof(uint32_t), FALSE, },
+};
 /** @endcond */
 static int session_driver_initialized = 0;
 
@@ -58,6 +77,146 @@ SR_PRIV void sr_zip_discard(struct zip *archive)
 }
 #endif
 
+/**
+ * Record the integer encoding of an analog channel's samples in a
+ * session file's metadata.
+ *
+ * Samples are stored in little endian byte order. The encoding's scale
+ * and offset translate them to the channel's values.
+ *
+ * @param[in] kf The session file's metadata.
+ * @param[in] ch_nr The channel's 1-based number ("analog<N>" keys).
+ * @param[in] encoding The samples' encoding.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The encoding is not an integer encoding which
+ *                    session files support.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_analog_encoding_set(GKeyFile *kf, size_t ch_nr,
+		const struct sr_analog_encoding *encoding)
+{
+	const char *name;
+	char *key, *val;
+	size_t i;
+
+	if (!kf || !encoding || encoding->is_float)
+		return SR_ERR_ARG;
+
+	name = NULL;
+	for (i = 0; i < ARRAY_SIZE(analog_int_encodings); i++) {
+		if (analog_int_encodings[i].unitsize != encoding->unitsize)
+			continue;
+		if (analog_int_encodings[i].is_signed != encoding->is_signed)
+			continue;
+		name = analog_int_encodings[i].name;
+		break;
+	}
+	if (!name || !encoding->scale.q || !encoding->offset.q)
+		return SR_ERR_ARG;
+
+	key = g_strdup_printf("analog%zu", ch_nr);
+	g_key_file_set_string(kf, ANALOG_ENCODING_GROUP, key, name);
+	g_free(key);
+	key = g_strdup_printf("analog%zu scale", ch_nr);
+	val = g_strdup_printf("%" PRId64 "/%" PRIu64,
+		encoding->scale.p, encoding->scale.q);
+	g_key_file_set_string(kf, ANALOG_ENCODING_GROUP, key, val);
+	g_free(val);
+	g_free(key);
+	key = g_strdup_printf("analog%zu offset", ch_nr);
+	val = g_strdup_printf("%" PRId64 "/%" PRIu64,
+		encoding->offset.p, encoding->offset.q);
+	g_key_file_set_string(kf, ANALOG_ENCODING_GROUP, key, val);
+	g_free(val);
+	g_free(key);
+
+	return SR_OK;
+}
+
+/* Get a "<p>/<q>" fraction, or @a dflt_p / 1 if the key is absent. */
+static int parse_fraction(GKeyFile *kf, const char *key,
+		struct sr_rational *value, int64_t dflt_p)
+{
+	char *val, *end;
+
+	val = g_key_file_get_string(kf, ANALOG_ENCODING_GROUP, key, NULL);
+	if (!val) {
+		value->p = dflt_p;
+		value->q = 1;
+		return SR_OK;
+	}
+	value->p = g_ascii_strtoll(val, &end, 10);
+	if (end == val || *end != '/') {
+		g_free(val);
+		return SR_ERR_DATA;
+	}
+	value->q = g_ascii_strtoull(end + 1, &end, 10);
+	if (*end || !value->q) {
+		g_free(val);
+		return SR_ERR_DATA;
+	}
+	g_free(val);
+
+	return SR_OK;
+}
+
+/**
+ * Get the encoding of an analog channel's samples in a session file.
+ *
+ * The caller presets @a encoding (see sr_analog_init()), which is kept
+ * for channels that hold float samples in the host's byte order.
+ *
+ * @param[in] kf The session file's metadata.
+ * @param[in] ch_nr The channel's 1-based number ("analog<N>" keys).
+ * @param[in,out] encoding The samples' encoding.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed encoding specs.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_analog_encoding_get(GKeyFile *kf, size_t ch_nr,
+		struct sr_analog_encoding *encoding)
+{
+	char *key, *name;
+	size_t i;
+	int ret;
+
+	if (!kf || !encoding)
+		return SR_ERR_ARG;
+
+	key = g_strdup_printf("analog%zu", ch_nr);
+	name = g_key_file_get_string(kf, ANALOG_ENCODING_GROUP, key, NULL);
+	g_free(key);
+	if (!name)
+		return SR_OK;
+	for (i = 0; i < ARRAY_SIZE(analog_int_encodings); i++) {
+		if (strcmp(name, analog_int_encodings[i].name) == 0)
+			break;
+	}
+	g_free(name);
+	if (i == ARRAY_SIZE(analog_int_encodings))
+		return SR_ERR_DATA;
+	encoding->unitsize = analog_int_encodings[i].unitsize;
+	encoding->is_signed = analog_int_encodings[i].is_signed;
+	encoding->is_float = FALSE;
+	encoding->is_bigendian = FALSE;
+
+	key = g_strdup_printf("analog%zu scale", ch_nr);
+	ret = parse_fraction(kf, key, &encoding->scale, 1);
+	g_free(key);
+	if (ret != SR_OK)
+		return ret;
+	key = g_strdup_printf("analog%zu offset", ch_nr);
+	ret = parse_fraction(kf, key, &encoding->offset, 0);
+	g_free(key);
+
+	return ret;
+}
+
 /**
  * Read metadata entries from a session archive.
  *
@@ -151,7 +310,7 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	zip_fclose(zf);
 	s[ret] = '\0';
 	version = g_ascii_strtoull(s, NULL, 10);
-	if (version == 0 || version > 2) {
+	if (version == 0 || version > 4) {
 		sr_dbg("Cannot handle sigrok session file version %" PRIu64 ".",
 			version);
 		zip_discard(archive);
@@ -393,4 +552,859 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+/** @cond PRIVATE */
+/* One member of a (possibly chunked) capture stream in the archive. */
+struct sessionfile_chunk {
+	uint64_t chunk_num;
+	uint64_t first_sample;
+	uint64_t num_samples;
+	zip_uint64_t index;
+	uint64_t size;
+};
+
+/* All chunks of one capture stream, ordered by their sample ranges. */
+struct sessionfile_stream {
+	size_t unitsize;
+	uint64_t num_samples;
+	GArray *chunks;
+	/* Analog streams only, samples need conversion unless float. */
+	struct sr_analog_encoding encoding;
+	/* Logic stream only, chunks hold runs of identical samples. */
+	gboolean runs;
+};
+
+struct sr_sessionfile_reader {
+	struct zip *archive;
+	struct sessionfile_stream *logic;
+	/* Analog streams, keyed by channel index. */
+	GHashTable *analog;
+	/* Summary level streams, keyed by their member base name. */
+	GHashTable *summaries;
+	/* The most recently decompressed chunk. */
+	const struct sessionfile_stream *cache_stream;
+	size_t cache_chunk;
+	uint8_t *cache;
+	size_t cache_size;
+};
+/** @endcond */
+
+static int stream_count_runs(struct sr_sessionfile_reader *reader,
+	struct sessionfile_stream *stream);
+
+/* The size of a sample, the items of runs also hold a count. */
+static size_t stream_sample_size(const struct sessionfile_stream *stream)
+{
+	if (stream->runs)
+		return stream->unitsize - SR_SESSIONFILE_RUN_COUNT_SIZE;
+
+	return stream->unitsize;
+}
+
+static struct sessionfile_stream *stream_new(size_t unitsize)
+{
+	struct sessionfile_stream *stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->unitsize = unitsize;
+	stream->chunks = g_array_new(FALSE, FALSE,
+		sizeof(struct sessionfile_chunk));
+
+	return stream;
+}
+
+static void stream_free(void *data)
+{
+	struct sessionfile_stream *stream;
+
+	stream = data;
+	if (!stream)
+		return;
+	g_array_free(stream->chunks, TRUE);
+	g_free(stream);
+}
+
+static void stream_add(struct sessionfile_stream *stream,
+	uint64_t chunk_num, zip_uint64_t index, uint64_t size)
+{
+	struct sessionfile_chunk chunk;
+
+	chunk.chunk_num = chunk_num;
+	chunk.index = index;
+	chunk.size = size;
+	chunk.num_samples = size / stream->unitsize;
+	chunk.first_sample = 0;
+	g_array_append_val(stream->chunks, chunk);
+}
+
+static gint chunk_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct sessionfile_chunk *ca, *cb;
+
+	ca = a;
+	cb = b;
+	if (ca->chunk_num == cb->chunk_num)
+		return 0;
+
+	return ca->chunk_num < cb->chunk_num ? -1 : 1;
+}
+
+/* Sort the chunks by their number, and assign their sample ranges. */
+static void stream_finalize(struct sessionfile_stream *stream)
+{
+	struct sessionfile_chunk *chunk;
+	guint i;
+
+	g_array_sort(stream->chunks, chunk_cmp);
+	stream->num_samples = 0;
+	for (i = 0; i < stream->chunks->len; i++) {
+		chunk = &g_array_index(stream->chunks,
+			struct sessionfile_chunk, i);
+		chunk->first_sample = stream->num_samples;
+		stream->num_samples += chunk->num_samples;
+	}
+}
+
+static void stream_finalize_cb(gpointer key, gpointer value, gpointer data)
+{
+	(void)key;
+	(void)data;
+
+	stream_finalize(value);
+}
+
+/* Parse a chunk number suffix ("" or "-<number>") of a member name. */
+static gboolean parse_chunk_suffix(const char *suffix, uint64_t *chunk_num)
+{
+	char *end;
+
+	if (!*suffix) {
+		*chunk_num = 0;
+		return TRUE;
+	}
+	if (suffix[0] != '-' || !g_ascii_isdigit(suffix[1]))
+		return FALSE;
+	*chunk_num = g_ascii_strtoull(suffix + 1, &end, 10);
+
+	return *end == '\0';
+}
+
+/*
+ * Index a chunk of a summary level ("summary-logic-1-<factor>-<chunk>",
+ * or "summary-analog-1-<channel number>-<factor>-<chunk>"). Each bin
+ * holds a minimum and a maximum.
+ */
+static void reader_add_summary(struct sr_sessionfile_reader *reader,
+	const char *name, zip_uint64_t index, uint64_t size)
+{
+	struct sessionfile_stream *stream;
+	const char *dash;
+	uint64_t chunk_num;
+	size_t unitsize;
+	char *base;
+
+	if (!strncmp(name, "summary-logic-1-", 16) && reader->logic)
+		unitsize = 2 * stream_sample_size(reader->logic);
+	else if (!strncmp(name, "summary-analog-1-", 17))
+		unitsize = 2 * sizeof(float);
+	else
+		return;
+
+	dash = strrchr(name, '-');
+	if (!parse_chunk_suffix(dash, &chunk_num))
+		return;
+
+	base = g_strndup(name, dash - name);
+	stream = g_hash_table_lookup(reader->summaries, base);
+	if (!stream) {
+		stream = stream_new(unitsize);
+		g_hash_table_insert(reader->summaries, base, stream);
+	} else {
+		g_free(base);
+	}
+	stream_add(stream, chunk_num, index, size);
+}
+
+/*
+ * Build the chunk index from the archive's directory. The directory
+ * holds the uncompressed size of every member, so no sample data needs
+ * to be decompressed for this.
+ */
+static int reader_build_index(struct sr_sessionfile_reader *reader,
+	GKeyFile *kf, const char *capturefile, size_t unitsize)
+{
+	struct sessionfile_stream *stream;
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct zip_stat zs;
+	zip_int64_t i, num_entries;
+	const char *name, *suffix;
+	size_t baselen;
+	uint64_t chunk_num, ch_nr;
+	char *end, *capture_encoding;
+	gboolean runs;
+	int ret;
+
+	/* Chunks of runs hold a count and a sample value per item. */
+	capture_encoding = g_key_file_get_string(kf, "device 1",
+		"capture encoding", NULL);
+	runs = g_strcmp0(capture_encoding, "runs") == 0;
+	if (capture_encoding && !runs) {
+		sr_err("Unknown capture encoding '%s'.", capture_encoding);
+		g_free(capture_encoding);
+		return SR_ERR_DATA;
+	}
+	g_free(capture_encoding);
+	if (capturefile && unitsize) {
+		if (runs)
+			unitsize += SR_SESSIONFILE_RUN_COUNT_SIZE;
+		reader->logic = stream_new(unitsize);
+		reader->logic->runs = runs;
+	}
+	baselen = capturefile ? strlen(capturefile) : 0;
+
+	num_entries = zip_get_num_entries(reader->archive, 0);
+	for (i = 0; i < num_entries; i++) {
+		name = zip_get_name(reader->archive, i, 0);
+		if (!name)
+			continue;
+		if (zip_stat_index(reader->archive, i, 0, &zs) < 0)
+			return SR_ERR_DATA;
+
+		if (!strncmp(name, "summary-", 8)) {
+			reader_add_summary(reader, name, i, zs.size);
+			continue;
+		}
+
+		if (reader->logic && !strncmp(name, capturefile, baselen) &&
+				parse_chunk_suffix(name + baselen, &chunk_num)) {
+			stream_add(reader->logic, chunk_num, i, zs.size);
+			continue;
+		}
+
+		/* "analog-1-<channel number>-<chunk number>" */
+		if (strncmp(name, "analog-1-", 9) != 0)
+			continue;
+		ch_nr = g_ascii_strtoull(name + 9, &end, 10);
+		suffix = end;
+		if (end == name + 9 || ch_nr == 0 || ch_nr > G_MAXINT ||
+				!parse_chunk_suffix(suffix, &chunk_num))
+			continue;
+		stream = g_hash_table_lookup(reader->analog,
+			GINT_TO_POINTER(ch_nr - 1));
+		if (!stream) {
+			sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+			if (sr_sessionfile_analog_encoding_get(kf, ch_nr,
+					&encoding) != SR_OK)
+				return SR_ERR_DATA;
+			stream = stream_new(encoding.unitsize);
+			stream->encoding = encoding;
+			g_hash_table_insert(reader->analog,
+				GINT_TO_POINTER(ch_nr - 1), stream);
+		}
+		stream_add(stream, chunk_num, i, zs.size);
+	}
+
+	if (reader->logic && reader->logic->runs) {
+		ret = stream_count_runs(reader, reader->logic);
+		if (ret != SR_OK)
+			return ret;
+	}
+	if (reader->logic)
+		stream_finalize(reader->logic);
+	g_hash_table_foreach(reader->analog, stream_finalize_cb, NULL);
+	g_hash_table_foreach(reader->summaries, stream_finalize_cb, NULL);
+
+	return SR_OK;
+}
+
+/**
+ * Open a session file for random access to its samples.
+ *
+ * An index which maps the archive's chunks to sample ranges is built
+ * from the archive's directory. Reading a range of samples then only
+ * decompresses the chunks which hold them.
+ *
+ * @param filename The name of the session file.
+ * @param reader Where to store the new reader. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR This is not a session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_open(const char *filename,
+	struct sr_sessionfile_reader **reader)
+{
+	struct sr_sessionfile_reader *rd;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	char *capturefile;
+	int unitsize, ret;
+
+	if (!filename || !reader)
+		return SR_ERR_ARG;
+	*reader = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	rd = g_malloc0(sizeof(*rd));
+	rd->analog = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+	rd->summaries = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, stream_free);
+	if (!(rd->archive = zip_open(filename, 0, NULL))) {
+		sr_sessionfile_reader_close(rd);
+		return SR_ERR;
+	}
+
+	if (zip_stat(rd->archive, "metadata", 0, &zs) < 0) {
+		sr_sessionfile_reader_close(rd);
+		return SR_ERR_DATA;
+	}
+	kf = sr_sessionfile_read_metadata(rd->archive, &zs);
+	if (!kf) {
+		sr_sessionfile_reader_close(rd);
+		return SR_ERR_DATA;
+	}
+	capturefile = g_key_file_get_string(kf, "device 1", "capturefile", NULL);
+	unitsize = g_key_file_get_integer(kf, "device 1", "unitsize", NULL);
+
+	ret = reader_build_index(rd, kf, capturefile,
+		unitsize > 0 ? unitsize : 0);
+	g_key_file_free(kf);
+	g_free(capturefile);
+	if (ret != SR_OK) {
+		sr_sessionfile_reader_close(rd);
+		return ret;
+	}
+
+	*reader = rd;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file reader.
+ *
+ * @param reader The reader to close.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_close(struct sr_sessionfile_reader *reader)
+{
+	if (!reader)
+		return SR_ERR_ARG;
+
+	if (reader->archive)
+		zip_discard(reader->archive);
+	stream_free(reader->logic);
+	g_hash_table_destroy(reader->analog);
+	g_hash_table_destroy(reader->summaries);
+	g_free(reader->cache);
+	g_free(reader);
+
+	return SR_OK;
+}
+
+/* Make the given chunk of a stream the reader's cached chunk. */
+static int reader_load_chunk(struct sr_sessionfile_reader *reader,
+	const struct sessionfile_stream *stream, size_t chunk_idx)
+{
+	const struct sessionfile_chunk *chunk;
+	struct zip_file *zf;
+	zip_int64_t len;
+	size_t size;
+
+	if (reader->cache_stream == stream && reader->cache_chunk == chunk_idx)
+		return SR_OK;
+	reader->cache_stream = NULL;
+
+	chunk = &g_array_index(stream->chunks, struct sessionfile_chunk,
+		chunk_idx);
+	size = chunk->size;
+	if (size > reader->cache_size) {
+		g_free(reader->cache);
+		reader->cache_size = 0;
+		reader->cache = g_try_malloc(size);
+		if (!reader->cache)
+			return SR_ERR_MALLOC;
+		reader->cache_size = size;
+	}
+
+	zf = zip_fopen_index(reader->archive, chunk->index, 0);
+	if (!zf) {
+		sr_err("Failed to open chunk: %s",
+			zip_strerror(reader->archive));
+		return SR_ERR_DATA;
+	}
+	len = zip_fread(zf, reader->cache, size);
+	zip_fclose(zf);
+	if (len < 0 || (size_t)len != size) {
+		sr_err("Failed to read chunk.");
+		return SR_ERR_DATA;
+	}
+
+	reader->cache_stream = stream;
+	reader->cache_chunk = chunk_idx;
+
+	return SR_OK;
+}
+
+/*
+ * Count the samples in the runs of a logic stream's chunks. This needs
+ * to decompress all of them once, when the reader gets opened.
+ */
+static int stream_count_runs(struct sr_sessionfile_reader *reader,
+	struct sessionfile_stream *stream)
+{
+	struct sessionfile_chunk *chunk;
+	const uint8_t *rdptr, *end;
+	guint i;
+	int ret;
+
+	for (i = 0; i < stream->chunks->len; i++) {
+		chunk = &g_array_index(stream->chunks,
+			struct sessionfile_chunk, i);
+		chunk->num_samples = 0;
+		if (!chunk->size)
+			continue;
+		ret = reader_load_chunk(reader, stream, i);
+		if (ret != SR_OK)
+			return ret;
+		rdptr = reader->cache;
+		end = rdptr + chunk->size;
+		while (rdptr + stream->unitsize <= end) {
+			chunk->num_samples += read_u32le(rdptr);
+			rdptr += stream->unitsize;
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Expand a range of samples from the runs of the cached chunk. */
+static void stream_expand_runs(struct sr_sessionfile_reader *reader,
+	const struct sessionfile_stream *stream,
+	const struct sessionfile_chunk *chunk,
+	uint64_t offset, uint64_t count, uint8_t *buf)
+{
+	const uint8_t *rdptr, *end, *value;
+	size_t unitsize;
+	uint64_t run;
+
+	unitsize = stream_sample_size(stream);
+	rdptr = reader->cache;
+	end = rdptr + chunk->size;
+	while (count && rdptr + stream->unitsize <= end) {
+		run = read_u32le(rdptr);
+		value = rdptr + SR_SESSIONFILE_RUN_COUNT_SIZE;
+		rdptr += stream->unitsize;
+		if (offset >= run) {
+			offset -= run;
+			continue;
+		}
+		run = MIN(run - offset, count);
+		offset = 0;
+		count -= run;
+		while (run--) {
+			memcpy(buf, value, unitsize);
+			buf += unitsize;
+		}
+	}
+}
+
+/* Find the chunk which holds a sample, by binary search. */
+static size_t stream_find_chunk(const struct sessionfile_stream *stream,
+	uint64_t sample)
+{
+	const struct sessionfile_chunk *chunk;
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = stream->chunks->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		chunk = &g_array_index(stream->chunks,
+			struct sessionfile_chunk, mid);
+		if (chunk->first_sample <= sample)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int stream_read(struct sr_sessionfile_reader *reader,
+	const struct sessionfile_stream *stream, uint64_t start,
+	uint64_t count, uint8_t *buf, uint64_t *samples_read)
+{
+	const struct sessionfile_chunk *chunk;
+	size_t chunk_idx;
+	uint64_t offset, copy;
+	int ret;
+
+	*samples_read = 0;
+	if (start >= stream->num_samples || !count)
+		return SR_OK;
+	count = MIN(count, stream->num_samples - start);
+
+	chunk_idx = stream_find_chunk(stream, start);
+	while (count && chunk_idx < stream->chunks->len) {
+		chunk = &g_array_index(stream->chunks,
+			struct sessionfile_chunk, chunk_idx);
+		if (!chunk->num_samples) {
+			chunk_idx++;
+			continue;
+		}
+		ret = reader_load_chunk(reader, stream, chunk_idx);
+		if (ret != SR_OK)
+			return ret;
+		offset = start - chunk->first_sample;
+		copy = MIN(count, chunk->num_samples - offset);
+		if (stream->runs) {
+			stream_expand_runs(reader, stream, chunk,
+				offset, copy, buf);
+			buf += copy * stream_sample_size(stream);
+		} else {
+			memcpy(buf, reader->cache + offset * stream->unitsize,
+				copy * stream->unitsize);
+			buf += copy * stream->unitsize;
+		}
+		start += copy;
+		count -= copy;
+		*samples_read += copy;
+		chunk_idx++;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the extent of the logic data in a session file.
+ *
+ * @param reader The reader to use.
+ * @param num_samples Where to store the number of logic samples.
+ *                    Zero when the file has no logic data. May be NULL.
+ * @param unitsize Where to store the size of a sample in bytes.
+ *                 May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_logic_info(
+	struct sr_sessionfile_reader *reader,
+	uint64_t *num_samples, unsigned int *unitsize)
+{
+	if (!reader)
+		return SR_ERR_ARG;
+
+	if (num_samples)
+		*num_samples = reader->logic ? reader->logic->num_samples : 0;
+	if (unitsize)
+		*unitsize = reader->logic ? stream_sample_size(reader->logic) : 0;
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of logic samples from a session file.
+ *
+ * Only the chunks which hold the requested range get decompressed.
+ * The most recently used chunk is cached, so that reading adjacent
+ * ranges is cheap.
+ *
+ * @param reader The reader to use.
+ * @param start The number of the first sample to read.
+ * @param count The number of samples to read.
+ * @param buf Buffer with space for @a count samples of the unitsize
+ *            which sr_sessionfile_reader_logic_info() returns.
+ * @param samples_read Where to store the number of samples read. This
+ *                     is less than @a count at the end of the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no logic data.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_read_logic(
+	struct sr_sessionfile_reader *reader,
+	uint64_t start, uint64_t count, void *buf, uint64_t *samples_read)
+{
+	if (!reader || !buf || !samples_read)
+		return SR_ERR_ARG;
+	if (!reader->logic)
+		return SR_ERR_NA;
+
+	return stream_read(reader, reader->logic, start, count,
+		buf, samples_read);
+}
+
+/**
+ * Get the extent of an analog channel's data in a session file.
+ *
+ * @param reader The reader to use.
+ * @param channel The index of the analog channel, as in sr_channel.
+ * @param num_samples Where to store the number of samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no data for this channel.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_analog_info(
+	struct sr_sessionfile_reader *reader, int channel,
+	uint64_t *num_samples)
+{
+	const struct sessionfile_stream *stream;
+
+	if (!reader || !num_samples)
+		return SR_ERR_ARG;
+
+	stream = g_hash_table_lookup(reader->analog, GINT_TO_POINTER(channel));
+	if (!stream)
+		return SR_ERR_NA;
+	*num_samples = stream->num_samples;
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of an analog channel's samples from a session file.
+ *
+ * @param reader The reader to use.
+ * @param channel The index of the analog channel, as in sr_channel.
+ * @param start The number of the first sample to read.
+ * @param count The number of samples to read.
+ * @param buf Buffer with space for @a count values.
+ * @param samples_read Where to store the number of samples read. This
+ *                     is less than @a count at the end of the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no data for this channel.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_read_analog(
+	struct sr_sessionfile_reader *reader, int channel,
+	uint64_t start, uint64_t count, float *buf, uint64_t *samples_read)
+{
+	const struct sessionfile_stream *stream;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_meaning meaning;
+	GSList channels;
+	uint8_t *raw;
+	int ret;
+
+	if (!reader || !buf || !samples_read)
+		return SR_ERR_ARG;
+
+	stream = g_hash_table_lookup(reader->analog, GINT_TO_POINTER(channel));
+	if (!stream)
+		return SR_ERR_NA;
+
+	if (stream->encoding.is_float) {
+		return stream_read(reader, stream, start, count,
+			(uint8_t *)buf, samples_read);
+	}
+
+	/* Integer samples get converted with their scale and offset. */
+	count = MIN(count, stream->num_samples - MIN(start, stream->num_samples));
+	raw = g_try_malloc(MAX(count, 1) * stream->unitsize);
+	if (!raw)
+		return SR_ERR_MALLOC;
+	ret = stream_read(reader, stream, start, count, raw, samples_read);
+	if (ret == SR_OK && *samples_read) {
+		memset(&analog, 0, sizeof(analog));
+		memset(&meaning, 0, sizeof(meaning));
+		channels.data = NULL;
+		channels.next = NULL;
+		meaning.channels = &channels;
+		analog.data = raw;
+		analog.num_samples = *samples_read;
+		analog.encoding = (struct sr_analog_encoding *)&stream->encoding;
+		analog.meaning = &meaning;
+		ret = sr_analog_to_float(&analog, buf);
+	}
+	g_free(raw);
+
+	return ret;
+}
+
+/* Look up a summary level stream. Logic data has a negative channel. */
+static const struct sessionfile_stream *reader_summary(
+	struct sr_sessionfile_reader *reader, int channel, uint64_t factor)
+{
+	const struct sessionfile_stream *stream;
+	char *name;
+
+	if (channel < 0)
+		name = g_strdup_printf("summary-logic-1-%" PRIu64, factor);
+	else
+		name = g_strdup_printf("summary-analog-1-%d-%" PRIu64,
+			channel + 1, factor);
+	stream = g_hash_table_lookup(reader->summaries, name);
+	g_free(name);
+
+	return stream;
+}
+
+/**
+ * Get the extent of a summary level of the logic data in a session file.
+ *
+ * Session files which were written with the srzip output module's
+ * "summary" option hold summaries of the data at several resolutions.
+ * Each bin of a level covers @a factor samples, the last bin may cover
+ * fewer. Levels exist for the factors 64, 4096, and 262144.
+ *
+ * @param reader The reader to use.
+ * @param factor The number of samples per bin.
+ * @param num_bins Where to store the number of bins.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no such summary level.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_logic_summary_info(
+	struct sr_sessionfile_reader *reader, uint64_t factor,
+	uint64_t *num_bins)
+{
+	const struct sessionfile_stream *stream;
+
+	if (!reader || !num_bins)
+		return SR_ERR_ARG;
+
+	if (!(stream = reader_summary(reader, -1, factor)))
+		return SR_ERR_NA;
+	*num_bins = stream->num_samples;
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of bins of a logic data summary level.
+ *
+ * Each bin consists of two values of the logic data's unitsize: the
+ * AND of all samples in the bin, followed by the OR of all samples in
+ * the bin. A channel toggled within the bin when its bits differ.
+ *
+ * @param reader The reader to use.
+ * @param factor The number of samples per bin.
+ * @param start The number of the first bin to read.
+ * @param count The number of bins to read.
+ * @param buf Buffer with space for @a count bins.
+ * @param bins_read Where to store the number of bins read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no such summary level.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_read_logic_summary(
+	struct sr_sessionfile_reader *reader, uint64_t factor,
+	uint64_t start, uint64_t count, void *buf, uint64_t *bins_read)
+{
+	const struct sessionfile_stream *stream;
+
+	if (!reader || !buf || !bins_read)
+		return SR_ERR_ARG;
+
+	if (!(stream = reader_summary(reader, -1, factor)))
+		return SR_ERR_NA;
+
+	return stream_read(reader, stream, start, count, buf, bins_read);
+}
+
+/**
+ * Get the extent of a summary level of an analog channel.
+ *
+ * @param reader The reader to use.
+ * @param channel The index of the analog channel, as in sr_channel.
+ * @param factor The number of samples per bin.
+ * @param num_bins Where to store the number of bins.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no such summary level.
+ *
+ * @see sr_sessionfile_reader_logic_summary_info()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_analog_summary_info(
+	struct sr_sessionfile_reader *reader, int channel, uint64_t factor,
+	uint64_t *num_bins)
+{
+	const struct sessionfile_stream *stream;
+
+	if (!reader || channel < 0 || !num_bins)
+		return SR_ERR_ARG;
+
+	if (!(stream = reader_summary(reader, channel, factor)))
+		return SR_ERR_NA;
+	*num_bins = stream->num_samples;
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of bins of an analog channel's summary level.
+ *
+ * Each bin consists of two values: the minimum and the maximum of all
+ * samples in the bin.
+ *
+ * @param reader The reader to use.
+ * @param channel The index of the analog channel, as in sr_channel.
+ * @param factor The number of samples per bin.
+ * @param start The number of the first bin to read.
+ * @param count The number of bins to read.
+ * @param buf Buffer with space for 2 * @a count values.
+ * @param bins_read Where to store the number of bins read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no such summary level.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_sessionfile_reader_read_analog_summary(
+	struct sr_sessionfile_reader *reader, int channel, uint64_t factor,
+	uint64_t start, uint64_t count, float *buf, uint64_t *bins_read)
+{
+	const struct sessionfile_stream *stream;
+
+	if (!reader || channel < 0 || !buf || !bins_read)
+		return SR_ERR_ARG;
+
+	if (!(stream = reader_summary(reader, channel, factor)))
+		return SR_ERR_NA;
+
+	return stream_read(reader, stream, start, count,
+		(uint8_t *)buf, bins_read);
+}
+
 /** @} */
@@ -0,0 +1,297 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Latest frame delivery for live displays.
+ *
+ * Scope drivers send each waveform between SR_DF_FRAME_BEGIN and
+ * SR_DF_FRAME_END. A display which draws from a datafeed callback holds
+ * up the acquisition while it draws, although it only ever shows the
+ * newest frame. With the session's frame mailbox enabled, the packets
+ * of every complete frame get kept instead (see sr_packet_ref()), and
+ * replace the frame which the display did not take yet. The display
+ * takes frames from its own thread at its own pace, see
+ * sr_session_frame_take().
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-mailbox"
+/** @endcond */
+
+struct sr_frame_mailbox {
+	/* Packets of the frame in progress, most recent first. */
+	GSList *building;
+	gboolean in_frame;
+	GMutex mutex;
+	GCond cond;
+	/* The latest complete frame, in order. */
+	GSList *ready;
+	/* No more frames until the next SR_DF_HEADER. */
+	gboolean ended;
+	uint64_t frames;
+	uint64_t dropped;
+};
+
+/**
+ * Release the packets of a frame.
+ *
+ * @param packets The frame, see sr_session_frame_take(). May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_frame_free(GSList *packets)
+{
+	g_slist_free_full(packets, (GDestroyNotify)sr_packet_unref);
+}
+
+static void mailbox_free(struct sr_frame_mailbox *mb)
+{
+	sr_session_frame_free(mb->building);
+	sr_session_frame_free(mb->ready);
+	g_mutex_clear(&mb->mutex);
+	g_cond_clear(&mb->cond);
+	g_free(mb);
+}
+
+/**
+ * Enable or disable the session's frame mailbox.
+ *
+ * While enabled, the latest complete frame of the datafeed is kept for
+ * sr_session_frame_take(). Frames which get replaced before they were
+ * taken are counted, see sr_session_frame_stats_get(). The datafeed
+ * callbacks receive all of the packets as before. This can only be done
+ * while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to keep the latest frame, FALSE to stop doing so.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_frame_mailbox_set(struct sr_session *session,
+		gboolean enable)
+{
+	struct sr_frame_mailbox *mb;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the frame mailbox of a running session.");
+		return SR_ERR;
+	}
+
+	if (!enable) {
+		sr_session_frame_mailbox_free(session);
+		return SR_OK;
+	}
+	if (session->frame_mailbox)
+		return SR_OK;
+
+	mb = g_malloc0(sizeof(*mb));
+	g_mutex_init(&mb->mutex);
+	g_cond_init(&mb->cond);
+	session->frame_mailbox = mb;
+
+	return SR_OK;
+}
+
+/**
+ * Take the latest complete frame of the session.
+ *
+ * The frame's packets are returned in order, starting with its
+ * SR_DF_FRAME_BEGIN and ending with its SR_DF_FRAME_END packet. Each
+ * frame gets returned once. This may be called from any thread.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param packets The frame's packets, release them with
+ *                sr_session_frame_free(). Must not be NULL.
+ * @param timeout_us How long to wait for a frame, in microseconds. 0 to
+ *                   return right away.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the mailbox is not enabled.
+ * @retval SR_ERR_TIMEOUT No frame completed within the timeout.
+ * @retval SR_ERR_NA The acquisition ended, and all frames were taken.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_frame_take(struct sr_session *session,
+		GSList **packets, gint64 timeout_us)
+{
+	struct sr_frame_mailbox *mb;
+	gint64 end_time;
+	int ret;
+
+	if (!session || !packets || !session->frame_mailbox) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	mb = session->frame_mailbox;
+
+	end_time = g_get_monotonic_time() + MAX(timeout_us, 0);
+	g_mutex_lock(&mb->mutex);
+	while (!mb->ready && !mb->ended) {
+		if (!g_cond_wait_until(&mb->cond, &mb->mutex, end_time))
+			break;
+	}
+	*packets = mb->ready;
+	mb->ready = NULL;
+	if (*packets)
+		ret = SR_OK;
+	else
+		ret = mb->ended ? SR_ERR_NA : SR_ERR_TIMEOUT;
+	g_mutex_unlock(&mb->mutex);
+
+	return ret;
+}
+
+/**
+ * Get the frame counters of the session's frame mailbox.
+ *
+ * The counters get reset with every SR_DF_HEADER of the datafeed.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param frames The number of complete frames. May be NULL.
+ * @param dropped The number of frames which were replaced before they
+ *                were taken. May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session, or the mailbox is not enabled.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_frame_stats_get(struct sr_session *session,
+		uint64_t *frames, uint64_t *dropped)
+{
+	struct sr_frame_mailbox *mb;
+
+	if (!session || !session->frame_mailbox) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	mb = session->frame_mailbox;
+
+	g_mutex_lock(&mb->mutex);
+	if (frames)
+		*frames = mb->frames;
+	if (dropped)
+		*dropped = mb->dropped;
+	g_mutex_unlock(&mb->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Pass a datafeed packet to the session's frame mailbox.
+ *
+ * @param session The session to use.
+ * @param packet The datafeed packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_frame_mailbox_push(struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_frame_mailbox *mb;
+	struct sr_datafeed_packet *ref;
+	GSList *replaced;
+
+	mb = session->frame_mailbox;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		g_mutex_lock(&mb->mutex);
+		mb->ended = FALSE;
+		mb->frames = 0;
+		mb->dropped = 0;
+		g_mutex_unlock(&mb->mutex);
+		return;
+	case SR_DF_END:
+		sr_session_frame_free(mb->building);
+		mb->building = NULL;
+		mb->in_frame = FALSE;
+		g_mutex_lock(&mb->mutex);
+		mb->ended = TRUE;
+		g_cond_broadcast(&mb->cond);
+		g_mutex_unlock(&mb->mutex);
+		return;
+	case SR_DF_FRAME_BEGIN:
+		/* A frame without its end gets discarded. */
+		sr_session_frame_free(mb->building);
+		mb->building = NULL;
+		mb->in_frame = TRUE;
+		break;
+	default:
+		if (!mb->in_frame)
+			return;
+		break;
+	}
+
+	ref = sr_packet_ref(packet);
+	if (!ref) {
+		sr_err("Cannot reference the packet for the frame mailbox.");
+		sr_session_frame_free(mb->building);
+		mb->building = NULL;
+		mb->in_frame = FALSE;
+		return;
+	}
+	mb->building = g_slist_prepend(mb->building, ref);
+	if (packet->type != SR_DF_FRAME_END)
+		return;
+
+	g_mutex_lock(&mb->mutex);
+	replaced = mb->ready;
+	mb->ready = g_slist_reverse(mb->building);
+	mb->frames++;
+	if (replaced)
+		mb->dropped++;
+	g_cond_broadcast(&mb->cond);
+	g_mutex_unlock(&mb->mutex);
+	mb->building = NULL;
+	mb->in_frame = FALSE;
+
+	sr_session_frame_free(replaced);
+}
+
+/**
+ * Release the session's frame mailbox, and the frames it holds.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_frame_mailbox_free(struct sr_session *session)
+{
+	if (!session->frame_mailbox)
+		return;
+
+	mailbox_free(session->frame_mailbox);
+	session->frame_mailbox = NULL;
+}
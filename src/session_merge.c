@@ -0,0 +1,625 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Sample clocks of the session's devices, and time ordered delivery.
+ *
+ * Each device which sends packets gets a clock model: the start time of
+ * its acquisition (from SR_DF_HEADER), its samplerate (from SR_DF_META,
+ * or the device configuration), a drift correction which the application
+ * may set, and the number of samples received or lost. That puts a time
+ * and a sample index (see sr_packet_info_get()) on every packet. Devices
+ * without a samplerate, like most multimeters, get their packets timed
+ * on arrival.
+ *
+ * When merging is enabled, packets get held back per device, and are
+ * delivered in time order across all devices. A packet is passed on when
+ * every other device either has data pending which is later, or has
+ * progressed past the packet's time. The byte budget bounds what gets
+ * held back; when it is exceeded, the earliest packets are passed on
+ * regardless, e.g. while a device waits for its trigger.
+ *
+ * Packets arrive here from a single thread only (the session's event
+ * processing, or the last transform pipeline stage). The clock models are
+ * read by the application as well, so they are guarded by a mutex.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-merge"
+/** @endcond */
+
+struct merge_item {
+	struct sr_datafeed_packet *packet;
+	int64_t time_ns;
+	size_t bytes;
+};
+
+struct dev_clock {
+	const struct sr_dev_inst *sdi;
+	/* Whether SR_DF_HEADER, or SR_DF_END was seen in the current run. */
+	gboolean started;
+	gboolean ended;
+	int64_t start_ns;
+	uint64_t samplerate;
+	double drift_ppm;
+	uint64_t num_samples;
+	/* Whether logic data advances the clock, rather than analog data. */
+	gboolean has_logic;
+	/* The analog channel which advances the clock otherwise. */
+	struct sr_channel *ref_channel;
+	/* Time and index of the reference channel's most recent data. */
+	int64_t span_ns;
+	uint64_t span_sample;
+	/* Wall clock time of SR_DF_HEADER, for the observed drift. */
+	int64_t wall_start_us;
+	/* Packets which are held back, struct merge_item. */
+	GQueue pending;
+};
+
+struct sr_session_merge {
+	/* struct sr_dev_inst -> struct dev_clock */
+	GHashTable *clocks;
+	/* Payload bytes of held back packets. */
+	size_t bytes;
+};
+
+static void dev_clock_free(void *data)
+{
+	struct dev_clock *clock;
+	struct merge_item *item;
+
+	clock = data;
+	while ((item = g_queue_pop_head(&clock->pending))) {
+		sr_packet_unref(item->packet);
+		g_free(item);
+	}
+	g_free(clock);
+}
+
+static struct sr_session_merge *merge_get(struct sr_session *session)
+{
+	struct sr_session_merge *merge;
+
+	merge = session->merge;
+	if (!merge) {
+		merge = g_malloc0(sizeof(*merge));
+		merge->clocks = g_hash_table_new_full(NULL, NULL, NULL,
+			dev_clock_free);
+		session->merge = merge;
+	}
+
+	return merge;
+}
+
+static struct dev_clock *clock_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_session_merge *merge;
+	struct dev_clock *clock;
+
+	merge = merge_get(session);
+	clock = g_hash_table_lookup(merge->clocks, sdi);
+	if (!clock) {
+		clock = g_malloc0(sizeof(*clock));
+		clock->sdi = sdi;
+		g_queue_init(&clock->pending);
+		g_hash_table_insert(merge->clocks, (void *)sdi, clock);
+	}
+
+	return clock;
+}
+
+/* Time of the clock's current sample position. */
+static int64_t clock_time(const struct dev_clock *clock)
+{
+	double rate;
+
+	if (!clock->samplerate)
+		return g_get_real_time() * 1000;
+
+	rate = clock->samplerate * (1.0 + clock->drift_ppm * 1e-6);
+
+	return clock->start_ns + (int64_t)(clock->num_samples * 1e9 / rate);
+}
+
+/* The time up to which all of the device's packets have arrived. */
+static int64_t clock_horizon(const struct dev_clock *clock)
+{
+	if (!clock || !clock->started)
+		return INT64_MIN;
+	if (clock->ended)
+		return INT64_MAX;
+
+	return clock_time(clock);
+}
+
+static void clock_start(struct dev_clock *clock,
+		const struct sr_datafeed_header *header)
+{
+	struct sr_dev_inst *sdi;
+	GVariant *gvar;
+
+	clock->started = TRUE;
+	clock->ended = FALSE;
+	clock->start_ns = (int64_t)header->starttime.tv_sec * 1000000000
+		+ (int64_t)header->starttime.tv_usec * 1000;
+	clock->num_samples = 0;
+	clock->has_logic = FALSE;
+	clock->ref_channel = NULL;
+	clock->span_ns = clock->start_ns;
+	clock->span_sample = 0;
+	clock->wall_start_us = g_get_real_time();
+
+	/* Drivers don't all announce their samplerate in the datafeed. */
+	clock->samplerate = 0;
+	sdi = (struct sr_dev_inst *)clock->sdi;
+	if (sdi->driver && sr_config_get(sdi->driver, sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		clock->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+}
+
+static uint64_t rle_samples(const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t i, count;
+
+	count = 0;
+	for (i = 0; i < rle->num_runs; i++)
+		count += rle->run_lengths[i];
+
+	return count;
+}
+
+/*
+ * Advance the clock by a packet, returns the packet's time. Lost samples
+ * before the packet advance the clock as well.
+ */
+static int64_t clock_packet(struct dev_clock *clock,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	struct sr_channel *ch;
+	uint64_t num_samples;
+	int64_t time_ns;
+	GSList *l;
+
+	if (packet->type == SR_DF_HEADER) {
+		clock_start(clock, packet->payload);
+		info->first_sample = 0;
+		return clock->start_ns;
+	}
+
+	/* Only packets which advance the clock can follow a gap. */
+	if (info->dropped_samples && (packet->type == SR_DF_LOGIC ||
+			packet->type == SR_DF_LOGIC_RLE ||
+			packet->type == SR_DF_LOGIC_PLANAR ||
+			(packet->type == SR_DF_ANALOG && !clock->has_logic)))
+		clock->num_samples += info->dropped_samples;
+	time_ns = clock_time(clock);
+	info->first_sample = clock->num_samples;
+	num_samples = 0;
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				clock->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		clock->has_logic = TRUE;
+		if (logic->unitsize)
+			num_samples = logic->length / logic->unitsize;
+		break;
+	case SR_DF_LOGIC_RLE:
+		clock->has_logic = TRUE;
+		num_samples = rle_samples(packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		clock->has_logic = TRUE;
+		num_samples = planar->num_samples;
+		break;
+	case SR_DF_ANALOG:
+		/*
+		 * The channels of a device cover the same time span, in
+		 * packets of their own or in one packet. Only logic data, or
+		 * the first analog channel seen, advance the clock.
+		 */
+		if (clock->has_logic)
+			break;
+		analog = packet->payload;
+		ch = analog->meaning->channels ?
+			analog->meaning->channels->data : NULL;
+		if (!clock->ref_channel)
+			clock->ref_channel = ch;
+		if (ch == clock->ref_channel) {
+			clock->span_ns = time_ns;
+			clock->span_sample = clock->num_samples;
+			num_samples = analog->num_samples;
+		} else {
+			info->first_sample = clock->span_sample;
+			if (clock->samplerate)
+				time_ns = clock->span_ns;
+		}
+		break;
+	case SR_DF_END:
+		clock->ended = TRUE;
+		break;
+	}
+	clock->num_samples += num_samples;
+
+	return time_ns;
+}
+
+static size_t packet_bytes(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_analog *analog;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		return rle->num_runs * (rle->unitsize + sizeof(uint64_t));
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		return (planar->num_samples + 7) / 8 * planar->unitsize * 8;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (size_t)analog->num_samples * analog->encoding->unitsize;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Update the sample clock of a device by a packet it sent.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ * @param info The packet's metadata. The number of lost samples is read,
+ *             the index of the first sample gets filled in.
+ *
+ * @return The time of the packet, in nanoseconds since the epoch.
+ *
+ * @private
+ */
+SR_PRIV int64_t sr_session_clock_packet(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet_info *info)
+{
+	struct dev_clock *clock;
+	int64_t time_ns;
+
+	g_mutex_lock(&session->merge_mutex);
+	clock = clock_get(session, sdi);
+	time_ns = clock_packet(clock, packet, info);
+	g_mutex_unlock(&session->merge_mutex);
+
+	return time_ns;
+}
+
+/**
+ * Forget the state of the device clocks' previous runs.
+ *
+ * Drift corrections are kept.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_clock_reset(struct sr_session *session)
+{
+	GHashTableIter iter;
+	struct dev_clock *clock;
+
+	g_mutex_lock(&session->merge_mutex);
+	if (session->merge) {
+		g_hash_table_iter_init(&iter, session->merge->clocks);
+		while (g_hash_table_iter_next(&iter, NULL, (void **)&clock)) {
+			clock->started = FALSE;
+			clock->ended = FALSE;
+		}
+	}
+	g_mutex_unlock(&session->merge_mutex);
+}
+
+/* The clock which holds the earliest packet, or NULL. */
+static struct dev_clock *earliest_pending(struct sr_session_merge *merge)
+{
+	GHashTableIter iter;
+	struct dev_clock *clock, *earliest;
+	struct merge_item *item, *first;
+
+	earliest = NULL;
+	first = NULL;
+	g_hash_table_iter_init(&iter, merge->clocks);
+	while (g_hash_table_iter_next(&iter, NULL, (void **)&clock)) {
+		item = g_queue_peek_head(&clock->pending);
+		if (item && (!first || item->time_ns < first->time_ns)) {
+			earliest = clock;
+			first = item;
+		}
+	}
+
+	return earliest;
+}
+
+/* Whether no device can send a packet before the given time anymore. */
+static gboolean all_past(struct sr_session *session, int64_t time_ns)
+{
+	struct dev_clock *clock;
+	GSList *l;
+
+	for (l = session->devs; l; l = l->next) {
+		clock = g_hash_table_lookup(session->merge->clocks, l->data);
+		if (clock && !g_queue_is_empty(&clock->pending))
+			continue;
+		if (clock_horizon(clock) < time_ns)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Pass on held back packets, all of them when @a force is set. */
+static int merge_release(struct sr_session *session, gboolean force)
+{
+	struct sr_session_merge *merge;
+	struct dev_clock *clock;
+	struct merge_item *item;
+	int ret;
+
+	merge = session->merge;
+	ret = SR_OK;
+	while (TRUE) {
+		g_mutex_lock(&session->merge_mutex);
+		clock = earliest_pending(merge);
+		item = clock ? g_queue_peek_head(&clock->pending) : NULL;
+		if (item && !force && merge->bytes <= session->merge_bytes &&
+				!all_past(session, item->time_ns))
+			item = NULL;
+		if (item) {
+			g_queue_pop_head(&clock->pending);
+			merge->bytes -= item->bytes;
+		}
+		g_mutex_unlock(&session->merge_mutex);
+		if (!item)
+			break;
+
+		if (sr_session_deliver_merged(session, clock->sdi,
+				item->packet) != SR_OK)
+			ret = SR_ERR;
+		sr_packet_unref(item->packet);
+		g_free(item);
+	}
+
+	return ret;
+}
+
+/**
+ * Hold back a packet for time ordered delivery.
+ *
+ * @param session The session to use. Merging must be enabled.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ * @param time_ns The packet's time, see sr_session_clock_packet().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR A packet could not be delivered.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_merge_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int64_t time_ns)
+{
+	struct dev_clock *clock;
+	struct merge_item *item;
+	struct sr_datafeed_packet *ref;
+
+	ref = sr_packet_ref(packet);
+	if (!ref)
+		return SR_ERR_MALLOC;
+
+	item = g_malloc0(sizeof(*item));
+	item->packet = ref;
+	item->time_ns = time_ns;
+	item->bytes = packet_bytes(packet);
+
+	g_mutex_lock(&session->merge_mutex);
+	clock = clock_get(session, sdi);
+	g_queue_push_tail(&clock->pending, item);
+	session->merge->bytes += item->bytes;
+	g_mutex_unlock(&session->merge_mutex);
+
+	return merge_release(session, FALSE);
+}
+
+/**
+ * Pass on all packets which are held back, in time order.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_merge_stop(struct sr_session *session)
+{
+	if (session->merge)
+		merge_release(session, TRUE);
+}
+
+/**
+ * Release the device clocks of a session.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_merge_free(struct sr_session *session)
+{
+	if (!session->merge)
+		return;
+
+	g_hash_table_unref(session->merge->clocks);
+	g_free(session->merge);
+	session->merge = NULL;
+}
+
+/**
+ * Deliver the packets of all devices of a session in time order.
+ *
+ * With a non-zero @a max_bytes, packets get held back until no other
+ * device of the session can send earlier data anymore, see
+ * sr_session_dev_clock_get() for how packets are timed. This gives the
+ * datafeed callbacks correlated data of several devices. Up to
+ * @a max_bytes of sample data are held back, when more arrives, the
+ * earliest packets are delivered regardless of the other devices.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes Budget of held back sample data. 0 disables merging.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_merge_set(struct sr_session *session,
+		size_t max_bytes)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change datafeed merging of a running session.");
+		return SR_ERR;
+	}
+
+	session->merge_bytes = max_bytes;
+
+	return SR_OK;
+}
+
+/**
+ * Get the sample clock model of a device in a session.
+ *
+ * Sample n of the current (or most recent) acquisition of the device
+ * was taken at start_ns + n * 10^9 / (samplerate * (1 + drift_ppm / 10^6))
+ * nanoseconds since the epoch. For devices with both logic and analog
+ * channels, samples are counted in the logic data. Devices without a
+ * samplerate have their packets timed on arrival.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device instance. Must not be NULL.
+ * @param clock The clock model gets stored here. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device did not start an acquisition yet.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_dev_clock_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_dev_clock *clock)
+{
+	struct dev_clock *dclock;
+	int64_t wall_us;
+	double nominal_us;
+	int ret;
+
+	if (!session || !sdi || !clock)
+		return SR_ERR_ARG;
+
+	ret = SR_ERR_NA;
+	g_mutex_lock(&session->merge_mutex);
+	dclock = session->merge ?
+		g_hash_table_lookup(session->merge->clocks, sdi) : NULL;
+	if (dclock && (dclock->started || dclock->ended)) {
+		clock->start_ns = dclock->start_ns;
+		clock->samplerate = dclock->samplerate;
+		clock->drift_ppm = dclock->drift_ppm;
+		clock->num_samples = dclock->num_samples;
+		clock->observed_drift_ppm = 0;
+		wall_us = g_get_real_time() - dclock->wall_start_us;
+		if (dclock->samplerate && wall_us > 0 && !dclock->ended) {
+			nominal_us = dclock->num_samples * 1e6 / dclock->samplerate;
+			clock->observed_drift_ppm = (nominal_us / wall_us - 1) * 1e6;
+		}
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->merge_mutex);
+
+	return ret;
+}
+
+/**
+ * Set the clock error of a device in a session.
+ *
+ * The correction is applied to the device's samplerate when timing its
+ * packets, and is kept across acquisitions. It typically gets measured
+ * by capturing a common reference signal with all devices.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device instance. Must not be NULL.
+ * @param drift_ppm How much faster the device's sample clock runs than
+ *                  nominal, in parts per million.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_dev_clock_drift_set(struct sr_session *session,
+		const struct sr_dev_inst *sdi, double drift_ppm)
+{
+	if (!session || !sdi || drift_ppm <= -1e6)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->merge_mutex);
+	clock_get(session, sdi)->drift_ppm = drift_ppm;
+	g_mutex_unlock(&session->merge_mutex);
+
+	return SR_OK;
+}
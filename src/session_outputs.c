@@ -0,0 +1,262 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Output modules which a session runs on worker threads.
+ *
+ * Frontends which write the datafeed to several outputs (an archive, a
+ * log, a display) would call them one after another from their datafeed
+ * callback, the costs of the outputs then add up on the acquisition
+ * path. Outputs registered with the session run on a thread each
+ * instead. Every packet gets referenced once (see sr_packet_ref()) and
+ * shared by all of the workers, which release it when they are done.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-outputs"
+/** @endcond */
+
+/* Maximum number of packets which an output's worker has queued. */
+#define OUTPUT_QUEUE_DEPTH 64
+
+struct output_worker {
+	struct sr_session *session;
+	const struct sr_output *output;
+	/* Where the output gets written, -1 for modules doing their own I/O. */
+	int fd;
+	GAsyncQueue *queue;
+	GThread *thread;
+	/* Limits the number of queued packets. */
+	GMutex mutex;
+	GCond cond;
+	unsigned int in_flight;
+	/* The first error of the output, later packets get dropped. */
+	int error;
+};
+
+/* Queued in place of a packet, tells the worker to terminate. */
+static struct sr_datafeed_packet stop_marker;
+
+static int worker_send(struct output_worker *worker,
+		const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+	int ret;
+
+	if (worker->fd >= 0)
+		return sr_output_send_fd(worker->output, packet, worker->fd);
+
+	out = NULL;
+	ret = sr_output_send(worker->output, packet, &out);
+	if (out)
+		g_string_free(out, TRUE);
+
+	return ret;
+}
+
+static gpointer worker_thread(gpointer data)
+{
+	struct output_worker *worker;
+	struct sr_datafeed_packet *packet;
+	int ret;
+
+	worker = data;
+	sr_thread_sched_apply(worker->session, SR_THREAD_OUTPUT, 0);
+	while ((packet = g_async_queue_pop(worker->queue)) != &stop_marker) {
+		if (worker->error == SR_OK) {
+			ret = worker_send(worker, packet);
+			if (ret < 0) {
+				sr_err("Output module '%s' failed: %d.",
+					worker->output->module->id, ret);
+				worker->error = ret;
+			}
+		}
+		sr_packet_unref(packet);
+
+		g_mutex_lock(&worker->mutex);
+		worker->in_flight--;
+		g_cond_signal(&worker->cond);
+		g_mutex_unlock(&worker->mutex);
+	}
+
+	return NULL;
+}
+
+static void worker_free(struct output_worker *worker)
+{
+	g_async_queue_unref(worker->queue);
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker);
+}
+
+/**
+ * Run an output module on a worker thread of the session.
+ *
+ * All the packets which reach the session's datafeed callbacks get
+ * passed to the output as well, in order, on a thread of its own. The
+ * output's text gets written to @a fd (see sr_output_send_fd()). Output
+ * modules which do their own I/O (SR_OUTPUT_INTERNAL_IO_HANDLING) take
+ * a negative @a fd. The datafeed blocks while the output lags behind by
+ * more than a few dozen packets.
+ *
+ * The output must not be used otherwise until it was removed again, see
+ * sr_session_outputs_remove_all(). This can only be done while the
+ * session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param o The output instance. Must not be NULL.
+ * @param fd The file descriptor to write the output to, or -1.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running, or thread creation failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_output_add(struct sr_session *session,
+		const struct sr_output *o, int fd)
+{
+	struct output_worker *worker;
+	GError *error;
+
+	if (!session || !o) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot add outputs to a running session.");
+		return SR_ERR;
+	}
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->session = session;
+	worker->output = o;
+	worker->fd = fd;
+	worker->queue = g_async_queue_new();
+	g_mutex_init(&worker->mutex);
+	g_cond_init(&worker->cond);
+
+	error = NULL;
+	worker->thread = g_thread_try_new("sr-output", worker_thread,
+		worker, &error);
+	if (!worker->thread) {
+		sr_err("Cannot create output thread: %s.", error->message);
+		g_error_free(error);
+		worker_free(worker);
+		return SR_ERR;
+	}
+	session->outputs = g_slist_append(session->outputs, worker);
+
+	return SR_OK;
+}
+
+/**
+ * Remove the outputs which run on worker threads of the session.
+ *
+ * The packets which were passed to the outputs get processed before
+ * this routine returns, so frontends call it before finishing the
+ * outputs' files or freeing the outputs. This can only be done while
+ * the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ * @retval other The first error of one of the outputs.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_outputs_remove_all(struct sr_session *session)
+{
+	struct output_worker *worker;
+	GSList *l;
+	int ret;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running && session->outputs) {
+		sr_err("Cannot remove outputs from a running session.");
+		return SR_ERR;
+	}
+
+	for (l = session->outputs; l; l = l->next) {
+		worker = l->data;
+		g_async_queue_push(worker->queue, &stop_marker);
+	}
+	ret = SR_OK;
+	for (l = session->outputs; l; l = l->next) {
+		worker = l->data;
+		g_thread_join(worker->thread);
+		if (ret == SR_OK)
+			ret = worker->error;
+		worker_free(worker);
+	}
+	g_slist_free(session->outputs);
+	session->outputs = NULL;
+
+	return ret;
+}
+
+/**
+ * Pass a packet to the outputs which run on worker threads.
+ *
+ * Blocks while one of the outputs has the maximum number of packets
+ * queued.
+ *
+ * @param session The session to use.
+ * @param packet The datafeed packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_outputs_push(struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	struct output_worker *worker;
+	struct sr_datafeed_packet *ref;
+	GSList *l;
+
+	/* One shared copy (or reference) for all of the outputs. */
+	ref = sr_packet_ref(packet);
+	if (!ref) {
+		sr_err("Cannot reference the packet for the outputs.");
+		return;
+	}
+
+	for (l = session->outputs; l; l = l->next) {
+		worker = l->data;
+		g_mutex_lock(&worker->mutex);
+		while (worker->in_flight >= OUTPUT_QUEUE_DEPTH)
+			g_cond_wait(&worker->cond, &worker->mutex);
+		worker->in_flight++;
+		g_mutex_unlock(&worker->mutex);
+		g_async_queue_push(worker->queue, sr_packet_ref(ref));
+	}
+	sr_packet_unref(ref);
+}
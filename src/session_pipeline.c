@@ -0,0 +1,375 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Pipelined execution of a session's transform modules.
+ *
+ * Each transform module of the session runs on a worker thread of its
+ * own, with packet queues between the stages. While one stage processes
+ * a packet, the previous stage can already work on the next one, so a
+ * chain of transforms spreads across multiple cores instead of running
+ * serially inside the driver's event handling.
+ *
+ * Packets enter the pipeline by reference (see sr_packet_ref()), stay in
+ * order, and leave it at the last stage which hands them to the datafeed
+ * callbacks (or the delivery ring, if one is configured).
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-pipeline"
+/** @endcond */
+
+struct pipeline_item {
+	const struct sr_dev_inst *sdi;
+	/* NULL tells the stage to terminate (after forwarding). */
+	struct sr_datafeed_packet *packet;
+};
+
+struct pipeline_stage {
+	struct sr_session_pipeline *pipeline;
+	struct sr_transform *transform;
+	GAsyncQueue *queue;
+	/* Next stage, or NULL if this stage delivers to the callbacks. */
+	struct pipeline_stage *next;
+	GThread *thread;
+};
+
+struct sr_session_pipeline {
+	struct sr_session *session;
+	GSList *stages;
+	struct pipeline_stage *first;
+
+	/* Limits the number of packets in the pipeline. */
+	GMutex mutex;
+	GCond cond;
+	unsigned int in_flight;
+	unsigned int max_in_flight;
+};
+
+static void pipeline_item_done(struct sr_session_pipeline *pipeline)
+{
+	g_mutex_lock(&pipeline->mutex);
+	pipeline->in_flight--;
+	g_cond_signal(&pipeline->cond);
+	g_mutex_unlock(&pipeline->mutex);
+}
+
+static void stage_forward(struct pipeline_stage *stage,
+		struct pipeline_item *item)
+{
+	if (stage->next) {
+		g_async_queue_push(stage->next->queue, item);
+		return;
+	}
+
+	if (item->packet) {
+		sr_session_deliver(stage->pipeline->session, item->sdi,
+				item->packet);
+		sr_packet_unref(item->packet);
+		pipeline_item_done(stage->pipeline);
+	}
+	g_free(item);
+}
+
+static gpointer stage_thread(gpointer data)
+{
+	struct pipeline_stage *stage;
+	struct pipeline_item *item;
+	struct sr_transform *t;
+	struct sr_datafeed_packet *packet_out, *ref;
+	gboolean done;
+	gint64 start;
+	int ret;
+
+	stage = data;
+	t = stage->transform;
+	sr_thread_sched_apply(stage->pipeline->session, SR_THREAD_TRANSFORM, 0);
+	do {
+		item = g_async_queue_pop(stage->queue);
+		done = !item->packet;
+		if (done) {
+			stage_forward(stage, item);
+			break;
+		}
+
+		/* Drop data after a fast stop, don't transform it. */
+		if (sr_session_discards(stage->pipeline->session, item->packet)) {
+			sr_packet_unref(item->packet);
+			pipeline_item_done(stage->pipeline);
+			g_free(item);
+			continue;
+		}
+
+		sr_spew("Running transform module '%s'.", t->module->id);
+		SR_PROBE3(transform__entry, t->module->id, item->packet->type,
+			sr_packet_payload_bytes(item->packet));
+		packet_out = NULL;
+		if (stage->pipeline->session->stats_enabled) {
+			start = g_get_monotonic_time();
+			ret = t->module->receive(t, item->packet, &packet_out);
+			sr_datafeed_timing_add(&t->timing,
+				g_get_monotonic_time() - start);
+		} else {
+			ret = t->module->receive(t, item->packet, &packet_out);
+		}
+		SR_PROBE2(transform__return, t->module->id, ret);
+		if (ret < 0)
+			sr_err("Error while running transform module: %d.", ret);
+
+		if (ret < 0 || !packet_out) {
+			sr_packet_unref(item->packet);
+			pipeline_item_done(stage->pipeline);
+			g_free(item);
+			continue;
+		}
+
+		if (packet_out != item->packet) {
+			/* The transform's output need not outlive the call. */
+			ref = sr_packet_ref(packet_out);
+			sr_packet_unref(item->packet);
+			if (!ref) {
+				pipeline_item_done(stage->pipeline);
+				g_free(item);
+				continue;
+			}
+			item->packet = ref;
+		}
+		stage_forward(stage, item);
+	} while (!done);
+
+	return NULL;
+}
+
+static void pipeline_free(struct sr_session_pipeline *pipeline)
+{
+	GSList *l;
+	struct pipeline_stage *stage;
+
+	for (l = pipeline->stages; l; l = l->next) {
+		stage = l->data;
+		g_async_queue_unref(stage->queue);
+		g_free(stage);
+	}
+	g_slist_free(pipeline->stages);
+	g_mutex_clear(&pipeline->mutex);
+	g_cond_clear(&pipeline->cond);
+	g_free(pipeline);
+}
+
+/**
+ * Start the transform pipeline of a session.
+ *
+ * Does nothing if the session has no transforms.
+ *
+ * @param session The session to start the pipeline for.
+ * @param depth Maximum number of packets in the pipeline.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Thread creation failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_pipeline_start(struct sr_session *session,
+		unsigned int depth)
+{
+	struct sr_session_pipeline *pipeline;
+	struct pipeline_stage *stage, *prev;
+	struct pipeline_item *item;
+	GSList *l;
+	GError *error;
+
+	if (!session->transforms)
+		return SR_OK;
+
+	pipeline = g_malloc0(sizeof(*pipeline));
+	pipeline->session = session;
+	pipeline->max_in_flight = depth;
+	g_mutex_init(&pipeline->mutex);
+	g_cond_init(&pipeline->cond);
+
+	prev = NULL;
+	for (l = session->transforms; l; l = l->next) {
+		stage = g_malloc0(sizeof(*stage));
+		stage->pipeline = pipeline;
+		stage->transform = l->data;
+		stage->queue = g_async_queue_new();
+		if (prev)
+			prev->next = stage;
+		else
+			pipeline->first = stage;
+		pipeline->stages = g_slist_append(pipeline->stages, stage);
+		prev = stage;
+	}
+
+	for (l = pipeline->stages; l; l = l->next) {
+		stage = l->data;
+		error = NULL;
+		stage->thread = g_thread_try_new("sr-transform",
+				stage_thread, stage, &error);
+		if (stage->thread)
+			continue;
+
+		sr_err("Cannot create transform thread: %s.", error->message);
+		g_error_free(error);
+		/* Terminate the stages which did start. */
+		if (l != pipeline->stages) {
+			item = g_malloc0(sizeof(*item));
+			g_async_queue_push(pipeline->first->queue, item);
+		}
+		for (l = pipeline->stages; l; l = l->next) {
+			stage = l->data;
+			if (!stage->thread) {
+				/* Swallow the terminator in place of the stage. */
+				g_free(g_async_queue_try_pop(stage->queue));
+				break;
+			}
+			g_thread_join(stage->thread);
+		}
+		pipeline_free(pipeline);
+		return SR_ERR;
+	}
+	sr_dbg("Running %u transform(s) in a pipeline.",
+		g_slist_length(pipeline->stages));
+
+	session->pipeline = pipeline;
+
+	return SR_OK;
+}
+
+/**
+ * Drain and stop the transform pipeline of a session.
+ *
+ * All packets which are still in the pipeline get processed and delivered
+ * before this routine returns.
+ *
+ * @param session The session to stop the pipeline for.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_pipeline_stop(struct sr_session *session)
+{
+	struct sr_session_pipeline *pipeline;
+	struct pipeline_stage *stage;
+	struct pipeline_item *item;
+	GSList *l;
+
+	pipeline = session->pipeline;
+	if (!pipeline)
+		return;
+
+	item = g_malloc0(sizeof(*item));
+	g_async_queue_push(pipeline->first->queue, item);
+	for (l = pipeline->stages; l; l = l->next) {
+		stage = l->data;
+		g_thread_join(stage->thread);
+	}
+
+	session->pipeline = NULL;
+	pipeline_free(pipeline);
+}
+
+/**
+ * Feed a packet into the transform pipeline of a session.
+ *
+ * Blocks while the pipeline holds the maximum number of packets.
+ *
+ * @param session The session to use. Its pipeline must be running.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The packet to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The packet could not be referenced.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_pipeline_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_pipeline *pipeline;
+	struct pipeline_item *item;
+	struct sr_datafeed_packet *ref;
+
+	pipeline = session->pipeline;
+
+	ref = sr_packet_ref(packet);
+	if (!ref)
+		return SR_ERR;
+
+	g_mutex_lock(&pipeline->mutex);
+	while (pipeline->in_flight >= pipeline->max_in_flight)
+		g_cond_wait(&pipeline->cond, &pipeline->mutex);
+	pipeline->in_flight++;
+	g_mutex_unlock(&pipeline->mutex);
+
+	item = g_malloc0(sizeof(*item));
+	item->sdi = sdi;
+	item->packet = ref;
+	g_async_queue_push(pipeline->first->queue, item);
+
+	return SR_OK;
+}
+
+/**
+ * Configure pipelined execution of a session's transform modules.
+ *
+ * With a non-zero @a depth, every transform module runs on a thread of
+ * its own, and up to @a depth packets can be in flight between the
+ * stages. The sender blocks while the pipeline is full. Datafeed callbacks
+ * then run on the thread of the last stage (unless a delivery ring was
+ * configured with sr_session_datafeed_ring_set()).
+ *
+ * Transform modules must not rely on running in the same thread as the
+ * driver, and must not keep references to packets they passed on.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param depth Maximum number of packets in the pipeline. 0 runs the
+ *              transforms synchronously, from within sr_session_send().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_transform_pipeline_set(struct sr_session *session,
+		unsigned int depth)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change transform execution of a running session.");
+		return SR_ERR;
+	}
+
+	session->pipeline_depth = depth;
+
+	return SR_OK;
+}
@@ -0,0 +1,633 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Rolling retention of the session datafeed.
+ *
+ * When enabled, copies of the data packets of all devices of a session
+ * are kept in memory, the oldest get dropped when the byte budget or the
+ * age limit is exceeded. Snapshots of the retained data get written to
+ * srzip files, one per device, by a writer thread. Taking a snapshot
+ * only references the retained packets, so the acquisition never waits
+ * for it. Snapshots can be taken on request, or when a soft trigger
+ * matched the logic data and the post trigger time has passed.
+ *
+ * Packets are copied rather than referenced, lent buffers go back to
+ * their driver immediately. Packets of a snapshot which is being written
+ * stay allocated until the writer is done with them, which may exceed
+ * the budget by the size of the snapshot.
+ *
+ * Retained packets are charged to the session's memory budget, and the
+ * oldest get dropped while the session is under memory pressure, so
+ * that retention yields to the acquisition.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <sys/time.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-retain"
+/** @endcond */
+
+/* Bookkeeping which is accounted for each packet, on top of its data. */
+#define PACKET_OVERHEAD 128
+
+/** @cond PRIVATE */
+struct retained_packet {
+	gint refcount;
+	struct sr_mem_account *account;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	size_t size;
+	gint64 time;
+};
+
+struct retention_dev {
+	uint64_t samplerate;
+	struct soft_trigger_logic *stl;
+};
+
+struct sr_session_retention {
+	GMutex mutex;
+	GQueue packets;
+	size_t bytes;
+	size_t max_bytes;
+	gint64 max_age;
+	struct sr_mem_account *account;
+	/* struct retention_dev of each device, by struct sr_dev_inst. */
+	GHashTable *devs;
+
+	struct sr_trigger *trigger;
+	gint64 post_trigger;
+	sr_session_retention_callback cb;
+	void *cb_data;
+	/* When a matched trigger is due, 0 if none is pending. */
+	gint64 trigger_due;
+
+	GThreadPool *writer;
+};
+
+struct snapshot_job {
+	char *filename;
+	GSList *devs;
+	/* The samplerate of each device in devs. */
+	uint64_t *samplerates;
+	GPtrArray *packets;
+};
+/** @endcond */
+
+static void retained_unref(struct retained_packet *rp)
+{
+	if (!g_atomic_int_dec_and_test(&rp->refcount))
+		return;
+
+	sr_mem_account_release(rp->account, rp->size);
+	sr_packet_free(rp->packet);
+	g_free(rp);
+}
+
+static void retention_dev_free(struct retention_dev *rdev)
+{
+	soft_trigger_logic_free(rdev->stl);
+	g_free(rdev);
+}
+
+static size_t packet_size(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_analog *analog;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		return rle->num_runs * (rle->unitsize + sizeof(uint64_t));
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		return (planar->num_samples + 7) / 8 * planar->unitsize * 8;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (size_t)analog->num_samples * analog->encoding->unitsize *
+			MAX(g_slist_length(analog->meaning->channels), 1);
+	default:
+		return 0;
+	}
+}
+
+static void drop_oldest(struct sr_session_retention *ret, gint64 now)
+{
+	struct retained_packet *rp;
+
+	while ((rp = g_queue_peek_head(&ret->packets))) {
+		if (ret->bytes <= ret->max_bytes &&
+				(!ret->max_age || now - rp->time <= ret->max_age) &&
+				!sr_mem_account_pressure(ret->account))
+			break;
+		g_queue_pop_head(&ret->packets);
+		ret->bytes -= rp->size;
+		retained_unref(rp);
+	}
+}
+
+static void clear_packets(struct sr_session_retention *ret)
+{
+	g_queue_clear_full(&ret->packets, (GDestroyNotify)retained_unref);
+	ret->bytes = 0;
+}
+
+static struct retention_dev *get_dev(struct sr_session_retention *ret,
+		const struct sr_dev_inst *sdi)
+{
+	struct retention_dev *rdev;
+
+	rdev = g_hash_table_lookup(ret->devs, sdi);
+	if (!rdev) {
+		rdev = g_malloc0(sizeof(*rdev));
+		g_hash_table_insert(ret->devs, (gpointer)sdi, rdev);
+	}
+
+	return rdev;
+}
+
+/* Whether the trigger tests channels of the device. */
+static gboolean trigger_applies(const struct sr_trigger *trigger,
+		const struct sr_dev_inst *sdi)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+
+	if (!trigger->stages)
+		return FALSE;
+	stage = trigger->stages->data;
+	if (!stage->matches)
+		return FALSE;
+	match = stage->matches->data;
+
+	return match->channel && match->channel->sdi == sdi;
+}
+
+static void check_trigger(struct sr_session_retention *ret,
+		const struct sr_dev_inst *sdi, struct retention_dev *rdev,
+		const struct sr_datafeed_logic *logic, gint64 now)
+{
+	int pre_trigger_samples;
+
+	if (ret->trigger_due || !logic->length)
+		return;
+	if (!rdev->stl) {
+		if (!trigger_applies(ret->trigger, sdi))
+			return;
+		rdev->stl = soft_trigger_logic_new(sdi, ret->trigger, 0);
+		if (!rdev->stl)
+			return;
+	}
+
+	if (soft_trigger_logic_check(rdev->stl, logic->data, logic->length,
+			&pre_trigger_samples) < 0)
+		return;
+
+	sr_dbg("Retention trigger matched.");
+	ret->trigger_due = now + ret->post_trigger;
+	/* Re-arm for the next event. */
+	soft_trigger_logic_free(rdev->stl);
+	rdev->stl = NULL;
+}
+
+/**
+ * Keep a copy of a packet which gets dispatched.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The datafeed packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_retention_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_retention *ret;
+	struct retention_dev *rdev;
+	struct retained_packet *rp;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	struct sr_datafeed_packet *copy;
+	gboolean fire;
+	GSList *l;
+	gint64 now;
+
+	ret = session->retention;
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(&ret->mutex);
+	rdev = get_dev(ret, sdi);
+	g_mutex_unlock(&ret->mutex);
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				rdev->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		if (ret->trigger)
+			check_trigger(ret, sdi, rdev, packet->payload, now);
+		/* Fall through. */
+	case SR_DF_LOGIC_RLE:
+	case SR_DF_LOGIC_PLANAR:
+	case SR_DF_ANALOG:
+	case SR_DF_TRIGGER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+		if (sr_packet_copy(packet, &copy) != SR_OK)
+			break;
+		rp = g_malloc(sizeof(*rp));
+		rp->refcount = 1;
+		rp->account = ret->account;
+		rp->sdi = sdi;
+		rp->packet = copy;
+		rp->size = packet_size(packet) + PACKET_OVERHEAD;
+		rp->time = now;
+		sr_mem_account_charge(rp->account, rp->size);
+		g_mutex_lock(&ret->mutex);
+		g_queue_push_tail(&ret->packets, rp);
+		ret->bytes += rp->size;
+		drop_oldest(ret, now);
+		g_mutex_unlock(&ret->mutex);
+		break;
+	default:
+		break;
+	}
+
+	/* The callback typically takes a snapshot, which needs the lock. */
+	fire = ret->trigger_due && (now >= ret->trigger_due ||
+		packet->type == SR_DF_END);
+	if (fire) {
+		ret->trigger_due = 0;
+		if (ret->cb)
+			ret->cb(session, ret->cb_data);
+	}
+}
+
+/**
+ * Drop the retained packets before a session run.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_retention_reset(struct sr_session *session)
+{
+	struct sr_session_retention *ret;
+
+	if (!(ret = session->retention))
+		return;
+
+	g_mutex_lock(&ret->mutex);
+	clear_packets(ret);
+	g_hash_table_remove_all(ret->devs);
+	ret->trigger_due = 0;
+	g_mutex_unlock(&ret->mutex);
+}
+
+/**
+ * Release the retention buffer of a session.
+ *
+ * Waits for pending snapshots to be written.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_retention_free(struct sr_session *session)
+{
+	struct sr_session_retention *ret;
+
+	if (!(ret = session->retention))
+		return;
+
+	if (ret->writer)
+		g_thread_pool_free(ret->writer, FALSE, TRUE);
+	clear_packets(ret);
+	g_hash_table_unref(ret->devs);
+	sr_mem_account_free(ret->account);
+	g_mutex_clear(&ret->mutex);
+	g_free(ret);
+	session->retention = NULL;
+}
+
+/* The name of a device's file, when a snapshot covers several devices. */
+static char *device_filename(const char *filename, unsigned int idx)
+{
+	const char *ext;
+
+	ext = strrchr(filename, '.');
+	if (!ext || strchr(ext, G_DIR_SEPARATOR))
+		return g_strdup_printf("%s-%u", filename, idx);
+
+	return g_strdup_printf("%.*s-%u%s", (int)(ext - filename), filename,
+		idx, ext);
+}
+
+static void send_output(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+
+	out = NULL;
+	if (sr_output_send(o, packet, &out) != SR_OK)
+		sr_err("Cannot write the retained data.");
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+static int write_device(struct snapshot_job *job,
+		const struct sr_dev_inst *sdi, uint64_t samplerate,
+		const char *filename)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_config *src;
+	struct retained_packet *rp;
+	unsigned int i;
+
+	if (!(omod = sr_output_find("srzip")))
+		return SR_ERR_NA;
+	if (!(o = sr_output_new(omod, NULL, sdi, filename)))
+		return SR_ERR;
+
+	header.feed_version = 1;
+	gettimeofday(&header.starttime, NULL);
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	send_output(o, &packet);
+	if (samplerate) {
+		src = sr_config_new(SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(samplerate));
+		meta.config = g_slist_append(NULL, src);
+		packet.type = SR_DF_META;
+		packet.payload = &meta;
+		send_output(o, &packet);
+		g_slist_free(meta.config);
+		sr_config_free(src);
+	}
+	for (i = 0; i < job->packets->len; i++) {
+		rp = g_ptr_array_index(job->packets, i);
+		if (rp->sdi == sdi)
+			send_output(o, rp->packet);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	send_output(o, &packet);
+
+	return sr_output_free(o);
+}
+
+static void snapshot_job_run(gpointer data, gpointer user_data)
+{
+	struct snapshot_job *job;
+	GSList *l;
+	char *filename;
+	unsigned int idx;
+
+	(void)user_data;
+
+	job = data;
+	for (l = job->devs, idx = 0; l; l = l->next, idx++) {
+		filename = job->devs->next ?
+			device_filename(job->filename, idx + 1) :
+			g_strdup(job->filename);
+		if (write_device(job, l->data, job->samplerates[idx],
+				filename) == SR_OK)
+			sr_info("Wrote retained data to %s.", filename);
+		else
+			sr_err("Cannot write retained data to %s.", filename);
+		g_free(filename);
+	}
+
+	g_ptr_array_free(job->packets, TRUE);
+	g_slist_free(job->devs);
+	g_free(job->samplerates);
+	g_free(job->filename);
+	g_free(job);
+}
+
+/**
+ * Retain the most recent datafeed of a session.
+ *
+ * Copies of the data packets of all devices get kept, the oldest are
+ * dropped when more than @a max_bytes of sample data are retained, or
+ * when they are older than @a max_ms. Use sr_session_retention_snapshot()
+ * to write the retained data to files.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes Memory budget of the retained data. 0 disables retention.
+ * @param max_ms Maximum age of retained packets, 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_retention_set(struct sr_session *session,
+		size_t max_bytes, uint64_t max_ms)
+{
+	struct sr_session_retention *ret;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the datafeed retention of a running session.");
+		return SR_ERR;
+	}
+
+	if (!max_bytes) {
+		sr_session_retention_free(session);
+		return SR_OK;
+	}
+
+	if (!(ret = session->retention)) {
+		ret = g_malloc0(sizeof(*ret));
+		g_mutex_init(&ret->mutex);
+		g_queue_init(&ret->packets);
+		ret->devs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, (GDestroyNotify)retention_dev_free);
+		ret->account = sr_mem_account_new(session, "retention");
+		session->retention = ret;
+	}
+	ret->max_bytes = max_bytes;
+	ret->max_age = max_ms * 1000;
+
+	return SR_OK;
+}
+
+/**
+ * Have a callback run when a trigger matched the retained logic data.
+ *
+ * The trigger gets evaluated in software on the logic data of the device
+ * whose channels it refers to. When it matched, the callback runs after
+ * @a post_ms more milliseconds, or at the end of the acquisition, and
+ * typically takes a snapshot with sr_session_retention_snapshot(). The
+ * trigger is re-armed once it matched.
+ *
+ * The callback runs in the thread which dispatches the datafeed, it
+ * should return quickly.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use, with retention enabled.
+ * @param trigger The trigger, NULL to remove it. Must live as long as it
+ *                is set.
+ * @param post_ms The time to retain data after the trigger matched.
+ * @param cb The callback.
+ * @param cb_data Data to pass to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments, or retention is not enabled.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_retention_trigger_set(struct sr_session *session,
+		struct sr_trigger *trigger, uint64_t post_ms,
+		sr_session_retention_callback cb, void *cb_data)
+{
+	struct sr_session_retention *ret;
+
+	if (!session || !(ret = session->retention)) {
+		sr_err("%s: session was NULL or has no retention", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the retention trigger of a running session.");
+		return SR_ERR;
+	}
+
+	g_hash_table_remove_all(ret->devs);
+	ret->trigger = trigger;
+	ret->post_trigger = post_ms * 1000;
+	ret->cb = cb;
+	ret->cb_data = cb_data;
+	ret->trigger_due = 0;
+
+	return SR_OK;
+}
+
+/**
+ * Write the retained datafeed of a session to srzip files.
+ *
+ * The files get written by a thread in the background, this routine only
+ * takes references to the currently retained packets. A single device's
+ * data goes to @a filename. With several devices, each one gets a file
+ * of its own, with its number appended to the name (before the
+ * extension). The devices must not be removed from the session before
+ * the files are written, sr_session_destroy() waits for that.
+ *
+ * This may be called from any thread, also while the session is running.
+ *
+ * @param session The session to use, with retention enabled.
+ * @param filename The name of the file to write.
+ *
+ * @retval SR_OK Success, the snapshot is being written.
+ * @retval SR_ERR_ARG Invalid arguments, or retention is not enabled.
+ * @retval SR_ERR_NA Nothing is retained.
+ * @retval SR_ERR The writer thread cannot be started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_retention_snapshot(struct sr_session *session,
+		const char *filename)
+{
+	struct sr_session_retention *ret;
+	struct retention_dev *rdev;
+	struct retained_packet *rp;
+	struct snapshot_job *job;
+	GError *error;
+	GList *l;
+	GSList *d;
+	unsigned int idx;
+
+	if (!session || !(ret = session->retention) || !filename) {
+		sr_err("%s: invalid arguments, or no retention", __func__);
+		return SR_ERR_ARG;
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->filename = g_strdup(filename);
+	g_mutex_lock(&ret->mutex);
+	if (!ret->writer) {
+		error = NULL;
+		ret->writer = g_thread_pool_new(snapshot_job_run, NULL, 1,
+			FALSE, &error);
+		if (!ret->writer) {
+			g_mutex_unlock(&ret->mutex);
+			sr_err("Cannot start the snapshot writer: %s.",
+				error->message);
+			g_error_free(error);
+			g_free(job->filename);
+			g_free(job);
+			return SR_ERR;
+		}
+	}
+	job->packets = g_ptr_array_new_full(g_queue_get_length(&ret->packets),
+		(GDestroyNotify)retained_unref);
+	for (l = ret->packets.head; l; l = l->next) {
+		rp = l->data;
+		g_atomic_int_inc(&rp->refcount);
+		g_ptr_array_add(job->packets, rp);
+		if (!g_slist_find(job->devs, rp->sdi))
+			job->devs = g_slist_append(job->devs, (gpointer)rp->sdi);
+	}
+	job->samplerates = g_malloc0_n(g_slist_length(job->devs) + 1,
+		sizeof(uint64_t));
+	for (d = job->devs, idx = 0; d; d = d->next, idx++) {
+		rdev = g_hash_table_lookup(ret->devs, d->data);
+		job->samplerates[idx] = rdev ? rdev->samplerate : 0;
+	}
+	g_mutex_unlock(&ret->mutex);
+
+	if (!job->devs) {
+		snapshot_job_run(job, NULL);
+		return SR_ERR_NA;
+	}
+	g_thread_pool_push(ret->writer, job, NULL);
+
+	return SR_OK;
+}
@@ -0,0 +1,380 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Decoupled datafeed delivery on a separate thread.
+ *
+ * Packets which drivers send to the session are put into a bounded
+ * single producer, single consumer ring. A dedicated delivery thread
+ * takes them from there and runs the datafeed callbacks. This keeps slow
+ * consumers (file output, network) from stalling the session's event
+ * processing, and thus USB transfer resubmission.
+ *
+ * The producer is the thread which executes the session's main context,
+ * the consumer is the delivery thread. The ring's head and tail indices
+ * are only ever written by one side each, so the fast path does not take
+ * any locks. The mutex and condition only get used when either side has
+ * to sleep because the ring is empty or full.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-ring"
+/** @endcond */
+
+struct ring_slot {
+	const struct sr_dev_inst *sdi;
+	/* NULL tells the delivery thread to terminate. */
+	struct sr_datafeed_packet *packet;
+};
+
+struct sr_session_ring {
+	struct sr_session *session;
+	struct ring_slot *slots;
+	unsigned int mask;
+	gboolean drop_when_full;
+
+	/* Written by the producer only. */
+	volatile guint head;
+	/* Written by the consumer only. */
+	volatile guint tail;
+
+	GMutex mutex;
+	GCond cond;
+	volatile gint consumer_waiting;
+	volatile gint producer_waiting;
+
+	GThread *thread;
+
+	/* Statistics, updated by the producer. */
+	uint64_t packets_queued;
+	uint64_t packets_dropped;
+	uint64_t producer_stalls;
+	unsigned int high_water;
+};
+
+static unsigned int ring_fill(struct sr_session_ring *ring)
+{
+	return (guint)g_atomic_int_get(&ring->head) -
+		(guint)g_atomic_int_get(&ring->tail);
+}
+
+static void ring_wakeup(struct sr_session_ring *ring, volatile gint *waiting)
+{
+	if (!g_atomic_int_get(waiting))
+		return;
+	g_mutex_lock(&ring->mutex);
+	g_cond_broadcast(&ring->cond);
+	g_mutex_unlock(&ring->mutex);
+}
+
+static gpointer ring_thread(gpointer data)
+{
+	struct sr_session_ring *ring;
+	struct ring_slot slot;
+	guint tail;
+
+	ring = data;
+	sr_thread_sched_apply(ring->session, SR_THREAD_DATAFEED, 0);
+	while (TRUE) {
+		if (ring_fill(ring) == 0) {
+			g_mutex_lock(&ring->mutex);
+			g_atomic_int_set(&ring->consumer_waiting, 1);
+			while (ring_fill(ring) == 0)
+				g_cond_wait(&ring->cond, &ring->mutex);
+			g_atomic_int_set(&ring->consumer_waiting, 0);
+			g_mutex_unlock(&ring->mutex);
+		}
+
+		tail = g_atomic_int_get(&ring->tail);
+		slot = ring->slots[tail & ring->mask];
+		g_atomic_int_set(&ring->tail, tail + 1);
+		ring_wakeup(ring, &ring->producer_waiting);
+
+		if (!slot.packet)
+			break;
+		sr_session_dispatch(ring->session, slot.sdi, slot.packet);
+		sr_packet_unref(slot.packet);
+	}
+
+	return NULL;
+}
+
+/* Packets which must never get dropped, even in lossy mode. */
+static gboolean is_control_packet(const struct sr_datafeed_packet *packet)
+{
+	if (!packet)
+		return TRUE;
+
+	return packet->type != SR_DF_LOGIC && packet->type != SR_DF_ANALOG &&
+		packet->type != SR_DF_LOGIC_RLE &&
+		packet->type != SR_DF_LOGIC_PLANAR;
+}
+
+static int ring_put(struct sr_session_ring *ring,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	guint head;
+	unsigned int fill;
+
+	head = g_atomic_int_get(&ring->head);
+	if (ring_fill(ring) > ring->mask) {
+		if (ring->drop_when_full && !is_control_packet(packet)) {
+			ring->packets_dropped++;
+			return SR_ERR;
+		}
+		ring->producer_stalls++;
+		g_mutex_lock(&ring->mutex);
+		g_atomic_int_set(&ring->producer_waiting, 1);
+		while (ring_fill(ring) > ring->mask)
+			g_cond_wait(&ring->cond, &ring->mutex);
+		g_atomic_int_set(&ring->producer_waiting, 0);
+		g_mutex_unlock(&ring->mutex);
+	}
+
+	ring->slots[head & ring->mask].sdi = sdi;
+	ring->slots[head & ring->mask].packet = packet;
+	g_atomic_int_set(&ring->head, head + 1);
+	ring_wakeup(ring, &ring->consumer_waiting);
+
+	if (packet)
+		ring->packets_queued++;
+	fill = ring_fill(ring);
+	if (fill > ring->high_water)
+		ring->high_water = fill;
+
+	return SR_OK;
+}
+
+/**
+ * Start the delivery thread of a session.
+ *
+ * @param session The session to start the delivery thread for.
+ * @param depth Number of packets the ring can hold, gets rounded up
+ *              to the next power of two.
+ * @param drop_when_full Drop logic and analog packets instead of
+ *                       blocking the producer when the ring is full.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Thread creation failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_ring_start(struct sr_session *session,
+		unsigned int depth, gboolean drop_when_full)
+{
+	struct sr_session_ring *ring;
+	unsigned int size;
+	GError *error;
+
+	size = 2;
+	while (size < depth)
+		size <<= 1;
+
+	ring = g_malloc0(sizeof(*ring));
+	ring->session = session;
+	ring->slots = g_malloc0_n(size, sizeof(ring->slots[0]));
+	ring->mask = size - 1;
+	ring->drop_when_full = drop_when_full;
+	g_mutex_init(&ring->mutex);
+	g_cond_init(&ring->cond);
+
+	error = NULL;
+	ring->thread = g_thread_try_new("sr-datafeed", ring_thread, ring, &error);
+	if (!ring->thread) {
+		sr_err("Cannot create delivery thread: %s.", error->message);
+		g_error_free(error);
+		g_mutex_clear(&ring->mutex);
+		g_cond_clear(&ring->cond);
+		g_free(ring->slots);
+		g_free(ring);
+		return SR_ERR;
+	}
+	sr_dbg("Delivering datafeed via a %u entry ring.", size);
+
+	session->ring = ring;
+	memset(&session->ring_stats, 0, sizeof(session->ring_stats));
+
+	return SR_OK;
+}
+
+/**
+ * Drain and stop the delivery thread of a session.
+ *
+ * All packets which still are in the ring get delivered before this
+ * routine returns. The statistics remain available afterwards.
+ *
+ * @param session The session to stop the delivery thread for.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_ring_stop(struct sr_session *session)
+{
+	struct sr_session_ring *ring;
+
+	ring = session->ring;
+	if (!ring)
+		return;
+
+	ring_put(ring, NULL, NULL);
+	g_thread_join(ring->thread);
+
+	session->ring_stats.packets_queued = ring->packets_queued;
+	session->ring_stats.packets_dropped = ring->packets_dropped;
+	session->ring_stats.producer_stalls = ring->producer_stalls;
+	session->ring_stats.high_water = ring->high_water;
+	session->ring_stats.depth = ring->mask + 1;
+
+	g_mutex_clear(&ring->mutex);
+	g_cond_clear(&ring->cond);
+	g_free(ring->slots);
+	g_free(ring);
+	session->ring = NULL;
+}
+
+/**
+ * Queue a packet for delivery by the session's delivery thread.
+ *
+ * The packet gets referenced (lent packets are not copied), so the
+ * caller's packet need not outlive this call. Packets which get dropped
+ * because the ring is full are not considered an error, they only show
+ * up in the statistics.
+ *
+ * @param session The session to use. Its delivery thread must be running.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The packet to queue.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The packet could not be referenced.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_ring_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet *ref;
+	struct sr_session_ring *ring;
+
+	ring = session->ring;
+	if (ring_fill(ring) > ring->mask && ring->drop_when_full &&
+			!is_control_packet(packet)) {
+		/* Don't bother referencing what gets dropped anyway. */
+		ring->packets_dropped++;
+		return SR_OK;
+	}
+
+	ref = sr_packet_ref(packet);
+	if (!ref)
+		return SR_ERR;
+	if (ring_put(ring, sdi, ref) != SR_OK)
+		sr_packet_unref(ref);
+
+	return SR_OK;
+}
+
+/**
+ * Configure decoupled datafeed delivery for a session.
+ *
+ * With a non-zero @a depth, datafeed callbacks no longer run from within
+ * the driver's event handling. Packets are queued in a ring of the given
+ * size instead, and get delivered by a separate thread. Datafeed callbacks
+ * then run in the context of that thread.
+ *
+ * When the ring is full, the driver blocks until there is space again,
+ * or, if @a drop_when_full is set, logic and analog packets get dropped.
+ * Control packets (header, end, meta, trigger, frame markers) are never
+ * dropped.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param depth Maximum number of queued packets. 0 disables the ring.
+ * @param drop_when_full Whether to drop packets instead of blocking.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_ring_set(struct sr_session *session,
+		unsigned int depth, gboolean drop_when_full)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change datafeed delivery of a running session.");
+		return SR_ERR;
+	}
+
+	session->ring_depth = depth;
+	session->ring_drop = drop_when_full;
+
+	return SR_OK;
+}
+
+/**
+ * Get the datafeed ring statistics of a session.
+ *
+ * While the session is running, the values are a snapshot which is
+ * updated concurrently. After the session stopped, they describe the
+ * complete run.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Where to store the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_ring_stats_get(struct sr_session *session,
+		struct sr_session_ring_stats *stats)
+{
+	struct sr_session_ring *ring;
+
+	if (!session || !stats) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	ring = session->ring;
+	if (!ring) {
+		*stats = session->ring_stats;
+		return SR_OK;
+	}
+
+	stats->packets_queued = ring->packets_queued;
+	stats->packets_dropped = ring->packets_dropped;
+	stats->producer_stalls = ring->producer_stalls;
+	stats->high_water = ring->high_water;
+	stats->depth = ring->mask + 1;
+
+	return SR_OK;
+}
@@ -0,0 +1,277 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Statistics of the session datafeed.
+ *
+ * When enabled, the session counts the packets and payload bytes which
+ * get delivered to the datafeed callbacks, and measures the time spent
+ * in each datafeed callback and in each transform module's receive()
+ * routine. Each set of counters only gets updated by the thread which
+ * runs the measured code (the session's event processing, the delivery
+ * thread, or a transform pipeline stage), so no locking is involved.
+ * The cost is two monotonic clock reads per invocation.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-stats"
+/** @endcond */
+
+/**
+ * Clear the statistics before a session run.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_stats_reset(struct sr_session *session)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	struct sr_transform *t;
+
+	memset(&session->stats, 0, sizeof(session->stats));
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		memset(&cb_struct->timing, 0, sizeof(cb_struct->timing));
+	}
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		memset(&t->timing, 0, sizeof(t->timing));
+	}
+}
+
+/**
+ * Get the size of a packet's sample data.
+ *
+ * @param packet The datafeed packet.
+ *
+ * @return The payload bytes of logic, analog, RLE and planar packets,
+ *         else 0.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_packet_payload_bytes(
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (uint64_t)analog->num_samples *
+			analog->encoding->unitsize *
+			g_slist_length(analog->meaning->channels);
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		return rle->num_runs *
+			(rle->unitsize + sizeof(rle->run_lengths[0]));
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		return (planar->num_samples + 7) / 8 * planar->unitsize * 8;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Account for a packet which gets delivered to the datafeed callbacks.
+ *
+ * @param session The session to use.
+ * @param packet The datafeed packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_stats_packet(struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	size_t idx;
+
+	if (packet->type < SR_DF_HEADER || packet->type > SR_DF_LOGIC_PLANAR)
+		return;
+
+	idx = packet->type - SR_DF_HEADER;
+	session->stats.packets[idx]++;
+	session->stats.bytes[idx] += sr_packet_payload_bytes(packet);
+}
+
+/**
+ * Account for one invocation of a callback or transform.
+ *
+ * @param timing The counters to update.
+ * @param usecs The duration of the invocation in microseconds.
+ *
+ * @private
+ */
+SR_PRIV void sr_datafeed_timing_add(struct sr_datafeed_timing *timing,
+		gint64 usecs)
+{
+	unsigned int bucket;
+
+	if (usecs < 0)
+		usecs = 0;
+
+	timing->calls++;
+	timing->total_us += usecs;
+	if ((uint64_t)usecs > timing->max_us)
+		timing->max_us = usecs;
+
+	bucket = 0;
+	while (usecs && bucket < SR_DATAFEED_TIMING_BUCKETS - 1) {
+		usecs >>= 1;
+		bucket++;
+	}
+	timing->histogram[bucket]++;
+}
+
+/**
+ * Enable or disable the collection of datafeed statistics.
+ *
+ * The statistics get cleared when the session starts, and remain
+ * available after it stopped.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable Whether to collect statistics.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_stats_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change datafeed statistics of a running session.");
+		return SR_ERR;
+	}
+
+	session->stats_enabled = enable;
+
+	return SR_OK;
+}
+
+/**
+ * Get the datafeed statistics of a session.
+ *
+ * While the session is running, the values are a snapshot which is
+ * updated concurrently. After the session stopped, they describe the
+ * complete run.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Where to store the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_stats_get(struct sr_session *session,
+		struct sr_session_datafeed_stats *stats)
+{
+	if (!session || !stats) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	*stats = session->stats;
+
+	return SR_OK;
+}
+
+/**
+ * Get the time spent in one of the datafeed callbacks of a session.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param index Position of the callback, in the order of registration.
+ * @param timing Where to store the timing. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such callback.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_timing_get(struct sr_session *session,
+		unsigned int index, struct sr_datafeed_timing *timing)
+{
+	struct datafeed_callback *cb_struct;
+
+	if (!session || !timing) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	cb_struct = g_slist_nth_data(session->datafeed_callbacks, index);
+	if (!cb_struct)
+		return SR_ERR_ARG;
+	*timing = cb_struct->timing;
+
+	return SR_OK;
+}
+
+/**
+ * Get the time spent in one of the transform modules of a session.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param index Position of the transform in the session's pipeline.
+ * @param timing Where to store the timing. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such transform.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_transform_timing_get(struct sr_session *session,
+		unsigned int index, struct sr_datafeed_timing *timing)
+{
+	struct sr_transform *t;
+
+	if (!session || !timing) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	t = g_slist_nth_data(session->transforms, index);
+	if (!t)
+		return SR_ERR_ARG;
+	*timing = t->timing;
+
+	return SR_OK;
+}
@@ -0,0 +1,566 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Per-device event processing threads.
+ *
+ * Each device of the session gets a worker thread with a main context of
+ * its own. The device's acquisition gets started and stopped there, and
+ * all event sources which the driver installs from that thread get
+ * attached to the worker's context. A driver which blocks in a serial
+ * read then only delays its own device.
+ *
+ * Packets which drivers send from a worker thread get queued, and are
+ * passed on from the session's main context. The queue is FIFO across
+ * all devices, so transforms, the delivery ring and the datafeed
+ * callbacks see the packets in the order they were sent, and keep
+ * running in a single thread.
+ *
+ * USB devices stay with the session's main context, since one event
+ * source handles the transfers of all devices on a libusb context.
+ * Optionally, all of the session's USB devices share a worker of their
+ * own instead (see sr_session_usb_thread_set()). Then libusb events get
+ * handled there, transfer completions don't wait for whatever else runs
+ * in the session's main context, and the resulting packets get queued
+ * like those of the other workers.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-threads"
+/** @endcond */
+
+struct dev_worker {
+	struct sr_session_threads *threads;
+	/* The device, or NULL for the worker of all USB devices. */
+	struct sr_dev_inst *sdi;
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
+	/* Whether to run with real-time scheduling. */
+	gboolean realtime;
+};
+
+struct queue_item {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+struct sr_session_threads {
+	struct sr_session *session;
+	GSList *workers;
+	/* The worker which handles the USB devices' events, or NULL. */
+	struct dev_worker *usb_worker;
+	GAsyncQueue *queue;
+
+	/* Idle source in the session's main context which drains the queue. */
+	GMutex mutex;
+	GSource *drain_source;
+};
+
+/* A function to run on a worker, and its result. */
+struct worker_call {
+	struct dev_worker *worker;
+	struct sr_dev_inst *sdi;
+	int (*func)(struct sr_dev_inst *sdi);
+	gboolean wait;
+	int ret;
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
+};
+
+/* The worker which the current thread runs, if any. */
+static GPrivate current_worker;
+
+static gpointer worker_thread(gpointer data)
+{
+	struct dev_worker *worker;
+
+	worker = data;
+	/* Without settings, only the USB thread may ask for real-time. */
+	sr_thread_sched_apply(worker->threads->session,
+		worker->sdi ? SR_THREAD_DEVICE : SR_THREAD_USB,
+		worker->realtime ? 1 : 0);
+	g_private_set(&current_worker, worker);
+	g_main_context_push_thread_default(worker->context);
+	g_main_loop_run(worker->loop);
+	g_main_context_pop_thread_default(worker->context);
+	g_private_set(&current_worker, NULL);
+
+	return NULL;
+}
+
+static struct dev_worker *worker_find(struct sr_session_threads *threads,
+		const struct sr_dev_inst *sdi)
+{
+	struct dev_worker *worker;
+	GSList *l;
+
+	if (sdi->inst_type == SR_INST_USB)
+		return threads->usb_worker;
+
+	for (l = threads->workers; l; l = l->next) {
+		worker = l->data;
+		if (worker->sdi == sdi)
+			return worker;
+	}
+
+	return NULL;
+}
+
+static void worker_free(struct dev_worker *worker)
+{
+	g_main_loop_unref(worker->loop);
+	g_main_context_unref(worker->context);
+	g_free(worker);
+}
+
+static struct dev_worker *worker_new(struct sr_session_threads *threads,
+		struct sr_dev_inst *sdi, gboolean realtime)
+{
+	struct dev_worker *worker;
+	GError *error;
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->threads = threads;
+	worker->sdi = sdi;
+	worker->realtime = realtime;
+	worker->context = g_main_context_new();
+	worker->loop = g_main_loop_new(worker->context, FALSE);
+	error = NULL;
+	worker->thread = g_thread_try_new(sdi ? "sr-device" : "sr-usb",
+		worker_thread, worker, &error);
+	if (!worker->thread) {
+		sr_err("Cannot create device thread: %s.", error->message);
+		g_error_free(error);
+		worker_free(worker);
+		return NULL;
+	}
+
+	return worker;
+}
+
+/* Run a function in the worker's thread, from its main loop. */
+static void worker_attach(struct dev_worker *worker, int priority,
+		GSourceFunc func, void *data)
+{
+	GSource *source;
+
+	/*
+	 * Not g_main_context_invoke(), which calls the function right away
+	 * (in the wrong thread) when the context is not in use yet.
+	 */
+	source = g_idle_source_new();
+	g_source_set_priority(source, priority);
+	g_source_set_callback(source, func, data, NULL);
+	g_source_attach(source, worker->context);
+	g_source_unref(source);
+}
+
+static gboolean worker_call_run(void *data)
+{
+	struct worker_call *call;
+	int ret;
+
+	call = data;
+	ret = call->func(call->sdi);
+	if (!call->wait) {
+		g_free(call);
+		return G_SOURCE_REMOVE;
+	}
+
+	g_mutex_lock(&call->mutex);
+	call->ret = ret;
+	call->done = TRUE;
+	g_cond_signal(&call->cond);
+	g_mutex_unlock(&call->mutex);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean worker_quit(void *data)
+{
+	struct dev_worker *worker;
+
+	worker = data;
+	g_main_loop_quit(worker->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean drain_queue(void *data)
+{
+	struct sr_session_threads *threads;
+	struct queue_item *item;
+
+	threads = data;
+	g_mutex_lock(&threads->mutex);
+	if (threads->drain_source) {
+		g_source_unref(threads->drain_source);
+		threads->drain_source = NULL;
+	}
+	g_mutex_unlock(&threads->mutex);
+
+	while ((item = g_async_queue_try_pop(threads->queue))) {
+		sr_session_send(item->sdi, item->packet);
+		sr_packet_unref(item->packet);
+		g_free(item);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void drain_later(struct sr_session_threads *threads)
+{
+	struct sr_session *session;
+	GSource *source;
+
+	session = threads->session;
+	g_mutex_lock(&threads->mutex);
+	if (threads->drain_source) {
+		g_mutex_unlock(&threads->mutex);
+		return;
+	}
+	source = g_idle_source_new();
+	g_source_set_priority(source, G_PRIORITY_DEFAULT);
+	g_source_set_callback(source, drain_queue, threads, NULL);
+	g_mutex_lock(&session->main_mutex);
+	if (session->main_context) {
+		g_source_attach(source, session->main_context);
+		threads->drain_source = source;
+	} else {
+		g_source_unref(source);
+	}
+	g_mutex_unlock(&session->main_mutex);
+	g_mutex_unlock(&threads->mutex);
+}
+
+/**
+ * Start the device worker threads of a session.
+ *
+ * Does nothing unless device threads were enabled with
+ * sr_session_device_threads_set(), or a USB thread with
+ * sr_session_usb_thread_set().
+ *
+ * @param session The session to use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Thread creation failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_threads_start(struct sr_session *session)
+{
+	struct sr_session_threads *threads;
+	struct dev_worker *worker;
+	struct sr_dev_inst *sdi;
+	gboolean have_usb;
+	GSList *l;
+
+	if (!session->device_threads && !session->usb_thread)
+		return SR_OK;
+
+	threads = g_malloc0(sizeof(*threads));
+	threads->session = session;
+	threads->queue = g_async_queue_new();
+	g_mutex_init(&threads->mutex);
+	session->threads = threads;
+
+	have_usb = FALSE;
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		if (sdi->inst_type == SR_INST_USB) {
+			have_usb = TRUE;
+			continue;
+		}
+		if (!session->device_threads)
+			continue;
+		worker = worker_new(threads, sdi, FALSE);
+		if (!worker) {
+			sr_session_threads_stop(session);
+			return SR_ERR;
+		}
+		threads->workers = g_slist_append(threads->workers, worker);
+	}
+	sr_dbg("Running %u device(s) on threads of their own.",
+		g_slist_length(threads->workers));
+
+	if (session->usb_thread && have_usb) {
+		worker = worker_new(threads, NULL, session->usb_thread_realtime);
+		if (!worker) {
+			sr_session_threads_stop(session);
+			return SR_ERR;
+		}
+		threads->workers = g_slist_append(threads->workers, worker);
+		threads->usb_worker = worker;
+		sr_dbg("Handling USB events on a thread of their own.");
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Stop the device worker threads of a session.
+ *
+ * Functions which were passed to sr_session_threads_dev_call() before
+ * still run. Packets which are still queued get passed on before this
+ * routine returns.
+ *
+ * @param session The session to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_threads_stop(struct sr_session *session)
+{
+	struct sr_session_threads *threads;
+	struct dev_worker *worker;
+	GSList *l;
+
+	threads = session->threads;
+	if (!threads)
+		return;
+
+	/* Below the priority of idle sources, so pending calls run first. */
+	for (l = threads->workers; l; l = l->next) {
+		worker = l->data;
+		worker_attach(worker, G_PRIORITY_LOW, worker_quit, worker);
+	}
+	for (l = threads->workers; l; l = l->next) {
+		worker = l->data;
+		g_thread_join(worker->thread);
+		worker_free(worker);
+	}
+	g_slist_free(threads->workers);
+	threads->workers = NULL;
+	threads->usb_worker = NULL;
+
+	g_mutex_lock(&threads->mutex);
+	if (threads->drain_source) {
+		g_source_destroy(threads->drain_source);
+		g_source_unref(threads->drain_source);
+		threads->drain_source = NULL;
+	}
+	g_mutex_unlock(&threads->mutex);
+	drain_queue(threads);
+
+	session->threads = NULL;
+	g_async_queue_unref(threads->queue);
+	g_mutex_clear(&threads->mutex);
+	g_free(threads);
+}
+
+/**
+ * Run a function for a device, in the thread which handles its events.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance.
+ * @param func The function to run, typically sr_dev_acquisition_start().
+ * @param wait Whether to wait for @a func to return.
+ *
+ * @return The result of @a func, or SR_OK if not waiting for it.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_threads_dev_call(struct sr_session *session,
+		struct sr_dev_inst *sdi, int (*func)(struct sr_dev_inst *sdi),
+		gboolean wait)
+{
+	struct dev_worker *worker;
+	struct worker_call *call;
+	int ret;
+
+	worker = session->threads ? worker_find(session->threads, sdi) : NULL;
+	if (!worker || g_private_get(&current_worker) == worker)
+		return func(sdi);
+
+	call = g_malloc0(sizeof(*call));
+	call->worker = worker;
+	call->sdi = sdi;
+	call->func = func;
+	call->wait = wait;
+	if (!wait) {
+		worker_attach(worker, G_PRIORITY_DEFAULT, worker_call_run, call);
+		return SR_OK;
+	}
+
+	g_mutex_init(&call->mutex);
+	g_cond_init(&call->cond);
+	worker_attach(worker, G_PRIORITY_DEFAULT, worker_call_run, call);
+	g_mutex_lock(&call->mutex);
+	while (!call->done)
+		g_cond_wait(&call->cond, &call->mutex);
+	g_mutex_unlock(&call->mutex);
+	ret = call->ret;
+	g_mutex_clear(&call->mutex);
+	g_cond_clear(&call->cond);
+	g_free(call);
+
+	return ret;
+}
+
+/**
+ * Get the main context for event sources which the current thread adds.
+ *
+ * @param session The session to use.
+ *
+ * @return The worker's main context when called from one of the
+ *         session's device threads, NULL otherwise.
+ *
+ * @private
+ */
+SR_PRIV GMainContext *sr_session_threads_context(struct sr_session *session)
+{
+	struct dev_worker *worker;
+
+	worker = g_private_get(&current_worker);
+	if (!worker || worker->threads != session->threads)
+		return NULL;
+
+	return worker->context;
+}
+
+/**
+ * Queue a packet which a driver sends from a device thread.
+ *
+ * The packet gets referenced (see sr_packet_ref()), the caller may
+ * release its copy right away.
+ *
+ * @param session The session to use.
+ * @param sdi The device instance that sent the packet.
+ * @param packet The packet.
+ *
+ * @retval TRUE The packet was queued.
+ * @retval FALSE Not called from a device thread, or out of memory.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_threads_push(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_threads *threads;
+	struct queue_item *item;
+	struct sr_datafeed_packet *ref;
+
+	if (!sr_session_threads_context(session))
+		return FALSE;
+	threads = session->threads;
+
+	ref = sr_packet_ref(packet);
+	if (!ref)
+		return FALSE;
+	item = g_malloc0(sizeof(*item));
+	item->sdi = sdi;
+	item->packet = ref;
+	g_async_queue_push(threads->queue, item);
+	drain_later(threads);
+
+	return TRUE;
+}
+
+/**
+ * Have each device of a session handle its events on a thread of its own.
+ *
+ * With this enabled, slow devices which block in their event handling,
+ * like serial multimeters which wait for the next reading, don't delay
+ * the other devices of the session. Acquisitions get started and stopped,
+ * and the drivers' event sources run, on the device's thread. Packets
+ * get passed on from the session's main context, in the order they were
+ * sent. USB devices keep using the session's main context.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to use a thread per device.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change device threads of a running session.");
+		return SR_ERR;
+	}
+
+	session->device_threads = enable;
+
+	return SR_OK;
+}
+
+/**
+ * Handle the events of the session's USB devices on a thread of their own.
+ *
+ * With this enabled, libusb event handling and the drivers' transfer
+ * completion callbacks run on a private thread, and the packets which
+ * the drivers send get passed on from the session's main context. This
+ * keeps busy datafeed callbacks or other devices from delaying transfer
+ * resubmission, which helps devices without sample memory of their own
+ * that overflow their FIFO otherwise, like fx2lafw ones at high rates.
+ *
+ * Real-time scheduling typically needs privileges. When it cannot be
+ * set up, the thread runs with normal scheduling. It runs at the lowest
+ * SCHED_FIFO priority, unless sr_thread_sched_set() or
+ * sr_session_thread_sched_set() configured SR_THREAD_USB otherwise.
+ *
+ * This can only be changed while the session is not running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to use a thread for USB events.
+ * @param realtime TRUE to run the thread with real-time scheduling.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_usb_thread_set(struct sr_session *session,
+		gboolean enable, gboolean realtime)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the USB thread of a running session.");
+		return SR_ERR;
+	}
+
+	session->usb_thread = enable;
+	session->usb_thread_realtime = realtime;
+
+	return SR_OK;
+}
@@ -0,0 +1,512 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Datafeed fan-out to other processes through POSIX shared memory.
+ *
+ * One writer process publishes records into a ring, any number of
+ * reader processes (up to SR_SHM_RING_READERS at a time) take them from
+ * there. Each reader has a cursor in the shared header, the writer does
+ * not overwrite data which an attached reader did not release yet.
+ * Readers which fall behind for too long get detached by the writer,
+ * so that one stuck consumer cannot stall acquisition.
+ *
+ * Positions are free running 32 bit byte counts, like the indices of
+ * the session ring, the distance between two of them is computed with
+ * wrapping arithmetic. Records never wrap around the end of the ring,
+ * a padding record fills its tail instead. So readers can hand out the
+ * payload in place, without copying it.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "shm-ring"
+/** @endcond */
+
+#define RECORD_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+/* Reader slot states. */
+enum {
+	READER_FREE,
+	READER_JOINING,
+	READER_ACTIVE,
+};
+
+static char *shm_name(const char *name)
+{
+	/* POSIX shared memory objects are named "/something". */
+	if (name[0] == '/')
+		return g_strdup(name);
+
+	return g_strconcat("/", name, NULL);
+}
+
+static struct sr_shm_ring *ring_map(int fd, char *name, size_t map_size,
+		gboolean writer)
+{
+	struct sr_shm_ring *ring;
+	void *map;
+
+	map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		sr_err("Cannot map shared memory %s: %s.", name, g_strerror(errno));
+		close(fd);
+		g_free(name);
+		return NULL;
+	}
+
+	ring = g_malloc0(sizeof(*ring));
+	ring->fd = fd;
+	ring->name = name;
+	ring->map_size = map_size;
+	ring->info = map;
+	ring->data = (uint8_t *)map + sizeof(struct sr_shm_ring_info);
+	ring->writer = writer;
+	ring->reader = -1;
+
+	return ring;
+}
+
+/**
+ * Create the shared memory ring of a writer.
+ *
+ * An existing ring of the same name gets replaced, readers which still
+ * have it mapped keep the old one. The caller fills in the channel
+ * layout, and then makes the ring visible with sr_shm_ring_publish().
+ *
+ * @param name The name of the ring.
+ * @param size The size of the data area in bytes, gets rounded up to a
+ *             power of two.
+ *
+ * @return The ring, or NULL upon errors.
+ *
+ * @private
+ */
+SR_PRIV struct sr_shm_ring *sr_shm_ring_create(const char *name, size_t size)
+{
+	size_t data_size, map_size;
+	char *path;
+	int fd;
+
+	if (!name || !*name || size > SR_SHM_RING_MAX_SIZE)
+		return NULL;
+
+	data_size = 4096;
+	while (data_size < size)
+		data_size <<= 1;
+	map_size = sizeof(struct sr_shm_ring_info) + data_size;
+
+	path = shm_name(name);
+	shm_unlink(path);
+	fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		sr_err("Cannot create shared memory %s: %s.", path,
+			g_strerror(errno));
+		g_free(path);
+		return NULL;
+	}
+	if (ftruncate(fd, map_size) < 0) {
+		sr_err("Cannot size shared memory %s: %s.", path,
+			g_strerror(errno));
+		close(fd);
+		shm_unlink(path);
+		g_free(path);
+		return NULL;
+	}
+
+	return ring_map(fd, path, map_size, TRUE);
+}
+
+/**
+ * Make a newly created ring visible to readers.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_ring_publish(struct sr_shm_ring *ring)
+{
+	struct sr_shm_ring_info *info;
+
+	info = ring->info;
+	info->version = SR_SHM_RING_VERSION;
+	info->data_size = ring->map_size - sizeof(*info);
+	/* The magic goes last, readers check it before anything else. */
+	g_atomic_int_set(&info->writer_closed, 0);
+	memcpy(info->magic, SR_SHM_RING_MAGIC, sizeof(info->magic));
+}
+
+/**
+ * Open the shared memory ring of a writer, for reading.
+ *
+ * @param name The name of the ring.
+ *
+ * @return The ring, or NULL when it does not exist or is invalid.
+ *
+ * @private
+ */
+SR_PRIV struct sr_shm_ring *sr_shm_ring_open(const char *name)
+{
+	struct sr_shm_ring *ring;
+	struct sr_shm_ring_info *info;
+	struct stat st;
+	char *path;
+	int fd;
+
+	if (!name || !*name)
+		return NULL;
+
+	path = shm_name(name);
+	fd = shm_open(path, O_RDWR, 0);
+	if (fd < 0) {
+		sr_dbg("Cannot open shared memory %s: %s.", path,
+			g_strerror(errno));
+		g_free(path);
+		return NULL;
+	}
+	if (fstat(fd, &st) < 0 ||
+			(size_t)st.st_size <= sizeof(struct sr_shm_ring_info)) {
+		sr_err("Shared memory %s is no datafeed ring.", path);
+		close(fd);
+		g_free(path);
+		return NULL;
+	}
+
+	ring = ring_map(fd, path, st.st_size, FALSE);
+	if (!ring)
+		return NULL;
+
+	info = ring->info;
+	if (memcmp(info->magic, SR_SHM_RING_MAGIC, sizeof(info->magic)) ||
+			info->version != SR_SHM_RING_VERSION ||
+			info->data_size != ring->map_size - sizeof(*info) ||
+			(info->data_size & (info->data_size - 1)) ||
+			info->num_logic + info->num_analog > SR_SHM_RING_CHANNELS) {
+		sr_err("Shared memory %s is no compatible datafeed ring.", path);
+		sr_shm_ring_close(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+/**
+ * Release a ring. A writer's ring gets marked as closed and removed,
+ * a reader gets detached.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_ring_close(struct sr_shm_ring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->writer) {
+		g_atomic_int_set(&ring->info->writer_closed, 1);
+		shm_unlink(ring->name);
+	} else {
+		sr_shm_ring_detach(ring);
+	}
+	munmap(ring->info, ring->map_size);
+	close(ring->fd);
+	g_free(ring->name);
+	g_free(ring);
+}
+
+/* Number of bytes which the slowest active reader did not release yet. */
+static guint ring_used(struct sr_shm_ring *ring, guint write_pos,
+		int *slowest)
+{
+	struct sr_shm_ring_reader *reader;
+	guint used, max_used;
+	int i;
+
+	max_used = 0;
+	*slowest = -1;
+	for (i = 0; i < SR_SHM_RING_READERS; i++) {
+		reader = &ring->info->readers[i];
+		if (g_atomic_int_get(&reader->state) != READER_ACTIVE)
+			continue;
+		used = write_pos - (guint)g_atomic_int_get(&reader->pos);
+		if (used >= max_used) {
+			max_used = used;
+			*slowest = i;
+		}
+	}
+
+	return max_used;
+}
+
+/* Wait until the ring has room for @a size more bytes. */
+static void ring_wait_space(struct sr_shm_ring *ring, guint write_pos,
+		size_t size, int timeout_ms)
+{
+	struct sr_shm_ring_info *info;
+	gint64 deadline;
+	int slowest;
+
+	info = ring->info;
+	deadline = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+	while (info->data_size - ring_used(ring, write_pos, &slowest) < size) {
+		if (g_get_monotonic_time() < deadline) {
+			g_usleep(500);
+			continue;
+		}
+		sr_warn("Detaching datafeed reader %d (pid %d), it fell behind.",
+			slowest, info->readers[slowest].pid);
+		g_atomic_int_set(&info->readers[slowest].state, READER_FREE);
+	}
+}
+
+/**
+ * Reserve space for a record in the ring.
+ *
+ * Waits up to @a timeout_ms for readers to release the space. Readers
+ * which still hold it by then get detached. The record becomes visible
+ * to readers with sr_shm_ring_commit().
+ *
+ * @param ring The writer's ring.
+ * @param type The record type.
+ * @param size The size of the payload in bytes.
+ * @param timeout_ms How long to wait for slow readers.
+ *
+ * @return The payload area of the record, or NULL when the payload is
+ *         too large for the ring (see sr_shm_ring_max_payload()).
+ *
+ * @private
+ */
+SR_PRIV void *sr_shm_ring_reserve(struct sr_shm_ring *ring, uint32_t type,
+		size_t size, int timeout_ms)
+{
+	struct sr_shm_ring_info *info;
+	struct sr_shm_ring_record *record;
+	size_t total, offset, tail;
+	guint pos;
+
+	if (size > sr_shm_ring_max_payload(ring))
+		return NULL;
+
+	info = ring->info;
+	total = RECORD_ALIGN(sizeof(*record) + size);
+	pos = info->write_pos;
+	offset = pos & (info->data_size - 1);
+	tail = info->data_size - offset;
+	if (tail < total) {
+		/* Pad the end of the ring, the record starts over. */
+		ring_wait_space(ring, pos, tail + total, timeout_ms);
+		record = (struct sr_shm_ring_record *)&ring->data[offset];
+		record->type = SR_SHM_REC_PAD;
+		record->size = tail - sizeof(*record);
+		pos += tail;
+		offset = 0;
+	} else {
+		ring_wait_space(ring, pos, total, timeout_ms);
+	}
+
+	record = (struct sr_shm_ring_record *)&ring->data[offset];
+	record->type = type;
+	record->size = size;
+	ring->pending_pos = pos + total;
+
+	return record + 1;
+}
+
+/**
+ * Make the record of the last sr_shm_ring_reserve() call visible.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_ring_commit(struct sr_shm_ring *ring)
+{
+	g_atomic_int_set(&ring->info->write_pos, ring->pending_pos);
+}
+
+/**
+ * Get the largest payload which fits into a record of the ring.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_shm_ring_max_payload(const struct sr_shm_ring *ring)
+{
+	/* Leave room, so that padding never needs the complete ring. */
+	return ring->info->data_size / 4 - sizeof(struct sr_shm_ring_record);
+}
+
+/*
+ * Check that the reader's slot still is its own. The writer frees the
+ * slots of readers which fell behind, and others may take them over.
+ */
+static gboolean reader_valid(const struct sr_shm_ring *ring)
+{
+	const struct sr_shm_ring_reader *reader;
+
+	if (ring->reader < 0)
+		return FALSE;
+	reader = &ring->info->readers[ring->reader];
+
+	return g_atomic_int_get(&reader->state) == READER_ACTIVE &&
+		g_atomic_int_get(&reader->generation) == ring->reader_generation;
+}
+
+/**
+ * Attach a reader to the ring. It starts at the ring's current end, the
+ * data which was written before is not seen.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR All reader slots are taken.
+ *
+ * @private
+ */
+SR_PRIV int sr_shm_ring_attach(struct sr_shm_ring *ring)
+{
+	struct sr_shm_ring_reader *reader;
+	int i;
+
+	if (ring->reader >= 0)
+		return SR_OK;
+
+	for (i = 0; i < SR_SHM_RING_READERS; i++) {
+		reader = &ring->info->readers[i];
+		if (!g_atomic_int_compare_and_exchange(&reader->state,
+				READER_FREE, READER_JOINING))
+			continue;
+		reader->pid = getpid();
+		ring->reader_generation =
+			g_atomic_int_add(&reader->generation, 1) + 1;
+		g_atomic_int_set(&reader->pos,
+			g_atomic_int_get(&ring->info->write_pos));
+		g_atomic_int_set(&reader->state, READER_ACTIVE);
+		ring->reader = i;
+		ring->read_pos = reader->pos;
+		sr_dbg("Attached to %s as reader %d.", ring->name, i);
+		return SR_OK;
+	}
+	sr_err("All %d readers of %s are taken.", SR_SHM_RING_READERS,
+		ring->name);
+
+	return SR_ERR;
+}
+
+/**
+ * Detach a reader from the ring.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_ring_detach(struct sr_shm_ring *ring)
+{
+	struct sr_shm_ring_reader *reader;
+
+	if (ring->reader < 0)
+		return;
+
+	if (reader_valid(ring)) {
+		reader = &ring->info->readers[ring->reader];
+		g_atomic_int_compare_and_exchange(&reader->state,
+			READER_ACTIVE, READER_FREE);
+	}
+	ring->reader = -1;
+}
+
+/**
+ * Get the reader's next record, without taking it.
+ *
+ * The record's payload stays valid until sr_shm_ring_release().
+ *
+ * @param ring The reader's ring.
+ * @param record Where to store the record.
+ *
+ * @retval SR_OK A record was returned.
+ * @retval SR_ERR_NA No record is pending. When the writer closed the
+ *         ring, no more will come (see sr_shm_ring_writer_closed()).
+ * @retval SR_ERR The reader was detached by the writer, or the ring
+ *         got corrupted.
+ *
+ * @private
+ */
+SR_PRIV int sr_shm_ring_peek(struct sr_shm_ring *ring,
+		const struct sr_shm_ring_record **record)
+{
+	struct sr_shm_ring_info *info;
+	const struct sr_shm_ring_record *rec;
+	size_t offset;
+	guint write_pos;
+
+	info = ring->info;
+	if (!reader_valid(ring))
+		return SR_ERR;
+
+	while (TRUE) {
+		write_pos = g_atomic_int_get(&info->write_pos);
+		if (write_pos == ring->read_pos)
+			return SR_ERR_NA;
+		offset = ring->read_pos & (info->data_size - 1);
+		rec = (const struct sr_shm_ring_record *)&ring->data[offset];
+		if (RECORD_ALIGN(sizeof(*rec) + rec->size) >
+				info->data_size - offset ||
+				write_pos - ring->read_pos >
+				info->data_size) {
+			sr_err("Datafeed ring %s is corrupt.", ring->name);
+			return SR_ERR;
+		}
+		if (rec->type != SR_SHM_REC_PAD)
+			break;
+		sr_shm_ring_release(ring);
+	}
+	*record = rec;
+
+	return SR_OK;
+}
+
+/**
+ * Take the record which sr_shm_ring_peek() returned, releasing its space.
+ *
+ * @private
+ */
+SR_PRIV void sr_shm_ring_release(struct sr_shm_ring *ring)
+{
+	const struct sr_shm_ring_record *rec;
+	size_t offset;
+
+	offset = ring->read_pos & (ring->info->data_size - 1);
+	rec = (const struct sr_shm_ring_record *)&ring->data[offset];
+	ring->read_pos += RECORD_ALIGN(sizeof(*rec) + rec->size);
+	if (reader_valid(ring))
+		g_atomic_int_set(&ring->info->readers[ring->reader].pos,
+			ring->read_pos);
+}
+
+/**
+ * Check whether the writer closed the ring.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_shm_ring_writer_closed(const struct sr_shm_ring *ring)
+{
+	return g_atomic_int_get(&ring->info->writer_closed) != 0;
+}
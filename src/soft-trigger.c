@@ -41,6 +41,229 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/* Load a sample of up to 8 bytes into a word, in little endian order. */
+static inline uint64_t sample_word(const uint8_t *p, int unitsize)
+{
+	uint64_t w;
+
+	switch (unitsize) {
+	case 1:
+		return read_u8(p);
+	case 2:
+		return read_u16le(p);
+	case 4:
+		return read_u32le(p);
+	case 8:
+		return read_u64le(p);
+	default:
+		w = 0;
+		while (unitsize--)
+			w = (w << 8) | p[unitsize];
+		return w;
+	}
+}
+
+static int history_alloc(struct soft_trigger_history *h,
+		const struct sr_dev_inst *sdi, int size)
+{
+	if (!h->account)
+		h->account = sr_mem_account_new(sdi->session, "pre-trigger");
+	g_free(h->buffer);
+	sr_mem_account_release(h->account, h->size);
+	h->size = MAX(size, 0);
+	h->fill = 0;
+	h->buffer = g_try_malloc(h->size);
+	h->head = h->buffer;
+	if (h->size > 0 && !h->buffer) {
+		h->size = 0;
+		return SR_ERR_MALLOC;
+	}
+	sr_mem_account_charge(h->account, h->size);
+
+	return SR_OK;
+}
+
+static void history_free(struct soft_trigger_history *h)
+{
+	g_free(h->buffer);
+	sr_mem_account_free(h->account);
+}
+
+static void history_reset(struct soft_trigger_history *h)
+{
+	h->head = h->buffer;
+	h->fill = 0;
+}
+
+static void history_append(struct soft_trigger_history *h,
+		const uint8_t *buf, int len)
+{
+	size_t size;
+
+	/* Avoid uselessly copying more than the pre-trigger size. */
+	if (len >= h->size) {
+		/* Replaces all of the history, no need to wrap around. */
+		buf += len - h->size;
+		len = h->size;
+		if (len > 0)
+			memcpy(h->buffer, buf, len);
+		h->head = h->buffer;
+		h->fill = len;
+		return;
+	}
+
+	/* Update the filling level of the pre-trigger circular buffer. */
+	h->fill = MIN(h->fill + len, h->size);
+
+	/* Actually copy data to the pre-trigger circular buffer. */
+	while (len > 0) {
+		size = MIN(h->buffer + h->size - h->head, len);
+		memcpy(h->head, buf, size);
+		h->head += size;
+		if (h->head >= h->buffer + h->size)
+			h->head = h->buffer;
+		buf += size;
+		len -= size;
+	}
+}
+
+static void reverse_bytes(uint8_t *p, size_t len)
+{
+	uint8_t tmp, *q;
+
+	if (!len)
+		return;
+	q = p + len - 1;
+	while (p < q) {
+		tmp = *p;
+		*p++ = *q;
+		*q-- = tmp;
+	}
+}
+
+/*
+ * Reorder the circular buffer's content in place such that the oldest
+ * sample is at the start of the buffer. Only happens when the trigger
+ * fires, so the cost does not matter while waiting for the trigger.
+ */
+static void history_linearize(struct soft_trigger_history *h)
+{
+	size_t pos, size;
+
+	/*
+	 * The buffer only ever wraps around when it is completely filled.
+	 * Else its content already starts at the buffer's beginning.
+	 */
+	if (h->fill < h->size)
+		return;
+
+	pos = h->head - h->buffer;
+	size = h->size;
+	reverse_bytes(h->buffer, pos);
+	reverse_bytes(h->buffer + pos, size - pos);
+	reverse_bytes(h->buffer, size);
+	h->head = h->buffer;
+}
+
+/*
+ * Split the pre-trigger data between the history and the @a len bytes
+ * of the current buffer before the trigger point, which get trimmed to
+ * the pre-trigger size. Returns the number of most recent history bytes
+ * to send before them, see history_data().
+ */
+static int history_split(struct soft_trigger_history *h,
+		uint8_t **buf, int *len)
+{
+	int keep;
+
+	if (*len > h->size) {
+		*buf += *len - h->size;
+		*len = h->size;
+	}
+	keep = MIN(h->fill, h->size - *len);
+	if (keep > 0)
+		history_linearize(h);
+
+	return keep;
+}
+
+static uint8_t *history_data(struct soft_trigger_history *h, int keep)
+{
+	return h->buffer + h->fill - keep;
+}
+
+/*
+ * Compile the trigger's stages into bit masks at setup time, so that
+ * checking a sample becomes a few word operations, instead of walking
+ * the list of matches and testing single bits.
+ */
+static int compile_stages(struct soft_trigger_logic *stl)
+{
+	struct soft_trigger_logic_stage *cs;
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	GSList *l, *m;
+	uint8_t *masks, bit;
+	int idx, byte;
+
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0_n(stl->num_stages, sizeof(stl->stages[0]));
+	for (l = stl->trigger->stages, idx = 0; l; l = l->next, idx++) {
+		stage = l->data;
+		if (!stage->matches)
+			/* No matches supplied, client error. */
+			return SR_ERR_ARG;
+
+		cs = &stl->stages[idx];
+		masks = g_malloc0(5 * stl->unitsize);
+		cs->level_mask = masks;
+		cs->level_value = masks + stl->unitsize;
+		cs->rise_mask = masks + 2 * stl->unitsize;
+		cs->fall_mask = masks + 3 * stl->unitsize;
+		cs->edge_mask = masks + 4 * stl->unitsize;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			byte = match->channel->index / 8;
+			bit = 1 << (match->channel->index % 8);
+			if (byte >= stl->unitsize)
+				continue;
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				cs->level_mask[byte] |= bit;
+				break;
+			case SR_TRIGGER_ONE:
+				cs->level_mask[byte] |= bit;
+				cs->level_value[byte] |= bit;
+				break;
+			case SR_TRIGGER_RISING:
+				cs->rise_mask[byte] |= bit;
+				cs->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_FALLING:
+				cs->fall_mask[byte] |= bit;
+				cs->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_EDGE:
+				cs->edge_mask[byte] |= bit;
+				cs->has_edges = TRUE;
+				break;
+			}
+		}
+		if (stl->unitsize <= (int)sizeof(uint64_t)) {
+			cs->w_level_mask = sample_word(cs->level_mask, stl->unitsize);
+			cs->w_level_value = sample_word(cs->level_value, stl->unitsize);
+			cs->w_rise_mask = sample_word(cs->rise_mask, stl->unitsize);
+			cs->w_fall_mask = sample_word(cs->fall_mask, stl->unitsize);
+			cs->w_edge_mask = sample_word(cs->edge_mask, stl->unitsize);
+		}
+	}
+
+	return SR_OK;
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -51,21 +274,16 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
+	stl->ops = sr_logic_ops_get(stl->unitsize);
 	stl->prev_sample = g_malloc0(stl->unitsize);
-	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
-	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
-	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
-		/*
-		 * Error out if g_try_malloc() failed (or was invoked as
-		 * g_try_malloc(0)) *and* more than 0 pretrigger samples
-		 * were requested.
-		 */
+	if (history_alloc(&stl->pre_trigger, sdi,
+			stl->unitsize * pre_trigger_samples) != SR_OK) {
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
-	stl->pre_trigger_head = stl->pre_trigger_buffer;
 
-	if (stl->pre_trigger_size > 0 && !stl->pre_trigger_buffer) {
+	if (compile_stages(stl) != SR_OK) {
+		sr_err("Trigger stage without matches.");
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
@@ -75,99 +293,182 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
-	g_free(stl->pre_trigger_buffer);
+	int i;
+
+	for (i = 0; i < stl->num_stages; i++)
+		g_free(stl->stages[i].level_mask);
+	g_free(stl->stages);
+	history_free(&stl->pre_trigger);
 	g_free(stl->prev_sample);
 	g_free(stl);
 }
 
-static void pre_trigger_append(struct soft_trigger_logic *stl,
-		uint8_t *buf, int len)
-{
-	/* Avoid uselessly copying more than the pre-trigger size. */
-	if (len > stl->pre_trigger_size) {
-		buf += len - stl->pre_trigger_size;
-		len = stl->pre_trigger_size;
-	}
-
-	/* Update the filling level of the pre-trigger circular buffer. */
-	stl->pre_trigger_fill = MIN(stl->pre_trigger_fill + len,
-	                            stl->pre_trigger_size);
-
-	/* Actually copy data to the pre-trigger circular buffer. */
-	while (len > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, len);
-		memcpy(stl->pre_trigger_head, buf, size);
-		stl->pre_trigger_head += size;
-		if (stl->pre_trigger_head >= stl->pre_trigger_buffer
-		                             + stl->pre_trigger_size)
-			stl->pre_trigger_head = stl->pre_trigger_buffer;
-		buf += size;
-		len -= size;
-	}
-}
-
+/*
+ * Send the pre-trigger data: the history that was kept from previous
+ * buffers, and the part of the current buffer up to the trigger point.
+ * The history gets sent as one contiguous packet, the current buffer's
+ * part is sent straight from the caller's memory, without copying it
+ * to the circular buffer first.
+ */
 static void pre_trigger_send(struct soft_trigger_logic *stl,
-		int *pre_trigger_samples)
+		uint8_t *buf, int len, int *pre_trigger_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	int keep;
 
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = stl->unitsize;
 
-	if (pre_trigger_samples)
-		*pre_trigger_samples = 0;
-
-	/* If pre-trigger buffer not full, rewind head to the first valid sample. */
-	if (stl->pre_trigger_fill < stl->pre_trigger_size)
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-
-	/* Send logic packets for the pre-trigger circular buffer content. */
-	while (stl->pre_trigger_fill > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, stl->pre_trigger_fill);
-		logic.length = size;
-		logic.data = stl->pre_trigger_head;
+	keep = history_split(&stl->pre_trigger, &buf, &len);
+	if (keep > 0) {
+		logic.length = keep;
+		logic.data = history_data(&stl->pre_trigger, keep);
 		sr_session_send(stl->sdi, &packet);
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-		stl->pre_trigger_fill -= size;
-		if (pre_trigger_samples)
-			*pre_trigger_samples += size / stl->unitsize;
 	}
+	if (len > 0) {
+		logic.length = len;
+		logic.data = buf;
+		sr_session_send(stl->sdi, &packet);
+	}
+
+	history_reset(&stl->pre_trigger);
+	if (pre_trigger_samples)
+		*pre_trigger_samples = (keep + len) / stl->unitsize;
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
-{
-	int bit, prev_bit;
-	gboolean result;
-
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+static gboolean stage_check_wide(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs, const uint8_t *sample,
+		gboolean have_prev)
+{
+	const uint8_t *prev;
+	uint8_t s, p;
+	int i;
+
+	prev = stl->prev_sample;
+	for (i = 0; i < stl->unitsize; i++) {
+		s = sample[i];
+		if ((s ^ cs->level_value[i]) & cs->level_mask[i])
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
+		if (!cs->has_edges)
+			continue;
+		p = prev[i];
+		if (!have_prev && (cs->rise_mask[i] | cs->fall_mask[i] |
+				cs->edge_mask[i]))
+			return FALSE;
+		if ((~p & s & cs->rise_mask[i]) != cs->rise_mask[i])
+			return FALSE;
+		if ((p & ~s & cs->fall_mask[i]) != cs->fall_mask[i])
+			return FALSE;
+		if (((p ^ s) & cs->edge_mask[i]) != cs->edge_mask[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static inline gboolean stage_check(const struct soft_trigger_logic_stage *cs,
+		uint64_t s, uint64_t p, gboolean have_prev)
+{
+	if ((s ^ cs->w_level_value) & cs->w_level_mask)
+		return FALSE;
+	if (!cs->has_edges)
+		return TRUE;
+	if (!have_prev)
+		/* First sample, don't have enough for an edge match yet. */
+		return FALSE;
+
+	return (~p & s & cs->w_rise_mask) == cs->w_rise_mask &&
+		(p & ~s & cs->w_fall_mask) == cs->w_fall_mask &&
+		((p ^ s) & cs->w_edge_mask) == cs->w_edge_mask;
+}
+
+static gboolean logic_check_match(struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs, const uint8_t *sample)
+{
+	gboolean have_prev;
+
+	/* Only tracks whether a previous sample exists, saturates at 1. */
+	have_prev = stl->count > 0;
+	stl->count = 1;
+	if (stl->unitsize > (int)sizeof(uint64_t))
+		return stage_check_wide(stl, cs, sample, have_prev);
+
+	return stage_check(cs, sample_word(sample, stl->unitsize),
+		sample_word(stl->prev_sample, stl->unitsize), have_prev);
+}
+
+/*
+ * Skip over samples which cannot match the first stage. This is where
+ * the trigger spends most of its time while waiting for a rare event,
+ * so the loop is kept tight and free of calls for common sample sizes.
+ * Returns the position of the first candidate sample (or len).
+ */
+static int first_stage_skip(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int len)
+{
+	const struct soft_trigger_logic_stage *cs;
+	uint16_t m16, v16;
+	uint32_t m32, v32;
+	uint64_t m64, v64;
+	int i;
+
+	cs = &stl->stages[0];
+	if (stl->cur_stage != 0 || cs->has_edges || !cs->w_level_mask)
+		return 0;
+
+	i = 0;
+	switch (stl->unitsize) {
+	case 1:
+		while (i < len && ((buf[i] ^ cs->w_level_value) & cs->w_level_mask))
+			i++;
+		break;
+	case 2:
+		m16 = cs->w_level_mask;
+		v16 = cs->w_level_value;
+		while (i < len && ((read_u16le(buf + i) ^ v16) & m16))
+			i += 2;
+		break;
+	case 4:
+		m32 = cs->w_level_mask;
+		v32 = cs->w_level_value;
+		while (i < len && ((read_u32le(buf + i) ^ v32) & m32))
+			i += 4;
+		break;
+	case 8:
+		m64 = cs->w_level_mask;
+		v64 = cs->w_level_value;
+		while (i < len && ((read_u64le(buf + i) ^ v64) & m64))
+			i += 8;
+		break;
+	default:
+		return 0;
 	}
+	if (i > 0) {
+		stl->count = 1;
+		memcpy(stl->prev_sample, buf + i - stl->unitsize,
+			stl->unitsize);
+	}
+
+	return i;
+}
+
+/*
+ * Pass samples which must not fire the trigger, e.g. the ones before
+ * the position where a hardware trigger matched the first stages. They
+ * only get kept as pre-trigger data, and as the reference for edges.
+ */
+SR_PRIV void soft_trigger_logic_skip(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	if (len < stl->unitsize)
+		return;
 
-	return result;
+	history_append(&stl->pre_trigger, buf, len);
+	stl->ops->copy(stl->prev_sample, buf + len - stl->unitsize,
+		stl->unitsize);
+	stl->count = 1;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,42 +476,35 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
+	const struct soft_trigger_logic_stage *cs;
 	int offset;
 	int i;
 	gboolean match_found;
 
+	if (stl->num_stages == 0)
+		/* No stages supplied, client error. */
+		return SR_ERR_ARG;
+
 	offset = -1;
 	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
-			/* No matches supplied, client error. */
-			return SR_ERR_ARG;
-
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
+		if (stl->cur_stage == 0) {
+			i += first_stage_skip(stl, buf + i, len - i);
+			if (i >= len)
 				break;
-			}
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
+		cs = &stl->stages[stl->cur_stage];
+		match_found = logic_check_match(stl, cs, buf + i);
+		stl->ops->copy(stl->prev_sample, buf + i, stl->unitsize);
 		if (match_found) {
 			/* Matched on the current stage. */
-			if (l_stage->next) {
+			if (stl->cur_stage + 1 < stl->num_stages) {
 				/* Advance to next stage. */
 				stl->cur_stage++;
 			} else {
 				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
+				if (stl->segmented)
+					std_session_send_df_frame_begin(stl->sdi);
+				pre_trigger_send(stl, buf, i, pre_trigger_samples);
 
 				/* Fire trigger. */
 				offset = i / stl->unitsize;
@@ -237,7 +531,671 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 	}
 
 	if (offset == -1)
-		pre_trigger_append(stl, buf, len);
+		history_append(&stl->pre_trigger, buf, len);
+
+	return offset;
+}
+
+/*
+ * Re-arm the trigger after every capture, instead of streaming all of
+ * the samples after the first match. Each match gets sent as a frame of
+ * the pre-trigger samples (as passed to soft_trigger_logic_new()) and
+ * @a post_trigger_samples samples from the trigger point on, the
+ * samples in between get dropped. The trigger ignores the first
+ * @a holdoff_samples samples after a frame. Frames and samples which
+ * were sent get accounted in @a limits when not NULL, where
+ * limit_frames is the number of segments to capture.
+ *
+ * Use soft_trigger_logic_segment() instead of soft_trigger_logic_check()
+ * to feed the samples.
+ */
+SR_PRIV void soft_trigger_logic_set_segmented(struct soft_trigger_logic *stl,
+		int post_trigger_samples, int holdoff_samples,
+		struct sr_sw_limits *limits)
+{
+	stl->segmented = TRUE;
+	stl->post_trigger_samples = MAX(post_trigger_samples, 0);
+	stl->holdoff_samples = MAX(holdoff_samples, 0);
+	stl->limits = limits;
+	stl->in_segment = FALSE;
+	stl->seg_remain = 0;
+	stl->holdoff_remain = 0;
+}
+
+static void segment_send(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = stl->unitsize;
+	logic.length = len;
+	logic.data = buf;
+	sr_session_send(stl->sdi, &packet);
+
+	/* The last sample sent is the reference for edges after the frame. */
+	stl->ops->copy(stl->prev_sample, buf + len - stl->unitsize,
+		stl->unitsize);
+	stl->count = 1;
+	if (stl->limits)
+		sr_sw_limits_update_samples_read(stl->limits,
+			len / stl->unitsize);
+}
+
+/*
+ * Feed samples to a segmented trigger, see
+ * soft_trigger_logic_set_segmented(). Sends the frames of all of the
+ * matches within the buffer. Returns TRUE when the limits were reached
+ * after a frame, the acquisition should stop then.
+ */
+SR_PRIV gboolean soft_trigger_logic_segment(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	int offset, count, pre_trigger_samples;
+
+	len -= len % stl->unitsize;
+	while (len > 0 || stl->in_segment) {
+		if (!stl->in_segment && stl->holdoff_remain > 0) {
+			/* Keep the samples as pre-trigger data only. */
+			count = MIN(len, stl->holdoff_remain * stl->unitsize);
+			soft_trigger_logic_skip(stl, buf, count);
+			stl->holdoff_remain -= count / stl->unitsize;
+			buf += count;
+			len -= count;
+			continue;
+		}
+		if (!stl->in_segment) {
+			pre_trigger_samples = 0;
+			offset = soft_trigger_logic_check(stl, buf, len,
+				&pre_trigger_samples);
+			if (offset < 0)
+				return FALSE;
+			if (stl->limits)
+				sr_sw_limits_update_samples_read(stl->limits,
+					pre_trigger_samples);
+			stl->in_segment = TRUE;
+			stl->seg_remain = stl->post_trigger_samples;
+			buf += offset * stl->unitsize;
+			len -= offset * stl->unitsize;
+		}
+
+		count = MIN(len, stl->seg_remain * stl->unitsize);
+		if (count > 0)
+			segment_send(stl, buf, count);
+		stl->seg_remain -= count / stl->unitsize;
+		buf += count;
+		len -= count;
+		if (stl->seg_remain > 0)
+			return FALSE;
+
+		/* The frame is complete, re-arm the trigger. */
+		std_session_send_df_frame_end(stl->sdi);
+		stl->in_segment = FALSE;
+		stl->cur_stage = 0;
+		stl->holdoff_remain = stl->holdoff_samples;
+		if (stl->limits) {
+			sr_sw_limits_update_frames_read(stl->limits, 1);
+			if (sr_sw_limits_check(stl->limits))
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/** @cond PRIVATE */
+/* Values per channel which the analog trigger checks at a time. */
+#define ANALOG_BLOCK_SIZE 256
+/* Values which the search for candidates tests at once. */
+#define ANALOG_SKIP_BLOCK 16
+/** @endcond */
+
+enum {
+	ANALOG_RISING,
+	ANALOG_FALLING,
+	ANALOG_OVER,
+	ANALOG_UNDER,
+	ANALOG_WINDOW_IN,
+	ANALOG_WINDOW_OUT,
+};
+
+/*
+ * An OVER and an UNDER match on the same channel become a window. The
+ * value has to be inside the window when the OVER level is the lower
+ * one, else outside of it.
+ */
+static gboolean analog_window_merge(struct soft_trigger_analog_stage *cs,
+		const struct sr_trigger_match *match)
+{
+	struct soft_trigger_analog_cond *c;
+	float over, under;
+	int i;
+
+	for (i = 0; i < cs->num_conds; i++) {
+		c = &cs->conds[i];
+		if (c->channel != match->channel)
+			continue;
+		if (c->type == ANALOG_OVER && match->match == SR_TRIGGER_UNDER) {
+			over = c->level;
+			under = match->value;
+		} else if (c->type == ANALOG_UNDER &&
+				match->match == SR_TRIGGER_OVER) {
+			over = match->value;
+			under = c->level;
+		} else {
+			continue;
+		}
+		c->type = over < under ? ANALOG_WINDOW_IN : ANALOG_WINDOW_OUT;
+		c->level = MIN(over, under);
+		c->level2 = MAX(over, under);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static int compile_analog_stages(struct soft_trigger_analog *sta)
+{
+	struct soft_trigger_analog_stage *cs;
+	struct soft_trigger_analog_cond *c;
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	GSList *l, *m;
+	int idx;
+
+	sta->num_stages = g_slist_length(sta->trigger->stages);
+	sta->stages = g_malloc0_n(sta->num_stages, sizeof(sta->stages[0]));
+	for (l = sta->trigger->stages, idx = 0; l; l = l->next, idx++) {
+		stage = l->data;
+		cs = &sta->stages[idx];
+		cs->conds = g_malloc0_n(g_slist_length(stage->matches),
+			sizeof(cs->conds[0]));
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (match->channel->type != SR_CHANNEL_ANALOG)
+				continue;
+			if (!match->channel->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			if (analog_window_merge(cs, match))
+				continue;
+			c = &cs->conds[cs->num_conds];
+			switch (match->match) {
+			case SR_TRIGGER_RISING:
+				c->type = ANALOG_RISING;
+				break;
+			case SR_TRIGGER_FALLING:
+				c->type = ANALOG_FALLING;
+				break;
+			case SR_TRIGGER_OVER:
+				c->type = ANALOG_OVER;
+				break;
+			case SR_TRIGGER_UNDER:
+				c->type = ANALOG_UNDER;
+				break;
+			default:
+				continue;
+			}
+			c->channel = match->channel;
+			c->level = match->value;
+			c->values = g_malloc(ANALOG_BLOCK_SIZE * sizeof(double));
+			cs->num_conds++;
+		}
+		if (!cs->num_conds)
+			/* No analog matches in this stage, client error. */
+			return SR_ERR_ARG;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Create an analog soft trigger.
+ *
+ * Stages hold matches on analog channels: RISING and FALLING cross the
+ * match's value (with hysteresis and slope, see below), OVER and UNDER
+ * compare against it, and an OVER plus an UNDER on the same channel
+ * form a window. All of a stage's matches must hold for the same
+ * sample, the stages have to match one after another (not necessarily
+ * on adjacent samples).
+ *
+ * @private
+ */
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	struct soft_trigger_analog *sta;
+
+	sta = g_malloc0(sizeof(struct soft_trigger_analog));
+	sta->sdi = sdi;
+	sta->trigger = trigger;
+	sta->pre_trigger_samples = MAX(pre_trigger_samples, 0);
+
+	if (compile_analog_stages(sta) != SR_OK) {
+		sr_err("Trigger stage without analog matches.");
+		soft_trigger_analog_free(sta);
+		return NULL;
+	}
+
+	return sta;
+}
+
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta)
+{
+	int i, j;
+
+	for (i = 0; i < sta->num_stages; i++) {
+		for (j = 0; j < sta->stages[i].num_conds; j++)
+			g_free(sta->stages[i].conds[j].values);
+		g_free(sta->stages[i].conds);
+	}
+	g_free(sta->stages);
+	history_free(&sta->pre_trigger);
+	g_slist_free(sta->channels);
+	g_free(sta);
+}
+
+/*
+ * Crossings need the value to have been below the level minus the
+ * hysteresis for RISING (above the level plus the hysteresis for
+ * FALLING) before, so that noise around the level doesn't fire.
+ */
+SR_PRIV void soft_trigger_analog_set_hysteresis(struct soft_trigger_analog *sta,
+		float hysteresis)
+{
+	sta->hysteresis = MAX(hysteresis, 0);
+}
+
+/* Minimum change per sample of crossings, 0 to accept any slope. */
+SR_PRIV void soft_trigger_analog_set_slope(struct soft_trigger_analog *sta,
+		float slope)
+{
+	sta->slope = MAX(slope, 0);
+}
+
+/* Compare the fields (not the padding) of two encodings. */
+static gboolean analog_encoding_equal(const struct sr_analog_encoding *a,
+		const struct sr_analog_encoding *b)
+{
+	return a->unitsize == b->unitsize &&
+		!a->is_signed == !b->is_signed &&
+		!a->is_float == !b->is_float &&
+		!a->is_bigendian == !b->is_bigendian &&
+		a->digits == b->digits &&
+		!a->is_digits_decimal == !b->is_digits_decimal &&
+		a->scale.p == b->scale.p && a->scale.q == b->scale.q &&
+		a->offset.p == b->offset.p && a->offset.q == b->offset.q;
+}
+
+/*
+ * Track the layout of the payloads. The pre-trigger buffer holds raw
+ * samples of one encoding and channel list, it starts over when they
+ * change.
+ */
+static void analog_layout_update(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int num_channels)
+{
+	GSList *l, *m;
+	gboolean changed;
+
+	changed = !analog_encoding_equal(&sta->encoding, analog->encoding);
+	for (l = sta->channels, m = analog->meaning->channels; l || m;
+			l = l ? l->next : NULL, m = m ? m->next : NULL) {
+		if (!l || !m || l->data != m->data)
+			changed = TRUE;
+	}
+	sta->meaning = *analog->meaning;
+	sta->meaning.channels = sta->channels;
+	if (analog->spec)
+		sta->spec = *analog->spec;
+	if (!changed && sta->frame_size)
+		return;
+
+	sta->encoding = *analog->encoding;
+	g_slist_free(sta->channels);
+	sta->channels = g_slist_copy(analog->meaning->channels);
+	sta->meaning.channels = sta->channels;
+	sta->frame_size = sta->encoding.unitsize * num_channels;
+	if (history_alloc(&sta->pre_trigger, sta->sdi,
+			sta->pre_trigger_samples * sta->frame_size) != SR_OK)
+		sr_warn("Cannot allocate the analog pre-trigger buffer.");
+}
+
+/*
+ * Locate the stage's channels in the payload, and translate all of the
+ * thresholds into the payload's raw sample units. Returns SR_ERR_NA when
+ * one of the channels is absent, the stage cannot match then.
+ */
+static int analog_stage_prepare(struct soft_trigger_analog *sta,
+		struct soft_trigger_analog_stage *cs,
+		const struct sr_datafeed_analog *analog,
+		double *unit_scale, double *unit_offset)
+{
+	struct soft_trigger_analog_cond *c;
+	double s, o;
+	int i, ret;
+
+	ret = sr_analog_to_raw_units(analog, 0, 1, 0, NULL, &s, &o);
+	if (ret != SR_OK)
+		return ret;
+	*unit_scale = s;
+	*unit_offset = o;
+
+	for (i = 0; i < cs->num_conds; i++) {
+		c = &cs->conds[i];
+		c->pos = g_slist_index(analog->meaning->channels, c->channel);
+		if (c->pos < 0)
+			return SR_ERR_NA;
+		c->raw_level = (c->level - o) / s;
+		c->raw_level2 = (c->level2 - o) / s;
+		c->raw_hysteresis = sta->hysteresis / s;
+		c->raw_slope = sta->slope / s;
+		c->prev = (c->prev_value - o) / s;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Find the first value which satisfies an expression on x. Blocks of
+ * values get tested at once without branches, which compilers turn into
+ * vector code, and only the block which contains a hit is looked at
+ * value by value.
+ */
+#define FIND_FIRST(expr) do { \
+	for (i = 0; i + ANALOG_SKIP_BLOCK <= n; i += ANALOG_SKIP_BLOCK) { \
+		hit = 0; \
+		for (k = 0; k < ANALOG_SKIP_BLOCK; k++) { \
+			x = v[i + k]; \
+			hit |= (expr); \
+		} \
+		if (hit) \
+			break; \
+	} \
+	for (; i < n; i++) { \
+		x = v[i]; \
+		if (expr) \
+			break; \
+	} \
+} while (0)
+
+/*
+ * Index of the first of @a n values which can change the condition's
+ * state, or match it. The values before it leave the condition as is.
+ * This is where the trigger spends most of its time while waiting.
+ */
+static size_t analog_cond_skip(const struct soft_trigger_analog_cond *c,
+		const double *v, size_t n)
+{
+	double x, lo, hi;
+	size_t i, k;
+	int hit;
+
+	lo = c->raw_level;
+	hi = c->raw_level2;
+	switch (c->type) {
+	case ANALOG_RISING:
+		if (c->armed) {
+			FIND_FIRST(x >= lo);
+		} else {
+			lo -= c->raw_hysteresis;
+			FIND_FIRST(x < lo);
+		}
+		break;
+	case ANALOG_FALLING:
+		if (c->armed) {
+			FIND_FIRST(x <= lo);
+		} else {
+			lo += c->raw_hysteresis;
+			FIND_FIRST(x > lo);
+		}
+		break;
+	case ANALOG_OVER:
+		FIND_FIRST(x > lo);
+		break;
+	case ANALOG_UNDER:
+		FIND_FIRST(x < lo);
+		break;
+	case ANALOG_WINDOW_IN:
+		FIND_FIRST((x > lo) & (x < hi));
+		break;
+	case ANALOG_WINDOW_OUT:
+		FIND_FIRST((x < lo) | (x > hi));
+		break;
+	default:
+		i = 0;
+		break;
+	}
+
+	return i;
+}
+
+/* Check a condition on a value, and update its state. */
+static gboolean analog_cond_check(struct soft_trigger_analog_cond *c,
+		double x)
+{
+	gboolean match;
+
+	match = FALSE;
+	switch (c->type) {
+	case ANALOG_RISING:
+		if (c->armed && x >= c->raw_level) {
+			c->armed = FALSE;
+			match = c->raw_slope <= 0 ||
+				(c->have_prev && x - c->prev >= c->raw_slope);
+		} else if (x < c->raw_level - c->raw_hysteresis) {
+			c->armed = TRUE;
+		}
+		break;
+	case ANALOG_FALLING:
+		if (c->armed && x <= c->raw_level) {
+			c->armed = FALSE;
+			match = c->raw_slope <= 0 ||
+				(c->have_prev && c->prev - x >= c->raw_slope);
+		} else if (x > c->raw_level + c->raw_hysteresis) {
+			c->armed = TRUE;
+		}
+		break;
+	case ANALOG_OVER:
+		match = x > c->raw_level;
+		break;
+	case ANALOG_UNDER:
+		match = x < c->raw_level;
+		break;
+	case ANALOG_WINDOW_IN:
+		match = x > c->raw_level && x < c->raw_level2;
+		break;
+	case ANALOG_WINDOW_OUT:
+		match = x < c->raw_level || x > c->raw_level2;
+		break;
+	}
+	c->prev = x;
+	c->have_prev = TRUE;
+
+	return match;
+}
+
+/*
+ * Returns the index of the first of @a len values in the conditions'
+ * blocks where all of the stage's conditions match, or len. Only the
+ * values where a condition can change get checked.
+ */
+static size_t analog_stage_match(struct soft_trigger_analog_stage *cs,
+		size_t len)
+{
+	struct soft_trigger_analog_cond *c;
+	gboolean match;
+	size_t pos;
+	int i;
+
+	for (i = 0; i < cs->num_conds; i++) {
+		c = &cs->conds[i];
+		c->next = analog_cond_skip(c, c->values, len);
+	}
+
+	while (TRUE) {
+		pos = len;
+		for (i = 0; i < cs->num_conds; i++)
+			pos = MIN(pos, cs->conds[i].next);
+		if (pos == len)
+			break;
+
+		match = TRUE;
+		for (i = 0; i < cs->num_conds; i++) {
+			c = &cs->conds[i];
+			if (c->next != pos) {
+				/* Can't match where it can't change. */
+				match = FALSE;
+				continue;
+			}
+			if (pos > 0) {
+				c->prev = c->values[pos - 1];
+				c->have_prev = TRUE;
+			}
+			if (!analog_cond_check(c, c->values[pos]))
+				match = FALSE;
+			c->next = pos + 1 + analog_cond_skip(c,
+				c->values + pos + 1, len - pos - 1);
+		}
+		if (match)
+			return pos;
+	}
+
+	for (i = 0; i < cs->num_conds && len; i++) {
+		c = &cs->conds[i];
+		c->prev = c->values[len - 1];
+		c->have_prev = TRUE;
+	}
+
+	return len;
+}
+
+static void analog_stage_reset(struct soft_trigger_analog_stage *cs)
+{
+	int i;
+
+	for (i = 0; i < cs->num_conds; i++) {
+		cs->conds[i].armed = FALSE;
+		cs->conds[i].have_prev = FALSE;
+	}
+}
+
+/* Like pre_trigger_send(), for the frames of an analog payload. */
+static void analog_pre_trigger_send(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int samples,
+		int *pre_trigger_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog out;
+	uint8_t *buf;
+	int len, keep;
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &out;
+	out.encoding = &sta->encoding;
+	out.meaning = &sta->meaning;
+	out.spec = &sta->spec;
+
+	buf = analog->data;
+	len = samples * sta->frame_size;
+	keep = history_split(&sta->pre_trigger, &buf, &len);
+	if (keep > 0) {
+		out.data = history_data(&sta->pre_trigger, keep);
+		out.num_samples = keep / sta->frame_size;
+		sr_session_send(sta->sdi, &packet);
+	}
+	if (len > 0) {
+		out.data = buf;
+		out.num_samples = len / sta->frame_size;
+		sr_session_send(sta->sdi, &packet);
+	}
+
+	history_reset(&sta->pre_trigger);
+	if (pre_trigger_samples)
+		*pre_trigger_samples = (keep + len) / sta->frame_size;
+}
+
+/*
+ * Check an analog payload, of one or several channels. The payload's
+ * raw samples get compared against thresholds in raw units, there is no
+ * conversion to values. When the trigger fires, the pre-trigger data
+ * and the trigger marker get sent.
+ *
+ * Returns the offset (in samples) within the payload of where the
+ * trigger occurred, or -1 if not triggered. The trigger starts over at
+ * its first stage after it fired.
+ */
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog, int *pre_trigger_samples)
+{
+	struct soft_trigger_analog_stage *cs;
+	struct soft_trigger_analog_cond *c;
+	double unit_scale, unit_offset;
+	size_t num_samples, pos, len, match;
+	int num_channels, offset, i;
+
+	if (sta->num_stages == 0)
+		/* No stages supplied, client error. */
+		return SR_ERR_ARG;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	num_samples = analog->num_samples;
+	if (!num_channels || !num_samples)
+		return -1;
+	analog_layout_update(sta, analog, num_channels);
+
+	offset = -1;
+	pos = 0;
+	while (pos < num_samples && offset < 0) {
+		cs = &sta->stages[sta->cur_stage];
+		if (analog_stage_prepare(sta, cs, analog,
+				&unit_scale, &unit_offset) != SR_OK)
+			break;
+
+		len = MIN(num_samples - pos, ANALOG_BLOCK_SIZE);
+		for (i = 0; i < cs->num_conds; i++) {
+			c = &cs->conds[i];
+			sr_analog_to_raw_units(analog,
+				pos * num_channels + c->pos, num_channels,
+				len, c->values, &unit_scale, &unit_offset);
+		}
+		match = analog_stage_match(cs, len);
+		for (i = 0; i < cs->num_conds; i++) {
+			c = &cs->conds[i];
+			c->prev_value = c->prev * unit_scale + unit_offset;
+		}
+		if (match == len) {
+			pos += len;
+			continue;
+		}
+
+		/* Matched on the current stage at this position. */
+		pos += match;
+		if (sta->cur_stage + 1 < sta->num_stages) {
+			/* Advance to next stage. */
+			sta->cur_stage++;
+			analog_stage_reset(&sta->stages[sta->cur_stage]);
+			pos++;
+			continue;
+		}
+
+		/* Matched on last stage, send pre-trigger data. */
+		analog_pre_trigger_send(sta, analog, pos, pre_trigger_samples);
+
+		/* Fire trigger. */
+		offset = pos;
+		std_session_send_df_trigger(sta->sdi);
+
+		sta->cur_stage = 0;
+		analog_stage_reset(&sta->stages[0]);
+	}
+
+	if (offset == -1)
+		history_append(&sta->pre_trigger, analog->data,
+			num_samples * sta->frame_size);
 
 	return offset;
 }
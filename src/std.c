@@ -939,3 +939,73 @@ SR_PRIV int std_dummy_set_handshake(struct sr_serial_dev_inst *serial,
 
 	return SR_OK;
 }
+
+/**
+ * Determine which part of a sample memory needs to get downloaded.
+ *
+ * Deep memory devices often capture more than the user asked for, e.g.
+ * when the memory is used as a ring buffer before the trigger. Callers
+ * pass the number of units (samples, or memory rows) which hold valid
+ * data, the position of the trigger among them, and the number of units
+ * which are wanted before and from the trigger on. The window is moved
+ * such that it stays within the valid data. Without a trigger the most
+ * recent units are taken.
+ *
+ * @param[out] win The window to download.
+ * @param[in] captured The number of valid units, oldest first.
+ * @param[in] trigger The trigger position, or STD_DOWNLOAD_NO_TRIGGER.
+ * @param[in] pre The number of units wanted before the trigger.
+ * @param[in] post The number of units wanted from the trigger on.
+ *
+ * @private
+ */
+SR_PRIV void std_download_window(struct std_download_window *win,
+	uint64_t captured, uint64_t trigger, uint64_t pre, uint64_t post)
+{
+	uint64_t want;
+
+	want = pre + post;
+	if (want < pre || want > captured)
+		want = captured;
+	if (trigger >= captured)
+		trigger = STD_DOWNLOAD_NO_TRIGGER;
+
+	if (trigger == STD_DOWNLOAD_NO_TRIGGER) {
+		win->first = captured - want;
+	} else {
+		win->first = (trigger > pre) ? trigger - pre : 0;
+		if (win->first + want > captured)
+			win->first = captured - want;
+	}
+	win->count = want;
+	win->trigger = STD_DOWNLOAD_NO_TRIGGER;
+	if (trigger != STD_DOWNLOAD_NO_TRIGGER)
+		win->trigger = trigger - win->first;
+}
+
+/**
+ * Determine the download window from sample limit and capture ratio.
+ *
+ * @param[out] win The window to download.
+ * @param[in] captured The number of valid samples, oldest first.
+ * @param[in] trigger The trigger position, or STD_DOWNLOAD_NO_TRIGGER.
+ * @param[in] limit The number of samples wanted, 0 for all of them.
+ * @param[in] ratio The percentage of samples wanted before the trigger.
+ *
+ * @private
+ */
+SR_PRIV void std_download_window_limits(struct std_download_window *win,
+	uint64_t captured, uint64_t trigger, uint64_t limit, uint64_t ratio)
+{
+	uint64_t pre;
+
+	if (!limit)
+		limit = captured;
+	if (ratio > 100)
+		ratio = 100;
+	pre = 0;
+	if (trigger != STD_DOWNLOAD_NO_TRIGGER)
+		pre = limit * ratio / 100;
+
+	std_download_window(win, captured, trigger, pre, limit - pre);
+}
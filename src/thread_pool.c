@@ -0,0 +1,414 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Worker threads which the modules and drivers of a context share.
+ *
+ * Rather than every module starting threads of its own, CPU bound work
+ * like formatting or compression gets cut into tasks, which run on the
+ * context's pool (see sr_task_run()). The pool starts with the first
+ * task. Each worker has a queue of its own, tasks which a worker
+ * submits go to the front of its queue, others get spread across the
+ * workers. Workers run the tasks from the front of their queue, and
+ * steal from the back of the others' queues when theirs is empty.
+ * Threads which wait for a group of tasks run queued tasks meanwhile,
+ * so tasks may submit and wait for further tasks.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "thread-pool"
+/** @endcond */
+
+/* Upper bound of the pool's threads. */
+#define POOL_MAX_THREADS 256
+
+struct pool_task {
+	sr_task_func func;
+	void *data;
+	struct sr_task_group *group;
+};
+
+struct pool_worker {
+	struct sr_thread_pool *pool;
+	GThread *thread;
+	GMutex mutex;
+	GQueue tasks;
+};
+
+struct sr_thread_pool {
+	unsigned int num_workers;
+	struct pool_worker *workers;
+	/* Tasks in all of the queues, workers sleep while there are none. */
+	gint queued;
+	GMutex mutex;
+	GCond cond;
+	gboolean stop;
+	/* Where tasks from outside of the pool go next. */
+	guint next;
+};
+
+/* The worker which runs on the current thread, if any. */
+static GPrivate current_worker;
+
+static struct pool_task *worker_pop(struct pool_worker *worker,
+		gboolean front)
+{
+	struct pool_task *task;
+
+	g_mutex_lock(&worker->mutex);
+	task = front ? g_queue_pop_head(&worker->tasks) :
+		g_queue_pop_tail(&worker->tasks);
+	g_mutex_unlock(&worker->mutex);
+
+	return task;
+}
+
+/* Take a task from the own queue, else steal one of another worker. */
+static struct pool_task *pool_take(struct sr_thread_pool *pool,
+		struct pool_worker *self)
+{
+	struct pool_task *task;
+	unsigned int start, i;
+
+	if (!g_atomic_int_get(&pool->queued))
+		return NULL;
+
+	task = NULL;
+	if (self)
+		task = worker_pop(self, TRUE);
+	start = self ? self - pool->workers : 0;
+	for (i = 0; !task && i < pool->num_workers; i++)
+		task = worker_pop(&pool->workers[(start + i) % pool->num_workers],
+			FALSE);
+	if (task)
+		g_atomic_int_add(&pool->queued, -1);
+
+	return task;
+}
+
+static void task_run(struct pool_task *task)
+{
+	struct sr_task_group *group;
+
+	group = task->group;
+	task->func(task->data);
+	g_free(task);
+	if (!group)
+		return;
+
+	g_mutex_lock(&group->mutex);
+	if (!--group->pending)
+		g_cond_broadcast(&group->cond);
+	g_mutex_unlock(&group->mutex);
+}
+
+static gpointer worker_thread(gpointer data)
+{
+	struct pool_worker *worker;
+	struct sr_thread_pool *pool;
+	struct pool_task *task;
+
+	worker = data;
+	pool = worker->pool;
+	g_private_set(&current_worker, worker);
+	for (;;) {
+		if ((task = pool_take(pool, worker))) {
+			task_run(task);
+			continue;
+		}
+		g_mutex_lock(&pool->mutex);
+		while (!pool->stop && !g_atomic_int_get(&pool->queued))
+			g_cond_wait(&pool->cond, &pool->mutex);
+		if (pool->stop && !g_atomic_int_get(&pool->queued)) {
+			g_mutex_unlock(&pool->mutex);
+			break;
+		}
+		g_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+
+static void pool_free(struct sr_thread_pool *pool)
+{
+	unsigned int i;
+
+	g_mutex_lock(&pool->mutex);
+	pool->stop = TRUE;
+	g_cond_broadcast(&pool->cond);
+	g_mutex_unlock(&pool->mutex);
+	for (i = 0; i < pool->num_workers; i++) {
+		if (pool->workers[i].thread)
+			g_thread_join(pool->workers[i].thread);
+		g_mutex_clear(&pool->workers[i].mutex);
+	}
+	g_mutex_clear(&pool->mutex);
+	g_cond_clear(&pool->cond);
+	g_free(pool->workers);
+	g_free(pool);
+}
+
+static struct sr_thread_pool *pool_new(unsigned int num_threads)
+{
+	struct sr_thread_pool *pool;
+	struct pool_worker *worker;
+	GError *error;
+	unsigned int i;
+
+	pool = g_malloc0(sizeof(*pool));
+	pool->workers = g_malloc0_n(num_threads, sizeof(pool->workers[0]));
+	g_mutex_init(&pool->mutex);
+	g_cond_init(&pool->cond);
+	for (i = 0; i < num_threads; i++) {
+		worker = &pool->workers[i];
+		worker->pool = pool;
+		g_mutex_init(&worker->mutex);
+		g_queue_init(&worker->tasks);
+		pool->num_workers++;
+		error = NULL;
+		worker->thread = g_thread_try_new("sr-pool", worker_thread,
+			worker, &error);
+		if (worker->thread)
+			continue;
+		sr_err("Cannot create pool thread: %s.", error->message);
+		g_error_free(error);
+		pool_free(pool);
+		return NULL;
+	}
+	sr_dbg("Started %u pool thread(s).", num_threads);
+
+	return pool;
+}
+
+/* The context's pool, which gets started on first use. */
+static struct sr_thread_pool *pool_get(struct sr_context *ctx)
+{
+	struct sr_thread_pool *pool;
+	unsigned int num_threads;
+
+	g_mutex_lock(&ctx->pool_mutex);
+	if (!ctx->pool && !ctx->pool_failed) {
+		num_threads = ctx->pool_threads;
+		if (!num_threads)
+			num_threads = g_get_num_processors();
+		ctx->pool = pool_new(MIN(num_threads, POOL_MAX_THREADS));
+		ctx->pool_failed = !ctx->pool;
+	}
+	pool = ctx->pool;
+	g_mutex_unlock(&ctx->pool_mutex);
+
+	return pool;
+}
+
+/**
+ * Set the number of threads of the context's shared worker pool.
+ *
+ * Modules and drivers run CPU bound work like formatting and compression
+ * on this pool, rather than starting threads of their own. A running
+ * pool finishes its tasks, and gets started again with the new number
+ * of threads when it is needed next.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param num_threads The number of threads, 0 for one per CPU.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid context passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_thread_pool_size_set(struct sr_context *ctx,
+		unsigned int num_threads)
+{
+	struct sr_thread_pool *pool;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->pool_mutex);
+	pool = ctx->pool;
+	ctx->pool = NULL;
+	ctx->pool_failed = FALSE;
+	ctx->pool_threads = num_threads;
+	g_mutex_unlock(&ctx->pool_mutex);
+	if (pool)
+		pool_free(pool);
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of threads of the context's shared worker pool.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ *
+ * @return The number of threads which the pool runs (when started).
+ *
+ * @since 0.6.0
+ */
+SR_API unsigned int sr_thread_pool_size_get(struct sr_context *ctx)
+{
+	unsigned int num_threads;
+
+	if (!ctx)
+		return 0;
+
+	g_mutex_lock(&ctx->pool_mutex);
+	num_threads = ctx->pool_threads;
+	g_mutex_unlock(&ctx->pool_mutex);
+	if (!num_threads)
+		num_threads = g_get_num_processors();
+
+	return MIN(num_threads, POOL_MAX_THREADS);
+}
+
+/**
+ * Stop the context's shared worker pool, after its tasks completed.
+ *
+ * @param ctx The context to use.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_pool_exit(struct sr_context *ctx)
+{
+	if (ctx->pool)
+		pool_free(ctx->pool);
+	ctx->pool = NULL;
+}
+
+/**
+ * Prepare a group of tasks, see sr_task_run() and sr_task_group_wait().
+ *
+ * @param group The group.
+ *
+ * @private
+ */
+SR_PRIV void sr_task_group_init(struct sr_task_group *group)
+{
+	g_mutex_init(&group->mutex);
+	g_cond_init(&group->cond);
+	group->pending = 0;
+}
+
+/**
+ * Release a group of tasks, all of which must have completed.
+ *
+ * @param group The group.
+ *
+ * @private
+ */
+SR_PRIV void sr_task_group_clear(struct sr_task_group *group)
+{
+	g_mutex_clear(&group->mutex);
+	g_cond_clear(&group->cond);
+}
+
+/**
+ * Run a task on the context's shared worker pool.
+ *
+ * The task runs right away on the calling thread when the pool cannot
+ * be started.
+ *
+ * @param ctx The context whose pool to use.
+ * @param group The group to account the task in, or NULL.
+ * @param func The routine to run.
+ * @param data The argument to pass to @a func.
+ *
+ * @private
+ */
+SR_PRIV void sr_task_run(struct sr_context *ctx, struct sr_task_group *group,
+		sr_task_func func, void *data)
+{
+	struct sr_thread_pool *pool;
+	struct pool_worker *worker;
+	struct pool_task *task;
+
+	pool = pool_get(ctx);
+	if (!pool) {
+		func(data);
+		return;
+	}
+
+	task = g_malloc(sizeof(*task));
+	task->func = func;
+	task->data = data;
+	task->group = group;
+	if (group) {
+		g_mutex_lock(&group->mutex);
+		group->pending++;
+		g_mutex_unlock(&group->mutex);
+	}
+
+	/* Tasks of a worker stay with it, until other workers steal them. */
+	worker = g_private_get(&current_worker);
+	if (!worker || worker->pool != pool)
+		worker = &pool->workers[g_atomic_int_add(&pool->next, 1) %
+			pool->num_workers];
+	g_atomic_int_inc(&pool->queued);
+	g_mutex_lock(&worker->mutex);
+	g_queue_push_head(&worker->tasks, task);
+	g_mutex_unlock(&worker->mutex);
+
+	g_mutex_lock(&pool->mutex);
+	g_cond_signal(&pool->cond);
+	g_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * Wait until all tasks of a group completed.
+ *
+ * Queued tasks (of any group) run on the calling thread meanwhile.
+ *
+ * @param ctx The context whose pool runs the tasks.
+ * @param group The group.
+ *
+ * @private
+ */
+SR_PRIV void sr_task_group_wait(struct sr_context *ctx,
+		struct sr_task_group *group)
+{
+	struct sr_thread_pool *pool;
+	struct pool_task *task;
+	gint64 end_time;
+
+	pool = ctx->pool;
+	g_mutex_lock(&group->mutex);
+	while (group->pending) {
+		g_mutex_unlock(&group->mutex);
+		task = pool ? pool_take(pool, g_private_get(&current_worker)) :
+			NULL;
+		if (task) {
+			task_run(task);
+			g_mutex_lock(&group->mutex);
+			continue;
+		}
+		/* Look for tasks to help with now and then. */
+		end_time = g_get_monotonic_time() + G_TIME_SPAN_MILLISECOND;
+		g_mutex_lock(&group->mutex);
+		if (group->pending)
+			g_cond_wait_until(&group->cond, &group->mutex, end_time);
+	}
+	g_mutex_unlock(&group->mutex);
+}
@@ -0,0 +1,316 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * CPU affinity and scheduling of the threads which libsigrok runs.
+ *
+ * Each kind of thread, like the USB event thread or the transform
+ * workers, can be restricted to a set of CPUs, and run with real-time
+ * (SCHED_FIFO) scheduling at a given priority. Settings of a session
+ * take precedence over those of its context. Threads apply the settings
+ * when they start, pool workers before each job when the settings or
+ * the session changed since. By default threads run on all CPUs with
+ * normal scheduling, only the USB thread runs at the lowest real-time
+ * priority when sr_session_usb_thread_set() asked for it.
+ *
+ * Both typically need privileges, threads which cannot have their
+ * settings applied run as they are, with a warning.
+ */
+
+#define _GNU_SOURCE
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef G_OS_UNIX
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "thread-sched"
+/** @endcond */
+
+/* What the current pool worker thread applied most recently. */
+struct applied_sched {
+	const struct sr_session *session;
+	enum sr_thread_class cls;
+	gint serial;
+};
+
+/* Changes with each change of the settings, see sr_thread_sched_enter(). */
+static gint sched_serial = 1;
+static GPrivate applied_key = G_PRIVATE_INIT(g_free);
+
+static int parse_cpus(const char *cpus, uint64_t *mask)
+{
+	char **ranges, *end;
+	unsigned long first, last, cpu;
+	int i, ret;
+
+	memset(mask, 0, sizeof(uint64_t) * SR_THREAD_CPU_WORDS);
+	if (!cpus || !*cpus)
+		return SR_OK;
+
+	/* Lists of CPUs and ranges of them, like "2-3,6". */
+	ranges = g_strsplit(cpus, ",", 0);
+	ret = SR_OK;
+	for (i = 0; ranges[i] && ret == SR_OK; i++) {
+		first = strtoul(ranges[i], &end, 10);
+		last = first;
+		if (end != ranges[i] && *end == '-')
+			last = strtoul(end + 1, &end, 10);
+		if (end == ranges[i] || *end || last < first ||
+				last >= SR_THREAD_CPU_WORDS * 64) {
+			sr_err("Invalid CPU list '%s'.", cpus);
+			ret = SR_ERR_ARG;
+			break;
+		}
+		for (cpu = first; cpu <= last; cpu++)
+			mask[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+	}
+	g_strfreev(ranges);
+
+	return ret;
+}
+
+static int sched_set(struct sr_thread_sched *sched, enum sr_thread_class cls,
+		const char *cpus, int priority)
+{
+	struct sr_thread_sched tmp;
+	int ret;
+
+	if ((unsigned int)cls >= SR_THREAD_CLASSES || priority < 0 ||
+			priority > 99)
+		return SR_ERR_ARG;
+
+	if ((ret = parse_cpus(cpus, tmp.cpus)) != SR_OK)
+		return ret;
+	tmp.priority = priority;
+	tmp.configured = TRUE;
+	sched[cls] = tmp;
+	g_atomic_int_inc(&sched_serial);
+
+	return SR_OK;
+}
+
+/* An empty mask leaves the affinity alone, or with @a reset allows all CPUs. */
+static void apply_affinity(const uint64_t *mask, gboolean reset)
+{
+#if defined(__linux__) && defined(CPU_SET)
+	cpu_set_t set;
+	unsigned int cpu;
+	gboolean any;
+	int ret;
+
+	CPU_ZERO(&set);
+	any = FALSE;
+	for (cpu = 0; cpu < SR_THREAD_CPU_WORDS * 64 && cpu < CPU_SETSIZE;
+			cpu++) {
+		if (!(mask[cpu / 64] & ((uint64_t)1 << (cpu % 64))))
+			continue;
+		CPU_SET(cpu, &set);
+		any = TRUE;
+	}
+	if (!any && !reset)
+		return;
+	if (!any) {
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			CPU_SET(cpu, &set);
+	}
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (ret != 0)
+		sr_warn("Cannot set the CPU affinity: %s.", g_strerror(ret));
+#else
+	unsigned int i;
+
+	(void)reset;
+	for (i = 0; i < SR_THREAD_CPU_WORDS; i++) {
+		if (mask[i]) {
+			sr_warn("CPU affinity is not supported on this platform.");
+			return;
+		}
+	}
+#endif
+}
+
+static void apply_priority(int priority)
+{
+#ifdef G_OS_UNIX
+	struct sched_param param;
+	int policy, ret;
+
+	memset(&param, 0, sizeof(param));
+	policy = SCHED_OTHER;
+	if (priority) {
+		policy = SCHED_FIFO;
+		param.sched_priority = CLAMP(priority,
+			sched_get_priority_min(SCHED_FIFO),
+			sched_get_priority_max(SCHED_FIFO));
+	}
+	ret = pthread_setschedparam(pthread_self(), policy, &param);
+	if (ret != 0 && priority)
+		sr_warn("Cannot use real-time scheduling: %s.", g_strerror(ret));
+	else if (priority)
+		sr_dbg("Using real-time scheduling, priority %d.",
+			param.sched_priority);
+#else
+	if (priority)
+		sr_warn("Real-time scheduling is not supported on this platform.");
+#endif
+}
+
+/*
+ * Without settings, threads keep what they inherited, unless @a reset
+ * says that they applied other settings before.
+ */
+static void apply(const struct sr_session *session, enum sr_thread_class cls,
+		int default_priority, gboolean reset)
+{
+	const struct sr_thread_sched *sched;
+	static const uint64_t all_cpus[SR_THREAD_CPU_WORDS];
+
+	sched = NULL;
+	if (session && session->thread_sched[cls].configured)
+		sched = &session->thread_sched[cls];
+	else if (session && session->ctx &&
+			session->ctx->thread_sched[cls].configured)
+		sched = &session->ctx->thread_sched[cls];
+
+	if (!sched) {
+		apply_affinity(all_cpus, reset);
+		if (default_priority || reset)
+			apply_priority(default_priority);
+		return;
+	}
+	apply_affinity(sched->cpus, reset);
+	apply_priority(sched->priority);
+}
+
+/**
+ * Apply the CPU affinity and scheduling settings to the calling thread.
+ *
+ * @param session The session the thread works for, may be NULL.
+ * @param cls The kind of thread.
+ * @param default_priority The priority without settings, 0 for normal
+ *                         scheduling.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_sched_apply(const struct sr_session *session,
+		enum sr_thread_class cls, int default_priority)
+{
+	apply(session, cls, default_priority, FALSE);
+}
+
+/**
+ * Apply the settings to a pool worker thread, when they changed.
+ *
+ * Pool workers, like those of GThreadPool, run jobs of different
+ * sessions and kinds. Call this before each job, it only takes effect
+ * when the settings differ from what the thread applied before.
+ *
+ * @param session The session the job works for, may be NULL.
+ * @param cls The kind of thread.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_sched_enter(const struct sr_session *session,
+		enum sr_thread_class cls)
+{
+	struct applied_sched *applied;
+	gboolean reset;
+	gint serial;
+
+	serial = g_atomic_int_get(&sched_serial);
+	applied = g_private_get(&applied_key);
+	if (applied && applied->session == session && applied->cls == cls &&
+			applied->serial == serial)
+		return;
+	reset = applied != NULL;
+	if (!applied) {
+		applied = g_malloc0(sizeof(*applied));
+		g_private_set(&applied_key, applied);
+	}
+	applied->session = session;
+	applied->cls = cls;
+	applied->serial = serial;
+	apply(session, cls, 0, reset);
+}
+
+/**
+ * Set where and how a kind of thread runs, for all sessions of a context.
+ *
+ * Sessions can override this with sr_session_thread_sched_set(). Threads
+ * which already run pick up changes when they get started next, pool
+ * workers before their next job.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param cls The kind of thread.
+ * @param cpus The CPUs to run on, like "2-3,6". NULL or "" for all.
+ * @param priority The SCHED_FIFO priority from 1 to 99, 0 for normal
+ *                 scheduling.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_thread_sched_set(struct sr_context *ctx,
+		enum sr_thread_class cls, const char *cpus, int priority)
+{
+	if (!ctx) {
+		sr_err("%s: ctx was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	return sched_set(ctx->thread_sched, cls, cpus, priority);
+}
+
+/**
+ * Set where and how a kind of thread runs, for one session.
+ *
+ * Takes precedence over the settings of the session's context, see
+ * sr_thread_sched_set().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cls The kind of thread.
+ * @param cpus The CPUs to run on, like "2-3,6". NULL or "" for all.
+ * @param priority The SCHED_FIFO priority from 1 to 99, 0 for normal
+ *                 scheduling.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_thread_sched_set(struct sr_session *session,
+		enum sr_thread_class cls, const char *cpus, int priority)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	return sched_set(session->thread_sched, cls, cpus, priority);
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/changes"
+
+/*
+ * Turn logic packets into SR_DF_LOGIC_RLE packets, which only hold the
+ * sample values at changes, and the number of samples until the next
+ * change. Mostly idle signals then shrink to a few runs per packet.
+ * Consumers which don't understand RLE packets get them expanded by
+ * the session, so this transform should be the last in the chain.
+ */
+
+struct context {
+	const struct sr_logic_ops *ops;
+	size_t unitsize;
+	GByteArray *values;
+	GArray *run_lengths;
+	struct sr_datafeed_logic_rle rle;
+	struct sr_datafeed_packet packet;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	(void)options;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->values = g_byte_array_new();
+	ctx->run_lengths = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data, *value;
+	uint64_t count, pos, len;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	if (packet_in->type != SR_DF_LOGIC)
+		return SR_OK;
+
+	logic = packet_in->payload;
+	if (!logic->unitsize || !logic->length)
+		return SR_OK;
+	if (ctx->unitsize != logic->unitsize) {
+		ctx->unitsize = logic->unitsize;
+		ctx->ops = sr_logic_ops_get(ctx->unitsize);
+	}
+
+	g_byte_array_set_size(ctx->values, 0);
+	g_array_set_size(ctx->run_lengths, 0);
+	data = logic->data;
+	count = logic->length / logic->unitsize;
+	pos = 0;
+	while (pos < count) {
+		value = &data[pos * ctx->unitsize];
+		len = 1 + ctx->ops->find_change(value + ctx->unitsize, value,
+			ctx->unitsize, count - pos - 1);
+		g_byte_array_append(ctx->values, value, ctx->unitsize);
+		g_array_append_val(ctx->run_lengths, len);
+		pos += len;
+	}
+
+	ctx->rle.unitsize = ctx->unitsize;
+	ctx->rle.num_runs = ctx->run_lengths->len;
+	ctx->rle.values = ctx->values->data;
+	ctx->rle.run_lengths = (uint64_t *)(void *)ctx->run_lengths->data;
+	ctx->packet.type = SR_DF_LOGIC_RLE;
+	ctx->packet.payload = &ctx->rle;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_byte_array_free(ctx->values, TRUE);
+	g_array_free(ctx->run_lengths, TRUE);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_transform_module transform_changes = {
+	.id = "changes",
+	.name = "Changes",
+	.desc = "Only keep the logic samples where a channel changes",
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,842 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+/*
+ * Reduce the samplerate by an integer factor. Each block of 'factor'
+ * input samples turns into one output sample (two for the min/max
+ * envelope). Blocks span packet boundaries, partial blocks are kept
+ * until more data arrives.
+ *
+ * Analog modes:
+ * - average: the mean of the block's values (boxcar filter).
+ * - minmax: the block's minimum and maximum, an envelope which keeps
+ *   peaks visible.
+ * - cic: a third order CIC filter. Its kernel gets applied directly
+ *   at the output rate, instead of running integrators at the input
+ *   rate, which would lose precision in float arithmetics during long
+ *   captures.
+ *
+ * Logic modes:
+ * - glitch-safe: channels which changed anywhere within a block toggle
+ *   in that block's output sample. Pulses shorter than a block remain
+ *   visible as one output sample.
+ * - sample: take the block's first sample.
+ *
+ * The inner loops use independent accumulators, and bitwise reductions
+ * on whole samples, which compilers turn into SIMD code.
+ */
+
+#define CIC_ORDER	3
+#define CIC_FACTOR_MAX	65536
+
+enum analog_mode {
+	ANALOG_AVERAGE,
+	ANALOG_MINMAX,
+	ANALOG_CIC,
+};
+
+enum logic_mode {
+	LOGIC_GLITCH_SAFE,
+	LOGIC_SAMPLE,
+};
+
+/* Decimation state of analog packets for a set of channels. */
+struct analog_stream {
+	size_t num_channels;
+	uint64_t phase;
+	double *sum;
+	float *min, *max;
+	/* CIC kernel input, two copies of the window per channel. */
+	float *history;
+	size_t hist_pos;
+};
+
+struct context {
+	uint64_t factor;
+	enum analog_mode analog_mode;
+	enum logic_mode logic_mode;
+	/* Logic state. */
+	size_t unitsize;
+	uint64_t logic_phase;
+	gboolean have_ref;
+	uint8_t ref[sizeof(uint64_t)];
+	uint8_t acc[sizeof(uint64_t)];
+	uint8_t *ref_wide, *acc_wide;
+	GByteArray *logic_out;
+	GArray *rle_lengths;
+	/* Analog state, streams are keyed by their first channel. */
+	GHashTable *streams;
+	double *cic_kernel;
+	size_t cic_len;
+	float *conv_buf;
+	size_t conv_size;
+	float *out_buf;
+	size_t out_size;
+	struct sr_analog_encoding encoding;
+	/* Output packets. */
+	GSList *meta_config;
+	struct sr_datafeed_packet packet;
+	union {
+		struct sr_datafeed_meta meta;
+		struct sr_datafeed_logic logic;
+		struct sr_datafeed_logic_rle rle;
+		struct sr_datafeed_analog analog;
+	} payload;
+};
+
+static void stream_free(void *data)
+{
+	struct analog_stream *stream;
+
+	stream = data;
+	g_free(stream->sum);
+	g_free(stream->min);
+	g_free(stream->max);
+	g_free(stream->history);
+	g_free(stream);
+}
+
+static struct analog_stream *stream_get(struct context *ctx,
+		void *key, size_t num_channels)
+{
+	struct analog_stream *stream;
+
+	stream = g_hash_table_lookup(ctx->streams, key);
+	if (stream && stream->num_channels == num_channels)
+		return stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->num_channels = num_channels;
+	stream->sum = g_malloc0_n(num_channels, sizeof(stream->sum[0]));
+	stream->min = g_malloc0_n(num_channels, sizeof(stream->min[0]));
+	stream->max = g_malloc0_n(num_channels, sizeof(stream->max[0]));
+	if (ctx->analog_mode == ANALOG_CIC) {
+		stream->history = g_malloc0_n(2 * ctx->cic_len * num_channels,
+			sizeof(stream->history[0]));
+	}
+	g_hash_table_replace(ctx->streams, key, stream);
+
+	return stream;
+}
+
+/*
+ * The CIC filter's impulse response is the boxcar of length 'factor',
+ * convolved with itself CIC_ORDER times. Each convolution with a boxcar
+ * is a moving sum.
+ */
+static void cic_kernel_create(struct context *ctx)
+{
+	double *kernel, *tmp, run, norm;
+	size_t len, i, order;
+
+	len = CIC_ORDER * (ctx->factor - 1) + 1;
+	kernel = g_malloc0_n(len, sizeof(kernel[0]));
+	tmp = g_malloc0_n(len, sizeof(tmp[0]));
+	kernel[0] = 1.0;
+	for (order = 0; order < CIC_ORDER; order++) {
+		run = 0.0;
+		for (i = 0; i < len; i++) {
+			run += kernel[i];
+			if (i >= ctx->factor)
+				run -= kernel[i - ctx->factor];
+			tmp[i] = run;
+		}
+		memcpy(kernel, tmp, len * sizeof(kernel[0]));
+	}
+	norm = pow((double)ctx->factor, CIC_ORDER);
+	for (i = 0; i < len; i++)
+		kernel[i] /= norm;
+	g_free(tmp);
+
+	ctx->cic_kernel = kernel;
+	ctx->cic_len = len;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options,
+		"factor"));
+	if (!ctx->factor) {
+		sr_err("Decimation factor must be at least 1.");
+		goto err_out;
+	}
+
+	mode = g_variant_get_string(g_hash_table_lookup(options, "analog"),
+		NULL);
+	if (g_ascii_strcasecmp(mode, "average") == 0) {
+		ctx->analog_mode = ANALOG_AVERAGE;
+	} else if (g_ascii_strcasecmp(mode, "minmax") == 0) {
+		ctx->analog_mode = ANALOG_MINMAX;
+	} else if (g_ascii_strcasecmp(mode, "cic") == 0) {
+		ctx->analog_mode = ANALOG_CIC;
+	} else {
+		sr_err("Unknown analog decimation mode '%s'.", mode);
+		goto err_out;
+	}
+
+	mode = g_variant_get_string(g_hash_table_lookup(options, "logic"),
+		NULL);
+	if (g_ascii_strcasecmp(mode, "glitch-safe") == 0) {
+		ctx->logic_mode = LOGIC_GLITCH_SAFE;
+	} else if (g_ascii_strcasecmp(mode, "sample") == 0) {
+		ctx->logic_mode = LOGIC_SAMPLE;
+	} else {
+		sr_err("Unknown logic decimation mode '%s'.", mode);
+		goto err_out;
+	}
+
+	if (ctx->analog_mode == ANALOG_CIC) {
+		if (ctx->factor > CIC_FACTOR_MAX) {
+			sr_err("CIC decimation supports factors up to %d.",
+				CIC_FACTOR_MAX);
+			goto err_out;
+		}
+		cic_kernel_create(ctx);
+	}
+
+	ctx->logic_out = g_byte_array_new();
+	ctx->rle_lengths = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+	ctx->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+
+	return SR_OK;
+
+err_out:
+	g_free(ctx);
+	t->priv = NULL;
+	return SR_ERR_ARG;
+}
+
+static void reset(struct context *ctx)
+{
+	ctx->unitsize = 0;
+	ctx->logic_phase = 0;
+	ctx->have_ref = FALSE;
+	g_free(ctx->ref_wide);
+	ctx->ref_wide = NULL;
+	g_free(ctx->acc_wide);
+	ctx->acc_wide = NULL;
+	g_hash_table_remove_all(ctx->streams);
+}
+
+/* {{{ logic */
+
+/* OR together the differences of samples to a reference sample. */
+static void logic_diff_or(uint8_t *acc, const uint8_t *ref,
+		const uint8_t *data, size_t unitsize, size_t count)
+{
+	size_t i, k;
+
+#define LOGIC_DIFF_OR(type) do { \
+	type r, a, v; \
+	memcpy(&r, ref, sizeof(r)); \
+	memcpy(&a, acc, sizeof(a)); \
+	for (i = 0; i < count; i++) { \
+		memcpy(&v, &data[i * sizeof(v)], sizeof(v)); \
+		a |= v ^ r; \
+	} \
+	memcpy(acc, &a, sizeof(a)); \
+} while (0)
+
+	switch (unitsize) {
+	case 1:
+		LOGIC_DIFF_OR(uint8_t);
+		break;
+	case 2:
+		LOGIC_DIFF_OR(uint16_t);
+		break;
+	case 4:
+		LOGIC_DIFF_OR(uint32_t);
+		break;
+	case 8:
+		LOGIC_DIFF_OR(uint64_t);
+		break;
+	default:
+		for (i = 0; i < count; i++, data += unitsize) {
+			for (k = 0; k < unitsize; k++)
+				acc[k] |= data[k] ^ ref[k];
+		}
+		break;
+	}
+
+#undef LOGIC_DIFF_OR
+}
+
+static int logic_setup(struct context *ctx, size_t unitsize)
+{
+	if (ctx->unitsize == unitsize)
+		return SR_OK;
+	if (ctx->unitsize) {
+		sr_err("Logic unit size changed from %zu to %zu.",
+			ctx->unitsize, unitsize);
+		return SR_ERR_DATA;
+	}
+
+	ctx->unitsize = unitsize;
+	ctx->logic_phase = 0;
+	ctx->have_ref = FALSE;
+	if (unitsize > sizeof(ctx->ref)) {
+		ctx->ref_wide = g_malloc0(unitsize);
+		ctx->acc_wide = g_malloc0(unitsize);
+	}
+
+	return SR_OK;
+}
+
+static uint8_t *logic_ref(struct context *ctx)
+{
+	return ctx->ref_wide ? ctx->ref_wide : ctx->ref;
+}
+
+static uint8_t *logic_acc(struct context *ctx)
+{
+	return ctx->acc_wide ? ctx->acc_wide : ctx->acc;
+}
+
+/*
+ * Account for 'count' samples of the current block. The data holds
+ * 'count' samples, or one sample which repeats when 'repeat' is set.
+ */
+static void logic_block_add(struct context *ctx, const uint8_t *data,
+		size_t count, gboolean repeat)
+{
+	uint8_t *ref, *acc;
+
+	ref = logic_ref(ctx);
+	acc = logic_acc(ctx);
+	if (!ctx->have_ref) {
+		memcpy(ref, data, ctx->unitsize);
+		ctx->have_ref = TRUE;
+	}
+
+	if (ctx->logic_mode == LOGIC_SAMPLE) {
+		if (!ctx->logic_phase)
+			memcpy(acc, data, ctx->unitsize);
+	} else {
+		logic_diff_or(acc, ref, data, ctx->unitsize,
+			repeat ? 1 : count);
+	}
+	ctx->logic_phase += count;
+}
+
+/* Complete the current block, returns its output sample. */
+static const uint8_t *logic_block_end(struct context *ctx)
+{
+	uint8_t *ref, *acc;
+	size_t k;
+
+	ref = logic_ref(ctx);
+	acc = logic_acc(ctx);
+	if (ctx->logic_mode == LOGIC_SAMPLE) {
+		memcpy(ref, acc, ctx->unitsize);
+	} else {
+		for (k = 0; k < ctx->unitsize; k++)
+			ref[k] ^= acc[k];
+	}
+	memset(acc, 0, ctx->unitsize);
+	ctx->logic_phase = 0;
+
+	return ref;
+}
+
+static int receive_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_packet **packet_out)
+{
+	const uint8_t *data;
+	uint64_t count, take;
+	int ret;
+
+	ret = logic_setup(ctx, logic->unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	g_byte_array_set_size(ctx->logic_out, 0);
+	data = logic->data;
+	count = logic->length / logic->unitsize;
+	while (count) {
+		take = MIN(count, ctx->factor - ctx->logic_phase);
+		logic_block_add(ctx, data, take, FALSE);
+		data += take * ctx->unitsize;
+		count -= take;
+		if (ctx->logic_phase == ctx->factor) {
+			g_byte_array_append(ctx->logic_out,
+				logic_block_end(ctx), ctx->unitsize);
+		}
+	}
+
+	if (!ctx->logic_out->len) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	ctx->payload.logic.unitsize = ctx->unitsize;
+	ctx->payload.logic.length = ctx->logic_out->len;
+	ctx->payload.logic.data = ctx->logic_out->data;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->payload.logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Append output samples to the RLE output, extend the last run if possible. */
+static void rle_emit(struct context *ctx, const uint8_t *value,
+		uint64_t count)
+{
+	size_t runs;
+	uint8_t *last;
+
+	runs = ctx->rle_lengths->len;
+	if (runs) {
+		last = &ctx->logic_out->data[(runs - 1) * ctx->unitsize];
+		if (memcmp(last, value, ctx->unitsize) == 0) {
+			g_array_index(ctx->rle_lengths, uint64_t, runs - 1) += count;
+			return;
+		}
+	}
+	g_byte_array_append(ctx->logic_out, value, ctx->unitsize);
+	g_array_append_val(ctx->rle_lengths, count);
+}
+
+/*
+ * Runs translate to output runs without expanding them. Blocks which
+ * are covered by a run entirely all decimate to the run's value.
+ */
+static int receive_logic_rle(struct context *ctx,
+		const struct sr_datafeed_logic_rle *rle,
+		struct sr_datafeed_packet **packet_out)
+{
+	const uint8_t *value;
+	uint64_t run, length, take, blocks;
+	int ret;
+
+	ret = logic_setup(ctx, rle->unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	g_byte_array_set_size(ctx->logic_out, 0);
+	g_array_set_size(ctx->rle_lengths, 0);
+	value = rle->values;
+	for (run = 0; run < rle->num_runs; run++, value += ctx->unitsize) {
+		length = rle->run_lengths[run];
+		while (length) {
+			take = MIN(length, ctx->factor - ctx->logic_phase);
+			logic_block_add(ctx, value, take, TRUE);
+			length -= take;
+			if (ctx->logic_phase < ctx->factor)
+				break;
+			rle_emit(ctx, logic_block_end(ctx), 1);
+			blocks = length / ctx->factor;
+			if (blocks) {
+				memcpy(logic_ref(ctx), value, ctx->unitsize);
+				rle_emit(ctx, value, blocks);
+				length -= blocks * ctx->factor;
+			}
+		}
+	}
+
+	if (!ctx->rle_lengths->len) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	ctx->payload.rle.unitsize = ctx->unitsize;
+	ctx->payload.rle.num_runs = ctx->rle_lengths->len;
+	ctx->payload.rle.values = ctx->logic_out->data;
+	ctx->payload.rle.run_lengths = (uint64_t *)(void *)ctx->rle_lengths->data;
+	ctx->packet.type = SR_DF_LOGIC_RLE;
+	ctx->packet.payload = &ctx->payload.rle;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* }}} */
+/* {{{ analog */
+
+static double sum_floats(const float *v, size_t count)
+{
+	double lane0, lane1, lane2, lane3;
+	size_t i;
+
+	lane0 = lane1 = lane2 = lane3 = 0.0;
+	for (i = 0; i + 4 <= count; i += 4) {
+		lane0 += v[i + 0];
+		lane1 += v[i + 1];
+		lane2 += v[i + 2];
+		lane3 += v[i + 3];
+	}
+	for (; i < count; i++)
+		lane0 += v[i];
+
+	return (lane0 + lane1) + (lane2 + lane3);
+}
+
+static void minmax_floats(const float *v, size_t count,
+		float *min, float *max)
+{
+	float lo[4], hi[4];
+	size_t i, k;
+
+	for (k = 0; k < 4; k++) {
+		lo[k] = *min;
+		hi[k] = *max;
+	}
+	for (i = 0; i + 4 <= count; i += 4) {
+		for (k = 0; k < 4; k++) {
+			lo[k] = v[i + k] < lo[k] ? v[i + k] : lo[k];
+			hi[k] = v[i + k] > hi[k] ? v[i + k] : hi[k];
+		}
+	}
+	for (; i < count; i++) {
+		lo[0] = v[i] < lo[0] ? v[i] : lo[0];
+		hi[0] = v[i] > hi[0] ? v[i] : hi[0];
+	}
+	for (k = 0; k < 4; k++) {
+		*min = lo[k] < *min ? lo[k] : *min;
+		*max = hi[k] > *max ? hi[k] : *max;
+	}
+}
+
+static double dot_kernel(const float *v, const double *kernel, size_t count)
+{
+	double lane0, lane1, lane2, lane3;
+	size_t i;
+
+	lane0 = lane1 = lane2 = lane3 = 0.0;
+	for (i = 0; i + 4 <= count; i += 4) {
+		lane0 += v[i + 0] * kernel[i + 0];
+		lane1 += v[i + 1] * kernel[i + 1];
+		lane2 += v[i + 2] * kernel[i + 2];
+		lane3 += v[i + 3] * kernel[i + 3];
+	}
+	for (; i < count; i++)
+		lane0 += v[i] * kernel[i];
+
+	return (lane0 + lane1) + (lane2 + lane3);
+}
+
+/* Account for 'count' samples of the current block. */
+static void analog_block_add(struct context *ctx, struct analog_stream *stream,
+		const float *data, size_t count)
+{
+	size_t nch, i, c, len;
+	float *hist;
+
+	nch = stream->num_channels;
+	if (!stream->phase) {
+		for (c = 0; c < nch; c++) {
+			stream->sum[c] = 0.0;
+			stream->min[c] = INFINITY;
+			stream->max[c] = -INFINITY;
+		}
+	}
+
+	switch (ctx->analog_mode) {
+	case ANALOG_AVERAGE:
+		if (nch == 1) {
+			stream->sum[0] += sum_floats(data, count);
+			break;
+		}
+		for (i = 0; i < count; i++) {
+			for (c = 0; c < nch; c++)
+				stream->sum[c] += data[i * nch + c];
+		}
+		break;
+	case ANALOG_MINMAX:
+		if (nch == 1) {
+			minmax_floats(data, count, &stream->min[0], &stream->max[0]);
+			break;
+		}
+		for (i = 0; i < count; i++) {
+			for (c = 0; c < nch; c++) {
+				if (data[i * nch + c] < stream->min[c])
+					stream->min[c] = data[i * nch + c];
+				if (data[i * nch + c] > stream->max[c])
+					stream->max[c] = data[i * nch + c];
+			}
+		}
+		break;
+	case ANALOG_CIC:
+		len = ctx->cic_len;
+		for (i = 0; i < count; i++) {
+			for (c = 0; c < nch; c++) {
+				hist = &stream->history[c * 2 * len];
+				hist[stream->hist_pos] = data[i * nch + c];
+				hist[stream->hist_pos + len] = data[i * nch + c];
+			}
+			if (++stream->hist_pos == len)
+				stream->hist_pos = 0;
+		}
+		break;
+	}
+	stream->phase += count;
+}
+
+/* Complete the current block, write its output samples. */
+static size_t analog_block_end(struct context *ctx,
+		struct analog_stream *stream, float *out)
+{
+	size_t nch, c;
+	const float *window;
+
+	nch = stream->num_channels;
+	stream->phase = 0;
+	switch (ctx->analog_mode) {
+	case ANALOG_AVERAGE:
+		for (c = 0; c < nch; c++)
+			out[c] = stream->sum[c] / ctx->factor;
+		return 1;
+	case ANALOG_MINMAX:
+		for (c = 0; c < nch; c++) {
+			out[c] = stream->min[c];
+			out[nch + c] = stream->max[c];
+		}
+		return 2;
+	case ANALOG_CIC:
+		for (c = 0; c < nch; c++) {
+			window = &stream->history[c * 2 * ctx->cic_len];
+			window += stream->hist_pos;
+			out[c] = dot_kernel(window, ctx->cic_kernel, ctx->cic_len);
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+static int receive_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct analog_stream *stream;
+	size_t nch, total, remain, take, outputs;
+	const float *data;
+	int ret;
+
+	nch = g_slist_length(analog->meaning->channels);
+	if (!nch || !analog->num_samples) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	stream = stream_get(ctx, analog->meaning->channels->data, nch);
+
+	total = analog->num_samples * nch;
+	if (ctx->conv_size < total) {
+		g_free(ctx->conv_buf);
+		ctx->conv_buf = g_malloc(total * sizeof(ctx->conv_buf[0]));
+		ctx->conv_size = total;
+	}
+	ret = sr_analog_to_float(analog, ctx->conv_buf);
+	if (ret != SR_OK)
+		return ret;
+
+	/* Up to two output samples per block, for the envelope. */
+	outputs = (stream->phase + analog->num_samples) / ctx->factor;
+	total = 2 * outputs * nch;
+	if (ctx->out_size < total) {
+		g_free(ctx->out_buf);
+		ctx->out_buf = g_malloc(total * sizeof(ctx->out_buf[0]));
+		ctx->out_size = total;
+	}
+
+	data = ctx->conv_buf;
+	remain = analog->num_samples;
+	outputs = 0;
+	while (remain) {
+		take = MIN(remain, ctx->factor - stream->phase);
+		analog_block_add(ctx, stream, data, take);
+		data += take * nch;
+		remain -= take;
+		if (stream->phase == ctx->factor) {
+			outputs += analog_block_end(ctx, stream,
+				&ctx->out_buf[outputs * nch]);
+		}
+	}
+
+	if (!outputs) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->payload.analog = *analog;
+	ctx->payload.analog.data = ctx->out_buf;
+	ctx->payload.analog.num_samples = outputs;
+	ctx->payload.analog.encoding = &ctx->encoding;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->payload.analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* }}} */
+
+/* Announce the reduced samplerate to subsequent consumers. */
+static int receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_config *src;
+	struct sr_config *cfg;
+	uint64_t rate;
+	GSList *l;
+
+	g_slist_free_full(ctx->meta_config, (GDestroyNotify)sr_config_free);
+	ctx->meta_config = NULL;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE) {
+			cfg = sr_config_new(src->key, g_variant_ref(src->data));
+		} else {
+			rate = g_variant_get_uint64(src->data) / ctx->factor;
+			if (ctx->analog_mode == ANALOG_MINMAX)
+				rate *= 2;
+			cfg = sr_config_new(src->key, g_variant_new_uint64(rate));
+		}
+		ctx->meta_config = g_slist_append(ctx->meta_config, cfg);
+	}
+
+	ctx->payload.meta.config = ctx->meta_config;
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->payload.meta;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	if (ctx->factor == 1)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		reset(ctx);
+		break;
+	case SR_DF_META:
+		return receive_meta(ctx, packet_in->payload, packet_out);
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in->payload, packet_out);
+	case SR_DF_LOGIC_RLE:
+		return receive_logic_rle(ctx, packet_in->payload, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in->payload, packet_out);
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	reset(ctx);
+	g_hash_table_destroy(ctx->streams);
+	g_byte_array_free(ctx->logic_out, TRUE);
+	g_array_free(ctx->rle_lengths, TRUE);
+	g_slist_free_full(ctx->meta_config, (GDestroyNotify)sr_config_free);
+	g_free(ctx->cic_kernel);
+	g_free(ctx->conv_buf);
+	g_free(ctx->out_buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per output sample", NULL, NULL },
+	{ "analog", "Analog mode", "Decimation of analog values: average, minmax, or cic", NULL, NULL },
+	{ "logic", "Logic mode", "Decimation of logic samples: glitch-safe, or sample", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("average"));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("average")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("minmax")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("cic")));
+		options[2].def = g_variant_ref_sink(g_variant_new_string("glitch-safe"));
+		options[2].values = g_slist_append(options[2].values,
+			g_variant_ref_sink(g_variant_new_string("glitch-safe")));
+		options[2].values = g_slist_append(options[2].values,
+			g_variant_ref_sink(g_variant_new_string("sample")));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the samplerate by an integer factor",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
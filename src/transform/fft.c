@@ -0,0 +1,469 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/fft"
+
+/*
+ * Replace analog values by their magnitude spectra. Each frame of
+ * 'size' values gets windowed and transformed, consecutive frames
+ * overlap by the given percentage. A spectrum has (size / 2 + 1) bins,
+ * bin k is at the frequency k * samplerate / size. The values are
+ * amplitudes, in the unit of the input: a sine of amplitude A shows
+ * up with the value A in its bin.
+ *
+ * Output packets carry the SR_MQFLAG_SPECTRUM flag. They hold all the
+ * spectra which the input packet completed, one after another. Packets
+ * with several channels hold interleaved values like in the time
+ * domain. Input packets which complete no frame get dropped.
+ *
+ * The transform of a real frame of size N is a complex transform of
+ * size N/2 over the even and odd values, split up afterwards. The plan
+ * with the window, twiddle factors and bit reversal table gets set up
+ * once.
+ */
+
+#define FFT_SIZE_MIN	4
+#define FFT_SIZE_MAX	(1 << 20)
+
+enum window_type {
+	WINDOW_RECTANGULAR,
+	WINDOW_HANN,
+	WINDOW_HAMMING,
+	WINDOW_BLACKMAN,
+};
+
+struct fft_plan {
+	/* Frame size N, and the size M = N / 2 of the complex transform. */
+	size_t size, half;
+	float *window;
+	/* Amplitude normalization, from the window's coherent gain. */
+	double norm;
+	/* Twiddle factors of the complex transform, M / 2 of them. */
+	double *tw_re, *tw_im;
+	/* Twiddle factors of the split, M + 1 of them. */
+	double *split_re, *split_im;
+	size_t *bitrev;
+	/* Work buffers. */
+	double *re, *im;
+};
+
+/* Frames in progress for a set of channels. */
+struct fft_stream {
+	size_t num_channels;
+	/* One frame buffer per channel, of the plan's size. */
+	float *frames;
+	size_t fill;
+};
+
+struct context {
+	struct fft_plan plan;
+	size_t hop;
+	GHashTable *streams;
+	float *values;
+	size_t values_size;
+	float *out;
+	size_t out_size;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static void plan_free(struct fft_plan *plan)
+{
+	g_free(plan->window);
+	g_free(plan->tw_re);
+	g_free(plan->tw_im);
+	g_free(plan->split_re);
+	g_free(plan->split_im);
+	g_free(plan->bitrev);
+	g_free(plan->re);
+	g_free(plan->im);
+}
+
+static void plan_create(struct fft_plan *plan, size_t size,
+		enum window_type window)
+{
+	size_t n, m, bits, i, r, b;
+	double sum, x;
+
+	plan->size = n = size;
+	plan->half = m = size / 2;
+
+	plan->window = g_malloc_n(n, sizeof(plan->window[0]));
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		x = 2 * G_PI * i / n;
+		switch (window) {
+		case WINDOW_HANN:
+			plan->window[i] = 0.5 - 0.5 * cos(x);
+			break;
+		case WINDOW_HAMMING:
+			plan->window[i] = 0.54 - 0.46 * cos(x);
+			break;
+		case WINDOW_BLACKMAN:
+			plan->window[i] = 0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x);
+			break;
+		case WINDOW_RECTANGULAR:
+		default:
+			plan->window[i] = 1;
+			break;
+		}
+		sum += plan->window[i];
+	}
+	plan->norm = 1 / sum;
+
+	plan->tw_re = g_malloc_n(m / 2 + 1, sizeof(double));
+	plan->tw_im = g_malloc_n(m / 2 + 1, sizeof(double));
+	for (i = 0; i <= m / 2; i++) {
+		plan->tw_re[i] = cos(2 * G_PI * i / m);
+		plan->tw_im[i] = -sin(2 * G_PI * i / m);
+	}
+	plan->split_re = g_malloc_n(m + 1, sizeof(double));
+	plan->split_im = g_malloc_n(m + 1, sizeof(double));
+	for (i = 0; i <= m; i++) {
+		plan->split_re[i] = cos(2 * G_PI * i / n);
+		plan->split_im[i] = -sin(2 * G_PI * i / n);
+	}
+
+	for (bits = 0; ((size_t)1 << bits) < m; bits++)
+		;
+	plan->bitrev = g_malloc_n(m, sizeof(plan->bitrev[0]));
+	for (i = 0; i < m; i++) {
+		r = 0;
+		for (b = 0; b < bits; b++)
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		plan->bitrev[i] = r;
+	}
+
+	plan->re = g_malloc_n(m + 1, sizeof(double));
+	plan->im = g_malloc_n(m + 1, sizeof(double));
+}
+
+/* In-place radix-2 transform of the plan's work buffers. */
+static void fft_complex(const struct fft_plan *plan)
+{
+	double *re, *im, wr, wi, tr, ti;
+	size_t m, len, half, step, start, k;
+
+	re = plan->re;
+	im = plan->im;
+	m = plan->half;
+	for (len = 2; len <= m; len <<= 1) {
+		half = len / 2;
+		step = m / len;
+		for (start = 0; start < m; start += len) {
+			for (k = 0; k < half; k++) {
+				wr = plan->tw_re[k * step];
+				wi = plan->tw_im[k * step];
+				tr = re[start + half + k] * wr - im[start + half + k] * wi;
+				ti = re[start + half + k] * wi + im[start + half + k] * wr;
+				re[start + half + k] = re[start + k] - tr;
+				im[start + half + k] = im[start + k] - ti;
+				re[start + k] += tr;
+				im[start + k] += ti;
+			}
+		}
+	}
+}
+
+/* Write the magnitude spectrum of a frame, with the given output stride. */
+static void spectrum(const struct fft_plan *plan, const float *frame,
+		float *out, size_t stride)
+{
+	double *re, *im, ev_re, ev_im, od_re, od_im, xr, xi, scale;
+	size_t m, k, j;
+
+	re = plan->re;
+	im = plan->im;
+	m = plan->half;
+	for (k = 0; k < m; k++) {
+		j = plan->bitrev[k];
+		re[j] = frame[2 * k] * plan->window[2 * k];
+		im[j] = frame[2 * k + 1] * plan->window[2 * k + 1];
+	}
+	fft_complex(plan);
+	re[m] = re[0];
+	im[m] = im[0];
+
+	/*
+	 * Split Z[k] into the transforms of the even and odd values:
+	 * E[k] = (Z[k] + conj(Z[M - k])) / 2
+	 * O[k] = -i (Z[k] - conj(Z[M - k])) / 2
+	 * X[k] = E[k] + W^k O[k]
+	 */
+	for (k = 0; k <= m; k++) {
+		ev_re = (re[k] + re[m - k]) / 2;
+		ev_im = (im[k] - im[m - k]) / 2;
+		od_re = (im[k] + im[m - k]) / 2;
+		od_im = -(re[k] - re[m - k]) / 2;
+		xr = ev_re + od_re * plan->split_re[k] - od_im * plan->split_im[k];
+		xi = ev_im + od_re * plan->split_im[k] + od_im * plan->split_re[k];
+		scale = (k == 0 || k == m) ? plan->norm : 2 * plan->norm;
+		out[k * stride] = sqrt(xr * xr + xi * xi) * scale;
+	}
+}
+
+static void stream_free(void *data)
+{
+	struct fft_stream *stream;
+
+	stream = data;
+	g_free(stream->frames);
+	g_free(stream);
+}
+
+static struct fft_stream *stream_get(struct context *ctx,
+		void *key, size_t num_channels)
+{
+	struct fft_stream *stream;
+
+	stream = g_hash_table_lookup(ctx->streams, key);
+	if (stream && stream->num_channels == num_channels)
+		return stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->num_channels = num_channels;
+	stream->frames = g_malloc0_n(num_channels * ctx->plan.size,
+		sizeof(stream->frames[0]));
+	g_hash_table_replace(ctx->streams, key, stream);
+
+	return stream;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	enum window_type window;
+	uint64_t size, overlap;
+	const char *s;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	size = g_variant_get_uint64(g_hash_table_lookup(options, "size"));
+	if (size < FFT_SIZE_MIN || size > FFT_SIZE_MAX || (size & (size - 1))) {
+		sr_err("FFT size must be a power of two from %d to %d.",
+			FFT_SIZE_MIN, FFT_SIZE_MAX);
+		return SR_ERR_ARG;
+	}
+	overlap = g_variant_get_uint64(g_hash_table_lookup(options, "overlap"));
+	if (overlap >= 100) {
+		sr_err("Overlap must be below 100 percent.");
+		return SR_ERR_ARG;
+	}
+	s = g_variant_get_string(g_hash_table_lookup(options, "window"), NULL);
+	if (g_ascii_strcasecmp(s, "rectangular") == 0) {
+		window = WINDOW_RECTANGULAR;
+	} else if (g_ascii_strcasecmp(s, "hann") == 0) {
+		window = WINDOW_HANN;
+	} else if (g_ascii_strcasecmp(s, "hamming") == 0) {
+		window = WINDOW_HAMMING;
+	} else if (g_ascii_strcasecmp(s, "blackman") == 0) {
+		window = WINDOW_BLACKMAN;
+	} else {
+		sr_err("Unknown window '%s'.", s);
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	plan_create(&ctx->plan, size, window);
+	ctx->hop = size - size * overlap / 100;
+	if (!ctx->hop)
+		ctx->hop = 1;
+	ctx->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+
+	return SR_OK;
+}
+
+static int receive_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct fft_stream *stream;
+	size_t nch, n, bins, frames, total, remain, take, i, c;
+	const float *src;
+	float *frame;
+	int ret;
+
+	*packet_out = NULL;
+	nch = g_slist_length(analog->meaning->channels);
+	if (!nch || !analog->num_samples)
+		return SR_OK;
+	stream = stream_get(ctx, analog->meaning->channels->data, nch);
+
+	total = analog->num_samples * nch;
+	if (ctx->values_size < total) {
+		g_free(ctx->values);
+		ctx->values = g_malloc(total * sizeof(ctx->values[0]));
+		ctx->values_size = total;
+	}
+	if ((ret = sr_analog_to_float(analog, ctx->values)) != SR_OK)
+		return ret;
+
+	n = ctx->plan.size;
+	bins = ctx->plan.half + 1;
+	frames = 0;
+	if (stream->fill + analog->num_samples >= n)
+		frames = (stream->fill + analog->num_samples - n) / ctx->hop + 1;
+	if (ctx->out_size < frames * bins * nch) {
+		g_free(ctx->out);
+		ctx->out_size = frames * bins * nch;
+		ctx->out = g_malloc(ctx->out_size * sizeof(ctx->out[0]));
+	}
+
+	src = ctx->values;
+	remain = analog->num_samples;
+	frames = 0;
+	while (remain) {
+		take = MIN(remain, n - stream->fill);
+		for (c = 0; c < nch; c++) {
+			frame = &stream->frames[c * n + stream->fill];
+			for (i = 0; i < take; i++)
+				frame[i] = src[i * nch + c];
+		}
+		src += take * nch;
+		remain -= take;
+		stream->fill += take;
+		if (stream->fill < n)
+			break;
+		for (c = 0; c < nch; c++) {
+			frame = &stream->frames[c * n];
+			spectrum(&ctx->plan, frame,
+				&ctx->out[frames * bins * nch + c], nch);
+			memmove(frame, frame + ctx->hop,
+				(n - ctx->hop) * sizeof(frame[0]));
+		}
+		stream->fill = n - ctx->hop;
+		frames++;
+	}
+	if (!frames)
+		return SR_OK;
+
+	ctx->meaning = *analog->meaning;
+	ctx->meaning.mqflags |= SR_MQFLAG_SPECTRUM;
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->analog = *analog;
+	ctx->analog.data = ctx->out;
+	ctx->analog.num_samples = frames * bins;
+	ctx->analog.meaning = &ctx->meaning;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		g_hash_table_remove_all(ctx->streams);
+		break;
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in->payload, packet_out);
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->streams);
+	plan_free(&ctx->plan);
+	g_free(ctx->values);
+	g_free(ctx->out);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "size", "Size", "Number of values per frame, a power of two", NULL, NULL },
+	{ "window", "Window", "Window function: rectangular, hann, hamming, or blackman", NULL, NULL },
+	{ "overlap", "Overlap", "Overlap of consecutive frames in percent", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1024));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("hann"));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("rectangular")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("hann")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("hamming")));
+		options[1].values = g_slist_append(options[1].values,
+			g_variant_ref_sink(g_variant_new_string("blackman")));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint64(50));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_fft = {
+	.id = "fft",
+	.name = "FFT",
+	.desc = "Replace analog values by their magnitude spectra",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,580 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/filter"
+
+/*
+ * Filter analog values. The filter is either an FIR filter with the
+ * given taps, a cascade of the given biquads, or both (the FIR filter
+ * runs first). Without explicit coefficients, a cascade of identical
+ * low-pass, high-pass or notch biquads gets designed for the cutoff
+ * frequency and Q, once the samplerate is known.
+ *
+ * Each channel keeps its filter state across packets. Packets get
+ * filtered as a whole: the FIR filter runs over the channel's history
+ * followed by the packet's values, the biquads run one after another
+ * over the whole packet.
+ */
+
+enum filter_type {
+	FILTER_LOWPASS,
+	FILTER_HIGHPASS,
+	FILTER_NOTCH,
+};
+
+/* Normalized coefficients, a0 is 1. */
+struct biquad {
+	double b0, b1, b2, a1, a2;
+};
+
+/* Filter state of one channel. */
+struct channel_state {
+	/* The last (num_taps - 1) input values. */
+	float *fir_history;
+	/* Two state variables per biquad (transposed direct form II). */
+	double *iir_state;
+};
+
+struct context {
+	enum filter_type type;
+	double cutoff;
+	double q;
+	uint64_t stages;
+	uint64_t samplerate;
+	/* FIR taps, in reverse order. */
+	double *taps;
+	size_t num_taps;
+	struct biquad *biquads;
+	size_t num_biquads;
+	gboolean designed;
+	GHashTable *channels;
+	float *values;
+	size_t values_size;
+	float *fir_buf;
+	size_t fir_buf_size;
+	double *work;
+	size_t work_size;
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static void channel_state_free(void *data)
+{
+	struct channel_state *state;
+
+	state = data;
+	g_free(state->fir_history);
+	g_free(state->iir_state);
+	g_free(state);
+}
+
+/* Parse a list of numbers, separated by commas. */
+static int parse_coefficients(const char *spec, double **values, size_t *count)
+{
+	char **items;
+	size_t i, n;
+	int ret;
+
+	items = g_strsplit(spec, ",", 0);
+	n = g_strv_length(items);
+	*values = g_malloc0_n(n ? n : 1, sizeof(double));
+	*count = n;
+	ret = SR_OK;
+	for (i = 0; i < n; i++) {
+		g_strstrip(items[i]);
+		if (sr_atod_ascii(items[i], &(*values)[i]) != SR_OK) {
+			sr_err("Invalid filter coefficient '%s'.", items[i]);
+			ret = SR_ERR_ARG;
+			break;
+		}
+	}
+	g_strfreev(items);
+	if (ret != SR_OK) {
+		g_free(*values);
+		*values = NULL;
+		*count = 0;
+	}
+
+	return ret;
+}
+
+static int parse_taps(struct context *ctx, const char *spec)
+{
+	double *taps, tmp;
+	size_t n, i;
+
+	if (parse_coefficients(spec, &taps, &n) != SR_OK)
+		return SR_ERR_ARG;
+	if (!n) {
+		g_free(taps);
+		return SR_OK;
+	}
+
+	/* Reversed taps turn the convolution into dot products. */
+	for (i = 0; i < n / 2; i++) {
+		tmp = taps[i];
+		taps[i] = taps[n - 1 - i];
+		taps[n - 1 - i] = tmp;
+	}
+	ctx->taps = taps;
+	ctx->num_taps = n;
+
+	return SR_OK;
+}
+
+/* Biquads are "b0,b1,b2,a0,a1,a2" groups, separated by semicolons. */
+static int parse_biquads(struct context *ctx, const char *spec)
+{
+	char **groups;
+	double *c;
+	size_t num_groups, i, n;
+	int ret;
+
+	groups = g_strsplit(spec, ";", 0);
+	num_groups = g_strv_length(groups);
+	ctx->biquads = g_malloc0_n(num_groups ? num_groups : 1,
+		sizeof(ctx->biquads[0]));
+	ret = SR_OK;
+	for (i = 0; i < num_groups; i++) {
+		if (parse_coefficients(groups[i], &c, &n) != SR_OK) {
+			ret = SR_ERR_ARG;
+			break;
+		}
+		if (n != 6 || c[3] == 0.0) {
+			sr_err("Invalid biquad '%s', need b0,b1,b2,a0,a1,a2.",
+				groups[i]);
+			g_free(c);
+			ret = SR_ERR_ARG;
+			break;
+		}
+		ctx->biquads[i].b0 = c[0] / c[3];
+		ctx->biquads[i].b1 = c[1] / c[3];
+		ctx->biquads[i].b2 = c[2] / c[3];
+		ctx->biquads[i].a1 = c[4] / c[3];
+		ctx->biquads[i].a2 = c[5] / c[3];
+		g_free(c);
+	}
+	g_strfreev(groups);
+	ctx->num_biquads = num_groups;
+
+	return ret;
+}
+
+/* Filter design after the Audio EQ Cookbook by Robert Bristow-Johnson. */
+static int design_biquads(struct context *ctx)
+{
+	struct biquad bq;
+	double w0, cw, alpha, a0;
+	size_t i;
+
+	if (!ctx->samplerate) {
+		sr_err("Unknown samplerate, cannot design the filter.");
+		return SR_ERR_DATA;
+	}
+	if (ctx->cutoff <= 0 || ctx->cutoff >= ctx->samplerate / 2.0) {
+		sr_err("Cutoff frequency %g Hz is not below half the "
+			"samplerate.", ctx->cutoff);
+		return SR_ERR_DATA;
+	}
+
+	w0 = 2 * G_PI * ctx->cutoff / ctx->samplerate;
+	cw = cos(w0);
+	alpha = sin(w0) / (2 * ctx->q);
+	a0 = 1 + alpha;
+	switch (ctx->type) {
+	case FILTER_LOWPASS:
+		bq.b0 = (1 - cw) / 2;
+		bq.b1 = 1 - cw;
+		bq.b2 = (1 - cw) / 2;
+		break;
+	case FILTER_HIGHPASS:
+		bq.b0 = (1 + cw) / 2;
+		bq.b1 = -(1 + cw);
+		bq.b2 = (1 + cw) / 2;
+		break;
+	case FILTER_NOTCH:
+	default:
+		bq.b0 = 1;
+		bq.b1 = -2 * cw;
+		bq.b2 = 1;
+		break;
+	}
+	bq.b0 /= a0;
+	bq.b1 /= a0;
+	bq.b2 /= a0;
+	bq.a1 = -2 * cw / a0;
+	bq.a2 = (1 - alpha) / a0;
+
+	g_free(ctx->biquads);
+	ctx->biquads = g_malloc_n(ctx->stages, sizeof(ctx->biquads[0]));
+	for (i = 0; i < ctx->stages; i++)
+		ctx->biquads[i] = bq;
+	ctx->num_biquads = ctx->stages;
+	sr_dbg("Designed %zu biquad(s) for %g Hz at %" PRIu64 " Hz samplerate.",
+		ctx->num_biquads, ctx->cutoff, ctx->samplerate);
+
+	return SR_OK;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *s;
+	int ret;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->channels = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, channel_state_free);
+
+	s = g_variant_get_string(g_hash_table_lookup(options, "type"), NULL);
+	if (g_ascii_strcasecmp(s, "lowpass") == 0) {
+		ctx->type = FILTER_LOWPASS;
+	} else if (g_ascii_strcasecmp(s, "highpass") == 0) {
+		ctx->type = FILTER_HIGHPASS;
+	} else if (g_ascii_strcasecmp(s, "notch") == 0) {
+		ctx->type = FILTER_NOTCH;
+	} else {
+		sr_err("Unknown filter type '%s'.", s);
+		ret = SR_ERR_ARG;
+		goto err_out;
+	}
+	ctx->cutoff = g_variant_get_double(g_hash_table_lookup(options, "cutoff"));
+	ctx->q = g_variant_get_double(g_hash_table_lookup(options, "q"));
+	ctx->stages = g_variant_get_uint64(g_hash_table_lookup(options, "stages"));
+	if (ctx->q <= 0 || !ctx->stages) {
+		sr_err("Q and the number of stages must be positive.");
+		ret = SR_ERR_ARG;
+		goto err_out;
+	}
+
+	s = g_variant_get_string(g_hash_table_lookup(options, "taps"), NULL);
+	if ((ret = parse_taps(ctx, s)) != SR_OK)
+		goto err_out;
+	s = g_variant_get_string(g_hash_table_lookup(options, "biquads"), NULL);
+	if (*s && (ret = parse_biquads(ctx, s)) != SR_OK)
+		goto err_out;
+
+	/* Explicit coefficients take precedence over a designed filter. */
+	ctx->designed = !ctx->num_taps && !ctx->num_biquads;
+	if (ctx->designed && ctx->cutoff <= 0) {
+		sr_err("Either a cutoff frequency, or coefficients are needed.");
+		ret = SR_ERR_ARG;
+		goto err_out;
+	}
+
+	return SR_OK;
+
+err_out:
+	g_hash_table_destroy(ctx->channels);
+	g_free(ctx->taps);
+	g_free(ctx->biquads);
+	g_free(ctx);
+	t->priv = NULL;
+	return ret;
+}
+
+static void set_samplerate(struct context *ctx, uint64_t samplerate)
+{
+	if (samplerate == ctx->samplerate)
+		return;
+	ctx->samplerate = samplerate;
+	if (ctx->designed) {
+		/* The coefficients get redone for the next packet. */
+		g_free(ctx->biquads);
+		ctx->biquads = NULL;
+		ctx->num_biquads = 0;
+		g_hash_table_remove_all(ctx->channels);
+	}
+}
+
+static void receive_header(const struct sr_transform *t, struct context *ctx)
+{
+	GVariant *gvar;
+
+	g_hash_table_remove_all(ctx->channels);
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		set_samplerate(ctx, g_variant_get_uint64(gvar));
+		g_variant_unref(gvar);
+	}
+}
+
+static void receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	GSList *l;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			set_samplerate(ctx, g_variant_get_uint64(src->data));
+	}
+}
+
+static struct channel_state *channel_state_get(struct context *ctx, void *ch)
+{
+	struct channel_state *state;
+
+	state = g_hash_table_lookup(ctx->channels, ch);
+	if (state)
+		return state;
+
+	state = g_malloc0(sizeof(*state));
+	if (ctx->num_taps > 1) {
+		state->fir_history = g_malloc0_n(ctx->num_taps - 1,
+			sizeof(state->fir_history[0]));
+	}
+	if (ctx->num_biquads) {
+		state->iir_state = g_malloc0_n(2 * ctx->num_biquads,
+			sizeof(state->iir_state[0]));
+	}
+	g_hash_table_insert(ctx->channels, ch, state);
+
+	return state;
+}
+
+static double dot(const float *v, const double *taps, size_t count)
+{
+	double lane0, lane1, lane2, lane3;
+	size_t i;
+
+	lane0 = lane1 = lane2 = lane3 = 0.0;
+	for (i = 0; i + 4 <= count; i += 4) {
+		lane0 += v[i + 0] * taps[i + 0];
+		lane1 += v[i + 1] * taps[i + 1];
+		lane2 += v[i + 2] * taps[i + 2];
+		lane3 += v[i + 3] * taps[i + 3];
+	}
+	for (; i < count; i++)
+		lane0 += v[i] * taps[i];
+
+	return (lane0 + lane1) + (lane2 + lane3);
+}
+
+static void run_fir(struct context *ctx, struct channel_state *state,
+		double *work, size_t count)
+{
+	size_t hist, i;
+	float *buf;
+
+	hist = ctx->num_taps - 1;
+	buf = ctx->fir_buf;
+	if (hist)
+		memcpy(buf, state->fir_history, hist * sizeof(buf[0]));
+	for (i = 0; i < count; i++)
+		buf[hist + i] = work[i];
+	for (i = 0; i < count; i++)
+		work[i] = dot(&buf[i], ctx->taps, ctx->num_taps);
+	if (hist) {
+		memcpy(state->fir_history, &buf[count],
+			hist * sizeof(buf[0]));
+	}
+}
+
+static void run_biquad(const struct biquad *bq, double *z,
+		double *work, size_t count)
+{
+	double x, y, z1, z2;
+	size_t i;
+
+	z1 = z[0];
+	z2 = z[1];
+	for (i = 0; i < count; i++) {
+		x = work[i];
+		y = bq->b0 * x + z1;
+		z1 = bq->b1 * x - bq->a1 * y + z2;
+		z2 = bq->b2 * x - bq->a2 * y;
+		work[i] = y;
+	}
+	z[0] = z1;
+	z[1] = z2;
+}
+
+static int receive_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct channel_state *state;
+	size_t nch, count, total, c, i, b;
+	GSList *l;
+	int ret;
+
+	if (ctx->designed && !ctx->num_biquads) {
+		if ((ret = design_biquads(ctx)) != SR_OK)
+			return ret;
+	}
+
+	nch = g_slist_length(analog->meaning->channels);
+	count = analog->num_samples;
+	if (!nch || !count)
+		return SR_OK;
+
+	total = nch * count;
+	if (ctx->values_size < total) {
+		g_free(ctx->values);
+		ctx->values = g_malloc(total * sizeof(ctx->values[0]));
+		ctx->values_size = total;
+	}
+	if (ctx->work_size < count) {
+		g_free(ctx->work);
+		ctx->work = g_malloc(count * sizeof(ctx->work[0]));
+		ctx->work_size = count;
+	}
+	if (ctx->num_taps && ctx->fir_buf_size < count + ctx->num_taps) {
+		g_free(ctx->fir_buf);
+		ctx->fir_buf_size = count + ctx->num_taps;
+		ctx->fir_buf = g_malloc(ctx->fir_buf_size * sizeof(ctx->fir_buf[0]));
+	}
+	if ((ret = sr_analog_to_float(analog, ctx->values)) != SR_OK)
+		return ret;
+
+	for (c = 0, l = analog->meaning->channels; l; c++, l = l->next) {
+		state = channel_state_get(ctx, l->data);
+		for (i = 0; i < count; i++)
+			ctx->work[i] = ctx->values[i * nch + c];
+		if (ctx->num_taps)
+			run_fir(ctx, state, ctx->work, count);
+		for (b = 0; b < ctx->num_biquads; b++) {
+			run_biquad(&ctx->biquads[b], &state->iir_state[2 * b],
+				ctx->work, count);
+		}
+		for (i = 0; i < count; i++)
+			ctx->values[i * nch + c] = ctx->work[i];
+	}
+
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->analog = *analog;
+	ctx->analog.data = ctx->values;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		receive_header(t, ctx);
+		break;
+	case SR_DF_META:
+		receive_meta(ctx, packet_in->payload);
+		break;
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in->payload, packet_out);
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->channels);
+	g_free(ctx->taps);
+	g_free(ctx->biquads);
+	g_free(ctx->values);
+	g_free(ctx->fir_buf);
+	g_free(ctx->work);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "type", "Type", "Designed filter: lowpass, highpass, or notch", NULL, NULL },
+	{ "cutoff", "Cutoff", "Cutoff (or notch) frequency of the designed filter in Hz", NULL, NULL },
+	{ "q", "Q", "Quality factor of the designed filter", NULL, NULL },
+	{ "stages", "Stages", "Number of cascaded biquads of the designed filter", NULL, NULL },
+	{ "taps", "FIR taps", "Comma separated FIR filter taps", NULL, NULL },
+	{ "biquads", "Biquads", "Biquads as b0,b1,b2,a0,a1,a2, separated by semicolons", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("lowpass"));
+		options[0].values = g_slist_append(options[0].values,
+			g_variant_ref_sink(g_variant_new_string("lowpass")));
+		options[0].values = g_slist_append(options[0].values,
+			g_variant_ref_sink(g_variant_new_string("highpass")));
+		options[0].values = g_slist_append(options[0].values,
+			g_variant_ref_sink(g_variant_new_string("notch")));
+		options[1].def = g_variant_ref_sink(g_variant_new_double(0.0));
+		options[2].def = g_variant_ref_sink(g_variant_new_double(G_SQRT2 / 2));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint64(1));
+		options[4].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[5].def = g_variant_ref_sink(g_variant_new_string(""));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_filter = {
+	.id = "filter",
+	.name = "Filter",
+	.desc = "Apply FIR or IIR filters to analog values",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,32 +24,156 @@
 
 #define LOG_PREFIX "transform/invert"
 
+struct context {
+	/* Bits of the selected logic channels, by channel index. */
+	uint8_t *mask;
+	size_t mask_size;
+	/* Selected channels, NULL when all channels are selected. */
+	GSList *channels;
+	/* The mask replicated to a word, for the packets' unit size. */
+	size_t word_unitsize;
+	uint64_t word_mask;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *spec;
+	char **names;
+	GSList *l;
+	size_t i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+
+	spec = g_variant_get_string(g_hash_table_lookup(options, "channels"),
+		NULL);
+	if (!spec || !*spec)
+		return SR_OK;
+
+	names = g_strsplit(spec, ",", 0);
+	for (i = 0; names[i]; i++) {
+		g_strstrip(names[i]);
+		for (l = t->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (g_strcmp0(ch->name, names[i]) == 0)
+				break;
+		}
+		if (!l) {
+			sr_err("Unknown channel '%s'.", names[i]);
+			g_strfreev(names);
+			return SR_ERR_ARG;
+		}
+		ctx->channels = g_slist_append(ctx->channels, ch);
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if ((size_t)ch->index / 8 >= ctx->mask_size) {
+			ctx->mask = g_realloc(ctx->mask, ch->index / 8 + 1);
+			memset(ctx->mask + ctx->mask_size, 0,
+				ch->index / 8 + 1 - ctx->mask_size);
+			ctx->mask_size = ch->index / 8 + 1;
+		}
+		ctx->mask[ch->index / 8] |= 1 << (ch->index % 8);
+	}
+	g_strfreev(names);
+
+	return SR_OK;
+}
+
+static uint8_t mask_byte(const struct context *ctx, size_t idx)
+{
+	if (!ctx->channels)
+		return 0xff;
+
+	return idx < ctx->mask_size ? ctx->mask[idx] : 0;
+}
+
+/*
+ * Invert the selected channels' bits of a number of samples. Unit sizes
+ * which divide the size of a word get handled a word at a time, with
+ * the mask replicated across the word.
+ */
+static void invert_samples(struct context *ctx, uint8_t *data,
+		size_t unitsize, size_t len)
+{
+	uint64_t w;
+	uint8_t m[sizeof(w)];
+	size_t i;
+
+	if (sizeof(w) % unitsize == 0) {
+		if (ctx->word_unitsize != unitsize) {
+			for (i = 0; i < sizeof(m); i++)
+				m[i] = mask_byte(ctx, i % unitsize);
+			memcpy(&ctx->word_mask, m, sizeof(m));
+			ctx->word_unitsize = unitsize;
+		}
+		for (i = 0; i + sizeof(w) <= len; i += sizeof(w)) {
+			memcpy(&w, data + i, sizeof(w));
+			w ^= ctx->word_mask;
+			memcpy(data + i, &w, sizeof(w));
+		}
+		/* The remainder is whole samples, shorter than a word. */
+		for (; i < len; i++)
+			data[i] ^= mask_byte(ctx, i % unitsize);
+		return;
+	}
+
+	for (i = 0; i < len; i++)
+		data[i] ^= mask_byte(ctx, i % unitsize);
+}
+
+static gboolean analog_selected(const struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	GSList *l;
+
+	if (!ctx->channels)
+		return TRUE;
+	for (l = analog->meaning->channels; l; l = l->next) {
+		if (g_slist_find(ctx->channels, l->data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
+	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
+	ctx = t->priv;
 
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
-		}
+		if (!logic->unitsize)
+			break;
+		invert_samples(ctx, logic->data, logic->unitsize,
+			logic->length - logic->length % logic->unitsize);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet_in->payload;
+		if (!rle->unitsize)
+			break;
+		invert_samples(ctx, rle->values, rle->unitsize,
+			rle->num_runs * rle->unitsize);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
+		if (!analog_selected(ctx, analog))
+			break;
 		p = analog->encoding->scale.p;
 		q = analog->encoding->scale.q;
 		if (q > INT64_MAX)
@@ -68,12 +192,43 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_slist_free(ctx->channels);
+	g_free(ctx->mask);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to invert, all channels if empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
 SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
-	.options = NULL,
-	.init = NULL,
+	.options = get_options,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.cleanup = cleanup,
 };
@@ -0,0 +1,334 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/measure"
+
+/*
+ * Measure the enabled logic channels over blocks of 'block' samples.
+ * For each block, three analog packets with one value per channel get
+ * delivered: the frequency (from the rising edges in the block), the
+ * duty cycle, and the number of edges. Unless 'keep' is set, the logic
+ * data is dropped, so consumers only see the low rate statistics.
+ *
+ * The statistics packets go to the consumers directly, they don't pass
+ * through the transforms after this one.
+ *
+ * Blocks of samples get sliced into one bit plane per channel (see
+ * sr_bitslice_load()). The planes are then processed 64 samples at a
+ * time: XOR with the plane shifted by one sample yields the edges, and
+ * population counts give the number of edges and of high samples.
+ */
+
+#define DEFAULT_BLOCK	1000000
+
+struct channel_stats {
+	uint64_t rising;
+	uint64_t falling;
+	uint64_t high;
+	/* Positions of the first and last rising edge in the block. */
+	uint64_t first_rise;
+	uint64_t last_rise;
+	/* State of the last sample, the reference for the next edge. */
+	uint64_t last_bit;
+};
+
+struct context {
+	uint64_t block;
+	gboolean keep;
+	uint64_t samplerate;
+	GSList *channels;
+	size_t num_channels;
+	struct sr_bitslice *bs;
+	struct channel_stats *stats;
+	/* Samples in the current block. */
+	uint64_t block_pos;
+	gboolean have_last;
+	float *values;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	uint64_t block;
+	int *index;
+	GSList *l;
+	size_t i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	block = g_variant_get_uint64(g_hash_table_lookup(options, "block"));
+	if (!block) {
+		sr_err("Block size must be at least one sample.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->block = block;
+	ctx->keep = g_variant_get_boolean(g_hash_table_lookup(options, "keep"));
+	for (l = t->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && ch->enabled)
+			ctx->channels = g_slist_append(ctx->channels, ch);
+	}
+	ctx->num_channels = g_slist_length(ctx->channels);
+	index = g_malloc0_n(ctx->num_channels + 1, sizeof(index[0]));
+	for (l = ctx->channels, i = 0; l; l = l->next, i++)
+		index[i] = ((struct sr_channel *)l->data)->index;
+	ctx->bs = sr_bitslice_new(index, ctx->num_channels);
+	g_free(index);
+	ctx->stats = g_malloc0_n(ctx->num_channels + 1, sizeof(ctx->stats[0]));
+	ctx->values = g_malloc0_n(ctx->num_channels + 1, sizeof(float));
+
+	return SR_OK;
+}
+
+static void block_reset(struct context *ctx)
+{
+	struct channel_stats *cs;
+	uint64_t last_bit;
+	size_t i;
+
+	for (i = 0; i < ctx->num_channels; i++) {
+		cs = &ctx->stats[i];
+		last_bit = cs->last_bit;
+		memset(cs, 0, sizeof(*cs));
+		cs->last_bit = last_bit;
+	}
+	ctx->block_pos = 0;
+}
+
+/* Accumulate @a count samples of a channel's plane, at most 4096. */
+static void plane_measure(struct context *ctx, struct channel_stats *cs,
+		const uint8_t *plane, size_t count)
+{
+	uint64_t w, prev, rise, fall, valid, pos;
+	size_t i, bits;
+
+	if (!ctx->have_last)
+		cs->last_bit = plane[0] & 1;
+
+	for (i = 0; i < count; i += 64) {
+		bits = MIN(count - i, 64);
+		valid = bits == 64 ? ~UINT64_C(0) : (UINT64_C(1) << bits) - 1;
+		w = read_u64le(&plane[i / 8]) & valid;
+		/* Bit k of prev is sample k - 1. */
+		prev = (w << 1) | cs->last_bit;
+		rise = w & ~prev & valid;
+		fall = ~w & prev & valid;
+		cs->high += __builtin_popcountll(w);
+		cs->falling += __builtin_popcountll(fall);
+		if (rise) {
+			pos = ctx->block_pos + i;
+			if (!cs->rising)
+				cs->first_rise = pos + __builtin_ctzll(rise);
+			cs->last_rise = pos + 63 - __builtin_clzll(rise);
+			cs->rising += __builtin_popcountll(rise);
+		}
+		cs->last_bit = (w >> (bits - 1)) & 1;
+	}
+}
+
+static void stats_send(const struct sr_transform *t, struct context *ctx,
+		int mq, int unit, int digits)
+{
+	const struct channel_stats *cs;
+	double span;
+	size_t i;
+
+	for (i = 0; i < ctx->num_channels; i++) {
+		cs = &ctx->stats[i];
+		switch (mq) {
+		case SR_MQ_FREQUENCY:
+			/* Average period between the first and last rising edge. */
+			span = cs->last_rise - cs->first_rise;
+			ctx->values[i] = 0;
+			if (cs->rising > 1 && ctx->samplerate)
+				ctx->values[i] = (cs->rising - 1) *
+					(double)ctx->samplerate / span;
+			break;
+		case SR_MQ_DUTY_CYCLE:
+			ctx->values[i] = 100.0 * cs->high / ctx->block_pos;
+			break;
+		default:
+			ctx->values[i] = cs->rising + cs->falling;
+			break;
+		}
+	}
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning,
+		&ctx->spec, digits);
+	ctx->meaning.mq = mq;
+	ctx->meaning.unit = unit;
+	ctx->meaning.mqflags = 0;
+	ctx->meaning.channels = ctx->channels;
+	ctx->analog.num_samples = 1;
+	ctx->analog.data = ctx->values;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	sr_session_deliver(t->sdi->session, t->sdi, &ctx->packet);
+}
+
+static void block_send(const struct sr_transform *t, struct context *ctx)
+{
+	if (!ctx->num_channels || !ctx->block_pos)
+		return;
+
+	stats_send(t, ctx, SR_MQ_FREQUENCY, SR_UNIT_HERTZ, 3);
+	stats_send(t, ctx, SR_MQ_DUTY_CYCLE, SR_UNIT_PERCENTAGE, 2);
+	stats_send(t, ctx, SR_MQ_COUNT, SR_UNIT_UNITLESS, 0);
+	block_reset(ctx);
+}
+
+static void receive_logic(const struct sr_transform *t, struct context *ctx,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *data;
+	uint64_t remain, count;
+	size_t i;
+
+	if (!logic->unitsize || !ctx->num_channels)
+		return;
+
+	data = logic->data;
+	remain = logic->length / logic->unitsize;
+	while (remain) {
+		count = MIN(remain, ctx->block - ctx->block_pos);
+		count = sr_bitslice_load(ctx->bs, data, logic->unitsize, count);
+		for (i = 0; i < ctx->num_channels; i++)
+			plane_measure(ctx, &ctx->stats[i],
+				sr_bitslice_plane(ctx->bs, i), count);
+		ctx->have_last = TRUE;
+		ctx->block_pos += count;
+		data += count * logic->unitsize;
+		remain -= count;
+		if (ctx->block_pos == ctx->block)
+			block_send(t, ctx);
+	}
+}
+
+static void receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	GSList *l;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			ctx->samplerate = g_variant_get_uint64(src->data);
+	}
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	GVariant *gvar;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		block_reset(ctx);
+		ctx->have_last = FALSE;
+		ctx->samplerate = 0;
+		if (sr_config_get(t->sdi->driver, t->sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			ctx->samplerate = g_variant_get_uint64(gvar);
+			g_variant_unref(gvar);
+		}
+		break;
+	case SR_DF_META:
+		receive_meta(ctx, packet_in->payload);
+		break;
+	case SR_DF_LOGIC:
+		receive_logic(t, ctx, packet_in->payload);
+		if (!ctx->keep)
+			*packet_out = NULL;
+		break;
+	case SR_DF_END:
+		/* Measure what there is of the last block. */
+		block_send(t, ctx);
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free(ctx->channels);
+	sr_bitslice_free(ctx->bs);
+	g_free(ctx->stats);
+	g_free(ctx->values);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "block", "Block", "Number of samples per measurement", NULL, NULL },
+	{ "keep", "Keep", "Pass the logic data on, besides the measurements", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_BLOCK));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_measure = {
+	.id = "measure",
+	.name = "Measure",
+	.desc = "Frequency, duty cycle and edge counts of logic channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,198 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/repack"
+
+/*
+ * Logic data keeps each channel's bit at the position of its index, so
+ * consumers still find the channels. What can go are the bytes at the
+ * end of the samples which hold disabled channels only. The bits of
+ * disabled channels in the remaining bytes get cleared, which makes
+ * runs of identical samples longer.
+ */
+struct context {
+	/* Size of the repacked samples. */
+	size_t unitsize;
+	/* Bits of the enabled logic channels, by channel index. */
+	uint8_t mask[sizeof(uint64_t)];
+	uint64_t word_mask;
+	struct sr_datafeed_packet packet;
+	union {
+		struct sr_datafeed_logic logic;
+		struct sr_datafeed_logic_rle rle;
+	} payload;
+};
+
+static void update_layout(const struct sr_transform *t, struct context *ctx)
+{
+	const struct sr_channel_layout *layout;
+	size_t i, byte;
+
+	layout = sr_dev_channel_layout(t->sdi);
+	ctx->unitsize = 0;
+	memset(ctx->mask, 0, sizeof(ctx->mask));
+	for (i = 0; i < layout->num_logic; i++) {
+		byte = layout->logic_byte[i];
+		ctx->unitsize = MAX(ctx->unitsize, byte + 1);
+		if (byte < sizeof(ctx->mask))
+			ctx->mask[byte] |= layout->logic_bit[i];
+	}
+	memcpy(&ctx->word_mask, ctx->mask, sizeof(ctx->word_mask));
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	(void)options;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	update_layout(t, ctx);
+
+	return SR_OK;
+}
+
+/*
+ * Repack samples in place, the output never is larger than the input.
+ * Returns the size of the repacked data.
+ */
+static size_t repack(const struct context *ctx, uint8_t *data,
+		size_t in_unitsize, size_t count)
+{
+	uint8_t *rdptr, *wrptr;
+	uint64_t w;
+	size_t out, i, k;
+
+	out = ctx->unitsize;
+	rdptr = wrptr = data;
+	if (out == sizeof(w) && in_unitsize == sizeof(w)) {
+		for (i = 0; i < count; i++, wrptr += sizeof(w)) {
+			memcpy(&w, wrptr, sizeof(w));
+			w &= ctx->word_mask;
+			memcpy(wrptr, &w, sizeof(w));
+		}
+		return count * out;
+	}
+
+	switch (out) {
+	case 1:
+		for (i = 0; i < count; i++, rdptr += in_unitsize)
+			*wrptr++ = *rdptr & ctx->mask[0];
+		break;
+	case 2:
+		for (i = 0; i < count; i++, rdptr += in_unitsize) {
+			write_u16le_inc(&wrptr,
+				read_u16le(rdptr) & (ctx->word_mask & 0xffff));
+		}
+		break;
+	case 4:
+		for (i = 0; i < count; i++, rdptr += in_unitsize) {
+			write_u32le_inc(&wrptr,
+				read_u32le(rdptr) & (ctx->word_mask & 0xffffffff));
+		}
+		break;
+	default:
+		for (i = 0; i < count; i++, rdptr += in_unitsize) {
+			for (k = 0; k < out; k++) {
+				*wrptr++ = rdptr[k] &
+					(k < sizeof(ctx->mask) ? ctx->mask[k] : 0xff);
+			}
+		}
+		break;
+	}
+
+	return count * out;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Channels may have changed since the last acquisition. */
+		update_layout(t, ctx);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!ctx->unitsize || ctx->unitsize > logic->unitsize)
+			break;
+		ctx->payload.logic = *logic;
+		ctx->payload.logic.unitsize = ctx->unitsize;
+		ctx->payload.logic.length = repack(ctx, logic->data,
+			logic->unitsize, logic->length / logic->unitsize);
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->payload.logic;
+		*packet_out = &ctx->packet;
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet_in->payload;
+		if (!ctx->unitsize || ctx->unitsize > rle->unitsize)
+			break;
+		ctx->payload.rle = *rle;
+		ctx->payload.rle.unitsize = ctx->unitsize;
+		repack(ctx, rle->values, rle->unitsize, rle->num_runs);
+		ctx->packet.type = SR_DF_LOGIC_RLE;
+		ctx->packet.payload = &ctx->payload.rle;
+		*packet_out = &ctx->packet;
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+
+	g_free(t->priv);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_transform_module transform_repack = {
+	.id = "repack",
+	.name = "Repack",
+	.desc = "Drop the bytes of disabled logic channels from samples",
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
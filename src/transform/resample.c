@@ -0,0 +1,715 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/resample"
+
+/*
+ * Convert the samplerate to 'rate', so that the data of devices with
+ * different samplerates lines up sample by sample. With the input rate
+ * reduced to up / down of the output rate, output sample n is taken at
+ * input position t = n * down / up.
+ *
+ * Logic samples get held: output sample n is input sample floor(t),
+ * exactly, without any filtering. Runs of RLE input stay runs.
+ *
+ * Analog values go through a polyphase FIR filter, a windowed sinc
+ * lowpass below the lower one of both Nyquist rates. The phase of t
+ * between two input samples selects one of 'up' sets of 'taps'
+ * coefficients, which is applied to the input samples around t. Each
+ * set has a gain of one. The window is centered on t, so analog output
+ * stays aligned with logic output. Its last 'taps / 2' input samples
+ * are held for the window of the last output samples at the end of the
+ * acquisition, these get delivered to the consumers directly, they
+ * don't pass through later transforms.
+ *
+ * Channel data is kept in planar blocks, so that the filter's inner
+ * loop runs over contiguous values, in independent accumulators which
+ * compilers turn into SIMD code.
+ *
+ * Data of devices without a samplerate passes unchanged.
+ */
+
+/* Zero crossings of the sinc on each side of the window. */
+#define HALF_ZEROS	8
+/* Fraction of the lower Nyquist rate which passes the filter. */
+#define PASSBAND	0.9
+/* Upper bound of the filter's coefficients, for all phases. */
+#define COEFS_MAX	(1 << 20)
+
+/* Resampling state of analog packets for a set of channels. */
+struct analog_stream {
+	size_t num_channels;
+	GSList *channels;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int digits;
+	/* Position of the next output sample in buf, times 'up'. */
+	uint64_t pos;
+	gboolean primed;
+	/* Per channel 'taps - 1' samples of history, then the input. */
+	float *buf;
+	size_t buf_size;
+};
+
+struct context {
+	uint64_t rate;
+	uint64_t in_rate;
+	uint64_t up, down;
+	gboolean active;
+	/* Logic state. */
+	size_t unitsize;
+	uint64_t logic_pos;
+	GByteArray *logic_out;
+	GArray *rle_lengths;
+	/* Analog state, streams are keyed by their first channel. */
+	GHashTable *streams;
+	double *coefs;
+	size_t taps;
+	float *conv_buf;
+	size_t conv_size;
+	float *out_buf;
+	size_t out_size;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_spec spec;
+	/* Output packets. */
+	GSList *meta_config;
+	struct sr_datafeed_packet packet;
+	union {
+		struct sr_datafeed_meta meta;
+		struct sr_datafeed_logic logic;
+		struct sr_datafeed_logic_rle rle;
+		struct sr_datafeed_analog analog;
+	} payload;
+};
+
+static void stream_free(void *data)
+{
+	struct analog_stream *stream;
+
+	stream = data;
+	g_slist_free(stream->channels);
+	g_free(stream->buf);
+	g_free(stream);
+}
+
+static struct analog_stream *stream_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog, size_t num_channels)
+{
+	struct analog_stream *stream;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	stream = g_hash_table_lookup(ctx->streams, key);
+	if (stream && stream->num_channels == num_channels)
+		return stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->num_channels = num_channels;
+	stream->channels = g_slist_copy(analog->meaning->channels);
+	/* The window is centered on the first output sample. */
+	stream->pos = ctx->taps / 2 * ctx->up;
+	g_hash_table_replace(ctx->streams, key, stream);
+
+	return stream;
+}
+
+static void reset(struct context *ctx)
+{
+	ctx->unitsize = 0;
+	ctx->logic_pos = 0;
+	g_hash_table_remove_all(ctx->streams);
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+	uint64_t r;
+
+	while (b) {
+		r = a % b;
+		a = b;
+		b = r;
+	}
+
+	return a;
+}
+
+static double sinc(double x)
+{
+	if (x == 0.0)
+		return 1.0;
+
+	return sin(G_PI * x) / (G_PI * x);
+}
+
+static double blackman(double x)
+{
+	return 0.42 + 0.5 * cos(G_PI * x) + 0.08 * cos(2 * G_PI * x);
+}
+
+/*
+ * The coefficients of phase p are the filter's impulse response at the
+ * distances of the window's input samples to t, in the order of the
+ * samples in the window.
+ */
+static int filter_create(struct context *ctx)
+{
+	double fc, half, tau, sum, *coefs;
+	size_t taps, p, j;
+
+	fc = 0.5 * PASSBAND * MIN(1.0, (double)ctx->up / ctx->down);
+	taps = 2 * (size_t)ceil(HALF_ZEROS / (2 * fc));
+	if (ctx->up > COEFS_MAX / taps) {
+		sr_err("Cannot resample from %" PRIu64 " Hz to %" PRIu64
+			" Hz, the rates are too close to each other.",
+			ctx->in_rate, ctx->rate);
+		return SR_ERR_ARG;
+	}
+
+	half = taps / 2;
+	coefs = g_malloc_n(ctx->up * taps, sizeof(coefs[0]));
+	for (p = 0; p < ctx->up; p++) {
+		sum = 0.0;
+		for (j = 0; j < taps; j++) {
+			tau = (double)p / ctx->up + (taps - 1 - j) - half;
+			coefs[p * taps + j] = 2 * fc * sinc(2 * fc * tau) *
+				blackman(tau / half);
+			sum += coefs[p * taps + j];
+		}
+		for (j = 0; j < taps; j++)
+			coefs[p * taps + j] /= sum;
+	}
+
+	g_free(ctx->coefs);
+	ctx->coefs = coefs;
+	ctx->taps = taps;
+
+	return SR_OK;
+}
+
+static int set_samplerate(struct context *ctx, uint64_t samplerate)
+{
+	uint64_t div;
+
+	if (samplerate == ctx->in_rate)
+		return SR_OK;
+	reset(ctx);
+	ctx->in_rate = samplerate;
+	ctx->active = FALSE;
+	if (!samplerate || samplerate == ctx->rate)
+		return SR_OK;
+
+	div = gcd(ctx->rate, samplerate);
+	ctx->up = ctx->rate / div;
+	ctx->down = samplerate / div;
+	if (filter_create(ctx) != SR_OK)
+		return SR_ERR_ARG;
+	ctx->active = TRUE;
+	sr_dbg("Resampling by %" PRIu64 "/%" PRIu64 ", %zu taps.",
+		ctx->up, ctx->down, ctx->taps);
+
+	return SR_OK;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	uint64_t rate;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	rate = g_variant_get_uint64(g_hash_table_lookup(options, "rate"));
+	if (!rate) {
+		sr_err("Output samplerate must be set.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->rate = rate;
+	ctx->logic_out = g_byte_array_new();
+	ctx->rle_lengths = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+	ctx->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+
+	return SR_OK;
+}
+
+/* {{{ logic */
+
+/* The number of output samples before input position 'end' times 'up'. */
+static uint64_t logic_outputs(struct context *ctx, uint64_t end)
+{
+	if (ctx->logic_pos >= end)
+		return 0;
+
+	return (end - ctx->logic_pos + ctx->down - 1) / ctx->down;
+}
+
+/* Pick the input sample of each of 'count' output samples. */
+static void logic_hold(uint8_t *out, const uint8_t *data, size_t unitsize,
+		uint64_t pos, uint64_t up, uint64_t down, uint64_t count)
+{
+	uint64_t i;
+
+#define LOGIC_HOLD(type) do { \
+	type v; \
+	for (i = 0; i < count; i++, pos += down) { \
+		memcpy(&v, &data[pos / up * sizeof(v)], sizeof(v)); \
+		memcpy(&out[i * sizeof(v)], &v, sizeof(v)); \
+	} \
+} while (0)
+
+	switch (unitsize) {
+	case 1:
+		LOGIC_HOLD(uint8_t);
+		break;
+	case 2:
+		LOGIC_HOLD(uint16_t);
+		break;
+	case 4:
+		LOGIC_HOLD(uint32_t);
+		break;
+	case 8:
+		LOGIC_HOLD(uint64_t);
+		break;
+	default:
+		for (i = 0; i < count; i++, pos += down) {
+			memcpy(&out[i * unitsize], &data[pos / up * unitsize],
+				unitsize);
+		}
+		break;
+	}
+
+#undef LOGIC_HOLD
+}
+
+static int logic_setup(struct context *ctx, size_t unitsize)
+{
+	if (ctx->unitsize == unitsize)
+		return SR_OK;
+	if (ctx->unitsize) {
+		sr_err("Logic unit size changed from %zu to %zu.",
+			ctx->unitsize, unitsize);
+		return SR_ERR_DATA;
+	}
+	ctx->unitsize = unitsize;
+	ctx->logic_pos = 0;
+
+	return SR_OK;
+}
+
+static int receive_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_packet **packet_out)
+{
+	uint64_t count, end, outputs;
+	int ret;
+
+	ret = logic_setup(ctx, logic->unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	count = logic->length / logic->unitsize;
+	end = count * ctx->up;
+	outputs = logic_outputs(ctx, end);
+	if (!outputs) {
+		ctx->logic_pos -= end;
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	g_byte_array_set_size(ctx->logic_out, outputs * ctx->unitsize);
+	logic_hold(ctx->logic_out->data, logic->data, ctx->unitsize,
+		ctx->logic_pos, ctx->up, ctx->down, outputs);
+	ctx->logic_pos += outputs * ctx->down - end;
+
+	ctx->payload.logic.unitsize = ctx->unitsize;
+	ctx->payload.logic.length = ctx->logic_out->len;
+	ctx->payload.logic.data = ctx->logic_out->data;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->payload.logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Each run turns into a run of the output samples which it holds. */
+static int receive_logic_rle(struct context *ctx,
+		const struct sr_datafeed_logic_rle *rle,
+		struct sr_datafeed_packet **packet_out)
+{
+	const uint8_t *value;
+	uint64_t run, end, outputs;
+	int ret;
+
+	ret = logic_setup(ctx, rle->unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	g_byte_array_set_size(ctx->logic_out, 0);
+	g_array_set_size(ctx->rle_lengths, 0);
+	value = rle->values;
+	end = 0;
+	for (run = 0; run < rle->num_runs; run++, value += ctx->unitsize) {
+		end += rle->run_lengths[run] * ctx->up;
+		outputs = logic_outputs(ctx, end);
+		if (!outputs)
+			continue;
+		ctx->logic_pos += outputs * ctx->down;
+		g_byte_array_append(ctx->logic_out, value, ctx->unitsize);
+		g_array_append_val(ctx->rle_lengths, outputs);
+	}
+	ctx->logic_pos -= end;
+
+	if (!ctx->rle_lengths->len) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+	ctx->payload.rle.unitsize = ctx->unitsize;
+	ctx->payload.rle.num_runs = ctx->rle_lengths->len;
+	ctx->payload.rle.values = ctx->logic_out->data;
+	ctx->payload.rle.run_lengths = (uint64_t *)(void *)ctx->rle_lengths->data;
+	ctx->packet.type = SR_DF_LOGIC_RLE;
+	ctx->packet.payload = &ctx->payload.rle;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* }}} */
+/* {{{ analog */
+
+static double dot_kernel(const float *v, const double *kernel, size_t count)
+{
+	double lane0, lane1, lane2, lane3;
+	size_t i;
+
+	lane0 = lane1 = lane2 = lane3 = 0.0;
+	for (i = 0; i + 4 <= count; i += 4) {
+		lane0 += v[i + 0] * kernel[i + 0];
+		lane1 += v[i + 1] * kernel[i + 1];
+		lane2 += v[i + 2] * kernel[i + 2];
+		lane3 += v[i + 3] * kernel[i + 3];
+	}
+	for (; i < count; i++)
+		lane0 += v[i] * kernel[i];
+
+	return (lane0 + lane1) + (lane2 + lane3);
+}
+
+/* Make room for @a count input samples per channel after the history. */
+static void stream_reserve(struct analog_stream *stream, size_t hist,
+		size_t count)
+{
+	float *buf;
+	size_t size, c;
+
+	if (stream->buf_size >= hist + count)
+		return;
+
+	size = hist + count;
+	buf = g_malloc_n(size * stream->num_channels, sizeof(buf[0]));
+	for (c = 0; stream->buf && c < stream->num_channels; c++) {
+		memcpy(&buf[c * size], &stream->buf[c * stream->buf_size],
+			hist * sizeof(buf[0]));
+	}
+	g_free(stream->buf);
+	stream->buf = buf;
+	stream->buf_size = size;
+}
+
+/*
+ * Filter @a count input samples per channel, which follow the history
+ * in the stream's buffer. Returns the number of output samples.
+ */
+static size_t stream_run(struct context *ctx, struct analog_stream *stream,
+		size_t count)
+{
+	const double *coefs;
+	float *buf;
+	size_t nch, hist, outputs, n, start, c;
+	uint64_t end;
+
+	nch = stream->num_channels;
+	hist = ctx->taps - 1;
+	end = (uint64_t)count * ctx->up;
+	outputs = end / ctx->down + 1;
+	if (ctx->out_size < outputs * nch) {
+		g_free(ctx->out_buf);
+		ctx->out_buf = g_malloc_n(outputs * nch, sizeof(ctx->out_buf[0]));
+		ctx->out_size = outputs * nch;
+	}
+
+	for (n = 0; stream->pos < end; n++, stream->pos += ctx->down) {
+		start = stream->pos / ctx->up;
+		coefs = &ctx->coefs[(stream->pos % ctx->up) * ctx->taps];
+		for (c = 0; c < nch; c++) {
+			buf = &stream->buf[c * stream->buf_size];
+			ctx->out_buf[n * nch + c] = dot_kernel(&buf[start],
+				coefs, ctx->taps);
+		}
+	}
+	stream->pos -= end;
+
+	for (c = 0; c < nch; c++) {
+		buf = &stream->buf[c * stream->buf_size];
+		memmove(buf, &buf[count], hist * sizeof(buf[0]));
+	}
+
+	return n;
+}
+
+static void analog_packet(struct context *ctx, struct analog_stream *stream,
+		size_t outputs)
+{
+	struct sr_datafeed_analog *analog;
+
+	analog = &ctx->payload.analog;
+	sr_analog_init(analog, &ctx->encoding, &ctx->meaning, &ctx->spec,
+		stream->digits);
+	ctx->encoding.is_signed = TRUE;
+	ctx->meaning = stream->meaning;
+	ctx->meaning.channels = stream->channels;
+	ctx->spec = stream->spec;
+	analog->num_samples = outputs;
+	analog->data = ctx->out_buf;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = analog;
+}
+
+static int receive_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct analog_stream *stream;
+	size_t nch, total, hist, count, i, c;
+	const float *data;
+	float *buf;
+	int ret;
+
+	*packet_out = NULL;
+	nch = g_slist_length(analog->meaning->channels);
+	if (!nch || !analog->num_samples)
+		return SR_OK;
+	stream = stream_get(ctx, analog, nch);
+	stream->meaning = *analog->meaning;
+	if (analog->spec)
+		stream->spec = *analog->spec;
+	stream->digits = analog->encoding->digits;
+
+	total = analog->num_samples * nch;
+	if (ctx->conv_size < total) {
+		g_free(ctx->conv_buf);
+		ctx->conv_buf = g_malloc(total * sizeof(ctx->conv_buf[0]));
+		ctx->conv_size = total;
+	}
+	ret = sr_analog_to_float(analog, ctx->conv_buf);
+	if (ret != SR_OK)
+		return ret;
+
+	hist = ctx->taps - 1;
+	count = analog->num_samples;
+	stream_reserve(stream, hist, count);
+	data = ctx->conv_buf;
+	for (c = 0; c < nch; c++) {
+		buf = &stream->buf[c * stream->buf_size];
+		/* Before the first sample, the signal holds its value. */
+		if (!stream->primed) {
+			for (i = 0; i < hist; i++)
+				buf[i] = data[c];
+		}
+		for (i = 0; i < count; i++)
+			buf[hist + i] = data[i * nch + c];
+	}
+	stream->primed = TRUE;
+
+	count = stream_run(ctx, stream, count);
+	if (!count)
+		return SR_OK;
+	analog_packet(ctx, stream, count);
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Deliver the output samples whose window extends past the last input. */
+static void analog_flush(const struct sr_transform *t, struct context *ctx,
+		struct analog_stream *stream)
+{
+	size_t hist, count, i, c;
+	float *buf;
+
+	if (!stream->primed)
+		return;
+
+	hist = ctx->taps - 1;
+	count = ctx->taps / 2;
+	stream_reserve(stream, hist, count);
+	for (c = 0; c < stream->num_channels; c++) {
+		buf = &stream->buf[c * stream->buf_size];
+		for (i = 0; i < count; i++)
+			buf[hist + i] = buf[hist - 1];
+	}
+	stream->primed = FALSE;
+
+	count = stream_run(ctx, stream, count);
+	if (!count)
+		return;
+	analog_packet(ctx, stream, count);
+	sr_session_deliver(t->sdi->session, t->sdi, &ctx->packet);
+}
+
+/* }}} */
+
+static void receive_header(const struct sr_transform *t, struct context *ctx)
+{
+	GVariant *gvar;
+
+	reset(ctx);
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		set_samplerate(ctx, g_variant_get_uint64(gvar));
+		g_variant_unref(gvar);
+	}
+}
+
+/* Announce the output samplerate to subsequent consumers. */
+static int receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_config *src;
+	struct sr_config *cfg;
+	GSList *l;
+	int ret;
+
+	g_slist_free_full(ctx->meta_config, (GDestroyNotify)sr_config_free);
+	ctx->meta_config = NULL;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE) {
+			cfg = sr_config_new(src->key, g_variant_ref(src->data));
+		} else {
+			ret = set_samplerate(ctx, g_variant_get_uint64(src->data));
+			if (ret != SR_OK)
+				return ret;
+			cfg = sr_config_new(src->key,
+				g_variant_new_uint64(ctx->rate));
+		}
+		ctx->meta_config = g_slist_append(ctx->meta_config, cfg);
+	}
+
+	ctx->payload.meta.config = ctx->meta_config;
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->payload.meta;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	GHashTableIter iter;
+	void *stream;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	if (packet_in->type == SR_DF_HEADER) {
+		receive_header(t, ctx);
+		return SR_OK;
+	}
+	if (packet_in->type == SR_DF_META)
+		return receive_meta(ctx, packet_in->payload, packet_out);
+	if (!ctx->active)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in->payload, packet_out);
+	case SR_DF_LOGIC_RLE:
+		return receive_logic_rle(ctx, packet_in->payload, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in->payload, packet_out);
+	case SR_DF_END:
+		g_hash_table_iter_init(&iter, ctx->streams);
+		while (g_hash_table_iter_next(&iter, NULL, &stream))
+			analog_flush(t, ctx, stream);
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->streams);
+	g_byte_array_free(ctx->logic_out, TRUE);
+	g_array_free(ctx->rle_lengths, TRUE);
+	g_slist_free_full(ctx->meta_config, (GDestroyNotify)sr_config_free);
+	g_free(ctx->coefs);
+	g_free(ctx->conv_buf);
+	g_free(ctx->out_buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "rate", "Rate", "Output samplerate (Hz)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(0));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_resample = {
+	.id = "resample",
+	.name = "Resample",
+	.desc = "Convert the samplerate, holding logic samples and filtering analog values",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
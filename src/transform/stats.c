@@ -0,0 +1,339 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/stats"
+
+/*
+ * Replace analog values by their statistics over blocks of 'block'
+ * values per channel. For each block, four analog packets with one
+ * value per channel get delivered: the minimum, the maximum, the mean
+ * and the RMS value, with the SR_MQFLAG_MIN, SR_MQFLAG_MAX,
+ * SR_MQFLAG_AVG and SR_MQFLAG_RMS flags respectively. The input's
+ * analog packets are dropped, others pass unchanged. Blocks don't span
+ * frames, what there is of them at a frame's start or at the end of
+ * the acquisition gets reported.
+ *
+ * Like the "measure" transform, the statistics packets go to the
+ * consumers directly, they don't pass through later transforms.
+ *
+ * The reductions run on the raw sample units of the payload (see
+ * sr_analog_to_raw_units()), in loops without branches which compilers
+ * turn into vector code. The sums of a chunk get translated into values
+ * once.
+ */
+
+#define DEFAULT_BLOCK	1000
+/* Values per channel which get reduced at a time. */
+#define CHUNK_SIZE	1024
+
+struct channel_acc {
+	double min, max;
+	double sum, sum_sq;
+};
+
+/* Block in progress for a set of channels. */
+struct stats_stream {
+	size_t num_channels;
+	GSList *channels;
+	struct channel_acc *acc;
+	uint64_t fill;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int digits;
+};
+
+struct context {
+	uint64_t block;
+	GHashTable *streams;
+	double *chunk;
+	float *values;
+	size_t values_size;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static void stream_reset(struct stats_stream *stream)
+{
+	size_t c;
+
+	for (c = 0; c < stream->num_channels; c++) {
+		stream->acc[c].min = INFINITY;
+		stream->acc[c].max = -INFINITY;
+		stream->acc[c].sum = 0;
+		stream->acc[c].sum_sq = 0;
+	}
+	stream->fill = 0;
+}
+
+static void stream_free(void *data)
+{
+	struct stats_stream *stream;
+
+	stream = data;
+	g_slist_free(stream->channels);
+	g_free(stream->acc);
+	g_free(stream);
+}
+
+static struct stats_stream *stream_get(struct context *ctx,
+		const struct sr_datafeed_analog *analog, size_t num_channels)
+{
+	struct stats_stream *stream;
+	void *key;
+
+	key = analog->meaning->channels->data;
+	stream = g_hash_table_lookup(ctx->streams, key);
+	if (stream && stream->num_channels == num_channels)
+		return stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->num_channels = num_channels;
+	stream->channels = g_slist_copy(analog->meaning->channels);
+	stream->acc = g_malloc0_n(num_channels, sizeof(stream->acc[0]));
+	stream_reset(stream);
+	g_hash_table_replace(ctx->streams, key, stream);
+	if (ctx->values_size < num_channels) {
+		g_free(ctx->values);
+		ctx->values = g_malloc_n(num_channels, sizeof(ctx->values[0]));
+		ctx->values_size = num_channels;
+	}
+
+	return stream;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	uint64_t block;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	block = g_variant_get_uint64(g_hash_table_lookup(options, "block"));
+	if (!block) {
+		sr_err("Block size must be at least one value.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->block = block;
+	ctx->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+	ctx->chunk = g_malloc_n(CHUNK_SIZE, sizeof(ctx->chunk[0]));
+
+	return SR_OK;
+}
+
+/* Add @a n values in raw units to a channel's accumulator. */
+static void chunk_reduce(struct channel_acc *acc, const double *v, size_t n,
+		double scale, double offset)
+{
+	double lo, hi, sum, sum_sq, x;
+	size_t i;
+
+	lo = v[0];
+	hi = v[0];
+	sum = 0;
+	sum_sq = 0;
+	for (i = 0; i < n; i++) {
+		x = v[i];
+		lo = x < lo ? x : lo;
+		hi = x > hi ? x : hi;
+		sum += x;
+		sum_sq += x * x;
+	}
+
+	/* The scale is never negative, see sr_analog_to_raw_units(). */
+	acc->min = MIN(acc->min, lo * scale + offset);
+	acc->max = MAX(acc->max, hi * scale + offset);
+	acc->sum += sum * scale + n * offset;
+	acc->sum_sq += sum_sq * scale * scale + 2 * sum * scale * offset +
+		n * offset * offset;
+}
+
+static void stats_send(const struct sr_transform *t, struct context *ctx,
+		const struct stats_stream *stream, int mqflag)
+{
+	const struct channel_acc *acc;
+	size_t c;
+
+	for (c = 0; c < stream->num_channels; c++) {
+		acc = &stream->acc[c];
+		switch (mqflag) {
+		case SR_MQFLAG_MIN:
+			ctx->values[c] = acc->min;
+			break;
+		case SR_MQFLAG_MAX:
+			ctx->values[c] = acc->max;
+			break;
+		case SR_MQFLAG_AVG:
+			ctx->values[c] = acc->sum / stream->fill;
+			break;
+		default:
+			ctx->values[c] = sqrt(acc->sum_sq / stream->fill);
+			break;
+		}
+	}
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning,
+		&ctx->spec, stream->digits);
+	ctx->meaning = stream->meaning;
+	ctx->meaning.mqflags |= mqflag;
+	ctx->meaning.channels = stream->channels;
+	ctx->spec = stream->spec;
+	ctx->analog.num_samples = 1;
+	ctx->analog.data = ctx->values;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	sr_session_deliver(t->sdi->session, t->sdi, &ctx->packet);
+}
+
+static void block_send(const struct sr_transform *t, struct context *ctx,
+		struct stats_stream *stream)
+{
+	if (!stream->fill)
+		return;
+
+	stats_send(t, ctx, stream, SR_MQFLAG_MIN);
+	stats_send(t, ctx, stream, SR_MQFLAG_MAX);
+	stats_send(t, ctx, stream, SR_MQFLAG_AVG);
+	stats_send(t, ctx, stream, SR_MQFLAG_RMS);
+	stream_reset(stream);
+}
+
+static int receive_analog(const struct sr_transform *t, struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	struct stats_stream *stream;
+	size_t nch, pos, len, c;
+	double scale, offset;
+	int ret;
+
+	nch = g_slist_length(analog->meaning->channels);
+	if (!nch || !analog->num_samples)
+		return SR_OK;
+	stream = stream_get(ctx, analog, nch);
+	stream->meaning = *analog->meaning;
+	if (analog->spec)
+		stream->spec = *analog->spec;
+	stream->digits = analog->encoding->digits;
+
+	pos = 0;
+	while (pos < analog->num_samples) {
+		len = MIN(analog->num_samples - pos, CHUNK_SIZE);
+		len = MIN(len, ctx->block - stream->fill);
+		for (c = 0; c < nch; c++) {
+			ret = sr_analog_to_raw_units(analog, pos * nch + c, nch,
+				len, ctx->chunk, &scale, &offset);
+			if (ret != SR_OK)
+				return ret;
+			chunk_reduce(&stream->acc[c], ctx->chunk, len,
+				scale, offset);
+		}
+		stream->fill += len;
+		pos += len;
+		if (stream->fill == ctx->block)
+			block_send(t, ctx, stream);
+	}
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	GHashTableIter iter;
+	void *stream;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		g_hash_table_remove_all(ctx->streams);
+		break;
+	case SR_DF_ANALOG:
+		*packet_out = NULL;
+		return receive_analog(t, ctx, packet_in->payload);
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_END:
+		/* Report what there is of the last blocks. */
+		g_hash_table_iter_init(&iter, ctx->streams);
+		while (g_hash_table_iter_next(&iter, NULL, &stream))
+			block_send(t, ctx, stream);
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->streams);
+	g_free(ctx->chunk);
+	g_free(ctx->values);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "block", "Block", "Number of values per channel and statistic", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_BLOCK));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_stats = {
+	.id = "stats",
+	.name = "Statistics",
+	.desc = "Replace analog values by their minimum, maximum, mean and RMS",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -45,12 +45,28 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_repack;
+extern SR_PRIV struct sr_transform_module transform_decimate;
+extern SR_PRIV struct sr_transform_module transform_changes;
+extern SR_PRIV struct sr_transform_module transform_filter;
+extern SR_PRIV struct sr_transform_module transform_fft;
+extern SR_PRIV struct sr_transform_module transform_measure;
+extern SR_PRIV struct sr_transform_module transform_stats;
+extern SR_PRIV struct sr_transform_module transform_resample;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_repack,
+	&transform_decimate,
+	&transform_changes,
+	&transform_filter,
+	&transform_fft,
+	&transform_measure,
+	&transform_stats,
+	&transform_resample,
 	NULL,
 };
 
@@ -178,4 +178,116 @@ SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 	return SR_OK;
 }
 
+/* Check whether the hardware can match all of a stage's matches. */
+static gboolean stage_fits_hw(const struct sr_trigger_stage *stage,
+		const struct sr_trigger_hw_caps *caps)
+{
+	const struct sr_trigger_match *match;
+	const GSList *l;
+
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (!match->channel->enabled)
+			continue;
+		if (match->channel->type != SR_CHANNEL_LOGIC)
+			return FALSE;
+		if (match->channel->index >= caps->num_channels)
+			return FALSE;
+		if (!(caps->matches & (1UL << match->match)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int stage_copy(struct sr_trigger *trig,
+		const struct sr_trigger_stage *stage)
+{
+	struct sr_trigger_stage *copy;
+	const struct sr_trigger_match *match;
+	const GSList *l;
+	int ret;
+
+	copy = sr_trigger_stage_add(trig);
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		ret = sr_trigger_match_add(copy, match->channel,
+			match->match, match->value);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Split a trigger into a part for the hardware, and a part for software.
+ *
+ * The leading stages which the hardware can match according to @a caps
+ * make up the hardware trigger. The remaining stages make up a trigger
+ * for software matching, which applies to the samples following the
+ * position where the hardware trigger fired. The hardware does as much
+ * of the matching as possible, even when it cannot take all of it.
+ *
+ * Either part is NULL when it would be empty. The caller owns the parts
+ * and frees them using sr_trigger_free().
+ *
+ * @param[in] trigger The trigger to split. May be NULL.
+ * @param[in] caps The capabilities of the hardware trigger.
+ * @param[out] hw_trigger The stages for the hardware.
+ * @param[out] sw_trigger The stages for software matching.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_trigger_split(const struct sr_trigger *trigger,
+		const struct sr_trigger_hw_caps *caps,
+		struct sr_trigger **hw_trigger, struct sr_trigger **sw_trigger)
+{
+	const struct sr_trigger_stage *stage;
+	struct sr_trigger *dst;
+	const GSList *l;
+	int num_hw, ret;
+
+	if (!caps || !hw_trigger || !sw_trigger)
+		return SR_ERR_ARG;
+
+	*hw_trigger = NULL;
+	*sw_trigger = NULL;
+	if (!trigger)
+		return SR_OK;
+
+	num_hw = 0;
+	ret = SR_OK;
+	for (l = trigger->stages; l && ret == SR_OK; l = l->next) {
+		stage = l->data;
+		if (*sw_trigger || num_hw >= caps->num_stages ||
+				!stage_fits_hw(stage, caps)) {
+			if (!*sw_trigger)
+				*sw_trigger = sr_trigger_new(trigger->name);
+			dst = *sw_trigger;
+		} else {
+			if (!*hw_trigger)
+				*hw_trigger = sr_trigger_new(trigger->name);
+			dst = *hw_trigger;
+			num_hw++;
+		}
+		ret = stage_copy(dst, stage);
+	}
+	if (ret != SR_OK) {
+		sr_trigger_free(*hw_trigger);
+		sr_trigger_free(*sw_trigger);
+		*hw_trigger = NULL;
+		*sw_trigger = NULL;
+		return ret;
+	}
+
+	sr_dbg("Split trigger into %d hardware and %d software stage(s).",
+		num_hw, *sw_trigger ? (int)g_slist_length((*sw_trigger)->stages) : 0);
+
+	return SR_OK;
+}
+
 /** @} */
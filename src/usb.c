@@ -22,6 +22,7 @@
 #include <config.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include <glib.h>
 #include <libusb.h>
 #include <libsigrok/libsigrok.h>
@@ -45,13 +46,59 @@ struct usb_source {
 	int64_t timeout_us;
 	int64_t due_us;
 
-	/* Needed to keep track of installed sources */
+	/* Needed to keep track of installed sources, NULL for hotplug. */
 	struct sr_session *session;
 
 	struct libusb_context *usb_ctx;
 	GPtrArray *pollfds;
 };
 
+/** A transfer of the per-device pool, and the buffer it owns. */
+struct usb_pool_transfer {
+	struct libusb_transfer *transfer;
+	unsigned char *buffer;
+	size_t size;
+	/* The handle a DMA capable buffer belongs to, NULL for heap memory. */
+	struct libusb_device_handle *devhdl;
+};
+
+/** Transfers of a USB device, kept across acquisitions. */
+struct sr_usb_transfer_pool {
+	/* All transfers of the pool, keyed by their libusb transfer. */
+	GHashTable *entries;
+	/* Transfers which currently are not borrowed. */
+	GSList *idle;
+};
+
+/** The strings of a device, as read during a scan. */
+struct usb_dev_strings {
+	int result;
+	char manufacturer[64];
+	char product[64];
+	char serial_num[64];
+};
+
+/**
+ * Enumeration results which the drivers share while scans are running,
+ * so that each device gets looked at and opened only once.
+ */
+struct sr_usb_scan_cache {
+	int refcount;
+	libusb_device **devlist;
+	ssize_t num_devs;
+	/* libusb_device -> struct usb_dev_strings */
+	GHashTable *strings;
+};
+
+/*
+ * The live event sources. libusb reports changes to its poll set to
+ * just one listener per context, which hands them on to all sources.
+ */
+static GSList *usb_sources;
+G_LOCK_DEFINE_STATIC(usb_sources);
+
+static void usb_pool_transfer_free(struct usb_pool_transfer *entry);
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -154,31 +201,37 @@ static gboolean usb_source_dispatch(GSource *source,
  */
 static void usb_source_finalize(GSource *source)
 {
-	struct usb_source *usource;
+	struct usb_source *usource, *other;
+	GSList *l;
 
 	usource = (struct usb_source *)source;
 
 	sr_spew("%s", __func__);
 
-	libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
+	G_LOCK(usb_sources);
+	usb_sources = g_slist_remove(usb_sources, usource);
+	for (l = usb_sources; l; l = l->next) {
+		other = l->data;
+		if (other->usb_ctx == usource->usb_ctx)
+			break;
+	}
+	if (!l)
+		libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
+	G_UNLOCK(usb_sources);
 
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
 
-	sr_session_source_destroyed(usource->session,
-			usource->usb_ctx, source);
+	if (usource->session)
+		sr_session_source_destroyed(usource->session,
+				usource->usb_ctx, source);
 }
 
-/** Callback invoked when a new libusb FD should be added to the poll set.
- */
-static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
-		short events, void *user_data)
+static void usb_source_add_pollfd(struct usb_source *usource,
+		libusb_os_handle fd, short events)
 {
-	struct usb_source *usource;
 	GPollFD *pollfd;
 
-	usource = user_data;
-
 	if (G_UNLIKELY(g_source_is_destroyed(&usource->base)))
 		return;
 
@@ -194,16 +247,12 @@ static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
 	g_source_add_poll(&usource->base, pollfd);
 }
 
-/** Callback invoked when a libusb FD should be removed from the poll set.
- */
-static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
+static void usb_source_remove_pollfd(struct usb_source *usource,
+		libusb_os_handle fd)
 {
-	struct usb_source *usource;
 	GPollFD *pollfd;
 	unsigned int i;
 
-	usource = user_data;
-
 	if (G_UNLIKELY(g_source_is_destroyed(&usource->base)))
 		return;
 
@@ -222,6 +271,39 @@ static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
 		") not found in event source poll set.", (gintptr)fd);
 }
 
+/** Callback invoked when a new libusb FD should be added to the poll set.
+ */
+static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
+		short events, void *user_data)
+{
+	struct usb_source *usource;
+	GSList *l;
+
+	G_LOCK(usb_sources);
+	for (l = usb_sources; l; l = l->next) {
+		usource = l->data;
+		if (usource->usb_ctx == user_data)
+			usb_source_add_pollfd(usource, fd, events);
+	}
+	G_UNLOCK(usb_sources);
+}
+
+/** Callback invoked when a libusb FD should be removed from the poll set.
+ */
+static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
+{
+	struct usb_source *usource;
+	GSList *l;
+
+	G_LOCK(usb_sources);
+	for (l = usb_sources; l; l = l->next) {
+		usource = l->data;
+		if (usource->usb_ctx == user_data)
+			usb_source_remove_pollfd(usource, fd);
+	}
+	G_UNLOCK(usb_sources);
+}
+
 /** Destroy notify callback for FDs maintained by the USB event source.
  */
 static void usb_source_free_pollfd(void *data)
@@ -243,7 +325,7 @@ static void usb_source_free_pollfd(void *data)
  * API at some point. Instead, drivers should install separate timer
  * event sources for their polling needs.
  *
- * @param session The session the event source belongs to.
+ * @param session The session the event source belongs to, or NULL.
  * @param usb_ctx The libusb context for which to handle events.
  * @param timeout_ms The timeout interval in ms, or -1 to wait indefinitely.
  * @return A new event source object, or NULL on failure.
@@ -283,19 +365,236 @@ static GSource *usb_source_new(struct sr_session *session,
 	usource->pollfds = g_ptr_array_new_full(8, &usb_source_free_pollfd);
 
 	for (upfd = upollfds; *upfd != NULL; upfd++)
-		usb_pollfd_added((*upfd)->fd, (*upfd)->events, usource);
+		usb_source_add_pollfd(usource, (*upfd)->fd, (*upfd)->events);
 
 #if (LIBUSB_API_VERSION >= 0x01000104)
 	libusb_free_pollfds(upollfds);
 #else
 	free(upollfds);
 #endif
+	G_LOCK(usb_sources);
+	usb_sources = g_slist_prepend(usb_sources, usource);
 	libusb_set_pollfd_notifiers(usb_ctx,
-		&usb_pollfd_added, &usb_pollfd_removed, usource);
+		&usb_pollfd_added, &usb_pollfd_removed, usb_ctx);
+	G_UNLOCK(usb_sources);
 
 	return source;
 }
 
+/**
+ * Start sharing the USB enumeration between scans.
+ *
+ * Until the matching sr_usb_scan_end() call, sr_usb_get_device_list()
+ * and sr_usb_get_strings() return what was found first, instead of
+ * querying the bus again. Calls can nest, and can come from several
+ * threads.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_begin(struct sr_context *ctx)
+{
+	struct sr_usb_scan_cache *cache;
+
+	g_mutex_lock(&ctx->usb_scan_mutex);
+	if (!(cache = ctx->usb_scan_cache)) {
+		cache = g_malloc0(sizeof(*cache));
+		cache->num_devs = -1;
+		cache->strings = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+		ctx->usb_scan_cache = cache;
+	}
+	cache->refcount++;
+	g_mutex_unlock(&ctx->usb_scan_mutex);
+}
+
+/**
+ * Stop sharing the USB enumeration, see sr_usb_scan_begin().
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_end(struct sr_context *ctx)
+{
+	struct sr_usb_scan_cache *cache;
+
+	g_mutex_lock(&ctx->usb_scan_mutex);
+	cache = ctx->usb_scan_cache;
+	if (cache && --cache->refcount == 0) {
+		ctx->usb_scan_cache = NULL;
+		g_hash_table_destroy(cache->strings);
+		if (cache->devlist)
+			libusb_free_device_list(cache->devlist, 1);
+		g_free(cache);
+	}
+	g_mutex_unlock(&ctx->usb_scan_mutex);
+}
+
+/**
+ * Get the list of USB devices.
+ *
+ * Works like libusb_get_device_list(), but shares the enumeration with
+ * other callers while a scan is running.
+ *
+ * @param ctx The libsigrok context.
+ * @param[out] list The NULL terminated list of devices. Must be freed
+ *                  with sr_usb_free_device_list().
+ *
+ * @return The number of devices, or a negative libusb error code.
+ *
+ * @private
+ */
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list)
+{
+	struct sr_usb_scan_cache *cache;
+	libusb_device **devlist;
+	ssize_t num_devs, i;
+
+	g_mutex_lock(&ctx->usb_scan_mutex);
+	cache = ctx->usb_scan_cache;
+	if (cache && cache->num_devs >= 0) {
+		devlist = cache->devlist;
+		num_devs = cache->num_devs;
+	} else {
+		num_devs = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+		if (num_devs < 0) {
+			g_mutex_unlock(&ctx->usb_scan_mutex);
+			*list = NULL;
+			return num_devs;
+		}
+		if (cache) {
+			cache->devlist = devlist;
+			cache->num_devs = num_devs;
+		}
+	}
+
+	*list = g_malloc((num_devs + 1) * sizeof(**list));
+	for (i = 0; i < num_devs; i++)
+		(*list)[i] = libusb_ref_device(devlist[i]);
+	(*list)[num_devs] = NULL;
+
+	if (!cache)
+		libusb_free_device_list(devlist, 1);
+	g_mutex_unlock(&ctx->usb_scan_mutex);
+
+	return num_devs;
+}
+
+/**
+ * Free a list of USB devices from sr_usb_get_device_list().
+ *
+ * @param list The list of devices. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_free_device_list(libusb_device **list)
+{
+	size_t i;
+
+	if (!list)
+		return;
+	for (i = 0; list[i]; i++)
+		libusb_unref_device(list[i]);
+	g_free(list);
+}
+
+static int read_string(libusb_device_handle *hdl, uint8_t index,
+		char *text, size_t len, const char *what)
+{
+	int ret;
+
+	text[0] = '\0';
+	if (!index)
+		return SR_OK;
+	ret = libusb_get_string_descriptor_ascii(hdl, index,
+		(unsigned char *)text, len);
+	if (ret < 0) {
+		sr_warn("Failed to get %s string descriptor: %s.",
+			what, libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int read_dev_strings(libusb_device *dev, struct usb_dev_strings *strings)
+{
+	struct libusb_device_descriptor des;
+	libusb_device_handle *hdl;
+	int ret;
+
+	libusb_get_device_descriptor(dev, &des);
+	if ((ret = libusb_open(dev, &hdl)) < 0) {
+		sr_warn("Failed to open potential device with "
+			"VID:PID %04x:%04x: %s.", des.idVendor,
+			des.idProduct, libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	ret = read_string(hdl, des.iManufacturer, strings->manufacturer,
+		sizeof(strings->manufacturer), "manufacturer");
+	if (ret == SR_OK)
+		ret = read_string(hdl, des.iProduct, strings->product,
+			sizeof(strings->product), "product");
+	if (ret == SR_OK)
+		ret = read_string(hdl, des.iSerialNumber, strings->serial_num,
+			sizeof(strings->serial_num), "serial number");
+	libusb_close(hdl);
+
+	return ret;
+}
+
+/**
+ * Get the manufacturer, product and serial number strings of a device.
+ *
+ * Reading the strings takes opening the device. While a scan is running
+ * (see sr_usb_scan_begin()), each device gets read only once, and later
+ * callers get the strings (or the failure) from before.
+ *
+ * @param ctx The libsigrok context.
+ * @param dev The device.
+ * @param[out] manufacturer The manufacturer string. Can be NULL.
+ * @param[out] product The product string. Can be NULL.
+ * @param[out] serial_num The serial number string. Can be NULL.
+ * @param len The size of each of the buffers.
+ *
+ * @retval SR_OK Success, strings which the device lacks are empty.
+ * @retval SR_ERR The device cannot be opened, or its strings be read.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_get_strings(struct sr_context *ctx, libusb_device *dev,
+		char *manufacturer, char *product, char *serial_num, size_t len)
+{
+	struct sr_usb_scan_cache *cache;
+	struct usb_dev_strings *strings, uncached;
+
+	g_mutex_lock(&ctx->usb_scan_mutex);
+	cache = ctx->usb_scan_cache;
+	strings = cache ? g_hash_table_lookup(cache->strings, dev) : NULL;
+	if (!strings) {
+		strings = cache ? g_malloc0(sizeof(*strings)) : &uncached;
+		strings->result = read_dev_strings(dev, strings);
+		if (cache)
+			g_hash_table_insert(cache->strings, dev, strings);
+	}
+
+	if (strings->result == SR_OK) {
+		if (manufacturer)
+			g_strlcpy(manufacturer, strings->manufacturer, len);
+		if (product)
+			g_strlcpy(product, strings->product, len);
+		if (serial_num)
+			g_strlcpy(serial_num, strings->serial_num, len);
+	}
+	g_mutex_unlock(&ctx->usb_scan_mutex);
+
+	return strings->result;
+}
+
 /**
  * Extract VID:PID or bus.addr from a connection string.
  *
@@ -382,7 +681,7 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
 /**
  * Find USB devices according to a connection string.
  *
- * @param usb_ctx libusb context to use while scanning.
+ * @param ctx The libsigrok context.
  * @param conn Connection string specifying the device(s) to match. This
  * can be of the form "<bus>.<address>", or "<vendorid>.<productid>".
  *
@@ -390,7 +689,7 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
  * matching the device that matched the connection string. The GSList and
  * its contents must be freed by the caller.
  */
-SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
+SR_PRIV GSList *sr_usb_find(struct sr_context *ctx, const char *conn)
 {
 	struct sr_usb_dev_inst *usb;
 	struct libusb_device **devlist;
@@ -412,7 +711,11 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 
 	/* Looks like a valid USB device specification, but is it connected? */
 	devices = NULL;
-	libusb_get_device_list(usb_ctx, &devlist);
+	if ((ret = sr_usb_get_device_list(ctx, &devlist)) < 0) {
+		sr_err("Failed to retrieve device list: %s.",
+		       libusb_error_name(ret));
+		return NULL;
+	}
 	for (i = 0; devlist[i]; i++) {
 		if ((ret = libusb_get_device_descriptor(devlist[i], &des))) {
 			sr_err("Failed to get device descriptor: %s.",
@@ -434,7 +737,7 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 		usb = sr_usb_dev_inst_new(b, a, NULL);
 		devices = g_slist_append(devices, usb);
 	}
-	libusb_free_device_list(devlist, 1);
+	sr_usb_free_device_list(devlist);
 
 	/* No log message for #devices found (caller will log that). */
 
@@ -488,11 +791,304 @@ SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
 
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb)
 {
+	sr_usb_transfer_pool_free(usb);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
 	sr_dbg("Closed USB device %d.%d.", usb->bus, usb->address);
 }
 
+/* Allocate a transfer and its buffer, preferably in DMA capable memory. */
+static struct usb_pool_transfer *usb_pool_transfer_new(
+		struct sr_usb_dev_inst *usb, size_t size)
+{
+	struct usb_pool_transfer *entry;
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->size = size;
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+	entry->buffer = libusb_dev_mem_alloc(usb->devhdl, size);
+	if (entry->buffer)
+		entry->devhdl = usb->devhdl;
+#else
+	(void)usb;
+#endif
+	if (!entry->buffer)
+		entry->buffer = g_try_malloc(size);
+	entry->transfer = libusb_alloc_transfer(0);
+	if (!entry->buffer || !entry->transfer) {
+		usb_pool_transfer_free(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+static void usb_pool_transfer_free(struct usb_pool_transfer *entry)
+{
+	if (entry->transfer)
+		libusb_free_transfer(entry->transfer);
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+	if (entry->devhdl) {
+		libusb_dev_mem_free(entry->devhdl, entry->buffer, entry->size);
+		entry->buffer = NULL;
+	}
+#endif
+	g_free(entry->buffer);
+	g_free(entry);
+}
+
+/**
+ * Borrow a transfer and its buffer from the device's transfer pool.
+ *
+ * Transfers which get returned by sr_usb_transfer_put() are kept for
+ * later acquisitions, so consecutive captures need not allocate their
+ * transfers and buffers again. Where the platform supports it, buffers
+ * get allocated in memory which the kernel can DMA to directly.
+ *
+ * The returned transfer's buffer holds at least @a size bytes, and its
+ * length is set to @a size. The caller fills in the other fields, e.g.
+ * with libusb_fill_bulk_transfer(), and must keep the buffer pointer.
+ *
+ * @param usb The USB device instance. The device must be open.
+ * @param size The required buffer size in bytes.
+ *
+ * @return The transfer, or NULL upon allocation failure.
+ *
+ * @private
+ */
+SR_PRIV struct libusb_transfer *sr_usb_transfer_get(struct sr_usb_dev_inst *usb,
+		size_t size)
+{
+	struct sr_usb_transfer_pool *pool;
+	struct usb_pool_transfer *entry;
+	GSList *l;
+
+	pool = usb->transfer_pool;
+	if (!pool) {
+		pool = g_malloc0(sizeof(*pool));
+		pool->entries = g_hash_table_new(g_direct_hash, g_direct_equal);
+		usb->transfer_pool = pool;
+	}
+
+	entry = NULL;
+	for (l = pool->idle; l; l = l->next) {
+		entry = l->data;
+		if (entry->size >= size)
+			break;
+		entry = NULL;
+	}
+	if (entry) {
+		pool->idle = g_slist_remove(pool->idle, entry);
+	} else {
+		/* Buffers of an earlier, smaller size won't fit again. */
+		if (pool->idle) {
+			entry = pool->idle->data;
+			pool->idle = g_slist_delete_link(pool->idle, pool->idle);
+			g_hash_table_remove(pool->entries, entry->transfer);
+			usb_pool_transfer_free(entry);
+		}
+		if (!(entry = usb_pool_transfer_new(usb, size))) {
+			sr_err("Cannot allocate USB transfer.");
+			return NULL;
+		}
+		g_hash_table_insert(pool->entries, entry->transfer, entry);
+	}
+
+	entry->transfer->buffer = entry->buffer;
+	entry->transfer->length = size;
+
+	return entry->transfer;
+}
+
+/**
+ * Return a transfer to the device's transfer pool.
+ *
+ * The transfer must have been obtained from sr_usb_transfer_get(), and
+ * must not be in flight.
+ *
+ * @param usb The USB device instance.
+ * @param transfer The transfer to return.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_transfer_put(struct sr_usb_dev_inst *usb,
+		struct libusb_transfer *transfer)
+{
+	struct sr_usb_transfer_pool *pool;
+	struct usb_pool_transfer *entry;
+
+	pool = usb->transfer_pool;
+	entry = pool ? g_hash_table_lookup(pool->entries, transfer) : NULL;
+	if (!entry) {
+		sr_err("%s: Transfer is not from the pool.", __func__);
+		return;
+	}
+
+	transfer->buffer = entry->buffer;
+	transfer->user_data = NULL;
+	pool->idle = g_slist_prepend(pool->idle, entry);
+}
+
+/**
+ * Release the device's transfer pool.
+ *
+ * Buffers in DMA capable memory must be released before the device
+ * gets closed. Drivers which close the device handle themselves must
+ * call this before libusb_close(), sr_usb_close() takes care of it.
+ * All transfers must have been returned at this point.
+ *
+ * @param usb The USB device instance.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_transfer_pool_free(struct sr_usb_dev_inst *usb)
+{
+	struct sr_usb_transfer_pool *pool;
+	guint busy;
+
+	pool = usb->transfer_pool;
+	if (!pool)
+		return;
+
+	busy = g_hash_table_size(pool->entries) - g_slist_length(pool->idle);
+	if (busy)
+		sr_err("Releasing transfer pool with %u transfers in use.", busy);
+	g_slist_free_full(pool->idle, (GDestroyNotify)usb_pool_transfer_free);
+	g_hash_table_destroy(pool->entries);
+	g_free(pool);
+	usb->transfer_pool = NULL;
+}
+
+/** @cond PRIVATE */
+/* Number of transfers which sr_usb_bulk_write() keeps in flight. */
+#define BULK_WRITE_TRANSFERS 4
+/** @endcond */
+
+struct bulk_write {
+	struct sr_usb_dev_inst *usb;
+	unsigned char endpoint;
+	const uint8_t *data;
+	size_t len, pos, chunk_size;
+	unsigned int timeout_ms;
+	int in_flight;
+	int result;
+};
+
+static void LIBUSB_CALL bulk_write_done(struct libusb_transfer *transfer);
+
+static int bulk_write_submit(struct bulk_write *bw,
+		struct libusb_transfer *transfer)
+{
+	size_t len;
+	int ret;
+
+	len = MIN(bw->chunk_size, bw->len - bw->pos);
+	libusb_fill_bulk_transfer(transfer, bw->usb->devhdl, bw->endpoint,
+		(unsigned char *)bw->data + bw->pos, len, bulk_write_done,
+		bw, bw->timeout_ms);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit bulk write: %s.",
+			libusb_error_name(ret));
+		return SR_ERR_IO;
+	}
+	bw->pos += len;
+	bw->in_flight++;
+
+	return SR_OK;
+}
+
+static void LIBUSB_CALL bulk_write_done(struct libusb_transfer *transfer)
+{
+	struct bulk_write *bw;
+
+	bw = transfer->user_data;
+	bw->in_flight--;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Bulk write failed: %s.",
+			libusb_error_name(transfer->status));
+		bw->result = SR_ERR_IO;
+	} else if (transfer->actual_length != transfer->length) {
+		sr_err("Short bulk write, %d of %d bytes.",
+			transfer->actual_length, transfer->length);
+		bw->result = SR_ERR_IO;
+	}
+
+	if (bw->result == SR_OK && bw->pos < bw->len) {
+		bw->result = bulk_write_submit(bw, transfer);
+		if (bw->result == SR_OK)
+			return;
+	}
+	libusb_free_transfer(transfer);
+}
+
+/**
+ * Write a block of data to a bulk OUT endpoint.
+ *
+ * The data gets split into transfers of @a chunk_size bytes, several of
+ * which are kept in flight, so the device doesn't idle between them.
+ * Returns when all of the data was written, or on the first error.
+ *
+ * @param ctx The libsigrok context, which handles the libusb events.
+ * @param usb The opened device.
+ * @param endpoint The endpoint address.
+ * @param data The data to write. Must not be NULL.
+ * @param len The number of bytes to write.
+ * @param chunk_size The largest transfer which the device accepts.
+ * @param timeout_ms The timeout of each transfer.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO A transfer failed, or was short.
+ * @retval SR_ERR_MALLOC Cannot allocate transfers.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_bulk_write(struct sr_context *ctx,
+		struct sr_usb_dev_inst *usb, unsigned char endpoint,
+		const uint8_t *data, size_t len, size_t chunk_size,
+		unsigned int timeout_ms)
+{
+	struct bulk_write bw;
+	struct libusb_transfer *transfer;
+	struct timeval tv;
+	int i, ret;
+
+	if (!ctx || !usb || !usb->devhdl || (len && !data) || !chunk_size)
+		return SR_ERR_ARG;
+
+	memset(&bw, 0, sizeof(bw));
+	bw.usb = usb;
+	bw.endpoint = endpoint;
+	bw.data = data;
+	bw.len = len;
+	bw.chunk_size = chunk_size;
+	bw.timeout_ms = timeout_ms;
+	bw.result = SR_OK;
+
+	for (i = 0; i < BULK_WRITE_TRANSFERS && bw.pos < bw.len; i++) {
+		if (!(transfer = libusb_alloc_transfer(0))) {
+			bw.result = SR_ERR_MALLOC;
+			break;
+		}
+		if ((ret = bulk_write_submit(&bw, transfer)) != SR_OK) {
+			libusb_free_transfer(transfer);
+			bw.result = ret;
+			break;
+		}
+	}
+
+	/* Completed transfers resubmit themselves until all is written. */
+	while (bw.in_flight > 0) {
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		libusb_handle_events_timeout_completed(ctx->libusb_ctx,
+			&tv, NULL);
+	}
+
+	return bw.result;
+}
+
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data)
 {
@@ -516,6 +1112,75 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
+/**
+ * Change the timeout of a session's USB event source.
+ *
+ * When called from the source's callback, the new timeout applies to
+ * the next invocation already.
+ *
+ * @param session The session the source was added to.
+ * @param ctx The libsigrok context.
+ * @param timeout The time between invocations in ms, -1 for none.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The session has no USB event source.
+ *
+ * @private
+ */
+SR_PRIV int usb_source_timeout_set(struct sr_session *session,
+		struct sr_context *ctx, int timeout)
+{
+	struct usb_source *usource;
+	GSList *l;
+
+	G_LOCK(usb_sources);
+	for (l = usb_sources; l; l = l->next) {
+		usource = l->data;
+		if (usource->session == session &&
+				usource->usb_ctx == ctx->libusb_ctx)
+			break;
+	}
+	if (l) {
+		usource->timeout_us = 1000 * (int64_t)timeout;
+		if (timeout >= 0)
+			usource->due_us = g_get_monotonic_time() +
+				usource->timeout_us;
+		else
+			usource->due_us = INT64_MAX;
+	}
+	G_UNLOCK(usb_sources);
+
+	return l ? SR_OK : SR_ERR_ARG;
+}
+
+/**
+ * Handle libusb events in a GLib main context, outside of any session.
+ *
+ * @param ctx The libsigrok context.
+ * @param main_ctx The main context to attach to, NULL for the default.
+ * @param cb Function to call when libusb has events to handle.
+ * @param cb_data Opaque pointer to pass to @a cb.
+ *
+ * @return The attached event source, to be destroyed by the caller.
+ *         NULL on failure.
+ *
+ * @private
+ */
+SR_PRIV GSource *usb_source_attach(struct sr_context *ctx,
+		GMainContext *main_ctx, sr_receive_data_callback cb, void *cb_data)
+{
+	GSource *source;
+
+	source = usb_source_new(NULL, ctx->libusb_ctx, -1);
+	if (!source)
+		return NULL;
+
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+	g_source_attach(source, main_ctx);
+
+	return source;
+}
+
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
@@ -555,46 +1220,155 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 	return SR_OK;
 }
 
-/**
- * Check the USB configuration to determine if this device has a given
- * manufacturer and product string.
- *
- * @return TRUE if the device's configuration profile strings
- *         configuration, FALSE otherwise.
- */
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product)
+/* Time it takes for an FX2 to be gone from the bus after the upload. */
+#define RENUM_GONE_MS 300
+/* Probe interval, when the device did not show up (yet). */
+#define RENUM_POLL_MS 100
+/* Probe interval after the device showed up, while its node gets set up. */
+#define RENUM_RETRY_MS 10
+
+struct renum_watch {
+	const char *port_path;
+	gint arrivals;
+};
+
+static int LIBUSB_CALL renum_arrived(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
 {
-	struct libusb_device_descriptor des;
-	struct libusb_device_handle *hdl;
-	gboolean ret;
-	unsigned char strdesc[64];
+	struct renum_watch *watch;
+	char path[64];
 
-	hdl = NULL;
-	ret = FALSE;
-	while (!ret) {
-		/* Assume the FW has not been loaded, unless proven wrong. */
-		libusb_get_device_descriptor(dev, &des);
+	(void)usb_ctx;
+	(void)event;
 
-		if (libusb_open(dev, &hdl) != 0)
-			break;
+	watch = user_data;
+#if defined(__FreeBSD__) || defined(__APPLE__)
+	/* Port paths take an open device here, leave it to the probe. */
+	(void)dev;
+	(void)path;
+	g_atomic_int_inc(&watch->arrivals);
+#else
+	if (usb_get_port_path(dev, path, sizeof(path)) == SR_OK &&
+			strcmp(path, watch->port_path) == 0)
+		g_atomic_int_inc(&watch->arrivals);
+#endif
+
+	return 0;
+}
 
-		if (libusb_get_string_descriptor_ascii(hdl,
-				des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
+/* Wait until @a end_time, or until a device arrives at the watched port. */
+static void renum_wait(struct sr_context *ctx, struct renum_watch *watch,
+		gboolean watching, int64_t end_time)
+{
+	struct timeval tv;
+	int64_t now, left;
+	gint seen;
+
+	seen = g_atomic_int_get(&watch->arrivals);
+	while ((now = g_get_monotonic_time()) < end_time) {
+		left = end_time - now;
+		if (!watching) {
+			g_usleep(left);
 			break;
-		if (strcmp((const char *)strdesc, manufacturer))
+		}
+		tv.tv_sec = left / G_USEC_PER_SEC;
+		tv.tv_usec = left % G_USEC_PER_SEC;
+		libusb_handle_events_timeout_completed(ctx->libusb_ctx, &tv,
+			NULL);
+		if (g_atomic_int_get(&watch->arrivals) != seen)
 			break;
+	}
+}
+
+/**
+ * Wait for a device to come back after its firmware was uploaded.
+ *
+ * Devices renumerate after a firmware upload, and come back with
+ * another address at the same port (the device's connection ID).
+ * Arrivals at that port get watched for where libusb supports hotplug,
+ * the probe runs as soon as the device shows up. Elsewhere the probe
+ * runs every 100ms.
+ *
+ * @param sdi The device instance, with its connection ID.
+ * @param fw_updated When the firmware upload completed, in monotonic time.
+ * @param timeout_ms How long after the upload to wait for the device.
+ * @param probe Routine which opens the renumerated device, returns SR_OK
+ *              when it succeeds.
+ *
+ * @return The result of the last probe.
+ *
+ * @private
+ */
+SR_PRIV int usb_wait_renumeration(struct sr_dev_inst *sdi,
+		int64_t fw_updated, int timeout_ms,
+		int (*probe)(struct sr_dev_inst *sdi))
+{
+	struct drv_context *drvc;
+	struct sr_context *ctx;
+	struct renum_watch watch;
+	libusb_hotplug_callback_handle handle;
+	struct sr_profile_scope scope;
+	gboolean watching;
+	int64_t deadline, now, next;
+	int ret;
 
-		if (libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, strdesc, sizeof(strdesc)) < 0)
+	drvc = sdi->driver->context;
+	ctx = drvc->sr_ctx;
+	sr_profile_begin(&scope, ctx, SR_PROFILE_RENUMERATION, NULL, sdi);
+
+	watch.port_path = sdi->connection_id;
+	watch.arrivals = 0;
+	watching = sdi->connection_id &&
+		libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+		libusb_hotplug_register_callback(ctx->libusb_ctx,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, 0,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, renum_arrived, &watch,
+			&handle) == LIBUSB_SUCCESS;
+
+	/* The device cannot be back before it was gone. */
+	renum_wait(ctx, &watch, watching, fw_updated + RENUM_GONE_MS * 1000);
+
+	deadline = fw_updated + (int64_t)timeout_ms * 1000;
+	for (;;) {
+		if ((ret = probe(sdi)) == SR_OK)
 			break;
-		if (strcmp((const char *)strdesc, product))
+		now = g_get_monotonic_time();
+		if (now >= deadline)
 			break;
-
-		ret = TRUE;
+		next = now + (g_atomic_int_get(&watch.arrivals) ?
+			RENUM_RETRY_MS : RENUM_POLL_MS) * 1000;
+		renum_wait(ctx, &watch, watching, MIN(next, deadline));
+		sr_spew("Waited %" PRIi64 "ms.",
+			(g_get_monotonic_time() - fw_updated) / 1000);
 	}
-	if (hdl)
-		libusb_close(hdl);
+	if (watching)
+		libusb_hotplug_deregister_callback(ctx->libusb_ctx, handle);
+
+	if (ret == SR_OK)
+		sr_info("Device came back after %" PRIi64 "ms.",
+			(g_get_monotonic_time() - fw_updated) / 1000);
+	sr_profile_end(&scope, ret);
 
 	return ret;
 }
+
+/**
+ * Check the USB configuration to determine if this device has a given
+ * manufacturer and product string.
+ *
+ * @return TRUE if the device's configuration profile strings
+ *         configuration, FALSE otherwise.
+ */
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product)
+{
+	char manuf_str[64], prod_str[64];
+
+	/* Assume the FW has not been loaded, unless proven wrong. */
+	if (sr_usb_get_strings(ctx, dev, manuf_str, prod_str, NULL,
+			sizeof(manuf_str)) != SR_OK)
+		return FALSE;
+
+	return !strcmp(manuf_str, manufacturer) && !strcmp(prod_str, product);
+}
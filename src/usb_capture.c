@@ -0,0 +1,461 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Recording and replay of USB transfers.
+ *
+ * While a capture file is set on the context, drivers pass each completed
+ * transfer to sr_usb_capture_transfer() before they decode it. Replaying
+ * the file feeds its transfers to a driver's transfer callback again,
+ * without the hardware, which makes the decode paths available to
+ * benchmarks and regression tests.
+ *
+ * The file starts with a header, followed by one record per transfer,
+ * all integers are little endian:
+ *
+ *   header: "SRUSBCAP", uint32 version, char driver[32]
+ *   record: uint64 time (us), int32 status, uint32 length,
+ *           uint8 endpoint, 3 reserved bytes, <length> bytes of data
+ *
+ * Replayed transfers have no device handle. Drivers resubmit transfers
+ * with sr_usb_submit_transfer(), which hands those back to the replay
+ * instead of libusb.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "usb-capture"
+/** @endcond */
+
+/**
+ * @defgroup grp_usb_capture USB capture
+ *
+ * Recording of USB transfers, for replaying them without the hardware.
+ *
+ * @{
+ */
+
+#define CAPTURE_MAGIC "SRUSBCAP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_DRIVER_LEN 32
+#define CAPTURE_HEADER_SIZE (8 + 4 + CAPTURE_DRIVER_LEN)
+#define CAPTURE_RECORD_SIZE (8 + 4 + 4 + 4)
+
+#ifdef HAVE_LIBUSB_1_0
+
+struct sr_usb_capture {
+	GMutex mutex;
+	FILE *file;
+	gboolean header_written;
+	gint64 start;
+};
+
+struct replay_record {
+	int status;
+	uint8_t endpoint;
+	size_t offset;
+	size_t length;
+};
+
+struct sr_usb_replay {
+	char driver[CAPTURE_DRIVER_LEN + 1];
+	GArray *records;
+	GByteArray *data;
+	/* Set by sr_usb_submit_transfer() while the callback runs. */
+	gboolean resubmitted;
+};
+
+static GPrivate current_replay;
+
+#endif
+
+/**
+ * Record the USB transfers of all devices to a file.
+ *
+ * Drivers which support this record the data they receive with bulk
+ * transfers during acquisitions. The file holds the transfers of the
+ * first device which starts receiving.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param filename The file to write. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or recording was started already.
+ * @retval SR_ERR_IO The file cannot be created.
+ * @retval SR_ERR_NA Built without USB support.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_usb_capture_start(struct sr_context *ctx, const char *filename)
+{
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_usb_capture *capture;
+	FILE *file;
+
+	if (!ctx || !filename || ctx->usb_capture)
+		return SR_ERR_ARG;
+
+	if (!(file = g_fopen(filename, "wb"))) {
+		sr_err("Cannot create %s: %s.", filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
+	capture = g_malloc0(sizeof(*capture));
+	g_mutex_init(&capture->mutex);
+	capture->file = file;
+	capture->start = g_get_monotonic_time();
+	g_atomic_pointer_set(&ctx->usb_capture, capture);
+	sr_info("Recording USB transfers to %s.", filename);
+
+	return SR_OK;
+#else
+	(void)ctx;
+	(void)filename;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Stop recording USB transfers, and close the file.
+ *
+ * Must not be called while an acquisition runs.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or recording was not started.
+ * @retval SR_ERR_IO The file could not be written completely.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_usb_capture_stop(struct sr_context *ctx)
+{
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_usb_capture *capture;
+	int ret;
+
+	if (!ctx || !(capture = ctx->usb_capture))
+		return SR_ERR_ARG;
+
+	g_atomic_pointer_set(&ctx->usb_capture, NULL);
+	ret = SR_OK;
+	if (ferror(capture->file) || fclose(capture->file) != 0) {
+		sr_err("Cannot write the USB capture file.");
+		ret = SR_ERR_IO;
+	}
+	g_mutex_clear(&capture->mutex);
+	g_free(capture);
+
+	return ret;
+#else
+	(void)ctx;
+
+	return SR_ERR_ARG;
+#endif
+}
+
+/** @} */
+
+#ifdef HAVE_LIBUSB_1_0
+
+/**
+ * Record a completed transfer, when recording was started.
+ *
+ * @param sdi The device which received the transfer.
+ * @param transfer The completed transfer.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_capture_transfer(const struct sr_dev_inst *sdi,
+		const struct libusb_transfer *transfer)
+{
+	struct sr_usb_capture *capture;
+	uint8_t header[CAPTURE_HEADER_SIZE];
+	uint8_t record[CAPTURE_RECORD_SIZE];
+	size_t length;
+
+	if (!sdi || !sdi->session || !sdi->session->ctx)
+		return;
+	capture = g_atomic_pointer_get(&sdi->session->ctx->usb_capture);
+	if (!capture)
+		return;
+
+	length = MAX(transfer->actual_length, 0);
+	g_mutex_lock(&capture->mutex);
+	if (!capture->header_written) {
+		memset(header, 0, sizeof(header));
+		memcpy(header, CAPTURE_MAGIC, 8);
+		WL32(&header[8], CAPTURE_VERSION);
+		if (sdi->driver)
+			g_strlcpy((char *)&header[12], sdi->driver->name,
+				CAPTURE_DRIVER_LEN);
+		fwrite(header, sizeof(header), 1, capture->file);
+		capture->header_written = TRUE;
+	}
+	memset(record, 0, sizeof(record));
+	WL64(&record[0], g_get_monotonic_time() - capture->start);
+	WL32(&record[8], transfer->status);
+	WL32(&record[12], length);
+	record[16] = transfer->endpoint;
+	fwrite(record, sizeof(record), 1, capture->file);
+	if (length)
+		fwrite(transfer->buffer, length, 1, capture->file);
+	g_mutex_unlock(&capture->mutex);
+}
+
+/**
+ * Submit a transfer, or hand it back to a running replay.
+ *
+ * Drivers resubmit completed transfers with this, in place of
+ * libusb_submit_transfer().
+ *
+ * @param transfer The transfer to submit.
+ *
+ * @return A libusb error code, LIBUSB_SUCCESS when the transfer was
+ *         submitted.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_submit_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_usb_replay *replay;
+
+	if (transfer->dev_handle)
+		return libusb_submit_transfer(transfer);
+
+	if (!(replay = g_private_get(&current_replay)))
+		return LIBUSB_ERROR_NO_DEVICE;
+	replay->resubmitted = TRUE;
+
+	return LIBUSB_SUCCESS;
+}
+
+/**
+ * Create an empty replay, for adding transfers to.
+ *
+ * @param driver The name of the driver which the transfers are for.
+ *
+ * @return The new replay.
+ *
+ * @private
+ */
+SR_PRIV struct sr_usb_replay *sr_usb_replay_new(const char *driver)
+{
+	struct sr_usb_replay *replay;
+
+	replay = g_malloc0(sizeof(*replay));
+	if (driver)
+		g_strlcpy(replay->driver, driver, sizeof(replay->driver));
+	replay->records = g_array_new(FALSE, FALSE, sizeof(struct replay_record));
+	replay->data = g_byte_array_new();
+
+	return replay;
+}
+
+/**
+ * Add a transfer to a replay.
+ *
+ * @param replay The replay.
+ * @param endpoint The endpoint which the transfer was for.
+ * @param status The transfer's completion status.
+ * @param data The received data, can be NULL when @a length is 0.
+ * @param length The number of bytes received.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_replay_add(struct sr_usb_replay *replay, uint8_t endpoint,
+		int status, const uint8_t *data, size_t length)
+{
+	struct replay_record rec;
+
+	rec.status = status;
+	rec.endpoint = endpoint;
+	rec.offset = replay->data->len;
+	rec.length = length;
+	g_array_append_val(replay->records, rec);
+	if (length)
+		g_byte_array_append(replay->data, data, length);
+}
+
+/**
+ * Load a file written while recording USB transfers.
+ *
+ * @param filename The file to read.
+ *
+ * @return The replay, NULL when the file cannot be read or is not
+ *         a USB capture.
+ *
+ * @private
+ */
+SR_PRIV struct sr_usb_replay *sr_usb_replay_load(const char *filename)
+{
+	struct sr_usb_replay *replay;
+	GError *error;
+	gchar *contents;
+	gsize size, pos, length;
+	char driver[CAPTURE_DRIVER_LEN + 1];
+
+	error = NULL;
+	if (!g_file_get_contents(filename, &contents, &size, &error)) {
+		sr_err("Cannot read %s: %s.", filename, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+	if (size < CAPTURE_HEADER_SIZE || memcmp(contents, CAPTURE_MAGIC, 8)
+			|| RL32(&contents[8]) != CAPTURE_VERSION) {
+		sr_err("%s is not a USB capture.", filename);
+		g_free(contents);
+		return NULL;
+	}
+
+	memcpy(driver, &contents[12], CAPTURE_DRIVER_LEN);
+	driver[CAPTURE_DRIVER_LEN] = '\0';
+	replay = sr_usb_replay_new(driver);
+	pos = CAPTURE_HEADER_SIZE;
+	while (pos + CAPTURE_RECORD_SIZE <= size) {
+		length = RL32(&contents[pos + 12]);
+		if (length > size - pos - CAPTURE_RECORD_SIZE) {
+			sr_warn("Truncated record at offset %" G_GSIZE_FORMAT
+				" in %s.", pos, filename);
+			break;
+		}
+		sr_usb_replay_add(replay, contents[pos + 16],
+			(int32_t)RL32(&contents[pos + 8]),
+			(const uint8_t *)&contents[pos + CAPTURE_RECORD_SIZE],
+			length);
+		pos += CAPTURE_RECORD_SIZE + length;
+	}
+	g_free(contents);
+	sr_dbg("Loaded %u transfers for %s from %s.",
+		replay->records->len, replay->driver, filename);
+
+	return replay;
+}
+
+/**
+ * Get the name of the driver which a replay's transfers are for.
+ *
+ * @param replay The replay.
+ *
+ * @return The driver name, empty when unknown.
+ *
+ * @private
+ */
+SR_PRIV const char *sr_usb_replay_driver(const struct sr_usb_replay *replay)
+{
+	return replay->driver;
+}
+
+/**
+ * Feed a replay's transfers to a driver's transfer callback.
+ *
+ * All transfers go through one libusb_transfer, which the callback is
+ * expected to resubmit with sr_usb_submit_transfer(). The replay ends
+ * early when the callback doesn't; the transfer then belongs to the
+ * driver, which has to free it (and its buffer, with g_free()).
+ *
+ * The driver's device context must be set up for an acquisition.
+ *
+ * @param replay The replay.
+ * @param sdi The device, which the transfers get as their user data.
+ * @param callback The driver's transfer callback.
+ * @param buffer_size The size of the transfer's buffer. Longer
+ *                    transfers get truncated.
+ * @param bytes Where to add up the number of bytes replayed, can be NULL.
+ *
+ * @return The number of transfers replayed.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_usb_replay_run(struct sr_usb_replay *replay,
+		struct sr_dev_inst *sdi, libusb_transfer_cb_fn callback,
+		size_t buffer_size, uint64_t *bytes)
+{
+	struct libusb_transfer *transfer;
+	const struct replay_record *rec;
+	size_t i, length;
+
+	if (!(transfer = libusb_alloc_transfer(0)))
+		return 0;
+	transfer->buffer = g_malloc0(buffer_size);
+
+	g_private_set(&current_replay, replay);
+	for (i = 0; i < replay->records->len; i++) {
+		rec = &g_array_index(replay->records, struct replay_record, i);
+		length = MIN(rec->length, buffer_size);
+		memcpy(transfer->buffer, replay->data->data + rec->offset, length);
+		transfer->dev_handle = NULL;
+		transfer->endpoint = rec->endpoint;
+		transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
+		transfer->length = buffer_size;
+		transfer->actual_length = length;
+		transfer->status = rec->status;
+		transfer->callback = callback;
+		transfer->user_data = sdi;
+		if (bytes)
+			*bytes += length;
+
+		replay->resubmitted = FALSE;
+		callback(transfer);
+		if (!replay->resubmitted) {
+			transfer = NULL;
+			i++;
+			break;
+		}
+	}
+	g_private_set(&current_replay, NULL);
+
+	if (transfer) {
+		g_free(transfer->buffer);
+		transfer->buffer = NULL;
+		libusb_free_transfer(transfer);
+	}
+
+	return i;
+}
+
+/**
+ * Free a replay.
+ *
+ * @param replay The replay, can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_replay_free(struct sr_usb_replay *replay)
+{
+	if (!replay)
+		return;
+
+	g_array_free(replay->records, TRUE);
+	g_byte_array_free(replay->data, TRUE);
+	g_free(replay);
+}
+
+#endif
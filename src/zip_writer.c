@@ -0,0 +1,565 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Streaming ZIP archive writer.
+ *
+ * libzip keeps everything that was added to an archive until the archive
+ * gets closed, and then rewrites the central directory. Appending chunks
+ * to a session file by re-opening it for each chunk is quadratic in I/O.
+ *
+ * This writer keeps the file open, writes each member (local header and
+ * data) as soon as it is added, and only keeps the small central directory
+ * records in memory. The directory is written when the archive gets
+ * finished. ZIP64 records are used when offsets or the number of members
+ * exceed the classic format's limits. Members are deflated when zlib is
+ * available, and stored otherwise. Callers may ask for zstd compressed
+ * members (method 93 of the ZIP specification) instead, which compress
+ * and decompress several times faster, when libzstd is available.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "zip-writer"
+/** @endcond */
+
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP_EOCD_SIG		0x06054b50
+#define ZIP64_EOCD_SIG		0x06064b50
+#define ZIP64_LOCATOR_SIG	0x07064b50
+
+#define ZIP_VERSION_STORE	10
+#define ZIP_VERSION_DEFLATE	20
+#define ZIP_VERSION_ZIP64	45
+#define ZIP_VERSION_ZSTD	63
+
+#define ZIP_LOCAL_HEADER_SIZE	30
+#define ZIP_CENTRAL_HEADER_SIZE	46
+#define ZIP_EOCD_SIZE		22
+#define ZIP64_EOCD_SIZE		56
+#define ZIP64_LOCATOR_SIZE	20
+
+struct zip_writer_entry {
+	char *name;
+	uint16_t method;
+	uint32_t crc;
+	uint64_t csize;
+	uint64_t usize;
+	uint64_t offset;
+};
+
+struct sr_zip_writer {
+	FILE *file;
+	char *filename;
+	uint64_t offset;
+	GArray *entries;
+	uint16_t dos_time;
+	uint16_t dos_date;
+};
+
+static void set_dos_timestamp(struct sr_zip_writer *zw)
+{
+	time_t now;
+	struct tm *tm;
+
+	now = time(NULL);
+	tm = localtime(&now);
+	if (!tm || tm->tm_year < 80) {
+		/* 1980-01-01 00:00:00, the earliest DOS date. */
+		zw->dos_time = 0;
+		zw->dos_date = (1 << 5) | 1;
+		return;
+	}
+	zw->dos_time = (tm->tm_hour << 11) | (tm->tm_min << 5) |
+		(tm->tm_sec / 2);
+	zw->dos_date = ((tm->tm_year - 80) << 9) | ((tm->tm_mon + 1) << 5) |
+		tm->tm_mday;
+}
+
+static int zw_write(struct sr_zip_writer *zw, const void *data, size_t len)
+{
+	if (!len)
+		return SR_OK;
+	if (fwrite(data, 1, len, zw->file) != len) {
+		sr_err("Cannot write to '%s': %s.", zw->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	zw->offset += len;
+
+	return SR_OK;
+}
+
+static void entry_clear(gpointer data)
+{
+	struct zip_writer_entry *entry;
+
+	entry = data;
+	g_free(entry->name);
+}
+
+/**
+ * Create a ZIP archive for streamed writing.
+ *
+ * An existing file of the same name gets replaced.
+ *
+ * @param filename The name of the archive file.
+ *
+ * @return The writer, or NULL upon errors.
+ *
+ * @private
+ */
+SR_PRIV struct sr_zip_writer *sr_zip_writer_open(const char *filename)
+{
+	struct sr_zip_writer *zw;
+	FILE *file;
+
+	if (!filename)
+		return NULL;
+
+	file = g_fopen(filename, "wb");
+	if (!file) {
+		sr_err("Cannot create '%s': %s.", filename, g_strerror(errno));
+		return NULL;
+	}
+
+	zw = g_malloc0(sizeof(*zw));
+	zw->file = file;
+	zw->filename = g_strdup(filename);
+	zw->entries = g_array_new(FALSE, FALSE, sizeof(struct zip_writer_entry));
+	g_array_set_clear_func(zw->entries, entry_clear);
+	set_dos_timestamp(zw);
+
+	return zw;
+}
+
+/*
+ * Deflate a buffer. Returns the compressed data in a newly allocated
+ * buffer, or NULL when compression is unavailable or does not pay off.
+ */
+static uint8_t *deflate_buffer(const void *data, size_t length, int level,
+	size_t *clength)
+{
+#ifdef HAVE_ZLIB
+	z_stream strm;
+	uint8_t *cbuf;
+	size_t bound;
+	int ret;
+
+	if (level == 0 || !length || length > G_MAXUINT32)
+		return NULL;
+
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK)
+		return NULL;
+	bound = deflateBound(&strm, length);
+	cbuf = g_try_malloc(bound);
+	if (!cbuf) {
+		deflateEnd(&strm);
+		return NULL;
+	}
+	strm.next_in = (void *)data;
+	strm.avail_in = length;
+	strm.next_out = cbuf;
+	strm.avail_out = bound;
+	ret = deflate(&strm, Z_FINISH);
+	deflateEnd(&strm);
+	if (ret != Z_STREAM_END || strm.total_out >= length) {
+		g_free(cbuf);
+		return NULL;
+	}
+	*clength = strm.total_out;
+
+	return cbuf;
+#else
+	(void)data;
+	(void)length;
+	(void)level;
+	(void)clength;
+
+	return NULL;
+#endif
+}
+
+/*
+ * Compress a buffer with zstd. Returns the compressed data in a newly
+ * allocated buffer, or NULL when compression does not pay off.
+ */
+static uint8_t *zstd_buffer(const void *data, size_t length, int level,
+	size_t *clength)
+{
+#ifdef HAVE_LIBZSTD
+	uint8_t *cbuf;
+	size_t bound, ret;
+
+	if (level == 0 || !length || length > G_MAXUINT32)
+		return NULL;
+
+	bound = ZSTD_compressBound(length);
+	cbuf = g_try_malloc(bound);
+	if (!cbuf)
+		return NULL;
+	ret = ZSTD_compress(cbuf, bound, data, length, level < 0 ? 3 : level);
+	if (ZSTD_isError(ret) || ret >= length) {
+		g_free(cbuf);
+		return NULL;
+	}
+	*clength = ret;
+
+	return cbuf;
+#else
+	(void)data;
+	(void)length;
+	(void)level;
+	(void)clength;
+
+	return NULL;
+#endif
+}
+
+static uint16_t version_needed(uint16_t method)
+{
+	if (method == SR_ZIP_METHOD_ZSTD)
+		return ZIP_VERSION_ZSTD;
+	if (method == SR_ZIP_METHOD_DEFLATE)
+		return ZIP_VERSION_DEFLATE;
+
+	return ZIP_VERSION_STORE;
+}
+
+/**
+ * Check whether members can get compressed with a method.
+ *
+ * @param method One of the SR_ZIP_METHOD_* values.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_zip_method_supported(uint16_t method)
+{
+	switch (method) {
+	case SR_ZIP_METHOD_STORE:
+		return TRUE;
+	case SR_ZIP_METHOD_DEFLATE:
+#ifdef HAVE_ZLIB
+		return TRUE;
+#else
+		return FALSE;
+#endif
+	case SR_ZIP_METHOD_ZSTD:
+#ifdef HAVE_LIBZSTD
+		return TRUE;
+#else
+		return FALSE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * Prepare the content of an archive member.
+ *
+ * This computes the checksum and compresses the content. It does not
+ * touch any writer, so several members can be prepared concurrently
+ * from different threads. The caller's buffer must remain valid until
+ * the member was added, and the member must be released with
+ * sr_zip_member_clear() afterwards.
+ *
+ * @param member The member to prepare.
+ * @param data The member's content.
+ * @param length The size of the content in bytes.
+ * @param method SR_ZIP_METHOD_DEFLATE or SR_ZIP_METHOD_ZSTD. Content
+ *               which does not shrink is stored.
+ * @param level Compression level, -1 for the default, 0 to store the
+ *              content without compression, 1 to 9 for deflate levels,
+ *              1 to 19 for zstd levels.
+ *
+ * @private
+ */
+SR_PRIV void sr_zip_member_prepare(struct sr_zip_member *member,
+	const void *data, size_t length, uint16_t method, int level)
+{
+	memset(member, 0, sizeof(*member));
+	member->usize = length;
+	member->crc = sr_crc32(0, data, length);
+	if (method == SR_ZIP_METHOD_ZSTD)
+		member->cbuf = zstd_buffer(data, length, level, &member->csize);
+	else
+		member->cbuf = deflate_buffer(data, length, level, &member->csize);
+	if (member->cbuf) {
+		member->method = method;
+		member->data = member->cbuf;
+	} else {
+		member->method = SR_ZIP_METHOD_STORE;
+		member->csize = length;
+		member->data = data;
+	}
+}
+
+/**
+ * Release the resources of a prepared archive member.
+ *
+ * @param member The member.
+ *
+ * @private
+ */
+SR_PRIV void sr_zip_member_clear(struct sr_zip_member *member)
+{
+	g_free(member->cbuf);
+	memset(member, 0, sizeof(*member));
+}
+
+/**
+ * Add a prepared member to a ZIP archive.
+ *
+ * The member's data is written to the file before this routine returns.
+ *
+ * @param zw The writer.
+ * @param name The member's name within the archive.
+ * @param member The member, see sr_zip_member_prepare().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Write error.
+ *
+ * @private
+ */
+SR_PRIV int sr_zip_writer_add_member(struct sr_zip_writer *zw,
+	const char *name, const struct sr_zip_member *member)
+{
+	struct zip_writer_entry entry;
+	uint8_t header[ZIP_LOCAL_HEADER_SIZE];
+	size_t namelen;
+	int ret;
+
+	if (!zw || !name || !member || (!member->data && member->csize))
+		return SR_ERR_ARG;
+	namelen = strlen(name);
+	if (namelen > G_MAXUINT16 || member->usize >= G_MAXUINT32)
+		return SR_ERR_ARG;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.method = member->method;
+	entry.crc = member->crc;
+	entry.csize = member->csize;
+	entry.usize = member->usize;
+	entry.offset = zw->offset;
+
+	write_u32le(&header[0], ZIP_LOCAL_HEADER_SIG);
+	write_u16le(&header[4], version_needed(entry.method));
+	write_u16le(&header[6], 0);
+	write_u16le(&header[8], entry.method);
+	write_u16le(&header[10], zw->dos_time);
+	write_u16le(&header[12], zw->dos_date);
+	write_u32le(&header[14], entry.crc);
+	write_u32le(&header[18], entry.csize);
+	write_u32le(&header[22], entry.usize);
+	write_u16le(&header[26], namelen);
+	write_u16le(&header[28], 0);
+
+	ret = zw_write(zw, header, sizeof(header));
+	if (ret == SR_OK)
+		ret = zw_write(zw, name, namelen);
+	if (ret == SR_OK)
+		ret = zw_write(zw, member->data, entry.csize);
+	if (ret != SR_OK)
+		return ret;
+
+	entry.name = g_strdup(name);
+	g_array_append_val(zw->entries, entry);
+
+	return SR_OK;
+}
+
+/**
+ * Add a member to a ZIP archive.
+ *
+ * The member's data is written to the file before this routine returns,
+ * the caller's buffer is not referenced afterwards.
+ *
+ * @param zw The writer.
+ * @param name The member's name within the archive.
+ * @param data The member's content.
+ * @param length The size of the content in bytes.
+ * @param level Compression level, -1 for the default, 0 to store the
+ *              content without compression, 1 to 9 for deflate levels.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Write error.
+ *
+ * @private
+ */
+SR_PRIV int sr_zip_writer_add(struct sr_zip_writer *zw, const char *name,
+	const void *data, size_t length, int level)
+{
+	struct sr_zip_member member;
+	int ret;
+
+	if (!zw || !name || (!data && length))
+		return SR_ERR_ARG;
+
+	sr_zip_member_prepare(&member, data, length, SR_ZIP_METHOD_DEFLATE, level);
+	ret = sr_zip_writer_add_member(zw, name, &member);
+	sr_zip_member_clear(&member);
+
+	return ret;
+}
+
+static int write_central_directory(struct sr_zip_writer *zw)
+{
+	struct zip_writer_entry *entry;
+	uint8_t header[ZIP_CENTRAL_HEADER_SIZE];
+	uint8_t extra[4 + 8];
+	uint8_t eocd[ZIP64_EOCD_SIZE];
+	uint64_t cd_offset, cd_size, eocd64_offset, count;
+	gboolean need_zip64;
+	size_t namelen, idx;
+	int ret;
+
+	cd_offset = zw->offset;
+	count = zw->entries->len;
+	for (idx = 0; idx < zw->entries->len; idx++) {
+		entry = &g_array_index(zw->entries, struct zip_writer_entry, idx);
+		namelen = strlen(entry->name);
+		need_zip64 = entry->offset >= G_MAXUINT32;
+
+		write_u32le(&header[0], ZIP_CENTRAL_HEADER_SIG);
+		write_u16le(&header[4], ZIP_VERSION_ZSTD);
+		write_u16le(&header[6], MAX(version_needed(entry->method),
+			need_zip64 ? ZIP_VERSION_ZIP64 : 0));
+		write_u16le(&header[8], 0);
+		write_u16le(&header[10], entry->method);
+		write_u16le(&header[12], zw->dos_time);
+		write_u16le(&header[14], zw->dos_date);
+		write_u32le(&header[16], entry->crc);
+		write_u32le(&header[20], entry->csize);
+		write_u32le(&header[24], entry->usize);
+		write_u16le(&header[28], namelen);
+		write_u16le(&header[30], need_zip64 ? sizeof(extra) : 0);
+		write_u16le(&header[32], 0);
+		write_u16le(&header[34], 0);
+		write_u16le(&header[36], 0);
+		write_u32le(&header[38], 0);
+		write_u32le(&header[42], need_zip64 ?
+			G_MAXUINT32 : entry->offset);
+		ret = zw_write(zw, header, sizeof(header));
+		if (ret == SR_OK)
+			ret = zw_write(zw, entry->name, namelen);
+		if (ret == SR_OK && need_zip64) {
+			write_u16le(&extra[0], 0x0001);
+			write_u16le(&extra[2], 8);
+			write_u64le(&extra[4], entry->offset);
+			ret = zw_write(zw, extra, sizeof(extra));
+		}
+		if (ret != SR_OK)
+			return ret;
+	}
+	cd_size = zw->offset - cd_offset;
+
+	need_zip64 = count >= G_MAXUINT16 || cd_offset >= G_MAXUINT32 ||
+		cd_size >= G_MAXUINT32;
+	if (need_zip64) {
+		eocd64_offset = zw->offset;
+		write_u32le(&eocd[0], ZIP64_EOCD_SIG);
+		write_u64le(&eocd[4], ZIP64_EOCD_SIZE - 12);
+		write_u16le(&eocd[12], ZIP_VERSION_ZIP64);
+		write_u16le(&eocd[14], ZIP_VERSION_ZIP64);
+		write_u32le(&eocd[16], 0);
+		write_u32le(&eocd[20], 0);
+		write_u64le(&eocd[24], count);
+		write_u64le(&eocd[32], count);
+		write_u64le(&eocd[40], cd_size);
+		write_u64le(&eocd[48], cd_offset);
+		ret = zw_write(zw, eocd, ZIP64_EOCD_SIZE);
+		if (ret != SR_OK)
+			return ret;
+
+		write_u32le(&eocd[0], ZIP64_LOCATOR_SIG);
+		write_u32le(&eocd[4], 0);
+		write_u64le(&eocd[8], eocd64_offset);
+		write_u32le(&eocd[16], 1);
+		ret = zw_write(zw, eocd, ZIP64_LOCATOR_SIZE);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	write_u32le(&eocd[0], ZIP_EOCD_SIG);
+	write_u16le(&eocd[4], 0);
+	write_u16le(&eocd[6], 0);
+	write_u16le(&eocd[8], MIN(count, G_MAXUINT16));
+	write_u16le(&eocd[10], MIN(count, G_MAXUINT16));
+	write_u32le(&eocd[12], MIN(cd_size, G_MAXUINT32));
+	write_u32le(&eocd[16], MIN(cd_offset, G_MAXUINT32));
+	write_u16le(&eocd[20], 0);
+
+	return zw_write(zw, eocd, ZIP_EOCD_SIZE);
+}
+
+/**
+ * Write the central directory of a ZIP archive and close it.
+ *
+ * The writer is freed, also when an error occurred.
+ *
+ * @param zw The writer.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Write error.
+ *
+ * @private
+ */
+SR_PRIV int sr_zip_writer_finish(struct sr_zip_writer *zw)
+{
+	int ret;
+
+	if (!zw)
+		return SR_ERR_ARG;
+
+	ret = write_central_directory(zw);
+	if (fclose(zw->file) != 0 && ret == SR_OK) {
+		sr_err("Cannot close '%s': %s.", zw->filename,
+			g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	g_array_free(zw->entries, TRUE);
+	g_free(zw->filename);
+	g_free(zw);
+
+	return ret;
+}
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -428,6 +429,135 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+/*
+ * Check the double precision and the per-channel conversion routines,
+ * on interleaved big endian 16bit signed input with scale and offset.
+ */
+START_TEST(test_analog_to_double_channel)
+{
+	int ret;
+	size_t i;
+	struct sr_channel ch1, ch2;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/* Interleaved samples: ch1 = 1, -2, 300; ch2 = -4, 5, -600. */
+	const uint8_t data[] = {
+		0x00, 0x01, 0xff, 0xfc,
+		0xff, 0xfe, 0x00, 0x05,
+		0x01, 0x2c, 0xfd, 0xa8,
+	};
+	const double want[] = { 2.5, -7.5, -3.5, 10.5, 600.5, -1199.5, };
+	double d_out[ARRAY_SIZE(want)];
+	float f_out[ARRAY_SIZE(want) / 2];
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = TRUE;
+	encoding.scale.p = 2;
+	encoding.offset.p = 1;
+	encoding.offset.q = 2;
+	analog.num_samples = 3;
+	analog.data = (void *)data;
+	meaning.channels = g_slist_append(NULL, &ch1);
+	meaning.channels = g_slist_append(meaning.channels, &ch2);
+
+	ret = sr_analog_to_double(&analog, d_out);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(want); i++)
+		fail_unless(d_out[i] == want[i], "%f != %f", d_out[i], want[i]);
+
+	ret = sr_analog_to_float_channel(&analog, 1, f_out);
+	fail_unless(ret == SR_OK, "sr_analog_to_float_channel() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(f_out); i++)
+		fail_unless(f_out[i] == want[2 * i + 1], "%f != %f",
+			f_out[i], want[2 * i + 1]);
+
+	/* Channel index out of range. */
+	ret = sr_analog_to_float_channel(&analog, 2, f_out);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/*
+ * Check the analog to logic conversion in raw sample units, on interleaved
+ * little endian 16bit signed input with a negative scale.
+ */
+START_TEST(test_a2l_logic)
+{
+	int ret;
+	size_t i;
+	struct sr_channel ch1, ch2;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/* ch1 = 1.0, 1.5, 2.0, 1.49; ch2 = 0.0, -0.6, -0.5, 1.0. */
+	const uint8_t data[] = {
+		0x9c, 0xff, 0x00, 0x00,
+		0x6a, 0xff, 0x3c, 0x00,
+		0x38, 0xff, 0x32, 0x00,
+		0x6b, 0xff, 0x9c, 0xff,
+	};
+	const float thr[] = { 1.495, -0.55, };
+	const float lo_thr[] = { 1.2, -0.55, };
+	const float hi_thr[] = { 1.8, 0.5, };
+	const uint8_t want_thr[] = { 0x91, 0x89, 0x99, 0x91, };
+	const uint8_t want_schmitt[] = { 0x81, 0x81, 0x89, 0x99, };
+	const uint8_t want_flat[] = { 1, 1, 1, 0, 1, 0, 1, 1, };
+	uint8_t logic[4], flat[8], states[2];
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = FALSE;
+	encoding.scale.p = -1;
+	encoding.scale.q = 100;
+	analog.num_samples = 4;
+	analog.data = (void *)data;
+	meaning.channels = g_slist_append(NULL, &ch1);
+	meaning.channels = g_slist_append(meaning.channels, &ch2);
+
+	/* Channels go to bits 3 and 4, the other bits are kept. */
+	memset(logic, 0x81, sizeof(logic));
+	ret = sr_a2l_threshold_logic(&analog, thr, logic, 1, 3);
+	fail_unless(ret == SR_OK, "sr_a2l_threshold_logic() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(logic); i++)
+		fail_unless(logic[i] == want_thr[i], "%02x != %02x",
+			logic[i], want_thr[i]);
+
+	memset(logic, 0x81, sizeof(logic));
+	states[0] = 1;
+	states[1] = 0;
+	ret = sr_a2l_schmitt_trigger_logic(&analog, lo_thr, hi_thr, states,
+		logic, 1, 3);
+	fail_unless(ret == SR_OK, "sr_a2l_schmitt_trigger_logic() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(logic); i++)
+		fail_unless(logic[i] == want_schmitt[i], "%02x != %02x",
+			logic[i], want_schmitt[i]);
+	fail_unless(states[0] == 1 && states[1] == 1);
+
+	/* The channels must fit into the logic unit. */
+	ret = sr_a2l_threshold_logic(&analog, thr, logic, 1, 7);
+	fail_unless(ret == SR_ERR_ARG);
+
+	/* One byte per value, all channels in a row. */
+	ret = sr_a2l_threshold(&analog, 0.0, flat, ARRAY_SIZE(flat));
+	fail_unless(ret == SR_OK, "sr_a2l_threshold() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(flat); i++)
+		fail_unless(flat[i] == want_flat[i], "%d != %d",
+			flat[i], want_flat[i]);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -697,6 +827,8 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_double_channel);
+	tcase_add_test(tc, test_a2l_logic);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
@@ -0,0 +1,1153 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput measurements of the datafeed and conversion hot paths.
+ *
+ * Each benchmark runs for at least the minimum duration on synthetic
+ * data, and prints one JSON object per line to stdout:
+ *
+ *   {"benchmark": "output/vcd", "items": 1024, "bytes": ..., "seconds": ...}
+ *
+ * where items are packets, samples or calls depending on the benchmark.
+ * The peak RSS is the process' high water mark after the benchmark,
+ * where the OS provides it. Diagnostics go to stderr, so the output can
+ * be collected and compared across builds as is.
+ *
+ * Usage: bench [-t <milliseconds>] [-s <MiB>] [-b <baseline file>]
+ *              [-r <percent>] [-u <USB capture>] [<name filter>]
+ *
+ * -s runs each benchmark on at least the given amount of data, e.g.
+ * "-s 1024" for a 1 GiB capture. -b compares the bytes per second of
+ * each benchmark against a previous run's output, and makes the program
+ * exit with an error when any of them are more than -r percent (default
+ * 10) slower. -u replays a recording of a Saleae Logic Pro's USB
+ * transfers (see sr_usb_capture_start()) through its decoder, in place
+ * of synthetic transfers.
+ *
+ * The soft trigger is internal to the library. This program gets linked
+ * against the static library to reach it.
+ */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#if defined(HAVE_LIBUSB_1_0) && defined(HAVE_HW_SALEAE_LOGIC_PRO)
+#include "hardware/saleae-logic-pro/protocol.h"
+#define BENCH_USB_REPLAY
+#endif
+
+#define BENCH_CHANNELS 16
+#define BENCH_ANALOG_CHANNELS 2
+#define BENCH_UNITSIZE ((BENCH_CHANNELS + 7) / 8)
+#define BENCH_PACKET_SIZE (64 * 1024)
+
+static struct sr_context *ctx;
+static gint64 min_usecs = 200 * 1000;
+static uint64_t min_bytes;
+static const char *filter;
+static GHashTable *baseline;
+static double max_regression = 10.0;
+static gboolean regressed;
+static const char *usb_capture_file;
+
+static uint64_t cb_bytes;
+
+static gboolean bench_wanted(const char *name)
+{
+	return !filter || strstr(name, filter);
+}
+
+/* Tell whether a benchmark needs to run longer, or on more data. */
+static gboolean bench_more(gint64 usecs, uint64_t bytes)
+{
+	return usecs < min_usecs || bytes < min_bytes;
+}
+
+/* Get the process' peak resident set size in KiB, 0 if unknown. */
+static uint64_t peak_rss_kib(void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+#endif
+
+	return 0;
+}
+
+/*
+ * Read a previous run's output, keep the bytes per second of each
+ * benchmark. Lines which don't look like results are ignored.
+ */
+static gboolean load_baseline(const char *filename)
+{
+	char *contents, **lines, *p;
+	char name[128];
+	double *rate;
+	size_t i;
+
+	if (!g_file_get_contents(filename, &contents, NULL, NULL)) {
+		fprintf(stderr, "Cannot read baseline '%s'.\n", filename);
+		return FALSE;
+	}
+	baseline = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+	lines = g_strsplit(contents, "\n", 0);
+	for (i = 0; lines[i]; i++) {
+		if (sscanf(lines[i], "{\"benchmark\": \"%127[^\"]\"", name) != 1)
+			continue;
+		p = strstr(lines[i], "\"bytes_per_second\": ");
+		if (!p)
+			continue;
+		rate = g_malloc(sizeof(*rate));
+		*rate = g_ascii_strtod(p + strlen("\"bytes_per_second\": "), NULL);
+		g_hash_table_insert(baseline, g_strdup(name), rate);
+	}
+	g_strfreev(lines);
+	g_free(contents);
+
+	return TRUE;
+}
+
+static void bench_report(const char *name, uint64_t items, uint64_t bytes,
+	gint64 usecs)
+{
+	double secs, rate, *base;
+
+	secs = usecs / 1e6;
+	rate = secs > 0 ? bytes / secs : 0;
+	printf("{\"benchmark\": \"%s\", \"items\": %" PRIu64
+		", \"bytes\": %" PRIu64 ", \"seconds\": %.6f"
+		", \"items_per_second\": %.0f, \"bytes_per_second\": %.0f"
+		", \"peak_rss_kib\": %" PRIu64 "}\n",
+		name, items, bytes, secs,
+		secs > 0 ? items / secs : 0, rate, peak_rss_kib());
+	fflush(stdout);
+
+	base = baseline ? g_hash_table_lookup(baseline, name) : NULL;
+	if (base && rate < *base * (1.0 - max_regression / 100.0)) {
+		fprintf(stderr, "%s: regression, %.1f MB/s, baseline %.1f MB/s.\n",
+			name, rate / 1e6, *base / 1e6);
+		regressed = TRUE;
+	}
+}
+
+/* Logic data with some activity on every channel. */
+static uint8_t *gen_logic(size_t length)
+{
+	uint8_t *data;
+	size_t i;
+	uint32_t lfsr;
+
+	data = g_malloc(length);
+	lfsr = 0xace1u;
+	for (i = 0; i < length; i++) {
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xb400u);
+		/* Low channels toggle often, high channels rarely. */
+		data[i] = (i / BENCH_UNITSIZE) & 1 ? lfsr : lfsr & 0x0f;
+	}
+
+	return data;
+}
+
+static struct sr_dev_inst *gen_sdi(void)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+	for (i = 0; i < BENCH_CHANNELS; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+
+	return sdi;
+}
+
+static struct sr_dev_inst *gen_analog_sdi(void)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+	for (i = 0; i < BENCH_ANALOG_CHANNELS; i++) {
+		snprintf(name, sizeof(name), "A%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_ANALOG, name);
+	}
+
+	return sdi;
+}
+
+static void count_cb(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	cb_bytes += logic->length;
+}
+
+/* sr_session_send() of logic packets to N datafeed callbacks. */
+static void bench_session_send(void)
+{
+	static const unsigned int cb_counts[] = { 1, 4, 16 };
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *data;
+	uint64_t packets;
+	gint64 start, usecs;
+	unsigned int idx, i;
+	char name[64];
+
+	data = gen_logic(BENCH_PACKET_SIZE);
+	logic.length = BENCH_PACKET_SIZE;
+	logic.unitsize = BENCH_UNITSIZE;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	for (idx = 0; idx < G_N_ELEMENTS(cb_counts); idx++) {
+		snprintf(name, sizeof(name), "session/send/%u-callbacks",
+			cb_counts[idx]);
+		if (!bench_wanted(name))
+			continue;
+
+		sr_session_new(ctx, &session);
+		sdi = gen_sdi();
+		sr_session_dev_add(session, sdi);
+		for (i = 0; i < cb_counts[idx]; i++)
+			sr_session_datafeed_callback_add(session, count_cb, NULL);
+
+		packets = 0;
+		start = g_get_monotonic_time();
+		do {
+			for (i = 0; i < 64; i++)
+				sr_session_send(sdi, &packet);
+			packets += 64;
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, packets * BENCH_PACKET_SIZE));
+		bench_report(name, packets, packets * BENCH_PACKET_SIZE, usecs);
+
+		sr_session_destroy(session);
+		sr_dev_inst_free(sdi);
+	}
+
+	g_free(data);
+}
+
+/* sr_analog_to_float() for the common encodings. */
+static void bench_analog_to_float(void)
+{
+	static const struct {
+		const char *name;
+		uint8_t unitsize;
+		gboolean is_signed, is_float, is_bigendian;
+	} encodings[] = {
+		{ "u8", 1, FALSE, FALSE, FALSE },
+		{ "s16le", 2, TRUE, FALSE, FALSE },
+		{ "s16be", 2, TRUE, FALSE, TRUE },
+		{ "s32le", 4, TRUE, FALSE, FALSE },
+		{ "float", 4, TRUE, TRUE, FALSE },
+		{ "double", 8, TRUE, TRUE, FALSE },
+	};
+	const size_t num_samples = 64 * 1024;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t *data;
+	float *out;
+	uint64_t samples;
+	gint64 start, usecs;
+	size_t idx, i;
+	char name[64];
+
+	data = gen_logic(num_samples * 8);
+	/* Random bits make for NaNs and denormals, use real values. */
+	for (i = 0; i < num_samples; i++)
+		((float *)data)[i] = (float)(i % 1000) / 100.0f;
+	out = g_malloc(num_samples * sizeof(float));
+
+	for (idx = 0; idx < G_N_ELEMENTS(encodings); idx++) {
+		snprintf(name, sizeof(name), "analog/to_float/%s",
+			encodings[idx].name);
+		if (!bench_wanted(name))
+			continue;
+
+		memset(&encoding, 0, sizeof(encoding));
+		encoding.unitsize = encodings[idx].unitsize;
+		encoding.is_signed = encodings[idx].is_signed;
+		encoding.is_float = encodings[idx].is_float;
+		encoding.is_bigendian = encodings[idx].is_bigendian;
+		encoding.digits = 3;
+		encoding.is_digits_decimal = TRUE;
+		encoding.scale.p = encoding.scale.q = 1;
+		encoding.offset.p = 0;
+		encoding.offset.q = 1;
+		if (!encoding.is_float) {
+			encoding.scale.p = 1;
+			encoding.scale.q = 1000;
+		}
+		memset(&meaning, 0, sizeof(meaning));
+		memset(&spec, 0, sizeof(spec));
+		analog.data = data;
+		analog.num_samples = num_samples;
+		analog.encoding = &encoding;
+		analog.meaning = &meaning;
+		analog.spec = &spec;
+
+		samples = 0;
+		start = g_get_monotonic_time();
+		do {
+			if (sr_analog_to_float(&analog, out) != SR_OK) {
+				fprintf(stderr, "%s: conversion failed\n", name);
+				break;
+			}
+			samples += num_samples;
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, samples * encoding.unitsize));
+		bench_report(name, samples, samples * encoding.unitsize, usecs);
+	}
+
+	g_free(out);
+	g_free(data);
+}
+
+/* soft_trigger_logic_check() with a trigger which never matches. */
+static void bench_soft_trigger(void)
+{
+	const char *name = "trigger/soft/no-match";
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_logic *stl;
+	uint8_t *data;
+	uint64_t bytes;
+	gint64 start, usecs;
+	int pre_trigger, ret;
+
+	if (!bench_wanted(name))
+		return;
+
+	sdi = gen_sdi();
+	trigger = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trigger);
+	/* The generated data never has the top channel high. */
+	sr_trigger_match_add(stage, g_slist_last(sdi->channels)->data,
+		SR_TRIGGER_RISING, 0);
+	stl = soft_trigger_logic_new(sdi, trigger, 0);
+	data = gen_logic(BENCH_PACKET_SIZE);
+	for (bytes = 1; bytes < BENCH_PACKET_SIZE; bytes += BENCH_UNITSIZE)
+		data[bytes] &= 0x7f;
+
+	bytes = 0;
+	start = g_get_monotonic_time();
+	do {
+		ret = soft_trigger_logic_check(stl, data, BENCH_PACKET_SIZE,
+			&pre_trigger);
+		if (ret >= 0) {
+			fprintf(stderr, "%s: unexpected match\n", name);
+			break;
+		}
+		bytes += BENCH_PACKET_SIZE;
+		usecs = g_get_monotonic_time() - start;
+	} while (bench_more(usecs, bytes));
+	bench_report(name, bytes / BENCH_UNITSIZE, bytes, usecs);
+
+	g_free(data);
+	soft_trigger_logic_free(stl);
+	sr_trigger_free(trigger);
+	sr_dev_inst_free(sdi);
+}
+
+/* soft_trigger_analog_check() on s16le samples, never crossing the level. */
+static void bench_soft_trigger_analog(void)
+{
+	const char *name = "trigger/soft-analog/no-match";
+	const size_t num_samples = 64 * 1024;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_analog *sta;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int16_t *data;
+	uint64_t samples;
+	gint64 start, usecs;
+	int pre_trigger, ret;
+	size_t i;
+
+	if (!bench_wanted(name))
+		return;
+
+	sdi = gen_analog_sdi();
+	trigger = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trigger);
+	/* The generated values stay within +/-1. */
+	sr_trigger_match_add(stage, sdi->channels->data,
+		SR_TRIGGER_RISING, 2.0);
+	sta = soft_trigger_analog_new(sdi, trigger, 0);
+	soft_trigger_analog_set_hysteresis(sta, 0.1);
+
+	data = g_malloc(num_samples * sizeof(*data));
+	for (i = 0; i < num_samples; i++)
+		data[i] = (int16_t)((i % 2000) < 1000 ?
+			(i % 2000) - 500 : 1500 - (i % 2000)) * 2;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(*data);
+	encoding.is_signed = TRUE;
+	encoding.is_float = FALSE;
+	encoding.scale.q = 1000;
+	meaning.channels = g_slist_append(NULL, sdi->channels->data);
+	analog.data = data;
+	analog.num_samples = num_samples;
+
+	samples = 0;
+	start = g_get_monotonic_time();
+	do {
+		ret = soft_trigger_analog_check(sta, &analog, &pre_trigger);
+		if (ret >= 0) {
+			fprintf(stderr, "%s: unexpected match\n", name);
+			break;
+		}
+		samples += num_samples;
+		usecs = g_get_monotonic_time() - start;
+	} while (bench_more(usecs, samples * sizeof(*data)));
+	bench_report(name, samples, samples * sizeof(*data), usecs);
+
+	g_slist_free(meaning.channels);
+	g_free(data);
+	soft_trigger_analog_free(sta);
+	sr_trigger_free(trigger);
+	sr_dev_inst_free(sdi);
+}
+
+/* feed_queue_logic_submit_many() with runs of different lengths. */
+static void bench_feed_queue(void)
+{
+	static const size_t run_lengths[] = { 1, 16, 4096 };
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct feed_queue_logic *q;
+	uint8_t *values;
+	size_t counts[256];
+	uint64_t samples;
+	gint64 start, usecs;
+	unsigned int idx, i;
+	char name[64];
+
+	values = gen_logic(G_N_ELEMENTS(counts) * sizeof(uint32_t));
+
+	for (idx = 0; idx < G_N_ELEMENTS(run_lengths); idx++) {
+		snprintf(name, sizeof(name), "feed_queue/runs/%zu-samples",
+			run_lengths[idx]);
+		if (!bench_wanted(name))
+			continue;
+		for (i = 0; i < G_N_ELEMENTS(counts); i++)
+			counts[i] = run_lengths[idx];
+
+		sr_session_new(ctx, &session);
+		sdi = gen_sdi();
+		sr_session_dev_add(session, sdi);
+		sr_session_datafeed_callback_add(session, count_cb, NULL);
+		q = feed_queue_logic_alloc(sdi, BENCH_PACKET_SIZE /
+			sizeof(uint32_t), sizeof(uint32_t));
+
+		samples = 0;
+		start = g_get_monotonic_time();
+		do {
+			feed_queue_logic_submit_many(q, values, counts,
+				G_N_ELEMENTS(counts));
+			samples += G_N_ELEMENTS(counts) * run_lengths[idx];
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, samples * sizeof(uint32_t)));
+		feed_queue_logic_flush(q);
+		bench_report(name, samples, samples * sizeof(uint32_t), usecs);
+
+		feed_queue_logic_free(q);
+		sr_session_destroy(session);
+		sr_dev_inst_free(sdi);
+	}
+
+	g_free(values);
+}
+
+/*
+ * Channel major to sample major conversion as done by the Saleae Logic16
+ * driver: each little endian word holds 16 samples of one channel, first
+ * sample in the most significant bit. Compare the former bit by bit loop
+ * with the bit plane transpose.
+ */
+static void logic16_convert_loop(uint8_t *dest, const uint8_t *src,
+	size_t words, const uint16_t *masks, size_t num_channels)
+{
+	uint16_t data[16], sample;
+	size_t ch;
+	int i;
+
+	memset(data, 0, sizeof(data));
+	ch = 0;
+	while (words--) {
+		sample = src[0] | (src[1] << 8);
+		src += 2;
+		for (i = 15; i >= 0; --i, sample >>= 1)
+			if (sample & 1)
+				data[i] |= masks[ch];
+		if (++ch == num_channels) {
+			ch = 0;
+			for (i = 0; i < 16; i++) {
+				*dest++ = data[i] & 0xff;
+				*dest++ = data[i] >> 8;
+			}
+			memset(data, 0, sizeof(data));
+		}
+	}
+}
+
+static inline uint16_t reverse_bits16(uint16_t x)
+{
+	x = ((x >> 1) & 0x5555) | ((x & 0x5555) << 1);
+	x = ((x >> 2) & 0x3333) | ((x & 0x3333) << 2);
+	x = ((x >> 4) & 0x0f0f) | ((x & 0x0f0f) << 4);
+
+	return (x >> 8) | (x << 8);
+}
+
+static void logic16_convert_planes(uint8_t *dest, const uint8_t *src,
+	size_t words, const uint8_t *const *planes, uint8_t (*batch)[2],
+	size_t num_channels)
+{
+	size_t ch;
+
+	ch = 0;
+	while (words--) {
+		write_u16le(batch[ch], reverse_bits16(read_u16le(src)));
+		src += 2;
+		if (++ch == num_channels) {
+			ch = 0;
+			sr_bitplanes_to_samples(dest, sizeof(uint16_t), planes,
+				sizeof(uint16_t));
+			dest += 16 * sizeof(uint16_t);
+		}
+	}
+}
+
+static void bench_logic16_convert(void)
+{
+	static const size_t channel_counts[] = { 3, 9, 16 };
+	uint8_t batch[16][2];
+	const uint8_t *planes[16];
+	uint16_t masks[16];
+	uint8_t *src, *dest, *check;
+	size_t idx, ch, num_channels, words, out_len;
+	uint64_t bytes;
+	gint64 start, usecs;
+	char name[64];
+	int method;
+
+	src = gen_logic(BENCH_PACKET_SIZE);
+
+	for (idx = 0; idx < G_N_ELEMENTS(channel_counts); idx++) {
+		num_channels = channel_counts[idx];
+		words = BENCH_PACKET_SIZE / 2 / num_channels * num_channels;
+		out_len = words / num_channels * 16 * sizeof(uint16_t);
+		dest = g_malloc(out_len);
+		check = g_malloc(out_len);
+		memset(planes, 0, sizeof(planes));
+		/* Spread the channels across the word, like a sparse selection. */
+		for (ch = 0; ch < num_channels; ch++) {
+			masks[ch] = 1 << (ch * 16 / num_channels);
+			planes[ch * 16 / num_channels] = batch[ch];
+		}
+
+		logic16_convert_loop(check, src, words, masks, num_channels);
+		logic16_convert_planes(dest, src, words, planes, batch,
+			num_channels);
+		if (memcmp(dest, check, out_len) != 0)
+			fprintf(stderr, "logic16: conversion results differ.\n");
+
+		for (method = 0; method < 2; method++) {
+			snprintf(name, sizeof(name), "convert/logic16/%s/%zu-channels",
+				method ? "transpose" : "loop", num_channels);
+			if (!bench_wanted(name))
+				continue;
+			bytes = 0;
+			start = g_get_monotonic_time();
+			do {
+				if (method)
+					logic16_convert_planes(dest, src, words,
+						planes, batch, num_channels);
+				else
+					logic16_convert_loop(dest, src, words,
+						masks, num_channels);
+				bytes += words * 2;
+				usecs = g_get_monotonic_time() - start;
+			} while (bench_more(usecs, bytes));
+			bench_report(name, bytes / 2 / num_channels * 16, bytes,
+				usecs);
+		}
+
+		g_free(check);
+		g_free(dest);
+	}
+
+	g_free(src);
+}
+
+#ifdef BENCH_USB_REPLAY
+#define LOGIC_PRO_TRANSFER_SIZE (16 * 1024)
+
+/* Replay of USB transfers through the Saleae Logic Pro's decoder. */
+static void bench_usb_replay(void)
+{
+	static const size_t channel_counts[] = { 1, 8, 16 };
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_usb_replay *replay;
+	struct sr_channel *ch;
+	uint8_t *data;
+	uint64_t transfers, bytes;
+	gint64 start, usecs;
+	size_t idx, i;
+	GSList *l;
+	char name[64];
+
+	if (usb_capture_file) {
+		replay = sr_usb_replay_load(usb_capture_file);
+		if (!replay)
+			return;
+		if (strcmp(sr_usb_replay_driver(replay), "saleae-logic-pro")) {
+			fprintf(stderr, "%s is a capture of %s, not a Saleae "
+				"Logic Pro.\n", usb_capture_file,
+				sr_usb_replay_driver(replay));
+			sr_usb_replay_free(replay);
+			return;
+		}
+	} else {
+		replay = sr_usb_replay_new("saleae-logic-pro");
+		data = gen_logic(LOGIC_PRO_TRANSFER_SIZE * 16);
+		for (i = 0; i < 16; i++)
+			sr_usb_replay_add(replay, 0x82, LIBUSB_TRANSFER_COMPLETED,
+				data + i * LOGIC_PRO_TRANSFER_SIZE,
+				LOGIC_PRO_TRANSFER_SIZE);
+		g_free(data);
+	}
+
+	for (idx = 0; idx < G_N_ELEMENTS(channel_counts); idx++) {
+		snprintf(name, sizeof(name), "usb-replay/saleae-logic-pro/"
+			"%zu-channels", channel_counts[idx]);
+		if (!bench_wanted(name))
+			continue;
+
+		sr_session_new(ctx, &session);
+		sdi = gen_sdi();
+		sr_session_dev_add(session, sdi);
+		sr_session_datafeed_callback_add(session, count_cb, NULL);
+
+		/* Like the driver's channel setup when acquisition starts. */
+		devc = g_malloc0(sizeof(*devc));
+		devc->conv_buffer = g_malloc(CONV_BUFFER_SIZE);
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			ch->enabled = (size_t)ch->index < channel_counts[idx];
+			if (!ch->enabled)
+				continue;
+			devc->batch_planes[ch->index] =
+				devc->batch_data[devc->dig_channel_cnt];
+			devc->dig_channel_masks[devc->dig_channel_cnt++] =
+				1 << ch->index;
+			devc->dig_channel_mask |= 1 << ch->index;
+		}
+		sdi->priv = devc;
+
+		transfers = bytes = 0;
+		start = g_get_monotonic_time();
+		do {
+			transfers += sr_usb_replay_run(replay, sdi,
+				saleae_logic_pro_receive_data,
+				LOGIC_PRO_TRANSFER_SIZE, &bytes);
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, bytes));
+		bench_report(name, transfers, bytes, usecs);
+
+		sr_session_destroy(session);
+		sdi->priv = NULL;
+		g_free(devc->conv_buffer);
+		g_free(devc);
+		sr_dev_inst_free(sdi);
+	}
+
+	sr_usb_replay_free(replay);
+}
+#endif
+
+static void output_send(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+
+	out = NULL;
+	sr_output_send(o, packet, &out);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+/* Send the header and the samplerate to an output. */
+static void output_start(const struct sr_output *o)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	header.feed_version = 1;
+	header.starttime.tv_sec = 0;
+	header.starttime.tv_usec = 0;
+	output_send(o, &packet);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SR_MHZ(100)));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	output_send(o, &packet);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+}
+
+/* The receive() routine of each output module, for logic data. */
+static void bench_outputs(void)
+{
+	const struct sr_output_module **omods;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *data;
+	uint64_t packets;
+	gint64 start, usecs;
+	char name[64], *filename;
+	size_t idx;
+
+	omods = sr_output_list();
+	data = gen_logic(BENCH_PACKET_SIZE);
+	filename = g_build_filename(g_get_tmp_dir(), "sigrok-bench.out", NULL);
+
+	for (idx = 0; omods[idx]; idx++) {
+		snprintf(name, sizeof(name), "output/%s",
+			sr_output_id_get(omods[idx]));
+		if (!bench_wanted(name))
+			continue;
+
+		sdi = gen_sdi();
+		o = sr_output_new(omods[idx], NULL, sdi, filename);
+		if (!o) {
+			fprintf(stderr, "%s: cannot create output\n", name);
+			sr_dev_inst_free(sdi);
+			continue;
+		}
+		output_start(o);
+
+		logic.length = BENCH_PACKET_SIZE;
+		logic.unitsize = BENCH_UNITSIZE;
+		logic.data = data;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		packets = 0;
+		start = g_get_monotonic_time();
+		do {
+			output_send(o, &packet);
+			packets++;
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, packets * BENCH_PACKET_SIZE));
+
+		packet.type = SR_DF_END;
+		packet.payload = NULL;
+		output_send(o, &packet);
+		usecs = g_get_monotonic_time() - start;
+		bench_report(name, packets, packets * BENCH_PACKET_SIZE, usecs);
+
+		sr_output_free(o);
+		sr_dev_inst_free(sdi);
+		g_unlink(filename);
+	}
+
+	g_free(filename);
+	g_free(data);
+}
+
+/*
+ * The receive() routine of each output module, for interleaved float
+ * samples of two analog channels.
+ */
+static void bench_outputs_analog(void)
+{
+	const struct sr_output_module **omods;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float *data;
+	size_t num_samples, idx, i;
+	uint64_t packets;
+	gint64 start, usecs;
+	char name[64], *filename;
+
+	omods = sr_output_list();
+	num_samples = BENCH_PACKET_SIZE / sizeof(float) / BENCH_ANALOG_CHANNELS;
+	data = g_malloc(BENCH_PACKET_SIZE);
+	for (i = 0; i < num_samples * BENCH_ANALOG_CHANNELS; i++)
+		data[i] = (float)(i % 1000) / 1000.0f - 0.5f;
+	filename = g_build_filename(g_get_tmp_dir(), "sigrok-bench.out", NULL);
+
+	for (idx = 0; omods[idx]; idx++) {
+		snprintf(name, sizeof(name), "output/%s/analog",
+			sr_output_id_get(omods[idx]));
+		if (!bench_wanted(name))
+			continue;
+
+		sdi = gen_analog_sdi();
+		o = sr_output_new(omods[idx], NULL, sdi, filename);
+		if (!o) {
+			fprintf(stderr, "%s: cannot create output\n", name);
+			sr_dev_inst_free(sdi);
+			continue;
+		}
+		output_start(o);
+
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+		analog.data = data;
+		analog.num_samples = num_samples;
+		meaning.mq = SR_MQ_VOLTAGE;
+		meaning.unit = SR_UNIT_VOLT;
+		meaning.channels = g_slist_copy(sdi->channels);
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		packets = 0;
+		start = g_get_monotonic_time();
+		do {
+			output_send(o, &packet);
+			packets++;
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, packets * BENCH_PACKET_SIZE));
+		g_slist_free(meaning.channels);
+
+		packet.type = SR_DF_END;
+		packet.payload = NULL;
+		output_send(o, &packet);
+		usecs = g_get_monotonic_time() - start;
+		bench_report(name, packets * num_samples * BENCH_ANALOG_CHANNELS,
+			packets * BENCH_PACKET_SIZE, usecs);
+
+		sr_output_free(o);
+		sr_dev_inst_free(sdi);
+		g_unlink(filename);
+	}
+
+	g_free(filename);
+	g_free(data);
+}
+
+static GString *gen_input_binary(size_t length)
+{
+	GString *s;
+	uint8_t *data;
+
+	data = gen_logic(length);
+	s = g_string_new_len((const char *)data, length);
+	g_free(data);
+
+	return s;
+}
+
+static GString *gen_input_csv(size_t length)
+{
+	GString *s;
+	size_t ch;
+	uint8_t *data, *p;
+
+	s = g_string_sized_new(length + 64);
+	for (ch = 0; ch < 8; ch++)
+		g_string_append_printf(s, "%sD%zu", ch ? "," : "", ch);
+	g_string_append_c(s, '\n');
+	data = gen_logic(length / 16 + 1);
+	for (p = data; s->len < length; p++) {
+		for (ch = 0; ch < 8; ch++) {
+			g_string_append_c(s, (*p & (1 << ch)) ? '1' : '0');
+			g_string_append_c(s, ch < 7 ? ',' : '\n');
+		}
+	}
+	g_free(data);
+
+	return s;
+}
+
+static GString *gen_input_vcd(size_t length)
+{
+	GString *s;
+	size_t ch;
+	uint64_t ts;
+	uint8_t *data, *p, prev;
+
+	s = g_string_sized_new(length + 256);
+	g_string_append(s, "$timescale 1 ns $end\n$scope module top $end\n");
+	for (ch = 0; ch < 8; ch++) {
+		g_string_append_printf(s, "$var wire 1 %c D%zu $end\n",
+			(int)('!' + ch), ch);
+	}
+	g_string_append(s, "$upscope $end\n$enddefinitions $end\n");
+	data = gen_logic(length / 8 + 1);
+	prev = ~data[0];
+	for (p = data, ts = 0; s->len < length; p++, ts++) {
+		if (*p == prev)
+			continue;
+		g_string_append_printf(s, "#%" PRIu64 "\n", ts);
+		for (ch = 0; ch < 8; ch++) {
+			if (!((*p ^ prev) & (1 << ch)))
+				continue;
+			g_string_append_printf(s, "%c%c\n",
+				(*p & (1 << ch)) ? '1' : '0', (int)('!' + ch));
+		}
+		prev = *p;
+	}
+	g_free(data);
+
+	return s;
+}
+
+/*
+ * Like FPGA simulations create them: many single bit signals, one value
+ * change per timestamp.
+ */
+static GString *gen_input_vcd_wide(size_t length)
+{
+	const size_t num_signals = 4096;
+	GString *s;
+	size_t idx;
+	uint64_t ts;
+
+	s = g_string_sized_new(length + num_signals * 32);
+	g_string_append(s, "$timescale 1 ns $end\n$scope module top $end\n");
+	for (idx = 0; idx < num_signals; idx++) {
+		g_string_append_printf(s, "$var wire 1 %c%c s%zu $end\n",
+			(int)('!' + idx % 94), (int)('!' + idx / 94), idx);
+	}
+	g_string_append(s, "$upscope $end\n$enddefinitions $end\n");
+	for (ts = 1; s->len < length; ts++) {
+		idx = ts % num_signals;
+		g_string_append_printf(s, "#%" PRIu64 "\n0%c%c\n1%c%c\n", ts,
+			(int)('!' + (idx + num_signals - 1) % num_signals % 94),
+			(int)('!' + (idx + num_signals - 1) % num_signals / 94),
+			(int)('!' + idx % 94), (int)('!' + idx / 94));
+	}
+
+	return s;
+}
+
+/* Stereo 16 bit PCM samples, a slow ramp on one channel, noise on the other. */
+static GString *gen_input_wav(size_t length)
+{
+	GString *s;
+	uint8_t hdr[44], *data;
+	size_t samples, i;
+
+	samples = length / 4;
+	memcpy(hdr, "RIFF", 4);
+	WL32(hdr + 4, 36 + samples * 4);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	WL32(hdr + 16, 16);
+	WL16(hdr + 20, 0x0001);
+	WL16(hdr + 22, 2);
+	WL32(hdr + 24, 48000);
+	WL32(hdr + 28, 48000 * 4);
+	WL16(hdr + 32, 4);
+	WL16(hdr + 34, 16);
+	memcpy(hdr + 36, "data", 4);
+	WL32(hdr + 40, samples * 4);
+
+	s = g_string_sized_new(sizeof(hdr) + samples * 4);
+	g_string_append_len(s, (const char *)hdr, sizeof(hdr));
+	data = gen_logic(samples * 2);
+	for (i = 0; i < samples; i++) {
+		WL16(hdr, i);
+		WL16(hdr + 2, data[2 * i] | (data[2 * i + 1] << 8));
+		g_string_append_len(s, (const char *)hdr, 4);
+	}
+	g_free(data);
+
+	return s;
+}
+
+/* Parse rate of input modules on generated files of their format. */
+static void bench_inputs(void)
+{
+	static const struct {
+		const char *name;
+		const char *id;
+		GString *(*gen)(size_t length);
+	} inputs[] = {
+		{ "binary", "binary", gen_input_binary },
+		{ "raw_analog", "raw_analog", gen_input_binary },
+		{ "csv", "csv", gen_input_csv },
+		{ "vcd", "vcd", gen_input_vcd },
+		{ "vcd-wide", "vcd", gen_input_vcd_wide },
+		{ "wav", "wav", gen_input_wav },
+	};
+	const size_t file_size = 4 * 1024 * 1024;
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	GString *file, *chunk;
+	uint64_t bytes;
+	gint64 start, usecs;
+	size_t idx, offset, len;
+	char name[64];
+
+	for (idx = 0; idx < G_N_ELEMENTS(inputs); idx++) {
+		snprintf(name, sizeof(name), "input/%s", inputs[idx].name);
+		if (!bench_wanted(name))
+			continue;
+		imod = sr_input_find((char *)inputs[idx].id);
+		if (!imod) {
+			fprintf(stderr, "%s: no such input module\n", name);
+			continue;
+		}
+
+		file = inputs[idx].gen(file_size);
+		chunk = g_string_sized_new(BENCH_PACKET_SIZE);
+		bytes = 0;
+		start = g_get_monotonic_time();
+		do {
+			in = sr_input_new(imod, NULL);
+			if (!in) {
+				fprintf(stderr, "%s: cannot create input\n", name);
+				break;
+			}
+			sr_session_new(ctx, &session);
+			sr_session_datafeed_callback_add(session, count_cb, NULL);
+			sr_session_dev_add(session, sr_input_dev_inst_get(in));
+			for (offset = 0; offset < file->len; offset += len) {
+				len = MIN(file->len - offset, BENCH_PACKET_SIZE);
+				g_string_truncate(chunk, 0);
+				g_string_append_len(chunk, file->str + offset, len);
+				if (sr_input_send(in, chunk) != SR_OK)
+					break;
+			}
+			sr_input_end(in);
+			sr_input_free(in);
+			sr_session_destroy(session);
+			bytes += file->len;
+			usecs = g_get_monotonic_time() - start;
+		} while (bench_more(usecs, bytes));
+		bench_report(name, bytes / file->len, bytes, usecs);
+
+		g_string_free(chunk, TRUE);
+		g_string_free(file, TRUE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			min_usecs = g_ascii_strtoll(argv[++i], NULL, 10) * 1000;
+			continue;
+		}
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			min_bytes = g_ascii_strtoull(argv[++i], NULL, 10) << 20;
+			continue;
+		}
+		if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+			if (!load_baseline(argv[++i]))
+				return 1;
+			continue;
+		}
+		if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			max_regression = g_ascii_strtod(argv[++i], NULL);
+			continue;
+		}
+		if (!strcmp(argv[i], "-u") && i + 1 < argc) {
+			usb_capture_file = argv[++i];
+			continue;
+		}
+		if (argv[i][0] == '-') {
+			fprintf(stderr, "Usage: %s [-t <milliseconds>] [-s <MiB>] "
+				"[-b <baseline>] [-r <percent>] [-u <capture>] "
+				"[<filter>]\n",
+				argv[0]);
+			return 1;
+		}
+		filter = argv[i];
+	}
+
+	sr_log_loglevel_set(SR_LOG_WARN);
+	if (sr_init(&ctx) != SR_OK) {
+		fprintf(stderr, "Cannot initialize libsigrok.\n");
+		return 1;
+	}
+
+	bench_session_send();
+	bench_analog_to_float();
+	bench_soft_trigger();
+	bench_soft_trigger_analog();
+	bench_feed_queue();
+	bench_logic16_convert();
+#ifdef BENCH_USB_REPLAY
+	bench_usb_replay();
+#endif
+	bench_outputs();
+	bench_outputs_analog();
+	bench_inputs();
+
+	sr_exit(ctx);
+	if (baseline)
+		g_hash_table_destroy(baseline);
+
+	return regressed ? 1 : 0;
+}
@@ -18,7 +18,17 @@
  */
 
 #include <config.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -59,6 +69,271 @@ START_TEST(test_config_get_set_samplerate)
 END_TEST
 #endif
 
+#ifndef _WIN32
+#define PPS_SAMPLES 3
+
+/*
+ * A Rigol DP832 lookalike on a local TCP port. It answers every query of
+ * a program message on one line, and counts the messages which carried
+ * measurements.
+ */
+struct fake_pps {
+	int listen_fd;
+	unsigned int port;
+	gint stop;
+	gint meas_messages;
+	gint meas_queries;
+	gint send_errors;
+	GThread *thread;
+};
+
+static char *fake_pps_answer(struct fake_pps *pps, const char *query,
+	gboolean *is_meas)
+{
+	unsigned int ch;
+	double v, i;
+
+	*is_meas = FALSE;
+	if (!strcmp(query, "*IDN?"))
+		return g_strdup("RIGOL TECHNOLOGIES,DP832,DP8C000000001,00.01.16");
+	if (sscanf(query, "MEAS:ALL? CH%u", &ch) == 1) {
+		*is_meas = TRUE;
+		g_atomic_int_inc(&pps->meas_queries);
+		v = 1.5 * ch;
+		i = 0.25 * ch;
+		return g_strdup_printf("%.4f,%.4f,%.4f", v, i, v * i);
+	}
+
+	return g_strdup("0");
+}
+
+static void fake_pps_message(struct fake_pps *pps, int fd, char *msg)
+{
+	GString *reply;
+	char **cmds, *cmd, *answer;
+	gboolean is_meas, has_meas;
+	size_t i;
+
+	reply = g_string_new(NULL);
+	has_meas = FALSE;
+	cmds = g_strsplit(msg, ";", 0);
+	for (i = 0; cmds[i]; i++) {
+		cmd = g_strstrip(cmds[i]);
+		if (*cmd == ':')
+			cmd++;
+		if (!strchr(cmd, '?'))
+			continue;
+		answer = fake_pps_answer(pps, cmd, &is_meas);
+		has_meas |= is_meas;
+		if (reply->len)
+			g_string_append_c(reply, ';');
+		g_string_append(reply, answer);
+		g_free(answer);
+	}
+	g_strfreev(cmds);
+	if (has_meas)
+		g_atomic_int_inc(&pps->meas_messages);
+
+	/* Raw TCP responses end with the first short read, send at once. */
+	if (reply->len) {
+		g_string_append_c(reply, '\n');
+		if (send(fd, reply->str, reply->len, 0) != (ssize_t)reply->len)
+			g_atomic_int_inc(&pps->send_errors);
+	}
+	g_string_free(reply, TRUE);
+}
+
+static gboolean fake_pps_poll(struct fake_pps *pps, int fd)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (!g_atomic_int_get(&pps->stop)) {
+		if (poll(&pfd, 1, 50) > 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gpointer fake_pps_thread(gpointer data)
+{
+	struct fake_pps *pps;
+	GString *buf;
+	char chunk[256], *eol;
+	ssize_t len;
+	int fd;
+
+	pps = data;
+	buf = g_string_new(NULL);
+	while (fake_pps_poll(pps, pps->listen_fd)) {
+		if ((fd = accept(pps->listen_fd, NULL, NULL)) < 0)
+			continue;
+		g_string_truncate(buf, 0);
+		while (fake_pps_poll(pps, fd)) {
+			if ((len = recv(fd, chunk, sizeof(chunk), 0)) <= 0)
+				break;
+			g_string_append_len(buf, chunk, len);
+			while ((eol = strchr(buf->str, '\n'))) {
+				*eol = '\0';
+				fake_pps_message(pps, fd, buf->str);
+				g_string_erase(buf, 0, eol - buf->str + 1);
+			}
+		}
+		close(fd);
+	}
+	g_string_free(buf, TRUE);
+
+	return NULL;
+}
+
+static void fake_pps_start(struct fake_pps *pps)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen;
+
+	memset(pps, 0, sizeof(*pps));
+	pps->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(pps->listen_fd >= 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addrlen = sizeof(addr);
+	fail_unless(bind(pps->listen_fd, (struct sockaddr *)&addr, addrlen) == 0);
+	fail_unless(listen(pps->listen_fd, 1) == 0);
+	fail_unless(getsockname(pps->listen_fd,
+		(struct sockaddr *)&addr, &addrlen) == 0);
+	pps->port = ntohs(addr.sin_port);
+	pps->thread = g_thread_new("fake-pps", fake_pps_thread, pps);
+}
+
+static void fake_pps_stop(struct fake_pps *pps)
+{
+	g_atomic_int_set(&pps->stop, 1);
+	g_thread_join(pps->thread);
+	close(pps->listen_fd);
+}
+
+struct pps_run {
+	unsigned int packets;
+	unsigned int mismatches;
+};
+
+static void pps_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct pps_run *run;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_channel *ch;
+	const float *data;
+	GSList *l;
+	double expected, v, i;
+	unsigned int output, k;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_ANALOG)
+		return;
+
+	run = cb_data;
+	run->packets++;
+	analog = packet->payload;
+	data = analog->data;
+	fail_unless(analog->num_samples == 1);
+	fail_unless(g_slist_length(analog->meaning->channels) == 3,
+		"Expected one channel per output.");
+	for (l = analog->meaning->channels, k = 0; l; l = l->next, k++) {
+		ch = l->data;
+		/* Channels are named after quantity and output, e.g. "V2". */
+		output = ch->name[1] - '0';
+		v = 1.5 * output;
+		i = 0.25 * output;
+		switch (analog->meaning->mq) {
+		case SR_MQ_VOLTAGE:
+			expected = v;
+			break;
+		case SR_MQ_CURRENT:
+			expected = i;
+			break;
+		default:
+			expected = v * i;
+			break;
+		}
+		if (data[k] < expected - 1e-3 || data[k] > expected + 1e-3)
+			run->mismatches++;
+	}
+}
+
+/*
+ * Check that scpi-pps sends the bulk measurements of all outputs in one
+ * program message per poll, and gets the values back to their channels.
+ */
+START_TEST(test_scpi_pps_bulk)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_session *sess;
+	struct sr_config opt_conn;
+	struct fake_pps pps;
+	struct pps_run run;
+	GSList *options, *devices;
+	char *conn;
+	int i, ret;
+
+	driver = NULL;
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "scpi-pps"))
+			driver = drivers[i];
+	}
+	/* Not every build has the driver. */
+	if (!driver)
+		return;
+	srtest_driver_init(srtest_ctx, driver);
+
+	fake_pps_start(&pps);
+	conn = g_strdup_printf("tcp-raw/127.0.0.1/%u", pps.port);
+	opt_conn.key = SR_CONF_CONN;
+	opt_conn.data = g_variant_new_string(conn);
+	options = g_slist_append(NULL, &opt_conn);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(opt_conn.data);
+	g_free(conn);
+	fail_unless(g_slist_length(devices) == 1, "No fake PPS found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_dev_open(sdi);
+	fail_unless(ret == SR_OK, "sr_dev_open() failed: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(PPS_SAMPLES));
+	fail_unless(ret == SR_OK);
+
+	memset(&run, 0, sizeof(run));
+	ret = sr_session_new(srtest_ctx, &sess);
+	fail_unless(ret == SR_OK);
+	sr_session_dev_add(sess, sdi);
+	sr_session_datafeed_callback_add(sess, pps_datafeed_in, &run);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run(sess);
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+	fake_pps_stop(&pps);
+
+	fail_unless(run.packets == 3 * PPS_SAMPLES,
+		"Expected %d packets, got %u.", 3 * PPS_SAMPLES, run.packets);
+	fail_unless(run.mismatches == 0, "%u wrong values.", run.mismatches);
+	fail_unless(g_atomic_int_get(&pps.send_errors) == 0);
+	fail_unless(g_atomic_int_get(&pps.meas_queries) == 3 * PPS_SAMPLES);
+	fail_unless(g_atomic_int_get(&pps.meas_messages) == PPS_SAMPLES,
+		"Outputs were not measured in one message per poll.");
+}
+END_TEST
+#endif
+
 Suite *suite_driver_all(void)
 {
 	Suite *s;
@@ -74,5 +349,12 @@ Suite *suite_driver_all(void)
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
 
+#ifndef _WIN32
+	tc = tcase_create("scpi");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_scpi_pps_bulk);
+	suite_add_tcase(s, tc);
+#endif
+
 	return s;
 }
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -33,6 +34,48 @@ START_TEST(test_input_available)
 }
 END_TEST
 
+static const char *scan_buffer_module(const char *data, size_t len)
+{
+	const struct sr_input *in;
+	const char *id;
+	GString *buf;
+	int ret;
+
+	buf = g_string_new_len(data, len);
+	ret = sr_input_scan_buffer(buf, &in);
+	g_string_free(buf, TRUE);
+	if (ret != SR_OK || !in)
+		return NULL;
+	id = sr_input_id_get(sr_input_module_get(in));
+	sr_input_free(in);
+
+	return id;
+}
+
+/*
+ * Check format detection for formats with and without byte signatures,
+ * and that modules with signatures don't claim other content.
+ */
+START_TEST(test_input_scan_buffer)
+{
+	static const char srcap[] = "sigrokCF\x01\x00\x00\x00";
+	static const char vcd[] = "$timescale 1 ns $end\n"
+		"$var wire 1 ! a $end\n$enddefinitions $end\n";
+	static const char text[] = "RIF";
+	const char *id;
+
+	id = scan_buffer_module(srcap, sizeof(srcap) - 1);
+	fail_unless(id && strcmp(id, "srcap") == 0,
+		"Signature not detected: %s.", id ? id : "(none)");
+	id = scan_buffer_module(vcd, sizeof(vcd) - 1);
+	fail_unless(id && strcmp(id, "vcd") == 0,
+		"Text format not detected: %s.", id ? id : "(none)");
+	id = scan_buffer_module(text, sizeof(text) - 1);
+	fail_unless(!id || strcmp(id, "wav") != 0,
+		"Partial signature got claimed.");
+}
+END_TEST
+
 Suite *suite_input_all(void)
 {
 	Suite *s;
@@ -42,6 +85,7 @@ Suite *suite_input_all(void)
 
 	tc = tcase_create("basic");
 	tcase_add_test(tc, test_input_available);
+	tcase_add_test(tc, test_input_scan_buffer);
 	suite_add_tcase(s, tc);
 
 	return s;
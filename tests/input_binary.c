@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <check.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -308,6 +310,106 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+START_TEST(test_input_binary_mapped)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	GHashTable *options;
+	uint8_t buf[1001];
+	size_t offset, length, consumed;
+	int ret;
+
+	df_packet_counter = sample_counter = 0;
+	have_seen_df_end = FALSE;
+	check_to_perform = CHECK_ALL_HIGH;
+	expected_samples = sizeof(buf) / 2;
+	expected_samplerate = NULL;
+	memset(buf, 0xff, sizeof(buf));
+
+	/* 12 channels, i.e. windows end in partial samples. */
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+		g_variant_ref_sink(g_variant_new_int32(12)));
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	ret = sr_input_send_mapped(in, buf, 33, &consumed);
+	fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+	fail_unless(sr_input_dev_inst_get(in) != NULL);
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	offset = consumed;
+	while (offset < sizeof(buf)) {
+		length = MIN(sizeof(buf) - offset, 33);
+		ret = sr_input_send_mapped(in, buf + offset, length, &consumed);
+		fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+		if (length == 1 && !consumed)
+			break;
+		fail_unless(consumed > 0 && consumed <= length);
+		offset += consumed;
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	fail_unless(have_seen_df_end);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_hash_table_destroy(options);
+}
+END_TEST
+
+START_TEST(test_input_binary_run_file)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	char *filename, *data;
+	size_t size;
+	int fd, ret;
+
+	df_packet_counter = sample_counter = 0;
+	have_seen_df_end = FALSE;
+	check_to_perform = CHECK_ALL_HIGH;
+	expected_samplerate = NULL;
+
+	/* More than two of the reader's chunks. */
+	size = 9 * 1024 * 1024 + 3;
+	expected_samples = size;
+	data = g_malloc(size);
+	memset(data, 0xff, size);
+	fd = g_file_open_tmp("input-binary-XXXXXX", &filename, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+	close(fd);
+	fail_unless(g_file_set_contents(filename, data, size, NULL));
+	g_free(data);
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	ret = sr_input_run_file(in, filename, session, 2);
+	fail_unless(ret == SR_OK, "sr_input_run_file() error: %d", ret);
+	fail_unless(sr_input_dev_inst_get(in) != NULL);
+	fail_unless(have_seen_df_end);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +423,8 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_mapped);
+	tcase_add_test(tc, test_input_binary_run_file);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -0,0 +1,226 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The libsigrok developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/*
+ * Generated VCD files like FPGA simulations create them: many single
+ * bit signals, one value change per timestamp. At timestamp t signal
+ * (t % N) is high, all other signals are low.
+ */
+
+static uint64_t sample_counter;
+static gboolean have_seen_df_end;
+
+/* Get a VCD identifier like the VCD output module does. */
+static void append_vcd_id(GString *s, size_t idx)
+{
+	do {
+		g_string_append_c(s, '!' + idx % 94);
+		idx /= 94;
+	} while (idx);
+}
+
+static GString *gen_vcd(size_t num_signals, size_t num_changes)
+{
+	GString *s;
+	size_t idx, ts;
+
+	s = g_string_sized_new(num_signals * 32 + num_changes * 16);
+	g_string_append(s, "$timescale 1 ns $end\n");
+	g_string_append(s, "$scope module top $end\n");
+	for (idx = 0; idx < num_signals; idx++) {
+		g_string_append(s, "$var wire 1 ");
+		append_vcd_id(s, idx);
+		g_string_append_printf(s, " s%zu $end\n", idx);
+	}
+	g_string_append(s, "$upscope $end\n");
+	g_string_append(s, "$enddefinitions $end\n");
+
+	g_string_append(s, "#0\n$dumpvars\n");
+	for (idx = 0; idx < num_signals; idx++) {
+		g_string_append_c(s, '0');
+		append_vcd_id(s, idx);
+		g_string_append_c(s, '\n');
+	}
+	g_string_append(s, "$end\n");
+	for (ts = 1; ts <= num_changes; ts++) {
+		g_string_append_printf(s, "#%zu\n0", ts);
+		append_vcd_id(s, (ts - 1) % num_signals);
+		g_string_append(s, "\n1");
+		append_vcd_id(s, ts % num_signals);
+		g_string_append_c(s, '\n');
+	}
+
+	return s;
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	size_t num_signals, count, idx, byte_idx, expect_bit;
+	uint64_t ts;
+
+	(void)sdi;
+
+	num_signals = *(size_t *)cb_data;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		fail_unless(logic->unitsize == (num_signals + 7) / 8);
+		data = logic->data;
+		count = logic->length / logic->unitsize;
+		for (idx = 0; idx < count; idx++) {
+			ts = sample_counter + idx;
+			for (byte_idx = 0; byte_idx < logic->unitsize; byte_idx++) {
+				expect_bit = ts % num_signals;
+				if (!ts || expect_bit / 8 != byte_idx) {
+					fail_unless(data[byte_idx] == 0,
+						"Unexpected level at %" PRIu64 ".", ts);
+					continue;
+				}
+				fail_unless(data[byte_idx] == 1 << (expect_bit % 8),
+					"Unexpected level at %" PRIu64 ".", ts);
+			}
+			data += logic->unitsize;
+		}
+		sample_counter += count;
+		break;
+	case SR_DF_END:
+		have_seen_df_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Feed the generated VCD, optionally starting at a timestamp and with an
+ * index file.
+ */
+static void check_vcd_opts(size_t num_signals, size_t num_changes,
+	uint64_t skip, const char *index_file)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	GHashTable *options;
+	GString *buf;
+	int ret;
+
+	sample_counter = skip;
+	have_seen_df_end = FALSE;
+	buf = gen_vcd(num_signals, num_changes);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	if (skip) {
+		g_hash_table_insert(options, "skip",
+			g_variant_ref_sink(g_variant_new_uint64(skip)));
+	}
+	if (index_file) {
+		g_hash_table_insert(options, "index",
+			g_variant_ref_sink(g_variant_new_string(index_file)));
+	}
+
+	imod = sr_input_find("vcd");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, options);
+	g_hash_table_destroy(options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, &num_signals);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	ret = sr_input_send(in, buf);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(have_seen_df_end);
+	fail_unless(sample_counter == num_changes + 1,
+		"Expected samples up to %zu, got samples up to %" PRIu64 ".",
+		num_changes + 1, sample_counter);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(buf, TRUE);
+}
+
+static void check_vcd(size_t num_signals, size_t num_changes)
+{
+	check_vcd_opts(num_signals, num_changes, 0, NULL);
+}
+
+START_TEST(test_input_vcd_small)
+{
+	check_vcd(3, 20);
+	check_vcd(8, 100);
+	check_vcd(100, 1000);
+}
+END_TEST
+
+/*
+ * The first import builds the index, the second resumes from it. Both
+ * must provide the same samples.
+ */
+START_TEST(test_input_vcd_index)
+{
+	char *index_file;
+	int fd;
+
+	fd = g_file_open_tmp("sr-vcd-XXXXXX.idx", &index_file, NULL);
+	fail_unless(fd >= 0, "Cannot create index file name.");
+	close(fd);
+	g_unlink(index_file);
+
+	check_vcd_opts(16, 5000, 1234, index_file);
+	fail_unless(g_file_test(index_file, G_FILE_TEST_EXISTS),
+		"VCD index was not written.");
+	check_vcd_opts(16, 5000, 1234, index_file);
+	check_vcd_opts(16, 5000, 0, index_file);
+
+	g_unlink(index_file);
+	g_free(index_file);
+}
+END_TEST
+
+Suite *suite_input_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-vcd");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_vcd_small);
+	tcase_add_test(tc, test_input_vcd_index);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,7 +19,11 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <check.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -96,6 +100,368 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+#define TEXT_CHANNELS 11
+#define TEXT_SAMPLES 300
+
+static uint8_t text_level(size_t sample, size_t ch)
+{
+	return ((sample * 7 + ch * 13) / (ch + 1)) % 3 == 0;
+}
+
+/*
+ * Reference layout of the bits and hex output, one sample at a time:
+ * "name:" and the samples of a line, a space after each byte, lines
+ * of all channels get flushed together.
+ */
+static GString *text_reference(gboolean hex, size_t width)
+{
+	GString *s, *lines[TEXT_CHANNELS];
+	uint8_t buf[TEXT_CHANNELS];
+	size_t sample, ch, cnt;
+
+	s = g_string_new(NULL);
+	for (ch = 0; ch < TEXT_CHANNELS; ch++) {
+		lines[ch] = g_string_new(NULL);
+		g_string_printf(lines[ch], "D%zu:", ch);
+		buf[ch] = 0;
+	}
+	cnt = 0;
+	for (sample = 0; sample < TEXT_SAMPLES; sample++) {
+		cnt++;
+		for (ch = 0; ch < TEXT_CHANNELS; ch++) {
+			if (hex) {
+				buf[ch] = (buf[ch] << 1) | text_level(sample, ch);
+				if (cnt % 8 == 0) {
+					g_string_append_printf(lines[ch], "%.2x ", buf[ch]);
+					buf[ch] = 0;
+				}
+			} else {
+				g_string_append_c(lines[ch],
+					text_level(sample, ch) ? '1' : '0');
+				if (cnt != width && cnt % 8 == 0)
+					g_string_append_c(lines[ch], ' ');
+			}
+			if (cnt == width) {
+				g_string_append_printf(s, "%s\n", lines[ch]->str);
+				g_string_printf(lines[ch], "D%zu:", ch);
+			}
+		}
+		if (cnt == width)
+			cnt = 0;
+	}
+	for (ch = 0; cnt && ch < TEXT_CHANNELS; ch++) {
+		if (hex && cnt % 8)
+			g_string_append_printf(lines[ch], "%.2x ",
+				buf[ch] << (8 - cnt % 8));
+		g_string_append_printf(s, "%s\n", lines[ch]->str);
+	}
+	for (ch = 0; ch < TEXT_CHANNELS; ch++)
+		g_string_free(lines[ch], TRUE);
+
+	return s;
+}
+
+static void check_text_output(const char *id, size_t width, size_t chunk)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *text, *out, *expect;
+	uint8_t data[TEXT_SAMPLES * 2];
+	size_t sample, ch, count;
+	char name[8];
+	const char *body;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (ch = 0; ch < TEXT_CHANNELS; ch++) {
+		snprintf(name, sizeof(name), "D%zu", ch);
+		sr_dev_inst_channel_add(sdi, ch, SR_CHANNEL_LOGIC, name);
+	}
+	memset(data, 0, sizeof(data));
+	for (sample = 0; sample < TEXT_SAMPLES; sample++) {
+		for (ch = 0; ch < TEXT_CHANNELS; ch++) {
+			if (text_level(sample, ch))
+				data[sample * 2 + ch / 8] |= 1 << (ch % 8);
+		}
+	}
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("width"),
+		g_variant_ref_sink(g_variant_new_uint32(width)));
+	o = sr_output_new(sr_output_find((char *)id), params, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create '%s' output.", id);
+	g_hash_table_destroy(params);
+
+	text = g_string_new(NULL);
+	logic.unitsize = 2;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (sample = 0; sample < TEXT_SAMPLES; sample += count) {
+		count = MIN(chunk, TEXT_SAMPLES - sample);
+		logic.length = count * logic.unitsize;
+		logic.data = &data[sample * logic.unitsize];
+		out = NULL;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		if (out) {
+			g_string_append_len(text, out->str, out->len);
+			g_string_free(out, TRUE);
+		}
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	out = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+	sr_output_free(o);
+
+	/* Skip the two header lines. */
+	body = strchr(text->str, '\n');
+	fail_unless(body != NULL);
+	body = strchr(body + 1, '\n');
+	fail_unless(body != NULL);
+	expect = text_reference(!strcmp(id, "hex"), width);
+	fail_unless(!strcmp(body + 1, expect->str),
+		"Unexpected '%s' output, width %zu, chunks of %zu samples.",
+		id, width, chunk);
+	g_string_free(expect, TRUE);
+	g_string_free(text, TRUE);
+}
+
+/* Check the bits and hex layout across packet and line boundaries. */
+START_TEST(test_output_text_layout)
+{
+	const size_t widths[] = { 8, 20, 64, 1000 };
+	const size_t chunks[] = { 1, 7, 37, TEXT_SAMPLES };
+	size_t w, c;
+
+	for (w = 0; w < G_N_ELEMENTS(widths); w++) {
+		for (c = 0; c < G_N_ELEMENTS(chunks); c++) {
+			check_text_output("bits", widths[w], chunks[c]);
+			check_text_output("hex", widths[w], chunks[c]);
+		}
+	}
+}
+END_TEST
+
+static uint32_t arrow_u32(const char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return GUINT32_FROM_LE(v);
+}
+
+/* Get the bodyLength field of an Arrow IPC message's metadata. */
+static uint64_t arrow_body_length(const char *meta)
+{
+	const char *table, *vtable;
+	uint16_t vtable_len, field;
+	uint64_t v;
+
+	table = meta + arrow_u32(meta);
+	vtable = table - (int32_t)arrow_u32(table);
+	memcpy(&vtable_len, vtable, sizeof(vtable_len));
+	if (GUINT16_FROM_LE(vtable_len) < 4 + 4 * 2)
+		return 0;
+	memcpy(&field, vtable + 4 + 3 * 2, sizeof(field));
+	field = GUINT16_FROM_LE(field);
+	if (!field)
+		return 0;
+	memcpy(&v, table + field, sizeof(v));
+	return GUINT64_FROM_LE(v);
+}
+
+/* Check the framing of the Arrow stream, and its number of batches. */
+START_TEST(test_output_arrow_stream)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *text, *out;
+	uint8_t data[TEXT_SAMPLES * 2];
+	size_t ch, pos, messages;
+	uint32_t meta_len;
+	char name[8];
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (ch = 0; ch < TEXT_CHANNELS; ch++) {
+		snprintf(name, sizeof(name), "D%zu", ch);
+		sr_dev_inst_channel_add(sdi, ch, SR_CHANNEL_LOGIC, name);
+	}
+	memset(data, 0x5a, sizeof(data));
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("batch"),
+		g_variant_ref_sink(g_variant_new_uint64(128)));
+	o = sr_output_new(sr_output_find("arrow"), params, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create 'arrow' output.");
+	g_hash_table_destroy(params);
+
+	text = g_string_new(NULL);
+	logic.unitsize = 2;
+	logic.length = sizeof(data);
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	out = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	out = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(out != NULL);
+	g_string_append_len(text, out->str, out->len);
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+
+	/* Schema, batches of 128, 128 and 44 rows, end of stream. */
+	pos = 0;
+	messages = 0;
+	while (TRUE) {
+		fail_unless(pos + 8 <= text->len, "Truncated Arrow stream.");
+		fail_unless(arrow_u32(text->str + pos) == 0xffffffff);
+		meta_len = arrow_u32(text->str + pos + 4);
+		pos += 8;
+		if (!meta_len)
+			break;
+		fail_unless(meta_len % 8 == 0);
+		pos += meta_len + arrow_body_length(text->str + pos);
+		messages++;
+	}
+	fail_unless(pos == text->len, "Data after the end of the stream.");
+	fail_unless(messages == 4, "Unexpected number of messages: %zu.",
+		messages);
+	g_string_free(text, TRUE);
+}
+END_TEST
+
+#define SRCAP_CHANNELS 12
+#define SRCAP_SAMPLES 1000
+
+static uint8_t srcap_byte(size_t sample, size_t byte)
+{
+	return (sample * 37 + byte * 101) & 0xff;
+}
+
+/*
+ * Write a srcap file for a device with 12 logic channels, from packets
+ * of the given unit size, and read the samples back. The file's unit
+ * size is always 2. Wider samples get truncated, narrower ones zero
+ * extended.
+ */
+static void check_srcap_logic(size_t unitsize, gboolean disable_upper)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *channel;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_capture_file *cf;
+	GSList *l;
+	GString *out;
+	uint8_t *data;
+	const void *mapped;
+	const uint8_t *sample;
+	uint64_t total, count, pos, i;
+	unsigned int num_logic, file_unitsize;
+	size_t ch, b, sent, chunk;
+	uint8_t expect;
+	char *filename, name[8];
+	int fd, ret;
+
+	fd = g_file_open_tmp("sr-srcap-XXXXXX.srcap", &filename, NULL);
+	fail_unless(fd >= 0, "Cannot create a temporary file.");
+	close(fd);
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (ch = 0; ch < SRCAP_CHANNELS; ch++) {
+		snprintf(name, sizeof(name), "D%zu", ch);
+		sr_dev_inst_channel_add(sdi, ch, SR_CHANNEL_LOGIC, name);
+	}
+	for (l = sr_dev_inst_channels_get(sdi); disable_upper && l; l = l->next) {
+		channel = l->data;
+		if (channel->index >= 8)
+			sr_dev_channel_enable(channel, FALSE);
+	}
+	data = g_malloc(SRCAP_SAMPLES * unitsize);
+	for (i = 0; i < SRCAP_SAMPLES; i++) {
+		for (b = 0; b < unitsize; b++)
+			data[i * unitsize + b] = srcap_byte(i, b);
+	}
+
+	o = sr_output_new(sr_output_find("srcap"), NULL, sdi, filename);
+	fail_unless(o != NULL, "Failed to create 'srcap' output.");
+	logic.unitsize = unitsize;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (sent = 0; sent < SRCAP_SAMPLES; sent += chunk) {
+		chunk = MIN(77, SRCAP_SAMPLES - sent);
+		logic.length = chunk * unitsize;
+		logic.data = &data[sent * unitsize];
+		out = NULL;
+		ret = sr_output_send(o, &packet, &out);
+		fail_unless(ret == SR_OK, "Unit size %zu: logic data rejected.",
+			unitsize);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	sr_output_free(o);
+
+	ret = sr_capture_file_open(filename, &cf);
+	fail_unless(ret == SR_OK, "Cannot read back the capture file.");
+	sr_capture_file_info(cf, NULL, &num_logic, &file_unitsize, NULL);
+	fail_unless(num_logic == SRCAP_CHANNELS);
+	fail_unless(file_unitsize == 2);
+	sr_capture_file_logic_samples(cf, &total);
+	fail_unless(total == SRCAP_SAMPLES, "Unit size %zu: %" PRIu64
+		" samples instead of %d.", unitsize, total, SRCAP_SAMPLES);
+	for (pos = 0; pos < total; pos += count) {
+		ret = sr_capture_file_logic_map(cf, pos, &mapped, &count);
+		fail_unless(ret == SR_OK && count > 0);
+		sample = mapped;
+		for (i = pos; i < pos + count; i++, sample += file_unitsize) {
+			for (b = 0; b < file_unitsize; b++) {
+				expect = b < unitsize ? srcap_byte(i, b) : 0;
+				fail_unless(sample[b] == expect, "Unit size %zu: "
+					"unexpected sample %" PRIu64 ".",
+					unitsize, i);
+			}
+		}
+	}
+	sr_capture_file_close(cf);
+
+	g_unlink(filename);
+	g_free(filename);
+	g_free(data);
+}
+
+/*
+ * Check that srcap keeps the logic data of drivers which don't send the
+ * unit size that the number of logic channels suggests.
+ */
+START_TEST(test_output_srcap_unitsize)
+{
+	check_srcap_logic(2, FALSE);
+	check_srcap_logic(4, FALSE);
+	check_srcap_logic(1, TRUE);
+	check_srcap_logic(3, TRUE);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +476,9 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_text_layout);
+	tcase_add_test(tc, test_output_arrow_stream);
+	tcase_add_test(tc, test_output_srcap_unitsize);
 	suite_add_tcase(s, tc);
 
 	return s;
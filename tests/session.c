@@ -19,7 +19,10 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -185,6 +188,1075 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+static void dummy_datafeed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+/*
+ * Check whether datafeed callbacks with flags can be registered.
+ * If it returns != SR_OK (or segfaults) this test will fail.
+ */
+START_TEST(test_session_datafeed_callback_add_full)
+{
+	int ret;
+	struct sr_session *sess;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_datafeed_callback_add_full(sess, dummy_datafeed_cb,
+			NULL, SR_DATAFEED_CB_REFCOUNTED);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_callback_add_full(sess, NULL, NULL, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_callback_add_full(NULL,
+			dummy_datafeed_cb, NULL, 0);
+	fail_unless(ret != SR_OK);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether packets which were not lent by a driver get copied by
+ * sr_packet_ref(), and whether further references share that copy.
+ */
+START_TEST(test_packet_ref_copy)
+{
+	uint8_t samples[] = { 0x01, 0x23, 0x45, 0x67 };
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet, *ref1, *ref2;
+	const struct sr_datafeed_logic *logic_ref;
+
+	logic.length = sizeof(samples);
+	logic.unitsize = 1;
+	logic.data = samples;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	ref1 = sr_packet_ref(&packet);
+	fail_unless(ref1 != NULL);
+	fail_unless(ref1 != &packet);
+	fail_unless(ref1->type == SR_DF_LOGIC);
+	logic_ref = ref1->payload;
+	fail_unless(logic_ref->data != samples);
+	fail_unless(logic_ref->length == logic.length);
+	fail_unless(!memcmp(logic_ref->data, samples, sizeof(samples)));
+
+	/* Referencing the copy again must not copy it once more. */
+	ref2 = sr_packet_ref(ref1);
+	fail_unless(ref2 == ref1);
+
+	sr_packet_unref(ref2);
+	sr_packet_unref(ref1);
+
+	/* NULL packets, must not segfault. */
+	fail_unless(sr_packet_ref(NULL) == NULL);
+	sr_packet_unref(NULL);
+}
+END_TEST
+
+/* Check expansion of run length encoded logic data, also piecewise. */
+START_TEST(test_logic_rle_expand)
+{
+	uint8_t values[] = { 0x01, 0x02, 0x03 };
+	uint64_t run_lengths[] = { 3, 0, 2 };
+	const uint8_t expected[] = { 0x01, 0x01, 0x01, 0x03, 0x03 };
+	struct sr_datafeed_logic_rle rle;
+	uint8_t buf[8];
+	uint64_t count;
+	int ret;
+
+	rle.num_runs = ARRAY_SIZE(values);
+	rle.unitsize = 1;
+	rle.values = values;
+	rle.run_lengths = run_lengths;
+
+	fail_unless(sr_logic_rle_sample_count(&rle) == sizeof(expected));
+
+	count = sizeof(buf);
+	ret = sr_logic_rle_expand(&rle, 0, buf, &count);
+	fail_unless(ret == SR_OK);
+	fail_unless(count == sizeof(expected));
+	fail_unless(!memcmp(buf, expected, sizeof(expected)));
+
+	/* A window which starts and ends within runs. */
+	count = 2;
+	ret = sr_logic_rle_expand(&rle, 2, buf, &count);
+	fail_unless(ret == SR_OK);
+	fail_unless(count == 2);
+	fail_unless(!memcmp(buf, &expected[2], 2));
+
+	count = sizeof(buf);
+	ret = sr_logic_rle_expand(NULL, 0, buf, &count);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
+static uint16_t sample16(const uint8_t *buf, uint64_t idx)
+{
+	return buf[2 * idx] | (buf[2 * idx + 1] << 8);
+}
+
+/* Check conversion of planar logic data, from aligned and odd offsets. */
+START_TEST(test_logic_planar_expand)
+{
+	uint8_t plane0[] = { 0x55, 0x55, 0x01 };
+	uint8_t plane9[] = { 0xf0, 0x0f, 0x01 };
+	uint8_t *planes[16] = { NULL };
+	struct sr_datafeed_logic_planar planar;
+	uint16_t expected[20];
+	uint8_t buf[48];
+	uint64_t count, i;
+	int ret;
+
+	planes[0] = plane0;
+	planes[9] = plane9;
+	planar.num_samples = ARRAY_SIZE(expected);
+	planar.unitsize = sizeof(uint16_t);
+	planar.planes = planes;
+	for (i = 0; i < ARRAY_SIZE(expected); i++) {
+		expected[i] = ((plane0[i / 8] >> (i % 8)) & 1) |
+			(((plane9[i / 8] >> (i % 8)) & 1) << 9);
+	}
+
+	count = ARRAY_SIZE(buf) / 2;
+	ret = sr_logic_planar_expand(&planar, 0, buf, &count);
+	fail_unless(ret == SR_OK);
+	fail_unless(count == ARRAY_SIZE(expected));
+	for (i = 0; i < count; i++)
+		fail_unless(sample16(buf, i) == expected[i]);
+
+	count = 7;
+	ret = sr_logic_planar_expand(&planar, 3, buf, &count);
+	fail_unless(ret == SR_OK);
+	fail_unless(count == 7);
+	for (i = 0; i < count; i++)
+		fail_unless(sample16(buf, i) == expected[3 + i]);
+
+	count = ARRAY_SIZE(buf) / 2;
+	ret = sr_logic_planar_expand(&planar, 16, buf, &count);
+	fail_unless(ret == SR_OK);
+	fail_unless(count == 4);
+	for (i = 0; i < count; i++)
+		fail_unless(sample16(buf, i) == expected[16 + i]);
+
+	ret = sr_logic_planar_expand(NULL, 0, buf, &count);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
+/*
+ * Acquisitions from the demo driver's "incremental" logic pattern. Each
+ * sample is the previous one plus one, which lets the datafeed callback
+ * detect lost, repeated and reordered packets.
+ */
+struct demo_run {
+	uint64_t samples;
+	uint64_t mismatches;
+	unsigned int logic_packets;
+	gboolean seen_header;
+	gboolean seen_end;
+	gboolean late_packets;
+	/* Delay per logic packet, to have packets pile up. */
+	gulong delay_us;
+	/* Stop the session after that many logic packets, if not 0. */
+	unsigned int stop_after;
+	struct sr_session *session;
+};
+
+static void demo_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct demo_run *run;
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	size_t i;
+
+	(void)sdi;
+
+	run = cb_data;
+	if (run->seen_end)
+		run->late_packets = TRUE;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		fail_unless(!run->seen_header, "Received a second header.");
+		run->seen_header = TRUE;
+		break;
+	case SR_DF_LOGIC:
+		fail_unless(run->seen_header, "Logic data before the header.");
+		logic = packet->payload;
+		fail_unless(logic->unitsize == 1);
+		data = logic->data;
+		for (i = 0; i < logic->length; i++) {
+			if (data[i] != (uint8_t)run->samples)
+				run->mismatches++;
+			run->samples++;
+		}
+		run->logic_packets++;
+		if (run->stop_after && run->logic_packets == run->stop_after)
+			sr_session_stop(run->session);
+		if (run->delay_us)
+			g_usleep(run->delay_us);
+		break;
+	case SR_DF_END:
+		run->seen_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Open a demo device, which sends limit_samples of the pattern. */
+static struct sr_dev_inst *demo_dev_open(uint64_t limit_samples)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_channel_group *cg;
+	struct sr_config opt_logic, opt_analog;
+	GSList *options, *devices;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	opt_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	opt_logic.data = g_variant_new_int32(8);
+	opt_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	opt_analog.data = g_variant_new_int32(0);
+	options = g_slist_append(NULL, &opt_logic);
+	options = g_slist_append(options, &opt_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(opt_logic.data);
+	g_variant_unref(opt_analog.data);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_dev_open(sdi);
+	fail_unless(ret == SR_OK, "sr_dev_open() failed: %d.", ret);
+	cg = sr_dev_inst_channel_groups_get(sdi)->data;
+	ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+		g_variant_new_string("incremental"));
+	fail_unless(ret == SR_OK);
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(10)));
+	fail_unless(ret == SR_OK);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(limit_samples));
+	fail_unless(ret == SR_OK);
+
+	return sdi;
+}
+
+/* Run the session with an opened demo device, until its limits. */
+static void demo_dev_run(struct sr_session *sess, struct demo_run *run,
+	struct sr_dev_inst *sdi)
+{
+	int ret;
+
+	run->session = sess;
+	sr_session_dev_add(sess, sdi);
+	sr_session_datafeed_callback_add(sess, demo_datafeed_in, run);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+	fail_unless(run->seen_end, "The stream did not end.");
+	fail_unless(!run->late_packets, "Packets after the end.");
+	fail_unless(run->mismatches == 0,
+		"%" PRIu64 " samples out of order.", run->mismatches);
+
+	sr_session_datafeed_callback_remove_all(sess);
+	sr_session_dev_remove_all(sess);
+	sr_dev_close(sdi);
+}
+
+/* Run the session with a demo device, until limit_samples got sent. */
+static void demo_run(struct sr_session *sess, struct demo_run *run,
+	uint64_t limit_samples)
+{
+	demo_dev_run(sess, run, demo_dev_open(limit_samples));
+}
+
+/*
+ * Check whether the datafeed ring can be configured, and whether its
+ * statistics are available before the first run.
+ */
+START_TEST(test_session_datafeed_ring)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_ring_stats stats;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_datafeed_ring_set(sess, 64, TRUE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_ring_set(sess, 0, FALSE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_ring_set(NULL, 64, FALSE);
+	fail_unless(ret == SR_ERR_ARG);
+
+	ret = sr_session_datafeed_ring_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats.packets_queued == 0);
+	fail_unless(stats.packets_dropped == 0);
+	ret = sr_session_datafeed_ring_stats_get(sess, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether all packets which pass through the datafeed ring reach
+ * the callback in order. The callback is slow and the ring is small,
+ * so the ring fills up and wraps around many times.
+ */
+START_TEST(test_session_datafeed_ring_delivery)
+{
+	const uint64_t limit = 400000;
+	struct sr_session *sess;
+	struct sr_session_ring_stats stats;
+	struct demo_run run;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_datafeed_ring_set(sess, 4, FALSE);
+	fail_unless(ret == SR_OK);
+
+	memset(&run, 0, sizeof(run));
+	run.delay_us = 200;
+	demo_run(sess, &run, limit);
+	fail_unless(run.samples == limit, "Expected %" PRIu64 " samples, "
+		"got %" PRIu64 ".", limit, run.samples);
+
+	ret = sr_session_datafeed_ring_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats.depth == 4);
+	fail_unless(stats.packets_dropped == 0);
+	fail_unless(stats.packets_queued >= run.logic_packets);
+	fail_unless(run.logic_packets > 2 * stats.depth,
+		"Only %u packets, the ring did not wrap.", run.logic_packets);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check that a device which runs on a thread of its own delivers all
+ * of its samples, in order, through the session's queue.
+ */
+START_TEST(test_session_device_threads)
+{
+	const uint64_t limit = 400000;
+	struct sr_session *sess;
+	struct demo_run run;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_device_threads_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+
+	memset(&run, 0, sizeof(run));
+	demo_run(sess, &run, limit);
+	fail_unless(run.samples == limit, "Expected %" PRIu64 " samples, "
+		"got %" PRIu64 ".", limit, run.samples);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Stop the session while the device thread has queued more packets
+ * than the slow callback has taken. The worker must get joined, and
+ * the queued packets must still get delivered, terminated by the end
+ * of the stream.
+ */
+START_TEST(test_session_device_threads_stop)
+{
+	const uint64_t limit = 100 * 1000 * 1000;
+	struct sr_session *sess;
+	struct demo_run run;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_device_threads_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+
+	memset(&run, 0, sizeof(run));
+	run.delay_us = 2000;
+	run.stop_after = 5;
+	demo_run(sess, &run, limit);
+	fail_unless(run.logic_packets > run.stop_after,
+		"Queued packets were lost.");
+	fail_unless(run.samples < limit, "The session did not stop.");
+
+	/* The session can run again after having been stopped. */
+	memset(&run, 0, sizeof(run));
+	demo_run(sess, &run, 10000);
+	fail_unless(run.samples == 10000);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check that outputs on worker threads of the session get all of the
+ * packets in order, and have written them when they got removed.
+ */
+START_TEST(test_session_outputs)
+{
+	const uint64_t limit = 400000;
+	const struct sr_output_module *omod;
+	const struct sr_output *o[2];
+	struct sr_dev_inst *sdi;
+	struct sr_session *sess;
+	struct demo_run run;
+	char *filename[2], *contents;
+	gsize len, i, mismatches;
+	int fd[2], ret;
+	size_t k;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_output_add(NULL, NULL, -1);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_output_add(sess, NULL, -1);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_outputs_remove_all(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_outputs_remove_all(NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sdi = demo_dev_open(limit);
+	omod = sr_output_find("binary");
+	fail_unless(omod != NULL, "Failed to find output module.");
+	for (k = 0; k < ARRAY_SIZE(o); k++) {
+		o[k] = sr_output_new(omod, NULL, sdi, NULL);
+		fail_unless(o[k] != NULL, "Failed to create output instance.");
+		fd[k] = g_file_open_tmp("sigrok-output-XXXXXX", &filename[k], NULL);
+		fail_unless(fd[k] >= 0, "Failed to create output file.");
+		ret = sr_session_output_add(sess, o[k], fd[k]);
+		fail_unless(ret == SR_OK, "sr_session_output_add() failed: %d.", ret);
+	}
+
+	memset(&run, 0, sizeof(run));
+	demo_dev_run(sess, &run, sdi);
+	fail_unless(run.samples == limit, "Expected %" PRIu64 " samples, "
+		"got %" PRIu64 ".", limit, run.samples);
+	/* The outputs' queues are drained when this returns. */
+	ret = sr_session_outputs_remove_all(sess);
+	fail_unless(ret == SR_OK, "sr_session_outputs_remove_all() failed: %d.", ret);
+
+	for (k = 0; k < ARRAY_SIZE(o); k++) {
+		fail_unless(g_file_get_contents(filename[k], &contents, &len, NULL),
+			"Failed to read output file.");
+		fail_unless(len == limit, "Output %zu wrote %" G_GSIZE_FORMAT
+			" of %" PRIu64 " samples.", k, len, limit);
+		mismatches = 0;
+		for (i = 0; i < len; i++) {
+			if ((uint8_t)contents[i] != (uint8_t)i)
+				mismatches++;
+		}
+		fail_unless(mismatches == 0, "Output %zu has %" G_GSIZE_FORMAT
+			" samples out of order.", k, mismatches);
+		g_free(contents);
+		sr_output_free(o[k]);
+		close(fd[k]);
+		g_unlink(filename[k]);
+		g_free(filename[k]);
+	}
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Samples per frame of the demo driver. */
+#define DEMO_FRAME_SAMPLES 1000
+
+/* Check a frame of the demo driver's incremental pattern. */
+static void frame_check(GSList *frame, unsigned int index)
+{
+	const struct sr_datafeed_packet *packet;
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	uint64_t sample;
+	size_t i;
+	GSList *l;
+
+	fail_unless(frame != NULL, "Empty frame.");
+	packet = frame->data;
+	fail_unless(packet->type == SR_DF_FRAME_BEGIN, "Frame starts with %d.",
+		packet->type);
+	packet = g_slist_last(frame)->data;
+	fail_unless(packet->type == SR_DF_FRAME_END, "Frame ends with %d.",
+		packet->type);
+
+	sample = (uint64_t)index * DEMO_FRAME_SAMPLES;
+	for (l = frame; l; l = l->next) {
+		packet = l->data;
+		if (packet->type != SR_DF_LOGIC)
+			continue;
+		logic = packet->payload;
+		data = logic->data;
+		for (i = 0; i < logic->length; i++, sample++) {
+			fail_unless(data[i] == (uint8_t)sample,
+				"Frame %u is not the expected one.", index);
+		}
+	}
+	fail_unless(sample == (uint64_t)(index + 1) * DEMO_FRAME_SAMPLES,
+		"Frame %u has %" PRIu64 " samples.", index,
+		sample - (uint64_t)index * DEMO_FRAME_SAMPLES);
+}
+
+struct mailbox_run {
+	struct sr_session *session;
+	unsigned int frame_begins;
+	gboolean taken;
+};
+
+/* Take a frame while the acquisition runs, at the start of frame 4. */
+static void mailbox_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct mailbox_run *run;
+	GSList *frame;
+	uint64_t frames, dropped;
+	int ret;
+
+	(void)sdi;
+
+	run = cb_data;
+	if (packet->type != SR_DF_FRAME_BEGIN || ++run->frame_begins != 5)
+		return;
+
+	ret = sr_session_frame_take(run->session, &frame, 0);
+	fail_unless(ret == SR_OK, "sr_session_frame_take() failed: %d.", ret);
+	frame_check(frame, 3);
+	sr_session_frame_free(frame);
+	ret = sr_session_frame_stats_get(run->session, &frames, &dropped);
+	fail_unless(ret == SR_OK);
+	fail_unless(frames == 4 && dropped == 3, "%" PRIu64 " frames, %"
+		PRIu64 " dropped.", frames, dropped);
+	run->taken = TRUE;
+}
+
+/*
+ * Check the frame mailbox's arguments, and that it keeps the latest
+ * frame: the demo device sends frames faster than they get taken, the
+ * frames which were not taken get replaced and counted.
+ */
+START_TEST(test_session_frame_mailbox)
+{
+	const uint64_t num_frames = 10;
+	int ret;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct demo_run run;
+	struct mailbox_run mb_run;
+	GSList *frame;
+	uint64_t frames, dropped;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_frame_take(sess, &frame, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_frame_mailbox_set(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_frame_mailbox_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_frame_take(sess, NULL, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	frame = NULL;
+	ret = sr_session_frame_take(sess, &frame, 0);
+	fail_unless(ret == SR_ERR_TIMEOUT);
+	fail_unless(frame == NULL);
+	ret = sr_session_frame_stats_get(sess, &frames, &dropped);
+	fail_unless(ret == SR_OK);
+	fail_unless(frames == 0 && dropped == 0);
+
+	sdi = demo_dev_open(100 * num_frames * DEMO_FRAME_SAMPLES);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_FRAMES,
+		g_variant_new_uint64(num_frames));
+	fail_unless(ret == SR_OK);
+	memset(&mb_run, 0, sizeof(mb_run));
+	mb_run.session = sess;
+	sr_session_datafeed_callback_add(sess, mailbox_datafeed_in, &mb_run);
+	memset(&run, 0, sizeof(run));
+	demo_dev_run(sess, &run, sdi);
+	fail_unless(mb_run.taken, "No frame was taken during the run.");
+	fail_unless(run.samples == num_frames * DEMO_FRAME_SAMPLES,
+		"Expected %" PRIu64 " samples, got %" PRIu64 ".",
+		num_frames * DEMO_FRAME_SAMPLES, run.samples);
+
+	/* Frames 0 to 2 and 4 to 8 got replaced before they were taken. */
+	ret = sr_session_frame_stats_get(sess, &frames, &dropped);
+	fail_unless(ret == SR_OK);
+	fail_unless(frames == num_frames && dropped == 3 + 5,
+		"%" PRIu64 " frames, %" PRIu64 " dropped.", frames, dropped);
+	ret = sr_session_frame_take(sess, &frame, 0);
+	fail_unless(ret == SR_OK, "sr_session_frame_take() failed: %d.", ret);
+	frame_check(frame, num_frames - 1);
+	sr_session_frame_free(frame);
+	ret = sr_session_frame_take(sess, &frame, 0);
+	fail_unless(ret == SR_ERR_NA, "Frames after the end: %d.", ret);
+
+	ret = sr_session_frame_mailbox_set(sess, FALSE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_frame_stats_get(sess, &frames, &dropped);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static unsigned int batch_logic_packets;
+static size_t batch_logic_bytes;
+
+static void batch_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	batch_logic_packets++;
+	batch_logic_bytes += logic->length;
+}
+
+/*
+ * Check whether consecutive logic packets get coalesced, and whether
+ * the pending data gets delivered at the end of the stream.
+ */
+START_TEST(test_session_datafeed_batch)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *sess;
+	GString *buf;
+	unsigned int i;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_datafeed_batch_set(NULL, 4096, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_batch_set(sess, 4096, 0);
+	fail_unless(ret == SR_OK);
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_datafeed_callback_add(sess, batch_datafeed_in, NULL);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+
+	batch_logic_packets = 0;
+	batch_logic_bytes = 0;
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0x55, buf->len);
+	for (i = 0; i < 100; i++) {
+		ret = sr_input_send(in, buf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(batch_logic_bytes == 100 * 100,
+		"Expected %d bytes, got %zu.", 100 * 100, batch_logic_bytes);
+	/* 10000 bytes in 4096 byte batches. */
+	fail_unless(batch_logic_packets == 3,
+		"Expected 3 packets, got %u.", batch_logic_packets);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static const struct sr_dev_inst *merge_order[8];
+static unsigned int merge_packets;
+
+static void merge_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	if (merge_packets < G_N_ELEMENTS(merge_order))
+		merge_order[merge_packets] = sdi;
+	merge_packets++;
+}
+
+static struct sr_input *merge_input_new(struct sr_session *sess,
+		uint64_t samplerate)
+{
+	GHashTable *options;
+	struct sr_input *in;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("samplerate"),
+		g_variant_ref_sink(g_variant_new_uint64(samplerate)));
+	in = sr_input_new(sr_input_find("binary"), options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	g_hash_table_destroy(options);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+
+	return in;
+}
+
+/*
+ * Check whether the packets of two devices get delivered in time order
+ * when merging is enabled, although one device sent all of its data
+ * before the other.
+ */
+START_TEST(test_session_datafeed_merge)
+{
+	struct sr_session *sess;
+	struct sr_input *in_a, *in_b;
+	struct sr_dev_inst *sdi_a, *sdi_b;
+	struct sr_dev_clock clock;
+	GString *buf;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_datafeed_merge_set(NULL, 1 << 20);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_merge_set(sess, 1 << 20);
+	fail_unless(ret == SR_OK);
+	sr_session_datafeed_callback_add(sess, merge_datafeed_in, NULL);
+
+	in_a = merge_input_new(sess, 1000);
+	in_b = merge_input_new(sess, 1000);
+	sdi_a = sr_input_dev_inst_get(in_a);
+	sdi_b = sr_input_dev_inst_get(in_b);
+
+	merge_packets = 0;
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0x55, buf->len);
+	/* Two packets of 100 ms each, per device. */
+	sr_input_send(in_a, buf);
+	sr_input_send(in_a, buf);
+	fail_unless(merge_packets == 0, "Packets were not held back.");
+	sr_input_send(in_b, buf);
+	sr_input_send(in_b, buf);
+	sr_input_end(in_a);
+	sr_input_end(in_b);
+
+	fail_unless(merge_packets == 4, "Expected 4 packets, got %u.",
+		merge_packets);
+	fail_unless(merge_order[0] == sdi_a && merge_order[1] == sdi_b &&
+		merge_order[2] == sdi_a && merge_order[3] == sdi_b,
+		"Packets were not delivered in time order.");
+
+	ret = sr_session_dev_clock_get(sess, sdi_a, &clock);
+	fail_unless(ret == SR_OK);
+	fail_unless(clock.samplerate == 1000);
+	fail_unless(clock.num_samples == 200);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in_b);
+	sr_input_free(in_a);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static uint64_t info_first_samples[4];
+static unsigned int info_packets;
+
+static void info_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_datafeed_packet_info info;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	fail_unless(sr_packet_info_get(packet, &info) == SR_OK,
+		"Logic packet without metadata.");
+	if (info_packets < G_N_ELEMENTS(info_first_samples))
+		info_first_samples[info_packets] = info.first_sample;
+	info_packets++;
+}
+
+/*
+ * Check whether delivered packets carry the index of their first sample.
+ */
+START_TEST(test_packet_info)
+{
+	struct sr_session *sess;
+	struct sr_input *in;
+	GString *buf;
+	unsigned int i;
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_datafeed_callback_add(sess, info_datafeed_in, NULL);
+	in = merge_input_new(sess, 1000);
+
+	info_packets = 0;
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0xaa, buf->len);
+	for (i = 0; i < 3; i++)
+		sr_input_send(in, buf);
+	sr_input_end(in);
+
+	fail_unless(info_packets == 3, "Expected 3 packets, got %u.",
+		info_packets);
+	for (i = 0; i < 3; i++)
+		fail_unless(info_first_samples[i] == 100 * i,
+			"Packet %u starts at sample %" PRIu64 ".", i,
+			info_first_samples[i]);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether packets, bytes and callback invocations get counted
+ * when datafeed statistics are enabled.
+ */
+START_TEST(test_session_datafeed_stats)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *sess;
+	struct sr_session_datafeed_stats stats;
+	struct sr_datafeed_timing timing;
+	GString *buf;
+	uint64_t num_packets;
+	unsigned int i, type;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_datafeed_stats_set(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_stats_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_datafeed_callback_add(sess, batch_datafeed_in, NULL);
+	sr_session_dev_add(sess, sr_input_dev_inst_get(in));
+
+	batch_logic_packets = 0;
+	batch_logic_bytes = 0;
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0x55, buf->len);
+	for (i = 0; i < 10; i++) {
+		ret = sr_input_send(in, buf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	ret = sr_session_datafeed_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	type = SR_DF_LOGIC - SR_DF_HEADER;
+	fail_unless(stats.packets[type] == batch_logic_packets,
+		"Expected %u logic packets, got %" PRIu64 ".",
+		batch_logic_packets, stats.packets[type]);
+	fail_unless(stats.bytes[type] == 10 * 100,
+		"Expected %d logic bytes, got %" PRIu64 ".",
+		10 * 100, stats.bytes[type]);
+	fail_unless(stats.packets[SR_DF_END - SR_DF_HEADER] == 1);
+
+	num_packets = 0;
+	for (type = 0; type < SR_DATAFEED_STATS_TYPES; type++)
+		num_packets += stats.packets[type];
+	fail_unless(stats.callbacks.calls == num_packets);
+	ret = sr_session_datafeed_callback_timing_get(sess, 0, &timing);
+	fail_unless(ret == SR_OK);
+	fail_unless(timing.calls == num_packets);
+	ret = sr_session_datafeed_callback_timing_get(sess, 1, &timing);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_transform_timing_get(sess, 0, &timing);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether the retained datafeed gets written to a session file,
+ * which holds all of the retained samples.
+ */
+START_TEST(test_session_retention_snapshot)
+{
+	struct sr_session *sess;
+	struct sr_sessionfile_reader *reader;
+	struct sr_input *in;
+	GString *buf;
+	char *filename;
+	uint64_t num_samples;
+	unsigned int i, unitsize;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_retention_set(NULL, 1 << 20, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_retention_snapshot(sess, "bogus.sr");
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_retention_set(sess, 1 << 20, 0);
+	fail_unless(ret == SR_OK);
+	in = merge_input_new(sess, 1000);
+
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0x5a, buf->len);
+	for (i = 0; i < 10; i++)
+		sr_input_send(in, buf);
+	sr_input_end(in);
+
+	filename = g_build_filename(g_get_tmp_dir(), "sigrok-retention.sr", NULL);
+	ret = sr_session_retention_snapshot(sess, filename);
+	fail_unless(ret == SR_OK, "Snapshot failed: %d.", ret);
+	/* Waits for the snapshot to be written. */
+	sr_session_destroy(sess);
+	sr_input_free(in);
+
+	ret = sr_sessionfile_reader_open(filename, &reader);
+	fail_unless(ret == SR_OK, "Cannot open the snapshot: %d.", ret);
+	ret = sr_sessionfile_reader_logic_info(reader, &num_samples, &unitsize);
+	fail_unless(ret == SR_OK);
+	fail_unless(num_samples == 1000, "Expected 1000 samples, got %"
+		PRIu64 ".", num_samples);
+	fail_unless(unitsize == 1);
+	sr_sessionfile_reader_close(reader);
+
+	g_unlink(filename);
+	g_free(filename);
+	g_string_free(buf, TRUE);
+}
+END_TEST
+
+/*
+ * Check that retained packets get charged to the session's memory
+ * budget, and released again.
+ */
+START_TEST(test_session_memory_budget)
+{
+	struct sr_session *sess;
+	struct sr_input *in;
+	GString *buf;
+	uint64_t used, peak, total;
+	unsigned int i;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_memory_budget_set(NULL, 1 << 20);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_memory_limit_set(sess, NULL, 1 << 20);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_memory_usage_get(NULL, NULL, &used, &peak);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_memory_budget_set(sess, 16 << 20);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_retention_set(sess, 1 << 20, 0);
+	fail_unless(ret == SR_OK);
+	in = merge_input_new(sess, 1000);
+
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, 100);
+	memset(buf->str, 0x5a, buf->len);
+	for (i = 0; i < 10; i++)
+		sr_input_send(in, buf);
+	sr_input_end(in);
+
+	ret = sr_session_memory_usage_get(sess, "retention", &used, &peak);
+	fail_unless(ret == SR_OK);
+	fail_unless(used >= 1000, "Expected at least 1000 bytes, got %"
+		PRIu64 ".", used);
+	fail_unless(peak >= used);
+	ret = sr_session_memory_usage_get(sess, NULL, &total, NULL);
+	fail_unless(ret == SR_OK);
+	fail_unless(total >= used);
+	fail_unless(!sr_session_memory_pressure(sess));
+
+	sr_session_retention_set(sess, 0, 0);
+	sr_session_memory_usage_get(sess, "retention", &used, &peak);
+	fail_unless(used == 0, "Retention still holds %" PRIu64 " bytes.",
+		used);
+	fail_unless(peak >= 1000);
+
+	sr_session_destroy(sess);
+	sr_input_free(in);
+	g_string_free(buf, TRUE);
+}
+END_TEST
+
+/* Check that bogus thread settings get rejected. */
+START_TEST(test_session_thread_sched)
+{
+	struct sr_session *sess;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_thread_sched_set(NULL, SR_THREAD_USB, NULL, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_thread_sched_set(sess, SR_THREAD_CLASSES, NULL, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_thread_sched_set(sess, SR_THREAD_USB, "1-x", 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_thread_sched_set(sess, SR_THREAD_USB, "3-2", 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_thread_sched_set(sess, SR_THREAD_USB, NULL, 100);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_thread_sched_set(NULL, SR_THREAD_OUTPUT, "0", 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_thread_sched_set(sess, SR_THREAD_OUTPUT, "0-1,3", 0);
+	fail_unless(ret == SR_OK);
+	ret = sr_thread_sched_set(srtest_ctx, SR_THREAD_TRANSFORM, "", 10);
+	fail_unless(ret == SR_OK);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check that the session file reader rejects bogus arguments. */
+START_TEST(test_sessionfile_reader_bogus)
+{
+	int ret;
+	struct sr_sessionfile_reader *reader;
+	uint64_t num;
+
+	ret = sr_sessionfile_reader_open(NULL, &reader);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_sessionfile_reader_open("/nonexistent.sr", NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	reader = NULL;
+	ret = sr_sessionfile_reader_open("/nonexistent.sr", &reader);
+	fail_unless(ret != SR_OK);
+	fail_unless(reader == NULL);
+	ret = sr_sessionfile_reader_close(NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_sessionfile_reader_logic_info(NULL, &num, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +1281,31 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_datafeed_callback_add_full);
+	tcase_add_test(tc, test_packet_ref_copy);
+	tcase_add_test(tc, test_session_datafeed_ring);
+	tcase_add_test(tc, test_session_datafeed_ring_delivery);
+	tcase_add_test(tc, test_session_device_threads);
+	tcase_add_test(tc, test_session_device_threads_stop);
+	tcase_add_test(tc, test_session_outputs);
+	tcase_add_test(tc, test_session_frame_mailbox);
+	tcase_add_test(tc, test_session_datafeed_batch);
+	tcase_add_test(tc, test_session_datafeed_merge);
+	tcase_add_test(tc, test_packet_info);
+	tcase_add_test(tc, test_session_datafeed_stats);
+	tcase_add_test(tc, test_session_retention_snapshot);
+	tcase_add_test(tc, test_session_memory_budget);
+	tcase_add_test(tc, test_session_thread_sched);
+	tcase_add_test(tc, test_logic_rle_expand);
+	tcase_add_test(tc, test_logic_planar_expand);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("sessionfile");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_sessionfile_reader_bogus);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
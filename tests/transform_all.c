@@ -18,10 +18,287 @@
  */
 
 #include <config.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
+
+/*
+ * The I/O tests run packets through transform instances of a demo
+ * device directly, without running a session. Analog input packets
+ * hold native floats, of the first one or two analog channels.
+ */
+
+static struct sr_session *session;
+static struct sr_dev_inst *sdi;
+static GSList *analog_channels[3];
+
+static struct sr_analog_encoding in_encoding;
+static struct sr_analog_meaning in_meaning;
+static struct sr_analog_spec in_spec;
+static struct sr_datafeed_analog in_analog;
+static struct sr_datafeed_logic in_logic;
+static struct sr_datafeed_packet in_packet;
+/* Payload of the last analog output packet. */
+static const struct sr_datafeed_analog *out_analog;
+
+static void setup_transform(void)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config opt_logic, opt_analog;
+	struct sr_channel *ch;
+	GSList *options, *devices, *l;
+	int ret;
+
+	srtest_setup();
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	opt_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	opt_logic.data = g_variant_new_int32(16);
+	opt_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	opt_analog.data = g_variant_new_int32(2);
+	options = g_slist_append(NULL, &opt_logic);
+	options = g_slist_append(options, &opt_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(opt_logic.data);
+	g_variant_unref(opt_analog.data);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		if (!analog_channels[1])
+			analog_channels[1] = g_slist_append(NULL, ch);
+		analog_channels[2] = g_slist_append(analog_channels[2], ch);
+	}
+	fail_unless(g_slist_length(analog_channels[2]) == 2,
+		"The demo device has no two analog channels.");
+
+	ret = sr_session_new(srtest_ctx, &session);
+	fail_unless(ret == SR_OK, "sr_session_new() failed: %d.", ret);
+	ret = sr_session_dev_add(session, sdi);
+	fail_unless(ret == SR_OK, "sr_session_dev_add() failed: %d.", ret);
+}
+
+static void teardown_transform(void)
+{
+	GSList *l;
+	size_t i;
+
+	for (l = session->transforms; l; l = l->next)
+		sr_transform_free(l->data);
+	g_slist_free(session->transforms);
+	session->transforms = NULL;
+	sr_session_destroy(session);
+	session = NULL;
+	for (i = 0; i < ARRAY_SIZE(analog_channels); i++) {
+		g_slist_free(analog_channels[i]);
+		analog_channels[i] = NULL;
+	}
+
+	srtest_teardown();
+}
+
+/* Create a transform, options are NULL terminated id/value pairs. */
+static const struct sr_transform *transform_new(const char *id, ...)
+{
+	const struct sr_transform_module *tmod;
+	const struct sr_transform *t;
+	GHashTable *options;
+	const char *key;
+	va_list args;
+
+	tmod = sr_transform_find(id);
+	fail_unless(tmod != NULL, "Couldn't find the '%s' transform module.", id);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	va_start(args, id);
+	while ((key = va_arg(args, const char *))) {
+		g_hash_table_insert(options, (char *)key,
+			g_variant_ref_sink(va_arg(args, GVariant *)));
+	}
+	va_end(args);
+	t = sr_transform_new(tmod, options, sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Failed to create the '%s' transform.", id);
+
+	return t;
+}
+
+static struct sr_datafeed_packet *transform_receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet *packet_out;
+	int ret;
+
+	packet_out = NULL;
+	ret = t->module->receive(t, packet, &packet_out);
+	fail_unless(ret == SR_OK, "Transform '%s' failed: %d.",
+		t->module->id, ret);
+
+	return packet_out;
+}
+
+/* Announce a samplerate to a transform, returns the one it passes on. */
+static uint64_t send_samplerate(const struct sr_transform *t, uint64_t samplerate)
+{
+	struct sr_datafeed_packet *packet_out;
+	const struct sr_datafeed_meta *meta_out;
+	const struct sr_config *cfg;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+	uint64_t rate;
+	GSList *l;
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(samplerate));
+	meta.config = g_slist_append(NULL, &src);
+	in_packet.type = SR_DF_META;
+	in_packet.payload = &meta;
+	packet_out = transform_receive(t, &in_packet);
+
+	rate = 0;
+	if (packet_out && packet_out->type == SR_DF_META) {
+		meta_out = packet_out->payload;
+		for (l = meta_out->config; l; l = l->next) {
+			cfg = l->data;
+			if (cfg->key == SR_CONF_SAMPLERATE)
+				rate = g_variant_get_uint64(cfg->data);
+		}
+	}
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+
+	return rate;
+}
+
+static struct sr_channel *logic_channel_get(int index)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && ch->index == index)
+			return ch;
+	}
+	fail_unless(FALSE, "No logic channel %d.", index);
+
+	return NULL;
+}
+
+/* Run logic samples through a transform, returns its output packet. */
+static struct sr_datafeed_packet *send_logic(const struct sr_transform *t,
+		const void *data, uint64_t length, uint16_t unitsize)
+{
+	in_logic.length = length;
+	in_logic.unitsize = unitsize;
+	in_logic.data = (void *)data;
+	in_packet.type = SR_DF_LOGIC;
+	in_packet.payload = &in_logic;
+
+	return transform_receive(t, &in_packet);
+}
+
+/*
+ * Run interleaved values of 'num_channels' channels through a transform.
+ * Returns the floats of the output packet, and their number of samples.
+ */
+static const float *send_analog(const struct sr_transform *t,
+		const float *data, uint32_t num_samples, size_t num_channels,
+		uint32_t *num_out)
+{
+	struct sr_datafeed_packet *packet_out;
+	const struct sr_datafeed_analog *analog;
+
+	memset(&in_encoding, 0, sizeof(in_encoding));
+	in_encoding.unitsize = sizeof(float);
+	in_encoding.is_signed = TRUE;
+	in_encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	in_encoding.is_bigendian = TRUE;
+#endif
+	in_encoding.digits = 6;
+	in_encoding.scale.p = 1;
+	in_encoding.scale.q = 1;
+	in_encoding.offset.p = 0;
+	in_encoding.offset.q = 1;
+	memset(&in_meaning, 0, sizeof(in_meaning));
+	in_meaning.mq = SR_MQ_VOLTAGE;
+	in_meaning.unit = SR_UNIT_VOLT;
+	in_meaning.channels = analog_channels[num_channels];
+	memset(&in_spec, 0, sizeof(in_spec));
+	in_spec.spec_digits = 6;
+	in_analog.data = (void *)data;
+	in_analog.num_samples = num_samples;
+	in_analog.encoding = &in_encoding;
+	in_analog.meaning = &in_meaning;
+	in_analog.spec = &in_spec;
+	in_packet.type = SR_DF_ANALOG;
+	in_packet.payload = &in_analog;
+
+	*num_out = 0;
+	out_analog = NULL;
+	packet_out = transform_receive(t, &in_packet);
+	if (!packet_out)
+		return NULL;
+	fail_unless(packet_out->type == SR_DF_ANALOG,
+		"Expected an analog packet, got type %d.", packet_out->type);
+	out_analog = analog = packet_out->payload;
+	fail_unless(analog->encoding->unitsize == sizeof(float) &&
+		analog->encoding->is_float, "Output values are no floats.");
+	fail_unless(g_slist_length(analog->meaning->channels) == num_channels);
+	*num_out = analog->num_samples;
+
+	return analog->data;
+}
+
+/*
+ * Run input samples through a transform in packets of the given sizes,
+ * the last size repeats. Appends the output values to 'out'.
+ */
+static void send_analog_split(const struct sr_transform *t,
+		const float *data, uint32_t num_samples, size_t num_channels,
+		const uint32_t *sizes, size_t num_sizes, GArray *out)
+{
+	const float *values;
+	uint32_t pos, count, num_out;
+	size_t i;
+
+	for (pos = 0, i = 0; pos < num_samples; pos += count) {
+		count = MIN(sizes[i], num_samples - pos);
+		if (i + 1 < num_sizes)
+			i++;
+		values = send_analog(t, &data[pos * num_channels], count,
+			num_channels, &num_out);
+		if (values)
+			g_array_append_vals(out, values, num_out * num_channels);
+	}
+}
+
+static void check_floats_equal(const GArray *a, const GArray *b, double tolerance)
+{
+	guint i;
+
+	fail_unless(a->len == b->len, "Got %u instead of %u values.",
+		b->len, a->len);
+	for (i = 0; i < a->len; i++) {
+		fail_unless(fabs(g_array_index(a, float, i) -
+			g_array_index(b, float, i)) <= tolerance,
+			"Value %u is %g instead of %g.", i,
+			g_array_index(b, float, i), g_array_index(a, float, i));
+	}
+}
 
 /* Check whether at least one transform module is available. */
 START_TEST(test_transform_available)
@@ -93,6 +370,795 @@ START_TEST(test_transform_options)
 
 	opt = sr_transform_options_get(sr_transform_find("nop"));
 	fail_unless(opt == NULL, "Transform module 'nop' doesn't have options.");
+
+	opt = sr_transform_options_get(sr_transform_find("invert"));
+	fail_unless(opt != NULL, "Transform module 'invert' has options.");
+	fail_unless(!strcmp(opt[0]->id, "channels"),
+		"Transform module 'invert' has no 'channels' option.");
+	sr_transform_options_free(opt);
+
+	fail_unless(sr_transform_find("repack") != NULL,
+		"Couldn't find the 'repack' transform module.");
+}
+END_TEST
+
+/*
+ * Check whether the invert transform flips the bits of the selected
+ * channels only, or of all channels without a selection. Unit sizes
+ * which do and don't divide a word take different code paths.
+ */
+START_TEST(test_invert_channels)
+{
+	static const char *selections[] = { "D1,D6,D9", "" };
+	static const uint8_t masks[][3] = {
+		{ 0x42, 0x02, 0x00 },
+		{ 0xff, 0xff, 0xff },
+	};
+	const struct sr_transform *t;
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet *packet_out;
+	uint8_t in[60], expect[60];
+	uint16_t unitsize;
+	size_t k, i;
+
+	for (k = 0; k < ARRAY_SIZE(selections); k++) {
+		t = transform_new("invert",
+			"channels", g_variant_new_string(selections[k]), NULL);
+		for (unitsize = 1; unitsize <= 3; unitsize++) {
+			for (i = 0; i < sizeof(in); i++) {
+				in[i] = i * 13;
+				expect[i] = in[i] ^ masks[k][i % unitsize];
+			}
+			packet_out = send_logic(t, in, sizeof(in), unitsize);
+			fail_unless(packet_out && packet_out->type == SR_DF_LOGIC,
+				"Expected a logic packet.");
+			logic = packet_out->payload;
+			fail_unless(logic->unitsize == unitsize &&
+				logic->length == sizeof(in), "Wrong packet layout.");
+			for (i = 0; i < sizeof(in); i++) {
+				fail_unless(((const uint8_t *)logic->data)[i] == expect[i],
+					"'%s', unit size %u: byte %zu is 0x%02x "
+					"instead of 0x%02x.", selections[k], unitsize, i,
+					((const uint8_t *)logic->data)[i], expect[i]);
+			}
+		}
+	}
+}
+END_TEST
+
+/*
+ * Check whether repacking keeps the channels' bit positions, and clears
+ * the bits of disabled channels. Partial samples at the end of packets
+ * get dropped.
+ */
+START_TEST(test_repack_channels)
+{
+	static const uint8_t mask[] = { 0xfb, 0xef };
+	const struct sr_transform *t;
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet *packet_out, header;
+	uint8_t in[9 * 3 + 1], *out;
+	uint16_t unitsize, out_unitsize;
+	size_t i, k;
+	int index;
+
+	/* D2 and the second byte's channels off, samples shrink to a byte. */
+	sr_dev_channel_enable(logic_channel_get(2), FALSE);
+	for (index = 8; index < 16; index++)
+		sr_dev_channel_enable(logic_channel_get(index), FALSE);
+	t = transform_new("repack", NULL);
+
+	for (out_unitsize = 1; out_unitsize <= 2; out_unitsize++) {
+		if (out_unitsize == 2) {
+			/* Only D12 off in the second byte, which stays. */
+			for (index = 8; index < 16; index++) {
+				sr_dev_channel_enable(logic_channel_get(index),
+					index != 12);
+			}
+			header.type = SR_DF_HEADER;
+			header.payload = NULL;
+			transform_receive(t, &header);
+		}
+		for (unitsize = out_unitsize; unitsize <= 3; unitsize++) {
+			for (i = 0; i < sizeof(in); i++)
+				in[i] = 0xff - i * 7;
+			packet_out = send_logic(t, in, 9 * unitsize + 1, unitsize);
+			fail_unless(packet_out && packet_out->type == SR_DF_LOGIC,
+				"Expected a logic packet.");
+			logic = packet_out->payload;
+			fail_unless(logic->unitsize == out_unitsize,
+				"Unit size %u instead of %u.", logic->unitsize,
+				out_unitsize);
+			fail_unless(logic->length == 9 * out_unitsize,
+				"Got %" PRIu64 " instead of %u bytes.", logic->length,
+				9 * out_unitsize);
+			out = logic->data;
+			for (i = 0; i < 9; i++) {
+				for (k = 0; k < out_unitsize; k++) {
+					fail_unless(out[i * out_unitsize + k] ==
+						((uint8_t)(0xff - (i * unitsize + k) * 7) & mask[k]),
+						"Unit size %u to %u: sample %zu byte %zu "
+						"is 0x%02x.", unitsize, out_unitsize, i, k,
+						out[i * out_unitsize + k]);
+				}
+			}
+		}
+	}
+}
+END_TEST
+
+/*
+ * Check the designed lowpass filter at DC and at the Nyquist frequency,
+ * with a constant on the first channel and an alternating signal on the
+ * second channel.
+ */
+START_TEST(test_filter_lowpass)
+{
+	const struct sr_transform *t;
+	const float *out;
+	float in[2 * 500];
+	uint32_t num_out, i;
+
+	t = transform_new("filter", "cutoff", g_variant_new_double(50.0),
+		"stages", g_variant_new_uint64(2), NULL);
+	send_samplerate(t, SR_KHZ(1));
+
+	for (i = 0; i < 500; i++) {
+		in[2 * i] = 1.0;
+		in[2 * i + 1] = (i & 1) ? -1.0 : 1.0;
+	}
+	out = send_analog(t, in, 500, 2, &num_out);
+	fail_unless(out != NULL, "The filter sent no output.");
+	fail_unless(num_out == 500, "Got %u instead of 500 samples.", num_out);
+	/* Skip the filter's step response. */
+	for (i = 400; i < 500; i++) {
+		fail_unless(fabs(out[2 * i] - 1.0) < 1e-4,
+			"DC sample %u is %g instead of 1.", i, out[2 * i]);
+		fail_unless(fabs(out[2 * i + 1]) < 1e-4,
+			"Nyquist sample %u is %g instead of 0.", i, out[2 * i + 1]);
+	}
+}
+END_TEST
+
+/*
+ * Check whether the filter state carries over from one packet to the
+ * next, for FIR taps and biquads: input that is split across packets
+ * of varying sizes must filter to the same values as a single packet.
+ */
+START_TEST(test_filter_packets)
+{
+	static const uint32_t whole[] = { 400 };
+	static const uint32_t split[] = { 1, 2, 7, 64, 3, 100 };
+	const struct sr_transform *t1, *t2;
+	GArray *out1, *out2;
+	float in[2 * 400];
+	uint32_t i;
+
+	t1 = transform_new("filter", "taps", g_variant_new_string("0.25,0.5,0.25"),
+		"biquads", g_variant_new_string("0.2,0.4,0.2,1,-0.3,0.1"), NULL);
+	t2 = transform_new("filter", "taps", g_variant_new_string("0.25,0.5,0.25"),
+		"biquads", g_variant_new_string("0.2,0.4,0.2,1,-0.3,0.1"), NULL);
+
+	for (i = 0; i < 400; i++) {
+		in[2 * i] = sin(i * 0.3) + 0.5 * sin(i * 2.1);
+		in[2 * i + 1] = (i % 7) - 3.0;
+	}
+	out1 = g_array_new(FALSE, FALSE, sizeof(float));
+	out2 = g_array_new(FALSE, FALSE, sizeof(float));
+	send_analog_split(t1, in, 400, 2, whole, ARRAY_SIZE(whole), out1);
+	send_analog_split(t2, in, 400, 2, split, ARRAY_SIZE(split), out2);
+	check_floats_equal(out1, out2, 1e-6);
+	g_array_free(out1, TRUE);
+	g_array_free(out2, TRUE);
+}
+END_TEST
+
+#define FFT_SIZE	64
+#define FFT_BINS	(FFT_SIZE / 2 + 1)
+
+/*
+ * Check the peak bins of sines which complete whole periods in a frame.
+ * The rectangular window keeps all of a sine's amplitude in its bin,
+ * the Hann window leaks half the amplitude into both neighbour bins.
+ */
+START_TEST(test_fft_peak)
+{
+	static const char *windows[] = { "rectangular", "hann" };
+	const struct sr_transform *t;
+	const float *out;
+	float in[2 * FFT_SIZE], expect[2][FFT_BINS], leak;
+	unsigned int w, i, c;
+	uint32_t num_out;
+
+	for (i = 0; i < FFT_SIZE; i++) {
+		in[2 * i] = 2.0 * sin(2 * G_PI * 5 * i / FFT_SIZE);
+		in[2 * i + 1] = cos(2 * G_PI * 12 * i / FFT_SIZE);
+	}
+
+	for (w = 0; w < ARRAY_SIZE(windows); w++) {
+		t = transform_new("fft", "size", g_variant_new_uint64(FFT_SIZE),
+			"window", g_variant_new_string(windows[w]),
+			"overlap", g_variant_new_uint64(0), NULL);
+
+		leak = (w == 0) ? 0.0 : 0.5;
+		memset(expect, 0, sizeof(expect));
+		expect[0][5] = 2.0;
+		expect[0][4] = expect[0][6] = 2.0 * leak;
+		expect[1][12] = 1.0;
+		expect[1][11] = expect[1][13] = leak;
+
+		out = send_analog(t, in, FFT_SIZE, 2, &num_out);
+		fail_unless(out != NULL, "No spectrum for a whole frame.");
+		fail_unless(num_out == FFT_BINS, "Got %u instead of %d bins.",
+			num_out, FFT_BINS);
+		fail_unless(out_analog->meaning->mqflags & SR_MQFLAG_SPECTRUM,
+			"Spectrum packets need the spectrum flag.");
+		for (i = 0; i < FFT_BINS; i++) {
+			for (c = 0; c < 2; c++) {
+				fail_unless(fabs(out[2 * i + c] - expect[c][i]) < 1e-4,
+					"%s window, channel %u: bin %u is %g instead of %g.",
+					windows[w], c, i, out[2 * i + c], expect[c][i]);
+			}
+		}
+	}
+}
+END_TEST
+
+/*
+ * Check whether frames span packets: input that is split across packets
+ * gives the same spectra as a single packet, and packets which complete
+ * no frame give no output.
+ */
+START_TEST(test_fft_packets)
+{
+	static const uint32_t whole[] = { 256 };
+	static const uint32_t split[] = { 10, 30, 50, 100, 1 };
+	const struct sr_transform *t1, *t2;
+	const float *out;
+	GArray *out1, *out2;
+	float in[2 * 256];
+	uint32_t num_out, i;
+
+	t1 = transform_new("fft", "size", g_variant_new_uint64(FFT_SIZE), NULL);
+	t2 = transform_new("fft", "size", g_variant_new_uint64(FFT_SIZE), NULL);
+
+	for (i = 0; i < 256; i++) {
+		in[2 * i] = sin(i * 0.4) + 0.25;
+		in[2 * i + 1] = sin(i * 1.3) * cos(i * 0.05);
+	}
+	out1 = g_array_new(FALSE, FALSE, sizeof(float));
+	out2 = g_array_new(FALSE, FALSE, sizeof(float));
+	send_analog_split(t1, in, 256, 2, whole, ARRAY_SIZE(whole), out1);
+	/* Frames of 64 samples, with the default overlap of 50%. */
+	fail_unless(out1->len == 7 * FFT_BINS * 2, "Got %u instead of %d values.",
+		out1->len, 7 * FFT_BINS * 2);
+
+	out = send_analog(t2, in, 10, 2, &num_out);
+	fail_unless(out == NULL, "Output before a frame was complete.");
+	send_analog_split(t2, &in[2 * 10], 256 - 10, 2, split, ARRAY_SIZE(split),
+		out2);
+	check_floats_equal(out1, out2, 1e-5);
+	g_array_free(out1, TRUE);
+	g_array_free(out2, TRUE);
+}
+END_TEST
+
+/*
+ * Check the boxcar average of blocks which span packets, for the single
+ * channel and the multi channel code paths, and the reduced samplerate.
+ */
+START_TEST(test_decimate_average)
+{
+	static const uint32_t split[] = { 3, 6, 7 };
+	const struct sr_transform *t;
+	GArray *out, *expect;
+	float in[2 * 16], v;
+	uint64_t rate;
+	size_t nch, c;
+	uint32_t i;
+
+	for (nch = 1; nch <= 2; nch++) {
+		t = transform_new("decimate", "factor", g_variant_new_uint64(4),
+			NULL);
+		rate = send_samplerate(t, SR_MHZ(1));
+		fail_unless(rate == SR_KHZ(250), "Samplerate %" PRIu64
+			" instead of 250 kHz.", rate);
+
+		for (i = 0; i < 16; i++) {
+			in[nch * i] = i;
+			if (nch == 2)
+				in[nch * i + 1] = (i % 4 == 1) ? 8.0 : 0.0;
+		}
+		expect = g_array_new(FALSE, FALSE, sizeof(float));
+		for (i = 0; i < 4; i++) {
+			for (c = 0; c < nch; c++) {
+				v = (c == 0) ? 4 * i + 1.5 : 2.0;
+				g_array_append_val(expect, v);
+			}
+		}
+		out = g_array_new(FALSE, FALSE, sizeof(float));
+		send_analog_split(t, in, 16, nch, split, ARRAY_SIZE(split), out);
+		check_floats_equal(expect, out, 1e-6);
+		g_array_free(out, TRUE);
+		g_array_free(expect, TRUE);
+	}
+}
+END_TEST
+
+/*
+ * Check the envelope of blocks which span packets: each block gives its
+ * minimum, then its maximum, at twice the reduced samplerate.
+ */
+START_TEST(test_decimate_minmax)
+{
+	static const uint32_t split[] = { 5, 11, 2 };
+	const struct sr_transform *t;
+	GArray *out, *expect;
+	float in[2 * 32], lo, hi;
+	uint64_t rate;
+	size_t nch, c;
+	uint32_t i, b;
+
+	for (nch = 1; nch <= 2; nch++) {
+		t = transform_new("decimate", "factor", g_variant_new_uint64(8),
+			"analog", g_variant_new_string("minmax"), NULL);
+		rate = send_samplerate(t, SR_MHZ(1));
+		fail_unless(rate == SR_KHZ(250), "Samplerate %" PRIu64
+			" instead of 250 kHz.", rate);
+
+		for (i = 0; i < 32 * nch; i++)
+			in[i] = (float)((i * 7) % 11) - 5;
+		expect = g_array_sized_new(FALSE, FALSE, sizeof(float), 8 * nch);
+		g_array_set_size(expect, 8 * nch);
+		for (b = 0; b < 4; b++) {
+			for (c = 0; c < nch; c++) {
+				lo = hi = in[8 * b * nch + c];
+				for (i = 8 * b; i < 8 * b + 8; i++) {
+					lo = MIN(lo, in[i * nch + c]);
+					hi = MAX(hi, in[i * nch + c]);
+				}
+				g_array_index(expect, float, 2 * b * nch + c) = lo;
+				g_array_index(expect, float, (2 * b + 1) * nch + c) = hi;
+			}
+		}
+		out = g_array_new(FALSE, FALSE, sizeof(float));
+		send_analog_split(t, in, 32, nch, split, ARRAY_SIZE(split), out);
+		check_floats_equal(expect, out, 0);
+		g_array_free(out, TRUE);
+		g_array_free(expect, TRUE);
+	}
+}
+END_TEST
+
+/*
+ * Check glitch-safe logic decimation, which keeps a change of a block
+ * even if it doesn't last to the sampled position, against sampling.
+ */
+START_TEST(test_decimate_logic)
+{
+	static const uint8_t in[] = {
+		0, 0, 1, 0,  0, 0, 0, 0,  1, 1, 1, 1,  1, 0, 1, 1,
+	};
+	static const uint8_t glitch_safe[] = { 1, 0, 1, 0 };
+	static const uint8_t sampled[] = { 0, 0, 1, 1 };
+	static const char *modes[] = { "glitch-safe", "sample" };
+	const uint8_t *expect[] = { glitch_safe, sampled };
+	const struct sr_transform *t;
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet *packet_out;
+	const uint8_t *out;
+	size_t m;
+
+	for (m = 0; m < ARRAY_SIZE(modes); m++) {
+		t = transform_new("decimate", "factor", g_variant_new_uint64(4),
+			"logic", g_variant_new_string(modes[m]), NULL);
+		packet_out = send_logic(t, in, 3, 1);
+		fail_unless(packet_out == NULL, "Output before a block was complete.");
+		packet_out = send_logic(t, &in[3], sizeof(in) - 3, 1);
+		fail_unless(packet_out && packet_out->type == SR_DF_LOGIC,
+			"No logic output.");
+		logic = packet_out->payload;
+		fail_unless(logic->unitsize == 1 && logic->length == 4,
+			"Got %" PRIu64 " instead of 4 bytes.", logic->length);
+		out = logic->data;
+		fail_unless(memcmp(out, expect[m], 4) == 0,
+			"Wrong %s output %u %u %u %u.", modes[m],
+			out[0], out[1], out[2], out[3]);
+	}
+}
+END_TEST
+
+/* Check the runs of an RLE packet against the expected values and lengths. */
+static void check_runs(const struct sr_datafeed_packet *packet,
+		uint16_t unitsize, const void *values, const uint64_t *lengths,
+		uint64_t num_runs)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t i;
+
+	fail_unless(packet && packet->type == SR_DF_LOGIC_RLE,
+		"Expected an RLE packet.");
+	rle = packet->payload;
+	fail_unless(rle->unitsize == unitsize, "Unit size %u instead of %u.",
+		rle->unitsize, unitsize);
+	fail_unless(rle->num_runs == num_runs, "Got %" PRIu64
+		" instead of %" PRIu64 " runs.", rle->num_runs, num_runs);
+	for (i = 0; i < num_runs; i++) {
+		fail_unless(rle->run_lengths[i] == lengths[i], "Run %" PRIu64
+			" has %" PRIu64 " instead of %" PRIu64 " samples.",
+			i, rle->run_lengths[i], lengths[i]);
+	}
+	fail_unless(memcmp(rle->values, values, num_runs * unitsize) == 0,
+		"Wrong run values.");
+}
+
+/* Check whether every change of the logic samples starts a run. */
+START_TEST(test_changes_edges)
+{
+	static const uint8_t in[] = { 0, 0, 0, 1, 1, 3, 3, 3, 3, 0 };
+	static const uint8_t values[] = { 0, 1, 3, 0 };
+	static const uint64_t lengths[] = { 3, 2, 4, 1 };
+	static const uint64_t lengths_wide[] = { 777, 123, 99, 1 };
+	const uint16_t values_wide[] = { 0x0100, 0x0101, 0x0001, 0x8001 };
+	const struct sr_transform *t;
+	struct sr_datafeed_packet *packet_out;
+	uint16_t in_wide[1000];
+	unsigned int i;
+
+	t = transform_new("changes", NULL);
+	packet_out = send_logic(t, in, sizeof(in), 1);
+	check_runs(packet_out, 1, values, lengths, ARRAY_SIZE(values));
+
+	/* Long runs, changes in either byte, and a change at the end. */
+	for (i = 0; i < ARRAY_SIZE(in_wide); i++) {
+		if (i < 777)
+			in_wide[i] = 0x0100;
+		else if (i < 900)
+			in_wide[i] = 0x0101;
+		else if (i < 999)
+			in_wide[i] = 0x0001;
+		else
+			in_wide[i] = 0x8001;
+	}
+	packet_out = send_logic(t, in_wide, sizeof(in_wide), sizeof(in_wide[0]));
+	check_runs(packet_out, 2, values_wide, lengths_wide,
+		ARRAY_SIZE(values_wide));
+}
+END_TEST
+
+/* Samplerates of the resample tests, from and to. */
+static const uint64_t resample_rates[][2] = {
+	{ SR_KHZ(1), SR_KHZ(2) },
+	{ SR_KHZ(3), SR_KHZ(2) },
+};
+
+/*
+ * Check that logic samples get held, at an integer and a fractional
+ * ratio: output sample n is input sample n * in_rate / out_rate. Input
+ * split across packets resamples like a single packet.
+ */
+START_TEST(test_resample_logic)
+{
+	static const uint64_t whole[] = { 30 };
+	static const uint64_t split[] = { 7, 11, 12 };
+	const uint64_t *sizes[] = { whole, split };
+	const size_t num_sizes[] = { ARRAY_SIZE(whole), ARRAY_SIZE(split) };
+	const struct sr_transform *t;
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet *packet_out;
+	GByteArray *out;
+	uint8_t in[30];
+	uint64_t in_rate, out_rate, rate, pos, n, count;
+	size_t r, k, i;
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = i;
+
+	for (r = 0; r < ARRAY_SIZE(resample_rates); r++) {
+		in_rate = resample_rates[r][0];
+		out_rate = resample_rates[r][1];
+		for (k = 0; k < ARRAY_SIZE(sizes); k++) {
+			t = transform_new("resample",
+				"rate", g_variant_new_uint64(out_rate), NULL);
+			rate = send_samplerate(t, in_rate);
+			fail_unless(rate == out_rate, "Samplerate %" PRIu64
+				" instead of %" PRIu64 ".", rate, out_rate);
+
+			out = g_byte_array_new();
+			for (pos = 0, i = 0; pos < sizeof(in); pos += count) {
+				count = MIN(sizes[k][i], sizeof(in) - pos);
+				if (i + 1 < num_sizes[k])
+					i++;
+				packet_out = send_logic(t, &in[pos], count, 1);
+				if (!packet_out)
+					continue;
+				fail_unless(packet_out->type == SR_DF_LOGIC,
+					"Expected a logic packet.");
+				logic = packet_out->payload;
+				g_byte_array_append(out, logic->data, logic->length);
+			}
+
+			fail_unless(out->len == sizeof(in) * out_rate / in_rate,
+				"Got %u instead of %" PRIu64 " samples.", out->len,
+				sizeof(in) * out_rate / in_rate);
+			for (n = 0; n < out->len; n++) {
+				fail_unless(out->data[n] == n * in_rate / out_rate,
+					"Sample %" PRIu64 " is %u instead of %" PRIu64 ".",
+					n, out->data[n], n * in_rate / out_rate);
+			}
+			g_byte_array_free(out, TRUE);
+		}
+	}
+}
+END_TEST
+
+static void resample_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_analog *analog;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_ANALOG)
+		return;
+	analog = packet->payload;
+	g_array_append_vals(cb_data, analog->data, analog->num_samples *
+		g_slist_length(analog->meaning->channels));
+}
+
+/*
+ * Check the length and the values of resampled analog data, at an
+ * integer and a fractional ratio. The last output samples get sent at
+ * the end of the acquisition. Input split across packets resamples
+ * like a single packet.
+ */
+START_TEST(test_resample_analog)
+{
+	static const uint32_t whole[] = { 300 };
+	static const uint32_t split[] = { 7, 50, 100, 1, 142 };
+	const struct sr_transform *t1, *t2;
+	GArray *out1, *out2;
+	float in[2 * 300], v;
+	uint64_t in_rate, out_rate;
+	double pos;
+	size_t r, n;
+	uint32_t i;
+
+	for (i = 0; i < 300; i++) {
+		in[2 * i] = sin(2 * G_PI * 0.02 * i);
+		in[2 * i + 1] = 1.5;
+	}
+
+	for (r = 0; r < ARRAY_SIZE(resample_rates); r++) {
+		in_rate = resample_rates[r][0];
+		out_rate = resample_rates[r][1];
+		t1 = transform_new("resample",
+			"rate", g_variant_new_uint64(out_rate), NULL);
+		t2 = transform_new("resample",
+			"rate", g_variant_new_uint64(out_rate), NULL);
+		send_samplerate(t1, in_rate);
+		send_samplerate(t2, in_rate);
+
+		out1 = g_array_new(FALSE, FALSE, sizeof(float));
+		out2 = g_array_new(FALSE, FALSE, sizeof(float));
+		send_analog_split(t1, in, 300, 2, whole, ARRAY_SIZE(whole), out1);
+		send_analog_split(t2, in, 300, 2, split, ARRAY_SIZE(split), out2);
+		in_packet.type = SR_DF_END;
+		in_packet.payload = NULL;
+		sr_session_datafeed_callback_add(session, resample_datafeed_in, out1);
+		transform_receive(t1, &in_packet);
+		sr_session_datafeed_callback_remove_all(session);
+		sr_session_datafeed_callback_add(session, resample_datafeed_in, out2);
+		transform_receive(t2, &in_packet);
+		sr_session_datafeed_callback_remove_all(session);
+
+		fail_unless(out1->len == 2 * 300 * out_rate / in_rate,
+			"Got %u instead of %" PRIu64 " values.", out1->len,
+			2 * 300 * out_rate / in_rate);
+		check_floats_equal(out1, out2, 1e-6);
+		for (n = 0; n < out1->len / 2; n++) {
+			v = g_array_index(out1, float, 2 * n + 1);
+			fail_unless(fabs(v - 1.5) < 1e-5,
+				"Constant sample %zu is %g instead of 1.5.", n, v);
+			/* The sine starts and ends with a step. */
+			pos = (double)n * in_rate / out_rate;
+			if (pos < 30 || pos > 270)
+				continue;
+			v = g_array_index(out1, float, 2 * n);
+			fail_unless(fabs(v - sin(2 * G_PI * 0.02 * pos)) < 1e-3,
+				"Sample %zu is %g instead of %g.", n, v,
+				sin(2 * G_PI * 0.02 * pos));
+		}
+		g_array_free(out1, TRUE);
+		g_array_free(out2, TRUE);
+	}
+}
+END_TEST
+
+/* Statistics packets, which transforms send to the session directly. */
+struct stats_packet {
+	enum sr_mq mq;
+	enum sr_mqflag mqflags;
+	size_t num_values;
+	float values[16];
+};
+
+static void stats_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_analog *analog;
+	struct stats_packet sp;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_ANALOG)
+		return;
+	analog = packet->payload;
+	fail_unless(analog->num_samples == 1, "Got %u statistics samples.",
+		analog->num_samples);
+	sp.mq = analog->meaning->mq;
+	sp.mqflags = analog->meaning->mqflags;
+	sp.num_values = g_slist_length(analog->meaning->channels);
+	fail_unless(sp.num_values <= ARRAY_SIZE(sp.values));
+	memcpy(sp.values, analog->data, sp.num_values * sizeof(float));
+	g_array_append_val(cb_data, sp);
+}
+
+/* Logic levels of the measure test, by sample and channel. */
+static gboolean measure_level(unsigned int i, unsigned int ch)
+{
+	if (ch == 0)
+		return (i % 10) < 3;
+	if (ch == 1)
+		return (i % 4) >= 2;
+
+	return FALSE;
+}
+
+/*
+ * Check frequency, duty cycle and edge counts of square waves, over two
+ * whole blocks and the part of a block at the end. Packets end at edges
+ * and at a block boundary, the edges must be counted anyway.
+ */
+START_TEST(test_measure_square)
+{
+	static const uint64_t sizes[] = { 10, 30, 60, 2, 98, 50 };
+	/* Per block and channel 0 and 1: frequency, duty cycle, edges. */
+	static const float expect[3][2][3] = {
+		{ { 100000, 30, 19 }, { 250000, 50, 49 } },
+		{ { 100000, 30, 20 }, { 250000, 50, 50 } },
+		{ { 100000, 30, 10 }, { 250000, 48, 25 } },
+	};
+	static const enum sr_mq mqs[] = {
+		SR_MQ_FREQUENCY, SR_MQ_DUTY_CYCLE, SR_MQ_COUNT,
+	};
+	const struct sr_transform *t;
+	const struct stats_packet *sp;
+	struct sr_datafeed_packet *packet_out, end;
+	uint8_t in[2 * 250];
+	GArray *out;
+	unsigned int i, ch, b, m;
+	uint64_t pos;
+	float v;
+
+	memset(in, 0, sizeof(in));
+	for (i = 0; i < 250; i++) {
+		for (ch = 0; ch < 16; ch++)
+			in[2 * i + ch / 8] |= measure_level(i, ch) << (ch % 8);
+	}
+
+	t = transform_new("measure", "block", g_variant_new_uint64(100), NULL);
+	send_samplerate(t, SR_MHZ(1));
+	out = g_array_new(FALSE, FALSE, sizeof(struct stats_packet));
+	sr_session_datafeed_callback_add(session, stats_datafeed_in, out);
+	for (pos = 0, i = 0; i < ARRAY_SIZE(sizes); pos += sizes[i++]) {
+		packet_out = send_logic(t, &in[2 * pos], 2 * sizes[i], 2);
+		fail_unless(packet_out == NULL, "Logic data got passed on.");
+	}
+	fail_unless(out->len == 2 * 3, "Got %u instead of %d packets.",
+		out->len, 2 * 3);
+	end.type = SR_DF_END;
+	end.payload = NULL;
+	transform_receive(t, &end);
+	sr_session_datafeed_callback_remove_all(session);
+
+	fail_unless(out->len == 3 * 3, "Got %u instead of %d packets.",
+		out->len, 3 * 3);
+	for (b = 0; b < 3; b++) {
+		for (m = 0; m < 3; m++) {
+			sp = &g_array_index(out, struct stats_packet, 3 * b + m);
+			fail_unless(sp->mq == mqs[m], "Packet %u has MQ %d.",
+				3 * b + m, sp->mq);
+			fail_unless(sp->num_values == 16, "Packet %u has %zu "
+				"channels.", 3 * b + m, sp->num_values);
+			for (ch = 0; ch < 16; ch++) {
+				v = ch < 2 ? expect[b][ch][m] : 0;
+				fail_unless(fabs(sp->values[ch] - v) <= 1e-3 * v,
+					"Block %u, channel %u, MQ %d: %g instead "
+					"of %g.", b, ch, sp->mq, sp->values[ch], v);
+			}
+		}
+	}
+	g_array_free(out, TRUE);
+}
+END_TEST
+
+/*
+ * Check the statistics of blocks against hand computed values. The
+ * first block spans two packets, the next one gets cut short by the
+ * start of a frame, the last one by the end of the acquisition.
+ */
+START_TEST(test_stats_blocks)
+{
+	static const float in[][2] = {
+		{ 1, -2 }, { 2, 2 }, { 3, -2 },
+		{ 4, 2 }, { 5, 3 }, { 6, -3 },
+		/* Frame begin. */
+		{ 10, 4 }, { 20, 4 }, { 30, 4 }, { 40, 4 }, { 7, -5 },
+	};
+	static const uint32_t sizes[] = { 3, 3, 5 };
+	/* Per block and channel: min, max, mean, RMS. */
+	static const float expect[4][2][4] = {
+		{ { 1, 4, 2.5, 2.7386128 }, { -2, 2, 0, 2 } },
+		{ { 5, 6, 5.5, 5.5226805 }, { -3, 3, 0, 3 } },
+		{ { 10, 40, 25, 27.386128 }, { 4, 4, 4, 4 } },
+		{ { 7, 7, 7, 7 }, { -5, -5, -5, 5 } },
+	};
+	static const enum sr_mqflag flags[] = {
+		SR_MQFLAG_MIN, SR_MQFLAG_MAX, SR_MQFLAG_AVG, SR_MQFLAG_RMS,
+	};
+	const struct sr_transform *t;
+	const struct stats_packet *sp;
+	struct sr_datafeed_packet packet, *packet_out;
+	const float *values;
+	GArray *out;
+	unsigned int b, m, c, pos, i;
+	uint32_t num_out;
+
+	t = transform_new("stats", "block", g_variant_new_uint64(4), NULL);
+	out = g_array_new(FALSE, FALSE, sizeof(struct stats_packet));
+	sr_session_datafeed_callback_add(session, stats_datafeed_in, out);
+
+	for (pos = 0, i = 0; i < ARRAY_SIZE(sizes); pos += sizes[i++]) {
+		if (i == 2) {
+			fail_unless(out->len == 4, "Got %u instead of 4 packets.",
+				out->len);
+			packet.type = SR_DF_FRAME_BEGIN;
+			packet.payload = NULL;
+			packet_out = transform_receive(t, &packet);
+			fail_unless(packet_out == &packet,
+				"Frame begin didn't pass on.");
+			fail_unless(out->len == 8, "Got %u instead of 8 packets.",
+				out->len);
+		}
+		values = send_analog(t, in[pos], sizes[i], 2, &num_out);
+		fail_unless(values == NULL, "Analog data got passed on.");
+		if (i == 0)
+			fail_unless(out->len == 0, "Statistics of a partial block.");
+	}
+	fail_unless(out->len == 12, "Got %u instead of 12 packets.", out->len);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	transform_receive(t, &packet);
+	sr_session_datafeed_callback_remove_all(session);
+
+	fail_unless(out->len == 16, "Got %u instead of 16 packets.", out->len);
+	for (b = 0; b < 4; b++) {
+		for (m = 0; m < 4; m++) {
+			sp = &g_array_index(out, struct stats_packet, 4 * b + m);
+			fail_unless(sp->mqflags & flags[m],
+				"Packet %u lacks flag 0x%x.", 4 * b + m, flags[m]);
+			fail_unless(sp->mq == SR_MQ_VOLTAGE && sp->num_values == 2,
+				"Packet %u lost its meaning.", 4 * b + m);
+			for (c = 0; c < 2; c++) {
+				fail_unless(fabs(sp->values[c] - expect[b][c][m]) < 1e-5,
+					"Block %u, channel %u, statistic %u: %g "
+					"instead of %g.", b, c, m, sp->values[c],
+					expect[b][c][m]);
+			}
+		}
+	}
+	g_array_free(out, TRUE);
 }
 END_TEST
 
@@ -112,5 +1178,51 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("logic");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_invert_channels);
+	tcase_add_test(tc, test_repack_channels);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("filter");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_filter_lowpass);
+	tcase_add_test(tc, test_filter_packets);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("fft");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_fft_peak);
+	tcase_add_test(tc, test_fft_packets);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("decimate");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_decimate_average);
+	tcase_add_test(tc, test_decimate_minmax);
+	tcase_add_test(tc, test_decimate_logic);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("changes");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_changes_edges);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("resample");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_resample_logic);
+	tcase_add_test(tc, test_resample_analog);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("measure");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_measure_square);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, setup_transform, teardown_transform);
+	tcase_add_test(tc, test_stats_blocks);
+	suite_add_tcase(s, tc);
+
 	return s;
 }